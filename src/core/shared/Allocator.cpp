@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef HLTOOLS_ALLOCATOR_MIMALLOC
+#include <mimalloc.h>
+#elif defined( HLTOOLS_ALLOCATOR_JEMALLOC )
+#include <jemalloc/jemalloc.h>
+#endif
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
+
+#include "Logging.h"
+#include "Platform.h"
+
+#ifndef WIN32
+#include <execinfo.h>
+#endif
+
+#include "Allocator.h"
+
+namespace mem
+{
+namespace
+{
+const size_t NUM_TAGS = static_cast<size_t>( Tag::COUNT );
+
+const char* const TAG_NAMES[ NUM_TAGS ] =
+{
+	"General",
+	"Studio models",
+	"Studio textures",
+	"Sprites",
+	"Scratch"
+};
+
+/**
+*	Stored in front of every allocation.
+*/
+struct AllocationHeader_t
+{
+	IAllocator* pAllocator;
+	size_t uiSize;
+	Tag tag;
+
+	/**
+	*	Index + 1 of the stack record of the allocation, or 0 if its stack wasn't captured.
+	*/
+	uint32_t uiStack;
+};
+
+/**
+*	Size reserved for the header. Keeps the memory after it aligned like the backend's memory.
+*/
+const size_t HEADER_SIZE = 32;
+
+static_assert( sizeof( AllocationHeader_t ) <= HEADER_SIZE, "Allocation header is larger than the space reserved for it" );
+static_assert( HEADER_SIZE % alignof( std::max_align_t ) == 0, "Allocation header breaks alignment" );
+
+/**
+*	Most frames recorded per stack.
+*/
+const size_t MAX_STACK_FRAMES = 16;
+
+/**
+*	Frames skipped when capturing: CaptureStack and Allocate.
+*/
+const size_t SKIPPED_STACK_FRAMES = 2;
+
+/**
+*	Stacks printed by mem_stacks by default.
+*/
+const size_t DEFAULT_REPORTED_STACKS = 10;
+
+class CCRTAllocator final : public IAllocator
+{
+public:
+	const char* GetName() const override { return "C runtime"; }
+
+	void* Allocate( const size_t uiSize ) override { return malloc( uiSize ); }
+
+	void Free( void* pMemory ) override { free( pMemory ); }
+};
+
+#ifdef HLTOOLS_ALLOCATOR_MIMALLOC
+class CMimallocAllocator final : public IAllocator
+{
+public:
+	const char* GetName() const override { return "mimalloc"; }
+
+	void* Allocate( const size_t uiSize ) override { return mi_malloc( uiSize ); }
+
+	void Free( void* pMemory ) override { mi_free( pMemory ); }
+};
+#elif defined( HLTOOLS_ALLOCATOR_JEMALLOC )
+class CJemallocAllocator final : public IAllocator
+{
+public:
+	const char* GetName() const override { return "jemalloc"; }
+
+	//Sizes are never 0 since they include the header.
+	void* Allocate( const size_t uiSize ) override { return mallocx( uiSize, 0 ); }
+
+	void Free( void* pMemory ) override { dallocx( pMemory, 0 ); }
+};
+#endif
+
+/**
+*	Plain atomics so they can be used during static initialization and destruction of other libraries.
+*/
+static std::atomic<IAllocator*> g_pAllocator{ nullptr };
+
+static std::atomic<int64_t> g_iBytes[ NUM_TAGS ];
+static std::atomic<int64_t> g_iPeakBytes[ NUM_TAGS ];
+static std::atomic<uint64_t> g_uiAllocations[ NUM_TAGS ];
+static std::atomic<uint64_t> g_uiFrees[ NUM_TAGS ];
+
+static std::atomic<bool> g_bCaptureStacks{ false };
+
+struct StackRecord_t
+{
+	Tag tag;
+	std::vector<void*> Frames;
+
+	uint64_t uiAllocations;
+	uint64_t uiBytes;
+
+	int64_t iLiveAllocations;
+	int64_t iLiveBytes;
+};
+
+struct StackData_t
+{
+	std::mutex Mutex;
+
+	/**
+	*	Records are never removed, so the indices stored in allocations stay valid.
+	*/
+	std::vector<StackRecord_t> Records;
+
+	std::map<std::pair<Tag, std::vector<void*>>, uint32_t> Lookup;
+};
+
+StackData_t& GetStackData()
+{
+	//Intentionally leaked, since allocations can be freed during static destruction.
+	static StackData_t* pData = new StackData_t();
+
+	return *pData;
+}
+
+size_t CaptureStack( void** ppFrames )
+{
+#ifdef WIN32
+	return CaptureStackBackTrace( SKIPPED_STACK_FRAMES, MAX_STACK_FRAMES, ppFrames, nullptr );
+#else
+	void* pFrames[ MAX_STACK_FRAMES + SKIPPED_STACK_FRAMES ];
+
+	const int iNumFrames = backtrace( pFrames, static_cast<int>( MAX_STACK_FRAMES + SKIPPED_STACK_FRAMES ) );
+
+	if( iNumFrames <= static_cast<int>( SKIPPED_STACK_FRAMES ) )
+		return 0;
+
+	const size_t uiNumFrames = static_cast<size_t>( iNumFrames ) - SKIPPED_STACK_FRAMES;
+
+	memcpy( ppFrames, pFrames + SKIPPED_STACK_FRAMES, uiNumFrames * sizeof( void* ) );
+
+	return uiNumFrames;
+#endif
+}
+
+/**
+*	@return Index + 1 of the record of the current stack.
+*/
+uint32_t RecordStack( const Tag tag, const size_t uiSize )
+{
+	void* pFrames[ MAX_STACK_FRAMES ];
+
+	const size_t uiNumFrames = CaptureStack( pFrames );
+
+	auto key = std::make_pair( tag, std::vector<void*>( pFrames, pFrames + uiNumFrames ) );
+
+	auto& data = GetStackData();
+
+	std::lock_guard<std::mutex> lock( data.Mutex );
+
+	auto it = data.Lookup.find( key );
+
+	if( it == data.Lookup.end() )
+	{
+		data.Records.push_back( StackRecord_t{ tag, key.second, 0, 0, 0, 0 } );
+
+		it = data.Lookup.emplace( std::move( key ), static_cast<uint32_t>( data.Records.size() ) ).first;
+	}
+
+	auto& record = data.Records[ it->second - 1 ];
+
+	++record.uiAllocations;
+	record.uiBytes += uiSize;
+	++record.iLiveAllocations;
+	record.iLiveBytes += static_cast<int64_t>( uiSize );
+
+	return it->second;
+}
+
+void ReleaseStack( const uint32_t uiStack, const size_t uiSize )
+{
+	auto& data = GetStackData();
+
+	std::lock_guard<std::mutex> lock( data.Mutex );
+
+	auto& record = data.Records[ uiStack - 1 ];
+
+	//Records are cleared while allocations are alive, don't count those.
+	if( record.iLiveAllocations > 0 )
+	{
+		--record.iLiveAllocations;
+		record.iLiveBytes = std::max( record.iLiveBytes - static_cast<int64_t>( uiSize ), static_cast<int64_t>( 0 ) );
+	}
+}
+
+void PrintFrames( const std::vector<void*>& frames )
+{
+#ifdef WIN32
+	for( auto pFrame : frames )
+		Message( "    %p\n", pFrame );
+#else
+	//Names of functions that aren't exported are only available when linking with -rdynamic.
+	char** ppszSymbols = backtrace_symbols( frames.data(), static_cast<int>( frames.size() ) );
+
+	for( size_t uiFrame = 0; uiFrame < frames.size(); ++uiFrame )
+	{
+		if( ppszSymbols )
+			Message( "    %s\n", ppszSymbols[ uiFrame ] );
+		else
+			Message( "    %p\n", frames[ uiFrame ] );
+	}
+
+	free( ppszSymbols );
+#endif
+}
+
+AllocationHeader_t* GetHeader( void* pMemory )
+{
+	return reinterpret_cast<AllocationHeader_t*>( reinterpret_cast<uint8_t*>( pMemory ) - HEADER_SIZE );
+}
+
+static cvar::CConCommand mem_allocs( "mem_allocs",
+	[]( const util::CCommand& )
+	{
+		ReportAllocations();
+	},
+	cvar::Flag::NONE, "Prints how much memory each allocation tag uses, and how often memory was allocated and freed" );
+
+static cvar::CConCommand mem_stacks_start( "mem_stacks_start",
+	[]( const util::CCommand& )
+	{
+		ClearStacks();
+		SetCaptureStacks( true );
+
+		Message( "Capturing allocation call stacks\n" );
+	},
+	cvar::Flag::NONE, "Starts recording the call stack of every allocation. Slow, only meant for finding allocation churn" );
+
+static cvar::CConCommand mem_stacks_stop( "mem_stacks_stop",
+	[]( const util::CCommand& )
+	{
+		SetCaptureStacks( false );
+
+		Message( "Stopped capturing allocation call stacks\n" );
+	},
+	cvar::Flag::NONE, "Stops recording allocation call stacks. Recorded stacks are kept until capture is started again" );
+
+static cvar::CConCommand mem_stacks( "mem_stacks",
+	[]( const util::CCommand& args )
+	{
+		const int iCount = args.ArgC() >= 2 ? atoi( args.Arg( 1 ) ) : static_cast<int>( DEFAULT_REPORTED_STACKS );
+
+		ReportStacks( iCount > 0 ? static_cast<size_t>( iCount ) : DEFAULT_REPORTED_STACKS );
+	},
+	cvar::Flag::NONE, "Prints the call stacks that allocated most often since mem_stacks_start. Usage: mem_stacks [count]" );
+}
+
+const char* GetTagName( const Tag tag )
+{
+	const size_t uiIndex = static_cast<size_t>( tag );
+
+	return uiIndex < NUM_TAGS ? TAG_NAMES[ uiIndex ] : "Unknown";
+}
+
+IAllocator* GetDefaultAllocator()
+{
+#ifdef HLTOOLS_ALLOCATOR_MIMALLOC
+	static CMimallocAllocator allocator;
+#elif defined( HLTOOLS_ALLOCATOR_JEMALLOC )
+	static CJemallocAllocator allocator;
+#else
+	static CCRTAllocator allocator;
+#endif
+
+	return &allocator;
+}
+
+IAllocator* GetAllocator()
+{
+	IAllocator* pAllocator = g_pAllocator.load( std::memory_order_acquire );
+
+	return pAllocator ? pAllocator : GetDefaultAllocator();
+}
+
+void SetAllocator( IAllocator* pAllocator )
+{
+	g_pAllocator.store( pAllocator, std::memory_order_release );
+}
+
+void* Allocate( const size_t uiSize, const Tag tag )
+{
+	assert( static_cast<size_t>( tag ) < NUM_TAGS );
+
+	if( uiSize > std::numeric_limits<size_t>::max() - HEADER_SIZE )
+		throw std::bad_alloc();
+
+	IAllocator* pAllocator = GetAllocator();
+
+	void* pBlock = pAllocator->Allocate( uiSize + HEADER_SIZE );
+
+	if( !pBlock )
+		throw std::bad_alloc();
+
+	auto pHeader = reinterpret_cast<AllocationHeader_t*>( pBlock );
+
+	pHeader->pAllocator = pAllocator;
+	pHeader->uiSize = uiSize;
+	pHeader->tag = tag;
+	pHeader->uiStack = g_bCaptureStacks.load( std::memory_order_relaxed ) ? RecordStack( tag, uiSize ) : 0;
+
+	const size_t uiIndex = static_cast<size_t>( tag );
+
+	g_uiAllocations[ uiIndex ].fetch_add( 1, std::memory_order_relaxed );
+
+	const int64_t iNewBytes = g_iBytes[ uiIndex ].fetch_add( static_cast<int64_t>( uiSize ), std::memory_order_relaxed ) + static_cast<int64_t>( uiSize );
+
+	int64_t iPeakBytes = g_iPeakBytes[ uiIndex ].load( std::memory_order_relaxed );
+
+	while( iNewBytes > iPeakBytes && !g_iPeakBytes[ uiIndex ].compare_exchange_weak( iPeakBytes, iNewBytes, std::memory_order_relaxed ) )
+	{
+	}
+
+	return reinterpret_cast<uint8_t*>( pBlock ) + HEADER_SIZE;
+}
+
+void Free( void* pMemory )
+{
+	if( !pMemory )
+		return;
+
+	AllocationHeader_t* pHeader = GetHeader( pMemory );
+
+	const size_t uiIndex = static_cast<size_t>( pHeader->tag );
+
+	g_uiFrees[ uiIndex ].fetch_add( 1, std::memory_order_relaxed );
+	g_iBytes[ uiIndex ].fetch_sub( static_cast<int64_t>( pHeader->uiSize ), std::memory_order_relaxed );
+
+	if( pHeader->uiStack != 0 )
+		ReleaseStack( pHeader->uiStack, pHeader->uiSize );
+
+	pHeader->pAllocator->Free( pHeader );
+}
+
+size_t GetAllocationSize( const void* pMemory )
+{
+	return pMemory ? GetHeader( const_cast<void*>( pMemory ) )->uiSize : 0;
+}
+
+TagStats_t GetTagStats( const Tag tag )
+{
+	const size_t uiIndex = static_cast<size_t>( tag );
+
+	TagStats_t stats;
+
+	stats.iBytes = g_iBytes[ uiIndex ].load( std::memory_order_relaxed );
+	stats.iPeakBytes = g_iPeakBytes[ uiIndex ].load( std::memory_order_relaxed );
+	stats.uiAllocations = g_uiAllocations[ uiIndex ].load( std::memory_order_relaxed );
+	stats.uiFrees = g_uiFrees[ uiIndex ].load( std::memory_order_relaxed );
+
+	return stats;
+}
+
+void ReportAllocations()
+{
+	Message( "Allocator: %s\n", GetAllocator()->GetName() );
+	Message( "%-20s %15s %15s %12s %12s %12s\n", "Tag", "Current", "Peak", "Allocations", "Frees", "Live" );
+
+	for( size_t uiIndex = 0; uiIndex < NUM_TAGS; ++uiIndex )
+	{
+		const auto stats = GetTagStats( static_cast<Tag>( uiIndex ) );
+
+		Message( "%-20s %12.2f MB %12.2f MB %12llu %12llu %12lld\n", TAG_NAMES[ uiIndex ],
+				 stats.iBytes / ( 1024.0 * 1024.0 ), stats.iPeakBytes / ( 1024.0 * 1024.0 ),
+				 static_cast<unsigned long long>( stats.uiAllocations ), static_cast<unsigned long long>( stats.uiFrees ),
+				 static_cast<long long>( stats.uiAllocations - stats.uiFrees ) );
+	}
+}
+
+void SetCaptureStacks( const bool bCapture )
+{
+	g_bCaptureStacks.store( bCapture, std::memory_order_relaxed );
+}
+
+bool IsCapturingStacks()
+{
+	return g_bCaptureStacks.load( std::memory_order_relaxed );
+}
+
+void ReportStacks( const size_t uiCount )
+{
+	auto& data = GetStackData();
+
+	std::lock_guard<std::mutex> lock( data.Mutex );
+
+	std::vector<const StackRecord_t*> records;
+
+	for( const auto& record : data.Records )
+	{
+		if( record.uiAllocations > 0 )
+			records.push_back( &record );
+	}
+
+	if( records.empty() )
+	{
+		Message( IsCapturingStacks() ? "No allocations have been made since capturing started\n" : "No stacks have been captured, use mem_stacks_start\n" );
+		return;
+	}
+
+	std::sort( records.begin(), records.end(), []( const StackRecord_t* pLHS, const StackRecord_t* pRHS ) { return pLHS->uiAllocations > pRHS->uiAllocations; } );
+
+	for( size_t uiRecord = 0; uiRecord < records.size() && uiRecord < uiCount; ++uiRecord )
+	{
+		const auto& record = *records[ uiRecord ];
+
+		Message( "%s: %llu allocations, %.2f MB total, %lld live using %.2f MB\n", GetTagName( record.tag ),
+				 static_cast<unsigned long long>( record.uiAllocations ), record.uiBytes / ( 1024.0 * 1024.0 ),
+				 static_cast<long long>( record.iLiveAllocations ), record.iLiveBytes / ( 1024.0 * 1024.0 ) );
+
+		PrintFrames( record.Frames );
+	}
+
+	if( records.size() > uiCount )
+		Message( "...and %u more stacks\n", static_cast<unsigned int>( records.size() - uiCount ) );
+}
+
+void ClearStacks()
+{
+	auto& data = GetStackData();
+
+	std::lock_guard<std::mutex> lock( data.Mutex );
+
+	for( auto& record : data.Records )
+	{
+		record.uiAllocations = 0;
+		record.uiBytes = 0;
+		record.iLiveAllocations = 0;
+		record.iLiveBytes = 0;
+	}
+}
+}
@@ -0,0 +1,158 @@
+#ifndef COMMON_ALLOCATOR_H
+#define COMMON_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "core/LibHLCore.h"
+
+/**
+*	Allocation of large engine buffers, like model headers, converted textures and sprites.
+*	Allocations go through a replaceable backend, are counted per tag, and can record the call stacks that make them
+*	so allocation churn can be found. Print the stats with mem_allocs, and capture stacks with mem_stacks_start.
+*/
+namespace mem
+{
+enum class Tag
+{
+	GENERAL = 0,
+
+	/**
+	*	Studio, texture and sequence group headers.
+	*/
+	STUDIO_MODEL,
+
+	/**
+	*	Converted studio model textures.
+	*/
+	STUDIO_TEXTURE,
+
+	/**
+	*	Sprite arenas.
+	*/
+	SPRITE,
+
+	/**
+	*	Short lived buffers used while converting data.
+	*/
+	SCRATCH,
+
+	COUNT
+};
+
+HLCORE_API const char* GetTagName( const Tag tag );
+
+/**
+*	Backend that memory is allocated from.
+*/
+class IAllocator
+{
+public:
+	virtual ~IAllocator() = default;
+
+	virtual const char* GetName() const = 0;
+
+	/**
+	*	@return Memory aligned for any type, or null if it couldn't be allocated.
+	*/
+	virtual void* Allocate( const size_t uiSize ) = 0;
+
+	virtual void Free( void* pMemory ) = 0;
+};
+
+/**
+*	@return The backend that was selected when HLCore was built: the C runtime, mimalloc or jemalloc.
+*/
+HLCORE_API IAllocator* GetDefaultAllocator();
+
+HLCORE_API IAllocator* GetAllocator();
+
+/**
+*	Sets the backend used by new allocations. Memory is always freed by the backend that allocated it,
+*	so a backend must outlive its allocations.
+*	@param pAllocator Backend to use, or null to use the default backend.
+*/
+HLCORE_API void SetAllocator( IAllocator* pAllocator );
+
+/**
+*	Allocates memory aligned for any type. Can be called from any thread.
+*	@exception std::bad_alloc If the memory couldn't be allocated.
+*/
+HLCORE_API void* Allocate( const size_t uiSize, const Tag tag );
+
+/**
+*	Frees memory returned by Allocate. Null is ignored.
+*/
+HLCORE_API void Free( void* pMemory );
+
+/**
+*	@return The size that was requested when the memory was allocated.
+*/
+HLCORE_API size_t GetAllocationSize( const void* pMemory );
+
+struct TagStats_t
+{
+	int64_t iBytes;
+	int64_t iPeakBytes;
+
+	uint64_t uiAllocations;
+	uint64_t uiFrees;
+};
+
+HLCORE_API TagStats_t GetTagStats( const Tag tag );
+
+/**
+*	Prints the stats of every tag.
+*/
+HLCORE_API void ReportAllocations();
+
+/**
+*	Sets whether the call stack of each allocation is recorded. Recording is slow, and only meant for finding allocation churn.
+*/
+HLCORE_API void SetCaptureStacks( const bool bCapture );
+
+HLCORE_API bool IsCapturingStacks();
+
+/**
+*	Prints the call stacks that made the most allocations since capturing started.
+*	@param uiCount Most stacks to print.
+*/
+HLCORE_API void ReportStacks( const size_t uiCount );
+
+/**
+*	Clears the recorded call stacks.
+*/
+HLCORE_API void ClearStacks();
+
+/**
+*	Deleter for unique pointers that own memory from Allocate.
+*/
+struct CDeleter final
+{
+	void operator()( void* pMemory ) const
+	{
+		Free( pMemory );
+	}
+};
+
+/**
+*	Array of trivial types owned by a unique pointer.
+*/
+template<typename T>
+using UniqueArray = std::unique_ptr<T[], CDeleter>;
+
+/**
+*	Allocates an array of trivial types. Elements aren't initialized.
+*/
+template<typename T>
+UniqueArray<T> AllocateArray( const size_t uiCount, const Tag tag )
+{
+	static_assert( std::is_trivial<T>::value, "Only arrays of trivial types can be allocated" );
+
+	return UniqueArray<T>( static_cast<T*>( Allocate( sizeof( T ) * uiCount, tag ) ) );
+}
+}
+
+#endif //COMMON_ALLOCATOR_H
@@ -0,0 +1,104 @@
+#include <cassert>
+#include <cstring>
+
+#include "CLogRingBuffer.h"
+
+static_assert( ( CLogRingBuffer::SLOT_COUNT & ( CLogRingBuffer::SLOT_COUNT - 1 ) ) == 0, "Slot count must be a power of 2" );
+
+CLogRingBuffer::CLogRingBuffer()
+{
+	for( size_t uiIndex = 0; uiIndex < SLOT_COUNT; ++uiIndex )
+	{
+		m_Slots[ uiIndex ].uiSequence.store( uiIndex, std::memory_order_relaxed );
+		m_Slots[ uiIndex ].pszLongMessage = nullptr;
+	}
+}
+
+CLogRingBuffer::~CLogRingBuffer()
+{
+	//Free any long messages that were never popped.
+	LogType type;
+	std::string szMessage;
+
+	while( TryPop( type, szMessage ) )
+	{
+	}
+}
+
+bool CLogRingBuffer::TryPush( const LogType type, const char* const pszMessage, const size_t uiLength )
+{
+	assert( pszMessage );
+
+	size_t uiPosition = m_uiPushPosition.load( std::memory_order_relaxed );
+
+	Slot_t* pSlot;
+
+	while( true )
+	{
+		pSlot = &m_Slots[ uiPosition & ( SLOT_COUNT - 1 ) ];
+
+		const size_t uiSequence = pSlot->uiSequence.load( std::memory_order_acquire );
+
+		const ptrdiff_t iDifference = static_cast<ptrdiff_t>( uiSequence ) - static_cast<ptrdiff_t>( uiPosition );
+
+		if( iDifference == 0 )
+		{
+			//The slot is free; claim it.
+			if( m_uiPushPosition.compare_exchange_weak( uiPosition, uiPosition + 1, std::memory_order_relaxed ) )
+				break;
+		}
+		else if( iDifference < 0 )
+		{
+			//The consumer hasn't freed this slot yet.
+			return false;
+		}
+		else
+		{
+			//Another producer claimed the slot.
+			uiPosition = m_uiPushPosition.load( std::memory_order_relaxed );
+		}
+	}
+
+	pSlot->type = type;
+	pSlot->uiLength = uiLength;
+
+	if( uiLength > MAX_INLINE_LENGTH )
+	{
+		pSlot->pszLongMessage = new char[ uiLength ];
+		memcpy( pSlot->pszLongMessage, pszMessage, uiLength );
+	}
+	else
+		memcpy( pSlot->szMessage, pszMessage, uiLength );
+
+	//Publish the message.
+	pSlot->uiSequence.store( uiPosition + 1, std::memory_order_release );
+
+	return true;
+}
+
+bool CLogRingBuffer::TryPop( LogType& type, std::string& szMessage )
+{
+	Slot_t& slot = m_Slots[ m_uiPopPosition & ( SLOT_COUNT - 1 ) ];
+
+	if( slot.uiSequence.load( std::memory_order_acquire ) != m_uiPopPosition + 1 )
+		return false;
+
+	type = slot.type;
+
+	if( slot.pszLongMessage )
+	{
+		szMessage.assign( slot.pszLongMessage, slot.uiLength );
+
+		delete[] slot.pszLongMessage;
+		slot.pszLongMessage = nullptr;
+	}
+	else
+		szMessage.assign( slot.szMessage, slot.uiLength );
+
+	//Hand the slot back to producers for the next time around the buffer.
+	slot.uiSequence.store( m_uiPopPosition + SLOT_COUNT, std::memory_order_release );
+
+	++m_uiPopPosition;
+
+	return true;
+}
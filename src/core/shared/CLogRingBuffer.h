@@ -0,0 +1,82 @@
+#ifndef COMMON_CLOGRINGBUFFER_H
+#define COMMON_CLOGRINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "Logging.h"
+
+/**
+*	Bounded lock-free queue of log messages. Any number of threads can push messages, one thread can pop them.
+*	Each slot has a sequence number that tells producers and the consumer whose turn it is to use the slot.
+*/
+class CLogRingBuffer final
+{
+public:
+	/**
+	*	Number of slots. Must be a power of 2.
+	*/
+	static const size_t SLOT_COUNT = 1024;
+
+	/**
+	*	Messages up to this length are stored in the slot itself. Longer messages are copied to the heap.
+	*/
+	static const size_t MAX_INLINE_LENGTH = 495;
+
+	/**
+	*	Size of the cache lines that the positions are kept apart by.
+	*/
+	static const size_t CACHE_LINE_SIZE = 64;
+
+private:
+	struct Slot_t
+	{
+		std::atomic<size_t> uiSequence;
+
+		LogType type;
+
+		size_t uiLength;
+
+		char* pszLongMessage;
+
+		char szMessage[ MAX_INLINE_LENGTH + 1 ];
+	};
+
+public:
+	CLogRingBuffer();
+	~CLogRingBuffer();
+
+	/**
+	*	Adds a message to the queue. Can be called from any thread.
+	*	@return Whether the message was added. false if the queue is full.
+	*/
+	bool TryPush( const LogType type, const char* const pszMessage, const size_t uiLength );
+
+	/**
+	*	Removes the oldest message from the queue. Must only be called by one thread at a time.
+	*	@return Whether a message was removed. false if the queue is empty.
+	*/
+	bool TryPop( LogType& type, std::string& szMessage );
+
+private:
+	Slot_t m_Slots[ SLOT_COUNT ];
+
+	//Kept on separate cache lines so producers and the consumer don't contend.
+	//Padded instead of aligned: the queue is allocated with new, which doesn't honor extended alignment before C++17.
+	char m_PushPadding[ CACHE_LINE_SIZE ];
+
+	std::atomic<size_t> m_uiPushPosition{ 0 };
+
+	char m_PopPadding[ CACHE_LINE_SIZE - sizeof( std::atomic<size_t> ) ];
+
+	size_t m_uiPopPosition = 0;
+
+	char m_EndPadding[ CACHE_LINE_SIZE - sizeof( size_t ) ];
+
+private:
+	CLogRingBuffer( const CLogRingBuffer& ) = delete;
+	CLogRingBuffer& operator=( const CLogRingBuffer& ) = delete;
+};
+
+#endif //COMMON_CLOGRINGBUFFER_H
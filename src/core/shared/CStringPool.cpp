@@ -0,0 +1,248 @@
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CStringPool.h"
+
+namespace
+{
+/**
+*	Number of entries in each chunk of the entry table.
+*/
+const size_t ENTRY_CHUNK_SIZE = 4096;
+
+/**
+*	Maximum number of chunks. The chunk table never grows, so entries can be read without locking.
+*/
+const size_t MAX_ENTRY_CHUNKS = 16384;
+
+/**
+*	Size of the blocks that strings are copied into, in bytes. Longer strings get a block of their own.
+*/
+const size_t STRING_BLOCK_SIZE = 65536;
+
+struct Entry_t
+{
+	const char* pszString;
+	size_t uiLength;
+};
+
+/**
+*	Lookup key. Refers to a string that doesn't have to be null terminated.
+*/
+struct Key_t
+{
+	const char* pszString;
+	size_t uiLength;
+};
+
+struct KeyHash final
+{
+	size_t operator()( const Key_t& key ) const
+	{
+		//FNV-1a
+		size_t uiHash = 2166136261U;
+
+		for( size_t uiIndex = 0; uiIndex < key.uiLength; ++uiIndex )
+		{
+			uiHash ^= static_cast<unsigned char>( key.pszString[ uiIndex ] );
+			uiHash *= 16777619U;
+		}
+
+		return uiHash;
+	}
+};
+
+struct KeyEqual final
+{
+	bool operator()( const Key_t& lhs, const Key_t& rhs ) const
+	{
+		return lhs.uiLength == rhs.uiLength && memcmp( lhs.pszString, rhs.pszString, lhs.uiLength ) == 0;
+	}
+};
+}
+
+struct CStringPool::Impl_t
+{
+	mutable std::shared_timed_mutex Mutex;
+
+	std::unordered_map<Key_t, StringId_t, KeyHash, KeyEqual> Map;
+
+	std::unique_ptr<Entry_t[]> Chunks[ MAX_ENTRY_CHUNKS ];
+
+	size_t uiCount = 0;
+
+	std::vector<std::unique_ptr<char[]>> Blocks;
+
+	char* pCurrent = nullptr;
+	size_t uiRemaining = 0;
+
+	size_t uiAllocatedSize = 0;
+
+	const char* CopyString( const char* const pszString, const size_t uiLength )
+	{
+		const size_t uiSize = uiLength + 1;
+
+		if( uiSize > uiRemaining )
+		{
+			const size_t uiBlockSize = uiSize > STRING_BLOCK_SIZE ? uiSize : STRING_BLOCK_SIZE;
+
+			Blocks.emplace_back( new char[ uiBlockSize ] );
+
+			uiAllocatedSize += uiBlockSize;
+
+			//Keep filling the current block if this string got its own.
+			if( uiBlockSize == STRING_BLOCK_SIZE )
+			{
+				pCurrent = Blocks.back().get();
+				uiRemaining = uiBlockSize;
+			}
+			else
+			{
+				char* pszCopy = Blocks.back().get();
+
+				memcpy( pszCopy, pszString, uiLength );
+				pszCopy[ uiLength ] = '\0';
+
+				return pszCopy;
+			}
+		}
+
+		char* pszCopy = pCurrent;
+
+		memcpy( pszCopy, pszString, uiLength );
+		pszCopy[ uiLength ] = '\0';
+
+		pCurrent += uiSize;
+		uiRemaining -= uiSize;
+
+		return pszCopy;
+	}
+};
+
+CStringPool::CStringPool()
+	: m_pImpl( new Impl_t )
+{
+}
+
+CStringPool::~CStringPool()
+{
+	delete m_pImpl;
+}
+
+StringId_t CStringPool::Intern( const char* const pszString )
+{
+	assert( pszString );
+
+	return Intern( pszString, strlen( pszString ) );
+}
+
+StringId_t CStringPool::Intern( const char* const pszString, const size_t uiLength )
+{
+	assert( pszString || !uiLength );
+
+	const Key_t key{ pszString, uiLength };
+
+	{
+		std::shared_lock<std::shared_timed_mutex> lock( m_pImpl->Mutex );
+
+		auto it = m_pImpl->Map.find( key );
+
+		if( it != m_pImpl->Map.end() )
+			return it->second;
+	}
+
+	std::lock_guard<std::shared_timed_mutex> lock( m_pImpl->Mutex );
+
+	//Another thread may have added it while the lock wasn't held.
+	auto it = m_pImpl->Map.find( key );
+
+	if( it != m_pImpl->Map.end() )
+		return it->second;
+
+	const size_t uiIndex = m_pImpl->uiCount;
+
+	const size_t uiChunk = uiIndex / ENTRY_CHUNK_SIZE;
+
+	assert( uiChunk < MAX_ENTRY_CHUNKS );
+
+	auto& chunk = m_pImpl->Chunks[ uiChunk ];
+
+	if( !chunk )
+		chunk.reset( new Entry_t[ ENTRY_CHUNK_SIZE ] );
+
+	const char* const pszCopy = m_pImpl->CopyString( pszString, uiLength );
+
+	chunk[ uiIndex % ENTRY_CHUNK_SIZE ] = Entry_t{ pszCopy, uiLength };
+
+	++m_pImpl->uiCount;
+
+	//Ids start at 1 so INVALID_STRING_ID is never used.
+	const StringId_t id = static_cast<StringId_t>( uiIndex + 1 );
+
+	m_pImpl->Map.emplace( Key_t{ pszCopy, uiLength }, id );
+
+	return id;
+}
+
+StringId_t CStringPool::Find( const char* const pszString ) const
+{
+	assert( pszString );
+
+	const Key_t key{ pszString, strlen( pszString ) };
+
+	std::shared_lock<std::shared_timed_mutex> lock( m_pImpl->Mutex );
+
+	auto it = m_pImpl->Map.find( key );
+
+	return it != m_pImpl->Map.end() ? it->second : INVALID_STRING_ID;
+}
+
+//Ids are only handed out after their entry is written, and entries never move, so these don't need to lock.
+const char* CStringPool::GetString( const StringId_t id ) const
+{
+	assert( id != INVALID_STRING_ID );
+
+	const size_t uiIndex = id - 1;
+
+	return m_pImpl->Chunks[ uiIndex / ENTRY_CHUNK_SIZE ][ uiIndex % ENTRY_CHUNK_SIZE ].pszString;
+}
+
+size_t CStringPool::GetLength( const StringId_t id ) const
+{
+	assert( id != INVALID_STRING_ID );
+
+	const size_t uiIndex = id - 1;
+
+	return m_pImpl->Chunks[ uiIndex / ENTRY_CHUNK_SIZE ][ uiIndex % ENTRY_CHUNK_SIZE ].uiLength;
+}
+
+size_t CStringPool::GetCount() const
+{
+	std::shared_lock<std::shared_timed_mutex> lock( m_pImpl->Mutex );
+
+	return m_pImpl->uiCount;
+}
+
+size_t CStringPool::GetMemoryUsage() const
+{
+	std::shared_lock<std::shared_timed_mutex> lock( m_pImpl->Mutex );
+
+	const size_t uiChunks = ( m_pImpl->uiCount + ENTRY_CHUNK_SIZE - 1 ) / ENTRY_CHUNK_SIZE;
+
+	return m_pImpl->uiAllocatedSize +
+		uiChunks * ENTRY_CHUNK_SIZE * sizeof( Entry_t ) +
+		m_pImpl->Map.size() * ( sizeof( Key_t ) + sizeof( StringId_t ) + sizeof( void* ) ) +
+		m_pImpl->Map.bucket_count() * sizeof( void* );
+}
+
+CStringPool& StringPool()
+{
+	static CStringPool pool;
+
+	return pool;
+}
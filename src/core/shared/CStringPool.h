@@ -0,0 +1,83 @@
+#ifndef COMMON_CSTRINGPOOL_H
+#define COMMON_CSTRINGPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core/LibHLCore.h"
+
+/**
+*	Identifies a string in the string pool.
+*/
+typedef uint32_t StringId_t;
+
+/**
+*	Id of no string. Never returned for a valid string.
+*/
+const StringId_t INVALID_STRING_ID = 0;
+
+/**
+*	Global string interner. Each distinct string is stored once and gets an id, so strings can be compared by id instead of by their characters.
+*	Strings are never removed, so ids and strings stay valid until the program exits.
+*	Comparisons are case sensitive. Can be used from any thread.
+*/
+class HLCORE_API CStringPool final
+{
+public:
+	CStringPool();
+	~CStringPool();
+
+	/**
+	*	Adds a string to the pool if it isn't in it already.
+	*	@return The string's id.
+	*/
+	StringId_t Intern( const char* const pszString );
+
+	/**
+	*	Adds the first uiLength characters of a string to the pool if they aren't in it already. The string doesn't have to be null terminated.
+	*	@return The string's id.
+	*/
+	StringId_t Intern( const char* const pszString, const size_t uiLength );
+
+	/**
+	*	Finds a string without adding it.
+	*	@return The string's id, or INVALID_STRING_ID if it isn't in the pool. In that case, nothing that was interned is equal to it.
+	*/
+	StringId_t Find( const char* const pszString ) const;
+
+	/**
+	*	@return The pool's copy of the string with the given id. Null terminated.
+	*/
+	const char* GetString( const StringId_t id ) const;
+
+	/**
+	*	@return The length of the string with the given id.
+	*/
+	size_t GetLength( const StringId_t id ) const;
+
+	/**
+	*	@return Number of strings in the pool.
+	*/
+	size_t GetCount() const;
+
+	/**
+	*	@return Memory used by the pool's strings and lookup tables, in bytes.
+	*/
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Impl_t;
+
+	Impl_t* m_pImpl;
+
+private:
+	CStringPool( const CStringPool& ) = delete;
+	CStringPool& operator=( const CStringPool& ) = delete;
+};
+
+/**
+*	Gets the global string pool.
+*/
+extern "C" HLCORE_API CStringPool& StringPool();
+
+#endif //COMMON_CSTRINGPOOL_H
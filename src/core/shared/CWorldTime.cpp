@@ -1,16 +1,45 @@
+#include <cmath>
+
 #include "CWorldTime.h"
 
 CWorldTime WorldTime;
 
+void CWorldTime::SetFixedStep( const double flFixedStep )
+{
+	const double flNewStep = flFixedStep > 0 ? flFixedStep : 0;
+
+	if( m_flFixedStep == flNewStep )
+		return;
+
+	m_flFixedStep = flNewStep;
+	m_flAccumulator = 0;
+}
+
 void CWorldTime::TimeChanged( const double flCurrentTime )
 {
-	double flFrameTime = flCurrentTime - WorldTime.GetPreviousRealTime();
+	double flFrameTime = flCurrentTime - GetPreviousRealTime();
 
 	if( flFrameTime > 1.0 )
 		flFrameTime = 0.1;
 
-	SetPreviousTime( WorldTime.GetCurrentTime() );
-	SetCurrentTime( static_cast<float>( WorldTime.GetCurrentTime() + flFrameTime ) );
+	if( m_flFixedStep > 0 )
+	{
+		m_flAccumulator += flFrameTime;
+
+		const double flSteps = std::floor( m_flAccumulator / m_flFixedStep );
+
+		m_uiNumSteps = flSteps < MAX_STEPS ? static_cast<unsigned int>( flSteps ) : MAX_STEPS;
+
+		//Multiplied instead of adding the step repeatedly, so time is exact multiples of the step.
+		flFrameTime = m_uiNumSteps * m_flFixedStep;
+
+		m_flAccumulator = flSteps < MAX_STEPS ? m_flAccumulator - flFrameTime : 0;
+	}
+	else
+		m_uiNumSteps = 1;
+
+	SetPreviousTime( GetCurrentTime() );
+	SetCurrentTime( GetCurrentTime() + flFrameTime );
 	SetFrameTime( static_cast<float>( flFrameTime ) );
-	SetPreviousRealTime( WorldTime.GetRealTime() );
+	SetPreviousRealTime( GetRealTime() );
 }
\ No newline at end of file
@@ -14,24 +14,24 @@ public:
 	CWorldTime& operator=( const CWorldTime& ) = default;
 
 	/**
-	*	The current time. Starts at 1.0.
+	*	The current time. Starts at 1.0. Stored as a double so long sessions don't lose precision.
 	*/
-	float GetCurrentTime() const { return m_flCurrentTime; }
+	double GetCurrentTime() const { return m_flCurrentTime; }
 
 	/**
 	*	Sets the current time. Avoid using this.
 	*/
-	void SetCurrentTime( const float flCurrentTime ) { m_flCurrentTime = flCurrentTime; }
+	void SetCurrentTime( const double flCurrentTime ) { m_flCurrentTime = flCurrentTime; }
 
 	/**
 	*	Gets the previous current time before the last time increment. Equal to GetCurrentTime() - GetFrameTime().
 	*/
-	float GetPreviousTime() const { return m_flPrevTime; }
+	double GetPreviousTime() const { return m_flPrevTime; }
 
 	/**
 	*	Sets the previous time. Avoid using this.
 	*/
-	void SetPreviousTime( const float flPrevTime ) { m_flPrevTime = flPrevTime; }
+	void SetPreviousTime( const double flPrevTime ) { m_flPrevTime = flPrevTime; }
 
 	/**
 	*	Gets the time between frames.
@@ -63,17 +63,43 @@ public:
 	*/
 	void SetPreviousRealTime( const double flRealTime ) { m_flPrevRealTime = flRealTime; }
 
+	/**
+	*	Gets the fixed time step, or 0 if time advances by the real frame time.
+	*/
+	double GetFixedStep() const { return m_flFixedStep; }
+
+	/**
+	*	Sets the fixed time step. If non-zero, time only advances in whole steps, and real time that doesn't make up a whole step
+	*	is carried over to the next frame. Animation and events then see the same time increments at any frame rate.
+	*/
+	void SetFixedStep( const double flFixedStep );
+
+	/**
+	*	Gets the number of fixed steps the last time increment advanced by. 0 if time didn't advance this frame, 1 if there is no fixed step.
+	*/
+	unsigned int GetNumSteps() const { return m_uiNumSteps; }
+
 	/**
 	*	Call with the new current time to update world time.
 	*/
 	void TimeChanged( const double flCurrentTime );
 
+public:
+	/**
+	*	Maximum number of fixed steps a frame can advance by. Time beyond that is dropped so a long stall doesn't fast forward.
+	*/
+	static const unsigned int MAX_STEPS = 10;
+
 private:
-	float m_flCurrentTime	= 1.0f;
-	float m_flPrevTime		= 1.0f;
+	double m_flCurrentTime	= 1.0;
+	double m_flPrevTime		= 1.0;
 	float m_flFrameTime		= 0.0f;
-	double m_flRealTime		= 0.0f;
-	double m_flPrevRealTime = 0.0f;
+	double m_flRealTime		= 0.0;
+	double m_flPrevRealTime = 0.0;
+
+	double m_flFixedStep	= 0.0;
+	double m_flAccumulator	= 0.0;
+	unsigned int m_uiNumSteps = 1;
 };
 
 //TODO: this should be managed by the application, not the core library.
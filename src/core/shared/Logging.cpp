@@ -1,5 +1,14 @@
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "utility/StringUtils.h"
 
@@ -7,8 +16,14 @@
 
 #include "Logging.h"
 
+#include "CLogRingBuffer.h"
+
 static cvar::CCVar developer( "developer", cvar::CCVarArgsBuilder().HelpInfo( "Developer level for logging" ).FloatValue( 0 ) );
 
+static cvar::CCVar log_collapserepeats( "log_collapserepeats", cvar::CCVarArgsBuilder().Flags( cvar::Flag::ARCHIVE ).FloatValue( 1 ).HelpInfo( "If non-zero, identical consecutive messages are logged once, followed by how many times they were repeated" ) );
+
+static cvar::CCVar log_ratelimit( "log_ratelimit", cvar::CCVarArgsBuilder().Flags( cvar::Flag::ARCHIVE ).FloatValue( 50 ).HelpInfo( "Maximum number of messages per second that a single call site can log. 0 disables the limit" ) );
+
 const char* GetLogTypePrefix( const LogType type )
 {
 	switch( type )
@@ -59,8 +74,95 @@ static CStdOutLogListener g_StdOutListener;
 static ILogListener* m_pDefaultLogListener = &g_NullLogListener;
 
 static CLogging g_Logging;
+
+//Don't trigger recursive logging.
+static thread_local bool g_bInLog = false;
+
+/**
+*	How long the writer thread sleeps when there are no messages to write.
+*/
+static const std::chrono::milliseconds WRITER_SLEEP_TIME( 5 );
+
+/**
+*	How often repeated messages are reported while they keep being logged.
+*/
+static const std::chrono::seconds REPEAT_REPORT_INTERVAL( 1 );
+
+/**
+*	Maximum number of call sites tracked per thread for rate limiting. Tracking is reset when this is exceeded.
+*/
+static const size_t MAX_TRACKED_CALL_SITES = 1024;
+
+struct CallSite_t
+{
+	std::chrono::steady_clock::time_point WindowStart;
+
+	unsigned int uiCount = 0;
+
+	unsigned int uiSuppressed = 0;
+};
+
+/**
+*	Per thread state used to filter messages, so filtering doesn't need a lock.
+*/
+struct LogFilterState_t
+{
+	LogType LastType = LogType::MESSAGE;
+
+	std::string szLastMessage;
+
+	unsigned int uiRepeatCount = 0;
+
+	std::chrono::steady_clock::time_point LastRepeatReport;
+
+	//Call sites are identified by their format string.
+	std::unordered_map<const char*, CallSite_t> CallSites;
+};
+
+static thread_local LogFilterState_t g_FilterState;
+
+/**
+*	Maximum number of messages waiting to be passed to the listener.
+*	Messages past this are still written to the log file.
+*/
+static const size_t MAX_PENDING_DISPATCH = 4096;
 }
 
+struct CLogging::AsyncState_t
+{
+	CLogRingBuffer Queue;
+
+	LogOverflowPolicy Policy = LogOverflowPolicy::SUMMARIZE;
+
+	std::atomic<unsigned int> uiDroppedCount{ 0 };
+
+	//Drops that haven't been reported yet, for LogOverflowPolicy::SUMMARIZE.
+	std::atomic<unsigned int> uiUnreportedDrops{ 0 };
+
+	std::thread Writer;
+
+	std::atomic<bool> bQuit{ false };
+
+	std::atomic<bool> bWriterSleeping{ false };
+
+	std::mutex WakeMutex;
+
+	std::condition_variable WakeCondition;
+
+	//Written messages waiting for the main thread.
+	std::mutex DispatchMutex;
+
+	std::vector<std::pair<LogType, std::string>> Dispatch;
+
+	unsigned int uiUndisplayedCount = 0;
+
+	void Wake()
+	{
+		if( bWriterSleeping.load( std::memory_order_acquire ) )
+			WakeCondition.notify_one();
+	}
+};
+
 ILogListener* GetNullLogListener()
 {
 	return &g_NullLogListener;
@@ -94,6 +196,7 @@ CLogging::CLogging()
 
 CLogging::~CLogging()
 {
+	StopAsync();
 	CloseLogFile();
 }
 
@@ -144,13 +247,13 @@ void CLogging::VLog( const LogType type, const DevLevel::DevLevel devLevel, cons
 {
 	assert( pszFormat != nullptr && *pszFormat );
 
-	if( m_bInLog )
+	if( g_bInLog )
 		return;
 
 	if( developer.GetInt() < devLevel )
 		return;
 
-	m_bInLog = true;
+	g_bInLog = true;
 
 	char szBuffer[ 8192 ];
 
@@ -164,14 +267,130 @@ void CLogging::VLog( const LogType type, const DevLevel::DevLevel devLevel, cons
 		}
 	}
 
-	if( IsLogFileOpen() )
+	if( type == LogType::FATAL_ERROR || FilterMessage( type, pszFormat, szBuffer ) )
+		Output( type, szBuffer );
+
+	g_bInLog = false;
+}
+
+bool CLogging::FilterMessage( const LogType type, const char* const pszFormat, const char* const pszMessage )
+{
+	auto& state = g_FilterState;
+
+	const auto now = std::chrono::steady_clock::now();
+
+	if( log_collapserepeats.GetBool() )
+	{
+		if( state.LastType == type && state.szLastMessage == pszMessage )
+		{
+			++state.uiRepeatCount;
+
+			//Report periodically so a message that keeps repeating still shows up.
+			if( now - state.LastRepeatReport >= REPEAT_REPORT_INTERVAL )
+				FlushRepeatedMessage();
+
+			return false;
+		}
+
+		FlushRepeatedMessage();
+
+		state.LastType = type;
+		state.szLastMessage = pszMessage;
+		state.LastRepeatReport = now;
+	}
+	else if( !state.szLastMessage.empty() )
+	{
+		//Collapsing was just disabled.
+		FlushRepeatedMessage();
+		state.szLastMessage.clear();
+	}
+
+	const int iRateLimit = log_ratelimit.GetInt();
+
+	if( iRateLimit <= 0 )
+		return true;
+
+	if( state.CallSites.size() >= MAX_TRACKED_CALL_SITES )
+		state.CallSites.clear();
+
+	auto& callSite = state.CallSites[ pszFormat ];
+
+	if( now - callSite.WindowStart >= std::chrono::seconds( 1 ) )
+	{
+		if( callSite.uiSuppressed > 0 )
+		{
+			char szBuffer[ 256 ];
+
+			if( PrintfSuccess( snprintf( szBuffer, sizeof( szBuffer ), "(%u similar messages were suppressed)\n", callSite.uiSuppressed ), sizeof( szBuffer ) ) )
+				Output( type, szBuffer );
+		}
+
+		callSite.WindowStart = now;
+		callSite.uiCount = 0;
+		callSite.uiSuppressed = 0;
+	}
+
+	if( callSite.uiCount >= static_cast<unsigned int>( iRateLimit ) )
 	{
-		fprintf( m_pLogFile, "%s", szBuffer );
+		++callSite.uiSuppressed;
+		return false;
 	}
 
-	GetLogListener()->LogMessage( type, szBuffer );
+	++callSite.uiCount;
+
+	return true;
+}
+
+void CLogging::FlushRepeatedMessage()
+{
+	auto& state = g_FilterState;
+
+	if( state.uiRepeatCount == 0 )
+		return;
+
+	char szBuffer[ 256 ];
+
+	if( PrintfSuccess( snprintf( szBuffer, sizeof( szBuffer ), "Last message repeated %u times\n", state.uiRepeatCount ), sizeof( szBuffer ) ) )
+		Output( state.LastType, szBuffer );
+
+	state.uiRepeatCount = 0;
+	state.LastRepeatReport = std::chrono::steady_clock::now();
+}
+
+void CLogging::Output( const LogType type, const char* const pszMessage )
+{
+	if( m_pAsync && type != LogType::FATAL_ERROR )
+	{
+		const size_t uiLength = strlen( pszMessage );
+
+		while( !m_pAsync->Queue.TryPush( type, pszMessage, uiLength ) )
+		{
+			if( m_pAsync->Policy == LogOverflowPolicy::BLOCK )
+			{
+				m_pAsync->WakeCondition.notify_one();
+				std::this_thread::yield();
+				continue;
+			}
+
+			++m_pAsync->uiDroppedCount;
+
+			if( m_pAsync->Policy == LogOverflowPolicy::SUMMARIZE )
+				++m_pAsync->uiUnreportedDrops;
 
-	m_bInLog = false;
+			break;
+		}
+
+		m_pAsync->Wake();
+	}
+	else
+	{
+		if( IsLogFileOpen() )
+		{
+			fprintf( m_pLogFile, "%s", pszMessage );
+		}
+
+		GetLogListener()->LogMessage( type, pszMessage );
+	}
 }
 
 bool CLogging::OpenLogFile( const char* const pszFilename, const bool bAppend )
@@ -211,6 +430,164 @@ void CLogging::CloseLogFile()
 	}
 }
 
+bool CLogging::StartAsync( const LogOverflowPolicy policy )
+{
+	if( m_pAsync )
+		return true;
+
+	m_pAsync = new AsyncState_t;
+
+	m_pAsync->Policy = policy;
+
+	m_pAsync->Writer = std::thread( &CLogging::WriteMessages, this );
+
+	return true;
+}
+
+void CLogging::StopAsync()
+{
+	if( !m_pAsync )
+		return;
+
+	m_pAsync->bQuit = true;
+	m_pAsync->WakeCondition.notify_one();
+
+	m_pAsync->Writer.join();
+
+	//Listeners still get everything that was logged.
+	DispatchMessages();
+
+	delete m_pAsync;
+	m_pAsync = nullptr;
+
+	if( IsLogFileOpen() )
+		fflush( m_pLogFile );
+}
+
+void CLogging::DispatchMessages()
+{
+	if( !m_pAsync )
+		return;
+
+	//Don't hold back a repeat count until the next different message.
+	{
+		auto& state = g_FilterState;
+
+		if( state.uiRepeatCount > 0 && std::chrono::steady_clock::now() - state.LastRepeatReport >= REPEAT_REPORT_INTERVAL )
+		{
+			g_bInLog = true;
+			FlushRepeatedMessage();
+			g_bInLog = false;
+		}
+	}
+
+	std::vector<std::pair<LogType, std::string>> messages;
+	unsigned int uiUndisplayedCount;
+
+	{
+		std::lock_guard<std::mutex> lock( m_pAsync->DispatchMutex );
+
+		messages.swap( m_pAsync->Dispatch );
+
+		uiUndisplayedCount = m_pAsync->uiUndisplayedCount;
+		m_pAsync->uiUndisplayedCount = 0;
+	}
+
+	//Listeners that log are ignored, same as when logging synchronously.
+	g_bInLog = true;
+
+	ILogListener* pListener = GetLogListener();
+
+	for( const auto& message : messages )
+	{
+		pListener->LogMessage( message.first, message.second.c_str() );
+	}
+
+	if( uiUndisplayedCount > 0 )
+	{
+		char szBuffer[ 256 ];
+
+		if( PrintfSuccess( snprintf( szBuffer, sizeof( szBuffer ), "%u messages were not displayed; see the log file\n", uiUndisplayedCount ), sizeof( szBuffer ) ) )
+			pListener->LogMessage( LogType::WARNING, szBuffer );
+	}
+
+	g_bInLog = false;
+}
+
+unsigned int CLogging::GetDroppedMessageCount() const
+{
+	return m_pAsync ? m_pAsync->uiDroppedCount.load() : 0;
+}
+
+void CLogging::WriteMessages()
+{
+	AsyncState_t& state = *m_pAsync;
+
+	LogType type;
+	std::string szMessage;
+
+	std::vector<std::pair<LogType, std::string>> written;
+
+	while( true )
+	{
+		//Read this before draining so messages logged before StopAsync are always written.
+		const bool bQuit = state.bQuit.load();
+
+		while( state.Queue.TryPop( type, szMessage ) )
+		{
+			if( IsLogFileOpen() )
+				fwrite( szMessage.data(), 1, szMessage.length(), m_pLogFile );
+
+			written.emplace_back( type, std::move( szMessage ) );
+		}
+
+		const unsigned int uiDrops = state.uiUnreportedDrops.exchange( 0 );
+
+		if( uiDrops > 0 )
+		{
+			char szBuffer[ 256 ];
+
+			if( PrintfSuccess( snprintf( szBuffer, sizeof( szBuffer ), "%u log messages were dropped\n", uiDrops ), sizeof( szBuffer ) ) )
+			{
+				if( IsLogFileOpen() )
+					fprintf( m_pLogFile, "%s", szBuffer );
+
+				written.emplace_back( LogType::WARNING, szBuffer );
+			}
+		}
+
+		if( !written.empty() )
+		{
+			if( IsLogFileOpen() )
+				fflush( m_pLogFile );
+
+			std::lock_guard<std::mutex> lock( state.DispatchMutex );
+
+			for( auto& message : written )
+			{
+				if( state.Dispatch.size() < MAX_PENDING_DISPATCH )
+					state.Dispatch.emplace_back( std::move( message ) );
+				else
+					++state.uiUndisplayedCount;
+			}
+
+			written.clear();
+		}
+		else if( bQuit )
+		{
+			break;
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock( state.WakeMutex );
+
+			state.bWriterSleeping.store( true, std::memory_order_release );
+			state.WakeCondition.wait_for( lock, WRITER_SLEEP_TIME );
+			state.bWriterSleeping.store( false, std::memory_order_release );
+		}
+	}
+}
+
 void Message( const char* const pszFormat, ... )
 {
 	va_list list;
@@ -85,6 +85,27 @@ extern "C" HLCORE_API ILogListener* GetDefaultLogListener();
 */
 extern "C" HLCORE_API void SetDefaultLogListener( ILogListener* pListener );
 
+/**
+*	What to do with messages that are logged while the asynchronous log queue is full.
+*/
+enum class LogOverflowPolicy
+{
+	/**
+	*	Drop the message.
+	*/
+	DROP,
+
+	/**
+	*	Wait until the writer thread has made room for the message.
+	*/
+	BLOCK,
+
+	/**
+	*	Drop the message, and log how many messages were dropped once there is room again.
+	*/
+	SUMMARIZE
+};
+
 /**
 *	This class manages logging state.
 */
@@ -145,14 +166,66 @@ public:
 
 	void CloseLogFile();
 
+	/**
+	*	@return Whether messages are being logged asynchronously.
+	*/
+	bool IsAsync() const { return m_pAsync != nullptr; }
+
+	/**
+	*	Starts logging asynchronously. Messages are pushed onto a lock-free queue, and a writer thread writes them to the log file.
+	*	Listeners are still called on the main thread, from DispatchMessages.
+	*	Fatal errors are always logged synchronously.
+	*	Must be called while no other threads are logging. The log file must not be opened or closed while logging asynchronously.
+	*	@param policy What to do with messages that are logged while the queue is full.
+	*	@return Whether asynchronous logging was started.
+	*/
+	bool StartAsync( const LogOverflowPolicy policy = LogOverflowPolicy::SUMMARIZE );
+
+	/**
+	*	Writes all queued messages, stops the writer thread and passes any remaining messages to the listener.
+	*	Must be called while no other threads are logging.
+	*/
+	void StopAsync();
+
+	/**
+	*	Passes messages that the writer thread has written to the log listener. Must be called on the main thread, once per frame.
+	*/
+	void DispatchMessages();
+
+	/**
+	*	@return Number of messages that were dropped because the queue was full.
+	*/
+	unsigned int GetDroppedMessageCount() const;
+
 private:
-	ILogListener* m_pListener = nullptr;
+	struct AsyncState_t;
+
+	void WriteMessages();
 
-	//Don't trigger recursive logging.
-	bool m_bInLog = false;
+	/**
+	*	Writes a message to the log file and listener, or queues it if logging asynchronously.
+	*/
+	void Output( const LogType type, const char* const pszMessage );
+
+	/**
+	*	Applies repeat collapsing and per call site rate limiting.
+	*	@param pszFormat Format string the message was created from. Identifies the call site.
+	*	@return Whether the message should be output.
+	*/
+	bool FilterMessage( const LogType type, const char* const pszFormat, const char* const pszMessage );
+
+	/**
+	*	Outputs how many times the calling thread's last message was repeated, if it was repeated at all.
+	*/
+	void FlushRepeatedMessage();
+
+private:
+	ILogListener* m_pListener = nullptr;
 
 	FILE* m_pLogFile = nullptr;
 
+	AsyncState_t* m_pAsync = nullptr;
+
 private:
 	CLogging( const CLogging& ) = delete;
 	CLogging& operator=( const CLogging& ) = delete;
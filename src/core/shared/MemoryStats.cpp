@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
+
+#include "Logging.h"
+
+#include "MemoryStats.h"
+
+namespace mem
+{
+namespace
+{
+const size_t NUM_CATEGORIES = static_cast<size_t>( Category::COUNT );
+
+const char* const CATEGORY_NAMES[ NUM_CATEGORIES ] =
+{
+	"Studio headers",
+	"Studio textures (VRAM)",
+	"Sprite frames",
+	"Sprite textures (VRAM)",
+	"Keyvalues",
+	"Sounds",
+	"Entities"
+};
+
+/**
+*	Most records listed per category in detailed reports.
+*/
+const size_t MAX_DETAILED_RECORDS = 10;
+
+/**
+*	Plain atomics so they can be used during static initialization and destruction of other libraries.
+*/
+static std::atomic<int64_t> g_iBytes[ NUM_CATEGORIES ];
+static std::atomic<int64_t> g_iPeakBytes[ NUM_CATEGORIES ];
+
+std::mutex& GetMutex()
+{
+	static std::mutex mutex;
+
+	return mutex;
+}
+
+static CMemoryRecord* g_pHead = nullptr;
+
+void PrintBytes( const char* const pszName, const int64_t iBytes, const int64_t iPeakBytes )
+{
+	Message( "%-28s %12.2f MB %12.2f MB\n", pszName, iBytes / ( 1024.0 * 1024.0 ), iPeakBytes / ( 1024.0 * 1024.0 ) );
+}
+
+static cvar::CConCommand mem_report( "mem_report",
+	[]( const util::CCommand& args )
+	{
+		Report( args.ArgC() >= 2 && !strcmp( args.Arg( 1 ), "detail" ) );
+	},
+	cvar::Flag::NONE, "Prints how much memory each subsystem uses, and the most it has used. Usage: mem_report [detail]" );
+}
+
+const char* GetCategoryName( const Category category )
+{
+	const size_t uiIndex = static_cast<size_t>( category );
+
+	return uiIndex < NUM_CATEGORIES ? CATEGORY_NAMES[ uiIndex ] : "Unknown";
+}
+
+void Add( const Category category, const int64_t iBytes )
+{
+	const size_t uiIndex = static_cast<size_t>( category );
+
+	const int64_t iNewBytes = g_iBytes[ uiIndex ].fetch_add( iBytes, std::memory_order_relaxed ) + iBytes;
+
+	int64_t iPeakBytes = g_iPeakBytes[ uiIndex ].load( std::memory_order_relaxed );
+
+	while( iNewBytes > iPeakBytes && !g_iPeakBytes[ uiIndex ].compare_exchange_weak( iPeakBytes, iNewBytes, std::memory_order_relaxed ) )
+	{
+	}
+}
+
+int64_t GetBytes( const Category category )
+{
+	return g_iBytes[ static_cast<size_t>( category ) ].load( std::memory_order_relaxed );
+}
+
+int64_t GetPeakBytes( const Category category )
+{
+	return g_iPeakBytes[ static_cast<size_t>( category ) ].load( std::memory_order_relaxed );
+}
+
+void Report( const bool bDetailed )
+{
+	Message( "%-28s %15s %15s\n", "Category", "Current", "Peak" );
+
+	int64_t iTotal = 0;
+
+	for( size_t uiIndex = 0; uiIndex < NUM_CATEGORIES; ++uiIndex )
+	{
+		const Category category = static_cast<Category>( uiIndex );
+
+		PrintBytes( GetCategoryName( category ), GetBytes( category ), GetPeakBytes( category ) );
+
+		iTotal += GetBytes( category );
+	}
+
+	Message( "Total: %.2f MB\n", iTotal / ( 1024.0 * 1024.0 ) );
+
+	if( !bDetailed )
+		return;
+
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	std::vector<const CMemoryRecord*> records;
+
+	for( size_t uiIndex = 0; uiIndex < NUM_CATEGORIES; ++uiIndex )
+	{
+		records.clear();
+
+		for( const CMemoryRecord* pRecord = g_pHead; pRecord; pRecord = pRecord->m_pNext )
+		{
+			if( pRecord->GetCategory() == static_cast<Category>( uiIndex ) && pRecord->GetBytes() > 0 )
+				records.push_back( pRecord );
+		}
+
+		if( records.empty() )
+			continue;
+
+		std::sort( records.begin(), records.end(), []( const CMemoryRecord* pLHS, const CMemoryRecord* pRHS ) { return pLHS->GetBytes() > pRHS->GetBytes(); } );
+
+		Message( "\n%s, largest first:\n", CATEGORY_NAMES[ uiIndex ] );
+
+		for( size_t uiRecord = 0; uiRecord < records.size() && uiRecord < MAX_DETAILED_RECORDS; ++uiRecord )
+		{
+			Message( "%12.2f MB  %s\n", records[ uiRecord ]->GetBytes() / ( 1024.0 * 1024.0 ), records[ uiRecord ]->GetName().c_str() );
+		}
+
+		if( records.size() > MAX_DETAILED_RECORDS )
+			Message( "...and %u more\n", static_cast<unsigned int>( records.size() - MAX_DETAILED_RECORDS ) );
+	}
+}
+
+CMemoryRecord::CMemoryRecord( const Category category, const char* const pszName )
+	: m_Category( category )
+	, m_szName( pszName )
+{
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	m_pNext = g_pHead;
+	g_pHead = this;
+}
+
+CMemoryRecord::~CMemoryRecord()
+{
+	SetBytes( 0 );
+
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	for( CMemoryRecord** ppRecord = &g_pHead; *ppRecord; ppRecord = &( *ppRecord )->m_pNext )
+	{
+		if( *ppRecord == this )
+		{
+			*ppRecord = m_pNext;
+			break;
+		}
+	}
+}
+
+void CMemoryRecord::SetName( const char* const pszName )
+{
+	//Detailed reports read the name while holding the lock.
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	m_szName = pszName;
+}
+
+void CMemoryRecord::SetBytes( const size_t uiBytes )
+{
+	const size_t uiOldBytes = m_uiBytes.exchange( uiBytes, std::memory_order_relaxed );
+
+	if( uiBytes != uiOldBytes )
+		Add( m_Category, static_cast<int64_t>( uiBytes ) - static_cast<int64_t>( uiOldBytes ) );
+}
+
+void CMemoryRecord::AddBytes( const int64_t iBytes )
+{
+	m_uiBytes.fetch_add( static_cast<size_t>( iBytes ), std::memory_order_relaxed );
+
+	Add( m_Category, iBytes );
+}
+}
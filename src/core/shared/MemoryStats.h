@@ -0,0 +1,129 @@
+#ifndef COMMON_MEMORYSTATS_H
+#define COMMON_MEMORYSTATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "core/LibHLCore.h"
+
+/**
+*	Tracks how much memory each subsystem uses, so the mem_report command can show where memory goes.
+*	Sizes are close estimates kept by the subsystems themselves, not measurements of the heap.
+*/
+namespace mem
+{
+enum class Category
+{
+	/**
+	*	Studio, texture and sequence group headers.
+	*/
+	STUDIO_HEADERS = 0,
+
+	/**
+	*	Estimated video memory used by studio model textures.
+	*/
+	STUDIO_TEXTURES,
+
+	/**
+	*	Sprite headers and frames.
+	*/
+	SPRITE_FRAMES,
+
+	/**
+	*	Estimated video memory used by sprite textures.
+	*/
+	SPRITE_TEXTURES,
+
+	/**
+	*	Keyvalue nodes and arenas.
+	*/
+	KEYVALUES,
+
+	/**
+	*	Cached sounds and the files of playing streams.
+	*/
+	SOUNDS,
+
+	/**
+	*	Entity pools.
+	*/
+	ENTITIES,
+
+	COUNT
+};
+
+HLCORE_API const char* GetCategoryName( const Category category );
+
+/**
+*	Adds to or removes from the bytes used by a category. Can be called from any thread.
+*	@param iBytes Bytes to add. Negative to remove bytes.
+*/
+HLCORE_API void Add( const Category category, const int64_t iBytes );
+
+/**
+*	@return Bytes currently used by a category.
+*/
+HLCORE_API int64_t GetBytes( const Category category );
+
+/**
+*	@return Most bytes that a category has used at once.
+*/
+HLCORE_API int64_t GetPeakBytes( const Category category );
+
+/**
+*	Prints the bytes used by each category and their high-water marks.
+*	@param bDetailed Whether to also list the largest records of each category.
+*/
+HLCORE_API void Report( const bool bDetailed );
+
+/**
+*	Memory used by one named object, like a model. Counts towards its category, and is listed by itself in detailed reports.
+*	Records must not outlive the HLCore library.
+*/
+class HLCORE_API CMemoryRecord final
+{
+public:
+	CMemoryRecord( const Category category, const char* const pszName = "" );
+	~CMemoryRecord();
+
+	Category GetCategory() const { return m_Category; }
+
+	/**
+	*	@return The name. Only safe to call while the name isn't being changed.
+	*/
+	const std::string& GetName() const { return m_szName; }
+
+	void SetName( const char* const pszName );
+
+	size_t GetBytes() const { return m_uiBytes.load( std::memory_order_relaxed ); }
+
+	/**
+	*	Sets the bytes used by the object. The category is updated with the difference.
+	*/
+	void SetBytes( const size_t uiBytes );
+
+	/**
+	*	Adds to the bytes used by the object.
+	*/
+	void AddBytes( const int64_t iBytes );
+
+	/**
+	*	Next record in the list of records. Only used by the list.
+	*/
+	CMemoryRecord* m_pNext = nullptr;
+
+private:
+	const Category m_Category;
+	std::string m_szName;
+
+	std::atomic<size_t> m_uiBytes{ 0 };
+
+private:
+	CMemoryRecord( const CMemoryRecord& ) = delete;
+	CMemoryRecord& operator=( const CMemoryRecord& ) = delete;
+};
+}
+
+#endif //COMMON_MEMORYSTATS_H
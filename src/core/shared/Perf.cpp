@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "Logging.h"
+#include "Profiler.h"
+
+#include "Perf.h"
+
+namespace perf
+{
+namespace
+{
+/**
+*	Guards the list of stats. Function local so stats constructed during static initialization of other libraries can register.
+*/
+std::mutex& GetMutex()
+{
+	static std::mutex mutex;
+
+	return mutex;
+}
+
+static CStat* g_pHead = nullptr;
+
+float ToReported( const StatType type, const int64_t iValue )
+{
+	return type == StatType::TIME ? iValue / 1000.0f : static_cast<float>( iValue );
+}
+}
+
+CStat::CStat( const char* const pszName, const StatType type )
+	: m_pszName( pszName )
+	, m_Type( type )
+{
+	for( auto& value : m_iWindow )
+		value.store( 0, std::memory_order_relaxed );
+
+	RegisterStat( this );
+}
+
+CStat::~CStat()
+{
+	UnregisterStat( this );
+}
+
+size_t CStat::GetWindow( int64_t* piValues ) const
+{
+	const size_t uiCount = std::min( static_cast<size_t>( m_uiNextSample.load( std::memory_order_relaxed ) ), WINDOW_SIZE );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		piValues[ uiIndex ] = m_iWindow[ uiIndex ].load( std::memory_order_relaxed );
+
+	return uiCount;
+}
+
+void CStat::Reset()
+{
+	m_uiCalls.store( 0, std::memory_order_relaxed );
+	m_iTotal.store( 0, std::memory_order_relaxed );
+	m_iMax.store( 0, std::memory_order_relaxed );
+	m_uiNextSample.store( 0, std::memory_order_relaxed );
+}
+
+void RegisterStat( CStat* pStat )
+{
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	pStat->m_pNext = g_pHead;
+	g_pHead = pStat;
+}
+
+void UnregisterStat( CStat* pStat )
+{
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	for( CStat** ppStat = &g_pHead; *ppStat; ppStat = &( *ppStat )->m_pNext )
+	{
+		if( *ppStat == pStat )
+		{
+			*ppStat = pStat->m_pNext;
+			break;
+		}
+	}
+}
+
+bool IsCompiledIn()
+{
+#ifdef HLTOOLS_PERF_COUNTERS
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Dump( const char* const pszFilter )
+{
+	if( !IsCompiledIn() )
+	{
+		Message( "Perf counters were not compiled in\n" );
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	std::vector<const CStat*> stats;
+
+	for( const CStat* pStat = g_pHead; pStat; pStat = pStat->m_pNext )
+	{
+		if( pStat->GetCalls() > 0 && ( !pszFilter || !( *pszFilter ) || strstr( pStat->GetName(), pszFilter ) ) )
+			stats.push_back( pStat );
+	}
+
+	if( stats.empty() )
+	{
+		Message( "No stats have been recorded\n" );
+		return;
+	}
+
+	std::sort( stats.begin(), stats.end(), []( const CStat* pLHS, const CStat* pRHS ) { return strcmp( pLHS->GetName(), pRHS->GetName() ) < 0; } );
+
+	Message( "%-32s %10s %12s %10s %10s %10s %10s\n", "Name", "Calls", "Total", "Average", "Recent", "Recent p95", "Max" );
+
+	int64_t iWindow[ WINDOW_SIZE ];
+	float flWindow[ WINDOW_SIZE ];
+
+	for( auto pStat : stats )
+	{
+		const StatType type = pStat->GetType();
+		const uint64_t uiCalls = pStat->GetCalls();
+
+		const size_t uiCount = pStat->GetWindow( iWindow );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+			flWindow[ uiIndex ] = ToReported( type, iWindow[ uiIndex ] );
+
+		profiler::SeriesStats_t recent{};
+
+		profiler::ComputeStats( flWindow, uiCount, recent );
+
+		Message( "%-32s %10llu %12.3f %10.3f %10.3f %10.3f %10.3f%s\n",
+				 pStat->GetName(), static_cast<unsigned long long>( uiCalls ),
+				 ToReported( type, pStat->GetTotal() ),
+				 ToReported( type, pStat->GetTotal() ) / uiCalls,
+				 recent.flAverage, recent.flP95,
+				 ToReported( type, pStat->GetMax() ),
+				 type == StatType::TIME ? " ms" : "" );
+	}
+}
+
+void Reset()
+{
+	std::lock_guard<std::mutex> lock( GetMutex() );
+
+	for( CStat* pStat = g_pHead; pStat; pStat = pStat->m_pNext )
+		pStat->Reset();
+}
+}
@@ -0,0 +1,184 @@
+#ifndef COMMON_PERF_H
+#define COMMON_PERF_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "core/LibHLCore.h"
+
+#include "Trace.h"
+
+/**
+*	Always on timers and counters for hot functions. Unlike the profiler, stats aren't tied to frames:
+*	they accumulate from startup or the last reset, and the most recent samples are kept for rolling statistics.
+*	Stats are printed with perf_dump and cleared with perf_reset.
+*	Instrumentation is compiled out unless HLTOOLS_PERF_COUNTERS is defined.
+*/
+namespace perf
+{
+enum class StatType
+{
+	/**
+	*	Values are durations in microseconds, reported in milliseconds.
+	*/
+	TIME = 0,
+
+	/**
+	*	Values are counts.
+	*/
+	COUNT
+};
+
+/**
+*	Number of recent samples that rolling statistics are computed from.
+*/
+static const size_t WINDOW_SIZE = 128;
+
+/**
+*	A named stat. Instances are expected to be function local statics, which register themselves on construction.
+*	Adding values is lock free, so stats can be updated from any thread.
+*/
+class CStat final
+{
+public:
+	/**
+	*	@param pszName Name of the stat. Must remain valid for the lifetime of the stat; string literals are expected.
+	*/
+	CStat( const char* const pszName, const StatType type );
+	~CStat();
+
+	const char* GetName() const { return m_pszName; }
+
+	StatType GetType() const { return m_Type; }
+
+	void Add( const int64_t iValue )
+	{
+		m_uiCalls.fetch_add( 1, std::memory_order_relaxed );
+		m_iTotal.fetch_add( iValue, std::memory_order_relaxed );
+
+		int64_t iMax = m_iMax.load( std::memory_order_relaxed );
+
+		while( iValue > iMax && !m_iMax.compare_exchange_weak( iMax, iValue, std::memory_order_relaxed ) )
+		{
+		}
+
+		m_iWindow[ m_uiNextSample.fetch_add( 1, std::memory_order_relaxed ) % WINDOW_SIZE ].store( iValue, std::memory_order_relaxed );
+	}
+
+	uint64_t GetCalls() const { return m_uiCalls.load( std::memory_order_relaxed ); }
+
+	int64_t GetTotal() const { return m_iTotal.load( std::memory_order_relaxed ); }
+
+	int64_t GetMax() const { return m_iMax.load( std::memory_order_relaxed ); }
+
+	/**
+	*	Copies the most recent samples.
+	*	@param piValues Destination. Must have room for WINDOW_SIZE values.
+	*	@return The number of samples that were copied.
+	*/
+	size_t GetWindow( int64_t* piValues ) const;
+
+	/**
+	*	Clears all values. Values added by other threads while resetting may be partially kept.
+	*/
+	void Reset();
+
+	/**
+	*	Next stat in the list of registered stats. Only used by the registry.
+	*/
+	CStat* m_pNext = nullptr;
+
+private:
+	const char* const m_pszName;
+	const StatType m_Type;
+
+	std::atomic<uint64_t> m_uiCalls{ 0 };
+	std::atomic<int64_t> m_iTotal{ 0 };
+	std::atomic<int64_t> m_iMax{ 0 };
+
+	std::atomic<uint32_t> m_uiNextSample{ 0 };
+	std::atomic<int64_t> m_iWindow[ WINDOW_SIZE ];
+
+private:
+	CStat( const CStat& ) = delete;
+	CStat& operator=( const CStat& ) = delete;
+};
+
+/**
+*	Adds a stat to the list of stats. Called by CStat.
+*/
+HLCORE_API void RegisterStat( CStat* pStat );
+
+/**
+*	Removes a stat from the list of stats. Called by CStat.
+*/
+HLCORE_API void UnregisterStat( CStat* pStat );
+
+/**
+*	@return Whether instrumentation was compiled in.
+*/
+HLCORE_API bool IsCompiledIn();
+
+/**
+*	Prints all stats that have values, sorted by name.
+*	@param pszFilter If not null or empty, only stats whose name contains this are printed.
+*/
+HLCORE_API void Dump( const char* const pszFilter = nullptr );
+
+/**
+*	Clears the values of all stats.
+*/
+HLCORE_API void Reset();
+
+/**
+*	Adds the time spent in this object's scope to a stat.
+*/
+class CScopedTimer final
+{
+public:
+	CScopedTimer( CStat& stat )
+		: m_Stat( stat )
+		, m_iStart( trace::GetTimestamp() )
+	{
+	}
+
+	~CScopedTimer()
+	{
+		m_Stat.Add( trace::GetTimestamp() - m_iStart );
+	}
+
+private:
+	CStat& m_Stat;
+	const int64_t m_iStart;
+
+private:
+	CScopedTimer( const CScopedTimer& ) = delete;
+	CScopedTimer& operator=( const CScopedTimer& ) = delete;
+};
+}
+
+#ifdef HLTOOLS_PERF_COUNTERS
+/**
+*	Adds the time until the end of the enclosing scope to the time stat named pszName.
+*/
+#define PERF_SCOPE( pszName )																				\
+static perf::CStat TRACE_CONCAT( __perfStat, __LINE__ )( pszName, perf::StatType::TIME );					\
+const perf::CScopedTimer TRACE_CONCAT( __perfTimer, __LINE__ )( TRACE_CONCAT( __perfStat, __LINE__ ) )
+
+/**
+*	Adds iCount to the count stat named pszName.
+*/
+#define PERF_COUNT( pszName, iCount )																		\
+do																											\
+{																											\
+	static perf::CStat __perfStat( pszName, perf::StatType::COUNT );										\
+	__perfStat.Add( static_cast<int64_t>( iCount ) );														\
+}																											\
+while( false )
+#else
+#define PERF_SCOPE( pszName )
+#define PERF_COUNT( pszName, iCount ) do {} while( false )
+#endif
+
+#endif //COMMON_PERF_H
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#include "Profiler.h"
+
+namespace profiler
+{
+namespace
+{
+struct Series_t
+{
+	const char* pszName;
+	SeriesType type;
+
+	/**
+	*	Total for the frame that is being recorded.
+	*/
+	std::atomic<int64_t> iCurrent;
+
+	int64_t iHistory[ HISTORY_SIZE ];
+};
+
+static std::atomic<bool> g_bEnabled{ false };
+
+static Series_t g_Series[ MAX_SERIES ];
+
+static std::atomic<size_t> g_uiSeriesCount{ 0 };
+
+/**
+*	Guards registration and the history.
+*/
+static std::mutex g_Mutex;
+
+/**
+*	Index in the history that the next frame is stored at.
+*/
+static size_t g_uiNextFrame = 0;
+
+static size_t g_uiFrameCount = 0;
+
+static int64_t g_iLastFrameEnd = 0;
+
+static const size_t g_uiFrameTimeSeries = RegisterSeries( "Frame", SeriesType::TIME );
+
+/**
+*	Converts a recorded value to the unit it is reported in.
+*/
+float ToReportedValue( const Series_t& series, const int64_t iValue )
+{
+	return series.type == SeriesType::TIME ? iValue / 1000.0f : static_cast<float>( iValue );
+}
+
+/**
+*	Copies a series' history, oldest first. The mutex must be locked.
+*/
+size_t CopyHistory( const Series_t& series, float* pflValues, const size_t uiMaxValues )
+{
+	const size_t uiCount = std::min( g_uiFrameCount, uiMaxValues );
+
+	//Start at the oldest of the frames being copied.
+	size_t uiIndex = ( g_uiNextFrame + HISTORY_SIZE - uiCount ) % HISTORY_SIZE;
+
+	for( size_t uiValue = 0; uiValue < uiCount; ++uiValue )
+	{
+		pflValues[ uiValue ] = ToReportedValue( series, series.iHistory[ uiIndex ] );
+
+		uiIndex = ( uiIndex + 1 ) % HISTORY_SIZE;
+	}
+
+	return uiCount;
+}
+
+/**
+*	@param pflSorted Values sorted in ascending order.
+*	@param flPercentile Percentile in the range [0, 1].
+*/
+float GetPercentile( const float* pflSorted, const size_t uiCount, const float flPercentile )
+{
+	const size_t uiIndex = static_cast<size_t>( std::ceil( flPercentile * uiCount ) );
+
+	return pflSorted[ uiIndex > 0 ? std::min( uiIndex, uiCount ) - 1 : 0 ];
+}
+}
+
+bool IsEnabled()
+{
+	return g_bEnabled.load( std::memory_order_relaxed );
+}
+
+void SetEnabled( const bool bEnabled )
+{
+	if( bEnabled == IsEnabled() )
+		return;
+
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	if( bEnabled )
+	{
+		const size_t uiCount = g_uiSeriesCount.load();
+
+		for( size_t uiSeries = 0; uiSeries < uiCount; ++uiSeries )
+		{
+			g_Series[ uiSeries ].iCurrent = 0;
+		}
+
+		g_uiNextFrame = 0;
+		g_uiFrameCount = 0;
+
+		//The first frame has no previous frame to measure from.
+		g_iLastFrameEnd = 0;
+	}
+
+	g_bEnabled = bEnabled;
+}
+
+size_t RegisterSeries( const char* const pszName, const SeriesType type )
+{
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	const size_t uiCount = g_uiSeriesCount.load();
+
+	for( size_t uiSeries = 0; uiSeries < uiCount; ++uiSeries )
+	{
+		if( !strcmp( g_Series[ uiSeries ].pszName, pszName ) )
+			return uiSeries;
+	}
+
+	if( uiCount >= MAX_SERIES )
+		return INVALID_SERIES;
+
+	Series_t& series = g_Series[ uiCount ];
+
+	series.pszName = pszName;
+	series.type = type;
+	series.iCurrent = 0;
+
+	//Frames recorded before this series existed had nothing in it.
+	std::fill( std::begin( series.iHistory ), std::end( series.iHistory ), 0 );
+
+	//Published last so AddValue never sees a series that is still being set up.
+	g_uiSeriesCount = uiCount + 1;
+
+	return uiCount;
+}
+
+void AddValue( const size_t uiSeries, const int64_t iValue )
+{
+	if( uiSeries < g_uiSeriesCount.load( std::memory_order_acquire ) )
+		g_Series[ uiSeries ].iCurrent.fetch_add( iValue, std::memory_order_relaxed );
+}
+
+void EndFrame()
+{
+	if( !IsEnabled() )
+		return;
+
+	const int64_t iNow = trace::GetTimestamp();
+
+	if( g_iLastFrameEnd != 0 )
+		AddValue( g_uiFrameTimeSeries, iNow - g_iLastFrameEnd );
+
+	g_iLastFrameEnd = iNow;
+
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	const size_t uiCount = g_uiSeriesCount.load();
+
+	for( size_t uiSeries = 0; uiSeries < uiCount; ++uiSeries )
+	{
+		Series_t& series = g_Series[ uiSeries ];
+
+		series.iHistory[ g_uiNextFrame ] = series.iCurrent.exchange( 0, std::memory_order_relaxed );
+	}
+
+	g_uiNextFrame = ( g_uiNextFrame + 1 ) % HISTORY_SIZE;
+	g_uiFrameCount = std::min( g_uiFrameCount + 1, HISTORY_SIZE );
+}
+
+size_t GetSeriesCount()
+{
+	return g_uiSeriesCount.load();
+}
+
+const char* GetSeriesName( const size_t uiSeries )
+{
+	if( uiSeries >= GetSeriesCount() )
+		return "";
+
+	return g_Series[ uiSeries ].pszName;
+}
+
+SeriesType GetSeriesType( const size_t uiSeries )
+{
+	if( uiSeries >= GetSeriesCount() )
+		return SeriesType::COUNT;
+
+	return g_Series[ uiSeries ].type;
+}
+
+size_t GetFrameCount()
+{
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	return g_uiFrameCount;
+}
+
+bool GetSeriesStats( const size_t uiSeries, SeriesStats_t& stats )
+{
+	stats = {};
+
+	if( uiSeries >= GetSeriesCount() )
+		return false;
+
+	float flValues[ HISTORY_SIZE ];
+
+	size_t uiCount;
+
+	{
+		std::lock_guard<std::mutex> lock( g_Mutex );
+
+		uiCount = CopyHistory( g_Series[ uiSeries ], flValues, HISTORY_SIZE );
+	}
+
+	return ComputeStats( flValues, uiCount, stats );
+}
+
+float GetLastValue( const size_t uiSeries )
+{
+	if( uiSeries >= GetSeriesCount() )
+		return 0;
+
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	if( g_uiFrameCount == 0 )
+		return 0;
+
+	const Series_t& series = g_Series[ uiSeries ];
+
+	return ToReportedValue( series, series.iHistory[ ( g_uiNextFrame + HISTORY_SIZE - 1 ) % HISTORY_SIZE ] );
+}
+
+bool ComputeStats( float* pflValues, const size_t uiCount, SeriesStats_t& stats )
+{
+	stats = {};
+
+	if( !pflValues || uiCount == 0 )
+		return false;
+
+	stats.flLast = pflValues[ uiCount - 1 ];
+
+	//Benchmarks compute statistics over many frames, so sum with more precision than the values have.
+	double flTotal = 0;
+
+	for( size_t uiValue = 0; uiValue < uiCount; ++uiValue )
+	{
+		flTotal += pflValues[ uiValue ];
+	}
+
+	stats.flAverage = static_cast<float>( flTotal / uiCount );
+
+	std::sort( pflValues, pflValues + uiCount );
+
+	stats.flP50 = GetPercentile( pflValues, uiCount, 0.5f );
+	stats.flP95 = GetPercentile( pflValues, uiCount, 0.95f );
+	stats.flP99 = GetPercentile( pflValues, uiCount, 0.99f );
+	stats.flMax = pflValues[ uiCount - 1 ];
+
+	return true;
+}
+
+size_t GetSeriesHistory( const size_t uiSeries, float* pflValues, const size_t uiMaxValues )
+{
+	if( !pflValues || uiSeries >= GetSeriesCount() )
+		return 0;
+
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	return CopyHistory( g_Series[ uiSeries ], pflValues, uiMaxValues );
+}
+}
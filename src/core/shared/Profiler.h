@@ -0,0 +1,176 @@
+#ifndef COMMON_PROFILER_H
+#define COMMON_PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core/LibHLCore.h"
+
+#include "Trace.h"
+
+/**
+*	Per frame profiling. Code adds time spent in named stages and named counts to the current frame,
+*	and EndFrame moves the totals into a rolling history that statistics are computed from.
+*	Nothing is recorded while the profiler is disabled, so instrumentation can stay in release builds.
+*/
+namespace profiler
+{
+enum class SeriesType
+{
+	/**
+	*	Values are durations. Added in microseconds, reported in milliseconds.
+	*/
+	TIME = 0,
+
+	/**
+	*	Values are counts, like draw calls.
+	*/
+	COUNT
+};
+
+/**
+*	Maximum number of series that can be registered.
+*/
+static const size_t MAX_SERIES = 32;
+
+/**
+*	Number of frames kept in the history of each series.
+*/
+static const size_t HISTORY_SIZE = 240;
+
+static const size_t INVALID_SERIES = static_cast<size_t>( -1 );
+
+/**
+*	Series that EndFrame records the time between frames in.
+*/
+static const size_t FRAME_TIME_SERIES = 0;
+
+struct SeriesStats_t
+{
+	float flLast;
+	float flAverage;
+	float flP50;
+	float flP95;
+	float flP99;
+	float flMax;
+};
+
+/**
+*	@return Whether values are being recorded.
+*/
+HLCORE_API bool IsEnabled();
+
+/**
+*	Enables or disables recording. The history is cleared when recording is enabled.
+*/
+HLCORE_API void SetEnabled( const bool bEnabled );
+
+/**
+*	Registers a series, or finds it if one with the same name was registered before.
+*	@param pszName Name of the series. Must remain valid for the rest of the program; string literals are expected.
+*	@param type What the values are.
+*	@return Index of the series, or INVALID_SERIES if too many series have been registered.
+*/
+HLCORE_API size_t RegisterSeries( const char* const pszName, const SeriesType type );
+
+/**
+*	Adds a value to a series for the current frame. Can be called from any thread.
+*	@param uiSeries Series to add to. INVALID_SERIES is ignored.
+*	@param iValue Microseconds for time series, a count otherwise.
+*/
+HLCORE_API void AddValue( const size_t uiSeries, const int64_t iValue );
+
+/**
+*	Ends the current frame. The totals of all series are added to the history and reset.
+*/
+HLCORE_API void EndFrame();
+
+/**
+*	@return The number of registered series.
+*/
+HLCORE_API size_t GetSeriesCount();
+
+HLCORE_API const char* GetSeriesName( const size_t uiSeries );
+
+HLCORE_API SeriesType GetSeriesType( const size_t uiSeries );
+
+/**
+*	@return The number of frames in the history.
+*/
+HLCORE_API size_t GetFrameCount();
+
+/**
+*	Computes statistics over a series' history. Time series are reported in milliseconds.
+*	@return Whether the series has any history.
+*/
+HLCORE_API bool GetSeriesStats( const size_t uiSeries, SeriesStats_t& stats );
+
+/**
+*	Gets the value a series had in the last frame that was ended. Time series are reported in milliseconds.
+*	@return The value, or 0 if there is no history.
+*/
+HLCORE_API float GetLastValue( const size_t uiSeries );
+
+/**
+*	Computes statistics over a list of values, like those that GetSeriesStats computes over a history.
+*	@param pflValues Values to compute statistics for. Sorted in place.
+*	@return Whether there were any values.
+*/
+HLCORE_API bool ComputeStats( float* pflValues, const size_t uiCount, SeriesStats_t& stats );
+
+/**
+*	Copies a series' history, oldest frame first. Time series are copied in milliseconds.
+*	@return The number of values that were copied.
+*/
+HLCORE_API size_t GetSeriesHistory( const size_t uiSeries, float* pflValues, const size_t uiMaxValues );
+
+/**
+*	Adds the time spent in this object's scope to a series.
+*/
+class CScopedTimer final
+{
+public:
+	CScopedTimer( const size_t uiSeries )
+		: m_uiSeries( IsEnabled() ? uiSeries : INVALID_SERIES )
+		, m_iStart( m_uiSeries != INVALID_SERIES ? trace::GetTimestamp() : 0 )
+	{
+	}
+
+	~CScopedTimer()
+	{
+		if( m_uiSeries != INVALID_SERIES )
+			AddValue( m_uiSeries, trace::GetTimestamp() - m_iStart );
+	}
+
+private:
+	const size_t m_uiSeries;
+	const int64_t m_iStart;
+
+private:
+	CScopedTimer( const CScopedTimer& ) = delete;
+	CScopedTimer& operator=( const CScopedTimer& ) = delete;
+};
+}
+
+/**
+*	Adds the time until the end of the enclosing scope to the time series named pszName.
+*/
+#define PROFILE_SCOPE( pszName )																										\
+static const size_t TRACE_CONCAT( __profileSeries, __LINE__ ) = profiler::RegisterSeries( pszName, profiler::SeriesType::TIME );	\
+const profiler::CScopedTimer TRACE_CONCAT( __profileTimer, __LINE__ )( TRACE_CONCAT( __profileSeries, __LINE__ ) )
+
+/**
+*	Adds iCount to the count series named pszName.
+*/
+#define PROFILE_COUNT( pszName, iCount )																				\
+do																														\
+{																														\
+	if( profiler::IsEnabled() )																							\
+	{																													\
+		static const size_t __profileSeries = profiler::RegisterSeries( pszName, profiler::SeriesType::COUNT );			\
+		profiler::AddValue( __profileSeries, static_cast<int64_t>( iCount ) );											\
+	}																													\
+}																														\
+while( false )
+
+#endif //COMMON_PROFILER_H
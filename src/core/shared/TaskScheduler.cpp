@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
+
+#include "Logging.h"
+#include "Trace.h"
+
+#include "TaskScheduler.h"
+
+namespace tasks
+{
+namespace
+{
+/**
+*	Number of tasks per thread that ParallelFor splits work into when no grain size is given.
+*	A few per thread keeps threads busy when some items take longer than others.
+*/
+static const size_t TASKS_PER_THREAD = 4;
+
+struct Task_t
+{
+	TaskFn_t Func;
+	CTaskGroup* pGroup;
+};
+
+/**
+*	Tasks added by one thread. The owner takes tasks from the back, thieves from the front.
+*	Each queue is allocated separately so that queues of different threads don't share cache lines.
+*/
+struct TaskQueue_t
+{
+	std::mutex Mutex;
+	std::deque<Task_t> Tasks;
+};
+
+/**
+*	Queue 0 is shared by all threads outside the pool, queue N belongs to worker N.
+*	Only changed by Start and Stop, while no tasks are queued.
+*/
+static std::vector<std::unique_ptr<TaskQueue_t>> g_Queues;
+
+static std::vector<std::thread> g_Threads;
+
+static bool g_bRunning = false;
+
+static bool g_bQuit = false;
+
+/**
+*	Guards sleeping and waking up. Held while notifying so that threads can't miss wakeups.
+*/
+static std::mutex g_SleepMutex;
+static std::condition_variable g_WorkReady;
+
+/**
+*	Number of tasks in all queues.
+*/
+static std::atomic<size_t> g_uiQueued{ 0 };
+
+static std::atomic<const Hooks_t*> g_pHooks{ nullptr };
+
+static std::atomic<uint64_t> g_uiTasksRun{ 0 };
+static std::atomic<uint64_t> g_uiTasksStolen{ 0 };
+static std::atomic<uint64_t> g_uiTasksInline{ 0 };
+
+/**
+*	Index of the calling thread's queue.
+*/
+static thread_local size_t t_uiQueue = 0;
+
+/**
+*	Wakes up sleeping workers and threads waiting for groups.
+*/
+void Wake()
+{
+	std::lock_guard<std::mutex> lock( g_SleepMutex );
+
+	g_WorkReady.notify_all();
+}
+
+void Push( Task_t&& task )
+{
+	{
+		TaskQueue_t& queue = *g_Queues[ t_uiQueue ];
+
+		std::lock_guard<std::mutex> lock( queue.Mutex );
+
+		queue.Tasks.emplace_back( std::move( task ) );
+	}
+
+	g_uiQueued.fetch_add( 1, std::memory_order_release );
+
+	//Threads waiting for groups also sleep on this, so a single wakeup might not reach a worker.
+	Wake();
+}
+
+/**
+*	Takes a task from the calling thread's queue, or steals one from another queue.
+*/
+bool TryPop( Task_t& task )
+{
+	if( g_uiQueued.load( std::memory_order_acquire ) == 0 )
+		return false;
+
+	const size_t uiSelf = t_uiQueue;
+	const size_t uiNumQueues = g_Queues.size();
+
+	{
+		TaskQueue_t& queue = *g_Queues[ uiSelf ];
+
+		std::lock_guard<std::mutex> lock( queue.Mutex );
+
+		if( !queue.Tasks.empty() )
+		{
+			//Workers run their newest task since its data is most likely still in cache.
+			//The shared queue is first in, first out so threads outside the pool don't starve older tasks.
+			if( uiSelf != 0 )
+			{
+				task = std::move( queue.Tasks.back() );
+				queue.Tasks.pop_back();
+			}
+			else
+			{
+				task = std::move( queue.Tasks.front() );
+				queue.Tasks.pop_front();
+			}
+
+			g_uiQueued.fetch_sub( 1, std::memory_order_relaxed );
+			return true;
+		}
+	}
+
+	for( size_t uiOffset = 1; uiOffset < uiNumQueues; ++uiOffset )
+	{
+		const size_t uiVictim = ( uiSelf + uiOffset ) % uiNumQueues;
+
+		TaskQueue_t& queue = *g_Queues[ uiVictim ];
+
+		std::unique_lock<std::mutex> lock( queue.Mutex, std::try_to_lock );
+
+		//Skip queues that are busy instead of waiting for them; they'll be tried again.
+		if( !lock.owns_lock() || queue.Tasks.empty() )
+			continue;
+
+		task = std::move( queue.Tasks.front() );
+		queue.Tasks.pop_front();
+
+		lock.unlock();
+
+		g_uiQueued.fetch_sub( 1, std::memory_order_relaxed );
+
+		//Tasks from the shared queue aren't stolen; the shared queue has no owner.
+		if( uiVictim != 0 )
+		{
+			g_uiTasksStolen.fetch_add( 1, std::memory_order_relaxed );
+
+			const Hooks_t* const pHooks = g_pHooks.load( std::memory_order_acquire );
+
+			if( pHooks && pHooks->pfnTaskStolen )
+				pHooks->pfnTaskStolen( uiSelf, uiVictim, pHooks->pUserData );
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void RunTask( Task_t& task )
+{
+	const char* const pszName = task.pGroup->GetName();
+
+	const Hooks_t* const pHooks = g_pHooks.load( std::memory_order_acquire );
+
+	if( pHooks && pHooks->pfnTaskStarted )
+		pHooks->pfnTaskStarted( pszName, t_uiQueue, pHooks->pUserData );
+
+	{
+		const trace::CScopedEvent event( pszName );
+
+		task.Func();
+	}
+
+	if( pHooks && pHooks->pfnTaskFinished )
+		pHooks->pfnTaskFinished( pszName, t_uiQueue, pHooks->pUserData );
+
+	g_uiTasksRun.fetch_add( 1, std::memory_order_relaxed );
+
+	//Release the function's captures before the group can be destroyed.
+	CTaskGroup* const pGroup = task.pGroup;
+
+	task = Task_t();
+
+	pGroup->OnTaskFinished();
+}
+
+void WorkerMain( const size_t uiQueue )
+{
+	t_uiQueue = uiQueue;
+
+	Task_t task;
+
+	while( true )
+	{
+		if( TryPop( task ) )
+		{
+			RunTask( task );
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( g_SleepMutex );
+
+		//Tasks that were skipped because their queue was busy are still counted, so this doesn't sleep while there's work.
+		g_WorkReady.wait( lock, [] { return g_bQuit || g_uiQueued.load( std::memory_order_acquire ) > 0; } );
+
+		if( g_bQuit )
+			break;
+	}
+}
+
+static cvar::CConCommand tasks_report( "tasks_report",
+	[]( const util::CCommand& )
+	{
+		const Stats_t stats = GetStats();
+
+		Message( "%u worker threads, %llu tasks run, %llu stolen, %llu run without the scheduler\n",
+				 static_cast<unsigned int>( stats.uiNumThreads ),
+				 static_cast<unsigned long long>( stats.uiTasksRun ),
+				 static_cast<unsigned long long>( stats.uiTasksStolen ),
+				 static_cast<unsigned long long>( stats.uiTasksInline ) );
+	},
+	cvar::Flag::NONE, "Prints how many tasks the task scheduler has run" );
+}
+
+bool Start( size_t uiNumThreads )
+{
+	if( g_bRunning )
+		return true;
+
+	if( uiNumThreads == 0 )
+	{
+		const unsigned int uiHardwareThreads = std::thread::hardware_concurrency();
+
+		uiNumThreads = uiHardwareThreads > 1 ? uiHardwareThreads - 1 : 0;
+	}
+
+	g_bQuit = false;
+
+	g_Queues.clear();
+
+	for( size_t uiIndex = 0; uiIndex <= uiNumThreads; ++uiIndex )
+	{
+		g_Queues.emplace_back( std::make_unique<TaskQueue_t>() );
+	}
+
+	g_Threads.reserve( uiNumThreads );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumThreads; ++uiIndex )
+	{
+		g_Threads.emplace_back( &WorkerMain, uiIndex + 1 );
+	}
+
+	g_bRunning = true;
+
+	return true;
+}
+
+void Stop()
+{
+	if( !g_bRunning )
+		return;
+
+	assert( g_uiQueued.load() == 0 );
+
+	{
+		std::lock_guard<std::mutex> lock( g_SleepMutex );
+
+		g_bQuit = true;
+	}
+
+	g_WorkReady.notify_all();
+
+	for( auto& thread : g_Threads )
+	{
+		thread.join();
+	}
+
+	g_Threads.clear();
+	g_Queues.clear();
+
+	g_bRunning = false;
+}
+
+bool IsRunning()
+{
+	return g_bRunning;
+}
+
+size_t GetNumThreads()
+{
+	return g_Threads.size();
+}
+
+void SetHooks( const Hooks_t* pHooks )
+{
+	assert( g_uiQueued.load() == 0 );
+
+	g_pHooks.store( pHooks, std::memory_order_release );
+}
+
+Stats_t GetStats()
+{
+	Stats_t stats;
+
+	stats.uiNumThreads = GetNumThreads();
+	stats.uiTasksRun = g_uiTasksRun.load( std::memory_order_relaxed );
+	stats.uiTasksStolen = g_uiTasksStolen.load( std::memory_order_relaxed );
+	stats.uiTasksInline = g_uiTasksInline.load( std::memory_order_relaxed );
+
+	return stats;
+}
+
+CTaskGroup::CTaskGroup( const char* const pszName )
+	: m_pszName( pszName )
+{
+}
+
+CTaskGroup::~CTaskGroup()
+{
+	Wait();
+}
+
+void CTaskGroup::Run( TaskFn_t task )
+{
+	assert( task );
+
+	if( !g_bRunning )
+	{
+		g_uiTasksInline.fetch_add( 1, std::memory_order_relaxed );
+
+		const trace::CScopedEvent event( m_pszName );
+
+		task();
+		return;
+	}
+
+	m_uiPending.fetch_add( 1, std::memory_order_relaxed );
+
+	Push( { std::move( task ), this } );
+}
+
+void CTaskGroup::Wait()
+{
+	Task_t task;
+
+	while( m_uiPending.load( std::memory_order_acquire ) > 0 )
+	{
+		//Help out instead of blocking, this also makes waiting from inside a task safe.
+		if( TryPop( task ) )
+		{
+			RunTask( task );
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( g_SleepMutex );
+
+		g_WorkReady.wait( lock, [ this ]
+		{
+			return m_uiPending.load( std::memory_order_acquire ) == 0 || g_uiQueued.load( std::memory_order_acquire ) > 0;
+		} );
+	}
+}
+
+void CTaskGroup::OnTaskFinished()
+{
+	if( m_uiPending.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+	{
+		//The waiting thread may be asleep.
+		Wake();
+	}
+}
+
+void ParallelFor( const size_t uiCount, const std::function<void( const size_t uiIndex )>& func, const size_t uiGrainSize, const char* const pszName )
+{
+	if( uiCount == 0 )
+		return;
+
+	size_t uiNumTasks;
+
+	if( uiGrainSize > 0 )
+		uiNumTasks = ( uiCount + uiGrainSize - 1 ) / uiGrainSize;
+	else
+		uiNumTasks = std::min( uiCount, ( GetNumThreads() + 1 ) * TASKS_PER_THREAD );
+
+	if( uiNumTasks <= 1 || !g_bRunning )
+	{
+		const trace::CScopedEvent event( pszName );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			func( uiIndex );
+		}
+
+		return;
+	}
+
+	CTaskGroup group( pszName );
+
+	for( size_t uiTask = 0; uiTask < uiNumTasks; ++uiTask )
+	{
+		const size_t uiFirst = uiTask * uiCount / uiNumTasks;
+		const size_t uiEnd = ( uiTask + 1 ) * uiCount / uiNumTasks;
+
+		group.Run( [ &func, uiFirst, uiEnd ]
+		{
+			for( size_t uiIndex = uiFirst; uiIndex < uiEnd; ++uiIndex )
+			{
+				func( uiIndex );
+			}
+		} );
+	}
+
+	group.Wait();
+}
+}
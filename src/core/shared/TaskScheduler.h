@@ -0,0 +1,149 @@
+#ifndef COMMON_TASKSCHEDULER_H
+#define COMMON_TASKSCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "core/LibHLCore.h"
+
+/**
+*	Work stealing thread pool shared by the whole application.
+*	Each worker thread has its own queue. Tasks added by a worker go to its own queue and are run newest first,
+*	idle workers steal the oldest tasks from other queues. Tasks added by threads outside the pool go to a shared queue.
+*	Threads that wait for a task group run queued tasks while they wait, so groups can be waited on from inside tasks.
+*	The scheduler is started and stopped by app::CAppSystem. If it isn't running, tasks run immediately on the thread that adds them.
+*/
+namespace tasks
+{
+typedef std::function<void()> TaskFn_t;
+
+/**
+*	Callbacks for instrumenting the scheduler. Called on the thread that runs the task, so they must be thread safe.
+*	Any of them can be null.
+*/
+struct Hooks_t
+{
+	/**
+	*	Called before a task is run.
+	*	@param pszName Name of the task's group, or null if it has none.
+	*	@param uiThread Index of the thread running the task. 0 for threads outside the pool, workers start at 1.
+	*/
+	void ( *pfnTaskStarted )( const char* pszName, size_t uiThread, void* pUserData ) = nullptr;
+
+	/**
+	*	Called after a task has run.
+	*/
+	void ( *pfnTaskFinished )( const char* pszName, size_t uiThread, void* pUserData ) = nullptr;
+
+	/**
+	*	Called when a thread takes a task from another thread's queue.
+	*/
+	void ( *pfnTaskStolen )( size_t uiThief, size_t uiVictim, void* pUserData ) = nullptr;
+
+	void* pUserData = nullptr;
+};
+
+struct Stats_t
+{
+	size_t uiNumThreads = 0;
+
+	uint64_t uiTasksRun = 0;
+
+	/**
+	*	Tasks taken from another thread's queue.
+	*/
+	uint64_t uiTasksStolen = 0;
+
+	/**
+	*	Tasks that ran immediately because the scheduler wasn't running.
+	*/
+	uint64_t uiTasksInline = 0;
+};
+
+/**
+*	Starts the worker threads. Does nothing if the scheduler is already running.
+*	@param uiNumThreads Number of worker threads to create. If 0, one less than the number of hardware threads is used.
+*	@return Whether the scheduler is running.
+*/
+HLCORE_API bool Start( size_t uiNumThreads = 0 );
+
+/**
+*	Stops the worker threads. Must not be called while tasks are queued or running.
+*/
+HLCORE_API void Stop();
+
+HLCORE_API bool IsRunning();
+
+/**
+*	@return The number of worker threads. Does not include threads that wait for task groups.
+*/
+HLCORE_API size_t GetNumThreads();
+
+/**
+*	Sets the instrumentation hooks. Must not be called while tasks are queued or running.
+*	@param pHooks Hooks to use, or null to remove them. Must remain valid until they are removed.
+*/
+HLCORE_API void SetHooks( const Hooks_t* pHooks );
+
+HLCORE_API Stats_t GetStats();
+
+/**
+*	Tracks a set of tasks so they can be waited for.
+*	Tasks can add more tasks to the group they belong to. Waiting for a group recursively from its own tasks is not allowed.
+*/
+class HLCORE_API CTaskGroup final
+{
+public:
+	/**
+	*	@param pszName Name of the group, passed to hooks and used to record trace events. Must remain valid for the lifetime of the group;
+	*	string literals are expected.
+	*/
+	CTaskGroup( const char* const pszName = nullptr );
+
+	/**
+	*	Waits for all tasks.
+	*/
+	~CTaskGroup();
+
+	const char* GetName() const { return m_pszName; }
+
+	/**
+	*	Queues a task.
+	*/
+	void Run( TaskFn_t task );
+
+	/**
+	*	Runs queued tasks until all tasks in this group have finished.
+	*/
+	void Wait();
+
+	/**
+	*	Called by the scheduler when one of this group's tasks has finished.
+	*/
+	void OnTaskFinished();
+
+private:
+	const char* const m_pszName;
+
+	std::atomic<size_t> m_uiPending{ 0 };
+
+private:
+	CTaskGroup( const CTaskGroup& ) = delete;
+	CTaskGroup& operator=( const CTaskGroup& ) = delete;
+};
+
+/**
+*	Calls func once for every index in [0, uiCount) and waits for all calls to finish.
+*	Indices are split into contiguous ranges, and each range is run as one task.
+*	@param uiCount Number of work items.
+*	@param func Function to call for each item. Calls can be made on any thread, in any order.
+*	@param uiGrainSize Number of items per task. If 0, items are split into a few tasks per thread.
+*	@param pszName Name of the task group.
+*/
+HLCORE_API void ParallelFor( const size_t uiCount, const std::function<void( const size_t uiIndex )>& func, const size_t uiGrainSize = 0,
+							 const char* const pszName = nullptr );
+}
+
+#endif //COMMON_TASKSCHEDULER_H
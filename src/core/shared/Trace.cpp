@@ -0,0 +1,247 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
+
+#include "Logging.h"
+
+#include "Trace.h"
+
+namespace trace
+{
+namespace
+{
+/**
+*	Maximum number of events recorded in a single trace. Further events are dropped.
+*/
+static const size_t MAX_EVENTS = 1 << 20;
+
+struct Event_t
+{
+	const char* pszName;
+	int64_t iStart;
+	int64_t iEnd;
+};
+
+/**
+*	Events recorded by one thread. The mutex is only contended while the trace is being written.
+*/
+struct ThreadBuffer_t
+{
+	std::mutex Mutex;
+
+	unsigned int uiThreadId;
+
+	std::vector<Event_t> Events;
+};
+
+static std::atomic<bool> g_bRecording{ false };
+
+static std::atomic<size_t> g_uiEventCount{ 0 };
+
+static std::mutex g_Mutex;
+
+//Shared with the owning thread so buffers outlive threads that exit while recording.
+static std::vector<std::shared_ptr<ThreadBuffer_t>> g_Buffers;
+
+static unsigned int g_uiNextThreadId = 1;
+
+static std::string g_szFilename;
+
+ThreadBuffer_t& GetThreadBuffer()
+{
+	static thread_local std::shared_ptr<ThreadBuffer_t> buffer;
+
+	if( !buffer )
+	{
+		buffer = std::make_shared<ThreadBuffer_t>();
+
+		std::lock_guard<std::mutex> lock( g_Mutex );
+
+		buffer->uiThreadId = g_uiNextThreadId++;
+
+		g_Buffers.push_back( buffer );
+	}
+
+	return *buffer;
+}
+
+void WriteEscapedString( FILE* pFile, const char* pszString )
+{
+	fputc( '\"', pFile );
+
+	for( ; *pszString; ++pszString )
+	{
+		if( *pszString == '\"' || *pszString == '\\' )
+			fputc( '\\', pFile );
+
+		if( static_cast<unsigned char>( *pszString ) >= ' ' )
+			fputc( *pszString, pFile );
+	}
+
+	fputc( '\"', pFile );
+}
+
+static cvar::CConCommand trace_start( "trace_start",
+	[]( const util::CCommand& args )
+	{
+		const char* const pszFilename = args.ArgC() >= 2 ? args.Arg( 1 ) : "trace.json";
+
+		if( StartRecording( pszFilename ) )
+			Message( "Recording trace to \"%s\"\n", pszFilename );
+	},
+	cvar::Flag::NONE, "Starts recording a trace of timed events. Usage: trace_start [filename]" );
+
+static cvar::CConCommand trace_stop( "trace_stop",
+	[]( const util::CCommand& )
+	{
+		if( !IsRecording() )
+		{
+			Message( "Not recording a trace\n" );
+			return;
+		}
+
+		StopRecording();
+	},
+	cvar::Flag::NONE, "Stops recording a trace and writes it to disk" );
+}
+
+bool IsRecording()
+{
+	return g_bRecording.load( std::memory_order_relaxed );
+}
+
+bool StartRecording( const char* const pszFilename )
+{
+	assert( pszFilename && *pszFilename );
+
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	if( g_bRecording )
+	{
+		Warning( "trace::StartRecording: Already recording to \"%s\"\n", g_szFilename.c_str() );
+		return false;
+	}
+
+	for( auto it = g_Buffers.begin(); it != g_Buffers.end(); )
+	{
+		//Forget threads that have exited.
+		if( it->use_count() == 1 )
+		{
+			it = g_Buffers.erase( it );
+			continue;
+		}
+
+		std::lock_guard<std::mutex> bufferLock( ( *it )->Mutex );
+
+		( *it )->Events.clear();
+
+		++it;
+	}
+
+	g_szFilename = pszFilename;
+	g_uiEventCount = 0;
+
+	g_bRecording = true;
+
+	return true;
+}
+
+bool StopRecording()
+{
+	std::lock_guard<std::mutex> lock( g_Mutex );
+
+	if( !g_bRecording )
+		return false;
+
+	g_bRecording = false;
+
+	FILE* pFile = fopen( g_szFilename.c_str(), "w" );
+
+	if( !pFile )
+	{
+		Error( "trace::StopRecording: Couldn't open \"%s\" for writing\n", g_szFilename.c_str() );
+		return false;
+	}
+
+	fprintf( pFile, "{\"traceEvents\":[\n" );
+
+	bool bFirst = true;
+
+	size_t uiWritten = 0;
+
+	for( auto& buffer : g_Buffers )
+	{
+		std::lock_guard<std::mutex> bufferLock( buffer->Mutex );
+
+		for( const auto& event : buffer->Events )
+		{
+			if( !bFirst )
+				fprintf( pFile, ",\n" );
+
+			bFirst = false;
+
+			fprintf( pFile, "{\"name\":" );
+			WriteEscapedString( pFile, event.pszName );
+			fprintf( pFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}",
+				buffer->uiThreadId,
+				static_cast<long long>( event.iStart ),
+				static_cast<long long>( event.iEnd - event.iStart ) );
+		}
+
+		uiWritten += buffer->Events.size();
+
+		buffer->Events.clear();
+		buffer->Events.shrink_to_fit();
+	}
+
+	fprintf( pFile, "\n]}\n" );
+
+	const bool bSuccess = !ferror( pFile );
+
+	fclose( pFile );
+
+	if( !bSuccess )
+	{
+		Error( "trace::StopRecording: Error writing \"%s\"\n", g_szFilename.c_str() );
+		return false;
+	}
+
+	Message( "Wrote %u trace events to \"%s\"\n", static_cast<unsigned int>( uiWritten ), g_szFilename.c_str() );
+
+	if( g_uiEventCount > MAX_EVENTS )
+		Warning( "%u trace events were dropped\n", static_cast<unsigned int>( g_uiEventCount - MAX_EVENTS ) );
+
+	return true;
+}
+
+int64_t GetTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void AddEvent( const char* const pszName, const int64_t iStart, const int64_t iEnd )
+{
+	assert( pszName );
+
+	if( !IsRecording() )
+		return;
+
+	if( g_uiEventCount.fetch_add( 1, std::memory_order_relaxed ) >= MAX_EVENTS )
+		return;
+
+	auto& buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock( buffer.Mutex );
+
+	buffer.Events.push_back( { pszName, iStart, iEnd } );
+}
+}
@@ -0,0 +1,82 @@
+#ifndef COMMON_TRACE_H
+#define COMMON_TRACE_H
+
+#include <cstdint>
+
+#include "core/LibHLCore.h"
+
+/**
+*	Lightweight tracing of scoped events. Recorded events are written as Chrome trace_event JSON,
+*	which can be viewed in chrome://tracing.
+*	Recording is controlled with the trace_start and trace_stop commands.
+*/
+namespace trace
+{
+/**
+*	@return Whether events are being recorded.
+*/
+HLCORE_API bool IsRecording();
+
+/**
+*	Starts recording events. Any events recorded before are discarded.
+*	@param pszFilename File to write the trace to when recording stops.
+*	@return Whether recording was started.
+*/
+HLCORE_API bool StartRecording( const char* const pszFilename );
+
+/**
+*	Stops recording and writes the trace file.
+*	@return Whether the file was written.
+*/
+HLCORE_API bool StopRecording();
+
+/**
+*	@return Current time in microseconds, as used for event timestamps.
+*/
+HLCORE_API int64_t GetTimestamp();
+
+/**
+*	Records an event for the calling thread. Does nothing if not recording.
+*	@param pszName Name of the event. Must remain valid until recording stops; string literals are expected.
+*	@param iStart When the event started, as returned by GetTimestamp.
+*	@param iEnd When the event ended, as returned by GetTimestamp.
+*/
+HLCORE_API void AddEvent( const char* const pszName, const int64_t iStart, const int64_t iEnd );
+
+/**
+*	Records an event that lasts as long as this object's scope.
+*/
+class CScopedEvent final
+{
+public:
+	CScopedEvent( const char* const pszName )
+		: m_pszName( IsRecording() ? pszName : nullptr )
+		, m_iStart( m_pszName ? GetTimestamp() : 0 )
+	{
+	}
+
+	~CScopedEvent()
+	{
+		if( m_pszName )
+			AddEvent( m_pszName, m_iStart, GetTimestamp() );
+	}
+
+private:
+	const char* const m_pszName;
+	const int64_t m_iStart;
+
+private:
+	CScopedEvent( const CScopedEvent& ) = delete;
+	CScopedEvent& operator=( const CScopedEvent& ) = delete;
+};
+}
+
+#define TRACE_CONCAT_IMPL( a, b ) a##b
+#define TRACE_CONCAT( a, b ) TRACE_CONCAT_IMPL( a, b )
+
+/**
+*	Records an event named pszName that lasts until the end of the enclosing scope.
+*/
+#define TRACE_SCOPE( pszName ) const trace::CScopedEvent TRACE_CONCAT( __traceEvent, __LINE__ )( pszName )
+
+#endif //COMMON_TRACE_H
@@ -48,10 +48,11 @@ float UTIL_RandomFloat( float flLow, float flHigh )
 
 long long GetCurrentTick()
 {
-	return duration_cast<milliseconds>( high_resolution_clock::now().time_since_epoch() ).count();
+	return duration_cast<milliseconds>( steady_clock::now().time_since_epoch() ).count();
 }
 
 double GetCurrentTime()
 {
-	return GetCurrentTick() / 1000.0;
+	//Not rounded to ticks, so frame times don't jitter by a millisecond.
+	return duration<double>( steady_clock::now().time_since_epoch() ).count();
 }
\ No newline at end of file
@@ -74,13 +74,13 @@ constexpr inline size_t _ArraySizeof( T( &)[ SIZE ] )
 //TODO: this might be better off in a static library;
 
 /**
-*	Returns the current tick time, in milliseconds.
+*	Returns the current tick time, in milliseconds. The clock is monotonic, and only meaningful relative to other ticks.
 *	@return Tick time, in milliseconds.
 */
 extern "C" HLCORE_API long long GetCurrentTick();
 
 /**
-*	Gets the current time, in seconds.
+*	Gets the current time, in seconds. The clock is monotonic and has sub-millisecond resolution, and is only meaningful relative to other times.
 *	@return Current time, in seconds.
 */
 extern "C" HLCORE_API double GetCurrentTime();
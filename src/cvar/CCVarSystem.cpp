@@ -1,8 +1,10 @@
 #include <cassert>
 #include <cctype>
+#include <chrono>
 #include <cstring>
 
 #include "shared/Logging.h"
+#include "shared/Perf.h"
 
 #include "utility/StringUtils.h"
 
@@ -27,6 +29,18 @@ static CConCommand g_Wait( "wait", &g_CVars, Flag::NONE, "Suspends command execu
 static CCVar g_ShowWait( "showwait", CCVarArgsBuilder().FloatValue( 0 ).HelpInfo( "If non-zero, outputs text every time a wait command is processed" ) );
 
 static CConCommand g_Find( "find", &g_CVars, Flag::NONE, "Finds commands by searching by name and through help info" );
+
+static CConCommand g_Exec( "exec", &g_CVars, Flag::NONE, "Executes a config file" );
+
+static CCVar g_ExecBudget( "exec_budget", CCVarArgsBuilder().FloatValue( 4 ).MinValue( 0 ).HelpInfo( "Maximum time in milliseconds spent executing config files each frame. 0 for no limit" ) );
+
+static CConCommand g_CmdList( "cmdlist", &g_CVars, Flag::NONE, "Lists all commands, or all commands whose name starts with the given prefix" );
+
+static CConCommand g_CVarLookups( "cvar_lookups", &g_CVars, Flag::NONE, "Shows how many times commands have been looked up by name" );
+
+static CConCommand g_PerfDump( "perf_dump", &g_CVars, Flag::NONE, "Prints the perf timers and counters. Usage: perf_dump [filter]" );
+
+static CConCommand g_PerfReset( "perf_reset", &g_CVars, Flag::NONE, "Clears the perf timers and counters" );
 }
 
 REGISTER_INTERFACE_GLOBAL( ICVARSYSTEM_NAME, CCVarSystem, &g_CVars );
@@ -63,11 +77,21 @@ void CCVarSystem::Shutdown()
 	m_bInitialized = false;
 
 	m_Commands.clear();
+	m_CommandTrie.Clear();
+
+	m_PendingChanges.clear();
+	m_PendingChangeIndices.clear();
+
+	m_ExecFiles.clear();
+
+	++m_uiCommandGeneration;
 }
 
 void CCVarSystem::RunFrame()
 {
 	Execute();
+
+	DispatchDeferredChanges();
 }
 
 bool CCVarSystem::AddCommand( CBaseConCommand* const pCommand )
@@ -81,7 +105,7 @@ bool CCVarSystem::AddCommand( CBaseConCommand* const pCommand )
 	}
 
 	{
-		auto it = m_Commands.find( pCommand->GetName() );
+		auto it = m_Commands.find( StringPool().Find( pCommand->GetName() ) );
 
 		//Duplicate command; check if they're compatible or not.
 		if( it != m_Commands.end() )
@@ -160,7 +184,14 @@ bool CCVarSystem::AddCommand( CBaseConCommand* const pCommand )
 		}
 	}
 
-	auto it = m_Commands.insert( std::make_pair( pCommand->GetName(), pCommand ) );
+	auto it = m_Commands.insert( std::make_pair( StringPool().Intern( pCommand->GetName() ), pCommand ) );
+
+	if( it.second )
+	{
+		m_CommandTrie.Add( pCommand );
+
+		++m_uiCommandGeneration;
+	}
 
 	return it.second;
 }
@@ -172,7 +203,7 @@ void CCVarSystem::RemoveCommand( CBaseConCommand* const pCommand )
 		return;
 	}
 
-	auto it = m_Commands.find( pCommand->GetName() );
+	auto it = m_Commands.find( StringPool().Find( pCommand->GetName() ) );
 
 	if( it == m_Commands.end() )
 	{
@@ -185,7 +216,13 @@ void CCVarSystem::RemoveCommand( CBaseConCommand* const pCommand )
 		return;
 	}
 
+	RemovePendingChange( it->second );
+
+	m_CommandTrie.Remove( it->second->GetName() );
+
 	m_Commands.erase( it );
+
+	++m_uiCommandGeneration;
 }
 
 void CCVarSystem::RemoveCommand( const char* const pszName )
@@ -197,14 +234,20 @@ void CCVarSystem::RemoveCommand( const char* const pszName )
 		return;
 	}
 
-	auto it = m_Commands.find( pszName );
+	auto it = m_Commands.find( StringPool().Find( pszName ) );
 
 	if( it == m_Commands.end() )
 	{
 		return;
 	}
 
-	m_Commands.erase( pszName );
+	RemovePendingChange( it->second );
+
+	m_CommandTrie.Remove( it->second->GetName() );
+
+	m_Commands.erase( it );
+
+	++m_uiCommandGeneration;
 }
 
 void CCVarSystem::Command( const char* const pszCommand )
@@ -246,6 +289,14 @@ void CCVarSystem::Execute()
 	//The wait is over.
 	m_bWait = false;
 
+	if( ExecuteBuffer() )
+		ExecuteFiles();
+}
+
+bool CCVarSystem::ExecuteBuffer()
+{
+	bool bContinue = true;
+
 	//Process the command buffer.
 	char* pszCommand = m_szCommandBuffer;
 
@@ -284,15 +335,9 @@ void CCVarSystem::Execute()
 			ProcessCommand( command );
 
 			//Processed a wait command.
-			if( m_bWait )
+			if( CheckWait() )
 			{
-				m_bWait = false;
-
-				if( g_ShowWait.GetBool() )
-				{
-					Message( "Waiting\n" );
-				}
-
+				bContinue = false;
 				break;
 			}
 		}
@@ -315,6 +360,97 @@ void CCVarSystem::Execute()
 	{
 		memset( m_szCommandBuffer, 0, sizeof( m_szCommandBuffer ) );
 	}
+
+	return bContinue;
+}
+
+void CCVarSystem::ExecuteFiles()
+{
+	if( m_ExecFiles.empty() )
+		return;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	const double flBudget = g_ExecBudget.GetFloat() / 1000.0;
+
+	char szCommand[ util::CCommand::MAX_LENGTH ];
+
+	util::CCommand command;
+
+	while( !m_ExecFiles.empty() )
+	{
+		CExecFile& file = *m_ExecFiles.back();
+
+		bool bTooLong;
+
+		if( !file.ReadCommand( szCommand, sizeof( szCommand ), bTooLong ) )
+		{
+			m_ExecFiles.pop_back();
+			continue;
+		}
+
+		if( bTooLong )
+		{
+			Error( "Command in \"%s\" is too long, ignoring\n", file.GetFilename().c_str() );
+			continue;
+		}
+
+		if( !command.Initialize( szCommand ) )
+		{
+			Error( "Failed to initialize command with contents \"%s\"\n", szCommand );
+			continue;
+		}
+
+		ProcessCommand( command );
+
+		if( CheckWait() )
+			return;
+
+		//Commands that were added to the buffer by this command run before the next command in the file.
+		if( *m_szCommandBuffer && !ExecuteBuffer() )
+			return;
+
+		if( flBudget > 0 && std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() >= flBudget )
+			return;
+	}
+}
+
+bool CCVarSystem::CheckWait()
+{
+	if( !m_bWait )
+		return false;
+
+	m_bWait = false;
+
+	if( g_ShowWait.GetBool() )
+	{
+		Message( "Waiting\n" );
+	}
+
+	return true;
+}
+
+bool CCVarSystem::ExecFile( const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	if( m_ExecFiles.size() >= MAX_EXEC_DEPTH )
+	{
+		Error( "Too many nested config files, cannot execute \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	auto file = std::make_unique<CExecFile>();
+
+	if( !file->Open( pszFilename ) )
+	{
+		Warning( "Couldn't exec \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	m_ExecFiles.push_back( std::move( file ) );
+
+	return true;
 }
 
 const CBaseConCommand* CCVarSystem::FindCommand( const char* const pszName ) const
@@ -324,7 +460,9 @@ const CBaseConCommand* CCVarSystem::FindCommand( const char* const pszName ) con
 	if( !( *pszName ) )
 		return nullptr;
 
-	auto it = m_Commands.find( pszName );
+	++m_uiNameLookups;
+
+	auto it = m_Commands.find( StringPool().Find( pszName ) );
 
 	if( it == m_Commands.end() )
 	{
@@ -339,6 +477,19 @@ CBaseConCommand* CCVarSystem::FindCommand( const char* const pszName )
 	return const_cast<CBaseConCommand*>( const_cast<const CCVarSystem* const>( this )->FindCommand( pszName ) );
 }
 
+void CCVarSystem::FindCommandsByPrefix( const char* const pszPrefix, const CommandCallback pCallback, void* pObject ) const
+{
+	assert( pszPrefix );
+	assert( pCallback );
+
+	m_CommandTrie.EnumeratePrefix( pszPrefix,
+		[ = ]( const CBaseConCommand& command )
+		{
+			return pCallback( pObject, command );
+		}
+	);
+}
+
 const CCVar* CCVarSystem::GetCVarWarn( const char* const pszCVar ) const
 {
 	assert( pszCVar );
@@ -439,7 +590,7 @@ void CCVarSystem::ProcessCommand( const util::CCommand& args )
 
 	const char* const pszName = args.Arg( 0 );
 
-	auto it = m_Commands.find( pszName );
+	auto it = m_Commands.find( StringPool().Find( pszName ) );
 
 	if( it == m_Commands.end() )
 	{
@@ -551,6 +702,44 @@ void CCVarSystem::HandleConCommand( const CConCommand& command, const util::CCom
 			}
 		}
 	}
+	else if( strcmp( pszName, "exec" ) == 0 )
+	{
+		if( args.ArgC() < 2 )
+		{
+			Message( "Usage: exec <filename>\n" );
+
+			return;
+		}
+
+		ExecFile( args.Arg( 1 ) );
+	}
+	else if( strcmp( pszName, "cmdlist" ) == 0 )
+	{
+		size_t uiCount = 0;
+
+		m_CommandTrie.EnumeratePrefix( args.ArgC() >= 2 ? args.Arg( 1 ) : "",
+			[ & ]( const CBaseConCommand& command )
+			{
+				Message( "%s\n", command.GetName() );
+				++uiCount;
+				return true;
+			}
+		);
+
+		Message( "%u commands\n", static_cast<unsigned int>( uiCount ) );
+	}
+	else if( strcmp( pszName, "cvar_lookups" ) == 0 )
+	{
+		Message( "%u name lookups, command generation %u\n", m_uiNameLookups, m_uiCommandGeneration );
+	}
+	else if( strcmp( pszName, "perf_dump" ) == 0 )
+	{
+		perf::Dump( args.ArgC() >= 2 ? args.Arg( 1 ) : nullptr );
+	}
+	else if( strcmp( pszName, "perf_reset" ) == 0 )
+	{
+		perf::Reset();
+	}
 }
 
 bool CCVarSystem::HasGlobalCVarHandler( ICVarHandler* pHandler ) const
@@ -558,17 +747,18 @@ bool CCVarSystem::HasGlobalCVarHandler( ICVarHandler* pHandler ) const
 	if( !pHandler )
 		return false;
 
-	return std::find( m_GlobalCVarHandlers.begin(), m_GlobalCVarHandlers.end(), pHandler ) != m_GlobalCVarHandlers.end();
+	return std::find( m_GlobalCVarHandlers.begin(), m_GlobalCVarHandlers.end(), pHandler ) != m_GlobalCVarHandlers.end() ||
+		std::find( m_DeferredCVarHandlers.begin(), m_DeferredCVarHandlers.end(), pHandler ) != m_DeferredCVarHandlers.end();
 }
 
-bool CCVarSystem::InstallGlobalCVarHandler( ICVarHandler* pHandler )
+bool CCVarSystem::InstallGlobalCVarHandler( ICVarHandler* pHandler, const bool bDeferred )
 {
 	assert( pHandler );
 
 	if( HasGlobalCVarHandler( pHandler ) )
 		return true;
 
-	m_GlobalCVarHandlers.push_back( pHandler );
+	( bDeferred ? m_DeferredCVarHandlers : m_GlobalCVarHandlers ).push_back( pHandler );
 
 	return true;
 }
@@ -578,14 +768,16 @@ void CCVarSystem::RemoveGlobalCVarHandler( ICVarHandler* pHandler )
 	if( !pHandler )
 		return;
 
-	auto it = std::find( m_GlobalCVarHandlers.begin(), m_GlobalCVarHandlers.end(), pHandler );
-
-	if( it == m_GlobalCVarHandlers.end() )
+	for( auto pHandlers : { &m_GlobalCVarHandlers, &m_DeferredCVarHandlers } )
 	{
-		return;
-	}
+		auto it = std::find( pHandlers->begin(), pHandlers->end(), pHandler );
 
-	m_GlobalCVarHandlers.erase( it );
+		if( it != pHandlers->end() )
+		{
+			pHandlers->erase( it );
+			return;
+		}
+	}
 }
 
 void CCVarSystem::CallGlobalCVarHandlers( CCVar& cvar, const char* pszOldValue, float flOldValue )
@@ -594,5 +786,65 @@ void CCVarSystem::CallGlobalCVarHandlers( CCVar& cvar, const char* pszOldValue,
 	{
 		handler->HandleCVar( cvar, pszOldValue, flOldValue );
 	}
+
+	if( !m_DeferredCVarHandlers.empty() )
+		QueueDeferredChange( cvar, pszOldValue, flOldValue );
+}
+
+void CCVarSystem::QueueDeferredChange( CCVar& cvar, const char* pszOldValue, float flOldValue )
+{
+	//Only the first change in a frame is stored, so handlers see the value from before the frame.
+	if( m_PendingChangeIndices.find( &cvar ) != m_PendingChangeIndices.end() )
+		return;
+
+	m_PendingChangeIndices.emplace( &cvar, m_PendingChanges.size() );
+
+	m_PendingChanges.push_back( { &cvar, pszOldValue, flOldValue } );
+}
+
+void CCVarSystem::DispatchDeferredChanges()
+{
+	if( m_PendingChanges.empty() )
+		return;
+
+	//Handlers can change cvars; those changes are dispatched next frame.
+	std::vector<PendingChange_t> changes;
+
+	changes.swap( m_PendingChanges );
+
+	m_PendingChangeIndices.clear();
+
+	for( const auto& change : changes )
+	{
+		//Changed back to the original value.
+		if( change.szOldValue == change.pCVar->GetString() )
+			continue;
+
+		for( size_t uiIndex = 0; uiIndex < m_DeferredCVarHandlers.size(); ++uiIndex )
+		{
+			m_DeferredCVarHandlers[ uiIndex ]->HandleCVar( *change.pCVar, change.szOldValue.c_str(), change.flOldValue );
+		}
+	}
+}
+
+void CCVarSystem::RemovePendingChange( const CBaseConCommand* pCommand )
+{
+	if( pCommand->GetType() != CommandType::CVAR )
+		return;
+
+	auto it = m_PendingChangeIndices.find( static_cast<const CCVar*>( pCommand ) );
+
+	if( it == m_PendingChangeIndices.end() )
+		return;
+
+	//Don't leave a dangling pointer behind; the change is simply never reported.
+	m_PendingChanges.erase( m_PendingChanges.begin() + it->second );
+
+	m_PendingChangeIndices.clear();
+
+	for( size_t uiIndex = 0; uiIndex < m_PendingChanges.size(); ++uiIndex )
+	{
+		m_PendingChangeIndices.emplace( m_PendingChanges[ uiIndex ].pCVar, uiIndex );
+	}
 }
 }
\ No newline at end of file
@@ -1,33 +1,60 @@
 #ifndef CVAR_CCVARSYSTEM_H
 #define CVAR_CCVARSYSTEM_H
 
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "shared/CStringPool.h"
+
 #include "utility/StringUtils.h"
 
 #include "utility/CCommand.h"
 
 #include "cvar/ICVarSystem.h"
 
+#include "CCommandTrie.h"
+#include "CExecFile.h"
+
 namespace cvar
 {
 class CCVarSystem final : public ICVarSystem, public IConCommandHandler
 {
 private:
-	//The default hasher and equal comparator for const char* operate on the memory address, not the string itself.
-	typedef std::unordered_map<const char*, CBaseConCommand*, Hash_C_String<const char*>, EqualTo_C_String<const char*>> Commands_t;
+	/**
+	*	Commands keyed by the string pool id of their name. Names that aren't in the pool have INVALID_STRING_ID as their id, which is never a key.
+	*/
+	typedef std::unordered_map<StringId_t, CBaseConCommand*> Commands_t;
 
 	typedef std::vector<ICVarHandler*> GlobalCVarHandlers_t;
 
+	/**
+	*	A cvar change that deferred handlers have not been told about yet.
+	*/
+	struct PendingChange_t
+	{
+		CCVar* pCVar;
+
+		std::string szOldValue;
+		float flOldValue;
+	};
+
 	/**
 	*	Maximum size of the command buffer. This should be able to store 64 commands that use the maximum space available.
 	*/
 	static const size_t MAX_COMMAND_BUFFER = util::CCommand::MAX_LENGTH * 64;
 
+	/**
+	*	Maximum number of config files that can be executing at the same time. Prevents infinite recursion.
+	*/
+	static const size_t MAX_EXEC_DEPTH = 32;
+
 public:
 	using CVarArchiveCallback = void ( * )( void* pObject, const CCVar& cvar );
 
+	using CommandCallback = bool ( * )( void* pObject, const CBaseConCommand& command );
+
 public:
 	CCVarSystem();
 	~CCVarSystem();
@@ -50,10 +77,18 @@ public:
 
 	void Execute() override final;
 
+	bool ExecFile( const char* const pszFilename ) override final;
+
 	const CBaseConCommand* FindCommand( const char* const pszName ) const override final;
 
 	CBaseConCommand* FindCommand( const char* const pszName ) override final;
 
+	void FindCommandsByPrefix( const char* const pszPrefix, const CommandCallback pCallback, void* pObject = nullptr ) const override final;
+
+	unsigned int GetCommandGeneration() const override final { return m_uiCommandGeneration; }
+
+	unsigned int GetNameLookupCount() const override final { return m_uiNameLookups; }
+
 private:
 	const CCVar* GetCVarWarn( const char* const pszCVar ) const;
 
@@ -72,26 +107,77 @@ public:
 
 	bool HasGlobalCVarHandler( ICVarHandler* pHandler ) const override final;
 
-	bool InstallGlobalCVarHandler( ICVarHandler* pHandler ) override final;
+	bool InstallGlobalCVarHandler( ICVarHandler* pHandler, const bool bDeferred = false ) override final;
 
 	void RemoveGlobalCVarHandler( ICVarHandler* pHandler ) override final;
 
 private:
+	/**
+	*	Executes the command buffer.
+	*	@return Whether execution should continue. false if a wait command was processed.
+	*/
+	bool ExecuteBuffer();
+
+	/**
+	*	Executes commands from config files until they are finished, a wait command is processed, or the time budget runs out.
+	*/
+	void ExecuteFiles();
+
+	/**
+	*	Handles a wait command that was just processed.
+	*	@return Whether a wait command was processed.
+	*/
+	bool CheckWait();
+
 	void ProcessCommand( const util::CCommand& args );
 
 	void HandleConCommand( const CConCommand& command, const util::CCommand& args ) override final;
 
 	void CallGlobalCVarHandlers( CCVar& cvar, const char* pszOldValue, float flOldValue );
 
+	void QueueDeferredChange( CCVar& cvar, const char* pszOldValue, float flOldValue );
+
+	/**
+	*	Notifies deferred handlers of all changes made since the last call.
+	*/
+	void DispatchDeferredChanges();
+
+	/**
+	*	Discards pending changes for a cvar that is being removed.
+	*/
+	void RemovePendingChange( const CBaseConCommand* pCommand );
+
 private:
 	bool m_bInitialized = false;
 
 	Commands_t m_Commands;
 
+	/**
+	*	Index of m_Commands by name prefix.
+	*/
+	CCommandTrie m_CommandTrie;
+
 	GlobalCVarHandlers_t m_GlobalCVarHandlers;
+	GlobalCVarHandlers_t m_DeferredCVarHandlers;
+
+	std::vector<PendingChange_t> m_PendingChanges;
+
+	/**
+	*	Maps cvars to their index in m_PendingChanges.
+	*/
+	std::unordered_map<const CCVar*, size_t> m_PendingChangeIndices;
+
+	unsigned int m_uiCommandGeneration = 1;
+
+	mutable unsigned int m_uiNameLookups = 0;
 
 	char m_szCommandBuffer[ MAX_COMMAND_BUFFER ];
 
+	/**
+	*	Config files that are being executed. The last file is executed first.
+	*/
+	std::vector<std::unique_ptr<CExecFile>> m_ExecFiles;
+
 	/**
 	*	If set to true while executing commands, will suspend command execution until the next frame.
 	*/
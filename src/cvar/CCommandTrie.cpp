@@ -0,0 +1,145 @@
+#include <cassert>
+
+#include "cvar/CBaseConCommand.h"
+
+#include "CCommandTrie.h"
+
+namespace cvar
+{
+CCommandTrie::CCommandTrie()
+{
+	Clear();
+}
+
+void CCommandTrie::Add( CBaseConCommand* pCommand )
+{
+	assert( pCommand );
+
+	Index_t uiNode = 0;
+
+	for( const char* pszName = pCommand->GetName(); *pszName; ++pszName )
+	{
+		//Find the child, or the sibling to insert after to keep the children sorted.
+		Index_t uiPrevious = INVALID_INDEX;
+		Index_t uiChild = m_Nodes[ uiNode ].uiFirstChild;
+
+		while( uiChild != INVALID_INDEX && m_Nodes[ uiChild ].cChar < *pszName )
+		{
+			uiPrevious = uiChild;
+			uiChild = m_Nodes[ uiChild ].uiNextSibling;
+		}
+
+		if( uiChild == INVALID_INDEX || m_Nodes[ uiChild ].cChar != *pszName )
+		{
+			const Node_t newNode{ *pszName, INVALID_INDEX, uiChild, nullptr };
+
+			Index_t uiNewNode;
+
+			if( !m_FreeNodes.empty() )
+			{
+				uiNewNode = m_FreeNodes.back();
+				m_FreeNodes.pop_back();
+
+				m_Nodes[ uiNewNode ] = newNode;
+			}
+			else
+			{
+				uiNewNode = static_cast<Index_t>( m_Nodes.size() );
+				m_Nodes.push_back( newNode );
+			}
+
+			if( uiPrevious != INVALID_INDEX )
+				m_Nodes[ uiPrevious ].uiNextSibling = uiNewNode;
+			else
+				m_Nodes[ uiNode ].uiFirstChild = uiNewNode;
+
+			uiChild = uiNewNode;
+		}
+
+		uiNode = uiChild;
+	}
+
+	m_Nodes[ uiNode ].pCommand = pCommand;
+}
+
+void CCommandTrie::Remove( const char* const pszName )
+{
+	assert( pszName );
+
+	std::vector<Index_t> path;
+
+	path.push_back( 0 );
+
+	for( const char* pszChar = pszName; *pszChar; ++pszChar )
+	{
+		Index_t uiChild = m_Nodes[ path.back() ].uiFirstChild;
+
+		while( uiChild != INVALID_INDEX && m_Nodes[ uiChild ].cChar != *pszChar )
+			uiChild = m_Nodes[ uiChild ].uiNextSibling;
+
+		if( uiChild == INVALID_INDEX )
+			return;
+
+		path.push_back( uiChild );
+	}
+
+	m_Nodes[ path.back() ].pCommand = nullptr;
+
+	//Prune nodes that no longer lead to a command. The root is never pruned.
+	while( path.size() > 1 )
+	{
+		const Index_t uiNode = path.back();
+
+		if( m_Nodes[ uiNode ].pCommand || m_Nodes[ uiNode ].uiFirstChild != INVALID_INDEX )
+			break;
+
+		path.pop_back();
+
+		Node_t& parent = m_Nodes[ path.back() ];
+
+		if( parent.uiFirstChild == uiNode )
+			parent.uiFirstChild = m_Nodes[ uiNode ].uiNextSibling;
+		else
+		{
+			Index_t uiSibling = parent.uiFirstChild;
+
+			while( m_Nodes[ uiSibling ].uiNextSibling != uiNode )
+				uiSibling = m_Nodes[ uiSibling ].uiNextSibling;
+
+			m_Nodes[ uiSibling ].uiNextSibling = m_Nodes[ uiNode ].uiNextSibling;
+		}
+
+		m_FreeNodes.push_back( uiNode );
+	}
+}
+
+void CCommandTrie::Clear()
+{
+	m_Nodes.clear();
+	m_FreeNodes.clear();
+
+	m_Nodes.push_back( { '\0', INVALID_INDEX, INVALID_INDEX, nullptr } );
+}
+
+CCommandTrie::Index_t CCommandTrie::Find( const char* pszString ) const
+{
+	assert( pszString );
+
+	Index_t uiNode = 0;
+
+	for( ; *pszString; ++pszString )
+	{
+		Index_t uiChild = m_Nodes[ uiNode ].uiFirstChild;
+
+		while( uiChild != INVALID_INDEX && m_Nodes[ uiChild ].cChar < *pszString )
+			uiChild = m_Nodes[ uiChild ].uiNextSibling;
+
+		if( uiChild == INVALID_INDEX || m_Nodes[ uiChild ].cChar != *pszString )
+			return INVALID_INDEX;
+
+		uiNode = uiChild;
+	}
+
+	return uiNode;
+}
+}
@@ -0,0 +1,117 @@
+#ifndef CVAR_CCOMMANDTRIE_H
+#define CVAR_CCOMMANDTRIE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace cvar
+{
+class CBaseConCommand;
+
+/**
+*	Prefix trie over command names.
+*	Nodes are stored in a single array, and each node links to its first child and next sibling.
+*	Siblings are sorted, so commands are enumerated in alphabetical order.
+*/
+class CCommandTrie final
+{
+private:
+	typedef uint32_t Index_t;
+
+	static const Index_t INVALID_INDEX = UINT32_MAX;
+
+	struct Node_t
+	{
+		char cChar;
+
+		Index_t uiFirstChild;
+		Index_t uiNextSibling;
+
+		/**
+		*	Command whose name ends at this node, if any.
+		*/
+		CBaseConCommand* pCommand;
+	};
+
+public:
+	CCommandTrie();
+	~CCommandTrie() = default;
+
+	/**
+	*	Adds a command. Replaces any command with the same name.
+	*/
+	void Add( CBaseConCommand* pCommand );
+
+	/**
+	*	Removes the command with the given name, if it exists.
+	*/
+	void Remove( const char* const pszName );
+
+	/**
+	*	Removes all commands.
+	*/
+	void Clear();
+
+	/**
+	*	Calls callback for every command whose name starts with pszPrefix, in alphabetical order.
+	*	Finding the prefix takes time linear in its length; every node visited after that leads to a result.
+	*	@param pszPrefix Prefix to find. An empty prefix enumerates all commands.
+	*	@param callback Callable that takes a CBaseConCommand&, and returns whether to continue enumerating.
+	*/
+	template<typename CALLBACK_FN>
+	void EnumeratePrefix( const char* const pszPrefix, CALLBACK_FN callback ) const;
+
+private:
+	/**
+	*	Finds the node for the given string.
+	*	@return Index of the node, or INVALID_INDEX.
+	*/
+	Index_t Find( const char* pszString ) const;
+
+	template<typename CALLBACK_FN>
+	bool EnumerateSubtree( const Index_t uiNode, CALLBACK_FN& callback ) const;
+
+private:
+	/**
+	*	Node 0 is the root, which represents the empty string.
+	*/
+	std::vector<Node_t> m_Nodes;
+
+	/**
+	*	Nodes that were removed, and can be reused.
+	*/
+	std::vector<Index_t> m_FreeNodes;
+
+private:
+	CCommandTrie( const CCommandTrie& ) = delete;
+	CCommandTrie& operator=( const CCommandTrie& ) = delete;
+};
+
+template<typename CALLBACK_FN>
+void CCommandTrie::EnumeratePrefix( const char* const pszPrefix, CALLBACK_FN callback ) const
+{
+	const Index_t uiNode = Find( pszPrefix );
+
+	if( uiNode != INVALID_INDEX )
+		EnumerateSubtree( uiNode, callback );
+}
+
+template<typename CALLBACK_FN>
+bool CCommandTrie::EnumerateSubtree( const Index_t uiNode, CALLBACK_FN& callback ) const
+{
+	const Node_t& node = m_Nodes[ uiNode ];
+
+	if( node.pCommand && !callback( *node.pCommand ) )
+		return false;
+
+	for( Index_t uiChild = node.uiFirstChild; uiChild != INVALID_INDEX; uiChild = m_Nodes[ uiChild ].uiNextSibling )
+	{
+		if( !EnumerateSubtree( uiChild, callback ) )
+			return false;
+	}
+
+	return true;
+}
+}
+
+#endif //CVAR_CCOMMANDTRIE_H
@@ -0,0 +1,71 @@
+#include <cassert>
+#include <cctype>
+#include <cstring>
+
+#include "CExecFile.h"
+
+namespace cvar
+{
+bool CExecFile::Open( const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	m_uiOffset = 0;
+
+	if( !m_File.Open( pszFilename ) )
+		return false;
+
+	m_szFilename = pszFilename;
+
+	return true;
+}
+
+bool CExecFile::ReadCommand( char* const pszBuffer, const size_t uiBufferSize, bool& bTooLong )
+{
+	assert( pszBuffer );
+	assert( uiBufferSize > 0 );
+
+	bTooLong = false;
+
+	const char* const pszData = static_cast<const char*>( m_File.GetData() );
+	const size_t uiSize = m_File.GetSize();
+
+	while( m_uiOffset < uiSize )
+	{
+		//Skip whitespace and separators.
+		while( m_uiOffset < uiSize && ( isspace( static_cast<unsigned char>( pszData[ m_uiOffset ] ) ) || pszData[ m_uiOffset ] == ';' ) )
+			++m_uiOffset;
+
+		if( m_uiOffset >= uiSize )
+			break;
+
+		const char* const pszCommand = pszData + m_uiOffset;
+
+		//Comments run to the end of the line.
+		const bool bIsComment = m_uiOffset + 1 < uiSize && pszCommand[ 0 ] == '/' && pszCommand[ 1 ] == '/';
+
+		size_t uiLength = 0;
+
+		while( m_uiOffset + uiLength < uiSize && pszCommand[ uiLength ] != '\n' && ( bIsComment || pszCommand[ uiLength ] != ';' ) )
+			++uiLength;
+
+		m_uiOffset += uiLength;
+
+		if( bIsComment )
+			continue;
+
+		if( uiLength >= uiBufferSize )
+		{
+			bTooLong = true;
+			return true;
+		}
+
+		memcpy( pszBuffer, pszCommand, uiLength );
+		pszBuffer[ uiLength ] = '\0';
+
+		return true;
+	}
+
+	return false;
+}
+}
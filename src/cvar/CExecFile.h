@@ -0,0 +1,52 @@
+#ifndef CVAR_CEXECFILE_H
+#define CVAR_CEXECFILE_H
+
+#include <cstddef>
+#include <string>
+
+#include "utility/CMappedFile.h"
+
+namespace cvar
+{
+/**
+*	Config file that is being executed. The file is memory mapped and commands are read from it one at a time,
+*	so there is no limit on the size of the file.
+*	Commands are separated by newlines and semicolons, the same as in the command buffer.
+*/
+class CExecFile final
+{
+public:
+	CExecFile() = default;
+	~CExecFile() = default;
+
+	/**
+	*	Opens the given file.
+	*	@return Whether the file was opened. Empty files cannot be opened.
+	*/
+	bool Open( const char* const pszFilename );
+
+	const std::string& GetFilename() const { return m_szFilename; }
+
+	/**
+	*	Reads the next command. Empty lines and lines starting with // are skipped.
+	*	@param pszBuffer Buffer to store the command in.
+	*	@param uiBufferSize Size of the buffer, including the null terminator.
+	*	@param bTooLong Set to whether the command was too long for the buffer. The command is skipped in that case.
+	*	@return Whether a command was read. false once the end of the file has been reached.
+	*/
+	bool ReadCommand( char* const pszBuffer, const size_t uiBufferSize, bool& bTooLong );
+
+private:
+	CMappedFile m_File;
+
+	std::string m_szFilename;
+
+	size_t m_uiOffset = 0;
+
+private:
+	CExecFile( const CExecFile& ) = delete;
+	CExecFile& operator=( const CExecFile& ) = delete;
+};
+}
+
+#endif //CVAR_CEXECFILE_H
@@ -1,5 +1,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "engine/shared/renderer/CRenderCommandBuffer.h"
+
 #include "CBaseRenderContext.h"
 
 namespace renderer
@@ -48,4 +50,9 @@ void CBaseRenderContext::Ortho( vec_t flLeft, vec_t flRight, vec_t flBottom, vec
 {
 	MultMatrix( glm::ortho( flLeft, flRight, flBottom, flTop, flNear, flFar ) );
 }
+
+void CBaseRenderContext::Submit( const CRenderCommandBuffer& buffer )
+{
+	buffer.Execute( *this );
+}
 }
\ No newline at end of file
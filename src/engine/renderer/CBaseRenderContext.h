@@ -37,6 +37,12 @@ public:
 
 	void Ortho( vec_t flLeft, vec_t flRight, vec_t flBottom, vec_t flTop, vec_t flNear, vec_t flFar ) override;
 
+	void Submit( const CRenderCommandBuffer& buffer ) override;
+
+	const DrawStats_t& GetDrawStats() const override { return m_DrawStats; }
+
+	void ResetDrawStats() override { m_DrawStats.Reset(); }
+
 protected:
 	/**
 	*	Gets the matrix stack for use by subclasses.
@@ -49,12 +55,19 @@ protected:
 	*/
 	CMatrixStack& GetMatrixStack() { return m_MatrixStack; }
 
+	/**
+	*	Stats that subclasses add the work they submit to.
+	*/
+	DrawStats_t& GetMutableDrawStats() { return m_DrawStats; }
+
 private:
 	MatrixMode::MatrixMode m_MatrixMode = MatrixMode::MODEL;
 
 	//Needed for all renderers because our API separates the Model and View matrices.
 	//We need to keep track of them separately so mult operations work in graphics APIs that combine matrices.
 	CMatrixStack m_MatrixStack;
+
+	DrawStats_t m_DrawStats;
 };
 }
 
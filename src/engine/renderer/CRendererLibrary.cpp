@@ -1,13 +1,54 @@
 #include "lib/LibInterface.h"
 
+#include "core/shared/Logging.h"
+
 #include "cvar/CVar.h"
 
+#include "engine/shared/EngineRenderContext.h"
+
+#include "engine/renderer/gl/core/CRenderContextCore.h"
+#include "engine/renderer/gl/imode/CRenderContextIMode.h"
+
 #include "CRendererLibrary.h"
 
 namespace renderer
 {
 REGISTER_SINGLE_INTERFACE( IRENDERERLIBRARY_NAME, CRendererLibrary );
 
+IRenderContext* CRendererLibrary::SelectBackend( const RenderBackend backend )
+{
+	CBaseGLRenderContext* pContext;
+
+	switch( backend )
+	{
+	case RenderBackend::IMMEDIATE:
+		{
+			pContext = GLIModeContext();
+			break;
+		}
+
+	case RenderBackend::CORE:
+		{
+			pContext = GLCoreContext();
+			break;
+		}
+
+	default:
+		{
+			Error( "CRendererLibrary::SelectBackend: Invalid backend \"%d\", using immediate mode\n", static_cast<int>( backend ) );
+			pContext = GLIModeContext();
+			break;
+		}
+	}
+
+	SetGLContext( pContext );
+
+	//This library has its own copy of the shared engine code.
+	engine::SetRenderContext( pContext );
+
+	return pContext;
+}
+
 bool CRendererLibrary::Connect( const CreateInterfaceFn* const pFactories, const size_t uiNumFactories )
 {
 	for( size_t uiIndex = 0; uiIndex < uiNumFactories; ++uiIndex )
@@ -23,10 +64,20 @@ bool CRendererLibrary::Connect( const CreateInterfaceFn* const pFactories, const
 
 	cvar::ConnectCVars();
 
+	//Nothing selected a backend, so use the one that works everywhere.
+	if( !GLContext() )
+		SelectBackend( RenderBackend::IMMEDIATE );
+
 	return true;
 }
 
 void CRendererLibrary::Disconnect()
 {
+	//The context is still current here.
+	if( GLCoreContext()->IsInitialized() )
+		GLCoreContext()->Shutdown();
+
+	engine::SetRenderContext( nullptr );
+	SetGLContext( nullptr );
 }
 }
\ No newline at end of file
@@ -10,6 +10,8 @@ class CRendererLibrary final : public IRendererLibrary
 public:
 	CRendererLibrary() = default;
 
+	IRenderContext* SelectBackend( const RenderBackend backend ) override final;
+
 	bool Connect( const CreateInterfaceFn* const pFactories, const size_t uiNumFactories ) override final;
 
 	void Disconnect() override final;
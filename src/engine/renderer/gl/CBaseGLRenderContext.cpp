@@ -1,13 +1,61 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "core/shared/Logging.h"
+#include "core/shared/Profiler.h"
+
+#include "cvar/CCVar.h"
 
 #include "CBaseGLRenderContext.h"
 
-static_assert( sizeof( renderer::HTexture_t ) == sizeof( GLuint ), "Unsupported handle size!" );
+static_assert( sizeof( renderer::HTexture_t ) >= sizeof( GLuint ), "Unsupported handle size!" );
 
 namespace renderer
 {
+namespace
+{
+static cvar::CCVar r_filterstatechanges( "r_filterstatechanges",
+	cvar::CCVarArgsBuilder()
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to drop render state changes that don't change the current state" ) );
+
+/**
+*	Maximum number of timer queries waiting for results. Timers are skipped while this many are pending,
+*	which only happens if ResolveGPUTimers isn't being called.
+*/
+static const size_t MAX_PENDING_GPU_TIMER_QUERIES = 256;
+
+size_t GetImageFormatChannels( const ImageFormat format )
+{
+	switch( format )
+	{
+	case ImageFormat::RGB:				return 3;
+	case ImageFormat::RGBA:				return 4;
+	case ImageFormat::LUMINANCE_ALPHA:	return 2;
+
+	default:							return 1;
+	}
+}
+
+bool AreGPUTimersSupported()
+{
+	return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+static CBaseGLRenderContext* g_pGLContext = nullptr;
+}
+
+CBaseGLRenderContext* GLContext()
+{
+	return g_pGLContext;
+}
+
+void SetGLContext( CBaseGLRenderContext* pContext )
+{
+	g_pGLContext = pContext;
+}
+
 GLenum ImageFormatToGL( const ImageFormat format )
 {
 	switch( format )
@@ -174,12 +222,21 @@ HTexture_t CBaseGLRenderContext::CreateTexture( const int mipmaps, const ImageFo
 
 	glTexImage2D( GL_TEXTURE_2D, mipmaps, imageFormat, iWidth, iHeight, 0, imageFormat, GL_UNSIGNED_BYTE, pData );
 
+	if( pData )
+		GetMutableDrawStats().uiUploadedBytes += static_cast<uint64_t>( iWidth * iHeight ) * GetImageFormatChannels( format );
+
 	//TODO: error handling.
 
 	//TODO: make this customizable?
 	//TODO: wrong target
 	glTexEnvi( GL_TEXTURE_2D, GL_TEXTURE_ENV_MODE, GL_MODULATE );
 
+	//Callers still bind these with GL directly, so they can't be evicted and restored.
+	if( m_TextureManager.Register( texture, static_cast<size_t>( iWidth * iHeight ) * GetImageFormatChannels( format ), nullptr ) )
+		glBindTexture( GL_TEXTURE_2D, texture );
+
+	m_bTexture2DKnown = false;
+
 	return GLToTexHandle( texture );
 }
 
@@ -190,12 +247,14 @@ void CBaseGLRenderContext::DestroyTexture( HTexture_t hTexture )
 
 	GLuint tex = TexHandleToGL( hTexture );
 
+	m_TextureManager.Unregister( tex );
+
 	glDeleteTextures( 1, &tex );
 }
 
 void CBaseGLRenderContext::BindTexture( HTexture_t hTexture )
 {
-	glBindTexture( GL_TEXTURE_2D, TexHandleToGL( hTexture ) );
+	BindTexture2D( TexHandleToGL( hTexture ) );
 }
 
 void CBaseGLRenderContext::SetMinMagFilters( const MinFilter min, const MagFilter mag )
@@ -203,4 +262,255 @@ void CBaseGLRenderContext::SetMinMagFilters( const MinFilter min, const MagFilte
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilterToGL( min ) );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilterToGL( mag ) );
 }
-}
\ No newline at end of file
+
+void CBaseGLRenderContext::RegisterTexture( HTexture_t hTexture, const size_t uiSizeInBytes, ITextureSource* pSource )
+{
+	//Evicting textures changes the binding.
+	if( m_TextureManager.Register( TexHandleToGL( hTexture ), uiSizeInBytes, pSource ) )
+		m_bTexture2DKnown = false;
+}
+
+void CBaseGLRenderContext::UnregisterTexture( HTexture_t hTexture )
+{
+	m_TextureManager.Unregister( TexHandleToGL( hTexture ) );
+}
+
+void CBaseGLRenderContext::InvalidateState()
+{
+	m_bFilterState = r_filterstatechanges.GetBool();
+
+	for( auto& bKnown : m_bCapKnown )
+	{
+		bKnown = false;
+	}
+
+	m_bBlendFuncKnown = false;
+	m_bDepthMaskKnown = false;
+	m_bAlphaFuncKnown = false;
+	m_bPolygonModeKnown = false;
+	m_bTexture2DKnown = false;
+}
+
+template<typename T>
+bool CBaseGLRenderContext::IsRedundant( bool& bKnown, T& current, const T& value )
+{
+	if( m_bFilterState && bKnown && current == value )
+	{
+		++m_uiFilteredStateChanges;
+		PROFILE_COUNT( "State changes filtered", 1 );
+		return true;
+	}
+
+	bKnown = true;
+	current = value;
+
+	PROFILE_COUNT( "State changes", 1 );
+
+	return false;
+}
+
+void CBaseGLRenderContext::SetEnabled( const GLenum cap, const bool bEnabled )
+{
+	Cap index;
+
+	switch( cap )
+	{
+	case GL_BLEND:		index = Cap::BLEND; break;
+	case GL_ALPHA_TEST:	index = Cap::ALPHA_TEST; break;
+	case GL_DEPTH_TEST:	index = Cap::DEPTH_TEST; break;
+	case GL_CULL_FACE:	index = Cap::CULL_FACE; break;
+	case GL_TEXTURE_2D:	index = Cap::TEXTURE_2D; break;
+
+	default:
+		{
+			if( bEnabled )
+				glEnable( cap );
+			else
+				glDisable( cap );
+
+			return;
+		}
+	}
+
+	const size_t uiIndex = static_cast<size_t>( index );
+
+	if( IsRedundant( m_bCapKnown[ uiIndex ], m_bCapEnabled[ uiIndex ], bEnabled ) )
+		return;
+
+	switch( index )
+	{
+	case Cap::BLEND:		++GetMutableDrawStats().uiBlendChanges; break;
+	case Cap::ALPHA_TEST:	++GetMutableDrawStats().uiAlphaChanges; break;
+	case Cap::DEPTH_TEST:	++GetMutableDrawStats().uiDepthChanges; break;
+	default: break;
+	}
+
+	if( bEnabled )
+		glEnable( cap );
+	else
+		glDisable( cap );
+}
+
+void CBaseGLRenderContext::BlendFunc( const GLenum sfactor, const GLenum dfactor )
+{
+	if( m_bFilterState && m_bBlendFuncKnown && m_BlendFunc[ 0 ] == sfactor && m_BlendFunc[ 1 ] == dfactor )
+	{
+		++m_uiFilteredStateChanges;
+		PROFILE_COUNT( "State changes filtered", 1 );
+		return;
+	}
+
+	PROFILE_COUNT( "State changes", 1 );
+
+	++GetMutableDrawStats().uiBlendChanges;
+
+	m_bBlendFuncKnown = true;
+	m_BlendFunc[ 0 ] = sfactor;
+	m_BlendFunc[ 1 ] = dfactor;
+
+	glBlendFunc( sfactor, dfactor );
+}
+
+void CBaseGLRenderContext::DepthMask( const bool bWrite )
+{
+	if( IsRedundant( m_bDepthMaskKnown, m_bDepthMask, bWrite ) )
+		return;
+
+	++GetMutableDrawStats().uiDepthChanges;
+
+	glDepthMask( bWrite ? GL_TRUE : GL_FALSE );
+}
+
+void CBaseGLRenderContext::AlphaFunc( const GLenum func, const GLclampf ref )
+{
+	if( m_bFilterState && m_bAlphaFuncKnown && m_AlphaFunc == func && m_flAlphaRef == ref )
+	{
+		++m_uiFilteredStateChanges;
+		PROFILE_COUNT( "State changes filtered", 1 );
+		return;
+	}
+
+	PROFILE_COUNT( "State changes", 1 );
+
+	++GetMutableDrawStats().uiAlphaChanges;
+
+	m_bAlphaFuncKnown = true;
+	m_AlphaFunc = func;
+	m_flAlphaRef = ref;
+
+	glAlphaFunc( func, ref );
+}
+
+void CBaseGLRenderContext::PolygonMode( const GLenum mode )
+{
+	if( IsRedundant( m_bPolygonModeKnown, m_PolygonMode, mode ) )
+		return;
+
+	glPolygonMode( GL_FRONT_AND_BACK, mode );
+}
+
+void CBaseGLRenderContext::BindTexture2D( const GLuint texture )
+{
+	if( IsRedundant( m_bTexture2DKnown, m_Texture2D, texture ) )
+		return;
+
+	++GetMutableDrawStats().uiTextureBinds;
+
+	//Restoring and evicting textures binds them, but the texture is bound below either way.
+	if( texture != 0 )
+		m_TextureManager.Use( texture );
+
+	glBindTexture( GL_TEXTURE_2D, texture );
+}
+
+void CBaseGLRenderContext::BeginGPUTimer( const char* const pszName )
+{
+	const size_t uiSeries = profiler::IsEnabled() && AreGPUTimersSupported() ? profiler::RegisterSeries( pszName, profiler::SeriesType::TIME ) : profiler::INVALID_SERIES;
+
+	StopGPUTimerQuery();
+
+	//Always tracked so EndGPUTimer calls match up even if the profiler is toggled in between.
+	m_GPUTimerStack.push_back( uiSeries );
+
+	StartGPUTimerQuery( uiSeries );
+}
+
+void CBaseGLRenderContext::EndGPUTimer()
+{
+	if( m_GPUTimerStack.empty() )
+	{
+		Warning( "CBaseGLRenderContext::EndGPUTimer: No timer was started\n" );
+		return;
+	}
+
+	StopGPUTimerQuery();
+
+	m_GPUTimerStack.pop_back();
+
+	//Resume timing the outer timer.
+	if( !m_GPUTimerStack.empty() )
+		StartGPUTimerQuery( m_GPUTimerStack.back() );
+}
+
+void CBaseGLRenderContext::ResolveGPUTimers()
+{
+	//Queries finish in order, so stop at the first one that hasn't finished.
+	while( !m_PendingGPUTimerQueries.empty() )
+	{
+		const GPUTimerQuery_t& query = m_PendingGPUTimerQueries.front();
+
+		GLint iAvailable = GL_FALSE;
+
+		glGetQueryObjectiv( query.query, GL_QUERY_RESULT_AVAILABLE, &iAvailable );
+
+		if( iAvailable == GL_FALSE )
+			break;
+
+		GLuint64 uiNanoseconds = 0;
+
+		glGetQueryObjectui64v( query.query, GL_QUERY_RESULT, &uiNanoseconds );
+
+		profiler::AddValue( query.uiSeries, static_cast<int64_t>( uiNanoseconds / 1000 ) );
+
+		m_FreeGPUTimerQueries.push_back( query.query );
+
+		m_PendingGPUTimerQueries.pop_front();
+	}
+}
+
+void CBaseGLRenderContext::StartGPUTimerQuery( const size_t uiSeries )
+{
+	if( uiSeries == profiler::INVALID_SERIES || m_PendingGPUTimerQueries.size() >= MAX_PENDING_GPU_TIMER_QUERIES )
+		return;
+
+	GLuint query;
+
+	if( !m_FreeGPUTimerQueries.empty() )
+	{
+		query = m_FreeGPUTimerQueries.back();
+		m_FreeGPUTimerQueries.pop_back();
+	}
+	else
+	{
+		glGenQueries( 1, &query );
+	}
+
+	glBeginQuery( GL_TIME_ELAPSED, query );
+
+	m_bGPUTimerQueryActive = true;
+	m_ActiveGPUTimerQuery.query = query;
+	m_ActiveGPUTimerQuery.uiSeries = uiSeries;
+}
+
+void CBaseGLRenderContext::StopGPUTimerQuery()
+{
+	if( !m_bGPUTimerQueryActive )
+		return;
+
+	glEndQuery( GL_TIME_ELAPSED );
+
+	m_bGPUTimerQueryActive = false;
+
+	m_PendingGPUTimerQueries.push_back( m_ActiveGPUTimerQuery );
+}
+}
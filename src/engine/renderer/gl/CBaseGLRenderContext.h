@@ -1,22 +1,27 @@
 #ifndef ENGINE_RENDERER_GL_CBASEGLRENDERCONTEXT_H
 #define ENGINE_RENDERER_GL_CBASEGLRENDERCONTEXT_H
 
+#include <deque>
+#include <vector>
+
 #include "engine/renderer/CBaseRenderContext.h"
 
 #include "graphics/OpenGL.h"
 
+#include "CGLTextureManager.h"
+
 namespace renderer
 {
 GLenum ImageFormatToGL( const ImageFormat format );
 
 inline HTexture_t GLToTexHandle( const GLuint texture )
 {
-	return reinterpret_cast<HTexture_t>( texture );
+	return NameToTexHandle( texture );
 }
 
 inline GLuint TexHandleToGL( const HTexture_t hTexture )
 {
-	return reinterpret_cast<GLuint>( hTexture );
+	return TexHandleToName( hTexture );
 }
 
 GLenum MinFilterToGL( const MinFilter min );
@@ -55,8 +60,155 @@ public:
 
 	void SetMinMagFilters( const MinFilter min, const MagFilter mag ) override;
 
+	void RegisterTexture( HTexture_t hTexture, const size_t uiSizeInBytes, ITextureSource* pSource ) override;
+
+	void UnregisterTexture( HTexture_t hTexture ) override;
+
+	const CGLTextureManager& GetTextureManager() const { return m_TextureManager; }
+
+	void BeginGPUTimer( const char* const pszName ) override;
+
+	void EndGPUTimer() override;
+
+	void ResolveGPUTimers() override;
+
+	//Shadowed state. Changes that leave the state as it was are dropped before they reach the driver.
+	//Anything that changes this state through GL directly must call InvalidateState before the next shadowed change.
+
+	/**
+	*	Forgets all shadowed state. The next change to each state is always passed on.
+	*/
+	void InvalidateState();
+
+	/**
+	*	Enables or disables a capability. Capabilities that aren't shadowed are always passed on.
+	*/
+	void SetEnabled( const GLenum cap, const bool bEnabled );
+
+	void Enable( const GLenum cap ) { SetEnabled( cap, true ); }
+
+	void Disable( const GLenum cap ) { SetEnabled( cap, false ); }
+
+	void BlendFunc( const GLenum sfactor, const GLenum dfactor );
+
+	void DepthMask( const bool bWrite );
+
+	void AlphaFunc( const GLenum func, const GLclampf ref );
+
+	/**
+	*	Sets the polygon mode of both front and back faces.
+	*/
+	void PolygonMode( const GLenum mode );
+
+	/**
+	*	Binds a 2D texture to the active texture unit. Evicted textures are restored first.
+	*/
+	void BindTexture2D( const GLuint texture );
+
+	/**
+	*	@return The number of state changes that were dropped since the last call to ResetFilteredStateChangeCount.
+	*/
+	size_t GetFilteredStateChangeCount() const { return m_uiFilteredStateChanges; }
+
+	void ResetFilteredStateChangeCount() { m_uiFilteredStateChanges = 0; }
+
 private:
+	/**
+	*	Capabilities that are shadowed.
+	*/
+	enum class Cap
+	{
+		BLEND = 0,
+		ALPHA_TEST,
+		DEPTH_TEST,
+		CULL_FACE,
+		TEXTURE_2D,
+
+		COUNT
+	};
+
+	/**
+	*	@return Whether the given change can be dropped. Updates the shadowed value otherwise.
+	*/
+	template<typename T>
+	bool IsRedundant( bool& bKnown, T& current, const T& value );
+
+	struct GPUTimerQuery_t
+	{
+		GLuint query;
+
+		/**
+		*	Profiler series the result is added to.
+		*/
+		size_t uiSeries;
+	};
+
+	/**
+	*	Starts a query for the given series, if it can be timed.
+	*/
+	void StartGPUTimerQuery( const size_t uiSeries );
+
+	/**
+	*	Ends the active query, if any. Its result is read by ResolveGPUTimers.
+	*/
+	void StopGPUTimerQuery();
+
+private:
+	/**
+	*	Whether state is filtered at all. Read when state is invalidated.
+	*/
+	bool m_bFilterState = true;
+
+	bool m_bCapKnown[ static_cast<size_t>( Cap::COUNT ) ] = {};
+	bool m_bCapEnabled[ static_cast<size_t>( Cap::COUNT ) ] = {};
+
+	bool m_bBlendFuncKnown = false;
+	GLenum m_BlendFunc[ 2 ] = {};
+
+	bool m_bDepthMaskKnown = false;
+	bool m_bDepthMask = true;
+
+	bool m_bAlphaFuncKnown = false;
+	GLenum m_AlphaFunc = GL_ALWAYS;
+	GLclampf m_flAlphaRef = 0;
+
+	bool m_bPolygonModeKnown = false;
+	GLenum m_PolygonMode = GL_FILL;
+
+	bool m_bTexture2DKnown = false;
+	GLuint m_Texture2D = 0;
+
+	size_t m_uiFilteredStateChanges = 0;
+
+	CGLTextureManager m_TextureManager;
+
+	/**
+	*	Series of the timers that have been started, innermost last. Timers that aren't being timed have an invalid series.
+	*	Only one GL_TIME_ELAPSED query can be active at a time, so starting a nested timer ends the outer timer's query,
+	*	and a new query is started for it once the nested timer ends.
+	*/
+	std::vector<size_t> m_GPUTimerStack;
+
+	bool m_bGPUTimerQueryActive = false;
+	GPUTimerQuery_t m_ActiveGPUTimerQuery;
+
+	/**
+	*	Queries that have ended but whose results haven't been read yet, oldest first.
+	*/
+	std::deque<GPUTimerQuery_t> m_PendingGPUTimerQueries;
+
+	std::vector<GLuint> m_FreeGPUTimerQueries;
 };
+
+/**
+*	Accessor for the context that the renderers draw with. Set by the renderer library when a backend is selected.
+*/
+CBaseGLRenderContext* GLContext();
+
+/**
+*	Sets the context that the renderers draw with.
+*/
+void SetGLContext( CBaseGLRenderContext* pContext );
 }
 
 #endif //ENGINE_RENDERER_GL_CBASEGLRENDERCONTEXT_H
\ No newline at end of file
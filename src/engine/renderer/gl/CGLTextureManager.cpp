@@ -0,0 +1,192 @@
+#include "core/shared/Logging.h"
+
+#include "cvar/CCVar.h"
+#include "cvar/CConCommand.h"
+
+#include "CBaseGLRenderContext.h"
+#include "CGLTextureManager.h"
+
+namespace renderer
+{
+namespace
+{
+static cvar::CCVar r_texturebudget( "r_texturebudget",
+	cvar::CCVarArgsBuilder()
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.Flags( cvar::Flag::ARCHIVE )
+	.HelpInfo( "Video memory that textures may use, in megabytes. Textures that haven't been used recently are evicted when it's exceeded. 0 for no budget" ) );
+
+static cvar::CConCommand r_texturestats( "r_texturestats",
+	[]( const util::CCommand& )
+	{
+		if( !GLContext() )
+			return;
+
+		const auto& manager = GLContext()->GetTextureManager();
+		const auto& stats = manager.GetStats();
+
+		const double flMegabyte = 1024 * 1024;
+
+		Message( "%u textures, %u resident using %.2f MB of %.2f MB budget\n",
+				 static_cast<unsigned int>( stats.uiTextures ), static_cast<unsigned int>( stats.uiResidentTextures ),
+				 stats.uiResidentSize / flMegabyte, manager.GetBudget() / flMegabyte );
+
+		Message( "%u evictions, %u restores\n", static_cast<unsigned int>( stats.uiEvictions ), static_cast<unsigned int>( stats.uiRestores ) );
+	},
+	cvar::Flag::NONE, "Prints how much video memory textures are estimated to use" );
+}
+
+bool CGLTextureManager::Register( const GLuint texture, const size_t uiSize, ITextureSource* pSource )
+{
+	if( texture == 0 )
+		return false;
+
+	auto it = m_Textures.find( texture );
+
+	if( it == m_Textures.end() )
+	{
+		it = m_Textures.emplace( texture, Texture_t() ).first;
+
+		++m_Stats.uiTextures;
+		++m_Stats.uiResidentTextures;
+	}
+	else
+	{
+		auto& data = it->second;
+
+		//Registering again means the owner just uploaded it.
+		if( data.bResident )
+		{
+			if( data.pSource )
+				m_LRU.erase( data.lru );
+
+			m_Stats.uiResidentSize -= data.uiSize;
+		}
+		else
+		{
+			data.bResident = true;
+			++m_Stats.uiResidentTextures;
+		}
+	}
+
+	auto& data = it->second;
+
+	data.uiSize = uiSize;
+	data.pSource = pSource;
+
+	m_Stats.uiResidentSize += uiSize;
+
+	if( pSource )
+	{
+		m_LRU.push_front( texture );
+		data.lru = m_LRU.begin();
+	}
+
+	return EnforceBudget( texture );
+}
+
+void CGLTextureManager::Unregister( const GLuint texture )
+{
+	auto it = m_Textures.find( texture );
+
+	if( it == m_Textures.end() )
+		return;
+
+	auto& data = it->second;
+
+	if( data.bResident )
+	{
+		if( data.pSource )
+			m_LRU.erase( data.lru );
+
+		m_Stats.uiResidentSize -= data.uiSize;
+		--m_Stats.uiResidentTextures;
+	}
+
+	--m_Stats.uiTextures;
+
+	m_Textures.erase( it );
+}
+
+bool CGLTextureManager::Use( const GLuint texture )
+{
+	auto it = m_Textures.find( texture );
+
+	if( it == m_Textures.end() )
+		return false;
+
+	auto& data = it->second;
+
+	//Pinned textures don't need to be ordered.
+	if( !data.pSource )
+		return false;
+
+	if( data.bResident )
+	{
+		m_LRU.splice( m_LRU.begin(), m_LRU, data.lru );
+		return false;
+	}
+
+	glBindTexture( GL_TEXTURE_2D, texture );
+
+	if( !data.pSource->RestoreTexture( GLToTexHandle( texture ) ) )
+		Warning( "CGLTextureManager::Use: Couldn't restore texture %u\n", texture );
+
+	data.bResident = true;
+
+	m_LRU.push_front( texture );
+	data.lru = m_LRU.begin();
+
+	m_Stats.uiResidentSize += data.uiSize;
+	++m_Stats.uiResidentTextures;
+	++m_Stats.uiRestores;
+
+	EnforceBudget( texture );
+
+	return true;
+}
+
+size_t CGLTextureManager::GetBudget() const
+{
+	return static_cast<size_t>( r_texturebudget.GetFloat() * 1024 * 1024 );
+}
+
+bool CGLTextureManager::EnforceBudget( const GLuint keep )
+{
+	const size_t uiBudget = GetBudget();
+
+	if( uiBudget == 0 || m_Stats.uiResidentSize <= uiBudget )
+		return false;
+
+	bool bEvicted = false;
+
+	//The texture that's being kept is the most recently used, so it's only reached once everything else has been evicted.
+	while( m_Stats.uiResidentSize > uiBudget && !m_LRU.empty() && m_LRU.back() != keep )
+	{
+		const GLuint texture = m_LRU.back();
+
+		Evict( texture, m_Textures[ texture ] );
+
+		bEvicted = true;
+	}
+
+	return bEvicted;
+}
+
+void CGLTextureManager::Evict( const GLuint texture, Texture_t& data )
+{
+	m_LRU.erase( data.lru );
+
+	glDeleteTextures( 1, &texture );
+
+	//Recreates the texture without storage, so the name isn't handed out by glGenTextures.
+	glBindTexture( GL_TEXTURE_2D, texture );
+
+	data.bResident = false;
+
+	m_Stats.uiResidentSize -= data.uiSize;
+	--m_Stats.uiResidentTextures;
+	++m_Stats.uiEvictions;
+}
+}
@@ -0,0 +1,105 @@
+#ifndef ENGINE_RENDERER_GL_CGLTEXTUREMANAGER_H
+#define ENGINE_RENDERER_GL_CGLTEXTUREMANAGER_H
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "engine/shared/renderer/IRenderContext.h"
+
+#include "graphics/OpenGL.h"
+
+namespace renderer
+{
+/**
+*	Keeps track of how much video memory textures use, and evicts the least recently used textures when they exceed a budget.
+*	Evicted textures are deleted and the name is bound again right away, so the name stays reserved and anything that stored it
+*	keeps working. The texture is restored by its source the next time it's bound.
+*	Requires the compatibility profile, since binding names that weren't generated is an error in the core profile.
+*/
+class CGLTextureManager final
+{
+public:
+	struct Stats_t
+	{
+		size_t uiTextures = 0;
+		size_t uiResidentTextures = 0;
+
+		/**
+		*	Estimated size of all resident textures, in bytes.
+		*/
+		size_t uiResidentSize = 0;
+
+		size_t uiEvictions = 0;
+		size_t uiRestores = 0;
+	};
+
+public:
+	CGLTextureManager() = default;
+	~CGLTextureManager() = default;
+
+	/**
+	*	@see IRenderContext::RegisterTexture
+	*	@return Whether any texture bindings were changed.
+	*/
+	bool Register( const GLuint texture, const size_t uiSize, ITextureSource* pSource );
+
+	/**
+	*	@see IRenderContext::UnregisterTexture
+	*/
+	void Unregister( const GLuint texture );
+
+	/**
+	*	Marks a texture as used. Restores it if it was evicted. Must be called before the texture is bound.
+	*	@return Whether any texture bindings were changed.
+	*/
+	bool Use( const GLuint texture );
+
+	/**
+	*	@return The budget, in bytes. 0 if there is no budget.
+	*/
+	size_t GetBudget() const;
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+private:
+	struct Texture_t
+	{
+		size_t uiSize = 0;
+
+		ITextureSource* pSource = nullptr;
+
+		bool bResident = true;
+
+		/**
+		*	Position in m_LRU. Only valid while the texture is resident and has a source.
+		*/
+		std::list<GLuint>::iterator lru;
+	};
+
+	/**
+	*	Evicts least recently used textures until the resident size is within the budget.
+	*	@param keep Texture that must not be evicted.
+	*	@return Whether any textures were evicted.
+	*/
+	bool EnforceBudget( const GLuint keep );
+
+	void Evict( const GLuint texture, Texture_t& data );
+
+private:
+	std::unordered_map<GLuint, Texture_t> m_Textures;
+
+	/**
+	*	Resident textures that can be evicted, most recently used first.
+	*/
+	std::list<GLuint> m_LRU;
+
+	Stats_t m_Stats;
+
+private:
+	CGLTextureManager( const CGLTextureManager& ) = delete;
+	CGLTextureManager& operator=( const CGLTextureManager& ) = delete;
+};
+}
+
+#endif //ENGINE_RENDERER_GL_CGLTEXTUREMANAGER_H
@@ -0,0 +1,314 @@
+#include <cstddef>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "core/shared/Logging.h"
+#include "core/shared/Profiler.h"
+
+#include "CRenderContextCore.h"
+
+namespace renderer
+{
+namespace
+{
+static CRenderContextCore g_GLCoreContext;
+
+const char* const VERTEX_SHADER =
+"#version 330 core\n"
+"layout( location = 0 ) in vec3 position;\n"
+"layout( location = 1 ) in vec2 texCoord;\n"
+"layout( location = 2 ) in vec4 color;\n"
+"uniform mat4 mvp;\n"
+"out vec2 fragTexCoord;\n"
+"out vec4 fragColor;\n"
+"void main()\n"
+"{\n"
+"	gl_Position = mvp * vec4( position, 1.0 );\n"
+"	fragTexCoord = texCoord;\n"
+"	fragColor = color;\n"
+"}\n";
+
+const char* const COLOR_FRAGMENT_SHADER =
+"#version 330 core\n"
+"in vec2 fragTexCoord;\n"
+"in vec4 fragColor;\n"
+"out vec4 outColor;\n"
+"void main()\n"
+"{\n"
+"	outColor = fragColor;\n"
+"}\n";
+
+const char* const TEXTURED_FRAGMENT_SHADER =
+"#version 330 core\n"
+"in vec2 fragTexCoord;\n"
+"in vec4 fragColor;\n"
+"uniform sampler2D tex;\n"
+"uniform float alphaTestReference;\n"
+"out vec4 outColor;\n"
+"void main()\n"
+"{\n"
+"	vec4 color = texture( tex, fragTexCoord ) * fragColor;\n"
+"	if( alphaTestReference >= 0.0 && color.a <= alphaTestReference )\n"
+"		discard;\n"
+"	outColor = color;\n"
+"}\n";
+
+const char* const FRAGMENT_SHADERS[] =
+{
+	COLOR_FRAGMENT_SHADER,
+	TEXTURED_FRAGMENT_SHADER
+};
+
+static_assert( ARRAYSIZE( FRAGMENT_SHADERS ) == static_cast<size_t>( CRenderContextCore::Program::COUNT ), "Update FRAGMENT_SHADERS" );
+
+/**
+*	Size the vertex stream is created with, in bytes. It grows if a single draw doesn't fit.
+*/
+static const size_t STREAM_SIZE = 1024 * 1024;
+}
+
+CRenderContextCore* GLCoreContext()
+{
+	return &g_GLCoreContext;
+}
+
+void CRenderContextCore::PopMatrix()
+{
+	BaseClass::PopMatrix();
+
+	MatricesChanged();
+}
+
+void CRenderContextCore::LoadIdentity()
+{
+	BaseClass::LoadIdentity();
+
+	MatricesChanged();
+}
+
+void CRenderContextCore::LoadMatrix( const Mat4x4& mat )
+{
+	BaseClass::LoadMatrix( mat );
+
+	MatricesChanged();
+}
+
+void CRenderContextCore::LoadTransposeMatrix( const Mat4x4& mat )
+{
+	BaseClass::LoadTransposeMatrix( mat );
+
+	MatricesChanged();
+}
+
+void CRenderContextCore::MultMatrix( const Mat4x4& mat )
+{
+	BaseClass::MultMatrix( mat );
+
+	MatricesChanged();
+}
+
+void CRenderContextCore::MultTransposeMatrix( const Mat4x4& mat )
+{
+	BaseClass::MultTransposeMatrix( mat );
+
+	MatricesChanged();
+}
+
+bool CRenderContextCore::Initialize()
+{
+	if( m_bInitialized )
+		return true;
+
+	if( m_bInitializeFailed )
+		return false;
+
+	m_bInitializeFailed = true;
+
+	if( !GLEW_VERSION_3_3 )
+	{
+		Error( "CRenderContextCore::Initialize: OpenGL 3.3 is not supported by this OpenGL implementation!\n" );
+		return false;
+	}
+
+	GLint iProfileMask = 0;
+
+	glGetIntegerv( GL_CONTEXT_PROFILE_MASK, &iProfileMask );
+
+	m_bFixedFunction = !( iProfileMask & GL_CONTEXT_CORE_PROFILE_BIT );
+
+	for( size_t uiIndex = 0; uiIndex < ARRAYSIZE( m_Programs ); ++uiIndex )
+	{
+		auto& data = m_Programs[ uiIndex ];
+
+		if( !data.program.Create( VERTEX_SHADER, FRAGMENT_SHADERS[ uiIndex ] ) )
+		{
+			Error( "CRenderContextCore::Initialize: Couldn't create program %u\n", static_cast<unsigned int>( uiIndex ) );
+			Shutdown();
+			return false;
+		}
+
+		data.iMVP = data.program.GetUniformLocation( "mvp" );
+		data.iTexture = data.program.GetUniformLocation( "tex" );
+		data.iAlphaTestReference = data.program.GetUniformLocation( "alphaTestReference" );
+
+		if( data.iTexture != -1 )
+		{
+			data.program.Bind();
+			glUniform1i( data.iTexture, 0 );
+			data.program.Unbind();
+		}
+	}
+
+	glGenVertexArrays( 1, &m_VertexArray );
+
+	glBindVertexArray( m_VertexArray );
+
+	glEnableVertexAttribArray( 0 );
+	glEnableVertexAttribArray( 1 );
+	glEnableVertexAttribArray( 2 );
+
+	glBindVertexArray( 0 );
+
+	m_Stream.Create( STREAM_SIZE );
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	m_AttribBuffer = 0;
+
+	m_bInitializeFailed = false;
+	m_bInitialized = true;
+
+	return true;
+}
+
+void CRenderContextCore::Shutdown()
+{
+	for( auto& data : m_Programs )
+	{
+		data.program.Destroy();
+		data.iMVP = data.iTexture = data.iAlphaTestReference = -1;
+		data.uiMVPRevision = 0;
+	}
+
+	m_Stream.Destroy();
+
+	if( m_VertexArray != 0 )
+	{
+		glDeleteVertexArrays( 1, &m_VertexArray );
+		m_VertexArray = 0;
+	}
+
+	m_AttribBuffer = 0;
+
+	m_bInitialized = false;
+}
+
+Mat4x4 CRenderContextCore::GetModelViewProjection() const
+{
+	const auto& stack = GetMatrixStack();
+
+	//Same order that the immediate mode context combines them in.
+	return stack.GetMatrix( MatrixMode::PROJECTION ) * stack.GetMatrix( MatrixMode::MODEL ) * stack.GetMatrix( MatrixMode::VIEW );
+}
+
+void CRenderContextCore::Draw( const Program program, const GLenum mode, const Vertex_t* const pVertices, const size_t uiCount )
+{
+	if( uiCount == 0 )
+		return;
+
+	if( !pVertices || program >= Program::COUNT )
+	{
+		Error( "CRenderContextCore::Draw: Invalid arguments!\n" );
+		return;
+	}
+
+	if( !Initialize() )
+		return;
+
+	auto& data = m_Programs[ static_cast<size_t>( program ) ];
+
+	const size_t uiSize = uiCount * sizeof( Vertex_t );
+
+	glBindVertexArray( m_VertexArray );
+
+	//Aligned to whole vertices so the offset can be passed as the first vertex, which saves setting up the attributes for every draw.
+	const size_t uiOffset = m_Stream.Upload( pVertices, uiSize, sizeof( Vertex_t ) );
+
+	//The stream is recreated when it grows.
+	if( m_Stream.GetBuffer() != m_AttribBuffer )
+		SetupAttributes();
+
+	data.program.Bind();
+
+	auto& stack = GetMatrixStack();
+
+	if( stack.IsAnyDirty() )
+	{
+		m_MVP = GetModelViewProjection();
+		++m_uiMVPRevision;
+
+		stack.ClearAllDirty();
+	}
+
+	if( data.uiMVPRevision != m_uiMVPRevision )
+	{
+		glUniformMatrix4fv( data.iMVP, 1, GL_FALSE, glm::value_ptr( m_MVP ) );
+		data.uiMVPRevision = m_uiMVPRevision;
+	}
+
+	if( data.iAlphaTestReference != -1 )
+		glUniform1f( data.iAlphaTestReference, m_flAlphaTestReference );
+
+	glDrawArrays( mode, static_cast<GLint>( uiOffset / sizeof( Vertex_t ) ), static_cast<GLsizei>( uiCount ) );
+
+	PROFILE_COUNT( "Draw calls", 1 );
+
+	auto& stats = GetMutableDrawStats();
+
+	++stats.uiDrawCalls;
+	stats.uiVertices += static_cast<uint32_t>( uiCount );
+	stats.uiUploadedBytes += uiSize;
+
+	data.program.Unbind();
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindVertexArray( 0 );
+}
+
+void CRenderContextCore::MatricesChanged()
+{
+	//Lets the first matrix change find out which profile the context has.
+	if( !m_bInitialized && !m_bInitializeFailed && GLEW_VERSION_3_3 )
+		Initialize();
+
+	if( !m_bFixedFunction )
+		return;
+
+	const auto& stack = GetMatrixStack();
+
+	if( GetMatrixMode() == MatrixMode::PROJECTION )
+	{
+		glMatrixMode( GL_PROJECTION );
+		glLoadMatrixf( glm::value_ptr( stack.GetMatrix( MatrixMode::PROJECTION ) ) );
+		glMatrixMode( GL_MODELVIEW );
+	}
+	else
+	{
+		//Model and View need to be combined.
+		const Mat4x4 modelView = stack.GetMatrix( MatrixMode::MODEL ) * stack.GetMatrix( MatrixMode::VIEW );
+
+		glMatrixMode( GL_MODELVIEW );
+		glLoadMatrixf( glm::value_ptr( modelView ) );
+	}
+}
+
+void CRenderContextCore::SetupAttributes()
+{
+	//The vertex array must be bound, and the stream bound to GL_ARRAY_BUFFER.
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex_t ), reinterpret_cast<const void*>( offsetof( Vertex_t, vecPosition ) ) );
+	glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex_t ), reinterpret_cast<const void*>( offsetof( Vertex_t, vecTexCoord ) ) );
+	glVertexAttribPointer( 2, 4, GL_FLOAT, GL_FALSE, sizeof( Vertex_t ), reinterpret_cast<const void*>( offsetof( Vertex_t, vecColor ) ) );
+
+	m_AttribBuffer = m_Stream.GetBuffer();
+}
+}
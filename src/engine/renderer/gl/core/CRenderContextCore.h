@@ -0,0 +1,168 @@
+#ifndef ENGINE_RENDERER_GL_CORE_CRENDERCONTEXTCORE_H
+#define ENGINE_RENDERER_GL_CORE_CRENDERCONTEXTCORE_H
+
+#include "graphics/CGLStreamBuffer.h"
+#include "graphics/GLShaderProgram.h"
+
+#include "engine/renderer/gl/CBaseGLRenderContext.h"
+
+namespace renderer
+{
+/**
+*	OpenGL 3.3 core profile render context. Matrices are kept by the context and passed to its programs as uniforms,
+*	and geometry is drawn from vertex arrays instead of immediate mode calls.
+*
+*	Renderers that haven't been ported to this context still use the fixed function pipeline. As long as the context
+*	has the compatibility profile, matrix changes are also passed to the fixed function pipeline so they keep working.
+*/
+class CRenderContextCore : public CBaseGLRenderContext
+{
+public:
+	typedef CBaseGLRenderContext BaseClass;
+
+	/**
+	*	Programs that geometry can be drawn with.
+	*	Studio models: wireframe, flat and smooth shaded use COLOR, textured uses TEXTURED.
+	*	Sprites: all render modes use TEXTURED. Alpha test and index alpha sprites set an alpha test reference, additive sprites set the blend function.
+	*/
+	enum class Program
+	{
+		/**
+		*	Vertex color only.
+		*/
+		COLOR = 0,
+
+		/**
+		*	Texture modulated by vertex color, with optional alpha testing.
+		*/
+		TEXTURED,
+
+		COUNT
+	};
+
+	/**
+	*	Vertex layout used by all programs.
+	*/
+	struct Vertex_t
+	{
+		glm::vec3 vecPosition;
+		glm::vec2 vecTexCoord;
+		glm::vec4 vecColor;
+	};
+
+public:
+	CRenderContextCore() = default;
+
+	void PopMatrix() override;
+
+	void LoadIdentity() override;
+
+	void LoadMatrix( const Mat4x4& mat ) override;
+
+	void LoadTransposeMatrix( const Mat4x4& mat ) override;
+
+	void MultMatrix( const Mat4x4& mat ) override;
+
+	void MultTransposeMatrix( const Mat4x4& mat ) override;
+
+	/**
+	*	Creates the programs and buffers. Called on first use if needed; the context must be current.
+	*	@return Whether the context is initialized.
+	*/
+	bool Initialize();
+
+	/**
+	*	Destroys the programs and buffers. The context must be current.
+	*/
+	void Shutdown();
+
+	bool IsInitialized() const { return m_bInitialized; }
+
+	/**
+	*	@return The matrix that transforms model space positions to clip space.
+	*/
+	Mat4x4 GetModelViewProjection() const;
+
+	/**
+	*	Sets the alpha value that fragments must exceed to be drawn by the TEXTURED program. Negative values disable alpha testing.
+	*/
+	void SetAlphaTestReference( const float flReference ) { m_flAlphaTestReference = flReference; }
+
+	/**
+	*	Draws the given vertices with the current matrices and the given program.
+	*	Vertices are streamed into a ring buffer that is shared by every draw.
+	*	@param program Program to draw with.
+	*	@param mode Primitive type.
+	*/
+	void Draw( const Program program, const GLenum mode, const Vertex_t* const pVertices, const size_t uiCount );
+
+private:
+	struct ProgramData_t
+	{
+		GLShaderProgram program;
+
+		GLint iMVP = -1;
+		GLint iTexture = -1;
+		GLint iAlphaTestReference = -1;
+
+		/**
+		*	Revision of the matrix that was last passed to this program. 0 if none was.
+		*/
+		size_t uiMVPRevision = 0;
+	};
+
+	/**
+	*	Passes the current matrices to the fixed function pipeline, if it's available.
+	*/
+	void MatricesChanged();
+
+	/**
+	*	Points the vertex attributes at the stream's buffer.
+	*/
+	void SetupAttributes();
+
+private:
+	bool m_bInitialized = false;
+
+	/**
+	*	Whether initialization failed. It isn't retried, so errors are only logged once.
+	*/
+	bool m_bInitializeFailed = false;
+
+	/**
+	*	Whether the context has the compatibility profile, so legacy code can still use the fixed function pipeline.
+	*/
+	bool m_bFixedFunction = true;
+
+	ProgramData_t m_Programs[ static_cast<size_t>( Program::COUNT ) ];
+
+	GLuint m_VertexArray = 0;
+
+	graphics::CGLStreamBuffer m_Stream;
+
+	/**
+	*	Buffer that the vertex attributes were last pointed at.
+	*/
+	GLuint m_AttribBuffer = 0;
+
+	float m_flAlphaTestReference = -1;
+
+	/**
+	*	Model view projection matrix as of the last draw, and how many times it has changed.
+	*	It's only recomputed when the matrix stack reports a change, and only passed to programs that have an older revision.
+	*/
+	Mat4x4 m_MVP;
+	size_t m_uiMVPRevision = 0;
+
+private:
+	CRenderContextCore( const CRenderContextCore& ) = delete;
+	CRenderContextCore& operator=( const CRenderContextCore& ) = delete;
+};
+
+/**
+*	Accessor for the core profile context.
+*/
+CRenderContextCore* GLCoreContext();
+}
+
+#endif //ENGINE_RENDERER_GL_CORE_CRENDERCONTEXTCORE_H
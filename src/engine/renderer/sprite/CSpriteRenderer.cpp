@@ -1,12 +1,19 @@
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <functional>
 
 #include <glm/vec4.hpp>
 
 #include "core/shared/Logging.h"
 
+#include "cvar/CCVar.h"
+
 #include "graphics/OpenGL.h"
 
+#include "engine/renderer/gl/CBaseGLRenderContext.h"
+
 #include "shared/CWorldTime.h"
 
 #include "engine/shared/renderer/sprite/CSpriteRenderInfo.h"
@@ -17,6 +24,88 @@
 
 namespace sprite
 {
+namespace
+{
+cvar::CCVar r_sprite_gpuorientation( "r_sprite_gpuorientation", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, sprites are oriented according to their type on the GPU" ) );
+
+cvar::CCVar r_sprite_gpuanimation( "r_sprite_gpuanimation", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, the frame of animated sprites whose frames share an atlas is picked on the GPU. Requires r_sprite_gpuorientation" ) );
+
+/**
+*	Places sprite quads in the world according to the sprite's type.
+*	The sprite's origin is passed in gl_Vertex, each corner's offset along the sprite's right and up axes in offset.
+*	orientation contains the sprite's angles, and its type in w. The viewer's axes are taken from the model view matrix.
+*	The sprite's up axis is Z for upright types. Upright sprites viewed from straight above or below face the viewer instead.
+*	If the frame rate in animation is non-zero, the frame is picked from the animation's start time, frame rate and start frame in animation,
+*	offset is relative to the frame's size and the texture coordinates select the corner of the frame's rectangle in frameRects.
+*/
+const char* const ORIENTATION_VERTEX_SHADER =
+"#version 120\n"
+"attribute vec2 offset;\n"
+"attribute vec4 orientation;\n"
+"attribute vec4 animation;\n"
+"uniform float time;\n"
+"uniform float frameCount;\n"
+"uniform vec2 atlasSize;\n"
+"uniform vec4 frameRects[ 64 ];\n"
+"void main()\n"
+"{\n"
+"	vec2 cornerOffset = offset;\n"
+"	vec4 texCoord = gl_MultiTexCoord0;\n"
+"	if( animation.y > 0.0 )\n"
+"	{\n"
+"		float frame = mod( floor( animation.z + ( time - animation.x ) * animation.y ), frameCount );\n"
+"		vec4 rect = frameRects[ int( min( frame, frameCount - 1.0 ) ) ];\n"
+"		cornerOffset = offset * ( rect.zw - rect.xy ) * atlasSize;\n"
+"		texCoord = vec4( mix( rect.xy, rect.zw, gl_MultiTexCoord0.xy ), 0.0, 1.0 );\n"
+"	}\n"
+"	vec3 viewRight = normalize( vec3( gl_ModelViewMatrix[ 0 ][ 0 ], gl_ModelViewMatrix[ 1 ][ 0 ], gl_ModelViewMatrix[ 2 ][ 0 ] ) );\n"
+"	vec3 viewUp = normalize( vec3( gl_ModelViewMatrix[ 0 ][ 1 ], gl_ModelViewMatrix[ 1 ][ 1 ], gl_ModelViewMatrix[ 2 ][ 1 ] ) );\n"
+"	vec3 viewForward = -normalize( vec3( gl_ModelViewMatrix[ 0 ][ 2 ], gl_ModelViewMatrix[ 1 ][ 2 ], gl_ModelViewMatrix[ 2 ][ 2 ] ) );\n"
+"	vec3 angles = radians( orientation.xyz );\n"
+"	int type = int( orientation.w + 0.5 );\n"
+"	vec3 right = viewRight;\n"
+"	vec3 up = viewUp;\n"
+"	if( type == 0 || type == 1 )\n"
+"	{\n"
+"		vec3 forward = type == 0 ? viewForward : gl_Vertex.xyz - gl_ModelViewMatrixInverse[ 3 ].xyz;\n"
+"		vec3 horizontalRight = vec3( forward.y, -forward.x, 0.0 );\n"
+"		if( length( horizontalRight ) > 0.001 )\n"
+"		{\n"
+"			right = normalize( horizontalRight );\n"
+"			up = vec3( 0.0, 0.0, 1.0 );\n"
+"		}\n"
+"	}\n"
+"	else if( type == 3 )\n"
+"	{\n"
+"		vec3 s = sin( angles );\n"
+"		vec3 c = cos( angles );\n"
+"		right = vec3( -s.z * s.x * c.y + c.z * s.y, -s.z * s.x * s.y - c.z * c.y, -s.z * c.x );\n"
+"		up = vec3( c.z * s.x * c.y + s.z * s.y, c.z * s.x * s.y - s.z * c.y, c.z * c.x );\n"
+"	}\n"
+"	else if( type == 4 )\n"
+"	{\n"
+"		float sr = sin( angles.z );\n"
+"		float cr = cos( angles.z );\n"
+"		right = viewRight * cr + viewUp * sr;\n"
+"		up = viewUp * cr - viewRight * sr;\n"
+"	}\n"
+"	gl_Position = gl_ModelViewProjectionMatrix * vec4( gl_Vertex.xyz + right * cornerOffset.x + up * cornerOffset.y, 1.0 );\n"
+"	gl_FrontColor = gl_Color;\n"
+"	gl_TexCoord[ 0 ] = texCoord;\n"
+"}\n";
+
+static_assert( Type::VP_PARALLEL_UPRIGHT == 0 && Type::FACING_UPRIGHT == 1 && Type::VP_PARALLEL == 2 && Type::ORIENTED == 3 && Type::VP_PARALLEL_ORIENTED == 4,
+			   "Update the sprite types in ORIENTATION_VERTEX_SHADER" );
+
+/**
+*	Render state goes through the context so redundant changes are dropped.
+*/
+renderer::CBaseGLRenderContext& GLState()
+{
+	return *renderer::GLContext();
+}
+}
+
 REGISTER_SINGLE_INTERFACE( ISPRITERENDERER_NAME, CSpriteRenderer );
 
 const float CSpriteRenderer::DEFAULT_FRAMERATE = 10;
@@ -49,20 +138,17 @@ void CSpriteRenderer::DrawSprite( const CSpriteRenderInfo* pRenderInfo, const re
 		return;
 	}
 
-	const auto& framedesc = pSprite->frames[ static_cast<int>( pRenderInfo->flFrame ) ];
-	//TODO: get correct frame when it's a group.
-	const auto& frame = framedesc.frameptr;
+	const float flFrame = GetRenderInfoFrame( pRenderInfo );
 
-	const sprite::Type::Type* pTypeOverride = pRenderInfo->bOverrideType ? &pRenderInfo->type : nullptr;
+	const mspriteframe_t* const pFrame = GetSpriteFrame( pSprite, flFrame );
 
-	DrawSprite( pRenderInfo->vecOrigin, { frame->width, frame->height }, pSprite, pRenderInfo->flFrame, flags, pTypeOverride );
+	DrawSprite( pRenderInfo->vecOrigin, { pFrame->width, pFrame->height }, pSprite, flFrame, flags, pRenderInfo );
 }
 
 void CSpriteRenderer::DrawSprite2D( const float flX, const float flY, const float flWidth, const float flHeight, const msprite_t* pSprite, const renderer::DrawFlags_t flags )
 {
 	const float flFrame = static_cast<float>( fmod( WorldTime.GetCurrentTime() * DEFAULT_FRAMERATE, pSprite->numframes ) );
 
-	//TODO: calculate frame
 	DrawSprite( { flX, flY, 0 }, { flWidth, flHeight }, pSprite, flFrame, flags );
 }
 
@@ -70,35 +156,86 @@ void CSpriteRenderer::DrawSprite2D( const float flX, const float flY, const mspr
 {
 	assert( pSprite );
 
-	const int iFrame = static_cast<int>( fmod( WorldTime.GetCurrentTime() * DEFAULT_FRAMERATE, pSprite->numframes ) );
+	const float flFrame = static_cast<float>( fmod( WorldTime.GetCurrentTime() * DEFAULT_FRAMERATE, pSprite->numframes ) );
+
+	const mspriteframe_t* const pFrame = GetSpriteFrame( pSprite, flFrame );
 
-	//TODO: calculate frame
-	const auto& framedesc = pSprite->frames[ iFrame ];
-	
-	mspriteframe_t* pFrame;
+	DrawSprite2D( flX, flY, static_cast<float>( pFrame->width * flScale ), static_cast<float>( pFrame->height * flScale ), pSprite, flags );
+}
 
-	if( framedesc.type == spriteframetype_t::SINGLE )
+void CSpriteRenderer::DrawSprite2D( const C2DSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags )
+{
+	assert( pRenderInfo );
+
+	if( !pRenderInfo )
 	{
-		pFrame = framedesc.frameptr;
+		Error( "CSpriteRenderer::DrawSprite2D: Null render info!\n" );
+		return;
 	}
-	else
+
+	const auto pSprite = pRenderInfo->pSprite;
+
+	assert( pSprite );
+
+	if( !pSprite )
 	{
-		auto pGroup = framedesc.GetGroup();
+		Error( "CSpriteRenderer::DrawSprite2D: Null sprite!\n" );
+		return;
+	}
+
+	const mspriteframe_t* const pFrame = GetSpriteFrame( pSprite, pRenderInfo->flFrame );
+
+	const sprite::TexFormat::TexFormat* pTexFormatOverride = pRenderInfo->bOverrideTexFormat ? &pRenderInfo->texFormat : nullptr;
+
+	DrawSprite( glm::vec3( pRenderInfo->vecPos, 0 ), 
+				glm::vec2( pRenderInfo->vecScale.x * pFrame->width, pRenderInfo->vecScale.y * pFrame->height ), 
+				pRenderInfo->pSprite, pRenderInfo->flFrame, flags, nullptr, pTexFormatOverride );
+}
+
+void CSpriteRenderer::BeginBatch()
+{
+	assert( !m_bBatching );
 
-		//TODO: get correct frame.
-		pFrame = pGroup->frames[ 0 ];
+	m_bBatching = true;
+
+	m_Batch.clear();
+	m_BatchVertices.clear();
+}
+
+void CSpriteRenderer::AddSprite( const CSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags )
+{
+	assert( pRenderInfo );
+
+	if( !pRenderInfo )
+	{
+		Error( "CSpriteRenderer::AddSprite: Null render info!\n" );
+		return;
 	}
 
-	DrawSprite2D( flX, flY, static_cast<float>( pFrame->width * flScale ), static_cast<float>( pFrame->height * flScale ), pSprite, flags );
+	const auto pSprite = pRenderInfo->pSprite;
+
+	assert( pSprite );
+
+	if( !pSprite )
+	{
+		Error( "CSpriteRenderer::AddSprite: Null sprite!\n" );
+		return;
+	}
+
+	const float flFrame = GetRenderInfoFrame( pRenderInfo );
+
+	const mspriteframe_t* const pFrame = GetSpriteFrame( pSprite, flFrame );
+
+	AddSprite( pRenderInfo->vecOrigin, { pFrame->width, pFrame->height }, pSprite, flFrame, flags, pRenderInfo );
 }
 
-void CSpriteRenderer::DrawSprite2D( const C2DSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags )
+void CSpriteRenderer::AddSprite2D( const C2DSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags )
 {
 	assert( pRenderInfo );
 
 	if( !pRenderInfo )
 	{
-		Error( "CSpriteRenderer::DrawSprite2D: Null render info!\n" );
+		Error( "CSpriteRenderer::AddSprite2D: Null render info!\n" );
 		return;
 	}
 
@@ -108,78 +245,276 @@ void CSpriteRenderer::DrawSprite2D( const C2DSpriteRenderInfo* pRenderInfo, cons
 
 	if( !pSprite )
 	{
-		Error( "CSpriteRenderer::DrawSprite2D: Null sprite!\n" );
+		Error( "CSpriteRenderer::AddSprite2D: Null sprite!\n" );
 		return;
 	}
 
-	const auto& framedesc = pSprite->frames[ static_cast<int>( pRenderInfo->flFrame ) ];
+	const mspriteframe_t* const pFrame = GetSpriteFrame( pSprite, pRenderInfo->flFrame );
+
+	const sprite::TexFormat::TexFormat* pTexFormatOverride = pRenderInfo->bOverrideTexFormat ? &pRenderInfo->texFormat : nullptr;
+
+	AddSprite( glm::vec3( pRenderInfo->vecPos, 0 ),
+			   glm::vec2( pRenderInfo->vecScale.x * pFrame->width, pRenderInfo->vecScale.y * pFrame->height ),
+			   pSprite, pRenderInfo->flFrame, flags, nullptr, pTexFormatOverride );
+}
+
+void CSpriteRenderer::Flush()
+{
+	if( !m_bBatching )
+		return;
+
+	m_bBatching = false;
+
+	if( m_Batch.empty() )
+		return;
+
+	//State may have been changed outside the renderer since the last draw.
+	GLState().InvalidateState();
+
+	std::stable_sort( m_Batch.begin(), m_Batch.end(),
+		[]( const BatchedSprite_t& lhs, const BatchedSprite_t& rhs )
+		{
+			if( lhs.textureId != rhs.textureId )
+				return lhs.textureId < rhs.textureId;
+
+			if( lhs.texFormat != rhs.texFormat )
+				return lhs.texFormat < rhs.texFormat;
+
+			if( lhs.flags != rhs.flags )
+				return lhs.flags < rhs.flags;
 
-	mspriteframe_t* pFrame;
+			if( lhs.bOriented != rhs.bOriented )
+				return lhs.bOriented < rhs.bOriented;
+
+			return std::less<const msprite_t*>()( lhs.pAnimatedSprite, rhs.pAnimatedSprite );
+		}
+	);
 
-	if( framedesc.type == spriteframetype_t::SINGLE )
+	m_SortedVertices.resize( m_BatchVertices.size() );
+
+	for( size_t uiIndex = 0; uiIndex < m_Batch.size(); ++uiIndex )
 	{
-		pFrame = framedesc.frameptr;
+		std::copy_n( m_BatchVertices.data() + m_Batch[ uiIndex ].uiFirstVertex, VERTICES_PER_SPRITE, m_SortedVertices.data() + uiIndex * VERTICES_PER_SPRITE );
 	}
-	else
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+
+	//Each run of sprites with the same state is drawn at once.
+	for( size_t uiFirst = 0; uiFirst < m_Batch.size(); )
 	{
-		auto pGroup = framedesc.GetGroup();
+		const BatchedSprite_t& first = m_Batch[ uiFirst ];
+
+		size_t uiEnd = uiFirst + 1;
+
+		while( uiEnd < m_Batch.size() &&
+			   m_Batch[ uiEnd ].textureId == first.textureId &&
+			   m_Batch[ uiEnd ].texFormat == first.texFormat &&
+			   m_Batch[ uiEnd ].flags == first.flags &&
+			   m_Batch[ uiEnd ].bOriented == first.bOriented &&
+			   m_Batch[ uiEnd ].pAnimatedSprite == first.pAnimatedSprite )
+		{
+			++uiEnd;
+		}
+
+		SetupTexFormat( first.textureId, first.texFormat );
 
-		//TODO: get correct frame.
-		pFrame = pGroup->frames[ 0 ];
+		DrawVertices( m_SortedVertices.data() + uiFirst * VERTICES_PER_SPRITE, ( uiEnd - uiFirst ) * VERTICES_PER_SPRITE, first.flags, first.bOriented, first.pAnimatedSprite );
+
+		uiFirst = uiEnd;
 	}
 
-	const sprite::TexFormat::TexFormat* pTexFormatOverride = pRenderInfo->bOverrideTexFormat ? &pRenderInfo->texFormat : nullptr;
+	glDisableClientState( GL_VERTEX_ARRAY );
 
-	DrawSprite( glm::vec3( pRenderInfo->vecPos, 0 ), 
-				glm::vec2( pRenderInfo->vecScale.x * pFrame->width, pRenderInfo->vecScale.y * pFrame->height ), 
-				pRenderInfo->pSprite, pRenderInfo->flFrame, flags, nullptr, pTexFormatOverride );
+	m_Batch.clear();
+	m_BatchVertices.clear();
+}
+
+void CSpriteRenderer::Shutdown()
+{
+	m_VertexStream.Destroy();
+
+	m_OrientationProgram.Destroy();
+
+	m_iOffsetAttrib = -1;
+	m_iOrientationAttrib = -1;
+	m_iAnimationAttrib = -1;
+
+	m_iTimeUniform = -1;
+	m_iFrameCountUniform = -1;
+	m_iAtlasSizeUniform = -1;
+	m_iFrameRectsUniform = -1;
+
+	m_bOrientationInitialized = false;
 }
 
 void CSpriteRenderer::DrawSprite( const glm::vec3& vecOrigin, const glm::vec2& vecSize, 
 								  const msprite_t* pSprite, const float flFrame, 
-								  const renderer::DrawFlags_t flags, const sprite::Type::Type* pTypeOverride, const sprite::TexFormat::TexFormat* pTexFormatOverride )
+								  const renderer::DrawFlags_t flags, const CSpriteRenderInfo* pRenderInfo, const sprite::TexFormat::TexFormat* pTexFormatOverride )
 {
 	assert( pSprite );
 
-	const auto& framedesc = pSprite->frames[ static_cast<int>( floor( flFrame ) ) ];
+	const mspriteframe_t* const pFrame = GetSpriteFrame( pSprite, flFrame );
 
-	mspriteframe_t* pFrame;
+	//State may have been changed outside the renderer since the last draw.
+	GLState().InvalidateState();
 
-	if( framedesc.type == spriteframetype_t::SINGLE )
+	//TODO: set up the sprite's orientation in the world when the orientation program isn't available.
+
+	const sprite::TexFormat::TexFormat texFormat = pTexFormatOverride ? *pTexFormatOverride : pSprite->texFormat;
+
+	SetupTexFormat( pFrame->gl_texturenum, texFormat );
+
+	BatchVertex_t vertices[ VERTICES_PER_SPRITE ];
+
+	const bool bOriented = pRenderInfo && ShouldUseGPUOrientation();
+
+	const msprite_t* const pAnimatedSprite = bOriented && ShouldUseGPUAnimation( pRenderInfo ) ? pSprite : nullptr;
+
+	if( pAnimatedSprite )
+	{
+		BuildAnimatedQuad( pRenderInfo, pRenderInfo->bOverrideType ? pRenderInfo->type : pSprite->type, vertices );
+	}
+	else if( bOriented )
+	{
+		BuildOrientedQuad( vecOrigin, vecSize, pFrame, pRenderInfo->bOverrideType ? pRenderInfo->type : pSprite->type, pRenderInfo->vecAngles, vertices );
+	}
+	else
+	{
+		BuildQuad( vecOrigin, vecSize, pFrame, vertices );
+	}
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+
+	DrawVertices( vertices, VERTICES_PER_SPRITE, flags, bOriented, pAnimatedSprite );
+
+	glDisableClientState( GL_VERTEX_ARRAY );
+}
+
+void CSpriteRenderer::AddSprite( const glm::vec3& vecOrigin, const glm::vec2& vecSize, 
+								 const msprite_t* pSprite, const float flFrame, 
+								 const renderer::DrawFlags_t flags, const CSpriteRenderInfo* pRenderInfo, const sprite::TexFormat::TexFormat* pTexFormatOverride )
+{
+	assert( pSprite );
+
+	if( !m_bBatching )
+	{
+		DrawSprite( vecOrigin, vecSize, pSprite, flFrame, flags, pRenderInfo, pTexFormatOverride );
+		return;
+	}
+
+	const mspriteframe_t* const pFrame = GetSpriteFrame( pSprite, flFrame );
+
+	BatchedSprite_t batched;
+
+	batched.textureId = pFrame->gl_texturenum;
+	batched.texFormat = pTexFormatOverride ? *pTexFormatOverride : pSprite->texFormat;
+	batched.flags = flags;
+	batched.bOriented = pRenderInfo && ShouldUseGPUOrientation();
+	batched.pAnimatedSprite = batched.bOriented && ShouldUseGPUAnimation( pRenderInfo ) ? pSprite : nullptr;
+	batched.uiFirstVertex = m_BatchVertices.size();
+
+	m_BatchVertices.resize( m_BatchVertices.size() + VERTICES_PER_SPRITE );
+
+	//All frames are in the same texture, so animated sprites in the batch don't need to be split up by frame.
+	if( batched.pAnimatedSprite )
+	{
+		BuildAnimatedQuad( pRenderInfo, pRenderInfo->bOverrideType ? pRenderInfo->type : pSprite->type, m_BatchVertices.data() + batched.uiFirstVertex );
+	}
+	else if( batched.bOriented )
 	{
-		pFrame = framedesc.frameptr;
+		BuildOrientedQuad( vecOrigin, vecSize, pFrame, pRenderInfo->bOverrideType ? pRenderInfo->type : pSprite->type, pRenderInfo->vecAngles,
+						   m_BatchVertices.data() + batched.uiFirstVertex );
 	}
 	else
 	{
-		auto pGroup = framedesc.GetGroup();
+		BuildQuad( vecOrigin, vecSize, pFrame, m_BatchVertices.data() + batched.uiFirstVertex );
+	}
 
-		float* pflIntervals = pGroup->intervals;
+	m_Batch.push_back( batched );
+}
 
-		double flInt;
+bool CSpriteRenderer::ShouldUseGPUOrientation()
+{
+	if( !r_sprite_gpuorientation.GetBool() )
+		return false;
 
-		const float flFraction = static_cast<float>( modf( flFrame, &flInt ) );
+	if( !m_bOrientationInitialized )
+	{
+		m_bOrientationInitialized = true;
 
-		int iIndex;
+		if( !GLEW_VERSION_2_0 )
+			return false;
 
-		for( iIndex = 0; iIndex < ( pGroup->numframes - 1 ); ++iIndex )
+		if( m_OrientationProgram.Create( ORIENTATION_VERTEX_SHADER, nullptr ) )
 		{
-			if( pflIntervals[ iIndex ] > flFraction )
-				break;
+			m_iOffsetAttrib = m_OrientationProgram.GetAttribLocation( "offset" );
+			m_iOrientationAttrib = m_OrientationProgram.GetAttribLocation( "orientation" );
+			m_iAnimationAttrib = m_OrientationProgram.GetAttribLocation( "animation" );
+
+			m_iTimeUniform = m_OrientationProgram.GetUniformLocation( "time" );
+			m_iFrameCountUniform = m_OrientationProgram.GetUniformLocation( "frameCount" );
+			m_iAtlasSizeUniform = m_OrientationProgram.GetUniformLocation( "atlasSize" );
+			m_iFrameRectsUniform = m_OrientationProgram.GetUniformLocation( "frameRects" );
+
+			if( m_iOffsetAttrib == -1 || m_iOrientationAttrib == -1 || m_iAnimationAttrib == -1 ||
+				m_iTimeUniform == -1 || m_iFrameCountUniform == -1 || m_iAtlasSizeUniform == -1 || m_iFrameRectsUniform == -1 )
+			{
+				Error( "CSpriteRenderer: Orientation program is missing vertex attributes or uniforms, orienting sprites is disabled\n" );
+				m_OrientationProgram.Destroy();
+			}
 		}
+	}
+
+	return m_OrientationProgram.Exists();
+}
+
+bool CSpriteRenderer::ShouldUseGPUAnimation( const CSpriteRenderInfo* pRenderInfo )
+{
+	if( !r_sprite_gpuanimation.GetBool() || pRenderInfo->flFrameRate <= 0 )
+		return false;
+
+	const msprite_t* const pSprite = pRenderInfo->pSprite;
+
+	return pSprite->singleatlas && pSprite->numframes <= MAX_GPU_ANIMATION_FRAMES && ShouldUseGPUOrientation();
+}
+
+float CSpriteRenderer::GetRenderInfoFrame( const CSpriteRenderInfo* pRenderInfo )
+{
+	if( pRenderInfo->flFrameRate <= 0 )
+		return pRenderInfo->flFrame;
+
+	return GetAnimatedFrame( pRenderInfo->pSprite, pRenderInfo->flFrame, pRenderInfo->flFrameRate, WorldTime.GetCurrentTime() - pRenderInfo->flAnimStartTime );
+}
+
+void CSpriteRenderer::SetupGPUAnimation( const msprite_t* pSprite )
+{
+	assert( pSprite->singleatlas && pSprite->numframes <= MAX_GPU_ANIMATION_FRAMES );
 
-		assert( iIndex >= 0 );
+	glm::vec4 frameRects[ MAX_GPU_ANIMATION_FRAMES ];
 
-		pFrame = pGroup->frames[ iIndex ];
+	for( int iFrame = 0; iFrame < pSprite->numframes; ++iFrame )
+	{
+		const mspriteframe_t* const pFrame = pSprite->frames[ iFrame ].GetFrame();
+
+		frameRects[ iFrame ] = glm::vec4( pFrame->smin, pFrame->tmin, pFrame->smax, pFrame->tmax );
 	}
 
-	glEnable( GL_TEXTURE_2D );
-	glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
-	glBindTexture( GL_TEXTURE_2D, pFrame->gl_texturenum );
+	//Frame sizes are derived from their rectangles, so only the atlas size is needed.
+	const mspriteframe_t* const pFirstFrame = pSprite->frames[ 0 ].GetFrame();
 
-	//TODO: set up the sprite's orientation in the world according to its type.
-	//TODO: the size of the sprite should change based on its distance from the viewer.
+	glUniform1f( m_iTimeUniform, static_cast<float>( WorldTime.GetCurrentTime() ) );
+	glUniform1f( m_iFrameCountUniform, static_cast<float>( pSprite->numframes ) );
+	glUniform2f( m_iAtlasSizeUniform, pFirstFrame->width / ( pFirstFrame->smax - pFirstFrame->smin ), pFirstFrame->height / ( pFirstFrame->tmax - pFirstFrame->tmin ) );
+	glUniform4fv( m_iFrameRectsUniform, pSprite->numframes, &frameRects[ 0 ].x );
 
-	const sprite::TexFormat::TexFormat texFormat = pTexFormatOverride ? *pTexFormatOverride : pSprite->texFormat;
+	m_DrawStats.uiUploadedBytes += pSprite->numframes * sizeof( glm::vec4 );
+}
+
+void CSpriteRenderer::SetupTexFormat( const GLuint textureId, const sprite::TexFormat::TexFormat texFormat )
+{
+	GLState().Enable( GL_TEXTURE_2D );
+	glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
+	GLState().BindTexture2D( textureId );
 
 	switch( texFormat )
 	{
@@ -187,83 +522,190 @@ void CSpriteRenderer::DrawSprite( const glm::vec3& vecOrigin, const glm::vec2& v
 	case TexFormat::SPR_NORMAL:
 		{
 			glTexEnvi( GL_TEXTURE_2D, GL_TEXTURE_ENV_MODE, GL_MODULATE );
-			glDisable( GL_BLEND );
+			GLState().Disable( GL_BLEND );
 			break;
 		}
 
 	case TexFormat::SPR_ADDITIVE:
 		{
-			glEnable( GL_BLEND );
-			glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+			GLState().Enable( GL_BLEND );
+			GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE );
 			break;
 		}
 
 	case TexFormat::SPR_INDEXALPHA:
 	case TexFormat::SPR_ALPHTEST:
 		{
-			glEnable( GL_BLEND );
-			glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+			GLState().Enable( GL_BLEND );
+			GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 			break;
 		}
 	}
 
 	if( texFormat == TexFormat::SPR_ALPHTEST )
 	{
-		glEnable( GL_ALPHA_TEST );
-		glAlphaFunc( GL_GREATER, 0.0f );
+		GLState().Enable( GL_ALPHA_TEST );
+		GLState().AlphaFunc( GL_GREATER, 0.0f );
 	}
 	else
 	{
-		glDisable( GL_ALPHA_TEST );
+		GLState().Disable( GL_ALPHA_TEST );
 	}
+}
 
+void CSpriteRenderer::BuildQuad( const glm::vec3& vecOrigin, const glm::vec2& vecSize, const mspriteframe_t* pFrame, BatchVertex_t* pVertices )
+{
 	const glm::vec4 vecRect{ vecOrigin.x - vecSize.x / 2, vecOrigin.y - vecSize.y / 2, vecOrigin.x + vecSize.x / 2, vecOrigin.y + vecSize.y / 2 };
 
-	if( !( flags & renderer::DrawFlag::NODRAW ) )
+	//Unoriented, unanimated sprites don't use the other attributes.
+	const glm::vec2 vecOffset( 0 );
+	const glm::vec4 vecUnused( 0 );
+
+	const BatchVertex_t corners[ 4 ] =
 	{
-		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
-		glEnable( GL_TEXTURE_2D );
-		glEnable( GL_CULL_FACE );
-		glEnable( GL_DEPTH_TEST );
-		glShadeModel( GL_SMOOTH );
-		glColor4f( 1, 1, 1, 1 );
+		{ { vecRect.x, vecRect.y, vecOrigin.z }, { pFrame->smin, pFrame->tmin }, vecOffset, vecUnused, vecUnused },
+		{ { vecRect.z, vecRect.y, vecOrigin.z }, { pFrame->smax, pFrame->tmin }, vecOffset, vecUnused, vecUnused },
+		{ { vecRect.x, vecRect.w, vecOrigin.z }, { pFrame->smin, pFrame->tmax }, vecOffset, vecUnused, vecUnused },
+		{ { vecRect.z, vecRect.w, vecOrigin.z }, { pFrame->smax, pFrame->tmax }, vecOffset, vecUnused, vecUnused }
+	};
+
+	//Same triangles and winding as a strip of the 4 corners.
+	pVertices[ 0 ] = corners[ 0 ];
+	pVertices[ 1 ] = corners[ 1 ];
+	pVertices[ 2 ] = corners[ 2 ];
+	pVertices[ 3 ] = corners[ 2 ];
+	pVertices[ 4 ] = corners[ 1 ];
+	pVertices[ 5 ] = corners[ 3 ];
+}
+
+void CSpriteRenderer::BuildOrientedQuad( const glm::vec3& vecOrigin, const glm::vec2& vecSize, const mspriteframe_t* pFrame,
+										   const sprite::Type::Type type, const glm::vec3& vecAngles, BatchVertex_t* pVertices )
+{
+	const glm::vec2 vecHalfSize = vecSize / 2.0f;
+
+	const glm::vec4 vecOrientation( vecAngles, static_cast<float>( type ) );
+
+	//A frame rate of 0 tells the program that the sprite isn't animated on the GPU.
+	const glm::vec4 vecAnimation( 0 );
 
-		glBegin( GL_TRIANGLE_STRIP );
+	//The top of the frame is at tmin, so it's at the top of the sprite's up axis.
+	const BatchVertex_t corners[ 4 ] =
+	{
+		{ vecOrigin, { pFrame->smin, pFrame->tmax }, { -vecHalfSize.x, -vecHalfSize.y }, vecOrientation, vecAnimation },
+		{ vecOrigin, { pFrame->smax, pFrame->tmax }, { vecHalfSize.x, -vecHalfSize.y }, vecOrientation, vecAnimation },
+		{ vecOrigin, { pFrame->smin, pFrame->tmin }, { -vecHalfSize.x, vecHalfSize.y }, vecOrientation, vecAnimation },
+		{ vecOrigin, { pFrame->smax, pFrame->tmin }, { vecHalfSize.x, vecHalfSize.y }, vecOrientation, vecAnimation }
+	};
+
+	pVertices[ 0 ] = corners[ 0 ];
+	pVertices[ 1 ] = corners[ 1 ];
+	pVertices[ 2 ] = corners[ 2 ];
+	pVertices[ 3 ] = corners[ 2 ];
+	pVertices[ 4 ] = corners[ 1 ];
+	pVertices[ 5 ] = corners[ 3 ];
+}
 
-		glTexCoord2f( 0, 0 );
-		glVertex3f( vecRect.x, vecRect.y, vecOrigin.z );
+void CSpriteRenderer::BuildAnimatedQuad( const CSpriteRenderInfo* pRenderInfo, const sprite::Type::Type type, BatchVertex_t* pVertices )
+{
+	const glm::vec3 vecOrigin( pRenderInfo->vecOrigin );
 
-		glTexCoord2f( 1, 0 );
-		glVertex3f( vecRect.z, vecRect.y, vecOrigin.z );
+	const glm::vec4 vecOrientation( pRenderInfo->vecAngles, static_cast<float>( type ) );
 
-		glTexCoord2f( 0, 1 );
-		glVertex3f( vecRect.x, vecRect.w, vecOrigin.z );
+	const glm::vec4 vecAnimation( static_cast<float>( pRenderInfo->flAnimStartTime ), pRenderInfo->flFrameRate, pRenderInfo->flFrame, 0 );
 
-		glTexCoord2f( 1, 1 );
-		glVertex3f( vecRect.z, vecRect.w, vecOrigin.z );
+	//Same corners as BuildOrientedQuad; the program scales them by the frame's size and maps them onto the frame's rectangle.
+	const BatchVertex_t corners[ 4 ] =
+	{
+		{ vecOrigin, { 0, 1 }, { -0.5f, -0.5f }, vecOrientation, vecAnimation },
+		{ vecOrigin, { 1, 1 }, { 0.5f, -0.5f }, vecOrientation, vecAnimation },
+		{ vecOrigin, { 0, 0 }, { -0.5f, 0.5f }, vecOrientation, vecAnimation },
+		{ vecOrigin, { 1, 0 }, { 0.5f, 0.5f }, vecOrientation, vecAnimation }
+	};
+
+	pVertices[ 0 ] = corners[ 0 ];
+	pVertices[ 1 ] = corners[ 1 ];
+	pVertices[ 2 ] = corners[ 2 ];
+	pVertices[ 3 ] = corners[ 2 ];
+	pVertices[ 4 ] = corners[ 1 ];
+	pVertices[ 5 ] = corners[ 3 ];
+}
 
-		glEnd();
+void CSpriteRenderer::DrawVertices( const BatchVertex_t* pVertices, const size_t uiCount, const renderer::DrawFlags_t flags, const bool bOriented,
+									const msprite_t* pAnimatedSprite )
+{
+	//Leaves the stream bound, so attribute pointers are offsets into it.
+	const size_t uiOffset = m_VertexStream.Upload( pVertices, uiCount * sizeof( BatchVertex_t ), sizeof( BatchVertex_t ) );
+
+	m_DrawStats.uiUploadedBytes += uiCount * sizeof( BatchVertex_t );
+
+	auto attribute = [ = ]( const size_t uiMemberOffset )
+	{
+		return reinterpret_cast<const void*>( uiOffset + uiMemberOffset );
+	};
+
+	glVertexPointer( 3, GL_FLOAT, sizeof( BatchVertex_t ), attribute( offsetof( BatchVertex_t, vecPosition ) ) );
+
+	if( bOriented )
+	{
+		m_OrientationProgram.Bind();
+
+		glEnableVertexAttribArray( m_iOffsetAttrib );
+		glVertexAttribPointer( m_iOffsetAttrib, 2, GL_FLOAT, GL_FALSE, sizeof( BatchVertex_t ), attribute( offsetof( BatchVertex_t, vecOffset ) ) );
+
+		glEnableVertexAttribArray( m_iOrientationAttrib );
+		glVertexAttribPointer( m_iOrientationAttrib, 4, GL_FLOAT, GL_FALSE, sizeof( BatchVertex_t ), attribute( offsetof( BatchVertex_t, vecOrientation ) ) );
+
+		glEnableVertexAttribArray( m_iAnimationAttrib );
+		glVertexAttribPointer( m_iAnimationAttrib, 4, GL_FLOAT, GL_FALSE, sizeof( BatchVertex_t ), attribute( offsetof( BatchVertex_t, vecAnimation ) ) );
+
+		if( pAnimatedSprite )
+			SetupGPUAnimation( pAnimatedSprite );
 	}
 
-	if( flags & renderer::DrawFlag::WIREFRAME_OVERLAY )
+	if( !( flags & renderer::DrawFlag::NODRAW ) )
 	{
-		glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
-		glDisable( GL_TEXTURE_2D );
-		glDisable( GL_CULL_FACE );
-		glDisable( GL_DEPTH_TEST );
+		GLState().PolygonMode( GL_FILL );
+		GLState().Enable( GL_TEXTURE_2D );
+		GLState().Enable( GL_CULL_FACE );
+		GLState().Enable( GL_DEPTH_TEST );
+		glShadeModel( GL_SMOOTH );
 		glColor4f( 1, 1, 1, 1 );
 
-		glBegin( GL_TRIANGLE_STRIP );
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( BatchVertex_t ), attribute( offsetof( BatchVertex_t, vecTexCoord ) ) );
+
+		glDrawArrays( GL_TRIANGLES, 0, static_cast<GLsizei>( uiCount ) );
+
+		++m_DrawStats.uiDrawCalls;
+		m_DrawStats.uiVertices += static_cast<uint32_t>( uiCount );
 
-		glVertex3f( vecRect.x, vecRect.y, vecOrigin.z );
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	}
+
+	if( flags & renderer::DrawFlag::WIREFRAME_OVERLAY )
+	{
+		GLState().PolygonMode( GL_LINE );
+		GLState().Disable( GL_TEXTURE_2D );
+		GLState().Disable( GL_CULL_FACE );
+		GLState().Disable( GL_DEPTH_TEST );
+		glColor4f( 1, 1, 1, 1 );
 
-		glVertex3f( vecRect.z, vecRect.y, vecOrigin.z );
+		glDrawArrays( GL_TRIANGLES, 0, static_cast<GLsizei>( uiCount ) );
 
-		glVertex3f( vecRect.x, vecRect.w, vecOrigin.z );
+		++m_DrawStats.uiDrawCalls;
+		m_DrawStats.uiVertices += static_cast<uint32_t>( uiCount );
+	}
 
-		glVertex3f( vecRect.z, vecRect.w, vecOrigin.z );
+	if( bOriented )
+	{
+		glDisableVertexAttribArray( m_iOffsetAttrib );
+		glDisableVertexAttribArray( m_iOrientationAttrib );
+		glDisableVertexAttribArray( m_iAnimationAttrib );
 
-		glEnd();
+		m_OrientationProgram.Unbind();
 	}
+
+	//Code that still uses client side arrays needs no buffer bound.
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
 }
-}
\ No newline at end of file
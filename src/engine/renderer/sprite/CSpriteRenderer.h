@@ -1,22 +1,83 @@
 #ifndef ENGINE_SHARED_SPRITE_CSPRITERENDERER_H
 #define ENGINE_SHARED_SPRITE_CSPRITERENDERER_H
 
+#include <vector>
+
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include "graphics/OpenGL.h"
+#include "graphics/CGLStreamBuffer.h"
+#include "graphics/GLShaderProgram.h"
+
 #include "engine/shared/renderer/DrawConstants.h"
+#include "engine/shared/renderer/DrawStats.h"
+
+#include "engine/shared/sprite/sprite.h"
 
 #include "engine/shared/renderer/sprite/ISpriteRenderer.h"
 
 namespace sprite
 {
-struct msprite_t;
-
 class CSpriteRenderer final : public ISpriteRenderer
 {
 private:
 	static const float DEFAULT_FRAMERATE;
 
+	/**
+	*	Each sprite is drawn as 2 triangles.
+	*/
+	static const size_t VERTICES_PER_SPRITE = 6;
+
+	/**
+	*	Largest number of frames that a sprite animated on the GPU can have. Must match the size of frameRects in ORIENTATION_VERTEX_SHADER.
+	*/
+	static const int MAX_GPU_ANIMATION_FRAMES = 64;
+
+	struct BatchVertex_t
+	{
+		glm::vec3 vecPosition;
+		glm::vec2 vecTexCoord;
+
+		/**
+		*	Oriented sprites only. vecPosition is the sprite's origin, and this is the corner's position relative to it along the sprite's right and up axes.
+		*/
+		glm::vec2 vecOffset;
+
+		/**
+		*	Oriented sprites only. The sprite's angles, and its type in w.
+		*/
+		glm::vec4 vecOrientation;
+
+		/**
+		*	Sprites animated on the GPU only. The animation's start time, frame rate and start frame. The frame rate is 0 for other sprites.
+		*	vecOffset is then the corner's position relative to the frame's size, and vecTexCoord selects the corner of the frame's rectangle.
+		*/
+		glm::vec4 vecAnimation;
+	};
+
+	/**
+	*	A sprite in the current batch. Its vertices are stored separately.
+	*/
+	struct BatchedSprite_t
+	{
+		GLuint textureId;
+		sprite::TexFormat::TexFormat texFormat;
+		renderer::DrawFlags_t flags;
+
+		/**
+		*	Whether the vertices are oriented by the orientation program.
+		*/
+		bool bOriented;
+
+		/**
+		*	If not null, the sprite whose frame the orientation program picks for these vertices.
+		*/
+		const msprite_t* pAnimatedSprite;
+
+		size_t uiFirstVertex;
+	};
+
 public:
 	CSpriteRenderer();
 	~CSpriteRenderer();
@@ -29,11 +90,118 @@ public:
 
 	void DrawSprite2D( const C2DSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags = renderer::DrawFlag::NONE ) override;
 
+	void BeginBatch() override;
+
+	void AddSprite( const CSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags ) override;
+
+	void AddSprite2D( const C2DSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags = renderer::DrawFlag::NONE ) override;
+
+	void Flush() override;
+
+	const renderer::DrawStats_t& GetDrawStats() const override { return m_DrawStats; }
+
+	void ResetDrawStats() override { m_DrawStats.Reset(); }
+
+	void Shutdown() override;
+
 private:
 
+	/**
+	*	Draws a sprite.
+	*	@param pRenderInfo If not null, the sprite is oriented in the world according to its type and angles. Otherwise it's drawn flat, facing the Z axis.
+	*/
 	void DrawSprite( const glm::vec3& vecOrigin, const glm::vec2& vecSize, 
 					 const msprite_t* pSprite, const float flFrame, 
-					 const renderer::DrawFlags_t flags, const sprite::Type::Type* pTypeOverride = nullptr, const sprite::TexFormat::TexFormat* pTexFormatOverride = nullptr );
+					 const renderer::DrawFlags_t flags, const CSpriteRenderInfo* pRenderInfo = nullptr, const sprite::TexFormat::TexFormat* pTexFormatOverride = nullptr );
+
+	/**
+	*	Adds a sprite to the current batch, or draws it if there is no batch.
+	*	@see DrawSprite
+	*/
+	void AddSprite( const glm::vec3& vecOrigin, const glm::vec2& vecSize, 
+					const msprite_t* pSprite, const float flFrame, 
+					const renderer::DrawFlags_t flags, const CSpriteRenderInfo* pRenderInfo = nullptr, const sprite::TexFormat::TexFormat* pTexFormatOverride = nullptr );
+
+	/**
+	*	@return Whether sprites should be oriented by the orientation program. Creates the program the first time it's needed.
+	*/
+	bool ShouldUseGPUOrientation();
+
+	/**
+	*	@return Whether the frame of the given sprite should be picked by the orientation program.
+	*	Only sprites whose frames are all in one atlas can be, since the texture can't change in the middle of a draw.
+	*/
+	bool ShouldUseGPUAnimation( const CSpriteRenderInfo* pRenderInfo );
+
+	/**
+	*	@return Frame to show for the given render info, taking its animation into account.
+	*/
+	static float GetRenderInfoFrame( const CSpriteRenderInfo* pRenderInfo );
+
+	/**
+	*	Uploads the frame rectangles of a sprite animated on the GPU. The orientation program must be bound.
+	*/
+	void SetupGPUAnimation( const msprite_t* pSprite );
+
+	/**
+	*	Sets up texture, blending and alpha testing for the given texture format.
+	*/
+	static void SetupTexFormat( const GLuint textureId, const sprite::TexFormat::TexFormat texFormat );
+
+	/**
+	*	Writes the triangles of a sprite quad.
+	*/
+	static void BuildQuad( const glm::vec3& vecOrigin, const glm::vec2& vecSize, const mspriteframe_t* pFrame, BatchVertex_t* pVertices );
+
+	/**
+	*	Writes the triangles of a sprite quad that the orientation program places in the world.
+	*/
+	static void BuildOrientedQuad( const glm::vec3& vecOrigin, const glm::vec2& vecSize, const mspriteframe_t* pFrame,
+								   const sprite::Type::Type type, const glm::vec3& vecAngles, BatchVertex_t* pVertices );
+
+	/**
+	*	Writes the triangles of a sprite quad whose frame and size the orientation program picks from the animation.
+	*/
+	static void BuildAnimatedQuad( const CSpriteRenderInfo* pRenderInfo, const sprite::Type::Type type, BatchVertex_t* pVertices );
+
+	/**
+	*	Draws a range of vertices from the given array. The vertices are streamed into m_VertexStream first.
+	*	@param bOriented Whether to draw the vertices using the orientation program.
+	*	@param pAnimatedSprite If not null, the sprite whose frames the orientation program picks.
+	*/
+	void DrawVertices( const BatchVertex_t* pVertices, const size_t uiCount, const renderer::DrawFlags_t flags, const bool bOriented,
+					   const msprite_t* pAnimatedSprite = nullptr );
+
+private:
+	bool m_bBatching = false;
+
+	/**
+	*	Vertex program that orients sprites according to their type.
+	*/
+	GLShaderProgram m_OrientationProgram;
+
+	GLint m_iOffsetAttrib = -1;
+	GLint m_iOrientationAttrib = -1;
+	GLint m_iAnimationAttrib = -1;
+
+	GLint m_iTimeUniform = -1;
+	GLint m_iFrameCountUniform = -1;
+	GLint m_iAtlasSizeUniform = -1;
+	GLint m_iFrameRectsUniform = -1;
+
+	bool m_bOrientationInitialized = false;
+
+	std::vector<BatchedSprite_t> m_Batch;
+	std::vector<BatchVertex_t> m_BatchVertices;
+
+	/**
+	*	Batch vertices in draw order.
+	*/
+	std::vector<BatchVertex_t> m_SortedVertices;
+
+	graphics::CGLStreamBuffer m_VertexStream;
+
+	renderer::DrawStats_t m_DrawStats;
 
 private:
 	CSpriteRenderer( const CSpriteRenderer& ) = delete;
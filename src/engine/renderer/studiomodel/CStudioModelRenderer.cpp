@@ -1,8 +1,14 @@
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/transform.hpp>
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
 
 #include "shared/Logging.h"
+#include "shared/Perf.h"
+#include "shared/Profiler.h"
+#include "shared/Trace.h"
 
 #include "lib/LibInterface.h"
 
@@ -11,7 +17,10 @@
 
 #include "graphics/GraphicsUtils.h"
 
+#include "engine/renderer/gl/CBaseGLRenderContext.h"
+
 #include "shared/studiomodel/CStudioModel.h"
+#include "shared/studiomodel/StudioKernels.h"
 #include "shared/renderer/studiomodel/IStudioModelRendererListener.h"
 #include "StudioSorting.h"
 
@@ -29,10 +38,172 @@ cvar::CCVar g_ShowStudioNormals( "r_showstudionormals", cvar::CCVarArgsBuilder()
 //TODO: this is temporary until lighting can be moved somewhere else
 
 DEFINE_COLOR_CVAR( , r_lighting, 255, 255, 255, "Lighting", cvar::CCVarArgsBuilder().Flags( cvar::Flag::ARCHIVE ).Callback( cvar::ColorCVarChanged ) );
+cvar::CCVar r_studio_vbo( "r_studio_vbo", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, studio model meshes are drawn from retained vertex buffers. Set to 0 to use immediate mode" ) );
+
+cvar::CCVar r_studio_gpuskinning( "r_studio_gpuskinning", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, studio model vertices are transformed on the GPU. Requires r_studio_vbo" ) );
+
+cvar::CCVar r_studio_renderqueue( "r_studio_renderqueue", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, meshes of all models in a view are sorted by render pass and texture before drawing. Requires r_studio_vbo" ) );
+
+cvar::CCVar r_studio_instancing( "r_studio_instancing", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, many instances of the same model are drawn with a single draw call per mesh. Requires r_studio_vbo" ) );
+
+cvar::CCVar r_studio_posecache( "r_studio_posecache", cvar::CCVarArgsBuilder().FloatValue( 8 ).MinValue( 0 ).MaxValue( 64 ).HelpInfo( "Number of model poses to keep so unchanged models don't need their bones set up again. 0 disables the cache" ) );
+
+cvar::CCVar r_studio_reusevertices( "r_studio_reusevertices", cvar::CCVarArgsBuilder().FloatValue( 1 ).HelpInfo( "If non-zero, transformed vertices, lighting and chrome are reused by later passes and frames that draw the same pose with the same light and view" ) );
+
+cvar::CCVar r_studio_cull( "r_studio_cull", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, models whose sequence bounding box is outside the view are not drawn" ) );
+
+cvar::CCVar r_studio_simd( "r_studio_simd", cvar::CCVarArgsBuilder().FloatValue( 1 ).HelpInfo( "If non-zero, CPU vertex transformation and lighting use SIMD kernels when supported" ) );
+
+cvar::CCVar r_studio_lod( "r_studio_lod", cvar::CCVarArgsBuilder().FloatValue( 1 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "If non-zero, models that are small on screen are drawn with simplified meshes. Requires r_studio_vbo" ) );
+
+cvar::CCVar r_studio_lodbias( "r_studio_lodbias", cvar::CCVarArgsBuilder().FloatValue( 0 ).Flags( cvar::Flag::ARCHIVE ).HelpInfo( "Detail level bias. Each unit halves (positive) or doubles (negative) the screen size at which simplified meshes are used" ) );
+
+cvar::CCVar r_studio_lodforce( "r_studio_lodforce", cvar::CCVarArgsBuilder().FloatValue( -1 ).MinValue( -1 ).MaxValue( studiomdl::STUDIO_LOD_COUNT - 1 ).HelpInfo( "If not -1, all models are drawn with this detail level" ) );
+
+cvar::CCVar r_studio_lightinglut( "r_studio_lightinglut", cvar::CCVarArgsBuilder().FloatValue( 1 ).HelpInfo( "If non-zero, CPU lighting looks up each normal's intensity in a table built once per model" ) );
+
 DEFINE_COLOR_CVAR( , r_wireframecolor, 255, 0, 0, "Wireframe overlay color", cvar::CCVarArgsBuilder().Flags( cvar::Flag::ARCHIVE ).Callback( cvar::ColorCVarChanged ) );
 
 namespace studiomdl
 {
+namespace
+{
+/**
+*	Render state goes through the context so redundant changes are dropped.
+*/
+renderer::CBaseGLRenderContext& GLState()
+{
+	return *renderer::GLContext();
+}
+
+/**
+*	Models whose bounding sphere has a smaller radius on screen than this, in pixels, use the next detail level.
+*/
+const float LOD_SCREEN_RADII[ STUDIO_LOD_COUNT - 1 ] = { 96, 40 };
+
+/**
+*	@return The same transform DrawModel builds on the matrix stack.
+*/
+glm::mat4 ComputeModelTransform( const CModelRenderInfo& renderInfo, const renderer::DrawFlags_t flags )
+{
+	auto origin = renderInfo.vecOrigin;
+
+	if( flags & renderer::DrawFlag::IS_VIEW_MODEL )
+	{
+		origin.z -= 1;
+	}
+
+	return 
+		glm::translate( origin ) * 
+		glm::rotate( glm::radians( renderInfo.vecAngles[ 1 ] ), glm::vec3( 0, 0, 1 ) ) * 
+		glm::rotate( glm::radians( renderInfo.vecAngles[ 0 ] ), glm::vec3( 0, 1, 0 ) ) * 
+		glm::rotate( glm::radians( renderInfo.vecAngles[ 2 ] ), glm::vec3( 1, 0, 0 ) ) * 
+		glm::scale( renderInfo.vecScale );
+}
+
+/**
+*	Skins vertices using the bone palette. The bone index is passed in the w component of the vertex.
+*	positionScale and positionOrigin map the positions of compact vertices to model space; float vertices use a scale of 1 and an origin of 0.
+*	The fragment stage is left to the fixed function pipeline.
+*/
+const char* const SKINNING_VERTEX_SHADER =
+"#version 120\n"
+"uniform vec4 bones[ 128 * 3 ];\n"
+"uniform vec3 positionScale;\n"
+"uniform vec3 positionOrigin;\n"
+"void main()\n"
+"{\n"
+"	int iBone = int( gl_Vertex.w ) * 3;\n"
+"	vec4 vecPosition = vec4( gl_Vertex.xyz * positionScale + positionOrigin, 1.0 );\n"
+"	vec3 vecSkinned = vec3( dot( bones[ iBone ], vecPosition ), dot( bones[ iBone + 1 ], vecPosition ), dot( bones[ iBone + 2 ], vecPosition ) );\n"
+"	gl_Position = gl_ModelViewProjectionMatrix * vec4( vecSkinned, 1.0 );\n"
+"	gl_FrontColor = gl_Color;\n"
+"	gl_TexCoord[ 0 ] = gl_MultiTexCoord0;\n"
+"}\n";
+
+static_assert( MAXSTUDIOBONES == 128, "Update the bone palette size in SKINNING_VERTEX_SHADER" );
+
+/**
+*	Draws instances of a model. Each instance is stored in the instances buffer as 3 rows of its transform,
+*	a texel holding its transparency and then its bone palette, 3 rows per bone.
+*	Vertices are skinned, lit and chromed the same way the CPU path does it; the fragment stage is left to the fixed function pipeline.
+*	The bone index is passed in the w component of the vertex and the normal's bone index in the first component of texture coordinate 1.
+*	Positions are mapped to model space the same way SKINNING_VERTEX_SHADER does it. If compactNormals is set,
+*	normals are octahedral encoded in the other 2 components of texture coordinate 1 instead of being passed as the normal.
+*	lighting contains the ambient, shade and lambert values. lightingMode is 0 for normal lighting, 1 for flatshade, 2 for fullbright and 3 for additive.
+*/
+const char* const INSTANCING_VERTEX_SHADER =
+"#version 120\n"
+"#extension GL_ARB_draw_instanced : require\n"
+"#extension GL_EXT_gpu_shader4 : require\n"
+"uniform samplerBuffer instances;\n"
+"uniform int instanceStride;\n"
+"uniform int firstInstance;\n"
+"uniform vec3 lightvec;\n"
+"uniform vec3 lightcolor;\n"
+"uniform vec3 lighting;\n"
+"uniform int lightingMode;\n"
+"uniform bool chrome;\n"
+"uniform vec3 viewerOrigin;\n"
+"uniform vec3 viewerRight;\n"
+"uniform vec2 texScale;\n"
+"uniform vec3 positionScale;\n"
+"uniform vec3 positionOrigin;\n"
+"uniform bool compactNormals;\n"
+"vec3 Transform( int iMatrix, vec4 vecValue )\n"
+"{\n"
+"	return vec3( dot( texelFetchBuffer( instances, iMatrix ), vecValue ), dot( texelFetchBuffer( instances, iMatrix + 1 ), vecValue ), dot( texelFetchBuffer( instances, iMatrix + 2 ), vecValue ) );\n"
+"}\n"
+"vec3 GetNormal()\n"
+"{\n"
+"	if( !compactNormals ) return gl_Normal;\n"
+"	vec2 vecEncoded = gl_MultiTexCoord1.yz / 32767.0;\n"
+"	vec3 vecNormal = vec3( vecEncoded, 1.0 - abs( vecEncoded.x ) - abs( vecEncoded.y ) );\n"
+"	if( vecNormal.z < 0.0 ) vecNormal.xy = ( 1.0 - abs( vecEncoded.yx ) ) * vec2( vecEncoded.x >= 0.0 ? 1.0 : -1.0, vecEncoded.y >= 0.0 ? 1.0 : -1.0 );\n"
+"	return normalize( vecNormal );\n"
+"}\n"
+"void main()\n"
+"{\n"
+"	int iInstance = ( firstInstance + gl_InstanceIDARB ) * instanceStride;\n"
+"	int iBone = iInstance + 4 + int( gl_Vertex.w ) * 3;\n"
+"	int iNormalBone = iInstance + 4 + int( gl_MultiTexCoord1.x ) * 3;\n"
+"	vec3 vecSkinned = Transform( iBone, vec4( gl_Vertex.xyz * positionScale + positionOrigin, 1.0 ) );\n"
+"	gl_Position = gl_ModelViewProjectionMatrix * vec4( Transform( iInstance, vec4( vecSkinned, 1.0 ) ), 1.0 );\n"
+"	vec3 vecNormal = Transform( iNormalBone, vec4( GetNormal(), 0.0 ) );\n"
+"	vec3 illum = vec3( 1.0 );\n"
+"	if( lightingMode < 2 )\n"
+"	{\n"
+"		illum = vec3( lighting.x + lighting.y * 0.8 );\n"
+"		if( lightingMode == 0 )\n"
+"		{\n"
+"			float lightcos = ( min( dot( vecNormal, lightvec ), 1.0 ) + ( lighting.z - 1.0 ) ) / lighting.z;\n"
+"			illum = vec3( lighting.x + lighting.y );\n"
+"			if( lightcos > 0.0 ) illum -= lightcos * lighting.y;\n"
+"			illum = max( illum, vec3( 0.0 ) );\n"
+"		}\n"
+"		float flMax = max( illum.x, max( illum.y, illum.z ) );\n"
+"		if( flMax > 1.0 ) illum /= flMax;\n"
+"		illum *= lightcolor;\n"
+"	}\n"
+"	gl_FrontColor = vec4( illum, texelFetchBuffer( instances, iInstance + 3 ).x );\n"
+"	vec2 vecTexCoord = gl_MultiTexCoord0.xy;\n"
+"	if( chrome )\n"
+"	{\n"
+"		vec3 vecBoneOrigin = vec3( texelFetchBuffer( instances, iNormalBone ).w, texelFetchBuffer( instances, iNormalBone + 1 ).w, texelFetchBuffer( instances, iNormalBone + 2 ).w );\n"
+"		vec3 vecDir = normalize( vecBoneOrigin - viewerOrigin );\n"
+"		vec3 vecUp = normalize( cross( vecDir, -viewerRight ) );\n"
+"		vec3 vecRight = normalize( cross( vecDir, vecUp ) );\n"
+"		vecTexCoord = vec2( dot( vecNormal, vecRight ) + 1.0, dot( vecNormal, -vecUp ) + 1.0 ) * 32.0;\n"
+"	}\n"
+"	gl_TexCoord[ 0 ] = vec4( vecTexCoord * texScale, 0.0, 1.0 );\n"
+"}\n";
+
+/**
+*	Number of texels stored for each instance before its bone palette.
+*/
+const size_t INSTANCE_HEADER_TEXELS = 4;
+}
+
 REGISTER_SINGLE_INTERFACE( ISTUDIOMODELRENDERER_NAME, CStudioModelRenderer );
 
 CStudioModelRenderer::CStudioModelRenderer()
@@ -47,21 +218,82 @@ bool CStudioModelRenderer::Initialize()
 {
 	m_uiModelsDrawnCount = 0;
 
+	m_uiModelsCulledCount = 0;
+
 	m_uiDrawnPolygonsCount = 0;
 
+	m_uiStateChangesSavedCount = 0;
+
+	m_DrawStats.Reset();
+
 	return true;
 }
 
 void CStudioModelRenderer::Shutdown()
 {
+	m_VertexStream.Destroy();
+
+	StudioVertices_t().swap( m_MeshVertexData );
+
+	std::vector<CachedPose_t>().swap( m_PoseCache );
+
+	m_bQueueing = false;
+	std::vector<QueuedMesh_t>().swap( m_RenderQueue );
+	StudioVertices_t().swap( m_QueuedVertexData );
+	std::vector<glm::mat3x4>().swap( m_QueuedBones );
+
+	m_SkinningProgram.Destroy();
+	m_iBonesUniform = -1;
+	m_iPositionScaleUniform = -1;
+	m_iPositionOriginUniform = -1;
+	m_bSkinningInitialized = false;
+
+	if( m_InstanceTexture != 0 )
+	{
+		glDeleteTextures( 1, &m_InstanceTexture );
+		m_InstanceTexture = 0;
+	}
+
+	if( m_InstanceBuffer != 0 )
+	{
+		glDeleteBuffers( 1, &m_InstanceBuffer );
+		m_InstanceBuffer = 0;
+	}
+
+	std::vector<glm::vec4>().swap( m_InstanceData );
+	std::vector<size_t>().swap( m_InstanceOrder );
+
+	std::vector<PreparedSubModel_t>().swap( m_PreparedSubModels );
+
+	std::vector<ChromeVectors_t>().swap( m_ChromeVectors );
+	m_pChromeVectors = nullptr;
+
+	m_InstancingProgram.Destroy();
+	m_InstancingUniforms = InstancingUniforms_t();
+	m_iMaxInstanceTexels = 0;
+	m_bInstancingInitialized = false;
 }
 
 void CStudioModelRenderer::RunFrame()
 {
+	//Model data can be edited between frames, so nothing prepared in an earlier frame is reused.
+	++m_uiFrameCount;
 }
 
 unsigned int CStudioModelRenderer::DrawModel( studiomdl::CModelRenderInfo* const pRenderInfo, const renderer::DrawFlags_t flags )
 {
+	return DrawModel( pRenderInfo, nullptr, flags );
+}
+
+unsigned int CStudioModelRenderer::DrawPosedModel( CModelRenderInfo* const pRenderInfo, CStudioPoseContext& poseContext, const renderer::DrawFlags_t flags )
+{
+	return DrawModel( pRenderInfo, &poseContext, flags );
+}
+
+unsigned int CStudioModelRenderer::DrawModel( CModelRenderInfo* const pRenderInfo, CStudioPoseContext* pPoseContext, const renderer::DrawFlags_t flags )
+{
+	PERF_SCOPE( "DrawModel" );
+
 	if( !pRenderInfo )
 	{
 		Error( "CStudioModelRenderer::DrawModel: Called with null render info!\n" );
@@ -83,12 +315,44 @@ unsigned int CStudioModelRenderer::DrawModel( studiomdl::CModelRenderInfo* const
 
 	++m_uiModelsDrawnCount; // render data cache cookie
 
-	m_pxformverts = &m_xformverts[ 0 ];
-	m_pvlightvalues = &m_lightvalues[ 0 ];
+	//State may have been changed outside the renderer since the last draw.
+	GLState().InvalidateState();
+
+	//A pose made for another model can't be used.
+	if( pPoseContext && pPoseContext->GetStudioHeader() != m_pStudioHdr )
+	{
+		Warning( "CStudioModelRenderer::DrawModel: Pose context was set up for a different model!\n" );
+		pPoseContext = nullptr;
+	}
 
 	if( m_pStudioHdr->numbodyparts == 0 )
 		return 0;
 
+	if( r_studio_cull.GetBool() )
+	{
+		glm::vec4 planes[ graphics::FRUSTUM_PLANE_COUNT ];
+
+		graphics::GetCurrentFrustumPlanes( planes );
+
+		if( !IsModelVisible( *m_pRenderInfo, pPoseContext, planes, flags ) )
+		{
+			++m_uiModelsCulledCount;
+			++m_DrawStats.uiCulledMeshes;
+			return 0;
+		}
+	}
+
+	m_iLod = 0;
+
+	if( ShouldSelectLods() )
+	{
+		LodView_t view;
+
+		GetCurrentLodView( view );
+
+		m_iLod = SelectLod( *m_pRenderInfo, pPoseContext, view, flags );
+	}
+
 	glPushMatrix();
 
 	auto origin = m_pRenderInfo->vecOrigin;
@@ -108,36 +372,84 @@ unsigned int CStudioModelRenderer::DrawModel( studiomdl::CModelRenderInfo* const
 
 	glScalef( m_pRenderInfo->vecScale.x, m_pRenderInfo->vecScale.y, m_pRenderInfo->vecScale.z );
 
-	SetUpBones();
+	if( m_pRenderInfo->iSequence >= m_pStudioHdr->numseq )
+		m_pRenderInfo->iSequence = 0;
+
+	if( pPoseContext )
+	{
+		m_pPoseContext = pPoseContext;
+	}
+	else
+	{
+		m_pPoseContext = GetCachedPose();
+	}
+
+	m_pBoneTransforms = m_pPoseContext->GetBoneTransforms();
+	m_pxformverts = m_pPoseContext->GetTransformedVertices();
+
+	if( m_bQueueing )
+	{
+		//Queued meshes are drawn later, so capture the state they need now.
+		glGetFloatv( GL_MODELVIEW_MATRIX, glm::value_ptr( m_matQueuedModelView ) );
+
+		GLint iCullFace;
+		glGetIntegerv( GL_CULL_FACE_MODE, &iCullFace );
+
+		m_QueuedCullFace = static_cast<GLenum>( iCullFace );
+		m_bQueuedCullFace = glIsEnabled( GL_CULL_FACE ) != GL_FALSE;
+
+		m_uiQueuedPalette = INVALID_PALETTE;
+	}
 
 	SetupLighting();
 
 	unsigned int uiDrawnPolys = 0;
 
 	if( m_pListener )
+	{
 		m_pListener->OnPreDraw( *this, *m_pRenderInfo );
 
+		//Listeners can change state directly.
+		GLState().InvalidateState();
+	}
+
 	if( !( flags & renderer::DrawFlag::NODRAW ) )
 	{
 		for( int i = 0; i < m_pStudioHdr->numbodyparts; i++ )
 		{
-			SetupModel( i );
+			if( !SetupModel( i ) )
+				continue;
+
 			if( m_pRenderInfo->flTransparency > 0.0f )
 				uiDrawnPolys += DrawPoints( false );
 		}
 	}
 
+	//Anything drawn on top of the model needs the model to be drawn first.
+	if( m_bQueueing && 
+		( ( flags & renderer::DrawFlag::WIREFRAME_OVERLAY ) || 
+		  g_ShowBones.GetBool() || g_ShowAttachments.GetBool() || g_ShowEyePosition.GetBool() || g_ShowHitboxes.GetBool() || g_ShowStudioNormals.GetBool() ||
+		  m_pListener ) )
+	{
+		FlushRenderQueue();
+		BeginRenderQueue();
+	}
+
 	if( flags & renderer::DrawFlag::WIREFRAME_OVERLAY )
 	{
+		const renderer::CScopedGPUTimer gpuTimer( GLState(), "GPU wireframe" );
+
 		//TODO: restore render mode after this? - Solokiller
-		glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
-		glDisable( GL_TEXTURE_2D );
-		glDisable( GL_CULL_FACE );
-		glEnable( GL_DEPTH_TEST );
+		GLState().PolygonMode( GL_LINE );
+		GLState().Disable( GL_TEXTURE_2D );
+		GLState().Disable( GL_CULL_FACE );
+		GLState().Enable( GL_DEPTH_TEST );
 
 		for( int i = 0; i < m_pStudioHdr->numbodyparts; i++ )
 		{
-			SetupModel( i );
+			if( !SetupModel( i ) )
+				continue;
+
 			if( m_pRenderInfo->flTransparency > 0.0f )
 				uiDrawnPolys += DrawPoints( true );
 		}
@@ -146,29 +458,31 @@ unsigned int CStudioModelRenderer::DrawModel( studiomdl::CModelRenderInfo* const
 	// draw bones
 	if( g_ShowBones.GetBool() )
 	{
-		DrawBones();
+		AddBones();
 	}
 
 	if( g_ShowAttachments.GetBool() )
 	{
-		DrawAttachments();
+		AddAttachments();
 	}
 
 	if( g_ShowEyePosition.GetBool() )
 	{
-		DrawEyePosition();
+		AddEyePosition();
 	}
 
 	if( g_ShowHitboxes.GetBool() )
 	{
-		DrawHitBoxes();
+		AddHitBoxes();
 	}
 
 	if( g_ShowStudioNormals.GetBool() )
 	{
-		DrawNormals();
+		AddNormals();
 	}
 
+	DrawDebugBatches();
+
 	//Call this after the above debug operations so overlaying works properly.
 	if( m_pListener )
 		m_pListener->OnPostDraw( *this, *m_pRenderInfo );
@@ -180,921 +494,1951 @@ unsigned int CStudioModelRenderer::DrawModel( studiomdl::CModelRenderInfo* const
 	return uiDrawnPolys;
 }
 
-void CStudioModelRenderer::DrawSingleBone( const int iBone )
+unsigned int CStudioModelRenderer::DrawModelInstances( CModelRenderInfo* const pRenderInfos, const size_t uiCount, const renderer::DrawFlags_t flags )
 {
-	if( !m_pStudioHdr || iBone < 0 || iBone >= m_pStudioHdr->numbones )
-		return;
-
-	const mstudiobone_t* const pbones = m_pStudioHdr->GetBones();
-	glDisable( GL_TEXTURE_2D );
-	glDisable( GL_DEPTH_TEST );
+	if( !pRenderInfos || uiCount == 0 )
+		return 0;
 
-	if( pbones[ iBone ].parent >= 0 )
+	if( !ShouldDrawInstanced( pRenderInfos, uiCount, flags ) )
 	{
-		glPointSize( 10.0f );
-		glColor3f( 0, 0.7f, 1 );
-		glBegin( GL_LINES );
-		glVertex3f( m_bonetransform[ pbones[ iBone ].parent ][ 0 ][ 3 ], m_bonetransform[ pbones[ iBone ].parent ][ 1 ][ 3 ], m_bonetransform[ pbones[ iBone ].parent ][ 2 ][ 3 ] );
-		glVertex3f( m_bonetransform[ iBone ][ 0 ][ 3 ], m_bonetransform[ iBone ][ 1 ][ 3 ], m_bonetransform[ iBone ][ 2 ][ 3 ] );
-		glEnd();
+		unsigned int uiDrawnPolys = 0;
 
-		glColor3f( 0, 0, 0.8f );
-		glBegin( GL_POINTS );
-		if( pbones[ pbones[ iBone ].parent ].parent != -1 )
-			glVertex3f( m_bonetransform[ pbones[ iBone ].parent ][ 0 ][ 3 ], m_bonetransform[ pbones[ iBone ].parent ][ 1 ][ 3 ], m_bonetransform[ pbones[ iBone ].parent ][ 2 ][ 3 ] );
-		glVertex3f( m_bonetransform[ iBone ][ 0 ][ 3 ], m_bonetransform[ iBone ][ 1 ][ 3 ], m_bonetransform[ iBone ][ 2 ][ 3 ] );
-		glEnd();
-	}
-	else
-	{
-		// draw parent bone node
-		glPointSize( 10.0f );
-		glColor3f( 0.8f, 0, 0 );
-		glBegin( GL_POINTS );
-		glVertex3f( m_bonetransform[ iBone ][ 0 ][ 3 ], m_bonetransform[ iBone ][ 1 ][ 3 ], m_bonetransform[ iBone ][ 2 ][ 3 ] );
-		glEnd();
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			uiDrawnPolys += DrawModel( &pRenderInfos[ uiIndex ], nullptr, flags );
+		}
+
+		return uiDrawnPolys;
 	}
 
-	glPointSize( 1.0f );
-}
+	//Invisible instances aren't drawn at all, just like DrawModel skips their bodyparts.
+	m_InstanceOrder.clear();
 
-void CStudioModelRenderer::DrawSingleAttachment( const int iAttachment )
-{
-	if( !m_pStudioHdr || iAttachment < 0 || iAttachment >= m_pStudioHdr->numattachments )
-		return;
+	const bool bCull = r_studio_cull.GetBool();
 
-	glDisable( GL_TEXTURE_2D );
-	glDisable( GL_CULL_FACE );
-	glDisable( GL_DEPTH_TEST );
+	glm::vec4 planes[ graphics::FRUSTUM_PLANE_COUNT ];
 
-	mstudioattachment_t *pattachments = m_pStudioHdr->GetAttachments();
-	glm::vec3 v[ 4 ];
-	VectorTransform( pattachments[ iAttachment ].org, m_bonetransform[ pattachments[ iAttachment ].bone ], v[ 0 ] );
-	VectorTransform( pattachments[ iAttachment ].vectors[ 0 ], m_bonetransform[ pattachments[ iAttachment ].bone ], v[ 1 ] );
-	VectorTransform( pattachments[ iAttachment ].vectors[ 1 ], m_bonetransform[ pattachments[ iAttachment ].bone ], v[ 2 ] );
-	VectorTransform( pattachments[ iAttachment ].vectors[ 2 ], m_bonetransform[ pattachments[ iAttachment ].bone ], v[ 3 ] );
-	glBegin( GL_LINES );
-	glColor3f( 0, 1, 1 );
-	glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-	glColor3f( 1, 1, 1 );
-	glVertex3fv( glm::value_ptr( v[ 1 ] ) );
-	glColor3f( 0, 1, 1 );
-	glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-	glColor3f( 1, 1, 1 );
-	glVertex3fv( glm::value_ptr( v[ 2 ] ) );
-	glColor3f( 0, 1, 1 );
-	glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-	glColor3f( 1, 1, 1 );
-	glVertex3fv( glm::value_ptr( v[ 3 ] ) );
-	glEnd();
-
-	glPointSize( 10 );
-	glColor3f( 0, 1, 0 );
-	glBegin( GL_POINTS );
-	glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-	glEnd();
-	glPointSize( 1 );
-}
+	if( bCull )
+		graphics::GetCurrentFrustumPlanes( planes );
 
-void CStudioModelRenderer::DrawBones()
-{
-	const mstudiobone_t* const pbones = m_pStudioHdr->GetBones();
-	glDisable( GL_TEXTURE_2D );
-	glDisable( GL_DEPTH_TEST );
+	const bool bSelectLods = ShouldSelectLods();
 
-	for( int i = 0; i < m_pStudioHdr->numbones; i++ )
+	LodView_t lodView;
+
+	if( bSelectLods )
+		GetCurrentLodView( lodView );
+
+	m_InstanceLods.assign( uiCount, 0 );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		if( pbones[ i ].parent >= 0 )
+		if( pRenderInfos[ uiIndex ].flTransparency <= 0.0f )
+			continue;
+
+		if( bCull && !IsModelVisible( pRenderInfos[ uiIndex ], nullptr, planes, flags ) )
 		{
-			glPointSize( 3.0f );
-			glColor3f( 1, 0.7f, 0 );
-			glBegin( GL_LINES );
-			glVertex3f( m_bonetransform[ pbones[ i ].parent ][ 0 ][ 3 ], m_bonetransform[ pbones[ i ].parent ][ 1 ][ 3 ], m_bonetransform[ pbones[ i ].parent ][ 2 ][ 3 ] );
-			glVertex3f( m_bonetransform[ i ][ 0 ][ 3 ], m_bonetransform[ i ][ 1 ][ 3 ], m_bonetransform[ i ][ 2 ][ 3 ] );
-			glEnd();
-
-			glColor3f( 0, 0, 0.8f );
-			glBegin( GL_POINTS );
-			if( pbones[ pbones[ i ].parent ].parent != -1 )
-				glVertex3f( m_bonetransform[ pbones[ i ].parent ][ 0 ][ 3 ], m_bonetransform[ pbones[ i ].parent ][ 1 ][ 3 ], m_bonetransform[ pbones[ i ].parent ][ 2 ][ 3 ] );
-			glVertex3f( m_bonetransform[ i ][ 0 ][ 3 ], m_bonetransform[ i ][ 1 ][ 3 ], m_bonetransform[ i ][ 2 ][ 3 ] );
-			glEnd();
+			++m_uiModelsCulledCount;
+			++m_DrawStats.uiCulledMeshes;
+			continue;
 		}
-		else
+
+		if( bSelectLods )
+			m_InstanceLods[ uiIndex ] = SelectLod( pRenderInfos[ uiIndex ], nullptr, lodView, flags );
+
+		m_InstanceOrder.push_back( uiIndex );
+	}
+
+	//Instances that draw the same meshes with the same textures are drawn together.
+	std::stable_sort( m_InstanceOrder.begin(), m_InstanceOrder.end(), 
+		[ = ]( const size_t lhs, const size_t rhs )
 		{
-			// draw parent bone node
-			glPointSize( 5.0f );
-			glColor3f( 0.8f, 0, 0 );
-			glBegin( GL_POINTS );
-			glVertex3f( m_bonetransform[ i ][ 0 ][ 3 ], m_bonetransform[ i ][ 1 ][ 3 ], m_bonetransform[ i ][ 2 ][ 3 ] );
-			glEnd();
+			if( pRenderInfos[ lhs ].iBodygroup != pRenderInfos[ rhs ].iBodygroup )
+				return pRenderInfos[ lhs ].iBodygroup < pRenderInfos[ rhs ].iBodygroup;
+
+			if( pRenderInfos[ lhs ].iSkin != pRenderInfos[ rhs ].iSkin )
+				return pRenderInfos[ lhs ].iSkin < pRenderInfos[ rhs ].iSkin;
+
+			return m_InstanceLods[ lhs ] < m_InstanceLods[ rhs ];
 		}
-	}
+	);
 
-	glPointSize( 1.0f );
-}
+	//Split the instances up if they don't all fit in the buffer texture.
+	const size_t uiStride = INSTANCE_HEADER_TEXELS + pRenderInfos[ 0 ].pModel->GetStudioHeader()->numbones * 3;
 
-void CStudioModelRenderer::DrawAttachments()
-{
-	glDisable( GL_TEXTURE_2D );
-	glDisable( GL_CULL_FACE );
-	glDisable( GL_DEPTH_TEST );
+	const size_t uiMaxBatchSize = std::max( static_cast<size_t>( 1 ), static_cast<size_t>( m_iMaxInstanceTexels ) / uiStride );
 
-	for( int i = 0; i < m_pStudioHdr->numattachments; i++ )
+	unsigned int uiDrawnPolys = 0;
+
+	for( size_t uiFirst = 0; uiFirst < m_InstanceOrder.size(); uiFirst += uiMaxBatchSize )
 	{
-		mstudioattachment_t *pattachments = m_pStudioHdr->GetAttachments();
-		glm::vec3 v[ 4 ];
-		VectorTransform( pattachments[ i ].org, m_bonetransform[ pattachments[ i ].bone ], v[ 0 ] );
-		VectorTransform( pattachments[ i ].vectors[ 0 ], m_bonetransform[ pattachments[ i ].bone ], v[ 1 ] );
-		VectorTransform( pattachments[ i ].vectors[ 1 ], m_bonetransform[ pattachments[ i ].bone ], v[ 2 ] );
-		VectorTransform( pattachments[ i ].vectors[ 2 ], m_bonetransform[ pattachments[ i ].bone ], v[ 3 ] );
-		glBegin( GL_LINES );
-		glColor3f( 1, 0, 0 );
-		glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-		glColor3f( 1, 1, 1 );
-		glVertex3fv( glm::value_ptr( v[ 1 ] ) );
-		glColor3f( 1, 0, 0 );
-		glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-		glColor3f( 1, 1, 1 );
-		glVertex3fv( glm::value_ptr( v[ 2 ] ) );
-		glColor3f( 1, 0, 0 );
-		glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-		glColor3f( 1, 1, 1 );
-		glVertex3fv( glm::value_ptr( v[ 3 ] ) );
-		glEnd();
+		const size_t uiBatchSize = std::min( uiMaxBatchSize, m_InstanceOrder.size() - uiFirst );
 
-		glPointSize( 5 );
-		glColor3f( 0, 1, 0 );
-		glBegin( GL_POINTS );
-		glVertex3fv( glm::value_ptr( v[ 0 ] ) );
-		glEnd();
-		glPointSize( 1 );
+		uiDrawnPolys += DrawInstanceBatch( pRenderInfos, m_InstanceOrder.data() + uiFirst, uiBatchSize, flags );
 	}
-}
 
-void CStudioModelRenderer::DrawEyePosition()
-{
-	glDisable( GL_TEXTURE_2D );
-	glDisable( GL_CULL_FACE );
-	glDisable( GL_DEPTH_TEST );
-
-	glPointSize( 7 );
-	glColor3f( 1, 0, 1 );
-	glBegin( GL_POINTS );
-	glVertex3fv( glm::value_ptr( m_pStudioHdr->eyeposition ) );
-	glEnd();
-	glPointSize( 1 );
+	m_uiDrawnPolygonsCount += uiDrawnPolys;
+
+	return uiDrawnPolys;
 }
 
-void CStudioModelRenderer::DrawHitBoxes()
+bool CStudioModelRenderer::ShouldDrawInstanced( const CModelRenderInfo* pRenderInfos, const size_t uiCount, const renderer::DrawFlags_t flags )
 {
-	glDisable( GL_TEXTURE_2D );
-	glDisable( GL_CULL_FACE );
-	if( m_pRenderInfo->flTransparency < 1.0f )
-		glDisable( GL_DEPTH_TEST );
-	else
-		glEnable( GL_DEPTH_TEST );
+	if( !r_studio_instancing.GetBool() || uiCount < 2 )
+		return false;
 
-	glColor4f( 1, 0, 0, 0.5f );
+	const CStudioModel* const pStudioModel = pRenderInfos[ 0 ].pModel;
 
-	glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
-	glEnable( GL_BLEND );
-	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	if( !pStudioModel || pStudioModel->GetStudioHeader()->numbodyparts == 0 )
+		return false;
 
-	for( int i = 0; i < m_pStudioHdr->numhitboxes; i++ )
+	for( size_t uiIndex = 1; uiIndex < uiCount; ++uiIndex )
 	{
-		mstudiobbox_t *pbboxes = m_pStudioHdr->GetHitBoxes();
-		glm::vec3 v[ 8 ], v2[ 8 ];
-
-		glm::vec3 bbmin = pbboxes[ i ].bbmin;
-		glm::vec3 bbmax = pbboxes[ i ].bbmax;
-
-		v[ 0 ][ 0 ] = bbmin[ 0 ];
-		v[ 0 ][ 1 ] = bbmax[ 1 ];
-		v[ 0 ][ 2 ] = bbmin[ 2 ];
+		if( pRenderInfos[ uiIndex ].pModel != pStudioModel )
+			return false;
+	}
 
-		v[ 1 ][ 0 ] = bbmin[ 0 ];
-		v[ 1 ][ 1 ] = bbmin[ 1 ];
-		v[ 1 ][ 2 ] = bbmin[ 2 ];
+	//Overlays and listeners need each instance to be drawn by itself.
+	if( ( flags & ( renderer::DrawFlag::NODRAW | renderer::DrawFlag::WIREFRAME_OVERLAY ) ) || 
+		g_ShowBones.GetBool() || g_ShowAttachments.GetBool() || g_ShowEyePosition.GetBool() || g_ShowHitboxes.GetBool() || g_ShowStudioNormals.GetBool() ||
+		m_pListener )
+		return false;
 
-		v[ 2 ][ 0 ] = bbmax[ 0 ];
-		v[ 2 ][ 1 ] = bbmax[ 1 ];
-		v[ 2 ][ 2 ] = bbmin[ 2 ];
+	//Queued meshes are drawn later, so instances drawn now would end up in the wrong order.
+	if( m_bQueueing )
+		return false;
 
-		v[ 3 ][ 0 ] = bbmax[ 0 ];
-		v[ 3 ][ 1 ] = bbmin[ 1 ];
-		v[ 3 ][ 2 ] = bbmin[ 2 ];
+	if( !r_studio_vbo.GetBool() || !GLEW_VERSION_1_5 || pStudioModel->GetIndexBuffer() == 0 || pStudioModel->GetSkinVertexBuffer() == 0 )
+		return false;
 
-		v[ 4 ][ 0 ] = bbmax[ 0 ];
-		v[ 4 ][ 1 ] = bbmax[ 1 ];
-		v[ 4 ][ 2 ] = bbmax[ 2 ];
+	if( !m_bInstancingInitialized )
+	{
+		m_bInstancingInitialized = true;
 
-		v[ 5 ][ 0 ] = bbmax[ 0 ];
-		v[ 5 ][ 1 ] = bbmin[ 1 ];
-		v[ 5 ][ 2 ] = bbmax[ 2 ];
+		if( !GLEW_VERSION_2_0 || !GLEW_ARB_draw_instanced || !GLEW_EXT_gpu_shader4 || !GLEW_ARB_texture_buffer_object )
+		{
+			Message( "CStudioModelRenderer: Instanced drawing is not supported, drawing instances separately\n" );
+			return false;
+		}
 
-		v[ 6 ][ 0 ] = bbmin[ 0 ];
-		v[ 6 ][ 1 ] = bbmax[ 1 ];
-		v[ 6 ][ 2 ] = bbmax[ 2 ];
+		glGetIntegerv( GL_MAX_TEXTURE_BUFFER_SIZE_ARB, &m_iMaxInstanceTexels );
 
-		v[ 7 ][ 0 ] = bbmin[ 0 ];
-		v[ 7 ][ 1 ] = bbmin[ 1 ];
-		v[ 7 ][ 2 ] = bbmax[ 2 ];
+		if( m_InstancingProgram.Create( INSTANCING_VERTEX_SHADER, nullptr ) )
+		{
+			auto& uniforms = m_InstancingUniforms;
+
+			uniforms.iInstances = m_InstancingProgram.GetUniformLocation( "instances" );
+			uniforms.iInstanceStride = m_InstancingProgram.GetUniformLocation( "instanceStride" );
+			uniforms.iFirstInstance = m_InstancingProgram.GetUniformLocation( "firstInstance" );
+			uniforms.iLightVec = m_InstancingProgram.GetUniformLocation( "lightvec" );
+			uniforms.iLightColor = m_InstancingProgram.GetUniformLocation( "lightcolor" );
+			uniforms.iLighting = m_InstancingProgram.GetUniformLocation( "lighting" );
+			uniforms.iLightingMode = m_InstancingProgram.GetUniformLocation( "lightingMode" );
+			uniforms.iChrome = m_InstancingProgram.GetUniformLocation( "chrome" );
+			uniforms.iViewerOrigin = m_InstancingProgram.GetUniformLocation( "viewerOrigin" );
+			uniforms.iViewerRight = m_InstancingProgram.GetUniformLocation( "viewerRight" );
+			uniforms.iTexScale = m_InstancingProgram.GetUniformLocation( "texScale" );
+			uniforms.iPositionScale = m_InstancingProgram.GetUniformLocation( "positionScale" );
+			uniforms.iPositionOrigin = m_InstancingProgram.GetUniformLocation( "positionOrigin" );
+			uniforms.iCompactNormals = m_InstancingProgram.GetUniformLocation( "compactNormals" );
+		}
+	}
 
-		VectorTransform( v[ 0 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 0 ] );
-		VectorTransform( v[ 1 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 1 ] );
-		VectorTransform( v[ 2 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 2 ] );
-		VectorTransform( v[ 3 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 3 ] );
-		VectorTransform( v[ 4 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 4 ] );
-		VectorTransform( v[ 5 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 5 ] );
-		VectorTransform( v[ 6 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 6 ] );
-		VectorTransform( v[ 7 ], m_bonetransform[ pbboxes[ i ].bone ], v2[ 7 ] );
+	//A single instance has to fit in the buffer texture.
+	const size_t uiStride = INSTANCE_HEADER_TEXELS + pStudioModel->GetStudioHeader()->numbones * 3;
 
-		graphics::DrawBox( v2 );
-	}
+	return m_InstancingProgram.Exists() && uiStride <= static_cast<size_t>( m_iMaxInstanceTexels );
 }
 
-void CStudioModelRenderer::DrawNormals()
+unsigned int CStudioModelRenderer::DrawInstanceBatch( CModelRenderInfo* const pRenderInfos, const size_t* pOrder, const size_t uiCount, const renderer::DrawFlags_t flags )
 {
-	glDisable( GL_TEXTURE_2D );
+	CStudioModel* const pStudioModel = pRenderInfos[ pOrder[ 0 ] ].pModel;
 
-	glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
-	glBegin( GL_LINES );
+	GLState().InvalidateState();
 
-	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
-	{
-		SetupModel( iBodyPart );
+	m_pStudioHdr = pStudioModel->GetStudioHeader();
+	m_pTextureHdr = pStudioModel->GetTextureHeader();
 
-		auto pvertbone = ( const byte* ) ( m_pStudioHdr->GetData() + m_pModel->vertinfoindex );
-		auto pnormbone = ( const byte* ) ( m_pStudioHdr->GetData() + m_pModel->norminfoindex );
-		auto ptexture = m_pTextureHdr->GetTextures();
+	const size_t uiStride = INSTANCE_HEADER_TEXELS + m_pStudioHdr->numbones * 3;
 
-		auto pMeshes = ( const mstudiomesh_t* ) ( m_pStudioHdr->GetData() + m_pModel->meshindex );
+	m_InstanceData.resize( uiCount * uiStride );
 
-		auto pstudioverts = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + m_pModel->vertindex );
-		auto pstudionorms = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + m_pModel->normindex );
+	glm::vec4* pData = m_InstanceData.data();
 
-		auto pskinref = m_pTextureHdr->GetSkins();
+	for( size_t uiInstance = 0; uiInstance < uiCount; ++uiInstance, pData += uiStride )
+	{
+		m_pRenderInfo = &pRenderInfos[ pOrder[ uiInstance ] ];
 
-		const int iSkinNum = m_pRenderInfo->iSkin;
+		++m_uiModelsDrawnCount; // render data cache cookie
 
-		if( iSkinNum != 0 && iSkinNum < m_pTextureHdr->numskinfamilies )
-			pskinref += ( iSkinNum * m_pTextureHdr->numskinref );
+		if( m_pRenderInfo->iSequence >= m_pStudioHdr->numseq )
+			m_pRenderInfo->iSequence = 0;
+
+		m_pPoseContext = GetCachedPose();
 
-		for( int i = 0; i < m_pModel->numverts; i++ )
+		const glm::mat4 matTransform = ComputeModelTransform( *m_pRenderInfo, flags );
+
+		for( int iRow = 0; iRow < 3; ++iRow )
 		{
-			VectorTransform( pstudioverts[ i ], m_bonetransform[ pvertbone[ i ] ], m_pxformverts[ i ] );
+			pData[ iRow ] = glm::vec4( matTransform[ 0 ][ iRow ], matTransform[ 1 ][ iRow ], matTransform[ 2 ][ iRow ], matTransform[ 3 ][ iRow ] );
 		}
 
-		//
-		// clip and draw all triangles
-		//
+		pData[ 3 ] = glm::vec4( m_pRenderInfo->flTransparency, 0, 0, 0 );
 
-		glm::vec3* lv = m_pvlightvalues;
+		//Bone matrices are stored as 3 rows of 4 floats, same as the skinning program's palette.
+		const glm::mat3x4* const pBones = m_pPoseContext->GetBoneTransforms();
 
-		for( int j = 0; j < m_pModel->nummesh; j++ )
+		for( int iBone = 0; iBone < m_pStudioHdr->numbones; ++iBone )
 		{
-			int flags = ptexture[ pskinref[ pMeshes[ j ].skinref ] ].flags;
-
-			for( int i = 0; i < pMeshes[ j ].numnorms; i++, ++lv, ++pstudionorms, pnormbone++ )
-			{
-				Lighting( *lv, *pnormbone, flags, *pstudionorms );
-
-				// FIX: move this check out of the inner loop
-				if( flags & STUDIO_NF_CHROME )
-					Chrome( m_chrome[ reinterpret_cast<glm::vec3*>( lv ) - m_pvlightvalues ], *pnormbone, *pstudionorms );
-			}
+			pData[ INSTANCE_HEADER_TEXELS + iBone * 3 ] = pBones[ iBone ][ 0 ];
+			pData[ INSTANCE_HEADER_TEXELS + iBone * 3 + 1 ] = pBones[ iBone ][ 1 ];
+			pData[ INSTANCE_HEADER_TEXELS + iBone * 3 + 2 ] = pBones[ iBone ][ 2 ];
 		}
+	}
 
-		//Reset
-		pstudionorms = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + m_pModel->normindex );
+	m_pBoneTransforms = m_pPoseContext->GetBoneTransforms();
+	m_pxformverts = m_pPoseContext->GetTransformedVertices();
 
-		for( int j = 0; j < m_pModel->nummesh; j++ )
-		{
-			auto& mesh = pMeshes[ j ];
-			auto ptricmds = ( const short* ) ( m_pStudioHdr->GetData() + mesh.triindex );
+	SetupLighting();
 
-			const mstudiotexture_t& texture = ptexture[ pskinref[ mesh.skinref ] ];
+	const StudioLightingParams_t& lightingParams = m_LightingParams;
 
-			const glm::vec3* vecTriangles[ 3 ];
+	if( m_InstanceBuffer == 0 )
+	{
+		glGenBuffers( 1, &m_InstanceBuffer );
+		glGenTextures( 1, &m_InstanceTexture );
+	}
 
-			int i;
+	glBindBuffer( GL_TEXTURE_BUFFER_ARB, m_InstanceBuffer );
+	glBufferData( GL_TEXTURE_BUFFER_ARB, m_InstanceData.size() * sizeof( glm::vec4 ), m_InstanceData.data(), GL_STREAM_DRAW );
 
-			while( i = *( ptricmds++ ) )
-			{
-				//Keep track of the total number of vertices. Used to invert strip normals.
-				const int total = i;
+	m_DrawStats.uiUploadedBytes += m_InstanceData.size() * sizeof( glm::vec4 );
 
-				if( i < 0 )
-				{
-					i = -i;
+	glActiveTexture( GL_TEXTURE1 );
+	glBindTexture( GL_TEXTURE_BUFFER_ARB, m_InstanceTexture );
+	glTexBufferARB( GL_TEXTURE_BUFFER_ARB, GL_RGBA32F_ARB, m_InstanceBuffer );
+	glActiveTexture( GL_TEXTURE0 );
 
-					vecTriangles[ 0 ] = &m_pxformverts[ ptricmds[ 0 ] ];
-					vecTriangles[ 1 ] = &m_pxformverts[ ptricmds[ 4 ] ];
+	glBindBuffer( GL_TEXTURE_BUFFER_ARB, 0 );
 
-					i -= 2;
-					ptricmds += 8;
+	m_InstancingProgram.Bind();
 
-					for( ; i > 0; --i, ptricmds += 4 )
-					{
-						vecTriangles[ 2 ] = &m_pxformverts[ ptricmds[ 0 ] ];
-						
-						const glm::vec3 vecCenter( ( *( vecTriangles[ 0 ] ) + *( vecTriangles[ 1 ] ) + *( vecTriangles[ 2 ] ) ) / 3.0f );
+	const auto& uniforms = m_InstancingUniforms;
 
-						glm::vec3 vecNormal( glm::cross( *( vecTriangles[ 2 ] ) - *( vecTriangles[ 0 ] ), *( vecTriangles[ 1 ] ) - *( vecTriangles[ 0 ] ) ) );
+	glUniform1i( uniforms.iInstances, 1 );
+	glUniform1i( uniforms.iInstanceStride, static_cast<GLint>( uiStride ) );
+	glUniform3fv( uniforms.iLightVec, 1, glm::value_ptr( m_lightvec ) );
+	glUniform3fv( uniforms.iLightColor, 1, glm::value_ptr( lightingParams.vecLightColor ) );
+	glUniform3f( uniforms.iLighting, lightingParams.flAmbient, lightingParams.flShade, lightingParams.flLambert );
+	glUniform3fv( uniforms.iViewerOrigin, 1, glm::value_ptr( m_vecViewerOrigin ) );
+	glUniform3fv( uniforms.iViewerRight, 1, glm::value_ptr( m_vecViewerRight ) );
+	glUniform1i( uniforms.iCompactNormals, pStudioModel->HasCompactVertices() ? 1 : 0 );
 
-						vecNormal = glm::normalize( vecNormal );
+	glBindBuffer( GL_ARRAY_BUFFER, pStudioModel->GetSkinVertexBuffer() );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, pStudioModel->GetIndexBuffer() );
 
-						glVertex3fv( glm::value_ptr( vecCenter ) );
-						glVertex3fv( glm::value_ptr( vecCenter + vecNormal ) );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_NORMAL_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
 
-						vecTriangles[ 1 ] = vecTriangles[ 2 ];
-					}
-				}
-				else
-				{
-					vecTriangles[ 0 ] = &m_pxformverts[ ptricmds[ 0 ] ];
-					vecTriangles[ 1 ] = &m_pxformverts[ ptricmds[ 4 ] ];
+	glClientActiveTexture( GL_TEXTURE1 );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glClientActiveTexture( GL_TEXTURE0 );
 
-					i -= 2;
-					ptricmds += 8;
+	//Polygons may overlap, so make sure they can blend together. - Solokiller
+	glDepthFunc( GL_LEQUAL );
 
-					for( ; i > 0; --i, ptricmds += 4 )
-					{
-						vecTriangles[ 2 ] = &m_pxformverts[ ptricmds[ 0 ] ];
+	unsigned int uiDrawnPolys = 0;
 
-						const glm::vec3 vecCenter( ( *( vecTriangles[ 0 ] ) + *( vecTriangles[ 1 ] ) + *( vecTriangles[ 2 ] ) ) / 3.0f );
+	for( size_t uiFirst = 0, uiLast; uiFirst < uiCount; uiFirst = uiLast )
+	{
+		m_pRenderInfo = &pRenderInfos[ pOrder[ uiFirst ] ];
 
-						glm::vec3 vecNormal( glm::cross( *( vecTriangles[ 2 ] ) - *( vecTriangles[ 0 ] ), *( vecTriangles[ 1 ] ) - *( vecTriangles[ 0 ] ) ) );
+		bool bTranslucent = m_pRenderInfo->flTransparency < 1.0f;
 
-						vecNormal = glm::normalize( vecNormal );
+		const int iLod = m_InstanceLods[ pOrder[ uiFirst ] ];
 
-						if( ( ( i % 2 ) == 0 ) ^ ( ( total % 2 ) == 0 ) )
-							vecNormal *= -1;
+		//Find all instances with the same bodygroup, skin and detail level.
+		for( uiLast = uiFirst + 1; uiLast < uiCount; ++uiLast )
+		{
+			const auto& renderInfo = pRenderInfos[ pOrder[ uiLast ] ];
 
-						glVertex3fv( glm::value_ptr( vecCenter ) );
-						glVertex3fv( glm::value_ptr( vecCenter + vecNormal ) );
+			if( renderInfo.iBodygroup != m_pRenderInfo->iBodygroup || renderInfo.iSkin != m_pRenderInfo->iSkin || m_InstanceLods[ pOrder[ uiLast ] ] != iLod )
+				break;
 
-						vecTriangles[ 0 ] = vecTriangles[ 1 ];
-						vecTriangles[ 1 ] = vecTriangles[ 2 ];
-					}
-				}
-			}
+			bTranslucent = bTranslucent || renderInfo.flTransparency < 1.0f;
 		}
-	}
 
-	glEnd();
-}
+		const GLsizei iNumInstances = static_cast<GLsizei>( uiLast - uiFirst );
 
-void CStudioModelRenderer::SetUpBones()
-{
-	static glm::vec3 pos[ MAXSTUDIOBONES ];
-	static glm::vec4 q[ MAXSTUDIOBONES ];
-					 
-	static glm::vec3 pos2[ MAXSTUDIOBONES ];
-	static glm::vec4 q2[ MAXSTUDIOBONES ];
-	static glm::vec3 pos3[ MAXSTUDIOBONES ];
-	static glm::vec4 q3[ MAXSTUDIOBONES ];
-	static glm::vec3 pos4[ MAXSTUDIOBONES ];
-	static glm::vec4 q4[ MAXSTUDIOBONES ];
+		glUniform1i( uniforms.iFirstInstance, static_cast<GLint>( uiFirst ) );
 
-	if( m_pRenderInfo->iSequence >= m_pStudioHdr->numseq )
-	{
-		m_pRenderInfo->iSequence = 0;
-	}
+		const mstudiotexture_t* const ptexture = m_pTextureHdr->GetTextures();
 
-	mstudioseqdesc_t* const pseqdesc = m_pStudioHdr->GetSequence( m_pRenderInfo->iSequence );
+		for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+		{
+			if( !SetupModel( iBodyPart ) )
+				continue;
 
-	const mstudioanim_t* panim = m_pRenderInfo->pModel->GetAnim( pseqdesc );
+			size_t uiNumMeshes;
 
-	CalcRotations( pos, q, pseqdesc, panim, m_pRenderInfo->flFrame );
+			const StudioDrawMesh_t* const pMeshes = pStudioModel->GetDrawList( m_pModel, m_pRenderInfo->iSkin, uiNumMeshes );
 
-	if( pseqdesc->numblends > 1 )
-	{
-		panim += m_pStudioHdr->numbones;
-		CalcRotations( pos2, q2, pseqdesc, panim, m_pRenderInfo->flFrame );
-		float s = m_pRenderInfo->iBlender[ 0 ] / 255.0;
+			for( size_t j = 0; j < uiNumMeshes; j++ )
+			{
+				auto pBuffer = pStudioModel->GetMeshBuffer( pMeshes[ j ].pMesh );
 
-		SlerpBones( q, pos, q2, pos2, s );
+				if( !pBuffer )
+					continue;
 
-		if( pseqdesc->numblends == 4 )
-		{
-			panim += m_pStudioHdr->numbones;
-			CalcRotations( pos3, q3, pseqdesc, panim, m_pRenderInfo->flFrame );
+				const mstudiotexture_t& texture = ptexture[ pMeshes[ j ].iTexture ];
 
-			panim += m_pStudioHdr->numbones;
-			CalcRotations( pos4, q4, pseqdesc, panim, m_pRenderInfo->flFrame );
+				if( texture.flags & STUDIO_NF_ADDITIVE )
+					GLState().DepthMask( false );
+				else
+					GLState().DepthMask( true );
 
-			s = m_pRenderInfo->iBlender[ 0 ] / 255.0;
-			SlerpBones( q3, pos3, q4, pos4, s );
+				//Instances drawn together can have different transparency, so blend whenever any of them needs it.
+				if( texture.flags & STUDIO_NF_ADDITIVE )
+				{
+					GLState().Enable( GL_BLEND );
+					GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE );
+				}
+				else if( bTranslucent )
+				{
+					GLState().Enable( GL_BLEND );
+					GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+				}
+				else
+					GLState().Disable( GL_BLEND );
 
-			s = m_pRenderInfo->iBlender[ 1 ] / 255.0;
-			SlerpBones( q, pos, q3, pos3, s );
-		}
+				if( texture.flags & STUDIO_NF_MASKED )
+				{
+					GLState().Enable( GL_ALPHA_TEST );
+					GLState().AlphaFunc( GL_GREATER, 0.5f );
+				}
+
+				GLState().BindTexture2D( pStudioModel->GetTextureId( pMeshes[ j ].iTexture ) );
+
+				GLint iLightingMode;
+
+				if( texture.flags & STUDIO_NF_ADDITIVE )
+					iLightingMode = 3;
+				else if( texture.flags & STUDIO_NF_FULLBRIGHT )
+					iLightingMode = 2;
+				else if( texture.flags & STUDIO_NF_FLATSHADE )
+					iLightingMode = 1;
+				else
+					iLightingMode = 0;
+
+				glUniform1i( uniforms.iLightingMode, iLightingMode );
+				glUniform1i( uniforms.iChrome, ( texture.flags & STUDIO_NF_CHROME ) ? 1 : 0 );
+				glUniform2f( uniforms.iTexScale, 1.0f / ( float ) texture.width, 1.0f / ( float ) texture.height );
+
+				SetSkinVertexPointer( *pStudioModel, *pBuffer, uniforms.iPositionScale, uniforms.iPositionOrigin );
+
+				const size_t uiBase = pBuffer->uiFirstVertex * pStudioModel->GetSkinVertexSize();
+
+				if( pStudioModel->HasCompactVertices() )
+				{
+					//The normal array isn't used by the program, but it's enabled, so it has to point to valid data.
+					glNormalPointer( GL_SHORT, sizeof( StudioCompactSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioCompactSkinVertex_t, iNormalBone ) ) );
+					glTexCoordPointer( 2, GL_SHORT, sizeof( StudioCompactSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioCompactSkinVertex_t, iTexCoord ) ) );
+
+					glClientActiveTexture( GL_TEXTURE1 );
+					glTexCoordPointer( 3, GL_SHORT, sizeof( StudioCompactSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioCompactSkinVertex_t, iNormalBone ) ) );
+					glClientActiveTexture( GL_TEXTURE0 );
+				}
+				else
+				{
+					glNormalPointer( GL_FLOAT, sizeof( StudioSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioSkinVertex_t, vecNormal ) ) );
+					glTexCoordPointer( 2, GL_FLOAT, sizeof( StudioSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioSkinVertex_t, vecTexCoord ) ) );
+
+					glClientActiveTexture( GL_TEXTURE1 );
+					glTexCoordPointer( 1, GL_FLOAT, sizeof( StudioSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioSkinVertex_t, flNormalBone ) ) );
+					glClientActiveTexture( GL_TEXTURE0 );
+				}
+
+				const StudioMeshLod_t lod = pBuffer->GetLod( iLod );
+
+				glDrawElementsInstancedARB( GL_TRIANGLES, static_cast<GLsizei>( lod.uiNumIndices ), GL_UNSIGNED_INT, 
+											reinterpret_cast<const void*>( lod.uiFirstIndex * sizeof( GLuint ) ), iNumInstances );
+
+				PROFILE_COUNT( "Draw calls", 1 );
+
+				++m_DrawStats.uiDrawCalls;
+				m_DrawStats.uiVertices += static_cast<uint32_t>( lod.uiNumIndices ) * iNumInstances;
+
+				if( texture.flags & STUDIO_NF_MASKED )
+					GLState().Disable( GL_ALPHA_TEST );
+
+				uiDrawnPolys += static_cast<unsigned int>( lod.uiNumIndices / 3 ) * iNumInstances;
+			}
+		}
+	}
+
+	GLState().DepthMask( true );
+
+	m_InstancingProgram.Unbind();
+
+	glClientActiveTexture( GL_TEXTURE1 );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glClientActiveTexture( GL_TEXTURE0 );
+
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+
+	glActiveTexture( GL_TEXTURE1 );
+	glBindTexture( GL_TEXTURE_BUFFER_ARB, 0 );
+	glActiveTexture( GL_TEXTURE0 );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	return uiDrawnPolys;
+}
+
+bool CStudioModelRenderer::GetModelBounds( const CModelRenderInfo& renderInfo, const CStudioPoseContext* pPoseContext, glm::vec3& vecMins, glm::vec3& vecMaxs )
+{
+	if( pPoseContext && pPoseContext->GetBounds( vecMins, vecMaxs ) )
+		return true;
+
+	const studiohdr_t* const pStudioHdr = renderInfo.pModel->GetStudioHeader();
+
+	const int iSequence = renderInfo.iSequence < pStudioHdr->numseq ? renderInfo.iSequence : 0;
+
+	const mstudioseqdesc_t* const pseqdesc = pStudioHdr->GetSequence( iSequence );
+
+	if( pseqdesc->bbmin == pseqdesc->bbmax )
+		return false;
+
+	vecMins = pseqdesc->bbmin;
+	vecMaxs = pseqdesc->bbmax;
+
+	return true;
+}
+
+bool CStudioModelRenderer::IsModelVisible( const CModelRenderInfo& renderInfo, const CStudioPoseContext* pPoseContext, 
+										   const glm::vec4 ( &planes )[ graphics::FRUSTUM_PLANE_COUNT ], const renderer::DrawFlags_t flags ) const
+{
+	glm::vec3 vecMins, vecMaxs;
+
+	//Some models don't have sequence bounds; they can't be culled.
+	if( !GetModelBounds( renderInfo, pPoseContext, vecMins, vecMaxs ) )
+		return true;
+
+	//Move the planes into model space instead of moving the box out of it, so the test stays exact for rotated models.
+	const glm::mat4 matTransposed = glm::transpose( ComputeModelTransform( renderInfo, flags ) );
+
+	glm::vec4 localPlanes[ graphics::FRUSTUM_PLANE_COUNT ];
+
+	for( size_t uiPlane = 0; uiPlane < graphics::FRUSTUM_PLANE_COUNT; ++uiPlane )
+	{
+		localPlanes[ uiPlane ] = matTransposed * planes[ uiPlane ];
+	}
+
+	return graphics::BoxInsidePlanes( vecMins, vecMaxs, localPlanes, graphics::FRUSTUM_PLANE_COUNT );
+}
+
+void CStudioModelRenderer::GetCurrentLodView( LodView_t& view )
+{
+	glm::mat4 matProjection;
+	GLint viewport[ 4 ];
+
+	glGetFloatv( GL_PROJECTION_MATRIX, glm::value_ptr( matProjection ) );
+	glGetFloatv( GL_MODELVIEW_MATRIX, glm::value_ptr( view.matView ) );
+	glGetIntegerv( GL_VIEWPORT, viewport );
+
+	//Perspective projections put -z in w, orthographic projections don't.
+	view.bPerspective = matProjection[ 2 ][ 3 ] != 0;
+	view.flPixelScale = std::abs( matProjection[ 1 ][ 1 ] ) * viewport[ 3 ] * 0.5f;
+}
+
+bool CStudioModelRenderer::ShouldSelectLods()
+{
+	return r_studio_lod.GetBool() || r_studio_lodforce.GetInt() >= 0;
+}
+
+int CStudioModelRenderer::SelectLod( const CModelRenderInfo& renderInfo, const CStudioPoseContext* pPoseContext, const LodView_t& view, const renderer::DrawFlags_t flags ) const
+{
+	const int iForcedLod = r_studio_lodforce.GetInt();
+
+	if( iForcedLod >= 0 )
+		return std::min( iForcedLod, STUDIO_LOD_COUNT - 1 );
+
+	//View models are always right in front of the camera.
+	if( flags & renderer::DrawFlag::IS_VIEW_MODEL )
+		return 0;
+
+	glm::vec3 vecMins, vecMaxs;
+
+	//Models without sequence bounds can't be measured.
+	if( !GetModelBounds( renderInfo, pPoseContext, vecMins, vecMaxs ) )
+		return 0;
+
+	const float flScale = std::max( std::abs( renderInfo.vecScale.x ), std::max( std::abs( renderInfo.vecScale.y ), std::abs( renderInfo.vecScale.z ) ) );
+
+	const float flRadius = glm::length( vecMaxs - vecMins ) * 0.5f * flScale;
+
+	const glm::vec4 vecCenter = view.matView * ComputeModelTransform( renderInfo, flags ) * glm::vec4( ( vecMins + vecMaxs ) * 0.5f, 1 );
+
+	float flScreenRadius = flRadius * view.flPixelScale;
+
+	if( view.bPerspective )
+	{
+		const float flDepth = -vecCenter.z;
+
+		//The camera is inside of or right next to the model.
+		if( flDepth <= flRadius )
+			return 0;
+
+		flScreenRadius /= flDepth;
+	}
+
+	flScreenRadius *= std::exp2( -r_studio_lodbias.GetFloat() );
+
+	int iLod = 0;
+
+	while( iLod + 1 < STUDIO_LOD_COUNT && flScreenRadius < LOD_SCREEN_RADII[ iLod ] )
+	{
+		++iLod;
+	}
+
+	return iLod;
+}
+
+CStudioPoseContext* CStudioModelRenderer::GetCachedPose()
+{
+	const size_t uiCacheSize = static_cast<size_t>( r_studio_posecache.GetInt() );
+
+	if( uiCacheSize == 0 )
+	{
+		m_PoseCache.clear();
+		m_PoseContext.SetUpBones( *m_pRenderInfo );
+		return &m_PoseContext;
+	}
+
+	if( m_PoseCache.size() > uiCacheSize )
+		m_PoseCache.resize( uiCacheSize );
+
+	CachedPose_t* pOldest = nullptr;
+
+	for( auto& pose : m_PoseCache )
+	{
+		if( pose.context->Matches( *m_pRenderInfo ) )
+		{
+			pose.uiLastUsed = m_uiModelsDrawnCount;
+			return pose.context.get();
+		}
+
+		if( !pOldest || pose.uiLastUsed < pOldest->uiLastUsed )
+			pOldest = &pose;
+	}
+
+	if( m_PoseCache.size() < uiCacheSize )
+	{
+		m_PoseCache.push_back( { std::make_unique<CStudioPoseContext>(), 0 } );
+		pOldest = &m_PoseCache.back();
+	}
+
+	pOldest->context->SetUpBones( *m_pRenderInfo );
+	pOldest->uiLastUsed = m_uiModelsDrawnCount;
+
+	return pOldest->context.get();
+}
+
+void CStudioModelRenderer::BeginRenderQueue()
+{
+	if( !r_studio_renderqueue.GetBool() )
+		return;
+
+	m_bQueueing = true;
+}
+
+unsigned int CStudioModelRenderer::FlushRenderQueue()
+{
+	m_bQueueing = false;
+
+	if( m_RenderQueue.empty() )
+		return 0;
+
+	PROFILE_SCOPE( "Mesh submission" );
+
+	GLState().InvalidateState();
+
+	//Sort by pass first so additive meshes are still drawn last, then group by texture and palette.
+	std::stable_sort( m_RenderQueue.begin(), m_RenderQueue.end(), 
+		[]( const QueuedMesh_t& lhs, const QueuedMesh_t& rhs )
+		{
+			if( lhs.pass != rhs.pass )
+				return lhs.pass < rhs.pass;
+
+			if( lhs.textureId != rhs.textureId )
+				return lhs.textureId < rhs.textureId;
+
+			if( lhs.uiFirstBone != rhs.uiFirstBone )
+				return lhs.uiFirstBone < rhs.uiFirstBone;
+
+			return lhs.flags < rhs.flags;
+		}
+	);
+
+	//Leaves the stream bound.
+	m_uiVertexStreamOffset = m_VertexStream.Upload( m_QueuedVertexData.data(), m_QueuedVertexData.size() * sizeof( StudioVertex_t ), sizeof( StudioVertex_t ) );
+
+	m_DrawStats.uiUploadedBytes += m_QueuedVertexData.size() * sizeof( StudioVertex_t );
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
+
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+
+	//Polygons may overlap, so make sure they can blend together. - Solokiller
+	glDepthFunc( GL_LEQUAL );
+
+	enum class BlendMode
+	{
+		UNKNOWN,
+		NONE,
+		ALPHA,
+		ADDITIVE
+	};
+
+	//State changes that drawing each mesh individually would have made: depth mask, blend mode, alpha test and texture.
+	const unsigned int uiStatesPerMesh = 4;
+
+	unsigned int uiStateChanges = 0;
+
+	int iDepthMask = -1;
+	BlendMode blendMode = BlendMode::UNKNOWN;
+	int iAlphaTest = -1;
+	GLuint textureId = 0;
+	bool bTextureBound = false;
+
+	int iCullFace = -1;
+	GLenum cullFace = GL_NONE;
+
+	const CStudioModel* pCurrentModel = nullptr;
+	bool bProgramBound = false;
+	size_t uiCurrentPalette = INVALID_PALETTE;
+
+	for( const auto& mesh : m_RenderQueue )
+	{
+		glLoadMatrixf( glm::value_ptr( mesh.matModelView ) );
+
+		if( iCullFace != static_cast<int>( mesh.bCullFace ) )
+		{
+			iCullFace = mesh.bCullFace;
+
+			if( mesh.bCullFace )
+				GLState().Enable( GL_CULL_FACE );
+			else
+				GLState().Disable( GL_CULL_FACE );
+		}
+
+		if( cullFace != mesh.cullFace )
+		{
+			cullFace = mesh.cullFace;
+			glCullFace( cullFace );
+		}
+
+		const int iNewDepthMask = ( mesh.flags & STUDIO_NF_ADDITIVE ) ? 0 : 1;
+
+		if( iDepthMask != iNewDepthMask )
+		{
+			iDepthMask = iNewDepthMask;
+			GLState().DepthMask( iDepthMask != 0 );
+			++uiStateChanges;
+		}
+
+		BlendMode newBlendMode;
+
+		if( mesh.flags & STUDIO_NF_ADDITIVE )
+			newBlendMode = BlendMode::ADDITIVE;
+		else if( mesh.flTransparency < 1.0f )
+			newBlendMode = BlendMode::ALPHA;
+		else
+			newBlendMode = BlendMode::NONE;
+
+		if( blendMode != newBlendMode )
+		{
+			blendMode = newBlendMode;
+
+			switch( blendMode )
+			{
+			case BlendMode::ADDITIVE:
+				GLState().Enable( GL_BLEND );
+				GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE );
+				break;
+
+			case BlendMode::ALPHA:
+				GLState().Enable( GL_BLEND );
+				GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+				break;
+
+			default:
+				GLState().Disable( GL_BLEND );
+				break;
+			}
+
+			++uiStateChanges;
+		}
+
+		const int iNewAlphaTest = ( mesh.flags & STUDIO_NF_MASKED ) ? 1 : 0;
+
+		if( iAlphaTest != iNewAlphaTest )
+		{
+			iAlphaTest = iNewAlphaTest;
+
+			if( iAlphaTest )
+			{
+				GLState().Enable( GL_ALPHA_TEST );
+				GLState().AlphaFunc( GL_GREATER, 0.5f );
+			}
+			else
+			{
+				GLState().Disable( GL_ALPHA_TEST );
+			}
+
+			++uiStateChanges;
+		}
+
+		if( !bTextureBound || textureId != mesh.textureId )
+		{
+			bTextureBound = true;
+			textureId = mesh.textureId;
+			GLState().BindTexture2D( textureId );
+			++uiStateChanges;
+		}
+
+		if( pCurrentModel != mesh.pModel )
+		{
+			pCurrentModel = mesh.pModel;
+			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, pCurrentModel->GetIndexBuffer() );
+		}
+
+		const bool bSkinned = mesh.uiFirstBone != INVALID_PALETTE;
+
+		if( bSkinned != bProgramBound )
+		{
+			bProgramBound = bSkinned;
+
+			if( bProgramBound )
+				m_SkinningProgram.Bind();
+			else
+				m_SkinningProgram.Unbind();
+		}
+
+		const size_t uiBase = m_uiVertexStreamOffset + mesh.uiVertexOffset * sizeof( StudioVertex_t );
+
+		if( bSkinned )
+		{
+			if( uiCurrentPalette != mesh.uiFirstBone )
+			{
+				uiCurrentPalette = mesh.uiFirstBone;
+				glUniform4fv( m_iBonesUniform, mesh.iNumBones * 3, glm::value_ptr( m_QueuedBones[ mesh.uiFirstBone ] ) );
+			}
+
+			glBindBuffer( GL_ARRAY_BUFFER, mesh.pModel->GetSkinVertexBuffer() );
+			SetSkinVertexPointer( *mesh.pModel, *mesh.pSkinBuffer, m_iPositionScaleUniform, m_iPositionOriginUniform );
+			glBindBuffer( GL_ARRAY_BUFFER, m_VertexStream.GetBuffer() );
+		}
+		else
+		{
+			glVertexPointer( 3, GL_FLOAT, sizeof( StudioVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioVertex_t, vecPosition ) ) );
+		}
+
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( StudioVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioVertex_t, vecTexCoord ) ) );
+		glColorPointer( 4, GL_FLOAT, sizeof( StudioVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioVertex_t, vecColor ) ) );
+
+		glDrawElements( GL_TRIANGLES, static_cast<GLsizei>( mesh.uiNumIndices ), GL_UNSIGNED_INT, reinterpret_cast<const void*>( mesh.uiFirstIndex * sizeof( GLuint ) ) );
+
+		m_DrawStats.uiVertices += static_cast<uint32_t>( mesh.uiNumIndices );
+	}
+
+	if( bProgramBound )
+		m_SkinningProgram.Unbind();
+
+	if( iAlphaTest == 1 )
+		GLState().Disable( GL_ALPHA_TEST );
+
+	GLState().DepthMask( true );
+
+	glPopMatrix();
+
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	const unsigned int uiPossibleChanges = static_cast<unsigned int>( m_RenderQueue.size() ) * uiStatesPerMesh;
+
+	const unsigned int uiSaved = uiPossibleChanges - uiStateChanges;
+
+	m_uiStateChangesSavedCount += uiSaved;
+
+	PROFILE_COUNT( "Draw calls", m_RenderQueue.size() );
+
+	m_DrawStats.uiDrawCalls += static_cast<uint32_t>( m_RenderQueue.size() );
+
+	m_RenderQueue.clear();
+	m_QueuedVertexData.clear();
+	m_QueuedBones.clear();
+
+	return uiSaved;
+}
+
+void CStudioModelRenderer::DrawSingleBone( const int iBone )
+{
+	if( !m_pStudioHdr || iBone < 0 || iBone >= m_pStudioHdr->numbones )
+		return;
+
+	const mstudiobone_t* const pbones = m_pStudioHdr->GetBones();
+
+	const glm::vec3 vecOrigin( m_pBoneTransforms[ iBone ][ 0 ][ 3 ], m_pBoneTransforms[ iBone ][ 1 ][ 3 ], m_pBoneTransforms[ iBone ][ 2 ][ 3 ] );
+
+	const int iParent = pbones[ iBone ].parent;
+
+	if( iParent >= 0 )
+	{
+		const glm::vec3 vecParentOrigin( m_pBoneTransforms[ iParent ][ 0 ][ 3 ], m_pBoneTransforms[ iParent ][ 1 ][ 3 ], m_pBoneTransforms[ iParent ][ 2 ][ 3 ] );
+
+		m_DebugOverlayBatch.AddLine( vecParentOrigin, vecOrigin, Color( 0, 179, 255 ) );
+
+		if( pbones[ iParent ].parent != -1 )
+			m_DebugOverlayBatch.AddPoint( vecParentOrigin, 10.0f, Color( 0, 0, 204 ) );
+
+		m_DebugOverlayBatch.AddPoint( vecOrigin, 10.0f, Color( 0, 0, 204 ) );
+	}
+	else
+	{
+		// draw parent bone node
+		m_DebugOverlayBatch.AddPoint( vecOrigin, 10.0f, Color( 204, 0, 0 ) );
+	}
+
+	DrawDebugBatch( m_DebugOverlayBatch, false );
+}
+
+void CStudioModelRenderer::DrawSingleAttachment( const int iAttachment )
+{
+	if( !m_pStudioHdr || iAttachment < 0 || iAttachment >= m_pStudioHdr->numattachments )
+		return;
+
+	const mstudioattachment_t& attachment = m_pStudioHdr->GetAttachments()[ iAttachment ];
+	glm::vec3 v[ 4 ];
+	VectorTransform( attachment.org, m_pBoneTransforms[ attachment.bone ], v[ 0 ] );
+	VectorTransform( attachment.vectors[ 0 ], m_pBoneTransforms[ attachment.bone ], v[ 1 ] );
+	VectorTransform( attachment.vectors[ 1 ], m_pBoneTransforms[ attachment.bone ], v[ 2 ] );
+	VectorTransform( attachment.vectors[ 2 ], m_pBoneTransforms[ attachment.bone ], v[ 3 ] );
+
+	for( int i = 1; i < 4; ++i )
+	{
+		m_DebugOverlayBatch.AddLine( v[ 0 ], Color( 0, 255, 255 ), v[ i ], Color( 255, 255, 255 ) );
 	}
 
+	m_DebugOverlayBatch.AddPoint( v[ 0 ], 10.0f, Color( 0, 255, 0 ) );
+
+	DrawDebugBatch( m_DebugOverlayBatch, false );
+}
+
+void CStudioModelRenderer::AddBones()
+{
 	const mstudiobone_t* const pbones = m_pStudioHdr->GetBones();
 
-	glm::mat3x4 bonematrix;
+	for( int i = 0; i < m_pStudioHdr->numbones; i++ )
+	{
+		const glm::vec3 vecOrigin( m_pBoneTransforms[ i ][ 0 ][ 3 ], m_pBoneTransforms[ i ][ 1 ][ 3 ], m_pBoneTransforms[ i ][ 2 ][ 3 ] );
+
+		const int iParent = pbones[ i ].parent;
+
+		if( iParent >= 0 )
+		{
+			const glm::vec3 vecParentOrigin( m_pBoneTransforms[ iParent ][ 0 ][ 3 ], m_pBoneTransforms[ iParent ][ 1 ][ 3 ], m_pBoneTransforms[ iParent ][ 2 ][ 3 ] );
+
+			m_DebugOverlayBatch.AddLine( vecParentOrigin, vecOrigin, Color( 255, 179, 0 ) );
+
+			if( pbones[ iParent ].parent != -1 )
+				m_DebugOverlayBatch.AddPoint( vecParentOrigin, 3.0f, Color( 0, 0, 204 ) );
+
+			m_DebugOverlayBatch.AddPoint( vecOrigin, 3.0f, Color( 0, 0, 204 ) );
+		}
+		else
+		{
+			// draw parent bone node
+			m_DebugOverlayBatch.AddPoint( vecOrigin, 5.0f, Color( 204, 0, 0 ) );
+		}
+	}
+}
+
+void CStudioModelRenderer::AddAttachments()
+{
+	const mstudioattachment_t* const pattachments = m_pStudioHdr->GetAttachments();
+
+	for( int i = 0; i < m_pStudioHdr->numattachments; i++ )
+	{
+		glm::vec3 v[ 4 ];
+		VectorTransform( pattachments[ i ].org, m_pBoneTransforms[ pattachments[ i ].bone ], v[ 0 ] );
+		VectorTransform( pattachments[ i ].vectors[ 0 ], m_pBoneTransforms[ pattachments[ i ].bone ], v[ 1 ] );
+		VectorTransform( pattachments[ i ].vectors[ 1 ], m_pBoneTransforms[ pattachments[ i ].bone ], v[ 2 ] );
+		VectorTransform( pattachments[ i ].vectors[ 2 ], m_pBoneTransforms[ pattachments[ i ].bone ], v[ 3 ] );
+
+		for( int j = 1; j < 4; ++j )
+		{
+			m_DebugOverlayBatch.AddLine( v[ 0 ], Color( 255, 0, 0 ), v[ j ], Color( 255, 255, 255 ) );
+		}
+
+		m_DebugOverlayBatch.AddPoint( v[ 0 ], 5.0f, Color( 0, 255, 0 ) );
+	}
+}
+
+void CStudioModelRenderer::AddEyePosition()
+{
+	m_DebugOverlayBatch.AddPoint( m_pStudioHdr->eyeposition, 7.0f, Color( 255, 0, 255 ) );
+}
+
+void CStudioModelRenderer::AddHitBoxes()
+{
+	//Hitboxes are hidden by the model unless it's translucent.
+	auto& batch = m_pRenderInfo->flTransparency < 1.0f ? m_DebugOverlayBatch : m_DebugBatch;
+
+	const mstudiobbox_t* const pbboxes = m_pStudioHdr->GetHitBoxes();
+
+	for( int i = 0; i < m_pStudioHdr->numhitboxes; i++ )
+	{
+		AddHitBox( pbboxes[ i ], batch );
+	}
+}
+
+void CStudioModelRenderer::AddHitBox( const mstudiobbox_t& hitbox, graphics::CDebugDrawBatch& batch )
+{
+	glm::vec3 v[ 8 ], v2[ 8 ];
+
+	const glm::vec3& bbmin = hitbox.bbmin;
+	const glm::vec3& bbmax = hitbox.bbmax;
+
+	v[ 0 ][ 0 ] = bbmin[ 0 ];
+	v[ 0 ][ 1 ] = bbmax[ 1 ];
+	v[ 0 ][ 2 ] = bbmin[ 2 ];
+
+	v[ 1 ][ 0 ] = bbmin[ 0 ];
+	v[ 1 ][ 1 ] = bbmin[ 1 ];
+	v[ 1 ][ 2 ] = bbmin[ 2 ];
+
+	v[ 2 ][ 0 ] = bbmax[ 0 ];
+	v[ 2 ][ 1 ] = bbmax[ 1 ];
+	v[ 2 ][ 2 ] = bbmin[ 2 ];
+
+	v[ 3 ][ 0 ] = bbmax[ 0 ];
+	v[ 3 ][ 1 ] = bbmin[ 1 ];
+	v[ 3 ][ 2 ] = bbmin[ 2 ];
+
+	v[ 4 ][ 0 ] = bbmax[ 0 ];
+	v[ 4 ][ 1 ] = bbmax[ 1 ];
+	v[ 4 ][ 2 ] = bbmax[ 2 ];
+
+	v[ 5 ][ 0 ] = bbmax[ 0 ];
+	v[ 5 ][ 1 ] = bbmin[ 1 ];
+	v[ 5 ][ 2 ] = bbmax[ 2 ];
+
+	v[ 6 ][ 0 ] = bbmin[ 0 ];
+	v[ 6 ][ 1 ] = bbmax[ 1 ];
+	v[ 6 ][ 2 ] = bbmax[ 2 ];
+
+	v[ 7 ][ 0 ] = bbmin[ 0 ];
+	v[ 7 ][ 1 ] = bbmin[ 1 ];
+	v[ 7 ][ 2 ] = bbmax[ 2 ];
+
+	for( int i = 0; i < 8; ++i )
+	{
+		VectorTransform( v[ i ], m_pBoneTransforms[ hitbox.bone ], v2[ i ] );
+	}
+
+	batch.AddBox( v2, Color( 255, 0, 0, 128 ) );
+}
+
+void CStudioModelRenderer::DrawDebugBatch( graphics::CDebugDrawBatch& batch, const bool bDepthTest )
+{
+	if( batch.IsEmpty() )
+		return;
+
+	GLState().Disable( GL_TEXTURE_2D );
+	GLState().Disable( GL_CULL_FACE );
+
+	if( bDepthTest )
+		GLState().Enable( GL_DEPTH_TEST );
+	else
+		GLState().Disable( GL_DEPTH_TEST );
+
+	GLState().Enable( GL_BLEND );
+	GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+	m_DrawStats.uiDrawCalls += static_cast<uint32_t>( batch.Draw( &m_VertexStream ) );
+}
+
+void CStudioModelRenderer::DrawDebugBatches()
+{
+	DrawDebugBatch( m_DebugBatch, true );
+	DrawDebugBatch( m_DebugOverlayBatch, false );
+}
+
+void CStudioModelRenderer::AddNormals()
+{
+	const Color color( 255, 255, 255 );
+
+	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		if( !SetupModel( iBodyPart ) )
+			continue;
+
+		auto pnormbone = ( const byte* ) ( m_pStudioHdr->GetData() + m_pModel->norminfoindex );
+		auto ptexture = m_pTextureHdr->GetTextures();
+
+		auto pMeshes = ( const mstudiomesh_t* ) ( m_pStudioHdr->GetData() + m_pModel->meshindex );
+
+		auto pstudionorms = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + m_pModel->normindex );
+
+		auto pskinref = m_pTextureHdr->GetSkins();
+
+		const int iSkinNum = m_pRenderInfo->iSkin;
+
+		if( iSkinNum != 0 && iSkinNum < m_pTextureHdr->numskinfamilies )
+			pskinref += ( iSkinNum * m_pTextureHdr->numskinref );
+
+		m_pPoseContext->TransformVertices( m_pModel, false );
+
+		//The context's storage grows to fit the submodel, so get it again.
+		m_pxformverts = m_pPoseContext->GetTransformedVertices();
+
+		//
+		// clip and draw all triangles
+		//
+
+		glm::vec3* lv = m_pvlightvalues;
+
+		SetupBoneLightVecs();
+
+		const StudioLightingParams_t& lightingParams = m_LightingParams;
+
+		for( int j = 0; j < m_pModel->nummesh; j++ )
+		{
+			const int flags = ptexture[ pskinref[ pMeshes[ j ].skinref ] ].flags;
+
+			const int iNumNorms = pMeshes[ j ].numnorms;
+
+			LightNormals( flags, false, pstudionorms, pnormbone, m_blightvec.Get(), iNumNorms, lightingParams, lv );
+
+			if( flags & STUDIO_NF_CHROME )
+			{
+				ChromeNormals( false, pstudionorms, pnormbone, iNumNorms, m_chrome.Get() + ( lv - m_pvlightvalues ) );
+			}
+
+			lv += iNumNorms;
+			pstudionorms += iNumNorms;
+			pnormbone += iNumNorms;
+		}
+
+		//Reset
+		pstudionorms = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + m_pModel->normindex );
+
+		for( int j = 0; j < m_pModel->nummesh; j++ )
+		{
+			auto& mesh = pMeshes[ j ];
+			auto ptricmds = ( const short* ) ( m_pStudioHdr->GetData() + mesh.triindex );
+
+			const mstudiotexture_t& texture = ptexture[ pskinref[ mesh.skinref ] ];
+
+			const glm::vec3* vecTriangles[ 3 ];
+
+			int i;
+
+			while( i = *( ptricmds++ ) )
+			{
+				//Keep track of the total number of vertices. Used to invert strip normals.
+				const int total = i;
+
+				if( i < 0 )
+				{
+					i = -i;
+
+					vecTriangles[ 0 ] = &m_pxformverts[ ptricmds[ 0 ] ];
+					vecTriangles[ 1 ] = &m_pxformverts[ ptricmds[ 4 ] ];
+
+					i -= 2;
+					ptricmds += 8;
+
+					for( ; i > 0; --i, ptricmds += 4 )
+					{
+						vecTriangles[ 2 ] = &m_pxformverts[ ptricmds[ 0 ] ];
+						
+						const glm::vec3 vecCenter( ( *( vecTriangles[ 0 ] ) + *( vecTriangles[ 1 ] ) + *( vecTriangles[ 2 ] ) ) / 3.0f );
+
+						glm::vec3 vecNormal( glm::cross( *( vecTriangles[ 2 ] ) - *( vecTriangles[ 0 ] ), *( vecTriangles[ 1 ] ) - *( vecTriangles[ 0 ] ) ) );
+
+						vecNormal = glm::normalize( vecNormal );
+
+						m_DebugBatch.AddLine( vecCenter, vecCenter + vecNormal, color );
+
+						vecTriangles[ 1 ] = vecTriangles[ 2 ];
+					}
+				}
+				else
+				{
+					vecTriangles[ 0 ] = &m_pxformverts[ ptricmds[ 0 ] ];
+					vecTriangles[ 1 ] = &m_pxformverts[ ptricmds[ 4 ] ];
+
+					i -= 2;
+					ptricmds += 8;
+
+					for( ; i > 0; --i, ptricmds += 4 )
+					{
+						vecTriangles[ 2 ] = &m_pxformverts[ ptricmds[ 0 ] ];
+
+						const glm::vec3 vecCenter( ( *( vecTriangles[ 0 ] ) + *( vecTriangles[ 1 ] ) + *( vecTriangles[ 2 ] ) ) / 3.0f );
+
+						glm::vec3 vecNormal( glm::cross( *( vecTriangles[ 2 ] ) - *( vecTriangles[ 0 ] ), *( vecTriangles[ 1 ] ) - *( vecTriangles[ 0 ] ) ) );
+
+						vecNormal = glm::normalize( vecNormal );
+
+						if( ( ( i % 2 ) == 0 ) ^ ( ( total % 2 ) == 0 ) )
+							vecNormal *= -1;
+
+						m_DebugBatch.AddLine( vecCenter, vecCenter + vecNormal, color );
+
+						vecTriangles[ 0 ] = vecTriangles[ 1 ];
+						vecTriangles[ 1 ] = vecTriangles[ 2 ];
+					}
+				}
+			}
+		}
+	}
+}
+
+void CStudioModelRenderer::SetupLighting()
+{
+	PROFILE_SCOPE( "Lighting" );
+
+	m_ambientlight = 32;
+	m_shadelight = 192;
+
+	m_lightcolor[ 0 ] = r_lighting_r.GetInt();
+	m_lightcolor[ 1 ] = r_lighting_g.GetInt();
+	m_lightcolor[ 2 ] = r_lighting_b.GetInt();
+
+	//Only needed if lighting can't be reused.
+	m_bBoneLightVecsSet = false;
+
+	//Everything that's the same for every normal is worked out here, once per model.
+	m_LightingParams = GetLightingParams();
+
+	if( r_studio_lightinglut.GetBool() )
+		BuildLightingLUT( m_LightingParams );
+}
+
+void CStudioModelRenderer::SetupBoneLightVecs()
+{
+	if( m_bBoneLightVecsSet )
+		return;
+
+	glm::vec3* const pLightVecs = m_blightvec.Reserve( m_pStudioHdr->numbones );
+
+	for( int i = 0; i < m_pStudioHdr->numbones; i++ )
+	{
+		VectorIRotate( m_lightvec, m_pBoneTransforms[ i ], pLightVecs[ i ] );
+	}
+
+	m_bBoneLightVecsSet = true;
+}
+
+bool CStudioModelRenderer::SetupModel( int bodypart )
+{
+	if( bodypart > m_pStudioHdr->numbodyparts )
+	{
+		// Con_DPrintf ("CStudioModelRenderer::SetupModel: no such bodypart %d\n", bodypart);
+		bodypart = 0;
+	}
+
+	//Entities resolve their submodels when their bodygroup changes, so most models skip the lookup entirely.
+	//Validated models skip the checks, which matters since this is done for every body part of every model drawn.
+	if( m_pRenderInfo->ppSubModels && bodypart < m_pStudioHdr->numbodyparts )
+		m_pModel = m_pRenderInfo->ppSubModels[ bodypart ];
+	else if( const auto pView = m_pRenderInfo->pModel->GetValidatedView() )
+		m_pModel = pView->GetModelByBodyPart( m_pRenderInfo->iBodygroup, bodypart );
+	else
+		m_pModel = m_pRenderInfo->pModel->GetModelByBodyPart( m_pRenderInfo->iBodygroup, bodypart );
+
+	if( !m_pModel )
+		return false;
+
+	//Sized to the submodel so small models stay in cache, and submodels past the original limits can still be lit.
+	m_pvlightvalues = m_lightvalues.Reserve( m_pModel->numnorms );
+	m_chrome.Reserve( m_pModel->numnorms );
+
+	return true;
+}
+
+unsigned int CStudioModelRenderer::DrawPoints( const bool bWireframe )
+{
+	TRACE_SCOPE( "DrawPoints" );
+
+	unsigned int uiDrawnPolys = 0;
+
+	auto ptexture = m_pTextureHdr->GetTextures();
+
+	auto pskinref = m_pTextureHdr->GetSkins();
+
+	if( m_pRenderInfo->iSkin != 0 && m_pRenderInfo->iSkin < m_pTextureHdr->numskinfamilies )
+		pskinref += ( m_pRenderInfo->iSkin * m_pTextureHdr->numskinref );
+
+	m_bUseGPUSkinning = ShouldUseGPUSkinning();
+
+	const bool bUseSIMD = r_studio_simd.GetBool() && AreSIMDKernelsSupported();
+
+	PrepareSubModel( ptexture, pskinref, bUseSIMD );
+
+	//
+	// clip and draw all triangles
+	//
+
+	//Already sorted by render mode when the model was loaded.
+	size_t uiNumMeshes;
+
+	const StudioDrawMesh_t* const pMeshes = m_pRenderInfo->pModel->GetDrawList( m_pModel, m_pRenderInfo->iSkin, uiNumMeshes );
+
+	if( pMeshes )
+		uiDrawnPolys += DrawMeshes( bWireframe, pMeshes, ptexture );
+
+	GLState().DepthMask( true );
+
+	//Queued meshes have copied what they need by now. Debug drawing writes to the renderer's own arrays.
+	m_pxformverts = m_pPoseContext->GetTransformedVertices();
+	m_pvlightvalues = m_lightvalues.Get();
+	m_pchrome = m_chrome.Get();
+
+	return uiDrawnPolys;
+}
+
+void CStudioModelRenderer::PrepareSubModel( const mstudiotexture_t* pTextures, const short* pSkinRef, const bool bUseSIMD )
+{
+	//Vertices are transformed by the skinning program instead.
+	const bool bTransform = !m_bUseGPUSkinning;
+
+	if( !r_studio_reusevertices.GetBool() )
+	{
+		m_PreparedSubModels.clear();
+
+		if( bTransform )
+			m_pPoseContext->TransformVertices( m_pModel, bUseSIMD );
+
+		m_pxformverts = m_pPoseContext->GetTransformedVertices();
+
+		ComputeSubModelLighting( pTextures, pSkinRef, bUseSIMD, m_lightvalues.Get(), m_chrome.Get() );
+
+		m_pvlightvalues = m_lightvalues.Get();
+		m_pchrome = m_chrome.Get();
+		return;
+	}
+
+	PreparedSubModel_t* pPrepared = nullptr;
+	PreparedSubModel_t* pOldest = nullptr;
+
+	for( auto& prepared : m_PreparedSubModels )
+	{
+		if( IsPreparedSubModelValid( prepared, pTextures, pSkinRef, bUseSIMD ) )
+		{
+			pPrepared = &prepared;
+			break;
+		}
+
+		const bool bCurrent = prepared.uiFrame == m_uiFrameCount;
+
+		//Entries from earlier frames are replaced first, then the least recently used.
+		if( !pOldest ||
+			( !bCurrent && pOldest->uiFrame == m_uiFrameCount ) ||
+			( bCurrent == ( pOldest->uiFrame == m_uiFrameCount ) && prepared.uiLastUsed < pOldest->uiLastUsed ) )
+			pOldest = &prepared;
+	}
+
+	if( pPrepared )
+	{
+		PROFILE_COUNT( "Prepared submodels reused", 1 );
+	}
+	else
+	{
+		if( m_PreparedSubModels.size() < MAX_PREPARED_SUBMODELS )
+		{
+			m_PreparedSubModels.emplace_back();
+			pOldest = &m_PreparedSubModels.back();
+		}
+
+		pPrepared = pOldest;
+
+		pPrepared->uiPoseSerial = m_pPoseContext->GetSerial();
+		pPrepared->pModel = m_pModel;
+		pPrepared->pSkinRef = pSkinRef;
+		pPrepared->bTransformed = bTransform;
+		pPrepared->bUseSIMD = bUseSIMD;
+		pPrepared->vecLightVec = m_lightvec;
+		pPrepared->lightColor[ 0 ] = m_lightcolor.GetRed();
+		pPrepared->lightColor[ 1 ] = m_lightcolor.GetGreen();
+		pPrepared->lightColor[ 2 ] = m_lightcolor.GetBlue();
+		pPrepared->flLambert = m_flLambert;
+		pPrepared->iAmbientLight = m_ambientlight;
+		pPrepared->flShadeLight = m_shadelight;
+		pPrepared->bLightingLUT = m_LightingParams.bHasLUT;
+		pPrepared->vecViewerOrigin = m_vecViewerOrigin;
+		pPrepared->vecViewerRight = m_vecViewerRight;
+
+		const mstudiomesh_t* const pMeshes = ( const mstudiomesh_t* ) ( ( const byte* ) m_pStudioHdr + m_pModel->meshindex );
+
+		pPrepared->meshFlags.resize( m_pModel->nummesh );
+
+		pPrepared->bHasChrome = false;
+
+		for( int j = 0; j < m_pModel->nummesh; ++j )
+		{
+			pPrepared->meshFlags[ j ] = pTextures[ pSkinRef[ pMeshes[ j ].skinref ] ].flags;
+
+			if( pPrepared->meshFlags[ j ] & STUDIO_NF_CHROME )
+				pPrepared->bHasChrome = true;
+		}
+
+		if( bTransform )
+		{
+			m_pPoseContext->TransformVertices( m_pModel, bUseSIMD );
+
+			const glm::vec3* pVerts = m_pPoseContext->GetTransformedVertices();
+
+			pPrepared->xformVerts.assign( pVerts, pVerts + m_pModel->numverts );
+		}
+		else
+		{
+			pPrepared->xformVerts.clear();
+		}
+
+		pPrepared->lightValues.resize( m_pModel->numnorms );
+		pPrepared->chrome.resize( m_pModel->numnorms );
+
+		ComputeSubModelLighting( pTextures, pSkinRef, bUseSIMD, pPrepared->lightValues.data(), pPrepared->chrome.data() );
+	}
+
+	pPrepared->uiFrame = m_uiFrameCount;
+	pPrepared->uiLastUsed = m_uiModelsDrawnCount;
+
+	//Skinned on the GPU; positions aren't read.
+	m_pxformverts = bTransform ? pPrepared->xformVerts.data() : m_pPoseContext->GetTransformedVertices();
+	m_pvlightvalues = pPrepared->lightValues.data();
+	m_pchrome = pPrepared->chrome.data();
+}
+
+bool CStudioModelRenderer::IsPreparedSubModelValid( const PreparedSubModel_t& prepared, const mstudiotexture_t* pTextures, const short* pSkinRef, const bool bUseSIMD ) const
+{
+	//Nothing that depends on the frame is stored, so paused models with a static light and view reuse results across frames.
+	if( prepared.uiPoseSerial != m_pPoseContext->GetSerial() ||
+		prepared.pModel != m_pModel ||
+		prepared.pSkinRef != pSkinRef ||
+		prepared.bTransformed != !m_bUseGPUSkinning ||
+		prepared.bUseSIMD != bUseSIMD ||
+		prepared.vecLightVec != m_lightvec ||
+		prepared.lightColor[ 0 ] != m_lightcolor.GetRed() ||
+		prepared.lightColor[ 1 ] != m_lightcolor.GetGreen() ||
+		prepared.lightColor[ 2 ] != m_lightcolor.GetBlue() ||
+		prepared.flLambert != m_flLambert ||
+		prepared.iAmbientLight != m_ambientlight ||
+		prepared.flShadeLight != m_shadelight ||
+		prepared.bLightingLUT != m_LightingParams.bHasLUT )
+		return false;
+
+	//Only chrome depends on the viewer, so views with different cameras share results for models without it.
+	if( prepared.bHasChrome && ( prepared.vecViewerOrigin != m_vecViewerOrigin || prepared.vecViewerRight != m_vecViewerRight ) )
+		return false;
+
+	const mstudiomesh_t* const pMeshes = ( const mstudiomesh_t* ) ( ( const byte* ) m_pStudioHdr + m_pModel->meshindex );
+
+	for( int j = 0; j < m_pModel->nummesh; ++j )
+	{
+		if( prepared.meshFlags[ j ] != pTextures[ pSkinRef[ pMeshes[ j ].skinref ] ].flags )
+			return false;
+	}
+
+	return true;
+}
+
+void CStudioModelRenderer::ComputeSubModelLighting( const mstudiotexture_t* pTextures, const short* pSkinRef, const bool bUseSIMD, glm::vec3* pLightValues, glm::vec2* pChrome )
+{
+	auto pnormbone = ( ( const byte* ) m_pStudioHdr + m_pModel->norminfoindex );
+
+	auto pmesh = ( const mstudiomesh_t* ) ( ( const byte* ) m_pStudioHdr + m_pModel->meshindex );
+
+	auto pstudionorms = ( const glm::vec3* ) ( ( const byte* ) m_pStudioHdr + m_pModel->normindex );
+
+	const StudioLightingParams_t& lightingParams = m_LightingParams;
+
+	SetupBoneLightVecs();
+
+	glm::vec3* lv = pLightValues;
+
+	for( int j = 0; j < m_pModel->nummesh; j++ )
+	{
+		const int flags = pTextures[ pSkinRef[ pmesh[ j ].skinref ] ].flags;
+
+		const int iNumNorms = pmesh[ j ].numnorms;
+
+		{
+			PROFILE_SCOPE( "Lighting" );
+			LightNormals( flags, bUseSIMD, pstudionorms, pnormbone, m_blightvec.Get(), iNumNorms, lightingParams, lv );
+		}
+
+		if( flags & STUDIO_NF_CHROME )
+		{
+			PROFILE_SCOPE( "Chrome" );
+			ChromeNormals( bUseSIMD, pstudionorms, pnormbone, iNumNorms, &pChrome[ lv - pLightValues ] );
+		}
+
+		lv += iNumNorms;
+		pstudionorms += iNumNorms;
+		pnormbone += iNumNorms;
+	}
+}
+
+unsigned int CStudioModelRenderer::DrawMeshes( const bool bWireframe, const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures )
+{
+	PROFILE_SCOPE( "Mesh submission" );
+
+	//Set here since it never changes. Much more efficient.
+	if( bWireframe )
+		glColor4f( r_wireframecolor_r.GetFloat() / 255.0f,
+				   r_wireframecolor_g.GetFloat() / 255.0f,
+				   r_wireframecolor_b.GetFloat() / 255.0f,
+				   m_pRenderInfo->flTransparency );
+
+	unsigned int uiDrawnPolys = 0;
+
+	//Polygons may overlap, so make sure they can blend together. - Solokiller
+	glDepthFunc( GL_LEQUAL );
+
+	const bool bUseMeshBuffers = ShouldUseMeshBuffers();
+
+	//Wireframe passes are overlays, so they're always drawn right away.
+	if( m_bQueueing && bUseMeshBuffers && !bWireframe )
+		return QueueMeshes( pMeshes, pTextures );
+
+	if( bUseMeshBuffers )
+		BeginMeshBuffers( bWireframe, pMeshes, pTextures );
+
+	size_t uiVertexOffset = 0;
+
+	for( int j = 0; j < m_pModel->nummesh; j++ )
+	{
+		auto pmesh = pMeshes[ j ].pMesh;
+
+		const mstudiotexture_t& texture = pTextures[ pMeshes[ j ].iTexture ];
+
+		if( texture.flags & STUDIO_NF_ADDITIVE )
+			GLState().DepthMask( false );
+		else
+			GLState().DepthMask( true );
+
+		if( texture.flags & STUDIO_NF_ADDITIVE )
+		{
+			GLState().Enable( GL_BLEND );
+			GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE );
+		}
+		else if( m_pRenderInfo->flTransparency < 1.0f )
+		{
+			GLState().Enable( GL_BLEND );
+			GLState().BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		}
+		else
+			GLState().Disable( GL_BLEND );
 
-	for( int i = 0; i < m_pStudioHdr->numbones; i++ )
-	{
-		QuaternionMatrix( q[ i ], bonematrix );
+		if( texture.flags & STUDIO_NF_MASKED )
+		{
+			GLState().Enable( GL_ALPHA_TEST );
+			GLState().AlphaFunc( GL_GREATER, 0.5f );
+		}
 
-		bonematrix[ 0 ][ 3 ] = pos[ i ][ 0 ];
-		bonematrix[ 1 ][ 3 ] = pos[ i ][ 1 ];
-		bonematrix[ 2 ][ 3 ] = pos[ i ][ 2 ];
+		if( !bWireframe )
+		{
+			GLState().BindTexture2D( m_pRenderInfo->pModel->GetTextureId( pMeshes[ j ].iTexture ) );
+		}
 
-		if( pbones[ i ].parent == -1 )
+		if( bUseMeshBuffers )
 		{
-			m_bonetransform[ i ] = bonematrix;
+			if( auto pBuffer = m_pRenderInfo->pModel->GetMeshBuffer( pmesh ) )
+			{
+				uiDrawnPolys += DrawMeshBuffer( bWireframe, *pBuffer, uiVertexOffset );
+				uiVertexOffset += pBuffer->uiNumVertices;
+			}
 		}
 		else
 		{
-			R_ConcatTransforms( m_bonetransform[ pbones[ i ].parent ], bonematrix, m_bonetransform[ i ] );
+			uiDrawnPolys += DrawMeshImmediate( bWireframe, pmesh, texture );
 		}
-	}
-}
 
-void CStudioModelRenderer::CalcRotations( glm::vec3* pos, glm::vec4* q, const mstudioseqdesc_t* const pseqdesc, const mstudioanim_t* panim, const float f )
-{
-	const int frame = ( int ) f;
-	const float s = ( f - frame );
-
-	// add in programatic controllers
-	CalcBoneAdj();
+		if( texture.flags & STUDIO_NF_MASKED )
+			GLState().Disable( GL_ALPHA_TEST );
+	}
 
-	auto pbone = m_pStudioHdr->GetBones();
+	if( bUseMeshBuffers )
+		EndMeshBuffers();
 
-	for( int i = 0; i < m_pStudioHdr->numbones; i++, pbone++, panim++ )
-	{
-		CalcBoneQuaternion( frame, s, pbone, panim, q[ i ] );
-		CalcBonePosition( frame, s, pbone, panim, pos[ i ] );
-	}
+	return uiDrawnPolys;
+}
 
-	if( pseqdesc->motiontype & STUDIO_X )
-		pos[ pseqdesc->motionbone ][ 0 ] = 0.0;
-	if( pseqdesc->motiontype & STUDIO_Y )
-		pos[ pseqdesc->motionbone ][ 1 ] = 0.0;
-	if( pseqdesc->motiontype & STUDIO_Z )
-		pos[ pseqdesc->motionbone ][ 2 ] = 0.0;
+bool CStudioModelRenderer::ShouldUseMeshBuffers() const
+{
+	return r_studio_vbo.GetBool() && GLEW_VERSION_1_5 && m_pRenderInfo->pModel->GetIndexBuffer() != 0;
 }
 
-void CStudioModelRenderer::CalcBoneAdj()
+bool CStudioModelRenderer::ShouldUseGPUSkinning()
 {
-	const auto* const pbonecontroller = m_pStudioHdr->GetBoneControllers();
+	if( !r_studio_gpuskinning.GetBool() || !ShouldUseMeshBuffers() || m_pRenderInfo->pModel->GetSkinVertexBuffer() == 0 )
+		return false;
 
-	for( int j = 0; j < m_pStudioHdr->numbonecontrollers; j++ )
+	if( !m_bSkinningInitialized )
 	{
-		const auto i = pbonecontroller[ j ].index;
+		m_bSkinningInitialized = true;
 
-		float value;
+		if( !GLEW_VERSION_2_0 )
+			return false;
 
-		if( i <= 3 )
-		{
-			// check for 360% wrapping
-			if( pbonecontroller[ j ].type & STUDIO_RLOOP )
-			{
-				value = m_pRenderInfo->iController[ i ] * ( 360.0 / 256.0 ) + pbonecontroller[ j ].start;
-			}
-			else
-			{
-				value = m_pRenderInfo->iController[ i ] / 255.0;
-				if( value < 0 ) value = 0;
-				if( value > 1.0 ) value = 1.0;
-				value = ( 1.0 - value ) * pbonecontroller[ j ].start + value * pbonecontroller[ j ].end;
-			}
-			// Con_DPrintf( "%d %d %f : %f\n", m_controller[j], m_prevcontroller[j], value, dadt );
-		}
-		else
+		GLint iMaxComponents = 0;
+
+		glGetIntegerv( GL_MAX_VERTEX_UNIFORM_COMPONENTS, &iMaxComponents );
+
+		if( iMaxComponents < MAXSTUDIOBONES * 3 * 4 )
 		{
-			value = m_pRenderInfo->iMouth / 64.0;
-			if( value > 1.0 ) value = 1.0;
-			value = ( 1.0 - value ) * pbonecontroller[ j ].start + value * pbonecontroller[ j ].end;
-			// Con_DPrintf("%d %f\n", mouthopen, value );
+			Message( "CStudioModelRenderer: Not enough vertex uniforms for GPU skinning (%d available), using CPU skinning\n", iMaxComponents );
+			return false;
 		}
-		switch( pbonecontroller[ j ].type & STUDIO_TYPES )
+
+		if( m_SkinningProgram.Create( SKINNING_VERTEX_SHADER, nullptr ) )
 		{
-		case STUDIO_XR:
-		case STUDIO_YR:
-		case STUDIO_ZR:
-			m_Adj[ j ] = value * ( Q_PI / 180.0 );
-			break;
-		case STUDIO_X:
-		case STUDIO_Y:
-		case STUDIO_Z:
-			m_Adj[ j ] = value;
-			break;
+			m_iBonesUniform = m_SkinningProgram.GetUniformLocation( "bones" );
+			m_iPositionScaleUniform = m_SkinningProgram.GetUniformLocation( "positionScale" );
+			m_iPositionOriginUniform = m_SkinningProgram.GetUniformLocation( "positionOrigin" );
 		}
 	}
+
+	return m_SkinningProgram.Exists();
 }
 
-void CStudioModelRenderer::CalcBoneQuaternion( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, glm::vec4& q )
+template<bool CHROME, bool ADDITIVE, bool SKIN_ON_GPU>
+void CStudioModelRenderer::BuildMeshVertices( const StudioMeshVertex_t* pVertices, const size_t uiCount, const float s, const float t, StudioVertex_t* pOut ) const
 {
-	glm::vec3			angle1, angle2;
+	const float flTransparency = m_pRenderInfo->flTransparency;
 
-	for( int j = 0; j < 3; j++ )
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		if( panim->offset[ j + 3 ] == 0 )
-		{
-			angle2[ j ] = angle1[ j ] = pbone->value[ j + 3 ]; // default;
-		}
-		else
-		{
-			auto panimvalue = ( const mstudioanimvalue_t* ) ( ( const byte* ) panim + panim->offset[ j + 3 ] );
-			auto k = frame;
-			while( panimvalue->num.total <= k )
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-			}
-			// Bah, missing blend!
-			if( panimvalue->num.valid > k )
-			{
-				angle1[ j ] = panimvalue[ k + 1 ].value;
-
-				if( panimvalue->num.valid > k + 1 )
-				{
-					angle2[ j ] = panimvalue[ k + 2 ].value;
-				}
-				else
-				{
-					if( panimvalue->num.total > k + 1 )
-						angle2[ j ] = angle1[ j ];
-					else
-						angle2[ j ] = panimvalue[ panimvalue->num.valid + 2 ].value;
-				}
-			}
-			else
-			{
-				angle1[ j ] = panimvalue[ panimvalue->num.valid ].value;
-				if( panimvalue->num.total > k + 1 )
-				{
-					angle2[ j ] = angle1[ j ];
-				}
-				else
-				{
-					angle2[ j ] = panimvalue[ panimvalue->num.valid + 2 ].value;
-				}
-			}
-			angle1[ j ] = pbone->value[ j + 3 ] + angle1[ j ] * pbone->scale[ j + 3 ];
-			angle2[ j ] = pbone->value[ j + 3 ] + angle2[ j ] * pbone->scale[ j + 3 ];
-		}
+		const StudioMeshVertex_t& vertex = pVertices[ uiIndex ];
+		StudioVertex_t& out = pOut[ uiIndex ];
 
-		if( pbone->bonecontroller[ j + 3 ] != -1 )
-		{
-			angle1[ j ] += m_Adj[ pbone->bonecontroller[ j + 3 ] ];
-			angle2[ j ] += m_Adj[ pbone->bonecontroller[ j + 3 ] ];
-		}
-	}
+		//Positions are computed by the skinning program instead.
+		if( !SKIN_ON_GPU )
+			out.vecPosition = m_pxformverts[ vertex.vertindex ];
 
-	if( !VectorCompare( angle1, angle2 ) )
-	{
-		glm::vec4 q1, q2;
+		if( CHROME )
+			out.vecTexCoord = glm::vec2( m_pchrome[ vertex.normindex ][ 0 ] * s, m_pchrome[ vertex.normindex ][ 1 ] * t );
+		else
+			out.vecTexCoord = glm::vec2( vertex.s * s, vertex.t * t );
 
-		AngleQuaternion( angle1, q1 );
-		AngleQuaternion( angle2, q2 );
-		QuaternionSlerp( q1, q2, s, q );
-	}
-	else
-	{
-		AngleQuaternion( angle1, q );
+		if( ADDITIVE )
+			out.vecColor = glm::vec4( 1.0f, 1.0f, 1.0f, flTransparency );
+		else
+			out.vecColor = glm::vec4( m_pvlightvalues[ vertex.normindex ], flTransparency );
 	}
 }
 
-void CStudioModelRenderer::CalcBonePosition( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, glm::vec3& pos )
+void CStudioModelRenderer::GatherMeshVertices( const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures, StudioVertices_t& vertices ) const
 {
-	for( int j = 0; j < 3; j++ )
+	typedef void ( CStudioModelRenderer::*BuildMeshVerticesFn )( const StudioMeshVertex_t*, const size_t, const float, const float, StudioVertex_t* ) const;
+
+	//Indexed by chrome | additive << 1 | skin on GPU << 2.
+	static const BuildMeshVerticesFn BUILD_FUNCTIONS[] = 
 	{
-		pos[ j ] = pbone->value[ j ]; // default;
-		if( panim->offset[ j ] != 0 )
-		{
-			auto panimvalue = ( mstudioanimvalue_t * ) ( ( byte * ) panim + panim->offset[ j ] );
+		&CStudioModelRenderer::BuildMeshVertices<false, false, false>,
+		&CStudioModelRenderer::BuildMeshVertices<true, false, false>,
+		&CStudioModelRenderer::BuildMeshVertices<false, true, false>,
+		&CStudioModelRenderer::BuildMeshVertices<true, true, false>,
+		&CStudioModelRenderer::BuildMeshVertices<false, false, true>,
+		&CStudioModelRenderer::BuildMeshVertices<true, false, true>,
+		&CStudioModelRenderer::BuildMeshVertices<false, true, true>,
+		&CStudioModelRenderer::BuildMeshVertices<true, true, true>
+	};
 
-			auto k = frame;
-			// find span of values that includes the frame we want
-			while( panimvalue->num.total <= k )
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-			}
-			// if we're inside the span
-			if( panimvalue->num.valid > k )
-			{
-				// and there's more data in the span
-				if( panimvalue->num.valid > k + 1 )
-				{
-					pos[ j ] += ( panimvalue[ k + 1 ].value * ( 1.0 - s ) + s * panimvalue[ k + 2 ].value ) * pbone->scale[ j ];
-				}
-				else
-				{
-					pos[ j ] += panimvalue[ k + 1 ].value * pbone->scale[ j ];
-				}
-			}
-			else
-			{
-				// are we at the end of the repeating values section and there's another section with data?
-				if( panimvalue->num.total <= k + 1 )
-				{
-					pos[ j ] += ( panimvalue[ panimvalue->num.valid ].value * ( 1.0 - s ) + s * panimvalue[ panimvalue->num.valid + 2 ].value ) * pbone->scale[ j ];
-				}
-				else
-				{
-					pos[ j ] += panimvalue[ panimvalue->num.valid ].value * pbone->scale[ j ];
-				}
-			}
-		}
-		if( pbone->bonecontroller[ j ] != -1 )
-		{
-			pos[ j ] += m_Adj[ pbone->bonecontroller[ j ] ];
-		}
-	}
-}
+	const CStudioModel* const pStudioModel = m_pRenderInfo->pModel;
 
-void CStudioModelRenderer::SlerpBones( glm::vec4* q1, glm::vec3* pos1, glm::vec4* q2, glm::vec3* pos2, float s )
-{
-	glm::vec4 q3;
+	const StudioMeshVertex_t* const pMeshVertices = pStudioModel->GetMeshVertices();
 
-	if( s < 0 ) s = 0;
-	else if( s > 1.0 ) s = 1.0;
+	//Gather the skinned vertices of all meshes in draw order so the whole model is uploaded at once.
+	for( int j = 0; j < m_pModel->nummesh; j++ )
+	{
+		auto pmesh = pMeshes[ j ].pMesh;
 
-	const float s1 = 1.0 - s;
+		auto pBuffer = pStudioModel->GetMeshBuffer( pmesh );
 
-	for( int i = 0; i < m_pStudioHdr->numbones; i++ )
-	{
-		QuaternionSlerp( q1[ i ], q2[ i ], s, q3 );
-		q1[ i ] = q3;
+		if( !pBuffer )
+			continue;
+
+		const mstudiotexture_t& texture = pTextures[ pMeshes[ j ].iTexture ];
+
+		const float s = 1.0f / ( float ) texture.width;
+		const float t = 1.0f / ( float ) texture.height;
+
+		const size_t uiFunction = 
+			( ( texture.flags & STUDIO_NF_CHROME ) ? 1 : 0 ) | 
+			( ( texture.flags & STUDIO_NF_ADDITIVE ) ? 2 : 0 ) | 
+			( m_bUseGPUSkinning ? 4 : 0 );
 
-		pos1[ i ] = pos1[ i ] * s1 + pos2[ i ] * s;
+		const size_t uiFirst = vertices.size();
+
+		vertices.resize( uiFirst + pBuffer->uiNumVertices );
+
+		( this->*BUILD_FUNCTIONS[ uiFunction ] )( pMeshVertices + pBuffer->uiFirstVertex, pBuffer->uiNumVertices, s, t, vertices.data() + uiFirst );
 	}
 }
 
-void CStudioModelRenderer::SetupLighting()
+unsigned int CStudioModelRenderer::QueueMeshes( const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures )
 {
-	m_ambientlight = 32;
-	m_shadelight = 192;
+	const CStudioModel* const pStudioModel = m_pRenderInfo->pModel;
 
-	m_lightcolor[ 0 ] = r_lighting_r.GetInt();
-	m_lightcolor[ 1 ] = r_lighting_g.GetInt();
-	m_lightcolor[ 2 ] = r_lighting_b.GetInt();
+	size_t uiVertexOffset = m_QueuedVertexData.size();
 
-	for( int i = 0; i < m_pStudioHdr->numbones; i++ )
+	GatherMeshVertices( pMeshes, pTextures, m_QueuedVertexData );
+
+	//All bodyparts of a model share its palette.
+	if( m_bUseGPUSkinning && m_uiQueuedPalette == INVALID_PALETTE )
 	{
-		VectorIRotate( m_lightvec, m_bonetransform[ i ], m_blightvec[ i ] );
+		m_uiQueuedPalette = m_QueuedBones.size();
+		m_QueuedBones.insert( m_QueuedBones.end(), m_pBoneTransforms, m_pBoneTransforms + m_pStudioHdr->numbones );
 	}
-}
 
-void CStudioModelRenderer::SetupModel( int bodypart )
-{
-	if( bodypart > m_pStudioHdr->numbodyparts )
+	unsigned int uiDrawnPolys = 0;
+
+	for( int j = 0; j < m_pModel->nummesh; j++ )
 	{
-		// Con_DPrintf ("CStudioModelRenderer::SetupModel: no such bodypart %d\n", bodypart);
-		bodypart = 0;
+		auto pmesh = pMeshes[ j ].pMesh;
+
+		auto pBuffer = pStudioModel->GetMeshBuffer( pmesh );
+
+		if( !pBuffer )
+			continue;
+
+		const mstudiotexture_t& texture = pTextures[ pMeshes[ j ].iTexture ];
+
+		QueuedMesh_t mesh;
+
+		mesh.matModelView = m_matQueuedModelView;
+		mesh.pModel = pStudioModel;
+		mesh.pass = GetMeshRenderPass( texture.flags, m_pRenderInfo->flTransparency );
+		mesh.textureId = pStudioModel->GetTextureId( pMeshes[ j ].iTexture );
+		mesh.flags = texture.flags;
+		mesh.flTransparency = m_pRenderInfo->flTransparency;
+		mesh.cullFace = m_QueuedCullFace;
+		mesh.bCullFace = m_bQueuedCullFace;
+		mesh.uiVertexOffset = uiVertexOffset;
+		mesh.pSkinBuffer = pBuffer;
+		const StudioMeshLod_t lod = pBuffer->GetLod( m_iLod );
+
+		mesh.uiFirstIndex = lod.uiFirstIndex;
+		mesh.uiNumIndices = lod.uiNumIndices;
+		mesh.uiFirstBone = m_bUseGPUSkinning ? m_uiQueuedPalette : INVALID_PALETTE;
+		mesh.iNumBones = m_pStudioHdr->numbones;
+
+		m_RenderQueue.push_back( mesh );
+
+		uiVertexOffset += pBuffer->uiNumVertices;
+		uiDrawnPolys += static_cast<unsigned int>( lod.uiNumIndices / 3 );
 	}
 
-	m_pModel = m_pRenderInfo->pModel->GetModelByBodyPart( m_pRenderInfo->iBodygroup, bodypart );
+	return uiDrawnPolys;
 }
 
-unsigned int CStudioModelRenderer::DrawPoints( const bool bWireframe )
+void CStudioModelRenderer::BeginMeshBuffers( const bool bWireframe, const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures )
 {
-	unsigned int uiDrawnPolys = 0;
+	const CStudioModel* const pStudioModel = m_pRenderInfo->pModel;
 
-	auto pvertbone = ( ( byte * ) m_pStudioHdr + m_pModel->vertinfoindex );
-	auto pnormbone = ( ( byte * ) m_pStudioHdr + m_pModel->norminfoindex );
-	auto ptexture = m_pTextureHdr->GetTextures();
+	m_MeshVertexData.clear();
 
-	auto pmesh = ( mstudiomesh_t * ) ( ( byte * ) m_pStudioHdr + m_pModel->meshindex );
+	GatherMeshVertices( pMeshes, pTextures, m_MeshVertexData );
 
-	auto pstudioverts = ( const glm::vec3* ) ( ( const byte* ) m_pStudioHdr + m_pModel->vertindex );
-	auto pstudionorms = ( const glm::vec3* ) ( ( const byte* ) m_pStudioHdr + m_pModel->normindex );
+	//Leaves the stream bound.
+	m_uiVertexStreamOffset = m_VertexStream.Upload( m_MeshVertexData.data(), m_MeshVertexData.size() * sizeof( StudioVertex_t ), sizeof( StudioVertex_t ) );
 
-	auto pskinref = m_pTextureHdr->GetSkins();
+	m_DrawStats.uiUploadedBytes += m_MeshVertexData.size() * sizeof( StudioVertex_t );
 
-	if( m_pRenderInfo->iSkin != 0 && m_pRenderInfo->iSkin < m_pTextureHdr->numskinfamilies )
-		pskinref += ( m_pRenderInfo->iSkin * m_pTextureHdr->numskinref );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, pStudioModel->GetIndexBuffer() );
+
+	glEnableClientState( GL_VERTEX_ARRAY );
 
-	for( int i = 0; i < m_pModel->numverts; i++ )
+	if( m_bUseGPUSkinning )
 	{
-		VectorTransform( pstudioverts[ i ], m_bonetransform[ pvertbone[ i ] ], m_pxformverts[ i ] );
+		m_SkinningProgram.Bind();
+
+		//Each bone matrix is stored as 3 rows of 4 floats, which is exactly how the program expects it.
+		glUniform4fv( m_iBonesUniform, m_pStudioHdr->numbones * 3, glm::value_ptr( m_pBoneTransforms[ 0 ] ) );
 	}
 
-	SortedMesh_t meshes[ MAXSTUDIOMESHES ];
+	//Wireframe uses a single color set by the caller.
+	if( !bWireframe )
+	{
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+	}
+}
 
-	//
-	// clip and draw all triangles
-	//
+void CStudioModelRenderer::EndMeshBuffers()
+{
+	if( m_bUseGPUSkinning )
+		m_SkinningProgram.Unbind();
 
-	glm::vec3* lv = m_pvlightvalues;
-	for( int j = 0; j < m_pModel->nummesh; j++ )
-	{
-		int flags = ptexture[ pskinref[ pmesh[ j ].skinref ] ].flags;
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
 
-		meshes[ j ].pMesh = &pmesh[ j ];
-		meshes[ j ].flags = flags;
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
 
-		for( int i = 0; i < pmesh[ j ].numnorms; i++, ++lv, ++pstudionorms, pnormbone++ )
-		{
-			Lighting( *lv, *pnormbone, flags, *pstudionorms );
+void CStudioModelRenderer::SetSkinVertexPointer( const CStudioModel& model, const StudioMeshBuffer_t& buffer, const GLint iScaleUniform, const GLint iOriginUniform )
+{
+	const StudioVertexQuantization_t& quantization = model.GetVertexQuantization( buffer.pModel );
 
-			// FIX: move this check out of the inner loop
-			if( flags & STUDIO_NF_CHROME )
-				Chrome( m_chrome[ reinterpret_cast<glm::vec3*>( lv ) - m_pvlightvalues ], *pnormbone, *pstudionorms );
-		}
+	glUniform3fv( iScaleUniform, 1, glm::value_ptr( quantization.vecScale ) );
+	glUniform3fv( iOriginUniform, 1, glm::value_ptr( quantization.vecOrigin ) );
+
+	const size_t uiBase = buffer.uiFirstVertex * model.GetSkinVertexSize();
+
+	//Integer positions aren't normalized, so the program gets the same values that were quantized.
+	if( model.HasCompactVertices() )
+		glVertexPointer( 4, GL_SHORT, sizeof( StudioCompactSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioCompactSkinVertex_t, iPosition ) ) );
+	else
+		glVertexPointer( 4, GL_FLOAT, sizeof( StudioSkinVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioSkinVertex_t, vecPosition ) ) );
+}
+
+unsigned int CStudioModelRenderer::DrawMeshBuffer( const bool bWireframe, const StudioMeshBuffer_t& buffer, const size_t uiVertexOffset )
+{
+	const size_t uiBase = m_uiVertexStreamOffset + uiVertexOffset * sizeof( StudioVertex_t );
+
+	if( m_bUseGPUSkinning )
+	{
+		//Model space positions and bone indices come from the model's static buffer.
+		glBindBuffer( GL_ARRAY_BUFFER, m_pRenderInfo->pModel->GetSkinVertexBuffer() );
+		SetSkinVertexPointer( *m_pRenderInfo->pModel, buffer, m_iPositionScaleUniform, m_iPositionOriginUniform );
+		glBindBuffer( GL_ARRAY_BUFFER, m_VertexStream.GetBuffer() );
+	}
+	else
+	{
+		glVertexPointer( 3, GL_FLOAT, sizeof( StudioVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioVertex_t, vecPosition ) ) );
+	}
+
+	if( !bWireframe )
+	{
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( StudioVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioVertex_t, vecTexCoord ) ) );
+		glColorPointer( 4, GL_FLOAT, sizeof( StudioVertex_t ), reinterpret_cast<const void*>( uiBase + offsetof( StudioVertex_t, vecColor ) ) );
 	}
 
-	//Sort meshes by render modes so additive meshes are drawn after solid meshes.
-	//Masked meshes are drawn before solid meshes.
-	std::stable_sort( meshes, meshes + m_pModel->nummesh, CompareSortedMeshes );
+	const StudioMeshLod_t lod = buffer.GetLod( m_iLod );
 
-	uiDrawnPolys += DrawMeshes( bWireframe, meshes, ptexture, pskinref );
+	glDrawElements( GL_TRIANGLES, static_cast<GLsizei>( lod.uiNumIndices ), GL_UNSIGNED_INT, reinterpret_cast<const void*>( lod.uiFirstIndex * sizeof( GLuint ) ) );
 
-	glDepthMask( GL_TRUE );
+	PROFILE_COUNT( "Draw calls", 1 );
 
-	return uiDrawnPolys;
+	++m_DrawStats.uiDrawCalls;
+	m_DrawStats.uiVertices += static_cast<uint32_t>( lod.uiNumIndices );
+
+	return static_cast<unsigned int>( lod.uiNumIndices / 3 );
 }
 
-unsigned int CStudioModelRenderer::DrawMeshes( const bool bWireframe, const SortedMesh_t* pMeshes, const mstudiotexture_t* pTextures, const short* pSkinRef )
+template<bool WIREFRAME, bool CHROME, bool ADDITIVE>
+unsigned int CStudioModelRenderer::DrawMeshImmediate( const mstudiomesh_t* pMesh, const mstudiotexture_t& texture )
 {
-	//Set here since it never changes. Much more efficient.
-	if( bWireframe )
-		glColor4f( r_wireframecolor_r.GetFloat() / 255.0f,
-				   r_wireframecolor_g.GetFloat() / 255.0f,
-				   r_wireframecolor_b.GetFloat() / 255.0f,
-				   m_pRenderInfo->flTransparency );
-
 	unsigned int uiDrawnPolys = 0;
+	unsigned int uiDrawCalls = 0;
 
-	//Polygons may overlap, so make sure they can blend together. - Solokiller
-	glDepthFunc( GL_LEQUAL );
-
-	for( int j = 0; j < m_pModel->nummesh; j++ )
-	{
-		auto pmesh = pMeshes[ j ].pMesh;
-		auto ptricmds = ( short * ) ( ( byte * ) m_pStudioHdr + pmesh->triindex );
+	auto ptricmds = ( short * ) ( ( byte * ) m_pStudioHdr + pMesh->triindex );
 
-		const mstudiotexture_t& texture = pTextures[ pSkinRef[ pmesh->skinref ] ];
+	const auto s = 1.0 / ( float ) texture.width;
+	const auto t = 1.0 / ( float ) texture.height;
 
-		const auto s = 1.0 / ( float ) texture.width;
-		const auto t = 1.0 / ( float ) texture.height;
+	const float flTransparency = m_pRenderInfo->flTransparency;
 
-		if( texture.flags & STUDIO_NF_ADDITIVE )
-			glDepthMask( GL_FALSE );
-		else
-			glDepthMask( GL_TRUE );
+	int i;
 
-		if( texture.flags & STUDIO_NF_ADDITIVE )
-		{
-			glEnable( GL_BLEND );
-			glBlendFunc( GL_SRC_ALPHA, GL_ONE );
-		}
-		else if( m_pRenderInfo->flTransparency < 1.0f )
+	while( i = *( ptricmds++ ) )
+	{
+		if( i < 0 )
 		{
-			glEnable( GL_BLEND );
-			glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+			glBegin( GL_TRIANGLE_FAN );
+			i = -i;
 		}
 		else
-			glDisable( GL_BLEND );
-
-		if( texture.flags & STUDIO_NF_MASKED )
-		{
-			glEnable( GL_ALPHA_TEST );
-			glAlphaFunc( GL_GREATER, 0.5f );
-		}
-
-		if( !bWireframe )
 		{
-			glBindTexture( GL_TEXTURE_2D, m_pRenderInfo->pModel->GetTextureId( pSkinRef[ pmesh->skinref ] ) );
+			glBegin( GL_TRIANGLE_STRIP );
 		}
 
-		int i;
+		++uiDrawCalls;
 
-		while( i = *( ptricmds++ ) )
-		{
-			if( i < 0 )
-			{
-				glBegin( GL_TRIANGLE_FAN );
-				i = -i;
-			}
-			else
-			{
-				glBegin( GL_TRIANGLE_STRIP );
-			}
+		uiDrawnPolys += i - 2;
 
-			uiDrawnPolys += i - 2;
+		m_DrawStats.uiVertices += i;
 
-			for( ; i > 0; i--, ptricmds += 4 )
+		for( ; i > 0; i--, ptricmds += 4 )
+		{
+			if( !WIREFRAME )
 			{
-				if( !bWireframe )
+				if( CHROME )
 				{
-					if( texture.flags & STUDIO_NF_CHROME )
-					{
-						glTexCoord2f( m_chrome[ ptricmds[ 1 ] ][ 0 ] * s, m_chrome[ ptricmds[ 1 ] ][ 1 ] * t );
-					}
-					else
-					{
-						glTexCoord2f( ptricmds[ 2 ] * s, ptricmds[ 3 ] * t );
-					}
-
-					if( texture.flags & STUDIO_NF_ADDITIVE )
-					{
-						glColor4f( 1.0f, 1.0f, 1.0f, m_pRenderInfo->flTransparency );
-					}
-					else
-					{
-						const glm::vec3& lightVec = m_pvlightvalues[ ptricmds[ 1 ] ];
-						glColor4f( lightVec[ 0 ], lightVec[ 1 ], lightVec[ 2 ], m_pRenderInfo->flTransparency );
-					}
+					glTexCoord2f( m_pchrome[ ptricmds[ 1 ] ][ 0 ] * s, m_pchrome[ ptricmds[ 1 ] ][ 1 ] * t );
+				}
+				else
+				{
+					glTexCoord2f( ptricmds[ 2 ] * s, ptricmds[ 3 ] * t );
 				}
 
-				glVertex3fv( glm::value_ptr( m_pxformverts[ ptricmds[ 0 ] ] ) );
+				if( ADDITIVE )
+				{
+					glColor4f( 1.0f, 1.0f, 1.0f, flTransparency );
+				}
+				else
+				{
+					const glm::vec3& lightVec = m_pvlightvalues[ ptricmds[ 1 ] ];
+					glColor4f( lightVec[ 0 ], lightVec[ 1 ], lightVec[ 2 ], flTransparency );
+				}
 			}
-			glEnd();
-		}
 
-		if( texture.flags & STUDIO_NF_MASKED )
-			glDisable( GL_ALPHA_TEST );
+			glVertex3fv( glm::value_ptr( m_pxformverts[ ptricmds[ 0 ] ] ) );
+		}
+		glEnd();
 	}
 
+	PROFILE_COUNT( "Draw calls", uiDrawCalls );
+
+	m_DrawStats.uiDrawCalls += uiDrawCalls;
+
 	return uiDrawnPolys;
 }
 
-void CStudioModelRenderer::Lighting( glm::vec3& lv, int bone, int flags, const glm::vec3& normal )
+unsigned int CStudioModelRenderer::DrawMeshImmediate( const bool bWireframe, const mstudiomesh_t* pMesh, const mstudiotexture_t& texture )
 {
-	const float ambient = std::max( 0.1f, ( float ) m_ambientlight / 255.0f ); // to avoid divison by zero
-	const float shade = m_shadelight / 255.0f;
-	glm::vec3 illum{ ambient };
+	//Wireframe only submits positions.
+	if( bWireframe )
+		return DrawMeshImmediate<true, false, false>( pMesh, texture );
 
-	if( flags & STUDIO_NF_FULLBRIGHT )
+	if( texture.flags & STUDIO_NF_CHROME )
 	{
-		lv = glm::vec3{ 1, 1, 1 };
-		return;
-	}
-	else if( flags & STUDIO_NF_FLATSHADE )
-	{
-		VectorMA( illum, 0.8f, glm::vec3{ shade }, illum );
+		if( texture.flags & STUDIO_NF_ADDITIVE )
+			return DrawMeshImmediate<false, true, true>( pMesh, texture );
+		else
+			return DrawMeshImmediate<false, true, false>( pMesh, texture );
 	}
 	else
 	{
-		auto lightcos = glm::dot( normal, m_blightvec[ bone ] ); // -1 colinear, 1 opposite
+		if( texture.flags & STUDIO_NF_ADDITIVE )
+			return DrawMeshImmediate<false, false, true>( pMesh, texture );
+		else
+			return DrawMeshImmediate<false, false, false>( pMesh, texture );
+	}
+}
 
-		if( lightcos > 1.0f ) lightcos = 1;
+StudioLightingParams_t CStudioModelRenderer::GetLightingParams() const
+{
+	StudioLightingParams_t params;
 
-		illum += m_shadelight / 255.0f;
+	params.flAmbient = std::max( 0.1f, ( float ) m_ambientlight / 255.0f ); // to avoid divison by zero
+	params.flShade = m_shadelight / 255.0f;
+	params.flIllum = params.flAmbient + params.flShade;
+	params.flLambert = std::max( 1.0f, m_flLambert );
+	params.vecLightColor = glm::vec3{ m_lightcolor.GetRed() / 255.0f, m_lightcolor.GetGreen() / 255.0f, m_lightcolor.GetBlue() / 255.0f };
 
-		auto r = m_flLambert;
-		if( r < 1.0f ) r = 1.0f;
-		lightcos = ( lightcos + ( r - 1.0f ) ) / r; // do modified hemispherical lighting
-		if( lightcos > 0.0f ) VectorMA( illum, -lightcos, glm::vec3{ shade }, illum );
+	return params;
+}
 
-		if( illum[ 0 ] <= 0 ) illum[ 0 ] = 0;
-		if( illum[ 1 ] <= 0 ) illum[ 1 ] = 0;
-		if( illum[ 2 ] <= 0 ) illum[ 2 ] = 0;
-	}
+void CStudioModelRenderer::ChromeNormals( const bool bUseSIMD, const glm::vec3* pNormals, const byte* pBones, const int iCount, glm::vec2* pOut )
+{
+	const ChromeVectors_t& vectors = GetChromeVectors();
 
-	float max = VectorMax( illum );
+	studiomdl::ChromeNormals( bUseSIMD, pNormals, pBones, vectors.right, vectors.up, iCount, pOut );
+}
 
-	if( max > 1.0f )
-		lv = illum * ( 1.0f / max );
-	else lv = illum;
+const CStudioModelRenderer::ChromeVectors_t& CStudioModelRenderer::GetChromeVectors()
+{
+	const unsigned int uiPoseSerial = m_pPoseContext->GetSerial();
 
-	const glm::vec3 lightcolor{ m_lightcolor.GetRed() / 255.0f, m_lightcolor.GetGreen() / 255.0f, m_lightcolor.GetBlue() / 255.0f };
+	const auto matches = [ & ]( const ChromeVectors_t& vectors )
+	{
+		return vectors.uiPoseSerial == uiPoseSerial && vectors.vecViewerOrigin == m_vecViewerOrigin && vectors.vecViewerRight == m_vecViewerRight;
+	};
 
-	lv *= lightcolor;
-}
+	//Usually the same as the last mesh that had chrome.
+	if( m_pChromeVectors && matches( *m_pChromeVectors ) )
+		return *m_pChromeVectors;
 
+	ChromeVectors_t* pVectors = nullptr;
+	ChromeVectors_t* pOldest = nullptr;
 
-void CStudioModelRenderer::Chrome( glm::vec2& chrome, int bone, const glm::vec3& normal )
-{
-	if( m_chromeage[ bone ] != m_uiModelsDrawnCount )
+	for( auto& vectors : m_ChromeVectors )
 	{
-		// calculate vectors from the viewer to the bone. This roughly adjusts for position
-		// vector pointing at bone in world reference frame
-		auto tmp = m_vecViewerOrigin * -1.0f;
+		if( matches( vectors ) )
+		{
+			pVectors = &vectors;
+			break;
+		}
+
+		if( !pOldest || vectors.uiLastUsed < pOldest->uiLastUsed )
+			pOldest = &vectors;
+	}
 
-		tmp[ 0 ] += m_bonetransform[ bone ][ 0 ][ 3 ];
-		tmp[ 1 ] += m_bonetransform[ bone ][ 1 ][ 3 ];
-		tmp[ 2 ] += m_bonetransform[ bone ][ 2 ][ 3 ];
+	if( pVectors )
+	{
+		PROFILE_COUNT( "Chrome vectors reused", 1 );
+	}
+	else
+	{
+		if( m_ChromeVectors.size() < MAX_CHROME_VECTORS )
+		{
+			m_ChromeVectors.reserve( MAX_CHROME_VECTORS );
+			m_ChromeVectors.emplace_back();
+			pOldest = &m_ChromeVectors.back();
+		}
 
-		VectorNormalize( tmp );
-		// g_chrome t vector in world reference frame
-		auto chromeupvec = glm::cross( tmp, -m_vecViewerRight );
-		VectorNormalize( chromeupvec );
-		// g_chrome s vector in world reference frame
-		auto chromerightvec = glm::cross( tmp, chromeupvec );
-		VectorNormalize( chromerightvec );
+		pVectors = pOldest;
 
-		VectorIRotate( -chromeupvec, m_bonetransform[ bone ], m_chromeup[ bone ] );
-		VectorIRotate( chromerightvec, m_bonetransform[ bone ], m_chromeright[ bone ] );
+		pVectors->uiPoseSerial = uiPoseSerial;
+		pVectors->vecViewerOrigin = m_vecViewerOrigin;
+		pVectors->vecViewerRight = m_vecViewerRight;
 
-		m_chromeage[ bone ] = m_uiModelsDrawnCount;
+		for( int bone = 0; bone < m_pStudioHdr->numbones; ++bone )
+		{
+			// calculate vectors from the viewer to the bone. This roughly adjusts for position
+			// vector pointing at bone in world reference frame
+			auto tmp = m_vecViewerOrigin * -1.0f;
+
+			tmp[ 0 ] += m_pBoneTransforms[ bone ][ 0 ][ 3 ];
+			tmp[ 1 ] += m_pBoneTransforms[ bone ][ 1 ][ 3 ];
+			tmp[ 2 ] += m_pBoneTransforms[ bone ][ 2 ][ 3 ];
+
+			VectorNormalize( tmp );
+			// g_chrome t vector in world reference frame
+			auto chromeupvec = glm::cross( tmp, -m_vecViewerRight );
+			VectorNormalize( chromeupvec );
+			// g_chrome s vector in world reference frame
+			auto chromerightvec = glm::cross( tmp, chromeupvec );
+			VectorNormalize( chromerightvec );
+
+			VectorIRotate( -chromeupvec, m_pBoneTransforms[ bone ], pVectors->up[ bone ] );
+			VectorIRotate( chromerightvec, m_pBoneTransforms[ bone ], pVectors->right[ bone ] );
+		}
 	}
 
-	// calc s coord
-	auto n = glm::dot( normal, m_chromeright[ bone ] );
-	chrome[ 0 ] = ( n + 1.0 ) * 32;
+	pVectors->uiLastUsed = m_uiModelsDrawnCount;
+
+	m_pChromeVectors = pVectors;
 
-	// calc t coord
-	n = glm::dot( normal, m_chromeup[ bone ] );
-	chrome[ 1 ] = ( n + 1.0 ) * 32;
+	return *pVectors;
 }
 }
\ No newline at end of file
@@ -6,19 +6,188 @@
 #include <glm/vec4.hpp>
 
 #include <glm/mat3x4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "graphics/OpenGL.h"
+#include "graphics/CDebugDrawBatch.h"
+#include "graphics/CGLStreamBuffer.h"
+#include "graphics/GraphicsUtils.h"
+#include "graphics/GLShaderProgram.h"
 
 #include "utility/Color.h"
+#include "utility/CScratchBuffer.h"
 
 #include "shared/studiomodel/studio.h"
+#include "shared/studiomodel/CStudioPoseContext.h"
+#include "shared/studiomodel/StudioKernels.h"
 
 #include "shared/renderer/studiomodel/IStudioModelRenderer.h"
 
+#include "StudioSorting.h"
+
 namespace studiomdl
 {
 class CStudioModel;
+struct StudioDrawMesh_t;
+struct StudioMeshBuffer_t;
+struct StudioMeshVertex_t;
 
 class CStudioModelRenderer final : public studiomdl::IStudioModelRenderer
 {
+private:
+	/**
+	*	Vertex submitted to the GPU by the retained mesh path.
+	*/
+	struct StudioVertex_t
+	{
+		glm::vec3 vecPosition;
+		glm::vec2 vecTexCoord;
+		glm::vec4 vecColor;
+	};
+
+	typedef std::vector<StudioVertex_t> StudioVertices_t;
+
+	/**
+	*	Mesh stored by the render queue until it is flushed.
+	*/
+	struct QueuedMesh_t
+	{
+		glm::mat4 matModelView;
+
+		const CStudioModel* pModel;
+
+		RenderPass pass;
+		GLuint textureId;
+		int flags;
+		float flTransparency;
+
+		GLenum cullFace;
+		bool bCullFace;
+
+		/**
+		*	Offset of the mesh's first vertex in the queued vertex data.
+		*/
+		size_t uiVertexOffset;
+
+		/**
+		*	Mesh buffer whose vertices in the model's skin vertex buffer are used if the mesh is skinned on the GPU.
+		*/
+		const StudioMeshBuffer_t* pSkinBuffer;
+
+		size_t uiFirstIndex;
+		size_t uiNumIndices;
+
+		/**
+		*	Offset of the bone palette in the queued bones if the mesh is skinned on the GPU, or INVALID_PALETTE otherwise.
+		*/
+		size_t uiFirstBone;
+		int iNumBones;
+	};
+
+	static const size_t INVALID_PALETTE = static_cast<size_t>( -1 );
+
+	/**
+	*	Pose kept around so models whose animation state hasn't changed don't need their bones set up again.
+	*/
+	struct CachedPose_t
+	{
+		std::unique_ptr<CStudioPoseContext> context;
+
+		/**
+		*	Value of m_uiModelsDrawnCount when this pose was last used.
+		*/
+		unsigned int uiLastUsed;
+	};
+
+	/**
+	*	Transformed vertices, lighting and chrome of a submodel. Kept so other passes that draw the same pose,
+	*	like the mirrored pass and the wireframe overlay, and later frames that draw it with the same light and view don't compute them again.
+	*/
+	struct PreparedSubModel_t
+	{
+		/**
+		*	Value of m_uiFrameCount when this was last used. Entries that weren't used this frame are replaced first.
+		*/
+		unsigned int uiFrame = 0;
+
+		/**
+		*	Value of m_uiModelsDrawnCount when this was last used.
+		*/
+		unsigned int uiLastUsed = 0;
+
+		unsigned int uiPoseSerial = 0;
+		const mstudiomodel_t* pModel = nullptr;
+		const short* pSkinRef = nullptr;
+
+		/**
+		*	Whether the vertices were transformed on the CPU.
+		*/
+		bool bTransformed = false;
+		bool bUseSIMD = false;
+
+		glm::vec3 vecLightVec;
+		byte lightColor[ 3 ];
+		float flLambert = 0;
+		int iAmbientLight = 0;
+		float flShadeLight = 0;
+		bool bLightingLUT = false;
+		glm::vec3 vecViewerOrigin;
+		glm::vec3 vecViewerRight;
+
+		/**
+		*	Whether any mesh uses chrome. The viewer is only compared if so.
+		*/
+		bool bHasChrome = false;
+
+		/**
+		*	Texture flags of each mesh. Flags can be changed while the model is open.
+		*/
+		std::vector<int> meshFlags;
+
+		std::vector<glm::vec3> xformVerts;
+		std::vector<glm::vec3> lightValues;
+		std::vector<glm::vec2> chrome;
+	};
+
+	/**
+	*	Maximum number of prepared submodels kept.
+	*/
+	static const size_t MAX_PREPARED_SUBMODELS = 16;
+
+	/**
+	*	Chrome vectors of every bone of a pose, as seen from a viewer. They only depend on the bone transforms and the viewer,
+	*	so they're kept across frames and reused for as long as neither the pose nor the camera changes.
+	*/
+	struct ChromeVectors_t
+	{
+		/**
+		*	Serial of the bone transforms that these were computed for.
+		*/
+		unsigned int uiPoseSerial = 0;
+
+		glm::vec3 vecViewerOrigin;
+		glm::vec3 vecViewerRight;
+
+		/**
+		*	Value of m_uiModelsDrawnCount when these were last used.
+		*/
+		unsigned int uiLastUsed = 0;
+
+		/**
+		*	Chrome "up" and "right" vectors in bone reference frames.
+		*/
+		glm::vec3 up[ MAXSTUDIOBONES ];
+		glm::vec3 right[ MAXSTUDIOBONES ];
+	};
+
+	/**
+	*	Maximum number of sets of chrome vectors that are kept.
+	*/
+	static const size_t MAX_CHROME_VECTORS = 16;
+
 public:
 	/**
 	*	Constructor.
@@ -38,6 +207,8 @@ public:
 
 	unsigned int GetModelsDrawnCount() const override final { return m_uiModelsDrawnCount; }
 
+	unsigned int GetModelsCulledCount() const override final { return m_uiModelsCulledCount; }
+
 	unsigned int GetDrawnPolygonsCount() const override final { return m_uiDrawnPolygonsCount; }
 
 	float GetLambert() const override final { return m_flLambert; }
@@ -62,6 +233,20 @@ public:
 
 	unsigned int DrawModel( CModelRenderInfo* const pRenderInfo, const renderer::DrawFlags_t flags ) override final;
 
+	unsigned int DrawPosedModel( CModelRenderInfo* const pRenderInfo, CStudioPoseContext& poseContext, const renderer::DrawFlags_t flags ) override final;
+
+	unsigned int DrawModelInstances( CModelRenderInfo* const pRenderInfos, const size_t uiCount, const renderer::DrawFlags_t flags ) override final;
+
+	void BeginRenderQueue() override final;
+
+	unsigned int FlushRenderQueue() override final;
+
+	unsigned int GetStateChangesSavedCount() const override final { return m_uiStateChangesSavedCount; }
+
+	const renderer::DrawStats_t& GetDrawStats() const override final { return m_DrawStats; }
+
+	void ResetDrawStats() override final { m_DrawStats.Reset(); }
+
 	IStudioModelRendererListener* GetRendererListener() const override final { return m_pListener; }
 
 	void SetRendererListener( IStudioModelRendererListener* pListener ) override final
@@ -74,40 +259,243 @@ public:
 	void DrawSingleAttachment( const int iAttachment ) override final;
 
 private:
-	void DrawBones();
+	/**
+	*	Draws a model.
+	*	@param pRenderInfo Render info that describes the model.
+	*	@param pPoseContext If not null, a pose context that has already been set up for this model. Otherwise, bones are set up by the renderer.
+	*	@param flags Flags.
+	*	@return Number of polygons that were drawn.
+	*/
+	unsigned int DrawModel( CModelRenderInfo* const pRenderInfo, CStudioPoseContext* pPoseContext, const renderer::DrawFlags_t flags );
 
-	void DrawAttachments();
+	/**
+	*	Finds a cached pose that matches the current render info, or sets up bones in the least recently used cache entry.
+	*	@return The pose context to draw with.
+	*/
+	CStudioPoseContext* GetCachedPose();
 
-	void DrawEyePosition();
+	/**
+	*	Gets the model space bounds of a model. If a pose is given, its bounds are used, otherwise the bounding box of the current sequence.
+	*	@param renderInfo Render info that describes the model.
+	*	@param pPoseContext Optional. Pose that the model is drawn with.
+	*	@return Whether the model has bounds. Some models don't have sequence bounds.
+	*/
+	static bool GetModelBounds( const CModelRenderInfo& renderInfo, const CStudioPoseContext* pPoseContext, glm::vec3& vecMins, glm::vec3& vecMaxs );
 
-	void DrawHitBoxes();
+	/**
+	*	Tests the bounding box of the model against the view frustum.
+	*	@param renderInfo Render info that describes the model.
+	*	@param pPoseContext Optional. Pose that the model is drawn with.
+	*	@param planes View frustum planes in world space.
+	*	@param flags Flags.
+	*	@return Whether the model could be visible.
+	*	@see GetModelBounds
+	*/
+	bool IsModelVisible( const CModelRenderInfo& renderInfo, const CStudioPoseContext* pPoseContext, 
+						 const glm::vec4 ( &planes )[ graphics::FRUSTUM_PLANE_COUNT ], const renderer::DrawFlags_t flags ) const;
 
-	void DrawNormals();
+	/**
+	*	View parameters used to pick detail levels.
+	*/
+	struct LodView_t
+	{
+		/**
+		*	World to eye space.
+		*/
+		glm::mat4 matView;
+
+		/**
+		*	Converts eye space sizes at a depth of 1 to pixels.
+		*/
+		float flPixelScale;
+
+		bool bPerspective;
+	};
+
+	/**
+	*	Gets the view parameters from the current OpenGL matrices and viewport.
+	*/
+	static void GetCurrentLodView( LodView_t& view );
+
+	/**
+	*	@return Whether detail levels should be picked for the models being drawn.
+	*/
+	static bool ShouldSelectLods();
+
+	/**
+	*	Picks the detail level to draw a model with, based on the size of its bounding sphere on screen.
+	*	@param renderInfo Render info that describes the model.
+	*	@param pPoseContext Optional. Pose that the model is drawn with.
+	*	@param view View that the model is drawn in.
+	*	@param flags Flags.
+	*	@return Detail level. 0 is full detail.
+	*	@see GetModelBounds
+	*/
+	int SelectLod( const CModelRenderInfo& renderInfo, const CStudioPoseContext* pPoseContext, const LodView_t& view, const renderer::DrawFlags_t flags ) const;
+
+	/**
+	*	@return Whether the given instances can be drawn with a single instanced draw per mesh. Creates the instancing program on first use.
+	*/
+	bool ShouldDrawInstanced( const CModelRenderInfo* pRenderInfos, const size_t uiCount, const renderer::DrawFlags_t flags );
+
+	/**
+	*	Draws a batch of instances of the same model. Instances must be sorted by bodygroup and skin.
+	*	@param pRenderInfos Render infos of all instances.
+	*	@param pOrder Indices into pRenderInfos of the instances in this batch, in draw order.
+	*	@param uiCount Number of instances in this batch.
+	*	@param flags Flags.
+	*	@return Number of polygons that were drawn.
+	*/
+	unsigned int DrawInstanceBatch( CModelRenderInfo* const pRenderInfos, const size_t* pOrder, const size_t uiCount, const renderer::DrawFlags_t flags );
+
+	/**
+	*	The following add debug geometry to m_DebugBatch or m_DebugOverlayBatch. It's drawn by DrawDebugBatches.
+	*/
+	void AddBones();
+
+	void AddAttachments();
+
+	void AddEyePosition();
+
+	void AddHitBoxes();
+
+	void AddNormals();
+
+	/**
+	*	Adds the edges of a hitbox to the given batch.
+	*/
+	void AddHitBox( const mstudiobbox_t& hitbox, graphics::CDebugDrawBatch& batch );
 
-	void SetUpBones();
-	void CalcRotations( glm::vec3* pos, glm::vec4* q, const mstudioseqdesc_t* const pseqdesc, const mstudioanim_t* panim, const float f );
+	/**
+	*	Draws a debug batch, with depth testing if requested. Textures are disabled and blending is enabled, so translucent lines blend.
+	*/
+	void DrawDebugBatch( graphics::CDebugDrawBatch& batch, const bool bDepthTest );
 
-	void CalcBoneAdj();
-	void CalcBoneQuaternion( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, glm::vec4& q );
-	void CalcBonePosition( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, glm::vec3& pos );
-	void SlerpBones( glm::vec4* q1, glm::vec3* pos1, glm::vec4* q2, glm::vec3* pos2, float s );
+	/**
+	*	Draws debug geometry that is depth tested first, so the overlay is drawn on top of it.
+	*/
+	void DrawDebugBatches();
 
 	/**
 	*	@brief set some global variables based on entity position
 	*/
 	void SetupLighting();
 
+	/**
+	*	Computes the light vector in each bone's reference frame, if it hasn't been computed for the model being drawn yet.
+	*/
+	void SetupBoneLightVecs();
+
 	/**
 	*	@brief based on the body part, figure out which mesh it should be using
+	*	@return Whether the body part has a valid submodel. If not, nothing should be drawn for it.
 	*/
-	void SetupModel( int bodypart );
+	bool SetupModel( int bodypart );
 
 	unsigned int DrawPoints( const bool bWireframe );
 
-	unsigned int DrawMeshes( const bool bWireframe, const SortedMesh_t* pMeshes, const mstudiotexture_t* pTextures, const short* pSkinRef );
+	/**
+	*	Transforms the current submodel's vertices and computes its lighting and chrome, or reuses the results of an earlier pass this frame.
+	*	Points m_pxformverts, m_pvlightvalues and m_pchrome at the results.
+	*/
+	void PrepareSubModel( const mstudiotexture_t* pTextures, const short* pSkinRef, const bool bUseSIMD );
+
+	/**
+	*	@return Whether the given prepared submodel can be used for the current submodel.
+	*/
+	bool IsPreparedSubModelValid( const PreparedSubModel_t& prepared, const mstudiotexture_t* pTextures, const short* pSkinRef, const bool bUseSIMD ) const;
+
+	/**
+	*	Computes lighting and chrome for the current submodel's normals.
+	*/
+	void ComputeSubModelLighting( const mstudiotexture_t* pTextures, const short* pSkinRef, const bool bUseSIMD, glm::vec3* pLightValues, glm::vec2* pChrome );
+
+	/**
+	*	Draws the current submodel's meshes in the order of its draw list.
+	*/
+	unsigned int DrawMeshes( const bool bWireframe, const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures );
+
+	/**
+	*	@return Whether the current model should be drawn using its retained mesh buffers.
+	*/
+	bool ShouldUseMeshBuffers() const;
+
+	/**
+	*	@return Whether the current model should be skinned on the GPU. Creates the skinning program on first use.
+	*/
+	bool ShouldUseGPUSkinning();
+
+	/**
+	*	Appends the vertex data for all meshes of the current model to the given list, in draw order.
+	*/
+	void GatherMeshVertices( const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures, StudioVertices_t& vertices ) const;
+
+	/**
+	*	Adds all meshes of the current model to the render queue.
+	*	@return Number of polygons that will be drawn.
+	*/
+	unsigned int QueueMeshes( const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures );
+
+	/**
+	*	Builds the vertex data for all meshes of the current model, uploads it and sets up client state.
+	*/
+	void BeginMeshBuffers( const bool bWireframe, const StudioDrawMesh_t* pMeshes, const mstudiotexture_t* pTextures );
+
+	/**
+	*	Restores client state changed by BeginMeshBuffers.
+	*/
+	void EndMeshBuffers();
+
+	/**
+	*	Draws a single mesh using its retained triangle list.
+	*	@param bWireframe Whether this is a wireframe pass.
+	*	@param buffer Retained mesh data.
+	*	@param uiVertexOffset Offset of the mesh's first vertex in the vertex buffer.
+	*	@return Number of polygons drawn.
+	*/
+	unsigned int DrawMeshBuffer( const bool bWireframe, const StudioMeshBuffer_t& buffer, const size_t uiVertexOffset );
+
+	/**
+	*	Points the vertex array at a mesh's positions and bones in its model's skin vertex buffer, which must be bound,
+	*	and sets the uniforms of the bound program that map the positions to model space.
+	*/
+	void SetSkinVertexPointer( const CStudioModel& model, const StudioMeshBuffer_t& buffer, const GLint iScaleUniform, const GLint iOriginUniform );
 
-	void Lighting( glm::vec3& lv, int bone, int flags, const glm::vec3& normal );
-	void Chrome( glm::vec2& chrome, int bone, const glm::vec3& normal );
+	/**
+	*	Draws a single mesh by walking its tricmds in immediate mode.
+	*	@return Number of polygons drawn.
+	*/
+	unsigned int DrawMeshImmediate( const bool bWireframe, const mstudiomesh_t* pMesh, const mstudiotexture_t& texture );
+
+	/**
+	*	Draws a single mesh by walking its tricmds in immediate mode. The template parameters are the mesh's render mode,
+	*	so the loop that runs for each vertex doesn't need to check the texture flags.
+	*	@return Number of polygons drawn.
+	*/
+	template<bool WIREFRAME, bool CHROME, bool ADDITIVE>
+	unsigned int DrawMeshImmediate( const mstudiomesh_t* pMesh, const mstudiotexture_t& texture );
+
+	/**
+	*	Builds vertices for a single mesh of the retained mesh path. Specialized on the mesh's render mode like DrawMeshImmediate.
+	*/
+	template<bool CHROME, bool ADDITIVE, bool SKIN_ON_GPU>
+	void BuildMeshVertices( const StudioMeshVertex_t* pVertices, const size_t uiCount, const float s, const float t, StudioVertex_t* pOut ) const;
+
+	/**
+	*	@return Lighting parameters for the model being drawn, without a lookup table.
+	*/
+	StudioLightingParams_t GetLightingParams() const;
+
+	/**
+	*	Calculates chrome texture coordinates for a mesh's normals.
+	*	@param bUseSIMD Whether to use the SIMD kernel. The caller must check AreSIMDKernelsSupported.
+	*/
+	void ChromeNormals( const bool bUseSIMD, const glm::vec3* pNormals, const byte* pBones, const int iCount, glm::vec2* pOut );
+
+	/**
+	*	@return The chrome vectors of the current pose as seen from the current viewer. Computed if no earlier draw used the same pose and viewer.
+	*/
+	const ChromeVectors_t& GetChromeVectors();
 
 private:
 	/**
@@ -115,6 +503,11 @@ private:
 	*/
 	unsigned int m_uiModelsDrawnCount = 0;
 
+	/**
+	*	Total number of models skipped because they were outside the view since the last time the renderer was initialized.
+	*/
+	unsigned int m_uiModelsCulledCount = 0;
+
 	studiomdl::CModelRenderInfo* m_pRenderInfo;
 
 	studiohdr_t* m_pStudioHdr = nullptr;
@@ -129,31 +522,187 @@ private:
 	*/
 	unsigned int m_uiDrawnPolygonsCount = 0;
 
-	glm::vec3		m_xformverts[ MAXSTUDIOVERTS ];		// transformed vertices
-	glm::vec3		m_lightvalues[ MAXSTUDIOVERTS ];	// light surface normals
-	glm::vec3*		m_pxformverts;
-	glm::vec3*		m_pvlightvalues;
+	/**
+	*	Bone and vertex transformation state for models drawn without a pose context.
+	*/
+	CStudioPoseContext	m_PoseContext;
+
+	/**
+	*	Pose context for the model being drawn. Either m_PoseContext or one provided by the caller.
+	*/
+	CStudioPoseContext*	m_pPoseContext = &m_PoseContext;
+
+	std::vector<CachedPose_t> m_PoseCache;
+
+	/**
+	*	Number of calls to RunFrame.
+	*/
+	unsigned int m_uiFrameCount = 1;
+
+	std::vector<PreparedSubModel_t> m_PreparedSubModels;
 
-	glm::mat3x4		m_bonetransform[ MAXSTUDIOBONES ];	// bone transformation matrix
+	CScratchBuffer<glm::vec3>	m_lightvalues;		// light surface normals, sized to the submodel being drawn
+	const glm::vec3*	m_pxformverts = nullptr;
+	glm::vec3*		m_pvlightvalues = nullptr;
 
-	vec_t			m_Adj[ MAXSTUDIOCONTROLLERS ];		//This used to be a vec4, but it really needs to be this.
+	const glm::mat3x4*	m_pBoneTransforms = nullptr;		// bone transformation matrices, owned by m_PoseContext
 
 	int				m_ambientlight;						// ambient world light
 	float			m_shadelight;						// direct world light
 
 	glm::vec3		m_lightvec = { 0, 0, -1 };			// light vector in model reference frame
 	Color			m_lightcolor;
-	glm::vec3		m_blightvec[ MAXSTUDIOBONES ];		// light vectors in bone reference frames
+	CScratchBuffer<glm::vec3>	m_blightvec;		// light vectors in bone reference frames, sized to the model being drawn
+	bool			m_bBoneLightVecsSet = false;		// whether m_blightvec is set for the model being drawn
 
-	glm::vec2		m_chrome[ MAXSTUDIOVERTS ];			// texture coords for surface normals
-	unsigned int	m_chromeage[ MAXSTUDIOBONES ];		// last time chrome vectors were updated
-	glm::vec3		m_chromeup[ MAXSTUDIOBONES ];		// chrome vector "up" in bone reference frames
-	glm::vec3		m_chromeright[ MAXSTUDIOBONES ];	// chrome vector "right" in bone reference frames
+	/**
+	*	Lighting parameters and lookup table for the model being drawn. Set up by SetupLighting.
+	*/
+	StudioLightingParams_t m_LightingParams;
+
+	CScratchBuffer<glm::vec2>	m_chrome;			// texture coords for surface normals, sized to the submodel being drawn
+	const glm::vec2*	m_pchrome = nullptr;				// chrome texture coords of the submodel being drawn
+	/**
+	*	Recently used chrome vectors. Never grows past MAX_CHROME_VECTORS, so pointers to entries stay valid.
+	*/
+	std::vector<ChromeVectors_t> m_ChromeVectors;
+	const ChromeVectors_t* m_pChromeVectors = nullptr;
 
 	glm::vec3		m_vecViewerOrigin;
 	glm::vec3		m_vecViewerRight = { 50, 50, 0 };	// needs to be set to viewer's right in order for chrome to work
 	float			m_flLambert = 1.5f;					// modifier for pseudo-hemispherical lighting
 
+	/**
+	*	Vertex data for the retained mesh path. Rebuilt every time a model is drawn.
+	*/
+	StudioVertices_t m_MeshVertexData;
+
+	/**
+	*	Ring buffer that per-frame vertex data is streamed into.
+	*/
+	graphics::CGLStreamBuffer m_VertexStream;
+
+	/**
+	*	Offset of the vertex data that is being drawn in m_VertexStream, in bytes.
+	*/
+	size_t			m_uiVertexStreamOffset = 0;
+
+	/**
+	*	Debug geometry that is hidden by the model, like normals.
+	*/
+	graphics::CDebugDrawBatch m_DebugBatch;
+
+	/**
+	*	Debug geometry that is drawn on top of everything, like bones.
+	*/
+	graphics::CDebugDrawBatch m_DebugOverlayBatch;
+
+	/**
+	*	Vertex program that transforms vertices using the bone palette.
+	*/
+	GLShaderProgram	m_SkinningProgram;
+	GLint			m_iBonesUniform = -1;
+	GLint			m_iPositionScaleUniform = -1;
+	GLint			m_iPositionOriginUniform = -1;
+
+	bool			m_bSkinningInitialized = false;
+
+	/**
+	*	Whether the mesh currently being drawn is skinned on the GPU.
+	*/
+	bool			m_bUseGPUSkinning = false;
+
+	/**
+	*	Detail level that the meshes of the model being drawn use.
+	*/
+	int				m_iLod = 0;
+
+	/**
+	*	Whether meshes are being stored in the render queue.
+	*/
+	bool			m_bQueueing = false;
+
+	std::vector<QueuedMesh_t> m_RenderQueue;
+
+	/**
+	*	Vertex data for all queued meshes.
+	*/
+	StudioVertices_t m_QueuedVertexData;
+
+	/**
+	*	Bone palettes of queued models that are skinned on the GPU.
+	*/
+	std::vector<glm::mat3x4> m_QueuedBones;
+
+	/**
+	*	Model view matrix and cull state of the model being drawn, captured when it is queued.
+	*/
+	glm::mat4		m_matQueuedModelView;
+	GLenum			m_QueuedCullFace = GL_FRONT;
+	bool			m_bQueuedCullFace = true;
+
+	/**
+	*	Offset of the current model's palette in m_QueuedBones, or INVALID_PALETTE if it hasn't been added yet.
+	*/
+	size_t			m_uiQueuedPalette = INVALID_PALETTE;
+
+	/**
+	*	Vertex program that draws many instances of a model, with lighting and chrome computed on the GPU.
+	*/
+	GLShaderProgram	m_InstancingProgram;
+
+	struct InstancingUniforms_t
+	{
+		GLint iInstances = -1;
+		GLint iInstanceStride = -1;
+		GLint iFirstInstance = -1;
+		GLint iLightVec = -1;
+		GLint iLightColor = -1;
+		GLint iLighting = -1;
+		GLint iLightingMode = -1;
+		GLint iChrome = -1;
+		GLint iViewerOrigin = -1;
+		GLint iViewerRight = -1;
+		GLint iTexScale = -1;
+		GLint iPositionScale = -1;
+		GLint iPositionOrigin = -1;
+		GLint iCompactNormals = -1;
+	};
+
+	InstancingUniforms_t m_InstancingUniforms;
+
+	bool			m_bInstancingInitialized = false;
+
+	/**
+	*	Per-instance transforms, transparency and bone palettes, read by the instancing program through a buffer texture.
+	*/
+	std::vector<glm::vec4> m_InstanceData;
+
+	GLuint			m_InstanceBuffer = 0;
+	GLuint			m_InstanceTexture = 0;
+
+	/**
+	*	Maximum number of texels in a buffer texture.
+	*/
+	GLint			m_iMaxInstanceTexels = 0;
+
+	/**
+	*	Indices of the instances being drawn, sorted by bodygroup, skin and detail level.
+	*/
+	std::vector<size_t> m_InstanceOrder;
+
+	/**
+	*	Detail level of each instance being drawn, indexed like the render infos.
+	*/
+	std::vector<int> m_InstanceLods;
+
+	/**
+	*	The number of state changes avoided by the render queue since the last call to Initialize.
+	*/
+	unsigned int	m_uiStateChangesSavedCount = 0;
+
+	renderer::DrawStats_t m_DrawStats;
+
 private:
 	CStudioModelRenderer( const CStudioModelRenderer& ) = delete;
 	CStudioModelRenderer& operator=( const CStudioModelRenderer& ) = delete;
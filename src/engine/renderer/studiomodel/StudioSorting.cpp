@@ -6,14 +6,17 @@
 
 namespace studiomdl
 {
-bool CompareSortedMeshes( const SortedMesh_t& lhs, const SortedMesh_t& rhs )
+RenderPass GetMeshRenderPass( const int flags, const float flTransparency )
 {
-	if( ( lhs.flags & ( STUDIO_NF_ADDITIVE ) ) == 0 && rhs.flags & ( STUDIO_NF_ADDITIVE ) )
-		return true;
+	if( flags & STUDIO_NF_ADDITIVE )
+		return RenderPass::ADDITIVE;
 
-	if( lhs.flags & ( STUDIO_NF_MASKED ) && ( rhs.flags & ( STUDIO_NF_MASKED ) ) == 0 )
-		return true;
+	if( flags & STUDIO_NF_MASKED )
+		return RenderPass::MASKED;
 
-	return false;
+	if( flTransparency < 1.0f )
+		return RenderPass::TRANSLUCENT;
+
+	return RenderPass::SOLID;
 }
 }
\ No newline at end of file
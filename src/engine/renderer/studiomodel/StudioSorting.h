@@ -5,13 +5,27 @@
 
 namespace studiomdl
 {
-struct SortedMesh_t
+/**
+*	Render passes used to order queued meshes. Passes are drawn in ascending order.
+*/
+enum class RenderPass
 {
-	mstudiomesh_t* pMesh;
-	int flags;
+	MASKED = 0,
+	SOLID,
+
+	/**
+	*	Non-additive meshes of models drawn with transparency.
+	*/
+	TRANSLUCENT,
+	ADDITIVE
 };
 
-bool CompareSortedMeshes( const SortedMesh_t& lhs, const SortedMesh_t& rhs );
+/**
+*	@param flags Texture flags.
+*	@param flTransparency Transparency of the model that the mesh belongs to.
+*	@return The render pass that a mesh belongs in. Matches the order of CStudioModel::GetDrawList.
+*/
+RenderPass GetMeshRenderPass( const int flags, const float flTransparency );
 }
 
 #endif //GAME_STUDIOMODEL_STUDIOSORTING_H
@@ -1,55 +1,159 @@
 #include <glm/gtc/matrix_transform.hpp>
 
+#ifndef DOUBLEVEC_T
+#include <xmmintrin.h>
+#endif
+
+#include "core/shared/Logging.h"
+
+#include "utility/PlatUtils.h"
+
 #include "CMatrixStack.h"
 
 namespace renderer
 {
-CMatrixStack::CMatrixStack()
+namespace
 {
-	//Push identity matrices for each stack.
-	for( auto& stack : m_Stacks )
+#ifndef DOUBLEVEC_T
+/**
+*	Computes lhs * rhs. Each column of the result is a sum of lhs' columns scaled by the elements of rhs' column, same as glm.
+*	The result may alias either operand.
+*/
+SSE2_TARGET void MultiplyMatricesSIMD( const Mat4x4& lhs, const Mat4x4& rhs, Mat4x4& result )
+{
+	const __m128 l0 = _mm_loadu_ps( &lhs[ 0 ][ 0 ] );
+	const __m128 l1 = _mm_loadu_ps( &lhs[ 1 ][ 0 ] );
+	const __m128 l2 = _mm_loadu_ps( &lhs[ 2 ][ 0 ] );
+	const __m128 l3 = _mm_loadu_ps( &lhs[ 3 ][ 0 ] );
+
+	__m128 columns[ 4 ];
+
+	for( int iColumn = 0; iColumn < 4; ++iColumn )
+	{
+		const __m128 x = _mm_set1_ps( rhs[ iColumn ][ 0 ] );
+		const __m128 y = _mm_set1_ps( rhs[ iColumn ][ 1 ] );
+		const __m128 z = _mm_set1_ps( rhs[ iColumn ][ 2 ] );
+		const __m128 w = _mm_set1_ps( rhs[ iColumn ][ 3 ] );
+
+		columns[ iColumn ] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( l0, x ), _mm_mul_ps( l1, y ) ), _mm_add_ps( _mm_mul_ps( l2, z ), _mm_mul_ps( l3, w ) ) );
+	}
+
+	for( int iColumn = 0; iColumn < 4; ++iColumn )
 	{
-		stack.push( Mat4x4() );
+		_mm_storeu_ps( &result[ iColumn ][ 0 ], columns[ iColumn ] );
 	}
 }
+#endif
 
-const Mat4x4& CMatrixStack::GetMatrix( const MatrixMode::MatrixMode mode ) const
+/**
+*	Computes lhs * rhs into result, which may alias either operand.
+*/
+void MultiplyMatrices( const Mat4x4& lhs, const Mat4x4& rhs, Mat4x4& result )
 {
-	return m_Stacks[ mode ].top();
+#ifndef DOUBLEVEC_T
+	static const bool bSIMD = plat::IsSSE2Supported();
+
+	if( bSIMD )
+	{
+		MultiplyMatricesSIMD( lhs, rhs, result );
+		return;
+	}
+#endif
+
+	result = lhs * rhs;
+}
+}
+
+CMatrixStack::CMatrixStack()
+{
+	//Every stack starts with an identity matrix.
+	for( auto& stack : m_Stacks )
+	{
+		stack.matrices[ 0 ] = Mat4x4( 1 );
+	}
 }
 
 void CMatrixStack::PushMatrix( const MatrixMode::MatrixMode mode )
 {
-	m_Stacks[ mode ].push( Mat4x4() );
+	auto& stack = m_Stacks[ mode ];
+
+	if( stack.uiDepth >= MAX_DEPTH )
+	{
+		Error( "CMatrixStack::PushMatrix: Stack overflow for matrix mode %d\n", mode );
+		return;
+	}
+
+	//Same as OpenGL, the new matrix is a copy of the previous one, so nothing has changed.
+	stack.matrices[ stack.uiDepth ] = stack.matrices[ stack.uiDepth - 1 ];
+
+	++stack.uiDepth;
 }
 
 void CMatrixStack::PopMatrix( const MatrixMode::MatrixMode mode )
 {
-	m_Stacks[ mode ].pop();
+	auto& stack = m_Stacks[ mode ];
+
+	if( stack.uiDepth <= 1 )
+	{
+		Error( "CMatrixStack::PopMatrix: Stack underflow for matrix mode %d\n", mode );
+		return;
+	}
+
+	--stack.uiDepth;
+
+	stack.bDirty = true;
 }
 
 void CMatrixStack::LoadIdentity( const MatrixMode::MatrixMode mode )
 {
-	m_Stacks[ mode ].top() = Mat4x4();
+	GetTop( mode ) = Mat4x4( 1 );
+	m_Stacks[ mode ].bDirty = true;
 }
 
 void CMatrixStack::LoadMatrix( const MatrixMode::MatrixMode mode, const Mat4x4& mat )
 {
-	m_Stacks[ mode ].top() = mat;
+	GetTop( mode ) = mat;
+	m_Stacks[ mode ].bDirty = true;
 }
 
 void CMatrixStack::LoadTransposeMatrix( const MatrixMode::MatrixMode mode, const Mat4x4& mat )
 {
-	m_Stacks[ mode ].top() = glm::transpose( mat );
+	GetTop( mode ) = glm::transpose( mat );
+	m_Stacks[ mode ].bDirty = true;
 }
 
 void CMatrixStack::MultMatrix( const MatrixMode::MatrixMode mode, const Mat4x4& mat )
 {
-	m_Stacks[ mode ].top() *= mat;
+	auto& top = GetTop( mode );
+
+	MultiplyMatrices( top, mat, top );
+	m_Stacks[ mode ].bDirty = true;
 }
 
 void CMatrixStack::MultTransposeMatrix( const MatrixMode::MatrixMode mode, const Mat4x4& mat )
 {
-	m_Stacks[ mode ].top() *= glm::transpose( mat );
+	auto& top = GetTop( mode );
+
+	MultiplyMatrices( top, glm::transpose( mat ), top );
+	m_Stacks[ mode ].bDirty = true;
+}
+
+bool CMatrixStack::IsAnyDirty() const
+{
+	for( const auto& stack : m_Stacks )
+	{
+		if( stack.bDirty )
+			return true;
+	}
+
+	return false;
+}
+
+void CMatrixStack::ClearAllDirty()
+{
+	for( auto& stack : m_Stacks )
+	{
+		stack.bDirty = false;
+	}
+}
 }
-}
\ No newline at end of file
@@ -1,7 +1,7 @@
 #ifndef ENGINE_RENDERER_UTIL_CMATRIXSTACK_H
 #define ENGINE_RENDERER_UTIL_CMATRIXSTACK_H
 
-#include <stack>
+#include <cstddef>
 
 #include "utility/mathlib.h"
 
@@ -10,12 +10,16 @@
 namespace renderer
 {
 /**
-*	Stack of matrices.
+*	Stack of matrices for each matrix mode. Each stack has a fixed capacity, so pushing and popping never allocates.
+*	Tracks which matrices have changed, so they only have to be passed to the graphics API when they're needed.
 */
 class CMatrixStack final
 {
-private:
-	typedef std::stack<Mat4x4> MatStack_t;
+public:
+	/**
+	*	Maximum number of matrices in each stack, including the bottom one. Same as the minimum OpenGL guarantees for the modelview stack.
+	*/
+	static const size_t MAX_DEPTH = 32;
 
 public:
 	CMatrixStack();
@@ -23,10 +27,26 @@ public:
 	CMatrixStack& operator=( const CMatrixStack& other ) = default;
 	~CMatrixStack() = default;
 
-	const Mat4x4& GetMatrix( const MatrixMode::MatrixMode mode ) const;
+	const Mat4x4& GetMatrix( const MatrixMode::MatrixMode mode ) const
+	{
+		const auto& stack = m_Stacks[ mode ];
+
+		return stack.matrices[ stack.uiDepth - 1 ];
+	}
+
+	/**
+	*	@return Number of matrices in the given stack, including the bottom one.
+	*/
+	size_t GetDepth( const MatrixMode::MatrixMode mode ) const { return m_Stacks[ mode ].uiDepth; }
 
+	/**
+	*	Pushes a copy of the current matrix. Logs an error if the stack is full.
+	*/
 	void PushMatrix( const MatrixMode::MatrixMode mode );
 
+	/**
+	*	Pops the current matrix. Logs an error if no matrix has been pushed.
+	*/
 	void PopMatrix( const MatrixMode::MatrixMode mode );
 
 	void LoadIdentity( const MatrixMode::MatrixMode mode );
@@ -39,9 +59,40 @@ public:
 
 	void MultTransposeMatrix( const MatrixMode::MatrixMode mode, const Mat4x4& mat );
 
+	/**
+	*	@return Whether the current matrix of the given mode has changed since the last call to ClearDirty for that mode.
+	*/
+	bool IsDirty( const MatrixMode::MatrixMode mode ) const { return m_Stacks[ mode ].bDirty; }
+
+	/**
+	*	@return Whether any current matrix has changed since its dirty flag was last cleared.
+	*/
+	bool IsAnyDirty() const;
+
+	void ClearDirty( const MatrixMode::MatrixMode mode ) { m_Stacks[ mode ].bDirty = false; }
+
+	void ClearAllDirty();
+
+private:
+	struct Stack_t
+	{
+		alignas( 16 ) Mat4x4 matrices[ MAX_DEPTH ];
+
+		size_t uiDepth = 1;
+
+		bool bDirty = true;
+	};
+
+	Mat4x4& GetTop( const MatrixMode::MatrixMode mode )
+	{
+		auto& stack = m_Stacks[ mode ];
+
+		return stack.matrices[ stack.uiDepth - 1 ];
+	}
+
 private:
-	MatStack_t m_Stacks[ MatrixMode::COUNT ];
+	Stack_t m_Stacks[ MatrixMode::COUNT ];
 };
 }
 
-#endif //ENGINE_RENDERER_UTIL_CMATRIXSTACK_H
\ No newline at end of file
+#endif //ENGINE_RENDERER_UTIL_CMATRIXSTACK_H
@@ -0,0 +1,820 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#include "shared/Platform.h"
+#include "shared/Logging.h"
+#include "shared/TaskScheduler.h"
+
+#include "utility/ByteSwap.h"
+#include "utility/CMappedFile.h"
+
+#include "shared/sprite/sprite.h"
+#include "shared/studiomodel/studio.h"
+
+#include "CAssetIndex.h"
+
+namespace engine
+{
+namespace
+{
+const char INDEX_MAGIC[ 4 ] = { 'H', 'L', 'A', 'I' };
+
+/**
+*	Must be incremented whenever the layout of the index file, or the information stored in it, changes.
+*/
+const uint32_t INDEX_VERSION = 1;
+
+/**
+*	Layout of an index file:
+*	IndexHeader_t
+*	For each directory: uint32_t length, followed by that many characters.
+*	For each entry: IndexEntry_t, followed by uiPathLength characters.
+*
+*	Index files are only ever read by the program that wrote them, so native byte order is used.
+*/
+struct IndexHeader_t
+{
+	char		szMagic[ 4 ];
+	uint32_t	uiVersion;
+	uint32_t	uiNumDirectories;
+	uint32_t	uiNumEntries;
+};
+
+struct IndexEntry_t
+{
+	uint32_t	uiType;
+	uint32_t	uiValidHeader;
+	uint64_t	uiSize;
+	int64_t		iModifiedTime;
+
+	int32_t		iNumBones;
+	int32_t		iNumSequences;
+	int32_t		iNumTextures;
+	int32_t		iNumBodyparts;
+	int32_t		iNumFrames;
+	int32_t		iWidth;
+	int32_t		iHeight;
+
+	uint32_t	uiPathLength;
+};
+
+const char* const ASSET_TYPE_NAMES[] =
+{
+	"model",
+	"sprite",
+	"sound"
+};
+
+static_assert( sizeof( ASSET_TYPE_NAMES ) / sizeof( ASSET_TYPE_NAMES[ 0 ] ) == static_cast<size_t>( AssetType::COUNT ), "Every asset type needs a name" );
+
+std::string ToLower( std::string szString )
+{
+	std::transform( szString.begin(), szString.end(), szString.begin(), []( const unsigned char c ) { return static_cast<char>( tolower( c ) ); } );
+
+	return szString;
+}
+
+/**
+*	@param szPath Path of a file.
+*	@param type If the file is an asset, set to its type.
+*	@return Whether the file is an asset that is indexed.
+*/
+bool GetAssetType( const std::string& szPath, AssetType& type )
+{
+	const size_t uiDot = szPath.find_last_of( "./" );
+
+	if( uiDot == std::string::npos || szPath[ uiDot ] != '.' )
+		return false;
+
+	const std::string szExtension = ToLower( szPath.substr( uiDot + 1 ) );
+
+	//Dreamcast models use the same format.
+	if( szExtension == "mdl" || szExtension == "dol" )
+		type = AssetType::MODEL;
+	else if( szExtension == "spr" )
+		type = AssetType::SPRITE;
+	else if( szExtension == "wav" )
+		type = AssetType::SOUND;
+	else
+		return false;
+
+	return true;
+}
+
+/**
+*	Gets the size and modification time of a file.
+*	@return Whether the file exists.
+*/
+bool StatFile( const std::string& szPath, CAssetIndex::Entry_t& entry )
+{
+	namespace fs = std::experimental::filesystem;
+
+	std::error_code error;
+
+	const auto uiSize = fs::file_size( szPath, error );
+
+	if( error )
+		return false;
+
+	const auto modifiedTime = fs::last_write_time( szPath, error );
+
+	if( error )
+		return false;
+
+	entry.uiSize = static_cast<uint64_t>( uiSize );
+	entry.iModifiedTime = static_cast<int64_t>( modifiedTime.time_since_epoch().count() );
+
+	return true;
+}
+
+/**
+*	Reads the counts in an entry's header. Only the start of the file is touched.
+*/
+void ReadHeader( CAssetIndex::Entry_t& entry )
+{
+	entry.bValidHeader = false;
+
+	CMappedFile file;
+
+	if( !file.Open( entry.szPath.c_str() ) )
+		return;
+
+	const byte* const pData = static_cast<const byte*>( file.GetData() );
+
+	switch( entry.type )
+	{
+	case AssetType::MODEL:
+		{
+			if( file.GetSize() < sizeof( studiohdr_t ) )
+				break;
+
+			studiohdr_t header;
+			memcpy( &header, pData, sizeof( header ) );
+
+			//Texture and sequence group files have their own identifiers and are listed without counts.
+			if( strncmp( reinterpret_cast<const char*>( &header.id ), STUDIOMDL_HDR_ID, sizeof( header.id ) ) || LittleValue( header.version ) != STUDIO_VERSION )
+				break;
+
+			entry.bValidHeader = true;
+			entry.iNumBones = LittleValue( header.numbones );
+			entry.iNumSequences = LittleValue( header.numseq );
+			entry.iNumTextures = LittleValue( header.numtextures );
+			entry.iNumBodyparts = LittleValue( header.numbodyparts );
+			break;
+		}
+
+	case AssetType::SPRITE:
+		{
+			if( file.GetSize() < sizeof( sprite::dsprite_t ) )
+				break;
+
+			sprite::dsprite_t header;
+			memcpy( &header, pData, sizeof( header ) );
+
+			if( LittleValue( header.ident ) != SPRITE_ID || LittleValue( header.version ) != SPRITE_VERSION )
+				break;
+
+			entry.bValidHeader = true;
+			entry.iNumFrames = LittleValue( header.numframes );
+			entry.iWidth = LittleValue( header.width );
+			entry.iHeight = LittleValue( header.height );
+			break;
+		}
+
+	case AssetType::SOUND:
+		{
+			entry.bValidHeader = file.GetSize() >= 12 && !memcmp( pData, "RIFF", 4 ) && !memcmp( pData + 8, "WAVE", 4 );
+			break;
+		}
+
+	default: break;
+	}
+}
+
+/**
+*	@return Whether the given file is in one of the directories or their subdirectories.
+*/
+bool IsInDirectories( const std::string& szPath, const std::vector<std::string>& directories )
+{
+	for( const auto& szDirectory : directories )
+	{
+		if( szPath.size() > szDirectory.size() && szPath[ szDirectory.size() ] == '/' && !szPath.compare( 0, szDirectory.size(), szDirectory ) )
+			return true;
+	}
+
+	return false;
+}
+
+bool ComparePaths( const CAssetIndex::Entry_t& lhs, const CAssetIndex::Entry_t& rhs )
+{
+	return lhs.szPath < rhs.szPath;
+}
+
+std::vector<CAssetIndex::Entry_t>::const_iterator FindEntry( const std::vector<CAssetIndex::Entry_t>& entries, const std::string& szPath )
+{
+	auto it = std::lower_bound( entries.begin(), entries.end(), szPath,
+		[]( const CAssetIndex::Entry_t& entry, const std::string& szPath ) { return entry.szPath < szPath; } );
+
+	return it != entries.end() && it->szPath == szPath ? it : entries.end();
+}
+
+enum class SearchField
+{
+	SIZE = 0,
+	BONES,
+	SEQUENCES,
+	TEXTURES,
+	BODYPARTS,
+	FRAMES,
+	WIDTH,
+	HEIGHT
+};
+
+const struct SearchFieldName_t
+{
+	const char* pszName;
+	SearchField field;
+} SEARCH_FIELDS[] =
+{
+	{ "size", SearchField::SIZE },
+	{ "bones", SearchField::BONES },
+	{ "seq", SearchField::SEQUENCES },
+	{ "textures", SearchField::TEXTURES },
+	{ "bodyparts", SearchField::BODYPARTS },
+	{ "frames", SearchField::FRAMES },
+	{ "width", SearchField::WIDTH },
+	{ "height", SearchField::HEIGHT }
+};
+
+enum class SearchOp
+{
+	EQUAL = 0,
+	LESS,
+	LESS_EQUAL,
+	GREATER,
+	GREATER_EQUAL
+};
+
+struct SearchFilter_t
+{
+	SearchField field;
+	SearchOp op;
+	int64_t iValue;
+};
+
+int64_t GetFieldValue( const CAssetIndex::Entry_t& entry, const SearchField field )
+{
+	switch( field )
+	{
+	case SearchField::SIZE:			return static_cast<int64_t>( entry.uiSize );
+	case SearchField::BONES:		return entry.iNumBones;
+	case SearchField::SEQUENCES:	return entry.iNumSequences;
+	case SearchField::TEXTURES:		return entry.iNumTextures;
+	case SearchField::BODYPARTS:	return entry.iNumBodyparts;
+	case SearchField::FRAMES:		return entry.iNumFrames;
+	case SearchField::WIDTH:		return entry.iWidth;
+	case SearchField::HEIGHT:		return entry.iHeight;
+	default:						return 0;
+	}
+}
+
+bool MatchesFilter( const CAssetIndex::Entry_t& entry, const SearchFilter_t& filter )
+{
+	const int64_t iValue = GetFieldValue( entry, filter.field );
+
+	switch( filter.op )
+	{
+	case SearchOp::EQUAL:			return iValue == filter.iValue;
+	case SearchOp::LESS:			return iValue < filter.iValue;
+	case SearchOp::LESS_EQUAL:		return iValue <= filter.iValue;
+	case SearchOp::GREATER:			return iValue > filter.iValue;
+	case SearchOp::GREATER_EQUAL:	return iValue >= filter.iValue;
+	default:						return false;
+	}
+}
+
+/**
+*	Parses a term of the form <field><op><number>.
+*	@return Whether the term is a filter.
+*/
+bool ParseFilter( const std::string& szTerm, SearchFilter_t& filter )
+{
+	const size_t uiOp = szTerm.find_first_of( "=<>" );
+
+	if( uiOp == std::string::npos || uiOp == 0 )
+		return false;
+
+	const std::string szField = szTerm.substr( 0, uiOp );
+
+	const auto pField = std::find_if( std::begin( SEARCH_FIELDS ), std::end( SEARCH_FIELDS ),
+		[ & ]( const SearchFieldName_t& field ) { return szField == field.pszName; } );
+
+	if( pField == std::end( SEARCH_FIELDS ) )
+		return false;
+
+	filter.field = pField->field;
+
+	size_t uiValue = uiOp + 1;
+
+	const bool bEqual = uiValue < szTerm.size() && szTerm[ uiValue ] == '=';
+
+	switch( szTerm[ uiOp ] )
+	{
+	case '<': filter.op = bEqual ? SearchOp::LESS_EQUAL : SearchOp::LESS; break;
+	case '>': filter.op = bEqual ? SearchOp::GREATER_EQUAL : SearchOp::GREATER; break;
+	default: filter.op = SearchOp::EQUAL; break;
+	}
+
+	if( bEqual && szTerm[ uiOp ] != '=' )
+		++uiValue;
+
+	if( uiValue >= szTerm.size() )
+		return false;
+
+	char* pszEnd;
+
+	filter.iValue = strtoll( szTerm.c_str() + uiValue, &pszEnd, 10 );
+
+	return *pszEnd == '\0';
+}
+
+void WriteString( std::vector<byte>& data, const std::string& szString )
+{
+	const uint32_t uiLength = static_cast<uint32_t>( szString.size() );
+
+	data.insert( data.end(), reinterpret_cast<const byte*>( &uiLength ), reinterpret_cast<const byte*>( &uiLength + 1 ) );
+	data.insert( data.end(), szString.begin(), szString.end() );
+}
+}
+
+const char CAssetIndex::DEFAULT_FILENAME[] = "assetindex.dat";
+
+const char* AssetTypeToString( const AssetType type )
+{
+	return type < AssetType::COUNT ? ASSET_TYPE_NAMES[ static_cast<size_t>( type ) ] : "unknown";
+}
+
+size_t CAssetIndex::GetCount() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_Entries.size();
+}
+
+bool CAssetIndex::Scan( const std::vector<std::string>& directories, const bool bParallel, const std::atomic<bool>* pbCancel )
+{
+	namespace fs = std::experimental::filesystem;
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	auto isCancelled = [ = ]() { return pbCancel && *pbCancel; };
+
+	//One task per item, directories and files vary a lot in how long they take.
+	auto parallelFor = [ = ]( const size_t uiCount, const std::function<void( const size_t uiIndex )>& func )
+	{
+		if( bParallel )
+		{
+			tasks::ParallelFor( uiCount, func, 1, "ScanAssets" );
+		}
+		else
+		{
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+			{
+				func( uiIndex );
+			}
+		}
+	};
+
+	std::vector<std::string> scanDirectories;
+
+	scanDirectories.reserve( directories.size() );
+
+	for( const auto& szDirectory : directories )
+	{
+		scanDirectories.emplace_back( fs::path( szDirectory ).generic_string() );
+
+		while( scanDirectories.back().size() > 1 && scanDirectories.back().back() == '/' )
+			scanDirectories.back().pop_back();
+	}
+
+	//Each directory is walked by one thread; the file system spends most of the time waiting on the disk, so this overlaps the waits.
+	std::vector<std::vector<Entry_t>> directoryEntries( scanDirectories.size() );
+
+	parallelFor( scanDirectories.size(), [ & ]( const size_t uiIndex )
+	{
+		std::error_code error;
+
+		for( fs::recursive_directory_iterator it( scanDirectories[ uiIndex ], error ), end; !error && it != end && !isCancelled(); it.increment( error ) )
+		{
+			std::error_code entryError;
+
+			if( !fs::is_regular_file( it->status( entryError ) ) )
+				continue;
+
+			Entry_t entry;
+
+			entry.szPath = it->path().generic_string();
+
+			if( !GetAssetType( entry.szPath, entry.type ) )
+				continue;
+
+			if( StatFile( entry.szPath, entry ) )
+				directoryEntries[ uiIndex ].emplace_back( std::move( entry ) );
+		}
+	} );
+
+	if( isCancelled() )
+		return false;
+
+	std::vector<Entry_t> entries;
+
+	for( auto& found : directoryEntries )
+	{
+		std::move( found.begin(), found.end(), std::back_inserter( entries ) );
+	}
+
+	directoryEntries.clear();
+
+	std::sort( entries.begin(), entries.end(), ComparePaths );
+
+	//Directories can be nested in each other.
+	entries.erase( std::unique( entries.begin(), entries.end(), []( const Entry_t& lhs, const Entry_t& rhs ) { return lhs.szPath == rhs.szPath; } ), entries.end() );
+
+	std::vector<size_t> toRead;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		for( size_t uiIndex = 0; uiIndex < entries.size(); ++uiIndex )
+		{
+			auto& entry = entries[ uiIndex ];
+
+			auto it = FindEntry( m_Entries, entry.szPath );
+
+			if( it != m_Entries.end() && it->type == entry.type && it->uiSize == entry.uiSize && it->iModifiedTime == entry.iModifiedTime )
+				entry = *it;
+			else
+				toRead.push_back( uiIndex );
+		}
+	}
+
+	parallelFor( toRead.size(), [ & ]( const size_t uiIndex )
+	{
+		if( !isCancelled() )
+			ReadHeader( entries[ toRead[ uiIndex ] ] );
+	} );
+
+	if( isCancelled() )
+		return false;
+
+	std::vector<std::string> searchNames;
+
+	searchNames.reserve( entries.size() );
+
+	for( const auto& entry : entries )
+	{
+		searchNames.emplace_back( ToLower( entry.szPath ) );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( !toRead.empty() || entries.size() != m_Entries.size() || scanDirectories != m_Directories )
+			m_bDirty = true;
+
+		m_Directories = std::move( scanDirectories );
+		m_Entries = std::move( entries );
+		m_SearchNames = std::move( searchNames );
+	}
+
+	const double flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+	Message( "Indexed %u assets in %u directories in %.2f seconds, read %u headers\n",
+		static_cast<unsigned int>( GetCount() ), static_cast<unsigned int>( directories.size() ), flSeconds, static_cast<unsigned int>( toRead.size() ) );
+
+	return true;
+}
+
+size_t CAssetIndex::Update( const std::vector<std::string>& files )
+{
+	namespace fs = std::experimental::filesystem;
+
+	std::vector<std::string> directories;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		directories = m_Directories;
+	}
+
+	//Headers are read without holding the lock, so searches aren't blocked by the disk.
+	std::vector<std::pair<Entry_t, bool>> updates;
+
+	for( const auto& szFile : files )
+	{
+		Entry_t entry;
+
+		entry.szPath = fs::path( szFile ).generic_string();
+
+		if( !GetAssetType( entry.szPath, entry.type ) || !IsInDirectories( entry.szPath, directories ) )
+			continue;
+
+		const bool bExists = StatFile( entry.szPath, entry );
+
+		if( bExists )
+			ReadHeader( entry );
+
+		updates.emplace_back( std::move( entry ), bExists );
+	}
+
+	size_t uiChanged = 0;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( auto& update : updates )
+	{
+		auto it = std::lower_bound( m_Entries.begin(), m_Entries.end(), update.first, ComparePaths );
+
+		const bool bFound = it != m_Entries.end() && it->szPath == update.first.szPath;
+
+		const auto searchName = m_SearchNames.begin() + ( it - m_Entries.begin() );
+
+		if( !update.second )
+		{
+			if( bFound )
+			{
+				m_SearchNames.erase( searchName );
+				m_Entries.erase( it );
+				++uiChanged;
+			}
+		}
+		else if( bFound )
+		{
+			*it = std::move( update.first );
+			++uiChanged;
+		}
+		else
+		{
+			m_SearchNames.insert( searchName, ToLower( update.first.szPath ) );
+			m_Entries.insert( it, std::move( update.first ) );
+			++uiChanged;
+		}
+	}
+
+	if( uiChanged > 0 )
+		m_bDirty = true;
+
+	return uiChanged;
+}
+
+size_t CAssetIndex::Search( const std::string& szQuery, std::vector<Entry_t>& results, const size_t uiMaxResults ) const
+{
+	std::vector<std::string> names;
+	std::vector<SearchFilter_t> filters;
+
+	bool bFilterType = false;
+	AssetType type = AssetType::MODEL;
+
+	const std::string szLowerQuery = ToLower( szQuery );
+
+	size_t uiStart = 0;
+
+	while( uiStart < szLowerQuery.size() )
+	{
+		size_t uiEnd = szLowerQuery.find( ' ', uiStart );
+
+		if( uiEnd == std::string::npos )
+			uiEnd = szLowerQuery.size();
+
+		const std::string szTerm = szLowerQuery.substr( uiStart, uiEnd - uiStart );
+
+		uiStart = uiEnd + 1;
+
+		if( szTerm.empty() )
+			continue;
+
+		SearchFilter_t filter;
+
+		if( !szTerm.compare( 0, 5, "type:" ) )
+		{
+			const std::string szType = szTerm.substr( 5 );
+
+			const auto pName = std::find_if( std::begin( ASSET_TYPE_NAMES ), std::end( ASSET_TYPE_NAMES ),
+				[ & ]( const char* const pszName ) { return szType == pszName; } );
+
+			if( pName == std::end( ASSET_TYPE_NAMES ) )
+			{
+				Warning( "CAssetIndex::Search: Unknown asset type \"%s\"\n", szType.c_str() );
+				return 0;
+			}
+
+			bFilterType = true;
+			type = static_cast<AssetType>( pName - std::begin( ASSET_TYPE_NAMES ) );
+		}
+		else if( ParseFilter( szTerm, filter ) )
+		{
+			filters.push_back( filter );
+		}
+		else
+		{
+			names.push_back( szTerm );
+		}
+	}
+
+	size_t uiMatches = 0;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( size_t uiIndex = 0; uiIndex < m_Entries.size(); ++uiIndex )
+	{
+		const auto& entry = m_Entries[ uiIndex ];
+
+		if( bFilterType && entry.type != type )
+			continue;
+
+		const auto& szSearchName = m_SearchNames[ uiIndex ];
+
+		if( !std::all_of( names.begin(), names.end(), [ & ]( const std::string& szName ) { return szSearchName.find( szName ) != std::string::npos; } ) )
+			continue;
+
+		if( !std::all_of( filters.begin(), filters.end(), [ & ]( const SearchFilter_t& filter ) { return MatchesFilter( entry, filter ); } ) )
+			continue;
+
+		if( uiMaxResults == 0 || uiMatches < uiMaxResults )
+			results.push_back( entry );
+
+		++uiMatches;
+	}
+
+	return uiMatches;
+}
+
+bool CAssetIndex::Load( const char* const pszFilename )
+{
+	CMappedFile file;
+
+	if( !file.Open( pszFilename ) )
+		return false;
+
+	const byte* pData = static_cast<const byte*>( file.GetData() );
+	const byte* const pEnd = pData + file.GetSize();
+
+	auto read = [ & ]( void* pDest, const size_t uiSize )
+	{
+		if( static_cast<size_t>( pEnd - pData ) < uiSize )
+			return false;
+
+		memcpy( pDest, pData, uiSize );
+		pData += uiSize;
+
+		return true;
+	};
+
+	auto readString = [ & ]( std::string& szString, const uint32_t uiLength )
+	{
+		if( static_cast<size_t>( pEnd - pData ) < uiLength )
+			return false;
+
+		szString.assign( reinterpret_cast<const char*>( pData ), uiLength );
+		pData += uiLength;
+
+		return true;
+	};
+
+	IndexHeader_t header;
+
+	if( !read( &header, sizeof( header ) ) || memcmp( header.szMagic, INDEX_MAGIC, sizeof( INDEX_MAGIC ) ) || header.uiVersion != INDEX_VERSION )
+		return false;
+
+	std::vector<std::string> directories( header.uiNumDirectories );
+
+	for( auto& szDirectory : directories )
+	{
+		uint32_t uiLength;
+
+		if( !read( &uiLength, sizeof( uiLength ) ) || !readString( szDirectory, uiLength ) )
+			return false;
+	}
+
+	std::vector<Entry_t> entries;
+	std::vector<std::string> searchNames;
+
+	//Every entry takes at least this much, so a corrupt count can't make this allocate too much.
+	if( header.uiNumEntries > static_cast<size_t>( pEnd - pData ) / sizeof( IndexEntry_t ) )
+		return false;
+
+	entries.resize( header.uiNumEntries );
+	searchNames.reserve( header.uiNumEntries );
+
+	for( auto& entry : entries )
+	{
+		IndexEntry_t record;
+
+		if( !read( &record, sizeof( record ) ) || record.uiType >= static_cast<uint32_t>( AssetType::COUNT ) || !readString( entry.szPath, record.uiPathLength ) )
+			return false;
+
+		entry.type = static_cast<AssetType>( record.uiType );
+		entry.bValidHeader = record.uiValidHeader != 0;
+		entry.uiSize = record.uiSize;
+		entry.iModifiedTime = record.iModifiedTime;
+		entry.iNumBones = record.iNumBones;
+		entry.iNumSequences = record.iNumSequences;
+		entry.iNumTextures = record.iNumTextures;
+		entry.iNumBodyparts = record.iNumBodyparts;
+		entry.iNumFrames = record.iNumFrames;
+		entry.iWidth = record.iWidth;
+		entry.iHeight = record.iHeight;
+
+		searchNames.emplace_back( ToLower( entry.szPath ) );
+	}
+
+	if( !std::is_sorted( entries.begin(), entries.end(), ComparePaths ) )
+		return false;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Directories = std::move( directories );
+	m_Entries = std::move( entries );
+	m_SearchNames = std::move( searchNames );
+
+	m_bDirty = false;
+
+	return true;
+}
+
+bool CAssetIndex::Save( const char* const pszFilename )
+{
+	std::vector<byte> data;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		IndexHeader_t header;
+
+		memcpy( header.szMagic, INDEX_MAGIC, sizeof( INDEX_MAGIC ) );
+		header.uiVersion = INDEX_VERSION;
+		header.uiNumDirectories = static_cast<uint32_t>( m_Directories.size() );
+		header.uiNumEntries = static_cast<uint32_t>( m_Entries.size() );
+
+		data.insert( data.end(), reinterpret_cast<const byte*>( &header ), reinterpret_cast<const byte*>( &header + 1 ) );
+
+		for( const auto& szDirectory : m_Directories )
+		{
+			WriteString( data, szDirectory );
+		}
+
+		for( const auto& entry : m_Entries )
+		{
+			IndexEntry_t record;
+
+			memset( &record, 0, sizeof( record ) );
+
+			record.uiType = static_cast<uint32_t>( entry.type );
+			record.uiValidHeader = entry.bValidHeader ? 1 : 0;
+			record.uiSize = entry.uiSize;
+			record.iModifiedTime = entry.iModifiedTime;
+			record.iNumBones = entry.iNumBones;
+			record.iNumSequences = entry.iNumSequences;
+			record.iNumTextures = entry.iNumTextures;
+			record.iNumBodyparts = entry.iNumBodyparts;
+			record.iNumFrames = entry.iNumFrames;
+			record.iWidth = entry.iWidth;
+			record.iHeight = entry.iHeight;
+			record.uiPathLength = static_cast<uint32_t>( entry.szPath.size() );
+
+			data.insert( data.end(), reinterpret_cast<const byte*>( &record ), reinterpret_cast<const byte*>( &record + 1 ) );
+			data.insert( data.end(), entry.szPath.begin(), entry.szPath.end() );
+		}
+	}
+
+	FILE* pFile = fopen( pszFilename, "wb" );
+
+	if( !pFile )
+	{
+		Error( "CAssetIndex::Save: Couldn't open \"%s\" for writing\n", pszFilename );
+		return false;
+	}
+
+	const bool bSuccess = fwrite( data.data(), 1, data.size(), pFile ) == data.size();
+
+	fclose( pFile );
+
+	if( !bSuccess )
+	{
+		Error( "CAssetIndex::Save: Couldn't write \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	m_bDirty = false;
+
+	return true;
+}
+}
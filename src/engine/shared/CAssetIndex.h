@@ -0,0 +1,162 @@
+#ifndef ENGINE_SHARED_CASSETINDEX_H
+#define ENGINE_SHARED_CASSETINDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace engine
+{
+enum class AssetType : uint32_t
+{
+	MODEL = 0,
+	SPRITE,
+	SOUND,
+
+	COUNT
+};
+
+/**
+*	@return Name of the given asset type, as used in searches.
+*/
+const char* AssetTypeToString( const AssetType type );
+
+/**
+*	Index of the models, sprites and sounds in a set of directories, with the information in their headers.
+*	Directories are walked and headers are read on the task scheduler's threads. Files whose size and modification time haven't changed keep their entry,
+*	so scanning again after a restart or a change only reads the headers of files that changed.
+*	The index can be saved to and loaded from a file in native byte order. Searches run on the entries in memory.
+*	All methods can be called from any thread.
+*/
+class CAssetIndex final
+{
+public:
+	/**
+	*	Name of the file the index is saved to by default. Relative to the working directory, like the settings files.
+	*/
+	static const char DEFAULT_FILENAME[];
+
+	struct Entry_t
+	{
+		/**
+		*	Absolute path, with forward slashes.
+		*/
+		std::string szPath;
+
+		AssetType type = AssetType::MODEL;
+
+		uint64_t uiSize = 0;
+
+		/**
+		*	Modification time, in file clock ticks.
+		*/
+		int64_t iModifiedTime = 0;
+
+		/**
+		*	Whether the file has a valid header, and the counts below were read from it.
+		*/
+		bool bValidHeader = false;
+
+		/**
+		*	Models only. Texture and sequence group files have no bones.
+		*/
+		int32_t iNumBones = 0;
+		int32_t iNumSequences = 0;
+		int32_t iNumTextures = 0;
+		int32_t iNumBodyparts = 0;
+
+		/**
+		*	Sprites only.
+		*/
+		int32_t iNumFrames = 0;
+		int32_t iWidth = 0;
+		int32_t iHeight = 0;
+	};
+
+public:
+	CAssetIndex() = default;
+	~CAssetIndex() = default;
+
+	/**
+	*	@return Number of indexed files.
+	*/
+	size_t GetCount() const;
+
+	/**
+	*	@return Whether the index has changed since it was last loaded or saved.
+	*/
+	bool IsDirty() const { return m_bDirty; }
+
+	/**
+	*	Indexes all assets in the given directories and their subdirectories. Replaces the previous contents, but reuses entries of unchanged files.
+	*	@param directories Directories to scan. Directories that don't exist are skipped.
+	*	@param bParallel Whether directories are walked and headers are read on the task scheduler. If not, everything runs on the calling thread.
+	*	@param pbCancel If not null, the scan stops as soon as possible once this is true, and the index is left as it was.
+	*	@return Whether the scan completed.
+	*/
+	bool Scan( const std::vector<std::string>& directories, const bool bParallel = false, const std::atomic<bool>* pbCancel = nullptr );
+
+	/**
+	*	Updates the entries of files that have changed. Files that were deleted are removed, new files in the scanned directories are added.
+	*	@param files Absolute paths of changed files, as reported by the file watcher. Files that aren't assets are ignored.
+	*	@return Number of entries that were added, updated or removed.
+	*/
+	size_t Update( const std::vector<std::string>& files );
+
+	/**
+	*	Finds entries that match a query. The query is a list of terms separated by spaces, all of which must match:
+	*	type:<model|sprite|sound>: Only entries of this type.
+	*	<field><op><number>: Compares a header field. Fields are size, bones, seq, textures, bodyparts, frames, width and height; op is one of =, <, >, <= and >=.
+	*	Anything else matches part of the path, ignoring case.
+	*	@param szQuery Query to match.
+	*	@param results Matching entries are added to this list, sorted by path.
+	*	@param uiMaxResults Maximum number of results to add. 0 for no limit.
+	*	@return Total number of matching entries, which may be more than the number added.
+	*/
+	size_t Search( const std::string& szQuery, std::vector<Entry_t>& results, const size_t uiMaxResults = 0 ) const;
+
+	/**
+	*	Loads the index from a file. Entries for files that changed since it was saved are updated by the next scan.
+	*	@return Whether the file was loaded.
+	*/
+	bool Load( const char* const pszFilename = DEFAULT_FILENAME );
+
+	/**
+	*	Saves the index to a file.
+	*	@return Whether the file was saved.
+	*/
+	bool Save( const char* const pszFilename = DEFAULT_FILENAME );
+
+private:
+	/**
+	*	Guards the members below.
+	*/
+	mutable std::mutex m_Mutex;
+
+	/**
+	*	Directories of the last scan. Changed files outside of these aren't added.
+	*/
+	std::vector<std::string> m_Directories;
+
+	/**
+	*	Sorted by path.
+	*/
+	std::vector<Entry_t> m_Entries;
+
+	/**
+	*	Lowercase copies of the entries' paths, in the same order, so searches don't convert them each time.
+	*/
+	std::vector<std::string> m_SearchNames;
+
+	std::atomic<bool> m_bDirty{ false };
+
+private:
+	CAssetIndex( const CAssetIndex& ) = delete;
+	CAssetIndex& operator=( const CAssetIndex& ) = delete;
+};
+}
+
+#endif //ENGINE_SHARED_CASSETINDEX_H
@@ -0,0 +1,66 @@
+#include <memory>
+#include <string>
+
+#include "utility/CMappedFile.h"
+
+#include "filesystem/IFileSystem.h"
+
+#include "EngineFileSystem.h"
+
+namespace engine
+{
+namespace
+{
+filesystem::IFileSystem* g_pEngineFileSystem = nullptr;
+}
+
+filesystem::IFileSystem* GetFileSystem()
+{
+	return g_pEngineFileSystem;
+}
+
+void SetFileSystem( filesystem::IFileSystem* pFileSystem )
+{
+	g_pEngineFileSystem = pFileSystem;
+}
+
+bool ReadFile( const char* const pszFilename, filesystem::CFileData& data )
+{
+	data.Clear();
+
+	if( !pszFilename || !( *pszFilename ) )
+		return false;
+
+	if( g_pEngineFileSystem )
+		return g_pEngineFileSystem->ReadFile( pszFilename, data );
+
+	auto file = std::make_shared<CMappedFile>();
+
+	if( !file->Open( pszFilename ) )
+		return false;
+
+	const byte* pData = reinterpret_cast<const byte*>( file->GetData() );
+	const size_t uiSize = file->GetSize();
+
+	data = filesystem::CFileData( std::move( file ), pData, uiSize );
+
+	return true;
+}
+
+std::future<filesystem::CFileData> ReadFileAsync( const char* const pszFilename )
+{
+	if( g_pEngineFileSystem )
+		return g_pEngineFileSystem->ReadFileAsync( pszFilename );
+
+	return std::async( std::launch::async, []( const std::string& szFilename )
+		{
+			filesystem::CFileData data;
+
+			ReadFile( szFilename.c_str(), data );
+
+			return data;
+		},
+		std::string( pszFilename ? pszFilename : "" )
+	);
+}
+}
@@ -0,0 +1,49 @@
+#ifndef ENGINE_SHARED_ENGINEFILESYSTEM_H
+#define ENGINE_SHARED_ENGINEFILESYSTEM_H
+
+#include <future>
+
+#include "filesystem/CFileData.h"
+
+namespace filesystem
+{
+class IFileSystem;
+}
+
+/*
+*	Filesystem used by the shared engine code to load models, sprites, and other resources.
+*	Each library that includes the shared engine code has its own copy, so it must be set in each library that loads resources.
+*/
+
+namespace engine
+{
+/**
+*	@return The filesystem used to load resources, or null if none has been set.
+*/
+filesystem::IFileSystem* GetFileSystem();
+
+/**
+*	Sets the filesystem used to load resources.
+*	@param pFileSystem Filesystem to use. May be null.
+*/
+void SetFileSystem( filesystem::IFileSystem* pFileSystem );
+
+/**
+*	Reads a file through the filesystem, so files in archives can be loaded.
+*	If no filesystem has been set, the file is read from disk.
+*	@param pszFilename Name of the file to read.
+*	@param data If the file was found, set to its contents.
+*	@return Whether the file was read.
+*/
+bool ReadFile( const char* const pszFilename, filesystem::CFileData& data );
+
+/**
+*	Reads a file on an I/O thread, so several files can be read at the same time.
+*	If no filesystem has been set, the file is read from disk on a new thread.
+*	@param pszFilename Name of the file to read.
+*	@return Future that is set to the file's contents. If the file couldn't be read, the data is not valid.
+*/
+std::future<filesystem::CFileData> ReadFileAsync( const char* const pszFilename );
+}
+
+#endif //ENGINE_SHARED_ENGINEFILESYSTEM_H
@@ -0,0 +1,19 @@
+#include "EngineRenderContext.h"
+
+namespace engine
+{
+namespace
+{
+renderer::IRenderContext* g_pEngineRenderContext = nullptr;
+}
+
+renderer::IRenderContext* GetRenderContext()
+{
+	return g_pEngineRenderContext;
+}
+
+void SetRenderContext( renderer::IRenderContext* pRenderContext )
+{
+	g_pEngineRenderContext = pRenderContext;
+}
+}
@@ -0,0 +1,28 @@
+#ifndef ENGINE_SHARED_ENGINERENDERCONTEXT_H
+#define ENGINE_SHARED_ENGINERENDERCONTEXT_H
+
+namespace renderer
+{
+class IRenderContext;
+}
+
+/*
+*	Render context used by the shared engine code to register the textures it creates.
+*	Each library that includes the shared engine code has its own copy, so it must be set in each library that creates textures.
+*/
+
+namespace engine
+{
+/**
+*	@return The render context, or null if none has been set.
+*/
+renderer::IRenderContext* GetRenderContext();
+
+/**
+*	Sets the render context.
+*	@param pRenderContext Context to use. May be null.
+*/
+void SetRenderContext( renderer::IRenderContext* pRenderContext );
+}
+
+#endif //ENGINE_SHARED_ENGINERENDERCONTEXT_H
@@ -0,0 +1,219 @@
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "CRenderCommandBuffer.h"
+
+namespace renderer
+{
+void CRenderCommandBuffer::Reset()
+{
+	m_Commands.clear();
+	m_Callbacks.clear();
+}
+
+void CRenderCommandBuffer::MatrixMode( const MatrixMode::MatrixMode mode )
+{
+	AddCommand( CommandType::MATRIX_MODE ).matrixMode = mode;
+}
+
+void CRenderCommandBuffer::PushMatrix()
+{
+	AddCommand( CommandType::PUSH_MATRIX );
+}
+
+void CRenderCommandBuffer::PopMatrix()
+{
+	AddCommand( CommandType::POP_MATRIX );
+}
+
+void CRenderCommandBuffer::LoadIdentity()
+{
+	AddCommand( CommandType::LOAD_IDENTITY );
+}
+
+void CRenderCommandBuffer::LoadMatrix( const Mat4x4& mat )
+{
+	AddMatrixCommand( CommandType::LOAD_MATRIX, mat );
+}
+
+void CRenderCommandBuffer::LoadTransposeMatrix( const Mat4x4& mat )
+{
+	AddMatrixCommand( CommandType::LOAD_TRANSPOSE_MATRIX, mat );
+}
+
+void CRenderCommandBuffer::MultMatrix( const Mat4x4& mat )
+{
+	AddMatrixCommand( CommandType::MULT_MATRIX, mat );
+}
+
+void CRenderCommandBuffer::MultTransposeMatrix( const Mat4x4& mat )
+{
+	AddMatrixCommand( CommandType::MULT_TRANSPOSE_MATRIX, mat );
+}
+
+void CRenderCommandBuffer::Ortho( vec_t flLeft, vec_t flRight, vec_t flBottom, vec_t flTop, vec_t flNear, vec_t flFar )
+{
+	auto& command = AddCommand( CommandType::ORTHO );
+
+	command.projection[ 0 ] = flLeft;
+	command.projection[ 1 ] = flRight;
+	command.projection[ 2 ] = flBottom;
+	command.projection[ 3 ] = flTop;
+	command.projection[ 4 ] = flNear;
+	command.projection[ 5 ] = flFar;
+}
+
+void CRenderCommandBuffer::PerspectiveY( vec_t flFOVY, vec_t flAspect, vec_t flNear, vec_t flFar )
+{
+	auto& command = AddCommand( CommandType::PERSPECTIVE_Y );
+
+	command.projection[ 0 ] = flFOVY;
+	command.projection[ 1 ] = flAspect;
+	command.projection[ 2 ] = flNear;
+	command.projection[ 3 ] = flFar;
+}
+
+void CRenderCommandBuffer::Viewport( int iX, int iY, int iWidth, int iHeight )
+{
+	auto& command = AddCommand( CommandType::VIEWPORT );
+
+	command.viewport[ 0 ] = iX;
+	command.viewport[ 1 ] = iY;
+	command.viewport[ 2 ] = iWidth;
+	command.viewport[ 3 ] = iHeight;
+}
+
+void CRenderCommandBuffer::ClearColor( const Color32& color )
+{
+	ClearColor( color.r, color.g, color.b, color.a );
+}
+
+void CRenderCommandBuffer::ClearColor( const Color24& color, float flA )
+{
+	ClearColor( color.r, color.g, color.b, flA );
+}
+
+void CRenderCommandBuffer::ClearColor( float flR, float flG, float flB, float flA )
+{
+	auto& command = AddCommand( CommandType::CLEAR_COLOR );
+
+	command.color[ 0 ] = flR;
+	command.color[ 1 ] = flG;
+	command.color[ 2 ] = flB;
+	command.color[ 3 ] = flA;
+}
+
+void CRenderCommandBuffer::Clear( const ClearBits_t bits )
+{
+	AddCommand( CommandType::CLEAR ).clearBits = bits;
+}
+
+void CRenderCommandBuffer::SetCullFace( const CullFace cullFace )
+{
+	AddCommand( CommandType::SET_CULL_FACE ).cullFace = cullFace;
+}
+
+void CRenderCommandBuffer::BindTexture( HTexture_t hTexture )
+{
+	AddCommand( CommandType::BIND_TEXTURE ).hTexture = hTexture;
+}
+
+void CRenderCommandBuffer::SetMinMagFilters( const MinFilter min, const MagFilter mag )
+{
+	auto& command = AddCommand( CommandType::SET_MIN_MAG_FILTERS );
+
+	command.filters.min = min;
+	command.filters.mag = mag;
+}
+
+void CRenderCommandBuffer::BeginGPUTimer( const char* const pszName )
+{
+	AddCommand( CommandType::BEGIN_GPU_TIMER ).pszTimerName = pszName;
+}
+
+void CRenderCommandBuffer::EndGPUTimer()
+{
+	AddCommand( CommandType::END_GPU_TIMER );
+}
+
+void CRenderCommandBuffer::Callback( Callback_t&& callback )
+{
+	if( !callback )
+		return;
+
+	AddCommand( CommandType::CALL_FUNCTION ).uiCallback = m_Callbacks.size();
+
+	m_Callbacks.emplace_back( std::move( callback ) );
+}
+
+void CRenderCommandBuffer::Execute( IRenderContext& context ) const
+{
+	for( const auto& command : m_Commands )
+	{
+		switch( command.type )
+		{
+		case CommandType::MATRIX_MODE:				context.MatrixMode( command.matrixMode ); break;
+		case CommandType::PUSH_MATRIX:				context.PushMatrix(); break;
+		case CommandType::POP_MATRIX:				context.PopMatrix(); break;
+		case CommandType::LOAD_IDENTITY:			context.LoadIdentity(); break;
+		case CommandType::LOAD_MATRIX:				context.LoadMatrix( glm::make_mat4( command.matrix ) ); break;
+		case CommandType::LOAD_TRANSPOSE_MATRIX:	context.LoadTransposeMatrix( glm::make_mat4( command.matrix ) ); break;
+		case CommandType::MULT_MATRIX:				context.MultMatrix( glm::make_mat4( command.matrix ) ); break;
+		case CommandType::MULT_TRANSPOSE_MATRIX:	context.MultTransposeMatrix( glm::make_mat4( command.matrix ) ); break;
+
+		case CommandType::ORTHO:
+			{
+				const auto& p = command.projection;
+				context.Ortho( p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ], p[ 4 ], p[ 5 ] );
+				break;
+			}
+
+		case CommandType::PERSPECTIVE_Y:
+			{
+				const auto& p = command.projection;
+				context.PerspectiveY( p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] );
+				break;
+			}
+
+		case CommandType::VIEWPORT:
+			{
+				const auto& v = command.viewport;
+				context.Viewport( v[ 0 ], v[ 1 ], v[ 2 ], v[ 3 ] );
+				break;
+			}
+
+		case CommandType::CLEAR_COLOR:
+			{
+				const auto& c = command.color;
+				context.ClearColor( c[ 0 ], c[ 1 ], c[ 2 ], c[ 3 ] );
+				break;
+			}
+
+		case CommandType::CLEAR:					context.Clear( command.clearBits ); break;
+		case CommandType::SET_CULL_FACE:			context.SetCullFace( command.cullFace ); break;
+		case CommandType::BIND_TEXTURE:				context.BindTexture( command.hTexture ); break;
+		case CommandType::SET_MIN_MAG_FILTERS:		context.SetMinMagFilters( command.filters.min, command.filters.mag ); break;
+		case CommandType::BEGIN_GPU_TIMER:			context.BeginGPUTimer( command.pszTimerName ); break;
+		case CommandType::END_GPU_TIMER:			context.EndGPUTimer(); break;
+		case CommandType::CALL_FUNCTION:			m_Callbacks[ command.uiCallback ]( context ); break;
+		}
+	}
+}
+
+CRenderCommandBuffer::Command_t& CRenderCommandBuffer::AddCommand( const CommandType type )
+{
+	m_Commands.emplace_back();
+
+	auto& command = m_Commands.back();
+
+	command.type = type;
+
+	return command;
+}
+
+void CRenderCommandBuffer::AddMatrixCommand( const CommandType type, const Mat4x4& mat )
+{
+	memcpy( AddCommand( type ).matrix, glm::value_ptr( mat ), sizeof( Command_t::matrix ) );
+}
+}
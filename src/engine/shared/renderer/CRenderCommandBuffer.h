@@ -0,0 +1,187 @@
+#ifndef ENGINE_RENDERER_CRENDERCOMMANDBUFFER_H
+#define ENGINE_RENDERER_CRENDERCOMMANDBUFFER_H
+
+#include <functional>
+#include <vector>
+
+#include "IRenderContext.h"
+
+namespace renderer
+{
+/**
+*	Records render context commands so they can be run later. Buffers can be recorded on any thread, one thread per buffer at a time,
+*	and are submitted to the context on the thread that owns it. This lets scene traversal, culling and pose setup run on worker threads
+*	while all GL calls stay on one thread.
+*
+*	Only commands that don't return anything can be recorded. Anything else, like drawing a model, can be recorded as a function
+*	that is called with the context when the buffer is run.
+*/
+class CRenderCommandBuffer final
+{
+public:
+	/**
+	*	Function that is called with the context when it's reached.
+	*/
+	using Callback_t = std::function<void( IRenderContext& context )>;
+
+private:
+	enum class CommandType
+	{
+		MATRIX_MODE = 0,
+		PUSH_MATRIX,
+		POP_MATRIX,
+		LOAD_IDENTITY,
+		LOAD_MATRIX,
+		LOAD_TRANSPOSE_MATRIX,
+		MULT_MATRIX,
+		MULT_TRANSPOSE_MATRIX,
+		ORTHO,
+		PERSPECTIVE_Y,
+		VIEWPORT,
+		CLEAR_COLOR,
+		CLEAR,
+		SET_CULL_FACE,
+		BIND_TEXTURE,
+		SET_MIN_MAG_FILTERS,
+		BEGIN_GPU_TIMER,
+		END_GPU_TIMER,
+		CALL_FUNCTION
+	};
+
+	struct Command_t
+	{
+		CommandType type;
+
+		union
+		{
+			MatrixMode::MatrixMode matrixMode;
+
+			/**
+			*	Column major, same as Mat4x4.
+			*/
+			vec_t matrix[ 16 ];
+
+			/**
+			*	Ortho and PerspectiveY arguments, in order.
+			*/
+			vec_t projection[ 6 ];
+
+			int viewport[ 4 ];
+
+			float color[ 4 ];
+
+			ClearBits_t clearBits;
+
+			CullFace cullFace;
+
+			HTexture_t hTexture;
+
+			struct
+			{
+				MinFilter min;
+				MagFilter mag;
+			} filters;
+
+			const char* pszTimerName;
+
+			/**
+			*	Index into m_Callbacks.
+			*/
+			size_t uiCallback;
+		};
+	};
+
+public:
+	CRenderCommandBuffer() = default;
+	CRenderCommandBuffer( CRenderCommandBuffer&& other ) = default;
+	CRenderCommandBuffer& operator=( CRenderCommandBuffer&& other ) = default;
+	~CRenderCommandBuffer() = default;
+
+	/**
+	*	@return Whether the buffer has no commands.
+	*/
+	bool IsEmpty() const { return m_Commands.empty(); }
+
+	/**
+	*	@return Number of recorded commands.
+	*/
+	size_t GetCommandCount() const { return m_Commands.size(); }
+
+	/**
+	*	Removes all commands. Memory is kept, so buffers that are recorded every frame don't allocate once they've grown.
+	*/
+	void Reset();
+
+	//Recorded versions of IRenderContext's methods.
+
+	void MatrixMode( const MatrixMode::MatrixMode mode );
+
+	void PushMatrix();
+
+	void PopMatrix();
+
+	void LoadIdentity();
+
+	void LoadMatrix( const Mat4x4& mat );
+
+	void LoadTransposeMatrix( const Mat4x4& mat );
+
+	void MultMatrix( const Mat4x4& mat );
+
+	void MultTransposeMatrix( const Mat4x4& mat );
+
+	void Ortho( vec_t flLeft, vec_t flRight, vec_t flBottom, vec_t flTop, vec_t flNear, vec_t flFar );
+
+	void PerspectiveY( vec_t flFOVY, vec_t flAspect, vec_t flNear, vec_t flFar );
+
+	void Viewport( int iX, int iY, int iWidth, int iHeight );
+
+	void ClearColor( const Color32& color );
+
+	void ClearColor( const Color24& color, float flA = 0 );
+
+	void ClearColor( float flR = 0, float flG = 0, float flB = 0, float flA = 0 );
+
+	void Clear( const ClearBits_t bits );
+
+	void SetCullFace( const CullFace cullFace );
+
+	void BindTexture( HTexture_t hTexture );
+
+	void SetMinMagFilters( const MinFilter min, const MagFilter mag );
+
+	/**
+	*	@see IRenderContext::BeginGPUTimer
+	*/
+	void BeginGPUTimer( const char* const pszName );
+
+	void EndGPUTimer();
+
+	/**
+	*	Records a function that is called with the context when the buffer is run. Anything it captures must stay valid until then.
+	*/
+	void Callback( Callback_t&& callback );
+
+	/**
+	*	Runs all commands on the given context, in the order they were recorded. Must be called on the thread that owns the context.
+	*	The buffer isn't changed, so it can be run again.
+	*/
+	void Execute( IRenderContext& context ) const;
+
+private:
+	Command_t& AddCommand( const CommandType type );
+
+	void AddMatrixCommand( const CommandType type, const Mat4x4& mat );
+
+private:
+	std::vector<Command_t> m_Commands;
+
+	std::vector<Callback_t> m_Callbacks;
+
+private:
+	CRenderCommandBuffer( const CRenderCommandBuffer& ) = delete;
+	CRenderCommandBuffer& operator=( const CRenderCommandBuffer& ) = delete;
+};
+}
+
+#endif //ENGINE_RENDERER_CRENDERCOMMANDBUFFER_H
@@ -0,0 +1,61 @@
+#ifndef ENGINE_RENDERER_DRAWSTATS_H
+#define ENGINE_RENDERER_DRAWSTATS_H
+
+#include <cstdint>
+
+namespace renderer
+{
+/**
+*	Work submitted to the driver since the stats were last reset. Renderers and render contexts each keep their own stats,
+*	and the tools reset them at the start of every frame, so batching and state filtering can be checked frame by frame.
+*/
+struct DrawStats_t
+{
+	uint32_t uiDrawCalls = 0;
+
+	/**
+	*	Vertices or indices submitted by all draw calls, instances included.
+	*/
+	uint32_t uiVertices = 0;
+
+	uint32_t uiTextureBinds = 0;
+
+	/**
+	*	State changes that were passed on to the driver. Changes dropped by state filtering aren't counted.
+	*/
+	uint32_t uiBlendChanges = 0;
+	uint32_t uiDepthChanges = 0;
+	uint32_t uiAlphaChanges = 0;
+
+	/**
+	*	Vertex, index, instance and texture data uploaded.
+	*/
+	uint64_t uiUploadedBytes = 0;
+
+	/**
+	*	Models and meshes that were skipped because they were outside the view.
+	*/
+	uint32_t uiCulledMeshes = 0;
+
+	void Reset()
+	{
+		*this = DrawStats_t();
+	}
+
+	DrawStats_t& operator+=( const DrawStats_t& other )
+	{
+		uiDrawCalls += other.uiDrawCalls;
+		uiVertices += other.uiVertices;
+		uiTextureBinds += other.uiTextureBinds;
+		uiBlendChanges += other.uiBlendChanges;
+		uiDepthChanges += other.uiDepthChanges;
+		uiAlphaChanges += other.uiAlphaChanges;
+		uiUploadedBytes += other.uiUploadedBytes;
+		uiCulledMeshes += other.uiCulledMeshes;
+
+		return *this;
+	}
+};
+}
+
+#endif //ENGINE_RENDERER_DRAWSTATS_H
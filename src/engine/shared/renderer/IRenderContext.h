@@ -1,6 +1,8 @@
 #ifndef ENGINE_RENDERER_IRENDERCONTEXT_H
 #define ENGINE_RENDERER_IRENDERCONTEXT_H
 
+#include <cstdint>
+
 #include "lib/LibInterface.h"
 
 #include "core/shared/Const.h"
@@ -8,6 +10,8 @@
 
 #include "utility/mathlib.h"
 
+#include "DrawStats.h"
+
 namespace renderer
 {
 namespace MatrixMode
@@ -137,6 +141,37 @@ typedef void* HTexture_t;
 */
 #define NULL_TEXTURE_HANDLE ( reinterpret_cast<HTexture_t>( 0 ) )
 
+/**
+*	Render contexts store integer texture names in handles. Converting through uintptr_t works for any pointer size.
+*/
+inline HTexture_t NameToTexHandle( const unsigned int uiName )
+{
+	return reinterpret_cast<HTexture_t>( static_cast<uintptr_t>( uiName ) );
+}
+
+inline unsigned int TexHandleToName( const HTexture_t hTexture )
+{
+	return static_cast<unsigned int>( reinterpret_cast<uintptr_t>( hTexture ) );
+}
+
+class CRenderCommandBuffer;
+
+/**
+*	Owner of a texture's data. Lets the render context evict textures that haven't been used recently and restore them when they're used again.
+*/
+class ITextureSource
+{
+public:
+	virtual ~ITextureSource() = default;
+
+	/**
+	*	Uploads the texture's contents again. The texture has been recreated without storage under the same name, and is bound.
+	*	Must not register or unregister textures.
+	*	@return Whether the texture was restored.
+	*/
+	virtual bool RestoreTexture( HTexture_t hTexture ) = 0;
+};
+
 /**
 *	Renderer context. Provides access to a variety of context specific operations.
 */
@@ -318,12 +353,85 @@ public:
 	*	@param mag Magnification filter.
 	*/
 	virtual void SetMinMagFilters( const MinFilter min, const MagFilter mag ) = 0;
+
+	/**
+	*	Tracks a texture that was created outside the context, so it counts towards the texture budget.
+	*	Textures created with CreateTexture are tracked automatically. Registering a tracked texture again updates it.
+	*	@param hTexture Texture to track.
+	*	@param uiSizeInBytes Estimated size of the texture in video memory.
+	*	@param pSource If not null, the texture can be evicted when the budget is exceeded and is restored by pSource when it's bound again.
+	*			Otherwise the texture is never evicted. Must remain valid until the texture is unregistered.
+	*/
+	virtual void RegisterTexture( HTexture_t hTexture, const size_t uiSizeInBytes, ITextureSource* pSource ) = 0;
+
+	/**
+	*	Stops tracking a texture. Must be called before a registered texture is deleted.
+	*/
+	virtual void UnregisterTexture( HTexture_t hTexture ) = 0;
+
+	/**
+	*	Starts timing GPU work. Timers can be nested; time spent in a nested timer is not counted in the outer timer.
+	*	Results are read back asynchronously and added to the frame profiler series of the same name a few frames later.
+	*	Does nothing if the profiler is disabled or timer queries are not supported.
+	*	@param pszName Name of the profiler series. Must remain valid for the rest of the program; string literals are expected.
+	*/
+	virtual void BeginGPUTimer( const char* const pszName ) = 0;
+
+	/**
+	*	Stops the timer that was started last.
+	*/
+	virtual void EndGPUTimer() = 0;
+
+	/**
+	*	Adds the results of finished timers to the profiler without waiting for unfinished ones.
+	*	Should be called once per frame, before the profiler's frame ends.
+	*/
+	virtual void ResolveGPUTimers() = 0;
+
+	/**
+	*	Runs the commands recorded in the given buffer. Buffers submitted one after another run in the order they were submitted.
+	*	Must be called on the thread that owns the context; the buffer must not be recorded into while it's running.
+	*	@see CRenderCommandBuffer
+	*/
+	virtual void Submit( const CRenderCommandBuffer& buffer ) = 0;
+
+	/**
+	*	@return Draw calls, texture binds, state changes and uploads made through this context since the last call to ResetDrawStats.
+	*/
+	virtual const DrawStats_t& GetDrawStats() const = 0;
+
+	virtual void ResetDrawStats() = 0;
+};
+
+/**
+*	Times GPU work for as long as this object's scope.
+*/
+class CScopedGPUTimer final
+{
+public:
+	CScopedGPUTimer( IRenderContext& context, const char* const pszName )
+		: m_Context( context )
+	{
+		m_Context.BeginGPUTimer( pszName );
+	}
+
+	~CScopedGPUTimer()
+	{
+		m_Context.EndGPUTimer();
+	}
+
+private:
+	IRenderContext& m_Context;
+
+private:
+	CScopedGPUTimer( const CScopedGPUTimer& ) = delete;
+	CScopedGPUTimer& operator=( const CScopedGPUTimer& ) = delete;
 };
 }
 
 /**
 *	Render context interface name.
 */
-#define IRENDERCONTEXT_NAME "IRenderContextV001"
+#define IRENDERCONTEXT_NAME "IRenderContextV005"
 
 #endif //ENGINE_RENDERER_IRENDERCONTEXT_H
\ No newline at end of file
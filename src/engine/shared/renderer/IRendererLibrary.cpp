@@ -0,0 +1,20 @@
+#include <cstring>
+
+#include "shared/Platform.h"
+
+#include "IRendererLibrary.h"
+
+namespace renderer
+{
+bool StringToRenderBackend( const char* const pszString, RenderBackend& backend )
+{
+	if( !strcasecmp( pszString, "imode" ) )
+		backend = RenderBackend::IMMEDIATE;
+	else if( !strcasecmp( pszString, "core" ) )
+		backend = RenderBackend::CORE;
+	else
+		return false;
+
+	return true;
+}
+}
@@ -5,16 +5,44 @@
 
 namespace renderer
 {
+class IRenderContext;
+
+/**
+*	Render context implementations.
+*/
+enum class RenderBackend
+{
+	/**
+	*	OpenGL immediate mode. Matrices are passed to the fixed function pipeline.
+	*/
+	IMMEDIATE = 0,
+
+	/**
+	*	OpenGL 3.3 core profile. Matrices are kept by the context and passed to its shaders.
+	*/
+	CORE
+};
+
+/**
+*	Converts a string to a render backend.
+*	@return Whether the string named a backend.
+*/
+bool StringToRenderBackend( const char* const pszString, RenderBackend& backend );
+
 class IRendererLibrary : public ILibSystem
 {
 public:
-
+	/**
+	*	Selects the render context that this library's renderers draw with. Must be called before Connect.
+	*	@return The render context of the given backend.
+	*/
+	virtual IRenderContext* SelectBackend( const RenderBackend backend ) = 0;
 };
 }
 
 /**
 *	Renderer library interface name.
 */
-#define IRENDERERLIBRARY_NAME "IRENDERERLIBRARYV001"
+#define IRENDERERLIBRARY_NAME "IRENDERERLIBRARYV002"
 
 #endif //ENGINE_RENDERER_IRENDERERLIBRARY_H
\ No newline at end of file
@@ -23,6 +23,17 @@ struct CSpriteRenderInfo final
 
 	float flFrame;
 
+	/**
+	*	If greater than 0, the sprite animates by itself at this many frames per second, starting at flFrame at flAnimStartTime.
+	*	The renderer picks the frame to show, on the GPU when it can, so nothing has to step the frame every frame.
+	*/
+	float flFrameRate = 0;
+
+	/**
+	*	World time that the animation started at.
+	*/
+	double flAnimStartTime = 0;
+
 	sprite::Type::Type type = sprite::Type::VP_PARALLEL_UPRIGHT;
 
 	bool bOverrideType = false;
@@ -4,6 +4,7 @@
 #include "lib/LibInterface.h"
 
 #include "engine/shared/renderer/DrawConstants.h"
+#include "engine/shared/renderer/DrawStats.h"
 
 /**
 *	@defgroup SpriteRenderer Sprite Renderer
@@ -59,6 +60,46 @@ public:
 	*	@param flags Draw flags.
 	*/
 	virtual void DrawSprite2D( const C2DSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags = renderer::DrawFlag::NONE ) = 0;
+
+	/**
+	*	Begins a batch. Sprites added to the batch are drawn together when Flush is called.
+	*	Sprites are grouped by texture and texture format, so translucent sprites that overlap may not be drawn in the order they were added.
+	*/
+	virtual void BeginBatch() = 0;
+
+	/**
+	*	Adds a sprite to the current batch. Draws it right away if no batch has been started.
+	*	@param pRenderInfo Render info.
+	*	@param flags Draw flags.
+	*	@see DrawSprite
+	*/
+	virtual void AddSprite( const CSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags ) = 0;
+
+	/**
+	*	Adds a 2D sprite to the current batch. Draws it right away if no batch has been started.
+	*	@param pRenderInfo Render info.
+	*	@param flags Draw flags.
+	*	@see DrawSprite2D
+	*/
+	virtual void AddSprite2D( const C2DSpriteRenderInfo* pRenderInfo, const renderer::DrawFlags_t flags = renderer::DrawFlag::NONE ) = 0;
+
+	/**
+	*	Draws all sprites in the current batch using the current matrices, and ends the batch.
+	*/
+	virtual void Flush() = 0;
+
+	/**
+	*	@return Draw calls, vertices and uploads since the last call to ResetDrawStats.
+	*	Texture binds and state changes are counted by the render context the renderer draws with.
+	*/
+	virtual const renderer::DrawStats_t& GetDrawStats() const = 0;
+
+	virtual void ResetDrawStats() = 0;
+
+	/**
+	*	Frees the GL resources created by the renderer. The GL context must still be current.
+	*/
+	virtual void Shutdown() = 0;
 };
 
 inline ISpriteRenderer::~ISpriteRenderer()
@@ -69,7 +110,7 @@ inline ISpriteRenderer::~ISpriteRenderer()
 /**
 *	Sprite renderer interface name.
 */
-#define ISPRITERENDERER_NAME "ISpriteRendererV001"
+#define ISPRITERENDERER_NAME "ISpriteRendererV002"
 
 /** @} */
 
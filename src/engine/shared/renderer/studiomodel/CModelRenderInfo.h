@@ -11,6 +11,8 @@
 *	@{
 */
 
+struct mstudiomodel_t;
+
 namespace studiomdl
 {
 class CStudioModel;
@@ -34,6 +36,12 @@ struct CModelRenderInfo
 	int iBodygroup;
 	int iSkin;
 
+	/**
+	*	Submodels selected by iBodygroup, indexed by body part, or null to resolve them from iBodygroup.
+	*	Only valid while the render info is being drawn; render info that is kept must not point to them.
+	*/
+	mstudiomodel_t* const* ppSubModels = nullptr;
+
 	byte iBlender[ 2 ];
 
 	byte iController[ 4 ];
@@ -1,6 +1,8 @@
 #ifndef ENGINE_STUDIOMODEL_ISTUDIOMODELRENDERER_H
 #define ENGINE_STUDIOMODEL_ISTUDIOMODELRENDERER_H
 
+#include <cstddef>
+
 #include <glm/vec3.hpp>
 
 #include "lib/LibInterface.h"
@@ -8,6 +10,7 @@
 #include "shared/Const.h"
 
 #include "engine/shared/renderer/DrawConstants.h"
+#include "engine/shared/renderer/DrawStats.h"
 
 #include "CModelRenderInfo.h"
 
@@ -20,6 +23,7 @@
 namespace studiomdl
 {
 class CStudioModel;
+class CStudioPoseContext;
 class IStudioModelRendererListener;
 
 /**
@@ -49,6 +53,11 @@ public:
 	*/
 	virtual unsigned int GetModelsDrawnCount() const = 0;
 
+	/**
+	*	@return The number of models that were skipped because they were outside the view during this map.
+	*/
+	virtual unsigned int GetModelsCulledCount() const = 0;
+
 	/**
 	*	@return The number of polygons drawn since the last call to Initialize.
 	*/
@@ -102,6 +111,55 @@ public:
 	*/
 	virtual unsigned int DrawModel( CModelRenderInfo* const pRenderInfo, const renderer::DrawFlags_t flags = renderer::DrawFlag::NONE ) = 0;
 
+	/**
+	*	Draws the given model using bones that have already been set up.
+	*	This allows bone setup to be done ahead of time, for instance on worker threads.
+	*	If the pose context was set up for a different model, bones are set up as they would be by DrawModel.
+	*	@param pRenderInfo Render info that describes the model. Should be the same render info that was used to set up the pose context.
+	*	@param poseContext Pose context whose bones have been set up for this model.
+	*	@param flags Flags.
+	*	@return Number of polygons that were drawn.
+	*/
+	virtual unsigned int DrawPosedModel( CModelRenderInfo* const pRenderInfo, CStudioPoseContext& poseContext, const renderer::DrawFlags_t flags = renderer::DrawFlag::NONE ) = 0;
+
+	/**
+	*	Draws many instances of the same model. Mesh and texture data is shared by all instances,
+	*	and the transforms and bone palettes of all instances are uploaded together so each mesh is drawn once for all of them.
+	*	Falls back to drawing each instance with DrawModel if instancing is disabled or unsupported, or if the instances use different models.
+	*	@param pRenderInfos Render infos that describe each instance. All instances must use the same model.
+	*	@param uiCount Number of instances.
+	*	@param flags Flags. Applied to all instances.
+	*	@return Number of polygons that were drawn.
+	*/
+	virtual unsigned int DrawModelInstances( CModelRenderInfo* const pRenderInfos, const size_t uiCount, const renderer::DrawFlags_t flags = renderer::DrawFlag::NONE ) = 0;
+
+	/**
+	*	Starts queueing meshes. Until FlushRenderQueue is called, meshes drawn by DrawModel and DrawPosedModel are stored instead of drawn,
+	*	so the meshes of all models can be sorted by render pass and texture. Meshes that can't be queued are drawn right away.
+	*	If a model has overlays that are drawn on top of it, the queue is flushed before they are drawn.
+	*	Does nothing if the render queue is disabled.
+	*/
+	virtual void BeginRenderQueue() = 0;
+
+	/**
+	*	Draws all queued meshes and stops queueing. GL state must be the same as it was when the meshes were queued.
+	*	@return Number of state changes that were avoided by sorting the queued meshes.
+	*/
+	virtual unsigned int FlushRenderQueue() = 0;
+
+	/**
+	*	@return The number of state changes avoided by the render queue since the last call to Initialize.
+	*/
+	virtual unsigned int GetStateChangesSavedCount() const = 0;
+
+	/**
+	*	@return Draw calls, vertices, uploads and culled models since the last call to ResetDrawStats.
+	*	Texture binds and state changes are counted by the render context the renderer draws with.
+	*/
+	virtual const renderer::DrawStats_t& GetDrawStats() const = 0;
+
+	virtual void ResetDrawStats() = 0;
+
 	/*
 	*	Tool only operations.
 	*/
@@ -134,7 +192,7 @@ public:
 /**
 *	StudioModel Renderer interface name.
 */
-#define ISTUDIOMODELRENDERER_NAME "IStudioModelRendererV001"
+#define ISTUDIOMODELRENDERER_NAME "IStudioModelRendererV003"
 
 /** @ } */
 
@@ -1,12 +1,31 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
 #include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
 #include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
 
+#include "shared/Allocator.h"
 #include "shared/Const.h"
+#include "shared/Logging.h"
+#include "shared/MemoryStats.h"
+#include "shared/Perf.h"
+#include "shared/Trace.h"
 
 #include "utility/ByteSwap.h"
 
+#include "engine/shared/EngineFileSystem.h"
+#include "engine/shared/EngineRenderContext.h"
+#include "engine/shared/renderer/IRenderContext.h"
+
 #include "graphics/Palette.h"
+#include "graphics/PaletteConversion.h"
+#include "graphics/TextureUpload.h"
 
 #include "CSprite.h"
 
@@ -14,6 +33,28 @@ namespace sprite
 {
 namespace
 {
+/**
+*	A frame whose pixels have been converted, but not uploaded yet.
+*/
+struct PendingFrame_t
+{
+	mspriteframe_t* pFrame;
+	std::unique_ptr<byte[]> pixels;
+
+	/**
+	*	Position of the frame's border in the atlas.
+	*/
+	int x = 0;
+	int y = 0;
+};
+
+typedef std::vector<PendingFrame_t> PendingFrames_t;
+
+/**
+*	Border around each frame in the atlas. Filled with the frame's edge pixels so filtering doesn't pick up neighbouring frames.
+*/
+const int ATLAS_FRAME_BORDER = 1;
+
 /**
 *	Converts an 8 bit indexed palette into a 32 bit palette using the given format.
 *	@param pInPalette 8 bit indexed palette.
@@ -33,13 +74,7 @@ void Convert8To32Bit( const byte* pInPalette, byte* pRGBAPalette, const TexForma
 	case TexFormat::SPR_NORMAL:
 	case TexFormat::SPR_ADDITIVE:
 		{
-			for( size_t uiIndex = 0; uiIndex < PALETTE_ENTRIES; ++uiIndex, pRGBA += 4 )
-			{
-				pRGBA[ 0 ] = pInPalette[ uiIndex * 3 ];
-				pRGBA[ 1 ] = pInPalette[ uiIndex * 3 + 1 ];
-				pRGBA[ 2 ] = pInPalette[ uiIndex * 3 + 2 ];
-				pRGBA[ 3 ] = 0xFF;
-			}
+			graphics::ConvertPaletteToRGBA( pInPalette, pRGBAPalette );
 
 			break;
 		}
@@ -75,21 +110,299 @@ void Convert8To32Bit( const byte* pInPalette, byte* pRGBAPalette, const TexForma
 	}
 }
 
-byte* LoadSpriteFrame( byte* pIn, mspriteframe_t** ppFrame, const int iFrame, const byte* pRGBAPalette )
+/**
+*	@return Estimated size of the texture in video memory.
+*/
+size_t UploadRGBATexture( const int iWidth, const int iHeight, const byte* pData, GLuint textureId )
+{
+	const auto settings = graphics::GetTextureUploadSettings( true );
+
+	graphics::UploadRGBATexture( textureId, iWidth, iHeight, pData, settings );
+
+	const size_t uiSize = graphics::EstimateRGBATextureSize( iWidth, iHeight, settings );
+
+	//Sprites are small and rebuilding an atlas isn't worth it, so they're only counted towards the texture budget, never evicted.
+	if( auto pRenderContext = engine::GetRenderContext() )
+		pRenderContext->RegisterTexture( renderer::NameToTexHandle( textureId ), uiSize, nullptr );
+
+	return uiSize;
+}
+
+/**
+*	Assigns each frame a position in an atlas using rows of frames sorted by height.
+*	@param frames Frames to pack.
+*	@param iMaxSize Largest width and height the atlas may have.
+*	@param iOutWidth Width of the atlas.
+*	@param iOutHeight Height of the atlas.
+*	@return Whether all frames fit.
+*/
+bool PackSpriteFrames( PendingFrames_t& frames, const int iMaxSize, int& iOutWidth, int& iOutHeight )
+{
+	size_t uiArea = 0;
+	int iMaxWidth = 0;
+
+	for( const auto& frame : frames )
+	{
+		const int iWidth = frame.pFrame->width + ATLAS_FRAME_BORDER * 2;
+		const int iHeight = frame.pFrame->height + ATLAS_FRAME_BORDER * 2;
+
+		uiArea += static_cast<size_t>( iWidth * iHeight );
+		iMaxWidth = std::max( iMaxWidth, iWidth );
+	}
+
+	//Aim for a square atlas.
+	const int iTargetWidth = std::max( iMaxWidth, static_cast<int>( std::ceil( std::sqrt( static_cast<double>( uiArea ) ) ) ) );
+
+	for( iOutWidth = 1; iOutWidth < iTargetWidth; iOutWidth <<= 1 )
+	{
+	}
+
+	iOutWidth = std::min( iOutWidth, iMaxSize );
+
+	if( iMaxWidth > iOutWidth )
+		return false;
+
+	std::vector<PendingFrame_t*> sortedFrames;
+
+	sortedFrames.reserve( frames.size() );
+
+	for( auto& frame : frames )
+	{
+		sortedFrames.push_back( &frame );
+	}
+
+	std::stable_sort( sortedFrames.begin(), sortedFrames.end(), 
+		[]( const PendingFrame_t* pLHS, const PendingFrame_t* pRHS )
+		{
+			return pLHS->pFrame->height > pRHS->pFrame->height;
+		}
+	);
+
+	int x = 0;
+	int y = 0;
+	int iRowHeight = 0;
+
+	for( auto pFrame : sortedFrames )
+	{
+		const int iWidth = pFrame->pFrame->width + ATLAS_FRAME_BORDER * 2;
+		const int iHeight = pFrame->pFrame->height + ATLAS_FRAME_BORDER * 2;
+
+		if( x + iWidth > iOutWidth )
+		{
+			x = 0;
+			y += iRowHeight;
+			iRowHeight = 0;
+		}
+
+		pFrame->x = x;
+		pFrame->y = y;
+
+		x += iWidth;
+		iRowHeight = std::max( iRowHeight, iHeight );
+	}
+
+	iOutHeight = y + iRowHeight;
+
+	return iOutHeight <= iMaxSize;
+}
+
+/**
+*	Copies a frame into the atlas, extending its edge pixels into the border.
+*/
+void CopyFrameToAtlas( const PendingFrame_t& frame, byte* pAtlas, const int iAtlasWidth )
+{
+	const int iWidth = frame.pFrame->width;
+	const int iHeight = frame.pFrame->height;
+
+	for( int y = -ATLAS_FRAME_BORDER; y < iHeight + ATLAS_FRAME_BORDER; ++y )
+	{
+		const int iSrcY = std::min( std::max( y, 0 ), iHeight - 1 );
+
+		const byte* pSrcRow = frame.pixels.get() + iSrcY * iWidth * 4;
+		byte* pDestRow = pAtlas + ( ( frame.y + ATLAS_FRAME_BORDER + y ) * iAtlasWidth + frame.x + ATLAS_FRAME_BORDER ) * 4;
+
+		memcpy( pDestRow, pSrcRow, iWidth * 4 );
+
+		for( int iBorder = 1; iBorder <= ATLAS_FRAME_BORDER; ++iBorder )
+		{
+			memcpy( pDestRow - iBorder * 4, pSrcRow, 4 );
+			memcpy( pDestRow + ( iWidth + iBorder - 1 ) * 4, pSrcRow + ( iWidth - 1 ) * 4, 4 );
+		}
+	}
+}
+
+/**
+*	Uploads all frames of a sprite. Frames are packed into a single texture if they fit, otherwise each frame gets its own texture.
+*	@return Estimated size of the textures in video memory.
+*/
+size_t UploadSpriteFrames( PendingFrames_t& frames )
+{
+	if( frames.empty() )
+		return 0;
+
+	GLint iMaxSize = 0;
+
+	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &iMaxSize );
+
+	int iAtlasWidth, iAtlasHeight;
+
+	if( !PackSpriteFrames( frames, iMaxSize, iAtlasWidth, iAtlasHeight ) )
+	{
+		size_t uiSize = 0;
+
+		for( auto& frame : frames )
+		{
+			mspriteframe_t* pFrame = frame.pFrame;
+
+			glGenTextures( 1, &pFrame->gl_texturenum );
+
+			uiSize += UploadRGBATexture( pFrame->width, pFrame->height, frame.pixels.get(), pFrame->gl_texturenum );
+
+			pFrame->smin = pFrame->tmin = 0;
+			pFrame->smax = pFrame->tmax = 1;
+		}
+
+		return uiSize;
+	}
+
+	std::unique_ptr<byte[]> atlas = std::make_unique<byte[]>( iAtlasWidth * iAtlasHeight * 4 );
+
+	memset( atlas.get(), 0, iAtlasWidth * iAtlasHeight * 4 );
+
+	GLuint atlasTexture;
+
+	glGenTextures( 1, &atlasTexture );
+
+	for( const auto& frame : frames )
+	{
+		CopyFrameToAtlas( frame, atlas.get(), iAtlasWidth );
+
+		mspriteframe_t* pFrame = frame.pFrame;
+
+		pFrame->gl_texturenum = atlasTexture;
+
+		pFrame->smin = static_cast<float>( frame.x + ATLAS_FRAME_BORDER ) / iAtlasWidth;
+		pFrame->tmin = static_cast<float>( frame.y + ATLAS_FRAME_BORDER ) / iAtlasHeight;
+		pFrame->smax = static_cast<float>( frame.x + ATLAS_FRAME_BORDER + pFrame->width ) / iAtlasWidth;
+		pFrame->tmax = static_cast<float>( frame.y + ATLAS_FRAME_BORDER + pFrame->height ) / iAtlasHeight;
+	}
+
+	return UploadRGBATexture( iAtlasWidth, iAtlasHeight, atlas.get(), atlasTexture );
+}
+
+/**
+*	Alignment of every allocation in a sprite's arena.
+*/
+const size_t ARENA_ALIGNMENT = alignof( std::max_align_t );
+
+size_t AlignArenaSize( const size_t uiSize )
+{
+	return ( uiSize + ARENA_ALIGNMENT - 1 ) & ~( ARENA_ALIGNMENT - 1 );
+}
+
+/**
+*	Memory that all of a sprite's data is placed in. The sprite itself is at the start, so freeing it frees everything.
+*/
+struct SpriteArena_t
+{
+	byte* pNext;
+	byte* pEnd;
+
+	template<typename T>
+	T* Allocate( const size_t uiSize )
+	{
+		byte* pMemory = pNext;
+
+		pNext += AlignArenaSize( uiSize );
+
+		assert( pNext <= pEnd );
+
+		return reinterpret_cast<T*>( pMemory );
+	}
+};
+
+/**
+*	Adds the memory that a frame needs to uiSize.
+*	@param pIn Frame data. Points past the frame afterwards.
+*	@param pEnd End of the sprite's data.
+*	@param uiSize Size of the arena.
+*	@return Whether the frame fits in the sprite's data.
+*/
+bool MeasureSpriteFrame( const byte*& pIn, const byte* const pEnd, size_t& uiSize )
+{
+	if( static_cast<size_t>( pEnd - pIn ) < sizeof( dspriteframe_t ) )
+		return false;
+
+	const dspriteframe_t* pFrame = reinterpret_cast<const dspriteframe_t*>( pIn );
+
+	const int iWidth = LittleValue( pFrame->width );
+	const int iHeight = LittleValue( pFrame->height );
+
+	if( iWidth < 0 || iHeight < 0 )
+		return false;
+
+	const size_t uiNumPixels = static_cast<size_t>( iWidth ) * iHeight;
+
+	pIn += sizeof( dspriteframe_t );
+
+	if( static_cast<size_t>( pEnd - pIn ) < uiNumPixels )
+		return false;
+
+	pIn += uiNumPixels;
+
+	uiSize += AlignArenaSize( sizeof( mspriteframe_t ) ) + AlignArenaSize( uiNumPixels );
+
+	return true;
+}
+
+/**
+*	Adds the memory that a group and its frames need to uiSize.
+*	@see MeasureSpriteFrame
+*/
+bool MeasureSpriteGroup( const byte*& pIn, const byte* const pEnd, size_t& uiSize )
+{
+	if( static_cast<size_t>( pEnd - pIn ) < sizeof( dspritegroup_t ) )
+		return false;
+
+	const int iNumFrames = LittleValue( reinterpret_cast<const dspritegroup_t*>( pIn )->numframes );
+
+	if( iNumFrames <= 0 )
+		return false;
+
+	pIn += sizeof( dspritegroup_t );
+
+	if( static_cast<size_t>( pEnd - pIn ) < sizeof( dspriteinterval_t ) * iNumFrames )
+		return false;
+
+	pIn += sizeof( dspriteinterval_t ) * iNumFrames;
+
+	uiSize += AlignArenaSize( sizeof( mspritegroup_t ) + ( ( iNumFrames - 1 ) * sizeof( mspriteframe_t* ) ) );
+
+	//Raw and cumulative intervals.
+	uiSize += AlignArenaSize( sizeof( float ) * iNumFrames * 2 );
+
+	for( int iIndex = 0; iIndex < iNumFrames; ++iIndex )
+	{
+		if( !MeasureSpriteFrame( pIn, pEnd, uiSize ) )
+			return false;
+	}
+
+	return true;
+}
+
+const byte* LoadSpriteFrame( const byte* pIn, mspriteframe_t** ppFrame, const int iFrame, const byte* pRGBAPalette, PendingFrames_t& frames, SpriteArena_t& arena )
 {
 	assert( pIn );
 	assert( ppFrame );
 
-	dspriteframe_t* pFrame = reinterpret_cast<dspriteframe_t*>( pIn );
+	const dspriteframe_t* pFrame = reinterpret_cast<const dspriteframe_t*>( pIn );
 
 	const int iWidth = LittleValue( pFrame->width );
 	const int iHeight = LittleValue( pFrame->height );
 
 	const glm::ivec2 vecOrigin{ LittleValue( pFrame->origin[ 0 ] ), LittleValue( pFrame->origin[ 1 ] ) };
 
-	mspriteframe_t* pSpriteFrame = new mspriteframe_t;
-
-	memset( pSpriteFrame, 0, sizeof( mspriteframe_t ) );
+	mspriteframe_t* pSpriteFrame = arena.Allocate<mspriteframe_t>( sizeof( mspriteframe_t ) );
 
 	*ppFrame = pSpriteFrame;
 
@@ -101,55 +414,47 @@ byte* LoadSpriteFrame( byte* pIn, mspriteframe_t** ppFrame, const int iFrame, co
 	pSpriteFrame->left		= static_cast<float>( vecOrigin[ 0 ] );
 	pSpriteFrame->right		= static_cast<float>( iWidth + vecOrigin[ 0 ] );
 
-	byte* pPixelData = reinterpret_cast<byte*>( pFrame + 1 );
+	const byte* pPixelData = reinterpret_cast<const byte*>( pFrame + 1 );
 
-	glGenTextures( 1, &pSpriteFrame->gl_texturenum );
+	if( iWidth > 0 && iHeight > 0 )
+	{
+		PendingFrame_t frame;
 
-	std::unique_ptr<byte[]> rgba = std::make_unique<byte[]>( iWidth * iHeight * 4 );
+		frame.pFrame = pSpriteFrame;
+		frame.pixels = std::make_unique<byte[]>( iWidth * iHeight * 4 );
 
-	byte* out  = rgba.get();
+		graphics::ExpandIndexedToRGBA( pPixelData, static_cast<size_t>( iWidth * iHeight ), pRGBAPalette, frame.pixels.get() );
 
-	for( int i = 0; i<iWidth; i++ )
-	{
-		for( int j = 0; j<iHeight; j++, out += 4 )
-		{
-			out[ 0 ] = pRGBAPalette[ pPixelData[ i * pSpriteFrame->width + j ] * 4 ];
-			out[ 1 ] = pRGBAPalette[ pPixelData[ i * pSpriteFrame->width + j ] * 4 + 1 ];
-			out[ 2 ] = pRGBAPalette[ pPixelData[ i * pSpriteFrame->width + j ] * 4 + 2 ];
-			out[ 3 ] = pRGBAPalette[ pPixelData[ i * pSpriteFrame->width + j ] * 4 + 3 ];
-		}
-	}
+		pSpriteFrame->pixels = arena.Allocate<byte>( iWidth * iHeight );
+
+		memcpy( pSpriteFrame->pixels, pPixelData, iWidth * iHeight );
 
-	//TODO: this is the same code as used by studiomodel. Refactor.
-	//TODO: it might be better to upload sprites as a single large texture containing all frames.
-	glBindTexture( GL_TEXTURE_2D, pSpriteFrame->gl_texturenum );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, iWidth, iHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.get() );
-	glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		frames.push_back( std::move( frame ) );
+	}
 
 	return pPixelData + ( iWidth * iHeight );
 }
 
-byte* LoadSpriteGroup( byte* pIn, mspriteframe_t** ppFrame, const int iFrame, const byte* pRGBAPalette )
+const byte* LoadSpriteGroup( const byte* pIn, mspriteframe_t** ppFrame, const int iFrame, const byte* pRGBAPalette, PendingFrames_t& frames, SpriteArena_t& arena )
 {
-	dspritegroup_t* pGroup = reinterpret_cast<dspritegroup_t*>( pIn );
+	const dspritegroup_t* pGroup = reinterpret_cast<const dspritegroup_t*>( pIn );
 
 	const int iNumFrames = LittleValue( pGroup->numframes );
 
 	const size_t size = sizeof( mspritegroup_t ) + ( ( iNumFrames - 1 ) * sizeof( mspriteframe_t* ) );
 
-	mspritegroup_t* pSpriteGroup = reinterpret_cast<mspritegroup_t*>( new byte[ size ] );
-
-	memset( pSpriteGroup, 0, size );
+	mspritegroup_t* pSpriteGroup = arena.Allocate<mspritegroup_t>( size );
 
 	*ppFrame = reinterpret_cast<mspriteframe_t*>( pSpriteGroup );
 
 	pSpriteGroup->numframes = iNumFrames;
 
-	float* pInIntervals = reinterpret_cast<float*>( pGroup + 1 );
+	const float* pInIntervals = reinterpret_cast<const float*>( pGroup + 1 );
+
+	//Raw and cumulative intervals share an allocation.
+	float* pOutIntervals = pSpriteGroup->intervals = arena.Allocate<float>( sizeof( float ) * iNumFrames * 2 );
 
-	float* pOutIntervals = pSpriteGroup->intervals = new float[ iNumFrames ];
+	pSpriteGroup->cumulativeintervals = pSpriteGroup->intervals + iNumFrames;
 
 	for( int iIndex = 0; iIndex < iNumFrames; ++iIndex, ++pInIntervals, ++pOutIntervals )
 	{
@@ -158,21 +463,42 @@ byte* LoadSpriteGroup( byte* pIn, mspriteframe_t** ppFrame, const int iFrame, co
 		//TODO: error checking
 	}
 
-	byte* pInput = reinterpret_cast<byte*>( pInIntervals );
+	//Stored intervals are the times at which each frame ends. Keep them increasing so they can be searched, even if the file is malformed.
+	float flTotal = 0;
+
+	for( int iIndex = 0; iIndex < iNumFrames; ++iIndex )
+	{
+		flTotal = std::max( flTotal, pSpriteGroup->intervals[ iIndex ] );
+		pSpriteGroup->cumulativeintervals[ iIndex ] = flTotal;
+	}
+
+	for( int iIndex = 0; iIndex < iNumFrames; ++iIndex )
+	{
+		//Without usable intervals every frame is shown for the same amount of time.
+		pSpriteGroup->cumulativeintervals[ iIndex ] = flTotal > 0 ? pSpriteGroup->cumulativeintervals[ iIndex ] / flTotal : static_cast<float>( iIndex + 1 ) / iNumFrames;
+	}
+
+	const byte* pInput = reinterpret_cast<const byte*>( pInIntervals );
 
 	for( int iIndex = 0; iIndex < iNumFrames; ++iIndex )
 	{
-		pInput = LoadSpriteFrame( pInput, &pSpriteGroup->frames[ iIndex ], iFrame * 100 + iIndex, pRGBAPalette );
+		pInput = LoadSpriteFrame( pInput, &pSpriteGroup->frames[ iIndex ], iFrame * 100 + iIndex, pRGBAPalette, frames, arena );
 	}
 
 	return pInput;
 }
 
-bool LoadSpriteInternal( byte* pIn, msprite_t*& pSprite )
+/**
+*	@param bUploadTextures Whether to upload the frames. If not, frames have no textures and their converted pixels are discarded.
+*/
+bool LoadSpriteInternal( const byte* pIn, const size_t uiSize, const bool bUploadTextures, msprite_t*& pSprite )
 {
 	assert( pIn );
 
-	dsprite_t* pHeader = reinterpret_cast<dsprite_t*>( pIn );
+	if( uiSize < sizeof( dsprite_t ) + sizeof( short ) + PALETTE_SIZE )
+		return false;
+
+	const dsprite_t* pHeader = reinterpret_cast<const dsprite_t*>( pIn );
 
 	if( LittleValue( pHeader->version ) != SPRITE_VERSION )
 		return false;
@@ -183,11 +509,11 @@ bool LoadSpriteInternal( byte* pIn, msprite_t*& pSprite )
 	//Offset in the buffer where the frames are located
 	size_t uiFrameOffset = 0;
 
-	byte* pPalette = nullptr;
+	const byte* pPalette = nullptr;
 
-	if( *reinterpret_cast<short*>( pHeader + 1 ) == PALETTE_ENTRIES )
+	if( *reinterpret_cast<const short*>( pHeader + 1 ) == PALETTE_ENTRIES )
 	{
-		pPalette = reinterpret_cast<byte*>( reinterpret_cast<short*>( pHeader + 1 ) + 1 );
+		pPalette = reinterpret_cast<const byte*>( reinterpret_cast<const short*>( pHeader + 1 ) + 1 );
 
 		uiFrameOffset = ( pPalette + PALETTE_SIZE ) - pIn;
 	}
@@ -204,11 +530,40 @@ bool LoadSpriteInternal( byte* pIn, msprite_t*& pSprite )
 
 	const int iNumFrames = LittleValue( pHeader->numframes );
 
-	const size_t size = sizeof( msprite_t ) + ( sizeof( mspriteframedesc_t ) * iNumFrames - 1 );
+	if( iNumFrames < 0 )
+		return false;
+
+	//Work out how much memory the sprite needs so everything can be placed in a single allocation.
+	size_t size = AlignArenaSize( sizeof( msprite_t ) + ( sizeof( mspriteframedesc_t ) * ( std::max( iNumFrames, 1 ) - 1 ) ) );
+
+	{
+		const byte* pInput = pIn + uiFrameOffset;
+		const byte* const pEnd = pIn + uiSize;
+
+		for( int iFrame = 0; iFrame < iNumFrames; ++iFrame )
+		{
+			if( static_cast<size_t>( pEnd - pInput ) < sizeof( spriteframetype_t ) )
+				return false;
+
+			const spriteframetype_t type = LittleEnumValue( *reinterpret_cast<const spriteframetype_t*>( pInput ) );
+
+			pInput += sizeof( spriteframetype_t );
+
+			const bool bFits = type == spriteframetype_t::SINGLE ? MeasureSpriteFrame( pInput, pEnd, size ) : MeasureSpriteGroup( pInput, pEnd, size );
+
+			if( !bFits )
+				return false;
+		}
+	}
+
+	SpriteArena_t arena;
+
+	arena.pNext = static_cast<byte*>( mem::Allocate( size, mem::Tag::SPRITE ) );
+	arena.pEnd = arena.pNext + size;
 
-	pSprite = reinterpret_cast<msprite_t*>( new byte[ size ] );
+	memset( arena.pNext, 0, size );
 
-	memset( pSprite, 0, size );
+	pSprite = arena.Allocate<msprite_t>( sizeof( msprite_t ) + ( sizeof( mspriteframedesc_t ) * ( std::max( iNumFrames, 1 ) - 1 ) ) );
 
 	pSprite->type		= LittleEnumValue( pHeader->type );
 	pSprite->texFormat	= texFormat;
@@ -216,11 +571,16 @@ bool LoadSpriteInternal( byte* pIn, msprite_t*& pSprite )
 	pSprite->maxheight	= LittleValue( pHeader->height );
 	pSprite->numframes	= iNumFrames;
 	pSprite->beamlength	= LittleValue( pHeader->beamlength );
+	pSprite->memorysize	= size;
+
+	memcpy( pSprite->palette, pPalette, sizeof( pSprite->palette ) );
 	//TODO: sync type
 
 	//Load frames
 
-	spriteframetype_t* pType = reinterpret_cast<spriteframetype_t*>( pIn + uiFrameOffset );
+	const spriteframetype_t* pType = reinterpret_cast<const spriteframetype_t*>( pIn + uiFrameOffset );
+
+	PendingFrames_t frames;
 
 	for( int iFrame = 0; iFrame < iNumFrames; ++iFrame )
 	{
@@ -230,43 +590,205 @@ bool LoadSpriteInternal( byte* pIn, msprite_t*& pSprite )
 
 		if( type == spriteframetype_t::SINGLE )
 		{
-			pType = reinterpret_cast<spriteframetype_t*>( LoadSpriteFrame( reinterpret_cast<byte*>( pType + 1 ), &pSprite->frames[ iFrame ].frameptr, iFrame, convertedPalette ) );
+			pType = reinterpret_cast<const spriteframetype_t*>( LoadSpriteFrame( reinterpret_cast<const byte*>( pType + 1 ), &pSprite->frames[ iFrame ].frameptr, iFrame, convertedPalette, frames, arena ) );
 		}
 		else
 		{
-			pType = reinterpret_cast<spriteframetype_t*>( LoadSpriteGroup( reinterpret_cast<byte*>( pType + 1 ), &pSprite->frames[ iFrame ].frameptr, iFrame, convertedPalette ) );
+			pType = reinterpret_cast<const spriteframetype_t*>( LoadSpriteGroup( reinterpret_cast<const byte*>( pType + 1 ), &pSprite->frames[ iFrame ].frameptr, iFrame, convertedPalette, frames, arena ) );
 		}
 	}
 
+	pSprite->texturememorysize = bUploadTextures ? UploadSpriteFrames( frames ) : 0;
+
+	pSprite->singleatlas = bUploadTextures && iNumFrames > 0;
+
+	for( int iFrame = 0; iFrame < iNumFrames && pSprite->singleatlas; ++iFrame )
+	{
+		const auto& framedesc = pSprite->frames[ iFrame ];
+
+		pSprite->singleatlas = framedesc.type == spriteframetype_t::SINGLE && framedesc.GetFrame()->gl_texturenum == pSprite->frames[ 0 ].GetFrame()->gl_texturenum;
+	}
+
+	mem::Add( mem::Category::SPRITE_FRAMES, static_cast<int64_t>( pSprite->memorysize ) );
+	mem::Add( mem::Category::SPRITE_TEXTURES, static_cast<int64_t>( pSprite->texturememorysize ) );
+
 	return true;
 }
+
+/**
+*	Appends values to a buffer that was sized up front, so building a file never reallocates.
+*/
+struct SpriteWriter_t
+{
+	byte* pNext;
+
+	void Write( const void* pData, const size_t uiSize )
+	{
+		memcpy( pNext, pData, uiSize );
+		pNext += uiSize;
+	}
+
+	template<typename T>
+	void WriteValue( const T value )
+	{
+		const T swapped = LittleValue( value );
+
+		Write( &swapped, sizeof( swapped ) );
+	}
+
+	template<typename T>
+	void WriteEnum( const T value )
+	{
+		const T swapped = LittleEnumValue( value );
+
+		Write( &swapped, sizeof( swapped ) );
+	}
+};
+
+size_t GetSpriteFrameFileSize( const mspriteframe_t* pFrame )
+{
+	return sizeof( dspriteframe_t ) + static_cast<size_t>( pFrame->width ) * pFrame->height;
 }
 
-bool LoadSprite( const char* const pszFilename, msprite_t*& pSprite )
+size_t GetFrameDescriptorFileSize( const mspriteframedesc_t& desc )
 {
-	assert( pszFilename );
+	size_t uiSize = sizeof( spriteframetype_t );
 
-	pSprite = nullptr;
+	if( desc.type == spriteframetype_t::SINGLE )
+		return uiSize + GetSpriteFrameFileSize( desc.GetFrame() );
+
+	const mspritegroup_t* pGroup = desc.GetGroup();
+
+	uiSize += sizeof( dspritegroup_t ) + sizeof( dspriteinterval_t ) * pGroup->numframes;
+
+	for( int iIndex = 0; iIndex < pGroup->numframes; ++iIndex )
+	{
+		uiSize += GetSpriteFrameFileSize( pGroup->GetFrame( iIndex ) );
+	}
+
+	return uiSize;
+}
+
+void WriteSpriteFrame( SpriteWriter_t& writer, const mspriteframe_t* pFrame )
+{
+	//The loader stores the origin as the frame's up and left extents.
+	writer.WriteValue( static_cast<int>( pFrame->left ) );
+	writer.WriteValue( static_cast<int>( pFrame->up ) );
+	writer.WriteValue( pFrame->width );
+	writer.WriteValue( pFrame->height );
+
+	const size_t uiNumPixels = static_cast<size_t>( pFrame->width ) * pFrame->height;
+
+	if( uiNumPixels > 0 )
+		writer.Write( pFrame->pixels, uiNumPixels );
+}
+
+void WriteFrameDescriptor( SpriteWriter_t& writer, const mspriteframedesc_t& desc )
+{
+	writer.WriteEnum( desc.type );
+
+	if( desc.type == spriteframetype_t::SINGLE )
+	{
+		WriteSpriteFrame( writer, desc.GetFrame() );
+		return;
+	}
+
+	const mspritegroup_t* pGroup = desc.GetGroup();
+
+	writer.WriteValue( pGroup->numframes );
+
+	for( int iIndex = 0; iIndex < pGroup->numframes; ++iIndex )
+	{
+		writer.WriteValue( pGroup->GetInterval( iIndex ) );
+	}
+
+	for( int iIndex = 0; iIndex < pGroup->numframes; ++iIndex )
+	{
+		WriteSpriteFrame( writer, pGroup->GetFrame( iIndex ) );
+	}
+}
+
+/**
+*	Gets the largest frame size of a frame descriptor.
+*/
+void GetFrameDescriptorSize( const mspriteframedesc_t& desc, int& iMaxWidth, int& iMaxHeight )
+{
+	if( desc.type == spriteframetype_t::SINGLE )
+	{
+		iMaxWidth = std::max( iMaxWidth, desc.GetFrame()->width );
+		iMaxHeight = std::max( iMaxHeight, desc.GetFrame()->height );
+		return;
+	}
+
+	const mspritegroup_t* pGroup = desc.GetGroup();
+
+	for( int iIndex = 0; iIndex < pGroup->numframes; ++iIndex )
+	{
+		iMaxWidth = std::max( iMaxWidth, pGroup->GetFrame( iIndex )->width );
+		iMaxHeight = std::max( iMaxHeight, pGroup->GetFrame( iIndex )->height );
+	}
+}
 
-	FILE* pFile = fopen( pszFilename, "rb" );
+/**
+*	Writes a file with a single write. The data goes to a temporary file first, so a failed write doesn't destroy an existing file.
+*/
+bool WriteSpriteFile( const char* const pszFilename, const byte* pData, const size_t uiSize )
+{
+	const std::string szTempFilename = std::string( pszFilename ) + ".tmp";
+
+	FILE* pFile = fopen( szTempFilename.c_str(), "wb" );
 
 	if( !pFile )
+	{
+		Error( "SaveSprite: Couldn't open \"%s\" for writing\n", szTempFilename.c_str() );
+		return false;
+	}
+
+	const bool bWritten = fwrite( pData, 1, uiSize, pFile ) == uiSize;
+
+	if( fclose( pFile ) != 0 || !bWritten )
+	{
+		Error( "SaveSprite: Couldn't write \"%s\"\n", szTempFilename.c_str() );
+		remove( szTempFilename.c_str() );
 		return false;
+	}
+
+	std::error_code error;
+
+	//Renaming doesn't replace existing files on all platforms.
+	std::experimental::filesystem::remove( pszFilename, error );
+
+	error.clear();
+
+	std::experimental::filesystem::rename( szTempFilename, pszFilename, error );
+
+	if( error )
+	{
+		Error( "SaveSprite: Couldn't rename \"%s\" to \"%s\": %s\n", szTempFilename.c_str(), pszFilename, error.message().c_str() );
+		remove( szTempFilename.c_str() );
+		return false;
+	}
 
-	const auto pos = ftell( pFile );
-	fseek( pFile, 0, SEEK_END );
-	const auto size = ftell( pFile );
-	fseek( pFile, pos, SEEK_SET );
+	return true;
+}
 
-	std::unique_ptr<byte[]> pBuffer = std::make_unique<byte[]>( size );
+/**
+*	@param bUploadTextures Whether to upload the frames.
+*/
+bool LoadSpriteFromFile( const char* const pszFilename, const bool bUploadTextures, msprite_t*& pSprite )
+{
+	assert( pszFilename );
 
-	bool bSuccess = fread( pBuffer.get(), size, 1, pFile ) == 1;
+	pSprite = nullptr;
+
+	//The sprite is converted straight from the file's data, there's no need to copy it.
+	filesystem::CFileData data;
 
-	fclose( pFile );
+	bool bSuccess = engine::ReadFile( pszFilename, data );
 
 	if( bSuccess )
 	{
-		bSuccess = LoadSpriteInternal( pBuffer.get(), pSprite );
+		bSuccess = LoadSpriteInternal( data.GetData(), data.GetSize(), bUploadTextures, pSprite );
 	}
 
 	if( !bSuccess )
@@ -277,36 +799,149 @@ bool LoadSprite( const char* const pszFilename, msprite_t*& pSprite )
 
 	return bSuccess;
 }
+}
+
+void ConvertPaletteToRGBA( const byte* pPalette, const TexFormat::TexFormat format, byte* pRGBAPalette )
+{
+	Convert8To32Bit( pPalette, pRGBAPalette, format );
+}
+
+bool LoadSprite( const char* const pszFilename, msprite_t*& pSprite )
+{
+	TRACE_SCOPE( "LoadSprite" );
+	PERF_SCOPE( "LoadSprite" );
+
+	return LoadSpriteFromFile( pszFilename, true, pSprite );
+}
+
+bool LoadSpriteFiles( const char* const pszFilename, msprite_t*& pSprite )
+{
+	TRACE_SCOPE( "LoadSpriteFiles" );
+	PERF_SCOPE( "LoadSpriteFiles" );
+
+	return LoadSpriteFromFile( pszFilename, false, pSprite );
+}
 
 void FreeSprite( msprite_t* pSprite )
 {
 	if( !pSprite )
 		return;
 
+	//Frames can share a texture, so collect them and delete each one once.
+	std::vector<GLuint> textures;
+
+	auto addTexture = [ & ]( const mspriteframe_t* pFrame )
+	{
+		if( pFrame && pFrame->gl_texturenum != 0 )
+			textures.push_back( pFrame->gl_texturenum );
+	};
+
 	for( int iFrame = 0; iFrame < pSprite->numframes; ++iFrame )
 	{
 		if( pSprite->frames[ iFrame ].type == spriteframetype_t::SINGLE )
 		{
-			delete pSprite->frames[ iFrame ].frameptr;
+			addTexture( pSprite->frames[ iFrame ].frameptr );
 		}
 		else
 		{
-			mspritegroup_t* pGroup = reinterpret_cast<mspritegroup_t*>( pSprite->frames[ iFrame ].frameptr );
+			const mspritegroup_t* pGroup = pSprite->frames[ iFrame ].GetGroup();
 
 			if( pGroup )
 			{
-				delete[] pGroup->intervals;
-
 				for( int iGroupFrame = 0; iGroupFrame < pGroup->numframes; ++iGroupFrame )
 				{
-					delete pGroup->frames[ iGroupFrame ];
+					addTexture( pGroup->frames[ iGroupFrame ] );
 				}
+			}
+		}
+	}
 
-				delete pGroup;
+	std::sort( textures.begin(), textures.end() );
+	textures.erase( std::unique( textures.begin(), textures.end() ), textures.end() );
+
+	if( !textures.empty() )
+	{
+		if( auto pRenderContext = engine::GetRenderContext() )
+		{
+			for( const auto texture : textures )
+			{
+				pRenderContext->UnregisterTexture( renderer::NameToTexHandle( texture ) );
 			}
 		}
+
+		glDeleteTextures( static_cast<GLsizei>( textures.size() ), textures.data() );
 	}
 
-	delete[] pSprite;
+	mem::Add( mem::Category::SPRITE_FRAMES, -static_cast<int64_t>( pSprite->memorysize ) );
+	mem::Add( mem::Category::SPRITE_TEXTURES, -static_cast<int64_t>( pSprite->texturememorysize ) );
+
+	//Everything else is in the sprite's arena.
+	mem::Free( pSprite );
+}
+
+bool SaveSprite( const char* const pszFilename, const msprite_t* pSprite )
+{
+	assert( pSprite );
+
+	return SaveSprite( pszFilename, pSprite, pSprite->texFormat, 0, -1 );
+}
+
+bool SaveSprite( const char* const pszFilename, const msprite_t* pSprite, const TexFormat::TexFormat texFormat, const int iFirstFrame, const int iNumFrames )
+{
+	assert( pszFilename );
+	assert( pSprite );
+
+	TRACE_SCOPE( "SaveSprite" );
+	PERF_SCOPE( "SaveSprite" );
+
+	if( iFirstFrame < 0 || iFirstFrame > pSprite->numframes )
+	{
+		Error( "SaveSprite: First frame %d is out of range, sprite has %d frames\n", iFirstFrame, pSprite->numframes );
+		return false;
+	}
+
+	const int iLastFrame = iNumFrames < 0 ? pSprite->numframes : std::min( pSprite->numframes, iFirstFrame + iNumFrames );
+
+	size_t uiSize = sizeof( dsprite_t ) + sizeof( short ) + PALETTE_SIZE;
+
+	int iMaxWidth = 0;
+	int iMaxHeight = 0;
+
+	for( int iFrame = iFirstFrame; iFrame < iLastFrame; ++iFrame )
+	{
+		const mspriteframedesc_t& desc = *pSprite->GetFrameDescriptor( iFrame );
+
+		uiSize += GetFrameDescriptorFileSize( desc );
+
+		GetFrameDescriptorSize( desc, iMaxWidth, iMaxHeight );
+	}
+
+	std::unique_ptr<byte[]> data = std::make_unique<byte[]>( uiSize );
+
+	SpriteWriter_t writer{ data.get() };
+
+	writer.WriteValue( static_cast<int>( SPRITE_ID ) );
+	writer.WriteValue( static_cast<int>( SPRITE_VERSION ) );
+	writer.WriteEnum( pSprite->type );
+	writer.WriteEnum( texFormat );
+	writer.WriteValue( std::sqrt( ( iMaxWidth / 2.0f ) * ( iMaxWidth / 2.0f ) + ( iMaxHeight / 2.0f ) * ( iMaxHeight / 2.0f ) ) );
+	writer.WriteValue( iMaxWidth );
+	writer.WriteValue( iMaxHeight );
+	writer.WriteValue( iLastFrame - iFirstFrame );
+	writer.WriteValue( pSprite->beamlength );
+	//The sync type isn't kept when loading.
+	writer.WriteEnum( synctype_t::SYNC );
+
+	writer.WriteValue( static_cast<short>( PALETTE_ENTRIES ) );
+	writer.Write( pSprite->palette, PALETTE_SIZE );
+
+	for( int iFrame = iFirstFrame; iFrame < iLastFrame; ++iFrame )
+	{
+		WriteFrameDescriptor( writer, *pSprite->GetFrameDescriptor( iFrame ) );
+	}
+
+	assert( writer.pNext == data.get() + uiSize );
+
+	return WriteSpriteFile( pszFilename, data.get(), uiSize );
+}
 }
-}
\ No newline at end of file
@@ -7,7 +7,37 @@ namespace sprite
 {
 bool LoadSprite( const char* const pszFilename, msprite_t*& pSprite );
 
+/**
+*	Loads a sprite without uploading its frames, so no GL context is needed and it can be called from any thread.
+*	Frames have no textures, the sprite can only be inspected.
+*/
+bool LoadSpriteFiles( const char* const pszFilename, msprite_t*& pSprite );
+
 void FreeSprite( msprite_t* pSprite );
+
+/**
+*	Saves a sprite. Frames are written from their retained pixels, so no textures are read back.
+*	The file is built in memory and written with a single write to a temporary file, which then replaces the destination.
+*	@return Whether the sprite was saved.
+*/
+bool SaveSprite( const char* const pszFilename, const msprite_t* pSprite );
+
+/**
+*	Saves a range of a sprite's frames with the given texture format. Frame groups count as a single frame.
+*	The header's size and bounding radius are computed from the frames that are saved.
+*	@param iFirstFrame First frame to save.
+*	@param iNumFrames Number of frames to save, or -1 to save all frames from iFirstFrame onward.
+*	@see SaveSprite( const char* const, const msprite_t* )
+*/
+bool SaveSprite( const char* const pszFilename, const msprite_t* pSprite, const TexFormat::TexFormat texFormat, const int iFirstFrame, const int iNumFrames );
+
+/**
+*	Converts a sprite palette to RGBA the same way it's converted when frames are uploaded, so exported frames look the way they're drawn.
+*	@param pPalette Palette to convert. Must be PALETTE_SIZE bytes.
+*	@param format Texture format of the sprite.
+*	@param pRGBAPalette Converted palette. Must be PALETTE_ENTRIES * 4 bytes.
+*/
+void ConvertPaletteToRGBA( const byte* pPalette, const TexFormat::TexFormat format, byte* pRGBAPalette );
 }
 
 #endif //ENGINE_SHARED_SPRITE_CSPRITE_H
\ No newline at end of file
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
 #include "core/shared/Platform.h"
 
 #include "sprite.h"
@@ -116,4 +120,44 @@ TexFormat::TexFormat StringToTexFormat( const char* const pszString, bool* pbSuc
 
 	return result;
 }
-}
\ No newline at end of file
+
+const mspriteframe_t* GetGroupFrame( const mspritegroup_t* pGroup, const float flFraction )
+{
+	assert( pGroup->numframes > 0 );
+
+	//The last frame is shown until the end, so it never has to be searched for.
+	const float* const pBegin = pGroup->cumulativeintervals;
+	const float* const pEnd = pBegin + pGroup->numframes - 1;
+
+	const float* const pInterval = std::upper_bound( pBegin, pEnd, flFraction );
+
+	return pGroup->frames[ pInterval - pBegin ];
+}
+
+const mspriteframe_t* GetSpriteFrame( const msprite_t* pSprite, const float flFrame )
+{
+	const float flIndex = floor( flFrame );
+
+	const int iIndex = std::max( 0, std::min( static_cast<int>( flIndex ), pSprite->numframes - 1 ) );
+
+	const auto& framedesc = pSprite->frames[ iIndex ];
+
+	if( framedesc.type == spriteframetype_t::SINGLE )
+		return framedesc.frameptr;
+
+	return GetGroupFrame( framedesc.GetGroup(), flFrame - flIndex );
+}
+
+float GetAnimatedFrame( const msprite_t* pSprite, const float flStartFrame, const float flFrameRate, const double flElapsedTime )
+{
+	if( pSprite->numframes <= 0 )
+		return 0;
+
+	const double flFrame = flStartFrame + flElapsedTime * flFrameRate;
+
+	//Wraps negative values too, so animations started in the future still show a valid frame.
+	const double flWrapped = flFrame - pSprite->numframes * floor( flFrame / pSprite->numframes );
+
+	return std::min( static_cast<float>( flWrapped ), std::nextafter( static_cast<float>( pSprite->numframes ), 0.0f ) );
+}
+}
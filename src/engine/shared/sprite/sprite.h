@@ -3,7 +3,10 @@
 
 #include <glm/vec2.hpp>
 
+#include "shared/Const.h"
+
 #include "graphics/OpenGL.h"
+#include "graphics/Palette.h"
 
 /**
 *	@file sprite.h Sprite file and memory definitions
@@ -343,14 +346,25 @@ struct mspriteframe_t final
 	int		height;
 
 	/**
-	*	Texture coordinates for this frame. Range [0, 1].
+	*	Extents of this frame relative to its origin.
 	*/
 	float	up, down, left, right;
 
 	/**
-	*	OpenGL texture ID.
+	*	OpenGL texture ID. All frames of a sprite share a single atlas texture when it fits.
 	*/
 	GLuint	gl_texturenum;
+
+	/**
+	*	Texture coordinates of this frame's rectangle in gl_texturenum. Range [0, 1].
+	*/
+	float	smin, tmin, smax, tmax;
+
+	/**
+	*	Indexed pixels of this frame, width * height bytes. Kept so tools can use the frame's contents without reading it back from the GPU.
+	*	@see msprite_t::palette
+	*/
+	byte*	pixels;
 };
 
 /**
@@ -370,6 +384,13 @@ struct mspritegroup_t final
 
 	float GetInterval( const size_t uiIndex ) const { return intervals[ uiIndex ]; }
 
+	/**
+	*	Pointer to the array of cumulative intervals, normalized to the range [0, 1]. Frame i is shown until cumulativeintervals[ i ] is reached.
+	*	Always increasing, so frames can be found with a binary search.
+	*	@see GetGroupFrame
+	*/
+	float* cumulativeintervals;
+
 	/**
 	*	Array of frames. Has numframes elements.
 	*	@see numframes
@@ -443,6 +464,27 @@ struct msprite_t final
 	*/
 	void* cachespot;
 
+	/**
+	*	Size of the sprite's allocation, in bytes.
+	*/
+	size_t memorysize;
+
+	/**
+	*	Estimated video memory used by the sprite's textures, in bytes.
+	*/
+	size_t texturememorysize;
+
+	/**
+	*	Whether every frame is a single frame and all of them are in the same atlas texture.
+	*	The frame to show can then be picked from its index alone, without switching textures.
+	*/
+	bool singleatlas;
+
+	/**
+	*	Palette that frame pixels index into.
+	*/
+	byte palette[ PALETTE_SIZE ];
+
 	/**
 	*	Array of frame descriptors. Has numframes elements.
 	*	@see numframes
@@ -453,6 +495,31 @@ struct msprite_t final
 			mspriteframedesc_t* GetFrameDescriptor( const size_t uiIndex )			{ return &frames[ uiIndex ]; }
 };
 
+/**
+*	Gets the frame of a group to show at the given point in the group's animation.
+*	@param pGroup Group to get the frame from.
+*	@param flFraction Point in the animation. Range [0, 1).
+*/
+const mspriteframe_t* GetGroupFrame( const mspritegroup_t* pGroup, const float flFraction );
+
+/**
+*	Gets the frame to show for the given frame value.
+*	The integral part selects the frame descriptor, the fractional part selects the frame if the descriptor is a group.
+*	@param pSprite Sprite to get the frame from.
+*	@param flFrame Frame value. Clamped to the sprite's frames.
+*/
+const mspriteframe_t* GetSpriteFrame( const msprite_t* pSprite, const float flFrame );
+
+/**
+*	Gets the frame value of a sprite that animates by itself, looping over all of its frames.
+*	@param pSprite Sprite to get the frame for.
+*	@param flStartFrame Frame value that the animation started at.
+*	@param flFrameRate Frames per second.
+*	@param flElapsedTime Time since the animation started, in seconds.
+*	@return Frame value. Range [0, numframes).
+*/
+float GetAnimatedFrame( const msprite_t* pSprite, const float flStartFrame, const float flFrameRate, const double flElapsedTime );
+
 /** @} */
 }
 
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "shared/Profiler.h"
+#include "shared/TaskScheduler.h"
+
+#include "CStudioModel.h"
+
+#include "CBakedPoseTrack.h"
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Frames are set up in chunks so that each chunk only needs one pose context.
+*	A few chunks per thread keeps threads busy when some frames take longer than others.
+*/
+const size_t CHUNKS_PER_THREAD = 4;
+}
+
+std::shared_ptr<const CBakedPoseTrack> CBakedPoseTrack::Bake( const std::shared_ptr<const CStudioModel>& model, const CModelRenderInfo& renderInfo,
+															  const std::atomic<bool>* pbCancel )
+{
+	PROFILE_SCOPE( "BakePoseTrack" );
+
+	assert( model );
+	assert( renderInfo.pModel == model.get() );
+
+	const studiohdr_t* const pStudioHdr = model->GetStudioHeader();
+
+	if( renderInfo.iSequence < 0 || renderInfo.iSequence >= pStudioHdr->numseq || pStudioHdr->numbones <= 0 )
+		return nullptr;
+
+	const int iNumFrames = pStudioHdr->GetSequence( renderInfo.iSequence )->numframes;
+
+	if( iNumFrames <= 0 )
+		return nullptr;
+
+	const size_t uiNumTransforms = static_cast<size_t>( iNumFrames ) * pStudioHdr->numbones;
+
+	if( uiNumTransforms * sizeof( glm::mat3x4 ) > MAX_MEMORY )
+		return nullptr;
+
+	std::shared_ptr<CBakedPoseTrack> track( new CBakedPoseTrack() );
+
+	track->m_Model = model;
+	track->m_Key = MakeKey( renderInfo );
+	track->m_iNumBones = pStudioHdr->numbones;
+	track->m_iNumFrames = iNumFrames;
+	track->m_BoneTransforms.resize( uiNumTransforms );
+
+	const size_t uiNumChunks = std::min( static_cast<size_t>( iNumFrames ), ( tasks::GetNumThreads() + 1 ) * CHUNKS_PER_THREAD );
+
+	tasks::ParallelFor( uiNumChunks, [ & ]( const size_t uiChunk )
+	{
+		//Too big for the stack.
+		auto context = std::make_unique<CStudioPoseContext>();
+
+		CModelRenderInfo frameInfo = renderInfo;
+
+		const int iFirst = static_cast<int>( uiChunk * iNumFrames / uiNumChunks );
+		const int iEnd = static_cast<int>( ( uiChunk + 1 ) * iNumFrames / uiNumChunks );
+
+		for( int iFrame = iFirst; iFrame < iEnd; ++iFrame )
+		{
+			if( pbCancel && *pbCancel )
+				return;
+
+			frameInfo.flFrame = static_cast<float>( iFrame );
+
+			context->SetUpBones( frameInfo );
+
+			memcpy( &track->m_BoneTransforms[ static_cast<size_t>( iFrame ) * track->m_iNumBones ], context->GetBoneTransforms(),
+					sizeof( glm::mat3x4 ) * track->m_iNumBones );
+		}
+	}, 1, "BakePoseTrack" );
+
+	if( pbCancel && *pbCancel )
+		return nullptr;
+
+	return track;
+}
+
+CStudioPoseContext::PoseKey_t CBakedPoseTrack::MakeKey( const CModelRenderInfo& renderInfo )
+{
+	auto key = CStudioPoseContext::MakeKey( renderInfo );
+
+	key.flFrame = 0;
+
+	return key;
+}
+
+bool CBakedPoseTrack::Matches( const CModelRenderInfo& renderInfo ) const
+{
+	if( m_Model.get() != renderInfo.pModel )
+		return false;
+
+	return m_Key == MakeKey( renderInfo );
+}
+
+const glm::mat3x4* CBakedPoseTrack::GetBoneTransforms( const float flFrame ) const
+{
+	if( flFrame < 0 || flFrame >= m_iNumFrames || std::floor( flFrame ) != flFrame )
+		return nullptr;
+
+	return &m_BoneTransforms[ static_cast<size_t>( flFrame ) * m_iNumBones ];
+}
+
+size_t CBakedPoseTrack::GetMemorySize() const
+{
+	return sizeof( *this ) + m_BoneTransforms.capacity() * sizeof( glm::mat3x4 );
+}
+
+CPoseTrackBaker::~CPoseTrackBaker()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bQuit = true;
+		m_bCancel = true;
+	}
+
+	m_RequestReady.notify_one();
+
+	if( m_Thread.joinable() )
+		m_Thread.join();
+}
+
+void CPoseTrackBaker::Request( const std::shared_ptr<const CStudioModel>& model, const CModelRenderInfo& renderInfo )
+{
+	assert( model );
+	assert( renderInfo.pModel == model.get() );
+
+	const auto key = CBakedPoseTrack::MakeKey( renderInfo );
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( m_RequestModel == model && m_RequestKey == key )
+			return;
+
+		m_RequestModel = model;
+		m_RequestInfo = renderInfo;
+		m_RequestInfo.ppSubModels = nullptr;
+		m_RequestKey = key;
+		m_bHasRequest = true;
+
+		//Whatever is being baked now is out of date.
+		m_bCancel = true;
+
+		if( !m_Thread.joinable() )
+		{
+			m_Thread = std::thread( &CPoseTrackBaker::ThreadMain, this );
+		}
+	}
+
+	m_RequestReady.notify_one();
+}
+
+CPoseTrackBaker::TrackPtr_t CPoseTrackBaker::GetTrack() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_Track;
+}
+
+void CPoseTrackBaker::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_bHasRequest = false;
+	m_bCancel = true;
+
+	m_RequestModel.reset();
+	m_RequestKey = CStudioPoseContext::PoseKey_t();
+	m_Track.reset();
+}
+
+void CPoseTrackBaker::ThreadMain()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_RequestReady.wait( lock, [ this ] { return m_bQuit || m_bHasRequest; } );
+
+		if( m_bQuit )
+			break;
+
+		m_bHasRequest = false;
+		m_bCancel = false;
+
+		//Copies, so the request can be replaced while this one is baked.
+		const std::shared_ptr<const CStudioModel> model = m_RequestModel;
+		const CModelRenderInfo renderInfo = m_RequestInfo;
+
+		lock.unlock();
+
+		auto track = CBakedPoseTrack::Bake( model, renderInfo, &m_bCancel );
+
+		lock.lock();
+
+		//Don't publish tracks for requests that were replaced or cleared in the meantime.
+		if( !m_bCancel )
+			m_Track = std::move( track );
+	}
+}
+}
@@ -0,0 +1,152 @@
+#ifndef GAME_STUDIOMODEL_CBAKEDPOSETRACK_H
+#define GAME_STUDIOMODEL_CBAKEDPOSETRACK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/mat3x4.hpp>
+
+#include "shared/renderer/studiomodel/CModelRenderInfo.h"
+
+#include "CStudioPoseContext.h"
+
+namespace studiomdl
+{
+class CStudioModel;
+
+/**
+*	The bone transforms of every whole frame of a sequence, for a fixed set of blenders, controllers and mouth.
+*	Looking up a frame replaces setting up its bones, so frames can be stepped through and scrubbed without decoding any animation data.
+*	Tracks are immutable once baked, so they can be shared between threads.
+*/
+class CBakedPoseTrack final
+{
+public:
+	/**
+	*	Maximum amount of memory a single track may use, in bytes.
+	*/
+	static const size_t MAX_MEMORY = 64 * 1024 * 1024;
+
+	/**
+	*	Bakes the sequence of the given render info. Frames are set up in parallel on the task scheduler.
+	*	@param model Model to bake. The track keeps it alive, so its key can't match another model that is later loaded at the same address.
+	*	@param renderInfo Inputs to bake. The frame is ignored.
+	*	@param pbCancel If not null, baking stops once this is set.
+	*	@return The track, or null if the sequence has no frames, the track would exceed MAX_MEMORY, or baking was cancelled.
+	*/
+	static std::shared_ptr<const CBakedPoseTrack> Bake( const std::shared_ptr<const CStudioModel>& model, const CModelRenderInfo& renderInfo,
+														const std::atomic<bool>* pbCancel = nullptr );
+
+	/**
+	*	@return The key that all frames of the render info's sequence share. The frame is always 0.
+	*/
+	static CStudioPoseContext::PoseKey_t MakeKey( const CModelRenderInfo& renderInfo );
+
+public:
+	~CBakedPoseTrack() = default;
+
+	int GetNumFrames() const { return m_iNumFrames; }
+
+	/**
+	*	@return Whether this track was baked with the same inputs as the given render info, ignoring the frame,
+	*	and the model's pose data hasn't changed since.
+	*/
+	bool Matches( const CModelRenderInfo& renderInfo ) const;
+
+	/**
+	*	@return The bone transforms of the given frame, or null if the frame is not a whole frame in the track.
+	*/
+	const glm::mat3x4* GetBoneTransforms( const float flFrame ) const;
+
+	/**
+	*	@return The amount of memory used by this track, in bytes.
+	*/
+	size_t GetMemorySize() const;
+
+private:
+	CBakedPoseTrack() = default;
+
+private:
+	std::shared_ptr<const CStudioModel> m_Model;
+
+	CStudioPoseContext::PoseKey_t m_Key;
+
+	int m_iNumBones = 0;
+	int m_iNumFrames = 0;
+
+	/**
+	*	m_iNumBones transforms for each frame.
+	*/
+	std::vector<glm::mat3x4> m_BoneTransforms;
+
+private:
+	CBakedPoseTrack( const CBakedPoseTrack& ) = delete;
+	CBakedPoseTrack& operator=( const CBakedPoseTrack& ) = delete;
+};
+
+/**
+*	Bakes pose tracks on a background thread. Only the most recent request is baked; requests replace older ones and cancel them if they're being baked.
+*/
+class CPoseTrackBaker final
+{
+public:
+	typedef std::shared_ptr<const CBakedPoseTrack> TrackPtr_t;
+
+public:
+	CPoseTrackBaker() = default;
+	~CPoseTrackBaker();
+
+	/**
+	*	Requests a track for the sequence of the given render info. Does nothing if the same track was the last one requested.
+	*	@param model Model to bake. Kept alive until the request is replaced or cleared.
+	*	@param renderInfo Inputs to bake. Must use the given model.
+	*/
+	void Request( const std::shared_ptr<const CStudioModel>& model, const CModelRenderInfo& renderInfo );
+
+	/**
+	*	@return The last track that finished baking, or null if there is none.
+	*/
+	TrackPtr_t GetTrack() const;
+
+	/**
+	*	Cancels any bake in progress and drops the last track.
+	*/
+	void Clear();
+
+private:
+	void ThreadMain();
+
+private:
+	std::thread m_Thread;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_RequestReady;
+
+	//Guarded by m_Mutex.
+	bool m_bQuit = false;
+	bool m_bHasRequest = false;
+
+	std::shared_ptr<const CStudioModel> m_RequestModel;
+	CModelRenderInfo m_RequestInfo;
+
+	/**
+	*	Key of the last request. Kept after it's done, so tracks that couldn't be baked aren't requested over and over.
+	*/
+	CStudioPoseContext::PoseKey_t m_RequestKey;
+
+	TrackPtr_t m_Track;
+
+	std::atomic<bool> m_bCancel{ false };
+
+private:
+	CPoseTrackBaker( const CPoseTrackBaker& ) = delete;
+	CPoseTrackBaker& operator=( const CPoseTrackBaker& ) = delete;
+};
+}
+
+#endif //GAME_STUDIOMODEL_CBAKEDPOSETRACK_H
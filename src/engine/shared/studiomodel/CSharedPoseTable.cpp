@@ -0,0 +1,113 @@
+#include <cassert>
+
+#include "shared/renderer/studiomodel/CModelRenderInfo.h"
+
+#include "CSharedPoseTable.h"
+
+namespace studiomdl
+{
+void CSharedPoseTable::BeginFrame()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_LastFrame = m_Frame;
+	m_Frame = Stats_t();
+
+	for( auto it = m_Entries.begin(); it != m_Entries.end(); )
+	{
+		//Only the table holds on to it, so nobody can be using it.
+		if( it->second->pose.use_count() == 1 )
+		{
+			if( m_FreePoses.size() < MAX_FREE_POSES )
+				m_FreePoses.emplace_back( std::move( it->second->pose ) );
+
+			it = m_Entries.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+CSharedPoseTable::PosePtr_t CSharedPoseTable::GetPose( const CModelRenderInfo& renderInfo )
+{
+	assert( renderInfo.pModel );
+
+	const auto key = CStudioPoseContext::MakeKey( renderInfo );
+
+	std::shared_ptr<Entry_t> entry;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		++m_Frame.uiRequests;
+		++m_Total.uiRequests;
+
+		auto& slot = m_Entries[ key ];
+
+		if( slot )
+		{
+			++m_Frame.uiHits;
+			++m_Total.uiHits;
+		}
+		else
+		{
+			slot = std::make_shared<Entry_t>();
+
+			if( !m_FreePoses.empty() )
+			{
+				slot->pose = std::move( m_FreePoses.back() );
+				m_FreePoses.pop_back();
+			}
+			else
+			{
+				slot->pose = std::make_shared<CStudioPoseContext>();
+			}
+		}
+
+		entry = slot;
+	}
+
+	//Set up outside the lock so different poses can be set up at the same time.
+	std::call_once( entry->setUp,
+		[ & ]()
+		{
+			entry->pose->SetUpBones( renderInfo );
+		}
+	);
+
+	return entry->pose;
+}
+
+CSharedPoseTable::Stats_t CSharedPoseTable::GetLastFrameStats() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_LastFrame;
+}
+
+CSharedPoseTable::Stats_t CSharedPoseTable::GetTotalStats() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_Total;
+}
+
+void CSharedPoseTable::ResetStats()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Frame = Stats_t();
+	m_LastFrame = Stats_t();
+	m_Total = Stats_t();
+}
+
+void CSharedPoseTable::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Entries.clear();
+	m_FreePoses.clear();
+}
+}
@@ -0,0 +1,109 @@
+#ifndef GAME_STUDIOMODEL_CSHAREDPOSETABLE_H
+#define GAME_STUDIOMODEL_CSHAREDPOSETABLE_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CStudioPoseContext.h"
+
+namespace studiomdl
+{
+struct CModelRenderInfo;
+
+/**
+*	Deduplicates pose setup for models that are posed with the same inputs, like a crowd playing the same sequence in step.
+*	Each distinct pose is set up once and shared by everyone that requests it.
+*	Thread safe; requests for a pose that is still being set up wait for it to finish.
+*/
+class CSharedPoseTable final
+{
+public:
+	typedef std::shared_ptr<CStudioPoseContext> PosePtr_t;
+
+	/**
+	*	Request statistics for a number of frames.
+	*/
+	struct Stats_t
+	{
+		size_t uiRequests = 0;
+
+		/**
+		*	Requests for a pose that had already been requested.
+		*/
+		size_t uiHits = 0;
+	};
+
+public:
+	CSharedPoseTable() = default;
+	~CSharedPoseTable() = default;
+
+	/**
+	*	Starts a new frame. Poses that nobody uses anymore are recycled; poses that are still in use can still be shared.
+	*	Must not be called while poses are being requested.
+	*/
+	void BeginFrame();
+
+	/**
+	*	Gets the pose for the given render info, setting up its bones if no pose with the same inputs has been requested yet.
+	*	The pose must not be set up again by its users.
+	*	@param renderInfo Render info to pose. Must have a model.
+	*/
+	PosePtr_t GetPose( const CModelRenderInfo& renderInfo );
+
+	/**
+	*	@return Statistics for the last completed frame.
+	*/
+	Stats_t GetLastFrameStats() const;
+
+	/**
+	*	@return Statistics for all frames since the table was created or the statistics were reset.
+	*/
+	Stats_t GetTotalStats() const;
+
+	void ResetStats();
+
+	/**
+	*	Drops all poses. Poses that are still in use stay alive until their last user releases them.
+	*/
+	void Clear();
+
+private:
+	struct Entry_t
+	{
+		PosePtr_t pose;
+		std::once_flag setUp;
+	};
+
+	struct KeyHash_t
+	{
+		size_t operator()( const CStudioPoseContext::PoseKey_t& key ) const { return key.Hash(); }
+	};
+
+	typedef std::unordered_map<CStudioPoseContext::PoseKey_t, std::shared_ptr<Entry_t>, KeyHash_t> Entries_t;
+
+	/**
+	*	Maximum number of unused poses to keep for reuse.
+	*/
+	static const size_t MAX_FREE_POSES = 64;
+
+private:
+	mutable std::mutex m_Mutex;
+
+	Entries_t m_Entries;
+
+	std::vector<PosePtr_t> m_FreePoses;
+
+	Stats_t m_Frame;
+	Stats_t m_LastFrame;
+	Stats_t m_Total;
+
+private:
+	CSharedPoseTable( const CSharedPoseTable& ) = delete;
+	CSharedPoseTable& operator=( const CSharedPoseTable& ) = delete;
+};
+}
+
+#endif //GAME_STUDIOMODEL_CSHAREDPOSETABLE_H
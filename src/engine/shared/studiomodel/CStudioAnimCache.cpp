@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "CStudioAnimCache.h"
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Decodes a single channel. Produces exactly the values CStudioModelRenderer's run length walk would read for every frame.
+*	@return false if the data is malformed, in which case the channel should be read directly.
+*/
+bool DecodeChannel( const mstudioanimvalue_t* panimvalue, const int iNumFrames, short* pValues, byte* pInterpolation )
+{
+	int k = 0;
+
+	for( int iFrame = 0; iFrame < iNumFrames; ++iFrame, ++k )
+	{
+		// find span of values that includes the frame we want
+		while( panimvalue->num.total <= k )
+		{
+			//Would loop forever.
+			if( panimvalue->num.total == 0 )
+				return false;
+
+			k -= panimvalue->num.total;
+			panimvalue += panimvalue->num.valid + 1;
+		}
+
+		if( panimvalue->num.valid > k )
+		{
+			pValues[ iFrame ] = panimvalue[ k + 1 ].value;
+		}
+		else
+		{
+			pValues[ iFrame ] = panimvalue[ panimvalue->num.valid ].value;
+		}
+
+		if( pInterpolation )
+		{
+			pInterpolation[ iFrame ] = ( panimvalue->num.valid > k + 1 ) || ( panimvalue->num.valid <= k && panimvalue->num.total <= k + 1 );
+		}
+
+		//The value after the last frame is whatever the last frame blends towards.
+		if( iFrame + 1 == iNumFrames )
+		{
+			if( panimvalue->num.valid > k + 1 )
+			{
+				pValues[ iNumFrames ] = panimvalue[ k + 2 ].value;
+			}
+			else if( panimvalue->num.total > k + 1 )
+			{
+				pValues[ iNumFrames ] = pValues[ iFrame ];
+			}
+			else
+			{
+				pValues[ iNumFrames ] = panimvalue[ panimvalue->num.valid + 2 ].value;
+			}
+		}
+	}
+
+	return true;
+}
+}
+
+CDecodedAnim::CDecodedAnim( const mstudioanim_t* panim, const int iNumBones, const int iNumFrames, const bool bQuantize )
+	: m_iNumFrames( iNumFrames )
+	, m_bQuantized( bQuantize )
+	, m_Channels( iNumBones * NUM_CHANNELS )
+	, m_InterpolationOffsets( iNumBones * NUM_POSITION_CHANNELS, 0 )
+{
+	assert( panim );
+	assert( iNumFrames > 0 );
+
+	std::vector<short> values( iNumFrames + 1 );
+	std::vector<byte> interpolation( iNumFrames );
+
+	int iInterpolationBits = 0;
+
+	for( int iBone = 0; iBone < iNumBones; ++iBone, ++panim )
+	{
+		for( int iChannel = 0; iChannel < NUM_CHANNELS; ++iChannel )
+		{
+			if( panim->offset[ iChannel ] == 0 )
+				continue;
+
+			const bool bIsPosition = iChannel < NUM_POSITION_CHANNELS;
+
+			auto panimvalue = ( const mstudioanimvalue_t* ) ( ( const byte* ) panim + panim->offset[ iChannel ] );
+
+			if( !DecodeChannel( panimvalue, iNumFrames, values.data(), bIsPosition ? interpolation.data() : nullptr ) )
+				continue;
+
+			StoreChannel( m_Channels[ iBone * NUM_CHANNELS + iChannel ], values );
+
+			if( bIsPosition )
+			{
+				m_InterpolationOffsets[ iBone * NUM_POSITION_CHANNELS + iChannel ] = iInterpolationBits;
+
+				m_Interpolation.resize( ( iInterpolationBits + iNumFrames + 7 ) / 8 );
+
+				for( int iFrame = 0; iFrame < iNumFrames; ++iFrame, ++iInterpolationBits )
+				{
+					if( interpolation[ iFrame ] )
+						m_Interpolation[ iInterpolationBits >> 3 ] |= 1 << ( iInterpolationBits & 7 );
+				}
+			}
+		}
+	}
+
+	m_Values.shrink_to_fit();
+	m_Bytes.shrink_to_fit();
+	m_Interpolation.shrink_to_fit();
+}
+
+void CDecodedAnim::StoreChannel( Channel_t& channel, const std::vector<short>& values )
+{
+	if( m_bQuantized )
+	{
+		const auto minMax = std::minmax_element( values.begin(), values.end() );
+
+		const int iRange = *minMax.second - *minMax.first;
+
+		channel.iBase = *minMax.first;
+
+		if( iRange == 0 )
+		{
+			channel.encoding = Encoding::CONSTANT;
+			return;
+		}
+
+		if( iRange <= std::numeric_limits<byte>::max() )
+		{
+			channel.encoding = Encoding::BYTE_OFFSETS;
+			channel.iOffset = static_cast<int>( m_Bytes.size() );
+
+			for( const auto value : values )
+			{
+				m_Bytes.push_back( static_cast<byte>( value - channel.iBase ) );
+			}
+
+			return;
+		}
+	}
+
+	channel.encoding = Encoding::SHORT_VALUES;
+	channel.iOffset = static_cast<int>( m_Values.size() );
+
+	m_Values.insert( m_Values.end(), values.begin(), values.end() );
+}
+
+size_t CDecodedAnim::GetMemorySize() const
+{
+	return sizeof( *this ) +
+		m_Channels.size() * sizeof( Channel_t ) +
+		m_InterpolationOffsets.size() * sizeof( int ) +
+		m_Values.size() * sizeof( short ) +
+		m_Bytes.size() * sizeof( byte ) +
+		m_Interpolation.size() * sizeof( byte );
+}
+
+size_t CStudioAnimCache::GetMemoryUsed() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_uiMemoryUsed;
+}
+
+std::shared_ptr<const CDecodedAnim> CStudioAnimCache::GetDecodedAnim( const mstudioanim_t* panim, const int iNumBones, const int iNumFrames, const size_t uiBudget, 
+																	 const bool bQuantize )
+{
+	assert( panim );
+
+	if( uiBudget == 0 || iNumFrames <= 0 )
+		return nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( m_bQuantize != bQuantize )
+		{
+			m_Entries.clear();
+			m_Usage.clear();
+			m_uiMemoryUsed = 0;
+			m_bQuantize = bQuantize;
+		}
+
+		auto it = m_Entries.find( panim );
+
+		if( it != m_Entries.end() )
+		{
+			//Move to the front of the usage list.
+			m_Usage.splice( m_Usage.begin(), m_Usage, it->second.usage );
+
+			return it->second.anim;
+		}
+	}
+
+	//Decode outside the lock so other threads can keep using the cache.
+	auto anim = std::make_shared<const CDecodedAnim>( panim, iNumBones, iNumFrames, bQuantize );
+
+	const size_t uiSize = anim->GetMemorySize();
+
+	if( uiSize > uiBudget )
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	//The setting may have changed while decoding.
+	if( anim->IsQuantized() != m_bQuantize )
+		return anim;
+
+	//Another thread may have decoded it in the meantime.
+	auto it = m_Entries.find( panim );
+
+	if( it != m_Entries.end() )
+	{
+		m_Usage.splice( m_Usage.begin(), m_Usage, it->second.usage );
+
+		return it->second.anim;
+	}
+
+	EvictToFit( uiBudget - uiSize );
+
+	m_Usage.push_front( panim );
+
+	CacheEntry_t entry;
+
+	entry.anim = anim;
+	entry.usage = m_Usage.begin();
+
+	m_Entries.emplace( panim, std::move( entry ) );
+
+	m_uiMemoryUsed += uiSize;
+
+	return anim;
+}
+
+void CStudioAnimCache::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Entries.clear();
+	m_Usage.clear();
+	m_uiMemoryUsed = 0;
+}
+
+void CStudioAnimCache::EvictToFit( const size_t uiBudget )
+{
+	//Caller must hold the lock.
+	while( m_uiMemoryUsed > uiBudget && !m_Usage.empty() )
+	{
+		auto it = m_Entries.find( m_Usage.back() );
+
+		assert( it != m_Entries.end() );
+
+		m_uiMemoryUsed -= it->second.anim->GetMemorySize();
+
+		m_Entries.erase( it );
+		m_Usage.pop_back();
+	}
+}
+}
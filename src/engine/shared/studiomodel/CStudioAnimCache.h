@@ -0,0 +1,211 @@
+#ifndef GAME_STUDIOMODEL_CSTUDIOANIMCACHE_H
+#define GAME_STUDIOMODEL_CSTUDIOANIMCACHE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "shared/Const.h"
+
+#include "studio.h"
+
+namespace studiomdl
+{
+/**
+*	Decoded animation values for a single sequence blend (one mstudioanim_t per bone).
+*	Run length encoded values are expanded so any frame can be looked up directly.
+*	Quantized animations store each channel with the smallest encoding that keeps every value: channels that never change store a single value,
+*	and channels whose values are all within 255 of each other store 8 bit offsets from their lowest value.
+*	Either way each channel is a fixed size block, so seeking to a frame never has to walk the data.
+*/
+class CDecodedAnim final
+{
+public:
+	/**
+	*	Number of channels per bone: 3 position, 3 rotation.
+	*/
+	static const int NUM_CHANNELS = 6;
+
+	/**
+	*	Number of position channels per bone. These come first.
+	*/
+	static const int NUM_POSITION_CHANNELS = 3;
+
+public:
+	/**
+	*	Decodes the animation.
+	*	@param panim Animation data for the first bone.
+	*	@param iNumBones Number of bones.
+	*	@param iNumFrames Number of frames in the sequence.
+	*	@param bQuantize Whether to store channels in the smallest encoding that fits them.
+	*/
+	CDecodedAnim( const mstudioanim_t* panim, const int iNumBones, const int iNumFrames, const bool bQuantize = false );
+	~CDecodedAnim() = default;
+
+	int GetNumFrames() const { return m_iNumFrames; }
+
+	bool IsQuantized() const { return m_bQuantized; }
+
+	/**
+	*	@return Whether the channel has decoded values. Channels without animation data or that could not be decoded have none.
+	*/
+	bool HasValues( const int iBone, const int iChannel ) const
+	{
+		return m_Channels[ iBone * NUM_CHANNELS + iChannel ].encoding != Encoding::NONE;
+	}
+
+	/**
+	*	Gets a decoded value. Frames go up to GetNumFrames(); the value at frame + 1 is the value to blend towards.
+	*	Only valid if HasValues returns true for the same channel.
+	*/
+	int GetValue( const int iBone, const int iChannel, const int iFrame ) const
+	{
+		const Channel_t& channel = m_Channels[ iBone * NUM_CHANNELS + iChannel ];
+
+		switch( channel.encoding )
+		{
+		case Encoding::BYTE_OFFSETS:	return channel.iBase + m_Bytes[ channel.iOffset + iFrame ];
+		case Encoding::SHORT_VALUES:	return m_Values[ channel.iOffset + iFrame ];
+		default:				return channel.iBase;
+		}
+	}
+
+	/**
+	*	Gets whether a position channel interpolates towards the next value at the given frame.
+	*	Only valid if HasValues returns true for the same channel.
+	*/
+	bool Interpolates( const int iBone, const int iChannel, const int iFrame ) const
+	{
+		const int iBit = m_InterpolationOffsets[ iBone * NUM_POSITION_CHANNELS + iChannel ] + iFrame;
+
+		return ( m_Interpolation[ iBit >> 3 ] & ( 1 << ( iBit & 7 ) ) ) != 0;
+	}
+
+	/**
+	*	@return The amount of memory used by this animation, in bytes.
+	*/
+	size_t GetMemorySize() const;
+
+private:
+	enum class Encoding : byte
+	{
+		NONE = 0,
+
+		/**
+		*	Every frame has the base value.
+		*/
+		CONSTANT,
+
+		/**
+		*	Offsets from the base value.
+		*/
+		BYTE_OFFSETS,
+		SHORT_VALUES
+	};
+
+	struct Channel_t
+	{
+		int iOffset = 0;
+		short iBase = 0;
+		Encoding encoding = Encoding::NONE;
+	};
+
+	/**
+	*	Stores the decoded values of a channel.
+	*/
+	void StoreChannel( Channel_t& channel, const std::vector<short>& values );
+
+private:
+	int m_iNumFrames;
+
+	bool m_bQuantized;
+
+	std::vector<Channel_t> m_Channels;
+
+	/**
+	*	Bit offsets.
+	*/
+	std::vector<int> m_InterpolationOffsets;
+
+	std::vector<short> m_Values;
+	std::vector<byte> m_Bytes;
+
+	/**
+	*	One bit per frame.
+	*/
+	std::vector<byte> m_Interpolation;
+
+private:
+	CDecodedAnim( const CDecodedAnim& ) = delete;
+	CDecodedAnim& operator=( const CDecodedAnim& ) = delete;
+};
+
+/**
+*	Caches decoded animations for a single model. Least recently used animations are evicted once the memory budget is exceeded.
+*	Thread safe; evicted animations stay alive until the last user releases them.
+*/
+class CStudioAnimCache final
+{
+private:
+	typedef std::list<const mstudioanim_t*> UsageList_t;
+
+	struct CacheEntry_t
+	{
+		std::shared_ptr<const CDecodedAnim> anim;
+		UsageList_t::iterator usage;
+	};
+
+	typedef std::unordered_map<const mstudioanim_t*, CacheEntry_t> Entries_t;
+
+public:
+	CStudioAnimCache() = default;
+	~CStudioAnimCache() = default;
+
+	/**
+	*	@return The amount of memory currently used by the cache, in bytes.
+	*/
+	size_t GetMemoryUsed() const;
+
+	/**
+	*	Gets the decoded animation for the given animation, decoding it if needed.
+	*	@param panim Animation data for the first bone.
+	*	@param iNumBones Number of bones.
+	*	@param iNumFrames Number of frames in the sequence.
+	*	@param uiBudget Maximum amount of memory to use, in bytes.
+	*	@param bQuantize Whether animations are quantized. Animations cached with the other setting are removed.
+	*	@return Decoded animation, or null if it does not fit in the budget.
+	*/
+	std::shared_ptr<const CDecodedAnim> GetDecodedAnim( const mstudioanim_t* panim, const int iNumBones, const int iNumFrames, const size_t uiBudget, 
+														const bool bQuantize = false );
+
+	/**
+	*	Removes all cached animations.
+	*/
+	void Clear();
+
+private:
+	void EvictToFit( const size_t uiBudget );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	Entries_t m_Entries;
+
+	/**
+	*	Most recently used first.
+	*/
+	UsageList_t m_Usage;
+
+	size_t m_uiMemoryUsed = 0;
+
+	bool m_bQuantize = false;
+
+private:
+	CStudioAnimCache( const CStudioAnimCache& ) = delete;
+	CStudioAnimCache& operator=( const CStudioAnimCache& ) = delete;
+};
+}
+
+#endif //GAME_STUDIOMODEL_CSTUDIOANIMCACHE_H
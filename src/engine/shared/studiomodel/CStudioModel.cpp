@@ -1,26 +1,62 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <filesystem>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <unordered_set>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
 
 #include "shared/Platform.h"
 #include "shared/Logging.h"
+#include "shared/Perf.h"
+#include "shared/TaskScheduler.h"
+#include "shared/Trace.h"
 
+#include "utility/PlatUtils.h"
 #include "utility/StringUtils.h"
 
 #include "cvar/CCVar.h"
 
+#include "engine/shared/EngineFileSystem.h"
+#include "engine/shared/EngineRenderContext.h"
+
+#include "graphics/CGLUploadQueue.h"
 #include "graphics/GraphicsUtils.h"
+#include "graphics/ImageResample.h"
+#include "graphics/MeshOptimization.h"
 #include "graphics/Palette.h"
+#include "graphics/PaletteConversion.h"
+#include "graphics/TextureUpload.h"
 
 #include "CStudioModel.h"
+#include "CStudioModelManager.h"
+#include "CStudioTextureTable.h"
+#include "StudioKernels.h"
+#include "StudioModelDiskCache.h"
+#include "StudioModelValidation.h"
 
 namespace studiomdl
 {
 namespace
 {
+/**
+*	Applies texture setting changes to loaded models, so they don't have to be reloaded.
+*/
+void TextureSettingsChanged( cvar::CCVar& cvar, const char* pszOldValue, float flOldValue );
+
 //Note: multiple libraries can include this file and define this cvar. The first library to register theirs wins.
 //All others will point to that one. - Solokiller
-static cvar::CCVar r_filtertextures( "r_filtertextures", cvar::CCVarArgsBuilder().FloatValue( 1 ).HelpInfo( "Whether to filter textures or not" ) );
+static cvar::CCVar r_filtertextures( "r_filtertextures",
+	cvar::CCVarArgsBuilder()
+	.FloatValue( 1 )
+	.Callback( &TextureSettingsChanged )
+	.HelpInfo( "Whether to filter textures or not" ) );
 
 static cvar::CCVar r_powerof2textures( "r_powerof2textures",
 	cvar::CCVarArgsBuilder()
@@ -28,15 +64,205 @@ static cvar::CCVar r_powerof2textures( "r_powerof2textures",
 	.FloatValue( 1 )
 	.MinValue( 0 )
 	.MaxValue( 1 )
+	.Callback( &TextureSettingsChanged )
 	.HelpInfo( "Whether to resize textures to power of 2 dimensions" ) );
 
+void TextureSettingsChanged( cvar::CCVar&, const char*, float )
+{
+	//Shared by both cvars, so both are read.
+	StudioModelManager().ApplyTextureSettings( r_filtertextures.GetBool(), r_powerof2textures.GetBool() );
+}
+
+static cvar::CCVar r_animcachebudget( "r_animcachebudget",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 16 )
+	.MinValue( 0 )
+	.HelpInfo( "Maximum amount of memory, in megabytes, that each model may use to cache decoded animations. 0 disables the cache" ) );
+
+static cvar::CCVar r_animcachequantize( "r_animcachequantize",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "If non-zero, cached animations store unchanging channels once and small ranges as 8 bit offsets. Poses are unaffected" ) );
+
+static cvar::CCVar mdl_deferredtextures( "mdl_deferredtextures",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to upload model textures the first time they're drawn instead of when a model is loaded" ) );
+
+static cvar::CCVar mdl_prefetchseqgroups( "mdl_prefetchseqgroups",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to load sequence groups in the background after a model has been opened. Otherwise they are loaded when first used" ) );
+
+static cvar::CCVar mdl_mapfiles( "mdl_mapfiles",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to map model files into memory instead of reading them. Only the parts of a model that are used are loaded, and changes are never written back to the file" ) );
+
+static cvar::CCVar mdl_validate( "mdl_validate",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to validate models when they're loaded. Invalid models are not loaded. Models that aren't validated are accessed through slower, checked accessors" ) );
+
+static cvar::CCVar mdl_optimizemeshes( "mdl_optimizemeshes",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to reorder mesh triangles and vertices for the vertex cache when models are loaded" ) );
+
+static cvar::CCVar mdl_meshlods( "mdl_meshlods",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to build simplified detail levels of meshes when models are loaded, for drawing models that are small on screen" ) );
+
+static cvar::CCVar mdl_compactvertices( "mdl_compactvertices",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to store the vertices used for GPU skinning and instancing with 16 bit positions and normals, which halves their memory and bandwidth. Takes effect when models are loaded" ) );
+
+static cvar::CCVar mdl_sharetextures( "mdl_sharetextures",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether models that contain identical textures share a single copy of them. Only affects textures uploaded afterwards" ) );
+
+static cvar::CCVar mdl_compacttextures( "mdl_compacttextures",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to release the CPU copies of model texture pixels once textures are uploaded, to save memory when browsing many models. Pixels are read from the model file again when they're needed" ) );
+
+static_assert( sizeof( GLuint ) == sizeof( uint32_t ), "Mesh indices are optimized as 32 bit integers" );
+
+/**
+*	Size of the simplification grid's cells for each simplified detail level, as a fraction of the model's size.
+*/
+const float LOD_CELL_SIZES[ STUDIO_LOD_COUNT - 1 ] = { 1 / 48.0f, 1 / 20.0f };
+
+/**
+*	A detail level must have at most this fraction of the triangles of the level before it, otherwise that level is used instead.
+*/
+const float LOD_MAX_TRIANGLE_FRACTION = 0.85f;
+
+/**
+*	Largest magnitude of a 16 bit normalized integer. -32768 isn't used so that 0 is exactly representable.
+*/
+const float SNORM16_MAX = 32767.0f;
+
+int16_t QuantizeSnorm16( const float flValue )
+{
+	return static_cast<int16_t>( std::round( glm::clamp( flValue, -1.0f, 1.0f ) * SNORM16_MAX ) );
+}
+
+/**
+*	Encodes a unit vector by projecting it onto an octahedron that is unfolded into a square.
+*	Precision is nearly uniform over the sphere, unlike storing 2 components and reconstructing the third.
+*/
+void EncodeOctahedral( const glm::vec3& vecNormal, int16_t* pOut )
+{
+	const float flLength = std::abs( vecNormal.x ) + std::abs( vecNormal.y ) + std::abs( vecNormal.z );
+
+	if( flLength <= 0 )
+	{
+		pOut[ 0 ] = pOut[ 1 ] = 0;
+		return;
+	}
+
+	glm::vec2 vecEncoded( vecNormal.x / flLength, vecNormal.y / flLength );
+
+	//The lower half is folded over the diagonals.
+	if( vecNormal.z < 0 )
+	{
+		vecEncoded = glm::vec2(
+			( 1.0f - std::abs( vecEncoded.y ) ) * ( vecEncoded.x >= 0 ? 1.0f : -1.0f ),
+			( 1.0f - std::abs( vecEncoded.x ) ) * ( vecEncoded.y >= 0 ? 1.0f : -1.0f ) );
+	}
+
+	pOut[ 0 ] = QuantizeSnorm16( vecEncoded.x );
+	pOut[ 1 ] = QuantizeSnorm16( vecEncoded.y );
+}
+
+/**
+*	Decodes a normal the same way the shaders do.
+*/
+glm::vec3 DecodeOctahedral( const int16_t* pEncoded )
+{
+	const glm::vec2 vecEncoded( pEncoded[ 0 ] / SNORM16_MAX, pEncoded[ 1 ] / SNORM16_MAX );
+
+	glm::vec3 vecNormal( vecEncoded, 1.0f - std::abs( vecEncoded.x ) - std::abs( vecEncoded.y ) );
+
+	if( vecNormal.z < 0 )
+	{
+		vecNormal.x = ( 1.0f - std::abs( vecEncoded.y ) ) * ( vecEncoded.x >= 0 ? 1.0f : -1.0f );
+		vecNormal.y = ( 1.0f - std::abs( vecEncoded.x ) ) * ( vecEncoded.y >= 0 ? 1.0f : -1.0f );
+	}
+
+	return glm::normalize( vecNormal );
+}
+
+/**
+*	Runs a batch of texture work on the task scheduler, one task per texture since textures differ a lot in size.
+*	Models can be loaded on several threads at once; their batches share the scheduler's threads.
+*/
+void RunTextureBatch( const size_t uiCount, const std::function<void( const size_t uiIndex )>& func )
+{
+	tasks::ParallelFor( uiCount, func, 1, "ConvertTextures" );
+}
+
+renderer::HTexture_t TextureToHandle( const GLuint texture )
+{
+	return renderer::NameToTexHandle( texture );
+}
+
+GLuint HandleToTexture( const renderer::HTexture_t hTexture )
+{
+	return renderer::TexHandleToName( hTexture );
+}
+
+CStudioTextureTable::Key_t MakeSharedTextureKey( const CStudioModel& model, const int iIndex, const uint64_t uiHash,
+												 const int iWidth, const int iHeight, const bool bFilterTextures )
+{
+	CStudioTextureTable::Key_t key;
+
+	key.uiHash = uiHash != 0 ? uiHash : HashStudioTexture( model, iIndex );
+	key.iWidth = iWidth;
+	key.iHeight = iHeight;
+	key.bFilter = bFilterTextures;
+
+	return key;
+}
+
 void UploadRGBATexture( const int iWidth, const int iHeight, const byte* pData, GLuint textureId, const bool bFilterTextures )
 {
-	glBindTexture( GL_TEXTURE_2D, textureId );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, iWidth, iHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pData );
-	glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, bFilterTextures ? GL_LINEAR : GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, bFilterTextures ? GL_LINEAR : GL_NEAREST );
+	graphics::UploadRGBATexture( textureId, iWidth, iHeight, pData, graphics::GetTextureUploadSettings( bFilterTextures ) );
 }
 
 //Dol differs only in texture storage
@@ -45,76 +271,44 @@ void ConvertDolToMdl( byte* pBuffer, const mstudiotexture_t& texture )
 {
 	const int RGBA_PALETTE_CHANNELS = 4;
 
-	auto palette = std::make_unique<byte[]>( PALETTE_SIZE );
+	//The palette is overwritten by the pixels, so it's kept on the stack until they've been moved.
+	byte palette[ PALETTE_SIZE ];
 
 	//Starts off with 32 byte texture name
 	auto pSourcePalette = pBuffer + texture.index + 32;
 
 	//Discard alpha value
 	//TODO: convert alpha value somehow? is it even used?
-	for( int i = 0; i < PALETTE_ENTRIES; ++i )
+	for( size_t i = 0; i < PALETTE_ENTRIES; ++i )
 	{
-		for( int j = 0; j < PALETTE_CHANNELS; ++j )
-		{
-			palette[ i * PALETTE_CHANNELS + j ] = pSourcePalette[ i * RGBA_PALETTE_CHANNELS + j ];
-		}
+		palette[ i * PALETTE_CHANNELS ] = pSourcePalette[ i * RGBA_PALETTE_CHANNELS ];
+		palette[ i * PALETTE_CHANNELS + 1 ] = pSourcePalette[ i * RGBA_PALETTE_CHANNELS + 1 ];
+		palette[ i * PALETTE_CHANNELS + 2 ] = pSourcePalette[ i * RGBA_PALETTE_CHANNELS + 2 ];
 	}
 
-	const auto size = texture.width * texture.height;
-
-	auto pixels = std::make_unique<byte[]>( size );
+	const auto size = static_cast<size_t>( texture.width ) * texture.height;
 
 	auto pSourcePixels = pSourcePalette + PALETTE_ENTRIES * RGBA_PALETTE_CHANNELS;
 
-	for( int i = 0; i < size; ++i )
-	{
-		auto pixel = pSourcePixels[ i ];
-
-		auto masked = pixel & 0x1F;
-
-		//Adjust the index to map to the correct palette entry
-		if( masked >= 8 )
-		{
-			if( masked >= 16 )
-			{
-				if( masked < 24 )
-				{
-					pixel -= 8;
-				}
-			}
-			else
-			{
-				pixel += 8;
-			}
-		}
-
-		pixels[ i ] = pixel;
-	}
-
-	//Now write the correct data to the model buffer
+	//Pixels move towards the start of the texture, so they can be remapped in place
 	auto pDestPixels = pBuffer + texture.index;
 
-	for( int i = 0; i < size; ++i )
-	{
-		pDestPixels[ i ] = pixels[ i ];
-	}
+	RemapDolPixels( AreSIMDKernelsSupported(), pSourcePixels, pDestPixels, size );
 
-	auto pDestPalette = pBuffer + texture.index + texture.width * texture.height;
+	auto pDestPalette = pDestPixels + size;
 
-	memcpy( pDestPalette, palette.get(), PALETTE_SIZE );
+	memcpy( pDestPalette, palette, PALETTE_SIZE );
 
 	//Some data will be left dangling after the palette and before the next texture/end of file. Nothing will reference it though
 	//in the SL version this will not be a problem since the file isn't loaded in one chunk
 }
 
-void UploadTexture( const mstudiotexture_t* ptexture, const byte* data, byte* pal, int name, const bool bFilterTextures, const bool bPowerOf2 )
+/**
+*	Converts a texture to RGBA, resizing it to power of 2 dimensions if requested. Does not use GL, so this can be called from any thread.
+*	@return Whether the texture was converted.
+*/
+bool ConvertTextureToRGBA( const mstudiotexture_t* ptexture, const byte* data, byte* pal, const bool bPowerOf2, StudioRGBATexture_t& texture )
 {
-	// unsigned *in, int inwidth, int inheight, unsigned *out,  int outwidth, int outheight;
-	int		i, j;
-	int		row1[ MAX_TEXTURE_DIMS ], row2[ MAX_TEXTURE_DIMS ], col1[ MAX_TEXTURE_DIMS ], col2[ MAX_TEXTURE_DIMS ];
-	const byte	*pix1, *pix2, *pix3, *pix4;
-	byte	*tex, *out;
-
 	// convert texture to power of 2
 	int outwidth;
 	int outheight;
@@ -122,7 +316,7 @@ void UploadTexture( const mstudiotexture_t* ptexture, const byte* data, byte* pa
 	if( bPowerOf2 )
 	{
 		if( !graphics::CalculateImageDimensions( ptexture->width, ptexture->height, outwidth, outheight ) )
-			return;
+			return false;
 	}
 	else
 	{
@@ -134,126 +328,119 @@ void UploadTexture( const mstudiotexture_t* ptexture, const byte* data, byte* pa
 
 	//Needs at least one pixel (satisfies code analysis)
 	if( uiSize < 4 )
-		return;
-
-	tex = out = ( byte * ) malloc( uiSize );
-	if( !out )
-	{
-		return;
-	}
-	/*
-	int k = 0;
-	for (i = 0; i < ptexture->height; i++)
-	{
-	for (j = 0; j < ptexture->width; j++)
-	{
+		return false;
 
-	in[k++] = pal[data[i * ptexture->width + j] * 3 + 0];
-	in[k++] = pal[data[i * ptexture->width + j] * 3 + 1];
-	in[k++] = pal[data[i * ptexture->width + j] * 3 + 2];
-	in[k++] = 0xff;;
-	}
-	}
+	texture.pixels = mem::AllocateArray<byte>( uiSize, mem::Tag::STUDIO_TEXTURE );
+	texture.iWidth = outwidth;
+	texture.iHeight = outheight;
 
-	gluScaleImage (GL_RGBA, ptexture->width, ptexture->height, GL_UNSIGNED_BYTE, in, outwidth, outheight, GL_UNSIGNED_BYTE, out);
-	free (in);
-	*/
+	const bool bMasked = ( ptexture->flags & STUDIO_NF_MASKED ) != 0;
 
-	for( i = 0; i < outwidth; i++ )
+	//This modifies the model's data. Sets the mask color to black. This is also done by Jed's model viewer. (export texture has black)
+	if( bMasked )
 	{
-		col1[ i ] = ( int ) ( ( i + 0.25 ) * ( ptexture->width / ( float ) outwidth ) );
-		col2[ i ] = ( int ) ( ( i + 0.75 ) * ( ptexture->width / ( float ) outwidth ) );
+		pal[ 255 * 3 + 0 ] = pal[ 255 * 3 + 1 ] = pal[ 255 * 3 + 2 ] = 0;
 	}
 
-	for( i = 0; i < outheight; i++ )
-	{
-		row1[ i ] = ( int ) ( ( i + 0.25 ) * ( ptexture->height / ( float ) outheight ) ) * ptexture->width;
-		row2[ i ] = ( int ) ( ( i + 0.75 ) * ( ptexture->height / ( float ) outheight ) ) * ptexture->width;
-	}
+	byte rgbaPalette[ PALETTE_ENTRIES * 4 ];
 
-	const byte* const pAlpha = &pal[ PALETTE_ALPHA_INDEX ];
+	graphics::ConvertPaletteToRGBA( pal, rgbaPalette );
 
-	//This modifies the model's data. Sets the mask color to black. This is also done by Jed's model viewer. (export texture has black)
-	if( ptexture->flags & STUDIO_NF_MASKED )
+	if( bMasked )
+		rgbaPalette[ 255 * 4 + 3 ] = 0x00;
+
+	//Textures that aren't resized can be expanded directly.
+	if( outwidth == ptexture->width && outheight == ptexture->height )
 	{
-		pal[ 255 * 3 + 0 ] = pal[ 255 * 3 + 1 ] = pal[ 255 * 3 + 2 ] = 0;
+		graphics::ExpandIndexedToRGBA( data, static_cast<size_t>( outwidth * outheight ), rgbaPalette, texture.pixels.get() );
+
+		return true;
 	}
 
-	// scale down and convert to 32bit RGB
-	for( i = 0; i<outheight; i++ )
-	{
-		for( j = 0; j<outwidth; j++, out += 4 )
-		{
-			pix1 = &pal[ data[ row1[ i ] + col1[ j ] ] * 3 ];
-			pix2 = &pal[ data[ row1[ i ] + col2[ j ] ] * 3 ];
-			pix3 = &pal[ data[ row2[ i ] + col1[ j ] ] * 3 ];
-			pix4 = &pal[ data[ row2[ i ] + col2[ j ] ] * 3 ];
+	const size_t uiPixels = static_cast<size_t>( ptexture->width ) * ptexture->height;
 
-			out[ 0 ] = ( pix1[ 0 ] + pix2[ 0 ] + pix3[ 0 ] + pix4[ 0 ] ) >> 2;
-			out[ 1 ] = ( pix1[ 1 ] + pix2[ 1 ] + pix3[ 1 ] + pix4[ 1 ] ) >> 2;
-			out[ 2 ] = ( pix1[ 2 ] + pix2[ 2 ] + pix3[ 2 ] + pix4[ 2 ] ) >> 2;
+	std::unique_ptr<byte[]> expanded = std::make_unique<byte[]>( uiPixels * 4 );
 
-			if( ptexture->flags & STUDIO_NF_MASKED && pix1 == pAlpha && pix2 == pAlpha && pix3 == pAlpha && pix4 == pAlpha )
-			{
-				//Set alpha to 0 to enable transparent pixel.
-				out[ 3 ] = 0x00;
-			}
-			else
-			{
-				out[ 3 ] = 0xFF;
-			}
-		}
-	}
+	graphics::ExpandIndexedToRGBA( data, uiPixels, rgbaPalette, expanded.get() );
 
-	UploadRGBATexture( outwidth, outheight, tex, name, bFilterTextures );
+	//Masked pixels stay fully transparent or fully opaque, so alpha testing still works.
+	graphics::ResampleRGBA( expanded.get(), ptexture->width, ptexture->height, texture.pixels.get(), outwidth, outheight,
+		graphics::ResampleFilter::LANCZOS, bMasked );
 
-	free( tex );
+	return true;
 }
 
-size_t UploadTextures( studiohdr_t& textureHdr, GLuint* pTextures, const bool bFilterTextures, const bool bPowerOf2, const bool bIsDol )
+void UploadIndexedTexture( const mstudiotexture_t* ptexture, const byte* data, byte* pal, int name, const bool bFilterTextures, const bool bPowerOf2 )
 {
-	size_t uiNumTextures = 0;
+	StudioRGBATexture_t texture;
 
-	if( textureHdr.textureindex > 0 && textureHdr.numtextures <= CStudioModel::MAX_TEXTURES )
-	{
-		mstudiotexture_t* ptexture = textureHdr.GetTextures();
+	if( ConvertTextureToRGBA( ptexture, data, pal, bPowerOf2, texture ) )
+		UploadRGBATexture( texture.iWidth, texture.iHeight, texture.pixels.get(), name, bFilterTextures );
+}
 
-		byte* pIn = reinterpret_cast<byte*>( &textureHdr );
+/**
+*	Builds the name of a sequence group file.
+*	@return Whether the name fit in the buffer.
+*/
+bool GetSequenceGroupFilename( const char* const pszFilename, const int iGroup, const bool bIsDol, char* pszBuffer, const size_t uiBufferSize )
+{
+	const auto suffix = bIsDol ? "%02d.dol" : "%02d.mdl";
 
-		const int n = textureHdr.numtextures;
+	const size_t uiLength = strlen( pszFilename );
 
-		for( int i = 0; i < n; ++i )
-		{
-			GLuint name;
+	if( uiLength < 4 || uiLength >= uiBufferSize )
+		return false;
 
-			glBindTexture( GL_TEXTURE_2D, 0 );
-			glGenTextures( 1, &name );
+	strcpy( pszBuffer, pszFilename );
 
-			if( bIsDol )
-			{
-				ConvertDolToMdl( pIn, ptexture[ i ] );
-			}
+	return PrintfSuccess( snprintf( &pszBuffer[ uiLength - 4 ], uiBufferSize - ( uiLength - 4 ), suffix, iGroup ), uiBufferSize - ( uiLength - 4 ) );
+}
 
-			UploadTexture( &ptexture[ i ], pIn + ptexture[ i ].index, pIn + ptexture[ i ].width * ptexture[ i ].height + ptexture[ i ].index, name, bFilterTextures, bPowerOf2 );
+/**
+*	Loads a model or sequence group header.
+*	@param pPendingRead If not null and the file isn't mapped, the header is loaded from this read instead of reading the file.
+*	@param pOutSize If not null and the header was loaded, set to the size of the file.
+*/
+StudioModelLoadResult LoadStudioHeader( const char* const pszFilename, const bool bAllowSeqGroup, studiohdr_t*& pOutStudioHdr, std::unique_ptr<CMappedFile>& mappedFile,
+										std::future<filesystem::CFileData>* pPendingRead = nullptr, size_t* pOutSize = nullptr );
 
-			pTextures[ i ] = name;
-		}
+/**
+*	Reports why a model file failed validation.
+*/
+void ReportValidationIssues( const char* const pszFilename, const std::vector<std::string>& issues );
 
-		uiNumTextures = n;
-	}
+/**
+*	Next pose revision to hand out. Shared by all models so pose caches keyed on the model's address never see a revision twice.
+*/
+std::atomic<unsigned int> g_uiNextPoseRevision{ 0 };
 
-	return uiNumTextures;
+unsigned int NewPoseRevision()
+{
+	return g_uiNextPoseRevision++;
 }
 }
 
 CStudioModel::CStudioModel()
+	: m_pStudioHdr( nullptr )
+	, m_pTextureHdr( nullptr )
+	, m_uiPoseRevision( NewPoseRevision() )
 {
-	memset( this, 0, sizeof( *this ) );
+	memset( m_pSeqHdrs, 0, sizeof( m_pSeqHdrs ) );
+	memset( m_Textures, 0, sizeof( m_Textures ) );
+	memset( m_bTexturePending, 0, sizeof( m_bTexturePending ) );
+	memset( m_bTextureUploading, 0, sizeof( m_bTextureUploading ) );
+	memset( m_TextureSizes, 0, sizeof( m_TextureSizes ) );
+
+	for( auto& bLoaded : m_bSeqGroupLoaded )
+	{
+		bLoaded = false;
+	}
 }
 
 CStudioModel::CStudioModel( studiohdr_t* pStudioHdr, studiohdr_t* pTextureHdr, studiohdr_t** ppSeqHdrs, const size_t uiNumSeqHdrs, GLuint* pTextures, const size_t uiNumTextures )
 	: m_pStudioHdr( pStudioHdr )
 	, m_pTextureHdr( pTextureHdr )
+	, m_uiPoseRevision( NewPoseRevision() )
 {
 	assert( pStudioHdr );
 	assert( pTextureHdr );
@@ -264,239 +451,2313 @@ CStudioModel::CStudioModel( studiohdr_t* pStudioHdr, studiohdr_t* pTextureHdr, s
 
 	for( size_t uiIndex = 0; uiIndex < uiNumSeqHdrs; ++uiIndex )
 	{
-		m_pSeqHdrs[ uiIndex ] = ppSeqHdrs[ uiIndex ];
+		m_pSeqHdrs[ uiIndex ] = ppSeqHdrs[ uiIndex ];
+	}
+
+	memset( m_pSeqHdrs + uiNumSeqHdrs, 0, sizeof( studiohdr_t* ) * ( MAX_SEQGROUPS - uiNumSeqHdrs ) );
+
+	//There are no files to load sequence groups from.
+	for( auto& bLoaded : m_bSeqGroupLoaded )
+	{
+		bLoaded = true;
+	}
+
+	memcpy( m_Textures, pTextures, sizeof( GLuint ) * uiNumTextures );
+	memset( m_Textures + uiNumTextures, 0, sizeof( GLuint ) * ( MAX_TEXTURES - uiNumTextures ) );
+	memset( m_bTexturePending, 0, sizeof( m_bTexturePending ) );
+	memset( m_bTextureUploading, 0, sizeof( m_bTextureUploading ) );
+	memset( m_TextureSizes, 0, sizeof( m_TextureSizes ) );
+
+	BuildEventIndex();
+	BuildBoneHierarchy();
+	BuildBoneBounds();
+	BuildTextureMeshIndex();
+	BuildDrawLists();
+}
+
+CStudioModel::~CStudioModel()
+{
+	if( m_PrefetchThread.joinable() )
+	{
+		m_bStopPrefetch = true;
+		m_PrefetchThread.join();
+	}
+
+	if( !m_pStudioHdr )
+		return;
+
+	//Completions reference this model, and textures can't be deleted while they're being written to.
+	FinishTextureUploads();
+
+	//Shared textures are only deleted once no other model uses them.
+	for( int i = 0; i < m_pTextureHdr->numtextures && i < static_cast<int>( MAX_TEXTURES ); ++i )
+	{
+		ReleaseTexture( i );
+	}
+
+	if( m_IndexBuffer != 0 )
+	{
+		glDeleteBuffers( 1, &m_IndexBuffer );
+	}
+
+	if( m_SkinVertexBuffer != 0 )
+	{
+		glDeleteBuffers( 1, &m_SkinVertexBuffer );
+	}
+
+	//Mapped headers are freed when m_MappedFiles is destroyed.
+	for( auto pSeqHdr : m_pSeqHdrs )
+	{
+		if( !IsMapped( pSeqHdr ) )
+			mem::Free( pSeqHdr );
+	}
+
+	//Textures were in a T.mdl, free separately.
+	if( m_pTextureHdr != m_pStudioHdr && !IsMapped( m_pTextureHdr ) )
+	{
+		mem::Free( m_pTextureHdr );
+	}
+
+	if( !IsMapped( m_pStudioHdr ) )
+		mem::Free( m_pStudioHdr );
+}
+
+int CStudioModel::GetUploadableTextureCount() const
+{
+	if( m_pTextureHdr->textureindex > 0 && m_pTextureHdr->numtextures <= static_cast<int>( MAX_TEXTURES ) )
+		return m_pTextureHdr->numtextures;
+
+	return 0;
+}
+
+void CStudioModel::ConvertTexture( const int iIndex, const bool bPowerOf2, StudioRGBATexture_t& texture ) const
+{
+	//Evicted textures can be restored after their pixels were released.
+	EnsureTexturePixels();
+
+	const mstudiotexture_t& studioTexture = m_pTextureHdr->GetTextures()[ iIndex ];
+
+	byte* const pData = m_pTextureHdr->GetData() + studioTexture.index;
+
+	texture.iIndex = iIndex;
+	texture.uiHash = HashStudioTexture( *this, iIndex );
+	texture.pixels.reset();
+
+	ConvertTextureToRGBA( &studioTexture, pData, pData + studioTexture.width * studioTexture.height, bPowerOf2, texture );
+}
+
+void CStudioModel::ConvertTextures( const bool bPowerOf2, const TextureConvertedFn_t& callback, const std::atomic<bool>* pbCancel,
+									 const std::vector<bool>* pSkip ) const
+{
+	RunTextureBatch( static_cast<size_t>( GetUploadableTextureCount() ),
+		[ & ]( const size_t uiIndex )
+		{
+			if( pbCancel && *pbCancel )
+				return;
+
+			if( pSkip && uiIndex < pSkip->size() && ( *pSkip )[ uiIndex ] )
+				return;
+
+			StudioRGBATexture_t texture;
+
+			ConvertTexture( static_cast<int>( uiIndex ), bPowerOf2, texture );
+
+			callback( texture );
+		}
+	);
+}
+
+bool CStudioModel::IsTextureUploaded( const int iIndex ) const
+{
+	if( iIndex < 0 || iIndex >= GetUploadableTextureCount() )
+		return false;
+
+	return m_Textures[ iIndex ] != 0 && !m_bTexturePending[ iIndex ] && !m_bTextureUploading[ iIndex ];
+}
+
+bool CStudioModel::AdoptTexture( const int iIndex, CStudioModel& other, const int iOtherIndex )
+{
+	if( iIndex < 0 || iIndex >= GetUploadableTextureCount() || !other.IsTextureUploaded( iOtherIndex ) )
+		return false;
+
+	//The texture has to look the same as if it had been uploaded with this model's settings.
+	if( other.m_bFilterPendingTextures != m_bFilterPendingTextures || other.m_bPowerOf2PendingTextures != m_bPowerOf2PendingTextures )
+		return false;
+
+	assert( !m_bTextureUploading[ iIndex ] );
+
+	//A name may have been reserved for a deferred upload.
+	ReleaseTexture( iIndex );
+
+	const GLuint name = other.m_Textures[ iOtherIndex ];
+	const size_t uiSize = other.m_TextureSizes[ iOtherIndex ];
+
+	auto pRenderContext = engine::GetRenderContext();
+
+	//Shared textures stay registered with the table, which restores them from whichever model uses them.
+	const bool bShared = StudioTextureTable().Transfer( name, other, iOtherIndex, *this, iIndex );
+
+	//The other model must not delete or restore it anymore.
+	if( pRenderContext && !bShared )
+		pRenderContext->UnregisterTexture( TextureToHandle( name ) );
+
+	other.m_TextureMemory.AddBytes( -static_cast<int64_t>( uiSize ) );
+	other.m_TextureSizes[ iOtherIndex ] = 0;
+	other.m_Textures[ iOtherIndex ] = 0;
+
+	m_Textures[ iIndex ] = name;
+	m_bTexturePending[ iIndex ] = false;
+
+	m_TextureMemory.AddBytes( static_cast<int64_t>( uiSize ) );
+	m_TextureSizes[ iIndex ] = uiSize;
+
+	if( pRenderContext && !bShared )
+		pRenderContext->RegisterTexture( TextureToHandle( name ), uiSize, this );
+
+	return true;
+}
+
+void CStudioModel::UploadTexture( const StudioRGBATexture_t& texture, const bool bFilterTextures ) const
+{
+	//Never write to a texture that other models use.
+	if( StudioTextureTable().Contains( m_Textures[ texture.iIndex ] ) )
+		ReleaseTexture( texture.iIndex );
+
+	if( texture.pixels && AcquireSharedTexture( texture.iIndex, texture.uiHash, texture.iWidth, texture.iHeight, bFilterTextures ) )
+		return;
+
+	GLuint name = m_Textures[ texture.iIndex ];
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	if( name == 0 )
+		glGenTextures( 1, &name );
+
+	if( texture.pixels )
+		UploadRGBATexture( texture.iWidth, texture.iHeight, texture.pixels.get(), name, bFilterTextures );
+
+	m_Textures[ texture.iIndex ] = name;
+	m_bTexturePending[ texture.iIndex ] = false;
+
+	if( texture.pixels )
+		ShareTexture( texture.iIndex, texture.uiHash, texture.iWidth, texture.iHeight, bFilterTextures );
+}
+
+void CStudioModel::QueueTextureUpload( StudioRGBATexture_t&& texture, const bool bFilterTextures )
+{
+	auto& queue = graphics::GLUploadQueue();
+
+	if( !queue.IsRunning() || !texture.pixels )
+	{
+		UploadTexture( texture, bFilterTextures );
+		return;
+	}
+
+	const int iIndex = texture.iIndex;
+
+	if( StudioTextureTable().Contains( m_Textures[ iIndex ] ) )
+		ReleaseTexture( iIndex );
+
+	const uint64_t uiHash = texture.uiHash != 0 ? texture.uiHash : HashStudioTexture( *this, iIndex );
+
+	if( AcquireSharedTexture( iIndex, uiHash, texture.iWidth, texture.iHeight, bFilterTextures ) )
+		return;
+
+	GLuint name = m_Textures[ iIndex ];
+
+	//Names are created on this thread so they can be stored right away.
+	if( name == 0 )
+		glGenTextures( 1, &name );
+
+	m_Textures[ iIndex ] = name;
+	m_bTexturePending[ iIndex ] = false;
+	m_bTextureUploading[ iIndex ] = true;
+
+	//Settings come from cvars, so they're read here. std::function must be copyable, so the pixels are shared.
+	const auto settings = graphics::GetTextureUploadSettings( bFilterTextures );
+
+	std::shared_ptr<byte> pixels( texture.pixels.release(), mem::CDeleter() );
+
+	const int iWidth = texture.iWidth;
+	const int iHeight = texture.iHeight;
+
+	queue.Queue(
+		[ = ]()
+		{
+			graphics::UploadRGBATexture( name, iWidth, iHeight, pixels.get(), settings );
+
+			glBindTexture( GL_TEXTURE_2D, 0 );
+		},
+		[ this, iIndex, uiHash, iWidth, iHeight, bFilterTextures ]()
+		{
+			m_bTextureUploading[ iIndex ] = false;
+
+			//Another model may have uploaded the same texture in the meantime.
+			if( !AcquireSharedTexture( iIndex, uiHash, iWidth, iHeight, bFilterTextures ) )
+				ShareTexture( iIndex, uiHash, iWidth, iHeight, bFilterTextures );
+		}
+	);
+}
+
+void CStudioModel::FinishTextureUploads() const
+{
+	for( const auto bUploading : m_bTextureUploading )
+	{
+		if( bUploading )
+		{
+			graphics::GLUploadQueue().Flush();
+			break;
+		}
+	}
+}
+
+void CStudioModel::RegisterTexture( const int iIndex, const int iWidth, const int iHeight, const bool bFilterTextures ) const
+{
+	const size_t uiSize = graphics::EstimateRGBATextureSize( iWidth, iHeight, graphics::GetTextureUploadSettings( bFilterTextures ) );
+
+	//Re-registering a texture replaces its old size.
+	m_TextureMemory.AddBytes( static_cast<int64_t>( uiSize ) - static_cast<int64_t>( m_TextureSizes[ iIndex ] ) );
+	m_TextureSizes[ iIndex ] = uiSize;
+
+	auto pRenderContext = engine::GetRenderContext();
+
+	if( !pRenderContext )
+		return;
+
+	//Registration only tracks the texture, it doesn't change the model.
+	pRenderContext->RegisterTexture( TextureToHandle( m_Textures[ iIndex ] ), uiSize, const_cast<CStudioModel*>( this ) );
+}
+
+bool CStudioModel::AcquireSharedTexture( const int iIndex, const uint64_t uiHash, const int iWidth, const int iHeight, const bool bFilterTextures ) const
+{
+	if( !mdl_sharetextures.GetBool() )
+		return false;
+
+	assert( !StudioTextureTable().Contains( m_Textures[ iIndex ] ) );
+
+	//The table doesn't change the model.
+	const GLuint name = StudioTextureTable().Acquire( MakeSharedTextureKey( *this, iIndex, uiHash, iWidth, iHeight, bFilterTextures ),
+													  *const_cast<CStudioModel*>( this ), iIndex );
+
+	if( name == 0 )
+		return false;
+
+	//Drops the name that was reserved or uploaded for this model.
+	ReleaseTexture( iIndex );
+
+	m_Textures[ iIndex ] = name;
+	m_bTexturePending[ iIndex ] = false;
+
+	return true;
+}
+
+void CStudioModel::ShareTexture( const int iIndex, const uint64_t uiHash, const int iWidth, const int iHeight, const bool bFilterTextures ) const
+{
+	if( !mdl_sharetextures.GetBool() )
+	{
+		RegisterTexture( iIndex, iWidth, iHeight, bFilterTextures );
+		return;
+	}
+
+	const size_t uiSize = graphics::EstimateRGBATextureSize( iWidth, iHeight, graphics::GetTextureUploadSettings( bFilterTextures ) );
+
+	auto pSource = StudioTextureTable().Add( MakeSharedTextureKey( *this, iIndex, uiHash, iWidth, iHeight, bFilterTextures ),
+											 m_Textures[ iIndex ], uiSize, *const_cast<CStudioModel*>( this ), iIndex );
+
+	if( !pSource )
+	{
+		RegisterTexture( iIndex, iWidth, iHeight, bFilterTextures );
+		return;
+	}
+
+	//This model is the first to use it, so it pays for it.
+	m_TextureMemory.AddBytes( static_cast<int64_t>( uiSize ) - static_cast<int64_t>( m_TextureSizes[ iIndex ] ) );
+	m_TextureSizes[ iIndex ] = uiSize;
+
+	if( auto pRenderContext = engine::GetRenderContext() )
+		pRenderContext->RegisterTexture( TextureToHandle( m_Textures[ iIndex ] ), uiSize, pSource );
+}
+
+void CStudioModel::ReleaseTexture( const int iIndex ) const
+{
+	const GLuint name = m_Textures[ iIndex ];
+
+	if( name == 0 )
+		return;
+
+	m_TextureMemory.AddBytes( -static_cast<int64_t>( m_TextureSizes[ iIndex ] ) );
+
+	const size_t uiSize = m_TextureSizes[ iIndex ];
+
+	m_Textures[ iIndex ] = 0;
+	m_TextureSizes[ iIndex ] = 0;
+	m_bTexturePending[ iIndex ] = false;
+
+	auto& table = StudioTextureTable();
+
+	if( table.Contains( name ) )
+	{
+		CStudioTextureTable::Holder_t newPayer;
+
+		if( table.Release( name, *const_cast<CStudioModel*>( this ), iIndex, newPayer ) )
+		{
+			if( newPayer.pModel )
+			{
+				newPayer.pModel->m_TextureMemory.AddBytes( static_cast<int64_t>( uiSize ) );
+				newPayer.pModel->m_TextureSizes[ newPayer.iIndex ] = uiSize;
+			}
+
+			return;
+		}
+	}
+
+	if( auto pRenderContext = engine::GetRenderContext() )
+		pRenderContext->UnregisterTexture( TextureToHandle( name ) );
+
+	glDeleteTextures( 1, &name );
+}
+
+void CStudioModel::MakeTextureUnique( const int iIndex )
+{
+	if( !StudioTextureTable().Contains( m_Textures[ iIndex ] ) )
+		return;
+
+	ReleaseTexture( iIndex );
+
+	glGenTextures( 1, &m_Textures[ iIndex ] );
+}
+
+bool CStudioModel::RestoreTexture( renderer::HTexture_t hTexture )
+{
+	const GLuint name = HandleToTexture( hTexture );
+
+	const int iNumTextures = GetUploadableTextureCount();
+
+	for( int i = 0; i < iNumTextures; ++i )
+	{
+		if( m_Textures[ i ] != name )
+			continue;
+
+		StudioRGBATexture_t texture;
+
+		ConvertTexture( i, m_bPowerOf2PendingTextures, texture );
+
+		if( !texture.pixels )
+			return false;
+
+		UploadRGBATexture( texture.iWidth, texture.iHeight, texture.pixels.get(), name, m_bFilterPendingTextures );
+
+		return true;
+	}
+
+	return false;
+}
+
+void CStudioModel::ReserveTextures( const bool bFilterTextures, const bool bPowerOf2Textures )
+{
+	m_bFilterPendingTextures = bFilterTextures;
+	m_bPowerOf2PendingTextures = bPowerOf2Textures;
+
+	const int iNumTextures = GetUploadableTextureCount();
+
+	if( iNumTextures == 0 )
+		return;
+
+	glGenTextures( iNumTextures, m_Textures );
+
+	for( int i = 0; i < iNumTextures; ++i )
+	{
+		m_bTexturePending[ i ] = true;
+	}
+}
+
+bool CStudioModel::IsMapped( const studiohdr_t* pHeader ) const
+{
+	if( !pHeader )
+		return false;
+
+	for( const auto& file : m_MappedFiles )
+	{
+		if( file->GetData() == pHeader )
+			return true;
+	}
+
+	return false;
+}
+
+bool CStudioModel::DetachMappedFiles() const
+{
+	//Detached memory isn't backed by the file anymore, so released pages have to be read in first.
+	EnsureTexturePixels();
+
+	std::lock_guard<std::mutex> lock( m_SeqGroupMutex );
+
+	bool bSuccess = true;
+
+	for( const auto& file : m_MappedFiles )
+	{
+		if( !file->Detach() )
+			bSuccess = false;
+	}
+
+	return bSuccess;
+}
+
+size_t CStudioModel::CompactTextures()
+{
+	if( m_bIsDol || m_bTexturesEdited || m_szTextureFilename.empty() )
+		return 0;
+
+	const int iNumTextures = GetUploadableTextureCount();
+
+	//Deferred and queued textures still need their pixels.
+	for( int i = 0; i < iNumTextures; ++i )
+	{
+		if( !IsTextureUploaded( i ) )
+			return 0;
+	}
+
+	std::lock_guard<std::mutex> lock( m_PixelMutex );
+
+	if( m_bPixelsReleased )
+		return 0;
+
+	std::vector<std::pair<size_t, size_t>> ranges;
+
+	ranges.reserve( iNumTextures );
+
+	const mstudiotexture_t* const pTextures = m_pTextureHdr->GetTextures();
+
+	for( int i = 0; i < iNumTextures; ++i )
+	{
+		const size_t uiStart = static_cast<size_t>( pTextures[ i ].index );
+
+		ranges.emplace_back( uiStart, uiStart + pTextures[ i ].width * pTextures[ i ].height + PALETTE_SIZE );
+	}
+
+	//Textures are usually stored one after the other, so merging them releases more whole pages.
+	std::sort( ranges.begin(), ranges.end() );
+
+	std::vector<std::pair<size_t, size_t>> merged;
+
+	for( const auto& range : ranges )
+	{
+		if( !merged.empty() && range.first <= merged.back().second )
+			merged.back().second = std::max( merged.back().second, range.second );
+		else
+			merged.emplace_back( range );
+	}
+
+	bool bFileBacked = false;
+
+	{
+		//The prefetch thread can be adding sequence group files.
+		std::lock_guard<std::mutex> seqGroupLock( m_SeqGroupMutex );
+
+		for( const auto& file : m_MappedFiles )
+		{
+			if( file->GetData() == m_pTextureHdr )
+			{
+				bFileBacked = !file->IsDetached();
+				break;
+			}
+		}
+	}
+
+	size_t uiReleased = 0;
+
+	for( const auto& range : merged )
+	{
+		uiReleased += plat::ReleasePages( m_pTextureHdr->GetData() + range.first, range.second - range.first, bFileBacked );
+	}
+
+	if( uiReleased == 0 )
+		return 0;
+
+	if( !bFileBacked )
+		m_ReleasedPixels = std::move( merged );
+
+	m_uiReleasedPixelBytes = uiReleased;
+	m_HeaderMemory.AddBytes( -static_cast<int64_t>( uiReleased ) );
+
+	m_bPixelsReleased.store( true, std::memory_order_release );
+
+	return uiReleased;
+}
+
+bool CStudioModel::EnsureTexturePixels() const
+{
+	if( !m_bPixelsReleased.load( std::memory_order_acquire ) )
+		return true;
+
+	std::lock_guard<std::mutex> lock( m_PixelMutex );
+
+	if( !m_bPixelsReleased )
+		return true;
+
+	if( !m_ReleasedPixels.empty() )
+	{
+		filesystem::CFileData data;
+
+		if( !engine::ReadFile( m_szTextureFilename.c_str(), data ) || data.GetSize() != static_cast<size_t>( m_pTextureHdr->length ) )
+		{
+			Error( "CStudioModel::EnsureTexturePixels: Couldn't read texture pixels from \"%s\"\n", m_szTextureFilename.c_str() );
+			return false;
+		}
+
+		for( const auto& range : m_ReleasedPixels )
+		{
+			memcpy( m_pTextureHdr->GetData() + range.first, data.GetData() + range.first, range.second - range.first );
+		}
+
+		m_ReleasedPixels.clear();
+	}
+
+	//Pages of mapped files are back once they're used, so count them from here on.
+	m_HeaderMemory.AddBytes( static_cast<int64_t>( m_uiReleasedPixelBytes ) );
+	m_uiReleasedPixelBytes = 0;
+
+	m_bPixelsReleased.store( false, std::memory_order_release );
+
+	return true;
+}
+
+size_t CStudioModel::GetResidentSize() const
+{
+	return m_HeaderMemory.GetBytes() +
+		m_MeshVertices.capacity() * sizeof( StudioMeshVertex_t ) +
+		m_MeshIndices.capacity() * sizeof( GLuint ) +
+		m_AnimCache.GetMemoryUsed();
+}
+
+mstudioanim_t* CStudioModel::GetAnim( const mstudioseqdesc_t* pseqdesc ) const
+{
+	if( m_bValidated )
+		return m_View.GetAnim( pseqdesc );
+
+	if( pseqdesc->seqgroup < 0 || pseqdesc->seqgroup >= m_pStudioHdr->numseqgroups || pseqdesc->animindex < 0 )
+		return nullptr;
+
+	const studiohdr_t* pHdr = m_pStudioHdr;
+
+	int64_t iOffset = pseqdesc->animindex;
+
+	if( pseqdesc->seqgroup == 0 )
+	{
+		iOffset += m_pStudioHdr->GetSequenceGroup( 0 )->unused2;
+	}
+	else
+	{
+		pHdr = GetSeqGroupHeader( pseqdesc->seqgroup );
+
+		if( !pHdr )
+			return nullptr;
+	}
+
+	//The animation values themselves are only checked by validation.
+	const int64_t iSize = static_cast<int64_t>( pseqdesc->numblends ) * m_pStudioHdr->numbones * sizeof( mstudioanim_t );
+
+	if( iOffset < 0 || iSize < 0 || iOffset + iSize > pHdr->length )
+		return nullptr;
+
+	return reinterpret_cast<mstudioanim_t*>( const_cast<byte*>( pHdr->GetData() ) + iOffset );
+}
+
+mstudioanim_t* CStudioModelView::GetGroupAnim( const mstudioseqdesc_t* pseqdesc ) const
+{
+	studiohdr_t* const pSeqHdr = m_pModel->GetSeqGroupHeader( pseqdesc->seqgroup );
+
+	if( !pSeqHdr )
+		return nullptr;
+
+	return reinterpret_cast<mstudioanim_t*>( pSeqHdr->GetData() + pseqdesc->animindex );
+}
+
+studiohdr_t* CStudioModel::GetSeqGroupHeader( const size_t i ) const
+{
+	if( i >= MAX_SEQGROUPS )
+		return nullptr;
+
+	if( !m_bSeqGroupLoaded[ i ].load( std::memory_order_acquire ) )
+		LoadSequenceGroup( i );
+
+	return m_pSeqHdrs[ i ];
+}
+
+void CStudioModel::PrefetchSequenceGroups()
+{
+	if( m_PrefetchThread.joinable() )
+		return;
+
+	m_PrefetchThread = std::thread( [ this ]()
+		{
+			std::vector<std::future<filesystem::CFileData>> reads( m_pStudioHdr->numseqgroups );
+
+			//Mapped files are only read from disk when they're used. Otherwise, read all groups at the same time.
+			if( !mdl_mapfiles.GetBool() )
+			{
+				char seqgroupname[ MAX_PATH_LENGTH ];
+
+				for( int i = 1; i < m_pStudioHdr->numseqgroups; ++i )
+				{
+					if( m_bSeqGroupLoaded[ i ].load( std::memory_order_acquire ) )
+						continue;
+
+					if( GetSequenceGroupFilename( m_szFilename.c_str(), i, m_bIsDol, seqgroupname, sizeof( seqgroupname ) ) )
+						reads[ i ] = engine::ReadFileAsync( seqgroupname );
+				}
+			}
+
+			for( int i = 1; i < m_pStudioHdr->numseqgroups && !m_bStopPrefetch; ++i )
+			{
+				if( !m_bSeqGroupLoaded[ i ].load( std::memory_order_acquire ) )
+					LoadSequenceGroup( i, &reads[ i ] );
+			}
+		}
+	);
+}
+
+void CStudioModel::LoadSequenceGroup( const size_t i, std::future<filesystem::CFileData>* pPendingRead ) const
+{
+	std::lock_guard<std::mutex> lock( m_SeqGroupMutex );
+
+	//Another thread may have loaded it while we were waiting.
+	if( m_bSeqGroupLoaded[ i ].load( std::memory_order_relaxed ) )
+		return;
+
+	//Group 0 is part of the main header.
+	if( i > 0 && static_cast<int>( i ) < m_pStudioHdr->numseqgroups )
+	{
+		char seqgroupname[ MAX_PATH_LENGTH ];
+
+		if( GetSequenceGroupFilename( m_szFilename.c_str(), static_cast<int>( i ), m_bIsDol, seqgroupname, sizeof( seqgroupname ) ) )
+		{
+			std::unique_ptr<CMappedFile> mappedFile;
+
+			studiohdr_t* pSeqHdr = nullptr;
+			size_t uiSize = 0;
+
+			if( LoadStudioHeader( seqgroupname, true, pSeqHdr, mappedFile, pPendingRead, &uiSize ) == StudioModelLoadResult::SUCCESS )
+			{
+				std::vector<std::string> issues;
+
+				if( !m_bValidateSeqGroups || ValidateSequenceGroup( *m_pStudioHdr, static_cast<int>( i ), pSeqHdr, uiSize, &issues ) )
+				{
+					m_pSeqHdrs[ i ] = pSeqHdr;
+
+					if( mappedFile )
+						m_MappedFiles.push_back( std::move( mappedFile ) );
+
+					m_HeaderMemory.AddBytes( pSeqHdr->length );
+				}
+				else
+				{
+					//Its sequences use the bind pose, as if the group couldn't be loaded.
+					ReportValidationIssues( seqgroupname, issues );
+
+					if( !mappedFile )
+						mem::Free( pSeqHdr );
+				}
+			}
+			else
+			{
+				Error( "CStudioModel::LoadSequenceGroup: Couldn't load sequence group \"%s\"\n", seqgroupname );
+			}
+		}
+	}
+
+	//Failures aren't retried so the error is only reported once.
+	m_bSeqGroupLoaded[ i ].store( true, std::memory_order_release );
+}
+
+bool CStudioModel::LoadAllSequenceGroups() const
+{
+	bool bSuccess = true;
+
+	for( int i = 1; i < m_pStudioHdr->numseqgroups; ++i )
+	{
+		if( !GetSeqGroupHeader( i ) )
+			bSuccess = false;
+	}
+
+	return bSuccess;
+}
+
+std::shared_ptr<const CDecodedAnim> CStudioModel::GetDecodedAnim( const mstudioseqdesc_t* pseqdesc, const mstudioanim_t* panim )
+{
+	const size_t uiBudget = static_cast<size_t>( r_animcachebudget.GetFloat() * 1024 * 1024 );
+
+	if( uiBudget == 0 )
+	{
+		m_AnimCache.Clear();
+		return nullptr;
+	}
+
+	return m_AnimCache.GetDecodedAnim( panim, m_pStudioHdr->numbones, pseqdesc->numframes, uiBudget, r_animcachequantize.GetBool() );
+}
+
+mstudiomodel_t* CStudioModel::GetModelByBodyPart( const int iBody, const int iBodyPart ) const
+{
+	if( m_bValidated )
+		return m_View.GetModelByBodyPart( iBody, iBodyPart );
+
+	if( iBodyPart < 0 || iBodyPart >= m_pStudioHdr->numbodyparts || iBody < 0 )
+		return nullptr;
+
+	const int64_t iBodypartEnd = m_pStudioHdr->bodypartindex + static_cast<int64_t>( iBodyPart + 1 ) * sizeof( mstudiobodyparts_t );
+
+	if( m_pStudioHdr->bodypartindex < 0 || iBodypartEnd > m_pStudioHdr->length )
+		return nullptr;
+
+	const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+
+	if( pbodypart->base < 1 || pbodypart->nummodels < 1 )
+		return nullptr;
+
+	const int index = ( iBody / pbodypart->base ) % pbodypart->nummodels;
+
+	const int64_t iModelEnd = pbodypart->modelindex + static_cast<int64_t>( index + 1 ) * sizeof( mstudiomodel_t );
+
+	if( pbodypart->modelindex < 0 || iModelEnd > m_pStudioHdr->length )
+		return nullptr;
+
+	return reinterpret_cast<mstudiomodel_t*>( m_pStudioHdr->GetData() + pbodypart->modelindex ) + index;
+}
+
+bool CStudioModel::CalculateBodygroup( const int iGroup, const int iValue, int& iInOutBodygroup ) const
+{
+	if( iGroup > m_pStudioHdr->numbodyparts )
+		return false;
+
+	const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iGroup );
+
+	int iCurrent = ( iInOutBodygroup / pbodypart->base ) % pbodypart->nummodels;
+
+	if( iValue >= pbodypart->nummodels )
+		return true;
+
+	iInOutBodygroup = ( iInOutBodygroup - ( iCurrent * pbodypart->base ) + ( iValue * pbodypart->base ) );
+
+	return true;
+}
+
+GLuint CStudioModel::GetTextureId( const int iIndex ) const
+{
+	const studiohdr_t* const pHdr = GetTextureHeader();
+
+	if( !pHdr )
+		return GL_INVALID_TEXTURE_ID;
+
+	if( iIndex < 0 || iIndex >= pHdr->numtextures )
+		return GL_INVALID_TEXTURE_ID;
+
+	if( m_bTextureUploading[ iIndex ] )
+		return GL_INVALID_TEXTURE_ID;
+
+	if( m_bTexturePending[ iIndex ] )
+	{
+		StudioRGBATexture_t texture;
+
+		ConvertTexture( iIndex, m_bPowerOf2PendingTextures, texture );
+		UploadTexture( texture, m_bFilterPendingTextures );
+	}
+
+	return m_Textures[ iIndex ];
+}
+
+void CStudioModel::ReplaceTexture( mstudiotexture_t* ptexture, byte *data, byte *pal, GLuint textureId )
+{
+	EnsureTexturePixels();
+
+	m_bTexturesEdited = true;
+
+	const int iIndex = ptexture - m_pTextureHdr->GetTextures();
+
+	const bool bOwnTexture = iIndex >= 0 && iIndex < m_pTextureHdr->numtextures && m_Textures[ iIndex ] == textureId;
+
+	//Other models sharing the texture keep the original.
+	if( bOwnTexture )
+	{
+		MakeTextureUnique( iIndex );
+		textureId = m_Textures[ iIndex ];
+	}
+
+	glDeleteTextures( 1, &textureId );
+
+	UploadIndexedTexture( ptexture, data, pal, textureId, r_filtertextures.GetBool(), r_powerof2textures.GetBool() );
+
+	if( bOwnTexture )
+		RegisterTexture( iIndex, ptexture->width, ptexture->height, r_filtertextures.GetBool() );
+}
+
+void CStudioModel::ReuploadTexture( mstudiotexture_t* ptexture )
+{
+	assert( ptexture );
+
+	const int iIndex = ptexture - m_pTextureHdr->GetTextures();
+
+	if( iIndex < 0 || iIndex >= m_pTextureHdr->numtextures )
+	{
+		Error( "CStudioModel::ReuploadTexture: Invalid texture!" );
+		return;
+	}
+
+	EnsureTexturePixels();
+
+	m_bTexturesEdited = true;
+
+	FinishTextureUploads();
+
+	//Other models sharing the texture keep the original.
+	MakeTextureUnique( iIndex );
+
+	GLuint textureId = m_Textures[ iIndex ];
+
+	glDeleteTextures( 1, &textureId );
+
+	m_bTexturePending[ iIndex ] = false;
+
+	UploadIndexedTexture( ptexture, 
+				   m_pTextureHdr->GetData() + ptexture->index, 
+				   m_pTextureHdr->GetData() + ptexture->index + ptexture->width * ptexture->height, textureId, r_filtertextures.GetBool(), r_powerof2textures.GetBool() );
+
+	RegisterTexture( iIndex, ptexture->width, ptexture->height, r_filtertextures.GetBool() );
+}
+
+void CStudioModel::ApplyTextureSettings( const bool bFilterTextures, const bool bPowerOf2Textures )
+{
+	if( bFilterTextures == m_bFilterPendingTextures && bPowerOf2Textures == m_bPowerOf2PendingTextures )
+		return;
+
+	FinishTextureUploads();
+
+	const bool bResize = bPowerOf2Textures != m_bPowerOf2PendingTextures;
+
+	m_bFilterPendingTextures = bFilterTextures;
+	m_bPowerOf2PendingTextures = bPowerOf2Textures;
+
+	const int iNumTextures = GetUploadableTextureCount();
+
+	//Textures that already have power of 2 dimensions look the same either way.
+	std::vector<bool> skip( iNumTextures, true );
+
+	bool bConvert = false;
+
+	for( int iIndex = 0; iIndex < iNumTextures; ++iIndex )
+	{
+		//Deferred uploads use the new settings when they happen.
+		if( m_Textures[ iIndex ] == 0 || m_bTexturePending[ iIndex ] )
+			continue;
+
+		const mstudiotexture_t* const ptexture = m_pTextureHdr->GetTexture( iIndex );
+
+		int iWidth, iHeight;
+
+		if( bResize && graphics::CalculateImageDimensions( ptexture->width, ptexture->height, iWidth, iHeight ) &&
+			( iWidth != ptexture->width || iHeight != ptexture->height ) )
+		{
+			skip[ iIndex ] = false;
+			bConvert = true;
+		}
+		else
+		{
+			//Shared textures are changed for all models using them, which is fine since all models follow the same settings.
+			graphics::SetTextureFilter( m_Textures[ iIndex ], bFilterTextures );
+		}
+	}
+
+	if( !bConvert )
+		return;
+
+	//Converted in parallel, uploaded here since it needs GL. Each texture has its own slot.
+	std::vector<StudioRGBATexture_t> textures( iNumTextures );
+
+	ConvertTextures( bPowerOf2Textures, [ & ]( StudioRGBATexture_t& texture )
+	{
+		textures[ texture.iIndex ] = std::move( texture );
+	}, nullptr, &skip );
+
+	for( int iIndex = 0; iIndex < iNumTextures; ++iIndex )
+	{
+		if( skip[ iIndex ] || !textures[ iIndex ].pixels )
+			continue;
+
+		//Texture storage can't be resized, so the old texture is dropped.
+		ReleaseTexture( iIndex );
+
+		UploadTexture( textures[ iIndex ], bFilterTextures );
+	}
+}
+
+void CStudioModel::InvalidatePoses()
+{
+	m_uiPoseRevision = NewPoseRevision();
+}
+
+const StudioMeshBuffer_t* CStudioModel::GetMeshBuffer( const mstudiomesh_t* pMesh ) const
+{
+	auto it = m_MeshBuffers.find( pMesh );
+
+	if( it == m_MeshBuffers.end() )
+		return nullptr;
+
+	return &it->second;
+}
+
+void CStudioModel::ReportMeshStats( const char* const pszName ) const
+{
+	if( m_MeshBuffers.empty() )
+	{
+		Message( "%s: no mesh data\n", pszName );
+		return;
+	}
+
+	Message( "%s: %u meshes, %u vertices, %u triangles\n", pszName,
+		static_cast<unsigned int>( m_MeshBuffers.size() ),
+		static_cast<unsigned int>( m_MeshVertices.size() ),
+		static_cast<unsigned int>( std::accumulate( m_MeshBuffers.begin(), m_MeshBuffers.end(), size_t( 0 ),
+			[]( const size_t uiTotal, const MeshBuffers_t::value_type& buffer ) { return uiTotal + buffer.second.uiNumIndices / 3; } ) ) );
+
+	if( m_SkinVertexBuffer != 0 )
+	{
+		if( m_bCompactVertices )
+		{
+			Message( "\tSkinning vertices: compact, %u bytes (%u as floats), largest position error %.4f units, largest normal error %.3f degrees\n",
+				static_cast<unsigned int>( m_MeshVertices.size() * sizeof( StudioCompactSkinVertex_t ) ),
+				static_cast<unsigned int>( m_MeshVertices.size() * sizeof( StudioSkinVertex_t ) ),
+				m_flCompactPositionError, m_flCompactNormalError );
+		}
+		else
+		{
+			Message( "\tSkinning vertices: float, %u bytes\n", static_cast<unsigned int>( m_MeshVertices.size() * sizeof( StudioSkinVertex_t ) ) );
+		}
+	}
+
+	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+
+		const mstudiomodel_t* const pModels = ( const mstudiomodel_t* ) ( m_pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			const mstudiomodel_t& model = pModels[ iModel ];
+
+			const mstudiomesh_t* const pMeshes = ( const mstudiomesh_t* ) ( m_pStudioHdr->GetData() + model.meshindex );
+
+			for( int iMesh = 0; iMesh < model.nummesh; ++iMesh )
+			{
+				const StudioMeshBuffer_t* const pBuffer = GetMeshBuffer( &pMeshes[ iMesh ] );
+
+				if( !pBuffer )
+					continue;
+
+				char szLods[ 64 ] = {};
+
+				for( int iLod = 1; iLod < STUDIO_LOD_COUNT; ++iLod )
+				{
+					const size_t uiLength = strlen( szLods );
+
+					snprintf( szLods + uiLength, sizeof( szLods ) - uiLength, "%s%u", iLod > 1 ? "/" : "", static_cast<unsigned int>( pBuffer->GetLod( iLod ).uiNumIndices / 3 ) );
+				}
+
+				Message( "\t%s/%s mesh %d: %u vertices, %u triangles, ACMR %.3f -> %.3f, LOD triangles %s\n",
+					pbodypart->name, model.name, iMesh,
+					static_cast<unsigned int>( pBuffer->uiNumVertices ), static_cast<unsigned int>( pBuffer->uiNumIndices / 3 ),
+					pBuffer->flOriginalACMR, pBuffer->flACMR, szLods );
+			}
+		}
+	}
+}
+
+void CStudioModel::BuildEventIndex()
+{
+	m_SortedEvents.clear();
+	m_EventOffsets.clear();
+
+	m_EventOffsets.reserve( m_pStudioHdr->numseq + 1 );
+
+	m_EventOffsets.push_back( 0 );
+
+	for( int iSequence = 0; iSequence < m_pStudioHdr->numseq; ++iSequence )
+	{
+		const mstudioseqdesc_t* const pseqdesc = m_pStudioHdr->GetSequence( iSequence );
+		const mstudioevent_t* const pEvents = reinterpret_cast<const mstudioevent_t*>( m_pStudioHdr->GetData() + pseqdesc->eventindex );
+
+		const size_t uiFirst = m_SortedEvents.size();
+
+		for( int iEvent = 0; iEvent < pseqdesc->numevents; ++iEvent )
+		{
+			m_SortedEvents.push_back( iEvent );
+		}
+
+		std::stable_sort( m_SortedEvents.begin() + uiFirst, m_SortedEvents.end(),
+			[ = ]( const int lhs, const int rhs )
+			{
+				return pEvents[ lhs ].frame < pEvents[ rhs ].frame;
+			}
+		);
+
+		m_EventOffsets.push_back( m_SortedEvents.size() );
+	}
+}
+
+void CStudioModel::BuildBoneHierarchy()
+{
+	const int iNumBones = m_pStudioHdr->numbones;
+
+	const mstudiobone_t* const pbones = m_pStudioHdr->GetBones();
+
+	m_BoneOrder.clear();
+	m_BoneParents.resize( iNumBones );
+
+	m_BoneOrder.reserve( iNumBones );
+
+	for( int iBone = 0; iBone < iNumBones; ++iBone )
+	{
+		const int iParent = pbones[ iBone ].parent;
+
+		if( iParent < -1 || iParent >= iNumBones || iParent == iBone )
+		{
+			Warning( "CStudioModel::BuildBoneHierarchy: Bone \"%s\" has invalid parent %d, treating it as a root bone\n", pbones[ iBone ].name, iParent );
+			m_BoneParents[ iBone ] = -1;
+		}
+		else
+		{
+			m_BoneParents[ iBone ] = iParent;
+		}
+	}
+
+	std::vector<bool> placed( iNumBones, false );
+
+	//Compiled models store parents first, so the first pass normally places every bone in its stored order.
+	while( static_cast<int>( m_BoneOrder.size() ) < iNumBones )
+	{
+		const size_t uiPlaced = m_BoneOrder.size();
+
+		for( int iBone = 0; iBone < iNumBones; ++iBone )
+		{
+			if( !placed[ iBone ] && ( m_BoneParents[ iBone ] == -1 || placed[ m_BoneParents[ iBone ] ] ) )
+			{
+				placed[ iBone ] = true;
+				m_BoneOrder.push_back( iBone );
+			}
+		}
+
+		if( m_BoneOrder.size() == uiPlaced )
+		{
+			//Every bone that's left is part of a cycle or a child of one. Break it up at the first of them.
+			const auto it = std::find( placed.begin(), placed.end(), false );
+			const int iBone = static_cast<int>( it - placed.begin() );
+
+			Warning( "CStudioModel::BuildBoneHierarchy: Bone \"%s\" is its own ancestor, treating it as a root bone\n", pbones[ iBone ].name );
+
+			m_BoneParents[ iBone ] = -1;
+		}
+	}
+}
+
+void CStudioModel::BuildBoneBounds()
+{
+	const int iNumBones = m_pStudioHdr->numbones;
+
+	m_BoneBounds.assign( iNumBones, { glm::vec3( std::numeric_limits<float>::max() ), glm::vec3( std::numeric_limits<float>::lowest() ), false } );
+
+	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+		const mstudiomodel_t* const pModels = reinterpret_cast<const mstudiomodel_t*>( m_pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			const mstudiomodel_t& model = pModels[ iModel ];
+
+			const glm::vec3* const pstudioverts = reinterpret_cast<const glm::vec3*>( m_pStudioHdr->GetData() + model.vertindex );
+			const byte* const pvertbone = m_pStudioHdr->GetData() + model.vertinfoindex;
+
+			for( int iVert = 0; iVert < model.numverts; ++iVert )
+			{
+				if( pvertbone[ iVert ] >= iNumBones )
+					continue;
+
+				auto& bounds = m_BoneBounds[ pvertbone[ iVert ] ];
+
+				bounds.vecMins = glm::min( bounds.vecMins, pstudioverts[ iVert ] );
+				bounds.vecMaxs = glm::max( bounds.vecMaxs, pstudioverts[ iVert ] );
+				bounds.bHasVertices = true;
+			}
+		}
+	}
+}
+
+void CStudioModel::BuildTextureMeshIndex()
+{
+	m_TextureMeshes.clear();
+	m_TextureMeshOffsets.clear();
+
+	const int iNumTextures = m_pTextureHdr->numtextures;
+
+	const short* const pskinref = m_pTextureHdr->GetSkins();
+
+	//Counted first so every texture's meshes can be stored next to each other.
+	m_TextureMeshOffsets.resize( iNumTextures + 1, 0 );
+
+	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+		const mstudiomodel_t* const pModels = reinterpret_cast<const mstudiomodel_t*>( m_pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			const mstudiomesh_t* const pMeshes = reinterpret_cast<const mstudiomesh_t*>( m_pStudioHdr->GetData() + pModels[ iModel ].meshindex );
+
+			for( int iMesh = 0; iMesh < pModels[ iModel ].nummesh; ++iMesh )
+			{
+				const int iTexture = pskinref[ pMeshes[ iMesh ].skinref ];
+
+				if( iTexture >= 0 && iTexture < iNumTextures )
+					++m_TextureMeshOffsets[ iTexture + 1 ];
+			}
+		}
+	}
+
+	for( int iTexture = 0; iTexture < iNumTextures; ++iTexture )
+	{
+		m_TextureMeshOffsets[ iTexture + 1 ] += m_TextureMeshOffsets[ iTexture ];
+	}
+
+	m_TextureMeshes.resize( m_TextureMeshOffsets[ iNumTextures ] );
+
+	std::vector<size_t> nextMesh( m_TextureMeshOffsets.begin(), m_TextureMeshOffsets.end() - 1 );
+
+	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+		const mstudiomodel_t* const pModels = reinterpret_cast<const mstudiomodel_t*>( m_pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			const mstudiomesh_t* const pMeshes = reinterpret_cast<const mstudiomesh_t*>( m_pStudioHdr->GetData() + pModels[ iModel ].meshindex );
+
+			for( int iMesh = 0; iMesh < pModels[ iModel ].nummesh; ++iMesh )
+			{
+				const int iTexture = pskinref[ pMeshes[ iMesh ].skinref ];
+
+				if( iTexture >= 0 && iTexture < iNumTextures )
+					m_TextureMeshes[ nextMesh[ iTexture ]++ ] = &pMeshes[ iMesh ];
+			}
+		}
+	}
+}
+
+const mstudiomesh_t* const* CStudioModel::GetTextureMeshes( const int iTexture, size_t& uiCount ) const
+{
+	if( iTexture < 0 || static_cast<size_t>( iTexture ) + 1 >= m_TextureMeshOffsets.size() )
+	{
+		uiCount = 0;
+		return nullptr;
+	}
+
+	uiCount = m_TextureMeshOffsets[ iTexture + 1 ] - m_TextureMeshOffsets[ iTexture ];
+
+	return uiCount > 0 ? m_TextureMeshes.data() + m_TextureMeshOffsets[ iTexture ] : nullptr;
+}
+
+void CStudioModel::BuildDrawLists()
+{
+	m_DrawMeshes.clear();
+	m_DrawListOffsets.clear();
+
+	const int iNumFamilies = std::max( 1, m_pTextureHdr->numskinfamilies );
+
+	const mstudiotexture_t* const ptexture = m_pTextureHdr->GetTextures();
+
+	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+		const mstudiomodel_t* const pModels = reinterpret_cast<const mstudiomodel_t*>( m_pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			const mstudiomodel_t& model = pModels[ iModel ];
+
+			const mstudiomesh_t* const pMeshes = reinterpret_cast<const mstudiomesh_t*>( m_pStudioHdr->GetData() + model.meshindex );
+
+			m_DrawListOffsets.emplace( &model, m_DrawMeshes.size() );
+
+			for( int iFamily = 0; iFamily < iNumFamilies; ++iFamily )
+			{
+				const short* const pskinref = m_pTextureHdr->GetSkins() + iFamily * m_pTextureHdr->numskinref;
+
+				const size_t uiFirst = m_DrawMeshes.size();
+
+				for( int iMesh = 0; iMesh < model.nummesh; ++iMesh )
+				{
+					const int iTexture = pskinref[ pMeshes[ iMesh ].skinref ];
+
+					const int flags = iTexture >= 0 && iTexture < m_pTextureHdr->numtextures ? ptexture[ iTexture ].flags : 0;
+
+					m_DrawMeshes.push_back( { &pMeshes[ iMesh ], iTexture, flags } );
+				}
+
+				//Same order as the render passes, so additive meshes are drawn after solid meshes and masked meshes before them.
+				std::stable_sort( m_DrawMeshes.begin() + uiFirst, m_DrawMeshes.end(), []( const StudioDrawMesh_t& lhs, const StudioDrawMesh_t& rhs )
+				{
+					const auto getRank = []( const int flags )
+					{
+						if( flags & STUDIO_NF_ADDITIVE )
+							return 2;
+
+						return ( flags & STUDIO_NF_MASKED ) ? 0 : 1;
+					};
+
+					return getRank( lhs.flags ) < getRank( rhs.flags );
+				} );
+			}
+		}
+	}
+}
+
+const StudioDrawMesh_t* CStudioModel::GetDrawList( const mstudiomodel_t* pModel, const int iSkin, size_t& uiCount ) const
+{
+	auto it = m_DrawListOffsets.find( pModel );
+
+	if( it == m_DrawListOffsets.end() || pModel->nummesh <= 0 )
+	{
+		uiCount = 0;
+		return nullptr;
+	}
+
+	const int iFamily = iSkin > 0 && iSkin < m_pTextureHdr->numskinfamilies ? iSkin : 0;
+
+	uiCount = static_cast<size_t>( pModel->nummesh );
+
+	return m_DrawMeshes.data() + it->second + iFamily * uiCount;
+}
+
+const int* CStudioModel::GetSortedEvents( const int iSequence, size_t& uiCount ) const
+{
+	assert( iSequence >= 0 && static_cast<size_t>( iSequence ) + 1 < m_EventOffsets.size() );
+
+	uiCount = m_EventOffsets[ iSequence + 1 ] - m_EventOffsets[ iSequence ];
+
+	return m_SortedEvents.data() + m_EventOffsets[ iSequence ];
+}
+
+void CStudioModel::FindEvents( const int iSequence, const float flStart, const float flEnd, size_t& uiFirst, size_t& uiLast ) const
+{
+	size_t uiCount;
+
+	const int* const pSorted = GetSortedEvents( iSequence, uiCount );
+
+	const mstudioseqdesc_t* const pseqdesc = m_pStudioHdr->GetSequence( iSequence );
+	const mstudioevent_t* const pEvents = reinterpret_cast<const mstudioevent_t*>( m_pStudioHdr->GetData() + pseqdesc->eventindex );
+
+	auto frameBefore = [ = ]( const int iEvent, const float flFrame )
+	{
+		return pEvents[ iEvent ].frame < flFrame;
+	};
+
+	uiFirst = std::lower_bound( pSorted, pSorted + uiCount, flStart, frameBefore ) - pSorted;
+	uiLast = std::lower_bound( pSorted + uiFirst, pSorted + uiCount, flEnd, frameBefore ) - pSorted;
+}
+
+void CStudioModel::BuildMeshData()
+{
+	//Requires buffer objects; the renderer falls back to immediate mode without them.
+	if( !GLEW_VERSION_1_5 )
+		return;
+
+	if( !m_MeshBuffers.empty() )
+		return;
+
+	MeshIndices_t& indices = m_MeshIndices;
+
+	//Maps a unique vertex/normal/texcoord combination to its index in the current mesh.
+	std::unordered_map<uint64_t, GLuint> vertexMap;
+
+	const bool bOptimize = mdl_optimizemeshes.GetBool();
+
+	//Simplification grids are scaled to the size of the model, which is taken from the bounds of its first sequence.
+	float flModelSize = 0;
+
+	if( mdl_meshlods.GetBool() )
+	{
+		if( m_pStudioHdr->numseq > 0 )
+		{
+			const mstudioseqdesc_t* const pseqdesc = m_pStudioHdr->GetSequence( 0 );
+
+			flModelSize = glm::length( pseqdesc->bbmax - pseqdesc->bbmin );
+		}
+
+		if( flModelSize <= 0 )
+			flModelSize = glm::length( m_pStudioHdr->bbmax - m_pStudioHdr->bbmin );
+	}
+
+	std::vector<uint32_t> remap;
+	MeshVertices_t reorderedVertices;
+
+	for( int iBodyPart = 0; iBodyPart < m_pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+
+		const mstudiomodel_t* const pModels = ( const mstudiomodel_t* ) ( m_pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			const mstudiomodel_t& model = pModels[ iModel ];
+
+			const mstudiomesh_t* const pMeshes = ( const mstudiomesh_t* ) ( m_pStudioHdr->GetData() + model.meshindex );
+
+			for( int iMesh = 0; iMesh < model.nummesh; ++iMesh )
+			{
+				const mstudiomesh_t& mesh = pMeshes[ iMesh ];
+
+				StudioMeshBuffer_t buffer;
+
+				buffer.pModel = &model;
+				buffer.uiFirstVertex = m_MeshVertices.size();
+				buffer.uiFirstIndex = indices.size();
+
+				vertexMap.clear();
+
+				auto addVertex = [ & ]( const short* ptricmd ) -> GLuint
+				{
+					const uint64_t key =
+						( static_cast<uint64_t>( static_cast<uint16_t>( ptricmd[ 0 ] ) ) << 48 ) |
+						( static_cast<uint64_t>( static_cast<uint16_t>( ptricmd[ 1 ] ) ) << 32 ) |
+						( static_cast<uint64_t>( static_cast<uint16_t>( ptricmd[ 2 ] ) ) << 16 ) |
+						static_cast<uint64_t>( static_cast<uint16_t>( ptricmd[ 3 ] ) );
+
+					auto result = vertexMap.emplace( key, static_cast<GLuint>( m_MeshVertices.size() - buffer.uiFirstVertex ) );
+
+					if( result.second )
+					{
+						m_MeshVertices.push_back( { ptricmd[ 0 ], ptricmd[ 1 ], ptricmd[ 2 ], ptricmd[ 3 ] } );
+					}
+
+					return result.first->second;
+				};
+
+				auto ptricmds = ( const short* ) ( m_pStudioHdr->GetData() + mesh.triindex );
+
+				int i;
+
+				while( i = *( ptricmds++ ) )
+				{
+					const bool bIsFan = i < 0;
+
+					if( bIsFan )
+						i = -i;
+
+					const short* const pFirst = ptricmds;
+
+					for( int iVert = 2; iVert < i; ++iVert )
+					{
+						const short* const pPrev = ptricmds + ( iVert - 1 ) * 4;
+						const short* const pCurrent = ptricmds + iVert * 4;
+
+						if( bIsFan )
+						{
+							indices.push_back( addVertex( pFirst ) );
+							indices.push_back( addVertex( pPrev ) );
+							indices.push_back( addVertex( pCurrent ) );
+						}
+						else
+						{
+							const short* const pPrev2 = ptricmds + ( iVert - 2 ) * 4;
+
+							//Every other strip triangle has reversed winding.
+							if( iVert % 2 )
+							{
+								indices.push_back( addVertex( pPrev ) );
+								indices.push_back( addVertex( pPrev2 ) );
+							}
+							else
+							{
+								indices.push_back( addVertex( pPrev2 ) );
+								indices.push_back( addVertex( pPrev ) );
+							}
+
+							indices.push_back( addVertex( pCurrent ) );
+						}
+					}
+
+					ptricmds += i * 4;
+				}
+
+				buffer.uiNumVertices = m_MeshVertices.size() - buffer.uiFirstVertex;
+				buffer.uiNumIndices = indices.size() - buffer.uiFirstIndex;
+
+				uint32_t* const pMeshIndices = reinterpret_cast<uint32_t*>( indices.data() + buffer.uiFirstIndex );
+
+				buffer.flOriginalACMR = graphics::CalculateACMR( pMeshIndices, buffer.uiNumIndices, buffer.uiNumVertices );
+
+				if( bOptimize )
+				{
+					graphics::OptimizeVertexCache( pMeshIndices, buffer.uiNumIndices, buffer.uiNumVertices );
+
+					//Store the vertices in the order they're first used so they're fetched sequentially.
+					remap.resize( buffer.uiNumVertices );
+
+					graphics::OptimizeVertexFetch( pMeshIndices, buffer.uiNumIndices, buffer.uiNumVertices, remap.data() );
+
+					reorderedVertices.resize( buffer.uiNumVertices );
+
+					for( size_t uiVertex = 0; uiVertex < buffer.uiNumVertices; ++uiVertex )
+					{
+						reorderedVertices[ remap[ uiVertex ] ] = m_MeshVertices[ buffer.uiFirstVertex + uiVertex ];
+					}
+
+					std::copy( reorderedVertices.begin(), reorderedVertices.end(), m_MeshVertices.begin() + buffer.uiFirstVertex );
+
+					buffer.flACMR = graphics::CalculateACMR( pMeshIndices, buffer.uiNumIndices, buffer.uiNumVertices );
+				}
+				else
+				{
+					buffer.flACMR = buffer.flOriginalACMR;
+				}
+
+				BuildMeshLods( model, buffer, flModelSize );
+
+				m_MeshBuffers.emplace( &mesh, buffer );
+			}
+		}
+	}
+}
+
+void CStudioModel::BuildMeshLods( const mstudiomodel_t& model, StudioMeshBuffer_t& buffer, const float flModelSize )
+{
+	StudioMeshLod_t previous{ buffer.uiFirstIndex, buffer.uiNumIndices };
+
+	for( auto& lod : buffer.lods )
+	{
+		lod = previous;
+	}
+
+	if( flModelSize <= 0 || buffer.uiNumIndices == 0 )
+		return;
+
+	auto pstudioverts = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + model.vertindex );
+	auto pvertbone = ( const byte* ) ( m_pStudioHdr->GetData() + model.vertinfoindex );
+	auto pnormbone = ( const byte* ) ( m_pStudioHdr->GetData() + model.norminfoindex );
+
+	std::vector<glm::vec3> positions( buffer.uiNumVertices );
+	std::vector<uint32_t> groups( buffer.uiNumVertices );
+
+	for( size_t uiVertex = 0; uiVertex < buffer.uiNumVertices; ++uiVertex )
+	{
+		const StudioMeshVertex_t& vertex = m_MeshVertices[ buffer.uiFirstVertex + uiVertex ];
+
+		//Vertices are in the space of the bone they're attached to, and only vertices attached to the same bones can be merged.
+		//This keeps every vertex's bone, so simplified meshes animate the same way.
+		positions[ uiVertex ] = pstudioverts[ vertex.vertindex ];
+		groups[ uiVertex ] = pvertbone[ vertex.vertindex ] | ( pnormbone[ vertex.normindex ] << 8 );
+	}
+
+	//Copied since adding levels to the index list can reallocate it.
+	const std::vector<uint32_t> fullIndices( m_MeshIndices.begin() + buffer.uiFirstIndex, m_MeshIndices.begin() + buffer.uiFirstIndex + buffer.uiNumIndices );
+
+	std::vector<uint32_t> lodIndices( fullIndices.size() );
+
+	for( int iLod = 1; iLod < STUDIO_LOD_COUNT; ++iLod )
+	{
+		StudioMeshLod_t& lod = buffer.lods[ iLod - 1 ];
+
+		const size_t uiCount = graphics::SimplifyByClustering( fullIndices.data(), fullIndices.size(), positions.data(), groups.data(), positions.size(),
+			flModelSize * LOD_CELL_SIZES[ iLod - 1 ], lodIndices.data() );
+
+		//Meshes are never simplified away entirely, and levels that barely remove anything aren't worth the memory.
+		if( uiCount > 0 && uiCount <= previous.uiNumIndices * LOD_MAX_TRIANGLE_FRACTION )
+		{
+			lod.uiFirstIndex = m_MeshIndices.size();
+			lod.uiNumIndices = uiCount;
+
+			m_MeshIndices.insert( m_MeshIndices.end(), lodIndices.begin(), lodIndices.begin() + uiCount );
+		}
+		else
+		{
+			lod = previous;
+		}
+
+		previous = lod;
+	}
+}
+
+void CStudioModel::CreateMeshBuffers()
+{
+	if( !GLEW_VERSION_1_5 )
+		return;
+
+	BuildMeshData();
+
+	if( m_MeshIndices.empty() )
+		return;
+
+	glGenBuffers( 1, &m_IndexBuffer );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, m_MeshIndices.size() * sizeof( GLuint ), m_MeshIndices.data(), GL_STATIC_DRAW );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	MeshIndices_t().swap( m_MeshIndices );
+
+	glGenBuffers( 1, &m_SkinVertexBuffer );
+
+	std::vector<StudioSkinVertex_t> vertices( m_MeshVertices.size() );
+
+	for( const auto& meshBuffer : m_MeshBuffers )
+	{
+		const StudioMeshBuffer_t& buffer = meshBuffer.second;
+
+		FillSkinVertices( buffer, &vertices[ buffer.uiFirstVertex ] );
+	}
+
+	m_bCompactVertices = UseCompactVertices();
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_SkinVertexBuffer );
+
+	if( m_bCompactVertices )
+	{
+		m_VertexQuantization.clear();
+		m_flCompactPositionError = 0;
+		m_flCompactNormalError = 0;
+
+		std::vector<StudioCompactSkinVertex_t> compactVertices( vertices.size() );
+
+		for( const auto& meshBuffer : m_MeshBuffers )
+		{
+			const StudioMeshBuffer_t& buffer = meshBuffer.second;
+
+			//Meshes of a submodel share its quantization, so they line up where they meet.
+			if( m_VertexQuantization.find( buffer.pModel ) == m_VertexQuantization.end() )
+				m_VertexQuantization.emplace( buffer.pModel, ComputeVertexQuantization( *buffer.pModel ) );
+
+			CompactSkinVertices( buffer, &vertices[ buffer.uiFirstVertex ], &compactVertices[ buffer.uiFirstVertex ] );
+		}
+
+		glBufferData( GL_ARRAY_BUFFER, compactVertices.size() * sizeof( StudioCompactSkinVertex_t ), compactVertices.data(), GL_STATIC_DRAW );
+	}
+	else
+	{
+		glBufferData( GL_ARRAY_BUFFER, vertices.size() * sizeof( StudioSkinVertex_t ), vertices.data(), GL_STATIC_DRAW );
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+void CStudioModel::FillSkinVertices( const StudioMeshBuffer_t& buffer, StudioSkinVertex_t* pOut ) const
+{
+	auto pstudioverts = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + buffer.pModel->vertindex );
+	auto pvertbone = ( const byte* ) ( m_pStudioHdr->GetData() + buffer.pModel->vertinfoindex );
+	auto pstudionorms = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + buffer.pModel->normindex );
+	auto pnormbone = ( const byte* ) ( m_pStudioHdr->GetData() + buffer.pModel->norminfoindex );
+
+	for( size_t uiIndex = 0; uiIndex < buffer.uiNumVertices; ++uiIndex )
+	{
+		const StudioMeshVertex_t& meshVertex = m_MeshVertices[ buffer.uiFirstVertex + uiIndex ];
+
+		StudioSkinVertex_t& vertex = pOut[ uiIndex ];
+
+		vertex.vecPosition = pstudioverts[ meshVertex.vertindex ];
+		vertex.flBone = pvertbone[ meshVertex.vertindex ];
+		vertex.vecNormal = pstudionorms[ meshVertex.normindex ];
+		vertex.flNormalBone = pnormbone[ meshVertex.normindex ];
+		vertex.vecTexCoord = glm::vec2( meshVertex.s, meshVertex.t );
+	}
+}
+
+StudioVertexQuantization_t CStudioModel::ComputeVertexQuantization( const mstudiomodel_t& model ) const
+{
+	StudioVertexQuantization_t quantization;
+
+	if( model.numverts <= 0 )
+		return quantization;
+
+	auto pstudioverts = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + model.vertindex );
+
+	glm::vec3 vecMins = pstudioverts[ 0 ];
+	glm::vec3 vecMaxs = pstudioverts[ 0 ];
+
+	for( int iVertex = 1; iVertex < model.numverts; ++iVertex )
+	{
+		vecMins = glm::min( vecMins, pstudioverts[ iVertex ] );
+		vecMaxs = glm::max( vecMaxs, pstudioverts[ iVertex ] );
+	}
+
+	//The bounds map to -SNORM16_MAX to SNORM16_MAX. Flat submodels still need a scale that isn't 0.
+	quantization.vecOrigin = ( vecMins + vecMaxs ) * 0.5f;
+	quantization.vecScale = glm::max( ( vecMaxs - vecMins ) * ( 0.5f / SNORM16_MAX ), glm::vec3( std::numeric_limits<float>::min() ) );
+
+	return quantization;
+}
+
+void CStudioModel::CompactSkinVertices( const StudioMeshBuffer_t& buffer, const StudioSkinVertex_t* pIn, StudioCompactSkinVertex_t* pOut )
+{
+	const StudioVertexQuantization_t& quantization = GetVertexQuantization( buffer.pModel );
+
+	for( size_t uiIndex = 0; uiIndex < buffer.uiNumVertices; ++uiIndex )
+	{
+		const StudioSkinVertex_t& vertex = pIn[ uiIndex ];
+
+		StudioCompactSkinVertex_t& compact = pOut[ uiIndex ];
+
+		const glm::vec3 vecQuantized = ( vertex.vecPosition - quantization.vecOrigin ) / quantization.vecScale;
+
+		for( int iAxis = 0; iAxis < 3; ++iAxis )
+		{
+			compact.iPosition[ iAxis ] = static_cast<int16_t>( std::round( glm::clamp( vecQuantized[ iAxis ], -SNORM16_MAX, SNORM16_MAX ) ) );
+		}
+
+		compact.iBone = static_cast<int16_t>( vertex.flBone );
+		compact.iNormalBone = static_cast<int16_t>( vertex.flNormalBone );
+
+		EncodeOctahedral( vertex.vecNormal, compact.iNormal );
+
+		compact.iPadding = 0;
+		compact.iTexCoord[ 0 ] = static_cast<int16_t>( vertex.vecTexCoord.x );
+		compact.iTexCoord[ 1 ] = static_cast<int16_t>( vertex.vecTexCoord.y );
+
+		//Compare against what the float path draws.
+		const glm::vec3 vecPosition = glm::vec3( compact.iPosition[ 0 ], compact.iPosition[ 1 ], compact.iPosition[ 2 ] ) * quantization.vecScale + quantization.vecOrigin;
+
+		m_flCompactPositionError = std::max( m_flCompactPositionError, glm::length( vecPosition - vertex.vecPosition ) );
+
+		if( glm::dot( vertex.vecNormal, vertex.vecNormal ) > 0 )
+		{
+			const float flCos = glm::clamp( glm::dot( DecodeOctahedral( compact.iNormal ), glm::normalize( vertex.vecNormal ) ), -1.0f, 1.0f );
+
+			m_flCompactNormalError = std::max( m_flCompactNormalError, glm::degrees( std::acos( flCos ) ) );
+		}
+	}
+}
+
+void CStudioModel::UploadSkinVertices( const StudioMeshBuffer_t& buffer, std::vector<StudioSkinVertex_t>& vertices, std::vector<StudioCompactSkinVertex_t>& compactVertices )
+{
+	vertices.resize( buffer.uiNumVertices );
+
+	FillSkinVertices( buffer, vertices.data() );
+
+	if( m_bCompactVertices )
+	{
+		compactVertices.resize( buffer.uiNumVertices );
+
+		CompactSkinVertices( buffer, vertices.data(), compactVertices.data() );
+
+		glBufferSubData( GL_ARRAY_BUFFER, buffer.uiFirstVertex * sizeof( StudioCompactSkinVertex_t ), compactVertices.size() * sizeof( StudioCompactSkinVertex_t ), compactVertices.data() );
+	}
+	else
+	{
+		glBufferSubData( GL_ARRAY_BUFFER, buffer.uiFirstVertex * sizeof( StudioSkinVertex_t ), vertices.size() * sizeof( StudioSkinVertex_t ), vertices.data() );
+	}
+}
+
+const StudioVertexQuantization_t& CStudioModel::GetVertexQuantization( const mstudiomodel_t* pModel ) const
+{
+	static const StudioVertexQuantization_t IDENTITY;
+
+	auto it = m_VertexQuantization.find( pModel );
+
+	return it != m_VertexQuantization.end() ? it->second : IDENTITY;
+}
+
+void CStudioModel::MarkVerticesDirty( const mstudiomodel_t* pModel )
+{
+	assert( pModel );
+
+	//Nothing to reupload without a buffer.
+	if( m_SkinVertexBuffer != 0 )
+		m_DirtyVertexModels.insert( pModel );
+}
+
+void CStudioModel::UpdateSkinVertexBuffer()
+{
+	if( m_SkinVertexBuffer == 0 || m_DirtyVertexModels.empty() )
+		return;
+
+	std::vector<StudioSkinVertex_t> vertices;
+	std::vector<StudioCompactSkinVertex_t> compactVertices;
+
+	//Edited vertices can move out of the submodel's old bounds.
+	if( m_bCompactVertices )
+	{
+		for( auto pModel : m_DirtyVertexModels )
+		{
+			auto it = m_VertexQuantization.find( pModel );
+
+			if( it != m_VertexQuantization.end() )
+				it->second = ComputeVertexQuantization( *pModel );
+		}
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_SkinVertexBuffer );
+
+	//Meshes have their own range of the buffer, so only the ranges of changed submodels are written.
+	for( const auto& meshBuffer : m_MeshBuffers )
+	{
+		const StudioMeshBuffer_t& buffer = meshBuffer.second;
+
+		if( buffer.uiNumVertices == 0 || m_DirtyVertexModels.find( buffer.pModel ) == m_DirtyVertexModels.end() )
+			continue;
+
+		UploadSkinVertices( buffer, vertices, compactVertices );
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	m_DirtyVertexModels.clear();
+}
+
+namespace
+{
+/**
+*	Loads a single studio header.
+*	@param pszFilename Name of the file to load.
+*	@param bAllowSeqGroup Whether the file may be a sequence group.
+*	@param pOutStudioHdr If the header was loaded, set to the header.
+*	@param mappedFile If the file was mapped into memory, set to the mapped file, which owns the header. Otherwise the header was allocated with new[].
+*/
+StudioModelLoadResult LoadStudioHeader( const char* const pszFilename, const bool bAllowSeqGroup, studiohdr_t*& pOutStudioHdr, std::unique_ptr<CMappedFile>& mappedFile,
+										std::future<filesystem::CFileData>* pPendingRead, size_t* pOutSize )
+{
+	mem::UniqueArray<byte> buffer;
+	std::unique_ptr<CMappedFile> file;
+
+	size_t size = 0;
+
+	//Mapping the file only reads the pages that are actually used, and avoids keeping a second copy of the file in memory.
+	if( mdl_mapfiles.GetBool() )
+	{
+		file = std::make_unique<CMappedFile>();
+
+		if( file->Open( pszFilename ) )
+		{
+			size = file->GetSize();
+		}
+		else
+		{
+			file.reset();
+		}
+	}
+
+	if( !file )
+	{
+		// load the model
+		//Models are modified after loading, so the file's data is copied. This also finds models that are in archives.
+		filesystem::CFileData data;
+
+		if( pPendingRead && pPendingRead->valid() )
+		{
+			data = pPendingRead->get();
+
+			if( !data.IsValid() )
+				return StudioModelLoadResult::FAILURE;
+		}
+		else if( !engine::ReadFile( pszFilename, data ) )
+		{
+			return StudioModelLoadResult::FAILURE;
+		}
+
+		size = data.GetSize();
+
+		buffer = mem::AllocateArray<byte>( size, mem::Tag::STUDIO_MODEL );
+
+		memcpy( buffer.get(), data.GetData(), size );
+	}
+
+	studiohdr_t* pStudioHdr = reinterpret_cast<studiohdr_t*>( file ? file->GetData() : buffer.get() );
+
+	if( !pStudioHdr || size < sizeof( studioseqhdr_t ) )
+		return StudioModelLoadResult::FAILURE;
+
+	if( strncmp( reinterpret_cast<const char*>( &pStudioHdr->id ), STUDIOMDL_HDR_ID, 4 ) &&
+		strncmp( reinterpret_cast<const char*>( &pStudioHdr->id ), STUDIOMDL_SEQ_ID, 4 ) )
+	{
+		return StudioModelLoadResult::FAILURE;
+	}
+
+	if( !bAllowSeqGroup && !strncmp( reinterpret_cast<const char*>( &pStudioHdr->id ), STUDIOMDL_SEQ_ID, 4 ) )
+	{
+		return StudioModelLoadResult::FAILURE;
+	}
+
+	if( pStudioHdr->version != STUDIO_VERSION )
+	{
+		return StudioModelLoadResult::VERSIONDIFFERS;
+	}
+
+	pOutStudioHdr = pStudioHdr;
+
+	if( pOutSize )
+		*pOutSize = size;
+
+	buffer.release();
+	mappedFile = std::move( file );
+
+	return StudioModelLoadResult::SUCCESS;
+}
+
+void ReportValidationIssues( const char* const pszFilename, const std::vector<std::string>& issues )
+{
+	Error( "Model \"%s\" failed validation:\n", pszFilename );
+
+	for( const auto& szIssue : issues )
+	{
+		Error( "\t%s\n", szIssue.c_str() );
+	}
+}
+}
+
+StudioModelLoadResult LoadStudioModelFiles( const char* const pszFilename, CStudioModel*& pModel )
+{
+	const auto bIsDol = std::experimental::filesystem::path( pszFilename ).extension() == ".dol";
+
+	//Takes care of cleanup on failure.
+	std::unique_ptr<CStudioModel> studioModel( new CStudioModel() );
+
+	std::unique_ptr<CMappedFile> mappedFile;
+
+	//Load the model
+	size_t uiModelSize = 0;
+
+	StudioModelLoadResult result = LoadStudioHeader( pszFilename, false, studioModel->m_pStudioHdr, mappedFile, nullptr, &uiModelSize );
+
+	if( mappedFile )
+		studioModel->m_MappedFiles.push_back( std::move( mappedFile ) );
+
+	if( result != StudioModelLoadResult::SUCCESS )
+	{
+		return result;
+	}
+
+	studioModel->m_szFilename = pszFilename;
+	studioModel->m_szTextureFilename = pszFilename;
+	studioModel->m_bIsDol = bIsDol;
+
+	const bool bValidate = mdl_validate.GetBool();
+
+	std::vector<std::string> issues;
+
+	//Everything after this reads the header's tables, including the prefetch thread.
+	if( bValidate && !ValidateStudioHeader( *studioModel->m_pStudioHdr, uiModelSize, bIsDol, &issues ) )
+	{
+		ReportValidationIssues( pszFilename, issues );
+		return StudioModelLoadResult::FAILURE;
+	}
+
+	//Set before the prefetch thread starts loading groups.
+	studioModel->m_bValidateSeqGroups = bValidate;
+
+	const bool bPrefetchSeqGroups = studioModel->m_pStudioHdr->numseqgroups > 1 && mdl_prefetchseqgroups.GetBool();
+
+	//Start reading sequence groups now so they're read at the same time as the texture model.
+	if( bPrefetchSeqGroups )
+		studioModel->PrefetchSequenceGroups();
+
+	// preload textures
+	if( studioModel->m_pStudioHdr->numtextures == 0 )
+	{
+		const auto extension = bIsDol ? "T.dol" : "T.mdl";
+
+		char texturename[ MAX_PATH_LENGTH ];
+
+		strcpy( texturename, pszFilename );
+		strcpy( &texturename[ strlen( texturename ) - 4 ], extension );
+
+		std::future<filesystem::CFileData> textureRead;
+
+		if( bPrefetchSeqGroups && !mdl_mapfiles.GetBool() )
+			textureRead = engine::ReadFileAsync( texturename );
+
+		size_t uiTextureSize = 0;
+
+		result = LoadStudioHeader( texturename, true, studioModel->m_pTextureHdr, mappedFile, &textureRead, &uiTextureSize );
+
+		if( mappedFile )
+		{
+			//The prefetch thread can be adding sequence group files.
+			std::lock_guard<std::mutex> lock( studioModel->m_SeqGroupMutex );
+
+			studioModel->m_MappedFiles.push_back( std::move( mappedFile ) );
+		}
+
+		if( result != StudioModelLoadResult::SUCCESS )
+		{
+			return result;
+		}
+
+		if( bValidate && !ValidateStudioHeader( *studioModel->m_pTextureHdr, uiTextureSize, bIsDol, &issues ) )
+		{
+			ReportValidationIssues( texturename, issues );
+			return StudioModelLoadResult::FAILURE;
+		}
+
+		studioModel->m_szTextureFilename = texturename;
+	}
+	else
+	{
+		studioModel->m_pTextureHdr = studioModel->m_pStudioHdr;
+	}
+
+	if( bValidate )
+	{
+		if( !ValidateSkinReferences( *studioModel->m_pStudioHdr, *studioModel->m_pTextureHdr, &issues ) )
+		{
+			ReportValidationIssues( pszFilename, issues );
+			return StudioModelLoadResult::FAILURE;
+		}
+
+		studioModel->m_bValidated = true;
+		studioModel->m_View = CStudioModelView( studioModel.get(), studioModel->m_pStudioHdr, studioModel->m_pTextureHdr );
+	}
+
+	//Sequence groups are loaded when they're first used, so only make sure they exist here.
+	if( studioModel->m_pStudioHdr->numseqgroups > 1 )
+	{
+		char seqgroupname[ MAX_PATH_LENGTH ];
+
+		for( int i = 1; i < studioModel->m_pStudioHdr->numseqgroups; ++i )
+		{
+			if( !GetSequenceGroupFilename( pszFilename, i, bIsDol, seqgroupname, sizeof( seqgroupname ) ) )
+				return StudioModelLoadResult::FAILURE;
+
+			if( !std::experimental::filesystem::exists( seqgroupname ) )
+				return StudioModelLoadResult::FAILURE;
+		}
+	}
+
+	//Dol textures are converted once when loading, so everything else only has to deal with the mdl format.
+	if( bIsDol )
+	{
+		studiohdr_t* const pTextureHdr = studioModel->m_pTextureHdr;
+
+		//Each texture only touches its own data.
+		RunTextureBatch( static_cast<size_t>( studioModel->GetUploadableTextureCount() ),
+			[ = ]( const size_t uiIndex )
+			{
+				ConvertDolToMdl( pTextureHdr->GetData(), pTextureHdr->GetTextures()[ uiIndex ] );
+			}
+		);
 	}
 
-	memset( m_pSeqHdrs + uiNumSeqHdrs, 0, sizeof( studiohdr_t* ) * MAX_SEQGROUPS - uiNumSeqHdrs );
+	studioModel->BuildEventIndex();
+	studioModel->BuildBoneHierarchy();
+	studioModel->BuildBoneBounds();
+	studioModel->BuildTextureMeshIndex();
+	studioModel->BuildDrawLists();
+
+	//Sequence groups are added as they're loaded, which the prefetch thread may already be doing.
+	studioModel->m_HeaderMemory.SetName( pszFilename );
+	studioModel->m_HeaderMemory.AddBytes( studioModel->m_pStudioHdr->length +
+		( studioModel->m_pTextureHdr != studioModel->m_pStudioHdr ? studioModel->m_pTextureHdr->length : 0 ) );
+
+	studioModel->m_TextureMemory.SetName( pszFilename );
+
+	pModel = studioModel.release();
 
-	memcpy( m_Textures, pTextureHdr, uiNumTextures );
-	memset( m_Textures + uiNumTextures, 0, sizeof( GLuint ) * MAX_TEXTURES - uiNumTextures );
+	return StudioModelLoadResult::SUCCESS;
 }
 
-CStudioModel::~CStudioModel()
+void GetTextureLoadSettings( bool& bOutFilterTextures, bool& bOutPowerOf2Textures )
 {
-	if( !m_pStudioHdr )
-		return;
+	bOutFilterTextures = r_filtertextures.GetBool();
+	bOutPowerOf2Textures = r_powerof2textures.GetBool();
+}
 
-	// deleting textures
-	glDeleteTextures( m_pTextureHdr->numtextures, m_Textures );
+bool UseDeferredTextureUploads()
+{
+	return mdl_deferredtextures.GetBool() && !mdl_compacttextures.GetBool();
+}
 
-	for( auto pSeqHdr : m_pSeqHdrs )
-	{
-		delete[] pSeqHdr;
-	}
+bool UseMeshOptimization()
+{
+	return mdl_optimizemeshes.GetBool();
+}
 
-	//Textures were in a T.mdl, free separately.
-	if( m_pTextureHdr != m_pStudioHdr )
-	{
-		delete[] m_pTextureHdr;
-	}
+bool UseMeshLods()
+{
+	return mdl_meshlods.GetBool();
+}
 
-	delete[] m_pStudioHdr;
+bool UseCompactVertices()
+{
+	return mdl_compactvertices.GetBool();
 }
 
-mstudioanim_t* CStudioModel::GetAnim( mstudioseqdesc_t* pseqdesc ) const
+void CompactStudioModelTextures( CStudioModel& model, const char* const pszName )
 {
-	mstudioseqgroup_t* pseqgroup = m_pStudioHdr->GetSequenceGroup( pseqdesc->seqgroup );
+	if( !mdl_compacttextures.GetBool() )
+		return;
 
-	if( pseqdesc->seqgroup == 0 )
+	const size_t uiReleased = model.CompactTextures();
+
+	if( uiReleased > 0 )
 	{
-		return ( mstudioanim_t * ) ( ( byte * ) m_pStudioHdr + pseqgroup->unused2 + pseqdesc->animindex );
+		Message( "Compacted model \"%s\": released %.1f KiB of texture pixels, %.1f KiB resident\n",
+				 pszName, uiReleased / 1024.0, model.GetResidentSize() / 1024.0 );
 	}
-
-	return ( mstudioanim_t * ) ( ( byte * ) m_pSeqHdrs[ pseqdesc->seqgroup ] + pseqdesc->animindex );
 }
 
-mstudiomodel_t* CStudioModel::GetModelByBodyPart( const int iBody, const int iBodyPart ) const
+StudioModelLoadResult LoadStudioModel( const char* const pszFilename, CStudioModel*& pModel )
 {
-	mstudiobodyparts_t* pbodypart = m_pStudioHdr->GetBodypart( iBodyPart );
+	TRACE_SCOPE( "LoadStudioModel" );
 
-	int index = iBody / pbodypart->base;
-	index = index % pbodypart->nummodels;
+	CStudioModel* pLoadedModel;
 
-	return ( mstudiomodel_t * ) ( ( byte * ) m_pStudioHdr + pbodypart->modelindex ) + index;
-}
+	const StudioModelLoadResult result = LoadStudioModelFiles( pszFilename, pLoadedModel );
 
-bool CStudioModel::CalculateBodygroup( const int iGroup, const int iValue, int& iInOutBodygroup ) const
-{
-	if( iGroup > m_pStudioHdr->numbodyparts )
-		return false;
+	if( result != StudioModelLoadResult::SUCCESS )
+		return result;
 
-	const mstudiobodyparts_t* const pbodypart = m_pStudioHdr->GetBodypart( iGroup );
+	//Takes care of cleanup on failure.
+	std::unique_ptr<CStudioModel> studioModel( pLoadedModel );
 
-	int iCurrent = ( iInOutBodygroup / pbodypart->base ) % pbodypart->nummodels;
+	bool bFilterTextures, bPowerOf2Textures;
 
-	if( iValue >= pbodypart->nummodels )
-		return true;
+	GetTextureLoadSettings( bFilterTextures, bPowerOf2Textures );
 
-	iInOutBodygroup = ( iInOutBodygroup - ( iCurrent * pbodypart->base ) + ( iValue * pbodypart->base ) );
+	//Evicted textures are restored with the settings they were loaded with.
+	studioModel->m_bFilterPendingTextures = bFilterTextures;
+	studioModel->m_bPowerOf2PendingTextures = bPowerOf2Textures;
 
-	return true;
-}
+	const bool bUseDiskCache = UseStudioModelDiskCache();
 
-GLuint CStudioModel::GetTextureId( const int iIndex ) const
-{
-	const studiohdr_t* const pHdr = GetTextureHeader();
+	const uint64_t uiHash = bUseDiskCache ? HashStudioModel( *studioModel ) : 0;
 
-	if( !pHdr )
-		return GL_INVALID_TEXTURE_ID;
+	const std::string szCacheDirectory = bUseDiskCache ? GetStudioModelCacheDirectory() : std::string();
 
-	if( iIndex < 0 || iIndex >= pHdr->numtextures )
-		return GL_INVALID_TEXTURE_ID;
+	std::vector<StudioRGBATexture_t> textures;
 
-	return m_Textures[ iIndex ];
-}
+	TRACE_SCOPE( "UploadTextures" );
+	PERF_SCOPE( "UploadTextures" );
 
-void CStudioModel::ReplaceTexture( mstudiotexture_t* ptexture, byte *data, byte *pal, GLuint textureId )
-{
-	glDeleteTextures( 1, &textureId );
+	//This is called on the main thread, so another process that is preparing the same model isn't waited for.
+	if( bUseDiskCache && LoadStudioModelCache( *studioModel, szCacheDirectory, uiHash, bPowerOf2Textures, false, textures ) )
+	{
+		//Cached textures are already converted, so there's nothing to be gained by deferring them.
+		for( auto& texture : textures )
+		{
+			studioModel->QueueTextureUpload( std::move( texture ), bFilterTextures );
+		}
+	}
+	//Cache entries need every texture, so they can't be deferred when the cache is used.
+	else if( UseDeferredTextureUploads() && !bUseDiskCache )
+	{
+		studioModel->ReserveTextures( bFilterTextures, bPowerOf2Textures );
+	}
+	else
+	{
+		//Convert on the pool, then upload on this thread since it owns the GL context.
+		textures.resize( static_cast<size_t>( studioModel->GetUploadableTextureCount() ) );
 
-	UploadTexture( ptexture, data, pal, textureId, r_filtertextures.GetBool(), r_powerof2textures.GetBool() );
-}
+		studioModel->ConvertTextures( bPowerOf2Textures,
+			[ & ]( StudioRGBATexture_t& texture )
+			{
+				textures[ texture.iIndex ] = std::move( texture );
+			}
+		);
 
-void CStudioModel::ReuploadTexture( mstudiotexture_t* ptexture )
-{
-	assert( ptexture );
+		if( bUseDiskCache )
+		{
+			studioModel->BuildMeshData();
+			SaveStudioModelCache( *studioModel, szCacheDirectory, uiHash, bPowerOf2Textures, textures );
+		}
 
-	const int iIndex = ptexture - m_pTextureHdr->GetTextures();
+		for( auto& texture : textures )
+		{
+			studioModel->QueueTextureUpload( std::move( texture ), bFilterTextures );
+		}
+	}
 
-	if( iIndex < 0 || iIndex >= m_pTextureHdr->numtextures )
 	{
-		Error( "CStudioModel::ReuploadTexture: Invalid texture!" );
-		return;
+		TRACE_SCOPE( "CreateMeshBuffers" );
+		studioModel->CreateMeshBuffers();
 	}
 
-	GLuint textureId = m_Textures[ iIndex ];
+	if( mdl_compacttextures.GetBool() )
+	{
+		//Pixels can only be released once the upload thread is done with them.
+		studioModel->FinishTextureUploads();
 
-	glDeleteTextures( 1, &textureId );
+		CompactStudioModelTextures( *studioModel, pszFilename );
+	}
 
-	UploadTexture( ptexture, 
-				   m_pTextureHdr->GetData() + ptexture->index, 
-				   m_pTextureHdr->GetData() + ptexture->index + ptexture->width * ptexture->height, textureId, r_filtertextures.GetBool(), r_powerof2textures.GetBool() );
+	pModel = studioModel.release();
+
+	return StudioModelLoadResult::SUCCESS;
 }
 
 namespace
 {
 /**
-*	Loads a single studio header.
+*	A file written by SaveStudioModel.
+*/
+struct SavePart_t
+{
+	std::string szFilename;
+	std::string szTempFilename;
+	std::string szBackupFilename;
+
+	const byte* pData;
+	size_t uiSize;
+
+	/**
+	*	Whether the file on disk already has this data, so it doesn't need to be written.
+	*/
+	bool bUnchanged = false;
+
+	bool bWritten = false;
+
+	/**
+	*	Whether the file existed before, and was moved to the backup filename while parts are committed.
+	*/
+	bool bBackedUp = false;
+
+	/**
+	*	Whether the temporary file has been renamed to the final filename.
+	*/
+	bool bCommitted = false;
+};
+
+/**
+*	@return Whether the given file exists and contains exactly the given data.
 */
-StudioModelLoadResult LoadStudioHeader( const char* const pszFilename, const bool bAllowSeqGroup, studiohdr_t*& pOutStudioHdr )
+bool IsFileEqual( const std::string& szFilename, const byte* pData, const size_t uiSize )
 {
-	// load the model
-	FILE* pFile = fopen( pszFilename, "rb" );
+	std::error_code error;
+
+	const auto uiFileSize = std::experimental::filesystem::file_size( szFilename, error );
+
+	//Checking the size first means files that changed size are never read.
+	if( error || uiFileSize != uiSize )
+		return false;
+
+	FILE* pFile = fopen( szFilename.c_str(), "rb" );
 
 	if( !pFile )
-		return StudioModelLoadResult::FAILURE;
+		return false;
 
-	fseek( pFile, 0, SEEK_END );
-	const size_t size = ftell( pFile );
-	fseek( pFile, 0, SEEK_SET );
+	byte buffer[ 64 * 1024 ];
 
-	std::unique_ptr<byte[]> buffer( new byte[ size ] );
+	size_t uiOffset = 0;
 
-	studiohdr_t* pStudioHdr = reinterpret_cast<studiohdr_t*>( buffer.get() );
+	bool bEqual = true;
 
-	if( !pStudioHdr )
+	while( bEqual && uiOffset < uiSize )
 	{
-		fclose( pFile );
-		return StudioModelLoadResult::FAILURE;
+		const size_t uiRead = fread( buffer, 1, std::min( sizeof( buffer ), uiSize - uiOffset ), pFile );
+
+		bEqual = uiRead > 0 && memcmp( buffer, pData + uiOffset, uiRead ) == 0;
+
+		uiOffset += uiRead;
 	}
 
-	const size_t uiRead = fread( pStudioHdr, size, 1, pFile );
 	fclose( pFile );
 
-	if( uiRead != 1 )
-		return StudioModelLoadResult::FAILURE;
+	return bEqual;
+}
 
-	if( strncmp( reinterpret_cast<const char*>( &pStudioHdr->id ), STUDIOMDL_HDR_ID, 4 ) &&
-		strncmp( reinterpret_cast<const char*>( &pStudioHdr->id ), STUDIOMDL_SEQ_ID, 4 ) )
+/**
+*	Writes a part to its temporary file, unless the file on disk is already up to date.
+*/
+bool WriteSavePart( SavePart_t& part )
+{
+	if( IsFileEqual( part.szFilename, part.pData, part.uiSize ) )
 	{
-		return StudioModelLoadResult::FAILURE;
+		part.bUnchanged = true;
+		return true;
 	}
 
-	if( !bAllowSeqGroup && !strncmp( reinterpret_cast<const char*>( &pStudioHdr->id ), STUDIOMDL_SEQ_ID, 4 ) )
+	FILE* pFile = fopen( part.szTempFilename.c_str(), "wb" );
+
+	if( !pFile )
 	{
-		return StudioModelLoadResult::FAILURE;
+		Error( "SaveStudioModel: Couldn't open \"%s\" for writing\n", part.szTempFilename.c_str() );
+		return false;
 	}
 
-	if( pStudioHdr->version != STUDIO_VERSION )
+	bool bSuccess = fwrite( part.pData, sizeof( byte ), part.uiSize, pFile ) == part.uiSize;
+
+	//Errors can be reported when buffered data is flushed on close.
+	bSuccess = fclose( pFile ) == 0 && bSuccess;
+
+	if( !bSuccess )
 	{
-		return StudioModelLoadResult::VERSIONDIFFERS;
+		Error( "SaveStudioModel: Couldn't write \"%s\"\n", part.szTempFilename.c_str() );
+		return false;
 	}
 
-	pOutStudioHdr = pStudioHdr;
-
-	buffer.release();
+	part.bWritten = true;
 
-	return StudioModelLoadResult::SUCCESS;
-}
+	return true;
 }
 
-StudioModelLoadResult LoadStudioModel( const char* const pszFilename, CStudioModel*& pModel )
+/**
+*	Replaces the parts' files with their temporary files. Existing files are moved aside first, and put back if any part can't be committed,
+*	so the files on disk are either all old or all new.
+*/
+bool CommitSaveParts( std::vector<SavePart_t>& parts )
 {
-	const auto bIsDol = std::experimental::filesystem::path( pszFilename ).extension() == ".dol";
-
-	//Takes care of cleanup on failure.
-	std::unique_ptr<CStudioModel> studioModel( new CStudioModel() );
+	std::error_code error;
 
-	//Load the model
-	StudioModelLoadResult result = LoadStudioHeader( pszFilename, false, studioModel->m_pStudioHdr );
+	bool bSuccess = true;
 
-	if( result != StudioModelLoadResult::SUCCESS )
+	for( auto& part : parts )
 	{
-		return result;
-	}
+		if( !part.bWritten )
+			continue;
 
-	// preload textures
-	if( studioModel->m_pStudioHdr->numtextures == 0 )
-	{
-		const auto extension = bIsDol ? "T.dol" : "T.mdl";
+		//Renaming doesn't replace existing files on all platforms.
+		if( std::experimental::filesystem::exists( part.szFilename, error ) )
+		{
+			std::experimental::filesystem::remove( part.szBackupFilename, error );
+			std::experimental::filesystem::rename( part.szFilename, part.szBackupFilename, error );
 
-		char texturename[ MAX_PATH_LENGTH ];
+			if( error )
+			{
+				Error( "SaveStudioModel: Couldn't move \"%s\" aside\n", part.szFilename.c_str() );
+				bSuccess = false;
+				break;
+			}
 
-		strcpy( texturename, pszFilename );
-		strcpy( &texturename[ strlen( texturename ) - 4 ], extension );
+			part.bBackedUp = true;
+		}
 
-		result = LoadStudioHeader( texturename, true, studioModel->m_pTextureHdr );
+		std::experimental::filesystem::rename( part.szTempFilename, part.szFilename, error );
 
-		if( result != StudioModelLoadResult::SUCCESS )
+		if( error )
 		{
-			return result;
+			Error( "SaveStudioModel: Couldn't rename \"%s\" to \"%s\"\n", part.szTempFilename.c_str(), part.szFilename.c_str() );
+			bSuccess = false;
+			break;
 		}
-	}
-	else
-	{
-		studioModel->m_pTextureHdr = studioModel->m_pStudioHdr;
+
+		part.bCommitted = true;
 	}
 
-	// preload animations
-	if( studioModel->m_pStudioHdr->numseqgroups > 1 )
+	for( auto& part : parts )
 	{
-		char seqgroupname[ MAX_PATH_LENGTH ];
-
-		for( int i = 1; i < studioModel->m_pStudioHdr->numseqgroups; ++i )
+		if( bSuccess )
 		{
-			const auto suffix = bIsDol ? "%02d.dol" : "%02d.mdl";
+			if( part.bBackedUp )
+				std::experimental::filesystem::remove( part.szBackupFilename, error );
 
-			strcpy( seqgroupname, pszFilename );
+			continue;
+		}
 
-			if( !PrintfSuccess( snprintf( &seqgroupname[ strlen( seqgroupname ) - 4 ], sizeof( seqgroupname ), suffix, i ), sizeof( seqgroupname ) ) )
-				return StudioModelLoadResult::FAILURE;
+		//Roll back to the old set of files.
+		if( part.bCommitted )
+			std::experimental::filesystem::remove( part.szFilename, error );
 
-			result = LoadStudioHeader( seqgroupname, true, studioModel->m_pSeqHdrs[ i ] );
+		if( part.bBackedUp )
+			std::experimental::filesystem::rename( part.szBackupFilename, part.szFilename, error );
 
-			if( result != StudioModelLoadResult::SUCCESS )
-			{
-				return result;
-			}
-		}
+		if( part.bWritten && !part.bCommitted )
+			std::experimental::filesystem::remove( part.szTempFilename, error );
 	}
 
-	UploadTextures( *studioModel->m_pTextureHdr, studioModel->m_Textures, r_filtertextures.GetBool(), r_powerof2textures.GetBool(), bIsDol );
-
-	pModel = studioModel.release();
-
-	return StudioModelLoadResult::SUCCESS;
+	return bSuccess;
+}
 }
 
 bool SaveStudioModel( const char* const pszFilename, const CStudioModel* const pModel )
@@ -507,110 +2768,125 @@ bool SaveStudioModel( const char* const pszFilename, const CStudioModel* const p
 	if( !pModel )
 		return false;
 
-	FILE* pFile = fopen( pszFilename, "wb" );
+	TRACE_SCOPE( "SaveStudioModel" );
 
-	if( !pFile )
+	if( !pModel->EnsureTexturePixels() )
 		return false;
 
-	const studiohdr_t* const pStudioHdr = pModel->GetStudioHeader();
-
-	bool bSuccess = fwrite( pStudioHdr, sizeof( byte ), pStudioHdr->length, pFile ) == pStudioHdr->length;
-
-	fclose( pFile );
+	//Sequence groups are saved over the files they would be loaded from, so they all have to be loaded first.
+	if( !pModel->LoadAllSequenceGroups() )
+	{
+		Error( "SaveStudioModel: Couldn't load all sequence groups\n" );
+		return false;
+	}
 
-	if( !bSuccess )
+	//The model may be saved over the files it was mapped from. Those files can't be replaced while they're still backing the model's data.
+	if( !pModel->DetachMappedFiles() )
 	{
+		Error( "SaveStudioModel: Couldn't detach model data from its files\n" );
 		return false;
 	}
 
+	const studiohdr_t* const pStudioHdr = pModel->GetStudioHeader();
 	const studiohdr_t* const pTextureHdr = pModel->GetTextureHeader();
 
-	// write texture model
-	if( pTextureHdr != pStudioHdr )
-	{
-		char texturename[ MAX_PATH_LENGTH ];
+	const std::string szBaseName( pszFilename, strlen( pszFilename ) - std::min<size_t>( strlen( pszFilename ), 4 ) );
 
-		strcpy( texturename, pszFilename );
-		strcpy( &texturename[ strlen( texturename ) - 4 ], "T.mdl" );
+	std::vector<SavePart_t> parts;
 
-		pFile = fopen( texturename, "wb" );
+	auto addPart = [ & ]( std::string&& szFilename, const void* pHeader, const int iLength )
+	{
+		SavePart_t part;
 
-		if( !pFile )
-			return false;
+		part.szTempFilename = szFilename + ".tmp";
+		part.szBackupFilename = szFilename + ".bak";
+		part.szFilename = std::move( szFilename );
+		part.pData = reinterpret_cast<const byte*>( pHeader );
+		part.uiSize = static_cast<size_t>( iLength );
 
-		bSuccess = fwrite( pTextureHdr, sizeof( byte ), pTextureHdr->length, pFile ) == pTextureHdr->length;
-		fclose( pFile );
+		parts.emplace_back( std::move( part ) );
+	};
 
-		if( !bSuccess )
-		{
-			return false;
-		}
-	}
+	addPart( pszFilename, pStudioHdr, pStudioHdr->length );
+
+	// write texture model
+	if( pTextureHdr != pStudioHdr )
+		addPart( szBaseName + "T.mdl", pTextureHdr, pTextureHdr->length );
 
 	// write seq groups
-	if( pStudioHdr->numseqgroups > 1 )
+	for( int i = 1; i < pStudioHdr->numseqgroups; i++ )
 	{
-		char seqgroupname[ MAX_PATH_LENGTH ];
+		char szSuffix[ 16 ];
 
-		for( int i = 1; i < pStudioHdr->numseqgroups; i++ )
-		{
-			strcpy( seqgroupname, pszFilename );
-			sprintf( &seqgroupname[ strlen( seqgroupname ) - 4 ], "%02d.mdl", i );
+		snprintf( szSuffix, sizeof( szSuffix ), "%02d.mdl", i );
 
-			pFile = fopen( seqgroupname, "wb" );
+		const auto pAnimHdr = pModel->GetSeqGroupHeader( i );
 
-			if( !pFile )
-				return false;
+		addPart( szBaseName + szSuffix, pAnimHdr, pAnimHdr->length );
+	}
 
-			const auto pAnimHdr = pModel->GetSeqGroupHeader( i );
+	//Parts are independent, so they're compared and written at the same time. This hides most of the latency of slow disks and network shares.
+	std::unique_ptr<bool[]> results( new bool[ parts.size() ] );
 
-			bSuccess = fwrite( pAnimHdr, sizeof( byte ), pAnimHdr->length, pFile ) == pAnimHdr->length;
-			fclose( pFile );
+	tasks::ParallelFor( parts.size(), [ & ]( const size_t uiIndex )
+	{
+		results[ uiIndex ] = WriteSavePart( parts[ uiIndex ] );
+	}, 1, "SaveStudioModelPart" );
 
-			if( !bSuccess )
-			{
-				return false;
-			}
+	const bool bWritten = std::all_of( results.get(), results.get() + parts.size(), []( const bool bResult ) { return bResult; } );
+
+	if( !bWritten )
+	{
+		std::error_code error;
+
+		for( const auto& part : parts )
+		{
+			if( part.bWritten )
+				std::experimental::filesystem::remove( part.szTempFilename, error );
 		}
+
+		return false;
 	}
 
-	return true;
+	return CommitSaveParts( parts );
 }
 
 void ScaleMeshes( CStudioModel* pStudioModel, const float flScale )
 {
 	assert( pStudioModel );
 
+	TRACE_SCOPE( "ScaleMeshes" );
+
 	auto pStudioHdr = pStudioModel->GetStudioHeader();
 
-	int iBodygroup = 0;
+	//Every submodel is scaled, so there is no need to go through bodygroups to find them.
+	std::vector<mstudiomodel_t*> models;
+
+	//Submodels that share vertices must only be scaled once.
+	std::unordered_set<int> vertexBlocks;
 
-	// scale verts
 	for( int i = 0; i < pStudioHdr->numbodyparts; i++ )
 	{
-		mstudiobodyparts_t *pbodypart = pStudioHdr->GetBodypart( i );
-		for( int j = 0; j < pbodypart->nummodels; j++ )
-		{
-			pStudioModel->CalculateBodygroup( i, j, iBodygroup );
+		mstudiobodyparts_t* const pbodypart = pStudioHdr->GetBodypart( i );
 
-			int bodypart = i;
+		mstudiomodel_t* const pModels = ( mstudiomodel_t* ) ( ( byte* ) pStudioHdr + pbodypart->modelindex );
 
-			if( bodypart > pStudioHdr->numbodyparts )
-			{
-				// Message( "studiomdl::ScaleMeshes: no such bodypart %d\n", bodypart );
-				bodypart = 0;
-			}
+		for( int j = 0; j < pbodypart->nummodels; j++ )
+		{
+			if( pModels[ j ].numverts > 0 && vertexBlocks.insert( pModels[ j ].vertindex ).second )
+				models.push_back( &pModels[ j ] );
+		}
+	}
 
-			mstudiomodel_t* pModel = pStudioModel->GetModelByBodyPart( iBodygroup, bodypart );
+	const bool bUseSIMD = AreSIMDKernelsSupported();
 
-			glm::vec3 *pstudioverts = ( glm::vec3 * )( ( byte * ) pStudioHdr + pModel->vertindex );
+	// scale verts
+	tasks::ParallelFor( models.size(), [ & ]( const size_t uiIndex )
+	{
+		mstudiomodel_t* const pModel = models[ uiIndex ];
 
-			for( int k = 0; k < pModel->numverts; k++ )
-			{
-				pstudioverts[ k ] *= flScale;
-			}
-		}
-	}
+		ScaleVectors( bUseSIMD, ( glm::vec3* ) ( ( byte* ) pStudioHdr + pModel->vertindex ), pModel->numverts, flScale );
+	}, 1, "ScaleMeshes" );
 
 	// scale complex hitboxes
 	mstudiobbox_t *pbboxes = pStudioHdr->GetHitBoxes();
@@ -621,6 +2897,14 @@ void ScaleMeshes( CStudioModel* pStudioModel, const float flScale )
 		pbboxes[ i ].bbmax *= flScale;
 	}
 
+	// scale attachments, which are offsets from their bone like vertices
+	mstudioattachment_t* const pattachments = pStudioHdr->GetAttachments();
+
+	for( int i = 0; i < pStudioHdr->numattachments; i++ )
+	{
+		pattachments[ i ].org *= flScale;
+	}
+
 	// scale bounding boxes
 	mstudioseqdesc_t *pseqdesc = pStudioHdr->GetSequences();
 
@@ -630,7 +2914,24 @@ void ScaleMeshes( CStudioModel* pStudioModel, const float flScale )
 		pseqdesc[ i ].bbmax *= flScale;
 	}
 
-	// maybe scale exeposition, pivots, attachments
+	pStudioHdr->eyeposition *= flScale;
+	pStudioHdr->min *= flScale;
+	pStudioHdr->max *= flScale;
+	pStudioHdr->bbmin *= flScale;
+	pStudioHdr->bbmax *= flScale;
+
+	//Only vertex positions changed; indices, normals and textures stay as they are.
+	for( auto pModel : models )
+	{
+		pStudioModel->MarkVerticesDirty( pModel );
+	}
+
+	pStudioModel->UpdateSkinVertexBuffer();
+
+	pStudioModel->BuildBoneBounds();
+
+	//Poses store bounds computed from the vertices.
+	pStudioModel->InvalidatePoses();
 }
 
 void ScaleBones( CStudioModel* pStudioModel, const float flScale )
@@ -649,6 +2950,23 @@ void ScaleBones( CStudioModel* pStudioModel, const float flScale )
 			pbones[ i ].scale[ j ] *= flScale;
 		}
 	}
+
+	mstudioseqdesc_t* const pseqdesc = pStudioHdr->GetSequences();
+
+	for( int i = 0; i < pStudioHdr->numseq; i++ )
+	{
+		pseqdesc[ i ].linearmovement *= flScale;
+
+		mstudiopivot_t* const ppivots = ( mstudiopivot_t* ) ( ( byte* ) pStudioHdr + pseqdesc[ i ].pivotindex );
+
+		for( int j = 0; j < pseqdesc[ i ].numpivots; j++ )
+		{
+			ppivots[ j ].org *= flScale;
+		}
+	}
+
+	//Bones are part of the pose, so nothing else has to be updated.
+	pStudioModel->InvalidatePoses();
 }
 
 const char* ControlToString( const int iControl )
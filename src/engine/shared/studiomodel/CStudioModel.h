@@ -1,19 +1,41 @@
 #ifndef GAME_STUDIOMODEL_CSTUDIOMODEL_H
 #define GAME_STUDIOMODEL_CSTUDIOMODEL_H
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include "shared/Allocator.h"
 #include "shared/Const.h"
+#include "shared/MemoryStats.h"
 
 #include "utility/mathlib.h"
+#include "utility/CMappedFile.h"
 #include "utility/Color.h"
 
 #include "graphics/OpenGL.h"
 
+#include "filesystem/CFileData.h"
+
+#include "engine/shared/renderer/IRenderContext.h"
+
 #include "studio.h"
 
+#include "CStudioAnimCache.h"
+#include "CStudioModelView.h"
+
 namespace studiomdl
 {
 enum class StudioModelLoadResult
@@ -26,6 +48,227 @@ enum class StudioModelLoadResult
 
 class CStudioModel;
 
+/**
+*	A single vertex in a mesh's retained triangle list.
+*	References the model's vertex and normal arrays, and stores the unnormalized texture coordinates.
+*/
+struct StudioMeshVertex_t
+{
+	short vertindex;
+	short normindex;
+	short s;
+	short t;
+};
+
+/**
+*	Vertex in the model's static skinning buffer. Stores the model space position and the index of the bone it's attached to,
+*	as well as the model space normal, its bone and the unscaled texture coordinates.
+*/
+struct StudioSkinVertex_t
+{
+	glm::vec3 vecPosition;
+	float flBone;
+
+	glm::vec3 vecNormal;
+	float flNormalBone;
+
+	glm::vec2 vecTexCoord;
+};
+
+/**
+*	Compact vertex in the model's static skinning buffer, used instead of StudioSkinVertex_t if mdl_compactvertices was enabled when the buffer was created.
+*	Positions are 16 bit integers relative to the bounds of their submodel, see StudioVertexQuantization_t.
+*	Normals are octahedral encoded, with -32767 to 32767 mapping to -1 to 1. Texture coordinates are the unscaled 16 bit coordinates, so they are exact.
+*	Bone indices are 16 bit since the vertex array pointers that these are drawn with don't accept bytes.
+*	The normal's bone comes first so it's in the same component of texture coordinate 1 as it is for StudioSkinVertex_t.
+*/
+struct StudioCompactSkinVertex_t
+{
+	int16_t iPosition[ 3 ];
+	int16_t iBone;
+
+	int16_t iNormalBone;
+	int16_t iNormal[ 2 ];
+	int16_t iPadding;
+
+	int16_t iTexCoord[ 2 ];
+};
+
+static_assert( sizeof( StudioCompactSkinVertex_t ) == 20, "Compact vertices must be tightly packed" );
+
+/**
+*	Maps the integer positions of a submodel's compact vertices back to model space: position = integer * vecScale + vecOrigin.
+*	The default maps positions to themselves, which is what the float format uses.
+*/
+struct StudioVertexQuantization_t
+{
+	glm::vec3 vecScale{ 1.0f };
+	glm::vec3 vecOrigin{ 0.0f };
+};
+
+/**
+*	A mesh in a submodel's draw list, with the texture it uses in the list's skin family.
+*/
+struct StudioDrawMesh_t
+{
+	const mstudiomesh_t* pMesh;
+
+	/**
+	*	Index of the texture in the texture header.
+	*/
+	int iTexture;
+
+	/**
+	*	Flags of the texture.
+	*/
+	int flags;
+};
+
+/**
+*	Number of detail levels of each mesh, including the full detail triangle list.
+*/
+const int STUDIO_LOD_COUNT = 3;
+
+/**
+*	Range of a mesh's triangle list in the model's index buffer.
+*/
+struct StudioMeshLod_t
+{
+	size_t uiFirstIndex;
+	size_t uiNumIndices;
+};
+
+/**
+*	Retained triangle list for a single mesh. Built from the mesh's tricmds when the model is loaded.
+*	Vertices are unique within a mesh, and are stored in the order the triangles first use them.
+*/
+struct StudioMeshBuffer_t
+{
+	/**
+	*	Model that this mesh belongs to.
+	*/
+	const mstudiomodel_t* pModel;
+
+	/**
+	*	Index of the first vertex in the model's mesh vertex list.
+	*/
+	size_t uiFirstVertex;
+	size_t uiNumVertices;
+
+	/**
+	*	Index of the first index in the model's index buffer. Indices are relative to uiFirstVertex.
+	*/
+	size_t uiFirstIndex;
+	size_t uiNumIndices;
+
+	/**
+	*	Average cache miss ratio of the triangle list as converted from the tricmds, and as it's drawn.
+	*	These are the same if meshes weren't optimized.
+	*/
+	float flOriginalACMR;
+	float flACMR;
+
+	/**
+	*	Simplified triangle lists, from most to least detailed. They use the same vertices as the full detail list.
+	*	Levels that couldn't be simplified any further have the same range as the level before them.
+	*/
+	StudioMeshLod_t lods[ STUDIO_LOD_COUNT - 1 ];
+
+	/**
+	*	@return The triangle list of the given detail level. Level 0 is the full detail list.
+	*/
+	StudioMeshLod_t GetLod( const int iLod ) const
+	{
+		if( iLod <= 0 )
+			return { uiFirstIndex, uiNumIndices };
+
+		return lods[ ( iLod < STUDIO_LOD_COUNT ? iLod : STUDIO_LOD_COUNT - 1 ) - 1 ];
+	}
+};
+
+/**
+*	Bounds of the vertices attached to a bone, in the bone's reference frame.
+*/
+struct StudioBoneBounds_t
+{
+	glm::vec3 vecMins;
+	glm::vec3 vecMaxs;
+
+	/**
+	*	Whether any vertices are attached to the bone. If not, the bounds are meaningless.
+	*/
+	bool bHasVertices;
+};
+
+/**
+*	A texture that has been converted to RGBA and is ready to be uploaded.
+*/
+struct StudioRGBATexture_t
+{
+	/**
+	*	Index of the texture in the model.
+	*/
+	int iIndex = 0;
+
+	int iWidth = 0;
+	int iHeight = 0;
+
+	/**
+	*	Hash of the source texture, used to share identical textures between models. 0 if it hasn't been computed.
+	*/
+	uint64_t uiHash = 0;
+
+	/**
+	*	Converted pixels, or null if the texture couldn't be converted.
+	*/
+	mem::UniqueArray<byte> pixels;
+};
+
+/**
+*	Loads the files of a studio model without uploading anything. Textures must be converted and uploaded, and mesh buffers created, before the model can be drawn.
+*	Does not use GL, so this can be called from any thread.
+*	@param pszFilename Name of the model to load. This is the entire path, including the extension.
+*	@param pModel The model, if it was successfully loaded in.
+*	@return StudioModelLoadResult::SUCCESS on success, an error code in all other cases.
+*	@see CStudioModelLoader
+*/
+StudioModelLoadResult LoadStudioModelFiles( const char* const pszFilename, CStudioModel*& pModel );
+
+/**
+*	Gets the settings that models are currently loaded with.
+*	@param bOutFilterTextures Whether textures are filtered.
+*	@param bOutPowerOf2Textures Whether textures are resized to power of 2 dimensions.
+*/
+void GetTextureLoadSettings( bool& bOutFilterTextures, bool& bOutPowerOf2Textures );
+
+/**
+*	@return Whether textures should be uploaded the first time they're used instead of when the model is loaded.
+*	Never true while textures are compacted, since that needs every texture to be uploaded.
+*/
+bool UseDeferredTextureUploads();
+
+/**
+*	@return Whether triangle lists are reordered for the vertex cache when meshes are converted.
+*/
+bool UseMeshOptimization();
+
+/**
+*	@return Whether simplified detail levels are built when meshes are converted.
+*/
+bool UseMeshLods();
+
+/**
+*	@return Whether skinning vertex buffers are created with StudioCompactSkinVertex_t instead of StudioSkinVertex_t.
+*/
+bool UseCompactVertices();
+
+/**
+*	If mdl_compacttextures is enabled, releases the texture pixels of a model whose textures have all been uploaded,
+*	and reports how much memory the model still uses.
+*	@param pszName Name of the model, used in the report.
+*/
+void CompactStudioModelTextures( CStudioModel& model, const char* const pszName );
+
 /**
 *	Loads a studio model.
 *	@param pszFilename Name of the model to load. This is the entire path, including the extension.
@@ -45,14 +288,23 @@ bool SaveStudioModel( const char* const pszFilename, const CStudioModel* const p
 /**
 *	Container representing a studiomodel and its data.
 */
-class CStudioModel final
+class CStudioModel final : public renderer::ITextureSource
 {
 private:
-	typedef std::vector<const mstudiomesh_t*> MeshList_t;
-	typedef std::vector<MeshList_t> TextureMeshMap_t;
+	typedef std::vector<StudioMeshVertex_t> MeshVertices_t;
+	typedef std::unordered_map<const mstudiomesh_t*, StudioMeshBuffer_t> MeshBuffers_t;
+	typedef std::vector<GLuint> MeshIndices_t;
+
+	typedef std::vector<std::unique_ptr<CMappedFile>> MappedFiles_t;
 
 protected:
+	friend StudioModelLoadResult LoadStudioModelFiles( const char* const pszFilename, CStudioModel*& pModel );
 	friend StudioModelLoadResult LoadStudioModel( const char* const pszFilename, CStudioModel*& pModel );
+	friend class CStudioModelLoader;
+	friend class CStudioModelView;
+	friend bool SaveStudioModel( const char* const pszFilename, const CStudioModel* const pModel );
+	friend bool LoadStudioModelCache( CStudioModel& model, const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2, const bool bWait, std::vector<StudioRGBATexture_t>& textures );
+	friend bool SaveStudioModelCache( const CStudioModel& model, const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2, const std::vector<StudioRGBATexture_t>& textures );
 
 public:
 	static const size_t MAX_SEQGROUPS = 32;
@@ -65,14 +317,57 @@ public:
 
 	studiohdr_t*	GetStudioHeader() const { return m_pStudioHdr; }
 	studiohdr_t*	GetTextureHeader() const { return m_pTextureHdr; }
-	studiohdr_t*	GetSeqGroupHeader( const size_t i ) const { return m_pSeqHdrs[ i ]; }
+	/**
+	*	Gets a sequence group header. Sequence groups are loaded on first use. Thread safe.
+	*	@param i Index of the sequence group. Group 0 is stored in the main header and has no header of its own.
+	*	@return The header, or null if the group couldn't be loaded.
+	*/
+	studiohdr_t*	GetSeqGroupHeader( const size_t i ) const;
 
-	mstudioanim_t*	GetAnim( mstudioseqdesc_t* pseqdesc ) const;
+	/**
+	*	@return Whether the model passed validation when it was loaded. Only models loaded from files with mdl_validate enabled are validated.
+	*/
+	bool			IsValidated() const { return m_bValidated; }
 
+	/**
+	*	@return Unchecked accessors for the model, or null if it wasn't validated. Use this in code that accesses the model often.
+	*/
+	const CStudioModelView* GetValidatedView() const { return m_bValidated ? &m_View : nullptr; }
+
+	/**
+	*	Models that weren't validated check the sequence's offsets first.
+	*	@return The animation data for a sequence, or null if its sequence group couldn't be loaded or the data is outside it.
+	*/
+	mstudioanim_t*	GetAnim( const mstudioseqdesc_t* pseqdesc ) const;
+
+	/**
+	*	Starts loading all sequence groups that haven't been loaded yet on a background thread.
+	*	Unless files are mapped, all groups are read at the same time.
+	*	Does nothing if a prefetch was already started.
+	*/
+	void PrefetchSequenceGroups();
+
+	/**
+	*	Gets the decoded animation data for a sequence blend. The data is decoded on first use, and cached within the r_animcachebudget memory budget.
+	*	Thread safe.
+	*	@param pseqdesc Sequence.
+	*	@param panim Animation data for the first bone of the blend.
+	*	@return Decoded animation, or null if the cache is disabled or the animation does not fit in the budget.
+	*/
+	std::shared_ptr<const CDecodedAnim> GetDecodedAnim( const mstudioseqdesc_t* pseqdesc, const mstudioanim_t* panim );
+
+	/**
+	*	Models that weren't validated check the body part and its models first.
+	*	@return The submodel selected by a bodygroup value, or null if the body part doesn't exist or is invalid.
+	*/
 	mstudiomodel_t* GetModelByBodyPart( const int iBody, const int iBodyPart ) const;
 
 	bool			CalculateBodygroup( const int iGroup, const int iValue, int& iInOutBodygroup ) const;
 
+	/**
+	*	Gets the GL texture for a texture. If the texture's upload was deferred, it is converted and uploaded now.
+	*	Must be called on the GL thread.
+	*/
 	GLuint			GetTextureId( const int iIndex ) const;
 
 	void			ReplaceTexture( mstudiotexture_t* ptexture, byte *data, byte *pal, GLuint textureId );
@@ -83,20 +378,543 @@ public:
 	*/
 	void ReuploadTexture( mstudiotexture_t* ptexture );
 
+	/**
+	*	Applies new texture settings to the model's uploaded textures. Deferred and evicted textures use them when they're uploaded.
+	*	Filter changes only change texture parameters. Power of 2 changes only convert and upload textures whose size changes.
+	*	Must be called on the GL thread.
+	*/
+	void ApplyTextureSettings( const bool bFilterTextures, const bool bPowerOf2Textures );
+
+	/**
+	*	Converts an evicted texture from the model's indexed data and uploads it again.
+	*/
+	bool RestoreTexture( renderer::HTexture_t hTexture ) override;
+
+	/**
+	*	@return The buffer object containing the indices of all retained meshes, or 0 if no buffers were created.
+	*/
+	GLuint GetIndexBuffer() const { return m_IndexBuffer; }
+
+	/**
+	*	@return The buffer object containing a skinning vertex for every retained mesh vertex, or 0 if no buffers were created.
+	*	@see HasCompactVertices
+	*/
+	GLuint GetSkinVertexBuffer() const { return m_SkinVertexBuffer; }
+
+	/**
+	*	@return Whether the skinning vertex buffer contains StudioCompactSkinVertex_t instead of StudioSkinVertex_t.
+	*/
+	bool HasCompactVertices() const { return m_bCompactVertices; }
+
+	/**
+	*	@return Size of a vertex in the skinning vertex buffer.
+	*/
+	size_t GetSkinVertexSize() const { return m_bCompactVertices ? sizeof( StudioCompactSkinVertex_t ) : sizeof( StudioSkinVertex_t ); }
+
+	/**
+	*	@return How the positions of a submodel's skinning vertices map to model space. Identity if the vertices aren't compact.
+	*/
+	const StudioVertexQuantization_t& GetVertexQuantization( const mstudiomodel_t* pModel ) const;
+
+	/**
+	*	Gets the largest error of the compact skinning vertices compared to the float vertices they were made from. Both are 0 if vertices aren't compact.
+	*	@param flPositionError Largest distance between a compact position and the original position, in model units.
+	*	@param flNormalError Largest angle between a compact normal and the original normal, in degrees.
+	*/
+	void GetCompactVertexError( float& flPositionError, float& flNormalError ) const
+	{
+		flPositionError = m_flCompactPositionError;
+		flNormalError = m_flCompactNormalError;
+	}
+
+	/**
+	*	Marks the skinning vertices of a submodel as out of date. Must be called after the submodel's vertices or normals have been changed.
+	*	@param pModel Submodel that was changed. Must be part of this model.
+	*/
+	void MarkVerticesDirty( const mstudiomodel_t* pModel );
+
+	/**
+	*	Reuploads the skinning vertices of submodels that were marked dirty, in place.
+	*/
+	void UpdateSkinVertexBuffer();
+
+	/**
+	*	@return The vertices of all retained meshes.
+	*/
+	const StudioMeshVertex_t* GetMeshVertices() const { return m_MeshVertices.data(); }
+
+	/**
+	*	Gets the retained triangle list for the given mesh.
+	*	@param pMesh Mesh to get the buffer for. Must be part of this model.
+	*	@return The mesh buffer, or null if the mesh has no retained data.
+	*/
+	const StudioMeshBuffer_t* GetMeshBuffer( const mstudiomesh_t* pMesh ) const;
+
+	/**
+	*	Prints the size and average cache miss ratio of every mesh's triangle list.
+	*	@param pszName Name to print the statistics under.
+	*/
+	void ReportMeshStats( const char* const pszName ) const;
+
+	/**
+	*	@return Revision of the data used to set up bones. Poses set up for another revision are out of date.
+	*	Revisions are unique among all models in the process, so a model that is allocated where a freed model was never matches its poses.
+	*/
+	unsigned int GetPoseRevision() const { return m_uiPoseRevision; }
+
+	/**
+	*	Marks all poses of this model as out of date. Must be called after data used to set up bones has been changed.
+	*/
+	void InvalidatePoses();
+
+	/**
+	*	Sorts the events of every sequence by frame, so the events in a range of frames can be found with a binary search.
+	*	Done when the model is loaded. Must be called again after events have been changed.
+	*/
+	void BuildEventIndex();
+
+	/**
+	*	Gets the events of a sequence sorted by frame. Events on the same frame are kept in the order they're stored in.
+	*	@param iSequence Sequence index.
+	*	@param uiCount Number of events.
+	*	@return Indices into the sequence's event array.
+	*/
+	const int* GetSortedEvents( const int iSequence, size_t& uiCount ) const;
+
+	/**
+	*	Finds the events of a sequence whose frame is in the range [ flStart, flEnd ).
+	*	@param iSequence Sequence index.
+	*	@param flStart Start of the range.
+	*	@param flEnd End of the range.
+	*	@param uiFirst Position of the first event in the list returned by GetSortedEvents.
+	*	@param uiLast Position after the last event.
+	*/
+	void FindEvents( const int iSequence, const float flStart, const float flEnd, size_t& uiFirst, size_t& uiLast ) const;
+
+	/**
+	*	Validates the bone hierarchy and sorts the bones so every bone comes after its parent.
+	*	Done when the model is loaded. Must be called again after bone parents have been changed.
+	*/
+	void BuildBoneHierarchy();
+
+	/**
+	*	@return Bone indices sorted so every bone comes after its parent. Has one entry for each bone.
+	*/
+	const int* GetBoneOrder() const { return m_BoneOrder.data(); }
+
+	/**
+	*	@return The parent of each bone, or -1 for root bones. Invalid parents and cycles in the file are broken up into root bones.
+	*/
+	const int* GetBoneParents() const { return m_BoneParents.data(); }
+
+	/**
+	*	Computes the bounds of the vertices attached to each bone, over all submodels.
+	*	Done when the model is loaded. Must be called again after vertices have been changed.
+	*/
+	void BuildBoneBounds();
+
+	/**
+	*	@return The bounds of the vertices attached to each bone. Has one entry for each bone.
+	*/
+	const StudioBoneBounds_t* GetBoneBounds() const { return m_BoneBounds.data(); }
+
+	/**
+	*	Builds the list of meshes that use each texture in the default skin.
+	*	Done when the model is loaded. Must be called again after the skin references of meshes have been changed.
+	*/
+	void BuildTextureMeshIndex();
+
+	/**
+	*	Gets the meshes of every bodypart and submodel that use a texture in the default skin, in the order they're stored in.
+	*	@param iTexture Texture index.
+	*	@param uiCount Number of meshes.
+	*	@return Meshes using the texture. Null if there are none or the index is out of range.
+	*/
+	const mstudiomesh_t* const* GetTextureMeshes( const int iTexture, size_t& uiCount ) const;
+
+	/**
+	*	Builds the draw list of every submodel in every skin family.
+	*	Done when the model is loaded. Must be called again after the flags of textures or the skin references of meshes have been changed.
+	*/
+	void BuildDrawLists();
+
+	/**
+	*	Gets the meshes of a submodel in the order they're drawn: masked meshes first, then solid meshes, then additive meshes.
+	*	Meshes with the same render mode are in the order they're stored in.
+	*	@param pModel Submodel of this model.
+	*	@param iSkin Skin family. Invalid families use the default skin, like the game does.
+	*	@param uiCount Number of meshes.
+	*	@return Meshes of the submodel, or null if it has none or isn't part of this model.
+	*/
+	const StudioDrawMesh_t* GetDrawList( const mstudiomodel_t* pModel, const int iSkin, size_t& uiCount ) const;
+
+	/**
+	*	@return The number of textures in the texture header that can be uploaded.
+	*/
+	int GetUploadableTextureCount() const;
+
+	/**
+	*	Converts a texture to RGBA. Does not use GL, so this can be called from any thread, as long as the texture's data isn't used elsewhere at the same time.
+	*	@param iIndex Index of the texture to convert.
+	*	@param bPowerOf2 Whether to resize the texture to power of 2 dimensions.
+	*	@param texture Converted texture.
+	*/
+	void ConvertTexture( const int iIndex, const bool bPowerOf2, StudioRGBATexture_t& texture ) const;
+
+	/**
+	*	@return Whether a texture has been uploaded and isn't waiting for an upload to complete.
+	*/
+	bool IsTextureUploaded( const int iIndex ) const;
+
+	/**
+	*	Takes over an uploaded texture of another model instead of uploading this model's texture, like when a model is reloaded.
+	*	The caller must make sure both textures have the same data; the other model no longer has its texture afterwards.
+	*	Must be called on the GL thread.
+	*	@param iIndex Index of the texture in this model.
+	*	@param other Model to take the texture from.
+	*	@param iOtherIndex Index of the texture in the other model.
+	*	@return Whether the texture was taken over. Fails if the other texture isn't uploaded, or was uploaded with other settings.
+	*/
+	bool AdoptTexture( const int iIndex, CStudioModel& other, const int iOtherIndex );
+
+	/**
+	*	Releases the memory used by the CPU copies of texture pixels, for viewing models without keeping data that's only used on the GPU.
+	*	Pixels of mapped files are paged back in from the file when they're used again, other pixels are read back in by EnsureTexturePixels.
+	*	Does nothing until every texture has been uploaded. Models whose textures were edited and Dreamcast models are never compacted.
+	*	@return Number of bytes that were released.
+	*/
+	size_t CompactTextures();
+
+	/**
+	*	Reads texture pixels released by CompactTextures back in. Must be called before texture pixels are read or written outside of this class.
+	*	Thread safe.
+	*	@return Whether the pixels are available.
+	*/
+	bool EnsureTexturePixels() const;
+
+	/**
+	*	@return Bytes of texture pixels that are currently released.
+	*/
+	size_t GetReleasedTextureBytes() const { return m_uiReleasedPixelBytes; }
+
+	/**
+	*	@return Estimated memory used by the model's headers, retained mesh data and decoded animations. Released texture pixels are not counted.
+	*/
+	size_t GetResidentSize() const;
+
+private:
+	typedef std::function<void( StudioRGBATexture_t& texture )> TextureConvertedFn_t;
+
+	/**
+	*	Converts all uploadable textures to RGBA on the texture conversion thread pool. Does not use GL.
+	*	@param bPowerOf2 Whether to resize textures to power of 2 dimensions.
+	*	@param callback Called for each converted texture, from any thread in the pool and in any order.
+	*	@param pbCancel Optional flag that stops conversion of the remaining textures when set.
+	*	@param pSkip Optional list of textures that shouldn't be converted, indexed by texture.
+	*/
+	void ConvertTextures( const bool bPowerOf2, const TextureConvertedFn_t& callback, const std::atomic<bool>* pbCancel = nullptr,
+						  const std::vector<bool>* pSkip = nullptr ) const;
+
+	/**
+	*	Creates the GL texture for a converted texture. Uses the texture name that was reserved for it, if any.
+	*/
+	void UploadTexture( const StudioRGBATexture_t& texture, const bool bFilterTextures ) const;
+
+	/**
+	*	Like UploadTexture, but uploads on the upload thread if it's running. GetTextureId returns an invalid id until the upload has completed.
+	*	@see graphics::CGLUploadQueue
+	*/
+	void QueueTextureUpload( StudioRGBATexture_t&& texture, const bool bFilterTextures );
+
+	/**
+	*	Waits for this model's queued texture uploads to complete.
+	*/
+	void FinishTextureUploads() const;
+
+	/**
+	*	Registers an uploaded texture with the render context, so it counts towards the texture budget and can be evicted.
+	*	Also updates the model's texture memory record.
+	*/
+	void RegisterTexture( const int iIndex, const int iWidth, const int iHeight, const bool bFilterTextures ) const;
+
+	/**
+	*	Uses an identical texture that another model already uploaded instead of uploading this one, if sharing is enabled.
+	*	The texture must not be a shared texture already. Its current name is deleted if a shared texture was found.
+	*	@param uiHash Hash of the source texture, or 0 to compute it.
+	*	@param iWidth Width of the converted texture.
+	*	@param iHeight Height of the converted texture.
+	*	@return Whether a shared texture is used now.
+	*/
+	bool AcquireSharedTexture( const int iIndex, const uint64_t uiHash, const int iWidth, const int iHeight, const bool bFilterTextures ) const;
+
+	/**
+	*	Registers a texture that has just been uploaded, and shares it with models loaded later if sharing is enabled.
+	*	@see AcquireSharedTexture
+	*/
+	void ShareTexture( const int iIndex, const uint64_t uiHash, const int iWidth, const int iHeight, const bool bFilterTextures ) const;
+
+	/**
+	*	Stops using a texture. It's unregistered and deleted, unless other models still share it.
+	*/
+	void ReleaseTexture( const int iIndex ) const;
+
+	/**
+	*	Gives a shared texture a name of its own, so it can be changed without changing other models' textures. The new texture is empty.
+	*/
+	void MakeTextureUnique( const int iIndex );
+
+	/**
+	*	Reserves names for all textures without uploading them. Each texture is converted and uploaded the first time GetTextureId is called for it.
+	*	@param bFilterTextures Whether textures are filtered.
+	*	@param bPowerOf2Textures Whether textures are resized to power of 2 dimensions.
+	*/
+	void ReserveTextures( const bool bFilterTextures, const bool bPowerOf2Textures );
+
+	/**
+	*	Loads a sequence group if it hasn't been loaded yet.
+	*	@param i Index of the group.
+	*	@param pPendingRead If not null, a read of the group's file that was already started.
+	*/
+	void LoadSequenceGroup( const size_t i, std::future<filesystem::CFileData>* pPendingRead = nullptr ) const;
+
+	/**
+	*	Loads all sequence groups that haven't been loaded yet.
+	*	@return Whether all sequence groups are loaded.
+	*/
+	bool LoadAllSequenceGroups() const;
+
+	/**
+	*	@return Whether the given header's memory belongs to a mapped file.
+	*/
+	bool IsMapped( const studiohdr_t* pHeader ) const;
+
+	/**
+	*	Detaches all mapped files so the files they were loaded from can be overwritten. Pointers into the model remain valid.
+	*	@return Whether all files were detached.
+	*/
+	bool DetachMappedFiles() const;
+
+	/**
+	*	Converts the tricmds of every mesh into indexed triangle lists. Does nothing if the meshes have already been converted.
+	*	Unless disabled with mdl_optimizemeshes, triangles and vertices are then reordered for the vertex cache.
+	*	Unless disabled with mdl_meshlods, simplified detail levels are built as well.
+	*	Does not use GL, so this can be done on any thread before CreateMeshBuffers is called.
+	*/
+	void BuildMeshData();
+
+	/**
+	*	Builds the simplified detail levels of a mesh whose full detail triangle list has just been built.
+	*	@param model Model that the mesh belongs to.
+	*	@param buffer The mesh's buffer. Its detail levels are set.
+	*	@param flModelSize Size of the model, which the simplification grids are scaled to. If 0, all levels use the full detail list.
+	*/
+	void BuildMeshLods( const mstudiomodel_t& model, StudioMeshBuffer_t& buffer, const float flModelSize );
+
+	/**
+	*	Converts the tricmds of every mesh into indexed triangle lists if that hasn't been done yet, and uploads the indices to a buffer object.
+	*/
+	void CreateMeshBuffers();
+
+	/**
+	*	Converts the vertices of a mesh buffer to skinning vertices.
+	*	@param pOut Receives buffer.uiNumVertices vertices.
+	*/
+	void FillSkinVertices( const StudioMeshBuffer_t& buffer, StudioSkinVertex_t* pOut ) const;
+
+	/**
+	*	Computes the quantization of a submodel's compact vertices from the bounds of its vertices.
+	*/
+	StudioVertexQuantization_t ComputeVertexQuantization( const mstudiomodel_t& model ) const;
+
+	/**
+	*	Converts the skinning vertices of a mesh buffer to compact vertices, and updates the largest error of the compact vertices.
+	*	@param pIn The mesh buffer's buffer.uiNumVertices skinning vertices.
+	*	@param pOut Receives buffer.uiNumVertices vertices.
+	*/
+	void CompactSkinVertices( const StudioMeshBuffer_t& buffer, const StudioSkinVertex_t* pIn, StudioCompactSkinVertex_t* pOut );
+
+	/**
+	*	Writes the skinning vertices of a mesh buffer to the bound skinning vertex buffer, in the buffer's format.
+	*	@param vertices Scratch storage for the float vertices.
+	*	@param compactVertices Scratch storage for the compact vertices.
+	*/
+	void UploadSkinVertices( const StudioMeshBuffer_t& buffer, std::vector<StudioSkinVertex_t>& vertices, std::vector<StudioCompactSkinVertex_t>& compactVertices );
+
 private:
 	studiohdr_t*	m_pStudioHdr;
 	studiohdr_t*	m_pTextureHdr;
 
-	studiohdr_t*	m_pSeqHdrs[ MAX_SEQGROUPS ];
+	/**
+	*	Sequence group headers. Loaded on demand, guarded by m_SeqGroupMutex.
+	*/
+	mutable studiohdr_t*	m_pSeqHdrs[ MAX_SEQGROUPS ];
+
+	/**
+	*	Whether each sequence group has been loaded, or failed to load. Once set, the header won't change anymore.
+	*/
+	mutable std::atomic<bool> m_bSeqGroupLoaded[ MAX_SEQGROUPS ];
+
+	mutable std::mutex	m_SeqGroupMutex;
+
+	/**
+	*	Name of the main model file, used to find sequence group files.
+	*/
+	std::string		m_szFilename;
 
-	GLuint			m_Textures[ MAXSTUDIOSKINS ];
+	/**
+	*	Name of the file that the texture header was loaded from. Released texture pixels are read back in from it.
+	*/
+	std::string		m_szTextureFilename;
+
+	bool			m_bIsDol = false;
+
+	/**
+	*	Whether the model and texture headers passed validation. Sequence groups are validated when they're loaded.
+	*/
+	bool			m_bValidated = false;
+
+	/**
+	*	Whether sequence groups are validated when they're loaded. Groups that fail validation are treated as if they couldn't be loaded.
+	*/
+	bool			m_bValidateSeqGroups = false;
+
+	CStudioModelView m_View;
+
+	std::thread		m_PrefetchThread;
+	std::atomic<bool> m_bStopPrefetch{ false };
+
+	mutable GLuint	m_Textures[ MAXSTUDIOSKINS ];
+
+	/**
+	*	Whether each texture has a reserved name, but hasn't been uploaded yet.
+	*/
+	mutable bool	m_bTexturePending[ MAXSTUDIOSKINS ];
+
+	/**
+	*	Whether each texture is being uploaded on the upload thread.
+	*/
+	mutable bool	m_bTextureUploading[ MAXSTUDIOSKINS ];
+
+	/**
+	*	Estimated size of each registered texture, in bytes.
+	*/
+	mutable size_t	m_TextureSizes[ MAXSTUDIOSKINS ];
+
+	/**
+	*	Memory used by the model's headers and loaded sequence groups, and its estimated texture memory.
+	*/
+	mutable mem::CMemoryRecord m_HeaderMemory{ mem::Category::STUDIO_HEADERS };
+	mutable mem::CMemoryRecord m_TextureMemory{ mem::Category::STUDIO_TEXTURES };
+
+	/**
+	*	Settings used to upload pending textures, and to restore evicted ones.
+	*/
+	bool			m_bFilterPendingTextures = true;
+	bool			m_bPowerOf2PendingTextures = true;
+
+	MeshVertices_t	m_MeshVertices;
+	MeshBuffers_t	m_MeshBuffers;
+
+	/**
+	*	Indices of all retained meshes. Only kept until they've been uploaded to the index buffer.
+	*/
+	MeshIndices_t	m_MeshIndices;
+
+	GLuint			m_IndexBuffer = 0;
+	GLuint			m_SkinVertexBuffer = 0;
+
+	/**
+	*	Format of the skinning vertex buffer, and the quantization of each submodel's compact vertices.
+	*/
+	bool			m_bCompactVertices = false;
+
+	std::unordered_map<const mstudiomodel_t*, StudioVertexQuantization_t> m_VertexQuantization;
+
+	float			m_flCompactPositionError = 0;
+	float			m_flCompactNormalError = 0;
+
+	/**
+	*	Submodels whose skinning vertices have to be reuploaded.
+	*/
+	std::unordered_set<const mstudiomodel_t*> m_DirtyVertexModels;
+
+	CStudioAnimCache m_AnimCache;
+
+	unsigned int	m_uiPoseRevision = 0;
+
+	/**
+	*	Event indices of all sequences sorted by frame, stored one sequence after the other.
+	*	The events of sequence i start at m_EventOffsets[ i ] and end at m_EventOffsets[ i + 1 ].
+	*/
+	std::vector<int>	m_SortedEvents;
+	std::vector<size_t>	m_EventOffsets;
+
+	/**
+	*	Flattened bone hierarchy.
+	*	@see GetBoneOrder
+	*	@see GetBoneParents
+	*/
+	std::vector<int>	m_BoneOrder;
+	std::vector<int>	m_BoneParents;
+
+	std::vector<StudioBoneBounds_t> m_BoneBounds;
+
+	/**
+	*	Meshes grouped by the texture they use in the default skin.
+	*	The meshes of texture i start at m_TextureMeshOffsets[ i ] and end at m_TextureMeshOffsets[ i + 1 ].
+	*/
+	std::vector<const mstudiomesh_t*>	m_TextureMeshes;
+	std::vector<size_t>				m_TextureMeshOffsets;
+
+	/**
+	*	Draw lists of all submodels. Each submodel has one list per skin family, stored next to each other.
+	*	m_DrawListOffsets maps submodels to the start of their first list.
+	*/
+	std::vector<StudioDrawMesh_t>	m_DrawMeshes;
+	std::unordered_map<const mstudiomodel_t*, size_t> m_DrawListOffsets;
+
+	/**
+	*	Files that headers were mapped from, if any. Headers that aren't mapped were allocated with new[].
+	*	Detaching doesn't change the model's data, so this can be done on const models.
+	*/
+	mutable MappedFiles_t m_MappedFiles;
+
+	/**
+	*	Ranges of the texture header, as offsets and ends, whose pixels were released and must be read from the file again.
+	*	Pixels of mapped files are paged back in by the OS, so they aren't listed. Guarded by m_PixelMutex.
+	*/
+	mutable std::vector<std::pair<size_t, size_t>> m_ReleasedPixels;
+
+	mutable std::mutex m_PixelMutex;
+
+	/**
+	*	Whether CompactTextures released pixels that haven't been read back in yet.
+	*/
+	mutable std::atomic<bool> m_bPixelsReleased{ false };
+
+	mutable std::atomic<size_t> m_uiReleasedPixelBytes{ 0 };
+
+	/**
+	*	Whether texture pixels or palettes were changed since the model was loaded. Edited pixels only exist in memory, so they can't be released.
+	*/
+	bool m_bTexturesEdited = false;
 
 private:
 	CStudioModel( const CStudioModel& ) = delete;
 	CStudioModel& operator=( const CStudioModel& ) = delete;
 };
 
+/**
+*	Scales everything that is positioned relative to bones: vertices, hitboxes and attachments.
+*	Also scales the model's and sequences' bounds and the eye position, since they're meant to contain the meshes.
+*	Vertices are scaled in parallel, and only the skinning vertices of the model are reuploaded.
+*/
 void ScaleMeshes( CStudioModel* pStudioModel, const float flScale );
+
+/**
+*	Scales the skeleton and its motion: bone positions, which also scales their animation, sequence movement and foot pivots.
+*	No buffers have to be reuploaded; bones are set up again the next time the model is posed.
+*/
 void ScaleBones( CStudioModel* pStudioModel, const float flScale );
 
 /**
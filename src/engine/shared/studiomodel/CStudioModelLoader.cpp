@@ -0,0 +1,381 @@
+#include <cassert>
+#include <chrono>
+
+#include "StudioModelDiskCache.h"
+
+#include "CStudioModelLoader.h"
+
+namespace studiomdl
+{
+CStudioModelLoader::~CStudioModelLoader()
+{
+	Cancel();
+}
+
+void CStudioModelLoader::Start( const char* const pszFilename )
+{
+	Cancel();
+
+	BeginLoad( pszFilename );
+}
+
+void CStudioModelLoader::StartReload( const char* const pszFilename, const std::shared_ptr<CStudioModel>& previous )
+{
+	assert( previous );
+
+	Cancel();
+
+	m_Previous = previous;
+
+	BeginLoad( pszFilename );
+}
+
+void CStudioModelLoader::BeginLoad( const char* const pszFilename )
+{
+	m_szFilename = pszFilename;
+
+	//Cvars are read here so the worker thread doesn't have to.
+	GetTextureLoadSettings( m_bFilterTextures, m_bPowerOf2Textures );
+	m_bUseDiskCache = UseStudioModelDiskCache();
+	m_szCacheDirectory = m_bUseDiskCache ? GetStudioModelCacheDirectory() : std::string();
+
+	//Cache entries need every texture, so they can't be deferred when the cache is used.
+	m_bDeferTextures = UseDeferredTextureUploads() && !m_bUseDiskCache;
+
+	m_PreviousHashes.clear();
+	m_ReusedTextures.clear();
+	m_TextureHashes.clear();
+	m_uiNumReused = 0;
+
+	//Textures uploaded with other settings look different, so they can't be reused.
+	if( m_Previous && 
+		m_Previous->m_bFilterPendingTextures == m_bFilterTextures && 
+		m_Previous->m_bPowerOf2PendingTextures == m_bPowerOf2Textures )
+	{
+		const int iNumTextures = m_Previous->GetUploadableTextureCount();
+
+		for( int i = 0; i < iNumTextures; ++i )
+		{
+			if( m_Previous->IsTextureUploaded( i ) )
+				m_PreviousHashes.emplace_back( HashStudioTexture( *m_Previous, i ), i );
+		}
+	}
+
+	m_Result = StudioModelLoadResult::FAILURE;
+	m_bWorkerDone = false;
+	m_uiNumTextures = 0;
+	m_uiNumUploaded = 0;
+
+	m_bCancel = false;
+	m_bLoading = true;
+
+	m_Thread = std::thread( &CStudioModelLoader::Load, this );
+}
+
+void CStudioModelLoader::Cancel()
+{
+	if( !m_bLoading )
+		return;
+
+	m_bCancel = true;
+
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	m_bLoading = false;
+
+	//The model may have textures already, so this has to be done on the GL thread.
+	m_Model.reset();
+	m_ConvertedTextures.clear();
+
+	m_Previous.reset();
+}
+
+bool CStudioModelLoader::Update( const double flBudget )
+{
+	if( !m_bLoading )
+		return false;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	do
+	{
+		StudioRGBATexture_t texture;
+
+		bool bHasTexture = false;
+		bool bWorkerDone;
+
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			if( !m_ConvertedTextures.empty() )
+			{
+				texture = std::move( m_ConvertedTextures.front() );
+				m_ConvertedTextures.pop_front();
+				bHasTexture = true;
+			}
+
+			bWorkerDone = m_bWorkerDone;
+		}
+
+		if( !bHasTexture )
+		{
+			//Nothing left to upload once the worker is done.
+			if( bWorkerDone )
+			{
+				Finish();
+				return true;
+			}
+
+			return false;
+		}
+
+		//Cached textures include the ones that are taken over from the previous model.
+		if( !IsReused( texture.iIndex ) )
+			m_Model->UploadTexture( texture, m_bFilterTextures );
+
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		++m_uiNumUploaded;
+	}
+	while( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() < flBudget );
+
+	return false;
+}
+
+float CStudioModelLoader::GetProgress() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_bWorkerDone && m_uiNumTextures == 0 )
+		return 1;
+
+	if( m_uiNumTextures == 0 )
+		return 0;
+
+	return static_cast<float>( m_uiNumUploaded ) / m_uiNumTextures;
+}
+
+void CStudioModelLoader::Load()
+{
+	CStudioModel* pModel = nullptr;
+
+	const StudioModelLoadResult result = LoadStudioModelFiles( m_szFilename.c_str(), pModel );
+
+	//Done before any texture is queued, so the GL thread can read the result without locking.
+	if( result == StudioModelLoadResult::SUCCESS && !m_PreviousHashes.empty() )
+		FindReusableTextures( *pModel );
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	m_Result = result;
+
+	if( result == StudioModelLoadResult::SUCCESS )
+	{
+		m_Model.reset( pModel );
+
+		if( m_bUseDiskCache )
+		{
+			lock.unlock();
+
+			std::vector<StudioRGBATexture_t> textures;
+
+			const uint64_t uiHash = HashStudioModel( *pModel );
+
+			//Waiting for another process only blocks this worker thread.
+			if( LoadStudioModelCache( *pModel, m_szCacheDirectory, uiHash, m_bPowerOf2Textures, true, textures ) )
+			{
+				//Cached textures weren't converted, so they aren't hashed yet. Done here to keep it off the GL thread.
+				for( auto& texture : textures )
+				{
+					texture.uiHash = HashStudioTexture( *pModel, texture.iIndex );
+				}
+
+				QueueTextures( textures );
+			}
+			else
+				ConvertAndCacheModel( uiHash );
+
+			lock.lock();
+		}
+		else
+		{
+			//Deferred textures are converted when they're first drawn instead.
+			const int iNumTextures = m_bDeferTextures ? 0 : m_Model->GetUploadableTextureCount();
+
+			//Textures that are taken over from the previous model don't need to be converted.
+			std::vector<bool> skip( static_cast<size_t>( iNumTextures ), false );
+
+			size_t uiNumSkipped = 0;
+
+			for( int i = 0; i < iNumTextures; ++i )
+			{
+				if( IsReused( i ) )
+				{
+					skip[ i ] = true;
+					++uiNumSkipped;
+				}
+			}
+
+			m_uiNumTextures = static_cast<size_t>( iNumTextures ) - uiNumSkipped;
+
+			lock.unlock();
+
+			if( m_uiNumTextures > 0 )
+			{
+				//Conversion only touches each texture's own data, which the GL thread never uses until loading has finished.
+				pModel->ConvertTextures( m_bPowerOf2Textures,
+					[ this ]( StudioRGBATexture_t& texture )
+					{
+						std::lock_guard<std::mutex> textureLock( m_Mutex );
+
+						m_ConvertedTextures.push_back( std::move( texture ) );
+					},
+					&m_bCancel,
+					&skip
+				);
+			}
+
+			pModel->BuildMeshData();
+
+			lock.lock();
+		}
+	}
+
+	m_bWorkerDone = true;
+}
+
+void CStudioModelLoader::ConvertAndCacheModel( const uint64_t uiHash )
+{
+	CStudioModel* const pModel = m_Model.get();
+
+	std::vector<StudioRGBATexture_t> textures( static_cast<size_t>( pModel->GetUploadableTextureCount() ) );
+
+	pModel->ConvertTextures( m_bPowerOf2Textures,
+		[ & ]( StudioRGBATexture_t& texture )
+		{
+			textures[ texture.iIndex ] = std::move( texture );
+		},
+		&m_bCancel
+	);
+
+	//Some textures may not have been converted. The model is discarded anyway.
+	if( m_bCancel )
+	{
+		ReleaseStudioModelCacheClaim( m_szCacheDirectory, uiHash, m_bPowerOf2Textures );
+		return;
+	}
+
+	pModel->BuildMeshData();
+
+	SaveStudioModelCache( *pModel, m_szCacheDirectory, uiHash, m_bPowerOf2Textures, textures );
+
+	QueueTextures( textures );
+}
+
+void CStudioModelLoader::QueueTextures( std::vector<StudioRGBATexture_t>& textures )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_uiNumTextures = textures.size();
+
+	for( auto& texture : textures )
+	{
+		m_ConvertedTextures.push_back( std::move( texture ) );
+	}
+}
+
+void CStudioModelLoader::FindReusableTextures( const CStudioModel& model )
+{
+	const int iNumTextures = model.GetUploadableTextureCount();
+
+	m_ReusedTextures.assign( static_cast<size_t>( iNumTextures ), -1 );
+	m_TextureHashes.resize( static_cast<size_t>( iNumTextures ) );
+
+	//Each texture of the previous model can only be taken over once.
+	std::vector<bool> taken( m_PreviousHashes.size(), false );
+
+	for( int i = 0; i < iNumTextures; ++i )
+	{
+		m_TextureHashes[ i ] = HashStudioTexture( model, i );
+
+		size_t uiMatch = m_PreviousHashes.size();
+
+		for( size_t uiIndex = 0; uiIndex < m_PreviousHashes.size(); ++uiIndex )
+		{
+			if( taken[ uiIndex ] || m_PreviousHashes[ uiIndex ].first != m_TextureHashes[ i ] )
+				continue;
+
+			uiMatch = uiIndex;
+
+			//Prefer the texture at the same index, in case there are duplicates.
+			if( m_PreviousHashes[ uiIndex ].second == i )
+				break;
+		}
+
+		if( uiMatch < m_PreviousHashes.size() )
+		{
+			taken[ uiMatch ] = true;
+			m_ReusedTextures[ i ] = m_PreviousHashes[ uiMatch ].second;
+		}
+	}
+}
+
+void CStudioModelLoader::AdoptReusedTextures()
+{
+	for( size_t uiIndex = 0; uiIndex < m_ReusedTextures.size(); ++uiIndex )
+	{
+		const int iIndex = static_cast<int>( uiIndex );
+		const int iPrevious = m_ReusedTextures[ uiIndex ];
+
+		if( iPrevious == -1 )
+			continue;
+
+		//The previous texture may have been edited or reuploaded while the new model was loading.
+		if( m_Previous->IsTextureUploaded( iPrevious ) && 
+			HashStudioTexture( *m_Previous, iPrevious ) == m_TextureHashes[ uiIndex ] &&
+			m_Model->AdoptTexture( iIndex, *m_Previous, iPrevious ) )
+		{
+			++m_uiNumReused;
+			continue;
+		}
+
+		//Deferred textures are still reserved, and will be uploaded on first use.
+		if( !m_bDeferTextures )
+		{
+			StudioRGBATexture_t texture;
+
+			m_Model->ConvertTexture( iIndex, m_bPowerOf2Textures, texture );
+			m_Model->UploadTexture( texture, m_bFilterTextures );
+		}
+	}
+}
+
+void CStudioModelLoader::Finish()
+{
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	m_bLoading = false;
+
+	if( m_Result == StudioModelLoadResult::SUCCESS )
+	{
+		//Evicted textures are restored with the settings they were loaded with.
+		m_Model->m_bFilterPendingTextures = m_bFilterTextures;
+		m_Model->m_bPowerOf2PendingTextures = m_bPowerOf2Textures;
+
+		if( m_bDeferTextures )
+			m_Model->ReserveTextures( m_bFilterTextures, m_bPowerOf2Textures );
+
+		if( m_Previous )
+			AdoptReusedTextures();
+
+		m_Model->CreateMeshBuffers();
+
+		//Textures are uploaded on this thread, so they're all done by now.
+		CompactStudioModelTextures( *m_Model, m_szFilename.c_str() );
+	}
+
+	m_Previous.reset();
+	m_PreviousHashes.clear();
+}
+}
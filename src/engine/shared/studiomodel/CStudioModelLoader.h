@@ -0,0 +1,188 @@
+#ifndef GAME_STUDIOMODEL_CSTUDIOMODELLOADER_H
+#define GAME_STUDIOMODEL_CSTUDIOMODELLOADER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CStudioModel.h"
+
+namespace studiomdl
+{
+/**
+*	Loads a studio model in two stages. A worker thread reads the model's files and converts its textures,
+*	and the GL thread uploads converted textures in small steps so it stays responsive while large models load.
+*/
+class CStudioModelLoader final
+{
+public:
+	CStudioModelLoader() = default;
+	~CStudioModelLoader();
+
+	/**
+	*	@return Whether a model is being loaded.
+	*/
+	bool IsLoading() const { return m_bLoading; }
+
+	/**
+	*	@return Name of the model being loaded, or the last model that was loaded.
+	*/
+	const std::string& GetFilename() const { return m_szFilename; }
+
+	/**
+	*	Starts loading a model. Cancels the model currently being loaded, if any.
+	*	@param pszFilename Name of the model to load. This is the entire path, including the extension.
+	*/
+	void Start( const char* const pszFilename );
+
+	/**
+	*	Starts loading a new version of a model that is already loaded. Textures whose data hasn't changed aren't converted or uploaded again;
+	*	the new model takes them over from the previous one when loading finishes. The previous model can still be used until then.
+	*	@param pszFilename Name of the model to load. This is the entire path, including the extension.
+	*	@param previous The loaded version of the model.
+	*/
+	void StartReload( const char* const pszFilename, const std::shared_ptr<CStudioModel>& previous );
+
+	/**
+	*	@return The number of textures that were taken over from the previous model by the last reload.
+	*/
+	size_t GetNumReusedTextures() const { return m_uiNumReused; }
+
+	/**
+	*	Stops loading the current model and frees it. Blocks until the worker thread has stopped.
+	*/
+	void Cancel();
+
+	/**
+	*	Uploads converted textures until the time budget is used up. Must be called on the GL thread, preferably once per frame.
+	*	At least one texture is uploaded each call, if one is ready.
+	*	@param flBudget Time, in seconds, that may be spent uploading.
+	*	@return Whether loading has finished. Use GetResult and ReleaseModel to get the outcome.
+	*/
+	bool Update( const double flBudget );
+
+	/**
+	*	@return Fraction of the model's textures that have been uploaded, in the range [0, 1].
+	*/
+	float GetProgress() const;
+
+	/**
+	*	@return Result of the last load. Only valid after Update has returned true.
+	*/
+	StudioModelLoadResult GetResult() const { return m_Result; }
+
+	/**
+	*	Takes ownership of the loaded model. Only valid after Update has returned true and the load succeeded.
+	*	@return The loaded model, or null if there is none.
+	*/
+	CStudioModel* ReleaseModel() { return m_Model.release(); }
+
+private:
+	/**
+	*	Reads settings and starts the worker thread.
+	*/
+	void BeginLoad( const char* const pszFilename );
+
+	/**
+	*	Runs on the worker thread.
+	*/
+	void Load();
+
+	/**
+	*	Converts all textures at once and saves them to the disk cache along with the mesh data.
+	*	Runs on the worker thread.
+	*/
+	void ConvertAndCacheModel( const uint64_t uiHash );
+
+	/**
+	*	Queues already converted textures for uploading. Runs on the worker thread.
+	*/
+	void QueueTextures( std::vector<StudioRGBATexture_t>& textures );
+
+	/**
+	*	Finds the textures of the new model that have the same data as uploaded textures of the previous model.
+	*	Runs on the worker thread.
+	*/
+	void FindReusableTextures( const CStudioModel& model );
+
+	/**
+	*	@return Whether a texture of the new model will be taken over from the previous model.
+	*/
+	bool IsReused( const int iIndex ) const
+	{
+		return iIndex >= 0 && static_cast<size_t>( iIndex ) < m_ReusedTextures.size() && m_ReusedTextures[ iIndex ] != -1;
+	}
+
+	/**
+	*	Takes over reusable textures from the previous model.
+	*/
+	void AdoptReusedTextures();
+
+	/**
+	*	Joins the worker thread and finishes setting up the model.
+	*/
+	void Finish();
+
+private:
+	std::string m_szFilename;
+
+	bool m_bLoading = false;
+
+	bool m_bFilterTextures = true;
+	bool m_bPowerOf2Textures = true;
+	bool m_bDeferTextures = false;
+	bool m_bUseDiskCache = false;
+	std::string m_szCacheDirectory;
+
+	std::thread m_Thread;
+
+	std::atomic<bool> m_bCancel{ false };
+
+	/**
+	*	When reloading, the loaded version of the model, and hashes of its uploaded textures.
+	*	Its textures are hashed when the reload starts, so the worker never reads the previous model.
+	*/
+	std::shared_ptr<CStudioModel> m_Previous;
+	std::vector<std::pair<uint64_t, int>> m_PreviousHashes;
+
+	/**
+	*	For each texture of the new model, the texture of the previous model it takes over, or -1.
+	*	Written by the worker thread before conversion starts.
+	*/
+	std::vector<int> m_ReusedTextures;
+	std::vector<uint64_t> m_TextureHashes;
+
+	size_t m_uiNumReused = 0;
+
+	/**
+	*	Guards all members below. The model itself is only used by the worker thread until it has finished.
+	*/
+	mutable std::mutex m_Mutex;
+
+	std::unique_ptr<CStudioModel> m_Model;
+
+	StudioModelLoadResult m_Result = StudioModelLoadResult::FAILURE;
+
+	bool m_bWorkerDone = false;
+
+	/**
+	*	Textures converted by the worker thread that are waiting to be uploaded.
+	*/
+	std::deque<StudioRGBATexture_t> m_ConvertedTextures;
+
+	size_t m_uiNumTextures = 0;
+	size_t m_uiNumUploaded = 0;
+
+private:
+	CStudioModelLoader( const CStudioModelLoader& ) = delete;
+	CStudioModelLoader& operator=( const CStudioModelLoader& ) = delete;
+};
+}
+
+#endif //GAME_STUDIOMODEL_CSTUDIOMODELLOADER_H
@@ -0,0 +1,182 @@
+#include "shared/Logging.h"
+
+#include "cvar/CConCommand.h"
+
+#include "CStudioModelManager.h"
+
+namespace studiomdl
+{
+namespace
+{
+static cvar::CConCommand mdl_resident( "mdl_resident",
+	[]( const util::CCommand& )
+	{
+		StudioModelManager().ReportResidentModels();
+	},
+	cvar::Flag::NONE, "Lists all studio models that are currently loaded" );
+
+static cvar::CConCommand mdl_meshstats( "mdl_meshstats",
+	[]( const util::CCommand& )
+	{
+		StudioModelManager().ReportMeshStats();
+	},
+	cvar::Flag::NONE, "Lists the vertex and triangle counts and vertex cache miss ratios of the meshes of all loaded studio models" );
+
+/**
+*	Gets the key of a model, and the time its file was last modified.
+*	@return Whether the file exists.
+*/
+bool GetModelKey( const char* const pszFilename, std::string& szKey, std::experimental::filesystem::file_time_type& modifiedTime )
+{
+	std::error_code error;
+
+	const auto path = std::experimental::filesystem::canonical( pszFilename, error );
+
+	if( error )
+		return false;
+
+	modifiedTime = std::experimental::filesystem::last_write_time( path, error );
+
+	if( error )
+		return false;
+
+	szKey = path.string();
+
+	return true;
+}
+}
+
+CStudioModelManager& StudioModelManager()
+{
+	static CStudioModelManager manager;
+
+	return manager;
+}
+
+StudioModelLoadResult CStudioModelManager::LoadModel( const char* const pszFilename, ModelPtr_t& model )
+{
+	model = FindModel( pszFilename );
+
+	if( model )
+		return StudioModelLoadResult::SUCCESS;
+
+	CStudioModel* pModel;
+
+	const StudioModelLoadResult result = LoadStudioModel( pszFilename, pModel );
+
+	if( result != StudioModelLoadResult::SUCCESS )
+		return result;
+
+	model = AddModel( pszFilename, pModel );
+
+	return StudioModelLoadResult::SUCCESS;
+}
+
+CStudioModelManager::ModelPtr_t CStudioModelManager::FindModel( const char* const pszFilename )
+{
+	std::string szKey;
+	std::experimental::filesystem::file_time_type modifiedTime;
+
+	if( !GetModelKey( pszFilename, szKey, modifiedTime ) )
+		return nullptr;
+
+	auto it = m_Models.find( szKey );
+
+	if( it == m_Models.end() )
+		return nullptr;
+
+	ModelPtr_t model = it->second.model.lock();
+
+	if( !model )
+	{
+		m_Models.erase( it );
+		return nullptr;
+	}
+
+	if( it->second.modifiedTime != modifiedTime )
+		return nullptr;
+
+	return model;
+}
+
+CStudioModelManager::ModelPtr_t CStudioModelManager::AddModel( const char* const pszFilename, CStudioModel* pModel )
+{
+	ModelPtr_t model( pModel );
+
+	RemoveFreedModels();
+
+	std::string szKey;
+	std::experimental::filesystem::file_time_type modifiedTime;
+
+	//Models whose file can't be found anymore aren't shared.
+	if( GetModelKey( pszFilename, szKey, modifiedTime ) )
+	{
+		auto& entry = m_Models[ szKey ];
+
+		entry.model = model;
+		entry.modifiedTime = modifiedTime;
+	}
+
+	return model;
+}
+
+void CStudioModelManager::GetResidentModels( std::vector<ResidentModel_t>& models )
+{
+	RemoveFreedModels();
+
+	models.clear();
+	models.reserve( m_Models.size() );
+
+	for( const auto& model : m_Models )
+	{
+		models.push_back( { model.first, model.second.model.use_count() } );
+	}
+}
+
+void CStudioModelManager::ReportResidentModels()
+{
+	std::vector<ResidentModel_t> models;
+
+	GetResidentModels( models );
+
+	Message( "%u resident studio models\n", static_cast<unsigned int>( models.size() ) );
+
+	for( const auto& model : models )
+	{
+		Message( "%s: %ld references\n", model.szFilename.c_str(), model.iReferences );
+	}
+}
+
+void CStudioModelManager::ReportMeshStats()
+{
+	RemoveFreedModels();
+
+	for( const auto& entry : m_Models )
+	{
+		if( auto model = entry.second.model.lock() )
+			model->ReportMeshStats( entry.first.c_str() );
+	}
+}
+
+void CStudioModelManager::ApplyTextureSettings( const bool bFilterTextures, const bool bPowerOf2Textures )
+{
+	RemoveFreedModels();
+
+	for( const auto& entry : m_Models )
+	{
+		if( auto model = entry.second.model.lock() )
+			model->ApplyTextureSettings( bFilterTextures, bPowerOf2Textures );
+	}
+}
+
+void CStudioModelManager::RemoveFreedModels()
+{
+	for( auto it = m_Models.begin(); it != m_Models.end(); )
+	{
+		if( it->second.model.expired() )
+			it = m_Models.erase( it );
+		else
+			++it;
+	}
+}
+}
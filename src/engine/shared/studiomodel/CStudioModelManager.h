@@ -0,0 +1,111 @@
+#ifndef GAME_STUDIOMODEL_CSTUDIOMODELMANAGER_H
+#define GAME_STUDIOMODEL_CSTUDIOMODELMANAGER_H
+
+#include <experimental/filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CStudioModel.h"
+
+namespace studiomdl
+{
+/**
+*	Shares loaded studio models between their users. Models are keyed on their canonical path and the time the file was last modified,
+*	so a model that has changed on disk is loaded again. A model is freed when its last reference is released.
+*	Must only be used on the GL thread.
+*/
+class CStudioModelManager final
+{
+public:
+	typedef std::shared_ptr<CStudioModel> ModelPtr_t;
+
+	/**
+	*	Information about a model that is currently loaded.
+	*/
+	struct ResidentModel_t
+	{
+		std::string szFilename;
+
+		/**
+		*	Number of references to the model.
+		*/
+		long iReferences;
+	};
+
+public:
+	CStudioModelManager() = default;
+	~CStudioModelManager() = default;
+
+	/**
+	*	Gets a model, loading it if it isn't loaded yet or if the file has changed since it was loaded.
+	*	@param pszFilename Name of the model to load.
+	*	@param model The model.
+	*	@return The result of the load.
+	*/
+	StudioModelLoadResult LoadModel( const char* const pszFilename, ModelPtr_t& model );
+
+	/**
+	*	Finds a loaded model.
+	*	@return The model, or null if it isn't loaded or if the file has changed since it was loaded.
+	*/
+	ModelPtr_t FindModel( const char* const pszFilename );
+
+	/**
+	*	Adds a model that was loaded elsewhere, replacing any model that was added with the same name.
+	*	Users of the replaced model keep it until they release it.
+	*	@param pszFilename Name of the file the model was loaded from.
+	*	@param pModel Model to add. The manager takes ownership of it.
+	*	@return Reference to the model.
+	*/
+	ModelPtr_t AddModel( const char* const pszFilename, CStudioModel* pModel );
+
+	/**
+	*	Gets all models that are currently loaded.
+	*/
+	void GetResidentModels( std::vector<ResidentModel_t>& models );
+
+	/**
+	*	Prints all models that are currently loaded.
+	*/
+	void ReportResidentModels();
+
+	/**
+	*	Prints the mesh statistics of all models that are currently loaded.
+	*	@see CStudioModel::ReportMeshStats
+	*/
+	void ReportMeshStats();
+
+	/**
+	*	Applies new texture settings to all models that are currently loaded.
+	*	@see CStudioModel::ApplyTextureSettings
+	*/
+	void ApplyTextureSettings( const bool bFilterTextures, const bool bPowerOf2Textures );
+
+private:
+	struct Entry_t
+	{
+		std::weak_ptr<CStudioModel> model;
+		std::experimental::filesystem::file_time_type modifiedTime;
+	};
+
+	typedef std::unordered_map<std::string, Entry_t> Models_t;
+
+	/**
+	*	Removes entries for models that have been freed.
+	*/
+	void RemoveFreedModels();
+
+private:
+	Models_t m_Models;
+
+private:
+	CStudioModelManager( const CStudioModelManager& ) = delete;
+	CStudioModelManager& operator=( const CStudioModelManager& ) = delete;
+};
+
+CStudioModelManager& StudioModelManager();
+}
+
+#endif //GAME_STUDIOMODEL_CSTUDIOMODELMANAGER_H
@@ -0,0 +1,110 @@
+#ifndef GAME_STUDIOMODEL_CSTUDIOMODELVIEW_H
+#define GAME_STUDIOMODEL_CSTUDIOMODELVIEW_H
+
+#include <cassert>
+
+#include "shared/Const.h"
+
+#include "studio.h"
+
+namespace studiomdl
+{
+class CStudioModel;
+
+/**
+*	Accessors for a model that passed validation when it was loaded.
+*	Offsets and counts in the headers were checked against the file sizes then, so nothing is checked here again.
+*	Indices passed in must be in range; this is only asserted.
+*	Obtained through CStudioModel::GetValidatedView, which returns null for models that weren't validated.
+*/
+class CStudioModelView final
+{
+public:
+	CStudioModelView() = default;
+
+	CStudioModelView( const CStudioModel* pModel, studiohdr_t* pStudioHdr, studiohdr_t* pTextureHdr )
+		: m_pModel( pModel )
+		, m_pStudioHdr( pStudioHdr )
+		, m_pTextureHdr( pTextureHdr )
+	{
+	}
+
+	studiohdr_t* GetStudioHeader() const { return m_pStudioHdr; }
+	studiohdr_t* GetTextureHeader() const { return m_pTextureHdr; }
+
+	mstudiobodyparts_t* GetBodypart( const int iBodyPart ) const
+	{
+		assert( iBodyPart >= 0 && iBodyPart < m_pStudioHdr->numbodyparts );
+
+		return m_pStudioHdr->GetBodypart( iBodyPart );
+	}
+
+	/**
+	*	@param iBody Bodygroup value. Must not be negative.
+	*/
+	mstudiomodel_t* GetModelByBodyPart( const int iBody, const int iBodyPart ) const
+	{
+		assert( iBody >= 0 );
+
+		const mstudiobodyparts_t* const pbodypart = GetBodypart( iBodyPart );
+
+		//Validation guarantees a base of at least 1 and at least 1 model.
+		const int index = ( iBody / pbodypart->base ) % pbodypart->nummodels;
+
+		return reinterpret_cast<mstudiomodel_t*>( m_pStudioHdr->GetData() + pbodypart->modelindex ) + index;
+	}
+
+	mstudioseqdesc_t* GetSequence( const int iSequence ) const
+	{
+		assert( iSequence >= 0 && iSequence < m_pStudioHdr->numseq );
+
+		return m_pStudioHdr->GetSequence( iSequence );
+	}
+
+	mstudiotexture_t* GetTexture( const int iTexture ) const
+	{
+		assert( iTexture >= 0 && iTexture < m_pTextureHdr->numtextures );
+
+		return m_pTextureHdr->GetTexture( iTexture );
+	}
+
+	/**
+	*	@return The texture indices of a skin family, one for each skin reference.
+	*/
+	short* GetSkinFamily( const int iSkin ) const
+	{
+		assert( iSkin >= 0 && iSkin < m_pTextureHdr->numskinfamilies );
+
+		return m_pTextureHdr->GetSkins() + iSkin * m_pTextureHdr->numskinref;
+	}
+
+	/**
+	*	@return The animation data for a sequence, or null if its sequence group couldn't be loaded or failed validation.
+	*/
+	mstudioanim_t* GetAnim( const mstudioseqdesc_t* pseqdesc ) const
+	{
+		if( pseqdesc->seqgroup == 0 )
+		{
+			const mstudioseqgroup_t* const pseqgroup = m_pStudioHdr->GetSequenceGroup( 0 );
+
+			return reinterpret_cast<mstudioanim_t*>( m_pStudioHdr->GetData() + pseqgroup->unused2 + pseqdesc->animindex );
+		}
+
+		return GetGroupAnim( pseqdesc );
+	}
+
+private:
+	/**
+	*	Gets the animation data of a sequence in another sequence group, loading the group if needed.
+	*/
+	mstudioanim_t* GetGroupAnim( const mstudioseqdesc_t* pseqdesc ) const;
+
+private:
+	const CStudioModel* m_pModel = nullptr;
+
+	studiohdr_t* m_pStudioHdr = nullptr;
+	studiohdr_t* m_pTextureHdr = nullptr;
+};
+}
+
+#endif //GAME_STUDIOMODEL_CSTUDIOMODELVIEW_H
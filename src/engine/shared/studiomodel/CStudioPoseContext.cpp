@@ -0,0 +1,661 @@
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include <glm/common.hpp>
+
+#include "utility/mathlib.h"
+
+#include "cvar/CCVar.h"
+
+#include "shared/Perf.h"
+#include "shared/Profiler.h"
+#include "shared/Trace.h"
+
+#include "shared/renderer/studiomodel/CModelRenderInfo.h"
+
+#include "CStudioModel.h"
+#include "StudioKernels.h"
+
+#include "CStudioPoseContext.h"
+
+//Double to float conversion
+#pragma warning( disable: 4244 )
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Bones can be set up on several threads at once.
+*/
+std::atomic<unsigned int> g_uiNextPoseSerial{ 1 };
+
+static cvar::CCVar mdl_simdbones( "mdl_simdbones",
+	cvar::CCVarArgsBuilder()
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "If non-zero, bones are blended and set up with SIMD kernels when supported" ) );
+
+static cvar::CCVar mdl_fastnlerp( "mdl_fastnlerp",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "If non-zero, blends between nearly identical bone rotations use a normalized lerp instead of a slerp. Requires mdl_simdbones" ) );
+
+static cvar::CCVar mdl_fusedblends( "mdl_fusedblends",
+	cvar::CCVarArgsBuilder()
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "If non-zero, all blends of a bone are decoded and blended at once instead of setting up a pose for each blend" ) );
+
+float GetBlendFraction( const byte iBlender )
+{
+	return iBlender / 255.0f;
+}
+}
+
+bool CStudioPoseContext::PoseKey_t::operator==( const PoseKey_t& other ) const
+{
+	if( pModel != other.pModel ||
+		uiPoseRevision != other.uiPoseRevision ||
+		iSequence != other.iSequence ||
+		flFrame != other.flFrame ||
+		iMouth != other.iMouth )
+		return false;
+
+	for( int iIndex = 0; iIndex < 2; ++iIndex )
+	{
+		if( iBlender[ iIndex ] != other.iBlender[ iIndex ] )
+			return false;
+	}
+
+	for( int iIndex = 0; iIndex < 4; ++iIndex )
+	{
+		if( iController[ iIndex ] != other.iController[ iIndex ] )
+			return false;
+	}
+
+	return true;
+}
+
+size_t CStudioPoseContext::PoseKey_t::Hash() const
+{
+	size_t uiHash = std::hash<const CStudioModel*>()( pModel );
+
+	const auto combine = [ &uiHash ]( const size_t uiValue )
+	{
+		uiHash ^= uiValue + 0x9e3779b9 + ( uiHash << 6 ) + ( uiHash >> 2 );
+	};
+
+	combine( uiPoseRevision );
+	combine( static_cast<size_t>( iSequence ) );
+	combine( std::hash<float>()( flFrame ) );
+	combine( iBlender[ 0 ] | ( iBlender[ 1 ] << 8 ) | ( iMouth << 16 ) );
+	combine( iController[ 0 ] | ( iController[ 1 ] << 8 ) | ( iController[ 2 ] << 16 ) | ( static_cast<size_t>( iController[ 3 ] ) << 24 ) );
+
+	return uiHash;
+}
+
+CStudioPoseContext::PoseKey_t CStudioPoseContext::MakeKey( const CModelRenderInfo& renderInfo )
+{
+	assert( renderInfo.pModel );
+
+	PoseKey_t key;
+
+	key.pModel = renderInfo.pModel;
+	key.uiPoseRevision = renderInfo.pModel->GetPoseRevision();
+	key.iSequence = renderInfo.iSequence;
+	key.flFrame = renderInfo.flFrame;
+
+	for( int iIndex = 0; iIndex < 2; ++iIndex )
+	{
+		key.iBlender[ iIndex ] = renderInfo.iBlender[ iIndex ];
+	}
+
+	for( int iIndex = 0; iIndex < 4; ++iIndex )
+	{
+		key.iController[ iIndex ] = renderInfo.iController[ iIndex ];
+	}
+
+	key.iMouth = renderInfo.iMouth;
+
+	return key;
+}
+
+bool CStudioPoseContext::Matches( const CModelRenderInfo& renderInfo ) const
+{
+	if( !m_Key.pModel || m_Key.pModel != renderInfo.pModel )
+		return false;
+
+	return m_Key == MakeKey( renderInfo );
+}
+
+void CStudioPoseContext::SetUpBones( const CModelRenderInfo& renderInfo )
+{
+	TRACE_SCOPE( "SetUpBones" );
+	PERF_SCOPE( "SetUpBones" );
+	PROFILE_SCOPE( "SetUpBones" );
+
+	assert( renderInfo.pModel );
+
+	m_pRenderInfo = &renderInfo;
+	m_pStudioHdr = renderInfo.pModel->GetStudioHeader();
+
+	m_uiSerial = g_uiNextPoseSerial++;
+
+	m_Key = MakeKey( renderInfo );
+
+	glm::vec3* const pos = m_Positions[ 0 ];
+	glm::vec4* const q = m_Quaternions[ 0 ];
+
+	glm::vec3* const pos2 = m_Positions[ 1 ];
+	glm::vec4* const q2 = m_Quaternions[ 1 ];
+	glm::vec3* const pos3 = m_Positions[ 2 ];
+	glm::vec4* const q3 = m_Quaternions[ 2 ];
+	glm::vec3* const pos4 = m_Positions[ 3 ];
+	glm::vec4* const q4 = m_Quaternions[ 3 ];
+
+	const int iSequence = m_pRenderInfo->iSequence < m_pStudioHdr->numseq ? m_pRenderInfo->iSequence : 0;
+
+	const mstudioseqdesc_t* const pseqdesc = m_pStudioHdr->GetSequence( iSequence );
+
+	const auto pView = m_pRenderInfo->pModel->GetValidatedView();
+
+	const mstudioanim_t* panim = pView ? pView->GetAnim( pseqdesc ) : m_pRenderInfo->pModel->GetAnim( pseqdesc );
+
+	const mstudiobone_t* const pbones = m_pStudioHdr->GetBones();
+
+	const bool bUseSIMD = mdl_simdbones.GetBool() && AreSIMDKernelsSupported();
+
+	const bool bFusedBlends = pseqdesc->numblends > 1 && mdl_fusedblends.GetBool();
+
+	// add in programatic controllers
+	CalcBoneAdj();
+
+	if( !panim )
+	{
+		//The sequence group couldn't be loaded, use the bind pose instead.
+		for( int i = 0; i < m_pStudioHdr->numbones; ++i )
+		{
+			pos[ i ] = glm::vec3( pbones[ i ].value[ 0 ], pbones[ i ].value[ 1 ], pbones[ i ].value[ 2 ] );
+			AngleQuaternion( glm::vec3( pbones[ i ].value[ 3 ], pbones[ i ].value[ 4 ], pbones[ i ].value[ 5 ] ), q[ i ] );
+		}
+	}
+	else if( bFusedBlends )
+	{
+		CalcBlendedRotations( pos, q, pseqdesc, panim, m_pRenderInfo->flFrame );
+	}
+	else
+	{
+		CalcRotations( pos, q, pseqdesc, panim, m_pRenderInfo->flFrame );
+	}
+
+	if( panim && pseqdesc->numblends > 1 && !bFusedBlends )
+	{
+		panim += m_pStudioHdr->numbones;
+		CalcRotations( pos2, q2, pseqdesc, panim, m_pRenderInfo->flFrame );
+		float s = m_pRenderInfo->iBlender[ 0 ] / 255.0;
+
+		SlerpBones( q, pos, q2, pos2, s, bUseSIMD );
+
+		if( pseqdesc->numblends == 4 )
+		{
+			panim += m_pStudioHdr->numbones;
+			CalcRotations( pos3, q3, pseqdesc, panim, m_pRenderInfo->flFrame );
+
+			panim += m_pStudioHdr->numbones;
+			CalcRotations( pos4, q4, pseqdesc, panim, m_pRenderInfo->flFrame );
+
+			s = m_pRenderInfo->iBlender[ 0 ] / 255.0;
+			SlerpBones( q3, pos3, q4, pos4, s, bUseSIMD );
+
+			s = m_pRenderInfo->iBlender[ 1 ] / 255.0;
+			SlerpBones( q, pos, q3, pos3, s, bUseSIMD );
+		}
+	}
+
+	//Parents are set up before their children, using the hierarchy that was validated on load.
+	const int* const pBoneOrder = m_pRenderInfo->pModel->GetBoneOrder();
+	const int* const pBoneParents = m_pRenderInfo->pModel->GetBoneParents();
+
+	if( bUseSIMD )
+	{
+		BoneMatricesSIMD( q, pos, m_pStudioHdr->numbones, m_bonetransform );
+		ConcatBoneTransformsSIMD( pBoneOrder, pBoneParents, m_pStudioHdr->numbones, m_bonetransform );
+	}
+	else
+	{
+		glm::mat3x4 bonematrix;
+
+		for( int iIndex = 0; iIndex < m_pStudioHdr->numbones; iIndex++ )
+		{
+			const int i = pBoneOrder[ iIndex ];
+
+			QuaternionMatrix( q[ i ], bonematrix );
+
+			bonematrix[ 0 ][ 3 ] = pos[ i ][ 0 ];
+			bonematrix[ 1 ][ 3 ] = pos[ i ][ 1 ];
+			bonematrix[ 2 ][ 3 ] = pos[ i ][ 2 ];
+
+			if( pBoneParents[ i ] == -1 )
+			{
+				m_bonetransform[ i ] = bonematrix;
+			}
+			else
+			{
+				R_ConcatTransforms( m_bonetransform[ pBoneParents[ i ] ], bonematrix, m_bonetransform[ i ] );
+			}
+		}
+	}
+
+	CalcBounds();
+}
+
+void CStudioPoseContext::SetBoneTransforms( const CModelRenderInfo& renderInfo, const glm::mat3x4* pBoneTransforms )
+{
+	assert( renderInfo.pModel );
+	assert( pBoneTransforms );
+
+	m_pRenderInfo = &renderInfo;
+	m_pStudioHdr = renderInfo.pModel->GetStudioHeader();
+
+	m_uiSerial = g_uiNextPoseSerial++;
+
+	m_Key = MakeKey( renderInfo );
+
+	memcpy( m_bonetransform, pBoneTransforms, sizeof( glm::mat3x4 ) * m_pStudioHdr->numbones );
+
+	CalcBounds();
+}
+
+void CStudioPoseContext::CalcBounds()
+{
+	const StudioBoneBounds_t* const pBoneBounds = m_pRenderInfo->pModel->GetBoneBounds();
+
+	m_bHasBounds = false;
+
+	for( int i = 0; i < m_pStudioHdr->numbones; ++i )
+	{
+		const auto& bounds = pBoneBounds[ i ];
+
+		if( !bounds.bHasVertices )
+			continue;
+
+		const glm::mat3x4& matrix = m_bonetransform[ i ];
+
+		const glm::vec3 vecCenter = ( bounds.vecMins + bounds.vecMaxs ) * 0.5f;
+		const glm::vec3 vecExtents = ( bounds.vecMaxs - bounds.vecMins ) * 0.5f;
+
+		//Transform the box and take the box around that.
+		glm::vec3 vecModelCenter;
+
+		VectorTransform( vecCenter, matrix, vecModelCenter );
+
+		glm::vec3 vecModelExtents;
+
+		for( int j = 0; j < 3; ++j )
+		{
+			vecModelExtents[ j ] = 
+				std::abs( matrix[ j ][ 0 ] ) * vecExtents.x + 
+				std::abs( matrix[ j ][ 1 ] ) * vecExtents.y + 
+				std::abs( matrix[ j ][ 2 ] ) * vecExtents.z;
+		}
+
+		const glm::vec3 vecMins = vecModelCenter - vecModelExtents;
+		const glm::vec3 vecMaxs = vecModelCenter + vecModelExtents;
+
+		if( m_bHasBounds )
+		{
+			m_vecMins = glm::min( m_vecMins, vecMins );
+			m_vecMaxs = glm::max( m_vecMaxs, vecMaxs );
+		}
+		else
+		{
+			m_vecMins = vecMins;
+			m_vecMaxs = vecMaxs;
+			m_bHasBounds = true;
+		}
+	}
+}
+
+void CStudioPoseContext::CalcRotations( glm::vec3* pos, glm::vec4* q, const mstudioseqdesc_t* const pseqdesc, const mstudioanim_t* panim, const float f )
+{
+	const int frame = ( int ) f;
+	const float s = ( f - frame );
+
+	auto pbone = m_pStudioHdr->GetBones();
+
+	const auto decoded = m_pRenderInfo->pModel->GetDecodedAnim( pseqdesc, panim );
+
+	const CDecodedAnim* pDecoded = decoded.get();
+
+	//Frames outside the sequence are walked the old way.
+	if( pDecoded && ( frame < 0 || frame >= pDecoded->GetNumFrames() ) )
+		pDecoded = nullptr;
+
+	for( int i = 0; i < m_pStudioHdr->numbones; i++, pbone++, panim++ )
+	{
+		CalcBoneQuaternion( frame, s, pbone, panim, pDecoded, i, q[ i ] );
+		CalcBonePosition( frame, s, pbone, panim, pDecoded, i, pos[ i ] );
+	}
+
+	if( pseqdesc->motiontype & STUDIO_X )
+		pos[ pseqdesc->motionbone ][ 0 ] = 0.0;
+	if( pseqdesc->motiontype & STUDIO_Y )
+		pos[ pseqdesc->motionbone ][ 1 ] = 0.0;
+	if( pseqdesc->motiontype & STUDIO_Z )
+		pos[ pseqdesc->motionbone ][ 2 ] = 0.0;
+}
+
+void CStudioPoseContext::CalcBlendedRotations( glm::vec3* pos, glm::vec4* q, const mstudioseqdesc_t* const pseqdesc, const mstudioanim_t* panim, const float f )
+{
+	const int frame = ( int ) f;
+	const float s = ( f - frame );
+
+	const int iNumBones = m_pStudioHdr->numbones;
+
+	//Only sequences with exactly 4 blends use the second blender, like the per blend path.
+	const int iNumBlends = pseqdesc->numblends == MAX_BLENDS ? MAX_BLENDS : 2;
+
+	const mstudioanim_t* panims[ MAX_BLENDS ];
+	std::shared_ptr<const CDecodedAnim> decoded[ MAX_BLENDS ];
+	const CDecodedAnim* pDecoded[ MAX_BLENDS ];
+
+	for( int iBlend = 0; iBlend < iNumBlends; ++iBlend )
+	{
+		panims[ iBlend ] = panim + iBlend * iNumBones;
+		decoded[ iBlend ] = m_pRenderInfo->pModel->GetDecodedAnim( pseqdesc, panims[ iBlend ] );
+		pDecoded[ iBlend ] = decoded[ iBlend ].get();
+
+		//Frames outside the sequence are walked the old way.
+		if( pDecoded[ iBlend ] && ( frame < 0 || frame >= pDecoded[ iBlend ]->GetNumFrames() ) )
+			pDecoded[ iBlend ] = nullptr;
+	}
+
+	const float s0 = glm::clamp( GetBlendFraction( m_pRenderInfo->iBlender[ 0 ] ), 0.0f, 1.0f );
+	const float s1 = glm::clamp( GetBlendFraction( m_pRenderInfo->iBlender[ 1 ] ), 0.0f, 1.0f );
+
+	auto pbone = m_pStudioHdr->GetBones();
+
+	for( int i = 0; i < iNumBones; i++, pbone++ )
+	{
+		glm::vec4 blendQ[ MAX_BLENDS ];
+		glm::vec3 blendPos[ MAX_BLENDS ];
+
+		for( int iBlend = 0; iBlend < iNumBlends; ++iBlend )
+		{
+			CalcBoneQuaternion( frame, s, pbone, panims[ iBlend ] + i, pDecoded[ iBlend ], i, blendQ[ iBlend ] );
+			CalcBonePosition( frame, s, pbone, panims[ iBlend ] + i, pDecoded[ iBlend ], i, blendPos[ iBlend ] );
+		}
+
+		//Same order as blending whole poses: the first 2 blends with the first blender, then the other 2, then both results with the second blender.
+		QuaternionSlerp( blendQ[ 0 ], blendQ[ 1 ], s0, q[ i ] );
+		pos[ i ] = blendPos[ 0 ] * ( 1.0f - s0 ) + blendPos[ 1 ] * s0;
+
+		if( iNumBlends == MAX_BLENDS )
+		{
+			glm::vec4 q2;
+
+			QuaternionSlerp( blendQ[ 2 ], blendQ[ 3 ], s0, q2 );
+
+			const glm::vec3 pos2 = blendPos[ 2 ] * ( 1.0f - s0 ) + blendPos[ 3 ] * s0;
+
+			const glm::vec4 q1 = q[ i ];
+
+			QuaternionSlerp( q1, q2, s1, q[ i ] );
+			pos[ i ] = pos[ i ] * ( 1.0f - s1 ) + pos2 * s1;
+		}
+	}
+
+	//Blending zeroed components keeps them zero.
+	if( pseqdesc->motiontype & STUDIO_X )
+		pos[ pseqdesc->motionbone ][ 0 ] = 0.0;
+	if( pseqdesc->motiontype & STUDIO_Y )
+		pos[ pseqdesc->motionbone ][ 1 ] = 0.0;
+	if( pseqdesc->motiontype & STUDIO_Z )
+		pos[ pseqdesc->motionbone ][ 2 ] = 0.0;
+}
+
+void CStudioPoseContext::CalcBoneAdj()
+{
+	const auto* const pbonecontroller = m_pStudioHdr->GetBoneControllers();
+
+	for( int j = 0; j < m_pStudioHdr->numbonecontrollers; j++ )
+	{
+		const auto i = pbonecontroller[ j ].index;
+
+		float value;
+
+		if( i <= 3 )
+		{
+			// check for 360% wrapping
+			if( pbonecontroller[ j ].type & STUDIO_RLOOP )
+			{
+				value = m_pRenderInfo->iController[ i ] * ( 360.0 / 256.0 ) + pbonecontroller[ j ].start;
+			}
+			else
+			{
+				value = m_pRenderInfo->iController[ i ] / 255.0;
+				if( value < 0 ) value = 0;
+				if( value > 1.0 ) value = 1.0;
+				value = ( 1.0 - value ) * pbonecontroller[ j ].start + value * pbonecontroller[ j ].end;
+			}
+			// Con_DPrintf( "%d %d %f : %f\n", m_controller[j], m_prevcontroller[j], value, dadt );
+		}
+		else
+		{
+			value = m_pRenderInfo->iMouth / 64.0;
+			if( value > 1.0 ) value = 1.0;
+			value = ( 1.0 - value ) * pbonecontroller[ j ].start + value * pbonecontroller[ j ].end;
+			// Con_DPrintf("%d %f\n", mouthopen, value );
+		}
+		switch( pbonecontroller[ j ].type & STUDIO_TYPES )
+		{
+		case STUDIO_XR:
+		case STUDIO_YR:
+		case STUDIO_ZR:
+			m_Adj[ j ] = value * ( Q_PI / 180.0 );
+			break;
+		case STUDIO_X:
+		case STUDIO_Y:
+		case STUDIO_Z:
+			m_Adj[ j ] = value;
+			break;
+		}
+	}
+}
+
+void CStudioPoseContext::CalcBoneQuaternion( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, 
+											   const CDecodedAnim* pDecoded, const int iBone, glm::vec4& q )
+{
+	glm::vec3			angle1, angle2;
+
+	for( int j = 0; j < 3; j++ )
+	{
+		if( panim->offset[ j + 3 ] == 0 )
+		{
+			angle2[ j ] = angle1[ j ] = pbone->value[ j + 3 ]; // default;
+		}
+		else if( pDecoded && pDecoded->HasValues( iBone, j + 3 ) )
+		{
+			angle1[ j ] = pbone->value[ j + 3 ] + pDecoded->GetValue( iBone, j + 3, frame ) * pbone->scale[ j + 3 ];
+			angle2[ j ] = pbone->value[ j + 3 ] + pDecoded->GetValue( iBone, j + 3, frame + 1 ) * pbone->scale[ j + 3 ];
+		}
+		else
+		{
+			auto panimvalue = ( const mstudioanimvalue_t* ) ( ( const byte* ) panim + panim->offset[ j + 3 ] );
+			auto k = frame;
+			while( panimvalue->num.total <= k )
+			{
+				k -= panimvalue->num.total;
+				panimvalue += panimvalue->num.valid + 1;
+			}
+			// Bah, missing blend!
+			if( panimvalue->num.valid > k )
+			{
+				angle1[ j ] = panimvalue[ k + 1 ].value;
+
+				if( panimvalue->num.valid > k + 1 )
+				{
+					angle2[ j ] = panimvalue[ k + 2 ].value;
+				}
+				else
+				{
+					if( panimvalue->num.total > k + 1 )
+						angle2[ j ] = angle1[ j ];
+					else
+						angle2[ j ] = panimvalue[ panimvalue->num.valid + 2 ].value;
+				}
+			}
+			else
+			{
+				angle1[ j ] = panimvalue[ panimvalue->num.valid ].value;
+				if( panimvalue->num.total > k + 1 )
+				{
+					angle2[ j ] = angle1[ j ];
+				}
+				else
+				{
+					angle2[ j ] = panimvalue[ panimvalue->num.valid + 2 ].value;
+				}
+			}
+			angle1[ j ] = pbone->value[ j + 3 ] + angle1[ j ] * pbone->scale[ j + 3 ];
+			angle2[ j ] = pbone->value[ j + 3 ] + angle2[ j ] * pbone->scale[ j + 3 ];
+		}
+
+		if( pbone->bonecontroller[ j + 3 ] != -1 )
+		{
+			angle1[ j ] += m_Adj[ pbone->bonecontroller[ j + 3 ] ];
+			angle2[ j ] += m_Adj[ pbone->bonecontroller[ j + 3 ] ];
+		}
+	}
+
+	if( !VectorCompare( angle1, angle2 ) )
+	{
+		glm::vec4 q1, q2;
+
+		AngleQuaternion( angle1, q1 );
+		AngleQuaternion( angle2, q2 );
+		QuaternionSlerp( q1, q2, s, q );
+	}
+	else
+	{
+		AngleQuaternion( angle1, q );
+	}
+}
+
+void CStudioPoseContext::CalcBonePosition( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, 
+											 const CDecodedAnim* pDecoded, const int iBone, glm::vec3& pos )
+{
+	for( int j = 0; j < 3; j++ )
+	{
+		pos[ j ] = pbone->value[ j ]; // default;
+		if( panim->offset[ j ] != 0 && pDecoded && pDecoded->HasValues( iBone, j ) )
+		{
+			if( pDecoded->Interpolates( iBone, j, frame ) )
+			{
+				pos[ j ] += ( pDecoded->GetValue( iBone, j, frame ) * ( 1.0 - s ) + s * pDecoded->GetValue( iBone, j, frame + 1 ) ) * pbone->scale[ j ];
+			}
+			else
+			{
+				pos[ j ] += pDecoded->GetValue( iBone, j, frame ) * pbone->scale[ j ];
+			}
+		}
+		else if( panim->offset[ j ] != 0 )
+		{
+			auto panimvalue = ( mstudioanimvalue_t * ) ( ( byte * ) panim + panim->offset[ j ] );
+
+			auto k = frame;
+			// find span of values that includes the frame we want
+			while( panimvalue->num.total <= k )
+			{
+				k -= panimvalue->num.total;
+				panimvalue += panimvalue->num.valid + 1;
+			}
+			// if we're inside the span
+			if( panimvalue->num.valid > k )
+			{
+				// and there's more data in the span
+				if( panimvalue->num.valid > k + 1 )
+				{
+					pos[ j ] += ( panimvalue[ k + 1 ].value * ( 1.0 - s ) + s * panimvalue[ k + 2 ].value ) * pbone->scale[ j ];
+				}
+				else
+				{
+					pos[ j ] += panimvalue[ k + 1 ].value * pbone->scale[ j ];
+				}
+			}
+			else
+			{
+				// are we at the end of the repeating values section and there's another section with data?
+				if( panimvalue->num.total <= k + 1 )
+				{
+					pos[ j ] += ( panimvalue[ panimvalue->num.valid ].value * ( 1.0 - s ) + s * panimvalue[ panimvalue->num.valid + 2 ].value ) * pbone->scale[ j ];
+				}
+				else
+				{
+					pos[ j ] += panimvalue[ panimvalue->num.valid ].value * pbone->scale[ j ];
+				}
+			}
+		}
+		if( pbone->bonecontroller[ j ] != -1 )
+		{
+			pos[ j ] += m_Adj[ pbone->bonecontroller[ j ] ];
+		}
+	}
+}
+
+void CStudioPoseContext::SlerpBones( glm::vec4* q1, glm::vec3* pos1, glm::vec4* q2, glm::vec3* pos2, float s, const bool bUseSIMD )
+{
+	glm::vec4 q3;
+
+	if( s < 0 ) s = 0;
+	else if( s > 1.0 ) s = 1.0;
+
+	if( bUseSIMD )
+	{
+		SlerpBonesSIMD( q1, pos1, q2, pos2, m_pStudioHdr->numbones, s, mdl_fastnlerp.GetBool() );
+		return;
+	}
+
+	const float s1 = 1.0 - s;
+
+	for( int i = 0; i < m_pStudioHdr->numbones; i++ )
+	{
+		QuaternionSlerp( q1[ i ], q2[ i ], s, q3 );
+		q1[ i ] = q3;
+
+		pos1[ i ] = pos1[ i ] * s1 + pos2[ i ] * s;
+	}
+}
+
+void CStudioPoseContext::TransformVertices( const mstudiomodel_t* pModel, const bool bUseSIMD )
+{
+	assert( pModel );
+	assert( m_pStudioHdr );
+
+	auto pvertbone = m_pStudioHdr->GetData() + pModel->vertinfoindex;
+	auto pstudioverts = ( const glm::vec3* ) ( m_pStudioHdr->GetData() + pModel->vertindex );
+
+	glm::vec3* const pxformverts = m_xformverts.Reserve( pModel->numverts );
+
+	if( bUseSIMD && AreSIMDKernelsSupported() )
+	{
+		TransformVerticesSIMD( pstudioverts, pvertbone, m_bonetransform, pModel->numverts, pxformverts );
+	}
+	else
+	{
+		for( int i = 0; i < pModel->numverts; i++ )
+		{
+			VectorTransform( pstudioverts[ i ], m_bonetransform[ pvertbone[ i ] ], pxformverts[ i ] );
+		}
+	}
+}
+}
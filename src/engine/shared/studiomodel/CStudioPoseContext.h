@@ -0,0 +1,209 @@
+#ifndef GAME_STUDIOMODEL_CSTUDIOPOSECONTEXT_H
+#define GAME_STUDIOMODEL_CSTUDIOPOSECONTEXT_H
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat3x4.hpp>
+
+#include "shared/Const.h"
+
+#include "utility/CScratchBuffer.h"
+
+#include "studio.h"
+
+namespace studiomdl
+{
+class CDecodedAnim;
+class CStudioModel;
+struct CModelRenderInfo;
+
+/**
+*	Holds all of the state needed to pose a model and transform its vertices.
+*	Contexts don't share any state, so different contexts can be used on different threads at the same time.
+*	Posing only reads model data, so the same model can be posed by multiple contexts at once.
+*/
+class CStudioPoseContext final
+{
+public:
+	/**
+	*	The inputs that a pose is set up with. Render infos with equal keys produce the same pose.
+	*/
+	struct PoseKey_t
+	{
+		const CStudioModel* pModel = nullptr;
+		unsigned int uiPoseRevision = 0;
+
+		int iSequence = 0;
+		float flFrame = 0;
+
+		byte iBlender[ 2 ] = { 0, 0 };
+		byte iController[ 4 ] = { 0, 0, 0, 0 };
+		byte iMouth = 0;
+
+		bool operator==( const PoseKey_t& other ) const;
+		bool operator!=( const PoseKey_t& other ) const { return !( *this == other ); }
+
+		size_t Hash() const;
+	};
+
+	/**
+	*	@return The key of the pose that the given render info produces. The render info must have a model.
+	*/
+	static PoseKey_t MakeKey( const CModelRenderInfo& renderInfo );
+
+public:
+	CStudioPoseContext() = default;
+	~CStudioPoseContext() = default;
+
+	/**
+	*	@return The studio header of the model that was last posed, or null if no model has been posed yet.
+	*/
+	const studiohdr_t* GetStudioHeader() const { return m_pStudioHdr; }
+
+	/**
+	*	@return The bone transforms calculated by the last call to SetUpBones.
+	*/
+	const glm::mat3x4* GetBoneTransforms() const { return m_bonetransform; }
+
+	/**
+	*	@return The vertices transformed by the last call to TransformVertices.
+	*/
+	const glm::vec3* GetTransformedVertices() const { return m_xformverts.Get(); }
+
+	/**
+	*	Gets the bounds of the model in the pose set up by the last call to SetUpBones, in model space.
+	*	Computed from the bounds of each bone's vertices, so they contain every submodel, not just the ones that are drawn.
+	*	@return Whether the model has any vertices. If not, the bounds are not set.
+	*/
+	bool GetBounds( glm::vec3& vecMins, glm::vec3& vecMaxs ) const
+	{
+		if( !m_bHasBounds )
+			return false;
+
+		vecMins = m_vecMins;
+		vecMaxs = m_vecMaxs;
+
+		return true;
+	}
+
+	/**
+	*	@return Identifies the bone transforms calculated by the last call to SetUpBones.
+	*	Changes every time bones are set up, and is never the same for two contexts.
+	*/
+	unsigned int GetSerial() const { return m_uiSerial; }
+
+	/**
+	*	@return Whether the bones were set up for a render info that produces the same pose as the given one,
+	*	and the model's pose data hasn't changed since.
+	*/
+	bool Matches( const CModelRenderInfo& renderInfo ) const;
+
+	/**
+	*	Marks the current pose as out of date.
+	*/
+	void Invalidate() { m_Key.pModel = nullptr; }
+
+	/**
+	*	Calculates the bone transforms for the given model state.
+	*	@param renderInfo Model state. If the sequence is out of range, sequence 0 is used.
+	*/
+	void SetUpBones( const CModelRenderInfo& renderInfo );
+
+	/**
+	*	Uses bone transforms that were set up before, like those of a baked pose track, instead of setting up bones.
+	*	@param renderInfo Model state that the transforms were set up for.
+	*	@param pBoneTransforms One transform for each bone of the model.
+	*/
+	void SetBoneTransforms( const CModelRenderInfo& renderInfo, const glm::mat3x4* pBoneTransforms );
+
+	/**
+	*	Transforms a model's vertices by the current bone transforms.
+	*	@param pModel Model whose vertices should be transformed. Must be part of the model passed to the last SetUpBones call.
+	*	@param bUseSIMD Whether to use SIMD kernels, if the CPU supports them.
+	*/
+	void TransformVertices( const mstudiomodel_t* pModel, const bool bUseSIMD );
+
+private:
+	/**
+	*	Calculates the rotations and positions of all bones for one blend. CalcBoneAdj must have been called.
+	*/
+	void CalcRotations( glm::vec3* pos, glm::vec4* q, const mstudioseqdesc_t* const pseqdesc, const mstudioanim_t* panim, const float f );
+
+	/**
+	*	Calculates the rotations and positions of all bones for a sequence with 2 or 4 blends. CalcBoneAdj must have been called.
+	*	Every blend of a bone is decoded and blended before moving on to the next bone, so no per blend poses are stored.
+	*	@param panim Animation data of the first blend.
+	*/
+	void CalcBlendedRotations( glm::vec3* pos, glm::vec4* q, const mstudioseqdesc_t* const pseqdesc, const mstudioanim_t* panim, const float f );
+
+	/**
+	*	Calculates the bone controller adjustments. Controllers are the same for every blend, so this is done once per pose.
+	*/
+	void CalcBoneAdj();
+
+	/**
+	*	Calculates a bone's rotation. If pDecoded is non-null, values are read from it instead of walking the run length encoded data.
+	*/
+	void CalcBoneQuaternion( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, 
+							 const CDecodedAnim* pDecoded, const int iBone, glm::vec4& q );
+
+	/**
+	*	Calculates a bone's position. If pDecoded is non-null, values are read from it instead of walking the run length encoded data.
+	*/
+	void CalcBonePosition( const int frame, const float s, const mstudiobone_t* const pbone, const mstudioanim_t* const panim, 
+						   const CDecodedAnim* pDecoded, const int iBone, glm::vec3& pos );
+
+	/**
+	*	Blends the second set of bones into the first.
+	*	@param bUseSIMD Whether to use the SIMD kernel. The caller must check AreSIMDKernelsSupported.
+	*/
+	void SlerpBones( glm::vec4* q1, glm::vec3* pos1, glm::vec4* q2, glm::vec3* pos2, float s, const bool bUseSIMD );
+
+	/**
+	*	Computes the pose's bounds from the bone transforms and the bounds of each bone's vertices.
+	*/
+	void CalcBounds();
+
+private:
+	/**
+	*	Maximum number of sequence blends.
+	*/
+	static const int MAX_BLENDS = 4;
+
+	/**
+	*	The inputs that the current pose was set up with.
+	*/
+	PoseKey_t m_Key;
+
+	unsigned int m_uiSerial = 0;
+
+	/**
+	*	Only valid during SetUpBones.
+	*/
+	const CModelRenderInfo* m_pRenderInfo = nullptr;
+
+	const studiohdr_t* m_pStudioHdr = nullptr;
+
+	glm::vec3		m_Positions[ MAX_BLENDS ][ MAXSTUDIOBONES ];
+	glm::vec4		m_Quaternions[ MAX_BLENDS ][ MAXSTUDIOBONES ];
+
+	glm::mat3x4		m_bonetransform[ MAXSTUDIOBONES ];	// bone transformation matrix
+
+	vec_t			m_Adj[ MAXSTUDIOCONTROLLERS ];		//This used to be a vec4, but it really needs to be this.
+
+	/**
+	*	Transformed vertices. Sized to the largest submodel transformed so far, so contexts for small models stay small.
+	*/
+	CScratchBuffer<glm::vec3> m_xformverts;
+
+	bool			m_bHasBounds = false;
+	glm::vec3		m_vecMins;
+	glm::vec3		m_vecMaxs;
+
+private:
+	CStudioPoseContext( const CStudioPoseContext& ) = delete;
+	CStudioPoseContext& operator=( const CStudioPoseContext& ) = delete;
+};
+}
+
+#endif //GAME_STUDIOMODEL_CSTUDIOPOSECONTEXT_H
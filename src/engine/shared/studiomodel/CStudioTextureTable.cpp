@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cassert>
+
+#include "shared/Logging.h"
+
+#include "cvar/CConCommand.h"
+
+#include "CStudioModel.h"
+
+#include "CStudioTextureTable.h"
+
+namespace studiomdl
+{
+namespace
+{
+static cvar::CConCommand mdl_sharedtextures( "mdl_sharedtextures",
+	[]( const util::CCommand& )
+	{
+		const auto stats = StudioTextureTable().GetStats();
+
+		Message( "%u shared textures used by %u model textures, saving %.2f MB\n",
+				 static_cast<unsigned int>( stats.uiTextures ), static_cast<unsigned int>( stats.uiReferences ),
+				 stats.uiSavedSize / ( 1024.0 * 1024.0 ) );
+	},
+	cvar::Flag::NONE, "Prints how many textures are shared between studio models" );
+}
+
+CStudioTextureTable& StudioTextureTable()
+{
+	static CStudioTextureTable table;
+
+	return table;
+}
+
+bool CStudioTextureTable::CEntry::RestoreTexture( renderer::HTexture_t hTexture )
+{
+	if( holders.empty() )
+		return false;
+
+	//Every user has the same source texture, so any of them can restore it.
+	return holders.front().pModel->RestoreTexture( hTexture );
+}
+
+GLuint CStudioTextureTable::Acquire( const Key_t& key, CStudioModel& model, const int iIndex )
+{
+	auto it = m_Entries.find( key );
+
+	if( it == m_Entries.end() )
+		return 0;
+
+	auto& entry = *it->second;
+
+	entry.holders.push_back( { &model, iIndex } );
+
+	return entry.name;
+}
+
+renderer::ITextureSource* CStudioTextureTable::Add( const Key_t& key, const GLuint name, const size_t uiSize, CStudioModel& model, const int iIndex )
+{
+	assert( name != 0 );
+	assert( m_EntriesByName.find( name ) == m_EntriesByName.end() );
+
+	//Two models can upload the same texture before either has been added. The second one is not shared.
+	if( m_Entries.find( key ) != m_Entries.end() )
+		return nullptr;
+
+	auto entry = std::make_unique<CEntry>();
+
+	entry->key = key;
+	entry->name = name;
+	entry->uiSize = uiSize;
+	entry->holders.push_back( { &model, iIndex } );
+
+	CEntry* const pEntry = entry.get();
+
+	m_Entries.emplace( key, std::move( entry ) );
+	m_EntriesByName.emplace( name, pEntry );
+
+	return pEntry;
+}
+
+bool CStudioTextureTable::Contains( const GLuint name ) const
+{
+	return m_EntriesByName.find( name ) != m_EntriesByName.end();
+}
+
+bool CStudioTextureTable::Release( const GLuint name, CStudioModel& model, const int iIndex, Holder_t& newPayer )
+{
+	newPayer = Holder_t();
+
+	auto it = m_EntriesByName.find( name );
+
+	if( it == m_EntriesByName.end() )
+		return false;
+
+	auto& entry = *it->second;
+
+	auto holder = std::find_if( entry.holders.begin(), entry.holders.end(), [ & ]( const Holder_t& candidate )
+	{
+		return candidate.pModel == &model && candidate.iIndex == iIndex;
+	} );
+
+	assert( holder != entry.holders.end() );
+
+	if( holder == entry.holders.end() )
+		return entry.holders.size() > 0;
+
+	const bool bWasPayer = holder == entry.holders.begin();
+
+	entry.holders.erase( holder );
+
+	if( !entry.holders.empty() )
+	{
+		if( bWasPayer )
+			newPayer = entry.holders.front();
+
+		return true;
+	}
+
+	const Key_t key = entry.key;
+
+	m_EntriesByName.erase( it );
+	m_Entries.erase( key );
+
+	return false;
+}
+
+bool CStudioTextureTable::Transfer( const GLuint name, const CStudioModel& from, const int iFromIndex, CStudioModel& to, const int iToIndex )
+{
+	auto it = m_EntriesByName.find( name );
+
+	if( it == m_EntriesByName.end() )
+		return false;
+
+	for( auto& holder : it->second->holders )
+	{
+		if( holder.pModel == &from && holder.iIndex == iFromIndex )
+		{
+			//Stays in the same position, so whoever paid for it still does.
+			holder.pModel = &to;
+			holder.iIndex = iToIndex;
+			return true;
+		}
+	}
+
+	assert( !"CStudioTextureTable::Transfer: Model does not use the texture" );
+
+	return true;
+}
+
+size_t CStudioTextureTable::GetSize( const GLuint name ) const
+{
+	auto it = m_EntriesByName.find( name );
+
+	if( it == m_EntriesByName.end() )
+		return 0;
+
+	return it->second->uiSize;
+}
+
+CStudioTextureTable::Stats_t CStudioTextureTable::GetStats() const
+{
+	Stats_t stats;
+
+	stats.uiTextures = m_Entries.size();
+
+	for( const auto& entry : m_Entries )
+	{
+		const size_t uiHolders = entry.second->holders.size();
+
+		stats.uiReferences += uiHolders;
+
+		if( uiHolders > 1 )
+			stats.uiSavedSize += ( uiHolders - 1 ) * entry.second->uiSize;
+	}
+
+	return stats;
+}
+}
@@ -0,0 +1,161 @@
+#ifndef GAME_STUDIOMODEL_CSTUDIOTEXTURETABLE_H
+#define GAME_STUDIOMODEL_CSTUDIOTEXTURETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "graphics/OpenGL.h"
+
+#include "engine/shared/renderer/IRenderContext.h"
+
+namespace studiomdl
+{
+class CStudioModel;
+
+/**
+*	Shares textures between models that contain identical textures, so each one is only uploaded and stored once.
+*	Textures are identified by a hash of their source pixels, palette and flags, and by the settings they were uploaded with.
+*	A shared texture is kept for as long as any model still uses it.
+*	Only one model pays for a shared texture in memory statistics. When it stops using the texture, another one takes over.
+*	Must only be used on the thread that owns the OpenGL context.
+*/
+class CStudioTextureTable final
+{
+public:
+	struct Key_t
+	{
+		uint64_t uiHash = 0;
+
+		/**
+		*	Size of the uploaded texture, which differs from the source's if it was resized.
+		*/
+		int iWidth = 0;
+		int iHeight = 0;
+
+		bool bFilter = false;
+
+		bool operator==( const Key_t& other ) const
+		{
+			return uiHash == other.uiHash && iWidth == other.iWidth && iHeight == other.iHeight && bFilter == other.bFilter;
+		}
+	};
+
+	/**
+	*	A texture of a model that uses a shared texture.
+	*/
+	struct Holder_t
+	{
+		CStudioModel* pModel = nullptr;
+		int iIndex = -1;
+	};
+
+	struct Stats_t
+	{
+		size_t uiTextures = 0;
+		size_t uiReferences = 0;
+
+		/**
+		*	Estimated amount of video memory that would have been used by copies, in bytes.
+		*/
+		size_t uiSavedSize = 0;
+	};
+
+public:
+	CStudioTextureTable() = default;
+	~CStudioTextureTable() = default;
+
+	/**
+	*	Starts using the shared texture with the given key, if there is one.
+	*	@return The shared texture's name, or 0 if there is no texture with the given key.
+	*/
+	GLuint Acquire( const Key_t& key, CStudioModel& model, const int iIndex );
+
+	/**
+	*	Adds a texture that has just been uploaded. The given model is its first user, and pays for it.
+	*	@param name Name of the texture. Must not be in the table already.
+	*	@param uiSize Estimated size of the texture, in bytes.
+	*	@return The source that the texture should be registered with. It restores the texture from whichever model uses it.
+	*/
+	renderer::ITextureSource* Add( const Key_t& key, const GLuint name, const size_t uiSize, CStudioModel& model, const int iIndex );
+
+	/**
+	*	@return Whether the given texture name is a shared texture.
+	*/
+	bool Contains( const GLuint name ) const;
+
+	/**
+	*	Stops using a shared texture.
+	*	@param name Name of the texture.
+	*	@param model Model that is no longer using it.
+	*	@param iIndex Index of the model's texture.
+	*	@param[ out ] newPayer If the model paid for the texture and other models still use it, the one that should pay for it from now on.
+	*		Otherwise, its model is null.
+	*	@return Whether other models still use the texture. If not, it's removed from the table and has to be unregistered and deleted.
+	*/
+	bool Release( const GLuint name, CStudioModel& model, const int iIndex, Holder_t& newPayer );
+
+	/**
+	*	Hands a model's use of a shared texture over to another model, as if the other one had acquired it and this one released it.
+	*	@return Whether the texture is a shared texture. Nothing is changed if it isn't.
+	*/
+	bool Transfer( const GLuint name, const CStudioModel& from, const int iFromIndex, CStudioModel& to, const int iToIndex );
+
+	/**
+	*	@return The estimated size of a shared texture, in bytes, or 0 if it isn't a shared texture.
+	*/
+	size_t GetSize( const GLuint name ) const;
+
+	Stats_t GetStats() const;
+
+private:
+	struct KeyHash_t
+	{
+		size_t operator()( const Key_t& key ) const
+		{
+			//The content hash is already well distributed.
+			return static_cast<size_t>( key.uiHash ^ ( static_cast<uint64_t>( key.iWidth ) << 32 ) ^ ( static_cast<uint64_t>( key.iHeight ) << 16 ) ^ key.bFilter );
+		}
+	};
+
+	class CEntry final : public renderer::ITextureSource
+	{
+	public:
+		CEntry() = default;
+
+		bool RestoreTexture( renderer::HTexture_t hTexture ) override;
+
+		Key_t key;
+
+		GLuint name = 0;
+		size_t uiSize = 0;
+
+		/**
+		*	Models that use the texture. The first one pays for it.
+		*/
+		std::vector<Holder_t> holders;
+
+	private:
+		CEntry( const CEntry& ) = delete;
+		CEntry& operator=( const CEntry& ) = delete;
+	};
+
+private:
+	std::unordered_map<Key_t, std::unique_ptr<CEntry>, KeyHash_t> m_Entries;
+
+	std::unordered_map<GLuint, CEntry*> m_EntriesByName;
+
+private:
+	CStudioTextureTable( const CStudioTextureTable& ) = delete;
+	CStudioTextureTable& operator=( const CStudioTextureTable& ) = delete;
+};
+
+/**
+*	@return The table of textures shared by all studio models.
+*/
+CStudioTextureTable& StudioTextureTable();
+}
+
+#endif //GAME_STUDIOMODEL_CSTUDIOTEXTURETABLE_H
@@ -0,0 +1,85 @@
+#include <climits>
+#include <cstdint>
+
+#include "CStudioModel.h"
+#include "CStudioModelView.h"
+#include "StudioBodygroups.h"
+
+namespace studiomdl
+{
+void CBodygroupSubModels::Resolve( const CStudioModel& model, const int iBody )
+{
+	const int iNumBodyParts = model.GetStudioHeader()->numbodyparts;
+
+	m_SubModels.resize( iNumBodyParts > 0 ? iNumBodyParts : 0 );
+
+	const CStudioModelView* const pView = model.GetValidatedView();
+
+	for( int iBodyPart = 0; iBodyPart < iNumBodyParts; ++iBodyPart )
+	{
+		m_SubModels[ iBodyPart ] = pView ? pView->GetModelByBodyPart( iBody, iBodyPart ) : model.GetModelByBodyPart( iBody, iBodyPart );
+	}
+
+	m_pModel = &model;
+	m_iBody = iBody;
+	m_bValid = true;
+}
+
+CBodygroupEnumerator::CBodygroupEnumerator( const CStudioModel& model )
+{
+	const studiohdr_t* const pStudioHdr = model.GetStudioHeader();
+
+	m_BodyParts.reserve( pStudioHdr->numbodyparts > 0 ? pStudioHdr->numbodyparts : 0 );
+
+	for( int iBodyPart = 0; iBodyPart < pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		BodyPart_t bodyPart{ model.GetModelByBodyPart( 0, iBodyPart ), 1, 1, 0 };
+
+		//Only body parts whose models were all found can be stepped through; the others stay at their first model or null.
+		if( bodyPart.pFirst )
+		{
+			const mstudiobodyparts_t* const pbodypart = pStudioHdr->GetBodypart( iBodyPart );
+
+			const int64_t iLastBody = static_cast<int64_t>( pbodypart->base ) * ( pbodypart->nummodels - 1 );
+
+			if( iLastBody <= INT_MAX && model.GetModelByBodyPart( static_cast<int>( iLastBody ), iBodyPart ) )
+			{
+				bodyPart.iBase = pbodypart->base;
+				bodyPart.iNumModels = pbodypart->nummodels;
+			}
+		}
+
+		m_BodyParts.emplace_back( bodyPart );
+	}
+}
+
+size_t CBodygroupEnumerator::GetCount() const
+{
+	size_t uiCount = 1;
+
+	for( const auto& bodyPart : m_BodyParts )
+	{
+		uiCount *= bodyPart.iNumModels;
+	}
+
+	return uiCount;
+}
+
+bool CBodygroupEnumerator::Next()
+{
+	for( auto& bodyPart : m_BodyParts )
+	{
+		if( ++bodyPart.iIndex < bodyPart.iNumModels )
+		{
+			m_iBody += bodyPart.iBase;
+			return true;
+		}
+
+		//Wrap around and carry into the next body part.
+		m_iBody -= bodyPart.iBase * ( bodyPart.iNumModels - 1 );
+		bodyPart.iIndex = 0;
+	}
+
+	return false;
+}
+}
@@ -0,0 +1,130 @@
+#ifndef GAME_STUDIOMODEL_STUDIOBODYGROUPS_H
+#define GAME_STUDIOMODEL_STUDIOBODYGROUPS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "studio.h"
+
+namespace studiomdl
+{
+class CStudioModel;
+
+/**
+*	The submodels selected by a bodygroup value, one for each body part.
+*	Resolving a bodygroup divides by each body part's base, so this is done once when the value changes instead of every time a model is drawn.
+*/
+class CBodygroupSubModels final
+{
+public:
+	CBodygroupSubModels() = default;
+
+	/**
+	*	@return Whether the submodels were resolved for the given model and bodygroup value.
+	*/
+	bool IsValid( const CStudioModel* pModel, const int iBody ) const
+	{
+		return m_bValid && m_pModel == pModel && m_iBody == iBody;
+	}
+
+	/**
+	*	Forces the submodels to be resolved again the next time they're needed.
+	*/
+	void Invalidate() { m_bValid = false; }
+
+	/**
+	*	Resolves the submodels of a bodygroup value. Body parts that are invalid get a null submodel.
+	*/
+	void Resolve( const CStudioModel& model, const int iBody );
+
+	size_t GetCount() const { return m_SubModels.size(); }
+
+	/**
+	*	@return The submodels, indexed by body part, or null if the model has no body parts.
+	*/
+	mstudiomodel_t* const* GetSubModels() const { return m_SubModels.empty() ? nullptr : m_SubModels.data(); }
+
+	mstudiomodel_t* GetSubModel( const int iBodyPart ) const
+	{
+		return iBodyPart >= 0 && static_cast<size_t>( iBodyPart ) < m_SubModels.size() ? m_SubModels[ iBodyPart ] : nullptr;
+	}
+
+private:
+	const CStudioModel* m_pModel = nullptr;
+
+	int m_iBody = 0;
+
+	bool m_bValid = false;
+
+	std::vector<mstudiomodel_t*> m_SubModels;
+};
+
+/**
+*	Walks every combination of submodels, starting at bodygroup 0.
+*	Moving to the next combination steps the first body part and carries into the next ones, so bodygroup values are never divided.
+*	Usage:
+*	for( CBodygroupEnumerator bodygroups( model ); ; )
+*	{
+*		//Use bodygroups.GetBody(), bodygroups.GetSubModel( iBodyPart )
+*		if( !bodygroups.Next() )
+*			break;
+*	}
+*/
+class CBodygroupEnumerator final
+{
+public:
+	CBodygroupEnumerator( const CStudioModel& model );
+
+	/**
+	*	@return The bodygroup value of the current combination.
+	*/
+	int GetBody() const { return m_iBody; }
+
+	/**
+	*	@return Index of the current submodel in a body part.
+	*/
+	int GetSubModelIndex( const int iBodyPart ) const { return m_BodyParts[ iBodyPart ].iIndex; }
+
+	/**
+	*	@return The current submodel of a body part, or null if the body part is invalid.
+	*/
+	mstudiomodel_t* GetSubModel( const int iBodyPart ) const
+	{
+		const BodyPart_t& bodyPart = m_BodyParts[ iBodyPart ];
+
+		return bodyPart.pFirst ? bodyPart.pFirst + bodyPart.iIndex : nullptr;
+	}
+
+	/**
+	*	@return The number of combinations.
+	*/
+	size_t GetCount() const;
+
+	/**
+	*	Moves to the next combination.
+	*	@return Whether there was another combination. If not, the enumerator is back at bodygroup 0.
+	*/
+	bool Next();
+
+private:
+	struct BodyPart_t
+	{
+		mstudiomodel_t* pFirst;
+
+		int iBase;
+		int iNumModels;
+
+		int iIndex;
+	};
+
+	std::vector<BodyPart_t> m_BodyParts;
+
+	int m_iBody = 0;
+
+private:
+	CBodygroupEnumerator( const CBodygroupEnumerator& ) = delete;
+	CBodygroupEnumerator& operator=( const CBodygroupEnumerator& ) = delete;
+};
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOBODYGROUPS_H
@@ -0,0 +1,741 @@
+#include <algorithm>
+#include <cassert>
+
+#include <emmintrin.h>
+
+#include "utility/mathlib.h"
+#include "utility/PlatUtils.h"
+
+#include "studio.h"
+
+#include "StudioKernels.h"
+
+namespace studiomdl
+{
+namespace
+{
+enum class LightingMode
+{
+	FULLBRIGHT,
+	FLATSHADE,
+	NORMAL,
+
+	/**
+	*	Regular lighting using the parameters' lookup table.
+	*/
+	LUT
+};
+
+/**
+*	Scales illumination down so its brightest component is at most 1, then applies the light color.
+*/
+inline glm::vec3 FinishLighting( const glm::vec3& illum, const glm::vec3& vecLightColor )
+{
+	const float max = VectorMax( illum );
+
+	glm::vec3 lv;
+
+	if( max > 1.0f )
+		lv = illum * ( 1.0f / max );
+	else
+		lv = illum;
+
+	return lv * vecLightColor;
+}
+
+/**
+*	Lights normals using a single lighting mode. MODE is a constant, so only the code for that mode is left in the loop.
+*/
+template<LightingMode MODE>
+void LightNormals( const glm::vec3* pNormals, const byte* pBones, const glm::vec3* pBoneLightVecs, const int iCount, const StudioLightingParams_t& params, glm::vec3* pOut )
+{
+	if( MODE == LightingMode::FULLBRIGHT )
+	{
+		for( int i = 0; i < iCount; ++i )
+		{
+			pOut[ i ] = glm::vec3{ 1, 1, 1 };
+		}
+	}
+	else if( MODE == LightingMode::FLATSHADE )
+	{
+		//Doesn't depend on the normal, so every normal gets the same value.
+		glm::vec3 illum{ params.flAmbient };
+
+		VectorMA( illum, 0.8f, glm::vec3{ params.flShade }, illum );
+
+		const glm::vec3 lv = FinishLighting( illum, params.vecLightColor );
+
+		for( int i = 0; i < iCount; ++i )
+		{
+			pOut[ i ] = lv;
+		}
+	}
+	else if( MODE == LightingMode::LUT )
+	{
+		const float flScale = LIGHTING_LUT_SIZE * 0.5f;
+
+		for( int i = 0; i < iCount; ++i )
+		{
+			auto lightcos = glm::dot( pNormals[ i ], pBoneLightVecs[ pBones[ i ] ] ); // -1 colinear, 1 opposite
+
+			//Written so NaN is clamped as well.
+			if( !( lightcos > -1.0f ) ) lightcos = -1;
+			if( lightcos > 1.0f ) lightcos = 1;
+
+			const float flPosition = ( lightcos + 1.0f ) * flScale;
+
+			const int iIndex = std::min( static_cast<int>( flPosition ), LIGHTING_LUT_SIZE - 1 );
+
+			const float flFraction = flPosition - iIndex;
+
+			const float flIntensity = params.flLUT[ iIndex ] + ( params.flLUT[ iIndex + 1 ] - params.flLUT[ iIndex ] ) * flFraction;
+
+			pOut[ i ] = glm::vec3( flIntensity ) * params.vecLightColor;
+		}
+	}
+	else
+	{
+		for( int i = 0; i < iCount; ++i )
+		{
+			auto lightcos = glm::dot( pNormals[ i ], pBoneLightVecs[ pBones[ i ] ] ); // -1 colinear, 1 opposite
+
+			if( lightcos > 1.0f ) lightcos = 1;
+
+			glm::vec3 illum{ params.flIllum };
+
+			lightcos = ( lightcos + ( params.flLambert - 1.0f ) ) / params.flLambert; // do modified hemispherical lighting
+			if( lightcos > 0.0f ) VectorMA( illum, -lightcos, glm::vec3{ params.flShade }, illum );
+
+			if( illum[ 0 ] <= 0 ) illum[ 0 ] = 0;
+			if( illum[ 1 ] <= 0 ) illum[ 1 ] = 0;
+			if( illum[ 2 ] <= 0 ) illum[ 2 ] = 0;
+
+			pOut[ i ] = FinishLighting( illum, params.vecLightColor );
+		}
+	}
+}
+
+/**
+*	Computes 2.0 * a * b in the order QuaternionMatrix does.
+*/
+SSE2_TARGET inline __m128d Mul2( const __m128d a, const __m128d b )
+{
+	return _mm_mul_pd( _mm_mul_pd( _mm_set1_pd( 2.0 ), a ), b );
+}
+
+/**
+*	Converts 2 quaternions to rotation matrices. QuaternionMatrix operates in double precision, so this does too.
+*	@param m Receives each matrix element for both quaternions.
+*/
+SSE2_TARGET inline void QuaternionMatricesPD( const __m128d x, const __m128d y, const __m128d z, const __m128d w, __m128d ( &m )[ 3 ][ 3 ] )
+{
+	const __m128d one = _mm_set1_pd( 1.0 );
+
+	m[ 0 ][ 0 ] = _mm_sub_pd( _mm_sub_pd( one, Mul2( y, y ) ), Mul2( z, z ) );
+	m[ 1 ][ 0 ] = _mm_add_pd( Mul2( x, y ), Mul2( w, z ) );
+	m[ 2 ][ 0 ] = _mm_sub_pd( Mul2( x, z ), Mul2( w, y ) );
+
+	m[ 0 ][ 1 ] = _mm_sub_pd( Mul2( x, y ), Mul2( w, z ) );
+	m[ 1 ][ 1 ] = _mm_sub_pd( _mm_sub_pd( one, Mul2( x, x ) ), Mul2( z, z ) );
+	m[ 2 ][ 1 ] = _mm_add_pd( Mul2( y, z ), Mul2( w, x ) );
+
+	m[ 0 ][ 2 ] = _mm_add_pd( Mul2( x, z ), Mul2( w, y ) );
+	m[ 1 ][ 2 ] = _mm_sub_pd( Mul2( y, z ), Mul2( w, x ) );
+	m[ 2 ][ 2 ] = _mm_sub_pd( _mm_sub_pd( one, Mul2( x, x ) ), Mul2( y, y ) );
+}
+
+/**
+*	Loads 4 quaternions and transposes them so each register holds a single component of every quaternion.
+*/
+SSE2_TARGET inline void LoadQuaternions( const glm::vec4* pQuaternions, __m128& x, __m128& y, __m128& z, __m128& w )
+{
+	x = _mm_loadu_ps( &pQuaternions[ 0 ][ 0 ] );
+	y = _mm_loadu_ps( &pQuaternions[ 1 ][ 0 ] );
+	z = _mm_loadu_ps( &pQuaternions[ 2 ][ 0 ] );
+	w = _mm_loadu_ps( &pQuaternions[ 3 ][ 0 ] );
+
+	_MM_TRANSPOSE4_PS( x, y, z, w );
+}
+}
+
+void BuildLightingLUT( StudioLightingParams_t& params )
+{
+	//Light with a white light so every component holds the intensity.
+	const glm::vec3 vecWhite{ 1, 1, 1 };
+
+	for( int iEntry = 0; iEntry <= LIGHTING_LUT_SIZE; ++iEntry )
+	{
+		auto lightcos = -1.0f + iEntry * ( 2.0f / LIGHTING_LUT_SIZE );
+
+		if( lightcos > 1.0f ) lightcos = 1;
+
+		glm::vec3 illum{ params.flIllum };
+
+		lightcos = ( lightcos + ( params.flLambert - 1.0f ) ) / params.flLambert;
+		if( lightcos > 0.0f ) VectorMA( illum, -lightcos, glm::vec3{ params.flShade }, illum );
+
+		if( illum[ 0 ] <= 0 ) illum[ 0 ] = 0;
+
+		params.flLUT[ iEntry ] = FinishLighting( glm::vec3{ illum[ 0 ] }, vecWhite )[ 0 ];
+	}
+
+	params.bHasLUT = true;
+}
+
+bool AreSIMDKernelsSupported()
+{
+	static const bool bSupported = plat::IsSSE2Supported();
+
+	return bSupported;
+}
+
+//The order of operations in these kernels matches the scalar code exactly so results are identical. Do not reorder them.
+
+SSE2_TARGET void TransformVerticesSIMD( const glm::vec3* pVerts, const byte* pBones, const glm::mat3x4* pBoneTransforms, const int iCount, glm::vec3* pOut )
+{
+	int i = 0;
+
+	for( ; i + 4 <= iCount; i += 4 )
+	{
+		const __m128 x = _mm_set_ps( pVerts[ i + 3 ].x, pVerts[ i + 2 ].x, pVerts[ i + 1 ].x, pVerts[ i ].x );
+		const __m128 y = _mm_set_ps( pVerts[ i + 3 ].y, pVerts[ i + 2 ].y, pVerts[ i + 1 ].y, pVerts[ i ].y );
+		const __m128 z = _mm_set_ps( pVerts[ i + 3 ].z, pVerts[ i + 2 ].z, pVerts[ i + 1 ].z, pVerts[ i ].z );
+
+		float out[ 3 ][ 4 ];
+
+		for( int iRow = 0; iRow < 3; ++iRow )
+		{
+			//Load this row for all 4 vertices, then transpose so each register holds a single matrix element for every vertex.
+			__m128 m0 = _mm_loadu_ps( &pBoneTransforms[ pBones[ i ] ][ iRow ][ 0 ] );
+			__m128 m1 = _mm_loadu_ps( &pBoneTransforms[ pBones[ i + 1 ] ][ iRow ][ 0 ] );
+			__m128 m2 = _mm_loadu_ps( &pBoneTransforms[ pBones[ i + 2 ] ][ iRow ][ 0 ] );
+			__m128 m3 = _mm_loadu_ps( &pBoneTransforms[ pBones[ i + 3 ] ][ iRow ][ 0 ] );
+
+			_MM_TRANSPOSE4_PS( m0, m1, m2, m3 );
+
+			const __m128 result = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m0 ), _mm_mul_ps( y, m1 ) ), _mm_mul_ps( z, m2 ) ), m3 );
+
+			_mm_storeu_ps( out[ iRow ], result );
+		}
+
+		for( int iVert = 0; iVert < 4; ++iVert )
+		{
+			pOut[ i + iVert ] = glm::vec3( out[ 0 ][ iVert ], out[ 1 ][ iVert ], out[ 2 ][ iVert ] );
+		}
+	}
+
+	for( ; i < iCount; ++i )
+	{
+		VectorTransform( pVerts[ i ], pBoneTransforms[ pBones[ i ] ], pOut[ i ] );
+	}
+}
+
+SSE2_TARGET void LightNormalsSIMD( const glm::vec3* pNormals, const byte* pBones, const glm::vec3* pBoneLightVecs, const int iCount, const StudioLightingParams_t& params, glm::vec3* pOut )
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 illumBase = _mm_set1_ps( params.flIllum );
+	const __m128 lambert = _mm_set1_ps( params.flLambert );
+	const __m128 lambertOffset = _mm_set1_ps( params.flLambert - 1.0f );
+	const __m128d shade = _mm_set1_pd( params.flShade );
+
+	int i = 0;
+
+	for( ; i + 4 <= iCount; i += 4 )
+	{
+		const glm::vec3& b0 = pBoneLightVecs[ pBones[ i ] ];
+		const glm::vec3& b1 = pBoneLightVecs[ pBones[ i + 1 ] ];
+		const glm::vec3& b2 = pBoneLightVecs[ pBones[ i + 2 ] ];
+		const glm::vec3& b3 = pBoneLightVecs[ pBones[ i + 3 ] ];
+
+		const __m128 nx = _mm_set_ps( pNormals[ i + 3 ].x, pNormals[ i + 2 ].x, pNormals[ i + 1 ].x, pNormals[ i ].x );
+		const __m128 ny = _mm_set_ps( pNormals[ i + 3 ].y, pNormals[ i + 2 ].y, pNormals[ i + 1 ].y, pNormals[ i ].y );
+		const __m128 nz = _mm_set_ps( pNormals[ i + 3 ].z, pNormals[ i + 2 ].z, pNormals[ i + 1 ].z, pNormals[ i ].z );
+
+		const __m128 bx = _mm_set_ps( b3.x, b2.x, b1.x, b0.x );
+		const __m128 by = _mm_set_ps( b3.y, b2.y, b1.y, b0.y );
+		const __m128 bz = _mm_set_ps( b3.z, b2.z, b1.z, b0.z );
+
+		__m128 lightcos = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, bx ), _mm_mul_ps( ny, by ) ), _mm_mul_ps( nz, bz ) );
+
+		//Operand order makes NaN pass through like the scalar comparison does.
+		lightcos = _mm_min_ps( one, lightcos );
+
+		lightcos = _mm_div_ps( _mm_add_ps( lightcos, lambertOffset ), lambert );
+
+		//VectorMA operates in double precision.
+		const __m128 negLightcos = _mm_sub_ps( zero, lightcos );
+
+		const __m128d illumLo = _mm_add_pd( _mm_cvtps_pd( illumBase ), _mm_mul_pd( _mm_cvtps_pd( negLightcos ), shade ) );
+		const __m128d illumHi = _mm_add_pd( _mm_cvtps_pd( illumBase ), _mm_mul_pd( _mm_cvtps_pd( _mm_movehl_ps( negLightcos, negLightcos ) ), shade ) );
+
+		const __m128 illumShaded = _mm_movelh_ps( _mm_cvtpd_ps( illumLo ), _mm_cvtpd_ps( illumHi ) );
+
+		const __m128 shadeMask = _mm_cmpgt_ps( lightcos, zero );
+
+		__m128 illum = _mm_or_ps( _mm_and_ps( shadeMask, illumShaded ), _mm_andnot_ps( shadeMask, illumBase ) );
+
+		illum = _mm_andnot_ps( _mm_cmple_ps( illum, zero ), illum );
+
+		const __m128 scaleMask = _mm_cmpgt_ps( illum, one );
+
+		const __m128 scaled = _mm_mul_ps( illum, _mm_div_ps( one, illum ) );
+
+		illum = _mm_or_ps( _mm_and_ps( scaleMask, scaled ), _mm_andnot_ps( scaleMask, illum ) );
+
+		float values[ 4 ];
+
+		_mm_storeu_ps( values, illum );
+
+		for( int iNorm = 0; iNorm < 4; ++iNorm )
+		{
+			pOut[ i + iNorm ] = glm::vec3( values[ iNorm ] ) * params.vecLightColor;
+		}
+	}
+
+	//Scalar remainder.
+	LightNormals<LightingMode::NORMAL>( pNormals + i, pBones + i, pBoneLightVecs, iCount - i, params, pOut + i );
+}
+
+namespace
+{
+void ChromeNormalsScalar( const glm::vec3* pNormals, const byte* pBones, const glm::vec3* pBoneChromeRight, const glm::vec3* pBoneChromeUp,
+						  const int iCount, glm::vec2* pOut )
+{
+	for( int i = 0; i < iCount; ++i )
+	{
+		//Matches the game's double precision math: the sum is rounded to single precision either way, and scaling by 32 is exact.
+		pOut[ i ][ 0 ] = ( glm::dot( pNormals[ i ], pBoneChromeRight[ pBones[ i ] ] ) + 1.0f ) * 32;
+		pOut[ i ][ 1 ] = ( glm::dot( pNormals[ i ], pBoneChromeUp[ pBones[ i ] ] ) + 1.0f ) * 32;
+	}
+}
+
+SSE2_TARGET void ChromeNormalsSIMD( const glm::vec3* pNormals, const byte* pBones, const glm::vec3* pBoneChromeRight, const glm::vec3* pBoneChromeUp,
+									const int iCount, glm::vec2* pOut )
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 scale = _mm_set1_ps( 32.0f );
+
+	int i = 0;
+
+	for( ; i + 4 <= iCount; i += 4 )
+	{
+		const glm::vec3& r0 = pBoneChromeRight[ pBones[ i ] ];
+		const glm::vec3& r1 = pBoneChromeRight[ pBones[ i + 1 ] ];
+		const glm::vec3& r2 = pBoneChromeRight[ pBones[ i + 2 ] ];
+		const glm::vec3& r3 = pBoneChromeRight[ pBones[ i + 3 ] ];
+
+		const glm::vec3& u0 = pBoneChromeUp[ pBones[ i ] ];
+		const glm::vec3& u1 = pBoneChromeUp[ pBones[ i + 1 ] ];
+		const glm::vec3& u2 = pBoneChromeUp[ pBones[ i + 2 ] ];
+		const glm::vec3& u3 = pBoneChromeUp[ pBones[ i + 3 ] ];
+
+		const __m128 nx = _mm_set_ps( pNormals[ i + 3 ].x, pNormals[ i + 2 ].x, pNormals[ i + 1 ].x, pNormals[ i ].x );
+		const __m128 ny = _mm_set_ps( pNormals[ i + 3 ].y, pNormals[ i + 2 ].y, pNormals[ i + 1 ].y, pNormals[ i ].y );
+		const __m128 nz = _mm_set_ps( pNormals[ i + 3 ].z, pNormals[ i + 2 ].z, pNormals[ i + 1 ].z, pNormals[ i ].z );
+
+		const __m128 rx = _mm_set_ps( r3.x, r2.x, r1.x, r0.x );
+		const __m128 ry = _mm_set_ps( r3.y, r2.y, r1.y, r0.y );
+		const __m128 rz = _mm_set_ps( r3.z, r2.z, r1.z, r0.z );
+
+		const __m128 ux = _mm_set_ps( u3.x, u2.x, u1.x, u0.x );
+		const __m128 uy = _mm_set_ps( u3.y, u2.y, u1.y, u0.y );
+		const __m128 uz = _mm_set_ps( u3.z, u2.z, u1.z, u0.z );
+
+		//Same order of operations as glm::dot.
+		const __m128 s = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, rx ), _mm_mul_ps( ny, ry ) ), _mm_mul_ps( nz, rz ) );
+		const __m128 t = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, ux ), _mm_mul_ps( ny, uy ) ), _mm_mul_ps( nz, uz ) );
+
+		const __m128 sCoords = _mm_mul_ps( _mm_add_ps( s, one ), scale );
+		const __m128 tCoords = _mm_mul_ps( _mm_add_ps( t, one ), scale );
+
+		//Interleaved into s, t pairs.
+		_mm_storeu_ps( &pOut[ i ][ 0 ], _mm_unpacklo_ps( sCoords, tCoords ) );
+		_mm_storeu_ps( &pOut[ i + 2 ][ 0 ], _mm_unpackhi_ps( sCoords, tCoords ) );
+	}
+
+	//Scalar remainder.
+	ChromeNormalsScalar( pNormals + i, pBones + i, pBoneChromeRight, pBoneChromeUp, iCount - i, pOut + i );
+}
+}
+
+void ChromeNormals( const bool bUseSIMD, const glm::vec3* pNormals, const byte* pBones,
+					const glm::vec3* pBoneChromeRight, const glm::vec3* pBoneChromeUp, const int iCount, glm::vec2* pOut )
+{
+	if( bUseSIMD )
+	{
+		ChromeNormalsSIMD( pNormals, pBones, pBoneChromeRight, pBoneChromeUp, iCount, pOut );
+	}
+	else
+	{
+		ChromeNormalsScalar( pNormals, pBones, pBoneChromeRight, pBoneChromeUp, iCount, pOut );
+	}
+}
+
+namespace
+{
+SSE2_TARGET void ScaleVectorsSIMD( glm::vec3* pVectors, const int iCount, const float flScale )
+{
+	//Vectors are tightly packed, so they can be scaled as a flat array of floats.
+	float* const pflValues = &pVectors[ 0 ][ 0 ];
+
+	const int iNumValues = iCount * 3;
+
+	const __m128 scale = _mm_set1_ps( flScale );
+
+	int i = 0;
+
+	for( ; i + 4 <= iNumValues; i += 4 )
+	{
+		_mm_storeu_ps( pflValues + i, _mm_mul_ps( _mm_loadu_ps( pflValues + i ), scale ) );
+	}
+
+	for( ; i < iNumValues; ++i )
+	{
+		pflValues[ i ] *= flScale;
+	}
+}
+}
+
+void ScaleVectors( const bool bUseSIMD, glm::vec3* pVectors, const int iCount, const float flScale )
+{
+	static_assert( sizeof( glm::vec3 ) == sizeof( float ) * 3, "Vectors must be tightly packed" );
+
+	if( iCount <= 0 )
+		return;
+
+	if( bUseSIMD )
+	{
+		ScaleVectorsSIMD( pVectors, iCount, flScale );
+	}
+	else
+	{
+		for( int i = 0; i < iCount; ++i )
+		{
+			pVectors[ i ] *= flScale;
+		}
+	}
+}
+
+namespace
+{
+struct DolRemapTable_t
+{
+	byte indices[ 256 ];
+
+	DolRemapTable_t()
+	{
+		for( int i = 0; i < 256; ++i )
+		{
+			//Entries 8-15 and 16-23 of each block of 32 trade places, which swaps bits 3 and 4 if they differ.
+			const int iFlip = ( ( i >> 1 ) ^ i ) & 0x08;
+
+			indices[ i ] = static_cast<byte>( i ^ ( iFlip | ( iFlip << 1 ) ) );
+		}
+	}
+};
+
+const DolRemapTable_t g_DolRemapTable;
+
+void RemapDolPixelsScalar( const byte* pSource, byte* pDest, const size_t uiCount )
+{
+	for( size_t i = 0; i < uiCount; ++i )
+	{
+		pDest[ i ] = g_DolRemapTable.indices[ pSource[ i ] ];
+	}
+}
+
+SSE2_TARGET void RemapDolPixelsSIMD( const byte* pSource, byte* pDest, const size_t uiCount )
+{
+	//SSE2 has no byte shuffles, so the bit swap that the table encodes is done directly.
+	//16 bit shifts are fine since the bits that cross into neighboring bytes are masked out.
+	const __m128i bit3 = _mm_set1_epi8( 0x08 );
+
+	size_t i = 0;
+
+	for( ; i + 16 <= uiCount; i += 16 )
+	{
+		const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i ) );
+
+		const __m128i flip = _mm_and_si128( _mm_xor_si128( _mm_srli_epi16( pixels, 1 ), pixels ), bit3 );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + i ), _mm_xor_si128( pixels, _mm_or_si128( flip, _mm_add_epi8( flip, flip ) ) ) );
+	}
+
+	RemapDolPixelsScalar( pSource + i, pDest + i, uiCount - i );
+}
+}
+
+void RemapDolPixels( const bool bUseSIMD, const byte* pSource, byte* pDest, const size_t uiCount )
+{
+	//Pixels are read before the pixels before them are written, so destinations that start before the source are fine.
+	assert( pDest <= pSource || pDest >= pSource + uiCount );
+
+	if( bUseSIMD )
+	{
+		RemapDolPixelsSIMD( pSource, pDest, uiCount );
+	}
+	else
+	{
+		RemapDolPixelsScalar( pSource, pDest, uiCount );
+	}
+}
+
+SSE2_TARGET void SlerpBonesSIMD( glm::vec4* pQ1, glm::vec3* pPos1, const glm::vec4* pQ2, const glm::vec3* pPos2, const int iCount, const float s, const bool bFastNlerp )
+{
+	const float s1 = 1.0 - s;
+
+	//Position components are all blended the same way, so they're treated as a flat array.
+	{
+		float* const pDest = &pPos1[ 0 ][ 0 ];
+		const float* const pSrc = &pPos2[ 0 ][ 0 ];
+
+		const int iFloats = iCount * 3;
+
+		const __m128 scale1 = _mm_set1_ps( s1 );
+		const __m128 scale2 = _mm_set1_ps( s );
+
+		int i = 0;
+
+		for( ; i + 4 <= iFloats; i += 4 )
+		{
+			_mm_storeu_ps( pDest + i, _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( pDest + i ), scale1 ), _mm_mul_ps( _mm_loadu_ps( pSrc + i ), scale2 ) ) );
+		}
+
+		for( ; i < iFloats; ++i )
+		{
+			pDest[ i ] = pDest[ i ] * s1 + pSrc[ i ] * s;
+		}
+	}
+
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+	const __m128 minNlerpCos = _mm_set1_ps( FAST_NLERP_MIN_COS );
+	const __m128 sclp = _mm_set1_ps( s1 );
+	const __m128 sclq = _mm_set1_ps( s );
+
+	for( int i = 0; i < iCount; i += 4 )
+	{
+		const int iLanes = std::min( 4, iCount - i );
+
+		//The last bones are padded with identity rotations so they can be done the same way.
+		glm::vec4 padded1[ 4 ];
+		glm::vec4 padded2[ 4 ];
+
+		const glm::vec4* pSrc1 = pQ1 + i;
+		const glm::vec4* pSrc2 = pQ2 + i;
+
+		if( iLanes < 4 )
+		{
+			for( int iLane = 0; iLane < 4; ++iLane )
+			{
+				padded1[ iLane ] = iLane < iLanes ? pSrc1[ iLane ] : glm::vec4( 0, 0, 0, 1 );
+				padded2[ iLane ] = iLane < iLanes ? pSrc2[ iLane ] : glm::vec4( 0, 0, 0, 1 );
+			}
+
+			pSrc1 = padded1;
+			pSrc2 = padded2;
+		}
+
+		__m128 p[ 4 ];
+		__m128 q[ 4 ];
+
+		LoadQuaternions( pSrc1, p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] );
+		LoadQuaternions( pSrc2, q[ 0 ], q[ 1 ], q[ 2 ], q[ 3 ] );
+
+		//Decide if one of the quaternions is backwards, summing in the same order as QuaternionSlerp.
+		__m128 a = _mm_setzero_ps();
+		__m128 b = _mm_setzero_ps();
+
+		for( int j = 0; j < 4; ++j )
+		{
+			const __m128 diff = _mm_sub_ps( p[ j ], q[ j ] );
+			const __m128 sum = _mm_add_ps( p[ j ], q[ j ] );
+
+			a = _mm_add_ps( a, _mm_mul_ps( diff, diff ) );
+			b = _mm_add_ps( b, _mm_mul_ps( sum, sum ) );
+		}
+
+		const __m128 flip = _mm_and_ps( _mm_cmpgt_ps( a, b ), signMask );
+
+		for( int j = 0; j < 4; ++j )
+		{
+			q[ j ] = _mm_xor_ps( q[ j ], flip );
+		}
+
+		const __m128 cosom = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( p[ 0 ], q[ 0 ] ), _mm_mul_ps( p[ 1 ], q[ 1 ] ) ), _mm_mul_ps( p[ 2 ], q[ 2 ] ) ), _mm_mul_ps( p[ 3 ], q[ 3 ] ) );
+
+		//QuaternionSlerp lerps when 1 - cosom is at most 0.00000001, which for floats only happens when cosom is at least 1.
+		const __m128 lerpMask = _mm_cmpge_ps( cosom, one );
+
+		const __m128 nlerpMask = bFastNlerp ? _mm_andnot_ps( lerpMask, _mm_cmpge_ps( cosom, minNlerpCos ) ) : _mm_setzero_ps();
+
+		__m128 blended[ 4 ];
+
+		for( int j = 0; j < 4; ++j )
+		{
+			blended[ j ] = _mm_add_ps( _mm_mul_ps( sclp, p[ j ] ), _mm_mul_ps( sclq, q[ j ] ) );
+		}
+
+		const __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_add_ps( 
+			_mm_mul_ps( blended[ 0 ], blended[ 0 ] ), _mm_mul_ps( blended[ 1 ], blended[ 1 ] ) ), 
+			_mm_mul_ps( blended[ 2 ], blended[ 2 ] ) ), _mm_mul_ps( blended[ 3 ], blended[ 3 ] ) ) );
+
+		for( int j = 0; j < 4; ++j )
+		{
+			blended[ j ] = _mm_or_ps( _mm_and_ps( nlerpMask, _mm_div_ps( blended[ j ], length ) ), _mm_andnot_ps( nlerpMask, blended[ j ] ) );
+		}
+
+		const int iHandled = _mm_movemask_ps( _mm_or_ps( lerpMask, nlerpMask ) );
+
+		_MM_TRANSPOSE4_PS( blended[ 0 ], blended[ 1 ], blended[ 2 ], blended[ 3 ] );
+
+		for( int iLane = 0; iLane < iLanes; ++iLane )
+		{
+			if( iHandled & ( 1 << iLane ) )
+			{
+				_mm_storeu_ps( &pQ1[ i + iLane ][ 0 ], blended[ iLane ] );
+			}
+			else
+			{
+				//QuaternionSlerp flips its second quaternion in place, so it gets a copy.
+				glm::vec4 q2 = pQ2[ i + iLane ];
+				glm::vec4 q3;
+
+				QuaternionSlerp( pQ1[ i + iLane ], q2, s, q3 );
+
+				pQ1[ i + iLane ] = q3;
+			}
+		}
+	}
+}
+
+SSE2_TARGET void BoneMatricesSIMD( const glm::vec4* pQuaternions, const glm::vec3* pPositions, const int iCount, glm::mat3x4* pOut )
+{
+	for( int i = 0; i < iCount; i += 4 )
+	{
+		const int iLanes = std::min( 4, iCount - i );
+
+		//The last bones are padded with identity transforms so they can be done the same way.
+		glm::vec4 paddedQuaternions[ 4 ];
+		glm::vec3 paddedPositions[ 4 ];
+		glm::mat3x4 paddedOut[ 4 ];
+
+		const glm::vec4* pSrcQuaternions = pQuaternions + i;
+		const glm::vec3* pSrcPositions = pPositions + i;
+		glm::mat3x4* pDest = pOut + i;
+
+		if( iLanes < 4 )
+		{
+			for( int iLane = 0; iLane < 4; ++iLane )
+			{
+				paddedQuaternions[ iLane ] = iLane < iLanes ? pSrcQuaternions[ iLane ] : glm::vec4( 0, 0, 0, 1 );
+				paddedPositions[ iLane ] = iLane < iLanes ? pSrcPositions[ iLane ] : glm::vec3( 0 );
+			}
+
+			pSrcQuaternions = paddedQuaternions;
+			pSrcPositions = paddedPositions;
+			pDest = paddedOut;
+		}
+
+		__m128 x, y, z, w;
+
+		LoadQuaternions( pSrcQuaternions, x, y, z, w );
+
+		__m128d lo[ 3 ][ 3 ];
+		__m128d hi[ 3 ][ 3 ];
+
+		QuaternionMatricesPD( _mm_cvtps_pd( x ), _mm_cvtps_pd( y ), _mm_cvtps_pd( z ), _mm_cvtps_pd( w ), lo );
+		QuaternionMatricesPD( 
+			_mm_cvtps_pd( _mm_movehl_ps( x, x ) ), _mm_cvtps_pd( _mm_movehl_ps( y, y ) ), 
+			_mm_cvtps_pd( _mm_movehl_ps( z, z ) ), _mm_cvtps_pd( _mm_movehl_ps( w, w ) ), hi );
+
+		for( int iRow = 0; iRow < 3; ++iRow )
+		{
+			__m128 m0 = _mm_movelh_ps( _mm_cvtpd_ps( lo[ iRow ][ 0 ] ), _mm_cvtpd_ps( hi[ iRow ][ 0 ] ) );
+			__m128 m1 = _mm_movelh_ps( _mm_cvtpd_ps( lo[ iRow ][ 1 ] ), _mm_cvtpd_ps( hi[ iRow ][ 1 ] ) );
+			__m128 m2 = _mm_movelh_ps( _mm_cvtpd_ps( lo[ iRow ][ 2 ] ), _mm_cvtpd_ps( hi[ iRow ][ 2 ] ) );
+			__m128 m3 = _mm_set_ps( pSrcPositions[ 3 ][ iRow ], pSrcPositions[ 2 ][ iRow ], pSrcPositions[ 1 ][ iRow ], pSrcPositions[ 0 ][ iRow ] );
+
+			//Transpose back so each register holds this row of a single bone's matrix.
+			_MM_TRANSPOSE4_PS( m0, m1, m2, m3 );
+
+			_mm_storeu_ps( &pDest[ 0 ][ iRow ][ 0 ], m0 );
+			_mm_storeu_ps( &pDest[ 1 ][ iRow ][ 0 ], m1 );
+			_mm_storeu_ps( &pDest[ 2 ][ iRow ][ 0 ], m2 );
+			_mm_storeu_ps( &pDest[ 3 ][ iRow ][ 0 ], m3 );
+		}
+
+		if( iLanes < 4 )
+		{
+			for( int iLane = 0; iLane < iLanes; ++iLane )
+			{
+				pOut[ i + iLane ] = paddedOut[ iLane ];
+			}
+		}
+	}
+}
+
+SSE2_TARGET void ConcatBoneTransformsSIMD( const int* pOrder, const int* pParents, const int iCount, glm::mat3x4* pTransforms )
+{
+	for( int iIndex = 0; iIndex < iCount; ++iIndex )
+	{
+		const int iBone = pOrder[ iIndex ];
+		const int iParent = pParents[ iBone ];
+
+		//Root bones are already in model space.
+		if( iParent == -1 )
+			continue;
+
+		const glm::mat3x4& parent = pTransforms[ iParent ];
+		glm::mat3x4& bone = pTransforms[ iBone ];
+
+		const __m128 row0 = _mm_loadu_ps( &bone[ 0 ][ 0 ] );
+		const __m128 row1 = _mm_loadu_ps( &bone[ 1 ][ 0 ] );
+		const __m128 row2 = _mm_loadu_ps( &bone[ 2 ][ 0 ] );
+
+		__m128 result[ 3 ];
+
+		for( int iRow = 0; iRow < 3; ++iRow )
+		{
+			//Adding -0 leaves the rotation columns unchanged, including zeroes.
+			const __m128 translation = _mm_set_ps( parent[ iRow ][ 3 ], -0.0f, -0.0f, -0.0f );
+
+			result[ iRow ] = _mm_add_ps( _mm_add_ps( _mm_add_ps( 
+				_mm_mul_ps( _mm_set1_ps( parent[ iRow ][ 0 ] ), row0 ), 
+				_mm_mul_ps( _mm_set1_ps( parent[ iRow ][ 1 ] ), row1 ) ), 
+				_mm_mul_ps( _mm_set1_ps( parent[ iRow ][ 2 ] ), row2 ) ), 
+				translation );
+		}
+
+		_mm_storeu_ps( &bone[ 0 ][ 0 ], result[ 0 ] );
+		_mm_storeu_ps( &bone[ 1 ][ 0 ], result[ 1 ] );
+		_mm_storeu_ps( &bone[ 2 ][ 0 ], result[ 2 ] );
+	}
+}
+
+void LightNormals( const int iTextureFlags, const bool bUseSIMD, 
+				   const glm::vec3* pNormals, const byte* pBones, const glm::vec3* pBoneLightVecs, const int iCount, const StudioLightingParams_t& params, glm::vec3* pOut )
+{
+	if( iTextureFlags & STUDIO_NF_FULLBRIGHT )
+	{
+		LightNormals<LightingMode::FULLBRIGHT>( pNormals, pBones, pBoneLightVecs, iCount, params, pOut );
+	}
+	else if( iTextureFlags & STUDIO_NF_FLATSHADE )
+	{
+		LightNormals<LightingMode::FLATSHADE>( pNormals, pBones, pBoneLightVecs, iCount, params, pOut );
+	}
+	else if( params.bHasLUT )
+	{
+		LightNormals<LightingMode::LUT>( pNormals, pBones, pBoneLightVecs, iCount, params, pOut );
+	}
+	else if( bUseSIMD )
+	{
+		LightNormalsSIMD( pNormals, pBones, pBoneLightVecs, iCount, params, pOut );
+	}
+	else
+	{
+		LightNormals<LightingMode::NORMAL>( pNormals, pBones, pBoneLightVecs, iCount, params, pOut );
+	}
+}
+}
@@ -0,0 +1,178 @@
+#ifndef GAME_STUDIOMODEL_STUDIOKERNELS_H
+#define GAME_STUDIOMODEL_STUDIOKERNELS_H
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat3x4.hpp>
+
+#include "shared/Const.h"
+
+namespace studiomdl
+{
+/**
+*	Number of intervals in the lighting lookup table, which covers lightcos values from -1 to 1.
+*	The remap from lightcos to intensity is piecewise linear, so interpolating between entries is exact
+*	except in the few intervals that contain one of its clamps.
+*/
+const int LIGHTING_LUT_SIZE = 256;
+
+/**
+*	Lighting parameters used by the lighting kernels. Precomputed once per model.
+*/
+struct StudioLightingParams_t
+{
+	/**
+	*	Ambient light, clamped to a minimum of 0.1.
+	*/
+	float flAmbient;
+
+	/**
+	*	Ambient + shade light.
+	*/
+	float flIllum;
+
+	/**
+	*	Shade light.
+	*/
+	float flShade;
+
+	/**
+	*	Lambert modifier, clamped to a minimum of 1.
+	*/
+	float flLambert;
+
+	glm::vec3 vecLightColor;
+
+	/**
+	*	Whether flLUT has been built. If so, regular lighting uses it instead of remapping each normal's lightcos.
+	*/
+	bool bHasLUT = false;
+
+	/**
+	*	Intensity, before the light color is applied, for lightcos values from -1 to 1.
+	*	@see BuildLightingLUT
+	*/
+	float flLUT[ LIGHTING_LUT_SIZE + 1 ];
+};
+
+/**
+*	Builds the lighting lookup table from the other parameters. Must be called again whenever they change.
+*	Entries are computed with the same operations as the lighting kernels, so lookups that land on an entry match them exactly.
+*	Normals are expected to be normalized; lightcos values below -1 are treated as -1.
+*/
+void BuildLightingLUT( StudioLightingParams_t& params );
+
+/**
+*	@return Whether the SIMD kernels can be used on this CPU.
+*/
+bool AreSIMDKernelsSupported();
+
+/**
+*	Transforms vertices by their bone's transform. Produces the same output as calling VectorTransform on each vertex.
+*	@param pVerts Vertices to transform.
+*	@param pBones Bone index for each vertex.
+*	@param pBoneTransforms Bone transformation matrices.
+*	@param iCount Number of vertices.
+*	@param pOut Transformed vertices.
+*/
+void TransformVerticesSIMD( const glm::vec3* pVerts, const byte* pBones, const glm::mat3x4* pBoneTransforms, const int iCount, glm::vec3* pOut );
+
+/**
+*	Lights normals using regular (non-fullbright, non-flatshaded) lighting. Produces the same output as LightNormals.
+*	@param pNormals Normals to light.
+*	@param pBones Bone index for each normal.
+*	@param pBoneLightVecs Light vector in each bone's reference frame.
+*	@param iCount Number of normals.
+*	@param params Lighting parameters.
+*	@param pOut Light values.
+*/
+void LightNormalsSIMD( const glm::vec3* pNormals, const byte* pBones, const glm::vec3* pBoneLightVecs, const int iCount, const StudioLightingParams_t& params, glm::vec3* pOut );
+
+/**
+*	Computes chrome texture coordinates for normals, before they're scaled by the texture's size.
+*	Produces the same output as computing each coordinate as ( dot( normal, vector ) + 1 ) * 32.
+*	@param bUseSIMD Whether to use SIMD to compute 4 normals at a time. The caller must check AreSIMDKernelsSupported.
+*	@param pNormals Normals to compute coordinates for.
+*	@param pBones Bone index for each normal.
+*	@param pBoneChromeRight Chrome s vector in each bone's reference frame.
+*	@param pBoneChromeUp Chrome t vector in each bone's reference frame.
+*	@param iCount Number of normals.
+*	@param pOut Chrome texture coordinates.
+*/
+void ChromeNormals( const bool bUseSIMD, const glm::vec3* pNormals, const byte* pBones, 
+					const glm::vec3* pBoneChromeRight, const glm::vec3* pBoneChromeUp, const int iCount, glm::vec2* pOut );
+
+/**
+*	Scales vectors in place. Produces the same output as multiplying each vector by the scale.
+*	@param bUseSIMD Whether to use SIMD to scale 4 components at a time. The caller must check AreSIMDKernelsSupported.
+*	@param pVectors Vectors to scale.
+*	@param iCount Number of vectors.
+*	@param flScale Scale to apply.
+*/
+void ScaleVectors( const bool bUseSIMD, glm::vec3* pVectors, const int iCount, const float flScale );
+
+/**
+*	Remaps the palette indices of Dol texture pixels to the order used by Mdl palettes.
+*	Dol palettes have the second and third group of 8 entries in every block of 32 swapped, so this is a fixed permutation of indices.
+*	@param bUseSIMD Whether to use SIMD to remap 16 pixels at a time. The caller must check AreSIMDKernelsSupported.
+*	@param pSource Pixels to remap.
+*	@param pDest Remapped pixels. May overlap pSource if it doesn't start after it, so textures can be converted in place.
+*	@param uiCount Number of pixels.
+*/
+void RemapDolPixels( const bool bUseSIMD, const byte* pSource, byte* pDest, const size_t uiCount );
+
+/**
+*	Smallest dot product between two quaternions that SlerpBonesSIMD blends with a normalized lerp when fast blending is enabled.
+*	This is a rotation of about 11 degrees between the blended poses, where nlerp is within 0.0001 of slerp.
+*/
+const float FAST_NLERP_MIN_COS = 0.995f;
+
+/**
+*	Blends two sets of bone rotations and positions, 4 bones at a time.
+*	Produces the same output as blending each rotation with QuaternionSlerp and lerping each position.
+*	Rotations that are the same in both sets are lerped in SIMD, the rest are blended with QuaternionSlerp.
+*	@param pQ1 First set of rotations. Receives the blended rotations.
+*	@param pPos1 First set of positions. Receives the blended positions.
+*	@param pQ2 Second set of rotations.
+*	@param pPos2 Second set of positions.
+*	@param iCount Number of bones.
+*	@param s Blend factor, from 0 to 1.
+*	@param bFastNlerp If true, rotations whose dot product is at least FAST_NLERP_MIN_COS are blended with a normalized lerp
+*		instead of QuaternionSlerp. The output is then no longer an exact match.
+*/
+void SlerpBonesSIMD( glm::vec4* pQ1, glm::vec3* pPos1, const glm::vec4* pQ2, const glm::vec3* pPos2, const int iCount, const float s, const bool bFastNlerp );
+
+/**
+*	Converts bone rotations and positions to matrices, 4 bones at a time.
+*	Produces the same output as calling QuaternionMatrix on each rotation and storing the position in the last column.
+*	@param pQuaternions Bone rotations.
+*	@param pPositions Bone positions.
+*	@param iCount Number of bones.
+*	@param pOut Bone matrices.
+*/
+void BoneMatricesSIMD( const glm::vec4* pQuaternions, const glm::vec3* pPositions, const int iCount, glm::mat3x4* pOut );
+
+/**
+*	Concatenates bone matrices with their parent's, in place. Produces the same output as calling R_ConcatTransforms on each bone.
+*	Each bone depends on its parent, so bones are done one at a time with all 4 columns of a row at once.
+*	@param pOrder Bone indices sorted so every bone comes after its parent.
+*	@param pParents Parent of each bone, or -1 for root bones.
+*	@param iCount Number of bones.
+*	@param pTransforms Bone matrices relative to their parent. Receives the bone transformation matrices.
+*/
+void ConcatBoneTransformsSIMD( const int* pOrder, const int* pParents, const int iCount, glm::mat3x4* pTransforms );
+
+/**
+*	Lights the normals of a mesh. The lighting mode is selected once from the texture flags,
+*	so the loop that runs for each normal has no branches on the flags.
+*	If the parameters have a lookup table, regular lighting uses it instead of the SIMD kernel.
+*	@param iTextureFlags Flags of the mesh's texture.
+*	@param bUseSIMD Whether to use the SIMD kernel for regular lighting. The caller must check AreSIMDKernelsSupported.
+*	@see LightNormalsSIMD for the other parameters.
+*/
+void LightNormals( const int iTextureFlags, const bool bUseSIMD, 
+				   const glm::vec3* pNormals, const byte* pBones, const glm::vec3* pBoneLightVecs, const int iCount, const StudioLightingParams_t& params, glm::vec3* pOut );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOKERNELS_H
@@ -0,0 +1,859 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+#include <functional>
+#include <set>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "shared/Logging.h"
+#include "shared/TaskScheduler.h"
+
+#include "utility/mathlib.h"
+
+#include "CStudioAnimCache.h"
+#include "CStudioModel.h"
+#include "StudioModelDecompiler.h"
+#include "StudioModelTextureExport.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Directory animations are written to, relative to the QC file.
+*/
+const char ANIMS_DIRECTORY[] = "anims";
+
+/**
+*	studiomdl rotates the root bones and meshes by this much around the Z axis. Undone so recompiling gives the same model.
+*/
+const float STUDIOMDL_ZROTATION = static_cast<float>( M_PI / 2 );
+
+/**
+*	Names of the Half-Life SDK activities, indexed by activity.
+*/
+const char* const ACTIVITY_NAMES[] =
+{
+	nullptr,
+	"ACT_IDLE",
+	"ACT_GUARD",
+	"ACT_WALK",
+	"ACT_RUN",
+	"ACT_FLY",
+	"ACT_SWIM",
+	"ACT_HOP",
+	"ACT_LEAP",
+	"ACT_FALL",
+	"ACT_LAND",
+	"ACT_STRAFE_LEFT",
+	"ACT_STRAFE_RIGHT",
+	"ACT_ROLL_LEFT",
+	"ACT_ROLL_RIGHT",
+	"ACT_TURN_LEFT",
+	"ACT_TURN_RIGHT",
+	"ACT_CROUCH",
+	"ACT_CROUCHIDLE",
+	"ACT_STAND",
+	"ACT_USE",
+	"ACT_SIGNAL1",
+	"ACT_SIGNAL2",
+	"ACT_SIGNAL3",
+	"ACT_TWITCH",
+	"ACT_COWER",
+	"ACT_SMALL_FLINCH",
+	"ACT_BIG_FLINCH",
+	"ACT_RANGE_ATTACK1",
+	"ACT_RANGE_ATTACK2",
+	"ACT_MELEE_ATTACK1",
+	"ACT_MELEE_ATTACK2",
+	"ACT_RELOAD",
+	"ACT_ARM",
+	"ACT_DISARM",
+	"ACT_EAT",
+	"ACT_DIESIMPLE",
+	"ACT_DIEBACKWARD",
+	"ACT_DIEFORWARD",
+	"ACT_DIEVIOLENT",
+	"ACT_BARNACLE_HIT",
+	"ACT_BARNACLE_PULL",
+	"ACT_BARNACLE_CHOMP",
+	"ACT_BARNACLE_CHEW",
+	"ACT_SLEEP",
+	"ACT_INSPECT_FLOOR",
+	"ACT_INSPECT_WALL",
+	"ACT_IDLE_ANGRY",
+	"ACT_WALK_HURT",
+	"ACT_RUN_HURT",
+	"ACT_HOVER",
+	"ACT_GLIDE",
+	"ACT_FLY_LEFT",
+	"ACT_FLY_RIGHT",
+	"ACT_DETECT_SCENT",
+	"ACT_SNIFF",
+	"ACT_BITE",
+	"ACT_THREAT_DISPLAY",
+	"ACT_FEAR_DISPLAY",
+	"ACT_EXCITED",
+	"ACT_SPECIAL_ATTACK1",
+	"ACT_SPECIAL_ATTACK2",
+	"ACT_COMBAT_IDLE",
+	"ACT_WALK_SCARED",
+	"ACT_RUN_SCARED",
+	"ACT_VICTORY_DANCE",
+	"ACT_DIE_HEADSHOT",
+	"ACT_DIE_CHESTSHOT",
+	"ACT_DIE_GUTSHOT",
+	"ACT_DIE_BACKSHOT",
+	"ACT_FLINCH_HEAD",
+	"ACT_FLINCH_CHEST",
+	"ACT_FLINCH_STOMACH",
+	"ACT_FLINCH_LEFTARM",
+	"ACT_FLINCH_RIGHTARM",
+	"ACT_FLINCH_LEFTLEG",
+	"ACT_FLINCH_RIGHTLEG"
+};
+
+void Printf( std::string& szOutput, const char* const pszFormat, ... )
+{
+	char szBuffer[ 1024 ];
+
+	va_list list;
+
+	va_start( list, pszFormat );
+	const int iResult = vsnprintf( szBuffer, sizeof( szBuffer ), pszFormat, list );
+	va_end( list );
+
+	if( iResult > 0 )
+		szOutput.append( szBuffer, std::min( static_cast<size_t>( iResult ), sizeof( szBuffer ) - 1 ) );
+}
+
+template<size_t SIZE>
+std::string GetName( const char ( &szName )[ SIZE ] )
+{
+	return std::string( szName, strnlen( szName, SIZE ) );
+}
+
+/**
+*	Makes a name usable as a file name: paths and extensions are removed, as are characters that aren't valid in file names.
+*/
+std::string GetFileName( std::string szName, const char* const pszFallback )
+{
+	const size_t uiSlash = szName.find_last_of( "/\\" );
+
+	if( uiSlash != std::string::npos )
+		szName.erase( 0, uiSlash + 1 );
+
+	const size_t uiDot = szName.find_last_of( '.' );
+
+	if( uiDot != std::string::npos )
+		szName.erase( uiDot );
+
+	for( auto& c : szName )
+	{
+		if( !isalnum( static_cast<unsigned char>( c ) ) && c != '_' && c != '-' )
+			c = '_';
+	}
+
+	return szName.empty() ? pszFallback : szName;
+}
+
+/**
+*	Makes file names unique. File names are case insensitive on some platforms.
+*/
+std::string MakeUnique( std::set<std::string>& usedNames, std::string szName )
+{
+	for( int iSuffix = 1; ; ++iSuffix )
+	{
+		std::string szCandidate = iSuffix == 1 ? szName : szName + "_" + std::to_string( iSuffix );
+
+		std::string szLowerName = szCandidate;
+
+		for( auto& c : szLowerName )
+		{
+			c = static_cast<char>( tolower( static_cast<unsigned char>( c ) ) );
+		}
+
+		if( usedNames.insert( szLowerName ).second )
+			return szCandidate;
+	}
+}
+
+bool WriteFile( const fs::path& path, const std::string& szContents )
+{
+	FILE* pFile = fopen( path.string().c_str(), "wb" );
+
+	if( !pFile )
+	{
+		Error( "Couldn't open \"%s\" for writing\n", path.string().c_str() );
+		return false;
+	}
+
+	const bool bSuccess = fwrite( szContents.data(), 1, szContents.size(), pFile ) == szContents.size();
+
+	if( fclose( pFile ) != 0 || !bSuccess )
+	{
+		Error( "Couldn't write \"%s\"\n", path.string().c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*	Rotates a vector back from the orientation studiomdl gives models.
+*/
+glm::vec3 UndoZRotation( const glm::vec3& vec )
+{
+	return glm::vec3( vec.y, -vec.x, vec.z );
+}
+
+/**
+*	Gets the position and rotation of a bone as written to SMD files. Root bones are rotated back from the orientation studiomdl gives them.
+*/
+void GetSMDBoneTransform( const mstudiobone_t& bone, glm::vec3 pos, glm::vec3 rot, glm::vec3& outPos, glm::vec3& outRot )
+{
+	if( bone.parent == -1 )
+	{
+		pos = UndoZRotation( pos );
+		rot.z -= STUDIOMDL_ZROTATION;
+	}
+
+	outPos = pos;
+	outRot = rot;
+}
+
+void WriteNodes( const studiohdr_t& studioHdr, std::string& szOutput )
+{
+	szOutput += "version 1\nnodes\n";
+
+	for( int iBone = 0; iBone < studioHdr.numbones; ++iBone )
+	{
+		const mstudiobone_t& bone = *studioHdr.GetBone( iBone );
+
+		Printf( szOutput, "%3d \"%s\" %d\n", iBone, GetName( bone.name ).c_str(), bone.parent );
+	}
+
+	szOutput += "end\n";
+}
+
+void WriteBoneFrame( const int iBone, const glm::vec3& pos, const glm::vec3& rot, std::string& szOutput )
+{
+	Printf( szOutput, "%3d %f %f %f %f %f %f\n", iBone, pos.x, pos.y, pos.z, rot.x, rot.y, rot.z );
+}
+
+/**
+*	Gets the bone to model space transforms of the default pose.
+*/
+void GetDefaultBoneTransforms( const studiohdr_t& studioHdr, std::vector<glm::mat3x4>& transforms )
+{
+	transforms.resize( studioHdr.numbones );
+
+	for( int iBone = 0; iBone < studioHdr.numbones; ++iBone )
+	{
+		const mstudiobone_t& bone = *studioHdr.GetBone( iBone );
+
+		glm::vec4 q;
+
+		AngleQuaternion( glm::vec3( bone.value[ 3 ], bone.value[ 4 ], bone.value[ 5 ] ), q );
+
+		glm::mat3x4 matrix;
+
+		QuaternionMatrix( q, matrix );
+
+		matrix[ 0 ][ 3 ] = bone.value[ 0 ];
+		matrix[ 1 ][ 3 ] = bone.value[ 1 ];
+		matrix[ 2 ][ 3 ] = bone.value[ 2 ];
+
+		//studiomdl sorts bones so parents come first.
+		if( bone.parent >= 0 && bone.parent < iBone )
+			R_ConcatTransforms( transforms[ bone.parent ], matrix, transforms[ iBone ] );
+		else
+			transforms[ iBone ] = matrix;
+	}
+}
+
+void WriteSMDVertex( const studiohdr_t& studioHdr, const mstudiomodel_t& submodel, const std::vector<glm::mat3x4>& transforms,
+					 const mstudiotexture_t& texture, const short* ptricmd, std::string& szOutput )
+{
+	const byte* const pVertBones = studioHdr.GetData() + submodel.vertinfoindex;
+	const byte* const pNormBones = studioHdr.GetData() + submodel.norminfoindex;
+
+	const glm::vec3* const pVerts = reinterpret_cast<const glm::vec3*>( studioHdr.GetData() + submodel.vertindex );
+	const glm::vec3* const pNorms = reinterpret_cast<const glm::vec3*>( studioHdr.GetData() + submodel.normindex );
+
+	const int iBone = pVertBones[ ptricmd[ 0 ] ];
+
+	glm::vec3 pos;
+	glm::vec3 normal;
+
+	VectorTransform( pVerts[ ptricmd[ 0 ] ], transforms[ iBone ], pos );
+	VectorRotate( pNorms[ ptricmd[ 1 ] ], transforms[ pNormBones[ ptricmd[ 1 ] ] ], normal );
+
+	pos = UndoZRotation( pos );
+	normal = UndoZRotation( normal );
+
+	const float flU = texture.width > 0 ? static_cast<float>( ptricmd[ 2 ] ) / texture.width : 0;
+	const float flV = texture.height > 0 ? 1.0f - static_cast<float>( ptricmd[ 3 ] ) / texture.height : 0;
+
+	Printf( szOutput, "%3d %f %f %f %f %f %f %f %f\n", iBone, pos.x, pos.y, pos.z, normal.x, normal.y, normal.z, flU, flV );
+}
+
+/**
+*	Writes a submodel as a reference SMD. Triangle commands are split back into triangles.
+*/
+std::string WriteReferenceSMD( const CStudioModel& model, const mstudiomodel_t& submodel, const std::vector<std::string>& textureNames )
+{
+	const studiohdr_t& studioHdr = *model.GetStudioHeader();
+	const studiohdr_t& textureHdr = *model.GetTextureHeader();
+
+	std::string szOutput;
+
+	WriteNodes( studioHdr, szOutput );
+
+	szOutput += "skeleton\ntime 0\n";
+
+	for( int iBone = 0; iBone < studioHdr.numbones; ++iBone )
+	{
+		const mstudiobone_t& bone = *studioHdr.GetBone( iBone );
+
+		glm::vec3 pos, rot;
+
+		GetSMDBoneTransform( bone, glm::vec3( bone.value[ 0 ], bone.value[ 1 ], bone.value[ 2 ] ), glm::vec3( bone.value[ 3 ], bone.value[ 4 ], bone.value[ 5 ] ), pos, rot );
+
+		WriteBoneFrame( iBone, pos, rot, szOutput );
+	}
+
+	szOutput += "end\ntriangles\n";
+
+	std::vector<glm::mat3x4> transforms;
+
+	GetDefaultBoneTransforms( studioHdr, transforms );
+
+	const short* const pSkins = textureHdr.GetSkins();
+
+	const mstudiomesh_t* const pMeshes = reinterpret_cast<const mstudiomesh_t*>( studioHdr.GetData() + submodel.meshindex );
+
+	for( int iMesh = 0; iMesh < submodel.nummesh; ++iMesh )
+	{
+		const mstudiomesh_t& mesh = pMeshes[ iMesh ];
+
+		//The reference uses the first skin family.
+		const int iTexture = mesh.skinref >= 0 && mesh.skinref < textureHdr.numskinref ? pSkins[ mesh.skinref ] : -1;
+
+		if( iTexture < 0 || iTexture >= textureHdr.numtextures )
+			continue;
+
+		const mstudiotexture_t& texture = *textureHdr.GetTexture( iTexture );
+
+		const std::string szTexture = textureNames[ iTexture ] + ".bmp";
+
+		const short* ptricmds = reinterpret_cast<const short*>( studioHdr.GetData() + mesh.triindex );
+
+		for( int i; ( i = *( ptricmds++ ) ) != 0; )
+		{
+			const bool bFan = i < 0;
+
+			if( bFan )
+				i = -i;
+
+			const short* const pVerts = ptricmds;
+
+			ptricmds += i * 4;
+
+			for( int iVert = 2; iVert < i; ++iVert )
+			{
+				int indices[ 3 ];
+
+				if( bFan )
+				{
+					indices[ 0 ] = 0;
+					indices[ 1 ] = iVert - 1;
+					indices[ 2 ] = iVert;
+				}
+				else if( iVert & 1 )
+				{
+					indices[ 0 ] = iVert - 1;
+					indices[ 1 ] = iVert - 2;
+					indices[ 2 ] = iVert;
+				}
+				else
+				{
+					indices[ 0 ] = iVert - 2;
+					indices[ 1 ] = iVert - 1;
+					indices[ 2 ] = iVert;
+				}
+
+				szOutput += szTexture;
+				szOutput += '\n';
+
+				//studiomdl flips triangles while compiling, so they're written in reverse.
+				for( int iIndex = 2; iIndex >= 0; --iIndex )
+				{
+					WriteSMDVertex( studioHdr, submodel, transforms, texture, pVerts + indices[ iIndex ] * 4, szOutput );
+				}
+			}
+		}
+	}
+
+	szOutput += "end\n";
+
+	return szOutput;
+}
+
+/**
+*	Writes one blend of a sequence as an animation SMD.
+*/
+std::string WriteAnimationSMD( const studiohdr_t& studioHdr, const mstudioseqdesc_t& seqdesc, const mstudioanim_t* panim )
+{
+	std::string szOutput;
+
+	WriteNodes( studioHdr, szOutput );
+
+	szOutput += "skeleton\n";
+
+	const CDecodedAnim anim( panim, studioHdr.numbones, seqdesc.numframes );
+
+	//studiomdl removes linear movement from root bones; it's added back so the animation moves again.
+	glm::vec3 vecMovement( 0 );
+
+	if( seqdesc.motiontype & STUDIO_LX )
+		vecMovement.x = seqdesc.linearmovement.x;
+	if( seqdesc.motiontype & STUDIO_LY )
+		vecMovement.y = seqdesc.linearmovement.y;
+	if( seqdesc.motiontype & STUDIO_LZ )
+		vecMovement.z = seqdesc.linearmovement.z;
+
+	for( int iFrame = 0; iFrame < seqdesc.numframes; ++iFrame )
+	{
+		Printf( szOutput, "time %d\n", iFrame );
+
+		for( int iBone = 0; iBone < studioHdr.numbones; ++iBone )
+		{
+			const mstudiobone_t& bone = *studioHdr.GetBone( iBone );
+
+			float flValues[ CDecodedAnim::NUM_CHANNELS ];
+
+			for( int iChannel = 0; iChannel < CDecodedAnim::NUM_CHANNELS; ++iChannel )
+			{
+				flValues[ iChannel ] = bone.value[ iChannel ] + ( anim.HasValues( iBone, iChannel ) ? anim.GetValue( iBone, iChannel, iFrame ) * bone.scale[ iChannel ] : 0 );
+			}
+
+			glm::vec3 pos( flValues[ 0 ], flValues[ 1 ], flValues[ 2 ] );
+
+			if( bone.parent == -1 && seqdesc.numframes > 1 )
+				pos += vecMovement * ( static_cast<float>( iFrame ) / ( seqdesc.numframes - 1 ) );
+
+			glm::vec3 outPos, outRot;
+
+			GetSMDBoneTransform( bone, pos, glm::vec3( flValues[ 3 ], flValues[ 4 ], flValues[ 5 ] ), outPos, outRot );
+
+			WriteBoneFrame( iBone, outPos, outRot, szOutput );
+		}
+	}
+
+	szOutput += "end\n";
+
+	return szOutput;
+}
+
+const char* MotionTypeToString( const int iType )
+{
+	switch( iType & STUDIO_TYPES )
+	{
+	case STUDIO_X:	return "X";
+	case STUDIO_Y:	return "Y";
+	case STUDIO_Z:	return "Z";
+	case STUDIO_XR:	return "XR";
+	case STUDIO_YR:	return "YR";
+	case STUDIO_ZR:	return "ZR";
+	case STUDIO_LX:	return "LX";
+	case STUDIO_LY:	return "LY";
+	case STUDIO_LZ:	return "LZ";
+	case STUDIO_AX:	return "AX";
+	case STUDIO_AY:	return "AY";
+	case STUDIO_AZ:	return "AZ";
+	case STUDIO_AXR:	return "AXR";
+	case STUDIO_AYR:	return "AYR";
+	case STUDIO_AZR:	return "AZR";
+	default:		return nullptr;
+	}
+}
+
+/**
+*	A file to write, and the function that writes it.
+*/
+struct DecompileJob_t
+{
+	fs::path path;
+	std::function<bool( const fs::path& path )> write;
+};
+
+void WriteQC( const CStudioModel& model, const char* const pszModelName,
+			  const std::vector<std::string>& textureNames, const std::vector<std::string>& submodelNames,
+			  const std::vector<std::vector<std::string>>& sequenceFiles, std::string& szOutput )
+{
+	const studiohdr_t& studioHdr = *model.GetStudioHeader();
+	const studiohdr_t& textureHdr = *model.GetTextureHeader();
+
+	Printf( szOutput, "/*\n==============================================================================\n\n"
+		"QC script generated by Half-Life Model Viewer for \"%s\"\n\n"
+		"==============================================================================\n*/\n\n", GetName( studioHdr.name ).c_str() );
+
+	Printf( szOutput, "$modelname \"%s.mdl\"\n", pszModelName );
+	szOutput += "$cd \".\"\n$cdtexture \".\"\n$scale 1.0\n$cliptotextures\n\n";
+
+	if( &textureHdr != &studioHdr )
+		szOutput += "$externaltextures\n";
+
+	if( studioHdr.numseqgroups > 1 )
+		szOutput += "//The model had demand loaded sequence groups; set $sequencegroupsize to split sequences the same way.\n";
+
+	Printf( szOutput, "$eyeposition %f %f %f\n", studioHdr.eyeposition.x, studioHdr.eyeposition.y, studioHdr.eyeposition.z );
+	Printf( szOutput, "$bbox %f %f %f %f %f %f\n", studioHdr.bbmin.x, studioHdr.bbmin.y, studioHdr.bbmin.z, studioHdr.bbmax.x, studioHdr.bbmax.y, studioHdr.bbmax.z );
+	Printf( szOutput, "$cbox %f %f %f %f %f %f\n", studioHdr.min.x, studioHdr.min.y, studioHdr.min.z, studioHdr.max.x, studioHdr.max.y, studioHdr.max.z );
+
+	if( studioHdr.flags )
+		Printf( szOutput, "$flags %d\n", studioHdr.flags );
+
+	szOutput += '\n';
+
+	size_t uiSubModel = 0;
+
+	for( int iBodyPart = 0; iBodyPart < studioHdr.numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t& bodyPart = *studioHdr.GetBodypart( iBodyPart );
+
+		Printf( szOutput, "$bodygroup \"%s\"\n{\n", GetName( bodyPart.name ).c_str() );
+
+		for( int iModel = 0; iModel < bodyPart.nummodels; ++iModel, ++uiSubModel )
+		{
+			if( submodelNames[ uiSubModel ].empty() )
+				szOutput += "\tblank\n";
+			else
+				Printf( szOutput, "\tstudio \"%s\"\n", submodelNames[ uiSubModel ].c_str() );
+		}
+
+		szOutput += "}\n";
+	}
+
+	//Only textures that change between skin families are listed.
+	if( textureHdr.numskinfamilies > 1 )
+	{
+		const short* const pSkins = textureHdr.GetSkins();
+
+		std::vector<int> changed;
+
+		for( int iSkinRef = 0; iSkinRef < textureHdr.numskinref; ++iSkinRef )
+		{
+			for( int iFamily = 1; iFamily < textureHdr.numskinfamilies; ++iFamily )
+			{
+				if( pSkins[ iFamily * textureHdr.numskinref + iSkinRef ] != pSkins[ iSkinRef ] )
+				{
+					changed.push_back( iSkinRef );
+					break;
+				}
+			}
+		}
+
+		szOutput += "\n$texturegroup \"skinfamilies\"\n{\n";
+
+		for( int iFamily = 0; iFamily < textureHdr.numskinfamilies; ++iFamily )
+		{
+			szOutput += "\t{";
+
+			for( const int iSkinRef : changed )
+			{
+				const int iTexture = pSkins[ iFamily * textureHdr.numskinref + iSkinRef ];
+
+				if( iTexture >= 0 && iTexture < textureHdr.numtextures )
+					Printf( szOutput, " \"%s.bmp\"", textureNames[ iTexture ].c_str() );
+			}
+
+			szOutput += " }\n";
+		}
+
+		szOutput += "}\n";
+	}
+
+	for( int iTexture = 0; iTexture < textureHdr.numtextures; ++iTexture )
+	{
+		const int iFlags = textureHdr.GetTexture( iTexture )->flags;
+
+		const struct
+		{
+			int iFlag;
+			const char* pszMode;
+		} modes[] =
+		{
+			{ STUDIO_NF_FLATSHADE, "flatshade" },
+			{ STUDIO_NF_CHROME, "chrome" },
+			{ STUDIO_NF_FULLBRIGHT, "fullbright" },
+			{ STUDIO_NF_ADDITIVE, "additive" },
+			{ STUDIO_NF_MASKED, "masked" }
+		};
+
+		for( const auto& mode : modes )
+		{
+			if( iFlags & mode.iFlag )
+				Printf( szOutput, "$texrendermode \"%s.bmp\" %s\n", textureNames[ iTexture ].c_str(), mode.pszMode );
+		}
+	}
+
+	szOutput += '\n';
+
+	for( int iAttachment = 0; iAttachment < studioHdr.numattachments; ++iAttachment )
+	{
+		const mstudioattachment_t& attachment = *studioHdr.GetAttachment( iAttachment );
+
+		if( attachment.bone < 0 || attachment.bone >= studioHdr.numbones )
+			continue;
+
+		Printf( szOutput, "$attachment %d \"%s\" %f %f %f\n", iAttachment, GetName( studioHdr.GetBone( attachment.bone )->name ).c_str(),
+				attachment.org.x, attachment.org.y, attachment.org.z );
+	}
+
+	for( int iController = 0; iController < studioHdr.numbonecontrollers; ++iController )
+	{
+		const mstudiobonecontroller_t& controller = *studioHdr.GetBoneController( iController );
+
+		const char* const pszType = MotionTypeToString( controller.type );
+
+		if( !pszType || controller.bone < 0 || controller.bone >= studioHdr.numbones )
+			continue;
+
+		if( controller.index == STUDIO_MOUTH_CONTROLLER )
+			Printf( szOutput, "$controller mouth \"%s\" %s %f %f\n", GetName( studioHdr.GetBone( controller.bone )->name ).c_str(), pszType, controller.start, controller.end );
+		else
+			Printf( szOutput, "$controller %d \"%s\" %s %f %f\n", controller.index, GetName( studioHdr.GetBone( controller.bone )->name ).c_str(), pszType, controller.start, controller.end );
+	}
+
+	for( int iHitBox = 0; iHitBox < studioHdr.numhitboxes; ++iHitBox )
+	{
+		const mstudiobbox_t& hitbox = *studioHdr.GetHitBox( iHitBox );
+
+		if( hitbox.bone < 0 || hitbox.bone >= studioHdr.numbones )
+			continue;
+
+		Printf( szOutput, "$hbox %d \"%s\" %f %f %f %f %f %f\n", hitbox.group, GetName( studioHdr.GetBone( hitbox.bone )->name ).c_str(),
+				hitbox.bbmin.x, hitbox.bbmin.y, hitbox.bbmin.z, hitbox.bbmax.x, hitbox.bbmax.y, hitbox.bbmax.z );
+	}
+
+	szOutput += '\n';
+
+	for( int iSequence = 0; iSequence < studioHdr.numseq; ++iSequence )
+	{
+		const mstudioseqdesc_t& seqdesc = *studioHdr.GetSequence( iSequence );
+
+		const auto& files = sequenceFiles[ iSequence ];
+
+		if( files.empty() )
+		{
+			Printf( szOutput, "//Sequence \"%s\" has no animation data\n", GetName( seqdesc.label ).c_str() );
+			continue;
+		}
+
+		Printf( szOutput, "$sequence \"%s\"", GetName( seqdesc.label ).c_str() );
+
+		for( const auto& szFile : files )
+		{
+			Printf( szOutput, " \"%s/%s\"", ANIMS_DIRECTORY, szFile.c_str() );
+		}
+
+		Printf( szOutput, " fps %g", seqdesc.fps );
+
+		if( seqdesc.flags & STUDIO_LOOPING )
+			szOutput += " loop";
+
+		if( seqdesc.activity > 0 && seqdesc.activity < static_cast<int>( ARRAYSIZE( ACTIVITY_NAMES ) ) )
+			Printf( szOutput, " %s %d", ACTIVITY_NAMES[ seqdesc.activity ], seqdesc.actweight );
+
+		for( int iType = STUDIO_CONTROL_FIRST; iType <= STUDIO_CONTROL_LAST; iType <<= 1 )
+		{
+			if( seqdesc.motiontype & iType )
+				Printf( szOutput, " %s", MotionTypeToString( iType ) );
+		}
+
+		for( int iBlend = 0; iBlend < STUDIO_MAX_BLENDERS && iBlend < seqdesc.numblends - 1; ++iBlend )
+		{
+			if( const char* pszType = MotionTypeToString( seqdesc.blendtype[ iBlend ] ) )
+				Printf( szOutput, " blend %s %f %f", pszType, seqdesc.blendstart[ iBlend ], seqdesc.blendend[ iBlend ] );
+		}
+
+		if( seqdesc.entrynode || seqdesc.exitnode )
+		{
+			if( seqdesc.entrynode == seqdesc.exitnode )
+				Printf( szOutput, " node %d", seqdesc.entrynode );
+			else if( seqdesc.nodeflags )
+				Printf( szOutput, " rtransition %d %d", seqdesc.entrynode, seqdesc.exitnode );
+			else
+				Printf( szOutput, " transition %d %d", seqdesc.entrynode, seqdesc.exitnode );
+		}
+
+		if( seqdesc.numevents > 0 )
+		{
+			szOutput += "\n{\n";
+
+			const mstudioevent_t* const pEvents = reinterpret_cast<const mstudioevent_t*>( studioHdr.GetData() + seqdesc.eventindex );
+
+			for( int iEvent = 0; iEvent < seqdesc.numevents; ++iEvent )
+			{
+				const mstudioevent_t& event = pEvents[ iEvent ];
+
+				Printf( szOutput, "\t{ event %d %d", event.event, event.frame );
+
+				const std::string szOptions = GetName( event.options );
+
+				if( !szOptions.empty() )
+					Printf( szOutput, " \"%s\"", szOptions.c_str() );
+
+				szOutput += " }\n";
+			}
+
+			szOutput += "}";
+		}
+
+		szOutput += '\n';
+	}
+}
+}
+
+bool DecompileStudioModel( const CStudioModel& model, const char* const pszModelName, const char* const pszOutputDirectory, DecompileResult_t& result )
+{
+	assert( pszModelName );
+	assert( pszOutputDirectory );
+
+	result = DecompileResult_t();
+
+	if( !model.EnsureTexturePixels() )
+		return false;
+
+	const studiohdr_t& studioHdr = *model.GetStudioHeader();
+	const studiohdr_t& textureHdr = *model.GetTextureHeader();
+
+	const fs::path outputDirectory( pszOutputDirectory );
+	const fs::path animsDirectory = outputDirectory / ANIMS_DIRECTORY;
+
+	std::error_code error;
+
+	fs::create_directories( animsDirectory, error );
+
+	if( error )
+	{
+		Error( "Couldn't create directory \"%s\": %s\n", animsDirectory.string().c_str(), error.message().c_str() );
+		return false;
+	}
+
+	std::vector<DecompileJob_t> jobs;
+
+	std::vector<std::string> textureNames;
+
+	GetStudioTextureFileNames( textureHdr, textureNames );
+
+	for( int iTexture = 0; iTexture < textureHdr.numtextures; ++iTexture )
+	{
+		jobs.push_back( { outputDirectory / ( textureNames[ iTexture ] + ".bmp" ), [ &textureHdr, iTexture ]( const fs::path& path )
+			{
+				return ExportStudioTexture( textureHdr, iTexture, ImageFormat::BMP, path.string().c_str() );
+			}
+		} );
+	}
+
+	//Reference meshes. Blank submodels have no file.
+	std::set<std::string> usedNames;
+
+	std::vector<std::string> submodelNames;
+
+	for( int iBodyPart = 0; iBodyPart < studioHdr.numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t& bodyPart = *studioHdr.GetBodypart( iBodyPart );
+
+		const mstudiomodel_t* const pSubModels = reinterpret_cast<const mstudiomodel_t*>( studioHdr.GetData() + bodyPart.modelindex );
+
+		for( int iModel = 0; iModel < bodyPart.nummodels; ++iModel )
+		{
+			const mstudiomodel_t& submodel = pSubModels[ iModel ];
+
+			if( submodel.nummesh <= 0 )
+			{
+				submodelNames.emplace_back();
+				continue;
+			}
+
+			submodelNames.emplace_back( MakeUnique( usedNames, GetFileName( GetName( submodel.name ), "submodel" ) ) );
+
+			jobs.push_back( { outputDirectory / ( submodelNames.back() + ".smd" ), [ &model, &submodel, &textureNames ]( const fs::path& path )
+				{
+					return WriteFile( path, WriteReferenceSMD( model, submodel, textureNames ) );
+				}
+			} );
+		}
+	}
+
+	//Animations, one file per blend. Animation data is found here so sequence groups are loaded before the jobs run.
+	std::set<std::string> usedAnimNames;
+
+	std::vector<std::vector<std::string>> sequenceFiles( studioHdr.numseq );
+
+	for( int iSequence = 0; iSequence < studioHdr.numseq; ++iSequence )
+	{
+		const mstudioseqdesc_t& seqdesc = *studioHdr.GetSequence( iSequence );
+
+		const mstudioanim_t* const panim = model.GetAnim( &seqdesc );
+
+		if( !panim || seqdesc.numframes <= 0 )
+			continue;
+
+		const std::string szName = GetFileName( GetName( seqdesc.label ), "sequence" );
+
+		for( int iBlend = 0; iBlend < seqdesc.numblends; ++iBlend )
+		{
+			std::string szFile = MakeUnique( usedAnimNames, seqdesc.numblends > 1 ? szName + "_blend" + std::to_string( iBlend + 1 ) : szName );
+
+			const mstudioanim_t* const pBlend = panim + iBlend * studioHdr.numbones;
+
+			jobs.push_back( { animsDirectory / ( szFile + ".smd" ), [ &studioHdr, &seqdesc, pBlend ]( const fs::path& path )
+				{
+					return WriteFile( path, WriteAnimationSMD( studioHdr, seqdesc, pBlend ) );
+				}
+			} );
+
+			sequenceFiles[ iSequence ].emplace_back( std::move( szFile ) );
+		}
+	}
+
+	std::atomic<size_t> uiWritten{ 0 };
+	std::atomic<size_t> uiFailed{ 0 };
+
+	tasks::ParallelFor( jobs.size(), [ & ]( const size_t uiIndex )
+	{
+		if( jobs[ uiIndex ].write( jobs[ uiIndex ].path ) )
+			++uiWritten;
+		else
+			++uiFailed;
+	}, 1, "DecompileStudioModel" );
+
+	std::string szQC;
+
+	WriteQC( model, pszModelName, textureNames, submodelNames, sequenceFiles, szQC );
+
+	if( WriteFile( outputDirectory / ( std::string( pszModelName ) + ".qc" ), szQC ) )
+		++uiWritten;
+	else
+		++uiFailed;
+
+	result.uiFilesWritten = uiWritten;
+	result.uiFilesFailed = uiFailed;
+
+	return result.uiFilesFailed == 0;
+}
+}
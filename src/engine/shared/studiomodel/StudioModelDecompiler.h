@@ -0,0 +1,41 @@
+#ifndef GAME_STUDIOMODEL_STUDIOMODELDECOMPILER_H
+#define GAME_STUDIOMODEL_STUDIOMODELDECOMPILER_H
+
+#include <cstddef>
+
+/*
+*	Decompiles loaded models into the files studiomdl compiles them from: a QC script, reference and animation SMD files, and BMP textures.
+*	Everything is written straight from the loaded headers, so no external tool is needed and no GL is used.
+*/
+
+namespace studiomdl
+{
+class CStudioModel;
+
+struct DecompileResult_t
+{
+	/**
+	*	Number of files that were written, including the QC file.
+	*/
+	size_t uiFilesWritten = 0;
+
+	/**
+	*	Number of files that couldn't be written.
+	*/
+	size_t uiFilesFailed = 0;
+};
+
+/**
+*	Decompiles a model. Each SMD and texture is a separate task, so sequences are written in parallel.
+*	Animations are written to an "anims" subdirectory so they can't overwrite reference meshes with the same name.
+*	Sequence groups that aren't loaded yet are loaded.
+*	@param model Model to decompile.
+*	@param pszModelName Name of the model without extension. Used for the QC file and $modelname.
+*	@param pszOutputDirectory Directory to write to. Created if it doesn't exist.
+*	@param result Number of files that were and weren't written.
+*	@return Whether all files were written.
+*/
+bool DecompileStudioModel( const CStudioModel& model, const char* const pszModelName, const char* const pszOutputDirectory, DecompileResult_t& result );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOMODELDECOMPILER_H
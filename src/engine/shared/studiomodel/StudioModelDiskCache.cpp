@@ -0,0 +1,894 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include "shared/Platform.h"
+#include "shared/Logging.h"
+
+#include "graphics/Palette.h"
+
+#include "utility/CMappedFile.h"
+#include "utility/PlatUtils.h"
+
+#include "cvar/CCVar.h"
+#include "cvar/CConCommand.h"
+
+#include "StudioModelDiskCache.h"
+
+namespace studiomdl
+{
+namespace
+{
+static cvar::CCVar mdl_diskcache( "mdl_diskcache",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to cache converted model textures and meshes on disk so models open faster the next time" ) );
+
+static cvar::CCVar mdl_diskcachesize( "mdl_diskcachesize",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 256 )
+	.MinValue( 0 )
+	.HelpInfo( "Maximum size of the model disk cache, in megabytes. Least recently used models are removed first" ) );
+
+static cvar::CCVar mdl_diskcachedir( "mdl_diskcachedir",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.StringValue( "modelcache" )
+	.HelpInfo( "Directory that the model disk cache is stored in. Processes that use the same directory share entries, so each model is only prepared once" ) );
+
+static cvar::CCVar mdl_diskcachewait( "mdl_diskcachewait",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 30 )
+	.MinValue( 0 )
+	.HelpInfo( "How long to wait for another process that is preparing the same model's cache entry, in seconds, before preparing it anyway" ) );
+
+/**
+*	Directory that cache entries are stored in if none is set. Relative to the working directory, like the settings files.
+*/
+const char DEFAULT_CACHE_DIRECTORY[] = "modelcache";
+
+const char CACHE_EXTENSION[] = ".mdlcache";
+
+/**
+*	Extension of the files that mark an entry as being prepared, and of entries that haven't been published yet.
+*/
+const char CLAIM_EXTENSION[] = ".claim";
+const char TEMP_EXTENSION[] = ".tmp";
+
+/**
+*	Claims and temporary files that are older than this were left behind by processes that exited before publishing, in seconds.
+*/
+const double STALE_FILE_AGE = 120;
+
+/**
+*	Interval at which a process that waits for an entry checks whether it has been published.
+*/
+const std::chrono::milliseconds CLAIM_POLL_INTERVAL( 25 );
+
+const char CACHE_MAGIC[ 4 ] = { 'H', 'L', 'M', 'C' };
+
+/**
+*	Must be incremented whenever the layout of cache entries, or the way the data in them is prepared, changes.
+*/
+const uint32_t CACHE_VERSION = 4;
+
+/**
+*	Pixel data is aligned so it can be read efficiently straight from the mapped file.
+*/
+const size_t CACHE_PIXEL_ALIGNMENT = 16;
+
+/**
+*	Layout of a cache entry:
+*	CacheHeader_t
+*	CacheTexture_t[ uiNumTextures ]
+*	CacheMesh_t[ uiNumMeshes ]
+*	StudioMeshVertex_t[ uiNumVertices ]
+*	GLuint[ uiNumIndices ]
+*	Pixels of each texture, at the offsets in the texture table.
+*
+*	Entries are only ever read by the program that wrote them, so native byte order is used.
+*/
+struct CacheHeader_t
+{
+	char		szMagic[ 4 ];
+	uint32_t	uiVersion;
+	uint64_t	uiHash;
+
+	/**
+	*	Sizes of the data that was hashed, to catch hash collisions.
+	*/
+	uint32_t	uiStudioLength;
+	uint32_t	uiTextureLength;
+
+	uint32_t	uiNumTextures;
+
+	/**
+	*	Number of meshes, in the order they appear in the model. 0 if no mesh data was saved.
+	*/
+	uint32_t	uiNumMeshes;
+	uint32_t	uiNumVertices;
+	uint32_t	uiNumIndices;
+
+	/**
+	*	How the meshes were prepared. Mesh data is only used if this matches the current settings.
+	*	@see GetMeshFlags
+	*/
+	uint32_t	uiMeshFlags;
+};
+
+struct CacheTexture_t
+{
+	/**
+	*	Dimensions of the converted texture. 0 If the texture couldn't be converted.
+	*/
+	int32_t		iWidth;
+	int32_t		iHeight;
+
+	/**
+	*	Offset of the pixels from the start of the file.
+	*/
+	uint64_t	uiOffset;
+};
+
+struct CacheMesh_t
+{
+	uint32_t	uiFirstVertex;
+	uint32_t	uiNumVertices;
+	uint32_t	uiFirstIndex;
+	uint32_t	uiNumIndices;
+
+	float		flOriginalACMR;
+	float		flACMR;
+
+	uint32_t	uiLodFirstIndex[ STUDIO_LOD_COUNT - 1 ];
+	uint32_t	uiLodNumIndices[ STUDIO_LOD_COUNT - 1 ];
+};
+
+enum MeshFlag : uint32_t
+{
+	MESH_FLAG_OPTIMIZED	= 1 << 0,
+	MESH_FLAG_LODS		= 1 << 1
+};
+
+/**
+*	@return Flags describing how meshes are prepared with the current settings.
+*/
+uint32_t GetMeshFlags()
+{
+	uint32_t uiFlags = 0;
+
+	if( UseMeshOptimization() )
+		uiFlags |= MESH_FLAG_OPTIMIZED;
+
+	if( UseMeshLods() )
+		uiFlags |= MESH_FLAG_LODS;
+
+	return uiFlags;
+}
+
+/**
+*	Serializes saves so they don't evict each other's entries while they're being written.
+*	Other processes that share the cache aren't affected; entries are published and removed in ways that are safe without a lock.
+*/
+std::mutex g_CacheMutex;
+
+/**
+*	Claims made by this process, guarded by g_ClaimMutex.
+*/
+std::mutex g_ClaimMutex;
+std::unordered_set<std::string> g_OwnedClaims;
+
+/**
+*	Makes temporary file names unique among the threads of this process.
+*/
+std::atomic<unsigned int> g_uiTempCounter{ 0 };
+
+void GetCacheFilename( const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2, char* pszBuffer, const size_t uiBufferSize )
+{
+	snprintf( pszBuffer, uiBufferSize, "%s/%016" PRIx64 "%s%s", szDirectory.c_str(), uiHash, bPowerOf2 ? "_pow2" : "", CACHE_EXTENSION );
+}
+
+/**
+*	@return How long ago the given file was last written to, in seconds, or a negative value if it doesn't exist.
+*/
+double GetFileAge( const std::experimental::filesystem::path& path )
+{
+	namespace fs = std::experimental::filesystem;
+
+	std::error_code error;
+
+	const auto time = fs::last_write_time( path, error );
+
+	if( error )
+		return -1;
+
+	return std::chrono::duration<double>( fs::file_time_type::clock::now() - time ).count();
+}
+
+/**
+*	Atomically creates the claim of an entry. Only one process can hold a claim at a time.
+*	@return Whether this process now holds the claim.
+*/
+bool TryClaimEntry( const std::string& szClaim )
+{
+	//Fails if the file exists, even if another process creates it at the same time.
+	FILE* pFile = fopen( szClaim.c_str(), "wx" );
+
+	if( !pFile )
+		return false;
+
+	fprintf( pFile, "%u\n", plat::GetProcessId() );
+	fclose( pFile );
+
+	std::lock_guard<std::mutex> lock( g_ClaimMutex );
+
+	g_OwnedClaims.insert( szClaim );
+
+	return true;
+}
+
+/**
+*	Removes the claim of an entry if this process holds it.
+*/
+void ReleaseClaim( const std::string& szClaim )
+{
+	{
+		std::lock_guard<std::mutex> lock( g_ClaimMutex );
+
+		if( !g_OwnedClaims.erase( szClaim ) )
+			return;
+	}
+
+	std::error_code error;
+
+	std::experimental::filesystem::remove( szClaim, error );
+}
+
+/**
+*	Waits until an entry exists. If no process is preparing it, claims it so that other processes wait for this one instead.
+*	@param szDirectory Cache directory that the entry is in.
+*	@param bWait Whether to wait for another process that is preparing the entry. If not, the caller prepares it as well.
+*	@return Whether the entry exists. If not, the caller should prepare the entry and save it, which releases the claim if there is one.
+*/
+bool WaitForCacheEntry( const std::string& szDirectory, const char* const pszFilename, const bool bWait )
+{
+	namespace fs = std::experimental::filesystem;
+
+	std::error_code error;
+
+	if( fs::exists( pszFilename, error ) )
+		return true;
+
+	//Without a directory no process can have saved the entry, and claims can't be made.
+	if( !fs::create_directories( szDirectory, error ) && error )
+		return false;
+
+	const std::string szClaim = std::string( pszFilename ) + CLAIM_EXTENSION;
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>( std::max( 0.0f, mdl_diskcachewait.GetFloat() ) );
+
+	bool bWaited = false;
+
+	while( true )
+	{
+		if( TryClaimEntry( szClaim ) )
+		{
+			//The entry may have been published between checking for it and claiming it.
+			if( fs::exists( pszFilename, error ) )
+			{
+				ReleaseClaim( szClaim );
+				return true;
+			}
+
+			return false;
+		}
+
+		if( fs::exists( pszFilename, error ) )
+		{
+			if( bWaited )
+				Message( "Using model cache entry \"%s\" prepared by another process\n", pszFilename );
+
+			return true;
+		}
+
+		//The process that made the claim exited without publishing, so the claim can be taken over.
+		if( GetFileAge( szClaim ) > STALE_FILE_AGE )
+		{
+			fs::remove( szClaim, error );
+			continue;
+		}
+
+		if( !bWait )
+			return false;
+
+		if( std::chrono::steady_clock::now() >= deadline )
+		{
+			Warning( "Timed out waiting for model cache entry \"%s\", preparing it in this process\n", pszFilename );
+			return false;
+		}
+
+		bWaited = true;
+
+		std::this_thread::sleep_for( CLAIM_POLL_INTERVAL );
+	}
+}
+
+/**
+*	FNV-1a over 64 bit words. The upper half is folded back in after every step, so every bit of the data affects the whole hash.
+*/
+uint64_t HashData( uint64_t uiHash, const byte* const pData, const size_t uiSize )
+{
+	const uint64_t FNV_PRIME = 0x100000001B3ULL;
+
+	size_t uiIndex = 0;
+
+	for( ; uiIndex + sizeof( uint64_t ) <= uiSize; uiIndex += sizeof( uint64_t ) )
+	{
+		uint64_t uiWord;
+		memcpy( &uiWord, pData + uiIndex, sizeof( uiWord ) );
+
+		uiHash = ( uiHash ^ uiWord ) * FNV_PRIME;
+		uiHash ^= uiHash >> 32;
+	}
+
+	for( ; uiIndex < uiSize; ++uiIndex )
+	{
+		uiHash = ( uiHash ^ pData[ uiIndex ] ) * FNV_PRIME;
+	}
+
+	return uiHash;
+}
+
+/**
+*	Calls the given function for every mesh in the model, in the order they're converted in.
+*/
+template<typename FUNC>
+void ForEachMesh( const studiohdr_t* const pStudioHdr, FUNC func )
+{
+	for( int iBodyPart = 0; iBodyPart < pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = pStudioHdr->GetBodypart( iBodyPart );
+
+		const mstudiomodel_t* const pModels = ( const mstudiomodel_t* ) ( pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			const mstudiomodel_t& model = pModels[ iModel ];
+
+			const mstudiomesh_t* const pMeshes = ( const mstudiomesh_t* ) ( pStudioHdr->GetData() + model.meshindex );
+
+			for( int iMesh = 0; iMesh < model.nummesh; ++iMesh )
+			{
+				func( model, pMeshes[ iMesh ] );
+			}
+		}
+	}
+}
+
+size_t CountMeshes( const studiohdr_t* const pStudioHdr )
+{
+	size_t uiCount = 0;
+
+	ForEachMesh( pStudioHdr, [ & ]( const mstudiomodel_t&, const mstudiomesh_t& ) { ++uiCount; } );
+
+	return uiCount;
+}
+
+size_t AlignPixelOffset( const size_t uiOffset )
+{
+	return ( uiOffset + CACHE_PIXEL_ALIGNMENT - 1 ) & ~( CACHE_PIXEL_ALIGNMENT - 1 );
+}
+
+/**
+*	Removes the least recently used entries in the given directory until the cache fits in its budget.
+*/
+void EvictCacheEntries( const std::string& szDirectory )
+{
+	namespace fs = std::experimental::filesystem;
+
+	struct Entry_t
+	{
+		fs::path path;
+		fs::file_time_type time;
+		uintmax_t uiSize;
+	};
+
+	std::vector<Entry_t> entries;
+
+	uintmax_t uiTotalSize = 0;
+
+	std::error_code error;
+
+	for( fs::directory_iterator it( szDirectory, error ), end; !error && it != end; it.increment( error ) )
+	{
+		const auto extension = it->path().extension();
+
+		//Left behind by processes that exited while they were preparing an entry.
+		if( extension == CLAIM_EXTENSION || extension == TEMP_EXTENSION )
+		{
+			std::error_code removeError;
+
+			if( GetFileAge( it->path() ) > STALE_FILE_AGE )
+				fs::remove( it->path(), removeError );
+
+			continue;
+		}
+
+		if( extension != CACHE_EXTENSION )
+			continue;
+
+		std::error_code entryError;
+
+		Entry_t entry{ it->path(), fs::last_write_time( it->path(), entryError ), fs::file_size( it->path(), entryError ) };
+
+		if( entryError )
+			continue;
+
+		uiTotalSize += entry.uiSize;
+
+		entries.emplace_back( std::move( entry ) );
+	}
+
+	const uintmax_t uiBudget = static_cast<uintmax_t>( std::max( 0.0f, mdl_diskcachesize.GetFloat() ) * 1024 * 1024 );
+
+	if( uiTotalSize <= uiBudget )
+		return;
+
+	std::sort( entries.begin(), entries.end(), []( const Entry_t& lhs, const Entry_t& rhs ) { return lhs.time < rhs.time; } );
+
+	for( const auto& entry : entries )
+	{
+		if( uiTotalSize <= uiBudget )
+			break;
+
+		std::error_code removeError;
+
+		//Processes that have an entry mapped keep reading it after it's removed. Where open files can't be removed, it stays until the next eviction.
+		if( fs::remove( entry.path, removeError ) )
+			uiTotalSize -= entry.uiSize;
+	}
+}
+
+static cvar::CConCommand mdl_diskcache_clear( "mdl_diskcache_clear",
+	[]( const util::CCommand& )
+	{
+		namespace fs = std::experimental::filesystem;
+
+		std::lock_guard<std::mutex> lock( g_CacheMutex );
+
+		size_t uiRemoved = 0;
+
+		std::error_code error;
+
+		for( fs::directory_iterator it( GetStudioModelCacheDirectory(), error ), end; !error && it != end; it.increment( error ) )
+		{
+			std::error_code removeError;
+
+			if( it->path().extension() == CACHE_EXTENSION && fs::remove( it->path(), removeError ) )
+				++uiRemoved;
+		}
+
+		Message( "Removed %u model cache entries\n", static_cast<unsigned int>( uiRemoved ) );
+	},
+	cvar::Flag::NONE, "Removes all entries from the model disk cache" );
+}
+
+bool UseStudioModelDiskCache()
+{
+	return mdl_diskcache.GetBool();
+}
+
+std::string GetStudioModelCacheDirectory()
+{
+	const char* const pszDirectory = mdl_diskcachedir.GetString();
+
+	return *pszDirectory ? pszDirectory : DEFAULT_CACHE_DIRECTORY;
+}
+
+void ReleaseStudioModelCacheClaim( const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2 )
+{
+	char szFilename[ MAX_PATH_LENGTH ];
+
+	GetCacheFilename( szDirectory, uiHash, bPowerOf2, szFilename, sizeof( szFilename ) );
+
+	ReleaseClaim( std::string( szFilename ) + CLAIM_EXTENSION );
+}
+
+uint64_t HashStudioModel( const CStudioModel& model )
+{
+	model.EnsureTexturePixels();
+
+	const studiohdr_t* const pStudioHdr = model.GetStudioHeader();
+	const studiohdr_t* const pTextureHdr = model.GetTextureHeader();
+
+	uint64_t uiHash = 0xCBF29CE484222325ULL;
+
+	uiHash = HashData( uiHash, reinterpret_cast<const byte*>( pStudioHdr ), pStudioHdr->length );
+
+	if( pTextureHdr != pStudioHdr )
+		uiHash = HashData( uiHash, reinterpret_cast<const byte*>( pTextureHdr ), pTextureHdr->length );
+
+	return uiHash;
+}
+
+uint64_t HashStudioTexture( const CStudioModel& model, const int iIndex )
+{
+	model.EnsureTexturePixels();
+
+	const studiohdr_t* const pTextureHdr = model.GetTextureHeader();
+
+	const mstudiotexture_t& texture = pTextureHdr->GetTextures()[ iIndex ];
+
+	const int32_t iProperties[] = { texture.width, texture.height, texture.flags };
+
+	uint64_t uiHash = 0xCBF29CE484222325ULL;
+
+	uiHash = HashData( uiHash, reinterpret_cast<const byte*>( iProperties ), sizeof( iProperties ) );
+
+	//Pixels are followed by the palette.
+	uiHash = HashData( uiHash, pTextureHdr->GetData() + texture.index, static_cast<size_t>( texture.width ) * texture.height + PALETTE_SIZE );
+
+	return uiHash;
+}
+
+bool LoadStudioModelCache( CStudioModel& model, const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2, const bool bWait, std::vector<StudioRGBATexture_t>& textures )
+{
+	char szFilename[ MAX_PATH_LENGTH ];
+
+	GetCacheFilename( szDirectory, uiHash, bPowerOf2, szFilename, sizeof( szFilename ) );
+
+	if( !WaitForCacheEntry( szDirectory, szFilename, bWait ) )
+		return false;
+
+	CMappedFile file;
+
+	if( !file.Open( szFilename ) )
+		return false;
+
+	const byte* const pData = reinterpret_cast<const byte*>( file.GetData() );
+	const size_t uiSize = file.GetSize();
+
+	if( uiSize < sizeof( CacheHeader_t ) )
+		return false;
+
+	const CacheHeader_t& header = *reinterpret_cast<const CacheHeader_t*>( pData );
+
+	const studiohdr_t* const pStudioHdr = model.m_pStudioHdr;
+	const studiohdr_t* const pTextureHdr = model.m_pTextureHdr;
+
+	if( memcmp( header.szMagic, CACHE_MAGIC, sizeof( CACHE_MAGIC ) ) ||
+		header.uiVersion != CACHE_VERSION ||
+		header.uiHash != uiHash ||
+		header.uiStudioLength != static_cast<uint32_t>( pStudioHdr->length ) ||
+		header.uiTextureLength != static_cast<uint32_t>( pTextureHdr->length ) ||
+		header.uiNumTextures != static_cast<uint32_t>( model.GetUploadableTextureCount() ) )
+	{
+		return false;
+	}
+
+	const size_t uiNumMeshes = CountMeshes( pStudioHdr );
+
+	if( header.uiNumMeshes != 0 && header.uiNumMeshes != uiNumMeshes )
+		return false;
+
+	const size_t uiTablesSize =
+		sizeof( CacheHeader_t ) +
+		header.uiNumTextures * sizeof( CacheTexture_t ) +
+		header.uiNumMeshes * sizeof( CacheMesh_t ) +
+		header.uiNumVertices * sizeof( StudioMeshVertex_t ) +
+		header.uiNumIndices * sizeof( GLuint );
+
+	if( uiSize < uiTablesSize )
+		return false;
+
+	const CacheTexture_t* const pTextures = reinterpret_cast<const CacheTexture_t*>( pData + sizeof( CacheHeader_t ) );
+	const CacheMesh_t* const pMeshes = reinterpret_cast<const CacheMesh_t*>( pTextures + header.uiNumTextures );
+	const StudioMeshVertex_t* const pVertices = reinterpret_cast<const StudioMeshVertex_t*>( pMeshes + header.uiNumMeshes );
+	const GLuint* const pIndices = reinterpret_cast<const GLuint*>( pVertices + header.uiNumVertices );
+
+	for( uint32_t uiIndex = 0; uiIndex < header.uiNumTextures; ++uiIndex )
+	{
+		const CacheTexture_t& texture = pTextures[ uiIndex ];
+
+		if( texture.iWidth < 0 || texture.iHeight < 0 ||
+			texture.uiOffset > uiSize ||
+			( uiSize - texture.uiOffset ) / 4 < static_cast<uint64_t>( texture.iWidth ) * texture.iHeight )
+		{
+			return false;
+		}
+	}
+
+	for( uint32_t uiIndex = 0; uiIndex < header.uiNumMeshes; ++uiIndex )
+	{
+		const CacheMesh_t& mesh = pMeshes[ uiIndex ];
+
+		if( mesh.uiFirstVertex > header.uiNumVertices || mesh.uiNumVertices > header.uiNumVertices - mesh.uiFirstVertex ||
+			mesh.uiFirstIndex > header.uiNumIndices || mesh.uiNumIndices > header.uiNumIndices - mesh.uiFirstIndex )
+		{
+			return false;
+		}
+
+		for( int iLod = 1; iLod < STUDIO_LOD_COUNT; ++iLod )
+		{
+			if( mesh.uiLodFirstIndex[ iLod - 1 ] > header.uiNumIndices || mesh.uiLodNumIndices[ iLod - 1 ] > header.uiNumIndices - mesh.uiLodFirstIndex[ iLod - 1 ] )
+				return false;
+		}
+	}
+
+	textures.clear();
+	textures.resize( header.uiNumTextures );
+
+	for( uint32_t uiIndex = 0; uiIndex < header.uiNumTextures; ++uiIndex )
+	{
+		const CacheTexture_t& cachedTexture = pTextures[ uiIndex ];
+
+		StudioRGBATexture_t& texture = textures[ uiIndex ];
+
+		texture.iIndex = static_cast<int>( uiIndex );
+		texture.iWidth = cachedTexture.iWidth;
+		texture.iHeight = cachedTexture.iHeight;
+
+		if( cachedTexture.iWidth > 0 && cachedTexture.iHeight > 0 )
+		{
+			const size_t uiPixelsSize = static_cast<size_t>( cachedTexture.iWidth ) * cachedTexture.iHeight * 4;
+
+			texture.pixels = mem::AllocateArray<byte>( uiPixelsSize, mem::Tag::STUDIO_TEXTURE );
+
+			memcpy( texture.pixels.get(), pData + cachedTexture.uiOffset, uiPixelsSize );
+		}
+	}
+
+	//Mesh data can only be used if the model's meshes haven't been converted yet, and if this system can draw them.
+	if( header.uiNumMeshes != 0 && GLEW_VERSION_1_5 && model.m_MeshBuffers.empty() && header.uiMeshFlags == GetMeshFlags() )
+	{
+		model.m_MeshVertices.assign( pVertices, pVertices + header.uiNumVertices );
+		model.m_MeshIndices.assign( pIndices, pIndices + header.uiNumIndices );
+
+		const CacheMesh_t* pMesh = pMeshes;
+
+		ForEachMesh( pStudioHdr,
+			[ & ]( const mstudiomodel_t& studioModel, const mstudiomesh_t& studioMesh )
+			{
+				StudioMeshBuffer_t buffer;
+
+				buffer.pModel = &studioModel;
+				buffer.uiFirstVertex = pMesh->uiFirstVertex;
+				buffer.uiNumVertices = pMesh->uiNumVertices;
+				buffer.uiFirstIndex = pMesh->uiFirstIndex;
+				buffer.uiNumIndices = pMesh->uiNumIndices;
+				buffer.flOriginalACMR = pMesh->flOriginalACMR;
+				buffer.flACMR = pMesh->flACMR;
+
+				for( int iLod = 1; iLod < STUDIO_LOD_COUNT; ++iLod )
+				{
+					buffer.lods[ iLod - 1 ].uiFirstIndex = pMesh->uiLodFirstIndex[ iLod - 1 ];
+					buffer.lods[ iLod - 1 ].uiNumIndices = pMesh->uiLodNumIndices[ iLod - 1 ];
+				}
+
+				model.m_MeshBuffers.emplace( &studioMesh, buffer );
+
+				++pMesh;
+			}
+		);
+	}
+
+	file.Close();
+
+	//Mark the entry as recently used so it's evicted last.
+	std::error_code error;
+
+	std::experimental::filesystem::last_write_time( szFilename, std::experimental::filesystem::file_time_type::clock::now(), error );
+
+	return true;
+}
+
+bool SaveStudioModelCache( const CStudioModel& model, const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2, const std::vector<StudioRGBATexture_t>& textures )
+{
+	char szFilename[ MAX_PATH_LENGTH ];
+
+	GetCacheFilename( szDirectory, uiHash, bPowerOf2, szFilename, sizeof( szFilename ) );
+
+	//Other processes stop waiting once the entry is published or the claim is gone, whichever way this returns.
+	struct ReleaseOnExit_t
+	{
+		const std::string szClaim;
+
+		~ReleaseOnExit_t()
+		{
+			ReleaseClaim( szClaim );
+		}
+	} releaseOnExit{ std::string( szFilename ) + CLAIM_EXTENSION };
+
+	const studiohdr_t* const pStudioHdr = model.m_pStudioHdr;
+	const studiohdr_t* const pTextureHdr = model.m_pTextureHdr;
+
+	if( textures.size() != static_cast<size_t>( model.GetUploadableTextureCount() ) )
+		return false;
+
+	//Indices are freed once they've been uploaded, so mesh data can only be saved before that.
+	const bool bSaveMeshes = !model.m_MeshBuffers.empty() && !model.m_MeshIndices.empty();
+
+	CacheHeader_t header;
+
+	memcpy( header.szMagic, CACHE_MAGIC, sizeof( CACHE_MAGIC ) );
+	header.uiVersion = CACHE_VERSION;
+	header.uiHash = uiHash;
+	header.uiStudioLength = static_cast<uint32_t>( pStudioHdr->length );
+	header.uiTextureLength = static_cast<uint32_t>( pTextureHdr->length );
+	header.uiNumTextures = static_cast<uint32_t>( textures.size() );
+	header.uiNumMeshes = bSaveMeshes ? static_cast<uint32_t>( model.m_MeshBuffers.size() ) : 0;
+	header.uiNumVertices = bSaveMeshes ? static_cast<uint32_t>( model.m_MeshVertices.size() ) : 0;
+	header.uiNumIndices = bSaveMeshes ? static_cast<uint32_t>( model.m_MeshIndices.size() ) : 0;
+	header.uiMeshFlags = GetMeshFlags();
+
+	std::vector<CacheTexture_t> textureTable( textures.size() );
+
+	size_t uiOffset = sizeof( CacheHeader_t ) +
+		header.uiNumTextures * sizeof( CacheTexture_t ) +
+		header.uiNumMeshes * sizeof( CacheMesh_t ) +
+		header.uiNumVertices * sizeof( StudioMeshVertex_t ) +
+		header.uiNumIndices * sizeof( GLuint );
+
+	for( size_t uiIndex = 0; uiIndex < textures.size(); ++uiIndex )
+	{
+		const StudioRGBATexture_t& texture = textures[ uiIndex ];
+
+		CacheTexture_t& cachedTexture = textureTable[ uiIndex ];
+
+		const bool bHasPixels = texture.pixels != nullptr;
+
+		uiOffset = AlignPixelOffset( uiOffset );
+
+		cachedTexture.iWidth = bHasPixels ? texture.iWidth : 0;
+		cachedTexture.iHeight = bHasPixels ? texture.iHeight : 0;
+		cachedTexture.uiOffset = uiOffset;
+
+		uiOffset += static_cast<size_t>( cachedTexture.iWidth ) * cachedTexture.iHeight * 4;
+	}
+
+	std::vector<CacheMesh_t> meshTable;
+
+	if( bSaveMeshes )
+	{
+		meshTable.reserve( header.uiNumMeshes );
+
+		ForEachMesh( pStudioHdr,
+			[ & ]( const mstudiomodel_t&, const mstudiomesh_t& studioMesh )
+			{
+				const StudioMeshBuffer_t* const pBuffer = model.GetMeshBuffer( &studioMesh );
+
+				CacheMesh_t mesh;
+
+				mesh.uiFirstVertex = static_cast<uint32_t>( pBuffer->uiFirstVertex );
+				mesh.uiNumVertices = static_cast<uint32_t>( pBuffer->uiNumVertices );
+				mesh.uiFirstIndex = static_cast<uint32_t>( pBuffer->uiFirstIndex );
+				mesh.uiNumIndices = static_cast<uint32_t>( pBuffer->uiNumIndices );
+				mesh.flOriginalACMR = pBuffer->flOriginalACMR;
+				mesh.flACMR = pBuffer->flACMR;
+
+				for( int iLod = 1; iLod < STUDIO_LOD_COUNT; ++iLod )
+				{
+					mesh.uiLodFirstIndex[ iLod - 1 ] = static_cast<uint32_t>( pBuffer->lods[ iLod - 1 ].uiFirstIndex );
+					mesh.uiLodNumIndices[ iLod - 1 ] = static_cast<uint32_t>( pBuffer->lods[ iLod - 1 ].uiNumIndices );
+				}
+
+				meshTable.push_back( mesh );
+			}
+		);
+	}
+
+	std::lock_guard<std::mutex> lock( g_CacheMutex );
+
+	std::error_code error;
+
+	std::experimental::filesystem::create_directories( szDirectory, error );
+
+	if( error )
+	{
+		Warning( "SaveStudioModelCache: Couldn't create cache directory \"%s\"\n", szDirectory.c_str() );
+		return false;
+	}
+
+	//Written to a temporary file first so a cache entry is never seen half written.
+	//The name is unique to this process and thread, so processes preparing the same entry don't write to the same file.
+	char szTempFilename[ MAX_PATH_LENGTH ];
+
+	snprintf( szTempFilename, sizeof( szTempFilename ), "%s.%u.%u%s", szFilename, plat::GetProcessId(), g_uiTempCounter++, TEMP_EXTENSION );
+
+	FILE* pFile = fopen( szTempFilename, "wb" );
+
+	if( !pFile )
+	{
+		Warning( "SaveStudioModelCache: Couldn't open \"%s\" for writing\n", szTempFilename );
+		return false;
+	}
+
+	bool bSuccess =
+		fwrite( &header, sizeof( header ), 1, pFile ) == 1 &&
+		fwrite( textureTable.data(), sizeof( CacheTexture_t ), textureTable.size(), pFile ) == textureTable.size() &&
+		fwrite( meshTable.data(), sizeof( CacheMesh_t ), meshTable.size(), pFile ) == meshTable.size();
+
+	if( bSuccess && bSaveMeshes )
+	{
+		bSuccess =
+			fwrite( model.m_MeshVertices.data(), sizeof( StudioMeshVertex_t ), model.m_MeshVertices.size(), pFile ) == model.m_MeshVertices.size() &&
+			fwrite( model.m_MeshIndices.data(), sizeof( GLuint ), model.m_MeshIndices.size(), pFile ) == model.m_MeshIndices.size();
+	}
+
+	for( size_t uiIndex = 0; bSuccess && uiIndex < textures.size(); ++uiIndex )
+	{
+		const CacheTexture_t& cachedTexture = textureTable[ uiIndex ];
+
+		const size_t uiPixelsSize = static_cast<size_t>( cachedTexture.iWidth ) * cachedTexture.iHeight * 4;
+
+		//Pad up to the texture's offset.
+		const byte padding[ CACHE_PIXEL_ALIGNMENT ] = {};
+
+		const long iPosition = ftell( pFile );
+
+		bSuccess = iPosition >= 0 && static_cast<uint64_t>( iPosition ) <= cachedTexture.uiOffset;
+
+		if( bSuccess )
+		{
+			const size_t uiPadding = static_cast<size_t>( cachedTexture.uiOffset - static_cast<uint64_t>( iPosition ) );
+
+			bSuccess = fwrite( padding, 1, uiPadding, pFile ) == uiPadding;
+		}
+
+		if( bSuccess && uiPixelsSize > 0 )
+			bSuccess = fwrite( textures[ uiIndex ].pixels.get(), 1, uiPixelsSize, pFile ) == uiPixelsSize;
+	}
+
+	bSuccess = fclose( pFile ) == 0 && bSuccess;
+
+	if( bSuccess )
+	{
+		//Renaming publishes the entry atomically: other processes either don't see it yet, or see all of it.
+		//Processes that have an older copy mapped keep reading that one.
+		std::experimental::filesystem::rename( szTempFilename, szFilename, error );
+
+		//Platforms that don't replace existing files need the old entry removed first. That fails while another process has it open,
+		//but entries are named after the hash of the data they were prepared from, so an entry that another process published
+		//in the meantime has the same contents and can be kept.
+		if( error && std::experimental::filesystem::exists( szFilename ) )
+		{
+			std::error_code removeError;
+
+			if( std::experimental::filesystem::remove( szFilename, removeError ) )
+				std::experimental::filesystem::rename( szTempFilename, szFilename, error );
+
+			if( error && std::experimental::filesystem::exists( szFilename ) )
+			{
+				std::experimental::filesystem::remove( szTempFilename, error );
+				error.clear();
+			}
+		}
+
+		bSuccess = !error;
+	}
+
+	if( !bSuccess )
+	{
+		Warning( "SaveStudioModelCache: Couldn't write cache entry \"%s\"\n", szFilename );
+		std::experimental::filesystem::remove( szTempFilename, error );
+		return false;
+	}
+
+	EvictCacheEntries( szDirectory );
+
+	return true;
+}
+}
@@ -0,0 +1,79 @@
+#ifndef GAME_STUDIOMODEL_STUDIOMODELDISKCACHE_H
+#define GAME_STUDIOMODEL_STUDIOMODELDISKCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CStudioModel.h"
+
+/*
+*	On-disk cache of model data that is expensive to prepare: textures converted to RGBA and meshes converted to indexed triangle lists.
+*	Entries are keyed on a hash of the model's data, so files that have changed since they were cached never use stale data.
+*	Several processes can share a cache directory: entries are mapped read only, so the system shares their pages between processes,
+*	and new entries are published by renaming a finished file into place. A process that prepares an entry claims it first,
+*	so other processes that need the same model wait for it instead of preparing it again.
+*/
+
+namespace studiomdl
+{
+/**
+*	@return Whether the disk cache is enabled.
+*/
+bool UseStudioModelDiskCache();
+
+/**
+*	@return Directory that cache entries are stored in. Reads a string cvar, so this must be called on the main thread.
+*	Code that uses the cache on other threads reads the directory once beforehand and passes it along.
+*/
+std::string GetStudioModelCacheDirectory();
+
+/**
+*	Hashes the data of a model that cache entries are prepared from.
+*/
+uint64_t HashStudioModel( const CStudioModel& model );
+
+/**
+*	Hashes the data that a texture is converted from: its dimensions, flags, pixels and palette.
+*	Textures with equal hashes convert to the same RGBA image, so an uploaded copy of one can be used for the other.
+*	@param model Model whose texture to hash.
+*	@param iIndex Index of the texture. Must be an uploadable texture.
+*/
+uint64_t HashStudioTexture( const CStudioModel& model, const int iIndex );
+
+/**
+*	Loads a model's converted textures and mesh data from its cache entry. Does not use GL, so this can be called from any thread.
+*	@param model Model to load the cache entry of. If the entry has mesh data, the model's meshes don't have to be converted anymore.
+*	@param szDirectory Cache directory, as returned by GetStudioModelCacheDirectory.
+*	@param uiHash Hash of the model.
+*	@param bPowerOf2 Whether textures are resized to power of 2 dimensions.
+*	@param bWait Whether to wait for another process that is preparing the entry. Must be false on threads that can't block, like the main thread.
+*	@param textures Converted textures, indexed by texture. Textures that couldn't be converted have no pixels.
+*	@return Whether the model had a valid cache entry.
+*	If another process is preparing the entry and bWait is true, waits for it to be published first. If no process is, the entry is claimed and this returns false;
+*	the caller should prepare the entry and save it, or release the claim if it gives up.
+*	@see HashStudioModel
+*	@see ReleaseStudioModelCacheClaim
+*/
+bool LoadStudioModelCache( CStudioModel& model, const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2, const bool bWait, std::vector<StudioRGBATexture_t>& textures );
+
+/**
+*	Saves a model's converted textures and mesh data to its cache entry. Removes the least recently used entries if the cache is over budget.
+*	Mesh data is only saved if it hasn't been uploaded yet. Releases this process's claim on the entry, whether it was saved or not.
+*	@param model Model to save the cache entry of.
+*	@param szDirectory Cache directory, as returned by GetStudioModelCacheDirectory.
+*	@param uiHash Hash of the model.
+*	@param bPowerOf2 Whether textures were resized to power of 2 dimensions.
+*	@param textures Converted textures, indexed by texture.
+*	@return Whether the entry was saved.
+*/
+bool SaveStudioModelCache( const CStudioModel& model, const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2, const std::vector<StudioRGBATexture_t>& textures );
+
+/**
+*	Releases this process's claim on a cache entry that won't be saved, so other processes stop waiting for it. Does nothing if there is no claim.
+*	@see LoadStudioModelCache
+*/
+void ReleaseStudioModelCacheClaim( const std::string& szDirectory, const uint64_t uiHash, const bool bPowerOf2 );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOMODELDISKCACHE_H
@@ -0,0 +1,1226 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+#include <memory>
+#include <vector>
+
+#include "shared/Platform.h"
+#include "shared/Logging.h"
+#include "shared/TaskScheduler.h"
+
+#include "utility/CMappedFile.h"
+
+#include "StudioModelDump.h"
+#include "StudioModelValidation.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Buffered writer. Formats everything into one string so the file is written with a single call.
+*/
+class CDumpWriter final
+{
+public:
+	CDumpWriter( std::string& szBuffer )
+		: m_szBuffer( szBuffer )
+	{
+	}
+
+	void Printf( const char* const pszFormat, ... )
+	{
+		const size_t uiOffset = m_szBuffer.size();
+
+		va_list list;
+
+		va_start( list, pszFormat );
+
+		va_list copy;
+
+		va_copy( copy, list );
+
+		m_szBuffer.resize( uiOffset + INITIAL_SIZE );
+
+		int iResult = vsnprintf( &m_szBuffer[ uiOffset ], INITIAL_SIZE, pszFormat, list );
+
+		//Didn't fit, format again with enough room.
+		if( iResult >= static_cast<int>( INITIAL_SIZE ) )
+		{
+			m_szBuffer.resize( uiOffset + iResult + 1 );
+
+			iResult = vsnprintf( &m_szBuffer[ uiOffset ], iResult + 1, pszFormat, copy );
+		}
+
+		va_end( copy );
+		va_end( list );
+
+		m_szBuffer.resize( uiOffset + std::max( iResult, 0 ) );
+	}
+
+	void Write( const char* const pszString, const size_t uiLength )
+	{
+		m_szBuffer.append( pszString, uiLength );
+	}
+
+	void Write( const char* const pszString )
+	{
+		m_szBuffer.append( pszString );
+	}
+
+	void Write( const char character )
+	{
+		m_szBuffer.push_back( character );
+	}
+
+private:
+	static const size_t INITIAL_SIZE = 256;
+
+	std::string& m_szBuffer;
+
+private:
+	CDumpWriter( const CDumpWriter& ) = delete;
+	CDumpWriter& operator=( const CDumpWriter& ) = delete;
+};
+
+/**
+*	Gets the length of a fixed size string. Strings in model files are not guaranteed to be null terminated.
+*/
+template<size_t SIZE>
+int StrLen( const char ( &szString )[ SIZE ] )
+{
+	return static_cast<int>( strnlen( szString, SIZE ) );
+}
+
+/**
+*	Writes the dump in the original HLMV text layout.
+*/
+void DumpText( const studiohdr_t& studioHdr, const studiohdr_t& textureHdr, CDumpWriter& writer )
+{
+	const studiohdr_t* const pHdr = &studioHdr;
+
+	const char* const pId = reinterpret_cast<const char*>( &pHdr->id );
+
+	writer.Printf(
+			 "ID Tag: %c%c%c%c\n"
+			 "Version: %d\n"
+			 "Name: \"%.*s\"\n"
+			 "Length: %d\n\n",
+			 pId[ 0 ], pId[ 1 ], pId[ 2 ], pId[ 3 ],
+			 pHdr->version,
+			 StrLen( pHdr->name ), pHdr->name,
+			 pHdr->length
+	);
+
+	writer.Printf(
+			 "Eye Position: %.6f %.6f %.6f\n"
+			 "Min: %.6f %.6f %.6f\n"
+			 "Max: %.6f %.6f %.6f\n"
+			 "Bounding Box Min: %.6f %.6f %.6f\n"
+			 "Bounding Box Max: %.6f %.6f %.6f\n"
+			 "Flags: %d\n\n",
+			 pHdr->eyeposition[ 0 ], pHdr->eyeposition[ 1 ], pHdr->eyeposition[ 2 ],
+			 pHdr->min[ 0 ], pHdr->min[ 1 ], pHdr->min[ 2 ],
+			 pHdr->max[ 0 ], pHdr->max[ 1 ], pHdr->max[ 2 ],
+			 pHdr->bbmin[ 0 ], pHdr->bbmin[ 1 ], pHdr->bbmin[ 2 ],
+			 pHdr->bbmax[ 0 ], pHdr->bbmax[ 1 ], pHdr->bbmax[ 2 ],
+			 pHdr->flags
+	);
+
+	writer.Printf(
+			 "Number of Bones: %d\n\n",
+			 pHdr->numbones
+	);
+
+	{
+		const mstudiobone_t* pBone = pHdr->GetBones();
+
+		for( int iIndex = 0; iIndex < pHdr->numbones; ++iIndex, ++pBone )
+		{
+			writer.Printf(
+					 "Bone %d Name: \"%.*s\"\n"
+					 "Bone %d Parent: %d\n"
+					 "Bone %d Flags: %d\n"
+					 "Bone %d Bonecontroller: %d %d %d %d %d %d\n"
+					 "Bone %d Value: %.6f %.6f %.6f %.6f %.6f %.6f\n"
+					 "Bone %d Scale: %.6f %.6f %.6f %.6f %.6f %.6f\n\n",
+					 iIndex + 1, StrLen( pBone->name ), pBone->name,
+					 iIndex + 1, pBone->parent,
+					 iIndex + 1, pBone->flags,
+					 iIndex + 1, pBone->bonecontroller[ 0 ], pBone->bonecontroller[ 1 ], pBone->bonecontroller[ 2 ],
+									pBone->bonecontroller[ 3 ], pBone->bonecontroller[ 4 ], pBone->bonecontroller[ 5 ],
+					 iIndex + 1, pBone->value[ 0 ], pBone->value[ 1 ], pBone->value[ 2 ], pBone->value[ 3 ], pBone->value[ 4 ], pBone->value[ 5 ],
+					 iIndex + 1, pBone->scale[ 0 ], pBone->scale[ 1 ], pBone->scale[ 2 ], pBone->scale[ 3 ], pBone->scale[ 4 ], pBone->scale[ 5 ]
+			);
+		}
+	}
+
+	writer.Printf(
+			 "Number of Bone Controllers: %d\n\n",
+			 pHdr->numbonecontrollers
+	);
+
+	{
+		const mstudiobonecontroller_t* pBoneC = pHdr->GetBoneControllers();
+
+		for( int iIndex = 0; iIndex < pHdr->numbonecontrollers; ++iIndex, ++pBoneC )
+		{
+			writer.Printf(
+					 "Bone Controller %d Bone: %d\n"
+					 "Bone Controller %d Type: %d\n"
+					 "Bone Controller %d Start: %f\n"
+					 "Bone Controller %d End: %f\n"
+					 "Bone Controller %d Rest: %d\n"
+					 "Bone Controller %d Index: %d\n\n",
+					 iIndex + 1, pBoneC->bone,
+					 iIndex + 1, pBoneC->type,
+					 iIndex + 1, pBoneC->start,
+					 iIndex + 1, pBoneC->end,
+					 iIndex + 1, pBoneC->rest,
+					 iIndex + 1, pBoneC->index
+			);
+		}
+	}
+
+	writer.Printf(
+			 "Number of Hitboxes: %d\n\n",
+			 pHdr->numhitboxes
+	);
+
+	{
+		const mstudiobbox_t* pHB = pHdr->GetHitBoxes();
+
+		for( int iIndex = 0; iIndex < pHdr->numhitboxes; ++iIndex, ++pHB )
+		{
+			writer.Printf(
+					 "Hitbox %d Bone: %d\n"
+					 "Hitbox %d Group: %d\n"
+					 "Hitbox %d Bounding Box Min: %.6f %.6f %.6f\n"
+					 "Hitbox %d Bounding Box Max: %.6f %.6f %.6f\n\n",
+					 iIndex + 1, pHB->bone,
+					 iIndex + 1, pHB->group,
+					 iIndex + 1, pHB->bbmin[ 0 ], pHB->bbmin[ 1 ], pHB->bbmin[ 2 ],
+					 iIndex + 1, pHB->bbmax[ 0 ], pHB->bbmax[ 1 ], pHB->bbmax[ 2 ]
+			);
+		}
+	}
+
+	writer.Printf(
+			 "Number of Sequences: %d\n\n",
+			 pHdr->numseq
+	);
+
+	{
+		const mstudioseqdesc_t* pSeq = pHdr->GetSequences();
+
+		for( int iIndex = 0; iIndex < pHdr->numseq; ++iIndex, ++pSeq )
+		{
+			writer.Printf(
+					 "Sequence %d Label: \"%.*s\"\n"
+					 "Sequence %d Frames per sec: %.6f\n"
+					 "Sequence %d Flags: %d\n"
+					 "Sequence %d Events: %d\n\n",
+					 iIndex + 1, StrLen( pSeq->label ), pSeq->label,
+					 iIndex + 1, pSeq->fps,
+					 iIndex + 1, pSeq->flags,
+					 iIndex + 1, pSeq->numevents
+			);
+
+			const mstudioevent_t* pEvent = reinterpret_cast<const mstudioevent_t*>( pHdr->GetData() + pSeq->eventindex );
+
+			for( int iEvent = 0; iEvent < pSeq->numevents; ++iEvent, ++pEvent )
+			{
+				writer.Printf(
+						 "\tEvent %d Frame: %d\n"
+						 "\tEvent %d Event: %d\n"
+						 "\tEvent %d Options: %.*s\n"
+						 "\tEvent %d Type: %d\n\n",
+						 iEvent + 1, pEvent->frame,
+						 iEvent + 1, pEvent->event,
+						 iEvent + 1, StrLen( pEvent->options ), pEvent->options,
+						 iEvent + 1, pEvent->type
+				);
+			}
+		}
+	}
+
+	writer.Printf(
+			 "Number of Sequence Groups: %d\n\n",
+			 pHdr->numseqgroups
+	);
+
+	{
+		const mstudioseqgroup_t* pSG = pHdr->GetSequenceGroups();
+
+		for( int iIndex = 0; iIndex < pHdr->numseqgroups; ++iIndex, ++pSG )
+		{
+			writer.Printf(
+					 "Sequence Group %d Label: \"%.*s\"\n\n"
+					 "Sequence Group %d Name: \"%.*s\"\n\n"
+					 "Sequence Group %d Data: %d\n\n",
+					 iIndex + 1, StrLen( pSG->label ), pSG->label,
+					 iIndex + 1, StrLen( pSG->name ), pSG->name,
+					 iIndex + 1, pSG->unused1
+			);
+		}
+	}
+
+	const studiohdr_t* const pTexHdr = &textureHdr;
+
+	writer.Printf(
+			 "Number of Textures: %d\n"
+			 "Texture Index: %d\n"
+			 "Texture Data Index: %d\n\n",
+			 pTexHdr->numtextures,
+			 pTexHdr->textureindex,
+			 pTexHdr->texturedataindex
+	);
+
+	{
+		const mstudiotexture_t* pTex = pTexHdr->GetTextures();
+
+		for( int iIndex = 0; iIndex < pTexHdr->numtextures; ++iIndex, ++pTex )
+		{
+			writer.Printf(
+					 "Texture %d Name: \"%.*s\"\n"
+					 "Texture %d Flags: %d\n"
+					 "Texture %d Width: %d\n"
+					 "Texture %d Height: %d\n"
+					 "Texture %d Index: %d\n\n",
+					 iIndex + 1, StrLen( pTex->name ), pTex->name,
+					 iIndex + 1, pTex->flags,
+					 iIndex + 1, pTex->width,
+					 iIndex + 1, pTex->height,
+					 iIndex + 1, pTex->index
+			);
+		}
+	}
+
+	writer.Printf(
+			 "Number of Skin References: %d\n"
+			 "Number of Skin Families: %d\n\n",
+		pTexHdr->numskinref,
+		pTexHdr->numskinfamilies
+	);
+
+	writer.Printf(
+			 "Number of Body Parts: %d\n\n",
+			 pHdr->numbodyparts
+	);
+
+	{
+		const mstudiobodyparts_t* pBP = pHdr->GetBodyparts();
+
+		for( int iIndex = 0; iIndex < pHdr->numbodyparts; ++iIndex, ++pBP )
+		{
+			writer.Printf(
+					 "Body Part %d Name: \"%.*s\"\n"
+					 "Body Part %d Number of Models: %d\n"
+					 "Body Part %d Base: %d\n"
+					 "Body Part %d Model Index: %d\n\n",
+					 iIndex + 1, StrLen( pBP->name ), pBP->name,
+					 iIndex + 1, pBP->nummodels,
+					 iIndex + 1, pBP->base,
+					 iIndex + 1, pBP->modelindex
+			);
+
+			const mstudiomodel_t* pSubModel = reinterpret_cast<const mstudiomodel_t*>( pHdr->GetData() + pBP->modelindex );
+
+			for( int iModel = 0; iModel < pBP->nummodels; ++iModel, ++pSubModel )
+			{
+				writer.Printf(
+						 "\tSub Model %d Name: \"%.*s\"\n"
+						 "\tSub Model %d Type: %d\n"
+						 "\tSub Model %d Meshes: %d\n"
+						 "\tSub Model %d Vertices: %d\n"
+						 "\tSub Model %d Normals: %d\n"
+						 "\tSub Model %d Deformation Groups: %d\n\n",
+						 iModel + 1, StrLen( pSubModel->name ), pSubModel->name,
+						 iModel + 1, pSubModel->type,
+						 iModel + 1, pSubModel->nummesh,
+						 iModel + 1, pSubModel->numverts,
+						 iModel + 1, pSubModel->numnorms,
+						 iModel + 1, pSubModel->numgroups
+				);
+
+				const mstudiomesh_t* pMesh = reinterpret_cast<const mstudiomesh_t*>( pHdr->GetData() + pSubModel->meshindex );
+
+				for( int iMesh = 0; iMesh < pSubModel->nummesh; ++iMesh, ++pMesh )
+				{
+					writer.Printf(
+							 "\t\tSub Model %d, Mesh %d Total Triangles: %d\n"
+							 "\t\tSub Model %d, Mesh %d Triangle Index: %d\n"
+							 "\t\tSub Model %d, Mesh %d Skin Reference: %d\n"
+							 "\t\tSub Model %d, Mesh %d Total Normals: %d\n"
+							 "\t\tSub Model %d, Mesh %d Normals Index: %d\n\n",
+							 iModel + 1, iMesh + 1, pMesh->numtris,
+							 iModel + 1, iMesh + 1, pMesh->triindex,
+							 iModel + 1, iMesh + 1, pMesh->skinref,
+							 iModel + 1, iMesh + 1, pMesh->numnorms,
+							 iModel + 1, iMesh + 1, pMesh->normindex
+					);
+				}
+			}
+		}
+	}
+
+	writer.Printf(
+			 "Number of Attachments: %d\n",
+			 pHdr->numattachments
+	);
+
+	{
+		const mstudioattachment_t* pAtt = pHdr->GetAttachments();
+
+		for( int iIndex = 0; iIndex < pHdr->numattachments; ++iIndex, ++pAtt )
+		{
+			writer.Printf(
+					 "Attachment %d Name: \"%.*s\"\n",
+					 iIndex + 1, StrLen( pAtt->name ), pAtt->name
+			);
+		}
+	}
+}
+
+/**
+*	Writes nested objects and arrays of named values. Used by the JSON and CSV formats, so both have the same schema.
+*	Values and containers in arrays have no name.
+*/
+class CStructuredWriter
+{
+public:
+	CStructuredWriter( CDumpWriter& writer )
+		: m_Writer( writer )
+	{
+	}
+
+	virtual ~CStructuredWriter() = default;
+
+	virtual void Begin() = 0;
+	virtual void End() = 0;
+
+	virtual void BeginObject( const char* const pszName ) = 0;
+	virtual void EndObject() = 0;
+
+	/**
+	*	@param bInline Whether the array only holds a few values and should be written on one line, if the format has lines.
+	*/
+	virtual void BeginArray( const char* const pszName, const bool bInline = false ) = 0;
+	virtual void EndArray() = 0;
+
+	virtual void Int( const char* const pszName, const int iValue ) = 0;
+	virtual void Float( const char* const pszName, const float flValue ) = 0;
+	virtual void String( const char* const pszName, const char* const pszValue, const size_t uiLength ) = 0;
+
+	template<size_t SIZE>
+	void String( const char* const pszName, const char ( &szValue )[ SIZE ] )
+	{
+		String( pszName, szValue, StrLen( szValue ) );
+	}
+
+	void Floats( const char* const pszName, const float* pflValues, const size_t uiCount )
+	{
+		BeginArray( pszName, true );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			Float( nullptr, pflValues[ uiIndex ] );
+		}
+
+		EndArray();
+	}
+
+	void Ints( const char* const pszName, const int* piValues, const size_t uiCount )
+	{
+		BeginArray( pszName, true );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			Int( nullptr, piValues[ uiIndex ] );
+		}
+
+		EndArray();
+	}
+
+	void Vector( const char* const pszName, const glm::vec3& vec )
+	{
+		Floats( pszName, &vec[ 0 ], 3 );
+	}
+
+protected:
+	CDumpWriter& m_Writer;
+
+private:
+	CStructuredWriter( const CStructuredWriter& ) = delete;
+	CStructuredWriter& operator=( const CStructuredWriter& ) = delete;
+};
+
+class CJSONWriter final : public CStructuredWriter
+{
+public:
+	using CStructuredWriter::CStructuredWriter;
+
+	void Begin() override
+	{
+		m_Containers.assign( 1, { true, false } );
+	}
+
+	void End() override
+	{
+		m_Writer.Write( '\n' );
+	}
+
+	void BeginObject( const char* const pszName ) override
+	{
+		BeginValue( pszName );
+		m_Writer.Write( '{' );
+		m_Containers.push_back( { true, false } );
+	}
+
+	void EndObject() override
+	{
+		EndContainer( '}' );
+	}
+
+	void BeginArray( const char* const pszName, const bool bInline ) override
+	{
+		BeginValue( pszName );
+		m_Writer.Write( '[' );
+		m_Containers.push_back( { true, bInline } );
+	}
+
+	void EndArray() override
+	{
+		EndContainer( ']' );
+	}
+
+	void Int( const char* const pszName, const int iValue ) override
+	{
+		BeginValue( pszName );
+		m_Writer.Printf( "%d", iValue );
+	}
+
+	void Float( const char* const pszName, const float flValue ) override
+	{
+		BeginValue( pszName );
+
+		//JSON has no representation for these.
+		if( std::isfinite( flValue ) )
+			m_Writer.Printf( "%.6f", flValue );
+		else
+			m_Writer.Write( "null" );
+	}
+
+	void String( const char* const pszName, const char* const pszValue, const size_t uiLength ) override
+	{
+		BeginValue( pszName );
+		WriteString( pszValue, uiLength );
+	}
+
+	using CStructuredWriter::String;
+
+private:
+	void Indent()
+	{
+		m_Writer.Write( '\n' );
+
+		for( size_t uiLevel = 1; uiLevel < m_Containers.size(); ++uiLevel )
+		{
+			m_Writer.Write( '\t' );
+		}
+	}
+
+	void BeginValue( const char* const pszName )
+	{
+		auto& container = m_Containers.back();
+
+		//The root value isn't preceded by a newline.
+		if( m_Containers.size() > 1 )
+		{
+			if( !container.bFirst )
+				m_Writer.Write( container.bInline ? ", " : "," );
+
+			if( !container.bInline )
+				Indent();
+		}
+
+		container.bFirst = false;
+
+		if( pszName )
+		{
+			WriteString( pszName, strlen( pszName ) );
+			m_Writer.Write( ": " );
+		}
+	}
+
+	void EndContainer( const char character )
+	{
+		const Container_t container = m_Containers.back();
+
+		m_Containers.pop_back();
+
+		if( !container.bFirst && !container.bInline )
+			Indent();
+
+		m_Writer.Write( character );
+	}
+
+	void WriteString( const char* const pszValue, const size_t uiLength )
+	{
+		m_Writer.Write( '\"' );
+
+		for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+		{
+			const unsigned char character = static_cast<unsigned char>( pszValue[ uiIndex ] );
+
+			switch( character )
+			{
+			case '\"':	m_Writer.Write( "\\\"" ); break;
+			case '\\':	m_Writer.Write( "\\\\" ); break;
+			case '\n':	m_Writer.Write( "\\n" ); break;
+			case '\r':	m_Writer.Write( "\\r" ); break;
+			case '\t':	m_Writer.Write( "\\t" ); break;
+
+			default:
+				{
+					//Control characters must be escaped. Other bytes are written as they are; names are mostly ASCII.
+					if( character < 0x20 )
+						m_Writer.Printf( "\\u%04x", character );
+					else
+						m_Writer.Write( static_cast<char>( character ) );
+					break;
+				}
+			}
+		}
+
+		m_Writer.Write( '\"' );
+	}
+
+private:
+	struct Container_t
+	{
+		/**
+		*	Whether nothing has been written into the container yet.
+		*/
+		bool bFirst;
+		bool bInline;
+	};
+
+	std::vector<Container_t> m_Containers;
+};
+
+class CCSVWriter final : public CStructuredWriter
+{
+public:
+	using CStructuredWriter::CStructuredWriter;
+
+	void Begin() override
+	{
+		m_Writer.Write( "key,value\n" );
+		m_Containers.clear();
+	}
+
+	void End() override
+	{
+	}
+
+	void BeginObject( const char* const pszName ) override
+	{
+		BeginContainer( pszName );
+	}
+
+	void EndObject() override
+	{
+		m_Containers.pop_back();
+	}
+
+	void BeginArray( const char* const pszName, const bool ) override
+	{
+		BeginContainer( pszName );
+	}
+
+	void EndArray() override
+	{
+		m_Containers.pop_back();
+	}
+
+	void Int( const char* const pszName, const int iValue ) override
+	{
+		WriteKey( pszName );
+		m_Writer.Printf( ",%d\n", iValue );
+	}
+
+	void Float( const char* const pszName, const float flValue ) override
+	{
+		WriteKey( pszName );
+		m_Writer.Printf( ",%.6f\n", flValue );
+	}
+
+	void String( const char* const pszName, const char* const pszValue, const size_t uiLength ) override
+	{
+		WriteKey( pszName );
+
+		//Strings are always quoted, quotes are doubled.
+		m_Writer.Write( ",\"" );
+
+		for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+		{
+			if( pszValue[ uiIndex ] == '\"' )
+				m_Writer.Write( '\"' );
+
+			m_Writer.Write( pszValue[ uiIndex ] );
+		}
+
+		m_Writer.Write( "\"\n" );
+	}
+
+	using CStructuredWriter::String;
+
+private:
+	struct Container_t
+	{
+		std::string szPath;
+		int iNextIndex;
+	};
+
+	std::string MakeKey( const char* const pszName )
+	{
+		if( m_Containers.empty() )
+			return pszName ? pszName : "";
+
+		auto& container = m_Containers.back();
+
+		std::string szKey = container.szPath;
+
+		if( !szKey.empty() )
+			szKey += '.';
+
+		if( pszName )
+			szKey += pszName;
+		else
+			szKey += std::to_string( container.iNextIndex++ );
+
+		return szKey;
+	}
+
+	void BeginContainer( const char* const pszName )
+	{
+		m_Containers.push_back( { MakeKey( pszName ), 0 } );
+	}
+
+	void WriteKey( const char* const pszName )
+	{
+		const std::string szKey = MakeKey( pszName );
+
+		m_Writer.Write( szKey.c_str(), szKey.length() );
+	}
+
+private:
+	std::vector<Container_t> m_Containers;
+};
+
+void DumpStructured( const studiohdr_t& studioHdr, const studiohdr_t& textureHdr, CStructuredWriter& writer )
+{
+	const studiohdr_t* const pHdr = &studioHdr;
+
+	writer.Begin();
+
+	writer.BeginObject( nullptr );
+
+	writer.String( "id", reinterpret_cast<const char*>( &pHdr->id ), 4 );
+	writer.Int( "version", pHdr->version );
+	writer.String( "name", pHdr->name );
+	writer.Int( "length", pHdr->length );
+	writer.Vector( "eyeposition", pHdr->eyeposition );
+	writer.Vector( "min", pHdr->min );
+	writer.Vector( "max", pHdr->max );
+	writer.Vector( "bbmin", pHdr->bbmin );
+	writer.Vector( "bbmax", pHdr->bbmax );
+	writer.Int( "flags", pHdr->flags );
+
+	writer.BeginArray( "bones" );
+
+	for( int iIndex = 0; iIndex < pHdr->numbones; ++iIndex )
+	{
+		const mstudiobone_t& bone = *pHdr->GetBone( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.String( "name", bone.name );
+		writer.Int( "parent", bone.parent );
+		writer.Int( "flags", bone.flags );
+		writer.Ints( "bonecontroller", bone.bonecontroller, STUDIO_MAX_PER_BONE_CONTROLLERS );
+		writer.Floats( "value", bone.value, STUDIO_MAX_PER_BONE_CONTROLLERS );
+		writer.Floats( "scale", bone.scale, STUDIO_MAX_PER_BONE_CONTROLLERS );
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.BeginArray( "bonecontrollers" );
+
+	for( int iIndex = 0; iIndex < pHdr->numbonecontrollers; ++iIndex )
+	{
+		const mstudiobonecontroller_t& controller = *pHdr->GetBoneController( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.Int( "bone", controller.bone );
+		writer.Int( "type", controller.type );
+		writer.Float( "start", controller.start );
+		writer.Float( "end", controller.end );
+		writer.Int( "rest", controller.rest );
+		writer.Int( "index", controller.index );
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.BeginArray( "hitboxes" );
+
+	for( int iIndex = 0; iIndex < pHdr->numhitboxes; ++iIndex )
+	{
+		const mstudiobbox_t& hitbox = *pHdr->GetHitBox( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.Int( "bone", hitbox.bone );
+		writer.Int( "group", hitbox.group );
+		writer.Vector( "bbmin", hitbox.bbmin );
+		writer.Vector( "bbmax", hitbox.bbmax );
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.BeginArray( "sequences" );
+
+	for( int iIndex = 0; iIndex < pHdr->numseq; ++iIndex )
+	{
+		const mstudioseqdesc_t& sequence = *pHdr->GetSequence( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.String( "label", sequence.label );
+		writer.Float( "fps", sequence.fps );
+		writer.Int( "flags", sequence.flags );
+		writer.Int( "activity", sequence.activity );
+		writer.Int( "actweight", sequence.actweight );
+		writer.Int( "numframes", sequence.numframes );
+		writer.Int( "motiontype", sequence.motiontype );
+		writer.Vector( "linearmovement", sequence.linearmovement );
+		writer.Int( "numblends", sequence.numblends );
+		writer.Int( "seqgroup", sequence.seqgroup );
+
+		writer.BeginArray( "events" );
+
+		const mstudioevent_t* const pEvents = reinterpret_cast<const mstudioevent_t*>( pHdr->GetData() + sequence.eventindex );
+
+		for( int iEvent = 0; iEvent < sequence.numevents; ++iEvent )
+		{
+			const mstudioevent_t& event = pEvents[ iEvent ];
+
+			writer.BeginObject( nullptr );
+			writer.Int( "frame", event.frame );
+			writer.Int( "event", event.event );
+			writer.String( "options", event.options );
+			writer.Int( "type", event.type );
+			writer.EndObject();
+		}
+
+		writer.EndArray();
+
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.BeginArray( "seqgroups" );
+
+	for( int iIndex = 0; iIndex < pHdr->numseqgroups; ++iIndex )
+	{
+		const mstudioseqgroup_t& group = *pHdr->GetSequenceGroup( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.String( "label", group.label );
+		writer.String( "name", group.name );
+		writer.Int( "data", group.unused1 );
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.BeginArray( "textures" );
+
+	for( int iIndex = 0; iIndex < textureHdr.numtextures; ++iIndex )
+	{
+		const mstudiotexture_t& texture = *textureHdr.GetTexture( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.String( "name", texture.name );
+		writer.Int( "flags", texture.flags );
+		writer.Int( "width", texture.width );
+		writer.Int( "height", texture.height );
+		writer.Int( "index", texture.index );
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.Int( "numskinref", textureHdr.numskinref );
+	writer.Int( "numskinfamilies", textureHdr.numskinfamilies );
+
+	writer.BeginArray( "bodyparts" );
+
+	for( int iIndex = 0; iIndex < pHdr->numbodyparts; ++iIndex )
+	{
+		const mstudiobodyparts_t& bodypart = *pHdr->GetBodypart( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.String( "name", bodypart.name );
+		writer.Int( "base", bodypart.base );
+
+		writer.BeginArray( "models" );
+
+		const mstudiomodel_t* const pModels = reinterpret_cast<const mstudiomodel_t*>( pHdr->GetData() + bodypart.modelindex );
+
+		for( int iModel = 0; iModel < bodypart.nummodels; ++iModel )
+		{
+			const mstudiomodel_t& model = pModels[ iModel ];
+
+			writer.BeginObject( nullptr );
+			writer.String( "name", model.name );
+			writer.Int( "type", model.type );
+			writer.Float( "boundingradius", model.boundingradius );
+			writer.Int( "numverts", model.numverts );
+			writer.Int( "numnorms", model.numnorms );
+			writer.Int( "numgroups", model.numgroups );
+
+			writer.BeginArray( "meshes" );
+
+			const mstudiomesh_t* const pMeshes = reinterpret_cast<const mstudiomesh_t*>( pHdr->GetData() + model.meshindex );
+
+			for( int iMesh = 0; iMesh < model.nummesh; ++iMesh )
+			{
+				const mstudiomesh_t& mesh = pMeshes[ iMesh ];
+
+				writer.BeginObject( nullptr );
+				writer.Int( "numtris", mesh.numtris );
+				writer.Int( "triindex", mesh.triindex );
+				writer.Int( "skinref", mesh.skinref );
+				writer.Int( "numnorms", mesh.numnorms );
+				writer.Int( "normindex", mesh.normindex );
+				writer.EndObject();
+			}
+
+			writer.EndArray();
+
+			writer.EndObject();
+		}
+
+		writer.EndArray();
+
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.BeginArray( "attachments" );
+
+	for( int iIndex = 0; iIndex < pHdr->numattachments; ++iIndex )
+	{
+		const mstudioattachment_t& attachment = *pHdr->GetAttachment( iIndex );
+
+		writer.BeginObject( nullptr );
+		writer.String( "name", attachment.name );
+		writer.Int( "bone", attachment.bone );
+		writer.Vector( "org", attachment.org );
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+
+	writer.EndObject();
+
+	writer.End();
+}
+
+/**
+*	Maps a model file and checks its header.
+*/
+const studiohdr_t* MapStudioHeader( const char* const pszFilename, CMappedFile& file )
+{
+	if( !file.Open( pszFilename ) )
+	{
+		Error( "Couldn't open \"%s\"\n", pszFilename );
+		return nullptr;
+	}
+
+	const studiohdr_t* const pHdr = reinterpret_cast<const studiohdr_t*>( file.GetData() );
+
+	if( file.GetSize() < sizeof( studiohdr_t ) || strncmp( reinterpret_cast<const char*>( &pHdr->id ), STUDIOMDL_HDR_ID, 4 ) )
+	{
+		Error( "\"%s\" is not a studio model\n", pszFilename );
+		return nullptr;
+	}
+
+	if( pHdr->version != STUDIO_VERSION )
+	{
+		Error( "\"%s\" has version %d, expected %d\n", pszFilename, pHdr->version, STUDIO_VERSION );
+		return nullptr;
+	}
+
+	const std::string szExtension = fs::path( pszFilename ).extension().string();
+
+	if( !ValidateStudioHeader( *pHdr, file.GetSize(), szExtension == ".dol" || szExtension == ".DOL" ) )
+	{
+		Error( "\"%s\" is corrupt, validate it for details\n", pszFilename );
+		return nullptr;
+	}
+
+	return pHdr;
+}
+
+/**
+*	Returns whether the given model file belongs to another model, like a texture model or a sequence group.
+*/
+bool IsCompanionFile( const fs::path& path )
+{
+	const std::string szName = path.stem().string();
+
+	std::string szOwner;
+
+	if( szName.length() > 1 && ( szName.back() == 't' || szName.back() == 'T' ) )
+		szOwner = szName.substr( 0, szName.length() - 1 );
+	else if( szName.length() > 2 && isdigit( static_cast<unsigned char>( szName[ szName.length() - 1 ] ) ) && isdigit( static_cast<unsigned char>( szName[ szName.length() - 2 ] ) ) )
+		szOwner = szName.substr( 0, szName.length() - 2 );
+	else
+		return false;
+
+	fs::path owner( path );
+
+	owner.replace_filename( szOwner + path.extension().string() );
+
+	std::error_code error;
+
+	return fs::exists( owner, error );
+}
+
+/**
+*	Gets the path of a file relative to a directory that contains it.
+*/
+fs::path GetRelativePath( const fs::path& path, const fs::path& root )
+{
+	auto pathIt = path.begin();
+
+	for( auto rootIt = root.begin(); rootIt != root.end() && pathIt != path.end() && *rootIt == *pathIt; ++rootIt, ++pathIt )
+	{
+	}
+
+	fs::path relative;
+
+	for( ; pathIt != path.end(); ++pathIt )
+	{
+		relative /= *pathIt;
+	}
+
+	return relative;
+}
+
+bool WriteFile( const char* const pszFilename, const std::string& szContents )
+{
+	FILE* pFile = fopen( pszFilename, "wb" );
+
+	if( !pFile )
+	{
+		Error( "Couldn't open \"%s\" for writing\n", pszFilename );
+		return false;
+	}
+
+	const bool bSuccess = fwrite( szContents.data(), 1, szContents.size(), pFile ) == szContents.size();
+
+	if( fclose( pFile ) != 0 || !bSuccess )
+	{
+		Error( "Couldn't write \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	return true;
+}
+}
+
+bool StringToDumpFormat( const char* const pszString, DumpFormat& format )
+{
+	if( !strcasecmp( pszString, "text" ) )
+		format = DumpFormat::TEXT;
+	else if( !strcasecmp( pszString, "json" ) )
+		format = DumpFormat::JSON;
+	else if( !strcasecmp( pszString, "csv" ) )
+		format = DumpFormat::CSV;
+	else
+		return false;
+
+	return true;
+}
+
+const char* DumpFormatToExtension( const DumpFormat format )
+{
+	switch( format )
+	{
+	default:
+	case DumpFormat::TEXT:	return "txt";
+	case DumpFormat::JSON:	return "json";
+	case DumpFormat::CSV:	return "csv";
+	}
+}
+
+void DumpStudioModel( const studiohdr_t& studioHdr, const studiohdr_t& textureHdr, const DumpFormat format, std::string& szOutput )
+{
+	CDumpWriter writer( szOutput );
+
+	switch( format )
+	{
+	default:
+	case DumpFormat::TEXT:
+		{
+			DumpText( studioHdr, textureHdr, writer );
+			break;
+		}
+
+	case DumpFormat::JSON:
+		{
+			CJSONWriter jsonWriter( writer );
+			DumpStructured( studioHdr, textureHdr, jsonWriter );
+			break;
+		}
+
+	case DumpFormat::CSV:
+		{
+			CCSVWriter csvWriter( writer );
+			DumpStructured( studioHdr, textureHdr, csvWriter );
+			break;
+		}
+	}
+}
+
+bool DumpStudioModelToFile( const studiohdr_t& studioHdr, const studiohdr_t& textureHdr, const DumpFormat format, const char* const pszFilename )
+{
+	std::string szOutput;
+
+	DumpStudioModel( studioHdr, textureHdr, format, szOutput );
+
+	return WriteFile( pszFilename, szOutput );
+}
+
+bool DumpStudioModelFile( const char* const pszModelFilename, const DumpFormat format, std::string& szOutput )
+{
+	CMappedFile modelFile;
+
+	const studiohdr_t* const pHdr = MapStudioHeader( pszModelFilename, modelFile );
+
+	if( !pHdr )
+		return false;
+
+	CMappedFile textureFile;
+
+	const studiohdr_t* pTextureHdr = pHdr;
+
+	//Textures are in a separate T.mdl file.
+	if( pHdr->numtextures == 0 )
+	{
+		fs::path texturePath( pszModelFilename );
+
+		texturePath.replace_filename( texturePath.stem().string() + "T" + texturePath.extension().string() );
+
+		std::error_code error;
+
+		if( fs::exists( texturePath, error ) )
+		{
+			pTextureHdr = MapStudioHeader( texturePath.string().c_str(), textureFile );
+
+			if( !pTextureHdr )
+				return false;
+		}
+	}
+
+	DumpStudioModel( *pHdr, *pTextureHdr, format, szOutput );
+
+	return true;
+}
+
+bool IsStudioModelCompanionFile( const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	return IsCompanionFile( fs::path( pszFilename ) );
+}
+
+bool DumpStudioModelDirectory( const char* const pszDirectory, const char* const pszOutputDirectory, const DumpFormat format,
+							   size_t& uiDumped, size_t& uiFailed )
+{
+	uiDumped = 0;
+	uiFailed = 0;
+
+	const fs::path root( pszDirectory );
+	const fs::path outputRoot( pszOutputDirectory );
+
+	std::vector<fs::path> models;
+
+	std::error_code error;
+
+	for( fs::recursive_directory_iterator it( root, error ), end; !error && it != end; it.increment( error ) )
+	{
+		if( !fs::is_regular_file( it->status() ) )
+			continue;
+
+		std::string szExtension = it->path().extension().string();
+
+		std::transform( szExtension.begin(), szExtension.end(), szExtension.begin(), ::tolower );
+
+		if( ( szExtension == ".mdl" || szExtension == ".dol" ) && !IsCompanionFile( it->path() ) )
+			models.push_back( it->path() );
+	}
+
+	if( error )
+	{
+		Error( "Couldn't search directory \"%s\": %s\n", pszDirectory, error.message().c_str() );
+		return false;
+	}
+
+	//Directory order is not defined; sort so the output is the same on every run.
+	std::sort( models.begin(), models.end() );
+
+	std::atomic<size_t> uiDumpedCount{ 0 };
+	std::atomic<size_t> uiFailedCount{ 0 };
+
+	//One task per model, dumps vary a lot in size.
+	tasks::ParallelFor( models.size(), [ & ]( const size_t uiIndex )
+	{
+		const fs::path& model = models[ uiIndex ];
+
+		//Keep the directory structure so models with the same name don't overwrite each other's dumps.
+		fs::path outputPath = outputRoot / GetRelativePath( model, root );
+
+		outputPath.replace_extension( DumpFormatToExtension( format ) );
+
+		std::error_code dirError;
+
+		fs::create_directories( outputPath.parent_path(), dirError );
+
+		std::string szOutput;
+
+		if( DumpStudioModelFile( model.string().c_str(), format, szOutput ) && WriteFile( outputPath.string().c_str(), szOutput ) )
+			++uiDumpedCount;
+		else
+			++uiFailedCount;
+	}, 1, "DumpStudioModel" );
+
+	uiDumped = uiDumpedCount;
+	uiFailed = uiFailedCount;
+
+	return true;
+}
+}
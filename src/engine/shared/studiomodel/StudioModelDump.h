@@ -0,0 +1,94 @@
+#ifndef GAME_STUDIOMODEL_STUDIOMODELDUMP_H
+#define GAME_STUDIOMODEL_STUDIOMODELDUMP_H
+
+#include <cstddef>
+#include <string>
+
+#include <glm/vec3.hpp>
+
+#include "studio.h"
+
+/*
+*	Dumps the contents of studio model headers as text, JSON or CSV.
+*	Dumps are built in memory and written with a single call, and only read the headers, so no GL is needed.
+*/
+
+namespace studiomdl
+{
+enum class DumpFormat
+{
+	/**
+	*	Human readable text, one "Key: value" pair per line.
+	*/
+	TEXT = 0,
+
+	/**
+	*	A single JSON object, with arrays for bones, sequences, body parts, etc.
+	*/
+	JSON,
+
+	/**
+	*	key,value rows, where the key is the path to the value, like "bones.0.name".
+	*/
+	CSV
+};
+
+/**
+*	Parses a dump format name: "text", "json" or "csv".
+*	@return Whether the name is a valid format.
+*/
+bool StringToDumpFormat( const char* const pszString, DumpFormat& format );
+
+/**
+*	@return The file extension dumps in the given format are saved with, without the dot.
+*/
+const char* DumpFormatToExtension( const DumpFormat format );
+
+/**
+*	Dumps a model's headers.
+*	@param studioHdr Model header.
+*	@param textureHdr Header that contains the model's textures. This is either the model header or the header of the T.mdl file.
+*	@param format Format to dump in.
+*	@param szOutput The dump is appended to this string.
+*/
+void DumpStudioModel( const studiohdr_t& studioHdr, const studiohdr_t& textureHdr, const DumpFormat format, std::string& szOutput );
+
+/**
+*	Dumps a model's headers to a file.
+*	@see DumpStudioModel
+*	@return Whether the file was written.
+*/
+bool DumpStudioModelToFile( const studiohdr_t& studioHdr, const studiohdr_t& textureHdr, const DumpFormat format, const char* const pszFilename );
+
+/**
+*	Maps a model file, and its texture file if it has one, into memory and dumps its headers.
+*	The headers are checked so that corrupt files are reported instead of read out of bounds.
+*	Does not use GL, so this can be called from any thread.
+*	@param pszModelFilename Model to dump.
+*	@param format Format to dump in.
+*	@param szOutput The dump is appended to this string.
+*	@return Whether the model was dumped.
+*/
+bool DumpStudioModelFile( const char* const pszModelFilename, const DumpFormat format, std::string& szOutput );
+
+/**
+*	@return Whether the file is the texture file or a sequence group file of a model in the same directory.
+*	These are loaded along with their model, and should not be processed on their own.
+*/
+bool IsStudioModelCompanionFile( const char* const pszFilename );
+
+/**
+*	Dumps every model in a directory and its subdirectories in parallel.
+*	Texture and sequence group files are not dumped on their own.
+*	@param pszDirectory Directory to search for models.
+*	@param pszOutputDirectory Directory to write dumps to. Paths relative to pszDirectory are kept.
+*	@param format Format to dump in.
+*	@param uiDumped Number of models that were dumped.
+*	@param uiFailed Number of models that could not be dumped.
+*	@return Whether the directory could be searched.
+*/
+bool DumpStudioModelDirectory( const char* const pszDirectory, const char* const pszOutputDirectory, const DumpFormat format,
+							   size_t& uiDumped, size_t& uiFailed );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOMODELDUMP_H
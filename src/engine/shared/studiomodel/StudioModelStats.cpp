@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_set>
+
+#include "graphics/GraphicsUtils.h"
+#include "graphics/Palette.h"
+
+#include "CStudioModel.h"
+#include "StudioModelStats.h"
+
+namespace studiomdl
+{
+namespace
+{
+void AppendF( std::string& szOutput, const char* const pszFormat, ... )
+{
+	char szBuffer[ 512 ];
+
+	va_list list;
+
+	va_start( list, pszFormat );
+
+	const int iResult = vsnprintf( szBuffer, sizeof( szBuffer ), pszFormat, list );
+
+	va_end( list );
+
+	if( iResult > 0 )
+		szOutput.append( szBuffer, std::min( static_cast<size_t>( iResult ), sizeof( szBuffer ) - 1 ) );
+}
+
+/**
+*	Appends a string, escaped for the given format.
+*/
+void AppendEscaped( std::string& szOutput, const std::string& szString, const DumpFormat format )
+{
+	if( format == DumpFormat::TEXT )
+	{
+		szOutput += szString;
+		return;
+	}
+
+	const bool bQuote = format == DumpFormat::JSON || szString.find_first_of( ",\"\n" ) != std::string::npos;
+
+	if( bQuote )
+		szOutput += '\"';
+
+	for( const char character : szString )
+	{
+		if( character == '\"' )
+			szOutput += format == DumpFormat::JSON ? "\\\"" : "\"\"";
+		else if( character == '\\' && format == DumpFormat::JSON )
+			szOutput += "\\\\";
+		else if( static_cast<unsigned char>( character ) >= ' ' )
+			szOutput += character;
+	}
+
+	if( bQuote )
+		szOutput += '\"';
+}
+
+/**
+*	Gets the size of a bone's compressed values for one channel. Each run is a header followed by its valid values,
+*	runs are read until they cover all frames.
+*/
+size_t GetAnimValuesSize( const mstudioanimvalue_t* pValue, const int iNumFrames )
+{
+	size_t uiNumValues = 0;
+
+	for( int iFrames = iNumFrames; iFrames > 0; )
+	{
+		if( pValue->num.total == 0 )
+			break;
+
+		const int iEntries = pValue->num.valid + 1;
+
+		uiNumValues += iEntries;
+		iFrames -= pValue->num.total;
+		pValue += iEntries;
+	}
+
+	return uiNumValues * sizeof( mstudioanimvalue_t );
+}
+
+size_t GetSequenceAnimBytes( const studiohdr_t& studioHdr, const mstudioseqdesc_t& seqdesc, const mstudioanim_t* pAnim )
+{
+	const size_t uiNumAnims = static_cast<size_t>( seqdesc.numblends ) * studioHdr.numbones;
+
+	size_t uiBytes = uiNumAnims * sizeof( mstudioanim_t );
+
+	for( size_t uiAnim = 0; uiAnim < uiNumAnims; ++uiAnim, ++pAnim )
+	{
+		for( int iChannel = 0; iChannel < 6; ++iChannel )
+		{
+			if( pAnim->offset[ iChannel ] == 0 )
+				continue;
+
+			uiBytes += GetAnimValuesSize(
+				reinterpret_cast<const mstudioanimvalue_t*>( reinterpret_cast<const byte*>( pAnim ) + pAnim->offset[ iChannel ] ), seqdesc.numframes );
+		}
+	}
+
+	return uiBytes;
+}
+
+void ComputeMeshStats( const studiohdr_t& studioHdr, const mstudiomesh_t& mesh, StudioModelStats_t& stats )
+{
+	//Same key as the mesh conversion: vertex, normal and texture coordinates.
+	std::unordered_set<uint64_t> vertices;
+
+	const short* ptricmds = reinterpret_cast<const short*>( studioHdr.GetData() + mesh.triindex );
+
+	for( int i; ( i = *( ptricmds++ ) ) != 0; )
+	{
+		if( i < 0 )
+		{
+			++stats.uiNumFans;
+			i = -i;
+		}
+		else
+			++stats.uiNumStrips;
+
+		stats.uiNumCommandVertices += i;
+
+		if( i >= 3 )
+			stats.uiNumTriangles += i - 2;
+
+		for( ; i > 0; --i, ptricmds += 4 )
+		{
+			uint64_t uiKey = 0;
+
+			for( int iComponent = 0; iComponent < 4; ++iComponent )
+			{
+				uiKey = ( uiKey << 16 ) | static_cast<uint16_t>( ptricmds[ iComponent ] );
+			}
+
+			vertices.insert( uiKey );
+		}
+	}
+
+	stats.uiNumMeshVertices += vertices.size();
+}
+}
+
+void ComputeStudioModelStats( const CStudioModel& model, StudioModelStats_t& stats )
+{
+	stats = StudioModelStats_t();
+
+	const studiohdr_t& studioHdr = *model.GetStudioHeader();
+	const studiohdr_t& textureHdr = *model.GetTextureHeader();
+
+	stats.iNumBones = studioHdr.numbones;
+	stats.iNumBoneControllers = studioHdr.numbonecontrollers;
+	stats.iNumSequences = studioHdr.numseq;
+	stats.iNumBodyParts = studioHdr.numbodyparts;
+	stats.iNumTextures = textureHdr.numtextures;
+
+	for( int iBodyPart = 0; iBodyPart < studioHdr.numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pBodyPart = studioHdr.GetBodypart( iBodyPart );
+
+		const mstudiomodel_t* const pModels = reinterpret_cast<const mstudiomodel_t*>( studioHdr.GetData() + pBodyPart->modelindex );
+
+		stats.iNumSubModels += pBodyPart->nummodels;
+
+		for( int iModel = 0; iModel < pBodyPart->nummodels; ++iModel )
+		{
+			const mstudiomodel_t& subModel = pModels[ iModel ];
+
+			const mstudiomesh_t* const pMeshes = reinterpret_cast<const mstudiomesh_t*>( studioHdr.GetData() + subModel.meshindex );
+
+			stats.iNumMeshes += subModel.nummesh;
+
+			for( int iMesh = 0; iMesh < subModel.nummesh; ++iMesh )
+			{
+				ComputeMeshStats( studioHdr, pMeshes[ iMesh ], stats );
+			}
+		}
+
+		//Body 0 uses the first submodel of every body part.
+		if( pBodyPart->nummodels > 0 )
+		{
+			stats.uiPoseVertices += pModels[ 0 ].numverts;
+			stats.uiPoseNormals += pModels[ 0 ].numnorms;
+		}
+	}
+
+	for( int iTexture = 0; iTexture < textureHdr.numtextures; ++iTexture )
+	{
+		const mstudiotexture_t* const pTexture = textureHdr.GetTexture( iTexture );
+
+		stats.uiTextureFileBytes += static_cast<size_t>( pTexture->width ) * pTexture->height + PALETTE_SIZE;
+
+		int iWidth, iHeight;
+
+		if( graphics::CalculateImageDimensions( pTexture->width, pTexture->height, iWidth, iHeight ) )
+			stats.uiTextureMemoryBytes += static_cast<size_t>( iWidth ) * iHeight * 4;
+	}
+
+	stats.SequenceGroups.resize( std::max( studioHdr.numseqgroups, 0 ) );
+
+	for( int iGroup = 0; iGroup < studioHdr.numseqgroups; ++iGroup )
+	{
+		const mstudioseqgroup_t* const pGroup = studioHdr.GetSequenceGroup( iGroup );
+
+		stats.SequenceGroups[ iGroup ].szLabel.assign( pGroup->label, strnlen( pGroup->label, sizeof( pGroup->label ) ) );
+	}
+
+	for( int iSequence = 0; iSequence < studioHdr.numseq; ++iSequence )
+	{
+		const mstudioseqdesc_t* const pseqdesc = studioHdr.GetSequence( iSequence );
+
+		const size_t uiChannels = static_cast<size_t>( pseqdesc->numblends ) * studioHdr.numbones * 6;
+
+		if( uiChannels > stats.uiPoseChannels )
+		{
+			stats.uiPoseChannels = uiChannels;
+			stats.szPoseSequence.assign( pseqdesc->label, strnlen( pseqdesc->label, sizeof( pseqdesc->label ) ) );
+		}
+
+		if( pseqdesc->seqgroup < 0 || pseqdesc->seqgroup >= studioHdr.numseqgroups )
+			continue;
+
+		SequenceGroupStats_t& group = stats.SequenceGroups[ pseqdesc->seqgroup ];
+
+		++group.iNumSequences;
+
+		const mstudioanim_t* const pAnim = model.GetAnim( pseqdesc );
+
+		if( !pAnim )
+		{
+			group.bLoaded = false;
+			continue;
+		}
+
+		group.uiAnimBytes += GetSequenceAnimBytes( studioHdr, *pseqdesc, pAnim );
+	}
+}
+
+void FormatStudioModelStats( const StudioModelStats_t& stats, const DumpFormat format, std::string& szOutput )
+{
+	switch( format )
+	{
+	default:
+	case DumpFormat::TEXT:
+		{
+			AppendF( szOutput,
+					 "Bones: %d\nBone controllers: %d\nSequences: %d\nBody parts: %d\nSubmodels: %d\nMeshes: %d\nTextures: %d\n\n",
+					 stats.iNumBones, stats.iNumBoneControllers, stats.iNumSequences,
+					 stats.iNumBodyParts, stats.iNumSubModels, stats.iNumMeshes, stats.iNumTextures );
+
+			AppendF( szOutput,
+					 "Triangles: %zu\nStrips: %zu\nFans: %zu\nCommand vertices: %zu\nMesh vertices: %zu\n"
+					 "Strip efficiency: %.3f triangles per vertex\nTriangles per command: %.2f\n\n",
+					 stats.uiNumTriangles, stats.uiNumStrips, stats.uiNumFans, stats.uiNumCommandVertices, stats.uiNumMeshVertices,
+					 stats.GetStripEfficiency(), stats.GetTrianglesPerCommand() );
+
+			AppendF( szOutput,
+					 "Texture file size: %zu bytes\nTexture memory: %zu bytes\n\n",
+					 stats.uiTextureFileBytes, stats.uiTextureMemoryBytes );
+
+			AppendF( szOutput, "Animation data: %zu bytes\n", stats.GetAnimBytes() );
+
+			for( size_t uiGroup = 0; uiGroup < stats.SequenceGroups.size(); ++uiGroup )
+			{
+				const auto& group = stats.SequenceGroups[ uiGroup ];
+
+				AppendF( szOutput, "Sequence group %u \"", static_cast<unsigned int>( uiGroup ) );
+				AppendEscaped( szOutput, group.szLabel, format );
+
+				if( group.bLoaded )
+					AppendF( szOutput, "\": %d sequences, %zu bytes\n", group.iNumSequences, group.uiAnimBytes );
+				else
+					AppendF( szOutput, "\": %d sequences, not loaded\n", group.iNumSequences );
+			}
+
+			AppendF( szOutput, "\nPose cost per frame: %zu channels (sequence \"", stats.uiPoseChannels );
+			AppendEscaped( szOutput, stats.szPoseSequence, format );
+			AppendF( szOutput, "\"), %zu bone transforms, %zu vertices, %zu normals\n",
+					 static_cast<size_t>( stats.iNumBones ), stats.uiPoseVertices, stats.uiPoseNormals );
+			break;
+		}
+
+	case DumpFormat::JSON:
+		{
+			AppendF( szOutput,
+					 "{\n\t\"numbones\": %d,\n\t\"numbonecontrollers\": %d,\n\t\"numseq\": %d,\n\t\"numbodyparts\": %d,\n"
+					 "\t\"numsubmodels\": %d,\n\t\"nummeshes\": %d,\n\t\"numtextures\": %d,\n",
+					 stats.iNumBones, stats.iNumBoneControllers, stats.iNumSequences,
+					 stats.iNumBodyParts, stats.iNumSubModels, stats.iNumMeshes, stats.iNumTextures );
+
+			AppendF( szOutput,
+					 "\t\"numtriangles\": %zu,\n\t\"numstrips\": %zu,\n\t\"numfans\": %zu,\n\t\"numcommandvertices\": %zu,\n"
+					 "\t\"nummeshvertices\": %zu,\n\t\"stripefficiency\": %.3f,\n\t\"trianglespercommand\": %.2f,\n",
+					 stats.uiNumTriangles, stats.uiNumStrips, stats.uiNumFans, stats.uiNumCommandVertices, stats.uiNumMeshVertices,
+					 stats.GetStripEfficiency(), stats.GetTrianglesPerCommand() );
+
+			AppendF( szOutput,
+					 "\t\"texturefilebytes\": %zu,\n\t\"texturememorybytes\": %zu,\n\t\"animbytes\": %zu,\n\t\"seqgroups\": [",
+					 stats.uiTextureFileBytes, stats.uiTextureMemoryBytes, stats.GetAnimBytes() );
+
+			for( size_t uiGroup = 0; uiGroup < stats.SequenceGroups.size(); ++uiGroup )
+			{
+				const auto& group = stats.SequenceGroups[ uiGroup ];
+
+				szOutput += uiGroup > 0 ? ",\n\t\t{ \"label\": " : "\n\t\t{ \"label\": ";
+				AppendEscaped( szOutput, group.szLabel, format );
+				AppendF( szOutput, ", \"numseq\": %d, \"animbytes\": %zu, \"loaded\": %s }",
+						 group.iNumSequences, group.uiAnimBytes, group.bLoaded ? "true" : "false" );
+			}
+
+			szOutput += stats.SequenceGroups.empty() ? "],\n" : "\n\t],\n";
+
+			AppendF( szOutput, "\t\"pose\": { \"channels\": %zu, \"sequence\": ", stats.uiPoseChannels );
+			AppendEscaped( szOutput, stats.szPoseSequence, format );
+			AppendF( szOutput, ", \"bones\": %d, \"vertices\": %zu, \"normals\": %zu }\n}\n",
+					 stats.iNumBones, stats.uiPoseVertices, stats.uiPoseNormals );
+			break;
+		}
+
+	case DumpFormat::CSV:
+		{
+			AppendF( szOutput,
+					 "key,value\nnumbones,%d\nnumbonecontrollers,%d\nnumseq,%d\nnumbodyparts,%d\nnumsubmodels,%d\nnummeshes,%d\nnumtextures,%d\n",
+					 stats.iNumBones, stats.iNumBoneControllers, stats.iNumSequences,
+					 stats.iNumBodyParts, stats.iNumSubModels, stats.iNumMeshes, stats.iNumTextures );
+
+			AppendF( szOutput,
+					 "numtriangles,%zu\nnumstrips,%zu\nnumfans,%zu\nnumcommandvertices,%zu\nnummeshvertices,%zu\n"
+					 "stripefficiency,%.3f\ntrianglespercommand,%.2f\n",
+					 stats.uiNumTriangles, stats.uiNumStrips, stats.uiNumFans, stats.uiNumCommandVertices, stats.uiNumMeshVertices,
+					 stats.GetStripEfficiency(), stats.GetTrianglesPerCommand() );
+
+			AppendF( szOutput, "texturefilebytes,%zu\ntexturememorybytes,%zu\nanimbytes,%zu\n",
+					 stats.uiTextureFileBytes, stats.uiTextureMemoryBytes, stats.GetAnimBytes() );
+
+			for( size_t uiGroup = 0; uiGroup < stats.SequenceGroups.size(); ++uiGroup )
+			{
+				const auto& group = stats.SequenceGroups[ uiGroup ];
+				const unsigned int uiIndex = static_cast<unsigned int>( uiGroup );
+
+				AppendF( szOutput, "seqgroups.%u.label,", uiIndex );
+				AppendEscaped( szOutput, group.szLabel, format );
+				AppendF( szOutput, "\nseqgroups.%u.numseq,%d\nseqgroups.%u.animbytes,%zu\nseqgroups.%u.loaded,%d\n",
+						 uiIndex, group.iNumSequences, uiIndex, group.uiAnimBytes, uiIndex, group.bLoaded ? 1 : 0 );
+			}
+
+			AppendF( szOutput, "pose.channels,%zu\npose.sequence,", stats.uiPoseChannels );
+			AppendEscaped( szOutput, stats.szPoseSequence, format );
+			AppendF( szOutput, "\npose.bones,%d\npose.vertices,%zu\npose.normals,%zu\n",
+					 stats.iNumBones, stats.uiPoseVertices, stats.uiPoseNormals );
+			break;
+		}
+	}
+}
+}
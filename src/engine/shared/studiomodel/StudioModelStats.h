@@ -0,0 +1,137 @@
+#ifndef GAME_STUDIOMODEL_STUDIOMODELSTATS_H
+#define GAME_STUDIOMODEL_STUDIOMODELSTATS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "StudioModelDump.h"
+
+/*
+*	Statistics about the cost of a model: geometry as the renderer converts it, texture memory, and animation data.
+*	Only the headers and animation data are read, so no GL is needed and models from many threads can be measured at once.
+*/
+
+namespace studiomdl
+{
+class CStudioModel;
+
+struct SequenceGroupStats_t
+{
+	std::string szLabel;
+
+	int iNumSequences = 0;
+
+	/**
+	*	Size of the animation data of the group's sequences: the per bone headers and the compressed values.
+	*/
+	size_t uiAnimBytes = 0;
+
+	/**
+	*	Whether the group could be loaded. Groups that couldn't be loaded have no animation data size.
+	*/
+	bool bLoaded = true;
+};
+
+struct StudioModelStats_t
+{
+	int iNumBones = 0;
+	int iNumBoneControllers = 0;
+	int iNumSequences = 0;
+	int iNumBodyParts = 0;
+	int iNumSubModels = 0;
+	int iNumMeshes = 0;
+	int iNumTextures = 0;
+
+	/**
+	*	Triangle commands across all submodels. Strips and fans are counted separately.
+	*/
+	size_t uiNumStrips = 0;
+	size_t uiNumFans = 0;
+
+	/**
+	*	Vertices referenced by all triangle commands. Vertices shared by commands are counted once per command.
+	*/
+	size_t uiNumCommandVertices = 0;
+
+	size_t uiNumTriangles = 0;
+
+	/**
+	*	Vertices after the triangle commands are converted to indexed meshes. Vertices are unique per mesh.
+	*/
+	size_t uiNumMeshVertices = 0;
+
+	/**
+	*	Size of the indexed pixels and palettes of all textures, as stored in the file.
+	*/
+	size_t uiTextureFileBytes = 0;
+
+	/**
+	*	Size of all textures once they're resized to powers of two and expanded to RGBA.
+	*/
+	size_t uiTextureMemoryBytes = 0;
+
+	std::vector<SequenceGroupStats_t> SequenceGroups;
+
+	/**
+	*	Values decoded per frame to pose the model with the most expensive sequence: 6 per bone for every blend.
+	*/
+	size_t uiPoseChannels = 0;
+
+	/**
+	*	Name of the most expensive sequence.
+	*/
+	std::string szPoseSequence;
+
+	/**
+	*	Vertices and normals transformed per frame with the default body and skin.
+	*/
+	size_t uiPoseVertices = 0;
+	size_t uiPoseNormals = 0;
+
+	/**
+	*	@return Triangles per vertex sent by triangle commands. 1 is the best possible; plain triangle lists get 1/3.
+	*/
+	float GetStripEfficiency() const
+	{
+		return uiNumCommandVertices > 0 ? static_cast<float>( uiNumTriangles ) / uiNumCommandVertices : 0;
+	}
+
+	/**
+	*	@return Average number of triangles per triangle command.
+	*/
+	float GetTrianglesPerCommand() const
+	{
+		const size_t uiNumCommands = uiNumStrips + uiNumFans;
+
+		return uiNumCommands > 0 ? static_cast<float>( uiNumTriangles ) / uiNumCommands : 0;
+	}
+
+	size_t GetAnimBytes() const
+	{
+		size_t uiBytes = 0;
+
+		for( const auto& group : SequenceGroups )
+		{
+			uiBytes += group.uiAnimBytes;
+		}
+
+		return uiBytes;
+	}
+};
+
+/**
+*	Measures a loaded model. Sequence groups that aren't loaded yet are loaded.
+*/
+void ComputeStudioModelStats( const CStudioModel& model, StudioModelStats_t& stats );
+
+/**
+*	Formats statistics for display or saving.
+*	@param stats Statistics to format.
+*	@param format Format to use.
+*	@param szOutput The statistics are appended to this string.
+*/
+void FormatStudioModelStats( const StudioModelStats_t& stats, const DumpFormat format, std::string& szOutput );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOMODELSTATS_H
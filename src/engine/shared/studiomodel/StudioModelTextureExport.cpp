@@ -0,0 +1,193 @@
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <experimental/filesystem>
+#include <set>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "shared/Logging.h"
+
+#include "graphics/BMPFile.h"
+#include "graphics/DDSFile.h"
+#include "graphics/Palette.h"
+#include "graphics/PaletteConversion.h"
+#include "graphics/PNGFile.h"
+
+#include "StudioModelTextureExport.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace studiomdl
+{
+std::string GetStudioTextureFileName( const mstudiotexture_t& texture, const int iTexture )
+{
+	const size_t uiLength = strnlen( texture.name, sizeof( texture.name ) );
+
+	std::string szName( texture.name, uiLength );
+
+	const size_t uiSlash = szName.find_last_of( "/\\" );
+
+	if( uiSlash != std::string::npos )
+		szName.erase( 0, uiSlash + 1 );
+
+	const size_t uiDot = szName.find_last_of( '.' );
+
+	if( uiDot != std::string::npos )
+		szName.erase( uiDot );
+
+	for( auto& c : szName )
+	{
+		if( !isalnum( static_cast<unsigned char>( c ) ) && c != '_' && c != '-' )
+			c = '_';
+	}
+
+	if( szName.empty() )
+		szName = "texture" + std::to_string( iTexture );
+
+	return szName;
+}
+
+void GetStudioTextureFileNames( const studiohdr_t& textureHdr, std::vector<std::string>& names )
+{
+	names.clear();
+	names.reserve( textureHdr.numtextures > 0 ? textureHdr.numtextures : 0 );
+
+	std::set<std::string> usedNames;
+
+	for( int iTexture = 0; iTexture < textureHdr.numtextures; ++iTexture )
+	{
+		std::string szName = GetStudioTextureFileName( *textureHdr.GetTexture( iTexture ), iTexture );
+
+		//Names aren't unique, and file names are case insensitive on some platforms.
+		std::string szLowerName = szName;
+
+		for( auto& c : szLowerName )
+		{
+			c = static_cast<char>( tolower( static_cast<unsigned char>( c ) ) );
+		}
+
+		if( !usedNames.insert( szLowerName ).second )
+		{
+			szName += "_" + std::to_string( iTexture );
+		}
+
+		names.emplace_back( std::move( szName ) );
+	}
+}
+
+bool StringToImageFormat( const char* const pszString, ImageFormat& format )
+{
+	assert( pszString );
+
+	if( !strcmp( pszString, "bmp" ) )
+		format = ImageFormat::BMP;
+	else if( !strcmp( pszString, "png" ) )
+		format = ImageFormat::PNG;
+	else if( !strcmp( pszString, "dds" ) )
+		format = ImageFormat::DDS;
+	else
+		return false;
+
+	return true;
+}
+
+const char* ImageFormatToExtension( const ImageFormat format )
+{
+	switch( format )
+	{
+	default:
+	case ImageFormat::BMP:	return "bmp";
+	case ImageFormat::PNG:	return "png";
+	case ImageFormat::DDS:	return "dds";
+	}
+}
+
+bool ExportStudioTexture( const studiohdr_t& textureHdr, const int iTexture, const ImageFormat format, const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	if( iTexture < 0 || iTexture >= textureHdr.numtextures )
+		return false;
+
+	const mstudiotexture_t& texture = *textureHdr.GetTexture( iTexture );
+
+	const byte* const pPixels = textureHdr.GetData() + texture.index;
+	const byte* const pPalette = pPixels + texture.width * texture.height;
+
+	switch( format )
+	{
+	default:
+	case ImageFormat::BMP:
+		return graphics::bmpfile::SaveBMPFile( pszFilename, texture.width, texture.height, pPixels, pPalette );
+
+	case ImageFormat::PNG:
+		return graphics::pngfile::SavePNGFile( pszFilename, texture.width, texture.height, pPixels, pPalette, ( texture.flags & STUDIO_NF_MASKED ) != 0 );
+
+	case ImageFormat::DDS:
+		{
+			if( texture.width <= 0 || texture.height <= 0 )
+				return false;
+
+			byte rgbaPalette[ PALETTE_ENTRIES * 4 ];
+
+			graphics::ConvertPaletteToRGBA( pPalette, rgbaPalette );
+
+			//Same as uploads: the mask color is transparent black, which keeps it out of the mip levels.
+			if( texture.flags & STUDIO_NF_MASKED )
+				memset( rgbaPalette + 255 * 4, 0, 4 );
+
+			const size_t uiPixels = static_cast<size_t>( texture.width ) * texture.height;
+
+			std::vector<byte> pixels( uiPixels * 4 );
+
+			graphics::ExpandIndexedToRGBA( pPixels, uiPixels, rgbaPalette, pixels.data() );
+
+			return graphics::ddsfile::SaveDDSFile( pszFilename, texture.width, texture.height, pixels.data() );
+		}
+	}
+}
+
+bool ExportStudioModelTextures( const studiohdr_t& textureHdr, const ImageFormat format, const char* const pszOutputDirectory, size_t& uiExported )
+{
+	assert( pszOutputDirectory );
+
+	uiExported = 0;
+
+	const fs::path outputDirectory( pszOutputDirectory );
+
+	std::error_code error;
+
+	fs::create_directories( outputDirectory, error );
+
+	if( error )
+	{
+		Error( "Couldn't create directory \"%s\": %s\n", pszOutputDirectory, error.message().c_str() );
+		return false;
+	}
+
+	bool bSuccess = true;
+
+	std::vector<std::string> names;
+
+	GetStudioTextureFileNames( textureHdr, names );
+
+	for( int iTexture = 0; iTexture < textureHdr.numtextures; ++iTexture )
+	{
+		const fs::path filename = outputDirectory / ( names[ iTexture ] + "." + ImageFormatToExtension( format ) );
+
+		if( ExportStudioTexture( textureHdr, iTexture, format, filename.string().c_str() ) )
+		{
+			++uiExported;
+		}
+		else
+		{
+			Error( "Couldn't save texture \"%s\"\n", filename.string().c_str() );
+			bSuccess = false;
+		}
+	}
+
+	return bSuccess;
+}
+}
@@ -0,0 +1,77 @@
+#ifndef GAME_STUDIOMODEL_STUDIOMODELTEXTUREEXPORT_H
+#define GAME_STUDIOMODEL_STUDIOMODELTEXTUREEXPORT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "studio.h"
+
+/*
+*	Exports studio model textures as image files.
+*	Textures are encoded straight from the indexed pixels and palettes in the texture header, so no GL is needed.
+*	DDS files are compressed with the same encoder and mipmap filter that texture uploads use.
+*/
+
+namespace studiomdl
+{
+enum class ImageFormat
+{
+	BMP = 0,
+
+	/**
+	*	Masked textures are saved with their transparent color.
+	*/
+	PNG,
+
+	/**
+	*	Compressed to BC1, or BC3 for translucent images, with a full mip chain. Masked textures use BC1 with 1 bit alpha.
+	*/
+	DDS
+};
+
+/**
+*	Parses an image format name: "bmp", "png" or "dds".
+*	@return Whether the name is a valid format.
+*/
+bool StringToImageFormat( const char* const pszString, ImageFormat& format );
+
+/**
+*	@return The file extension images in the given format are saved with, without the dot.
+*/
+const char* ImageFormatToExtension( const ImageFormat format );
+
+/**
+*	Gets the file name a texture is exported with, without extension. Texture names can contain paths and characters that aren't valid in file names,
+*	those are removed. Textures without a name are named after their index.
+*/
+std::string GetStudioTextureFileName( const mstudiotexture_t& texture, const int iTexture );
+
+/**
+*	Gets the file names of every texture in a header, without extension. Textures with the same name get their index appended.
+*/
+void GetStudioTextureFileNames( const studiohdr_t& textureHdr, std::vector<std::string>& names );
+
+/**
+*	Exports a single texture.
+*	@param textureHdr Header that contains the texture, in the mdl layout.
+*	@param iTexture Index of the texture.
+*	@param format Format to save in.
+*	@param pszFilename Name of the file to save to.
+*	@return Whether the texture was saved.
+*/
+bool ExportStudioTexture( const studiohdr_t& textureHdr, const int iTexture, const ImageFormat format, const char* const pszFilename );
+
+/**
+*	Exports every texture in a header to a directory. Files are named after the textures.
+*	Does not use GL, so models from many threads can be exported at once.
+*	@param textureHdr Header that contains the textures, in the mdl layout.
+*	@param format Format to save in.
+*	@param pszOutputDirectory Directory to save to. Created if it doesn't exist.
+*	@param uiExported Number of textures that were saved.
+*	@return Whether all textures were saved.
+*/
+bool ExportStudioModelTextures( const studiohdr_t& textureHdr, const ImageFormat format, const char* const pszOutputDirectory, size_t& uiExported );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOMODELTEXTUREEXPORT_H
@@ -0,0 +1,691 @@
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+
+#include "utility/CMappedFile.h"
+
+#include "graphics/Palette.h"
+
+#include "CStudioModel.h"
+
+#include "StudioModelValidation.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Checks the contents of a single file. Issues are prefixed with the current context, like the bone or sequence being checked.
+*/
+class CValidator final
+{
+public:
+	CValidator( const byte* pData, const size_t uiSize, std::vector<std::string>* pIssues )
+		: m_pData( pData )
+		, m_uiSize( uiSize )
+		, m_pIssues( pIssues )
+	{
+		m_szContext[ 0 ] = '\0';
+	}
+
+	bool IsValid() const { return m_bValid; }
+
+	const byte* GetData() const { return m_pData; }
+
+	template<typename T>
+	const T* Get( const int iOffset ) const
+	{
+		return reinterpret_cast<const T*>( m_pData + iOffset );
+	}
+
+	void SetContext( const char* const pszFormat, ... )
+	{
+		va_list list;
+
+		va_start( list, pszFormat );
+		vsnprintf( m_szContext, sizeof( m_szContext ), pszFormat, list );
+		va_end( list );
+	}
+
+	void ClearContext()
+	{
+		m_szContext[ 0 ] = '\0';
+	}
+
+	void Report( const char* const pszFormat, ... )
+	{
+		m_bValid = false;
+
+		if( !m_pIssues || m_uiReported >= MAX_VALIDATION_ISSUES )
+			return;
+
+		++m_uiReported;
+
+		char szIssue[ 512 ];
+
+		va_list list;
+
+		va_start( list, pszFormat );
+		vsnprintf( szIssue, sizeof( szIssue ), pszFormat, list );
+		va_end( list );
+
+		if( m_szContext[ 0 ] )
+			m_pIssues->emplace_back( std::string( m_szContext ) + ": " + szIssue );
+		else
+			m_pIssues->emplace_back( szIssue );
+	}
+
+	/**
+	*	@return Whether iBytes bytes at pData are inside the file.
+	*/
+	bool IsInside( const byte* pData, const int64_t iBytes ) const
+	{
+		const ptrdiff_t iOffset = pData - m_pData;
+
+		return iOffset >= 0 && iBytes >= 0 && static_cast<size_t>( iOffset ) <= m_uiSize && static_cast<uint64_t>( m_uiSize - iOffset ) >= static_cast<uint64_t>( iBytes );
+	}
+
+	/**
+	*	Checks that a table of iCount elements of uiElementSize bytes at iOffset is inside the file.
+	*/
+	bool CheckTable( const char* const pszName, const int iOffset, const int64_t iCount, const size_t uiElementSize )
+	{
+		if( iCount < 0 )
+		{
+			Report( "%s has a negative count (%lld)", pszName, static_cast<long long>( iCount ) );
+			return false;
+		}
+
+		if( iCount == 0 )
+			return true;
+
+		if( iOffset < 0 || !IsInside( m_pData + iOffset, iCount * static_cast<int64_t>( uiElementSize ) ) )
+		{
+			Report( "%s (%lld entries at offset %d) is outside the file", pszName, static_cast<long long>( iCount ), iOffset );
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	*	Checks that an index is in [ iMin, iCount ).
+	*/
+	bool CheckIndex( const char* const pszName, const int iIndex, const int iCount, const int iMin = 0 )
+	{
+		if( iIndex < iMin || iIndex >= iCount )
+		{
+			Report( "%s %d is out of range, there are %d", pszName, iIndex, iCount );
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	*	Checks a count against the fixed size arrays that the loader and renderer use.
+	*/
+	bool CheckLimit( const char* const pszName, const int iCount, const int iLimit )
+	{
+		if( iCount > iLimit )
+		{
+			Report( "Has %d %s, at most %d are supported", iCount, pszName, iLimit );
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	const byte* const m_pData;
+	const size_t m_uiSize;
+
+	std::vector<std::string>* const m_pIssues;
+
+	bool m_bValid = true;
+
+	size_t m_uiReported = 0;
+
+	char m_szContext[ 256 ];
+
+private:
+	CValidator( const CValidator& ) = delete;
+	CValidator& operator=( const CValidator& ) = delete;
+};
+
+/**
+*	Checks the run length encoded animation values of a sequence. The validator must be for the file that has the sequence's group.
+*/
+void CheckAnimations( CValidator& validator, const mstudioseqdesc_t& sequence, const int iNumBones )
+{
+	if( !validator.CheckTable( "Animations", sequence.animindex, static_cast<int64_t>( sequence.numblends ) * iNumBones, sizeof( mstudioanim_t ) ) )
+		return;
+
+	const mstudioanim_t* const pAnims = validator.Get<mstudioanim_t>( sequence.animindex );
+
+	for( int iAnim = 0; iAnim < sequence.numblends * iNumBones; ++iAnim )
+	{
+		const mstudioanim_t& anim = pAnims[ iAnim ];
+
+		for( int iChannel = 0; iChannel < 6; ++iChannel )
+		{
+			if( anim.offset[ iChannel ] == 0 )
+				continue;
+
+			const byte* pValues = reinterpret_cast<const byte*>( &anim ) + anim.offset[ iChannel ];
+
+			//Every frame must be covered by a run, or decoding reads past the last one.
+			for( int iFrames = sequence.numframes; iFrames > 0; )
+			{
+				if( !validator.IsInside( pValues, sizeof( mstudioanimvalue_t ) ) )
+				{
+					validator.Report( "Values of bone %d channel %d are outside the file", iAnim % iNumBones, iChannel );
+					return;
+				}
+
+				const mstudioanimvalue_t* const pValue = reinterpret_cast<const mstudioanimvalue_t*>( pValues );
+
+				if( pValue->num.total == 0 || pValue->num.valid > pValue->num.total )
+				{
+					validator.Report( "Bone %d channel %d has an invalid run (%d valid of %d)", iAnim % iNumBones, iChannel, pValue->num.valid, pValue->num.total );
+					return;
+				}
+
+				const int64_t iRunSize = ( pValue->num.valid + 1 ) * static_cast<int64_t>( sizeof( mstudioanimvalue_t ) );
+
+				if( !validator.IsInside( pValues, iRunSize ) )
+				{
+					validator.Report( "Values of bone %d channel %d are outside the file", iAnim % iNumBones, iChannel );
+					return;
+				}
+
+				iFrames -= pValue->num.total;
+				pValues += iRunSize;
+			}
+		}
+	}
+}
+
+void CheckTriangleCommands( CValidator& validator, const mstudiomesh_t& mesh, const mstudiomodel_t& model )
+{
+	if( mesh.triindex < 0 )
+	{
+		validator.Report( "Triangle commands have a negative offset" );
+		return;
+	}
+
+	const byte* pCommands = validator.GetData() + mesh.triindex;
+
+	for( ;; )
+	{
+		if( !validator.IsInside( pCommands, sizeof( short ) ) )
+		{
+			validator.Report( "Triangle commands run past the end of the file" );
+			return;
+		}
+
+		int iCount = *reinterpret_cast<const short*>( pCommands );
+
+		pCommands += sizeof( short );
+
+		if( iCount == 0 )
+			break;
+
+		//Negative counts are fans.
+		if( iCount < 0 )
+			iCount = -iCount;
+
+		const int64_t iBytes = iCount * 4 * static_cast<int64_t>( sizeof( short ) );
+
+		if( !validator.IsInside( pCommands, iBytes ) )
+		{
+			validator.Report( "Triangle commands run past the end of the file" );
+			return;
+		}
+
+		const short* const pVertices = reinterpret_cast<const short*>( pCommands );
+
+		for( int iVertex = 0; iVertex < iCount; ++iVertex )
+		{
+			if( !validator.CheckIndex( "Triangle command vertex", pVertices[ iVertex * 4 ], model.numverts ) ||
+				!validator.CheckIndex( "Triangle command normal", pVertices[ iVertex * 4 + 1 ], model.numnorms ) )
+			{
+				return;
+			}
+		}
+
+		pCommands += iBytes;
+	}
+}
+
+/**
+*	Checks that every bone index in a vertex or normal bone table is valid.
+*/
+void CheckBoneIndices( CValidator& validator, const char* const pszName, const int iOffset, const int iCount, const int iNumBones )
+{
+	if( !validator.CheckTable( pszName, iOffset, iCount, sizeof( byte ) ) )
+		return;
+
+	const byte* const pBones = validator.Get<byte>( iOffset );
+
+	for( int iIndex = 0; iIndex < iCount; ++iIndex )
+	{
+		if( pBones[ iIndex ] >= iNumBones )
+		{
+			validator.Report( "%s %d uses bone %d, there are %d", pszName, iIndex, pBones[ iIndex ], iNumBones );
+			return;
+		}
+	}
+}
+
+void CheckBones( CValidator& validator, const studiohdr_t& hdr )
+{
+	validator.CheckLimit( "bones", hdr.numbones, MAXSTUDIOBONES );
+	validator.CheckLimit( "bone controllers", hdr.numbonecontrollers, MAXSTUDIOCONTROLLERS );
+
+	if( validator.CheckTable( "Bones", hdr.boneindex, hdr.numbones, sizeof( mstudiobone_t ) ) )
+	{
+		for( int iBone = 0; iBone < hdr.numbones; ++iBone )
+		{
+			const mstudiobone_t& bone = *hdr.GetBone( iBone );
+
+			validator.SetContext( "Bone %d", iBone );
+
+			if( bone.parent == iBone )
+				validator.Report( "Is its own parent" );
+			else
+				validator.CheckIndex( "Parent", bone.parent, hdr.numbones, -1 );
+
+			for( int iController = 0; iController < STUDIO_MAX_PER_BONE_CONTROLLERS; ++iController )
+			{
+				validator.CheckIndex( "Bone controller", bone.bonecontroller[ iController ], hdr.numbonecontrollers, -1 );
+			}
+		}
+
+		validator.ClearContext();
+	}
+
+	if( validator.CheckTable( "Bone controllers", hdr.bonecontrollerindex, hdr.numbonecontrollers, sizeof( mstudiobonecontroller_t ) ) )
+	{
+		for( int iController = 0; iController < hdr.numbonecontrollers; ++iController )
+		{
+			validator.SetContext( "Bone controller %d", iController );
+			validator.CheckIndex( "Bone", hdr.GetBoneController( iController )->bone, hdr.numbones, -1 );
+		}
+
+		validator.ClearContext();
+	}
+
+	if( validator.CheckTable( "Hitboxes", hdr.hitboxindex, hdr.numhitboxes, sizeof( mstudiobbox_t ) ) )
+	{
+		for( int iHitbox = 0; iHitbox < hdr.numhitboxes; ++iHitbox )
+		{
+			validator.SetContext( "Hitbox %d", iHitbox );
+			validator.CheckIndex( "Bone", hdr.GetHitBox( iHitbox )->bone, hdr.numbones );
+		}
+
+		validator.ClearContext();
+	}
+
+	if( validator.CheckTable( "Attachments", hdr.attachmentindex, hdr.numattachments, sizeof( mstudioattachment_t ) ) )
+	{
+		for( int iAttachment = 0; iAttachment < hdr.numattachments; ++iAttachment )
+		{
+			validator.SetContext( "Attachment %d", iAttachment );
+			validator.CheckIndex( "Bone", hdr.GetAttachment( iAttachment )->bone, hdr.numbones );
+		}
+
+		validator.ClearContext();
+	}
+}
+
+void CheckSequences( CValidator& validator, const studiohdr_t& hdr )
+{
+	validator.CheckLimit( "sequence groups", hdr.numseqgroups, static_cast<int>( CStudioModel::MAX_SEQGROUPS ) );
+
+	validator.CheckTable( "Sequence groups", hdr.seqgroupindex, hdr.numseqgroups, sizeof( mstudioseqgroup_t ) );
+
+	if( !validator.CheckTable( "Sequences", hdr.seqindex, hdr.numseq, sizeof( mstudioseqdesc_t ) ) )
+		return;
+
+	for( int iSequence = 0; iSequence < hdr.numseq; ++iSequence )
+	{
+		const mstudioseqdesc_t& sequence = *hdr.GetSequence( iSequence );
+
+		validator.SetContext( "Sequence %d (\"%.32s\")", iSequence, sequence.label );
+
+		validator.CheckTable( "Events", sequence.eventindex, sequence.numevents, sizeof( mstudioevent_t ) );
+		validator.CheckTable( "Pivots", sequence.pivotindex, sequence.numpivots, sizeof( mstudiopivot_t ) );
+
+		if( sequence.numframes < 1 )
+			validator.Report( "Has no frames" );
+
+		if( sequence.numblends < 1 )
+			validator.Report( "Has no blends" );
+
+		if( hdr.numbones > 0 )
+			validator.CheckIndex( "Motion bone", sequence.motionbone, hdr.numbones );
+
+		if( validator.CheckIndex( "Sequence group", sequence.seqgroup, hdr.numseqgroups ) && sequence.seqgroup == 0 && sequence.numframes > 0 )
+			CheckAnimations( validator, sequence, hdr.numbones );
+	}
+
+	validator.ClearContext();
+}
+
+void CheckTextures( CValidator& validator, const studiohdr_t& hdr, const bool bIsDol )
+{
+	validator.CheckLimit( "textures", hdr.numtextures, static_cast<int>( CStudioModel::MAX_TEXTURES ) );
+
+	if( validator.CheckTable( "Textures", hdr.textureindex, hdr.numtextures, sizeof( mstudiotexture_t ) ) )
+	{
+		for( int iTexture = 0; iTexture < hdr.numtextures; ++iTexture )
+		{
+			const mstudiotexture_t& texture = *hdr.GetTexture( iTexture );
+
+			validator.SetContext( "Texture %d (\"%.64s\")", iTexture, texture.name );
+
+			if( texture.width <= 0 || texture.height <= 0 )
+			{
+				validator.Report( "Has invalid dimensions %dx%d", texture.width, texture.height );
+				continue;
+			}
+
+			const int64_t iPixels = static_cast<int64_t>( texture.width ) * texture.height;
+
+			//Dol textures start with a name, and have an RGBA palette before the pixels.
+			const int64_t iDataSize = bIsDol ? 32 + PALETTE_ENTRIES * 4 + iPixels : iPixels + PALETTE_SIZE;
+
+			validator.CheckTable( "Texture data", texture.index, iDataSize, sizeof( byte ) );
+		}
+
+		validator.ClearContext();
+	}
+
+	if( validator.CheckTable( "Skins", hdr.skinindex, static_cast<int64_t>( hdr.numskinref ) * hdr.numskinfamilies, sizeof( short ) ) )
+	{
+		const short* const pSkins = hdr.GetSkins();
+
+		for( int iSkin = 0; iSkin < hdr.numskinref * hdr.numskinfamilies; ++iSkin )
+		{
+			if( !validator.CheckIndex( "Skin texture", pSkins[ iSkin ], hdr.numtextures ) )
+				break;
+		}
+	}
+}
+
+void CheckBodyparts( CValidator& validator, const studiohdr_t& hdr )
+{
+	validator.CheckLimit( "body parts", hdr.numbodyparts, MAXSTUDIOBODYPARTS );
+
+	if( !validator.CheckTable( "Body parts", hdr.bodypartindex, hdr.numbodyparts, sizeof( mstudiobodyparts_t ) ) )
+		return;
+
+	for( int iBodypart = 0; iBodypart < hdr.numbodyparts; ++iBodypart )
+	{
+		const mstudiobodyparts_t& bodypart = *hdr.GetBodypart( iBodypart );
+
+		validator.SetContext( "Body part %d (\"%.64s\")", iBodypart, bodypart.name );
+
+		validator.CheckLimit( "models", bodypart.nummodels, MAXSTUDIOMODELS );
+
+		//Body values are divided by the base and wrapped around the number of models to find the submodel.
+		if( bodypart.nummodels < 1 )
+			validator.Report( "Has no models" );
+		else if( bodypart.base < 1 )
+			validator.Report( "Has an invalid base %d", bodypart.base );
+
+		if( !validator.CheckTable( "Models", bodypart.modelindex, bodypart.nummodels, sizeof( mstudiomodel_t ) ) )
+			continue;
+
+		const mstudiomodel_t* const pModels = validator.Get<mstudiomodel_t>( bodypart.modelindex );
+
+		for( int iModel = 0; iModel < bodypart.nummodels; ++iModel )
+		{
+			const mstudiomodel_t& model = pModels[ iModel ];
+
+			validator.SetContext( "Body part %d model %d (\"%.64s\")", iBodypart, iModel, model.name );
+
+			//Vertices and normals aren't limited to MAXSTUDIOVERTS; posing and lighting buffers are sized to each submodel.
+			//Their tables must still fit in the file, which bounds how much memory they can take.
+			validator.CheckLimit( "meshes", model.nummesh, MAXSTUDIOMESHES );
+
+			validator.CheckTable( "Vertices", model.vertindex, model.numverts, sizeof( glm::vec3 ) );
+			validator.CheckTable( "Normals", model.normindex, model.numnorms, sizeof( glm::vec3 ) );
+
+			CheckBoneIndices( validator, "Vertex bones", model.vertinfoindex, model.numverts, hdr.numbones );
+			CheckBoneIndices( validator, "Normal bones", model.norminfoindex, model.numnorms, hdr.numbones );
+
+			if( !validator.CheckTable( "Meshes", model.meshindex, model.nummesh, sizeof( mstudiomesh_t ) ) )
+				continue;
+
+			const mstudiomesh_t* const pMeshes = validator.Get<mstudiomesh_t>( model.meshindex );
+
+			for( int iMesh = 0; iMesh < model.nummesh; ++iMesh )
+			{
+				validator.SetContext( "Body part %d model %d mesh %d", iBodypart, iModel, iMesh );
+
+				CheckTriangleCommands( validator, pMeshes[ iMesh ], model );
+			}
+		}
+	}
+
+	validator.ClearContext();
+}
+
+/**
+*	Maps a file and checks its identifier and version.
+*/
+bool MapFile( const fs::path& path, const char* const pszID, CMappedFile& file, std::vector<std::string>& issues )
+{
+	if( !file.Open( path.string().c_str() ) )
+	{
+		issues.emplace_back( "\"" + path.string() + "\": Couldn't open file" );
+		return false;
+	}
+
+	const studioseqhdr_t* const pHdr = reinterpret_cast<const studioseqhdr_t*>( file.GetData() );
+
+	//Sequence group headers are the smallest headers.
+	if( file.GetSize() < sizeof( studioseqhdr_t ) || strncmp( reinterpret_cast<const char*>( &pHdr->id ), pszID, 4 ) )
+	{
+		issues.emplace_back( "\"" + path.string() + "\": Not a studio model file" );
+		return false;
+	}
+
+	if( pHdr->version != STUDIO_VERSION )
+	{
+		issues.emplace_back( "\"" + path.string() + "\": Has version " + std::to_string( pHdr->version ) + ", expected " + std::to_string( STUDIO_VERSION ) );
+		return false;
+	}
+
+	if( !strcmp( pszID, STUDIOMDL_HDR_ID ) && file.GetSize() < sizeof( studiohdr_t ) )
+	{
+		issues.emplace_back( "\"" + path.string() + "\": File is smaller than its header" );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*	Prefixes the issues found in a file with its name.
+*/
+void AddFileName( const fs::path& path, std::vector<std::string>& issues, const size_t uiFirst )
+{
+	for( size_t uiIssue = uiFirst; uiIssue < issues.size(); ++uiIssue )
+	{
+		issues[ uiIssue ] = "\"" + path.string() + "\": " + issues[ uiIssue ];
+	}
+}
+
+bool ValidateHeaderFile( const fs::path& path, const bool bIsDol, CMappedFile& file, std::vector<std::string>& issues )
+{
+	if( !MapFile( path, STUDIOMDL_HDR_ID, file, issues ) )
+		return false;
+
+	const size_t uiFirst = issues.size();
+
+	const bool bValid = ValidateStudioHeader( *reinterpret_cast<const studiohdr_t*>( file.GetData() ), file.GetSize(), bIsDol, &issues );
+
+	AddFileName( path, issues, uiFirst );
+
+	return bValid;
+}
+}
+
+bool ValidateStudioHeader( const studiohdr_t& hdr, const size_t uiSize, const bool bIsDol, std::vector<std::string>* pIssues )
+{
+	CValidator validator( hdr.GetData(), uiSize, pIssues );
+
+	if( uiSize < sizeof( studiohdr_t ) )
+	{
+		validator.Report( "File is smaller than its header" );
+		return false;
+	}
+
+	if( hdr.length < 0 || static_cast<size_t>( hdr.length ) > uiSize )
+		validator.Report( "Header length %d does not match the file size %u", hdr.length, static_cast<unsigned int>( uiSize ) );
+
+	CheckBones( validator, hdr );
+	CheckSequences( validator, hdr );
+	CheckTextures( validator, hdr, bIsDol );
+	CheckBodyparts( validator, hdr );
+
+	return validator.IsValid();
+}
+
+bool ValidateSkinReferences( const studiohdr_t& hdr, const studiohdr_t& textureHdr, std::vector<std::string>* pIssues )
+{
+	CValidator validator( hdr.GetData(), hdr.length, pIssues );
+
+	for( int iBodypart = 0; iBodypart < hdr.numbodyparts; ++iBodypart )
+	{
+		const mstudiobodyparts_t& bodypart = *hdr.GetBodypart( iBodypart );
+
+		const mstudiomodel_t* const pModels = validator.Get<mstudiomodel_t>( bodypart.modelindex );
+
+		for( int iModel = 0; iModel < bodypart.nummodels; ++iModel )
+		{
+			const mstudiomesh_t* const pMeshes = validator.Get<mstudiomesh_t>( pModels[ iModel ].meshindex );
+
+			for( int iMesh = 0; iMesh < pModels[ iModel ].nummesh; ++iMesh )
+			{
+				validator.SetContext( "Body part %d model %d mesh %d", iBodypart, iModel, iMesh );
+				validator.CheckIndex( "Skin reference", pMeshes[ iMesh ].skinref, textureHdr.numskinref );
+			}
+		}
+	}
+
+	return validator.IsValid();
+}
+
+bool ValidateSequenceGroup( const studiohdr_t& hdr, const int iGroup, const void* pGroupData, const size_t uiSize, std::vector<std::string>* pIssues )
+{
+	CValidator validator( static_cast<const byte*>( pGroupData ), uiSize, pIssues );
+
+	for( int iSequence = 0; iSequence < hdr.numseq; ++iSequence )
+	{
+		const mstudioseqdesc_t& sequence = *hdr.GetSequence( iSequence );
+
+		if( sequence.seqgroup != iGroup || sequence.numframes < 1 )
+			continue;
+
+		validator.SetContext( "Sequence %d (\"%.32s\")", iSequence, sequence.label );
+
+		CheckAnimations( validator, sequence, hdr.numbones );
+	}
+
+	return validator.IsValid();
+}
+
+bool ValidateStudioModelFile( const char* const pszFilename, std::vector<std::string>& issues )
+{
+	const fs::path path( pszFilename );
+
+	const std::string szExtension = path.extension().string();
+
+	const bool bIsDol = szExtension == ".dol" || szExtension == ".DOL";
+
+	CMappedFile modelFile;
+
+	if( !ValidateHeaderFile( path, bIsDol, modelFile, issues ) )
+		return false;
+
+	const studiohdr_t& hdr = *reinterpret_cast<const studiohdr_t*>( modelFile.GetData() );
+
+	bool bValid = true;
+
+	//Textures are in a separate T.mdl file.
+	CMappedFile textureFile;
+
+	const studiohdr_t* pTextureHdr = &hdr;
+
+	if( hdr.numtextures == 0 )
+	{
+		fs::path texturePath( path );
+
+		texturePath.replace_filename( path.stem().string() + "T" + szExtension );
+
+		std::error_code error;
+
+		//The loader requires the texture file, even if there are no meshes.
+		if( !fs::exists( texturePath, error ) )
+		{
+			issues.emplace_back( "\"" + path.string() + "\": Has no textures, and the texture file \"" + texturePath.string() + "\" doesn't exist" );
+			bValid = false;
+			pTextureHdr = nullptr;
+		}
+		else if( ValidateHeaderFile( texturePath, bIsDol, textureFile, issues ) )
+		{
+			pTextureHdr = reinterpret_cast<const studiohdr_t*>( textureFile.GetData() );
+		}
+		else
+		{
+			bValid = false;
+			pTextureHdr = nullptr;
+		}
+	}
+
+	if( pTextureHdr )
+	{
+		const size_t uiFirst = issues.size();
+
+		bValid = ValidateSkinReferences( hdr, *pTextureHdr, &issues ) && bValid;
+
+		AddFileName( path, issues, uiFirst );
+	}
+
+	//Animations of other groups are in their own files.
+	for( int iGroup = 1; iGroup < hdr.numseqgroups; ++iGroup )
+	{
+		char szSuffix[ 16 ];
+
+		snprintf( szSuffix, sizeof( szSuffix ), "%02d", iGroup );
+
+		fs::path groupPath( path );
+
+		groupPath.replace_filename( path.stem().string() + szSuffix + szExtension );
+
+		CMappedFile groupFile;
+
+		if( !MapFile( groupPath, STUDIOMDL_SEQ_ID, groupFile, issues ) )
+		{
+			bValid = false;
+			continue;
+		}
+
+		const size_t uiFirst = issues.size();
+
+		bValid = ValidateSequenceGroup( hdr, iGroup, groupFile.GetData(), groupFile.GetSize(), &issues ) && bValid;
+
+		AddFileName( groupPath, issues, uiFirst );
+	}
+
+	return bValid;
+}
+}
@@ -0,0 +1,65 @@
+#ifndef GAME_STUDIOMODEL_STUDIOMODELVALIDATION_H
+#define GAME_STUDIOMODEL_STUDIOMODELVALIDATION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "studio.h"
+
+/*
+*	Checks model files before they're loaded. Models are validated by the loader unless mdl_validate is disabled.
+*	Validated models are accessed without further checks through CStudioModelView, so anything it or the renderer reads must be checked here.
+*	Validation only reads the files, so no GL is needed and it can be done on any thread.
+*/
+
+namespace studiomdl
+{
+/**
+*	Most issues that are recorded for a single file. Validation continues past this, so the result is still correct.
+*/
+const size_t MAX_VALIDATION_ISSUES = 64;
+
+/**
+*	Checks that all tables, texture data, triangle commands and animations in a header are inside the file,
+*	and that indices into other tables are in range.
+*	Animations in other sequence groups are not checked, since they're in other files.
+*	@param hdr Model or texture model header.
+*	@param uiSize Size of the file the header was loaded from.
+*	@param bIsDol Whether the file is a Dreamcast model, whose textures have a different layout.
+*	@param pIssues If not null, a description of each issue is added to this list.
+*	@return Whether the header is valid.
+*/
+bool ValidateStudioHeader( const studiohdr_t& hdr, const size_t uiSize, const bool bIsDol, std::vector<std::string>* pIssues = nullptr );
+
+/**
+*	Checks that meshes only reference skins that the texture header has.
+*	@param hdr Model header. Must have been validated with ValidateStudioHeader.
+*	@param textureHdr Header that contains the model's textures. Can be the model header itself.
+*	@param pIssues If not null, a description of each issue is added to this list.
+*	@return Whether all skin references are valid.
+*/
+bool ValidateSkinReferences( const studiohdr_t& hdr, const studiohdr_t& textureHdr, std::vector<std::string>* pIssues = nullptr );
+
+/**
+*	Checks that the animations of all sequences in a sequence group are inside the group's file.
+*	@param hdr Model header. Must have been validated with ValidateStudioHeader.
+*	@param iGroup Index of the group. Group 0 is part of the model header and is checked by ValidateStudioHeader.
+*	@param pGroupData Contents of the group's file.
+*	@param uiSize Size of the group's file.
+*	@param pIssues If not null, a description of each issue is added to this list.
+*	@return Whether the group is valid.
+*/
+bool ValidateSequenceGroup( const studiohdr_t& hdr, const int iGroup, const void* pGroupData, const size_t uiSize, std::vector<std::string>* pIssues = nullptr );
+
+/**
+*	Validates a model file, along with its texture file and sequence group files if it has them.
+*	Also checks that meshes only reference skins that the texture file has, and the animations in sequence groups.
+*	@param pszFilename Model to validate.
+*	@param issues A description of each issue is added to this list, including the file it was found in.
+*	@return Whether the model is valid.
+*/
+bool ValidateStudioModelFile( const char* const pszFilename, std::vector<std::string>& issues );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOMODELVALIDATION_H
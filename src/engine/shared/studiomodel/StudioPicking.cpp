@@ -0,0 +1,571 @@
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "utility/mathlib.h"
+
+#include "CStudioModel.h"
+
+#include "StudioPicking.h"
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Most triangles that a leaf can hold.
+*/
+const uint32_t MAX_LEAF_TRIANGLES = 4;
+
+/**
+*	Deepest a tree can get. Trees are split at the median, so this is enough for far more triangles than a model can have.
+*/
+const size_t MAX_TREE_DEPTH = 64;
+
+glm::vec3 GetBoneOrigin( const glm::mat3x4& bone )
+{
+	return glm::vec3( bone[ 0 ][ 3 ], bone[ 1 ][ 3 ], bone[ 2 ][ 3 ] );
+}
+
+/**
+*	Transforms a ray into a bone's reference frame. Bones don't scale, so distances along the ray stay the same.
+*/
+PickRay_t TransformRayToBone( const PickRay_t& ray, const glm::mat3x4& bone )
+{
+	PickRay_t result;
+
+	VectorIRotate( ray.vecOrigin - GetBoneOrigin( bone ), bone, result.vecOrigin );
+	VectorIRotate( ray.vecDir, bone, result.vecDir );
+
+	return result;
+}
+
+glm::vec3 GetInverseDir( const glm::vec3& vecDir )
+{
+	//Zero components become infinite, which the slab test handles correctly.
+	return glm::vec3( 1.0f / vecDir.x, 1.0f / vecDir.y, 1.0f / vecDir.z );
+}
+
+/**
+*	Slab test.
+*	@return Distance at which the ray enters the box, or a negative value if it misses the box or only hits it beyond flMaxDistance.
+*/
+float IntersectBox( const glm::vec3& vecOrigin, const glm::vec3& vecInvDir, const glm::vec3& vecMins, const glm::vec3& vecMaxs, const float flMaxDistance )
+{
+	float flNear = 0;
+	float flFar = flMaxDistance;
+
+	for( int i = 0; i < 3; ++i )
+	{
+		float flT1 = ( vecMins[ i ] - vecOrigin[ i ] ) * vecInvDir[ i ];
+		float flT2 = ( vecMaxs[ i ] - vecOrigin[ i ] ) * vecInvDir[ i ];
+
+		if( flT1 > flT2 )
+			std::swap( flT1, flT2 );
+
+		//Written so that NaN, from a ray that lies exactly in a slab's plane, doesn't reject the box.
+		flNear = flT1 > flNear ? flT1 : flNear;
+		flFar = flT2 < flFar ? flT2 : flFar;
+
+		if( flNear > flFar )
+			return -1;
+	}
+
+	return flNear;
+}
+
+/**
+*	Intersects a ray with a triangle, from either side.
+*	@return Distance to the intersection, or a negative value if there is none.
+*/
+float IntersectTriangle( const PickRay_t& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2 )
+{
+	const glm::vec3 vecEdge1 = v1 - v0;
+	const glm::vec3 vecEdge2 = v2 - v0;
+
+	const glm::vec3 vecP = glm::cross( ray.vecDir, vecEdge2 );
+
+	const float flDet = glm::dot( vecEdge1, vecP );
+
+	if( std::fabs( flDet ) < 1e-12f )
+		return -1;
+
+	const float flInvDet = 1.0f / flDet;
+
+	const glm::vec3 vecT = ray.vecOrigin - v0;
+
+	const float u = glm::dot( vecT, vecP ) * flInvDet;
+
+	if( u < 0 || u > 1 )
+		return -1;
+
+	const glm::vec3 vecQ = glm::cross( vecT, vecEdge1 );
+
+	const float v = glm::dot( ray.vecDir, vecQ ) * flInvDet;
+
+	if( v < 0 || u + v > 1 )
+		return -1;
+
+	return glm::dot( vecEdge2, vecQ ) * flInvDet;
+}
+
+/**
+*	Tests whether a point is inside the cone around a ray.
+*	@return Distance along the ray to the point, or a negative value if it's outside the cone.
+*/
+float IntersectPoint( const PickRay_t& ray, const glm::vec3& vecPoint, const float flTolerance )
+{
+	const glm::vec3 vecOffset = vecPoint - ray.vecOrigin;
+
+	const float flAlong = glm::dot( vecOffset, ray.vecDir );
+
+	if( flAlong <= 0 )
+		return -1;
+
+	const float flRadius = flAlong * flTolerance;
+
+	if( glm::dot( vecOffset, vecOffset ) - flAlong * flAlong > flRadius * flRadius )
+		return -1;
+
+	return flAlong;
+}
+
+bool IsNearer( const PickResult_t& result, const float flDistance )
+{
+	return result.type == PickType::NONE || flDistance < result.flDistance;
+}
+}
+
+CStudioModelPicker::CStudioModelPicker( const CStudioModel& model )
+	: m_pModel( &model )
+	, m_pStudioHdr( model.GetStudioHeader() )
+{
+	const studiohdr_t* const pStudioHdr = m_pStudioHdr;
+
+	for( int iBodyPart = 0; iBodyPart < pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiobodyparts_t* const pbodypart = pStudioHdr->GetBodypart( iBodyPart );
+
+		const mstudiomodel_t* const pModels = ( const mstudiomodel_t* ) ( pStudioHdr->GetData() + pbodypart->modelindex );
+
+		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
+		{
+			BuildSubmodel( pModels[ iModel ], m_Submodels[ &pModels[ iModel ] ] );
+		}
+	}
+}
+
+bool CStudioModelPicker::IsBuiltFor( const CStudioModel& model ) const
+{
+	return m_pModel == &model && m_pStudioHdr == model.GetStudioHeader();
+}
+
+void CStudioModelPicker::BuildSubmodel( const mstudiomodel_t& model, Submodel_t& submodel )
+{
+	const studiohdr_t* const pStudioHdr = m_pStudioHdr;
+
+	const glm::vec3* const pVertices = ( const glm::vec3* ) ( pStudioHdr->GetData() + model.vertindex );
+	const byte* const pVertexBones = pStudioHdr->GetData() + model.vertinfoindex;
+
+	const mstudiomesh_t* const pMeshes = ( const mstudiomesh_t* ) ( pStudioHdr->GetData() + model.meshindex );
+
+	//Index of each bone's tree, or -1 if it has none yet.
+	int treeIndices[ MAXSTUDIOBONES ];
+
+	std::fill( std::begin( treeIndices ), std::end( treeIndices ), -1 );
+
+	auto addTriangle = [ & ]( const int iMesh, const short* p0, const short* p1, const short* p2 )
+	{
+		const short* const verts[ 3 ] = { p0, p1, p2 };
+
+		int iBones[ 3 ];
+
+		for( int i = 0; i < 3; ++i )
+		{
+			iBones[ i ] = pVertexBones[ verts[ i ][ 0 ] ];
+
+			//Malformed models are reported by validation, just leave these triangles out.
+			if( iBones[ i ] >= pStudioHdr->numbones )
+				return;
+		}
+
+		if( iBones[ 0 ] == iBones[ 1 ] && iBones[ 0 ] == iBones[ 2 ] )
+		{
+			int& iTree = treeIndices[ iBones[ 0 ] ];
+
+			if( iTree == -1 )
+			{
+				iTree = static_cast<int>( submodel.trees.size() );
+				submodel.trees.emplace_back();
+				submodel.trees.back().iBone = iBones[ 0 ];
+			}
+
+			submodel.trees[ iTree ].triangles.push_back( { { pVertices[ p0[ 0 ] ], pVertices[ p1[ 0 ] ], pVertices[ p2[ 0 ] ] }, iMesh } );
+		}
+		else
+		{
+			submodel.mixed.push_back( { { pVertices[ p0[ 0 ] ], pVertices[ p1[ 0 ] ], pVertices[ p2[ 0 ] ] }, { iBones[ 0 ], iBones[ 1 ], iBones[ 2 ] }, iMesh } );
+		}
+	};
+
+	for( int iMesh = 0; iMesh < model.nummesh; ++iMesh )
+	{
+		auto ptricmds = ( const short* ) ( pStudioHdr->GetData() + pMeshes[ iMesh ].triindex );
+
+		int i;
+
+		while( ( i = *( ptricmds++ ) ) != 0 )
+		{
+			const bool bIsFan = i < 0;
+
+			if( bIsFan )
+				i = -i;
+
+			//Winding doesn't matter, triangles are hit from both sides.
+			for( int iVert = 2; iVert < i; ++iVert )
+			{
+				const short* const pFirst = bIsFan ? ptricmds : ptricmds + ( iVert - 2 ) * 4;
+
+				addTriangle( iMesh, pFirst, ptricmds + ( iVert - 1 ) * 4, ptricmds + iVert * 4 );
+			}
+
+			ptricmds += i * 4;
+		}
+	}
+
+	for( auto& tree : submodel.trees )
+	{
+		tree.nodes.reserve( tree.triangles.size() / MAX_LEAF_TRIANGLES * 2 + 1 );
+
+		BuildNode( tree, 0, static_cast<uint32_t>( tree.triangles.size() ) );
+	}
+}
+
+uint32_t CStudioModelPicker::BuildNode( BoneTree_t& tree, const uint32_t uiFirst, const uint32_t uiCount )
+{
+	const uint32_t uiNode = static_cast<uint32_t>( tree.nodes.size() );
+
+	tree.nodes.push_back( {} );
+
+	const auto begin = tree.triangles.begin() + uiFirst;
+	const auto end = begin + uiCount;
+
+	glm::vec3 vecMins( FLT_MAX );
+	glm::vec3 vecMaxs( -FLT_MAX );
+
+	glm::vec3 vecCenterMins( FLT_MAX );
+	glm::vec3 vecCenterMaxs( -FLT_MAX );
+
+	for( auto it = begin; it != end; ++it )
+	{
+		for( const auto& vertex : it->v )
+		{
+			vecMins = glm::min( vecMins, vertex );
+			vecMaxs = glm::max( vecMaxs, vertex );
+		}
+
+		const glm::vec3 vecCenter = it->v[ 0 ] + it->v[ 1 ] + it->v[ 2 ];
+
+		vecCenterMins = glm::min( vecCenterMins, vecCenter );
+		vecCenterMaxs = glm::max( vecCenterMaxs, vecCenter );
+	}
+
+	tree.nodes[ uiNode ].vecMins = vecMins;
+	tree.nodes[ uiNode ].vecMaxs = vecMaxs;
+
+	if( uiCount <= MAX_LEAF_TRIANGLES )
+	{
+		tree.nodes[ uiNode ].uiFirst = uiFirst;
+		tree.nodes[ uiNode ].uiCount = uiCount;
+
+		return uiNode;
+	}
+
+	//Split at the median along the axis the centers are spread out the most on.
+	const glm::vec3 vecExtents = vecCenterMaxs - vecCenterMins;
+
+	const int iAxis = vecExtents.x >= vecExtents.y && vecExtents.x >= vecExtents.z ? 0 : ( vecExtents.y >= vecExtents.z ? 1 : 2 );
+
+	const uint32_t uiHalf = uiCount / 2;
+
+	//Centers are compared tripled, which doesn't change their order.
+	std::nth_element( begin, begin + uiHalf, end, [ = ]( const Triangle_t& lhs, const Triangle_t& rhs )
+	{
+		return lhs.v[ 0 ][ iAxis ] + lhs.v[ 1 ][ iAxis ] + lhs.v[ 2 ][ iAxis ] < rhs.v[ 0 ][ iAxis ] + rhs.v[ 1 ][ iAxis ] + rhs.v[ 2 ][ iAxis ];
+	} );
+
+	//The first child directly follows its parent.
+	BuildNode( tree, uiFirst, uiHalf );
+
+	const uint32_t uiSecond = BuildNode( tree, uiFirst + uiHalf, uiCount - uiHalf );
+
+	//Nodes may have been reallocated.
+	tree.nodes[ uiNode ].uiFirst = uiSecond;
+	tree.nodes[ uiNode ].uiCount = 0;
+
+	return uiNode;
+}
+
+float CStudioModelPicker::TraceTree( const BoneTree_t& tree, const PickRay_t& ray, const float flMaxDistance, int& iMesh )
+{
+	if( tree.nodes.empty() )
+		return flMaxDistance;
+
+	const glm::vec3 vecInvDir = GetInverseDir( ray.vecDir );
+
+	float flNearest = flMaxDistance;
+
+	uint32_t stack[ MAX_TREE_DEPTH ];
+	size_t uiStackSize = 0;
+
+	const Node_t* const pNodes = tree.nodes.data();
+
+	if( IntersectBox( ray.vecOrigin, vecInvDir, pNodes[ 0 ].vecMins, pNodes[ 0 ].vecMaxs, flNearest ) < 0 )
+		return flMaxDistance;
+
+	stack[ uiStackSize++ ] = 0;
+
+	while( uiStackSize > 0 )
+	{
+		const Node_t& node = pNodes[ stack[ --uiStackSize ] ];
+
+		if( node.uiCount > 0 )
+		{
+			for( uint32_t uiIndex = node.uiFirst; uiIndex < node.uiFirst + node.uiCount; ++uiIndex )
+			{
+				const Triangle_t& triangle = tree.triangles[ uiIndex ];
+
+				const float flDistance = IntersectTriangle( ray, triangle.v[ 0 ], triangle.v[ 1 ], triangle.v[ 2 ] );
+
+				if( flDistance >= 0 && flDistance < flNearest )
+				{
+					flNearest = flDistance;
+					iMesh = triangle.iMesh;
+				}
+			}
+
+			continue;
+		}
+
+		const uint32_t uiFirstChild = static_cast<uint32_t>( &node - pNodes ) + 1;
+		const uint32_t uiSecondChild = node.uiFirst;
+
+		const float flFirst = IntersectBox( ray.vecOrigin, vecInvDir, pNodes[ uiFirstChild ].vecMins, pNodes[ uiFirstChild ].vecMaxs, flNearest );
+		const float flSecond = IntersectBox( ray.vecOrigin, vecInvDir, pNodes[ uiSecondChild ].vecMins, pNodes[ uiSecondChild ].vecMaxs, flNearest );
+
+		//Visit the nearer child first, so hits in it can cull the other one.
+		if( flFirst >= 0 && flSecond >= 0 )
+		{
+			if( flFirst <= flSecond )
+			{
+				stack[ uiStackSize++ ] = uiSecondChild;
+				stack[ uiStackSize++ ] = uiFirstChild;
+			}
+			else
+			{
+				stack[ uiStackSize++ ] = uiFirstChild;
+				stack[ uiStackSize++ ] = uiSecondChild;
+			}
+		}
+		else if( flFirst >= 0 )
+		{
+			stack[ uiStackSize++ ] = uiFirstChild;
+		}
+		else if( flSecond >= 0 )
+		{
+			stack[ uiStackSize++ ] = uiSecondChild;
+		}
+
+		assert( uiStackSize < MAX_TREE_DEPTH - 1 );
+	}
+
+	return flNearest;
+}
+
+bool CStudioModelPicker::PickBone( const glm::mat3x4* pBoneTransforms, const PickRay_t& ray, const float flTolerance, PickResult_t& result ) const
+{
+	assert( pBoneTransforms );
+
+	const studiohdr_t* const pStudioHdr = m_pStudioHdr;
+
+	bool bFound = false;
+
+	for( int iBone = 0; iBone < pStudioHdr->numbones; ++iBone )
+	{
+		const glm::vec3 vecOrigin = GetBoneOrigin( pBoneTransforms[ iBone ] );
+
+		const float flDistance = IntersectPoint( ray, vecOrigin, flTolerance );
+
+		if( flDistance >= 0 && IsNearer( result, flDistance ) )
+		{
+			result.type = PickType::BONE;
+			result.iIndex = iBone;
+			result.pMesh = nullptr;
+			result.flDistance = flDistance;
+			result.vecPosition = vecOrigin;
+
+			bFound = true;
+		}
+	}
+
+	return bFound;
+}
+
+bool CStudioModelPicker::PickAttachment( const glm::mat3x4* pBoneTransforms, const PickRay_t& ray, const float flTolerance, PickResult_t& result ) const
+{
+	assert( pBoneTransforms );
+
+	const studiohdr_t* const pStudioHdr = m_pStudioHdr;
+
+	const mstudioattachment_t* const pAttachments = pStudioHdr->GetAttachments();
+
+	bool bFound = false;
+
+	for( int iAttachment = 0; iAttachment < pStudioHdr->numattachments; ++iAttachment )
+	{
+		glm::vec3 vecOrigin;
+
+		VectorTransform( pAttachments[ iAttachment ].org, pBoneTransforms[ pAttachments[ iAttachment ].bone ], vecOrigin );
+
+		const float flDistance = IntersectPoint( ray, vecOrigin, flTolerance );
+
+		if( flDistance >= 0 && IsNearer( result, flDistance ) )
+		{
+			result.type = PickType::ATTACHMENT;
+			result.iIndex = iAttachment;
+			result.pMesh = nullptr;
+			result.flDistance = flDistance;
+			result.vecPosition = vecOrigin;
+
+			bFound = true;
+		}
+	}
+
+	return bFound;
+}
+
+bool CStudioModelPicker::PickHitbox( const glm::mat3x4* pBoneTransforms, const PickRay_t& ray, PickResult_t& result ) const
+{
+	assert( pBoneTransforms );
+
+	const studiohdr_t* const pStudioHdr = m_pStudioHdr;
+
+	const mstudiobbox_t* const pHitboxes = pStudioHdr->GetHitBoxes();
+
+	bool bFound = false;
+
+	for( int iHitbox = 0; iHitbox < pStudioHdr->numhitboxes; ++iHitbox )
+	{
+		const mstudiobbox_t& hitbox = pHitboxes[ iHitbox ];
+
+		//Hitboxes are boxes in their bone's reference frame.
+		const PickRay_t boneRay = TransformRayToBone( ray, pBoneTransforms[ hitbox.bone ] );
+
+		const float flMaxDistance = result.type == PickType::NONE ? FLT_MAX : result.flDistance;
+
+		const float flDistance = IntersectBox( boneRay.vecOrigin, GetInverseDir( boneRay.vecDir ), hitbox.bbmin, hitbox.bbmax, flMaxDistance );
+
+		if( flDistance >= 0 && IsNearer( result, flDistance ) )
+		{
+			result.type = PickType::HITBOX;
+			result.iIndex = iHitbox;
+			result.pMesh = nullptr;
+			result.flDistance = flDistance;
+			result.vecPosition = ray.vecOrigin + ray.vecDir * flDistance;
+
+			bFound = true;
+		}
+	}
+
+	return bFound;
+}
+
+bool CStudioModelPicker::PickMesh( const glm::mat3x4* pBoneTransforms, const int iBodygroup, const PickRay_t& ray, PickResult_t& result ) const
+{
+	assert( pBoneTransforms );
+
+	const studiohdr_t* const pStudioHdr = m_pStudioHdr;
+
+	bool bFound = false;
+
+	for( int iBodyPart = 0; iBodyPart < pStudioHdr->numbodyparts; ++iBodyPart )
+	{
+		const mstudiomodel_t* const pModel = m_pModel->GetModelByBodyPart( iBodygroup, iBodyPart );
+
+		auto it = m_Submodels.find( pModel );
+
+		if( it == m_Submodels.end() )
+			continue;
+
+		const Submodel_t& submodel = it->second;
+
+		const float flMaxDistance = result.type == PickType::NONE ? FLT_MAX : result.flDistance;
+
+		float flNearest = flMaxDistance;
+		int iMesh = -1;
+
+		for( const auto& tree : submodel.trees )
+		{
+			flNearest = TraceTree( tree, TransformRayToBone( ray, pBoneTransforms[ tree.iBone ] ), flNearest, iMesh );
+		}
+
+		for( const auto& triangle : submodel.mixed )
+		{
+			glm::vec3 v[ 3 ];
+
+			for( int i = 0; i < 3; ++i )
+			{
+				VectorTransform( triangle.v[ i ], pBoneTransforms[ triangle.iBones[ i ] ], v[ i ] );
+			}
+
+			const float flDistance = IntersectTriangle( ray, v[ 0 ], v[ 1 ], v[ 2 ] );
+
+			if( flDistance >= 0 && flDistance < flNearest )
+			{
+				flNearest = flDistance;
+				iMesh = triangle.iMesh;
+			}
+		}
+
+		if( iMesh != -1 )
+		{
+			result.type = PickType::MESH;
+			result.iIndex = iBodyPart;
+			result.pMesh = ( const mstudiomesh_t* ) ( pStudioHdr->GetData() + pModel->meshindex ) + iMesh;
+			result.flDistance = flNearest;
+			result.vecPosition = ray.vecOrigin + ray.vecDir * flNearest;
+
+			bFound = true;
+		}
+	}
+
+	return bFound;
+}
+
+PickRay_t TransformRayToModel( const glm::vec3& vecOrigin, const glm::vec3& vecDir,
+							   const glm::vec3& vecModelOrigin, const glm::vec3& vecAngles, const glm::vec3& vecScale )
+{
+	//Same transformation as the renderer uses to draw the model.
+	glm::mat4 mat = glm::translate( vecModelOrigin );
+
+	mat *= glm::rotate( glm::radians( vecAngles[ 1 ] ), glm::vec3{ 0, 0, 1 } );
+	mat *= glm::rotate( glm::radians( vecAngles[ 0 ] ), glm::vec3{ 0, 1, 0 } );
+	mat *= glm::rotate( glm::radians( vecAngles[ 2 ] ), glm::vec3{ 1, 0, 0 } );
+	mat *= glm::scale( vecScale );
+
+	const glm::mat4 inverse = glm::inverse( mat );
+
+	PickRay_t ray;
+
+	ray.vecOrigin = glm::vec3( inverse * glm::vec4( vecOrigin, 1 ) );
+	ray.vecDir = glm::normalize( glm::vec3( inverse * glm::vec4( vecDir, 0 ) ) );
+
+	return ray;
+}
+}
@@ -0,0 +1,198 @@
+#ifndef GAME_STUDIOMODEL_STUDIOPICKING_H
+#define GAME_STUDIOMODEL_STUDIOPICKING_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/mat3x4.hpp>
+
+#include "studio.h"
+
+namespace studiomdl
+{
+class CStudioModel;
+
+enum class PickType
+{
+	NONE = 0,
+	BONE,
+	ATTACHMENT,
+	HITBOX,
+	MESH
+};
+
+/**
+*	A ray in model space. The direction must be normalized.
+*/
+struct PickRay_t
+{
+	glm::vec3 vecOrigin;
+	glm::vec3 vecDir;
+};
+
+struct PickResult_t
+{
+	PickType type = PickType::NONE;
+
+	/**
+	*	Index of the bone, attachment or hitbox that was hit. For meshes, the index of the body part.
+	*/
+	int iIndex = -1;
+
+	/**
+	*	Mesh that was hit, if any.
+	*/
+	const mstudiomesh_t* pMesh = nullptr;
+
+	/**
+	*	Distance along the ray to the hit.
+	*/
+	float flDistance = 0;
+
+	/**
+	*	Position of the hit, in model space.
+	*/
+	glm::vec3 vecPosition;
+};
+
+/**
+*	Picks parts of a posed model with rays.
+*	Studio models are rigidly skinned, so triangles whose vertices are all attached to the same bone never change shape.
+*	Those are stored in a bounding volume hierarchy per bone, in the bone's reference frame. Rays are transformed into each bone's frame
+*	instead of transforming the triangles, so the trees never need to be rebuilt. Triangles spanning multiple bones are tested one by one.
+*	All queries are read only, so the picker can be used by multiple threads at once.
+*/
+class CStudioModelPicker final
+{
+public:
+	/**
+	*	Builds the trees of every submodel.
+	*	@param model Model to pick. Its headers must stay valid for as long as the picker is used.
+	*/
+	explicit CStudioModelPicker( const CStudioModel& model );
+	~CStudioModelPicker() = default;
+
+	/**
+	*	@return Whether the picker was built for the given model's current data. Models that are reloaded have to be built again.
+	*/
+	bool IsBuiltFor( const CStudioModel& model ) const;
+
+	/**
+	*	Finds the bone nearest to the ray.
+	*	@param pBoneTransforms Pose to use.
+	*	@param ray Ray to test.
+	*	@param flTolerance How far bones may be from the ray, as a fraction of their distance along it.
+	*		This is the tangent of the cone around the ray that is tested, so it can be derived from the size of a pixel.
+	*	@param result Output. Only changed if a bone was found that is nearer than the current result.
+	*	@return Whether a bone was found.
+	*/
+	bool PickBone( const glm::mat3x4* pBoneTransforms, const PickRay_t& ray, const float flTolerance, PickResult_t& result ) const;
+
+	/**
+	*	Finds the attachment nearest to the ray.
+	*	@see PickBone
+	*/
+	bool PickAttachment( const glm::mat3x4* pBoneTransforms, const PickRay_t& ray, const float flTolerance, PickResult_t& result ) const;
+
+	/**
+	*	Finds the nearest hitbox that the ray intersects.
+	*	@param pBoneTransforms Pose to use.
+	*	@param ray Ray to test.
+	*	@param result Output. Only changed if a hitbox was found that is nearer than the current result.
+	*	@return Whether a hitbox was found.
+	*/
+	bool PickHitbox( const glm::mat3x4* pBoneTransforms, const PickRay_t& ray, PickResult_t& result ) const;
+
+	/**
+	*	Finds the nearest triangle that the ray intersects.
+	*	@param pBoneTransforms Pose to use.
+	*	@param iBodygroup Bodygroup whose submodels are tested.
+	*	@param ray Ray to test.
+	*	@param result Output. Only changed if a triangle was found that is nearer than the current result.
+	*	@return Whether a triangle was found.
+	*/
+	bool PickMesh( const glm::mat3x4* pBoneTransforms, const int iBodygroup, const PickRay_t& ray, PickResult_t& result ) const;
+
+private:
+	struct Triangle_t
+	{
+		glm::vec3 v[ 3 ];
+
+		/**
+		*	Index of the mesh in its submodel.
+		*/
+		int iMesh;
+	};
+
+	/**
+	*	Triangle whose vertices are attached to different bones. Positions are in the reference frames of their bones.
+	*/
+	struct MixedTriangle_t
+	{
+		glm::vec3 v[ 3 ];
+		int iBones[ 3 ];
+		int iMesh;
+	};
+
+	/**
+	*	Interior nodes have a count of 0, their first child is the next node and uiFirst is the second child.
+	*	Leaf nodes reference uiCount triangles starting at uiFirst.
+	*/
+	struct Node_t
+	{
+		glm::vec3 vecMins;
+		uint32_t uiFirst;
+		glm::vec3 vecMaxs;
+		uint32_t uiCount;
+	};
+
+	struct BoneTree_t
+	{
+		int iBone;
+
+		std::vector<Node_t> nodes;
+		std::vector<Triangle_t> triangles;
+	};
+
+	struct Submodel_t
+	{
+		std::vector<BoneTree_t> trees;
+		std::vector<MixedTriangle_t> mixed;
+	};
+
+private:
+	void BuildSubmodel( const mstudiomodel_t& model, Submodel_t& submodel );
+
+	/**
+	*	Builds the subtree for a range of the tree's triangles, reordering them.
+	*	@return Index of the subtree's root node.
+	*/
+	static uint32_t BuildNode( BoneTree_t& tree, const uint32_t uiFirst, const uint32_t uiCount );
+
+	/**
+	*	@return The distance to the nearest triangle in the tree that is nearer than flMaxDistance, or flMaxDistance if none is.
+	*/
+	static float TraceTree( const BoneTree_t& tree, const PickRay_t& ray, const float flMaxDistance, int& iMesh );
+
+private:
+	const CStudioModel* const m_pModel;
+	const studiohdr_t* const m_pStudioHdr;
+
+	std::unordered_map<const mstudiomodel_t*, Submodel_t> m_Submodels;
+
+private:
+	CStudioModelPicker( const CStudioModelPicker& ) = delete;
+	CStudioModelPicker& operator=( const CStudioModelPicker& ) = delete;
+};
+
+/**
+*	Transforms a ray from world space into the space of a model that is drawn with the given origin, angles and scale.
+*	The direction is normalized again afterwards, so distances are in model units.
+*/
+PickRay_t TransformRayToModel( const glm::vec3& vecOrigin, const glm::vec3& vecDir,
+							   const glm::vec3& vecModelOrigin, const glm::vec3& vecAngles, const glm::vec3& vecScale );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOPICKING_H
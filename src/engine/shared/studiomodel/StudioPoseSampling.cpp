@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "shared/Logging.h"
+#include "shared/Profiler.h"
+#include "shared/TaskScheduler.h"
+
+#include "shared/renderer/studiomodel/CModelRenderInfo.h"
+
+#include "CStudioModel.h"
+#include "CStudioPoseContext.h"
+
+#include "StudioPoseSampling.h"
+
+namespace studiomdl
+{
+namespace
+{
+/**
+*	Same as baking pose tracks: a few chunks per thread keeps threads busy when some samples take longer than others.
+*/
+const size_t CHUNKS_PER_THREAD = 4;
+
+bool IsValidSample( const studiohdr_t& studioHdr, const PoseSample_t& sample, const size_t uiIndex )
+{
+	if( sample.iSequence < 0 || sample.iSequence >= studioHdr.numseq )
+	{
+		Error( "SamplePoses: sample %u has invalid sequence %d\n", static_cast<unsigned int>( uiIndex ), sample.iSequence );
+		return false;
+	}
+
+	if( !sample.pBoneTransforms || reinterpret_cast<uintptr_t>( sample.pBoneTransforms ) % POSE_BUFFER_ALIGNMENT != 0 )
+	{
+		Error( "SamplePoses: sample %u has no buffer, or it isn't aligned to %u bytes\n",
+			   static_cast<unsigned int>( uiIndex ), static_cast<unsigned int>( POSE_BUFFER_ALIGNMENT ) );
+		return false;
+	}
+
+	return true;
+}
+}
+
+float SequenceTimeToFrame( const mstudioseqdesc_t& seqdesc, const float flTime )
+{
+	if( seqdesc.numframes <= 1 || flTime <= 0 )
+		return 0;
+
+	const float flLastFrame = static_cast<float>( seqdesc.numframes - 1 );
+
+	const float flFrame = flTime * seqdesc.fps;
+
+	if( !( seqdesc.flags & STUDIO_LOOPING ) )
+		return std::min( flFrame, flLastFrame );
+
+	//Same wrapping as CStudioModelEntity::AdvanceFrame, the last frame is the same as the first.
+	return flFrame - std::floor( flFrame / flLastFrame ) * flLastFrame;
+}
+
+bool SamplePoses( CStudioModel& model, const PoseSample_t* pSamples, const size_t uiCount, const bool bParallel )
+{
+	PROFILE_SCOPE( "SamplePoses" );
+
+	assert( pSamples || uiCount == 0 );
+
+	const studiohdr_t* const pStudioHdr = model.GetStudioHeader();
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		if( !IsValidSample( *pStudioHdr, pSamples[ uiIndex ], uiIndex ) )
+			return false;
+	}
+
+	if( uiCount == 0 || pStudioHdr->numbones <= 0 )
+		return true;
+
+	const size_t uiTransformsSize = sizeof( glm::mat3x4 ) * pStudioHdr->numbones;
+
+	auto sampleRange = [ & ]( const size_t uiFirst, const size_t uiEnd )
+	{
+		//Too big for the stack.
+		auto context = std::make_unique<CStudioPoseContext>();
+
+		CModelRenderInfo renderInfo{};
+
+		renderInfo.pModel = &model;
+
+		for( size_t uiIndex = uiFirst; uiIndex < uiEnd; ++uiIndex )
+		{
+			const PoseSample_t& sample = pSamples[ uiIndex ];
+
+			renderInfo.iSequence = sample.iSequence;
+			renderInfo.flFrame = SequenceTimeToFrame( *pStudioHdr->GetSequence( sample.iSequence ), sample.flTime );
+
+			memcpy( renderInfo.iBlender, sample.iBlender, sizeof( renderInfo.iBlender ) );
+			memcpy( renderInfo.iController, sample.iController, sizeof( renderInfo.iController ) );
+			renderInfo.iMouth = sample.iMouth;
+
+			//Consecutive samples of the same pose, like a sequence sampled at a fixed rate that repeats frames, are only set up once.
+			if( !context->Matches( renderInfo ) )
+				context->SetUpBones( renderInfo );
+
+			memcpy( sample.pBoneTransforms, context->GetBoneTransforms(), uiTransformsSize );
+		}
+	};
+
+	if( !bParallel || tasks::GetNumThreads() == 0 )
+	{
+		sampleRange( 0, uiCount );
+		return true;
+	}
+
+	const size_t uiNumChunks = std::min( uiCount, ( tasks::GetNumThreads() + 1 ) * CHUNKS_PER_THREAD );
+
+	tasks::ParallelFor( uiNumChunks, [ & ]( const size_t uiChunk )
+	{
+		sampleRange( uiChunk * uiCount / uiNumChunks, ( uiChunk + 1 ) * uiCount / uiNumChunks );
+	}, 1, "SamplePoses" );
+
+	return true;
+}
+}
@@ -0,0 +1,67 @@
+#ifndef GAME_STUDIOMODEL_STUDIOPOSESAMPLING_H
+#define GAME_STUDIOMODEL_STUDIOPOSESAMPLING_H
+
+#include <cstddef>
+
+#include <glm/mat3x4.hpp>
+
+#include "shared/Const.h"
+
+#include "studio.h"
+
+/*
+*	Samples bone poses of models without rendering them, for tools that need poses on the CPU, like retargeting and collision baking.
+*	Poses are set up by the same code that the renderer uses, so sampled poses match what is drawn.
+*/
+
+namespace studiomdl
+{
+class CStudioModel;
+
+/**
+*	Alignment that buffers receiving bone transforms must have, so they can be read with aligned SIMD loads.
+*/
+const size_t POSE_BUFFER_ALIGNMENT = 16;
+
+/**
+*	A pose to sample, and where to store it.
+*/
+struct PoseSample_t
+{
+	int iSequence = 0;
+
+	/**
+	*	Time into the sequence, in seconds. Looping sequences wrap around, others stop at their last frame.
+	*/
+	float flTime = 0;
+
+	byte iBlender[ 2 ] = { 0, 0 };
+	byte iController[ 4 ] = { 0, 0, 0, 0 };
+	byte iMouth = 0;
+
+	/**
+	*	Receives one transform for each bone of the model, in model space. Must be aligned to POSE_BUFFER_ALIGNMENT.
+	*/
+	glm::mat3x4* pBoneTransforms = nullptr;
+};
+
+/**
+*	Converts a time into a sequence to a frame, the way entities advance their frame.
+*	@param seqdesc Sequence to convert the time of.
+*	@param flTime Time into the sequence, in seconds.
+*/
+float SequenceTimeToFrame( const mstudioseqdesc_t& seqdesc, const float flTime );
+
+/**
+*	Sets up the bones of each sample. Samples are split into chunks that are set up in parallel, each with its own pose context.
+*	Only reads model data, so different threads can sample the same model at the same time.
+*	@param model Model to pose.
+*	@param pSamples Samples to set up.
+*	@param uiCount Number of samples.
+*	@param bParallel Whether to set up samples on the task scheduler. If not, samples are set up on the calling thread.
+*	@return Whether every sample was valid. If not, no samples are set up.
+*/
+bool SamplePoses( CStudioModel& model, const PoseSample_t* pSamples, const size_t uiCount, const bool bParallel = true );
+}
+
+#endif //GAME_STUDIOMODEL_STUDIOPOSESAMPLING_H
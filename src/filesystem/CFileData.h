@@ -0,0 +1,67 @@
+#ifndef FILESYSTEM_CFILEDATA_H
+#define FILESYSTEM_CFILEDATA_H
+
+#include <cstddef>
+#include <memory>
+
+#include "shared/Const.h"
+
+/**
+*	@ingroup FileSystem
+*
+*	@{
+*/
+
+namespace filesystem
+{
+/**
+*	Read-only view of a file's contents. The data is mapped into memory; files in archives point directly into the mapped archive.
+*	Copies share the data, which stays valid until the last copy is destroyed, even if the archive is removed from the search paths.
+*/
+class CFileData final
+{
+public:
+	CFileData() = default;
+
+	/**
+	*	@param owner Object that keeps the data alive.
+	*	@param pData Start of the file's data.
+	*	@param uiSize Size of the file, in bytes.
+	*/
+	CFileData( std::shared_ptr<const void> owner, const byte* pData, const size_t uiSize )
+		: m_Owner( std::move( owner ) )
+		, m_pData( pData )
+		, m_uiSize( uiSize )
+	{
+	}
+
+	/**
+	*	@return Whether this contains a file.
+	*/
+	bool IsValid() const { return m_pData != nullptr; }
+
+	const byte* GetData() const { return m_pData; }
+
+	size_t GetSize() const { return m_uiSize; }
+
+	/**
+	*	Releases the file's data.
+	*/
+	void Clear()
+	{
+		m_Owner.reset();
+		m_pData = nullptr;
+		m_uiSize = 0;
+	}
+
+private:
+	std::shared_ptr<const void> m_Owner;
+
+	const byte* m_pData = nullptr;
+	size_t m_uiSize = 0;
+};
+}
+
+/** @} */
+
+#endif //FILESYSTEM_CFILEDATA_H
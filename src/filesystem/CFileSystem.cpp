@@ -1,14 +1,41 @@
 #include <cstring>
 #include <cstdio>
+#include <experimental/filesystem>
+
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
 
 #include "shared/Logging.h"
 #include "shared/Utility.h"
+#include "utility/CMappedFile.h"
 #include "utility/StringUtils.h"
 
 #include "CFileSystem.h"
+#include "FileSystemConstants.h"
 
 namespace filesystem
 {
+namespace
+{
+/**
+*	Extension of search paths that are archives.
+*/
+const char PACK_EXTENSION[] = ".pak";
+
+const size_t PACK_EXTENSION_LENGTH = sizeof( PACK_EXTENSION ) - 1;
+
+/**
+*	Number of threads that serve asynchronous reads. Reads spend most of their time waiting on the disk, so this doesn't depend on the number of cores.
+*/
+const size_t NUM_IO_THREADS = 4;
+
+/**
+*	Granularity at which data is touched to read it from disk. Pages are at least this large on all supported platforms.
+*/
+const size_t IO_PAGE_SIZE = 4096;
+}
+
 REGISTER_SINGLE_INTERFACE( IFILESYSTEM_NAME, CFileSystem );
 
 CFileSystem::CFileSystem()
@@ -24,11 +51,19 @@ bool CFileSystem::Initialize()
 {
 	SetBasePath( "." );
 
+	StartIOThreads();
+
 	return true;
 }
 
 void CFileSystem::Shutdown()
 {
+	UnwatchAllFiles();
+
+	m_Watcher.Stop();
+
+	StopIOThreads();
+
 	RemoveAllSearchPaths();
 }
 
@@ -62,6 +97,9 @@ void CFileSystem::SetBasePath( const char* const pszPath )
 
 	strncpy( m_szBasePath, pszPath, sizeof( m_szBasePath ) );
 	m_szBasePath[ sizeof( m_szBasePath ) - 1 ] = '\0';
+
+	//Indexes are relative to the base path.
+	InvalidatePathCache();
 }
 
 bool CFileSystem::HasSearchPath( const char* const pszPath ) const
@@ -92,7 +130,34 @@ void CFileSystem::AddSearchPath( const char* const pszPath )
 
 	path.szPath[ sizeof( path.szPath ) - 1 ] = '\0';
 
-	m_SearchPaths.push_back( path );
+	const size_t uiLength = strlen( path.szPath );
+
+	if( uiLength >= PACK_EXTENSION_LENGTH && strcasecmp( path.szPath + uiLength - PACK_EXTENSION_LENGTH, PACK_EXTENSION ) == 0 )
+	{
+		char szArchive[ MAX_PATH_LENGTH ];
+
+		const int iRet = snprintf( szArchive, sizeof( szArchive ), "%s/%s", m_szBasePath, path.szPath );
+
+		if( !PrintfSuccess( iRet, sizeof( szArchive ) ) )
+		{
+			Warning( "CFileSystem::AddSearchPath: Path to archive \"%s\" is too long\n", path.szPath );
+			return;
+		}
+
+		path.pack = std::make_unique<CPackFile>();
+
+		if( !path.pack->Open( szArchive ) )
+		{
+			Warning( "CFileSystem::AddSearchPath: Couldn't add archive \"%s\"\n", path.szPath );
+			return;
+		}
+	}
+	else if( m_bIndexSearchPaths )
+		IndexSearchPath( path );
+
+	m_SearchPaths.push_back( std::move( path ) );
+
+	ClearPathCache();
 }
 
 void CFileSystem::RemoveSearchPath( const char* const pszPath )
@@ -105,6 +170,8 @@ void CFileSystem::RemoveSearchPath( const char* const pszPath )
 		if( strcmp( ( *it ).szPath, pszPath ) == 0 )
 		{
 			m_SearchPaths.erase( it );
+
+			ClearPathCache();
 			return;
 		}
 	}
@@ -113,26 +180,52 @@ void CFileSystem::RemoveSearchPath( const char* const pszPath )
 void CFileSystem::RemoveAllSearchPaths()
 {
 	m_SearchPaths.clear();
+
+	ClearPathCache();
 }
 
-bool CFileSystem::CheckFileExists( const char* const pszCompletePath, const size_t uiLength, char* pszOutPath, size_t uiBufferSize ) const
+std::string CFileSystem::FindFile( const char* const pszFilename ) const
 {
-	if( FileExists( pszCompletePath ) )
+	char szCompletePath[ MAX_PATH_LENGTH ];
+
+	const std::string szKey = m_bIndexSearchPaths ? ToIndexKey( pszFilename ) : std::string();
+
+	for( const auto& path : m_SearchPaths )
 	{
-		//Buffer too small
-		if( uiLength >= uiBufferSize )
+		//Files in archives have no path on disk.
+		if( path.pack )
+			continue;
+
+		if( m_bIndexSearchPaths )
 		{
-			pszOutPath[ 0 ] = '\0';
-			return true;
+			auto it = path.index.find( szKey );
+
+			if( it == path.index.end() )
+				continue;
+
+			const int iRet = snprintf( szCompletePath, sizeof( szCompletePath ), "%s/%s/%s", m_szBasePath, path.szPath, it->second.c_str() );
+
+			if( PrintfSuccess( iRet, sizeof( szCompletePath ) ) )
+				return szCompletePath;
+
+			continue;
 		}
 
-		strncpy( pszOutPath, pszCompletePath, uiBufferSize );
-		pszOutPath[ uiBufferSize - 1 ] = '\0';
+		const int iRet = snprintf( szCompletePath, sizeof( szCompletePath ), "%s/%s/%s", m_szBasePath, path.szPath, pszFilename );
 
-		return true;
+		if( !PrintfSuccess( iRet, sizeof( szCompletePath ) ) )
+			continue;
+
+		if( FileExists( szCompletePath ) )
+			return szCompletePath;
 	}
 
-	return false;
+	const int iRet = snprintf( szCompletePath, sizeof( szCompletePath ), "%s/%s", m_szBasePath, pszFilename );
+
+	if( PrintfSuccess( iRet, sizeof( szCompletePath ) ) && FileExists( szCompletePath ) )
+		return szCompletePath;
+
+	return {};
 }
 
 bool CFileSystem::GetRelativePath( const char* const pszFilename, char* pszOutPath, const size_t uiBufferSize )
@@ -143,40 +236,401 @@ bool CFileSystem::GetRelativePath( const char* const pszFilename, char* pszOutPa
 	if( !pszOutPath || !uiBufferSize )
 		return false;
 
+	std::string szPath;
+
+	bool bCached = false;
+
+	{
+		std::lock_guard<std::mutex> lock( m_CacheMutex );
+
+		auto it = m_PathCache.find( pszFilename );
+
+		if( it != m_PathCache.end() )
+		{
+			szPath = it->second;
+			bCached = true;
+		}
+	}
+
+	//Probe without holding the lock so lookups from other threads aren't blocked on file access.
+	if( !bCached )
+	{
+		szPath = FindFile( pszFilename );
+
+		std::lock_guard<std::mutex> lock( m_CacheMutex );
+
+		m_PathCache.emplace( pszFilename, szPath );
+	}
+
+	if( szPath.empty() )
+		return false;
+
+	//Buffer too small
+	if( szPath.length() >= uiBufferSize )
+	{
+		pszOutPath[ 0 ] = '\0';
+		return true;
+	}
+
+	strncpy( pszOutPath, szPath.c_str(), uiBufferSize );
+	pszOutPath[ uiBufferSize - 1 ] = '\0';
+
+	return true;
+}
+
+bool CFileSystem::ReadFile( const char* const pszFilename, CFileData& data )
+{
+	data.Clear();
+
+	if( !pszFilename || !( *pszFilename ) )
+		return false;
+
+	//Files chosen in file dialogs are given as full paths.
+	if( FileExists( pszFilename ) )
+		return MapFile( pszFilename, data );
+
 	char szCompletePath[ MAX_PATH_LENGTH ];
 
+	const std::string szKey = ToIndexKey( pszFilename );
+
 	for( const auto& path : m_SearchPaths )
 	{
-		const int iRet = snprintf( szCompletePath, sizeof( szCompletePath ), "%s/%s/%s", m_szBasePath, path.szPath, pszFilename );
+		if( path.pack )
+		{
+			if( path.pack->Find( szKey, data ) )
+				return true;
 
-		if( !PrintfSuccess( iRet, sizeof( szCompletePath ) ) )
 			continue;
+		}
 
-		if( FileExists( szCompletePath ) )
+		int iRet;
+
+		if( m_bIndexSearchPaths )
 		{
-			//Buffer too small
-			if( static_cast<size_t>( iRet ) >= uiBufferSize )
-			{
-				pszOutPath[ 0 ] = '\0';
-				return true;
-			}
+			auto it = path.index.find( szKey );
 
-			strncpy( pszOutPath, szCompletePath, uiBufferSize );
-			pszOutPath[ uiBufferSize - 1 ] = '\0';
+			if( it == path.index.end() )
+				continue;
 
-			return true;
+			iRet = snprintf( szCompletePath, sizeof( szCompletePath ), "%s/%s/%s", m_szBasePath, path.szPath, it->second.c_str() );
+		}
+		else
+		{
+			iRet = snprintf( szCompletePath, sizeof( szCompletePath ), "%s/%s/%s", m_szBasePath, path.szPath, pszFilename );
 		}
 
-		if( CheckFileExists( szCompletePath, static_cast<size_t>( iRet ), pszOutPath, uiBufferSize ) )
-			return true;
+		if( PrintfSuccess( iRet, sizeof( szCompletePath ) ) && FileExists( szCompletePath ) )
+			return MapFile( szCompletePath, data );
 	}
 
 	const int iRet = snprintf( szCompletePath, sizeof( szCompletePath ), "%s/%s", m_szBasePath, pszFilename );
 
-	if( !PrintfSuccess( iRet, sizeof( szCompletePath ) ) )
+	if( PrintfSuccess( iRet, sizeof( szCompletePath ) ) && FileExists( szCompletePath ) )
+		return MapFile( szCompletePath, data );
+
+	return false;
+}
+
+bool CFileSystem::MapFile( const char* const pszFilename, CFileData& data )
+{
+	auto file = std::make_shared<CMappedFile>();
+
+	if( !file->Open( pszFilename ) )
 		return false;
 
-	return CheckFileExists( szCompletePath, static_cast<size_t>( iRet ), pszOutPath, uiBufferSize );
+	const byte* pData = reinterpret_cast<const byte*>( file->GetData() );
+	const size_t uiSize = file->GetSize();
+
+	data = CFileData( std::move( file ), pData, uiSize );
+
+	return true;
+}
+
+std::future<CFileData> CFileSystem::ReadFileAsync( const char* const pszFilename )
+{
+	ReadRequest_t request;
+
+	request.szFilename = pszFilename ? pszFilename : "";
+
+	auto future = request.promise.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock( m_IOMutex );
+
+		if( !m_IOThreads.empty() )
+		{
+			m_IORequests.push_back( std::move( request ) );
+			m_IOCondition.notify_one();
+
+			return future;
+		}
+	}
+
+	//Not initialized or already shut down, read on this thread.
+	CFileData data;
+
+	ReadFile( request.szFilename.c_str(), data );
+
+	request.promise.set_value( std::move( data ) );
+
+	return future;
+}
+
+void CFileSystem::StartIOThreads()
+{
+	std::lock_guard<std::mutex> lock( m_IOMutex );
+
+	if( !m_IOThreads.empty() )
+		return;
+
+	m_bIOQuit = false;
+
+	for( size_t uiIndex = 0; uiIndex < NUM_IO_THREADS; ++uiIndex )
+	{
+		m_IOThreads.emplace_back( &CFileSystem::IOThreadMain, this );
+	}
+}
+
+void CFileSystem::StopIOThreads()
+{
+	std::vector<std::thread> threads;
+	std::deque<ReadRequest_t> requests;
+
+	{
+		std::lock_guard<std::mutex> lock( m_IOMutex );
+
+		m_bIOQuit = true;
+
+		threads.swap( m_IOThreads );
+		requests.swap( m_IORequests );
+	}
+
+	m_IOCondition.notify_all();
+
+	for( auto& request : requests )
+	{
+		request.promise.set_value( CFileData() );
+	}
+
+	for( auto& thread : threads )
+	{
+		thread.join();
+	}
+}
+
+void CFileSystem::IOThreadMain()
+{
+	while( true )
+	{
+		ReadRequest_t request;
+
+		{
+			std::unique_lock<std::mutex> lock( m_IOMutex );
+
+			m_IOCondition.wait( lock, [ this ]() { return m_bIOQuit || !m_IORequests.empty(); } );
+
+			if( m_bIOQuit )
+				return;
+
+			request = std::move( m_IORequests.front() );
+			m_IORequests.pop_front();
+		}
+
+		CFileData data;
+
+		if( ReadFile( request.szFilename.c_str(), data ) )
+		{
+			//Mapped data is only read from disk when it's accessed, so touch every page here instead of on the thread that uses it.
+			volatile byte uiSum = 0;
+
+			for( size_t uiOffset = 0; uiOffset < data.GetSize(); uiOffset += IO_PAGE_SIZE )
+			{
+				uiSum += data.GetData()[ uiOffset ];
+			}
+		}
+
+		request.promise.set_value( std::move( data ) );
+	}
+}
+
+std::string CFileSystem::GetWatchPath( const char* const pszFilename )
+{
+	namespace fs = std::experimental::filesystem;
+
+	if( !pszFilename || !( *pszFilename ) )
+		return {};
+
+	std::string szPath;
+
+	if( FileExists( pszFilename ) )
+	{
+		szPath = pszFilename;
+	}
+	else
+	{
+		char szRelativePath[ MAX_PATH_LENGTH ];
+
+		if( !GetRelativePath( pszFilename, szRelativePath, sizeof( szRelativePath ) ) || !( *szRelativePath ) )
+			return {};
+
+		szPath = szRelativePath;
+	}
+
+	std::error_code error;
+
+	//Use the same form the watcher reports so changes can be matched.
+	const fs::path path = fs::canonical( szPath, error );
+
+	if( error )
+		return {};
+
+	return path.generic_string();
+}
+
+bool CFileSystem::WatchFile( const char* const pszFilename )
+{
+	namespace fs = std::experimental::filesystem;
+
+	const std::string szPath = GetWatchPath( pszFilename );
+
+	if( szPath.empty() )
+		return false;
+
+	if( m_WatchedFiles.find( szPath ) != m_WatchedFiles.end() )
+		return true;
+
+	if( !m_Watcher.Start() )
+		return false;
+
+	const std::string szDirectory = fs::path( szPath ).parent_path().generic_string();
+
+	auto it = m_WatchedDirectories.find( szDirectory );
+
+	if( it == m_WatchedDirectories.end() )
+	{
+		if( !m_Watcher.WatchDirectory( szDirectory ) )
+		{
+			Warning( "CFileSystem::WatchFile: Couldn't watch directory \"%s\"\n", szDirectory.c_str() );
+			return false;
+		}
+
+		it = m_WatchedDirectories.emplace( szDirectory, 0 ).first;
+	}
+
+	++it->second;
+
+	m_WatchedFiles.emplace( szPath );
+
+	return true;
+}
+
+void CFileSystem::UnwatchFile( const char* const pszFilename )
+{
+	namespace fs = std::experimental::filesystem;
+
+	const std::string szPath = GetWatchPath( pszFilename );
+
+	auto file = m_WatchedFiles.find( szPath );
+
+	if( file == m_WatchedFiles.end() )
+		return;
+
+	m_WatchedFiles.erase( file );
+
+	const std::string szDirectory = fs::path( szPath ).parent_path().generic_string();
+
+	auto it = m_WatchedDirectories.find( szDirectory );
+
+	if( it != m_WatchedDirectories.end() && --it->second == 0 )
+	{
+		m_Watcher.UnwatchDirectory( szDirectory );
+		m_WatchedDirectories.erase( it );
+	}
+}
+
+void CFileSystem::UnwatchAllFiles()
+{
+	for( const auto& directory : m_WatchedDirectories )
+	{
+		m_Watcher.UnwatchDirectory( directory.first );
+	}
+
+	m_WatchedDirectories.clear();
+	m_WatchedFiles.clear();
+}
+
+void CFileSystem::GetFileChanges( std::vector<std::string>& changes )
+{
+	if( !m_Watcher.IsRunning() )
+		return;
+
+	std::vector<std::string> changedFiles;
+
+	m_Watcher.GetChanges( changedFiles );
+
+	for( const auto& szPath : changedFiles )
+	{
+		OnFileChanged( szPath );
+
+		if( m_WatchedFiles.find( szPath ) != m_WatchedFiles.end() )
+			changes.push_back( szPath );
+	}
+}
+
+void CFileSystem::OnFileChanged( const std::string& szPath )
+{
+	namespace fs = std::experimental::filesystem;
+
+	const std::string szKey = ToIndexKey( szPath );
+
+	//Only entries for files with this name have to be found again. Entries for other files with the same name in other directories are invalidated as well.
+	{
+		std::lock_guard<std::mutex> lock( m_CacheMutex );
+
+		for( auto it = m_PathCache.begin(); it != m_PathCache.end(); )
+		{
+			const std::string szEntryKey = ToIndexKey( it->first );
+
+			const bool bMatches = szEntryKey.length() < szKey.length() &&
+				szKey.compare( szKey.length() - szEntryKey.length(), szEntryKey.length(), szEntryKey ) == 0 &&
+				szKey[ szKey.length() - szEntryKey.length() - 1 ] == '/';
+
+			if( bMatches )
+				it = m_PathCache.erase( it );
+			else
+				++it;
+		}
+	}
+
+	if( !m_bIndexSearchPaths )
+		return;
+
+	const bool bExists = FileExists( szPath.c_str() );
+
+	for( auto& path : m_SearchPaths )
+	{
+		if( path.pack )
+			continue;
+
+		std::error_code error;
+
+		const fs::path root = fs::canonical( fs::path( m_szBasePath ) / path.szPath, error );
+
+		if( error )
+			continue;
+
+		const std::string szRoot = root.generic_string() + '/';
+
+		if( szKey.compare( 0, szRoot.length(), ToIndexKey( szRoot ) ) != 0 )
+			continue;
+
+		const std::string szRelativePath = szPath.substr( szRoot.length() );
+
+		if( bExists )
+			path.index.emplace( ToIndexKey( szRelativePath ), szRelativePath );
+		else
+			path.index.erase( ToIndexKey( szRelativePath ) );
+	}
 }
 
 bool CFileSystem::FileExists( const char* const pszFilename ) const
@@ -184,13 +638,87 @@ bool CFileSystem::FileExists( const char* const pszFilename ) const
 	if( !pszFilename || !( *pszFilename ) )
 		return false;
 
-	if( FILE* pFile = fopen( pszFilename, "r" ) )
+#ifdef WIN32
+	const DWORD attributes = GetFileAttributesA( pszFilename );
+
+	return attributes != INVALID_FILE_ATTRIBUTES && !( attributes & FILE_ATTRIBUTE_DIRECTORY );
+#else
+	struct stat info;
+
+	return stat( pszFilename, &info ) == 0 && S_ISREG( info.st_mode );
+#endif
+}
+
+void CFileSystem::InvalidatePathCache()
+{
+	if( m_bIndexSearchPaths )
 	{
-		fclose( pFile );
+		for( auto& path : m_SearchPaths )
+		{
+			IndexSearchPath( path );
+		}
+	}
 
-		return true;
+	ClearPathCache();
+}
+
+void CFileSystem::SetSearchPathIndexing( const bool bIndex )
+{
+	if( m_bIndexSearchPaths == bIndex )
+		return;
+
+	m_bIndexSearchPaths = bIndex;
+
+	for( auto& path : m_SearchPaths )
+	{
+		if( m_bIndexSearchPaths )
+		{
+			IndexSearchPath( path );
+		}
+		else
+		{
+			path.index.clear();
+		}
 	}
 
-	return false;
+	ClearPathCache();
+}
+
+void CFileSystem::ClearPathCache()
+{
+	std::lock_guard<std::mutex> lock( m_CacheMutex );
+
+	m_PathCache.clear();
+}
+
+void CFileSystem::IndexSearchPath( SearchPath_t& path ) const
+{
+	namespace fs = std::experimental::filesystem;
+
+	path.index.clear();
+
+	if( path.pack )
+		return;
+
+	const fs::path root = fs::path( m_szBasePath ) / path.szPath;
+
+	std::string szRoot = root.generic_string();
+
+	if( !szRoot.empty() && szRoot.back() != '/' )
+		szRoot += '/';
+
+	std::error_code error;
+
+	//Search paths that don't exist are common (e.g. SteamPipe directories), they just have no files.
+	for( fs::recursive_directory_iterator it( root, error ), end; !error && it != end; it.increment( error ) )
+	{
+		if( !fs::is_regular_file( it->status() ) )
+			continue;
+
+		const std::string szRelativePath = it->path().generic_string().substr( szRoot.length() );
+
+		//Keep the first match if several files only differ in case.
+		path.index.emplace( ToIndexKey( szRelativePath ), szRelativePath );
+	}
 }
 }
\ No newline at end of file
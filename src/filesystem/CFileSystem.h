@@ -1,10 +1,20 @@
 #ifndef FILESYSTEM_CFILESYSTEM_H
 #define FILESYSTEM_CFILESYSTEM_H
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "shared/Platform.h"
 
+#include "CFileWatcher.h"
+#include "CPackFile.h"
 #include "IFileSystem.h"
 
 /**
@@ -18,13 +28,39 @@ namespace filesystem
 class CFileSystem final : public IFileSystem
 {
 private:
+	/**
+	*	Maps lowercase paths of files in a search path, relative to the search path, to the actual paths.
+	*/
+	typedef std::unordered_map<std::string, std::string> SearchPathIndex_t;
+
 	struct SearchPath_t
 	{
 		char szPath[ MAX_PATH_LENGTH ];
+
+		/**
+		*	Files in this search path. Only used if search paths are indexed.
+		*/
+		SearchPathIndex_t index;
+
+		/**
+		*	If this search path is an archive, the archive. Archives are never indexed.
+		*/
+		std::unique_ptr<CPackFile> pack;
 	};
 
 	typedef std::vector<SearchPath_t> SearchPaths_t;
 
+	/**
+	*	Maps file names passed to GetRelativePath to the path they resolved to. Files that weren't found map to an empty string.
+	*/
+	typedef std::unordered_map<std::string, std::string> PathCache_t;
+
+	struct ReadRequest_t
+	{
+		std::string szFilename;
+		std::promise<CFileData> promise;
+	};
+
 public:
 	CFileSystem();
 	~CFileSystem();
@@ -51,16 +87,105 @@ public:
 
 	bool GetRelativePath( const char* const pszFilename, char* pszOutPath, const size_t uiBufferSize ) override final;
 
+	bool ReadFile( const char* const pszFilename, CFileData& data ) override final;
+
+	std::future<CFileData> ReadFileAsync( const char* const pszFilename ) override final;
+
 	bool FileExists( const char* const pszFilename ) const override final;
 
+	void InvalidatePathCache() override final;
+
+	bool IsSearchPathIndexing() const override final { return m_bIndexSearchPaths; }
+
+	void SetSearchPathIndexing( const bool bIndex ) override final;
+
+	bool WatchFile( const char* const pszFilename ) override final;
+
+	void UnwatchFile( const char* const pszFilename ) override final;
+
+	void UnwatchAllFiles() override final;
+
+	void GetFileChanges( std::vector<std::string>& changes ) override final;
+
 private:
-	bool CheckFileExists( const char* const pszCompletePath, const size_t uiLength, char* pszOutPath, size_t uiBufferSize ) const;
+	void ClearPathCache();
+
+	/**
+	*	Enumerates all files in the given search path.
+	*/
+	void IndexSearchPath( SearchPath_t& path ) const;
+
+	/**
+	*	Maps a file on disk into memory.
+	*/
+	static bool MapFile( const char* const pszFilename, CFileData& data );
+
+	void StartIOThreads();
+
+	/**
+	*	Stops the I/O threads. Requests that haven't been started yet complete without data.
+	*/
+	void StopIOThreads();
+
+	void IOThreadMain();
+
+	/**
+	*	Gets the absolute path of a file to watch.
+	*	@return The path, or an empty string if the file doesn't exist.
+	*/
+	std::string GetWatchPath( const char* const pszFilename );
+
+	/**
+	*	Invalidates cached paths and updates indexes after a file changed.
+	*	@param szPath Absolute path to the file.
+	*/
+	void OnFileChanged( const std::string& szPath );
+
+	/**
+	*	Finds the path to a file by probing every search path.
+	*	@return The path to the file, or an empty string if it doesn't exist.
+	*/
+	std::string FindFile( const char* const pszFilename ) const;
 
 private:
 	char m_szBasePath[ MAX_PATH_LENGTH ];
 
 	SearchPaths_t m_SearchPaths;
 
+	bool m_bIndexSearchPaths = false;
+
+	/**
+	*	Guards m_PathCache. GetRelativePath can be called from worker threads.
+	*/
+	std::mutex m_CacheMutex;
+
+	PathCache_t m_PathCache;
+
+	std::vector<std::thread> m_IOThreads;
+
+	/**
+	*	Guards the members below.
+	*/
+	std::mutex m_IOMutex;
+
+	std::condition_variable m_IOCondition;
+
+	std::deque<ReadRequest_t> m_IORequests;
+
+	bool m_bIOQuit = false;
+
+	CFileWatcher m_Watcher;
+
+	/**
+	*	Absolute paths of watched files.
+	*/
+	std::unordered_set<std::string> m_WatchedFiles;
+
+	/**
+	*	Number of watched files in each watched directory.
+	*/
+	std::unordered_map<std::string, size_t> m_WatchedDirectories;
+
 private:
 	CFileSystem( const CFileSystem& ) = delete;
 	CFileSystem& operator=( const CFileSystem& ) = delete;
@@ -0,0 +1,448 @@
+#include <cstring>
+#include <memory>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "shared/Logging.h"
+
+#include "CFileWatcher.h"
+
+namespace filesystem
+{
+CFileWatcher::~CFileWatcher()
+{
+	Stop();
+}
+
+void CFileWatcher::AddChange( const std::string& szDirectory, const std::string& szFilename )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Changes.emplace( szDirectory + '/' + szFilename );
+}
+
+void CFileWatcher::GetChanges( std::vector<std::string>& changes )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	changes.reserve( changes.size() + m_Changes.size() );
+
+	for( const auto& szChange : m_Changes )
+	{
+		changes.push_back( szChange );
+	}
+
+	m_Changes.clear();
+}
+
+#ifdef WIN32
+namespace
+{
+std::wstring ToWide( const std::string& szString )
+{
+	const int iLength = MultiByteToWideChar( CP_UTF8, 0, szString.c_str(), -1, nullptr, 0 );
+
+	if( iLength <= 0 )
+		return {};
+
+	std::wstring szWide( iLength - 1, L'\0' );
+
+	MultiByteToWideChar( CP_UTF8, 0, szString.c_str(), -1, &szWide[ 0 ], iLength );
+
+	return szWide;
+}
+
+std::string ToUTF8( const wchar_t* pszString, const int iLength )
+{
+	const int iSize = WideCharToMultiByte( CP_UTF8, 0, pszString, iLength, nullptr, 0, nullptr, nullptr );
+
+	if( iSize <= 0 )
+		return {};
+
+	std::string szString( iSize, '\0' );
+
+	WideCharToMultiByte( CP_UTF8, 0, pszString, iLength, &szString[ 0 ], iSize, nullptr, nullptr );
+
+	//Use the same separators as the paths that are watched.
+	for( auto& c : szString )
+	{
+		if( c == '\\' )
+			c = '/';
+	}
+
+	return szString;
+}
+
+const DWORD NOTIFY_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+}
+
+bool CFileWatcher::Start()
+{
+	if( IsRunning() )
+		return true;
+
+	m_hWakeEvent = CreateEventA( nullptr, FALSE, FALSE, nullptr );
+
+	if( !m_hWakeEvent )
+	{
+		Error( "CFileWatcher::Start: Couldn't create event\n" );
+		return false;
+	}
+
+	m_bQuit = false;
+
+	m_Thread = std::thread( &CFileWatcher::ThreadMain, this );
+
+	return true;
+}
+
+void CFileWatcher::Stop()
+{
+	if( !IsRunning() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bQuit = true;
+		m_Directories.clear();
+		m_Changes.clear();
+	}
+
+	SetEvent( m_hWakeEvent );
+
+	m_Thread.join();
+
+	CloseHandle( m_hWakeEvent );
+	m_hWakeEvent = nullptr;
+}
+
+bool CFileWatcher::WatchDirectory( const std::string& szDirectory )
+{
+	if( !IsRunning() )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_Directories.emplace( szDirectory );
+	}
+
+	SetEvent( m_hWakeEvent );
+
+	return true;
+}
+
+void CFileWatcher::UnwatchDirectory( const std::string& szDirectory )
+{
+	if( !IsRunning() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_Directories.erase( szDirectory );
+	}
+
+	SetEvent( m_hWakeEvent );
+}
+
+void CFileWatcher::ThreadMain()
+{
+	std::vector<std::unique_ptr<Directory_t>> directories;
+
+	auto closeDirectory = []( Directory_t& directory )
+	{
+		if( directory.bPending )
+		{
+			CancelIo( directory.hDirectory );
+
+			//Wait for the cancelled read to finish before the buffer is freed.
+			DWORD dwBytes;
+			GetOverlappedResult( directory.hDirectory, &directory.overlapped, &dwBytes, TRUE );
+		}
+
+		CloseHandle( directory.overlapped.hEvent );
+		CloseHandle( directory.hDirectory );
+	};
+
+	auto issueRead = []( Directory_t& directory )
+	{
+		directory.bPending = ReadDirectoryChangesW( directory.hDirectory, directory.buffer, sizeof( directory.buffer ), FALSE,
+			NOTIFY_FILTER, nullptr, &directory.overlapped, nullptr ) != FALSE;
+
+		return directory.bPending;
+	};
+
+	std::vector<HANDLE> handles;
+
+	while( true )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			if( m_bQuit )
+				break;
+
+			//Close directories that are no longer watched.
+			for( auto it = directories.begin(); it != directories.end(); )
+			{
+				if( m_Directories.find( ( *it )->szPath ) == m_Directories.end() )
+				{
+					closeDirectory( **it );
+					it = directories.erase( it );
+				}
+				else
+					++it;
+			}
+
+			//Open new directories.
+			for( const auto& szPath : m_Directories )
+			{
+				bool bOpen = false;
+
+				for( const auto& directory : directories )
+				{
+					if( directory->szPath == szPath )
+					{
+						bOpen = true;
+						break;
+					}
+				}
+
+				if( bOpen )
+					continue;
+
+				//One handle is used for the wake event.
+				if( directories.size() + 1 >= MAXIMUM_WAIT_OBJECTS )
+				{
+					Warning( "CFileWatcher: Too many directories watched, not watching \"%s\"\n", szPath.c_str() );
+					continue;
+				}
+
+				auto directory = std::make_unique<Directory_t>();
+
+				directory->szPath = szPath;
+
+				directory->hDirectory = CreateFileW( ToWide( szPath ).c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+					nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr );
+
+				if( directory->hDirectory == INVALID_HANDLE_VALUE )
+					continue;
+
+				memset( &directory->overlapped, 0, sizeof( directory->overlapped ) );
+
+				directory->overlapped.hEvent = CreateEventA( nullptr, TRUE, FALSE, nullptr );
+
+				if( !directory->overlapped.hEvent || !issueRead( *directory ) )
+				{
+					if( directory->overlapped.hEvent )
+						CloseHandle( directory->overlapped.hEvent );
+
+					CloseHandle( directory->hDirectory );
+					continue;
+				}
+
+				directories.push_back( std::move( directory ) );
+			}
+		}
+
+		handles.clear();
+		handles.push_back( m_hWakeEvent );
+
+		for( const auto& directory : directories )
+		{
+			handles.push_back( directory->overlapped.hEvent );
+		}
+
+		const DWORD dwResult = WaitForMultipleObjects( static_cast<DWORD>( handles.size() ), handles.data(), FALSE, INFINITE );
+
+		if( dwResult < WAIT_OBJECT_0 + 1 || dwResult >= WAIT_OBJECT_0 + handles.size() )
+			continue;
+
+		Directory_t& directory = *directories[ dwResult - WAIT_OBJECT_0 - 1 ];
+
+		directory.bPending = false;
+
+		DWORD dwBytes = 0;
+
+		if( GetOverlappedResult( directory.hDirectory, &directory.overlapped, &dwBytes, FALSE ) && dwBytes > 0 )
+		{
+			const char* pData = directory.buffer;
+
+			while( true )
+			{
+				const FILE_NOTIFY_INFORMATION* pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>( pData );
+
+				AddChange( directory.szPath, ToUTF8( pInfo->FileName, static_cast<int>( pInfo->FileNameLength / sizeof( wchar_t ) ) ) );
+
+				if( !pInfo->NextEntryOffset )
+					break;
+
+				pData += pInfo->NextEntryOffset;
+			}
+		}
+
+		ResetEvent( directory.overlapped.hEvent );
+
+		//If the read can't be reissued the directory is gone; it stays closed until it's watched again.
+		if( !issueRead( directory ) )
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			m_Directories.erase( directory.szPath );
+		}
+	}
+
+	for( auto& directory : directories )
+	{
+		closeDirectory( *directory );
+	}
+}
+#else
+bool CFileWatcher::Start()
+{
+	if( IsRunning() )
+		return true;
+
+	m_iNotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+
+	if( m_iNotifyFD == -1 )
+	{
+		Error( "CFileWatcher::Start: Couldn't initialize inotify\n" );
+		return false;
+	}
+
+	if( pipe2( m_WakeFDs, O_NONBLOCK | O_CLOEXEC ) == -1 )
+	{
+		Error( "CFileWatcher::Start: Couldn't create pipe\n" );
+
+		close( m_iNotifyFD );
+		m_iNotifyFD = -1;
+		return false;
+	}
+
+	m_Thread = std::thread( &CFileWatcher::ThreadMain, this );
+
+	return true;
+}
+
+void CFileWatcher::Stop()
+{
+	if( !IsRunning() )
+		return;
+
+	const char wake = 0;
+
+	write( m_WakeFDs[ 1 ], &wake, sizeof( wake ) );
+
+	m_Thread.join();
+
+	//Closing the descriptor removes all watches.
+	close( m_iNotifyFD );
+	m_iNotifyFD = -1;
+
+	close( m_WakeFDs[ 0 ] );
+	close( m_WakeFDs[ 1 ] );
+	m_WakeFDs[ 0 ] = m_WakeFDs[ 1 ] = -1;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Watches.clear();
+	m_Changes.clear();
+}
+
+bool CFileWatcher::WatchDirectory( const std::string& szDirectory )
+{
+	if( !IsRunning() )
+		return false;
+
+	const int iWatch = inotify_add_watch( m_iNotifyFD, szDirectory.c_str(), IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR );
+
+	if( iWatch == -1 )
+		return false;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Watches[ iWatch ] = szDirectory;
+
+	return true;
+}
+
+void CFileWatcher::UnwatchDirectory( const std::string& szDirectory )
+{
+	if( !IsRunning() )
+		return;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( auto it = m_Watches.begin(); it != m_Watches.end(); ++it )
+	{
+		if( it->second == szDirectory )
+		{
+			inotify_rm_watch( m_iNotifyFD, it->first );
+			m_Watches.erase( it );
+			return;
+		}
+	}
+}
+
+void CFileWatcher::ThreadMain()
+{
+	alignas( inotify_event ) char buffer[ 16384 ];
+
+	pollfd fds[ 2 ] =
+	{
+		{ m_iNotifyFD, POLLIN, 0 },
+		{ m_WakeFDs[ 0 ], POLLIN, 0 }
+	};
+
+	while( true )
+	{
+		if( poll( fds, 2, -1 ) == -1 )
+			continue;
+
+		if( fds[ 1 ].revents )
+			break;
+
+		if( !( fds[ 0 ].revents & POLLIN ) )
+			continue;
+
+		ssize_t iRead;
+
+		while( ( iRead = read( m_iNotifyFD, buffer, sizeof( buffer ) ) ) > 0 )
+		{
+			for( const char* pData = buffer; pData < buffer + iRead; )
+			{
+				const inotify_event* pEvent = reinterpret_cast<const inotify_event*>( pData );
+
+				pData += sizeof( inotify_event ) + pEvent->len;
+
+				if( !pEvent->len || ( pEvent->mask & IN_ISDIR ) )
+					continue;
+
+				std::string szDirectory;
+
+				{
+					std::lock_guard<std::mutex> lock( m_Mutex );
+
+					auto it = m_Watches.find( pEvent->wd );
+
+					if( it == m_Watches.end() )
+						continue;
+
+					szDirectory = it->second;
+				}
+
+				AddChange( szDirectory, pEvent->name );
+			}
+		}
+	}
+}
+#endif
+}
@@ -0,0 +1,128 @@
+#ifndef FILESYSTEM_CFILEWATCHER_H
+#define FILESYSTEM_CFILEWATCHER_H
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "shared/Platform.h"
+
+/**
+*	@ingroup FileSystem
+*
+*	@{
+*/
+
+namespace filesystem
+{
+/**
+*	Watches directories for changes to the files in them, on a background thread.
+*	Uses inotify on Linux and ReadDirectoryChangesW on Windows. Subdirectories are not watched.
+*/
+class CFileWatcher final
+{
+public:
+	CFileWatcher() = default;
+	~CFileWatcher();
+
+	/**
+	*	@return Whether the watcher is running.
+	*/
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	/**
+	*	Starts the watcher thread. Does nothing if it's already running.
+	*	@return Whether the watcher is running.
+	*/
+	bool Start();
+
+	/**
+	*	Stops the watcher thread and stops watching all directories.
+	*/
+	void Stop();
+
+	/**
+	*	Starts watching a directory.
+	*	@param szDirectory Absolute path to the directory, with forward slashes and no trailing slash.
+	*	@return Whether the directory is being watched.
+	*/
+	bool WatchDirectory( const std::string& szDirectory );
+
+	/**
+	*	Stops watching a directory.
+	*/
+	void UnwatchDirectory( const std::string& szDirectory );
+
+	/**
+	*	Gets the files that were created, modified, deleted or renamed since the last call. Each file is listed once.
+	*	@param changes Absolute paths of changed files are added to this list.
+	*/
+	void GetChanges( std::vector<std::string>& changes );
+
+private:
+	void ThreadMain();
+
+	void AddChange( const std::string& szDirectory, const std::string& szFilename );
+
+private:
+	std::thread m_Thread;
+
+	/**
+	*	Guards the members below.
+	*/
+	std::mutex m_Mutex;
+
+	std::unordered_set<std::string> m_Changes;
+
+#ifdef WIN32
+	struct Directory_t
+	{
+		std::string szPath;
+		HANDLE hDirectory = INVALID_HANDLE_VALUE;
+		OVERLAPPED overlapped;
+
+		/**
+		*	Whether a read has been issued that hasn't completed yet.
+		*/
+		bool bPending = false;
+
+		alignas( DWORD ) char buffer[ 16384 ];
+	};
+
+	/**
+	*	Directories that should be watched. The thread opens and closes directories to match.
+	*/
+	std::unordered_set<std::string> m_Directories;
+
+	/**
+	*	Signaled when the thread should exit, or when directories were added or removed.
+	*/
+	HANDLE m_hWakeEvent = nullptr;
+
+	bool m_bQuit = false;
+#else
+	int m_iNotifyFD = -1;
+
+	/**
+	*	Pipe used to wake the thread when it should exit.
+	*/
+	int m_WakeFDs[ 2 ] = { -1, -1 };
+
+	/**
+	*	Maps inotify watch descriptors to directories.
+	*/
+	std::unordered_map<int, std::string> m_Watches;
+#endif
+
+private:
+	CFileWatcher( const CFileWatcher& ) = delete;
+	CFileWatcher& operator=( const CFileWatcher& ) = delete;
+};
+}
+
+/** @} */
+
+#endif //FILESYSTEM_CFILEWATCHER_H
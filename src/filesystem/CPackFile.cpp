@@ -0,0 +1,104 @@
+#include <cstring>
+
+#include "shared/Logging.h"
+
+#include "utility/ByteSwap.h"
+#include "utility/CMappedFile.h"
+
+#include "CPackFile.h"
+#include "FileSystemConstants.h"
+
+namespace filesystem
+{
+bool CPackFile::Open( const char* const pszFilename )
+{
+	m_File.reset();
+	m_Entries.clear();
+
+	auto file = std::make_shared<CMappedFile>();
+
+	if( !file->Open( pszFilename ) )
+	{
+		Error( "CPackFile::Open: Couldn't open archive \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	const size_t uiSize = file->GetSize();
+	const byte* pData = reinterpret_cast<const byte*>( file->GetData() );
+
+	if( uiSize < sizeof( dpackheader_t ) )
+	{
+		Error( "CPackFile::Open: \"%s\" is too small to be an archive\n", pszFilename );
+		return false;
+	}
+
+	dpackheader_t header;
+
+	memcpy( &header, pData, sizeof( header ) );
+
+	if( LittleValue( header.ident ) != PACK_ID )
+	{
+		Error( "CPackFile::Open: \"%s\" is not a PAK archive\n", pszFilename );
+		return false;
+	}
+
+	const int iDirOffset = LittleValue( header.dirofs );
+	const int iDirLength = LittleValue( header.dirlen );
+
+	if( iDirOffset < 0 || iDirLength < 0 ||
+		static_cast<size_t>( iDirOffset ) > uiSize ||
+		static_cast<size_t>( iDirLength ) > uiSize - iDirOffset ||
+		( iDirLength % sizeof( dpackfile_t ) ) != 0 )
+	{
+		Error( "CPackFile::Open: \"%s\" has an invalid directory\n", pszFilename );
+		return false;
+	}
+
+	const size_t uiNumFiles = iDirLength / sizeof( dpackfile_t );
+
+	m_Entries.reserve( uiNumFiles );
+
+	dpackfile_t entry;
+
+	for( size_t uiIndex = 0; uiIndex < uiNumFiles; ++uiIndex )
+	{
+		//The directory isn't guaranteed to be aligned.
+		memcpy( &entry, pData + iDirOffset + uiIndex * sizeof( dpackfile_t ), sizeof( entry ) );
+
+		const int iFilePos = LittleValue( entry.filepos );
+		const int iFileLen = LittleValue( entry.filelen );
+
+		if( iFilePos < 0 || iFileLen < 0 ||
+			static_cast<size_t>( iFilePos ) > uiSize ||
+			static_cast<size_t>( iFileLen ) > uiSize - iFilePos )
+		{
+			Error( "CPackFile::Open: \"%s\" has an entry outside the archive\n", pszFilename );
+			m_Entries.clear();
+			return false;
+		}
+
+		entry.name[ sizeof( entry.name ) - 1 ] = '\0';
+
+		//Like the engine, the first entry with a given name is used.
+		m_Entries.emplace( ToIndexKey( entry.name ), Entry_t{ static_cast<size_t>( iFilePos ), static_cast<size_t>( iFileLen ) } );
+	}
+
+	m_File = std::move( file );
+
+	return true;
+}
+
+bool CPackFile::Find( const std::string& szKey, CFileData& data ) const
+{
+	auto it = m_Entries.find( szKey );
+
+	if( it == m_Entries.end() )
+		return false;
+
+	const byte* pData = reinterpret_cast<const byte*>( m_File->GetData() );
+
+	data = CFileData( m_File, pData + it->second.uiOffset, it->second.uiSize );
+
+	return true;
+}
+}
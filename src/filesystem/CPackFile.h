@@ -0,0 +1,117 @@
+#ifndef FILESYSTEM_CPACKFILE_H
+#define FILESYSTEM_CPACKFILE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "CFileData.h"
+
+class CMappedFile;
+
+/**
+*	@ingroup FileSystem
+*
+*	@{
+*/
+
+namespace filesystem
+{
+/**
+*	Identifier of PAK archives.
+*/
+#define PACK_ID (('K'<<24)+('C'<<16)+('A'<<8)+'P')
+
+/**
+*	Maximum length of a file name in a PAK archive, including the null terminator.
+*/
+const size_t MAX_PACK_FILENAME = 56;
+
+/**
+*	PAK archive header.
+*/
+struct dpackheader_t final
+{
+	/**
+	*	Must be PACK_ID.
+	*/
+	int ident;
+
+	/**
+	*	Offset of the directory in the archive.
+	*/
+	int dirofs;
+
+	/**
+	*	Size of the directory, in bytes.
+	*/
+	int dirlen;
+};
+
+/**
+*	Directory entry for a single file in a PAK archive.
+*/
+struct dpackfile_t final
+{
+	char name[ MAX_PACK_FILENAME ];
+
+	int filepos;
+	int filelen;
+};
+
+/**
+*	A PAK archive. The directory is parsed once when the archive is opened, and the archive stays mapped into memory,
+*	so reading a file from it doesn't access the disk or copy anything.
+*/
+class CPackFile final
+{
+private:
+	struct Entry_t
+	{
+		size_t uiOffset;
+		size_t uiSize;
+	};
+
+	/**
+	*	Maps lowercase file names with forward slashes to their entries.
+	*/
+	typedef std::unordered_map<std::string, Entry_t> Entries_t;
+
+public:
+	CPackFile() = default;
+	~CPackFile() = default;
+
+	/**
+	*	Opens an archive and reads its directory.
+	*	@param pszFilename Name of the archive.
+	*	@return Whether the archive was opened. Fails if the directory or any of its entries lie outside the archive.
+	*/
+	bool Open( const char* const pszFilename );
+
+	/**
+	*	@return Number of files in the archive.
+	*/
+	size_t GetFileCount() const { return m_Entries.size(); }
+
+	/**
+	*	Looks up a file.
+	*	@param szKey Lowercase name of the file, with forward slashes.
+	*	@param data If the file is in the archive, set to its contents.
+	*	@return Whether the file is in the archive.
+	*/
+	bool Find( const std::string& szKey, CFileData& data ) const;
+
+private:
+	std::shared_ptr<CMappedFile> m_File;
+
+	Entries_t m_Entries;
+
+private:
+	CPackFile( const CPackFile& ) = delete;
+	CPackFile& operator=( const CPackFile& ) = delete;
+};
+}
+
+/** @} */
+
+#endif //FILESYSTEM_CPACKFILE_H
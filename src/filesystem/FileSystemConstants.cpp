@@ -1,7 +1,20 @@
+#include <algorithm>
+#include <cctype>
+
 #include "shared/Utility.h"
 
 #include "FileSystemConstants.h"
 
 namespace filesystem
 {
-}
\ No newline at end of file
+std::string ToIndexKey( std::string szPath )
+{
+	std::transform( szPath.begin(), szPath.end(), szPath.begin(), []( const char c )
+		{
+			return c == '\\' ? '/' : static_cast<char>( tolower( static_cast<unsigned char>( c ) ) );
+		}
+	);
+
+	return szPath;
+}
+}
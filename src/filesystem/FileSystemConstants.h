@@ -1,6 +1,8 @@
 #ifndef FILESYSTEM_FILESYSTEMCONSTANTS_H
 #define FILESYSTEM_FILESYSTEMCONSTANTS_H
 
+#include <string>
+
 /**
 *	@ingroup FileSystem
 *
@@ -8,8 +10,12 @@
 */
 namespace filesystem
 {
+/**
+*	Converts a path to the form used to look up files in search path indexes and archives: lowercase, with forward slashes.
+*/
+std::string ToIndexKey( std::string szPath );
 }
 
 /** @} */
 
-#endif //FILESYSTEM_FILESYSTEMCONSTANTS_H
\ No newline at end of file
+#endif //FILESYSTEM_FILESYSTEMCONSTANTS_H
@@ -1,8 +1,14 @@
 #ifndef FILESYSTEM_IFILESYSTEM_H
 #define FILESYSTEM_IFILESYSTEM_H
 
+#include <future>
+#include <string>
+#include <vector>
+
 #include "lib/LibInterface.h"
 
+#include "CFileData.h"
+
 /** @file */
 
 /**
@@ -19,6 +25,7 @@ namespace filesystem
 *	<pre>
 *	The filesystem has a concept of a base path: this is the path to the game directory, like "common/Half-Life"
 *	All search paths are relative to this base path.
+*	Search paths that end in ".pak" are PAK archives. Files in archives can only be read with ReadFile.
 *	</pre>
 */
 class IFileSystem : public IBaseInterface
@@ -80,6 +87,8 @@ public:
 
 	/**
 	*	Gets a relative path to a file. This may actually be an absolute path, depending on the value of the base path. The file must exist.
+	*	Files that are only in archives are not found; use ReadFile to read those.
+	*	Results, including files that weren't found, are cached until the search paths change or InvalidatePathCache is called.
 	*	@param pszFilename File to get a path to.
 	*	@param pszOutPath Destination buffer for the path.
 	*	@param uiBufferSize Size of the destination buffer, in characters.
@@ -87,12 +96,74 @@ public:
 	*/
 	virtual bool GetRelativePath( const char* const pszFilename, char* pszOutPath, const size_t uiBufferSize ) = 0;
 
+	/**
+	*	Reads a file. Search paths are searched in order, including archives. Absolute paths and paths relative to the working directory
+	*	are read directly. The data is mapped into memory, and files in archives are not copied.
+	*	@param pszFilename Name of the file to read.
+	*	@param data If the file was found, set to its contents.
+	*	@return Whether the file was read.
+	*/
+	virtual bool ReadFile( const char* const pszFilename, CFileData& data ) = 0;
+
+	/**
+	*	Reads a file on an I/O thread. Several files can be read at the same time this way.
+	*	The file's data is read from disk before the future becomes ready, so accessing it doesn't block.
+	*	Search paths must not be changed while reads are pending.
+	*	@param pszFilename Name of the file to read.
+	*	@return Future that is set to the file's contents. If the file couldn't be read, the data is not valid.
+	*	@see ReadFile
+	*/
+	virtual std::future<CFileData> ReadFileAsync( const char* const pszFilename ) = 0;
+
 	/**
 	*	Returns whether the given file exists.
 	*	@param pszFilename Name of the file to check for.
 	*	@return true if the file exists, false otherwise.
 	*/
 	virtual bool FileExists( const char* const pszFilename ) const = 0;
+
+	/**
+	*	Clears the paths cached by GetRelativePath. Call this when files have been added to or removed from the search paths.
+	*/
+	virtual void InvalidatePathCache() = 0;
+
+	/**
+	*	@return Whether search paths are indexed.
+	*	@see SetSearchPathIndexing
+	*/
+	virtual bool IsSearchPathIndexing() const = 0;
+
+	/**
+	*	Sets whether search paths are indexed. When enabled, the files in each search path are enumerated once when it's added,
+	*	and GetRelativePath finds files in the index instead of probing the disk. Files in the index are matched case insensitively.
+	*	Files added afterwards are only found after calling InvalidatePathCache.
+	*	@param bIndex Whether to index search paths.
+	*/
+	virtual void SetSearchPathIndexing( const bool bIndex ) = 0;
+
+	/**
+	*	Starts watching a file for changes. Changes are reported by GetFileChanges.
+	*	@param pszFilename Name of the file. Found the same way as GetRelativePath does. Files in archives can't be watched.
+	*	@return Whether the file is being watched.
+	*/
+	virtual bool WatchFile( const char* const pszFilename ) = 0;
+
+	/**
+	*	Stops watching a file.
+	*/
+	virtual void UnwatchFile( const char* const pszFilename ) = 0;
+
+	/**
+	*	Stops watching all files.
+	*/
+	virtual void UnwatchAllFiles() = 0;
+
+	/**
+	*	Gets the watched files that were modified, created, deleted or renamed since the last call. Call this regularly, on the thread that changes search paths.
+	*	Cached paths of any file that changed in a watched directory are invalidated, and search path indexes are updated.
+	*	@param changes Absolute paths of changed watched files are added to this list. Each file is listed once.
+	*/
+	virtual void GetFileChanges( std::vector<std::string>& changes ) = 0;
 };
 
 inline IFileSystem::~IFileSystem()
@@ -1,3 +1,30 @@
 #include "shared/Logging.h"
 
-#include "CBaseAnimating.h"
\ No newline at end of file
+#include "CBaseEntityList.h"
+#include "CEntityComponents.h"
+
+#include "CBaseAnimating.h"
+
+void CBaseAnimating::WriteComponents( CEntityComponents& components ) const
+{
+	BaseClass::WriteComponents( components );
+
+	const entity::EntIndex_t uiIndex = GetEntHandle().GetEntIndex();
+
+	components.SetFrame( uiIndex, m_flFrame );
+	components.SetFrameRate( uiIndex, m_flFrameRate );
+}
+
+void CBaseAnimating::FrameChanged()
+{
+	if( GetEntHandle().IsValid() )
+		GetEntityList().GetComponents().SetFrame( GetEntHandle().GetEntIndex(), m_flFrame );
+}
+
+void CBaseAnimating::SetFrameRate( const float flFrameRate )
+{
+	m_flFrameRate = flFrameRate;
+
+	if( GetEntHandle().IsValid() )
+		GetEntityList().GetComponents().SetFrameRate( GetEntHandle().GetEntIndex(), flFrameRate );
+}
@@ -13,6 +13,15 @@ class CBaseAnimating : public CBaseEntity
 public:
 	DECLARE_CLASS( CBaseAnimating, CBaseEntity );
 
+public:
+	virtual void WriteComponents( CEntityComponents& components ) const override;
+
+protected:
+	/**
+	*	Must be called after changing m_flFrame, so the component arrays stay up to date.
+	*/
+	void FrameChanged();
+
 protected:
 	float	m_flFrame		= 0;	// frame
 	float	m_flFrameRate	= 1;	//Framerate.
@@ -32,7 +41,7 @@ public:
 	*	Sets the frame rate.
 	*	TODO: prevent negative?
 	*/
-	void SetFrameRate( const float flFrameRate ) { m_flFrameRate = flFrameRate; }
+	void SetFrameRate( const float flFrameRate );
 };
 
 #endif //GAME_CBASEANIMATING_H
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "shared/Logging.h"
 
 #include "CBaseEntityList.h"
+#include "CEntityComponents.h"
+#include "CEntityManager.h"
 
 #include "CBaseEntity.h"
 
@@ -34,6 +36,67 @@ bool CBaseEntity::Spawn()
 	return true;
 }
 
+void CBaseEntity::GetWorldBounds( glm::vec3& vecMins, glm::vec3& vecMaxs ) const
+{
+	vecMins = vecMaxs = m_vecOrigin;
+}
+
+void CBaseEntity::WriteComponents( CEntityComponents& components ) const
+{
+	const entity::EntIndex_t uiIndex = m_EntHandle.GetEntIndex();
+
+	components.SetTransform( uiIndex, m_vecOrigin, m_vecAngles, m_vecScale );
+	components.SetLastThinkTime( uiIndex, m_flLastThinkTime );
+	components.SetNextThinkTime( uiIndex, m_flNextThinkTime );
+}
+
+void CBaseEntity::BoundsChanged()
+{
+	//Entities that aren't in the list yet get their bounds when they're added.
+	if( !m_EntHandle.IsValid() )
+		return;
+
+	GetEntityList().GetComponents().SetTransform( m_EntHandle.GetEntIndex(), m_vecOrigin, m_vecAngles, m_vecScale );
+
+	EntityManager().MarkBoundsDirty( this );
+}
+
+void CBaseEntity::FlagsChanged( const entity::Flags_t oldFlags )
+{
+	//Entities that aren't in the list yet are scheduled when they're added.
+	if( !m_EntHandle.IsValid() )
+		return;
+
+	const entity::Flags_t addedFlags = m_Flags & ~oldFlags;
+
+	if( addedFlags & entity::FL_ALWAYSTHINK )
+		EntityManager().ScheduleAlwaysThink( this );
+
+	if( addedFlags & entity::FL_KILLME )
+		EntityManager().ScheduleRemove( this );
+}
+
+void CBaseEntity::SetLastThinkTime( const float flLastThink )
+{
+	m_flLastThinkTime = flLastThink;
+
+	if( m_EntHandle.IsValid() )
+		GetEntityList().GetComponents().SetLastThinkTime( m_EntHandle.GetEntIndex(), flLastThink );
+}
+
+void CBaseEntity::SetNextThinkTime( const float flNextThink )
+{
+	m_flNextThinkTime = flNextThink;
+
+	if( !m_EntHandle.IsValid() )
+		return;
+
+	GetEntityList().GetComponents().SetNextThinkTime( m_EntHandle.GetEntIndex(), flNextThink );
+
+	if( flNextThink != 0 )
+		EntityManager().ScheduleThink( this );
+}
+
 CBaseEntity* CBaseEntity::Create( const char* const pszClassName, const glm::vec3& vecOrigin, const glm::vec3& vecAngles, const bool bSpawn )
 {
 	CBaseEntity* pEntity = GetEntityDict().CreateEntity( pszClassName );
@@ -52,6 +115,9 @@ CBaseEntity* CBaseEntity::Create( const char* const pszClassName, const glm::vec
 		return nullptr;
 	}
 
+	//Pick up anything that was set before the entity had a handle.
+	EntityManager().ScheduleEntity( pEntity );
+
 	pEntity->SetOrigin( vecOrigin );
 	pEntity->SetAngles( vecAngles );
 
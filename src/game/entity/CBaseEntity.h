@@ -9,6 +9,7 @@
 
 #include "EntityConstants.h"
 #include "EHandle.h"
+#include "CEntityBVH.h"
 #include "CEntityDict.h"
 
 //Windows defines this
@@ -17,6 +18,7 @@
 #endif
 
 class CBaseEntity;
+class CEntityComponents;
 
 /**
 *	Pointer to member function used for think methods.
@@ -31,6 +33,8 @@ class CBaseEntity
 public:
 	DECLARE_CLASS_NOBASE( CBaseEntity );
 
+	friend class CEntityManager;
+
 public:
 	CBaseEntity();
 	~CBaseEntity();
@@ -56,6 +60,37 @@ public:
 	*/
 	virtual void Draw( renderer::DrawFlags_t flags ) {}
 
+	/**
+	*	Called every frame after all entities have thought, before any entity is drawn.
+	*	Entities can do work that Draw needs here. This can be called on any thread, at the same time as PrepareDraw for other entities,
+	*	so it must not modify anything other than this entity's own draw state.
+	*/
+	virtual void PrepareDraw() {}
+
+	/**
+	*	Gets the entity's bounds in world space. Used to find entities for culling and picking.
+	*	The default is a point at the entity's origin.
+	*/
+	virtual void GetWorldBounds( glm::vec3& vecMins, glm::vec3& vecMaxs ) const;
+
+	/**
+	*	Writes this entity's frequently used fields to the entity list's component arrays.
+	*	Called when the entity is added to the list. Overrides must call the base class version.
+	*/
+	virtual void WriteComponents( CEntityComponents& components ) const;
+
+	/**
+	*	Tells the entity manager that the entity's world bounds have changed, and updates the transform in the component arrays.
+	*	Called by SetOrigin, SetAngles and SetScale; must be called after modifying them through the non-const getters.
+	*/
+	void BoundsChanged();
+
+	/**
+	*	Tells the entity manager that the entity's world bounds have changed because of its draw state.
+	*	Can be called from PrepareDraw; the bounds are updated once all entities have been prepared.
+	*/
+	void PreparedBoundsChanged() { m_bPreparedBoundsChanged = true; }
+
 private:
 	const char* m_pszClassName = nullptr;
 	EHandle m_EntHandle;
@@ -119,18 +154,35 @@ public:
 	/**
 	*	Sets the entity's flags to the given flags.
 	*/
-	void InitFlags( const entity::Flags_t flags ) { m_Flags = flags; }
+	void InitFlags( const entity::Flags_t flags )
+	{
+		const entity::Flags_t oldFlags = m_Flags;
+		m_Flags = flags;
+		FlagsChanged( oldFlags );
+	}
 
 	/**
 	*	Sets the given flags on the entity. Existing flags are unaffected.
 	*/
-	void SetFlags( const entity::Flags_t flags ) { m_Flags |= flags; }
+	void SetFlags( const entity::Flags_t flags )
+	{
+		const entity::Flags_t oldFlags = m_Flags;
+		m_Flags |= flags;
+		FlagsChanged( oldFlags );
+	}
 
 	/**
 	*	Clears the given flags from the entity's flags.
 	*/
 	void ClearFlags( const entity::Flags_t flags ) { m_Flags &= ~flags; }
 
+private:
+	/**
+	*	Tells the entity manager about flags that affect scheduling.
+	*/
+	void FlagsChanged( const entity::Flags_t oldFlags );
+
+public:
 	/**
 	*	Gets the entity's origin.
 	*/
@@ -145,7 +197,11 @@ public:
 	/**
 	*	Sets the entity's origin.
 	*/
-	void SetOrigin( const glm::vec3& vecOrigin ) { m_vecOrigin = vecOrigin; }
+	void SetOrigin( const glm::vec3& vecOrigin )
+	{
+		m_vecOrigin = vecOrigin;
+		BoundsChanged();
+	}
 
 	/**
 	*	Gets the entity's angles.
@@ -161,7 +217,11 @@ public:
 	/**
 	*	Sets the entity's angles.
 	*/
-	void SetAngles( const glm::vec3& vecAngles ) { m_vecAngles = vecAngles; }
+	void SetAngles( const glm::vec3& vecAngles )
+	{
+		m_vecAngles = vecAngles;
+		BoundsChanged();
+	}
 
 	/**
 	*	Gets the entity's scale.
@@ -177,7 +237,11 @@ public:
 	/**
 	*	Sets the entity's scale.
 	*/
-	void SetScale( const glm::vec3& vecScale ) { m_vecScale = vecScale; }
+	void SetScale( const glm::vec3& vecScale )
+	{
+		m_vecScale = vecScale;
+		BoundsChanged();
+	}
 
 	/**
 	*	Gets the entity's transparency.
@@ -194,6 +258,18 @@ private:
 	float m_flLastThinkTime = 0;
 	float m_flNextThinkTime = 0;
 
+	//Whether the entity manager has this entity in its always think list.
+	bool m_bInAlwaysThinkList = false;
+
+	//This entity's leaf in the entity manager's bounding volume hierarchy.
+	CEntityBVH::ProxyId_t m_iBVHProxy = CEntityBVH::INVALID_PROXY;
+
+	//Whether the entity manager has this entity in its dirty bounds list.
+	bool m_bBoundsDirty = false;
+
+	//Whether PrepareDraw changed the entity's bounds.
+	bool m_bPreparedBoundsChanged = false;
+
 public:
 	/**
 	*	Gets the think method.
@@ -226,7 +302,7 @@ public:
 	/**
 	*	Sets the last think time. Should only be used by the entity manager.
 	*/
-	void SetLastThinkTime( const float flLastThink ) { m_flLastThinkTime = flLastThink; }
+	void SetLastThinkTime( const float flLastThink );
 
 	/**
 	*	Gets the next think time.
@@ -234,9 +310,9 @@ public:
 	float GetNextThinkTime() const { return m_flNextThinkTime; }
 
 	/**
-	*	Sets the next think time.
+	*	Sets the next think time. 0 means the entity doesn't think.
 	*/
-	void SetNextThinkTime( const float flNextThink ) { m_flNextThinkTime = flNextThink; }
+	void SetNextThinkTime( const float flNextThink );
 
 	/**
 	*	Runs the think method. NOTE: non-virtual.
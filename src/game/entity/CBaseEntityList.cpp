@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <memory>
 
@@ -7,6 +8,7 @@
 #include "EHandle.h"
 
 #include "CEntityDict.h"
+#include "CEntityManager.h"
 
 #include "CBaseEntityList.h"
 
@@ -29,7 +31,6 @@ void SetEntityList( CBaseEntityList* pList )
 
 CBaseEntityList::CBaseEntityList()
 {
-	memset( m_Entities, 0, sizeof( m_Entities ) );
 }
 
 CBaseEntityList::~CBaseEntityList()
@@ -40,6 +41,9 @@ CBaseEntity* CBaseEntityList::GetEntityByIndex( const entity::EntIndex_t uiIndex
 {
 	assert( uiIndex < entity::MAX_ENTITIES );
 
+	if( uiIndex >= m_Entities.size() )
+		return nullptr;
+
 	return m_Entities[ uiIndex ].pEntity;
 }
 
@@ -51,6 +55,9 @@ CBaseEntity* CBaseEntityList::GetEntityByHandle( const EHandle& handle ) const
 
 	assert( handle.GetEntIndex() < entity::MAX_ENTITIES );
 
+	if( handle.GetEntIndex() >= m_Entities.size() )
+		return nullptr;
+
 	if( m_Entities[ handle.GetEntIndex() ].serial == handle.GetSerialNumber() )
 		return m_Entities[ handle.GetEntIndex() ].pEntity;
 
@@ -64,12 +71,23 @@ EHandle CBaseEntityList::GetFirstEntity() const
 
 EHandle CBaseEntityList::GetNextEntity( const EHandle& previous ) const
 {
-	for( size_t uiIndex = previous.IsValid() ? previous.GetEntIndex() + 1 : 0; uiIndex < m_uiHighestEntIndex; ++uiIndex )
+	size_t uiNext = 0;
+
+	if( previous.GetEntHandle() != entity::INVALID_ENTITY_HANDLE && previous.GetEntIndex() < m_Entities.size() )
 	{
-		if( m_Entities[ uiIndex ].pEntity )
-			return m_Entities[ uiIndex ].pEntity;
+		const EntData_t& data = m_Entities[ previous.GetEntIndex() ];
+
+		//If the slot has been reused since, start over.
+		if( data.serial == previous.GetSerialNumber() )
+		{
+			//If the entity was removed, the entity that took its place in the packed array hasn't been returned yet.
+			uiNext = data.pEntity ? data.uiPackedIndex + 1 : data.uiPackedIndex;
+		}
 	}
 
+	if( uiNext < m_LiveEntities.size() )
+		return m_Entities[ m_LiveEntities[ uiNext ] ].pEntity;
+
 	return nullptr;
 }
 
@@ -77,31 +95,25 @@ size_t CBaseEntityList::Add( CBaseEntity* pEntity )
 {
 	assert( pEntity );
 
-	if( m_uiNumEntities >= entity::MAX_ENTITIES )
+	if( m_uiFirstFree == entity::INVALID_ENTITY_INDEX && !Grow() )
 	{
 		Warning( "Max entities reached (%u)!\n", entity::MAX_ENTITIES );
 		return entity::INVALID_ENTITY_INDEX;
 	}
 
-	entity::EntIndex_t uiIndex;
+	const entity::EntIndex_t uiIndex = m_uiFirstFree;
 
-	for( uiIndex = 0; uiIndex < entity::MAX_ENTITIES; ++uiIndex )
-	{
-		if( !m_Entities[ uiIndex ].pEntity )
-			break;
-	}
+	EntData_t& data = m_Entities[ uiIndex ];
 
-	//Shouldn't happen.
-	if( uiIndex >= entity::MAX_ENTITIES )
-	{
-		Warning( "Max entities reached (%u)!\n", entity::MAX_ENTITIES );
-		return entity::INVALID_ENTITY_INDEX;
-	}
+	m_uiFirstFree = data.uiNextFree;
 
-	++m_uiNumEntities;
+	if( m_uiFirstFree == entity::INVALID_ENTITY_INDEX )
+		m_uiLastFree = entity::INVALID_ENTITY_INDEX;
 
-	if( uiIndex >= m_uiHighestEntIndex )
-		m_uiHighestEntIndex = uiIndex + 1;
+	data.uiNextFree = entity::INVALID_ENTITY_INDEX;
+	data.uiPackedIndex = static_cast<entity::EntIndex_t>( m_LiveEntities.size() );
+
+	m_LiveEntities.push_back( uiIndex );
 
 	FinishAddEntity( uiIndex, pEntity );
 
@@ -118,45 +130,87 @@ void CBaseEntityList::Remove( CBaseEntity* pEntity )
 	const entity::EntIndex_t uiIndex = handle.GetEntIndex();
 
 	//this shouldn't ever be hit, unless the entity was corrupted/not managed by this list.
-	assert( uiIndex < m_uiHighestEntIndex );
+	assert( uiIndex < m_Entities.size() );
 
 	//Sanity check.
 	assert( m_Entities[ uiIndex ].pEntity == pEntity );
 
 	FinishRemoveEntity( pEntity );
 
-	--m_uiNumEntities;
+	//Move the last live entity into the removed entity's place. The removed slot keeps its packed index for GetNextEntity.
+	EntData_t& data = m_Entities[ uiIndex ];
 
-	//Adjust highest entity index.
-	if( uiIndex == m_uiHighestEntIndex - 1 )
-	{
-		for( ; m_uiHighestEntIndex > 0; --m_uiHighestEntIndex )
-		{
-			if( m_Entities[ m_uiHighestEntIndex - 1 ].pEntity )
-			{
-				m_uiHighestEntIndex = m_uiHighestEntIndex - 1;
-				break;
-			}
-		}
-	}
+	const entity::EntIndex_t uiLast = m_LiveEntities.back();
+
+	m_LiveEntities[ data.uiPackedIndex ] = uiLast;
+	m_Entities[ uiLast ].uiPackedIndex = data.uiPackedIndex;
+
+	m_LiveEntities.pop_back();
+
+	//Add to the end of the free list.
+	if( m_uiLastFree != entity::INVALID_ENTITY_INDEX )
+		m_Entities[ m_uiLastFree ].uiNextFree = uiIndex;
+	else
+		m_uiFirstFree = uiIndex;
 
-	return;
+	m_uiLastFree = uiIndex;
 }
 
 void CBaseEntityList::RemoveAll()
 {
-	for( size_t uiIndex = 0; uiIndex < m_uiHighestEntIndex; ++uiIndex )
+	for( size_t uiIndex = 0; uiIndex < m_LiveEntities.size(); ++uiIndex )
 	{
-		if( CBaseEntity* pEntity = m_Entities[ uiIndex ].pEntity )
+		if( CBaseEntity* pEntity = m_Entities[ m_LiveEntities[ uiIndex ] ].pEntity )
 		{
 			FinishRemoveEntity( pEntity );
 		}
 	}
 
-	m_uiHighestEntIndex = 0;
-	m_uiNumEntities = 0;
+	m_LiveEntities.clear();
 
-	memset( m_Entities, 0, sizeof( m_Entities ) );
+	//Serial numbers are kept so old handles stay invalid.
+	m_uiFirstFree = m_uiLastFree = entity::INVALID_ENTITY_INDEX;
+
+	for( size_t uiIndex = 0; uiIndex < m_Entities.size(); ++uiIndex )
+	{
+		m_Entities[ uiIndex ].pEntity = nullptr;
+		m_Entities[ uiIndex ].uiPackedIndex = entity::INVALID_ENTITY_INDEX;
+		m_Entities[ uiIndex ].uiNextFree = uiIndex + 1 < m_Entities.size() ? static_cast<entity::EntIndex_t>( uiIndex + 1 ) : entity::INVALID_ENTITY_INDEX;
+	}
+
+	if( !m_Entities.empty() )
+	{
+		m_uiFirstFree = 0;
+		m_uiLastFree = static_cast<entity::EntIndex_t>( m_Entities.size() - 1 );
+	}
+}
+
+bool CBaseEntityList::Grow()
+{
+	const size_t uiOldSize = m_Entities.size();
+
+	if( uiOldSize >= entity::MAX_ENTITIES )
+		return false;
+
+	const size_t uiNewSize = std::min( uiOldSize + SLOT_CHUNK_SIZE, static_cast<size_t>( entity::MAX_ENTITIES ) );
+
+	m_Entities.resize( uiNewSize, { nullptr, 0, entity::INVALID_ENTITY_INDEX, entity::INVALID_ENTITY_INDEX } );
+
+	m_Components.Resize( uiNewSize );
+
+	for( size_t uiIndex = uiOldSize; uiIndex < uiNewSize; ++uiIndex )
+	{
+		const entity::EntIndex_t uiSlot = static_cast<entity::EntIndex_t>( uiIndex );
+
+		if( m_uiLastFree != entity::INVALID_ENTITY_INDEX )
+			m_Entities[ m_uiLastFree ].uiNextFree = uiSlot;
+		else
+			m_uiFirstFree = uiSlot;
+
+		m_uiLastFree = uiSlot;
+	}
+
+	return true;
 }
 
 void CBaseEntityList::FinishAddEntity( const entity::EntIndex_t uiIndex, CBaseEntity* pEntity )
@@ -172,6 +226,8 @@ void CBaseEntityList::FinishAddEntity( const entity::EntIndex_t uiIndex, CBaseEn
 
 	pEntity->SetEntHandle( handle );
 
+	pEntity->WriteComponents( m_Components );
+
 	OnAdded( pEntity );
 }
 
@@ -179,9 +235,13 @@ void CBaseEntityList::FinishRemoveEntity( CBaseEntity* pEntity )
 {
 	OnRemove( pEntity );
 
+	EntityManager().OnEntityRemoved( pEntity );
+
 	const EHandle handle = pEntity->GetEntHandle();
 
 	GetEntityDict().DestroyEntity( pEntity );
 
 	m_Entities[ handle.GetEntIndex() ].pEntity = nullptr;
+
+	m_Components.Reset( handle.GetEntIndex() );
 }
\ No newline at end of file
@@ -1,13 +1,19 @@
 #ifndef GAME_ENTITY_CBASEENTITYLIST_H
 #define GAME_ENTITY_CBASEENTITYLIST_H
 
+#include <vector>
+
 #include "EntityConstants.h"
+#include "CEntityComponents.h"
 
 class CBaseEntity;
 class EHandle;
 
 /**
 *	Manages a list of entities.
+*	Slots are allocated from a free list and grow in chunks as needed.
+*	Live entities are also kept in a packed array, so iterating costs in proportion to the number of entities.
+*	Frequently used fields of each entity are kept in component arrays indexed by slot.
 */
 class CBaseEntityList
 {
@@ -20,8 +26,24 @@ private:
 	{
 		CBaseEntity*		pEntity;
 		entity::EntSerial_t serial;
+
+		/**
+		*	If in use, the index of the entity in the packed array.
+		*	If free, keeps the index the entity had, so iteration can continue after the entity is removed.
+		*/
+		entity::EntIndex_t	uiPackedIndex;
+
+		/**
+		*	If free, the next free slot.
+		*/
+		entity::EntIndex_t	uiNextFree;
 	};
 
+	/**
+	*	Number of slots added each time the list grows.
+	*/
+	static const size_t SLOT_CHUNK_SIZE = 256;
+
 public:
 	CBaseEntityList();
 	~CBaseEntityList();
@@ -29,12 +51,22 @@ public:
 	/**
 	*	Gets the total number of entities.
 	*/
-	size_t GetNumEntities() const { return m_uiNumEntities; }
+	size_t GetNumEntities() const { return m_LiveEntities.size(); }
+
+	/**
+	*	Gets the number of allocated slots. All entity indices are lower than this.
+	*/
+	size_t GetHighestEntityIndex() const { return m_Entities.size(); }
+
+	/**
+	*	Gets the component arrays. Has an element for every slot.
+	*/
+	const CEntityComponents& GetComponents() const { return m_Components; }
 
 	/**
-	*	Gets the highest entity index that's currently in use, + 1.
+	*	@copydoc GetComponents() const
 	*/
-	size_t GetHighestEntityIndex() const { return m_uiHighestEntIndex; }
+	CEntityComponents& GetComponents() { return m_Components; }
 
 	/**
 	*	Gets an entity by index.
@@ -53,6 +85,8 @@ public:
 
 	/**
 	*	Gets the next entity in the list after previous.
+	*	If previous was removed since it was returned, iteration continues where it was, so entities can be removed while iterating.
+	*	Entities aren't returned in any particular order.
 	*/
 	EHandle GetNextEntity( const EHandle& previous ) const;
 
@@ -83,6 +117,12 @@ protected:
 	virtual void OnRemove( CBaseEntity* pEntity ) {}
 
 private:
+	/**
+	*	Adds another chunk of free slots.
+	*	@return Whether any slots were added.
+	*/
+	bool Grow();
+
 	/**
 	*	Finishes adding an entity.
 	*/
@@ -95,20 +135,22 @@ private:
 
 private:
 	/**
-	*	The actual list.
-	*	TODO: consider: allocate dynamically, resize as needed. Allows for a num_edicts like command line parameter.
+	*	The actual list. Grows up to entity::MAX_ENTITIES slots.
 	*/
-	EntData_t m_Entities[ entity::MAX_ENTITIES ];
+	std::vector<EntData_t> m_Entities;
 
 	/**
-	*	The total number of entities.
+	*	Indices of live entities, packed together.
 	*/
-	size_t m_uiNumEntities = 0;
+	std::vector<entity::EntIndex_t> m_LiveEntities;
 
 	/**
-	*	The highest entity index that is currently in use, + 1.
+	*	Free slots are reused oldest first, so serial numbers of a given slot don't wrap around quickly.
 	*/
-	size_t m_uiHighestEntIndex = 0;
+	entity::EntIndex_t m_uiFirstFree = entity::INVALID_ENTITY_INDEX;
+	entity::EntIndex_t m_uiLastFree = entity::INVALID_ENTITY_INDEX;
+
+	CEntityComponents m_Components;
 
 private:
 	CBaseEntityList( const CBaseEntityList& ) = delete;
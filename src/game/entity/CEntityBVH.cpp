@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cassert>
+
+#include <glm/common.hpp>
+
+#include "CEntityBVH.h"
+
+namespace
+{
+/**
+*	How much leaf bounds are enlarged by on each side, in world units.
+*/
+const float LEAF_MARGIN = 4.0f;
+
+float SurfaceArea( const glm::vec3& vecMins, const glm::vec3& vecMaxs )
+{
+	const glm::vec3 vecSize = vecMaxs - vecMins;
+
+	return 2.0f * ( vecSize.x * vecSize.y + vecSize.y * vecSize.z + vecSize.z * vecSize.x );
+}
+
+bool Contains( const glm::vec3& vecOuterMins, const glm::vec3& vecOuterMaxs, const glm::vec3& vecMins, const glm::vec3& vecMaxs )
+{
+	return vecOuterMins.x <= vecMins.x && vecOuterMins.y <= vecMins.y && vecOuterMins.z <= vecMins.z &&
+		vecMaxs.x <= vecOuterMaxs.x && vecMaxs.y <= vecOuterMaxs.y && vecMaxs.z <= vecOuterMaxs.z;
+}
+}
+
+CEntityBVH::ProxyId_t CEntityBVH::Insert( const glm::vec3& vecMins, const glm::vec3& vecMaxs, const EHandle& entity )
+{
+	const ProxyId_t leaf = AllocateNode();
+
+	Node_t& node = m_Nodes[ leaf ];
+
+	node.vecMins = vecMins - LEAF_MARGIN;
+	node.vecMaxs = vecMaxs + LEAF_MARGIN;
+	node.entity = entity;
+
+	InsertLeaf( leaf );
+
+	++m_uiLeafCount;
+
+	return leaf;
+}
+
+void CEntityBVH::Remove( const ProxyId_t proxy )
+{
+	assert( proxy >= 0 && static_cast<size_t>( proxy ) < m_Nodes.size() );
+	assert( m_Nodes[ proxy ].IsLeaf() );
+
+	RemoveLeaf( proxy );
+
+	FreeNode( proxy );
+
+	--m_uiLeafCount;
+}
+
+bool CEntityBVH::Update( const ProxyId_t proxy, const glm::vec3& vecMins, const glm::vec3& vecMaxs )
+{
+	assert( proxy >= 0 && static_cast<size_t>( proxy ) < m_Nodes.size() );
+	assert( m_Nodes[ proxy ].IsLeaf() );
+
+	Node_t& node = m_Nodes[ proxy ];
+
+	const glm::vec3 vecFatMins = vecMins - LEAF_MARGIN;
+	const glm::vec3 vecFatMaxs = vecMaxs + LEAF_MARGIN;
+
+	if( Contains( node.vecMins, node.vecMaxs, vecMins, vecMaxs ) )
+	{
+		//Still fits; only reinsert if the leaf has become much larger than needed, so queries stay tight.
+		const glm::vec3 vecHugeMins = vecFatMins - 4.0f * LEAF_MARGIN;
+		const glm::vec3 vecHugeMaxs = vecFatMaxs + 4.0f * LEAF_MARGIN;
+
+		if( Contains( vecHugeMins, vecHugeMaxs, node.vecMins, node.vecMaxs ) )
+			return false;
+	}
+
+	RemoveLeaf( proxy );
+
+	node.vecMins = vecFatMins;
+	node.vecMaxs = vecFatMaxs;
+
+	InsertLeaf( proxy );
+
+	return true;
+}
+
+void CEntityBVH::Clear()
+{
+	m_Nodes.clear();
+
+	m_iRoot = INVALID_PROXY;
+	m_iFreeList = INVALID_PROXY;
+	m_uiLeafCount = 0;
+}
+
+CEntityBVH::ProxyId_t CEntityBVH::AllocateNode()
+{
+	ProxyId_t node;
+
+	if( m_iFreeList != INVALID_PROXY )
+	{
+		node = m_iFreeList;
+		m_iFreeList = m_Nodes[ node ].iParent;
+	}
+	else
+	{
+		node = static_cast<ProxyId_t>( m_Nodes.size() );
+		m_Nodes.emplace_back();
+	}
+
+	Node_t& data = m_Nodes[ node ];
+
+	data.iParent = INVALID_PROXY;
+	data.iChild1 = INVALID_PROXY;
+	data.iChild2 = INVALID_PROXY;
+	data.entity = nullptr;
+
+	return node;
+}
+
+void CEntityBVH::FreeNode( const ProxyId_t node )
+{
+	m_Nodes[ node ].entity = nullptr;
+	m_Nodes[ node ].iParent = m_iFreeList;
+	m_iFreeList = node;
+}
+
+void CEntityBVH::InsertLeaf( const ProxyId_t leaf )
+{
+	if( m_iRoot == INVALID_PROXY )
+	{
+		m_iRoot = leaf;
+		m_Nodes[ leaf ].iParent = INVALID_PROXY;
+		return;
+	}
+
+	//Find the best sibling by descending towards the child whose area grows the least.
+	const glm::vec3 vecLeafMins = m_Nodes[ leaf ].vecMins;
+	const glm::vec3 vecLeafMaxs = m_Nodes[ leaf ].vecMaxs;
+
+	ProxyId_t sibling = m_iRoot;
+
+	while( !m_Nodes[ sibling ].IsLeaf() )
+	{
+		const Node_t& node = m_Nodes[ sibling ];
+
+		const float flArea = SurfaceArea( node.vecMins, node.vecMaxs );
+		const float flCombinedArea = SurfaceArea( glm::min( node.vecMins, vecLeafMins ), glm::max( node.vecMaxs, vecLeafMaxs ) );
+
+		//Cost of making a new parent for this node and the leaf.
+		const float flCost = 2.0f * flCombinedArea;
+
+		//Minimum cost of pushing the leaf further down.
+		const float flInheritanceCost = 2.0f * ( flCombinedArea - flArea );
+
+		auto childCost = [ & ]( const ProxyId_t child )
+		{
+			const Node_t& childNode = m_Nodes[ child ];
+
+			const float flChildArea = SurfaceArea( glm::min( childNode.vecMins, vecLeafMins ), glm::max( childNode.vecMaxs, vecLeafMaxs ) );
+
+			if( childNode.IsLeaf() )
+				return flChildArea + flInheritanceCost;
+
+			return flChildArea - SurfaceArea( childNode.vecMins, childNode.vecMaxs ) + flInheritanceCost;
+		};
+
+		const float flCost1 = childCost( node.iChild1 );
+		const float flCost2 = childCost( node.iChild2 );
+
+		if( flCost < flCost1 && flCost < flCost2 )
+			break;
+
+		sibling = flCost1 < flCost2 ? node.iChild1 : node.iChild2;
+	}
+
+	//Allocating can move the nodes, so don't hold references across it.
+	const ProxyId_t oldParent = m_Nodes[ sibling ].iParent;
+	const ProxyId_t newParent = AllocateNode();
+
+	Node_t& parentNode = m_Nodes[ newParent ];
+
+	parentNode.iParent = oldParent;
+	parentNode.iChild1 = sibling;
+	parentNode.iChild2 = leaf;
+	parentNode.vecMins = glm::min( m_Nodes[ sibling ].vecMins, vecLeafMins );
+	parentNode.vecMaxs = glm::max( m_Nodes[ sibling ].vecMaxs, vecLeafMaxs );
+
+	if( oldParent != INVALID_PROXY )
+	{
+		if( m_Nodes[ oldParent ].iChild1 == sibling )
+			m_Nodes[ oldParent ].iChild1 = newParent;
+		else
+			m_Nodes[ oldParent ].iChild2 = newParent;
+	}
+	else
+	{
+		m_iRoot = newParent;
+	}
+
+	m_Nodes[ sibling ].iParent = newParent;
+	m_Nodes[ leaf ].iParent = newParent;
+
+	Refit( oldParent );
+}
+
+void CEntityBVH::RemoveLeaf( const ProxyId_t leaf )
+{
+	if( leaf == m_iRoot )
+	{
+		m_iRoot = INVALID_PROXY;
+		return;
+	}
+
+	const ProxyId_t parent = m_Nodes[ leaf ].iParent;
+	const ProxyId_t grandParent = m_Nodes[ parent ].iParent;
+	const ProxyId_t sibling = m_Nodes[ parent ].iChild1 == leaf ? m_Nodes[ parent ].iChild2 : m_Nodes[ parent ].iChild1;
+
+	//Replace the parent with the sibling.
+	if( grandParent != INVALID_PROXY )
+	{
+		if( m_Nodes[ grandParent ].iChild1 == parent )
+			m_Nodes[ grandParent ].iChild1 = sibling;
+		else
+			m_Nodes[ grandParent ].iChild2 = sibling;
+
+		m_Nodes[ sibling ].iParent = grandParent;
+
+		Refit( grandParent );
+	}
+	else
+	{
+		m_iRoot = sibling;
+		m_Nodes[ sibling ].iParent = INVALID_PROXY;
+	}
+
+	FreeNode( parent );
+}
+
+void CEntityBVH::Refit( ProxyId_t node )
+{
+	for( ; node != INVALID_PROXY; node = m_Nodes[ node ].iParent )
+	{
+		Node_t& data = m_Nodes[ node ];
+
+		data.vecMins = glm::min( m_Nodes[ data.iChild1 ].vecMins, m_Nodes[ data.iChild2 ].vecMins );
+		data.vecMaxs = glm::max( m_Nodes[ data.iChild1 ].vecMaxs, m_Nodes[ data.iChild2 ].vecMaxs );
+	}
+}
+
+bool CEntityBVH::RayIntersects( const Node_t& node, const glm::vec3& vecStart, const glm::vec3& vecInvDelta, const float flMaxFraction, float& flEnter )
+{
+	const glm::vec3 vecT1 = ( node.vecMins - vecStart ) * vecInvDelta;
+	const glm::vec3 vecT2 = ( node.vecMaxs - vecStart ) * vecInvDelta;
+
+	const glm::vec3 vecNear = glm::min( vecT1, vecT2 );
+	const glm::vec3 vecFar = glm::max( vecT1, vecT2 );
+
+	flEnter = std::max( std::max( vecNear.x, vecNear.y ), std::max( vecNear.z, 0.0f ) );
+
+	const float flExit = std::min( std::min( vecFar.x, vecFar.y ), std::min( vecFar.z, flMaxFraction ) );
+
+	return flEnter <= flExit;
+}
@@ -0,0 +1,253 @@
+#ifndef GAME_ENTITY_CENTITYBVH_H
+#define GAME_ENTITY_CENTITYBVH_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+
+#include "EHandle.h"
+
+/**
+*	Dynamic bounding volume hierarchy over entity bounds.
+*	Leaves store slightly enlarged bounds, so entities that move a little don't need to be reinserted.
+*	Used to find entities in a view frustum or along a ray without visiting every entity.
+*	Queries share a traversal stack, so the hierarchy must not be queried or modified from inside a query callback.
+*/
+class CEntityBVH final
+{
+public:
+	typedef int ProxyId_t;
+
+	static const ProxyId_t INVALID_PROXY = -1;
+
+private:
+	struct Node_t
+	{
+		glm::vec3 vecMins;
+		glm::vec3 vecMaxs;
+
+		/**
+		*	Parent node, or the next free node if this node is free.
+		*/
+		ProxyId_t iParent;
+
+		ProxyId_t iChild1;
+		ProxyId_t iChild2;
+
+		/**
+		*	Entity stored in this leaf.
+		*/
+		EHandle entity;
+
+		bool IsLeaf() const { return iChild1 == INVALID_PROXY; }
+	};
+
+public:
+	CEntityBVH() = default;
+	~CEntityBVH() = default;
+
+	/**
+	*	@return Number of entities in the hierarchy.
+	*/
+	size_t GetCount() const { return m_uiLeafCount; }
+
+	/**
+	*	Adds an entity with the given bounds.
+	*	@return Proxy that refers to the entity in the hierarchy.
+	*/
+	ProxyId_t Insert( const glm::vec3& vecMins, const glm::vec3& vecMaxs, const EHandle& entity );
+
+	/**
+	*	Removes an entity.
+	*/
+	void Remove( const ProxyId_t proxy );
+
+	/**
+	*	Updates an entity's bounds. The entity is only reinserted if its bounds no longer fit the leaf's enlarged bounds,
+	*	or if the leaf's bounds are much larger than needed.
+	*	@return Whether the entity was reinserted.
+	*/
+	bool Update( const ProxyId_t proxy, const glm::vec3& vecMins, const glm::vec3& vecMaxs );
+
+	/**
+	*	Removes all entities.
+	*/
+	void Clear();
+
+	/**
+	*	Calls func( const EHandle& ) for each entity whose bounds are not completely behind any of the given planes.
+	*	@param pPlanes Planes as ( normal, distance ). Points p with dot( normal, p ) + distance >= 0 are in front of a plane.
+	*	@param uiPlaneCount Number of planes.
+	*/
+	template<typename FUNC>
+	void QueryPlanes( const glm::vec4* pPlanes, const size_t uiPlaneCount, FUNC func ) const;
+
+	/**
+	*	Calls func( const EHandle& ) for each entity whose bounds overlap the given box.
+	*/
+	template<typename FUNC>
+	void QueryBox( const glm::vec3& vecMins, const glm::vec3& vecMaxs, FUNC func ) const;
+
+	/**
+	*	Calls func( const EHandle&, float flFraction ) for each entity whose bounds are hit by the ray vecStart + vecDelta * fraction,
+	*	for fractions between 0 and flMaxFraction. flFraction is where the ray enters the bounds.
+	*	func returns the new maximum fraction, so closest hit searches can skip everything further away. Returning 0 stops the query.
+	*/
+	template<typename FUNC>
+	void QueryRay( const glm::vec3& vecStart, const glm::vec3& vecDelta, float flMaxFraction, FUNC func ) const;
+
+private:
+	ProxyId_t AllocateNode();
+
+	void FreeNode( const ProxyId_t node );
+
+	void InsertLeaf( const ProxyId_t leaf );
+
+	void RemoveLeaf( const ProxyId_t leaf );
+
+	/**
+	*	Recomputes the bounds of node and all of its ancestors.
+	*/
+	void Refit( ProxyId_t node );
+
+	static bool RayIntersects( const Node_t& node, const glm::vec3& vecStart, const glm::vec3& vecInvDelta, const float flMaxFraction, float& flEnter );
+
+private:
+	std::vector<Node_t> m_Nodes;
+
+	ProxyId_t m_iRoot = INVALID_PROXY;
+
+	ProxyId_t m_iFreeList = INVALID_PROXY;
+
+	size_t m_uiLeafCount = 0;
+
+	//Kept around so queries don't allocate.
+	mutable std::vector<ProxyId_t> m_Stack;
+
+private:
+	CEntityBVH( const CEntityBVH& ) = delete;
+	CEntityBVH& operator=( const CEntityBVH& ) = delete;
+};
+
+template<typename FUNC>
+void CEntityBVH::QueryPlanes( const glm::vec4* pPlanes, const size_t uiPlaneCount, FUNC func ) const
+{
+	if( m_iRoot == INVALID_PROXY )
+		return;
+
+	m_Stack.clear();
+	m_Stack.push_back( m_iRoot );
+
+	while( !m_Stack.empty() )
+	{
+		const Node_t& node = m_Nodes[ m_Stack.back() ];
+
+		m_Stack.pop_back();
+
+		bool bOutside = false;
+
+		for( size_t uiPlane = 0; uiPlane < uiPlaneCount; ++uiPlane )
+		{
+			const glm::vec3 vecNormal( pPlanes[ uiPlane ] );
+
+			//The corner furthest along the plane normal.
+			const glm::vec3 vecCorner(
+				vecNormal.x >= 0 ? node.vecMaxs.x : node.vecMins.x,
+				vecNormal.y >= 0 ? node.vecMaxs.y : node.vecMins.y,
+				vecNormal.z >= 0 ? node.vecMaxs.z : node.vecMins.z );
+
+			if( glm::dot( vecNormal, vecCorner ) + pPlanes[ uiPlane ].w < 0 )
+			{
+				bOutside = true;
+				break;
+			}
+		}
+
+		if( bOutside )
+			continue;
+
+		if( node.IsLeaf() )
+		{
+			func( node.entity );
+		}
+		else
+		{
+			m_Stack.push_back( node.iChild1 );
+			m_Stack.push_back( node.iChild2 );
+		}
+	}
+}
+
+template<typename FUNC>
+void CEntityBVH::QueryBox( const glm::vec3& vecMins, const glm::vec3& vecMaxs, FUNC func ) const
+{
+	if( m_iRoot == INVALID_PROXY )
+		return;
+
+	m_Stack.clear();
+	m_Stack.push_back( m_iRoot );
+
+	while( !m_Stack.empty() )
+	{
+		const Node_t& node = m_Nodes[ m_Stack.back() ];
+
+		m_Stack.pop_back();
+
+		if( node.vecMaxs.x < vecMins.x || node.vecMaxs.y < vecMins.y || node.vecMaxs.z < vecMins.z ||
+			vecMaxs.x < node.vecMins.x || vecMaxs.y < node.vecMins.y || vecMaxs.z < node.vecMins.z )
+			continue;
+
+		if( node.IsLeaf() )
+		{
+			func( node.entity );
+		}
+		else
+		{
+			m_Stack.push_back( node.iChild1 );
+			m_Stack.push_back( node.iChild2 );
+		}
+	}
+}
+
+template<typename FUNC>
+void CEntityBVH::QueryRay( const glm::vec3& vecStart, const glm::vec3& vecDelta, float flMaxFraction, FUNC func ) const
+{
+	if( m_iRoot == INVALID_PROXY )
+		return;
+
+	//Division by zero gives infinity, which the slab test handles.
+	const glm::vec3 vecInvDelta( 1.0f / vecDelta.x, 1.0f / vecDelta.y, 1.0f / vecDelta.z );
+
+	m_Stack.clear();
+	m_Stack.push_back( m_iRoot );
+
+	while( !m_Stack.empty() )
+	{
+		const Node_t& node = m_Nodes[ m_Stack.back() ];
+
+		m_Stack.pop_back();
+
+		float flEnter;
+
+		if( !RayIntersects( node, vecStart, vecInvDelta, flMaxFraction, flEnter ) )
+			continue;
+
+		if( node.IsLeaf() )
+		{
+			flMaxFraction = func( node.entity, flEnter );
+
+			if( flMaxFraction <= 0 )
+				return;
+		}
+		else
+		{
+			m_Stack.push_back( node.iChild1 );
+			m_Stack.push_back( node.iChild2 );
+		}
+	}
+}
+
+#endif //GAME_ENTITY_CENTITYBVH_H
@@ -0,0 +1,31 @@
+#include <cassert>
+
+#include "CEntityComponents.h"
+
+void CEntityComponents::Resize( const size_t uiCount )
+{
+	m_Origins.resize( uiCount, glm::vec3( 0.0f ) );
+	m_Angles.resize( uiCount, glm::vec3( 0.0f ) );
+	m_Scales.resize( uiCount, glm::vec3( 1.0f, 1.0f, 1.0f ) );
+
+	m_LastThinkTimes.resize( uiCount, 0.0f );
+	m_NextThinkTimes.resize( uiCount, 0.0f );
+
+	m_Sequences.resize( uiCount, NO_SEQUENCE );
+	m_Frames.resize( uiCount, 0.0f );
+	m_FrameRates.resize( uiCount, 1.0f );
+}
+
+void CEntityComponents::Reset( const entity::EntIndex_t uiIndex )
+{
+	assert( uiIndex < GetCount() );
+
+	SetTransform( uiIndex, glm::vec3( 0.0f ), glm::vec3( 0.0f ), glm::vec3( 1.0f, 1.0f, 1.0f ) );
+
+	m_LastThinkTimes[ uiIndex ] = 0;
+	m_NextThinkTimes[ uiIndex ] = 0;
+
+	m_Sequences[ uiIndex ] = NO_SEQUENCE;
+	m_Frames[ uiIndex ] = 0;
+	m_FrameRates[ uiIndex ] = 1;
+}
@@ -0,0 +1,86 @@
+#ifndef GAME_ENTITY_CENTITYCOMPONENTS_H
+#define GAME_ENTITY_CENTITYCOMPONENTS_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "EntityConstants.h"
+
+/**
+*	Copies of the entity fields that are read every frame, stored in contiguous arrays indexed by entity slot.
+*	Systems that visit many entities can stream through these instead of touching every entity object.
+*	Entities remain the owners of this data; they write changes here as they happen.
+*	Slots that aren't in use hold default values.
+*/
+class CEntityComponents final
+{
+public:
+	/**
+	*	Sequence stored for entities that don't have sequences.
+	*/
+	static const int NO_SEQUENCE = -1;
+
+public:
+	CEntityComponents() = default;
+	~CEntityComponents() = default;
+
+	/**
+	*	@return Number of slots.
+	*/
+	size_t GetCount() const { return m_Origins.size(); }
+
+	/**
+	*	Sets the number of slots. New slots hold default values.
+	*/
+	void Resize( const size_t uiCount );
+
+	/**
+	*	Resets a slot to default values.
+	*/
+	void Reset( const entity::EntIndex_t uiIndex );
+
+	const glm::vec3* GetOrigins() const { return m_Origins.data(); }
+	const glm::vec3* GetAngles() const { return m_Angles.data(); }
+	const glm::vec3* GetScales() const { return m_Scales.data(); }
+
+	const float* GetLastThinkTimes() const { return m_LastThinkTimes.data(); }
+	const float* GetNextThinkTimes() const { return m_NextThinkTimes.data(); }
+
+	const int* GetSequences() const { return m_Sequences.data(); }
+	const float* GetFrames() const { return m_Frames.data(); }
+	const float* GetFrameRates() const { return m_FrameRates.data(); }
+
+	void SetTransform( const entity::EntIndex_t uiIndex, const glm::vec3& vecOrigin, const glm::vec3& vecAngles, const glm::vec3& vecScale )
+	{
+		m_Origins[ uiIndex ] = vecOrigin;
+		m_Angles[ uiIndex ] = vecAngles;
+		m_Scales[ uiIndex ] = vecScale;
+	}
+
+	void SetLastThinkTime( const entity::EntIndex_t uiIndex, const float flTime ) { m_LastThinkTimes[ uiIndex ] = flTime; }
+	void SetNextThinkTime( const entity::EntIndex_t uiIndex, const float flTime ) { m_NextThinkTimes[ uiIndex ] = flTime; }
+
+	void SetSequence( const entity::EntIndex_t uiIndex, const int iSequence ) { m_Sequences[ uiIndex ] = iSequence; }
+	void SetFrame( const entity::EntIndex_t uiIndex, const float flFrame ) { m_Frames[ uiIndex ] = flFrame; }
+	void SetFrameRate( const entity::EntIndex_t uiIndex, const float flFrameRate ) { m_FrameRates[ uiIndex ] = flFrameRate; }
+
+private:
+	std::vector<glm::vec3> m_Origins;
+	std::vector<glm::vec3> m_Angles;
+	std::vector<glm::vec3> m_Scales;
+
+	std::vector<float> m_LastThinkTimes;
+	std::vector<float> m_NextThinkTimes;
+
+	std::vector<int> m_Sequences;
+	std::vector<float> m_Frames;
+	std::vector<float> m_FrameRates;
+
+private:
+	CEntityComponents( const CEntityComponents& ) = delete;
+	CEntityComponents& operator=( const CEntityComponents& ) = delete;
+};
+
+#endif //GAME_ENTITY_CENTITYCOMPONENTS_H
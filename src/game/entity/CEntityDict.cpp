@@ -26,7 +26,13 @@ const CBaseEntityRegistry* CEntityDict::FindEntity( const char* const pszClassNa
 {
 	assert( pszClassName );
 
-	auto it = m_Dict.find( pszClassName );
+	//Class names are interned when they're added, so names that aren't in the pool aren't registered either.
+	const StringId_t id = StringPool().Find( pszClassName );
+
+	if( id == INVALID_STRING_ID )
+		return nullptr;
+
+	auto it = m_Dict.find( id );
 
 	return it != m_Dict.end() ? it->second : nullptr;
 }
@@ -42,7 +48,7 @@ bool CEntityDict::AddEntity( const CBaseEntityRegistry* pRegistry )
 		return false;
 	}
 
-	m_Dict.insert( std::make_pair( pRegistry->GetClassname(), pRegistry ) );
+	m_Dict.insert( std::make_pair( StringPool().Intern( pRegistry->GetClassname() ), pRegistry ) );
 
 	return true;
 }
@@ -80,4 +86,24 @@ void CEntityDict::DestroyEntity( CBaseEntity* pEntity ) const
 	pEntity->OnDestroy();
 
 	pReg->Destroy( pEntity );
+}
+
+bool CEntityDict::ReserveEntities( const char* const pszClassName, const size_t uiCount ) const
+{
+	const auto pReg = FindEntity( pszClassName );
+
+	if( !pReg )
+		return false;
+
+	pReg->Reserve( uiCount );
+
+	return true;
+}
+
+void CEntityDict::ReserveAllEntities( const size_t uiCount ) const
+{
+	for( const auto& entry : m_Dict )
+	{
+		entry.second->Reserve( uiCount );
+	}
 }
\ No newline at end of file
@@ -2,9 +2,12 @@
 #define GAME_ENTITY_CENTITYDICT_H
 
 #include <cassert>
+#include <new>
 #include <unordered_map>
 
-#include "utility/StringUtils.h"
+#include "shared/CStringPool.h"
+
+#include "CEntityPool.h"
 
 class CBaseEntity;
 class CBaseEntityRegistry;
@@ -15,7 +18,10 @@ class CBaseEntityRegistry;
 class CEntityDict final
 {
 private:
-	typedef std::unordered_map<const char*, const CBaseEntityRegistry*, Hash_C_String<const char*>, EqualTo_C_String<const char*>> EntityDict_t;
+	/**
+	*	Registries keyed by the string pool id of their class name.
+	*/
+	typedef std::unordered_map<StringId_t, const CBaseEntityRegistry*> EntityDict_t;
 
 public:
 	CEntityDict() = default;
@@ -51,6 +57,17 @@ public:
 	*/
 	void DestroyEntity( CBaseEntity* pEntity ) const;
 
+	/**
+	*	Makes sure that uiCount entities of the given type can exist without allocating more memory.
+	*	@return Whether the entity type exists.
+	*/
+	bool ReserveEntities( const char* const pszClassName, const size_t uiCount ) const;
+
+	/**
+	*	Makes sure that uiCount entities of every type can exist without allocating more memory.
+	*/
+	void ReserveAllEntities( const size_t uiCount ) const;
+
 private:
 	EntityDict_t m_Dict;
 
@@ -66,15 +83,17 @@ CEntityDict& GetEntityDict();
 
 /**
 *	Base class for the entity registry.
+*	Each registry has a pool that its entities are allocated from.
 *	Abstract.
 */
 class CBaseEntityRegistry
 {
 public:
-	CBaseEntityRegistry( const char* const pszClassname, const char* const pszInternalname, const size_t uiSizeInBytes )
+	CBaseEntityRegistry( const char* const pszClassname, const char* const pszInternalname, const size_t uiSizeInBytes, const size_t uiAlignment )
 		: m_pszClassname( pszClassname )
 		, m_pszInternalname( pszInternalname )
 		, m_uiSizeInBytes( uiSizeInBytes )
+		, m_Pool( uiSizeInBytes, uiAlignment )
 	{
 		assert( pszClassname );
 		assert( pszInternalname );
@@ -98,6 +117,16 @@ public:
 	*/
 	size_t GetSize() const { return m_uiSizeInBytes; }
 
+	/**
+	*	Gets the pool that entities of this type are allocated from.
+	*/
+	const CEntityPool& GetPool() const { return m_Pool; }
+
+	/**
+	*	Makes sure that uiCount entities of this type can exist without allocating more memory.
+	*/
+	void Reserve( const size_t uiCount ) const { m_Pool.Reserve( uiCount ); }
+
 	/**
 	*	Creates an instance of the entity represented by this registry.
 	*/
@@ -108,11 +137,19 @@ public:
 	*/
 	virtual void Destroy( CBaseEntity* pEntity ) const = 0;
 
+protected:
+	void* AllocateMemory() const { return m_Pool.Allocate(); }
+
+	void FreeMemory( void* pMemory ) const { m_Pool.Free( pMemory ); }
+
 private:
 	const char* const m_pszClassname;
 	const char* const m_pszInternalname;
 	const size_t m_uiSizeInBytes;
 
+	//Creating and destroying entities doesn't change the registry itself.
+	mutable CEntityPool m_Pool;
+
 private:
 	CBaseEntityRegistry( const CBaseEntityRegistry& ) = delete;
 	CBaseEntityRegistry& operator=( const CBaseEntityRegistry& ) = delete;
@@ -126,20 +163,25 @@ class CEntityRegistry final : public CBaseEntityRegistry
 {
 public:
 	CEntityRegistry( const char* const pszClassname, const char* const pszInternalname )
-		: CBaseEntityRegistry( pszClassname, pszInternalname, sizeof( ENTITY ) )
+		: CBaseEntityRegistry( pszClassname, pszInternalname, sizeof( ENTITY ), alignof( ENTITY ) )
 	{
 	}
 
 	CBaseEntity* Create() const override final
 	{
-		return static_cast<CBaseEntity*>( new ENTITY() );
+		return static_cast<CBaseEntity*>( new ( AllocateMemory() ) ENTITY() );
 	}
 
 	void Destroy( CBaseEntity* pEntity ) const override final
 	{
 		assert( pEntity );
 
-		delete pEntity;
+		//Destroy as the most derived type, since the destructor isn't virtual.
+		ENTITY* pObject = static_cast<ENTITY*>( pEntity );
+
+		pObject->~ENTITY();
+
+		FreeMemory( pObject );
 	}
 
 private:
@@ -1,13 +1,35 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
 #include "shared/CWorldTime.h"
+#include "shared/Logging.h"
+#include "shared/TaskScheduler.h"
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
 
 #include "CBaseEntity.h"
 #include "CBaseEntityList.h"
+#include "CEntityComponents.h"
+#include "CEntityDict.h"
 
 #include "CEntityManager.h"
 
 namespace
 {
 static CEntityManager g_EntityManager;
+
+static cvar::CConCommand ent_posestats( "ent_posestats",
+	[]( const util::CCommand& args )
+	{
+		g_EntityManager.ReportPoseStats();
+
+		if( args.ArgC() >= 2 && !strcmp( args.Arg( 1 ), "reset" ) )
+			g_EntityManager.GetSharedPoses().ResetStats();
+	},
+	cvar::Flag::NONE, "Prints how many entity poses were shared instead of being set up again. Usage: ent_posestats [reset]" );
 }
 
 CEntityManager& EntityManager()
@@ -32,10 +54,13 @@ void CEntityManager::Shutdown()
 {
 }
 
-bool CEntityManager::OnMapBegin()
+bool CEntityManager::OnMapBegin( const size_t uiReservePerClass )
 {
 	assert( !m_bMapRunning );
 
+	//Spawning entities during the map then doesn't need to allocate memory.
+	GetEntityDict().ReserveAllEntities( uiReservePerClass );
+
 	m_bMapRunning = true;
 
 	return true;
@@ -48,33 +73,321 @@ void CEntityManager::OnMapEnd()
 	m_bMapRunning = false;
 
 	GetEntityList().RemoveAll();
+
+	ClearSchedules();
+
+	//Models can be unloaded after this, so keys must not be matched against new models at the same address.
+	m_SharedPoses.Clear();
 }
 
 void CEntityManager::RunFrame()
 {
-	for( EHandle entity = GetEntityList().GetFirstEntity(); entity; entity = GetEntityList().GetNextEntity( entity ) )
+	//With a fixed time step, frames that didn't advance time have nothing to simulate.
+	if( WorldTime.GetFixedStep() <= 0 || WorldTime.GetFrameTime() > 0 )
+		RunThink();
+
+	RemoveKilledEntities();
+
+	//Bounds can depend on the pose set up while preparing.
+	PrepareDraw();
+
+	UpdateBounds();
+}
+
+void CEntityManager::ScheduleEntity( CBaseEntity* pEntity )
+{
+	assert( pEntity );
+
+	if( pEntity->AnyFlagsSet( entity::FL_ALWAYSTHINK ) )
+		ScheduleAlwaysThink( pEntity );
+
+	if( pEntity->GetNextThinkTime() != 0 )
+		ScheduleThink( pEntity );
+
+	if( pEntity->AnyFlagsSet( entity::FL_KILLME ) )
+		ScheduleRemove( pEntity );
+
+	MarkBoundsDirty( pEntity );
+}
+
+void CEntityManager::ScheduleAlwaysThink( CBaseEntity* pEntity )
+{
+	assert( pEntity );
+
+	if( pEntity->m_bInAlwaysThinkList )
+		return;
+
+	pEntity->m_bInAlwaysThinkList = true;
+
+	m_AlwaysThink.push_back( pEntity );
+}
+
+void CEntityManager::ScheduleThink( CBaseEntity* pEntity )
+{
+	assert( pEntity );
+
+	m_ThinkQueue.push( { pEntity->GetNextThinkTime(), pEntity } );
+}
+
+void CEntityManager::ScheduleRemove( CBaseEntity* pEntity )
+{
+	assert( pEntity );
+
+	m_KillList.push_back( pEntity );
+}
+
+void CEntityManager::MarkBoundsDirty( CBaseEntity* pEntity )
+{
+	assert( pEntity );
+
+	if( pEntity->m_bBoundsDirty )
+		return;
+
+	pEntity->m_bBoundsDirty = true;
+
+	m_DirtyBounds.push_back( pEntity );
+}
+
+void CEntityManager::OnEntityRemoved( CBaseEntity* pEntity )
+{
+	assert( pEntity );
+
+	if( pEntity->m_iBVHProxy != CEntityBVH::INVALID_PROXY )
+	{
+		m_BVH.Remove( pEntity->m_iBVHProxy );
+		pEntity->m_iBVHProxy = CEntityBVH::INVALID_PROXY;
+	}
+}
+
+void CEntityManager::UpdateBounds()
+{
+	glm::vec3 vecMins, vecMaxs;
+
+	for( const auto& handle : m_DirtyBounds )
+	{
+		CBaseEntity* pEntity = handle;
+
+		//Removed since it was marked.
+		if( !pEntity )
+			continue;
+
+		pEntity->m_bBoundsDirty = false;
+
+		pEntity->GetWorldBounds( vecMins, vecMaxs );
+
+		if( pEntity->m_iBVHProxy == CEntityBVH::INVALID_PROXY )
+			pEntity->m_iBVHProxy = m_BVH.Insert( vecMins, vecMaxs, handle );
+		else
+			m_BVH.Update( pEntity->m_iBVHProxy, vecMins, vecMaxs );
+	}
+
+	m_DirtyBounds.clear();
+}
+
+CBaseEntity* CEntityManager::PickEntity( const glm::vec3& vecStart, const glm::vec3& vecDelta, float* flFraction )
+{
+	UpdateBounds();
+
+	CBaseEntity* pClosest = nullptr;
+	float flClosest = 1.0f;
+
+	m_BVH.QueryRay( vecStart, vecDelta, 1.0f,
+		[ & ]( const EHandle& entity, const float )
+		{
+			CBaseEntity* pEntity = entity;
+
+			if( !pEntity )
+				return flClosest;
+
+			//Leaves are enlarged, so test the entity's actual bounds.
+			glm::vec3 vecMins, vecMaxs;
+
+			pEntity->GetWorldBounds( vecMins, vecMaxs );
+
+			float flNear = 0.0f;
+			float flFar = flClosest;
+
+			for( int iAxis = 0; iAxis < 3; ++iAxis )
+			{
+				if( vecDelta[ iAxis ] == 0 )
+				{
+					if( vecStart[ iAxis ] < vecMins[ iAxis ] || vecMaxs[ iAxis ] < vecStart[ iAxis ] )
+						return flClosest;
+
+					continue;
+				}
+
+				float flT1 = ( vecMins[ iAxis ] - vecStart[ iAxis ] ) / vecDelta[ iAxis ];
+				float flT2 = ( vecMaxs[ iAxis ] - vecStart[ iAxis ] ) / vecDelta[ iAxis ];
+
+				if( flT1 > flT2 )
+					std::swap( flT1, flT2 );
+
+				flNear = std::max( flNear, flT1 );
+				flFar = std::min( flFar, flT2 );
+
+				if( flNear > flFar )
+					return flClosest;
+			}
+
+			pClosest = pEntity;
+			flClosest = flNear;
+
+			return flClosest;
+		}
+	);
+
+	if( flFraction )
+		*flFraction = flClosest;
+
+	return pClosest;
+}
+
+void CEntityManager::RunThink()
+{
+	//Think times are relative to the map, so they're kept as floats.
+	const float flCurTime = static_cast<float>( WorldTime.GetCurrentTime() );
+
+	//Entities with a next think time only think once per frame.
+	const float flPrevFrameTime = flCurTime - WorldTime.GetFrameTime();
+
+	//Entities can be added while thinking, so don't cache the size.
+	for( size_t uiIndex = 0; uiIndex < m_AlwaysThink.size(); )
+	{
+		CBaseEntity* pEntity = m_AlwaysThink[ uiIndex ];
+
+		if( !pEntity || !pEntity->AnyFlagsSet( entity::FL_ALWAYSTHINK ) )
+		{
+			if( pEntity )
+				pEntity->m_bInAlwaysThinkList = false;
+
+			m_AlwaysThink[ uiIndex ] = m_AlwaysThink.back();
+			m_AlwaysThink.pop_back();
+			continue;
+		}
+
+		++uiIndex;
+
+		//Set first so entities can do lastthink + delay.
+		pEntity->SetLastThinkTime( flCurTime );
+		pEntity->SetNextThinkTime( 0 );
+
+		pEntity->Think();
+	}
+
+	//Think times are checked in the component arrays, so stale entries don't touch the entity itself.
+	const CEntityComponents& components = GetEntityList().GetComponents();
+
+	while( !m_ThinkQueue.empty() && m_ThinkQueue.top().flTime <= flCurTime )
 	{
-		CBaseEntity* pEntity = entity;
+		const ScheduledThink_t scheduled = m_ThinkQueue.top();
 
-		if( pEntity->AnyFlagsSet( entity::FL_ALWAYSTHINK ) ||
-			( pEntity->GetNextThinkTime() != 0 && 
-			pEntity->GetNextThinkTime() <= WorldTime.GetCurrentTime() && 
-			( WorldTime.GetCurrentTime() - WorldTime.GetFrameTime() ) >= pEntity->GetLastThinkTime() ) )
+		m_ThinkQueue.pop();
+
+		CBaseEntity* pEntity = scheduled.entity;
+
+		if( !pEntity )
+			continue;
+
+		const entity::EntIndex_t uiEntIndex = scheduled.entity.GetEntIndex();
+
+		//Rescheduled since, or thought this frame because it always thinks.
+		if( components.GetNextThinkTimes()[ uiEntIndex ] != scheduled.flTime )
+			continue;
+
+		if( flPrevFrameTime < components.GetLastThinkTimes()[ uiEntIndex ] )
 		{
-			//Set first so entities can do lastthink + delay.
-			pEntity->SetLastThinkTime( WorldTime.GetCurrentTime() );
-			pEntity->SetNextThinkTime( 0 );
+			m_DeferredThinks.push_back( scheduled );
+			continue;
+		}
+
+		pEntity->SetLastThinkTime( flCurTime );
+		pEntity->SetNextThinkTime( 0 );
+
+		pEntity->Think();
+	}
+
+	for( const auto& scheduled : m_DeferredThinks )
+	{
+		m_ThinkQueue.push( scheduled );
+	}
+
+	m_DeferredThinks.clear();
+}
+
+void CEntityManager::RemoveKilledEntities()
+{
+	//Removing an entity can flag others, so don't cache the size.
+	for( size_t uiIndex = 0; uiIndex < m_KillList.size(); ++uiIndex )
+	{
+		CBaseEntity* pEntity = m_KillList[ uiIndex ];
 
-			pEntity->Think();
+		if( pEntity && pEntity->AnyFlagsSet( entity::FL_KILLME ) )
+		{
+			GetEntityList().Remove( pEntity );
 		}
 	}
 
-	//Remove all entities flagged with FL_KILLME.
+	m_KillList.clear();
+}
+
+void CEntityManager::ClearSchedules()
+{
+	m_AlwaysThink.clear();
+	m_ThinkQueue = decltype( m_ThinkQueue )();
+	m_DeferredThinks.clear();
+	m_KillList.clear();
+
+	for( const auto& handle : m_DirtyBounds )
+	{
+		if( CBaseEntity* pEntity = handle )
+			pEntity->m_bBoundsDirty = false;
+	}
+
+	m_DirtyBounds.clear();
+	m_BVH.Clear();
+}
+
+void CEntityManager::PrepareDraw()
+{
+	m_SharedPoses.BeginFrame();
+
+	m_PrepareEntities.clear();
+
 	for( EHandle entity = GetEntityList().GetFirstEntity(); entity; entity = GetEntityList().GetNextEntity( entity ) )
 	{
-		if( entity->GetFlags() & entity::FL_KILLME )
+		m_PrepareEntities.push_back( entity );
+	}
+
+	tasks::ParallelFor( m_PrepareEntities.size(), 
+		[ this ]( const size_t uiIndex )
 		{
-			GetEntityList().Remove( entity );
+			m_PrepareEntities[ uiIndex ]->PrepareDraw();
+		},
+		0, "PrepareEntities"
+	);
+
+	for( auto pEntity : m_PrepareEntities )
+	{
+		if( pEntity->m_bPreparedBoundsChanged )
+		{
+			pEntity->m_bPreparedBoundsChanged = false;
+			MarkBoundsDirty( pEntity );
 		}
 	}
-}
\ No newline at end of file
+}
+
+void CEntityManager::ReportPoseStats() const
+{
+	const auto printStats = []( const char* const pszName, const studiomdl::CSharedPoseTable::Stats_t& stats )
+	{
+		const float flHitRate = stats.uiRequests > 0 ? 100.0f * stats.uiHits / stats.uiRequests : 0.0f;
+
+		Message( "%s: %u pose requests, %u shared (%.1f%%), %u set up\n", pszName,
+				 static_cast<unsigned int>( stats.uiRequests ), static_cast<unsigned int>( stats.uiHits ), flHitRate,
+				 static_cast<unsigned int>( stats.uiRequests - stats.uiHits ) );
+	};
+
+	printStats( "Last frame", m_SharedPoses.GetLastFrameStats() );
+	printStats( "Total", m_SharedPoses.GetTotalStats() );
+}
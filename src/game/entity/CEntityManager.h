@@ -1,11 +1,40 @@
 #ifndef GAME_ENTITY_CENTITYMANAGER_H
 #define GAME_ENTITY_CENTITYMANAGER_H
 
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "shared/studiomodel/CSharedPoseTable.h"
+
+#include "CEntityBVH.h"
+#include "CEntityPool.h"
+#include "EHandle.h"
+
+class CBaseEntity;
+
 /**
 *	Manages entities.
+*	Thinking is scheduled: entities that always think are kept in a list, entities with a next think time in a queue ordered by that time.
+*	Entities flagged for removal are kept in a list as well, so a frame only visits entities that have something to do.
+*	Entity bounds are kept in a bounding volume hierarchy that is brought up to date every frame before drawing.
 */
 class CEntityManager final
 {
+private:
+	struct ScheduledThink_t
+	{
+		float flTime;
+		EHandle entity;
+
+		bool operator>( const ScheduledThink_t& other ) const
+		{
+			return flTime > other.flTime;
+		}
+	};
+
 public:
 	CEntityManager();
 	~CEntityManager();
@@ -28,8 +57,9 @@ public:
 
 	/**
 	*	Called when a map begins.
+	*	@param uiReservePerClass Number of entities of each class to allocate memory for up front.
 	*/
-	bool OnMapBegin();
+	bool OnMapBegin( const size_t uiReservePerClass = CEntityPool::MIN_CHUNK_COUNT );
 
 	/**
 	*	Called when a map ends. Removes all entities.
@@ -38,12 +68,126 @@ public:
 
 	/**
 	*	Runs a single frame for all entities. Removes entities flagged as needing removal.
+	*	Once all entities have thought, draw preparation is run for all entities in parallel.
 	*/
 	void RunFrame();
 
+	/**
+	*	Schedules everything the entity's current state asks for. Called when an entity is added.
+	*/
+	void ScheduleEntity( CBaseEntity* pEntity );
+
+	/**
+	*	Adds an entity that has FL_ALWAYSTHINK set to the always think list.
+	*/
+	void ScheduleAlwaysThink( CBaseEntity* pEntity );
+
+	/**
+	*	Schedules an entity to think at its next think time.
+	*/
+	void ScheduleThink( CBaseEntity* pEntity );
+
+	/**
+	*	Schedules an entity that has FL_KILLME set for removal at the end of the frame.
+	*/
+	void ScheduleRemove( CBaseEntity* pEntity );
+
+	/**
+	*	Marks an entity's bounds as changed. The hierarchy is updated once per frame, so this can be called any number of times.
+	*/
+	void MarkBoundsDirty( CBaseEntity* pEntity );
+
+	/**
+	*	Called by the entity list when an entity is about to be destroyed.
+	*/
+	void OnEntityRemoved( CBaseEntity* pEntity );
+
+	/**
+	*	Gets the hierarchy of entity bounds. Up to date after RunFrame, or after calling UpdateBounds.
+	*/
+	const CEntityBVH& GetBVH() const { return m_BVH; }
+
+	/**
+	*	Updates the hierarchy for all entities whose bounds have changed.
+	*/
+	void UpdateBounds();
+
+	/**
+	*	Finds the entity whose bounds are hit first by the ray vecStart + vecDelta * fraction, for fractions between 0 and 1.
+	*	@param flFraction Optional. Where the ray enters the entity's bounds.
+	*	@return The entity, or null if no entity was hit.
+	*/
+	CBaseEntity* PickEntity( const glm::vec3& vecStart, const glm::vec3& vecDelta, float* flFraction = nullptr );
+
+	/**
+	*	Gets the table that studio model entities share poses through, so entities playing the same sequence in step only set up bones once.
+	*/
+	studiomdl::CSharedPoseTable& GetSharedPoses() { return m_SharedPoses; }
+
+	/**
+	*	Prints how many pose requests were shared during the last frame and since the statistics were reset.
+	*/
+	void ReportPoseStats() const;
+
+private:
+	/**
+	*	Runs think functions for all entities that should think this frame.
+	*/
+	void RunThink();
+
+	/**
+	*	Removes entities flagged with FL_KILLME.
+	*/
+	void RemoveKilledEntities();
+
+	/**
+	*	Clears all schedules.
+	*/
+	void ClearSchedules();
+
+	/**
+	*	Calls PrepareDraw on all entities, spread out over the task scheduler's threads.
+	*/
+	void PrepareDraw();
+
 private:
 	bool m_bMapRunning = false;
 
+	/**
+	*	Entities to prepare this frame. Kept around to avoid reallocating every frame.
+	*/
+	std::vector<CBaseEntity*> m_PrepareEntities;
+
+	/**
+	*	Entities that think every frame. Entities that no longer have FL_ALWAYSTHINK set are removed while thinking.
+	*/
+	std::vector<EHandle> m_AlwaysThink;
+
+	/**
+	*	Entities with a next think time, earliest first.
+	*	Entries whose time no longer matches the entity's next think time are stale and skipped.
+	*/
+	std::priority_queue<ScheduledThink_t, std::vector<ScheduledThink_t>, std::greater<ScheduledThink_t>> m_ThinkQueue;
+
+	/**
+	*	Entries that were due, but whose entity already thought this frame.
+	*/
+	std::vector<ScheduledThink_t> m_DeferredThinks;
+
+	/**
+	*	Entities flagged for removal.
+	*/
+	std::vector<EHandle> m_KillList;
+
+	CEntityBVH m_BVH;
+
+	studiomdl::CSharedPoseTable m_SharedPoses;
+
+	/**
+	*	Entities whose bounds have changed since the hierarchy was last updated.
+	*/
+	std::vector<EHandle> m_DirtyBounds;
+
 private:
 	CEntityManager( const CEntityManager& ) = delete;
 	CEntityManager& operator=( const CEntityManager& ) = delete;
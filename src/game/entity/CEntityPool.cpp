@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include "shared/MemoryStats.h"
+
+#include "CEntityPool.h"
+
+namespace
+{
+size_t GetSlotAlignment( const size_t uiAlignment )
+{
+	//Free slots store a pointer in the object's memory.
+	return std::max( uiAlignment, alignof( void* ) );
+}
+
+size_t GetSlotSize( const size_t uiObjectSize, const size_t uiAlignment )
+{
+	const size_t uiSlotAlignment = GetSlotAlignment( uiAlignment );
+
+	return ( std::max( uiObjectSize, sizeof( void* ) ) + uiSlotAlignment - 1 ) & ~( uiSlotAlignment - 1 );
+}
+}
+
+CEntityPool::CEntityPool( const size_t uiObjectSize, const size_t uiAlignment )
+	: m_uiSlotSize( GetSlotSize( uiObjectSize, uiAlignment ) )
+	, m_uiAlignment( GetSlotAlignment( uiAlignment ) )
+{
+	assert( uiObjectSize > 0 );
+	assert( ( uiAlignment & ( uiAlignment - 1 ) ) == 0 );
+}
+
+CEntityPool::~CEntityPool()
+{
+	//Objects still in use belong to entities that were never destroyed; their memory goes away with the chunks.
+	mem::Add( mem::Category::ENTITIES, -static_cast<int64_t>( m_uiAllocatedSize ) );
+}
+
+void* CEntityPool::Allocate()
+{
+	if( !m_pFreeList )
+		AddChunk( std::max( m_uiCapacity, static_cast<size_t>( MIN_CHUNK_COUNT ) ) );
+
+	FreeSlot_t* pSlot = m_pFreeList;
+
+	m_pFreeList = pSlot->pNext;
+
+	++m_uiUsedCount;
+
+	return pSlot;
+}
+
+void CEntityPool::Free( void* pObject )
+{
+	assert( pObject );
+	assert( m_uiUsedCount > 0 );
+
+	FreeSlot_t* pSlot = static_cast<FreeSlot_t*>( pObject );
+
+	pSlot->pNext = m_pFreeList;
+	m_pFreeList = pSlot;
+
+	--m_uiUsedCount;
+}
+
+void CEntityPool::Reserve( const size_t uiCount )
+{
+	if( uiCount > m_uiCapacity )
+		AddChunk( std::max( uiCount - m_uiCapacity, static_cast<size_t>( MIN_CHUNK_COUNT ) ) );
+}
+
+void CEntityPool::AddChunk( const size_t uiCount )
+{
+	assert( uiCount > 0 );
+
+	//Over-allocate so the first slot can be aligned.
+	const size_t uiChunkSize = uiCount * m_uiSlotSize + m_uiAlignment - 1;
+
+	std::unique_ptr<unsigned char[]> chunk( new unsigned char[ uiChunkSize ] );
+
+	const uintptr_t uiStart = ( reinterpret_cast<uintptr_t>( chunk.get() ) + m_uiAlignment - 1 ) & ~static_cast<uintptr_t>( m_uiAlignment - 1 );
+
+	unsigned char* const pStart = reinterpret_cast<unsigned char*>( uiStart );
+
+	//Link in reverse so objects are handed out in address order.
+	for( size_t uiIndex = uiCount; uiIndex-- > 0; )
+	{
+		FreeSlot_t* pSlot = reinterpret_cast<FreeSlot_t*>( pStart + uiIndex * m_uiSlotSize );
+
+		pSlot->pNext = m_pFreeList;
+		m_pFreeList = pSlot;
+	}
+
+	m_Chunks.emplace_back( std::move( chunk ) );
+
+	m_uiCapacity += uiCount;
+	m_uiAllocatedSize += uiChunkSize;
+
+	mem::Add( mem::Category::ENTITIES, static_cast<int64_t>( uiChunkSize ) );
+}
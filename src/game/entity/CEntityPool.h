@@ -0,0 +1,87 @@
+#ifndef GAME_ENTITY_CENTITYPOOL_H
+#define GAME_ENTITY_CENTITYPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+*	Slab allocator for objects of a single size. Memory is allocated in chunks and freed objects are reused,
+*	so creating objects normally doesn't touch the global allocator. Objects allocated together are kept next to each other.
+*	Only provides memory; constructing and destroying objects is up to the caller.
+*/
+class CEntityPool final
+{
+public:
+	/**
+	*	Minimum number of objects allocated at once.
+	*/
+	static const size_t MIN_CHUNK_COUNT = 32;
+
+private:
+	struct FreeSlot_t
+	{
+		FreeSlot_t* pNext;
+	};
+
+public:
+	/**
+	*	@param uiObjectSize Size of each object, in bytes.
+	*	@param uiAlignment Alignment of each object. Must be a power of 2.
+	*/
+	CEntityPool( const size_t uiObjectSize, const size_t uiAlignment );
+	~CEntityPool();
+
+	/**
+	*	@return Number of objects that can be allocated without allocating more memory, including ones that are in use.
+	*/
+	size_t GetCapacity() const { return m_uiCapacity; }
+
+	/**
+	*	@return Number of objects that are in use.
+	*/
+	size_t GetUsedCount() const { return m_uiUsedCount; }
+
+	/**
+	*	Allocates memory for one object.
+	*/
+	void* Allocate();
+
+	/**
+	*	Frees memory returned by Allocate.
+	*/
+	void Free( void* pObject );
+
+	/**
+	*	Makes sure that at least uiCount objects can exist without allocating more memory.
+	*/
+	void Reserve( const size_t uiCount );
+
+private:
+	/**
+	*	Allocates a chunk with room for uiCount objects and adds them to the free list.
+	*/
+	void AddChunk( const size_t uiCount );
+
+private:
+	const size_t m_uiSlotSize;
+	const size_t m_uiAlignment;
+
+	std::vector<std::unique_ptr<unsigned char[]>> m_Chunks;
+
+	FreeSlot_t* m_pFreeList = nullptr;
+
+	size_t m_uiCapacity = 0;
+	size_t m_uiUsedCount = 0;
+
+	/**
+	*	Total size of all chunks, in bytes.
+	*/
+	size_t m_uiAllocatedSize = 0;
+
+private:
+	CEntityPool( const CEntityPool& ) = delete;
+	CEntityPool& operator=( const CEntityPool& ) = delete;
+};
+
+#endif //GAME_ENTITY_CENTITYPOOL_H
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cmath>
+
 #include "shared/CWorldTime.h"
 
 #include "engine/shared/sprite/sprite.h"
@@ -10,6 +13,14 @@
 //TODO: remove
 extern sprite::ISpriteRenderer* g_pSpriteRenderer;
 
+namespace
+{
+/**
+*	Frames per second that sprites animate at.
+*/
+const float SPRITE_FRAMERATE = 10;
+}
+
 LINK_ENTITY_TO_CLASS( sprite, CSpriteEntity );
 
 void CSpriteEntity::OnDestroy()
@@ -21,9 +32,8 @@ void CSpriteEntity::OnDestroy()
 
 bool CSpriteEntity::Spawn()
 {
-	SetThink( &ThisClass::AnimThink );
-
-	SetFlags( entity::FL_ALWAYSTHINK );
+	//No think; the animation is a function of time, so thousands of sprites cost nothing until they're drawn.
+	m_flAnimStartTime = WorldTime.GetCurrentTime();
 
 	return true;
 }
@@ -41,20 +51,43 @@ void CSpriteEntity::Draw( renderer::DrawFlags_t flags )
 	info.flTransparency = GetTransparency();
 
 	info.flFrame = GetFrame();
+	info.flFrameRate = SPRITE_FRAMERATE;
+	info.flAnimStartTime = m_flAnimStartTime;
 
 	g_pSpriteRenderer->DrawSprite( &info, flags );
 }
 
-void CSpriteEntity::AnimThink()
+void CSpriteEntity::GetWorldBounds( glm::vec3& vecMins, glm::vec3& vecMaxs ) const
 {
-	m_flFrame += WorldTime.GetFrameTime() * 10;
+	if( !m_pSprite )
+	{
+		BaseClass::GetWorldBounds( vecMins, vecMaxs );
+		return;
+	}
+
+	const glm::vec3& vecScale = GetScale();
+
+	const float flScale = std::max( std::max( std::abs( vecScale.x ), std::abs( vecScale.y ) ), std::abs( vecScale.z ) );
 
-	if( m_flFrame >= m_pSprite->numframes )
-		m_flFrame = 0;
+	//Half of the diagonal, so the frame fits at any angle.
+	const float flRadius = 0.5f * flScale * std::sqrt( static_cast<float>( m_pSprite->maxwidth * m_pSprite->maxwidth + m_pSprite->maxheight * m_pSprite->maxheight ) );
+
+	vecMins = GetOrigin() - flRadius;
+	vecMaxs = GetOrigin() + flRadius;
+}
+
+float CSpriteEntity::GetCurrentFrame() const
+{
+	if( !m_pSprite )
+		return GetFrame();
+
+	return sprite::GetAnimatedFrame( m_pSprite, GetFrame(), SPRITE_FRAMERATE, WorldTime.GetCurrentTime() - m_flAnimStartTime );
 }
 
 void CSpriteEntity::SetSprite( sprite::msprite_t* pSprite )
 {
 	//TODO: release old sprite
 	m_pSprite = pSprite;
+
+	BoundsChanged();
 }
\ No newline at end of file
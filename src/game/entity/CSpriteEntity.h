@@ -19,7 +19,16 @@ public:
 
 	virtual void Draw( renderer::DrawFlags_t flags ) override;
 
-	void AnimThink();
+	/**
+	*	Sprites can face any direction, so the bounds are a cube around the origin that fits the largest frame.
+	*/
+	virtual void GetWorldBounds( glm::vec3& vecMins, glm::vec3& vecMaxs ) const override;
+
+	/**
+	*	Sprites aren't stepped every frame; the frame is derived from the time the animation started, by the renderer when drawing.
+	*	@return The frame shown at the current time.
+	*/
+	float GetCurrentFrame() const;
 
 	sprite::msprite_t* GetSprite() const { return m_pSprite; }
 
@@ -27,6 +36,11 @@ public:
 
 private:
 	sprite::msprite_t* m_pSprite = nullptr;
+
+	/**
+	*	World time that the animation started at.
+	*/
+	double m_flAnimStartTime = 0;
 };
 
 #endif //GAME_ENTITY_CSPRITEENTITY_H
\ No newline at end of file
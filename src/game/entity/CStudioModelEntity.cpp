@@ -1,21 +1,42 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
 
 #include "shared/Logging.h"
 #include "shared/CWorldTime.h"
 
+#include "utility/mathlib.h"
+
+#include "cvar/CCVar.h"
+
 #include "shared/studiomodel/CStudioModel.h"
 
 #include "shared/renderer/studiomodel/IStudioModelRenderer.h"
 
+#include "CBaseEntityList.h"
+#include "CEntityComponents.h"
+#include "CEntityManager.h"
+
 #include "CStudioModelEntity.h"
 
+static cvar::CCVar ent_skinnedbounds( "ent_skinnedbounds",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "If non-zero, studio model bounds are computed from the current pose instead of taken from the sequence" ) );
+
 //TODO: remove
 extern studiomdl::IStudioModelRenderer* g_pStudioMdlRenderer;
 
 void CStudioModelEntity::OnDestroy()
 {
-	//TODO: once models are managed by a cache, don't do this
-	delete m_pModel;
+	SetPoseTrack( nullptr );
+	m_Model.reset();
 
 	BaseClass::OnDestroy();
 }
@@ -29,7 +50,7 @@ bool CStudioModelEntity::Spawn()
 	SetController( 3, 0.0f );
 	SetMouth( 0.0f );
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	for( int n = 0; n < pStudioHdr->numbodyparts; ++n )
 		SetBodygroup( n, 0 );
@@ -43,6 +64,123 @@ void CStudioModelEntity::Draw( renderer::DrawFlags_t flags )
 {
 	studiomdl::CModelRenderInfo renderInfo;
 
+	GetRenderInfo( renderInfo );
+
+	if( m_PoseContext && m_PoseContext->Matches( renderInfo ) )
+	{
+		g_pStudioMdlRenderer->DrawPosedModel( &renderInfo, *m_PoseContext, flags );
+	}
+	else
+	{
+		g_pStudioMdlRenderer->DrawModel( &renderInfo, flags );
+	}
+}
+
+void CStudioModelEntity::PrepareDraw()
+{
+	if( !m_Model )
+		return;
+
+	studiomdl::CModelRenderInfo renderInfo;
+
+	GetRenderInfo( renderInfo );
+
+	//Match the renderer's behavior so the pose matches the render info used to draw.
+	if( renderInfo.iSequence >= m_Model->GetStudioHeader()->numseq )
+		renderInfo.iSequence = 0;
+
+	//Nothing has changed since the last time, so the pose is still valid.
+	if( m_PoseContext && m_PoseContext->Matches( renderInfo ) )
+		return;
+
+	const glm::mat3x4* pBakedTransforms = nullptr;
+
+	if( m_PoseTrack && m_PoseTrack->Matches( renderInfo ) )
+		pBakedTransforms = m_PoseTrack->GetBoneTransforms( renderInfo.flFrame );
+
+	if( pBakedTransforms )
+	{
+		if( !m_TrackPoseContext )
+			m_TrackPoseContext = std::make_shared<studiomdl::CStudioPoseContext>();
+
+		m_TrackPoseContext->SetBoneTransforms( renderInfo, pBakedTransforms );
+
+		m_PoseContext = m_TrackPoseContext;
+	}
+	else
+	{
+		m_PoseContext = EntityManager().GetSharedPoses().GetPose( renderInfo );
+	}
+
+	if( ent_skinnedbounds.GetBool() )
+		PreparedBoundsChanged();
+}
+
+const studiomdl::CStudioPoseContext* CStudioModelEntity::GetPose()
+{
+	if( !m_Model )
+		return nullptr;
+
+	PrepareDraw();
+
+	return m_PoseContext.get();
+}
+
+void CStudioModelEntity::SetPoseTrack( const std::shared_ptr<const studiomdl::CBakedPoseTrack>& track )
+{
+	m_PoseTrack = track;
+
+	if( !m_PoseTrack )
+		m_TrackPoseContext.reset();
+}
+
+void CStudioModelEntity::WriteComponents( CEntityComponents& components ) const
+{
+	BaseClass::WriteComponents( components );
+
+	components.SetSequence( GetEntHandle().GetEntIndex(), m_iSequence );
+}
+
+void CStudioModelEntity::GetWorldBounds( glm::vec3& vecMins, glm::vec3& vecMaxs ) const
+{
+	if( !m_Model )
+	{
+		BaseClass::GetWorldBounds( vecMins, vecMaxs );
+		return;
+	}
+
+	glm::vec3 vecBoxMins, vecBoxMaxs;
+
+	ExtractBbox( vecBoxMins, vecBoxMaxs );
+
+	const glm::vec3 vecCenter = ( vecBoxMins + vecBoxMaxs ) * 0.5f * GetScale();
+	const glm::vec3 vecExtents = glm::abs( ( vecBoxMaxs - vecBoxMins ) * 0.5f * GetScale() );
+
+	glm::mat3x4 matrix;
+
+	AngleMatrix( GetAngles(), matrix );
+
+	//Rotate the box and take the box around that.
+	glm::vec3 vecWorldCenter;
+
+	VectorRotate( vecCenter, matrix, vecWorldCenter );
+
+	glm::vec3 vecWorldExtents;
+
+	for( int i = 0; i < 3; ++i )
+	{
+		vecWorldExtents[ i ] = 
+			std::abs( matrix[ i ][ 0 ] ) * vecExtents.x + 
+			std::abs( matrix[ i ][ 1 ] ) * vecExtents.y + 
+			std::abs( matrix[ i ][ 2 ] ) * vecExtents.z;
+	}
+
+	vecMins = GetOrigin() + vecWorldCenter - vecWorldExtents;
+	vecMaxs = GetOrigin() + vecWorldCenter + vecWorldExtents;
+}
+
+void CStudioModelEntity::GetRenderInfo( studiomdl::CModelRenderInfo& renderInfo ) const
+{
 	renderInfo.vecOrigin = GetOrigin();
 	renderInfo.vecAngles = GetAngles();
 	renderInfo.vecScale = GetScale();
@@ -54,6 +192,7 @@ void CStudioModelEntity::Draw( renderer::DrawFlags_t flags )
 	renderInfo.flFrame = GetFrame();
 	renderInfo.iBodygroup = GetBodygroup();
 	renderInfo.iSkin = GetSkin();
+	renderInfo.ppSubModels = renderInfo.pModel ? GetSubModels().GetSubModels() : nullptr;
 
 	for( int iIndex = 0; iIndex < 2; ++iIndex )
 	{
@@ -66,22 +205,20 @@ void CStudioModelEntity::Draw( renderer::DrawFlags_t flags )
 	}
 
 	renderInfo.iMouth = GetMouth();
-
-	g_pStudioMdlRenderer->DrawModel( &renderInfo, flags );
 }
 
 float CStudioModelEntity::AdvanceFrame( float dt, const float flMax )
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0.0;
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	const mstudioseqdesc_t* pseqdesc = pStudioHdr->GetSequence( m_iSequence );
 
 	if( dt == 0.0 )
 	{
-		dt = ( WorldTime.GetCurrentTime() - m_flAnimTime );
+		dt = static_cast<float>( WorldTime.GetCurrentTime() - m_flAnimTime );
 		if( dt <= 0.001 )
 		{
 			m_flAnimTime = WorldTime.GetCurrentTime();
@@ -120,67 +257,112 @@ float CStudioModelEntity::AdvanceFrame( float dt, const float flMax )
 		}
 	}
 
+	FrameChanged();
+
 	m_flAnimTime = WorldTime.GetCurrentTime();
 
 	return dt;
 }
 
-int CStudioModelEntity::GetAnimationEvent( CAnimEvent& event, float flStart, float flEnd, int index, const bool bAllowClientEvents )
+size_t CStudioModelEntity::FindEventRanges( float flStart, float flEnd, EventRange_t ( &ranges )[ 2 ] ) const
 {
-	if( !m_pModel )
+	const mstudioseqdesc_t* pseqdesc = m_Model->GetStudioHeader()->GetSequence( m_iSequence );
+
+	if( pseqdesc->numevents == 0 )
 		return 0;
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	if( pseqdesc->numframes <= 1 )
+	{
+		flStart = 0;
+		flEnd = 1.0;
+	}
 
-	if( m_iSequence >= pStudioHdr->numseq )
+	m_Model->FindEvents( m_iSequence, flStart, flEnd, ranges[ 0 ].uiFirst, ranges[ 0 ].uiLast );
+
+	if( !( pseqdesc->flags & STUDIO_LOOPING ) || flEnd < pseqdesc->numframes - 1 )
+		return 1;
+
+	//The range wrapped around, so events at the start of the sequence happen after the ones at the end.
+	EventRange_t wrapped;
+
+	m_Model->FindEvents( m_iSequence, std::numeric_limits<float>::lowest(), flEnd - pseqdesc->numframes + 1, wrapped.uiFirst, wrapped.uiLast );
+
+	if( wrapped.uiFirst == wrapped.uiLast )
+		return 1;
+
+	//The ranges touch, so every event between them is in one of them. Don't fire those events twice.
+	if( wrapped.uiLast >= ranges[ 0 ].uiFirst )
+	{
+		ranges[ 0 ].uiFirst = wrapped.uiFirst;
+		ranges[ 0 ].uiLast = std::max( ranges[ 0 ].uiLast, wrapped.uiLast );
+		return 1;
+	}
+
+	ranges[ 1 ] = wrapped;
+
+	return 2;
+}
+
+int CStudioModelEntity::GetAnimationEvent( CAnimEvent& event, float flStart, float flEnd, int index, const bool bAllowClientEvents )
+{
+	if( !m_Model )
 		return 0;
 
-	int events = 0;
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
+
+	if( m_iSequence >= pStudioHdr->numseq || index < 0 )
+		return 0;
 
 	const mstudioseqdesc_t* pseqdesc = pStudioHdr->GetSequence( m_iSequence );
 	const mstudioevent_t* pevent = ( const mstudioevent_t * ) ( ( const byte * ) pStudioHdr + pseqdesc->eventindex );
 
-	if( pseqdesc->numevents == 0 || index > pseqdesc->numevents )
-		return 0;
+	EventRange_t ranges[ 2 ];
 
-	if( pseqdesc->numframes <= 1 )
-	{
-		flStart = 0;
-		flEnd = 1.0;
-	}
+	const size_t uiRangeCount = FindEventRanges( flStart, flEnd, ranges );
+
+	size_t uiCount;
+
+	const int* const pSorted = m_Model->GetSortedEvents( m_iSequence, uiCount );
 
-	for( ; index < pseqdesc->numevents; index++ )
+	//index counts events across all ranges.
+	size_t uiIndex = static_cast<size_t>( index );
+	size_t uiRangeStart = 0;
+
+	for( size_t uiRange = 0; uiRange < uiRangeCount; ++uiRange )
 	{
-		//TODO: maybe leave it up to the listener to filter these out?
-		if( !bAllowClientEvents )
+		const EventRange_t& range = ranges[ uiRange ];
+
+		const size_t uiRangeEnd = uiRangeStart + ( range.uiLast - range.uiFirst );
+
+		for( ; uiIndex < uiRangeEnd; ++uiIndex )
 		{
+			const mstudioevent_t& studioEvent = pevent[ pSorted[ range.uiFirst + ( uiIndex - uiRangeStart ) ] ];
+
+			//TODO: maybe leave it up to the listener to filter these out?
 			// Don't send client-side events to the server AI
-			if( pevent[ index ].event >= EVENT_CLIENT )
+			if( !bAllowClientEvents && studioEvent.event >= EVENT_CLIENT )
 				continue;
-		}
 
-		if( ( pevent[ index ].frame >= flStart && pevent[ index ].frame < flEnd ) ||
-			( ( pseqdesc->flags & STUDIO_LOOPING ) && flEnd >= pseqdesc->numframes - 1 && pevent[ index ].frame < flEnd - pseqdesc->numframes + 1 ) )
-		{
-			event.iEvent = pevent[ index ].event;
-			event.pszOptions = pevent[ index ].options;
-			return index + 1;
+			event.iEvent = studioEvent.event;
+			event.pszOptions = studioEvent.options;
+			return static_cast<int>( uiIndex + 1 );
 		}
+
+		uiRangeStart = uiRangeEnd;
 	}
+
 	return 0;
 }
 
 void CStudioModelEntity::DispatchAnimEvents( const bool bAllowClientEvents )
 {
-	if( !m_pModel )
+	if( !m_Model )
 	{
 		Message( "Gibbed monster is thinking!\n" );
 		return;
 	}
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
-
-	const mstudioseqdesc_t* pseqdesc = pStudioHdr->GetSequence( m_iSequence );
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	//This is based on Source's DispatchAnimEvents. It fixes the bug where events don't get triggered, and get triggered multiple times due to the workaround.
 	//Plays from previous frame to current. This differs from GoldSource in that GoldSource plays from current to predicted future frame.
@@ -190,13 +372,37 @@ void CStudioModelEntity::DispatchAnimEvents( const bool bAllowClientEvents )
 	float flEnd = m_flFrame;
 	m_flLastEventCheck = m_flFrame;
 
-	CAnimEvent event;
+	if( m_iSequence >= pStudioHdr->numseq )
+		return;
+
+	const mstudioseqdesc_t* pseqdesc = pStudioHdr->GetSequence( m_iSequence );
+	const mstudioevent_t* pevent = ( const mstudioevent_t * ) ( ( const byte * ) pStudioHdr + pseqdesc->eventindex );
+
+	EventRange_t ranges[ 2 ];
+
+	const size_t uiRangeCount = FindEventRanges( flStart, flEnd, ranges );
+
+	size_t uiCount;
 
-	int index = 0;
+	const int* const pSorted = m_Model->GetSortedEvents( m_iSequence, uiCount );
 
-	while( ( index = GetAnimationEvent( event, flStart, flEnd, index, bAllowClientEvents ) ) != 0 )
+	CAnimEvent event;
+
+	for( size_t uiRange = 0; uiRange < uiRangeCount; ++uiRange )
 	{
-		HandleAnimEvent( event );
+		for( size_t uiIndex = ranges[ uiRange ].uiFirst; uiIndex < ranges[ uiRange ].uiLast; ++uiIndex )
+		{
+			const mstudioevent_t& studioEvent = pevent[ pSorted[ uiIndex ] ];
+
+			// Don't send client-side events to the server AI
+			if( !bAllowClientEvents && studioEvent.event >= EVENT_CLIENT )
+				continue;
+
+			event.iEvent = studioEvent.event;
+			event.pszOptions = studioEvent.options;
+
+			HandleAnimEvent( event );
+		}
 	}
 }
 
@@ -209,10 +415,10 @@ int CStudioModelEntity::SetFrame( const int iFrame )
 	if( iFrame == -1 )
 		return static_cast<int>( m_flFrame );
 
-	if( !m_pModel )
+	if( !m_Model )
 		return 0;
 
-	mstudioseqdesc_t* pseqdesc = m_pModel->GetStudioHeader()->GetSequence( m_iSequence );
+	mstudioseqdesc_t* pseqdesc = m_Model->GetStudioHeader()->GetSequence( m_iSequence );
 
 	m_flFrame = static_cast<float>( iFrame );
 
@@ -226,41 +432,56 @@ int CStudioModelEntity::SetFrame( const int iFrame )
 		m_flFrame -= ( int ) ( m_flFrame / ( pseqdesc->numframes - 1 ) ) * ( pseqdesc->numframes - 1 );
 	}
 
+	FrameChanged();
+
 	m_flAnimTime = WorldTime.GetCurrentTime();
 
 	return static_cast<int>( m_flFrame );
 }
 
-void CStudioModelEntity::SetModel( studiomdl::CStudioModel* pModel )
+void CStudioModelEntity::SetModel( const studiomdl::CStudioModelManager::ModelPtr_t& model )
 {
-	//TODO: release old model.
-	m_pModel = pModel;
+	m_Model = model;
+
+	m_SubModels.Invalidate();
+
+	//Tracks are baked for a specific model.
+	SetPoseTrack( nullptr );
+
+	BoundsChanged();
 
 	//TODO: reinit entity settings
 }
 
 int CStudioModelEntity::GetNumFrames() const
 {
-	const mstudioseqdesc_t* const pseqdesc = m_pModel->GetStudioHeader()->GetSequence( m_iSequence );
+	const mstudioseqdesc_t* const pseqdesc = m_Model->GetStudioHeader()->GetSequence( m_iSequence );
 
 	return pseqdesc->numframes;
 }
 
 int CStudioModelEntity::SetSequence( const int iSequence )
 {
-	if( iSequence > m_pModel->GetStudioHeader()->numseq )
+	if( iSequence > m_Model->GetStudioHeader()->numseq )
 		return m_iSequence;
 
 	m_iSequence = iSequence;
 	m_flFrame = 0;
 	m_flLastEventCheck = 0;
 
+	if( GetEntHandle().IsValid() )
+		GetEntityList().GetComponents().SetSequence( GetEntHandle().GetEntIndex(), m_iSequence );
+
+	FrameChanged();
+
+	BoundsChanged();
+
 	return m_iSequence;
 }
 
 void CStudioModelEntity::GetSequenceInfo( float& flFrameRate, float& flGroundSpeed ) const
 {
-	const mstudioseqdesc_t* pseqdesc = m_pModel->GetStudioHeader()->GetSequence( m_iSequence );
+	const mstudioseqdesc_t* pseqdesc = m_Model->GetStudioHeader()->GetSequence( m_iSequence );
 
 	if( pseqdesc->numframes > 1 )
 	{
@@ -277,24 +498,28 @@ void CStudioModelEntity::GetSequenceInfo( float& flFrameRate, float& flGroundSpe
 
 int CStudioModelEntity::SetBodygroup( const int iBodygroup, const int iValue )
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0;
 
-	if( iBodygroup > m_pModel->GetStudioHeader()->numbodyparts )
+	if( iBodygroup > m_Model->GetStudioHeader()->numbodyparts )
 		return -1;
 
-	if( m_pModel->CalculateBodygroup( iBodygroup, iValue, m_iBodygroup ) )
+	if( m_Model->CalculateBodygroup( iBodygroup, iValue, m_iBodygroup ) )
+	{
+		m_SubModels.Invalidate();
+
 		return iValue;
+	}
 
 	return -1;
 }
 
 int CStudioModelEntity::SetSkin( const int iSkin )
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0;
 
-	if( iSkin < m_pModel->GetTextureHeader()->numskinfamilies )
+	if( iSkin < m_Model->GetTextureHeader()->numskinfamilies )
 	{
 		m_iSkin = iSkin;
 	}
@@ -311,13 +536,13 @@ byte CStudioModelEntity::GetControllerByIndex( const int iController ) const
 
 float CStudioModelEntity::GetControllerValue( const int iController ) const
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0.0f;
 
 	if( iController < 0 || iController >= STUDIO_TOTAL_CONTROLLERS )
 		return 0;
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	const mstudiobonecontroller_t* pbonecontroller = pStudioHdr->GetBoneControllers();
 
@@ -345,10 +570,10 @@ float CStudioModelEntity::GetControllerValue( const int iController ) const
 
 float CStudioModelEntity::SetController( const int iController, float flValue )
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0.0f;
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	const mstudiobonecontroller_t* pbonecontroller = pStudioHdr->GetBoneControllers();
 
@@ -400,10 +625,10 @@ float CStudioModelEntity::SetController( const int iController, float flValue )
 
 float CStudioModelEntity::SetMouth( float flValue )
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0.0f;
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	const mstudiobonecontroller_t* pbonecontroller = pStudioHdr->GetBoneControllers();
 
@@ -456,13 +681,13 @@ byte CStudioModelEntity::GetBlendingByIndex( const int iBlender ) const
 
 float CStudioModelEntity::GetBlendingValue( const int iBlender ) const
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0.0f;
 
 	if( iBlender < 0 || iBlender >= STUDIO_MAX_BLENDERS )
 		return 0;
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	const mstudioseqdesc_t* pseqdesc = pStudioHdr->GetSequence( m_iSequence );
 
@@ -474,13 +699,13 @@ float CStudioModelEntity::GetBlendingValue( const int iBlender ) const
 
 float CStudioModelEntity::SetBlending( const int iBlender, float flValue )
 {
-	if( !m_pModel )
+	if( !m_Model )
 		return 0.0f;
 
 	if( iBlender < 0 || iBlender >= STUDIO_MAX_BLENDERS )
 		return 0;
 
-	const studiohdr_t* pStudioHdr = m_pModel->GetStudioHeader();
+	const studiohdr_t* pStudioHdr = m_Model->GetStudioHeader();
 
 	const mstudioseqdesc_t* pseqdesc = pStudioHdr->GetSequence( m_iSequence );
 
@@ -515,7 +740,20 @@ float CStudioModelEntity::SetBlending( const int iBlender, float flValue )
 
 void CStudioModelEntity::ExtractBbox( glm::vec3& vecMins, glm::vec3& vecMaxs ) const
 {
-	const mstudioseqdesc_t* pseqdesc = m_pModel->GetStudioHeader()->GetSequence( m_iSequence );
+	if( ent_skinnedbounds.GetBool() && m_PoseContext )
+	{
+		studiomdl::CModelRenderInfo renderInfo;
+
+		GetRenderInfo( renderInfo );
+
+		if( renderInfo.iSequence >= m_Model->GetStudioHeader()->numseq )
+			renderInfo.iSequence = 0;
+
+		if( m_PoseContext->Matches( renderInfo ) && m_PoseContext->GetBounds( vecMins, vecMaxs ) )
+			return;
+	}
+
+	const mstudioseqdesc_t* pseqdesc = m_Model->GetStudioHeader()->GetSequence( m_iSequence );
 
 	vecMins = pseqdesc->bbmin;
 	vecMaxs = pseqdesc->bbmax;
@@ -523,44 +761,13 @@ void CStudioModelEntity::ExtractBbox( glm::vec3& vecMins, glm::vec3& vecMaxs ) c
 
 mstudiomodel_t* CStudioModelEntity::GetModelByBodyPart( const int iBodyPart ) const
 {
-	return m_pModel->GetModelByBodyPart( m_iBodygroup, iBodyPart );
+	return GetSubModels().GetSubModel( iBodyPart );
 }
 
-CStudioModelEntity::MeshList_t CStudioModelEntity::ComputeMeshList( const int iTexture ) const
+const studiomdl::CBodygroupSubModels& CStudioModelEntity::GetSubModels() const
 {
-	const studiomdl::CStudioModel* pStudioModel = GetModel();
-
-	assert( pStudioModel );
-
-	MeshList_t meshes;
-
-	const auto pStudioHdr = pStudioModel->GetStudioHeader();
-
-	const short* const pskinref = pStudioModel->GetTextureHeader()->GetSkins();
-
-	int iBodygroup = 0;
-
-	for( int iBodyPart = 0; iBodyPart < pStudioHdr->numbodyparts; ++iBodyPart )
-	{
-		mstudiobodyparts_t *pbodypart = pStudioHdr->GetBodypart( iBodyPart );
-
-		for( int iModel = 0; iModel < pbodypart->nummodels; ++iModel )
-		{
-			pStudioModel->CalculateBodygroup( iBodyPart, iModel, iBodygroup );
-
-			mstudiomodel_t* pModel = pStudioModel->GetModelByBodyPart( iBodygroup, iBodyPart );
-
-			for( int iMesh = 0; iMesh < pModel->nummesh; ++iMesh )
-			{
-				const mstudiomesh_t* pMesh = ( ( const mstudiomesh_t* ) ( ( const byte* ) pStudioModel->GetStudioHeader() + pModel->meshindex ) ) + iMesh;
-
-				if( pskinref[ pMesh->skinref ] == iTexture )
-				{
-					meshes.push_back( pMesh );
-				}
-			}
-		}
-	}
+	if( !m_SubModels.IsValid( m_Model.get(), m_iBodygroup ) )
+		m_SubModels.Resolve( *m_Model, m_iBodygroup );
 
-	return meshes;
+	return m_SubModels;
 }
\ No newline at end of file
@@ -1,9 +1,16 @@
 #ifndef GAME_CSTUDIOMODELENTITY_H
 #define GAME_CSTUDIOMODELENTITY_H
 
+#include <memory>
 #include <vector>
 
+#include "shared/studiomodel/CBakedPoseTrack.h"
 #include "shared/studiomodel/CStudioModel.h"
+#include "shared/studiomodel/CStudioModelManager.h"
+#include "shared/studiomodel/CStudioPoseContext.h"
+#include "shared/studiomodel/StudioBodygroups.h"
+
+#include "shared/renderer/studiomodel/CModelRenderInfo.h"
 
 #include "game/CAnimEvent.h"
 #include "game/Events.h"
@@ -18,9 +25,6 @@ class CStudioModelEntity : public CBaseAnimating
 public:
 	DECLARE_CLASS( CStudioModelEntity, CBaseAnimating );
 
-public:
-	typedef std::vector<const mstudiomesh_t*> MeshList_t;
-
 public:
 	virtual void OnDestroy() override;
 
@@ -28,6 +32,38 @@ public:
 
 	virtual void Draw( renderer::DrawFlags_t flags ) override;
 
+	/**
+	*	Sets up this entity's bones for the current frame.
+	*/
+	virtual void PrepareDraw() override;
+
+	/**
+	*	Computes bounds from the current sequence's bounding box, transformed by the entity's origin, angles and scale.
+	*/
+	virtual void GetWorldBounds( glm::vec3& vecMins, glm::vec3& vecMaxs ) const override;
+
+	virtual void WriteComponents( CEntityComponents& components ) const override;
+
+	/**
+	*	Fills in render info for this entity's current state.
+	*/
+	void GetRenderInfo( studiomdl::CModelRenderInfo& renderInfo ) const;
+
+	/**
+	*	Sets up the pose of the entity's current state, if it's out of date.
+	*	@return The pose, or null if the entity has no model.
+	*/
+	const studiomdl::CStudioPoseContext* GetPose();
+
+	/**
+	*	Sets a baked track to take poses from. While the entity's state matches the track and its frame is a whole frame,
+	*	bones are copied from the track instead of being set up.
+	*	@param track Track to use, or null to stop using one.
+	*/
+	void SetPoseTrack( const std::shared_ptr<const studiomdl::CBakedPoseTrack>& track );
+
+	const std::shared_ptr<const studiomdl::CBakedPoseTrack>& GetPoseTrack() const { return m_PoseTrack; }
+
 	/**
 	*	Advances the frame. If dt is 0, advances to current time, otherwise, advances by the given amount of time.
 	*	TODO: clamp dt to positive?
@@ -42,7 +78,7 @@ public:
 	*	@param event Output. Event data.
 	*	@param flStart Start of the range of frames to check.
 	*	@param flEnd End of the range of frames to check.
-	*	@param index Event index to start checking at.
+	*	@param index Event index to start checking at. Counts the events in the range sorted by frame, so 0 is the first event in the range.
 	*	@param bAllowClientEvents Whether to process client events or not.
 	*	@return Next event index to use as the index parameter. If 0, no more events are left.
 	*/
@@ -68,7 +104,24 @@ public:
 	int SetFrame( const int iFrame );
 
 private:
-	studiomdl::CStudioModel* m_pModel = nullptr;
+	/**
+	*	Range of positions in the current sequence's sorted events.
+	*/
+	struct EventRange_t
+	{
+		size_t uiFirst;
+		size_t uiLast;
+	};
+
+	/**
+	*	Finds the events of the current sequence between flStart and flEnd. If a looping sequence reached its end,
+	*	the events at its start are found as well. Ranges are in the order their events happen.
+	*	@return Number of ranges.
+	*/
+	size_t FindEventRanges( float flStart, float flEnd, EventRange_t ( &ranges )[ 2 ] ) const;
+
+private:
+	studiomdl::CStudioModelManager::ModelPtr_t m_Model;
 
 	int		m_iSequence			= 0;				// sequence index
 	int		m_iBodygroup		= 0;				// bodypart selection	
@@ -78,18 +131,41 @@ private:
 	byte	m_uiBlending[ STUDIO_MAX_BLENDERS ]	= { 0, 0 };			// animation blending
 
 	float	m_flLastEventCheck	= 0;				//Last time we checked for animation events.
-	float	m_flAnimTime		= 0;				//Time when the frame was set.
+	double	m_flAnimTime		= 0;				//Time when the frame was set.
+
+	/**
+	*	Bones set up by PrepareDraw. Only used if the entity's state still matches the pose when it's drawn.
+	*	Shared with other entities that have the same pose.
+	*/
+	std::shared_ptr<studiomdl::CStudioPoseContext> m_PoseContext;
+
+	/**
+	*	Submodels selected by m_iBodygroup. Resolved when they're first needed after the bodygroup or model changes.
+	*/
+	mutable studiomdl::CBodygroupSubModels m_SubModels;
+
+	std::shared_ptr<const studiomdl::CBakedPoseTrack> m_PoseTrack;
+
+	/**
+	*	Poses copied from m_PoseTrack. Not shared, so it can be overwritten for every frame.
+	*/
+	std::shared_ptr<studiomdl::CStudioPoseContext> m_TrackPoseContext;
 
 public:
 	/**
 	*	Gets the model.
 	*/
-	studiomdl::CStudioModel* GetModel() const { return m_pModel; }
+	studiomdl::CStudioModel* GetModel() const { return m_Model.get(); }
+
+	/**
+	*	Gets the model, for users that need to keep it alive.
+	*/
+	const studiomdl::CStudioModelManager::ModelPtr_t& GetModelPtr() const { return m_Model; }
 
 	/**
-	*	Sets the model.
+	*	Sets the model. The entity keeps a reference to it until another model is set or the entity is destroyed.
 	*/
-	void SetModel( studiomdl::CStudioModel* pModel );
+	void SetModel( const studiomdl::CStudioModelManager::ModelPtr_t& model );
 
 	/**
 	*	Gets the number of frames that the current sequence has.
@@ -200,10 +276,11 @@ public:
 	/**
 	*	Gets the last time this entity advanced its frame.
 	*/
-	float GetAnimTime() const { return m_flAnimTime; }
+	double GetAnimTime() const { return m_flAnimTime; }
 
 	/**
-	*	Extracts the bounding box from the current sequence.
+	*	Extracts the bounding box in model space. If the pose set up by PrepareDraw is current, the bounds of the posed bones' vertices are used.
+	*	Otherwise, the bounding box of the current sequence is used.
 	*/
 	void ExtractBbox( glm::vec3& vecMins, glm::vec3& vecMaxs ) const;
 
@@ -213,9 +290,9 @@ public:
 	mstudiomodel_t* GetModelByBodyPart( const int iBodyPart ) const;
 
 	/**
-	*	Computes a list of meshes that use the given texture.
+	*	Gets the submodels selected by the current bodygroup, for every body part.
 	*/
-	MeshList_t ComputeMeshList( const int iTexture ) const;
+	const studiomdl::CBodygroupSubModels& GetSubModels() const;
 };
 
 #endif //GAME_CSTUDIOMODELENTITY_H
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 #include "shared/renderer/studiomodel/IStudioModelRenderer.h"
 
+#include "graphics/GraphicsUtils.h"
+
 #include "GraphicsHelpers.h"
 
 //TODO: remove
@@ -91,20 +93,13 @@ void DrawFloorQuad( float flSideLength )
 {
 	flSideLength = std::abs( flSideLength );
 
-	glBegin( GL_TRIANGLE_STRIP );
-	glTexCoord2f( 0.0f, 0.0f );
-	glVertex3f( -flSideLength, flSideLength, 0.0f );
-
-	glTexCoord2f( 0.0f, 1.0f );
-	glVertex3f( -flSideLength, -flSideLength, 0.0f );
-
-	glTexCoord2f( 1.0f, 0.0f );
-	glVertex3f( flSideLength, flSideLength, 0.0f );
+	//The quad is compiled once at unit size.
+	glPushMatrix();
+	glScalef( flSideLength, flSideLength, 1.0f );
 
-	glTexCoord2f( 1.0f, 1.0f );
-	glVertex3f( flSideLength, -flSideLength, 0.0f );
+	graphics::DrawSceneGeometry( graphics::SceneGeometry::FLOOR_QUAD );
 
-	glEnd();
+	glPopMatrix();
 }
 
 void DrawFloor( float flSideLength, GLuint groundTexture, const Color& groundColor, const bool bMirror )
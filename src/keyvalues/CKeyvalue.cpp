@@ -24,6 +24,20 @@ void CKeyvalue::SetValue( const CString& szValue )
 	SetValue( szValue.CStr() );
 }
 
+void CKeyvalue::SetValue( const char* const pszValue, const size_t uiLength )
+{
+	assert( pszValue );
+
+	m_szValue.AssignN( pszValue, uiLength );
+}
+
+void CKeyvalue::SetValueStatic( const char* const pszValue, const size_t uiLength )
+{
+	assert( pszValue );
+
+	m_szValue.AssignStatic( pszValue, uiLength );
+}
+
 void CKeyvalue::Print( const size_t uiTabLevel ) const
 {
 	Message( "%*s\"%s\" \"%s\"\n", static_cast<int>( uiTabLevel * KEYVALUE_TAB_WIDTH ), "", GetKey().CStr(), m_szValue.CStr() );
@@ -37,6 +37,17 @@ public:
 	*/
 	void SetValue( const CString& szValue );
 
+	/**
+	*	Sets the value to the first uiLength characters of pszValue. pszValue does not have to be null terminated.
+	*/
+	void SetValue( const char* const pszValue, const size_t uiLength );
+
+	/**
+	*	Points the value at a null terminated string that is not owned by this keyvalue, such as a string in the tree's arena.
+	*	The string must outlive this keyvalue.
+	*/
+	void SetValueStatic( const char* const pszValue, const size_t uiLength );
+
 	//TODO: move
 	virtual void Print( const size_t uiTabLevel = 0 ) const override;
 
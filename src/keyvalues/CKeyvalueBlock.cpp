@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstring>
 
 #include "shared/Logging.h"
 
@@ -12,6 +13,12 @@ CKeyvalueBlock::CKeyvalueBlock( const char* const pszKey )
 {
 }
 
+CKeyvalueBlock::CKeyvalueBlock( const char* const pszKey, CKeyvaluesArena& arena )
+	: BaseClass( pszKey, NodeType::BLOCK )
+	, m_Children( Children_t::allocator_type( &arena ) )
+{
+}
+
 CKeyvalueBlock::CKeyvalueBlock( const char* const pszKey, const Children_t& children )
 	: CKeyvalueBlock( pszKey )
 {
@@ -31,17 +38,86 @@ CKeyvalueBlock::~CKeyvalueBlock()
 	RemoveAllChildren();
 }
 
+bool CKeyvalueBlock::UpdateIndex() const
+{
+	if( m_Children.size() < MIN_INDEXED_CHILDREN )
+		return false;
+
+	if( !m_Index.empty() && m_uiIndexedChildren == m_Children.size() && m_uiIndexKeyGeneration == GetKeyGeneration() )
+		return true;
+
+	//Keep the load factor at or below 50%.
+	size_t uiSize = 16;
+
+	while( uiSize < m_Children.size() * 2 )
+		uiSize *= 2;
+
+	m_Index.assign( uiSize, IndexEntry_t{ INVALID_STRING_ID, INVALID_CHILD } );
+
+	const size_t uiMask = uiSize - 1;
+
+	//Children are inserted in order, so probing visits children with the same key in order as well.
+	for( size_t uiChild = 0; uiChild < m_Children.size(); ++uiChild )
+	{
+		const StringId_t keyId = m_Children[ uiChild ]->GetKeyId();
+
+		size_t uiSlot = HashKey( keyId ) & uiMask;
+
+		while( m_Index[ uiSlot ].uiChild != INVALID_CHILD )
+			uiSlot = ( uiSlot + 1 ) & uiMask;
+
+		m_Index[ uiSlot ].keyId = keyId;
+		m_Index[ uiSlot ].uiChild = static_cast<unsigned int>( uiChild );
+	}
+
+	m_uiIndexedChildren = m_Children.size();
+	m_uiIndexKeyGeneration = GetKeyGeneration();
+
+	return true;
+}
+
+template<typename FUNCTOR>
+void CKeyvalueBlock::ForEachChildWithKey( const char* const pszKey, FUNCTOR callback ) const
+{
+	//Keys are interned, so if the key isn't in the pool, no child has it.
+	const StringId_t keyId = StringPool().Find( pszKey );
+
+	if( keyId == INVALID_STRING_ID )
+		return;
+
+	if( UpdateIndex() )
+	{
+		const size_t uiMask = m_Index.size() - 1;
+
+		for( size_t uiSlot = HashKey( keyId ) & uiMask; m_Index[ uiSlot ].uiChild != INVALID_CHILD; uiSlot = ( uiSlot + 1 ) & uiMask )
+		{
+			const auto& entry = m_Index[ uiSlot ];
+
+			if( entry.keyId == keyId && !callback( m_Children[ entry.uiChild ] ) )
+				return;
+		}
+	}
+	else
+	{
+		for( const auto pChild : m_Children )
+		{
+			if( pChild->GetKeyId() == keyId && !callback( pChild ) )
+				return;
+		}
+	}
+}
+
 CKeyvalueBlock::Children_t CKeyvalueBlock::GetChildrenByKey( const char* const pszKey ) const
 {
 	assert( pszKey );
 
 	Children_t children;
 
-	for( auto child : m_Children )
+	ForEachChildWithKey( pszKey, [ & ]( CKeyvalueNode* pChild )
 	{
-		if( child->GetKey() == pszKey )
-			children.push_back( child );
-	}
+		children.push_back( pChild );
+		return true;
+	} );
 
 	return children;
 }
@@ -68,15 +144,19 @@ void CKeyvalueBlock::RemoveAllChildren()
 	}
 
 	m_Children.clear();
+
+	InvalidateIndex();
 }
 
 void CKeyvalueBlock::RemoveAllNotNamed( const char* const pszKey )
 {
 	assert( pszKey );
 
+	const StringId_t keyId = StringPool().Find( pszKey );
+
 	for( Children_t::iterator it = m_Children.begin(); it != m_Children.end(); )
 	{
-		if( ( *it )->GetKey() != pszKey )
+		if( ( *it )->GetKeyId() != keyId )
 		{
 			delete *it;
 			it = m_Children.erase( it );
@@ -84,53 +164,49 @@ void CKeyvalueBlock::RemoveAllNotNamed( const char* const pszKey )
 		else
 			++it;
 	}
+
+	InvalidateIndex();
 }
 
 CKeyvalueNode* CKeyvalueBlock::FindFirstChild( const char* const pszKey ) const
 {
 	assert( pszKey );
 
-	for( const auto pChild : m_Children )
+	CKeyvalueNode* pResult = nullptr;
+
+	ForEachChildWithKey( pszKey, [ & ]( CKeyvalueNode* pChild )
 	{
-		if( strcmp( pszKey, pChild->GetKey().CStr() ) == 0 )
-			return pChild;
-	}
+		pResult = pChild;
+		return false;
+	} );
 
-	return nullptr;
+	return pResult;
 }
 
 CKeyvalueNode* CKeyvalueBlock::FindFirstChild( const char* const pszKey, const NodeType type ) const
 {
 	assert( pszKey );
 
-	for( const auto pChild : m_Children )
+	CKeyvalueNode* pResult = nullptr;
+
+	ForEachChildWithKey( pszKey, [ & ]( CKeyvalueNode* pChild )
 	{
-		if( pChild->GetType() == type )
-		{
-			if( strcmp( pszKey, pChild->GetKey().CStr() ) == 0 )
-				return pChild;
-		}
-	}
+		if( pChild->GetType() != type )
+			return true;
 
-	return nullptr;
+		pResult = pChild;
+		return false;
+	} );
+
+	return pResult;
 }
 
 CString CKeyvalueBlock::FindFirstKeyvalue( const char* const pszKey ) const
 {
 	if( pszKey && *pszKey )
 	{
-		const Children_t& children = GetChildren();
-
-		for( Children_t::const_iterator it = children.begin(), end = children.end(); it != end; ++it )
-		{
-			if( ( *it )->GetType() == NodeType::KEYVALUE )
-			{
-				CKeyvalue* pKV = static_cast<CKeyvalue*>( *it );
-
-				if( strcmp( pszKey, pKV->GetKey().CStr() ) == 0 )
-					return pKV->GetValue();
-			}
-		}
+		if( auto pKV = static_cast<CKeyvalue*>( FindFirstChild( pszKey, NodeType::KEYVALUE ) ) )
+			return pKV->GetValue();
 	}
 
 	return "";
@@ -142,6 +218,8 @@ void CKeyvalueBlock::AddKeyvalue( const char* const pszKey, const char* const ps
 	assert( pszValue );
 
 	m_Children.emplace_back( new CKeyvalue( pszKey, pszValue ) );
+
+	InvalidateIndex();
 }
 
 void CKeyvalueBlock::Print( const size_t uiTabLevel ) const
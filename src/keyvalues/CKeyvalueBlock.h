@@ -1,8 +1,10 @@
 #ifndef KEYVALUES_CKEYVALUEBLOCK_H
 #define KEYVALUES_CKEYVALUEBLOCK_H
 
+#include <memory>
 #include <vector>
 
+#include "CKeyvaluesArena.h"
 #include "CKeyvalueNode.h"
 
 namespace keyvalues
@@ -16,7 +18,12 @@ class CKeyvalueBlock final : public CKeyvalueNode
 public:
 	typedef CKeyvalueNode BaseClass;
 
-	typedef std::vector<CKeyvalueNode*> Children_t;
+	typedef std::vector<CKeyvalueNode*, CKeyvaluesAllocator<CKeyvalueNode*>> Children_t;
+
+	/**
+	*	Blocks with fewer children than this are searched linearly instead of building an index.
+	*/
+	static const size_t MIN_INDEXED_CHILDREN = 8;
 
 public:
 	/*
@@ -25,6 +32,13 @@ public:
 	*/
 	CKeyvalueBlock( const char* const pszKey );
 
+	/**
+	*	Constructs a keyvalue node with a key, whose list of children is allocated from an arena.
+	*	@param pszKey Key. Must be non-null.
+	*	@param arena Arena to allocate from.
+	*/
+	CKeyvalueBlock( const char* const pszKey, CKeyvaluesArena& arena );
+
 	/**
 	*	Constructs a keyvalue node with a key.
 	*	Children are set to the given list of children.
@@ -45,7 +59,12 @@ public:
 
 	const Children_t& GetChildren() const { return m_Children; }
 	//TODO: remove this and add ways to add/remove children safely.
-	Children_t& GetChildren() { return m_Children; }
+	Children_t& GetChildren()
+	{
+		//The caller may modify the list.
+		InvalidateIndex();
+		return m_Children;
+	}
 
 	/**
 	*	Gets a list of children that have the given key. The children are still managed by this block.
@@ -114,9 +133,62 @@ public:
 
 	void PrintChildren( const size_t uiTabLevel = 0 ) const;
 
+	/**
+	*	Gives this block ownership of the arena that its descendants were allocated from.
+	*	The arena is destroyed after the children, and releases all of their memory at once.
+	*/
+	void SetArena( std::unique_ptr<CKeyvaluesArena>&& arena ) { m_Arena = std::move( arena ); }
+
+	/**
+	*	@return The arena owned by this block, if any.
+	*/
+	CKeyvaluesArena* GetArena() const { return m_Arena.get(); }
+
+private:
+	/**
+	*	Entry in the open addressing key index. Empty entries have INVALID_CHILD as their child.
+	*/
+	struct IndexEntry_t
+	{
+		StringId_t keyId;
+		unsigned int uiChild;
+	};
+
+	static const unsigned int INVALID_CHILD = ~0U;
+
+	/**
+	*	Spreads key ids over the index. Ids are sequential, so they're mixed to avoid clustering.
+	*/
+	static unsigned int HashKey( const StringId_t keyId ) { return keyId * 2654435761U; }
+
+	void InvalidateIndex() { m_Index.clear(); }
+
+	/**
+	*	Builds the key index if it is missing or out of date.
+	*	@return Whether the index can be used. Small blocks don't use an index.
+	*/
+	bool UpdateIndex() const;
+
+	/**
+	*	Calls callback for each child with the given key, in order, until it returns false.
+	*/
+	template<typename FUNCTOR>
+	void ForEachChildWithKey( const char* const pszKey, FUNCTOR callback ) const;
+
 private:
+	//Must be declared before m_Children so it's destroyed last.
+	std::unique_ptr<CKeyvaluesArena> m_Arena;
+
 	Children_t m_Children;
 
+	/**
+	*	Lazily built index of children by key. Not safe to build from multiple threads at once.
+	*	The size and key generation of the children it was built for are stored so changes made through GetChildren are detected.
+	*/
+	mutable std::vector<IndexEntry_t> m_Index;
+	mutable size_t m_uiIndexedChildren = 0;
+	mutable unsigned int m_uiIndexKeyGeneration = 0;
+
 private:
 	CKeyvalueBlock( const CKeyvalueBlock& ) = delete;
 	CKeyvalueBlock& operator=( const CKeyvalueBlock& ) = delete;
@@ -1,9 +1,60 @@
 #include <cassert>
+#include <cstring>
+
+#include <new>
+
+#include "shared/MemoryStats.h"
+
+#include "CKeyvaluesArena.h"
 
 #include "CKeyvalueNode.h"
 
 namespace keyvalues
 {
+std::atomic<unsigned int> CKeyvalueNode::m_uiKeyGeneration{ 0 };
+
+void* CKeyvalueNode::operator new( size_t uiSize )
+{
+	auto pHeader = static_cast<AllocationHeader_t*>( ::operator new( sizeof( AllocationHeader_t ) + uiSize ) );
+
+	pHeader->uiSize = sizeof( AllocationHeader_t ) + uiSize;
+	pHeader->bInArena = false;
+
+	mem::Add( mem::Category::KEYVALUES, static_cast<int64_t>( pHeader->uiSize ) );
+
+	return pHeader + 1;
+}
+
+void* CKeyvalueNode::operator new( size_t uiSize, CKeyvaluesArena& arena )
+{
+	auto pHeader = static_cast<AllocationHeader_t*>( arena.Allocate( sizeof( AllocationHeader_t ) + uiSize, alignof( AllocationHeader_t ) ) );
+
+	pHeader->uiSize = 0;
+	pHeader->bInArena = true;
+
+	return pHeader + 1;
+}
+
+void CKeyvalueNode::operator delete( void* pMemory )
+{
+	if( !pMemory )
+		return;
+
+	auto pHeader = static_cast<AllocationHeader_t*>( pMemory ) - 1;
+
+	//Arena memory is released all at once.
+	if( !pHeader->bInArena )
+	{
+		mem::Add( mem::Category::KEYVALUES, -static_cast<int64_t>( pHeader->uiSize ) );
+
+		::operator delete( pHeader );
+	}
+}
+
+void CKeyvalueNode::operator delete( void*, CKeyvaluesArena& )
+{
+}
+
 CKeyvalueNode::CKeyvalueNode( const char* const pszKey, const NodeType type )
 	: m_Type( type )
 {
@@ -14,11 +65,26 @@ void CKeyvalueNode::SetKey( const char* const pszKey )
 {
 	assert( pszKey );
 
-	m_szKey = pszKey;
+	SetKey( pszKey, strlen( pszKey ) );
 }
 
 void CKeyvalueNode::SetKey( const CString& szKey )
 {
 	SetKey( szKey.CStr() );
 }
+
+void CKeyvalueNode::SetKey( const char* const pszKey, const size_t uiLength )
+{
+	assert( pszKey );
+
+	//Embedded nulls can't be looked up, so the key ends at the first one like it did when keys were copied.
+	const char* const pszEnd = static_cast<const char*>( memchr( pszKey, '\0', uiLength ) );
+
+	m_KeyId = StringPool().Intern( pszKey, pszEnd ? pszEnd - pszKey : uiLength );
+
+	//Pool strings are never freed.
+	m_szKey.AssignStatic( StringPool().GetString( m_KeyId ), StringPool().GetLength( m_KeyId ) );
+
+	OnKeyChanged();
+}
 }
\ No newline at end of file
@@ -1,20 +1,40 @@
 #ifndef CKEYVALUENODE_H
 #define CKEYVALUENODE_H
 
+#include <atomic>
+#include <cstddef>
 #include <cstdlib>
 
+#include "shared/CStringPool.h"
+
 #include "utility/CString.h"
 
 #include "KeyvaluesConstants.h"
 
 namespace keyvalues
 {
+class CKeyvaluesArena;
+
 /**
 *	A single keyvalue node
 */
 class CKeyvalueNode
 {
 public:
+	/**
+	*	Allocates a node from the heap.
+	*/
+	static void* operator new( size_t uiSize );
+
+	/**
+	*	Allocates a node from an arena. The node can be deleted as usual, but its memory is only released with the arena.
+	*/
+	static void* operator new( size_t uiSize, CKeyvaluesArena& arena );
+
+	static void operator delete( void* pMemory );
+
+	static void operator delete( void* pMemory, CKeyvaluesArena& arena );
+
 	/**
 	*	Constructs a keyvalue node with a key.
 	*	@param pszKey Key. Must be non-null.
@@ -26,6 +46,11 @@ public:
 
 	const CString& GetKey() const { return m_szKey; }
 
+	/**
+	*	@return The key's id in the string pool. Keys are interned, so nodes with equal keys have the same id.
+	*/
+	StringId_t GetKeyId() const { return m_KeyId; }
+
 	/**
 	*	Sets the node key. Must be non-null.
 	*/
@@ -36,6 +61,16 @@ public:
 	*/
 	void SetKey( const CString& szKey );
 
+	/**
+	*	Sets the node key to the first uiLength characters of pszKey. pszKey does not have to be null terminated.
+	*/
+	void SetKey( const char* const pszKey, const size_t uiLength );
+
+	/**
+	*	Incremented every time any node's key changes. Used to invalidate lookup indices.
+	*/
+	static unsigned int GetKeyGeneration() { return m_uiKeyGeneration.load( std::memory_order_relaxed ); }
+
 	/**
 	*	Gets the node type.
 	*/
@@ -45,7 +80,29 @@ public:
 	virtual void Print( const size_t uiTabLevel = 0 ) const = 0;
 
 private:
+	/**
+	*	Stored in front of every node to track where it was allocated.
+	*/
+	struct alignas( std::max_align_t ) AllocationHeader_t
+	{
+		/**
+		*	Size of the allocation, including this header. Only set for heap allocations, arena memory is counted by the arena.
+		*/
+		size_t uiSize;
+
+		bool bInArena;
+	};
+
+	void OnKeyChanged() { m_uiKeyGeneration.fetch_add( 1, std::memory_order_relaxed ); }
+
+private:
+	static std::atomic<unsigned int> m_uiKeyGeneration;
+
+	/**
+	*	Points at the string pool's copy of the key, so nodes don't store keys of their own.
+	*/
 	CString m_szKey;
+	StringId_t m_KeyId = INVALID_STRING_ID;
 	const NodeType m_Type;
 
 private:
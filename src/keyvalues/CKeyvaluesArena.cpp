@@ -0,0 +1,59 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "shared/MemoryStats.h"
+
+#include "CKeyvaluesArena.h"
+
+namespace keyvalues
+{
+CKeyvaluesArena::~CKeyvaluesArena()
+{
+	mem::Add( mem::Category::KEYVALUES, -static_cast<int64_t>( m_uiAllocatedSize ) );
+}
+
+void* CKeyvaluesArena::Allocate( const size_t uiSize, const size_t uiAlignment )
+{
+	assert( uiAlignment && !( uiAlignment & ( uiAlignment - 1 ) ) );
+
+	size_t uiPadding = m_pCurrent ? ( uiAlignment - ( reinterpret_cast<uintptr_t>( m_pCurrent ) & ( uiAlignment - 1 ) ) ) & ( uiAlignment - 1 ) : 0;
+
+	if( !m_pCurrent || uiPadding + uiSize > m_uiRemaining )
+	{
+		//Blocks from new[] are aligned for any fundamental type; only overaligned types need extra space.
+		const size_t uiExtra = uiAlignment > alignof( std::max_align_t ) ? uiAlignment : 0;
+		const size_t uiBlockSize = uiSize + uiExtra > BLOCK_SIZE ? uiSize + uiExtra : BLOCK_SIZE;
+
+		m_Blocks.emplace_back( new unsigned char[ uiBlockSize ] );
+
+		m_pCurrent = m_Blocks.back().get();
+		m_uiRemaining = uiBlockSize;
+		m_uiAllocatedSize += uiBlockSize;
+
+		mem::Add( mem::Category::KEYVALUES, static_cast<int64_t>( uiBlockSize ) );
+
+		uiPadding = ( uiAlignment - ( reinterpret_cast<uintptr_t>( m_pCurrent ) & ( uiAlignment - 1 ) ) ) & ( uiAlignment - 1 );
+	}
+
+	void* pMemory = m_pCurrent + uiPadding;
+
+	m_pCurrent += uiPadding + uiSize;
+	m_uiRemaining -= uiPadding + uiSize;
+
+	return pMemory;
+}
+
+const char* CKeyvaluesArena::AllocateString( const char* const pszString, const size_t uiLength )
+{
+	assert( pszString || !uiLength );
+
+	char* pszCopy = static_cast<char*>( Allocate( uiLength + 1, 1 ) );
+
+	memcpy( pszCopy, pszString, uiLength );
+
+	pszCopy[ uiLength ] = '\0';
+
+	return pszCopy;
+}
+}
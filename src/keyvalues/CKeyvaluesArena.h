@@ -0,0 +1,127 @@
+#ifndef KEYVALUES_CKEYVALUESARENA_H
+#define KEYVALUES_CKEYVALUESARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace keyvalues
+{
+/**
+*	Monotonic allocator for keyvalue trees. Memory is handed out from a few large blocks,
+*	and is only released when the arena is destroyed.
+*/
+class CKeyvaluesArena final
+{
+public:
+	/**
+	*	Default size of a block, in bytes. Larger allocations get a block of their own.
+	*/
+	static const size_t BLOCK_SIZE = 16384;
+
+public:
+	CKeyvaluesArena() = default;
+	~CKeyvaluesArena();
+
+	/**
+	*	Allocates memory. Never returns null.
+	*	@param uiSize Size of the allocation, in bytes.
+	*	@param uiAlignment Alignment of the allocation. Must be a power of 2.
+	*/
+	void* Allocate( const size_t uiSize, const size_t uiAlignment = alignof( std::max_align_t ) );
+
+	/**
+	*	Copies a string into the arena.
+	*	@param pszString String to copy. Does not have to be null terminated.
+	*	@param uiLength Number of characters to copy.
+	*	@return Null terminated copy of the string.
+	*/
+	const char* AllocateString( const char* const pszString, const size_t uiLength );
+
+	/**
+	*	@return Total size of all blocks, in bytes.
+	*/
+	size_t GetAllocatedSize() const { return m_uiAllocatedSize; }
+
+private:
+	std::vector<std::unique_ptr<unsigned char[]>> m_Blocks;
+
+	unsigned char* m_pCurrent = nullptr;
+	size_t m_uiRemaining = 0;
+
+	size_t m_uiAllocatedSize = 0;
+
+private:
+	CKeyvaluesArena( const CKeyvaluesArena& ) = delete;
+	CKeyvaluesArena& operator=( const CKeyvaluesArena& ) = delete;
+};
+
+/**
+*	Standard allocator that allocates from an arena. Without an arena, allocates from the heap.
+*	Memory allocated from the arena is never freed individually.
+*/
+template<typename T>
+class CKeyvaluesAllocator
+{
+public:
+	typedef T value_type;
+
+	typedef std::false_type propagate_on_container_copy_assignment;
+	typedef std::false_type propagate_on_container_move_assignment;
+	typedef std::false_type propagate_on_container_swap;
+
+public:
+	CKeyvaluesAllocator() = default;
+
+	explicit CKeyvaluesAllocator( CKeyvaluesArena* pArena )
+		: m_pArena( pArena )
+	{
+	}
+
+	template<typename U>
+	CKeyvaluesAllocator( const CKeyvaluesAllocator<U>& other )
+		: m_pArena( other.GetArena() )
+	{
+	}
+
+	CKeyvaluesArena* GetArena() const { return m_pArena; }
+
+	T* allocate( const size_t uiCount )
+	{
+		if( m_pArena )
+			return static_cast<T*>( m_pArena->Allocate( sizeof( T ) * uiCount, alignof( T ) ) );
+
+		return static_cast<T*>( ::operator new( sizeof( T ) * uiCount ) );
+	}
+
+	void deallocate( T* pMemory, const size_t )
+	{
+		if( !m_pArena )
+			::operator delete( pMemory );
+	}
+
+	/**
+	*	Copies of containers always allocate from the heap, so they can outlive the arena.
+	*/
+	CKeyvaluesAllocator select_on_container_copy_construction() const { return CKeyvaluesAllocator(); }
+
+private:
+	CKeyvaluesArena* m_pArena = nullptr;
+};
+
+template<typename T, typename U>
+inline bool operator==( const CKeyvaluesAllocator<T>& lhs, const CKeyvaluesAllocator<U>& rhs )
+{
+	return lhs.GetArena() == rhs.GetArena();
+}
+
+template<typename T, typename U>
+inline bool operator!=( const CKeyvaluesAllocator<T>& lhs, const CKeyvaluesAllocator<U>& rhs )
+{
+	return !( lhs == rhs );
+}
+}
+
+#endif //KEYVALUES_CKEYVALUESARENA_H
@@ -0,0 +1,400 @@
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "shared/Logging.h"
+
+#include "CKeyvalue.h"
+#include "CKeyvalueBlock.h"
+#include "CKeyvaluesArena.h"
+#include "CKeyvaluesWriter.h"
+
+#include "CKeyvaluesBinary.h"
+
+namespace keyvalues
+{
+namespace
+{
+class CStringTable final
+{
+public:
+	uint32_t Add( const CString& szString )
+	{
+		auto result = m_Indices.emplace( std::string( szString.CStr(), szString.Length() ), static_cast<uint32_t>( m_Strings.size() ) );
+
+		if( result.second )
+			m_Strings.push_back( &result.first->first );
+
+		return result.first->second;
+	}
+
+	const std::vector<const std::string*>& GetStrings() const { return m_Strings; }
+
+private:
+	std::unordered_map<std::string, uint32_t> m_Indices;
+
+	//Points to the map's keys, which are never moved.
+	std::vector<const std::string*> m_Strings;
+};
+
+template<typename T>
+void Append( std::string& output, const T& value )
+{
+	output.append( reinterpret_cast<const char*>( &value ), sizeof( value ) );
+}
+
+template<typename T>
+T ReadAt( const unsigned char* pData, const size_t uiOffset )
+{
+	//The data isn't necessarily aligned.
+	T value;
+	memcpy( &value, pData + uiOffset, sizeof( value ) );
+
+	return value;
+}
+
+/**
+*	Checks that uiCount elements of size uiElementSize starting at uiOffset fit in uiSize bytes.
+*/
+bool IsRangeValid( const size_t uiSize, const size_t uiOffset, const size_t uiCount, const size_t uiElementSize )
+{
+	return uiOffset <= uiSize && uiCount <= ( uiSize - uiOffset ) / uiElementSize;
+}
+}
+
+bool WriteBinaryKeyvalues( const CKeyvalueBlock& root, std::string& output )
+{
+	output.clear();
+
+	CStringTable strings;
+
+	std::vector<binary::Node_t> nodes;
+
+	//Blocks are laid out breadth first, so the children of each block are contiguous and blocks are visited in node order.
+	std::deque<std::pair<const CKeyvalueBlock*, size_t>> blocks;
+
+	nodes.push_back( { strings.Add( root.GetKey() ), static_cast<uint32_t>( NodeType::BLOCK ), 0, 0 } );
+	blocks.emplace_back( &root, 0 );
+
+	while( !blocks.empty() )
+	{
+		const CKeyvalueBlock& block = *blocks.front().first;
+		const size_t uiIndex = blocks.front().second;
+
+		blocks.pop_front();
+
+		const auto& children = block.GetChildren();
+
+		if( nodes.size() + children.size() > std::numeric_limits<uint32_t>::max() )
+		{
+			Error( "WriteBinaryKeyvalues: Too many nodes\n" );
+			return false;
+		}
+
+		nodes[ uiIndex ].uiValue = static_cast<uint32_t>( nodes.size() );
+		nodes[ uiIndex ].uiChildCount = static_cast<uint32_t>( children.size() );
+
+		for( const auto pChild : children )
+		{
+			binary::Node_t node{ strings.Add( pChild->GetKey() ), static_cast<uint32_t>( pChild->GetType() ), 0, 0 };
+
+			if( pChild->GetType() == NodeType::BLOCK )
+				blocks.emplace_back( static_cast<const CKeyvalueBlock*>( pChild ), nodes.size() );
+			else
+				node.uiValue = strings.Add( static_cast<const CKeyvalue*>( pChild )->GetValue() );
+
+			nodes.push_back( node );
+		}
+	}
+
+	const auto& stringList = strings.GetStrings();
+
+	size_t uiDataSize = 0;
+
+	for( const auto pszString : stringList )
+	{
+		uiDataSize += pszString->size() + 1;
+	}
+
+	binary::Header_t header;
+
+	header.uiMagic = binary::MAGIC;
+	header.uiVersion = binary::VERSION;
+	header.uiStringCount = static_cast<uint32_t>( stringList.size() );
+	header.uiStringsOffset = sizeof( binary::Header_t );
+	header.uiNodeCount = static_cast<uint32_t>( nodes.size() );
+
+	const size_t uiStringDataOffset = header.uiStringsOffset + stringList.size() * sizeof( binary::String_t );
+
+	//Align the nodes so they can be read in place.
+	const size_t uiNodesOffset = ( uiStringDataOffset + uiDataSize + alignof( binary::Node_t ) - 1 ) & ~( alignof( binary::Node_t ) - 1 );
+
+	const size_t uiTotalSize = uiNodesOffset + nodes.size() * sizeof( binary::Node_t );
+
+	if( uiTotalSize > std::numeric_limits<uint32_t>::max() )
+	{
+		Error( "WriteBinaryKeyvalues: Keyvalues too large\n" );
+		return false;
+	}
+
+	header.uiNodesOffset = static_cast<uint32_t>( uiNodesOffset );
+
+	output.reserve( uiTotalSize );
+
+	Append( output, header );
+
+	size_t uiOffset = uiStringDataOffset;
+
+	for( const auto pszString : stringList )
+	{
+		const binary::String_t string{ static_cast<uint32_t>( uiOffset ), static_cast<uint32_t>( pszString->size() ) };
+
+		Append( output, string );
+
+		uiOffset += pszString->size() + 1;
+	}
+
+	for( const auto pszString : stringList )
+	{
+		output.append( pszString->c_str(), pszString->size() + 1 );
+	}
+
+	output.resize( uiNodesOffset, '\0' );
+
+	output.append( reinterpret_cast<const char*>( nodes.data() ), nodes.size() * sizeof( binary::Node_t ) );
+
+	return true;
+}
+
+bool SaveBinaryKeyvalues( const CKeyvalueBlock& root, const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	std::string output;
+
+	if( !WriteBinaryKeyvalues( root, output ) )
+		return false;
+
+	if( !CKeyvaluesWriter::WriteFileAtomic( pszFilename, output.data(), output.size() ) )
+	{
+		Error( "SaveBinaryKeyvalues: Couldn't write \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	return true;
+}
+
+CKeyvaluesBinaryReader::~CKeyvaluesBinaryReader()
+{
+	Close();
+}
+
+bool CKeyvaluesBinaryReader::Open( const char* const pszFilename )
+{
+	assert( pszFilename );
+
+	Close();
+
+	if( !m_File.Open( pszFilename ) )
+	{
+		Error( "CKeyvaluesBinaryReader::Open: Couldn't open \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	if( !Build( m_File.GetData(), m_File.GetSize() ) )
+	{
+		Error( "CKeyvaluesBinaryReader::Open: \"%s\" is not a valid binary keyvalues file\n", pszFilename );
+
+		m_File.Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool CKeyvaluesBinaryReader::Load( const void* const pData, const size_t uiSize )
+{
+	assert( pData || !uiSize );
+
+	Close();
+
+	return Build( pData, uiSize );
+}
+
+void CKeyvaluesBinaryReader::Close()
+{
+	m_pKeyvalues.reset();
+
+	m_File.Close();
+}
+
+bool CKeyvaluesBinaryReader::Build( const void* const pData, const size_t uiSize )
+{
+	const unsigned char* const pBytes = static_cast<const unsigned char*>( pData );
+
+	if( uiSize < sizeof( binary::Header_t ) )
+		return false;
+
+	const auto header = ReadAt<binary::Header_t>( pBytes, 0 );
+
+	if( header.uiMagic != binary::MAGIC || header.uiVersion != binary::VERSION )
+		return false;
+
+	if( !header.uiNodeCount ||
+		!IsRangeValid( uiSize, header.uiStringsOffset, header.uiStringCount, sizeof( binary::String_t ) ) ||
+		!IsRangeValid( uiSize, header.uiNodesOffset, header.uiNodeCount, sizeof( binary::Node_t ) ) )
+		return false;
+
+	//Validate all strings up front so nodes can reference them without further checks.
+	for( uint32_t uiString = 0; uiString < header.uiStringCount; ++uiString )
+	{
+		const auto string = ReadAt<binary::String_t>( pBytes, header.uiStringsOffset + uiString * sizeof( binary::String_t ) );
+
+		if( !IsRangeValid( uiSize, string.uiOffset, static_cast<size_t>( string.uiLength ) + 1, 1 ) || pBytes[ string.uiOffset + string.uiLength ] != '\0' )
+			return false;
+	}
+
+	auto getString = [ & ]( const uint32_t uiString, const char*& pszString, size_t& uiLength )
+	{
+		if( uiString >= header.uiStringCount )
+			return false;
+
+		const auto string = ReadAt<binary::String_t>( pBytes, header.uiStringsOffset + uiString * sizeof( binary::String_t ) );
+
+		pszString = reinterpret_cast<const char*>( pBytes + string.uiOffset );
+		uiLength = string.uiLength;
+
+		return true;
+	};
+
+	auto arena = std::make_unique<CKeyvaluesArena>();
+
+	CKeyvaluesArena& nodeArena = *arena;
+
+	//The root is allocated normally so it can own the arena.
+	std::unique_ptr<CKeyvalueBlock> root( new CKeyvalueBlock( "", nodeArena ) );
+	root->SetArena( std::move( arena ) );
+
+	std::vector<CKeyvalueNode*> nodes( header.uiNodeCount, nullptr );
+
+	nodes[ 0 ] = root.get();
+
+	//Each block's children must directly follow the children of the block before it.
+	//This guarantees that every node has exactly one parent, and that there are no cycles.
+	uint32_t uiNextChild = 1;
+
+	const char* pszString;
+	size_t uiLength;
+
+	for( uint32_t uiNode = 0; uiNode < header.uiNodeCount; ++uiNode )
+	{
+		if( !nodes[ uiNode ] )
+			return false;
+
+		const auto node = ReadAt<binary::Node_t>( pBytes, header.uiNodesOffset + uiNode * sizeof( binary::Node_t ) );
+
+		if( !getString( node.uiKey, pszString, uiLength ) )
+			return false;
+
+		nodes[ uiNode ]->SetKey( pszString, uiLength );
+
+		if( node.uiType != static_cast<uint32_t>( nodes[ uiNode ]->GetType() ) )
+			return false;
+
+		if( nodes[ uiNode ]->GetType() == NodeType::KEYVALUE )
+		{
+			if( node.uiChildCount || !getString( node.uiValue, pszString, uiLength ) )
+				return false;
+
+			static_cast<CKeyvalue*>( nodes[ uiNode ] )->SetValueStatic( pszString, uiLength );
+
+			continue;
+		}
+
+		if( node.uiValue != uiNextChild || node.uiChildCount > header.uiNodeCount - uiNextChild )
+			return false;
+
+		auto& children = static_cast<CKeyvalueBlock*>( nodes[ uiNode ] )->GetChildren();
+
+		children.reserve( node.uiChildCount );
+
+		for( uint32_t uiChild = uiNextChild; uiChild < uiNextChild + node.uiChildCount; ++uiChild )
+		{
+			//Only the type is needed here; keys and values are set when the child is visited.
+			const auto child = ReadAt<binary::Node_t>( pBytes, header.uiNodesOffset + uiChild * sizeof( binary::Node_t ) );
+
+			CKeyvalueNode* pChild;
+
+			if( child.uiType == static_cast<uint32_t>( NodeType::BLOCK ) )
+				pChild = new( nodeArena ) CKeyvalueBlock( "", nodeArena );
+			else
+				pChild = new( nodeArena ) CKeyvalue( "", "" );
+
+			children.push_back( pChild );
+
+			nodes[ uiChild ] = pChild;
+		}
+
+		uiNextChild += node.uiChildCount;
+	}
+
+	if( uiNextChild != header.uiNodeCount )
+		return false;
+
+	m_pKeyvalues = std::move( root );
+
+	return true;
+}
+
+bool ConvertTextToBinaryKeyvalues( const char* const pszTextFilename, const char* const pszBinaryFilename, const CKeyvaluesParserSettings& settings )
+{
+	assert( pszTextFilename );
+	assert( pszBinaryFilename );
+
+	CKeyvaluesParser parser( pszTextFilename, settings );
+
+	if( !parser.HasInputData() )
+	{
+		Error( "ConvertTextToBinaryKeyvalues: Couldn't open \"%s\"\n", pszTextFilename );
+		return false;
+	}
+
+	const CKeyvaluesParser::ParseResult result = parser.Parse();
+
+	if( result != CKeyvaluesParser::ParseResult::SUCCESS )
+	{
+		Error( "ConvertTextToBinaryKeyvalues: Error parsing \"%s\": %s\n", pszTextFilename, CKeyvaluesParser::ParseResultToString( result ) );
+		return false;
+	}
+
+	return SaveBinaryKeyvalues( *parser.GetKeyvalues(), pszBinaryFilename );
+}
+
+bool ConvertBinaryToTextKeyvalues( const char* const pszBinaryFilename, const char* const pszTextFilename )
+{
+	assert( pszBinaryFilename );
+	assert( pszTextFilename );
+
+	CKeyvaluesBinaryReader reader;
+
+	if( !reader.Open( pszBinaryFilename ) )
+		return false;
+
+	CKeyvaluesWriter writer( pszTextFilename );
+
+	//The root block is implicit in text files.
+	for( const auto pChild : reader.GetKeyvalues()->GetChildren() )
+	{
+		if( !writer.Write( *pChild ) )
+		{
+			writer.Discard();
+			return false;
+		}
+	}
+
+	return writer.Close();
+}
+}
@@ -0,0 +1,172 @@
+#ifndef KEYVALUES_CKEYVALUESBINARY_H
+#define KEYVALUES_CKEYVALUESBINARY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "utility/CMappedFile.h"
+
+#include "CKeyvaluesParser.h"
+
+namespace keyvalues
+{
+class CKeyvalueBlock;
+
+/**
+*	Binary keyvalues format.
+*	The file starts with a header, followed by the string table, the string data and the nodes.
+*	Strings are interned: each distinct key or value is stored once, null terminated.
+*	Node 0 is the root block. The children of a block are stored contiguously, after the block itself.
+*	All values are little endian.
+*/
+namespace binary
+{
+const uint32_t MAGIC = 'K' | ( 'V' << 8 ) | ( 'B' << 16 ) | ( '1' << 24 );
+
+const uint32_t VERSION = 1;
+
+struct Header_t
+{
+	uint32_t uiMagic;
+	uint32_t uiVersion;
+
+	uint32_t uiStringCount;
+
+	/**
+	*	Offset of the String_t table.
+	*/
+	uint32_t uiStringsOffset;
+
+	uint32_t uiNodeCount;
+
+	/**
+	*	Offset of the Node_t table.
+	*/
+	uint32_t uiNodesOffset;
+};
+
+struct String_t
+{
+	/**
+	*	Offset of the string's data. The data is followed by a null terminator.
+	*/
+	uint32_t uiOffset;
+	uint32_t uiLength;
+};
+
+struct Node_t
+{
+	/**
+	*	Index of the key string.
+	*/
+	uint32_t uiKey;
+
+	/**
+	*	NodeType of this node.
+	*/
+	uint32_t uiType;
+
+	/**
+	*	Keyvalues: index of the value string.
+	*	Blocks: index of the first child node.
+	*/
+	uint32_t uiValue;
+
+	/**
+	*	Number of children. Always 0 for keyvalues.
+	*/
+	uint32_t uiChildCount;
+};
+}
+
+/**
+*	Encodes a keyvalue tree in the binary format.
+*	@param root Root block. Its key is not stored.
+*	@param output Destination buffer. Its contents are replaced.
+*	@return Whether the tree could be encoded.
+*/
+bool WriteBinaryKeyvalues( const CKeyvalueBlock& root, std::string& output );
+
+/**
+*	Saves a keyvalue tree to a file in the binary format. The file is replaced atomically.
+*	@see WriteBinaryKeyvalues
+*/
+bool SaveBinaryKeyvalues( const CKeyvalueBlock& root, const char* const pszFilename );
+
+/**
+*	Reads binary keyvalues in place. Files are memory mapped; keys and values are not copied,
+*	only the nodes themselves are allocated, all from one arena.
+*	The tree returned by GetKeyvalues is only valid for as long as the reader has it loaded.
+*/
+class CKeyvaluesBinaryReader final
+{
+public:
+	CKeyvaluesBinaryReader() = default;
+	~CKeyvaluesBinaryReader();
+
+	/**
+	*	@return Whether binary keyvalues are loaded.
+	*/
+	bool IsOpen() const { return m_pKeyvalues != nullptr; }
+
+	/**
+	*	Maps a binary keyvalues file and loads it. Closes the current file first.
+	*	@return Whether the file was loaded.
+	*/
+	bool Open( const char* const pszFilename );
+
+	/**
+	*	Loads binary keyvalues from memory. Closes the current file first.
+	*	@param pData Data to load. Must remain valid until the reader is closed.
+	*	@param uiSize Size of the data, in bytes.
+	*	@return Whether the data was loaded.
+	*/
+	bool Load( const void* const pData, const size_t uiSize );
+
+	/**
+	*	Frees the keyvalues and unmaps the file.
+	*/
+	void Close();
+
+	/**
+	*	@return The root block, or null if nothing is loaded.
+	*/
+	const CKeyvalueBlock* GetKeyvalues() const { return m_pKeyvalues.get(); }
+
+private:
+	/**
+	*	Validates the data and builds the tree.
+	*/
+	bool Build( const void* const pData, const size_t uiSize );
+
+private:
+	CMappedFile m_File;
+
+	std::unique_ptr<CKeyvalueBlock> m_pKeyvalues;
+
+private:
+	CKeyvaluesBinaryReader( const CKeyvaluesBinaryReader& ) = delete;
+	CKeyvaluesBinaryReader& operator=( const CKeyvaluesBinaryReader& ) = delete;
+};
+
+/**
+*	Converts a text keyvalues file to the binary format.
+*	@param pszTextFilename Name of the text file to read.
+*	@param pszBinaryFilename Name of the binary file to write.
+*	@param settings Settings used to parse the text file.
+*	@return Whether the file was converted.
+*/
+bool ConvertTextToBinaryKeyvalues( const char* const pszTextFilename, const char* const pszBinaryFilename,
+								   const CKeyvaluesParserSettings& settings = CKeyvaluesParserSettings() );
+
+/**
+*	Converts a binary keyvalues file to the text format.
+*	@param pszBinaryFilename Name of the binary file to read.
+*	@param pszTextFilename Name of the text file to write.
+*	@return Whether the file was converted.
+*/
+bool ConvertBinaryToTextKeyvalues( const char* const pszBinaryFilename, const char* const pszTextFilename );
+}
+
+#endif //KEYVALUES_CKEYVALUESBINARY_H
@@ -1,15 +1,165 @@
 #include <cassert>
 #include <cctype>
+#include <cstddef>
 #include <cstring>
 #include <cstdio>
 #include <algorithm>
 
+#include <emmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #include "shared/Logging.h"
 
+#include "utility/PlatUtils.h"
+
 #include "CKeyvaluesLexer.h"
 
 namespace keyvalues
 {
+namespace
+{
+/**
+*	Number of characters scanned at a time by the SIMD scanners.
+*/
+const ptrdiff_t SIMD_WIDTH = 16;
+
+/**
+*	Same as isspace in the C locale, without the locale lookup.
+*/
+inline bool IsWhitespace( const char c )
+{
+	return c == ' ' || static_cast<unsigned char>( c - '\t' ) <= '\r' - '\t';
+}
+
+inline int CountTrailingZeros( const unsigned int uiValue )
+{
+#ifdef _MSC_VER
+	unsigned long ulIndex;
+	_BitScanForward( &ulIndex, uiValue );
+	return static_cast<int>( ulIndex );
+#else
+	return __builtin_ctz( uiValue );
+#endif
+}
+
+bool IsSIMDScanSupported()
+{
+	static const bool bSupported = plat::IsSSE2Supported();
+
+	return bSupported;
+}
+
+/**
+*	@return Bit mask of the whitespace characters in chars.
+*/
+SSE2_TARGET inline int WhitespaceMask( const __m128i chars )
+{
+	//'\t' through '\r' are contiguous; an unsigned compare after subtracting '\t' finds them in one test.
+	const __m128i offset = _mm_sub_epi8( chars, _mm_set1_epi8( '\t' ) );
+	const __m128i controls = _mm_cmpeq_epi8( _mm_min_epu8( offset, _mm_set1_epi8( '\r' - '\t' ) ), offset );
+	const __m128i spaces = _mm_cmpeq_epi8( chars, _mm_set1_epi8( ' ' ) );
+
+	return _mm_movemask_epi8( _mm_or_si128( controls, spaces ) );
+}
+
+SSE2_TARGET const char* FindNonWhitespaceSIMD( const char* pszBegin, const char* const pszEnd )
+{
+	for( ; pszEnd - pszBegin >= SIMD_WIDTH; pszBegin += SIMD_WIDTH )
+	{
+		const int iMask = WhitespaceMask( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pszBegin ) ) ) ^ 0xFFFF;
+
+		if( iMask )
+			return pszBegin + CountTrailingZeros( iMask );
+	}
+
+	return pszBegin;
+}
+
+SSE2_TARGET const char* FindWhitespaceSIMD( const char* pszBegin, const char* const pszEnd )
+{
+	for( ; pszEnd - pszBegin >= SIMD_WIDTH; pszBegin += SIMD_WIDTH )
+	{
+		const int iMask = WhitespaceMask( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pszBegin ) ) );
+
+		if( iMask )
+			return pszBegin + CountTrailingZeros( iMask );
+	}
+
+	return pszBegin;
+}
+
+SSE2_TARGET const char* FindQuotedStringControlSIMD( const char* pszBegin, const char* const pszEnd, const char cDelimiter )
+{
+	const __m128i quote = _mm_set1_epi8( CONTROL_QUOTE );
+	const __m128i newline = _mm_set1_epi8( '\n' );
+	const __m128i delimiter = _mm_set1_epi8( cDelimiter );
+
+	for( ; pszEnd - pszBegin >= SIMD_WIDTH; pszBegin += SIMD_WIDTH )
+	{
+		const __m128i chars = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pszBegin ) );
+
+		const int iMask = _mm_movemask_epi8( _mm_or_si128( _mm_or_si128(
+			_mm_cmpeq_epi8( chars, quote ),
+			_mm_cmpeq_epi8( chars, newline ) ),
+			_mm_cmpeq_epi8( chars, delimiter ) ) );
+
+		if( iMask )
+			return pszBegin + CountTrailingZeros( iMask );
+	}
+
+	return pszBegin;
+}
+
+/**
+*	Finds the first character that isn't whitespace.
+*	@return Pointer to the character, or pszEnd if there is none.
+*/
+const char* FindNonWhitespace( const char* pszBegin, const char* const pszEnd )
+{
+	if( IsSIMDScanSupported() )
+		pszBegin = FindNonWhitespaceSIMD( pszBegin, pszEnd );
+
+	//Scan the remainder of the buffer.
+	while( pszBegin < pszEnd && IsWhitespace( *pszBegin ) )
+		++pszBegin;
+
+	return pszBegin;
+}
+
+/**
+*	Finds the first whitespace character.
+*	@return Pointer to the character, or pszEnd if there is none.
+*/
+const char* FindWhitespace( const char* pszBegin, const char* const pszEnd )
+{
+	if( IsSIMDScanSupported() )
+		pszBegin = FindWhitespaceSIMD( pszBegin, pszEnd );
+
+	while( pszBegin < pszEnd && !IsWhitespace( *pszBegin ) )
+		++pszBegin;
+
+	return pszBegin;
+}
+
+/**
+*	Finds the first character that ends or interrupts a quoted string: a quote, a newline or an escape sequence delimiter.
+*	@return Pointer to the character, or pszEnd if there is none.
+*/
+const char* FindQuotedStringControl( const char* pszBegin, const char* const pszEnd, const char cDelimiter )
+{
+	if( IsSIMDScanSupported() )
+		pszBegin = FindQuotedStringControlSIMD( pszBegin, pszEnd, cDelimiter );
+
+	while( pszBegin < pszEnd && *pszBegin != CONTROL_QUOTE && *pszBegin != '\n' && *pszBegin != cDelimiter )
+		++pszBegin;
+
+	return pszBegin;
+}
+}
+
 CKeyvaluesLexer::CKeyvaluesLexer( const CKeyvaluesLexerSettings& settings )
 	: m_TokenType( TokenType::NONE )
 	, m_pszCurrentPosition( nullptr )
@@ -31,7 +181,7 @@ CKeyvaluesLexer::CKeyvaluesLexer( Memory_t& memory, const CKeyvaluesLexerSetting
 
 	m_Memory.Swap( memory );
 
-	m_pszCurrentPosition = reinterpret_cast<const char*>( m_Memory.GetMemory() );
+	InitializeReadPosition();
 }
 
 CKeyvaluesLexer::CKeyvaluesLexer( Memory_t& memory, CEscapeSequences& escapeSeqConversion, const CKeyvaluesLexerSettings& settings )
@@ -66,7 +216,7 @@ CKeyvaluesLexer::CKeyvaluesLexer( const char* const pszFilename, const CKeyvalue
 			m_Memory.Swap( memory );
 
 			//TODO: preparse file and normalize newlines if needed
-			m_pszCurrentPosition = reinterpret_cast<const char*>( m_Memory.GetMemory() );
+			InitializeReadPosition();
 		}
 	}
 }
@@ -87,11 +237,17 @@ CKeyvaluesLexer::size_type CKeyvaluesLexer::GetReadOffset() const
 	return m_pszCurrentPosition ? m_pszCurrentPosition - reinterpret_cast<const char*>( m_Memory.GetMemory() ) : 0;
 }
 
-void CKeyvaluesLexer::Reset()
+void CKeyvaluesLexer::InitializeReadPosition()
 {
 	m_pszCurrentPosition = reinterpret_cast<const char*>( m_Memory.GetMemory() );
+	m_pszEnd = m_pszCurrentPosition ? m_pszCurrentPosition + m_Memory.GetSize() : nullptr;
+}
+
+void CKeyvaluesLexer::Reset()
+{
+	InitializeReadPosition();
 	m_TokenType = TokenType::NONE;
-	m_szToken = "";
+	SetToken( nullptr, 0 );
 }
 
 void CKeyvaluesLexer::Swap( CKeyvaluesLexer& other )
@@ -100,12 +256,67 @@ void CKeyvaluesLexer::Swap( CKeyvaluesLexer& other )
 	{
 		m_Memory.Swap( other.m_Memory );
 		std::swap( m_pszCurrentPosition, other.m_pszCurrentPosition );
+		std::swap( m_pszEnd, other.m_pszEnd );
 		std::swap( m_TokenType, other.m_TokenType );
+		std::swap( m_TokenView, other.m_TokenView );
 		std::swap( m_szToken, other.m_szToken );
+		std::swap( m_bTokenConverted, other.m_bTokenConverted );
 		std::swap( m_Settings, other.m_Settings );
 	}
 }
 
+const CString& CKeyvaluesLexer::GetToken() const
+{
+	if( !m_bTokenConverted )
+	{
+		if( m_TokenView.bHasEscapeSequences )
+			ConvertEscapeSequences( m_TokenView, m_szToken );
+		else
+			m_szToken.AssignN( m_TokenView.pszBegin, m_TokenView.uiLength );
+
+		m_bTokenConverted = true;
+	}
+
+	return m_szToken;
+}
+
+const char* CKeyvaluesLexer::GetTokenText( const TokenView_t& token, CString& szBuffer, size_type& uiLength ) const
+{
+	if( !token.bHasEscapeSequences )
+	{
+		uiLength = token.uiLength;
+		return token.pszBegin ? token.pszBegin : "";
+	}
+
+	ConvertEscapeSequences( token, szBuffer );
+
+	uiLength = szBuffer.Length();
+
+	return szBuffer.CStr();
+}
+
+void CKeyvaluesLexer::ConvertEscapeSequences( const TokenView_t& token, CString& szDest ) const
+{
+	szDest.Clear();
+	szDest.Reserve( token.uiLength );
+
+	//The lexer has already validated the sequences. Converting never makes the token longer.
+	char* const pszDest = szDest.CStr();
+
+	pszDest[ m_pEscapeSeqConversion->Unescape( token.pszBegin, token.uiLength, pszDest ) ] = '\0';
+
+	szDest.RecalculateLength();
+}
+
+void CKeyvaluesLexer::SetToken( const char* pszBegin, const size_type uiLength, const bool bHasEscapeSequences )
+{
+	m_TokenView.pszBegin = pszBegin;
+	m_TokenView.uiLength = uiLength;
+	m_TokenView.bHasEscapeSequences = bHasEscapeSequences;
+
+	m_bTokenConverted = false;
+}
+
 CKeyvaluesLexer::ReadResult CKeyvaluesLexer::Read()
 {
 	ReadResult result = ReadNextToken();
@@ -117,18 +328,10 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::Read()
 	return result;
 }
 
-bool CKeyvaluesLexer::IsValidReadPosition()
-{
-	const size_t offset = ( m_pszCurrentPosition - reinterpret_cast<const char*>( m_Memory.GetMemory() ) );
-	return static_cast<size_type>( m_pszCurrentPosition - reinterpret_cast<const char*>( m_Memory.GetMemory() ) ) < m_Memory.GetSize();
-}
-
 void CKeyvaluesLexer::SkipWhitespace()
 {
-	while( IsValidReadPosition() && isspace( *m_pszCurrentPosition ) )
-	{
-		++m_pszCurrentPosition;
-	}
+	if( IsValidReadPosition() )
+		m_pszCurrentPosition = FindNonWhitespace( m_pszCurrentPosition, m_pszEnd );
 }
 
 bool CKeyvaluesLexer::SkipComments()
@@ -153,15 +356,14 @@ bool CKeyvaluesLexer::SkipCommentLine()
 	if( !IsValidReadPosition() )
 		return false;
 
-	if( *m_pszCurrentPosition == '/' && *( m_pszCurrentPosition + 1 ) == '/' )
+	if( *m_pszCurrentPosition == '/' && m_pszCurrentPosition + 1 < m_pszEnd && *( m_pszCurrentPosition + 1 ) == '/' )
 	{
 		m_pszCurrentPosition += 2;
 
 		//Skip all characters, including the newline
-		while( *( m_pszCurrentPosition - 1 ) != '\n' && IsValidReadPosition() )
-		{
-			++m_pszCurrentPosition;
-		}
+		const char* pszNewline = static_cast<const char*>( memchr( m_pszCurrentPosition, '\n', m_pszEnd - m_pszCurrentPosition ) );
+
+		m_pszCurrentPosition = pszNewline ? pszNewline + 1 : m_pszEnd;
 
 		return true;
 	}
@@ -188,18 +390,23 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::ReadNext( const char*& pszBegin, co
 
 			pszBegin = m_pszCurrentPosition;
 
-			while( *m_pszCurrentPosition != CONTROL_QUOTE && *m_pszCurrentPosition != '\n' && IsValidReadPosition() )
+			const char cDelimiter = m_pEscapeSeqConversion->GetDelimiterChar();
+
+			while( true )
 			{
+				m_pszCurrentPosition = FindQuotedStringControl( m_pszCurrentPosition, m_pszEnd, cDelimiter );
+
+				if( !IsValidReadPosition() || *m_pszCurrentPosition != cDelimiter )
+					break;
+
 				//This is the start of an escape sequence, so skip it and the sequence itself.
-				if( m_pEscapeSeqConversion->GetDelimiterChar() == *m_pszCurrentPosition )
+				if( m_pszEnd - m_pszCurrentPosition < 2 )
 				{
-					++m_pszCurrentPosition;
-
-					if( !IsValidReadPosition() )
-						break;
+					m_pszCurrentPosition = m_pszEnd;
+					break;
 				}
 
-				++m_pszCurrentPosition;
+				m_pszCurrentPosition += 2;
 			}
 
 			pszEnd = m_pszCurrentPosition;
@@ -238,8 +445,7 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::ReadNext( const char*& pszBegin, co
 
 			pszBegin = m_pszCurrentPosition;
 
-			while( !isspace( *m_pszCurrentPosition ) && IsValidReadPosition() )
-				++m_pszCurrentPosition;
+			m_pszCurrentPosition = FindWhitespace( m_pszCurrentPosition, m_pszEnd );
 
 			pszEnd = m_pszCurrentPosition;
 
@@ -295,12 +501,12 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::ReadNextToken()
 						Error( "CKeyvaluesLexer::ReadNextToken: illegal block open '%c'!\n", CONTROL_BLOCK_OPEN );
 
 					result = ReadResult::FORMAT_ERROR;
-					m_szToken = "";
+					SetToken( nullptr, 0 );
 					m_TokenType = TokenType::NONE;
 				}
 				else
 				{
-					m_szToken = CONTROL_BLOCK_OPEN;
+					SetToken( pszBegin, 1 );
 					m_TokenType = TokenType::BLOCK_OPEN;
 				}
 
@@ -315,12 +521,12 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::ReadNextToken()
 						Error( "CKeyvaluesLexer::ReadNextToken: illegal block close '%c'!\n", CONTROL_BLOCK_CLOSE );
 
 					result = ReadResult::FORMAT_ERROR;
-					m_szToken = "";
+					SetToken( nullptr, 0 );
 					m_TokenType = TokenType::NONE;
 				}
 				else
 				{
-					m_szToken = CONTROL_BLOCK_CLOSE;
+					SetToken( pszBegin, 1 );
 					m_TokenType = TokenType::BLOCK_CLOSE;
 				}
 
@@ -330,13 +536,11 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::ReadNextToken()
 		
 		if( !bHandled )
 		{
-			//Process and check if there are escape characters.
+			//Validate escape sequences. They are converted when the token is requested as a string.
 
 			const size_t uiMaxSize = pszEnd - pszBegin;
 
-			m_szToken.Reserve( uiMaxSize );
-
-			m_szToken.Clear();
+			bool bHasEscapeSequences = false;
 
 			for( size_t uiIndex = 0; uiIndex < uiMaxSize; )
 			{
@@ -344,11 +548,9 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::ReadNextToken()
 				{
 					if( uiIndex + 1 < uiMaxSize )
 					{
-						const char cEscapeSeq = m_pEscapeSeqConversion->GetEscapeSequence( &pszBegin[ uiIndex ] );
-
-						if( cEscapeSeq != CEscapeSequences::INVALID_CHAR )
+						if( m_pEscapeSeqConversion->GetEscapeSequence( &pszBegin[ uiIndex ] ) != CEscapeSequences::INVALID_CHAR )
 						{
-							m_szToken += cEscapeSeq;
+							bHasEscapeSequences = true;
 
 							uiIndex += 2;
 						}
@@ -358,31 +560,30 @@ CKeyvaluesLexer::ReadResult CKeyvaluesLexer::ReadNextToken()
 								Error( "CKeyvaluesLexer::ReadNextToken: illegal escape sequence '%c%c'!\n", pszBegin[ uiIndex ], pszBegin[ uiIndex + 1 ] );
 
 							result = ReadResult::FORMAT_ERROR;
-							m_szToken = "";
-							m_TokenType = TokenType::NONE;
-
 							break;
 						}
 					}
 					else
 					{
 						if( m_Settings.fLogErrors )
-							Error( "CKeyvaluesLexer::ReadNextToken: escape sequence delimiter '%c' at the end of a token!\n", pszBegin[ uiIndex - 1 ] );
+							Error( "CKeyvaluesLexer::ReadNextToken: escape sequence delimiter '%c' at the end of a token!\n", pszBegin[ uiIndex ] );
 
 						result = ReadResult::FORMAT_ERROR;
-						m_szToken = "";
-						m_TokenType = TokenType::NONE;
-
 						break;
 					}
 				}
 				else
-				{
-					m_szToken += pszBegin[ uiIndex ];
 					++uiIndex;
-				}
 			}
 
+			if( result == ReadResult::FORMAT_ERROR )
+			{
+				SetToken( nullptr, 0 );
+				m_TokenType = TokenType::NONE;
+			}
+			else
+				SetToken( pszBegin, uiMaxSize, bHasEscapeSequences );
+
 			//If the previous token was a key, this becomes a value
 			if( m_TokenType == TokenType::KEY )
 				m_TokenType = TokenType::VALUE;
@@ -29,6 +29,21 @@ public:
 
 	typedef CMemory<size_type> Memory_t;
 
+	/**
+	*	A token that points into the lexer's buffer. Valid until the lexer's data is changed.
+	*	Escape sequences in the token have been validated, but not converted.
+	*/
+	struct TokenView_t
+	{
+		const char* pszBegin = nullptr;
+		size_type uiLength = 0;
+
+		/**
+		*	Whether the token contains escape sequences that must be converted.
+		*/
+		bool bHasEscapeSequences = false;
+	};
+
 public:
 	/**
 	*	Constructs an empty lexer
@@ -98,9 +113,24 @@ public:
 	TokenType GetTokenType() const { return m_TokenType; }
 
 	/**
-	*	Gets the current token.
+	*	Gets the current token. Converts the token's escape sequences the first time this is called for a token.
+	*	@see GetTokenView
+	*/
+	const CString& GetToken() const;
+
+	/**
+	*	Gets the current token without copying it.
+	*/
+	const TokenView_t& GetTokenView() const { return m_TokenView; }
+
+	/**
+	*	Gets a token's text with escape sequences converted.
+	*	@param token Token to get the text of.
+	*	@param szBuffer If the token has escape sequences, the token is converted into this buffer.
+	*	@param uiLength Length of the text.
+	*	@return The text. If the token has no escape sequences this points into the lexer's buffer, and is not null terminated.
 	*/
-	const CString& GetToken() const { return m_szToken; }
+	const char* GetTokenText( const TokenView_t& token, CString& szBuffer, size_type& uiLength ) const;
 
 	/**
 	*	Gets the escape sequences conversion object.
@@ -134,7 +164,12 @@ public:
 	ReadResult Read();
 
 private:
-	bool IsValidReadPosition();
+	bool IsValidReadPosition() const { return m_pszCurrentPosition < m_pszEnd; }
+
+	/**
+	*	Sets the read position to the start of the input data, and caches the end of the data.
+	*/
+	void InitializeReadPosition();
 
 	void SkipWhitespace();
 
@@ -152,12 +187,24 @@ private:
 
 	ReadResult ReadNextToken();
 
+	/**
+	*	Converts escape sequences in a token that has been validated.
+	*/
+	void ConvertEscapeSequences( const TokenView_t& token, CString& szDest ) const;
+
+	void SetToken( const char* pszBegin, const size_type uiLength, const bool bHasEscapeSequences = false );
+
 private:
 	Memory_t			m_Memory;
 	const char*			m_pszCurrentPosition;
+	const char*			m_pszEnd = nullptr;		//End of the input data
 
 	TokenType			m_TokenType;			//Type of the last token we read
-	CString				m_szToken;				//The last token we read
+	TokenView_t			m_TokenView;			//The last token we read
+
+	//The last token converted to a string, created on demand.
+	mutable CString		m_szToken;
+	mutable bool		m_bTokenConverted = true;
 
 	CEscapeSequences* m_pEscapeSeqConversion = &GetNoEscapeSeqConversion();
 
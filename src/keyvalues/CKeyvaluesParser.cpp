@@ -1,6 +1,12 @@
+#include <memory>
+
+#include "shared/Perf.h"
+#include "shared/Trace.h"
+
 #include "CKeyvalueNode.h"
 #include "CKeyvalue.h"
 #include "CKeyvalueBlock.h"
+#include "CKeyvaluesArena.h"
 
 #include "CKeyvaluesParser.h"
 
@@ -69,6 +75,28 @@ void CBaseKeyvaluesParser::Initialize( CKeyvaluesLexer::Memory_t& memory )
 	m_iCurrentDepth = m_fIsIterative ? 1 : 0;
 }
 
+const char* CBaseKeyvaluesParser::GetTokenText( const CKeyvaluesLexer::TokenView_t& token, size_t& uiLength )
+{
+	CKeyvaluesLexer::size_type uiTokenLength;
+	const char* pszText = m_Lexer.GetTokenText( token, m_szTokenBuffer, uiTokenLength );
+
+	uiLength = uiTokenLength;
+
+	if( m_pArena )
+		pszText = m_pArena->AllocateString( pszText, uiLength );
+
+	return pszText;
+}
+
+void CBaseKeyvaluesParser::SetNodeKey( CKeyvalueNode& node, const CKeyvaluesLexer::TokenView_t& key )
+{
+	//Keys are interned, so they don't need a copy in the arena.
+	CKeyvaluesLexer::size_type uiLength;
+	const char* const pszKey = m_Lexer.GetTokenText( key, m_szTokenBuffer, uiLength );
+
+	node.SetKey( pszKey, uiLength );
+}
+
 CBaseKeyvaluesParser::ParseResult CBaseKeyvaluesParser::ParseNext( CKeyvalueNode*& pNode, bool fParseFirst )
 {
 	ParseResult parseResult;
@@ -98,7 +126,8 @@ CBaseKeyvaluesParser::ParseResult CBaseKeyvaluesParser::ParseNext( CKeyvalueNode
 		}
 	}
 
-	CString szKey = !fIsUnnamed ? m_Lexer.GetToken() : "";
+	//The key points into the lexer's buffer, which stays valid while parsing.
+	const CKeyvaluesLexer::TokenView_t key = !fIsUnnamed ? m_Lexer.GetTokenView() : CKeyvaluesLexer::TokenView_t();
 
 	//Only read again if named
 	if( !fIsUnnamed )
@@ -118,7 +147,9 @@ CBaseKeyvaluesParser::ParseResult CBaseKeyvaluesParser::ParseNext( CKeyvalueNode
 			//If parsing the root, current depth is 1
 			if( m_iCurrentDepth == 1 || m_Settings.fAllowNestedBlocks )
 			{
-				auto pBlock = new CKeyvalueBlock( szKey.CStr() );
+				auto pBlock = m_pArena ? new( *m_pArena ) CKeyvalueBlock( "", *m_pArena ) : new CKeyvalueBlock( "" );
+
+				SetNodeKey( *pBlock, key );
 
 				pNode = pBlock;
 
@@ -134,7 +165,19 @@ CBaseKeyvaluesParser::ParseResult CBaseKeyvaluesParser::ParseNext( CKeyvalueNode
 
 	case TokenType::VALUE:
 		{
-			pNode = new CKeyvalue( szKey.CStr(), m_Lexer.GetToken().CStr() );
+			auto pKeyvalue = m_pArena ? new( *m_pArena ) CKeyvalue( "", "" ) : new CKeyvalue( "", "" );
+
+			SetNodeKey( *pKeyvalue, key );
+
+			size_t uiLength;
+			const char* pszValue = GetTokenText( m_Lexer.GetTokenView(), uiLength );
+
+			if( m_pArena )
+				pKeyvalue->SetValueStatic( pszValue, uiLength );
+			else
+				pKeyvalue->SetValue( pszValue, uiLength );
+
+			pNode = pKeyvalue;
 			parseResult = ParseResult::SUCCESS;
 			break;
 		}
@@ -281,16 +324,34 @@ void CKeyvaluesParser::Initialize( CKeyvaluesLexer::Memory_t& memory )
 
 CKeyvaluesParser::ParseResult CKeyvaluesParser::Parse()
 {
+	TRACE_SCOPE( "CKeyvaluesParser::Parse" );
+	PERF_SCOPE( "CKeyvaluesParser::Parse" );
+
 	if( m_pKeyvalues )
 	{
 		delete m_pKeyvalues;
 		m_pKeyvalues = nullptr;
 	}
 
-	auto pRootNode = new CKeyvalueBlock( "" );
+	CKeyvalueBlock* pRootNode;
+
+	if( GetSettings().fUseArena )
+	{
+		auto arena = std::make_unique<CKeyvaluesArena>();
+
+		m_pArena = arena.get();
+
+		//The root itself is allocated normally so it can own the arena.
+		pRootNode = new CKeyvalueBlock( "", *arena );
+		pRootNode->SetArena( std::move( arena ) );
+	}
+	else
+		pRootNode = new CKeyvalueBlock( "" );
 
 	ParseResult result = ParseBlock( pRootNode, true );
 
+	m_pArena = nullptr;
+
 	if( result == ParseResult::SUCCESS )
 	{
 		m_pKeyvalues = pRootNode;
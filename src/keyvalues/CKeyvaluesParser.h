@@ -7,6 +7,7 @@ namespace keyvalues
 {
 class CKeyvalueNode;
 class CKeyvalueBlock;
+class CKeyvaluesArena;
 
 /**
 *	Parser settings.
@@ -17,8 +18,14 @@ struct CKeyvaluesParserSettings final
 
 	bool fAllowNestedBlocks;	//Keyvalues like entity data don't allow this
 
+	/**
+	*	If true, CKeyvaluesParser allocates the tree and its strings from an arena owned by the root block.
+	*/
+	bool fUseArena;
+
 	CKeyvaluesParserSettings()
 		: fAllowNestedBlocks( true )
+		, fUseArena( false )
 	{
 	}
 };
@@ -94,16 +101,37 @@ protected:
 
 	ParseResult ParseNext( CKeyvalueNode*& pNode, bool fParseFirst );
 
+	CKeyvaluesLexer& GetLexer() { return m_Lexer; }
+
+	int GetCurrentDepth() const { return m_iCurrentDepth; }
+
+	void SetCurrentDepth( const int iDepth ) { m_iCurrentDepth = iDepth; }
+
+	ParseResult GetResultFor( const CKeyvaluesLexer::ReadResult result, bool fExpectedMore = false ) const;
+
 	ParseResult ParseBlock( CKeyvalueBlock*& pBlock, bool fIsRoot );
 
 private:
 	void Construct();
 
-	ParseResult GetResultFor( const CKeyvaluesLexer::ReadResult result, bool fExpectedMore = false ) const;
+	/*
+	* Sets a node's key from a token, converting escape sequences if needed.
+	*/
+	void SetNodeKey( CKeyvalueNode& node, const CKeyvaluesLexer::TokenView_t& key );
+
+	/*
+	* Gets the text of a token. If an arena is used, the text is copied into it.
+	*/
+	const char* GetTokenText( const CKeyvaluesLexer::TokenView_t& token, size_t& uiLength );
 
 private:
 	CKeyvaluesLexer m_Lexer;
 
+	/*
+	* Scratch buffer for tokens that contain escape sequences.
+	*/
+	CString m_szTokenBuffer;
+
 	/*
 	* How deep we are in the parsing process.
 	* If a keyvalue exists in the global scope, we're 1 level deep.
@@ -115,6 +143,12 @@ private:
 
 	const bool m_fIsIterative;	//Required to make sure the current depth setting is valid for iterative calls
 
+protected:
+	/*
+	* If set, nodes are allocated from this arena.
+	*/
+	CKeyvaluesArena* m_pArena = nullptr;
+
 private:
 	CBaseKeyvaluesParser( const CBaseKeyvaluesParser& ) = delete;
 	CBaseKeyvaluesParser& operator=( const CBaseKeyvaluesParser& ) = delete;
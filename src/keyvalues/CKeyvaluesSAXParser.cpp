@@ -0,0 +1,142 @@
+#include "shared/Perf.h"
+#include "shared/Trace.h"
+
+#include "CKeyvaluesSAXParser.h"
+
+namespace keyvalues
+{
+CKeyvaluesSAXParser::CKeyvaluesSAXParser( const CKeyvaluesParserSettings& settings )
+	: BaseClass( settings, false )
+{
+}
+
+CKeyvaluesSAXParser::CKeyvaluesSAXParser( CKeyvaluesLexer::Memory_t& memory, const CKeyvaluesParserSettings& settings )
+	: BaseClass( memory, settings, false )
+{
+}
+
+CKeyvaluesSAXParser::CKeyvaluesSAXParser( const char* const pszFilename, const CKeyvaluesParserSettings& settings )
+	: BaseClass( pszFilename, settings, false )
+{
+}
+
+void CKeyvaluesSAXParser::GetTokenString( const CKeyvaluesLexer::TokenView_t& token, CString& szDest )
+{
+	CKeyvaluesLexer::size_type uiLength;
+	const char* pszText = GetLexer().GetTokenText( token, szDest, uiLength );
+
+	//Tokens with escape sequences are converted into the destination directly.
+	if( pszText != szDest.CStr() )
+		szDest.AssignN( pszText, uiLength );
+}
+
+CKeyvaluesSAXParser::ParseResult CKeyvaluesSAXParser::Parse( IKeyvaluesHandler& handler )
+{
+	TRACE_SCOPE( "CKeyvaluesSAXParser::Parse" );
+	PERF_SCOPE( "CKeyvaluesSAXParser::Parse" );
+
+	m_bStopped = false;
+
+	CKeyvaluesLexer& lexer = GetLexer();
+
+	//Same depth as CKeyvaluesParser uses for the root block.
+	SetCurrentDepth( 1 );
+
+	while( true )
+	{
+		CKeyvaluesLexer::ReadResult result = lexer.Read();
+
+		const bool bIsRoot = GetCurrentDepth() == 1;
+
+		if( result == CKeyvaluesLexer::ReadResult::END_OF_BUFFER && bIsRoot )
+			SetCurrentDepth( 0 );
+
+		ParseResult parseResult = GetResultFor( result );
+
+		if( lexer.GetTokenType() == TokenType::NONE )
+		{
+			//End of the file while in a block
+			return bIsRoot ? parseResult : ParseResult::FORMAT_ERROR;
+		}
+
+		if( parseResult != ParseResult::SUCCESS )
+			return parseResult;
+
+		if( lexer.GetTokenType() == TokenType::BLOCK_CLOSE )
+		{
+			//Root blocks can't be closed by the buffer
+			if( bIsRoot )
+				return ParseResult::FORMAT_ERROR;
+
+			SetCurrentDepth( GetCurrentDepth() - 1 );
+
+			if( !handler.OnBlockEnd() )
+			{
+				m_bStopped = true;
+				return ParseResult::SUCCESS;
+			}
+
+			continue;
+		}
+
+		bool bIsUnnamed = false;
+
+		//The token we've parsed in must be a key, otherwise the format is incorrect
+		if( lexer.GetTokenType() != TokenType::KEY )
+		{
+			if( !GetSettings().lexerSettings.fAllowUnnamedBlocks )
+				return ParseResult::FORMAT_ERROR;
+
+			bIsUnnamed = true;
+		}
+
+		const CKeyvaluesLexer::TokenView_t key = !bIsUnnamed ? lexer.GetTokenView() : CKeyvaluesLexer::TokenView_t();
+
+		//Only read again if named
+		if( !bIsUnnamed )
+		{
+			result = lexer.Read();
+
+			if( ( parseResult = GetResultFor( result, result == CKeyvaluesLexer::ReadResult::READ_TOKEN ) ) != ParseResult::SUCCESS )
+				return parseResult;
+		}
+
+		bool bContinue;
+
+		switch( lexer.GetTokenType() )
+		{
+		case TokenType::BLOCK_OPEN:
+			{
+				//If parsing the root, current depth is 1
+				if( !bIsRoot && !GetSettings().fAllowNestedBlocks )
+					return ParseResult::FORMAT_ERROR;
+
+				SetCurrentDepth( GetCurrentDepth() + 1 );
+
+				GetTokenString( key, m_szKey );
+
+				bContinue = handler.OnBlockBegin( m_szKey );
+				break;
+			}
+
+		case TokenType::VALUE:
+			{
+				GetTokenString( key, m_szKey );
+				GetTokenString( lexer.GetTokenView(), m_szValue );
+
+				bContinue = handler.OnKeyvalue( m_szKey, m_szValue );
+				break;
+			}
+
+			//Shouldn't be able to get here since the format is already checked, but just in case
+		default: return ParseResult::FORMAT_ERROR;
+		}
+
+		if( !bContinue )
+		{
+			m_bStopped = true;
+			return ParseResult::SUCCESS;
+		}
+	}
+}
+}
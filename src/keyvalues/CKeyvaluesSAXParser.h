@@ -0,0 +1,101 @@
+#ifndef KEYVALUES_CKEYVALUESSAXPARSER_H
+#define KEYVALUES_CKEYVALUESSAXPARSER_H
+
+#include "CKeyvaluesParser.h"
+
+namespace keyvalues
+{
+/**
+*	Receives events from CKeyvaluesSAXParser.
+*	Strings passed to the handler are only valid for the duration of the call.
+*	Each method returns whether parsing should continue.
+*/
+class IKeyvaluesHandler
+{
+public:
+	virtual ~IKeyvaluesHandler() = 0;
+
+	/**
+	*	Called when a block is opened.
+	*	@param szKey Key of the block. Empty for unnamed blocks.
+	*/
+	virtual bool OnBlockBegin( const CString& szKey ) = 0;
+
+	/**
+	*	Called for each keyvalue.
+	*/
+	virtual bool OnKeyvalue( const CString& szKey, const CString& szValue ) = 0;
+
+	/**
+	*	Called when the innermost open block is closed.
+	*/
+	virtual bool OnBlockEnd() = 0;
+};
+
+inline IKeyvaluesHandler::~IKeyvaluesHandler()
+{
+}
+
+/**
+*	Parser that reports keyvalues to a handler as they are read, instead of building a tree.
+*	Nothing is allocated per node, and parsing stops as soon as the handler has what it needs.
+*/
+class CKeyvaluesSAXParser final : public CBaseKeyvaluesParser
+{
+public:
+	typedef CBaseKeyvaluesParser BaseClass;
+
+public:
+	/**
+	*	Constructs an empty parser with the given settings.
+	*	@param settings Parser settings.
+	*/
+	CKeyvaluesSAXParser( const CKeyvaluesParserSettings& settings = CKeyvaluesParserSettings() );
+
+	/**
+	*	Constructs a parser that reads from the given memory, and that has the given settings.
+	*	@param memory Memory to read from.
+	*	@param settings Parser settings.
+	*/
+	CKeyvaluesSAXParser( CKeyvaluesLexer::Memory_t& memory, const CKeyvaluesParserSettings& settings = CKeyvaluesParserSettings() );
+
+	/**
+	*	Constructs a parser that reads from the given file, and that has the given settings.
+	*	@param pszFilename Name of the file to read from.
+	*	@param settings Parser settings.
+	*/
+	CKeyvaluesSAXParser( const char* const pszFilename, const CKeyvaluesParserSettings& settings = CKeyvaluesParserSettings() );
+
+	/**
+	*	Parses the buffer, passing each block and keyvalue to the handler.
+	*	The buffer is validated the same way CKeyvaluesParser::Parse validates it, up to the point where parsing stops.
+	*	@param handler Handler to pass events to.
+	*	@return ParseResult::SUCCESS if the entire buffer was parsed, or if the handler stopped parsing.
+	*		Otherwise, the error that was encountered.
+	*/
+	ParseResult Parse( IKeyvaluesHandler& handler );
+
+	/**
+	*	@return Whether the last call to Parse was stopped by the handler.
+	*/
+	bool WasStopped() const { return m_bStopped; }
+
+private:
+	/**
+	*	Gets a token as a string, converting escape sequences if needed.
+	*/
+	void GetTokenString( const CKeyvaluesLexer::TokenView_t& token, CString& szDest );
+
+private:
+	CString m_szKey;
+	CString m_szValue;
+
+	bool m_bStopped = false;
+
+private:
+	CKeyvaluesSAXParser( const CKeyvaluesSAXParser& ) = delete;
+	CKeyvaluesSAXParser& operator=( const CKeyvaluesSAXParser& ) = delete;
+};
+}
+
+#endif //KEYVALUES_CKEYVALUESSAXPARSER_H
@@ -13,6 +13,20 @@
 
 namespace keyvalues
 {
+CKeyvaluesWriter::CKeyvaluesWriter( const CKeyvaluesLexerSettings& settings )
+	: CKeyvaluesWriter( GetNoEscapeSeqConversion(), settings )
+{
+}
+
+CKeyvaluesWriter::CKeyvaluesWriter( CEscapeSequences& escapeSeqConversion, const CKeyvaluesLexerSettings& settings )
+	: m_Settings( settings )
+	, m_pEscapeSeqConversion( &escapeSeqConversion )
+{
+	m_szFilename[ 0 ] = '\0';
+
+	OpenMemory();
+}
+
 CKeyvaluesWriter::CKeyvaluesWriter( const char* pszFilename, const CKeyvaluesLexerSettings& settings )
 	: CKeyvaluesWriter( pszFilename, GetNoEscapeSeqConversion(), settings )
 {
@@ -38,25 +52,92 @@ bool CKeyvaluesWriter::Open( const char* const pszFilename )
 
 	Close();
 
-	m_pFile = fopen( pszFilename, "w" );
+	m_Buffer.clear();
 
 	strncpy( m_szFilename, pszFilename, sizeof( m_szFilename ) );
 	m_szFilename[ sizeof( m_szFilename ) - 1 ] = '\0';
 
+	m_bIsOpen = *m_szFilename != '\0';
+
 	return IsOpen();
 }
 
-void CKeyvaluesWriter::Close()
+void CKeyvaluesWriter::OpenMemory()
+{
+	Close();
+
+	m_Buffer.clear();
+
+	m_bIsOpen = true;
+}
+
+bool CKeyvaluesWriter::Close()
 {
+	bool bSuccess = true;
+
 	if( IsOpen() )
 	{
-		fclose( m_pFile );
-		m_pFile = nullptr;
+		if( *m_szFilename )
+		{
+			//Leave the existing file alone if the output is incomplete.
+			bSuccess = !ErrorOccurred() && WriteFileAtomic( m_szFilename, m_Buffer.data(), m_Buffer.size() );
+
+			if( !bSuccess && m_Settings.fLogErrors )
+				::Error( "CKeyvaluesWriter::Close: Couldn't write \"%s\"\n", m_szFilename );
 
-		m_szFilename[ 0 ] = '\0';
+			m_Buffer.clear();
+			m_Buffer.shrink_to_fit();
+
+			m_szFilename[ 0 ] = '\0';
+		}
+
+		m_bIsOpen = false;
 	}
 
 	m_bErrorOccurred = false;
+
+	return bSuccess;
+}
+
+void CKeyvaluesWriter::Discard()
+{
+	m_szFilename[ 0 ] = '\0';
+
+	m_Buffer.clear();
+
+	Close();
+}
+
+bool CKeyvaluesWriter::WriteFileAtomic( const char* const pszFilename, const void* const pData, const size_t uiSize )
+{
+	assert( pszFilename );
+	assert( pData || !uiSize );
+
+	const std::string szTempFilename = std::string( pszFilename ) + ".tmp";
+
+	FILE* pFile = fopen( szTempFilename.c_str(), "wb" );
+
+	if( !pFile )
+		return false;
+
+	bool bSuccess = fwrite( pData, 1, uiSize, pFile ) == uiSize;
+
+	bSuccess = fclose( pFile ) == 0 && bSuccess;
+
+	if( bSuccess )
+	{
+#ifdef WIN32
+		bSuccess = MoveFileExA( szTempFilename.c_str(), pszFilename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != FALSE;
+#else
+		//rename replaces the file atomically.
+		bSuccess = rename( szTempFilename.c_str(), pszFilename ) == 0;
+#endif
+	}
+
+	if( !bSuccess )
+		remove( szTempFilename.c_str() );
+
+	return bSuccess;
 }
 
 bool CKeyvaluesWriter::BeginBlock( const char* pszName )
@@ -87,12 +168,12 @@ bool CKeyvaluesWriter::BeginBlock( const char* pszName )
 	if( !WriteToken( pszName ) )
 		return false;
 
-	fprintf( m_pFile, "\n" );
+	Append( '\n' );
 
 	if( !WriteTabs() )
 		return false;
 
-	fprintf( m_pFile, "{\n" );
+	Append( "{\n" );
 
 	++m_uiTabDepth;
 
@@ -123,7 +204,7 @@ bool CKeyvaluesWriter::EndBlock()
 	if( !WriteTabs() )
 		return false;
 
-	fprintf( m_pFile, "}\n" );
+	Append( "}\n" );
 
 	return true;
 }
@@ -156,12 +237,12 @@ bool CKeyvaluesWriter::WriteKeyvalue( const char* const pszKey, const char* cons
 	if( !WriteToken( pszKey ) )
 		return false;
 
-	fprintf( m_pFile, " " );
+	Append( ' ' );
 
 	if( !WriteToken( pszValue ) )
 		return false;
 
-	fprintf( m_pFile, "\n" );
+	Append( '\n' );
 
 	return true;
 }
@@ -212,7 +293,9 @@ bool CKeyvaluesWriter::WriteComment( const char* const pszComment, const size_t
 
 	WriteTabs( uiTabs );
 
-	fprintf( m_pFile, "//%s\n", pszComment );
+	Append( "//" );
+	Append( pszComment );
+	Append( '\n' );
 
 	return true;
 }
@@ -230,16 +313,7 @@ bool CKeyvaluesWriter::WriteTabs( const size_t uiTabs )
 		return false;
 	}
 
-	char szBuffer[ MAX_BUFFER_LENGTH ];
-
-	for( size_t uiTab = 0; uiTab < uiTabs; ++uiTab )
-	{
-		szBuffer[ uiTab ] = '\t';
-	}
-
-	szBuffer[ uiTabs ] = '\0';
-
-	fprintf( m_pFile, "%s", szBuffer );
+	m_Buffer.append( uiTabs, '\t' );
 
 	return true;
 }
@@ -264,36 +338,16 @@ bool CKeyvaluesWriter::WriteToken( const char* const pszToken )
 
 	const size_t uiLength = strlen( pszToken );
 
-	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	//Sized first so the whole token can be converted in one pass.
+	if( ( uiBufIndex + m_pEscapeSeqConversion->GetEscapedLength( pszToken, uiLength ) ) >= sizeof( szBuffer ) )
 	{
-		const char* pszConv = m_pEscapeSeqConversion->GetString( pszToken[ uiIndex ] );
-
-		if( pszConv )
-		{
-			const size_t uiConvLength = m_pEscapeSeqConversion->GetStringLength( pszToken[ uiIndex ] );
-
-			if( ( uiBufIndex + uiConvLength ) >= sizeof( szBuffer ) )
-			{
-				Error( "CKeyvaluesWriter::WriteToken: Token too large!\n" );
-
-				return false;
-			}
-
-			strncpy( szBuffer + uiBufIndex, pszConv, uiConvLength );
-
-			uiBufIndex += uiConvLength;
-		}
-		else
-			szBuffer[ uiBufIndex++ ] = pszToken[ uiIndex ];
-
-		if( uiBufIndex >= sizeof( szBuffer ) )
-		{
-			Error( "CKeyvaluesWriter::WriteToken: Token too large!\n" );
+		Error( "CKeyvaluesWriter::WriteToken: Token too large!\n" );
 
-			return false;
-		}
+		return false;
 	}
 
+	uiBufIndex += m_pEscapeSeqConversion->Escape( pszToken, uiLength, szBuffer + uiBufIndex );
+
 	if( busesQuotes )
 		szBuffer[ uiBufIndex++ ] = '\"';
 
@@ -304,9 +358,7 @@ bool CKeyvaluesWriter::WriteToken( const char* const pszToken )
 		return false;
 	}
 
-	szBuffer[ uiBufIndex ] = '\0';
-
-	fprintf( m_pFile, "%s", szBuffer );
+	m_Buffer.append( szBuffer, uiBufIndex );
 
 	return true;
 }
@@ -1,6 +1,8 @@
 #ifndef CKEYVALUESWRITER_H
 #define CKEYVALUESWRITER_H
 
+#include <string>
+
 #include "shared/Platform.h"
 
 #include "KeyvaluesConstants.h"
@@ -15,10 +17,26 @@ class CKeyvalueBlock;
 
 /**
 *	Writer that can write keyvalues files.
+*	Output is built in memory. When writing to a file, the file is only replaced when the writer is closed,
+*	by writing a temporary file and renaming it over the original, so a failure never leaves a truncated file.
 */
 class CKeyvaluesWriter final
 {
 public:
+	/**
+	*	Constructs a writer that writes to memory.
+	*	@param settings Writer settings.
+	*	@see GetOutput
+	*/
+	CKeyvaluesWriter( const CKeyvaluesLexerSettings& settings = CKeyvaluesLexerSettings() );
+
+	/**
+	*	Constructs a writer that writes to memory, and uses the provided escape sequences conversion.
+	*	@param escapeSeqConversion Escape sequences conversion rules.
+	*	@param settings Writer settings.
+	*/
+	CKeyvaluesWriter( CEscapeSequences& escapeSeqConversion, const CKeyvaluesLexerSettings& settings = CKeyvaluesLexerSettings() );
+
 	/**
 	*	Constructs a writer that will write to the given file
 	*	No escape sequence conversion will take place
@@ -38,15 +56,20 @@ public:
 	~CKeyvaluesWriter();
 
 	/**
-	*	Returns whether the writer has a file open or not.
+	*	Returns whether the writer has a file or memory buffer open or not.
 	*/
-	bool IsOpen() const { return m_pFile != nullptr; }
+	bool IsOpen() const { return m_bIsOpen; }
 
 	/**
 	*	Gets the name of the file that is being written to, or an empty string if no file is open.
 	*/
 	const char* GetFilename() const { return m_szFilename; }
 
+	/**
+	*	Gets the output that has been written so far. For files, this is what will be written when the writer is closed.
+	*/
+	const std::string& GetOutput() const { return m_Buffer; }
+
 	/**
 	*	Returns whether an error has occurred during writing.
 	*/
@@ -54,13 +77,37 @@ public:
 
 	/**
 	*	Opens a file for writing. If a file is currently open, it is closed first.
+	*	The file isn't touched until the writer is closed.
 	*/
 	bool Open( const char* const pszFileName );
 
 	/**
-	*	If a file is currently opened for writing, closes the file.
+	*	Starts writing to memory. If a file is currently open, it is closed first.
 	*/
-	void Close();
+	void OpenMemory();
+
+	/**
+	*	If a file is currently opened for writing, writes the output to it and closes it.
+	*	If an error occurred while writing, the file is left unchanged.
+	*	The output of memory writers remains available until the writer is opened again.
+	*	@return Whether the output was written, or true for memory writers.
+	*/
+	bool Close();
+
+	/**
+	*	Closes the writer without writing anything to the file. Files that were opened are left unchanged.
+	*/
+	void Discard();
+
+	/**
+	*	Writes a buffer to a file with a single write to a temporary file, followed by a rename that replaces the file.
+	*	Can be called from any thread.
+	*	@param pszFilename Name of the file to write.
+	*	@param pData Data to write.
+	*	@param uiSize Size of the data, in bytes.
+	*	@return Whether the file was written.
+	*/
+	static bool WriteFileAtomic( const char* const pszFilename, const void* const pData, const size_t uiSize );
 
 	/**
 	*	Begins a new block.
@@ -130,6 +177,10 @@ private:
 	*/
 	bool WriteToken( const char* const pszToken );
 
+	void Append( const char* const pszString ) { m_Buffer.append( pszString ); }
+
+	void Append( const char c ) { m_Buffer.push_back( c ); }
+
 	/**
 	*	Reports an error.
 	*	@param pszError Error to report.
@@ -141,7 +192,9 @@ private:
 
 	CEscapeSequences* m_pEscapeSeqConversion;
 
-	FILE* m_pFile = nullptr;
+	std::string m_Buffer;
+
+	bool m_bIsOpen = false;
 
 	char m_szFilename[ MAX_PATH_LENGTH + 1 ];
 
@@ -10,10 +10,14 @@ namespace keyvalues
 class CKeyvalueNode;
 class CKeyvalue;
 class CKeyvalueBlock;
+class CKeyvaluesArena;
 class CKeyvaluesLexer;
 class CKeyvaluesParser;
 class CIterativeKeyvaluesParser;
+class CKeyvaluesSAXParser;
+class IKeyvaluesHandler;
 class CKeyvaluesWriter;
+class CKeyvaluesBinaryReader;
 
 //Define shorthand notation for common types.
 typedef CKeyvalueNode				Node;
@@ -21,7 +25,9 @@ typedef CKeyvalue					KV;
 typedef CKeyvalueBlock				Block;
 typedef CKeyvaluesParser			Parser;
 typedef CIterativeKeyvaluesParser	IterativeParser;
+typedef CKeyvaluesSAXParser			SAXParser;
 typedef CKeyvaluesWriter			Writer;
+typedef CKeyvaluesBinaryReader		BinaryReader;
 }
 
 //Define a shorter namespace.
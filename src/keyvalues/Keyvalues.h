@@ -7,10 +7,13 @@
 
 #include "CKeyvalueNode.h"
 #include "CKeyvalue.h"
+#include "CKeyvaluesArena.h"
 #include "CKeyvalueBlock.h"
 
 #include "CKeyvaluesLexer.h"
 #include "CKeyvaluesParser.h"
+#include "CKeyvaluesSAXParser.h"
 #include "CKeyvaluesWriter.h"
+#include "CKeyvaluesBinary.h"
 
 #endif //KEYVALUES_KEYVALUES_H
\ No newline at end of file
@@ -1,10 +1,58 @@
 #include <cassert>
+#include <cstdint>
 #include <cstring>
+#include <unordered_map>
 
 #include "LibInterface.h"
 
+namespace
+{
+/**
+*	FNV-1a hash of a C string.
+*/
+struct CStringHash final
+{
+	size_t operator()( const char* pszString ) const
+	{
+		uint32_t uiHash = 2166136261U;
+
+		for( ; *pszString; ++pszString )
+		{
+			uiHash = ( uiHash ^ static_cast<unsigned char>( *pszString ) ) * 16777619U;
+		}
+
+		return uiHash;
+	}
+};
+
+struct CStringEqual final
+{
+	bool operator()( const char* pszLHS, const char* pszRHS ) const
+	{
+		return strcmp( pszLHS, pszRHS ) == 0;
+	}
+};
+
+using InterfaceIndex_t = std::unordered_map<const char*, const CInterfaceRegistry*, CStringHash, CStringEqual>;
+
+InterfaceIndex_t BuildInterfaceIndex()
+{
+	InterfaceIndex_t index;
+
+	//Walked from the head so the last registered interface with a name wins, like the list lookup did.
+	for( auto pIFace = CInterfaceRegistry::GetHead(); pIFace; pIFace = pIFace->GetNext() )
+	{
+		index.emplace( pIFace->GetName(), pIFace );
+	}
+
+	return index;
+}
+}
+
 CInterfaceRegistry* CInterfaceRegistry::m_pHead = nullptr;
 
+bool CInterfaceRegistry::m_bIndexed = false;
+
 CInterfaceRegistry::CInterfaceRegistry( const char* const pszName, const InstantiateInterfaceFn instantiateFn )
 	: m_pNext( m_pHead )
 	, m_pszName( pszName )
@@ -12,25 +60,38 @@ CInterfaceRegistry::CInterfaceRegistry( const char* const pszName, const Instant
 {
 	assert( pszName && *pszName );
 	assert( instantiateFn );
+	assert( !m_bIndexed );
 
 	m_pHead = this;
 }
 
+const CInterfaceRegistry* CInterfaceRegistry::Find( const char* const pszName )
+{
+	assert( pszName );
+
+	//Built once, thread safe since libraries can be connected from any thread.
+	static const InterfaceIndex_t index = []()
+	{
+		m_bIndexed = true;
+
+		return BuildInterfaceIndex();
+	}();
+
+	auto it = index.find( pszName );
+
+	return it != index.end() ? it->second : nullptr;
+}
+
 IBaseInterface* CreateInterface( const char* const pszName, IFaceResult* pResult )
 {
 	IBaseInterface* pInterface = nullptr;
 	IFaceResult result = IFaceResult::FAILURE;
 
-	for( auto pIFace = CInterfaceRegistry::GetHead(); pIFace; pIFace = pIFace->GetNext() )
+	if( auto pIFace = CInterfaceRegistry::Find( pszName ) )
 	{
-		if( strcmp( pszName, pIFace->GetName() ) == 0 )
-		{
-			pInterface = pIFace->GetInstantiateFn()();
+		pInterface = pIFace->GetInstantiateFn()();
 
-			result = IFaceResult::SUCCESS;
-
-			break;
-		}
+		result = IFaceResult::SUCCESS;
 	}
 
 	if( pResult )
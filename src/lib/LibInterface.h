@@ -46,8 +46,21 @@ public:
 
 	InstantiateInterfaceFn GetInstantiateFn() const { return m_InstantiateFn; }
 
+	/**
+	*	Finds a registered interface by name. The first lookup builds a hash index of all registered interfaces,
+	*	so lookups don't compare against every name. All interfaces must be registered before the first lookup,
+	*	which static registration guarantees.
+	*	@return The registry entry, or null if no interface has the given name.
+	*/
+	static const CInterfaceRegistry* Find( const char* const pszName );
+
 private:
 	static CInterfaceRegistry* m_pHead;
+
+	/**
+	*	Whether the index was built. Used to catch registrations after the first lookup.
+	*/
+	static bool m_bIndexed;
 	CInterfaceRegistry* m_pNext;
 
 	const char* const m_pszName;
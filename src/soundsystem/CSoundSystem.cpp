@@ -1,10 +1,14 @@
 #include "fmod.hpp"
 #include "fmod_errors.h"
 
+#include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
 
 #include "shared/Logging.h"
+#include "shared/MemoryStats.h"
 #include "shared/Utility.h"
 
 #include "lib/LibInterface.h"
@@ -19,9 +23,46 @@ namespace soundsystem
 {
 REGISTER_SINGLE_INTERFACE( ISOUNDSYSTEM_NAME, CSoundSystem );
 
+namespace
+{
+/**
+*	Records channels that have ended so RunFrame can free their sounds without polling every channel.
+*	Stolen channels and channels that are stopped also end.
+*/
+FMOD_RESULT F_CALLBACK ChannelCallback( FMOD_CHANNELCONTROL* pChannelControl, FMOD_CHANNELCONTROL_TYPE controlType, FMOD_CHANNELCONTROL_CALLBACK_TYPE callbackType,
+										void*, void* )
+{
+	if( controlType != FMOD_CHANNELCONTROL_CHANNEL || callbackType != FMOD_CHANNELCONTROL_CALLBACK_END )
+		return FMOD_OK;
+
+	auto pChannel = reinterpret_cast<FMOD::Channel*>( pChannelControl );
+
+	FMOD::System* pSystem;
+	void* pChannelData;
+	void* pSystemData;
+
+	if( pChannel->getUserData( &pChannelData ) != FMOD_OK ||
+		pChannel->getSystemObject( &pSystem ) != FMOD_OK ||
+		pSystem->getUserData( &pSystemData ) != FMOD_OK ||
+		!pSystemData )
+		return FMOD_OK;
+
+	static_cast<CSoundSystem::EndedChannels_t*>( pSystemData )->emplace_back( reinterpret_cast<uintptr_t>( pChannelData ), pChannel );
+
+	return FMOD_OK;
+}
+}
+
 CSoundSystem::CSoundSystem()
 {
-	memset( m_Sounds, 0, sizeof( m_Sounds ) );
+	//Lowest indices are used first.
+	m_FreeSounds.reserve( MAX_SOUNDS );
+
+	for( size_t uiIndex = MAX_SOUNDS; uiIndex > 0; --uiIndex )
+		m_FreeSounds.push_back( uiIndex - 1 );
+
+	m_PendingStreams.reserve( MAX_SOUNDS );
+	m_EndedChannels.reserve( MAX_SOUNDS );
 }
 
 CSoundSystem::~CSoundSystem()
@@ -54,6 +95,11 @@ bool CSoundSystem::Initialize()
 	*/
 	result = FMOD::System_Create( &m_pSystem );
 
+	if( CheckFMODResult( result ) )
+		return false;
+
+	result = m_pSystem->setUserData( &m_EndedChannels );
+
 	if( CheckFMODResult( result ) )
 		return false;
 
@@ -118,6 +164,11 @@ void CSoundSystem::Shutdown()
 {
 	StopAllSounds();
 
+	m_PendingSounds.clear();
+	m_PendingPreloads.clear();
+
+	ClearSoundCache();
+
 	FMOD_RESULT result;
 
 	if( m_pSystem )
@@ -133,28 +184,64 @@ void CSoundSystem::RunFrame()
 {
 	m_pSystem->update();
 
-	size_t uiIndex = 0;
+	//Channels are compared in case the sound has been replaced since its channel ended.
+	for( const auto& ended : m_EndedChannels )
+	{
+		if( m_Sounds[ ended.first ].pChannel == ended.second )
+			ReleaseSound( ended.first, false );
+	}
+
+	m_EndedChannels.clear();
 
 	FMOD_RESULT result;
 
-	bool bIsPlaying;
-
-	for( auto& sound : m_Sounds )
+	for( size_t uiPending = 0; uiPending < m_PendingStreams.size(); )
 	{
-		++uiIndex;
+		const size_t uiIndex = m_PendingStreams[ uiPending ];
+
+		FMOD_OPENSTATE openState;
+
+		result = m_Sounds[ uiIndex ].pStream->getOpenState( &openState, nullptr, nullptr, nullptr );
 
-		if( !sound.pSound )
+		bool bFailed = CheckFMODResult( result ) || openState == FMOD_OPENSTATE_ERROR;
+
+		if( !bFailed && openState != FMOD_OPENSTATE_READY )
+		{
+			++uiPending;
 			continue;
+		}
+
+		m_PendingStreams[ uiPending ] = m_PendingStreams.back();
+		m_PendingStreams.pop_back();
 
-		result = sound.pChannel->isPlaying( &bIsPlaying );
+		if( !bFailed )
+			bFailed = !StartSound( uiIndex, m_Sounds[ uiIndex ].pStream );
 
-		if( result == FMOD_ERR_INVALID_HANDLE || result == FMOD_ERR_CHANNEL_STOLEN || !bIsPlaying || CheckFMODResult( result ) )
+		if( bFailed )
+			ReleaseSound( uiIndex, true );
+	}
+
+	//Add preloaded sounds to the cache once they've been read.
+	for( auto it = m_PendingPreloads.begin(); it != m_PendingPreloads.end(); )
+	{
+		if( it->second.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
 		{
-			CheckFMODResult( sound.pSound->release() );
-			sound = Sound_t{};
-			m_SoundsLRU.erase( std::find( m_SoundsLRU.begin(), m_SoundsLRU.end(), uiIndex - 1 ) );
+			++it;
+			continue;
 		}
+
+		auto data = it->second.get();
+
+		//Streams are opened when they're played, so they aren't kept.
+		if( data.IsValid() && data.GetSize() < STREAM_MIN_SIZE && m_SoundCache.find( it->first ) == m_SoundCache.end() )
+			CreateCachedSound( std::string( it->first ), std::move( data ) );
+
+		it = m_PendingPreloads.erase( it );
 	}
+
+	StartPendingSounds();
+
+	EvictSounds();
 }
 
 void CSoundSystem::PlaySound( const char* pszFilename, float flVolume, int iPitch )
@@ -167,116 +254,441 @@ void CSoundSystem::PlaySound( const char* pszFilename, float flVolume, int iPitc
 
 	char szActualFilename[ MAX_PATH_LENGTH ];
 
-	if( pszFilename[ 0 ] == '*' )
-		++pszFilename;
+	if( !GetSoundFilename( pszFilename, szActualFilename, sizeof( szActualFilename ) ) )
+		return;
+
+	flVolume = clamp( flVolume, 0.0f, 1.0f );
+	iPitch = clamp( iPitch, 0, 255 );
 
-	const int iRet = snprintf( szActualFilename, sizeof( szActualFilename ), "sound/%s", pszFilename );
+	std::string szKey = GetSoundKey( szActualFilename );
 
-	if( iRet < 0 || static_cast<size_t>( iRet ) >= sizeof( szActualFilename ) )
+	auto it = m_SoundCache.find( szKey );
+
+	//Reading and creating the sound happens in the background, so the caller never waits for the file.
+	if( it == m_SoundCache.end() )
+	{
+		QueueSound( std::move( szKey ), szActualFilename, flVolume, iPitch );
 		return;
+	}
 
-	char szFullFilename[ MAX_PATH_LENGTH ];
+	PlayCachedSound( &it->second, flVolume, iPitch );
+}
 
-	if( !m_pFileSystem->GetRelativePath( szActualFilename, szFullFilename, sizeof( szFullFilename ) ) )
+void CSoundSystem::QueueSound( std::string&& szKey, const char* const pszFilename, const float flVolume, const int iPitch )
+{
+	auto pending = m_PendingSounds.find( szKey );
+
+	if( pending == m_PendingSounds.end() )
 	{
-		Warning( "CSoundSystem::PlaySound: Unable to find sound file '%s'\n", pszFilename );
+		PendingSound_t sound;
+
+		sound.szFilename = pszFilename;
+
+		auto preload = m_PendingPreloads.find( szKey );
+
+		//If it's being preloaded, use that read instead of reading it again.
+		if( preload != m_PendingPreloads.end() && preload->second.valid() )
+		{
+			sound.read = std::move( preload->second );
+
+			m_PendingPreloads.erase( preload );
+		}
+		//Read through the filesystem so sounds in archives can be played. FMOD uses the data in place.
+		else
+		{
+			sound.read = m_pFileSystem->ReadFileAsync( pszFilename );
+		}
+
+		pending = m_PendingSounds.emplace( std::move( szKey ), std::move( sound ) ).first;
+	}
+
+	pending->second.plays.emplace_back( flVolume, iPitch );
+}
+
+void CSoundSystem::StartPendingSounds()
+{
+	if( m_PendingSounds.empty() )
 		return;
+
+	//Taken out first, playing streams again adds new entries.
+	std::vector<std::pair<std::string, PendingSound_t>> ready;
+
+	for( auto it = m_PendingSounds.begin(); it != m_PendingSounds.end(); )
+	{
+		if( it->second.read.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+		{
+			++it;
+			continue;
+		}
+
+		ready.emplace_back( it->first, std::move( it->second ) );
+
+		it = m_PendingSounds.erase( it );
 	}
 
-	flVolume = clamp( flVolume, 0.0f, 1.0f );
-	iPitch = clamp( iPitch, 0, 255 );
+	for( auto& entry : ready )
+	{
+		PendingSound_t& sound = entry.second;
+
+		auto data = sound.read.get();
+
+		if( !data.IsValid() )
+		{
+			Warning( "CSoundSystem::PlaySound: Unable to find sound file '%s'\n", sound.szFilename.c_str() );
+			continue;
+		}
+
+		//Streams can only be played by one channel, so plays after the first read the file again.
+		if( data.GetSize() >= STREAM_MIN_SIZE )
+		{
+			PlayStream( std::move( data ), sound.plays.front().first, sound.plays.front().second );
+
+			for( size_t uiPlay = 1; uiPlay < sound.plays.size(); ++uiPlay )
+			{
+				QueueSound( std::string( entry.first ), sound.szFilename.c_str(), sound.plays[ uiPlay ].first, sound.plays[ uiPlay ].second );
+			}
+
+			continue;
+		}
+
+		//Preloads of the same file may have finished first.
+		auto it = m_SoundCache.find( entry.first );
+
+		CachedSound_t* const pCachedSound = it != m_SoundCache.end() ? &it->second : CreateCachedSound( std::move( entry.first ), std::move( data ) );
+
+		if( !pCachedSound )
+			continue;
+
+		//A sound that failed to start may have been evicted.
+		for( const auto& play : sound.plays )
+		{
+			if( !PlayCachedSound( pCachedSound, play.first, play.second ) )
+				break;
+		}
+	}
+}
 
+bool CSoundSystem::PlayCachedSound( CachedSound_t* pCachedSound, const float flVolume, const int iPitch )
+{
 	const size_t uiIndex = GetSoundForPlayback();
 
-	Sound_t sound{};
+	Sound_t& sound = m_Sounds[ uiIndex ];
 
-	FMOD_RESULT result = m_pSystem->createSound( szFullFilename, FMOD_LOOP_OFF | FMOD_2D, nullptr, &sound.pSound );
+	sound.pCachedSound = pCachedSound;
+	sound.flVolume = flVolume;
+	sound.iPitch = iPitch;
 
-	if( result == FMOD_ERR_FILE_NOTFOUND )
+	//Referenced from here on so failures release it again.
+	if( pCachedSound->uiRefCount++ == 0 )
+		m_UnusedSounds.erase( pCachedSound->unused );
+
+	if( !StartSound( uiIndex, pCachedSound->pSound ) )
 	{
-		return;
+		ReleaseSound( uiIndex, true );
+		return false;
 	}
 
-	if( CheckFMODResult( result ) )
+	EvictSounds();
+
+	return true;
+}
+
+void CSoundSystem::PreloadSounds( const char* const* ppszFilenames, const size_t uiCount )
+{
+	if( !m_pSystem || !ppszFilenames )
 		return;
 
-	if( CheckFMODResult( m_pSystem->playSound( sound.pSound, 0, false, &sound.pChannel ) ) )
+	//Resolve every name first so all reads can be queued at once.
+	std::vector<std::pair<std::string, std::string>> reads;
+
+	reads.reserve( uiCount );
+
+	char szActualFilename[ MAX_PATH_LENGTH ];
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		CheckFMODResult( sound.pSound->release() );
-		return;
+		const char* const pszFilename = ppszFilenames[ uiIndex ];
+
+		if( !pszFilename || !( *pszFilename ) )
+			continue;
+
+		if( !GetSoundFilename( pszFilename, szActualFilename, sizeof( szActualFilename ) ) )
+			continue;
+
+		std::string szKey = GetSoundKey( szActualFilename );
+
+		if( m_SoundCache.find( szKey ) != m_SoundCache.end() || m_PendingPreloads.find( szKey ) != m_PendingPreloads.end() ||
+			m_PendingSounds.find( szKey ) != m_PendingSounds.end() )
+			continue;
+
+		//Reserve the key so duplicates in the list are only read once.
+		m_PendingPreloads.emplace( szKey, std::future<filesystem::CFileData>() );
+
+		reads.emplace_back( std::move( szKey ), szActualFilename );
 	}
 
-	if( CheckFMODResult( sound.pChannel->setVolume( flVolume ) ) )
+	for( auto& read : reads )
 	{
-		CheckFMODResult( sound.pSound->release() );
+		m_PendingPreloads[ read.first ] = m_pFileSystem->ReadFileAsync( read.second.c_str() );
+	}
+}
+
+void CSoundSystem::StopAllSounds()
+{
+	if( !m_pSystem )
 		return;
+
+	//Sounds that are still being read aren't played anymore, but are still cached once they've been read.
+	for( auto& pending : m_PendingSounds )
+	{
+		m_PendingPreloads.emplace( pending.first, std::move( pending.second.read ) );
 	}
 
-	float flFrequency;
+	m_PendingSounds.clear();
 
-	if( CheckFMODResult( sound.pChannel->getFrequency( &flFrequency ) ) )
+	for( size_t uiIndex = 0; uiIndex < MAX_SOUNDS; ++uiIndex )
 	{
-		CheckFMODResult( sound.pSound->release() );
-		return;
+		if( m_Sounds[ uiIndex ].bUsed )
+			ReleaseSound( uiIndex, true );
 	}
 
-	if( CheckFMODResult( sound.pChannel->setFrequency( flFrequency * ( iPitch / ( static_cast<float>( PITCH_NORM ) ) ) ) ) )
+	EvictSounds();
+}
+
+size_t CSoundSystem::GetSoundForPlayback()
+{
+	if( m_FreeSounds.empty() )
 	{
-		CheckFMODResult( sound.pSound->release() );
-		return;
+		//get from LRU.
+		ReleaseSound( m_SoundsLRU.back(), true );
 	}
 
-	m_Sounds[ uiIndex ] = sound;
+	const size_t uiIndex = m_FreeSounds.back();
+
+	m_FreeSounds.pop_back();
+
+	Sound_t& sound = m_Sounds[ uiIndex ];
+
+	sound.bUsed = true;
 
 	m_SoundsLRU.push_front( uiIndex );
+	sound.lru = m_SoundsLRU.begin();
+
+	return uiIndex;
 }
 
-void CSoundSystem::StopAllSounds()
+bool CSoundSystem::GetSoundFilename( const char* pszFilename, char* pszOutFilename, const size_t uiBufferSize )
 {
-	if( !m_pSystem )
-		return;
+	if( pszFilename[ 0 ] == '*' )
+		++pszFilename;
+
+	const int iRet = snprintf( pszOutFilename, uiBufferSize, "sound/%s", pszFilename );
+
+	return iRet >= 0 && static_cast<size_t>( iRet ) < uiBufferSize;
+}
+
+std::string CSoundSystem::GetSoundKey( const char* const pszFilename )
+{
+	//Loose files are keyed by the path they resolve to, so files with the same name in different search paths are kept apart.
+	//Files that are only in archives use the name they're read with.
+	char szResolvedFilename[ MAX_PATH_LENGTH ];
+
+	if( m_pFileSystem->GetRelativePath( pszFilename, szResolvedFilename, sizeof( szResolvedFilename ) ) )
+		return szResolvedFilename;
+
+	return pszFilename;
+}
+
+CSoundSystem::CachedSound_t* CSoundSystem::CreateCachedSound( std::string&& szKey, filesystem::CFileData&& data )
+{
+	CachedSound_t cachedSound;
+
+	cachedSound.data = std::move( data );
 
-	for( auto& sound : m_Sounds )
+	FMOD_CREATESOUNDEXINFO info{};
+
+	info.cbsize = sizeof( info );
+	info.length = static_cast<unsigned int>( cachedSound.data.GetSize() );
+
+	FMOD_RESULT result = m_pSystem->createSound( reinterpret_cast<const char*>( cachedSound.data.GetData() ), FMOD_LOOP_OFF | FMOD_2D | FMOD_OPENMEMORY_POINT, &info, &cachedSound.pSound );
+
+	if( result == FMOD_ERR_FILE_NOTFOUND )
 	{
-		if( !sound.pSound )
-			continue;
+		return nullptr;
+	}
 
-		CheckFMODResult( sound.pChannel->stop() );
+	if( CheckFMODResult( result ) )
+		return nullptr;
 
-		CheckFMODResult( sound.pSound->release() );
+	cachedSound.uiMemorySize = cachedSound.data.GetSize();
 
-		sound = Sound_t{};
+	//PCM data is played from the file, anything else is decoded into a sample.
+	FMOD_SOUND_FORMAT format;
+	unsigned int uiPCMBytes;
+
+	if( cachedSound.pSound->getFormat( nullptr, &format, nullptr, nullptr ) == FMOD_OK &&
+		( format < FMOD_SOUND_FORMAT_PCM8 || format > FMOD_SOUND_FORMAT_PCMFLOAT ) &&
+		cachedSound.pSound->getLength( &uiPCMBytes, FMOD_TIMEUNIT_PCMBYTES ) == FMOD_OK )
+	{
+		cachedSound.uiMemorySize += uiPCMBytes;
 	}
 
-	m_SoundsLRU.clear();
+	m_uiCacheMemory += cachedSound.uiMemorySize;
+
+	mem::Add( mem::Category::SOUNDS, static_cast<int64_t>( cachedSound.uiMemorySize ) );
+
+	auto it = m_SoundCache.emplace( std::move( szKey ), std::move( cachedSound ) ).first;
+
+	it->second.pKey = &it->first;
+
+	m_UnusedSounds.push_front( it->first );
+	it->second.unused = m_UnusedSounds.begin();
+
+	return &it->second;
 }
 
-size_t CSoundSystem::GetSoundForPlayback()
+void CSoundSystem::PlayStream( filesystem::CFileData&& data, const float flVolume, const int iPitch )
 {
-	for( size_t uiIndex = 0; uiIndex < MAX_SOUNDS; ++uiIndex )
+	const size_t uiIndex = GetSoundForPlayback();
+
+	Sound_t& sound = m_Sounds[ uiIndex ];
+
+	sound.streamData = std::move( data );
+	sound.flVolume = flVolume;
+	sound.iPitch = iPitch;
+
+	mem::Add( mem::Category::SOUNDS, static_cast<int64_t>( sound.streamData.GetSize() ) );
+
+	FMOD_CREATESOUNDEXINFO info{};
+
+	info.cbsize = sizeof( info );
+	info.length = static_cast<unsigned int>( sound.streamData.GetSize() );
+
+	//Opened on FMOD's thread, RunFrame starts it once it's ready.
+	if( CheckFMODResult( m_pSystem->createSound( reinterpret_cast<const char*>( sound.streamData.GetData() ),
+												 FMOD_LOOP_OFF | FMOD_2D | FMOD_OPENMEMORY_POINT | FMOD_CREATESTREAM | FMOD_NONBLOCKING,
+												 &info, &sound.pStream ) ) )
+	{
+		sound.pStream = nullptr;
+		ReleaseSound( uiIndex, true );
+		return;
+	}
+
+	m_PendingStreams.push_back( uiIndex );
+}
+
+bool CSoundSystem::StartSound( const size_t uiIndex, FMOD::Sound* pSound )
+{
+	Sound_t& sound = m_Sounds[ uiIndex ];
+
+	if( CheckFMODResult( m_pSystem->playSound( pSound, 0, true, &sound.pChannel ) ) )
 	{
-		if( !m_Sounds[ uiIndex ].pSound )
-			return uiIndex;
+		sound.pChannel = nullptr;
+		return false;
 	}
 
-	//Shouldn't happen; LRU is only empty if no sounds are playing.
-	if( m_SoundsLRU.empty() )
-		return 0;
+	if( CheckFMODResult( sound.pChannel->setUserData( reinterpret_cast<void*>( static_cast<uintptr_t>( uiIndex ) ) ) ) )
+		return false;
+
+	if( CheckFMODResult( sound.pChannel->setCallback( &ChannelCallback ) ) )
+		return false;
+
+	if( CheckFMODResult( sound.pChannel->setVolume( sound.flVolume ) ) )
+		return false;
 
-	//get from LRU.
-	const size_t uiIndex = m_SoundsLRU.back();
+	float flFrequency;
 
-	m_SoundsLRU.pop_back();
+	if( CheckFMODResult( sound.pChannel->getFrequency( &flFrequency ) ) )
+		return false;
 
+	if( CheckFMODResult( sound.pChannel->setFrequency( flFrequency * ( sound.iPitch / ( static_cast<float>( PITCH_NORM ) ) ) ) ) )
+		return false;
+
+	if( CheckFMODResult( sound.pChannel->setPaused( false ) ) )
+		return false;
+
+	return true;
+}
+
+void CSoundSystem::ReleaseSound( const size_t uiIndex, const bool bStop )
+{
 	Sound_t& sound = m_Sounds[ uiIndex ];
 
-	CheckFMODResult( sound.pChannel->stop() );
-	
-	CheckFMODResult( sound.pSound->release() );
+	assert( sound.bUsed );
 
-	//Reset the sound data. Must be done after the above actions so it doesn't try to access null pointers.
-	m_Sounds[ uiIndex ] = Sound_t{};
+	if( sound.pStream && !sound.pChannel )
+	{
+		auto it = std::find( m_PendingStreams.begin(), m_PendingStreams.end(), uiIndex );
 
-	return uiIndex;
+		if( it != m_PendingStreams.end() )
+		{
+			*it = m_PendingStreams.back();
+			m_PendingStreams.pop_back();
+		}
+	}
+
+	if( bStop && sound.pChannel )
+		CheckFMODResult( sound.pChannel->stop() );
+
+	//Releasing a stream that's still opening waits for it to finish opening.
+	if( sound.pStream )
+		CheckFMODResult( sound.pStream->release() );
+
+	CachedSound_t* const pCachedSound = sound.pCachedSound;
+
+	mem::Add( mem::Category::SOUNDS, -static_cast<int64_t>( sound.streamData.GetSize() ) );
+
+	m_SoundsLRU.erase( sound.lru );
+
+	sound = Sound_t{};
+
+	m_FreeSounds.push_back( uiIndex );
+
+	if( !pCachedSound )
+		return;
+
+	assert( pCachedSound->uiRefCount > 0 );
+
+	if( --pCachedSound->uiRefCount == 0 )
+	{
+		m_UnusedSounds.push_front( *pCachedSound->pKey );
+		pCachedSound->unused = m_UnusedSounds.begin();
+	}
+}
+
+void CSoundSystem::EvictSounds()
+{
+	//The most recently played sound is only evicted if it's the only one that's left.
+	while( m_uiCacheMemory > SOUND_CACHE_BUDGET && m_UnusedSounds.size() > 1 )
+	{
+		auto it = m_SoundCache.find( m_UnusedSounds.back() );
+
+		m_UnusedSounds.pop_back();
+
+		m_uiCacheMemory -= it->second.uiMemorySize;
+
+		mem::Add( mem::Category::SOUNDS, -static_cast<int64_t>( it->second.uiMemorySize ) );
+
+		CheckFMODResult( it->second.pSound->release() );
+
+		m_SoundCache.erase( it );
+	}
+}
+
+void CSoundSystem::ClearSoundCache()
+{
+	for( auto& entry : m_SoundCache )
+	{
+		assert( entry.second.uiRefCount == 0 );
+
+		CheckFMODResult( entry.second.pSound->release() );
+	}
+
+	m_SoundCache.clear();
+	m_UnusedSounds.clear();
+
+	mem::Add( mem::Category::SOUNDS, -static_cast<int64_t>( m_uiCacheMemory ) );
+
+	m_uiCacheMemory = 0;
 }
 }
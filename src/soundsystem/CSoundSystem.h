@@ -1,7 +1,14 @@
 #ifndef SOUNDSYSTEM_CSOUNDSYSTEM_H
 #define SOUNDSYSTEM_CSOUNDSYSTEM_H
 
+#include <future>
 #include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "filesystem/CFileData.h"
 
 #include "shared/SoundConstants.h"
 
@@ -33,14 +40,111 @@ public:
 	//Maximum number of sounds to play simultaneously.
 	static const size_t MAX_SOUNDS = 16;
 
+	/**
+	*	Amount of memory that sounds that aren't playing can use before the least recently played ones are released, in bytes.
+	*/
+	static const size_t SOUND_CACHE_BUDGET = 32 * 1024 * 1024;
+
+	/**
+	*	Files at least this large are streamed instead of being decoded up front, in bytes.
+	*	Long dialogue and music would otherwise stall the thread that plays them.
+	*/
+	static const size_t STREAM_MIN_SIZE = 1024 * 1024;
+
 private:
+	/**
+	*	A sound that has been created, and can be played by any number of channels at once.
+	*/
+	struct CachedSound_t
+	{
+		FMOD::Sound* pSound = nullptr;
+
+		/**
+		*	The sound's file. FMOD plays sounds from this memory, so it's kept until the sound is released.
+		*/
+		filesystem::CFileData data;
+
+		/**
+		*	Approximate amount of memory used by the sound, in bytes.
+		*/
+		size_t uiMemorySize = 0;
+
+		/**
+		*	Number of channels playing this sound. Sounds are only released when no channels are playing them.
+		*/
+		size_t uiRefCount = 0;
+
+		/**
+		*	Key of this sound in the cache.
+		*/
+		const std::string* pKey = nullptr;
+
+		/**
+		*	Position in the list of unused sounds. Only valid if the reference count is 0.
+		*/
+		std::list<std::string>::iterator unused;
+	};
+
+	typedef std::unordered_map<std::string, CachedSound_t> SoundCache_t;
+
+	/**
+	*	A sound that was played before it was loaded. It starts playing once its file has been read.
+	*/
+	struct PendingSound_t
+	{
+		/**
+		*	Name the file is read with, for warnings.
+		*/
+		std::string szFilename;
+
+		std::future<filesystem::CFileData> read;
+
+		/**
+		*	Volume and pitch of every time the sound was played while it was being read.
+		*/
+		std::vector<std::pair<float, int>> plays;
+	};
 
 	struct Sound_t
 	{
-		FMOD::Sound* pSound;
-		FMOD::Channel* pChannel;
+		CachedSound_t* pCachedSound = nullptr;
+
+		/**
+		*	Streams can only be played by one channel at a time, so they aren't cached. Each sound that plays one owns it.
+		*/
+		FMOD::Sound* pStream = nullptr;
+
+		/**
+		*	The stream's file. FMOD reads the stream from this memory.
+		*/
+		filesystem::CFileData streamData;
+
+		/**
+		*	Null while a stream is still opening.
+		*/
+		FMOD::Channel* pChannel = nullptr;
+
+		/**
+		*	Playback parameters, used to start streams once they've opened.
+		*/
+		float flVolume = 1;
+		int iPitch = PITCH_NORM;
+
+		bool bUsed = false;
+
+		/**
+		*	Position in m_SoundsLRU. Only valid if the sound is used.
+		*/
+		std::list<size_t>::iterator lru;
 	};
 
+public:
+	/**
+	*	Channels that have ended, and the index of the sound that played them.
+	*	Filled by FMOD's channel callback during System::update.
+	*/
+	typedef std::vector<std::pair<size_t, FMOD::Channel*>> EndedChannels_t;
+
 public:
 	CSoundSystem();
 	~CSoundSystem();
@@ -60,11 +164,78 @@ public:
 
 	void PlaySound( const char* pszFilename, float flVolume, int iPitch ) override final;
 
+	void PreloadSounds( const char* const* ppszFilenames, const size_t uiCount ) override final;
+
 	void StopAllSounds() override final;
 
 private:
+	/**
+	*	Gets a free sound, stopping the least recently played one if all of them are in use.
+	*	The sound is marked as used and is made the most recently played one.
+	*	@return Index of the sound.
+	*/
 	size_t GetSoundForPlayback();
 
+	/**
+	*	Gets the name of a sound's file from the name that it's played by.
+	*	@return Whether the name fits in the buffer.
+	*/
+	static bool GetSoundFilename( const char* pszFilename, char* pszOutFilename, const size_t uiBufferSize );
+
+	/**
+	*	Gets the key that the given file is cached by.
+	*/
+	std::string GetSoundKey( const char* const pszFilename );
+
+	/**
+	*	Starts reading a sound that isn't cached, and plays it once it's been read.
+	*	Sounds played again while they're being read share the read.
+	*/
+	void QueueSound( std::string&& szKey, const char* const pszFilename, const float flVolume, const int iPitch );
+
+	/**
+	*	Plays sounds whose reads have finished.
+	*/
+	void StartPendingSounds();
+
+	/**
+	*	Plays a cached sound on a new channel.
+	*	@return Whether the sound started playing. If not, the cached sound may have been evicted.
+	*/
+	bool PlayCachedSound( CachedSound_t* pCachedSound, const float flVolume, const int iPitch );
+
+	/**
+	*	Creates a sound from a file's data and adds it to the cache.
+	*	@return The sound, or null if it couldn't be created.
+	*/
+	CachedSound_t* CreateCachedSound( std::string&& szKey, filesystem::CFileData&& data );
+
+	/**
+	*	Opens a file as a stream. The stream opens in the background and starts playing in RunFrame once it's ready.
+	*/
+	void PlayStream( filesystem::CFileData&& data, const float flVolume, const int iPitch );
+
+	/**
+	*	Starts playing a sound on a new channel, using the sound's volume and pitch.
+	*	@return Whether the sound is playing.
+	*/
+	bool StartSound( const size_t uiIndex, FMOD::Sound* pSound );
+
+	/**
+	*	Stops a sound's channel, releases its stream or its reference to its cached sound, and frees the sound.
+	*/
+	void ReleaseSound( const size_t uiIndex, const bool bStop );
+
+	/**
+	*	Releases unused sounds, least recently played first, until the cache fits in its budget.
+	*/
+	void EvictSounds();
+
+	/**
+	*	Releases all cached sounds. No sounds may be playing.
+	*/
+	void ClearSoundCache();
+
 private:
 	filesystem::IFileSystem* m_pFileSystem = nullptr;
 
@@ -74,6 +245,40 @@ private:
 
 	std::list<size_t> m_SoundsLRU;
 
+	/**
+	*	Indices of sounds that aren't used.
+	*/
+	std::vector<size_t> m_FreeSounds;
+
+	/**
+	*	Indices of sounds whose streams are still opening.
+	*/
+	std::vector<size_t> m_PendingStreams;
+
+	EndedChannels_t m_EndedChannels;
+
+	/**
+	*	Sounds keyed by resolved filename.
+	*/
+	SoundCache_t m_SoundCache;
+
+	/**
+	*	Keys of sounds that no channel is playing, most recently played first.
+	*/
+	std::list<std::string> m_UnusedSounds;
+
+	size_t m_uiCacheMemory = 0;
+
+	/**
+	*	Sounds that are being read for PreloadSounds, keyed the same way as the cache.
+	*/
+	std::unordered_map<std::string, std::future<filesystem::CFileData>> m_PendingPreloads;
+
+	/**
+	*	Sounds that are being read so they can be played, keyed the same way as the cache.
+	*/
+	std::unordered_map<std::string, PendingSound_t> m_PendingSounds;
+
 private:
 	CSoundSystem( const CSoundSystem& ) = delete;
 	CSoundSystem& operator=( const CSoundSystem& ) = delete;
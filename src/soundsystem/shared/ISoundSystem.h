@@ -36,12 +36,22 @@ public:
 
 	/**
 	*	Plays a sound by name. The filename is relative to the game's sound directory, and is looked up using the filesystem.
+	*	Sounds that aren't loaded yet are read in the background and start playing in RunFrame once they've been read,
+	*	so this never waits for file I/O.
 	*	@param pszFilename Sound filename.
 	*	@param flVolume Volume. Expressed as a range between [0, 1].
 	*	@param iPitch Pitch amount. Expressed as a range between [0, 255].
 	*/
 	virtual void PlaySound( const char* pszFilename, float flVolume, int iPitch ) = 0;
 
+	/**
+	*	Loads sounds in the background so they don't have to be read when they're first played.
+	*	Sounds that are already loaded or being loaded are skipped.
+	*	@param ppszFilenames Sound filenames, as passed to PlaySound.
+	*	@param uiCount Number of filenames.
+	*/
+	virtual void PreloadSounds( const char* const* ppszFilenames, const size_t uiCount ) = 0;
+
 	/**
 	*	Stops all sounds that are currently playing.
 	*/
@@ -52,7 +62,7 @@ public:
 /**
 *	ISoundSystem interface name.
 */
-#define ISOUNDSYSTEM_NAME "ISoundSystemV001"
+#define ISOUNDSYSTEM_NAME "ISoundSystemV002"
 
 /** @} */
 
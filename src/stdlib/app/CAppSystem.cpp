@@ -1,10 +1,14 @@
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 
 #include <experimental/filesystem>
 
 #include "core/shared/Logging.h"
 
 #include "core/shared/Platform.h"
+#include "core/shared/TaskScheduler.h"
+#include "core/shared/Trace.h"
 
 #include "utility/PlatUtils.h"
 
@@ -12,6 +16,21 @@
 
 namespace app
 {
+namespace
+{
+/**
+*	Cache of the running app. Factories are plain functions, so the cached factory finds it through this.
+*/
+CInterfaceCache* g_pInterfaceCache = nullptr;
+
+IBaseInterface* CreateCachedInterface( const char* const pszName, IFaceResult* pResult )
+{
+	assert( g_pInterfaceCache );
+
+	return g_pInterfaceCache->CreateInterface( pszName, pResult );
+}
+}
+
 bool CAppSystem::Run( int iArgc, wchar_t* pszArgV[] )
 {
 	bool bResult = Start();
@@ -40,8 +59,17 @@ bool CAppSystem::Start()
 
 void CAppSystem::OnShutdown()
 {
+	const bool bFastShutdown = m_State == AppState::RUNNING && UseFastShutdown();
+
 	m_State = AppState::SHUTTING_DOWN;
 
+	if( bFastShutdown )
+	{
+		FastShutdownApp();
+
+		FastExit();
+	}
+
 	ShutdownApp();
 
 	Shutdown();
@@ -51,6 +79,8 @@ void CAppSystem::OnShutdown()
 
 bool CAppSystem::Startup()
 {
+	TRACE_SCOPE( "CAppSystem::Startup" );
+
 	//Configure the working directory to be the exe directory.
 	{
 		bool bSuccess;
@@ -91,12 +121,21 @@ bool CAppSystem::Startup()
 		}
 	}
 
+	const auto start = std::chrono::steady_clock::now();
+
 	m_State = AppState::STARTING_UP;
 
-	if( !StartupApp() )
+	//Started first so startup steps can use it.
+	tasks::Start();
+
 	{
-		Error( "CAppSystem::Startup: Failed to start up app!\n" );
-		return false;
+		CStartupTimer timer( *this, "App startup" );
+
+		if( !StartupApp() )
+		{
+			Error( "CAppSystem::Startup: Failed to start up app!\n" );
+			return false;
+		}
 	}
 
 	m_State = AppState::LOADING_LIBS;
@@ -125,27 +164,57 @@ bool CAppSystem::Startup()
 		}
 	}
 
-	factories.shrink_to_fit();
+	//Everything is connected through the cache, so each interface is looked up in every library only once.
+	m_InterfaceCache.SetFactories( factories.data(), factories.size() );
+
+	g_pInterfaceCache = &m_InterfaceCache;
+
+	const CreateInterfaceFn cachedFactory = &CreateCachedInterface;
 
-	if( !Connect( factories.data(), factories.size() ) )
 	{
-		Error( "CAppSystem::Startup: Failed to connect one or more interfaces!\n" );
-		return false;
+		bool bConnected = Connect( &cachedFactory, 1 );
+
+		//Shutdown expects every step to have finished.
+		if( !WaitForParallelSteps() )
+			bConnected = false;
+
+		if( !bConnected )
+		{
+			Error( "CAppSystem::Startup: Failed to connect one or more interfaces!\n" );
+			return false;
+		}
 	}
 
 	m_State = AppState::INITIALIZING;
 
-	if( !Initialize() )
 	{
-		Error( "CAppSystem::Startup: Failed to initialize app!\n" );
-		return false;
+		CStartupTimer timer( *this, "App initialization" );
+
+		if( !Initialize() )
+		{
+			Error( "CAppSystem::Startup: Failed to initialize app!\n" );
+			return false;
+		}
 	}
 
+	AddStartupTime( "Total", std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count(), false );
+
+	ReportStartupTimes();
+
 	return true;
 }
 
 void CAppSystem::Shutdown()
 {
+	//Tasks may run code from any library, so workers have to be gone before libraries are freed.
+	tasks::Stop();
+
+	//Cached interfaces live in the libraries.
+	if( g_pInterfaceCache == &m_InterfaceCache )
+		g_pInterfaceCache = nullptr;
+
+	m_InterfaceCache.Clear();
+
 	for( auto& lib : m_Libraries )
 	{
 		lib.Free();
@@ -155,6 +224,21 @@ void CAppSystem::Shutdown()
 	m_Libraries.shrink_to_fit();
 }
 
+void CAppSystem::FastExit()
+{
+	if( trace::IsRecording() )
+		trace::StopRecording();
+
+	logging().StopAsync();
+
+	logging().CloseLogFile();
+
+	fflush( nullptr );
+
+	//Static destructors would free the same resources one by one, so they're skipped as well.
+	std::quick_exit( EXIT_SUCCESS );
+}
+
 const CLibrary* CAppSystem::GetLibraryByName( const char* const pszName ) const
 {
 	assert( pszName );
@@ -173,11 +257,82 @@ bool CAppSystem::IsLibraryLoaded( const char* const pszName ) const
 	return GetLibraryByName( pszName ) != nullptr;
 }
 
+void CAppSystem::AddStartupTime( const char* const pszName, const double flMilliseconds, const bool bParallel )
+{
+	std::lock_guard<std::mutex> lock( m_StartupTimesMutex );
+
+	m_StartupTimes.push_back( { pszName, flMilliseconds, bParallel } );
+}
+
+void CAppSystem::StartParallelStep( const char* const pszName, std::function<bool()> step )
+{
+	assert( pszName );
+	assert( step );
+
+	//Listeners aren't thread safe, so messages are queued until the steps are done.
+	if( m_ParallelSteps.empty() && !logging().IsAsync() )
+	{
+		logging().StartAsync( LogOverflowPolicy::BLOCK );
+		m_bStartedAsyncLogging = true;
+	}
+
+	m_ParallelSteps.emplace_back( pszName, std::async( std::launch::async, [ this, pszName ]( const std::function<bool()>& step )
+		{
+			TRACE_SCOPE( pszName );
+
+			const auto start = std::chrono::steady_clock::now();
+
+			const bool bResult = step();
+
+			AddStartupTime( pszName, std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count(), true );
+
+			return bResult;
+		}, std::move( step ) ) );
+}
+
+bool CAppSystem::WaitForParallelSteps()
+{
+	bool bSuccess = true;
+
+	for( auto& step : m_ParallelSteps )
+	{
+		if( !step.second.get() )
+		{
+			Error( "CAppSystem::WaitForParallelSteps: Startup step \"%s\" failed\n", step.first );
+			bSuccess = false;
+		}
+	}
+
+	m_ParallelSteps.clear();
+
+	if( m_bStartedAsyncLogging )
+	{
+		logging().StopAsync();
+		m_bStartedAsyncLogging = false;
+	}
+
+	return bSuccess;
+}
+
+void CAppSystem::ReportStartupTimes() const
+{
+	std::lock_guard<std::mutex> lock( m_StartupTimesMutex );
+
+	Message( "Startup times:\n" );
+
+	for( const auto& time : m_StartupTimes )
+	{
+		Message( "%-32s %10.2f ms%s\n", time.szName.c_str(), time.flMilliseconds, time.bParallel ? " (parallel)" : "" );
+	}
+}
+
 bool CAppSystem::LoadLibrary( const CLibArgs& args )
 {
 	if( IsLibraryLoaded( args.GetFilename() ) )
 		return true;
 
+	CStartupTimer timer( *this, args.GetFilename() );
+
 	CLibrary lib;
 
 	if( !lib.Load( args ) )
@@ -1,9 +1,15 @@
 #ifndef APP_CAPPSYSTEM_H
 #define APP_CAPPSYSTEM_H
 
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
 #include <type_traits>
 #include <vector>
 
+#include "lib/CInterfaceCache.h"
 #include "lib/CLibArgs.h"
 #include "lib/CLibrary.h"
 #include "lib/LibInterface.h"
@@ -35,6 +41,20 @@ class CAppSystem
 private:
 	typedef std::vector<CLibrary> Libraries_t;
 
+	/**
+	*	How long a startup step took.
+	*/
+	struct StartupTime_t
+	{
+		std::string szName;
+		double flMilliseconds;
+
+		/**
+		*	Whether the step ran on a worker thread.
+		*/
+		bool bParallel;
+	};
+
 public:
 	CAppSystem() = default;
 	~CAppSystem() = default;
@@ -71,6 +91,11 @@ private:
 	*/
 	void Shutdown();
 
+	/**
+	*	Writes out logs and traces, and exits the process without freeing anything.
+	*/
+	[[noreturn]] void FastExit();
+
 protected:
 	/**
 	*	Lets the app run code on startup. This is called after the current working directory has been set.
@@ -112,7 +137,71 @@ protected:
 	*/
 	virtual void ShutdownApp() {}
 
+	/**
+	*	@return Whether the app can exit without freeing resources that live until the process exits.
+	*	If so, FastShutdownApp is called instead of ShutdownApp, and the process exits right after,
+	*	so the system releases memory, GPU resources and the context all at once.
+	*	Only apps that started up successfully shut down fast.
+	*/
+	virtual bool UseFastShutdown() const { return false; }
+
+	/**
+	*	Saves anything that has to outlive the process, like settings. Called instead of ShutdownApp when shutting down fast.
+	*/
+	virtual void FastShutdownApp() {}
+
 protected:
+	/**
+	*	Times a startup step on the calling thread, and adds it to the startup timing report when it goes out of scope.
+	*/
+	class CStartupTimer final
+	{
+	public:
+		CStartupTimer( CAppSystem& app, const char* const pszName )
+			: m_App( app )
+			, m_pszName( pszName )
+			, m_Start( std::chrono::steady_clock::now() )
+		{
+		}
+
+		~CStartupTimer()
+		{
+			m_App.AddStartupTime( m_pszName, std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_Start ).count(), false );
+		}
+
+	private:
+		CAppSystem& m_App;
+		const char* const m_pszName;
+		const std::chrono::steady_clock::time_point m_Start;
+
+	private:
+		CStartupTimer( const CStartupTimer& ) = delete;
+		CStartupTimer& operator=( const CStartupTimer& ) = delete;
+	};
+
+	/**
+	*	Adds a step to the startup timing report. Can be called from any thread.
+	*	@param pszName Name of the step.
+	*	@param flMilliseconds How long the step took.
+	*	@param bParallel Whether the step ran on a worker thread.
+	*/
+	void AddStartupTime( const char* const pszName, const double flMilliseconds, const bool bParallel );
+
+	/**
+	*	Runs a startup step on a worker thread, so it can run while the main thread sets up things that it doesn't depend on.
+	*	While steps are running, messages are queued and passed to the log listener on the main thread once all of them have finished.
+	*	Steps are waited for after Connect, even if it fails.
+	*	@param pszName Name of the step, used in errors and the startup timing report.
+	*	@param step Step to run. Returns whether it succeeded.
+	*/
+	void StartParallelStep( const char* const pszName, std::function<bool()> step );
+
+	/**
+	*	Waits for all steps started by StartParallelStep.
+	*	@return Whether all of them succeeded.
+	*/
+	bool WaitForParallelSteps();
+
 	/**
 	*	Gets the list of libraries.
 	*	@return The list of libraries.
@@ -126,6 +215,11 @@ protected:
 	*/
 	const CLibrary* GetLibraryByName( const char* const pszName ) const;
 
+	/**
+	*	Gets the cache of interfaces resolved across all libraries. Connect is given a factory that uses it.
+	*/
+	CInterfaceCache& GetInterfaceCache() { return m_InterfaceCache; }
+
 	/**
 	*	Checks whether the given library is loaded.
 	*	@param pszName Name of the library to check. Includes path and extension.
@@ -269,11 +363,29 @@ protected:
 		return CheckInterfaces( interfaces... );
 	}
 
+private:
+	/**
+	*	Logs how long each startup step took.
+	*/
+	void ReportStartupTimes() const;
+
 private:
 	AppState m_State = AppState::CONSTRUCTING;
 
 	Libraries_t m_Libraries;
 
+	CInterfaceCache m_InterfaceCache;
+
+	mutable std::mutex m_StartupTimesMutex;
+	std::vector<StartupTime_t> m_StartupTimes;
+
+	std::vector<std::pair<const char*, std::future<bool>>> m_ParallelSteps;
+
+	/**
+	*	Whether asynchronous logging was started for parallel steps, and should be stopped once they've finished.
+	*/
+	bool m_bStartedAsyncLogging = false;
+
 private:
 	CAppSystem( const CAppSystem& ) = delete;
 	CAppSystem& operator=( const CAppSystem& ) = delete;
@@ -121,17 +121,18 @@ const char* CCVar::GetString() const
 
 float CCVar::GetFloat() const
 {
-	return m_pParent->m_flValue;
+	//A single value has no ordering requirements with other memory.
+	return m_pParent->m_flValue.load( std::memory_order_relaxed );
 }
 
 int CCVar::GetInt() const
 {
-	return static_cast<int>( m_pParent->m_flValue );
+	return static_cast<int>( GetFloat() );
 }
 
 bool CCVar::GetBool() const
 {
-	return ( m_pParent->m_flValue ) != 0;
+	return GetFloat() != 0;
 }
 
 void CCVar::SetString( const char* const pszValue )
@@ -195,16 +196,20 @@ void CCVar::SetStringValue( const char* pszValue )
 
 	char* pszOldValue = m_pszValue;
 
-	const float flOldValue = m_flValue;
+	const float flOldValue = m_flValue.load( std::memory_order_relaxed );
 
-	float flValue = m_flValue = static_cast<float>( atof( pszValue ) );
+	const float flValue = static_cast<float>( atof( pszValue ) );
 
-	Clamp( m_flValue );
+	float flClampedValue = flValue;
+
+	Clamp( flClampedValue );
+
+	m_flValue.store( flClampedValue, std::memory_order_relaxed );
 
 	//Value was clamped, modify string.
-	if( m_flValue != flValue )
+	if( flClampedValue != flValue )
 	{
-		m_pszValue = CreateStringValue( "%.2f", m_flValue );
+		m_pszValue = CreateStringValue( "%.2f", flClampedValue );
 	}
 	else
 	{
@@ -227,9 +232,9 @@ void CCVar::SetFloatValue( float flValue, const bool bFormatFloat )
 
 	Clamp( flValue );
 
-	const float flOldValue = m_flValue;
+	const float flOldValue = m_flValue.load( std::memory_order_relaxed );
 
-	m_flValue = flValue;
+	m_flValue.store( flValue, std::memory_order_relaxed );
 
 	char* pszOldValue = m_pszValue;
 
@@ -1,6 +1,7 @@
 #ifndef CVAR_CCVAR_H
 #define CVAR_CCVAR_H
 
+#include <atomic>
 #include <cassert>
 
 #include "CBaseConCommand.h"
@@ -247,26 +248,32 @@ public:
 
 	/**
 	*	Gets the value as a string.
+	*	Only call this on the main thread: the string is freed when the value changes.
 	*/
 	const char* GetString() const;
 
 	/**
 	*	Gets the value as a float.
+	*	The numeric getters can be called from any thread. The value is published atomically,
+	*	so worker threads always see either the old or the new value, without locking.
 	*/
 	float GetFloat() const;
 
 	/**
 	*	Gets the value as an int.
+	*	@see GetFloat
 	*/
 	int	GetInt() const;
 
 	/**
 	*	Gets the value as a boolean.
+	*	@see GetFloat
 	*/
 	bool GetBool() const;
 
 	/**
 	*	Sets the value as a string.
+	*	Setters must only be called on the main thread, which is where change callbacks are invoked.
 	*/
 	virtual void SetString( const char* const pszValue );
 
@@ -328,7 +335,11 @@ private:
 	CallbackType m_CallbackType = CallbackType::FUNCTION;
 
 	char*	m_pszValue			= nullptr;
-	float	m_flValue			= 0;
+
+	/**
+	*	Only written by the main thread, but can be read by any thread.
+	*/
+	std::atomic<float> m_flValue{ 0 };
 
 	float	m_flMinValue;
 	float	m_flMaxValue;
@@ -0,0 +1,85 @@
+#include <cassert>
+
+#include "shared/Logging.h"
+
+#include "CVar.h"
+
+#include "CCVarHandle.h"
+
+namespace cvar
+{
+CCVar* CCVarHandle::Get() const
+{
+	assert( g_pCVar );
+
+	const unsigned int uiGeneration = g_pCVar->GetCommandGeneration();
+
+	if( m_uiGeneration != uiGeneration )
+	{
+		m_uiGeneration = uiGeneration;
+
+		auto pCommand = g_pCVar->FindCommand( m_pszName );
+
+		if( pCommand && pCommand->GetType() == CommandType::CVAR )
+		{
+			m_pCVar = static_cast<CCVar*>( pCommand );
+		}
+		else
+		{
+			m_pCVar = nullptr;
+
+			Warning( "Unknown CVar \"%s\", ignoring\n", m_pszName );
+		}
+	}
+
+	return m_pCVar;
+}
+
+const char* CCVarHandle::GetString() const
+{
+	auto pCVar = Get();
+
+	return pCVar ? pCVar->GetString() : "";
+}
+
+float CCVarHandle::GetFloat() const
+{
+	auto pCVar = Get();
+
+	return pCVar ? pCVar->GetFloat() : 0;
+}
+
+int CCVarHandle::GetInt() const
+{
+	auto pCVar = Get();
+
+	return pCVar ? pCVar->GetInt() : 0;
+}
+
+bool CCVarHandle::GetBool() const
+{
+	auto pCVar = Get();
+
+	return pCVar ? pCVar->GetBool() : false;
+}
+
+void CCVarHandle::SetString( const char* const pszValue ) const
+{
+	assert( pszValue );
+
+	if( auto pCVar = Get() )
+		pCVar->SetString( pszValue );
+}
+
+void CCVarHandle::SetFloat( const float flValue ) const
+{
+	if( auto pCVar = Get() )
+		pCVar->SetFloat( flValue );
+}
+
+void CCVarHandle::SetBool( const bool bValue ) const
+{
+	if( auto pCVar = Get() )
+		pCVar->SetBool( bValue );
+}
+}
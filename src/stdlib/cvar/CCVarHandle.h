@@ -0,0 +1,86 @@
+#ifndef CVAR_CCVARHANDLE_H
+#define CVAR_CCVARHANDLE_H
+
+/**
+*	@ingroup CVar
+*	@{
+*/
+namespace cvar
+{
+class CCVar;
+
+/**
+*	Handle to a cvar that is owned by another library. The cvar is looked up by name the first time the handle is used,
+*	after which its value is accessed through a direct pointer. The cvar is only looked up again if commands have been added or removed.
+*	Handles are constant initialized, so they can be used as globals:
+*	static cvar::CCVarHandle g_MaxFPS( "max_fps" );
+*	Handles must be used on the main thread. Worker threads should read through a CCVar pointer obtained from Get.
+*/
+class CCVarHandle final
+{
+public:
+	/**
+	*	@param pszName Name of the cvar. Must remain valid for the lifetime of the handle.
+	*/
+	constexpr explicit CCVarHandle( const char* const pszName )
+		: m_pszName( pszName )
+	{
+	}
+
+	const char* GetName() const { return m_pszName; }
+
+	/**
+	*	@return The cvar, or null if no cvar with this name exists.
+	*/
+	CCVar* Get() const;
+
+	/**
+	*	@return Whether the cvar exists.
+	*/
+	bool IsValid() const { return Get() != nullptr; }
+
+	/**
+	*	@return The value as a string, or an empty string if the cvar doesn't exist.
+	*/
+	const char* GetString() const;
+
+	/**
+	*	@return The value as a float, or 0 if the cvar doesn't exist.
+	*/
+	float GetFloat() const;
+
+	/**
+	*	@return The value as an int, or 0 if the cvar doesn't exist.
+	*/
+	int GetInt() const;
+
+	/**
+	*	@return The value as a bool, or false if the cvar doesn't exist.
+	*/
+	bool GetBool() const;
+
+	void SetString( const char* const pszValue ) const;
+
+	void SetFloat( const float flValue ) const;
+
+	void SetBool( const bool bValue ) const;
+
+private:
+	const char* const m_pszName;
+
+	mutable CCVar* m_pCVar = nullptr;
+
+	/**
+	*	Command generation that m_pCVar was looked up in. 0 if it was never looked up.
+	*/
+	mutable unsigned int m_uiGeneration = 0;
+
+private:
+	CCVarHandle( const CCVarHandle& ) = delete;
+	CCVarHandle& operator=( const CCVarHandle& ) = delete;
+};
+}
+
+/** @} */
+
+#endif //CVAR_CCVARHANDLE_H
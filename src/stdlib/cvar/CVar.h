@@ -6,6 +6,7 @@
 #include "CBaseConCommand.h"
 #include "CConCommand.h"
 #include "CCVar.h"
+#include "CCVarHandle.h"
 
 #include "ICVarSystem.h"
 
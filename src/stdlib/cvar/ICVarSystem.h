@@ -21,6 +21,12 @@ class ICVarSystem : public IBaseInterface
 public:
 	using CVarArchiveCallback = void( *)( void* pObject, const CCVar& cvar );
 
+	/**
+	*	Callback for command enumeration.
+	*	@return Whether to continue enumerating.
+	*/
+	using CommandCallback = bool ( * )( void* pObject, const CBaseConCommand& command );
+
 public:
 	/**
 	*	@return Whether the system has been initialized.
@@ -67,10 +73,19 @@ public:
 	virtual void Command( const char* const pszCommand ) = 0;
 
 	/**
-	*	Executes the current command buffer.
+	*	Executes the current command buffer, followed by config files that are being executed.
 	*/
 	virtual void Execute() = 0;
 
+	/**
+	*	Starts executing a config file. Commands are read from the file as they are executed,
+	*	and execution is spread out over multiple frames if it exceeds the time budget set by exec_budget.
+	*	Config files can execute other config files; these are executed before the rest of the file.
+	*	@param pszFilename Name of the file to execute.
+	*	@return Whether the file was opened.
+	*/
+	virtual bool ExecFile( const char* const pszFilename ) = 0;
+
 	/**
 	*	Finds a command by name.
 	*/
@@ -81,6 +96,28 @@ public:
 	*/
 	virtual CBaseConCommand* FindCommand( const char* const pszName ) = 0;
 
+	/**
+	*	Enumerates all commands whose name starts with the given prefix, in alphabetical order.
+	*	Finding the first result takes time proportional to the length of the prefix, not the number of commands,
+	*	so this can be used for completion while typing.
+	*	@param pszPrefix Prefix to search for. An empty prefix enumerates all commands.
+	*	@param pCallback Callback to invoke for each command.
+	*	@param pObject Object to pass to the callback.
+	*/
+	virtual void FindCommandsByPrefix( const char* const pszPrefix, const CommandCallback pCallback, void* pObject = nullptr ) const = 0;
+
+	/**
+	*	Gets the command generation. This changes every time a command is added or removed,
+	*	so cached command pointers can tell when they need to be looked up again.
+	*	@see CCVarHandle
+	*/
+	virtual unsigned int GetCommandGeneration() const = 0;
+
+	/**
+	*	@return Number of lookups by name that have been made. Includes FindCommand and the GetCVar and SetCVar methods.
+	*/
+	virtual unsigned int GetNameLookupCount() const = 0;
+
 	virtual const char* GetCVarString( const char* const pszCVar ) const = 0;
 
 	virtual float GetCVarFloat( const char* const pszCVar ) const = 0;
@@ -104,9 +141,12 @@ public:
 	/**
 	*	Installs a global cvar handler.
 	*	@param pHandler Handler to install.
+	*	@param bDeferred If true, the handler is notified in RunFrame instead of when the cvar is set.
+	*		Changes are coalesced per cvar: the handler is called once, with the value from before the first change.
+	*		Cvars that were changed back to their original value are not reported.
 	*	@return true on success, false otherwise.
 	*/
-	virtual bool InstallGlobalCVarHandler( ICVarHandler* pHandler ) = 0;
+	virtual bool InstallGlobalCVarHandler( ICVarHandler* pHandler, const bool bDeferred = false ) = 0;
 
 	/**
 	*	Removes a global cvar handler.
@@ -119,7 +159,7 @@ public:
 /**
 *	CVar system interface name.
 */
-#define ICVARSYSTEM_NAME "ICVarSystemV001"
+#define ICVARSYSTEM_NAME "ICVarSystemV002"
 
 /** @} */
 
@@ -1,6 +1,6 @@
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
-#include <memory>
 
 #include "Palette.h"
 
@@ -10,104 +10,203 @@ namespace graphics
 {
 namespace bmpfile
 {
-bool SaveBMPFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette )
+namespace
 {
-	if( !pszFilename || !( *pszFilename ) )
-		return false;
-
-	if( iWidth <= 0 || iHeight <= 0 )
-		return false;
-
-	if( !pPixels || !( pPalette ) )
-		return false;
+/**
+*	Rows in BMP files are padded to a multiple of this many bytes.
+*/
+const size_t ROW_ALIGNMENT = 4;
+
+/**
+*	Writes a value in the little endian order BMP files use. The headers are written field by field,
+*	so the layout doesn't depend on how the compiler packs the structs.
+*/
+uint8_t* WriteLittleEndian16( uint8_t* pDest, const uint16_t uiValue )
+{
+	pDest[ 0 ] = static_cast<uint8_t>( uiValue );
+	pDest[ 1 ] = static_cast<uint8_t>( uiValue >> 8 );
 
-	FILE* pFile = fopen( pszFilename, "wb" );
+	return pDest + 2;
+}
 
-	if( !pFile )
-		return false;
+uint8_t* WriteLittleEndian32( uint8_t* pDest, const uint32_t uiValue )
+{
+	pDest[ 0 ] = static_cast<uint8_t>( uiValue );
+	pDest[ 1 ] = static_cast<uint8_t>( uiValue >> 8 );
+	pDest[ 2 ] = static_cast<uint8_t>( uiValue >> 16 );
+	pDest[ 3 ] = static_cast<uint8_t>( uiValue >> 24 );
 
-	Header header;
-	InfoHeader infoHeader;
+	return pDest + 4;
+}
 
-	memset( &header, 0, sizeof( header ) );
-	memset( &infoHeader, 0, sizeof( infoHeader ) );
+/**
+*	Sizes the buffer for the whole file and writes the headers.
+*	@return Pointer to the data after the headers.
+*/
+uint8_t* BeginFile( const int iWidth, const int iHeight, const uint16_t uiBitCount, const size_t uiPaletteBytes, const size_t uiRowBytes,
+					std::vector<uint8_t>& data )
+{
+	const size_t uiPixelsBytes = uiRowBytes * iHeight;
 
-	const int32_t iDiskWidth = ( iWidth + 3 ) & ~3;
+	const size_t uiOffBits = HEADERS_SIZE + uiPaletteBytes;
 
-	const int32_t iPixelsBytes = iDiskWidth * iHeight;
+	//Padding is zeroed here, so rows only need their pixels copied.
+	data.assign( uiOffBits + uiPixelsBytes, 0 );
 
-	const int32_t iPaletteBytes = PALETTE_ENTRIES * sizeof( RGBQuad );
+	Header header;
 
-	//This might not be correct. TODO: verify
 	header.bfType		= BMP_TYPE_ID;
-
-	header.bfSize		= sizeof( Header ) + sizeof( InfoHeader ) + iPixelsBytes + iPaletteBytes;
+	header.bfSize		= static_cast<uint32_t>( data.size() );
 	header.bfReserved1	= 0;
 	header.bfReserved2	= 0;
-	header.bfOffBits	= sizeof( Header ) + sizeof( InfoHeader ) + iPaletteBytes;
+	header.bfOffBits	= static_cast<uint32_t>( uiOffBits );
 
-	//Write the header.
-	if( fwrite( &header, sizeof( header ), 1, pFile ) != 1 )
-	{
-		fclose( pFile );
-		return false;
-	}
+	InfoHeader infoHeader;
 
-	infoHeader.biSize			= sizeof( infoHeader );
-	infoHeader.biWidth			= iDiskWidth;
-	infoHeader.biHeight			= iHeight;
+	infoHeader.biSize			= 40;
+	infoHeader.biWidth			= iWidth;					//Row padding is implied, so this is the actual width.
+	infoHeader.biHeight			= iHeight;					//Positive, so rows are stored bottom up.
 	infoHeader.biPlanes			= 1;
-	infoHeader.biBitCount		= 8;						//8 bit encoding.
+	infoHeader.biBitCount		= uiBitCount;
 	infoHeader.biCompression	= COMPRESSION_RGB;			//Uncompressed.
-	infoHeader.biSizeImage		= 0;
+	infoHeader.biSizeImage		= static_cast<uint32_t>( uiPixelsBytes );
 	infoHeader.biXPelsPerMeter	= 0;
 	infoHeader.biYPelsPerMeter	= 0;
-	infoHeader.biClrUsed		= PALETTE_ENTRIES;			//Store all colors.
+	infoHeader.biClrUsed		= static_cast<uint32_t>( uiPaletteBytes / sizeof( RGBQuad ) );
 	infoHeader.biClrImportant	= 0;
 
-	//Write the info header.
-	if( fwrite( &infoHeader, sizeof( infoHeader ), 1, pFile ) != 1 )
-	{
-		fclose( pFile );
+	uint8_t* pDest = data.data();
+
+	pDest = WriteLittleEndian16( pDest, header.bfType );
+	pDest = WriteLittleEndian32( pDest, header.bfSize );
+	pDest = WriteLittleEndian16( pDest, header.bfReserved1 );
+	pDest = WriteLittleEndian16( pDest, header.bfReserved2 );
+	pDest = WriteLittleEndian32( pDest, header.bfOffBits );
+
+	pDest = WriteLittleEndian32( pDest, infoHeader.biSize );
+	pDest = WriteLittleEndian32( pDest, static_cast<uint32_t>( infoHeader.biWidth ) );
+	pDest = WriteLittleEndian32( pDest, static_cast<uint32_t>( infoHeader.biHeight ) );
+	pDest = WriteLittleEndian16( pDest, infoHeader.biPlanes );
+	pDest = WriteLittleEndian16( pDest, infoHeader.biBitCount );
+	pDest = WriteLittleEndian32( pDest, infoHeader.biCompression );
+	pDest = WriteLittleEndian32( pDest, infoHeader.biSizeImage );
+	pDest = WriteLittleEndian32( pDest, static_cast<uint32_t>( infoHeader.biXPelsPerMeter ) );
+	pDest = WriteLittleEndian32( pDest, static_cast<uint32_t>( infoHeader.biYPelsPerMeter ) );
+	pDest = WriteLittleEndian32( pDest, infoHeader.biClrUsed );
+	pDest = WriteLittleEndian32( pDest, infoHeader.biClrImportant );
+
+	return pDest;
+}
+
+size_t GetRowBytes( const int iWidth, const size_t uiBytesPerPixel )
+{
+	return ( iWidth * uiBytesPerPixel + ROW_ALIGNMENT - 1 ) & ~( ROW_ALIGNMENT - 1 );
+}
+
+bool WriteFile( const char* const pszFilename, const std::vector<uint8_t>& data )
+{
+	FILE* pFile = fopen( pszFilename, "wb" );
+
+	if( !pFile )
 		return false;
-	}
 
-	RGBQuad palette[ PALETTE_ENTRIES ];
+	const bool bSuccess = fwrite( data.data(), data.size(), 1, pFile ) == 1;
 
-	for( size_t uiIndex = 0; uiIndex < PALETTE_ENTRIES; ++uiIndex, pPalette += 3 )
-	{
-		palette[ uiIndex ].rgbRed		= pPalette[ 0 ];
-		palette[ uiIndex ].rgbGreen		= pPalette[ 1 ];
-		palette[ uiIndex ].rgbBlue		= pPalette[ 2 ];
-		palette[ uiIndex ].rgbReserved	= 0;
-	}
+	if( fclose( pFile ) != 0 )
+		return false;
 
-	//Write the palette
-	if( fwrite( palette, sizeof( palette ), 1, pFile ) != 1 )
-	{
-		fclose( pFile );
+	return bSuccess;
+}
+}
+
+bool EncodeBMP( const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette, std::vector<uint8_t>& data )
+{
+	if( iWidth <= 0 || iHeight <= 0 )
 		return false;
-	}
 
-	std::unique_ptr<uint8_t[]> pixels = std::make_unique<uint8_t[]>( iPixelsBytes );
+	if( !pPixels || !( pPalette ) )
+		return false;
+
+	const size_t uiRowBytes = GetRowBytes( iWidth, 1 );
+
+	uint8_t* pDest = BeginFile( iWidth, iHeight, 8, PALETTE_ENTRIES * sizeof( RGBQuad ), uiRowBytes, data );
+
+	for( size_t uiIndex = 0; uiIndex < PALETTE_ENTRIES; ++uiIndex, pPalette += 3, pDest += sizeof( RGBQuad ) )
+	{
+		pDest[ 0 ] = pPalette[ 2 ];
+		pDest[ 1 ] = pPalette[ 1 ];
+		pDest[ 2 ] = pPalette[ 0 ];
+		pDest[ 3 ] = 0;
+	}
 
 	//Flip the image vertically.
 	const uint8_t* pSrcData = pPixels + ( iHeight - 1 ) * iWidth;
 
-	for( int iIndex = 0; iIndex < iHeight; ++iIndex, pSrcData -= iWidth )
+	for( int iIndex = 0; iIndex < iHeight; ++iIndex, pSrcData -= iWidth, pDest += uiRowBytes )
 	{
-		memcpy( pixels.get() + ( iDiskWidth * iIndex ), pSrcData, iWidth );
+		memcpy( pDest, pSrcData, iWidth );
 	}
 
-	if( fwrite( pixels.get(), iPixelsBytes, 1, pFile ) != 1 )
-	{
-		fclose( pFile );
+	return true;
+}
+
+bool EncodeRGBBMP( const int iWidth, const int iHeight, const uint8_t* pPixels, std::vector<uint8_t>& data, const bool bBottomUp )
+{
+	if( iWidth <= 0 || iHeight <= 0 )
 		return false;
-	}
 
-	fclose( pFile );
+	if( !pPixels )
+		return false;
+
+	const size_t uiRowBytes = GetRowBytes( iWidth, 3 );
+
+	uint8_t* pDest = BeginFile( iWidth, iHeight, 24, 0, uiRowBytes, data );
+
+	//Swap to the BGR order BMP files use, flipping the image vertically if it's stored top down.
+	const ptrdiff_t iSrcRowStep = bBottomUp ? iWidth * 3 : -iWidth * 3;
+
+	const uint8_t* pSrcData = bBottomUp ? pPixels : pPixels + ( iHeight - 1 ) * iWidth * 3;
+
+	for( int iIndex = 0; iIndex < iHeight; ++iIndex, pSrcData += iSrcRowStep, pDest += uiRowBytes )
+	{
+		const uint8_t* pSrc = pSrcData;
+		uint8_t* pDestPixel = pDest;
+
+		for( int iColumn = 0; iColumn < iWidth; ++iColumn, pSrc += 3, pDestPixel += 3 )
+		{
+			pDestPixel[ 0 ] = pSrc[ 2 ];
+			pDestPixel[ 1 ] = pSrc[ 1 ];
+			pDestPixel[ 2 ] = pSrc[ 0 ];
+		}
+	}
 
 	return true;
 }
+
+bool SaveBMPFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette )
+{
+	if( !pszFilename || !( *pszFilename ) )
+		return false;
+
+	std::vector<uint8_t> data;
+
+	if( !EncodeBMP( iWidth, iHeight, pPixels, pPalette, data ) )
+		return false;
+
+	return WriteFile( pszFilename, data );
+}
+
+bool SaveRGBBMPFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const bool bBottomUp )
+{
+	if( !pszFilename || !( *pszFilename ) )
+		return false;
+
+	std::vector<uint8_t> data;
+
+	if( !EncodeRGBBMP( iWidth, iHeight, pPixels, data, bBottomUp ) )
+		return false;
+
+	return WriteFile( pszFilename, data );
+}
+}
 }
-}
\ No newline at end of file
@@ -1,7 +1,9 @@
 #ifndef GRAPHICS_BMPFILE_H
 #define GRAPHICS_BMPFILE_H
 
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 namespace graphics
 {
@@ -56,15 +58,47 @@ enum Compression
 };
 
 /**
-*	Saves a BMP file. Note: does not support the full range of BMP's features. It is intended to be used only for use with HL textures.
-*	@param pszFilename Filename to save to.
+*	Size of the headers at the start of a BMP file, as stored on disk.
+*/
+const size_t HEADERS_SIZE = 14 + 40;
+
+/**
+*	Encodes an 8 bit paletted image as a BMP file. Note: does not support the full range of BMP's features. It is intended to be used only for use with HL textures.
+*	The file is assembled in a single buffer; only uses memory owned by the caller, so this can be called from any thread.
 *	@param iWidth Width of the image.
 *	@param iHeight Height of the image.
 *	@param pPixels Array of pixels. Must be iWidth * iHeight bytes in size.
 *	@param pPalette Array of colors. Must be 256 entries, each entry being 3 bytes (RGB 8 bit)
+*	@param data Encoded file. Existing contents are replaced.
+*	@return true on success, false otherwise.
+*/
+bool EncodeBMP( const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette, std::vector<uint8_t>& data );
+
+/**
+*	Encodes a 24 bit RGB image as a BMP file.
+*	@param iWidth Width of the image.
+*	@param iHeight Height of the image.
+*	@param pPixels Array of pixels. Must be iWidth * iHeight * 3 bytes in size, each pixel being 3 bytes (RGB 8 bit)
+*	@param data Encoded file. Existing contents are replaced.
+*	@param bBottomUp Whether the last row comes first, like pixels read back from OpenGL. BMP files store rows this way,
+*		so such images need no flipping.
 *	@return true on success, false otherwise.
 */
+bool EncodeRGBBMP( const int iWidth, const int iHeight, const uint8_t* pPixels, std::vector<uint8_t>& data, const bool bBottomUp = false );
+
+/**
+*	Saves a BMP file with a single write.
+*	@param pszFilename Filename to save to.
+*	@see EncodeBMP
+*/
 bool SaveBMPFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette );
+
+/**
+*	Saves a 24 bit BMP file with a single write.
+*	@param pszFilename Filename to save to.
+*	@see EncodeRGBBMP
+*/
+bool SaveRGBBMPFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const bool bBottomUp = false );
 }
 }
 
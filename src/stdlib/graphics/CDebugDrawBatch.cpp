@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include "CGLStreamBuffer.h"
+
+#include "CDebugDrawBatch.h"
+
+namespace graphics
+{
+namespace
+{
+/**
+*	Corners connected by each edge of a box, using the corner order of graphics::DrawBox.
+*/
+const size_t BOX_EDGES[ 12 ][ 2 ] =
+{
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+	{ 0, 2 }, { 2, 4 }, { 4, 6 }, { 6, 0 },
+	{ 1, 3 }, { 3, 5 }, { 5, 7 }, { 7, 1 }
+};
+}
+
+void CDebugDrawBatch::AddLine( const glm::vec3& vecStart, const Color& startColor, const glm::vec3& vecEnd, const Color& endColor )
+{
+	m_Lines.push_back( { vecStart, startColor } );
+	m_Lines.push_back( { vecEnd, endColor } );
+}
+
+void CDebugDrawBatch::AddPoint( const glm::vec3& vecPosition, const float flSize, const Color& color )
+{
+	m_Points.push_back( { flSize, { vecPosition, color } } );
+}
+
+void CDebugDrawBatch::AddBox( const glm::vec3* const v, const Color& color )
+{
+	assert( v );
+
+	for( const auto& edge : BOX_EDGES )
+	{
+		AddLine( v[ edge[ 0 ] ], v[ edge[ 1 ] ], color );
+	}
+}
+
+void CDebugDrawBatch::Clear()
+{
+	m_Lines.clear();
+	m_Points.clear();
+}
+
+size_t CDebugDrawBatch::Draw( CGLStreamBuffer* pStream )
+{
+	if( IsEmpty() )
+		return 0;
+
+	//Points of the same size are drawn together. Stable, so overlapping points are drawn in the order they were added.
+	std::stable_sort( m_Points.begin(), m_Points.end(), []( const Point_t& lhs, const Point_t& rhs )
+	{
+		return lhs.flSize < rhs.flSize;
+	} );
+
+	m_Vertices.clear();
+	m_Vertices.reserve( m_Lines.size() + m_Points.size() );
+
+	m_Vertices.insert( m_Vertices.end(), m_Lines.begin(), m_Lines.end() );
+
+	for( const auto& point : m_Points )
+	{
+		m_Vertices.push_back( point.vertex );
+	}
+
+	const char* pBase = reinterpret_cast<const char*>( m_Vertices.data() );
+
+	if( pStream )
+	{
+		//Leaves the stream bound, so the pointers are offsets into it.
+		pBase = reinterpret_cast<const char*>( pStream->Upload( m_Vertices.data(), m_Vertices.size() * sizeof( Vertex_t ), sizeof( Vertex_t ) ) );
+	}
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
+
+	glVertexPointer( 3, GL_FLOAT, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, vecPosition ) );
+	glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, color ) );
+
+	size_t uiDrawCalls = 0;
+
+	if( !m_Lines.empty() )
+	{
+		glDrawArrays( GL_LINES, 0, static_cast<GLsizei>( m_Lines.size() ) );
+		++uiDrawCalls;
+	}
+
+	for( size_t uiFirst = 0; uiFirst < m_Points.size(); )
+	{
+		const float flSize = m_Points[ uiFirst ].flSize;
+
+		size_t uiEnd = uiFirst + 1;
+
+		while( uiEnd < m_Points.size() && m_Points[ uiEnd ].flSize == flSize )
+			++uiEnd;
+
+		glPointSize( flSize );
+		glDrawArrays( GL_POINTS, static_cast<GLint>( m_Lines.size() + uiFirst ), static_cast<GLsizei>( uiEnd - uiFirst ) );
+		++uiDrawCalls;
+
+		uiFirst = uiEnd;
+	}
+
+	if( !m_Points.empty() )
+		glPointSize( 1.0f );
+
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+
+	if( pStream )
+	{
+		//Code that still uses client side arrays needs no buffer bound.
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+
+	Clear();
+
+	return uiDrawCalls;
+}
+}
@@ -0,0 +1,92 @@
+#ifndef GRAPHICS_CDEBUGDRAWBATCH_H
+#define GRAPHICS_CDEBUGDRAWBATCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "utility/Color.h"
+
+#include "OpenGL.h"
+
+namespace graphics
+{
+class CGLStreamBuffer;
+
+/**
+*	Collects lines and points for debug overlays, like bones and hitboxes, and draws them with as few draw calls as possible.
+*	Lines are drawn in a single call, points in one call for each point size that was used.
+*	Drawing doesn't change any state other than the arrays, so the caller sets up texturing, depth testing and blending beforehand.
+*/
+class CDebugDrawBatch final
+{
+public:
+	struct Vertex_t
+	{
+		glm::vec3 vecPosition;
+		Color color;
+	};
+
+public:
+	CDebugDrawBatch() = default;
+	~CDebugDrawBatch() = default;
+
+	bool IsEmpty() const { return m_Lines.empty() && m_Points.empty(); }
+
+	void AddLine( const glm::vec3& vecStart, const glm::vec3& vecEnd, const Color& color )
+	{
+		AddLine( vecStart, color, vecEnd, color );
+	}
+
+	/**
+	*	Adds a line whose color is blended from one end to the other.
+	*/
+	void AddLine( const glm::vec3& vecStart, const Color& startColor, const glm::vec3& vecEnd, const Color& endColor );
+
+	/**
+	*	Adds a point.
+	*	@param flSize Size of the point, in pixels.
+	*/
+	void AddPoint( const glm::vec3& vecPosition, const float flSize, const Color& color );
+
+	/**
+	*	Adds the edges of a box using an array of 8 vectors as corner points. The corners are ordered the same way as graphics::DrawBox expects them.
+	*/
+	void AddBox( const glm::vec3* const v, const Color& color );
+
+	/**
+	*	Discards everything that was added.
+	*/
+	void Clear();
+
+	/**
+	*	Draws everything that was added, and clears the batch.
+	*	@param pStream If not null, vertices are uploaded to this stream. Otherwise client side arrays are used.
+	*	@return Number of draw calls made.
+	*/
+	size_t Draw( CGLStreamBuffer* pStream = nullptr );
+
+private:
+	struct Point_t
+	{
+		float flSize;
+		Vertex_t vertex;
+	};
+
+private:
+	std::vector<Vertex_t> m_Lines;
+	std::vector<Point_t> m_Points;
+
+	/**
+	*	Lines followed by points sorted by size, as they're drawn.
+	*/
+	std::vector<Vertex_t> m_Vertices;
+
+private:
+	CDebugDrawBatch( const CDebugDrawBatch& ) = delete;
+	CDebugDrawBatch& operator=( const CDebugDrawBatch& ) = delete;
+};
+}
+
+#endif //GRAPHICS_CDEBUGDRAWBATCH_H
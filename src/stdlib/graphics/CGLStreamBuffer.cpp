@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "shared/Logging.h"
+
+#include "CGLStreamBuffer.h"
+
+namespace graphics
+{
+namespace
+{
+bool AreFencesSupported()
+{
+	return GLEW_VERSION_3_2 || GLEW_ARB_sync;
+}
+
+size_t AlignUp( const size_t uiValue, const size_t uiAlignment )
+{
+	return ( ( uiValue + uiAlignment - 1 ) / uiAlignment ) * uiAlignment;
+}
+}
+
+CGLStreamBuffer::~CGLStreamBuffer()
+{
+	Destroy();
+}
+
+bool CGLStreamBuffer::Create( const size_t uiSize )
+{
+	Destroy();
+
+	//Every segment must be able to hold at least one aligned upload.
+	m_uiSize = AlignUp( std::max( uiSize, NUM_SEGMENTS * 256 ), NUM_SEGMENTS );
+
+	glGenBuffers( 1, &m_Buffer );
+
+	if( m_Buffer == 0 )
+	{
+		Error( "CGLStreamBuffer::Create: Couldn't create buffer\n" );
+		return false;
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+
+	//Coherent mapping makes writes visible without flushing; fences make sure the GPU is done reading before writing again.
+	if( GLEW_ARB_buffer_storage && AreFencesSupported() )
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glBufferStorage( GL_ARRAY_BUFFER, m_uiSize, nullptr, flags );
+
+		m_pMapped = glMapBufferRange( GL_ARRAY_BUFFER, 0, m_uiSize, flags );
+
+		if( !m_pMapped )
+		{
+			Warning( "CGLStreamBuffer::Create: Couldn't map buffer persistently, using uploads\n" );
+
+			//Storage is immutable, so the buffer has to be recreated.
+			glDeleteBuffers( 1, &m_Buffer );
+			glGenBuffers( 1, &m_Buffer );
+			glBindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+		}
+	}
+
+	if( !m_pMapped )
+		glBufferData( GL_ARRAY_BUFFER, m_uiSize, nullptr, GL_STREAM_DRAW );
+
+	m_uiOffset = 0;
+	m_uiSegment = 0;
+
+	return true;
+}
+
+void CGLStreamBuffer::Destroy()
+{
+	DeleteFences();
+
+	if( m_Buffer != 0 )
+	{
+		//Deleting a mapped buffer unmaps it.
+		m_pMapped = nullptr;
+
+		glDeleteBuffers( 1, &m_Buffer );
+		m_Buffer = 0;
+	}
+
+	m_uiSize = 0;
+	m_uiOffset = 0;
+	m_uiSegment = 0;
+}
+
+size_t CGLStreamBuffer::Upload( const void* pData, const size_t uiSize, const size_t uiAlignment )
+{
+	assert( uiAlignment > 0 );
+
+	const size_t uiSegmentSize = m_uiSize / NUM_SEGMENTS;
+
+	//Grow so an upload always fits in a segment. The old buffer is freed once the GPU is done with it.
+	if( m_Buffer == 0 || uiSize + uiAlignment > uiSegmentSize )
+	{
+		if( !Create( std::max( m_uiSize, std::max( DEFAULT_SIZE, ( uiSize + uiAlignment ) * NUM_SEGMENTS ) ) ) )
+			return 0;
+	}
+	else
+		glBindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+
+	size_t uiOffset = AlignUp( m_uiOffset, uiAlignment );
+
+	//Uploads don't straddle segments, so each fence covers everything that was written before it.
+	if( uiOffset + uiSize > ( m_uiSegment + 1 ) * ( m_uiSize / NUM_SEGMENTS ) )
+	{
+		NextSegment();
+		uiOffset = AlignUp( m_uiOffset, uiAlignment );
+	}
+
+	if( m_pMapped )
+	{
+		memcpy( static_cast<unsigned char*>( m_pMapped ) + uiOffset, pData, uiSize );
+	}
+	else
+	{
+		glBufferSubData( GL_ARRAY_BUFFER, uiOffset, uiSize, pData );
+	}
+
+	m_uiOffset = uiOffset + uiSize;
+
+	return uiOffset;
+}
+
+void CGLStreamBuffer::NextSegment()
+{
+	m_uiSegment = ( m_uiSegment + 1 ) % NUM_SEGMENTS;
+	m_uiOffset = m_uiSegment * ( m_uiSize / NUM_SEGMENTS );
+
+	//Uploads into unused parts of the buffer don't stall, so only wrapping around needs care.
+	if( !m_pMapped )
+	{
+		//Orphan the storage so the driver doesn't have to wait for draws that still use it.
+		if( m_uiSegment == 0 )
+			glBufferData( GL_ARRAY_BUFFER, m_uiSize, nullptr, GL_STREAM_DRAW );
+
+		return;
+	}
+
+	const size_t uiPrevious = ( m_uiSegment + NUM_SEGMENTS - 1 ) % NUM_SEGMENTS;
+
+	m_Fences[ uiPrevious ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+	if( GLsync fence = m_Fences[ m_uiSegment ] )
+	{
+		//Usually signaled long ago; the ring holds several frames worth of data.
+		if( glClientWaitSync( fence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+		{
+			while( glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 ) == GL_TIMEOUT_EXPIRED )
+			{
+			}
+		}
+
+		glDeleteSync( fence );
+		m_Fences[ m_uiSegment ] = nullptr;
+	}
+}
+
+void CGLStreamBuffer::DeleteFences()
+{
+	for( auto& fence : m_Fences )
+	{
+		if( fence )
+		{
+			glDeleteSync( fence );
+			fence = nullptr;
+		}
+	}
+}
+}
@@ -0,0 +1,104 @@
+#ifndef GRAPHICS_CGLSTREAMBUFFER_H
+#define GRAPHICS_CGLSTREAMBUFFER_H
+
+#include <cstddef>
+
+#include "OpenGL.h"
+
+namespace graphics
+{
+/**
+*	Ring buffer for vertex data that is generated every frame.
+*	If ARB_buffer_storage is supported, the buffer is persistently mapped and written to directly. Otherwise data is uploaded with glBufferSubData,
+*	and the buffer is orphaned when it wraps around.
+*	The ring is split into segments. A fence is placed once writing leaves a segment, and writing waits for that fence before it reuses the segment,
+*	so data isn't overwritten while the GPU may still be reading it. Uploads are synchronized by the driver, so only orphaning is needed then.
+*	The context must be current whenever this is used.
+*/
+class CGLStreamBuffer final
+{
+public:
+	/**
+	*	Size used if none was given, in bytes.
+	*/
+	static const size_t DEFAULT_SIZE = 4 * 1024 * 1024;
+
+	/**
+	*	Number of segments that are fenced separately.
+	*/
+	static const size_t NUM_SEGMENTS = 4;
+
+public:
+	CGLStreamBuffer() = default;
+	~CGLStreamBuffer();
+
+	/**
+	*	Creates the buffer. Called on first use if needed.
+	*	@param uiSize Size of the ring, in bytes. Grows if a single upload doesn't fit in a segment.
+	*	@return Whether the buffer was created.
+	*/
+	bool Create( const size_t uiSize = DEFAULT_SIZE );
+
+	/**
+	*	Destroys the buffer. Safe to call if it wasn't created.
+	*/
+	void Destroy();
+
+	bool IsCreated() const { return m_Buffer != 0; }
+
+	/**
+	*	@return The buffer object. Valid until the next upload, since the buffer can be recreated to grow it.
+	*/
+	GLuint GetBuffer() const { return m_Buffer; }
+
+	/**
+	*	@return Whether the buffer is persistently mapped.
+	*/
+	bool IsPersistent() const { return m_pMapped != nullptr; }
+
+	/**
+	*	Copies data into the ring and binds the buffer to GL_ARRAY_BUFFER.
+	*	@param pData Data to copy.
+	*	@param uiSize Size of the data, in bytes.
+	*	@param uiAlignment Alignment of the returned offset. Should be the size of the vertex structure, so offsets can be used as a base vertex too.
+	*	@return Offset of the data in the buffer, in bytes.
+	*/
+	size_t Upload( const void* pData, const size_t uiSize, const size_t uiAlignment = 16 );
+
+private:
+	/**
+	*	Moves writing to the next segment, fencing the current one and waiting for the next one.
+	*/
+	void NextSegment();
+
+	void DeleteFences();
+
+private:
+	GLuint m_Buffer = 0;
+
+	size_t m_uiSize = 0;
+
+	/**
+	*	Mapped memory, if the buffer is persistently mapped.
+	*/
+	void* m_pMapped = nullptr;
+
+	/**
+	*	Offset that the next upload is written to.
+	*/
+	size_t m_uiOffset = 0;
+
+	size_t m_uiSegment = 0;
+
+	/**
+	*	Fence placed after the last write to each segment, if the buffer is persistently mapped.
+	*/
+	GLsync m_Fences[ NUM_SEGMENTS ] = {};
+
+private:
+	CGLStreamBuffer( const CGLStreamBuffer& ) = delete;
+	CGLStreamBuffer& operator=( const CGLStreamBuffer& ) = delete;
+};
+}
+
+#endif //GRAPHICS_CGLSTREAMBUFFER_H
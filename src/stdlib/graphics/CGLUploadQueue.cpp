@@ -0,0 +1,222 @@
+#include "shared/Logging.h"
+
+#include "CGLUploadQueue.h"
+
+namespace graphics
+{
+namespace
+{
+static CGLUploadQueue g_GLUploadQueue;
+
+/**
+*	How long Flush waits for the GPU at a time, in nanoseconds.
+*/
+const GLuint64 FLUSH_WAIT_TIMEOUT = 1000000000;
+}
+
+CGLUploadQueue& GLUploadQueue()
+{
+	return g_GLUploadQueue;
+}
+
+CGLUploadQueue::~CGLUploadQueue()
+{
+	Stop();
+}
+
+bool CGLUploadQueue::Start( std::unique_ptr<IGLUploadContext>&& context )
+{
+	if( IsRunning() )
+		return true;
+
+	if( !context )
+		return false;
+
+	if( !GLEW_VERSION_3_2 && !GLEW_ARB_sync )
+	{
+		Message( "Fences are not supported by this OpenGL implementation; uploading on the main thread\n" );
+		return false;
+	}
+
+	m_Context = std::move( context );
+	m_bStop = false;
+
+	m_Thread = std::thread( &CGLUploadQueue::UploadThread, this );
+
+	return true;
+}
+
+void CGLUploadQueue::Stop()
+{
+	if( !IsRunning() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		m_bStop = true;
+	}
+
+	m_Signal.notify_all();
+
+	m_Thread.join();
+
+	for( auto& upload : m_Made )
+	{
+		if( upload.fence )
+			glDeleteSync( upload.fence );
+	}
+
+	m_Pending.clear();
+	m_Made.clear();
+
+	m_Context.reset();
+}
+
+void CGLUploadQueue::Queue( UploadFn_t&& upload, CompletionFn_t&& completion )
+{
+	if( !IsRunning() )
+	{
+		if( upload )
+			upload();
+
+		if( completion )
+			completion();
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		Upload_t item;
+
+		item.upload = std::move( upload );
+		item.completion = std::move( completion );
+
+		m_Pending.emplace_back( std::move( item ) );
+	}
+
+	m_Signal.notify_all();
+}
+
+size_t CGLUploadQueue::RunCompletions()
+{
+	if( !IsRunning() )
+		return 0;
+
+	size_t uiCompleted = 0;
+
+	while( true )
+	{
+		Upload_t upload;
+
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			if( m_Made.empty() )
+				break;
+
+			const GLenum result = glClientWaitSync( m_Made.front().fence, 0, 0 );
+
+			//Later uploads can't have finished before this one.
+			if( result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED )
+				break;
+
+			upload = std::move( m_Made.front() );
+			m_Made.pop_front();
+		}
+
+		//Called without the lock held so it can queue more uploads.
+		Complete( upload );
+
+		++uiCompleted;
+	}
+
+	return uiCompleted;
+}
+
+void CGLUploadQueue::Flush()
+{
+	if( !IsRunning() )
+		return;
+
+	while( true )
+	{
+		Upload_t upload;
+
+		{
+			std::unique_lock<std::mutex> lock( m_Mutex );
+
+			m_Signal.wait( lock, [ this ] { return !m_Made.empty() || m_Pending.empty(); } );
+
+			if( m_Made.empty() )
+				break;
+
+			upload = std::move( m_Made.front() );
+			m_Made.pop_front();
+		}
+
+		while( glClientWaitSync( upload.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FLUSH_WAIT_TIMEOUT ) == GL_TIMEOUT_EXPIRED )
+		{
+		}
+
+		Complete( upload );
+	}
+}
+
+void CGLUploadQueue::UploadThread()
+{
+	if( !m_Context->MakeCurrent() )
+	{
+		Error( "CGLUploadQueue::UploadThread: Couldn't make the upload context current\n" );
+	}
+
+	while( true )
+	{
+		Upload_t upload;
+
+		{
+			std::unique_lock<std::mutex> lock( m_Mutex );
+
+			m_Signal.wait( lock, [ this ] { return m_bStop || !m_Pending.empty(); } );
+
+			if( m_bStop )
+				break;
+
+			//Moved out so the main thread can keep queueing while this upload is made.
+			upload = std::move( m_Pending.front() );
+			m_Pending.pop_front();
+		}
+
+		if( upload.upload )
+			upload.upload();
+
+		upload.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+		//The main context can only see the fence once it's been flushed.
+		glFlush();
+
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			m_Made.emplace_back( std::move( upload ) );
+		}
+
+		m_Signal.notify_all();
+	}
+
+	m_Context->ReleaseCurrent();
+}
+
+void CGLUploadQueue::Complete( Upload_t& upload )
+{
+	if( upload.fence )
+	{
+		glDeleteSync( upload.fence );
+		upload.fence = nullptr;
+	}
+
+	if( upload.completion )
+		upload.completion();
+}
+}
@@ -0,0 +1,148 @@
+#ifndef GRAPHICS_CGLUPLOADQUEUE_H
+#define GRAPHICS_CGLUPLOADQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "OpenGL.h"
+
+namespace graphics
+{
+/**
+*	Context that the upload thread makes current. It must share objects with the main context.
+*	Implemented by the UI layer, since that's what creates contexts.
+*/
+class IGLUploadContext
+{
+public:
+	virtual ~IGLUploadContext() = default;
+
+	/**
+	*	Makes the context current on the calling thread.
+	*	@return Whether the context is current.
+	*/
+	virtual bool MakeCurrent() = 0;
+
+	/**
+	*	Makes the context no longer current on the calling thread.
+	*/
+	virtual void ReleaseCurrent() = 0;
+};
+
+/**
+*	Runs GL uploads on a thread that has its own context, so texture uploads don't stall the thread that draws.
+*	Each upload is followed by a fence. Once the GPU has passed the fence, the upload's completion function is called
+*	on the main thread, after which the uploaded objects can be used by the main context.
+*
+*	If no upload thread is running, uploads and their completion functions are called immediately on the calling thread,
+*	so callers don't need to handle both cases.
+*/
+class CGLUploadQueue final
+{
+public:
+	/**
+	*	Function that makes GL calls on the upload thread.
+	*/
+	typedef std::function<void()> UploadFn_t;
+
+	/**
+	*	Function that is called on the main thread once an upload has completed.
+	*/
+	typedef std::function<void()> CompletionFn_t;
+
+public:
+	CGLUploadQueue() = default;
+	~CGLUploadQueue();
+
+	/**
+	*	Starts the upload thread. Requires fences (OpenGL 3.2 or ARB_sync); the main context must be current.
+	*	@param context Context the upload thread uses. Destroyed when the thread stops, on the thread that calls Stop.
+	*	@return Whether the thread was started.
+	*/
+	bool Start( std::unique_ptr<IGLUploadContext>&& context );
+
+	/**
+	*	Stops the upload thread. Uploads that haven't finished yet are discarded without calling their completion functions.
+	*/
+	void Stop();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	/**
+	*	Queues an upload. Anything the functions use must stay valid until the completion function has been called.
+	*	Must be called on the main thread.
+	*/
+	void Queue( UploadFn_t&& upload, CompletionFn_t&& completion );
+
+	/**
+	*	Calls the completion functions of uploads that the GPU has finished, in the order they were queued.
+	*	Must be called on the main thread with the main context current.
+	*	@return Number of completion functions that were called.
+	*/
+	size_t RunCompletions();
+
+	/**
+	*	Waits for every queued upload to finish and calls their completion functions.
+	*	Must be called on the main thread with the main context current.
+	*/
+	void Flush();
+
+private:
+	struct Upload_t
+	{
+		UploadFn_t upload;
+		CompletionFn_t completion;
+
+		/**
+		*	Set by the upload thread once the upload has been made.
+		*/
+		GLsync fence = nullptr;
+	};
+
+	void UploadThread();
+
+	/**
+	*	Calls the completion function of the given upload and destroys its fence.
+	*/
+	void Complete( Upload_t& upload );
+
+private:
+	std::unique_ptr<IGLUploadContext> m_Context;
+
+	std::thread m_Thread;
+
+	std::mutex m_Mutex;
+
+	/**
+	*	Signalled when uploads are queued, when the thread should stop, and when an upload has been made.
+	*/
+	std::condition_variable m_Signal;
+
+	bool m_bStop = false;
+
+	/**
+	*	Uploads that haven't been made yet, oldest first.
+	*/
+	std::deque<Upload_t> m_Pending;
+
+	/**
+	*	Uploads that have been made, waiting for the GPU, oldest first.
+	*/
+	std::deque<Upload_t> m_Made;
+
+private:
+	CGLUploadQueue( const CGLUploadQueue& ) = delete;
+	CGLUploadQueue& operator=( const CGLUploadQueue& ) = delete;
+};
+
+/**
+*	Queue used for texture uploads.
+*/
+CGLUploadQueue& GLUploadQueue();
+}
+
+#endif //GRAPHICS_CGLUPLOADQUEUE_H
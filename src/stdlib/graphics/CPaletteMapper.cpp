@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+
+#include <emmintrin.h>
+
+#include "shared/TaskScheduler.h"
+
+#include "utility/PlatUtils.h"
+
+#include "CPaletteMapper.h"
+
+namespace graphics
+{
+namespace
+{
+/**
+*	Rows in each band of an image that's mapped in parallel.
+*/
+const int ROWS_PER_BAND = 16;
+
+/**
+*	Unused entries in the SIMD copy of the palette are set to this, so they're further away than any real color.
+*/
+const int16_t PADDING_COLOR = 1000;
+
+bool UseSSE2()
+{
+	static const bool bSupported = plat::IsSSE2Supported();
+
+	return bSupported;
+}
+
+/**
+*	Palette split into channels, padded to a multiple of 8 entries.
+*/
+struct alignas( 16 ) PlanarPalette_t
+{
+	int16_t r[ PALETTE_ENTRIES ];
+	int16_t g[ PALETTE_ENTRIES ];
+	int16_t b[ PALETTE_ENTRIES ];
+};
+
+size_t FindNearestColor( const byte* const pPalette, const size_t uiNumColors, const int r, const int g, const int b )
+{
+	int iBestDistance = INT_MAX;
+	size_t uiBestIndex = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiNumColors; ++uiIndex )
+	{
+		const byte* const pColor = pPalette + uiIndex * PALETTE_CHANNELS;
+
+		const int dr = pColor[ 0 ] - r;
+		const int dg = pColor[ 1 ] - g;
+		const int db = pColor[ 2 ] - b;
+
+		const int iDistance = dr * dr + dg * dg + db * db;
+
+		if( iDistance < iBestDistance )
+		{
+			iBestDistance = iDistance;
+			uiBestIndex = uiIndex;
+		}
+	}
+
+	return uiBestIndex;
+}
+
+/**
+*	Keeps the distance and index of each lane that's closer than the best one so far.
+*/
+SSE2_TARGET inline void SelectNearer( const __m128i distance, const __m128i index, __m128i& bestDistance, __m128i& bestIndex )
+{
+	const __m128i nearer = _mm_cmplt_epi32( distance, bestDistance );
+
+	bestDistance = _mm_or_si128( _mm_and_si128( nearer, distance ), _mm_andnot_si128( nearer, bestDistance ) );
+	bestIndex = _mm_or_si128( _mm_and_si128( nearer, index ), _mm_andnot_si128( nearer, bestIndex ) );
+}
+
+/**
+*	Same as FindNearestColor, but compares 8 entries at a time. Ties are resolved the same way, so the results are identical.
+*/
+SSE2_TARGET size_t FindNearestColorSSE2( const PlanarPalette_t& palette, const size_t uiNumColors, const int r, const int g, const int b )
+{
+	const __m128i red = _mm_set1_epi16( static_cast<int16_t>( r ) );
+	const __m128i green = _mm_set1_epi16( static_cast<int16_t>( g ) );
+	const __m128i blue = _mm_set1_epi16( static_cast<int16_t>( b ) );
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i four = _mm_set1_epi32( 4 );
+
+	__m128i bestDistance = _mm_set1_epi32( INT_MAX );
+	__m128i bestIndex = zero;
+	__m128i index = _mm_setr_epi32( 0, 1, 2, 3 );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumColors; uiIndex += 8 )
+	{
+		const __m128i dr = _mm_sub_epi16( _mm_load_si128( reinterpret_cast<const __m128i*>( palette.r + uiIndex ) ), red );
+		const __m128i dg = _mm_sub_epi16( _mm_load_si128( reinterpret_cast<const __m128i*>( palette.g + uiIndex ) ), green );
+		const __m128i db = _mm_sub_epi16( _mm_load_si128( reinterpret_cast<const __m128i*>( palette.b + uiIndex ) ), blue );
+
+		//Interleaving red and green lets one multiply-add compute dr * dr + dg * dg in 32 bits.
+		const __m128i rgLow = _mm_unpacklo_epi16( dr, dg );
+		const __m128i rgHigh = _mm_unpackhi_epi16( dr, dg );
+		const __m128i bLow = _mm_unpacklo_epi16( db, zero );
+		const __m128i bHigh = _mm_unpackhi_epi16( db, zero );
+
+		const __m128i distanceLow = _mm_add_epi32( _mm_madd_epi16( rgLow, rgLow ), _mm_madd_epi16( bLow, bLow ) );
+		const __m128i distanceHigh = _mm_add_epi32( _mm_madd_epi16( rgHigh, rgHigh ), _mm_madd_epi16( bHigh, bHigh ) );
+
+		SelectNearer( distanceLow, index, bestDistance, bestIndex );
+		index = _mm_add_epi32( index, four );
+
+		SelectNearer( distanceHigh, index, bestDistance, bestIndex );
+		index = _mm_add_epi32( index, four );
+	}
+
+	alignas( 16 ) int32_t distances[ 4 ];
+	alignas( 16 ) int32_t indices[ 4 ];
+
+	_mm_store_si128( reinterpret_cast<__m128i*>( distances ), bestDistance );
+	_mm_store_si128( reinterpret_cast<__m128i*>( indices ), bestIndex );
+
+	size_t uiBestLane = 0;
+
+	for( size_t uiLane = 1; uiLane < 4; ++uiLane )
+	{
+		if( distances[ uiLane ] < distances[ uiBestLane ] ||
+			( distances[ uiLane ] == distances[ uiBestLane ] && indices[ uiLane ] < indices[ uiBestLane ] ) )
+		{
+			uiBestLane = uiLane;
+		}
+	}
+
+	return static_cast<size_t>( indices[ uiBestLane ] );
+}
+}
+
+CPaletteMapper::CPaletteMapper( const byte* const pPalette, const size_t uiNumColors )
+{
+	assert( pPalette );
+	assert( uiNumColors > 0 && uiNumColors <= PALETTE_ENTRIES );
+
+	std::fill( std::begin( m_ExactColors ), std::end( m_ExactColors ), EMPTY_SLOT );
+	std::fill( std::begin( m_ExactIndices ), std::end( m_ExactIndices ), 0 );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumColors; ++uiIndex )
+	{
+		const byte* const pColor = pPalette + uiIndex * PALETTE_CHANNELS;
+
+		const uint32_t uiColor = ( pColor[ 0 ] << 16 ) | ( pColor[ 1 ] << 8 ) | pColor[ 2 ];
+
+		size_t uiSlot = Hash( uiColor );
+
+		while( m_ExactColors[ uiSlot ] != EMPTY_SLOT && m_ExactColors[ uiSlot ] != uiColor )
+			uiSlot = ( uiSlot + 1 ) & ( NUM_SLOTS - 1 );
+
+		//Palettes often repeat colors; the first entry wins, like a linear search would pick.
+		if( m_ExactColors[ uiSlot ] == EMPTY_SLOT )
+		{
+			m_ExactColors[ uiSlot ] = uiColor;
+			m_ExactIndices[ uiSlot ] = static_cast<byte>( uiIndex );
+		}
+	}
+
+	const bool bUseSSE2 = UseSSE2();
+
+	PlanarPalette_t planar;
+
+	if( bUseSSE2 )
+	{
+		std::fill( std::begin( planar.r ), std::end( planar.r ), PADDING_COLOR );
+		std::fill( std::begin( planar.g ), std::end( planar.g ), PADDING_COLOR );
+		std::fill( std::begin( planar.b ), std::end( planar.b ), PADDING_COLOR );
+
+		for( size_t uiIndex = 0; uiIndex < uiNumColors; ++uiIndex )
+		{
+			planar.r[ uiIndex ] = pPalette[ uiIndex * PALETTE_CHANNELS ];
+			planar.g[ uiIndex ] = pPalette[ uiIndex * PALETTE_CHANNELS + 1 ];
+			planar.b[ uiIndex ] = pPalette[ uiIndex * PALETTE_CHANNELS + 2 ];
+		}
+	}
+
+	//Each cell maps to the entry nearest to its center.
+	for( size_t uiCell = 0; uiCell < NUM_CELLS; ++uiCell )
+	{
+		const int r = static_cast<int>( ( ( uiCell >> 10 ) & 0x1F ) << 3 ) | 4;
+		const int g = static_cast<int>( ( ( uiCell >> 5 ) & 0x1F ) << 3 ) | 4;
+		const int b = static_cast<int>( ( uiCell & 0x1F ) << 3 ) | 4;
+
+		const size_t uiIndex = bUseSSE2 ? FindNearestColorSSE2( planar, uiNumColors, r, g, b ) : FindNearestColor( pPalette, uiNumColors, r, g, b );
+
+		m_NearestIndices[ uiCell ] = static_cast<byte>( uiIndex );
+	}
+}
+
+void CPaletteMapper::MapPixels( const byte* pRGB, const size_t uiCount, byte* pOut ) const
+{
+	assert( pRGB );
+	assert( pOut );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex, pRGB += 3 )
+	{
+		pOut[ uiIndex ] = MapColor( pRGB[ 0 ], pRGB[ 1 ], pRGB[ 2 ] );
+	}
+}
+
+void CPaletteMapper::MapImage( const byte* pRGB, const int iWidth, const int iHeight, byte* pOut ) const
+{
+	assert( pRGB );
+	assert( pOut );
+
+	if( iWidth <= 0 || iHeight <= 0 )
+		return;
+
+	const size_t uiWidth = static_cast<size_t>( iWidth );
+
+	if( uiWidth * iHeight < MIN_PARALLEL_PIXELS )
+	{
+		MapPixels( pRGB, uiWidth * iHeight, pOut );
+		return;
+	}
+
+	const size_t uiNumBands = static_cast<size_t>( ( iHeight + ROWS_PER_BAND - 1 ) / ROWS_PER_BAND );
+
+	tasks::ParallelFor( uiNumBands, [ & ]( const size_t uiBand )
+	{
+		const size_t uiFirstRow = uiBand * ROWS_PER_BAND;
+		const size_t uiRows = std::min<size_t>( ROWS_PER_BAND, iHeight - uiFirstRow );
+
+		MapPixels( pRGB + uiFirstRow * uiWidth * 3, uiRows * uiWidth, pOut + uiFirstRow * uiWidth );
+	}, 0, "MapPalette" );
+}
+}
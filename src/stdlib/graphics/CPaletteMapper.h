@@ -0,0 +1,99 @@
+#ifndef GRAPHICS_CPALETTEMAPPER_H
+#define GRAPHICS_CPALETTEMAPPER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "shared/Const.h"
+
+#include "Palette.h"
+
+namespace graphics
+{
+/**
+*	Maps RGB colors to the indices of a palette, for converting images to 8 bit.
+*	Colors that are in the palette map to their exact index. Other colors map to the entry nearest to their RGB555 cell,
+*	which is looked up in a table that's built once per palette. Mappers are never modified after construction,
+*	so one mapper can be used from many threads.
+*/
+class CPaletteMapper final
+{
+public:
+	/**
+	*	Number of cells in the nearest color table, one for every RGB555 color.
+	*/
+	static const size_t NUM_CELLS = 1 << 15;
+
+	/**
+	*	Images with at least this many pixels are mapped in parallel.
+	*/
+	static const size_t MIN_PARALLEL_PIXELS = 64 * 64;
+
+public:
+	/**
+	*	@param pPalette Palette to map to. Must be uiNumColors * PALETTE_CHANNELS bytes.
+	*	@param uiNumColors Number of colors in the palette. At most PALETTE_ENTRIES.
+	*/
+	CPaletteMapper( const byte* const pPalette, const size_t uiNumColors = PALETTE_ENTRIES );
+	~CPaletteMapper() = default;
+
+	/**
+	*	@return The index of the palette entry that best matches the color.
+	*/
+	byte MapColor( const byte r, const byte g, const byte b ) const
+	{
+		const uint32_t uiColor = ( r << 16 ) | ( g << 8 ) | b;
+
+		for( size_t uiSlot = Hash( uiColor ); m_ExactColors[ uiSlot ] != EMPTY_SLOT; uiSlot = ( uiSlot + 1 ) & ( NUM_SLOTS - 1 ) )
+		{
+			if( m_ExactColors[ uiSlot ] == uiColor )
+				return m_ExactIndices[ uiSlot ];
+		}
+
+		return m_NearestIndices[ ( ( r >> 3 ) << 10 ) | ( ( g >> 3 ) << 5 ) | ( b >> 3 ) ];
+	}
+
+	/**
+	*	Maps RGB pixels to palette indices.
+	*	@param pRGB Pixels to map, 3 bytes each.
+	*	@param uiCount Number of pixels.
+	*	@param pOut Palette indices. Must be uiCount bytes.
+	*/
+	void MapPixels( const byte* pRGB, const size_t uiCount, byte* pOut ) const;
+
+	/**
+	*	Maps an RGB image to palette indices. Large images are split into bands of rows that are mapped in parallel.
+	*	@param pRGB Pixels to map, 3 bytes each. Rows are tightly packed.
+	*	@param iWidth Width of the image.
+	*	@param iHeight Height of the image.
+	*	@param pOut Palette indices. Must be iWidth * iHeight bytes.
+	*/
+	void MapImage( const byte* pRGB, const int iWidth, const int iHeight, byte* pOut ) const;
+
+private:
+	/**
+	*	Size of the exact color table. Large enough that it's at most a quarter full.
+	*/
+	static const size_t NUM_SLOTS = PALETTE_ENTRIES * 4;
+
+	static const uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+	static size_t Hash( const uint32_t uiColor )
+	{
+		//Knuth's multiplicative hash, the top bits are the best mixed.
+		return static_cast<size_t>( ( uiColor * 2654435761U ) >> 22 ) & ( NUM_SLOTS - 1 );
+	}
+
+private:
+	uint32_t m_ExactColors[ NUM_SLOTS ];
+	byte m_ExactIndices[ NUM_SLOTS ];
+
+	byte m_NearestIndices[ NUM_CELLS ];
+
+private:
+	CPaletteMapper( const CPaletteMapper& ) = delete;
+	CPaletteMapper& operator=( const CPaletteMapper& ) = delete;
+};
+}
+
+#endif //GRAPHICS_CPALETTEMAPPER_H
@@ -0,0 +1,211 @@
+#include <cassert>
+
+#include "shared/Logging.h"
+
+#include "CPixelReadback.h"
+
+namespace graphics
+{
+namespace
+{
+/**
+*	How long to wait for a copy to finish per try when waiting, in nanoseconds.
+*/
+const GLuint64 WAIT_TIMEOUT = 100000000;
+
+bool UsePixelBuffers()
+{
+	return GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+}
+
+bool UseSyncObjects()
+{
+	return GLEW_VERSION_3_2 || GLEW_ARB_sync;
+}
+}
+
+CPixelReadback::~CPixelReadback()
+{
+	Destroy();
+}
+
+CPixelReadback::Handle_t CPixelReadback::Read( const GLint x, const GLint y, const GLsizei iWidth, const GLsizei iHeight, const GLenum readBuffer )
+{
+	assert( iWidth > 0 && iHeight > 0 );
+
+	Request_t request{};
+
+	request.handle = m_NextHandle++;
+
+	if( m_NextHandle == INVALID_HANDLE )
+		m_NextHandle = INVALID_HANDLE + 1;
+
+	request.iWidth = iWidth;
+	request.iHeight = iHeight;
+
+	const size_t uiSize = static_cast<size_t>( iWidth ) * iHeight * 3;
+
+	GLint oldReadBuffer;
+	GLint oldPackAlignment;
+
+	glGetIntegerv( GL_READ_BUFFER, &oldReadBuffer );
+	glGetIntegerv( GL_PACK_ALIGNMENT, &oldPackAlignment );
+
+	glReadBuffer( readBuffer );
+
+	//Set pack alignment to 1 so no padding is added
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+
+	if( UsePixelBuffers() )
+	{
+		if( !m_FreeBuffers.empty() )
+		{
+			request.buffer = m_FreeBuffers.back();
+			m_FreeBuffers.pop_back();
+		}
+		else
+		{
+			glGenBuffers( 1, &request.buffer );
+		}
+
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, request.buffer );
+
+		glBufferData( GL_PIXEL_PACK_BUFFER, uiSize, nullptr, GL_STREAM_READ );
+
+		//Returns right away; the pixels are copied into the buffer in the background.
+		glReadPixels( x, y, iWidth, iHeight, GL_RGB, GL_UNSIGNED_BYTE, nullptr );
+
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+		if( UseSyncObjects() )
+		{
+			request.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+			//Make sure the fence gets to the GPU, otherwise polling it never finishes.
+			glFlush();
+		}
+	}
+	else
+	{
+		request.pixels.resize( uiSize );
+
+		glReadPixels( x, y, iWidth, iHeight, GL_RGB, GL_UNSIGNED_BYTE, request.pixels.data() );
+	}
+
+	glReadBuffer( oldReadBuffer );
+	glPixelStorei( GL_PACK_ALIGNMENT, oldPackAlignment );
+
+	const Handle_t handle = request.handle;
+
+	m_Requests.emplace_back( std::move( request ) );
+
+	return handle;
+}
+
+void CPixelReadback::Poll( const CompletionFn_t& func, const bool bWait )
+{
+	//Requests finish in order, so stop at the first one that hasn't finished.
+	while( !m_Requests.empty() && IsFinished( m_Requests.front(), bWait ) )
+	{
+		Complete( func );
+	}
+}
+
+void CPixelReadback::PollUntil( const CompletionFn_t& func, const size_t uiMaxPending )
+{
+	Poll( func, false );
+
+	while( m_Requests.size() > uiMaxPending )
+	{
+		IsFinished( m_Requests.front(), true );
+
+		Complete( func );
+	}
+}
+
+void CPixelReadback::Destroy()
+{
+	for( auto& request : m_Requests )
+	{
+		FreeRequest( request );
+	}
+
+	m_Requests.clear();
+
+	if( !m_FreeBuffers.empty() )
+	{
+		glDeleteBuffers( static_cast<GLsizei>( m_FreeBuffers.size() ), m_FreeBuffers.data() );
+		m_FreeBuffers.clear();
+	}
+}
+
+bool CPixelReadback::IsFinished( Request_t& request, const bool bWait )
+{
+	if( !request.buffer )
+		return true;
+
+	if( request.fence )
+	{
+		GLenum result;
+
+		do
+		{
+			result = glClientWaitSync( request.fence, 0, bWait ? WAIT_TIMEOUT : 0 );
+		}
+		while( bWait && result == GL_TIMEOUT_EXPIRED );
+
+		return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED;
+	}
+
+	//Without sync objects, assume the copy has finished by the next frame. Mapping the buffer waits for it regardless.
+	return bWait || request.uiPollCount++ > 0;
+}
+
+void CPixelReadback::Complete( const CompletionFn_t& func )
+{
+	assert( !m_Requests.empty() );
+
+	//Taken out of the queue first so the callback can start new reads.
+	Request_t request = std::move( m_Requests.front() );
+
+	m_Requests.pop_front();
+
+	if( request.buffer )
+	{
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, request.buffer );
+
+		const auto pPixels = static_cast<const unsigned char*>( glMapBuffer( GL_PIXEL_PACK_BUFFER, GL_READ_ONLY ) );
+
+		if( !pPixels )
+			Error( "CPixelReadback::Poll: Couldn't map pixel buffer\n" );
+
+		func( request.handle, pPixels, request.iWidth, request.iHeight );
+
+		if( pPixels )
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	}
+	else
+	{
+		func( request.handle, request.pixels.data(), request.iWidth, request.iHeight );
+	}
+
+	FreeRequest( request );
+}
+
+void CPixelReadback::FreeRequest( Request_t& request )
+{
+	if( request.fence )
+	{
+		glDeleteSync( request.fence );
+		request.fence = nullptr;
+	}
+
+	if( request.buffer )
+	{
+		m_FreeBuffers.push_back( request.buffer );
+		request.buffer = 0;
+	}
+}
+}
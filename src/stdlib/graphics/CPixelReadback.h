@@ -0,0 +1,125 @@
+#ifndef GRAPHICS_CPIXELREADBACK_H
+#define GRAPHICS_CPIXELREADBACK_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "OpenGL.h"
+
+namespace graphics
+{
+/**
+*	Reads pixels back from the framebuffer without stalling, by copying them into pixel buffer objects that are mapped later on.
+*	The copy overlaps with drawing the next frames; Poll hands out pixels once the GPU has finished writing them.
+*	Falls back to synchronous reads if pixel buffer objects are not supported.
+*	Pixels are tightly packed RGB, with rows stored bottom to top.
+*	The context must be current whenever this is used.
+*/
+class CPixelReadback final
+{
+public:
+	typedef unsigned int Handle_t;
+
+	static const Handle_t INVALID_HANDLE = 0;
+
+	/**
+	*	Called with finished readbacks.
+	*	@param handle Handle returned by Read.
+	*	@param pPixels Pixels. Only valid during the call.
+	*	@param iWidth Width of the area that was read.
+	*	@param iHeight Height of the area that was read.
+	*/
+	using CompletionFn_t = std::function<void( const Handle_t handle, const unsigned char* pPixels, const GLsizei iWidth, const GLsizei iHeight )>;
+
+private:
+	struct Request_t
+	{
+		Handle_t handle;
+
+		GLuint buffer;
+
+		GLsizei iWidth;
+		GLsizei iHeight;
+
+		/**
+		*	Signaled once the copy has finished, if sync objects are supported.
+		*/
+		GLsync fence;
+
+		/**
+		*	Number of times the request has been polled. Used to guess whether the copy has finished without sync objects.
+		*/
+		unsigned int uiPollCount;
+
+		/**
+		*	Pixels for synchronous reads.
+		*/
+		std::vector<unsigned char> pixels;
+	};
+
+public:
+	CPixelReadback() = default;
+	~CPixelReadback();
+
+	/**
+	*	@return Whether any readbacks have not been handed out by Poll yet.
+	*/
+	bool IsPending() const { return !m_Requests.empty(); }
+
+	/**
+	*	@return Number of readbacks that have not been handed out by Poll yet.
+	*/
+	size_t GetPendingCount() const { return m_Requests.size(); }
+
+	/**
+	*	Starts copying pixels from the given area of the given buffer of the bound framebuffer.
+	*	@return Handle that identifies the readback in Poll.
+	*/
+	Handle_t Read( const GLint x, const GLint y, const GLsizei iWidth, const GLsizei iHeight, const GLenum readBuffer );
+
+	/**
+	*	Calls func for readbacks that have finished, oldest first.
+	*	@param bWait Whether to wait for all readbacks to finish.
+	*/
+	void Poll( const CompletionFn_t& func, const bool bWait = false );
+
+	/**
+	*	Calls func for readbacks that have finished, oldest first, then waits for the oldest ones until at most uiMaxPending are left.
+	*	Lets callers keep a fixed number of readbacks in flight without waiting for all of them.
+	*/
+	void PollUntil( const CompletionFn_t& func, const size_t uiMaxPending );
+
+	/**
+	*	Frees all buffers and forgets pending readbacks.
+	*/
+	void Destroy();
+
+private:
+	bool IsFinished( Request_t& request, const bool bWait );
+
+	/**
+	*	Hands out the oldest request, which must have finished.
+	*/
+	void Complete( const CompletionFn_t& func );
+
+	void FreeRequest( Request_t& request );
+
+private:
+	std::deque<Request_t> m_Requests;
+
+	/**
+	*	Buffers that can be reused, to avoid allocating new buffer storage for every readback.
+	*/
+	std::vector<GLuint> m_FreeBuffers;
+
+	Handle_t m_NextHandle = INVALID_HANDLE + 1;
+
+private:
+	CPixelReadback( const CPixelReadback& ) = delete;
+	CPixelReadback& operator=( const CPixelReadback& ) = delete;
+};
+}
+
+#endif //GRAPHICS_CPIXELREADBACK_H
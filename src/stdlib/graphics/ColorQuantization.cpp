@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "CPaletteMapper.h"
+#include "Palette.h"
+
+#include "ColorQuantization.h"
+
+namespace graphics
+{
+namespace
+{
+const size_t NUM_CELLS = 1 << 15;
+
+const int CHANNELS = static_cast<int>( PALETTE_CHANNELS );
+
+/**
+*	Alpha values below this are left out of the palette.
+*/
+const byte MIN_OPAQUE_ALPHA = 128;
+
+/**
+*	A non-empty RGB555 cell of the histogram.
+*/
+struct Cell_t
+{
+	uint32_t uiCount;
+
+	/**
+	*	Average color of the pixels in this cell.
+	*/
+	byte color[ PALETTE_CHANNELS ];
+
+	uint64_t uiSums[ PALETTE_CHANNELS ];
+};
+
+/**
+*	A range of cells that becomes one palette entry.
+*/
+struct Box_t
+{
+	size_t uiBegin;
+	size_t uiEnd;
+
+	uint64_t uiCount;
+
+	/**
+	*	Channel with the largest range, and that range.
+	*/
+	int iChannel;
+	int iRange;
+};
+
+void MeasureBox( const std::vector<Cell_t>& cells, Box_t& box )
+{
+	byte mins[ PALETTE_CHANNELS ] = { 255, 255, 255 };
+	byte maxs[ PALETTE_CHANNELS ] = { 0, 0, 0 };
+
+	box.uiCount = 0;
+
+	for( size_t uiCell = box.uiBegin; uiCell < box.uiEnd; ++uiCell )
+	{
+		const auto& cell = cells[ uiCell ];
+
+		box.uiCount += cell.uiCount;
+
+		for( size_t uiChannel = 0; uiChannel < PALETTE_CHANNELS; ++uiChannel )
+		{
+			mins[ uiChannel ] = std::min( mins[ uiChannel ], cell.color[ uiChannel ] );
+			maxs[ uiChannel ] = std::max( maxs[ uiChannel ], cell.color[ uiChannel ] );
+		}
+	}
+
+	box.iChannel = 0;
+	box.iRange = -1;
+
+	for( size_t uiChannel = 0; uiChannel < PALETTE_CHANNELS; ++uiChannel )
+	{
+		const int iRange = maxs[ uiChannel ] - mins[ uiChannel ];
+
+		if( iRange > box.iRange )
+		{
+			box.iChannel = static_cast<int>( uiChannel );
+			box.iRange = iRange;
+		}
+	}
+}
+
+byte ClampColor( const int iValue )
+{
+	return static_cast<byte>( std::min( 255, std::max( 0, iValue ) ) );
+}
+}
+
+size_t BuildMedianCutPalette( const byte* const pRGB, const size_t uiCount, const size_t uiMaxColors, byte* const pOutPalette,
+							  const byte* const pAlpha )
+{
+	assert( pRGB );
+	assert( pOutPalette );
+	assert( uiMaxColors > 0 && uiMaxColors <= PALETTE_ENTRIES );
+
+	memset( pOutPalette, 0, uiMaxColors * PALETTE_CHANNELS );
+
+	std::vector<uint32_t> counts( NUM_CELLS, 0 );
+	std::vector<uint64_t> sums( NUM_CELLS * PALETTE_CHANNELS, 0 );
+
+	const byte* pPixel = pRGB;
+
+	for( size_t uiPixel = 0; uiPixel < uiCount; ++uiPixel, pPixel += PALETTE_CHANNELS )
+	{
+		if( pAlpha && pAlpha[ uiPixel ] < MIN_OPAQUE_ALPHA )
+			continue;
+
+		const size_t uiCell = ( ( pPixel[ 0 ] >> 3 ) << 10 ) | ( ( pPixel[ 1 ] >> 3 ) << 5 ) | ( pPixel[ 2 ] >> 3 );
+
+		++counts[ uiCell ];
+
+		uint64_t* const pSums = &sums[ uiCell * PALETTE_CHANNELS ];
+
+		pSums[ 0 ] += pPixel[ 0 ];
+		pSums[ 1 ] += pPixel[ 1 ];
+		pSums[ 2 ] += pPixel[ 2 ];
+	}
+
+	std::vector<Cell_t> cells;
+
+	for( size_t uiCell = 0; uiCell < NUM_CELLS; ++uiCell )
+	{
+		if( !counts[ uiCell ] )
+			continue;
+
+		Cell_t cell;
+
+		cell.uiCount = counts[ uiCell ];
+
+		for( size_t uiChannel = 0; uiChannel < PALETTE_CHANNELS; ++uiChannel )
+		{
+			cell.uiSums[ uiChannel ] = sums[ uiCell * PALETTE_CHANNELS + uiChannel ];
+			cell.color[ uiChannel ] = static_cast<byte>( cell.uiSums[ uiChannel ] / cell.uiCount );
+		}
+
+		cells.push_back( cell );
+	}
+
+	if( cells.empty() )
+		return 0;
+
+	std::vector<Box_t> boxes;
+
+	boxes.reserve( uiMaxColors );
+
+	{
+		Box_t box{ 0, cells.size(), 0, 0, 0 };
+
+		MeasureBox( cells, box );
+
+		boxes.push_back( box );
+	}
+
+	while( boxes.size() < uiMaxColors )
+	{
+		//Split the box whose pixels are spread out the most. Weighting the range by the number of pixels
+		//gives common colors more palette entries than rare outliers.
+		Box_t* pBest = nullptr;
+		uint64_t uiBestScore = 0;
+
+		for( auto& box : boxes )
+		{
+			if( box.uiEnd - box.uiBegin < 2 )
+				continue;
+
+			const uint64_t uiScore = static_cast<uint64_t>( box.iRange + 1 ) * box.uiCount;
+
+			if( uiScore > uiBestScore )
+			{
+				pBest = &box;
+				uiBestScore = uiScore;
+			}
+		}
+
+		if( !pBest )
+			break;
+
+		const int iChannel = pBest->iChannel;
+
+		std::sort( cells.begin() + pBest->uiBegin, cells.begin() + pBest->uiEnd, [ = ]( const Cell_t& lhs, const Cell_t& rhs )
+		{
+			return lhs.color[ iChannel ] < rhs.color[ iChannel ];
+		} );
+
+		//Split at the median pixel, keeping at least one cell on each side.
+		uint64_t uiLowerCount = 0;
+
+		size_t uiSplit = pBest->uiBegin;
+
+		while( uiSplit < pBest->uiEnd - 1 && uiLowerCount + cells[ uiSplit ].uiCount <= pBest->uiCount / 2 )
+		{
+			uiLowerCount += cells[ uiSplit ].uiCount;
+			++uiSplit;
+		}
+
+		if( uiSplit == pBest->uiBegin )
+			++uiSplit;
+
+		Box_t upper{ uiSplit, pBest->uiEnd, 0, 0, 0 };
+
+		pBest->uiEnd = uiSplit;
+
+		MeasureBox( cells, *pBest );
+		MeasureBox( cells, upper );
+
+		boxes.push_back( upper );
+	}
+
+	for( size_t uiBox = 0; uiBox < boxes.size(); ++uiBox )
+	{
+		const auto& box = boxes[ uiBox ];
+
+		uint64_t uiSums[ PALETTE_CHANNELS ] = { 0, 0, 0 };
+
+		for( size_t uiCell = box.uiBegin; uiCell < box.uiEnd; ++uiCell )
+		{
+			for( size_t uiChannel = 0; uiChannel < PALETTE_CHANNELS; ++uiChannel )
+			{
+				uiSums[ uiChannel ] += cells[ uiCell ].uiSums[ uiChannel ];
+			}
+		}
+
+		for( size_t uiChannel = 0; uiChannel < PALETTE_CHANNELS; ++uiChannel )
+		{
+			pOutPalette[ uiBox * PALETTE_CHANNELS + uiChannel ] = static_cast<byte>( ( uiSums[ uiChannel ] + box.uiCount / 2 ) / box.uiCount );
+		}
+	}
+
+	return boxes.size();
+}
+
+void DitherImage( const CPaletteMapper& mapper, const byte* const pPalette, const byte* const pRGB, const int iWidth, const int iHeight, byte* const pOut )
+{
+	assert( pPalette );
+	assert( pRGB );
+	assert( pOut );
+
+	if( iWidth <= 0 || iHeight <= 0 )
+		return;
+
+	const size_t uiWidth = static_cast<size_t>( iWidth );
+
+	//Errors are stored in 1/16ths, with a pixel of padding on both sides so the edges need no special cases.
+	std::vector<int> currentErrors( ( uiWidth + 2 ) * PALETTE_CHANNELS, 0 );
+	std::vector<int> nextErrors( ( uiWidth + 2 ) * PALETTE_CHANNELS, 0 );
+
+	for( size_t uiRow = 0; uiRow < static_cast<size_t>( iHeight ); ++uiRow )
+	{
+		std::swap( currentErrors, nextErrors );
+		std::fill( nextErrors.begin(), nextErrors.end(), 0 );
+
+		const byte* pSource = pRGB + uiRow * uiWidth * PALETTE_CHANNELS;
+		byte* pDest = pOut + uiRow * uiWidth;
+
+		for( size_t uiColumn = 0; uiColumn < uiWidth; ++uiColumn, pSource += PALETTE_CHANNELS )
+		{
+			int* const pError = &currentErrors[ ( uiColumn + 1 ) * PALETTE_CHANNELS ];
+
+			byte color[ PALETTE_CHANNELS ];
+
+			for( size_t uiChannel = 0; uiChannel < PALETTE_CHANNELS; ++uiChannel )
+			{
+				color[ uiChannel ] = ClampColor( pSource[ uiChannel ] + pError[ uiChannel ] / 16 );
+			}
+
+			const byte index = mapper.MapColor( color[ 0 ], color[ 1 ], color[ 2 ] );
+
+			pDest[ uiColumn ] = index;
+
+			int* const pNextError = &nextErrors[ ( uiColumn + 1 ) * PALETTE_CHANNELS ];
+
+			for( int iChannel = 0; iChannel < CHANNELS; ++iChannel )
+			{
+				const int iError = color[ iChannel ] - pPalette[ index * CHANNELS + iChannel ];
+
+				pError[ CHANNELS + iChannel ] += iError * 7;
+				pNextError[ iChannel - CHANNELS ] += iError * 3;
+				pNextError[ iChannel ] += iError * 5;
+				pNextError[ CHANNELS + iChannel ] += iError;
+			}
+		}
+	}
+}
+}
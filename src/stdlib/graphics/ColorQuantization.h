@@ -0,0 +1,42 @@
+#ifndef GRAPHICS_COLORQUANTIZATION_H
+#define GRAPHICS_COLORQUANTIZATION_H
+
+#include <cstddef>
+
+#include "shared/Const.h"
+
+/*
+*	Conversion of RGB images to 8 bit paletted images.
+*/
+
+namespace graphics
+{
+class CPaletteMapper;
+
+/**
+*	Builds a palette for an image with median cut. Colors are first binned into RGB555 cells, so the cost of the cut
+*	only depends on the number of distinct cells, not on the number of pixels.
+*	@param pRGB Pixels, 3 bytes each.
+*	@param uiCount Number of pixels.
+*	@param uiMaxColors Most colors the palette can have. At most PALETTE_ENTRIES.
+*	@param pOutPalette Palette. Must be uiMaxColors * PALETTE_CHANNELS bytes. Entries that aren't used are set to black.
+*	@param pAlpha If not null, the alpha of each pixel. Pixels that are less than half opaque are left out.
+*	@return Number of colors in the palette.
+*/
+size_t BuildMedianCutPalette( const byte* const pRGB, const size_t uiCount, const size_t uiMaxColors, byte* const pOutPalette,
+							  const byte* const pAlpha = nullptr );
+
+/**
+*	Maps an image to a palette with Floyd-Steinberg dithering, which spreads the error of each pixel to its neighbors.
+*	Each pixel depends on the ones before it, so this runs on a single thread.
+*	@param mapper Mapper for the palette.
+*	@param pPalette Palette the mapper was built for.
+*	@param pRGB Pixels, 3 bytes each. Rows are tightly packed.
+*	@param iWidth Width of the image.
+*	@param iHeight Height of the image.
+*	@param pOut Palette indices. Must be iWidth * iHeight bytes.
+*/
+void DitherImage( const CPaletteMapper& mapper, const byte* const pPalette, const byte* const pRGB, const int iWidth, const int iHeight, byte* const pOut );
+}
+
+#endif //GRAPHICS_COLORQUANTIZATION_H
@@ -0,0 +1,141 @@
+#include <cstdio>
+
+#include "TextureCompression.h"
+
+#include "DDSFile.h"
+
+namespace graphics
+{
+namespace ddsfile
+{
+namespace
+{
+const uint8_t DDS_MAGIC[] = { 'D', 'D', 'S', ' ' };
+
+/**
+*	Size of the header that follows the magic, and of the pixel format in it.
+*/
+const uint32_t HEADER_SIZE = 124;
+const uint32_t PIXELFORMAT_SIZE = 32;
+
+const uint32_t DDSD_CAPS		= 0x1;
+const uint32_t DDSD_HEIGHT		= 0x2;
+const uint32_t DDSD_WIDTH		= 0x4;
+const uint32_t DDSD_PIXELFORMAT	= 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT	= 0x20000;
+const uint32_t DDSD_LINEARSIZE	= 0x80000;
+
+const uint32_t DDPF_FOURCC		= 0x4;
+
+const uint32_t DDSCAPS_COMPLEX	= 0x8;
+const uint32_t DDSCAPS_TEXTURE	= 0x1000;
+const uint32_t DDSCAPS_MIPMAP	= 0x400000;
+
+/**
+*	Writes 32 bit values in little endian order, which is what DDS uses on every platform.
+*/
+void WriteUInt32( std::vector<uint8_t>& data, const uint32_t value )
+{
+	data.push_back( static_cast<uint8_t>( value & 0xFF ) );
+	data.push_back( static_cast<uint8_t>( ( value >> 8 ) & 0xFF ) );
+	data.push_back( static_cast<uint8_t>( ( value >> 16 ) & 0xFF ) );
+	data.push_back( static_cast<uint8_t>( value >> 24 ) );
+}
+
+void WriteFourCC( std::vector<uint8_t>& data, const char* const pszFourCC )
+{
+	data.insert( data.end(), pszFourCC, pszFourCC + 4 );
+}
+}
+
+bool EncodeDDS( const int iWidth, const int iHeight, const uint8_t* pPixels, const bool bMipmaps, std::vector<uint8_t>& data )
+{
+	data.clear();
+
+	if( iWidth <= 0 || iHeight <= 0 || !pPixels )
+		return false;
+
+	std::vector<std::vector<byte>> levels;
+
+	const BlockFormat format = CompressRGBAMipChain( pPixels, iWidth, iHeight, bMipmaps, levels );
+
+	size_t uiSize = sizeof( DDS_MAGIC ) + HEADER_SIZE;
+
+	for( const auto& level : levels )
+	{
+		uiSize += level.size();
+	}
+
+	//The whole file is built in memory so it can be written with a single call.
+	data.reserve( uiSize );
+
+	data.insert( data.end(), DDS_MAGIC, DDS_MAGIC + sizeof( DDS_MAGIC ) );
+
+	const bool bHasMipmaps = levels.size() > 1;
+
+	WriteUInt32( data, HEADER_SIZE );
+	WriteUInt32( data, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | ( bHasMipmaps ? DDSD_MIPMAPCOUNT : 0 ) );
+	WriteUInt32( data, static_cast<uint32_t>( iHeight ) );
+	WriteUInt32( data, static_cast<uint32_t>( iWidth ) );
+	WriteUInt32( data, static_cast<uint32_t>( levels[ 0 ].size() ) );
+	//Depth.
+	WriteUInt32( data, 0 );
+	WriteUInt32( data, static_cast<uint32_t>( levels.size() ) );
+
+	//Reserved.
+	for( int i = 0; i < 11; ++i )
+	{
+		WriteUInt32( data, 0 );
+	}
+
+	WriteUInt32( data, PIXELFORMAT_SIZE );
+	WriteUInt32( data, DDPF_FOURCC );
+	//BC1 with and without alpha share a FourCC, readers check the color endpoints of each block.
+	WriteFourCC( data, format == BlockFormat::BC3 ? "DXT5" : "DXT1" );
+
+	//Bit count and masks are only used by uncompressed formats.
+	for( int i = 0; i < 5; ++i )
+	{
+		WriteUInt32( data, 0 );
+	}
+
+	WriteUInt32( data, DDSCAPS_TEXTURE | ( bHasMipmaps ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0 ) );
+
+	//Caps 2, 3 and 4, and reserved.
+	for( int i = 0; i < 4; ++i )
+	{
+		WriteUInt32( data, 0 );
+	}
+
+	for( const auto& level : levels )
+	{
+		data.insert( data.end(), level.begin(), level.end() );
+	}
+
+	return true;
+}
+
+bool SaveDDSFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const bool bMipmaps )
+{
+	if( !pszFilename || !( *pszFilename ) )
+		return false;
+
+	std::vector<uint8_t> data;
+
+	if( !EncodeDDS( iWidth, iHeight, pPixels, bMipmaps, data ) )
+		return false;
+
+	FILE* pFile = fopen( pszFilename, "wb" );
+
+	if( !pFile )
+		return false;
+
+	const bool bSuccess = fwrite( data.data(), data.size(), 1, pFile ) == 1;
+
+	if( fclose( pFile ) != 0 )
+		return false;
+
+	return bSuccess;
+}
+}
+}
@@ -0,0 +1,33 @@
+#ifndef GRAPHICS_DDSFILE_H
+#define GRAPHICS_DDSFILE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace graphics
+{
+namespace ddsfile
+{
+/**
+*	Encodes an RGBA image as a DDS file. Opaque images are saved as BC1 (DXT1), images with only fully transparent or opaque pixels
+*	as BC1 with 1 bit alpha and everything else as BC3 (DXT5).
+*	Only uses memory owned by the caller, so this can be called from any thread.
+*	@param iWidth Width of the image.
+*	@param iHeight Height of the image.
+*	@param pPixels RGBA pixels. Must be iWidth * iHeight * 4 bytes in size.
+*	@param bMipmaps Whether to include a full mip chain.
+*	@param data Encoded file. Existing contents are replaced.
+*	@return true on success, false otherwise.
+*/
+bool EncodeDDS( const int iWidth, const int iHeight, const uint8_t* pPixels, const bool bMipmaps, std::vector<uint8_t>& data );
+
+/**
+*	Saves a DDS file.
+*	@param pszFilename Filename to save to.
+*	@see EncodeDDS
+*/
+bool SaveDDSFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const bool bMipmaps = true );
+}
+}
+
+#endif //GRAPHICS_DDSFILE_H
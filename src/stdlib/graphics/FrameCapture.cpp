@@ -0,0 +1,227 @@
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "shared/Logging.h"
+#include "shared/Platform.h"
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
+
+#ifdef HLTOOLS_RENDERDOC
+#ifndef WIN32
+#include <dlfcn.h>
+#endif
+
+#include <renderdoc_app.h>
+#endif
+
+#include "FrameCapture.h"
+
+namespace graphics
+{
+namespace
+{
+unsigned int g_uiFramesToCapture = 0;
+
+#ifdef HLTOOLS_RENDERDOC
+RENDERDOC_API_1_1_2* g_pRenderDoc = nullptr;
+
+bool g_bCapturing = false;
+#endif
+
+#ifdef HLTOOLS_RENDERDOC
+/**
+*	@return RenderDoc's RENDERDOC_GetAPI function, or null if RenderDoc isn't loaded and couldn't be loaded.
+*	The library is never freed, RenderDoc doesn't support being unloaded.
+*/
+pRENDERDOC_GetAPI GetRenderDocAPIFunction()
+{
+	const char* const pszLibrary = getenv( "HLTOOLS_RENDERDOC_LIBRARY" );
+
+#ifdef WIN32
+	HMODULE hModule = GetModuleHandleA( "renderdoc.dll" );
+
+	if( !hModule && pszLibrary && *pszLibrary )
+		hModule = LoadLibraryA( pszLibrary );
+
+	return hModule ? reinterpret_cast<pRENDERDOC_GetAPI>( GetProcAddress( hModule, "RENDERDOC_GetAPI" ) ) : nullptr;
+#else
+	void* hModule = dlopen( "librenderdoc.so", RTLD_NOW | RTLD_NOLOAD );
+
+	if( !hModule && pszLibrary && *pszLibrary )
+		hModule = dlopen( pszLibrary, RTLD_NOW );
+
+	return hModule ? reinterpret_cast<pRENDERDOC_GetAPI>( dlsym( hModule, "RENDERDOC_GetAPI" ) ) : nullptr;
+#endif
+}
+
+/**
+*	@return The filename of the most recent capture, or an empty string if there are no captures.
+*/
+std::vector<char> GetLastCaptureFilename()
+{
+	std::vector<char> filename;
+
+	const uint32_t uiNumCaptures = g_pRenderDoc->GetNumCaptures();
+
+	uint32_t uiLength = 0;
+
+	if( uiNumCaptures == 0 || !g_pRenderDoc->GetCapture( uiNumCaptures - 1, nullptr, &uiLength, nullptr ) )
+	{
+		filename.push_back( '\0' );
+		return filename;
+	}
+
+	filename.resize( uiLength + 1 );
+
+	g_pRenderDoc->GetCapture( uiNumCaptures - 1, filename.data(), &uiLength, nullptr );
+
+	filename.back() = '\0';
+
+	return filename;
+}
+#endif
+
+static cvar::CConCommand r_captureframe( "r_captureframe",
+	[]( const util::CCommand& args )
+	{
+		if( !IsFrameCaptureAvailable() )
+		{
+#ifdef HLTOOLS_RENDERDOC
+			Message( "RenderDoc isn't loaded, run the program from RenderDoc or set HLTOOLS_RENDERDOC_LIBRARY to RenderDoc's library\n" );
+#else
+			Message( "Frame capture was not compiled in, build with HLTOOLS_RENDERDOC\n" );
+#endif
+			return;
+		}
+
+		const int iFrames = args.ArgC() >= 2 ? atoi( args.Arg( 1 ) ) : 1;
+
+		RequestFrameCapture( iFrames > 0 ? static_cast<unsigned int>( iFrames ) : 1 );
+	},
+	cvar::Flag::NONE, "Captures the next frames with RenderDoc, so every GL call they make can be replayed and inspected. Usage: r_captureframe [frames]" );
+
+static cvar::CConCommand r_openlastcapture( "r_openlastcapture",
+	[]( const util::CCommand& )
+	{
+		OpenLastCapture();
+	},
+	cvar::Flag::NONE, "Opens the most recent frame capture in RenderDoc" );
+}
+
+bool InitFrameCapture()
+{
+#ifdef HLTOOLS_RENDERDOC
+	if( g_pRenderDoc )
+		return true;
+
+	const auto pGetAPI = GetRenderDocAPIFunction();
+
+	if( !pGetAPI )
+		return false;
+
+	if( !pGetAPI( eRENDERDOC_API_Version_1_1_2, reinterpret_cast<void**>( &g_pRenderDoc ) ) )
+	{
+		Warning( "RenderDoc is loaded, but doesn't support API version 1.1.2. Frame capture is disabled\n" );
+		g_pRenderDoc = nullptr;
+		return false;
+	}
+
+	//Captures are requested with r_captureframe, the overlay would show up in screenshots.
+	g_pRenderDoc->MaskOverlayBits( eRENDERDOC_Overlay_None, eRENDERDOC_Overlay_None );
+
+	Message( "RenderDoc frame capture is available\n" );
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool IsFrameCaptureAvailable()
+{
+#ifdef HLTOOLS_RENDERDOC
+	return g_pRenderDoc != nullptr;
+#else
+	return false;
+#endif
+}
+
+void RequestFrameCapture( const unsigned int uiFrames )
+{
+	if( !IsFrameCaptureAvailable() )
+		return;
+
+	g_uiFramesToCapture += uiFrames;
+}
+
+void BeginFrameCapture()
+{
+#ifdef HLTOOLS_RENDERDOC
+	if( !g_pRenderDoc || g_bCapturing || g_uiFramesToCapture == 0 )
+		return;
+
+	--g_uiFramesToCapture;
+
+	//Null device and window capture whichever context is current.
+	g_pRenderDoc->StartFrameCapture( nullptr, nullptr );
+
+	g_bCapturing = true;
+#endif
+}
+
+void EndFrameCapture()
+{
+#ifdef HLTOOLS_RENDERDOC
+	if( !g_bCapturing )
+		return;
+
+	g_bCapturing = false;
+
+	if( !g_pRenderDoc->EndFrameCapture( nullptr, nullptr ) )
+	{
+		Error( "RenderDoc failed to capture the frame\n" );
+		return;
+	}
+
+	Message( "Captured frame to \"%s\"\n", GetLastCaptureFilename().data() );
+#endif
+}
+
+bool OpenLastCapture()
+{
+#ifdef HLTOOLS_RENDERDOC
+	if( !g_pRenderDoc )
+	{
+		Message( "RenderDoc isn't loaded\n" );
+		return false;
+	}
+
+	const auto filename = GetLastCaptureFilename();
+
+	if( !filename[ 0 ] )
+	{
+		Message( "No frames have been captured yet, use r_captureframe\n" );
+		return false;
+	}
+
+	//The command line is parsed like a shell would, so the filename is quoted in case it has spaces.
+	const std::string szCommandLine = std::string( "\"" ) + filename.data() + "\"";
+
+	//Connects the replay UI to this process, so more frames can be captured from it.
+	if( !g_pRenderDoc->LaunchReplayUI( 1, szCommandLine.c_str() ) )
+	{
+		Error( "Couldn't launch RenderDoc's replay UI\n" );
+		return false;
+	}
+
+	return true;
+#else
+	Message( "Frame capture was not compiled in, build with HLTOOLS_RENDERDOC\n" );
+	return false;
+#endif
+}
+}
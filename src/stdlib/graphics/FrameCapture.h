@@ -0,0 +1,47 @@
+#ifndef GRAPHICS_FRAMECAPTURE_H
+#define GRAPHICS_FRAMECAPTURE_H
+
+/**
+*	Captures of single frames through RenderDoc's in application API. A capture records every GL call made while drawing the frame,
+*	along with the buffers and textures it uses, and can be replayed and stepped through call by call in RenderDoc.
+*	Requires building with HLTOOLS_RENDERDOC, and running the tool from RenderDoc or with HLTOOLS_RENDERDOC_LIBRARY set to RenderDoc's library.
+*	Frames are captured with r_captureframe, and the last capture is opened with r_openlastcapture.
+*/
+namespace graphics
+{
+/**
+*	Connects to RenderDoc if it's loaded into the process, or loads the library that HLTOOLS_RENDERDOC_LIBRARY names.
+*	Must be called before any GL contexts are created, since RenderDoc can only capture contexts created after it was loaded.
+*	@return Whether frames can be captured.
+*/
+bool InitFrameCapture();
+
+/**
+*	@return Whether frames can be captured.
+*/
+bool IsFrameCaptureAvailable();
+
+/**
+*	Captures the next frames that are drawn.
+*	@param uiFrames Number of frames to capture.
+*/
+void RequestFrameCapture( const unsigned int uiFrames = 1 );
+
+/**
+*	Called by canvases before they draw a frame. Starts capturing if a capture was requested.
+*/
+void BeginFrameCapture();
+
+/**
+*	Called by canvases after they present a frame. Ends the capture started by BeginFrameCapture, if any.
+*/
+void EndFrameCapture();
+
+/**
+*	Opens the most recent capture in RenderDoc's replay UI.
+*	@return Whether the replay UI was launched.
+*/
+bool OpenLastCapture();
+}
+
+#endif //GRAPHICS_FRAMECAPTURE_H
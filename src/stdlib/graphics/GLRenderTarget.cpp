@@ -2,12 +2,7 @@
 
 GLRenderTarget::GLRenderTarget( const bool bCreate )
 {
-	glGenFramebuffers( 1, &m_FrameBuffer );
-
-	glBindFramebuffer( GL_FRAMEBUFFER, m_FrameBuffer );
-
-	glGenTextures( 1, &m_Texture );
-
+	//Creating the objects here made Create return early, so the depth buffer was never created.
 	if( bCreate )
 		Create();
 }
@@ -78,18 +73,18 @@ void GLRenderTarget::Setup( const GLsizei iWidth, const GLsizei iHeight, const b
 
 	glDrawBuffers( 1, &drawBuffer );
 
-	//TODO: depth buffer doesn't work properly at this time.
+	//The stencil buffer is needed to draw mirrored models.
 	if( bUseDepthBuffer )
 	{
 		glBindRenderbuffer( GL_RENDERBUFFER, m_DepthBuffer );
-		glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, iWidth, iHeight );
+		glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, iWidth, iHeight );
 
-		glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer );
+		glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer );
 		glBindRenderbuffer( GL_RENDERBUFFER, 0 );
 	}
 	else
 	{
-		glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0 );
+		glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0 );
 	}
 }
 
@@ -49,7 +49,7 @@ public:
 	*	Sets the render target's dimensions, and sets up the depth buffer.
 	*	@param iWidth Width, in pixels.
 	*	@param iHeight Height, in pixels.
-	*	@param bUseDepthBuffer Whether to use a depth buffer or not.
+	*	@param bUseDepthBuffer Whether to use a depth and stencil buffer or not.
 	*/
 	void Setup( const GLsizei iWidth, const GLsizei iHeight, const bool bUseDepthBuffer );
 
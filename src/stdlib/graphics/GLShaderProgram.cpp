@@ -0,0 +1,417 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+#include <memory>
+#include <vector>
+
+#include "shared/Platform.h"
+#include "shared/Logging.h"
+
+#include "utility/CCommand.h"
+
+#include "cvar/CCVar.h"
+#include "cvar/CConCommand.h"
+
+#include "GLShaderProgram.h"
+
+namespace
+{
+static cvar::CCVar r_programcache( "r_programcache",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to cache linked shader programs on disk so they don't have to be compiled again on the next start" ) );
+
+/**
+*	Directory that cached programs are stored in. Relative to the working directory, like the settings files.
+*/
+const char PROGRAM_CACHE_DIRECTORY[] = "programcache";
+
+const char PROGRAM_CACHE_EXTENSION[] = ".glprogram";
+
+const char PROGRAM_CACHE_MAGIC[ 4 ] = { 'H', 'L', 'P', 'B' };
+
+/**
+*	Must be incremented whenever the layout of cached programs changes.
+*/
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+/**
+*	Layout of a cached program:
+*	ProgramCacheHeader_t
+*	Program binary of uiLength bytes.
+*
+*	Binaries are only valid for the driver that made them, so the driver's vendor, renderer and version strings are part of the key.
+*/
+struct ProgramCacheHeader_t
+{
+	char		szMagic[ 4 ];
+	uint32_t	uiVersion;
+	uint64_t	uiHash;
+
+	/**
+	*	Sizes of the sources that were hashed, to catch hash collisions.
+	*/
+	uint32_t	uiVertexLength;
+	uint32_t	uiFragmentLength;
+
+	uint32_t	uiBinaryFormat;
+	uint32_t	uiLength;
+};
+
+uint64_t HashString( uint64_t uiHash, const char* const pszString )
+{
+	//FNV-1a. The terminator is included so consecutive strings can't run into each other.
+	const char* pszChar = pszString ? pszString : "";
+
+	do
+	{
+		uiHash ^= static_cast<unsigned char>( *pszChar );
+		uiHash *= 0x100000001B3ULL;
+	}
+	while( *pszChar++ );
+
+	return uiHash;
+}
+
+uint64_t HashProgram( const char* const pszVertexShader, const char* const pszFragmentShader )
+{
+	uint64_t uiHash = 0xCBF29CE484222325ULL;
+
+	uiHash = HashString( uiHash, reinterpret_cast<const char*>( glGetString( GL_VENDOR ) ) );
+	uiHash = HashString( uiHash, reinterpret_cast<const char*>( glGetString( GL_RENDERER ) ) );
+	uiHash = HashString( uiHash, reinterpret_cast<const char*>( glGetString( GL_VERSION ) ) );
+	uiHash = HashString( uiHash, pszVertexShader );
+	uiHash = HashString( uiHash, pszFragmentShader );
+
+	return uiHash;
+}
+
+uint32_t GetSourceLength( const char* const pszSource )
+{
+	return pszSource ? static_cast<uint32_t>( strlen( pszSource ) ) : 0;
+}
+
+/**
+*	@return Whether programs can be cached with the current driver.
+*/
+bool CanCachePrograms()
+{
+	if( !r_programcache.GetBool() || !( GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary ) )
+		return false;
+
+	//Drivers can support the extension without supporting any formats.
+	GLint iNumFormats = 0;
+
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &iNumFormats );
+
+	return iNumFormats > 0;
+}
+
+void GetProgramCacheFilename( const uint64_t uiHash, char* pszBuffer, const size_t uiBufferSize )
+{
+	snprintf( pszBuffer, uiBufferSize, "%s/%016" PRIx64 "%s", PROGRAM_CACHE_DIRECTORY, uiHash, PROGRAM_CACHE_EXTENSION );
+}
+
+/**
+*	Loads a cached program binary into the given program.
+*	@return Whether the program was loaded and linked. Binaries made by another driver version fail to link, and are compiled again.
+*/
+bool LoadCachedProgram( const GLuint program, const uint64_t uiHash, const char* const pszVertexShader, const char* const pszFragmentShader )
+{
+	char szFilename[ MAX_PATH_LENGTH ];
+
+	GetProgramCacheFilename( uiHash, szFilename, sizeof( szFilename ) );
+
+	FILE* pFile = fopen( szFilename, "rb" );
+
+	if( !pFile )
+		return false;
+
+	ProgramCacheHeader_t header;
+
+	bool bSuccess = fread( &header, sizeof( header ), 1, pFile ) == 1 &&
+		!memcmp( header.szMagic, PROGRAM_CACHE_MAGIC, sizeof( PROGRAM_CACHE_MAGIC ) ) &&
+		header.uiVersion == PROGRAM_CACHE_VERSION &&
+		header.uiHash == uiHash &&
+		header.uiVertexLength == GetSourceLength( pszVertexShader ) &&
+		header.uiFragmentLength == GetSourceLength( pszFragmentShader ) &&
+		header.uiLength > 0;
+
+	std::vector<unsigned char> binary;
+
+	if( bSuccess )
+	{
+		binary.resize( header.uiLength );
+
+		bSuccess = fread( binary.data(), 1, binary.size(), pFile ) == binary.size();
+	}
+
+	fclose( pFile );
+
+	if( !bSuccess )
+		return false;
+
+	glProgramBinary( program, header.uiBinaryFormat, binary.data(), static_cast<GLsizei>( binary.size() ) );
+
+	GLint iStatus = GL_FALSE;
+
+	glGetProgramiv( program, GL_LINK_STATUS, &iStatus );
+
+	return iStatus == GL_TRUE;
+}
+
+/**
+*	Saves the binary of a linked program to the cache.
+*/
+void SaveCachedProgram( const GLuint program, const uint64_t uiHash, const char* const pszVertexShader, const char* const pszFragmentShader )
+{
+	GLint iLength = 0;
+
+	glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &iLength );
+
+	if( iLength <= 0 )
+		return;
+
+	std::vector<unsigned char> binary( iLength );
+
+	GLenum binaryFormat = 0;
+
+	glGetProgramBinary( program, iLength, &iLength, &binaryFormat, binary.data() );
+
+	if( iLength <= 0 )
+		return;
+
+	ProgramCacheHeader_t header;
+
+	memcpy( header.szMagic, PROGRAM_CACHE_MAGIC, sizeof( PROGRAM_CACHE_MAGIC ) );
+	header.uiVersion = PROGRAM_CACHE_VERSION;
+	header.uiHash = uiHash;
+	header.uiVertexLength = GetSourceLength( pszVertexShader );
+	header.uiFragmentLength = GetSourceLength( pszFragmentShader );
+	header.uiBinaryFormat = binaryFormat;
+	header.uiLength = static_cast<uint32_t>( iLength );
+
+	std::error_code error;
+
+	std::experimental::filesystem::create_directories( PROGRAM_CACHE_DIRECTORY, error );
+
+	if( error )
+	{
+		Warning( "GLShaderProgram: Couldn't create program cache directory \"%s\"\n", PROGRAM_CACHE_DIRECTORY );
+		return;
+	}
+
+	char szFilename[ MAX_PATH_LENGTH ];
+
+	GetProgramCacheFilename( uiHash, szFilename, sizeof( szFilename ) );
+
+	//Written to a temporary file first so a cached program is never seen half written.
+	char szTempFilename[ MAX_PATH_LENGTH ];
+
+	snprintf( szTempFilename, sizeof( szTempFilename ), "%s.tmp", szFilename );
+
+	FILE* pFile = fopen( szTempFilename, "wb" );
+
+	if( !pFile )
+	{
+		Warning( "GLShaderProgram: Couldn't open \"%s\" for writing\n", szTempFilename );
+		return;
+	}
+
+	bool bSuccess =
+		fwrite( &header, sizeof( header ), 1, pFile ) == 1 &&
+		fwrite( binary.data(), 1, header.uiLength, pFile ) == header.uiLength;
+
+	bSuccess = fclose( pFile ) == 0 && bSuccess;
+
+	if( bSuccess )
+	{
+		//Remove the old entry first, rename won't replace existing files on all platforms.
+		std::experimental::filesystem::remove( szFilename, error );
+		std::experimental::filesystem::rename( szTempFilename, szFilename, error );
+
+		bSuccess = !error;
+	}
+
+	if( !bSuccess )
+	{
+		std::experimental::filesystem::remove( szTempFilename, error );
+		Warning( "GLShaderProgram: Couldn't write cached program \"%s\"\n", szFilename );
+	}
+}
+
+static cvar::CConCommand r_programcache_clear( "r_programcache_clear",
+	[]( const util::CCommand& )
+	{
+		namespace fs = std::experimental::filesystem;
+
+		size_t uiRemoved = 0;
+
+		std::error_code error;
+
+		for( fs::directory_iterator it( PROGRAM_CACHE_DIRECTORY, error ), end; !error && it != end; it.increment( error ) )
+		{
+			std::error_code removeError;
+
+			if( it->path().extension() == PROGRAM_CACHE_EXTENSION && fs::remove( it->path(), removeError ) )
+				++uiRemoved;
+		}
+
+		Message( "Removed %u cached programs\n", static_cast<unsigned int>( uiRemoved ) );
+	},
+	cvar::Flag::NONE, "Removes all cached shader programs" );
+
+GLuint CompileShader( const GLenum type, const char* const pszSource )
+{
+	const GLuint shader = glCreateShader( type );
+
+	if( shader == 0 )
+		return 0;
+
+	glShaderSource( shader, 1, &pszSource, nullptr );
+	glCompileShader( shader );
+
+	GLint iStatus = GL_FALSE;
+
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &iStatus );
+
+	if( iStatus != GL_TRUE )
+	{
+		GLint iLength = 0;
+
+		glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &iLength );
+
+		auto log = std::make_unique<char[]>( iLength + 1 );
+
+		glGetShaderInfoLog( shader, iLength + 1, nullptr, log.get() );
+
+		Error( "GLShaderProgram: Error compiling %s shader:\n%s\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment", log.get() );
+
+		glDeleteShader( shader );
+
+		return 0;
+	}
+
+	return shader;
+}
+}
+
+GLShaderProgram::~GLShaderProgram()
+{
+	Destroy();
+}
+
+bool GLShaderProgram::Create( const char* const pszVertexShader, const char* const pszFragmentShader )
+{
+	Destroy();
+
+	if( !GLEW_VERSION_2_0 )
+	{
+		Error( "GLShaderProgram::Create: Shaders are not supported by this OpenGL implementation!\n" );
+		return false;
+	}
+
+	const bool bUseCache = CanCachePrograms();
+
+	const uint64_t uiHash = bUseCache ? HashProgram( pszVertexShader, pszFragmentShader ) : 0;
+
+	if( bUseCache )
+	{
+		m_Program = glCreateProgram();
+
+		if( LoadCachedProgram( m_Program, uiHash, pszVertexShader, pszFragmentShader ) )
+			return true;
+
+		//A failed load can leave the program in an unusable state, so start over with a new one.
+		Destroy();
+	}
+
+	const GLuint vertexShader = pszVertexShader ? CompileShader( GL_VERTEX_SHADER, pszVertexShader ) : 0;
+	const GLuint fragmentShader = pszFragmentShader ? CompileShader( GL_FRAGMENT_SHADER, pszFragmentShader ) : 0;
+
+	bool bSuccess = ( !pszVertexShader || vertexShader != 0 ) && ( !pszFragmentShader || fragmentShader != 0 );
+
+	if( bSuccess )
+	{
+		m_Program = glCreateProgram();
+
+		if( vertexShader != 0 )
+			glAttachShader( m_Program, vertexShader );
+
+		if( fragmentShader != 0 )
+			glAttachShader( m_Program, fragmentShader );
+
+		if( bUseCache )
+			glProgramParameteri( m_Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
+		glLinkProgram( m_Program );
+
+		GLint iStatus = GL_FALSE;
+
+		glGetProgramiv( m_Program, GL_LINK_STATUS, &iStatus );
+
+		if( iStatus != GL_TRUE )
+		{
+			GLint iLength = 0;
+
+			glGetProgramiv( m_Program, GL_INFO_LOG_LENGTH, &iLength );
+
+			auto log = std::make_unique<char[]>( iLength + 1 );
+
+			glGetProgramInfoLog( m_Program, iLength + 1, nullptr, log.get() );
+
+			Error( "GLShaderProgram: Error linking program:\n%s\n", log.get() );
+
+			bSuccess = false;
+		}
+		else if( bUseCache )
+		{
+			SaveCachedProgram( m_Program, uiHash, pszVertexShader, pszFragmentShader );
+		}
+	}
+
+	//The program keeps the shaders alive while they're attached.
+	if( vertexShader != 0 )
+		glDeleteShader( vertexShader );
+
+	if( fragmentShader != 0 )
+		glDeleteShader( fragmentShader );
+
+	if( !bSuccess )
+		Destroy();
+
+	return bSuccess;
+}
+
+void GLShaderProgram::Destroy()
+{
+	if( m_Program != 0 )
+	{
+		glDeleteProgram( m_Program );
+		m_Program = 0;
+	}
+}
+
+void GLShaderProgram::Bind()
+{
+	glUseProgram( m_Program );
+}
+
+void GLShaderProgram::Unbind()
+{
+	glUseProgram( 0 );
+}
+
+GLint GLShaderProgram::GetUniformLocation( const char* const pszName ) const
+{
+	return glGetUniformLocation( m_Program, pszName );
+}
+
+GLint GLShaderProgram::GetAttribLocation( const char* const pszName ) const
+{
+	return glGetAttribLocation( m_Program, pszName );
+}
@@ -0,0 +1,70 @@
+#ifndef GRAPHICS_GLSHADERPROGRAM_H
+#define GRAPHICS_GLSHADERPROGRAM_H
+
+#include "OpenGL.h"
+
+/**
+*	This class represents a GLSL program. Either shader stage may be omitted, in which case the fixed function pipeline is used for that stage.
+*	You must set the context to current yourself.
+*/
+class GLShaderProgram final
+{
+public:
+	GLShaderProgram() = default;
+	~GLShaderProgram();
+
+	/**
+	*	Gets the program ID.
+	*/
+	GLuint GetProgram() const { return m_Program; }
+
+	/**
+	*	Returns whether this program exists.
+	*/
+	bool Exists() const { return m_Program != 0; }
+
+	/**
+	*	Compiles and links the program. Destroys the existing program, if any.
+	*	If the driver supports program binaries, linked programs are cached on disk and loaded from there the next time,
+	*	so the shaders only have to be compiled again when the sources or the driver change.
+	*	Compilation and link errors are logged.
+	*	@param pszVertexShader Vertex shader source. May be null.
+	*	@param pszFragmentShader Fragment shader source. May be null.
+	*	@return true on success, false otherwise.
+	*/
+	bool Create( const char* const pszVertexShader, const char* const pszFragmentShader );
+
+	/**
+	*	Destroys the program if it exists.
+	*/
+	void Destroy();
+
+	/**
+	*	Makes this program current.
+	*/
+	void Bind();
+
+	/**
+	*	Restores the fixed function pipeline.
+	*/
+	void Unbind();
+
+	/**
+	*	Gets the location of a uniform. Returns -1 if the uniform does not exist.
+	*/
+	GLint GetUniformLocation( const char* const pszName ) const;
+
+	/**
+	*	Gets the location of a vertex attribute. Returns -1 if the attribute does not exist.
+	*/
+	GLint GetAttribLocation( const char* const pszName ) const;
+
+private:
+	GLuint m_Program = 0;
+
+private:
+	GLShaderProgram( const GLShaderProgram& ) = delete;
+	GLShaderProgram& operator=( const GLShaderProgram& ) = delete;
+};
+
+#endif //GRAPHICS_GLSHADERPROGRAM_H
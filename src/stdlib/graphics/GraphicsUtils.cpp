@@ -1,15 +1,147 @@
 #include <cassert>
+#include <cstring>
+#include <memory>
 
+#include <glm/geometric.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "shared/Const.h"
 
 #include "shared/studiomodel/studio.h"
 
+#include "PaletteConversion.h"
+
 #include "GraphicsUtils.h"
 
 namespace graphics
 {
+namespace
+{
+/**
+*	Display lists of each kind of scene geometry, or 0 if it hasn't been compiled yet.
+*/
+static GLuint g_SceneGeometryLists[ static_cast<size_t>( SceneGeometry::COUNT ) ] = {};
+
+void CompileSceneGeometry( const SceneGeometry geometry )
+{
+	switch( geometry )
+	{
+	case SceneGeometry::FLOOR_QUAD:
+		{
+			glBegin( GL_TRIANGLE_STRIP );
+			glTexCoord2f( 0.0f, 0.0f );
+			glVertex3f( -1.0f, 1.0f, 0.0f );
+
+			glTexCoord2f( 0.0f, 1.0f );
+			glVertex3f( -1.0f, -1.0f, 0.0f );
+
+			glTexCoord2f( 1.0f, 0.0f );
+			glVertex3f( 1.0f, 1.0f, 0.0f );
+
+			glTexCoord2f( 1.0f, 1.0f );
+			glVertex3f( 1.0f, -1.0f, 0.0f );
+			glEnd();
+
+			break;
+		}
+
+	case SceneGeometry::BACKGROUND:
+		{
+			glDisable( GL_CULL_FACE );
+			glEnable( GL_TEXTURE_2D );
+
+			glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
+			glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+
+			glBegin( GL_TRIANGLE_STRIP );
+
+			glTexCoord2f( 0, 0 );
+			glVertex2f( 0, 0 );
+
+			glTexCoord2f( 1, 0 );
+			glVertex2f( 1, 0 );
+
+			glTexCoord2f( 0, 1 );
+			glVertex2f( 0, 1 );
+
+			glTexCoord2f( 1, 1 );
+			glVertex2f( 1, 1 );
+
+			glEnd();
+
+			break;
+		}
+
+	case SceneGeometry::AXES:
+		{
+			const float flLength = 50.0f;
+
+			glDisable( GL_TEXTURE_2D );
+			glEnable( GL_DEPTH_TEST );
+
+			glLineWidth( 1.0f );
+
+			glBegin( GL_LINES );
+
+			glColor4f( 1.0f, 0.0f, 0.0f, 1.0f );
+			glVertex3f( 0, 0, 0 );
+			glVertex3f( flLength, 0, 0 );
+
+			glColor4f( 0.0f, 1.0f, 0.0f, 1.0f );
+			glVertex3f( 0, 0, 0 );
+			glVertex3f( 0, flLength, 0 );
+
+			glColor4f( 0.0f, 0.0f, 1.0f, 1.0f );
+			glVertex3f( 0, 0, 0 );
+			glVertex3f( 0, 0, flLength );
+
+			glEnd();
+
+			break;
+		}
+
+	default: break;
+	}
+}
+}
+
+void DrawSceneGeometry( const SceneGeometry geometry )
+{
+	assert( geometry >= SceneGeometry::FLOOR_QUAD && geometry < SceneGeometry::COUNT );
+
+	GLuint& list = g_SceneGeometryLists[ static_cast<size_t>( geometry ) ];
+
+	if( list == 0 )
+	{
+		list = glGenLists( 1 );
+
+		//Draw it the slow way if no list could be created.
+		if( list == 0 )
+		{
+			CompileSceneGeometry( geometry );
+			return;
+		}
+
+		glNewList( list, GL_COMPILE );
+		CompileSceneGeometry( geometry );
+		glEndList();
+	}
+
+	glCallList( list );
+}
+
+void FreeSceneGeometry()
+{
+	for( auto& list : g_SceneGeometryLists )
+	{
+		if( list != 0 )
+		{
+			glDeleteLists( list, 1 );
+			list = 0;
+		}
+	}
+}
+
 bool CalculateImageDimensions( const int iWidth, const int iHeight, int& iOutWidth, int& iOutHeight )
 {
 	if( iWidth <= 0 || iHeight <= 0 )
@@ -38,36 +170,44 @@ void Convert8to24Bit( const int iWidth, const int iHeight, const byte* const pDa
 	assert( pPalette );
 	assert( pOutData );
 
-	byte* pOut = pOutData;
+	ExpandIndexedToRGB( pData, static_cast<size_t>( iWidth * iHeight ), pPalette, pOutData );
+}
 
-	for( int y = 0; y < iHeight; ++y )
+void FlipImageVertically( const int iWidth, const int iHeight, byte* const pData )
+{
+	assert( iWidth > 0 );
+	assert( iHeight > 0 );
+	assert( pData );
+
+	const size_t uiRowSize = static_cast<size_t>( iWidth ) * 3;
+
+	std::unique_ptr<byte[]> row = std::make_unique<byte[]>( uiRowSize );
+
+	//Swap whole rows instead of single bytes.
+	for( int y = 0; y < iHeight / 2; ++y )
 	{
-		for( int x = 0; x < iWidth; ++x, pOut += 3 )
-		{
-			pOut[ 0 ] = pPalette[ pData[ x + y * iWidth ] * 3 ];
-			pOut[ 1 ] = pPalette[ pData[ x + y * iWidth ] * 3 + 1 ];
-			pOut[ 2 ] = pPalette[ pData[ x + y * iWidth ] * 3 + 2 ];
-		}
+		byte* const pTop = pData + y * uiRowSize;
+		byte* const pBottom = pData + ( iHeight - y - 1 ) * uiRowSize;
+
+		memcpy( row.get(), pTop, uiRowSize );
+		memcpy( pTop, pBottom, uiRowSize );
+		memcpy( pBottom, row.get(), uiRowSize );
 	}
 }
 
-void FlipImageVertically( const int iWidth, const int iHeight, byte* const pData )
+void FlipImageVertically( const int iWidth, const int iHeight, const byte* const pData, byte* const pOutData )
 {
 	assert( iWidth > 0 );
 	assert( iHeight > 0 );
 	assert( pData );
+	assert( pOutData );
+	assert( pData != pOutData );
 
-	const int iHalfHeight = iHeight / 2;
+	const size_t uiRowSize = static_cast<size_t>( iWidth ) * 3;
 
-	for( int y = iHalfHeight; y < iHeight; ++y )
+	for( int y = 0; y < iHeight; ++y )
 	{
-		for( int x = 0; x < iWidth; ++x )
-		{
-			for( int i = 0; i < 3; ++i )
-			{
-				std::swap( pData[ ( x + y * iWidth ) * 3 + i ], pData[ ( x + ( iHeight - y - 1 ) * iWidth ) * 3 + i ] );
-			}
-		}
+		memcpy( pOutData + y * uiRowSize, pData + ( iHeight - y - 1 ) * uiRowSize, uiRowSize );
 	}
 }
 
@@ -85,29 +225,9 @@ void DrawBackground( GLuint backgroundTexture )
 	glPushMatrix();
 	glLoadIdentity();
 
-	glDisable( GL_CULL_FACE );
-	glEnable( GL_TEXTURE_2D );
-
-	glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
-	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
-
 	glBindTexture( GL_TEXTURE_2D, backgroundTexture );
 
-	glBegin( GL_TRIANGLE_STRIP );
-
-	glTexCoord2f( 0, 0 );
-	glVertex2f( 0, 0 );
-
-	glTexCoord2f( 1, 0 );
-	glVertex2f( 1, 0 );
-
-	glTexCoord2f( 0, 1 );
-	glVertex2f( 0, 1 );
-
-	glTexCoord2f( 1, 1 );
-	glVertex2f( 1, 1 );
-
-	glEnd();
+	DrawSceneGeometry( SceneGeometry::BACKGROUND );
 
 	glPopMatrix();
 
@@ -122,6 +242,59 @@ void SetProjection( const float flFOV, const int iWidth, const int iHeight )
 	gluPerspective( flFOV, ( GLfloat ) iWidth / ( GLfloat ) iHeight, 1.0f, 1 << 24 );
 }
 
+void ExtractFrustumPlanes( const glm::mat4& matViewProjection, glm::vec4 ( &planes )[ FRUSTUM_PLANE_COUNT ] )
+{
+	//Each plane is the last row of the matrix plus or minus one of the other rows. glm matrices are column major.
+	const glm::vec4 row0( matViewProjection[ 0 ][ 0 ], matViewProjection[ 1 ][ 0 ], matViewProjection[ 2 ][ 0 ], matViewProjection[ 3 ][ 0 ] );
+	const glm::vec4 row1( matViewProjection[ 0 ][ 1 ], matViewProjection[ 1 ][ 1 ], matViewProjection[ 2 ][ 1 ], matViewProjection[ 3 ][ 1 ] );
+	const glm::vec4 row2( matViewProjection[ 0 ][ 2 ], matViewProjection[ 1 ][ 2 ], matViewProjection[ 2 ][ 2 ], matViewProjection[ 3 ][ 2 ] );
+	const glm::vec4 row3( matViewProjection[ 0 ][ 3 ], matViewProjection[ 1 ][ 3 ], matViewProjection[ 2 ][ 3 ], matViewProjection[ 3 ][ 3 ] );
+
+	planes[ 0 ] = row3 + row0;
+	planes[ 1 ] = row3 - row0;
+	planes[ 2 ] = row3 + row1;
+	planes[ 3 ] = row3 - row1;
+	planes[ 4 ] = row3 + row2;
+
+	for( auto& plane : planes )
+	{
+		const float flLength = glm::length( glm::vec3( plane ) );
+
+		if( flLength > 0 )
+			plane /= flLength;
+	}
+}
+
+void GetCurrentFrustumPlanes( glm::vec4 ( &planes )[ FRUSTUM_PLANE_COUNT ] )
+{
+	glm::mat4 matProjection;
+	glm::mat4 matModelView;
+
+	glGetFloatv( GL_PROJECTION_MATRIX, glm::value_ptr( matProjection ) );
+	glGetFloatv( GL_MODELVIEW_MATRIX, glm::value_ptr( matModelView ) );
+
+	ExtractFrustumPlanes( matProjection * matModelView, planes );
+}
+
+bool BoxInsidePlanes( const glm::vec3& vecMins, const glm::vec3& vecMaxs, const glm::vec4* pPlanes, const size_t uiPlaneCount )
+{
+	for( size_t uiPlane = 0; uiPlane < uiPlaneCount; ++uiPlane )
+	{
+		const glm::vec4& plane = pPlanes[ uiPlane ];
+
+		//The corner furthest along the plane normal.
+		const glm::vec3 vecCorner(
+			plane.x >= 0 ? vecMaxs.x : vecMins.x,
+			plane.y >= 0 ? vecMaxs.y : vecMins.y,
+			plane.z >= 0 ? vecMaxs.z : vecMins.z );
+
+		if( glm::dot( glm::vec3( plane ), vecCorner ) + plane.w < 0 )
+			return false;
+	}
+
+	return true;
+}
+
 void DrawBox( const glm::vec3* const v )
 {
 	glBegin( GL_QUAD_STRIP );
@@ -2,8 +2,11 @@
 #define GRAPHICS_GRAPHICSUTILS_H
 
 #include <algorithm>
+#include <cstddef>
 
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 
 #include "shared/Const.h"
 
@@ -11,6 +14,12 @@
 
 namespace graphics
 {
+/**
+*	Number of planes in a view frustum. The far plane is left out; views use a far plane so distant that it never culls anything,
+*	and extracting it loses too much precision to be reliable.
+*/
+const size_t FRUSTUM_PLANE_COUNT = 5;
+
 /**
 *	Converts image dimensions to power of 2.
 *	Returns true on success, false otherwise.
@@ -30,6 +39,50 @@ void Convert8to24Bit( const int iWidth, const int iHeight, const byte* const pDa
 */
 void FlipImageVertically( const int iWidth, const int iHeight, byte* const pData );
 
+/**
+*	Copies an image, flipping it vertically. Rows are copied straight to their flipped position,
+*	so an image that's read back into a scratch buffer can be flipped into its destination without an extra pass.
+*	@param iWidth Image width, in pixels.
+*	@param iHeight Image height, in pixels.
+*	@param pData Pixel data, in RGB 24 bit.
+*	@param pOutData Flipped image. Must not overlap pData.
+*/
+void FlipImageVertically( const int iWidth, const int iHeight, const byte* const pData, byte* const pOutData );
+
+/**
+*	Static geometry drawn by the scene helpers every frame.
+*/
+enum class SceneGeometry
+{
+	/**
+	*	Quad from -1 to 1 on the X and Y axes, with texture coordinates.
+	*/
+	FLOOR_QUAD = 0,
+
+	/**
+	*	Quad from 0 to 1 on the X and Y axes, with texture coordinates. Sets up the state to draw a textured background.
+	*/
+	BACKGROUND,
+
+	/**
+	*	The X, Y and Z axes as red, green and blue lines of length 50. Sets up the state to draw them.
+	*/
+	AXES,
+
+	COUNT
+};
+
+/**
+*	Draws static scene geometry. Each piece of geometry is compiled into a display list the first time it's drawn,
+*	so drawing it again only costs a single call.
+*/
+void DrawSceneGeometry( const SceneGeometry geometry );
+
+/**
+*	Deletes the display lists created by DrawSceneGeometry. The context must be current.
+*/
+void FreeSceneGeometry();
+
 /**
 *	Draws a background texture, fitted to the viewport.
 *	@param backgroundTexture OpenGL texture id that represents the background texture
@@ -44,6 +97,27 @@ void DrawBackground( GLuint backgroundTexture );
 */
 void SetProjection( const float flFOV, const int iWidth, const int iHeight );
 
+/**
+*	Extracts the planes of the view frustum described by the given matrix.
+*	Planes are stored as ( normal, distance ), with normals pointing into the frustum.
+*	@param matViewProjection Projection matrix multiplied by the model view matrix.
+*		If this only contains the projection and view, the planes are in world space.
+*	@param planes Output. Left, right, bottom, top and near planes.
+*/
+void ExtractFrustumPlanes( const glm::mat4& matViewProjection, glm::vec4 ( &planes )[ FRUSTUM_PLANE_COUNT ] );
+
+/**
+*	Extracts the planes of the view frustum from the current OpenGL projection and model view matrices.
+*	@see ExtractFrustumPlanes
+*/
+void GetCurrentFrustumPlanes( glm::vec4 ( &planes )[ FRUSTUM_PLANE_COUNT ] );
+
+/**
+*	Tests whether a box is at least partially inside the given planes.
+*	@return false if the box is completely behind any of the planes, true otherwise.
+*/
+bool BoxInsidePlanes( const glm::vec3& vecMins, const glm::vec3& vecMaxs, const glm::vec4* pPlanes, const size_t uiPlaneCount );
+
 /**
 *	Draws a box using an array of 8 vectors as corner points.
 */
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "utility/PlatUtils.h"
+
+#include "ImageResample.h"
+
+namespace graphics
+{
+namespace
+{
+const float PI = 3.14159265358979323846f;
+
+/**
+*	Number of lobes of the Lanczos filter.
+*/
+const float LANCZOS_LOBES = 3;
+
+bool UseSSE2()
+{
+	static const bool bSupported = plat::IsSSE2Supported();
+
+	return bSupported;
+}
+
+/**
+*	Weights of the source pixels that make up each pixel along one axis.
+*	Every output pixel has the same number of taps, unused taps have a weight of 0.
+*/
+struct Kernel_t
+{
+	int iTaps;
+
+	/**
+	*	Source pixel of each tap, clamped to the image.
+	*/
+	std::vector<int> indices;
+
+	std::vector<float> weights;
+};
+
+float Sinc( float flX )
+{
+	if( std::fabs( flX ) < 1e-6f )
+		return 1;
+
+	flX *= PI;
+
+	return std::sin( flX ) / flX;
+}
+
+float EvaluateFilter( const ResampleFilter filter, const float flX )
+{
+	switch( filter )
+	{
+	default:
+	case ResampleFilter::BOX:
+		//Half open, so a source pixel that's exactly between two output pixels only counts for one of them.
+		return flX >= -0.5f && flX < 0.5f ? 1.0f : 0.0f;
+
+	case ResampleFilter::LANCZOS:
+		if( std::fabs( flX ) >= LANCZOS_LOBES )
+			return 0;
+
+		return Sinc( flX ) * Sinc( flX / LANCZOS_LOBES );
+	}
+}
+
+void BuildKernel( const int iSize, const int iOutSize, const ResampleFilter filter, Kernel_t& kernel )
+{
+	const float flScale = static_cast<float>( iSize ) / iOutSize;
+
+	//When shrinking, the filter is stretched so that every source pixel contributes.
+	const float flFilterScale = std::max( flScale, 1.0f );
+
+	const float flRadius = ( filter == ResampleFilter::BOX ? 0.5f : LANCZOS_LOBES ) * flFilterScale;
+
+	kernel.iTaps = static_cast<int>( std::ceil( flRadius * 2 ) ) + 1;
+
+	kernel.indices.assign( iOutSize * kernel.iTaps, 0 );
+	kernel.weights.assign( iOutSize * kernel.iTaps, 0.0f );
+
+	for( int i = 0; i < iOutSize; ++i )
+	{
+		//Pixel centers are at integer coordinates.
+		const float flCenter = ( i + 0.5f ) * flScale - 0.5f;
+
+		const int iFirst = static_cast<int>( std::ceil( flCenter - flRadius ) );
+
+		int* const pIndices = &kernel.indices[ i * kernel.iTaps ];
+		float* const pWeights = &kernel.weights[ i * kernel.iTaps ];
+
+		float flTotal = 0;
+
+		for( int iTap = 0; iTap < kernel.iTaps; ++iTap )
+		{
+			const int iSource = iFirst + iTap;
+
+			pIndices[ iTap ] = std::min( std::max( iSource, 0 ), iSize - 1 );
+			pWeights[ iTap ] = EvaluateFilter( filter, ( iSource - flCenter ) / flFilterScale );
+
+			flTotal += pWeights[ iTap ];
+		}
+
+		if( flTotal != 0 )
+		{
+			for( int iTap = 0; iTap < kernel.iTaps; ++iTap )
+			{
+				pWeights[ iTap ] /= flTotal;
+			}
+		}
+		else
+		{
+			//Can't happen with the filters above, but use the nearest pixel rather than making it black.
+			pIndices[ 0 ] = std::min( std::max( static_cast<int>( flCenter + 0.5f ), 0 ), iSize - 1 );
+			pWeights[ 0 ] = 1;
+		}
+	}
+}
+
+/**
+*	Converts a row to floating point, with colors multiplied by alpha.
+*/
+void PremultiplyRow( const byte* pIn, const int iWidth, float* pOut )
+{
+	for( int x = 0; x < iWidth; ++x, pIn += 4, pOut += 4 )
+	{
+		const float flAlpha = pIn[ 3 ] / 255.0f;
+
+		pOut[ 0 ] = pIn[ 0 ] * flAlpha;
+		pOut[ 1 ] = pIn[ 1 ] * flAlpha;
+		pOut[ 2 ] = pIn[ 2 ] * flAlpha;
+		pOut[ 3 ] = pIn[ 3 ];
+	}
+}
+
+/**
+*	Converts a filtered row back to bytes, dividing colors by alpha again.
+*/
+void FinishRow( const float* pIn, const int iWidth, const bool bBinaryAlpha, byte* pOut )
+{
+	for( int x = 0; x < iWidth; ++x, pIn += 4, pOut += 4 )
+	{
+		const float flAlpha = pIn[ 3 ];
+
+		int iAlpha = static_cast<int>( flAlpha + 0.5f );
+
+		if( bBinaryAlpha )
+			iAlpha = iAlpha >= 128 ? 255 : 0;
+
+		pOut[ 3 ] = static_cast<byte>( std::min( std::max( iAlpha, 0 ), 255 ) );
+
+		if( flAlpha < 0.5f || pOut[ 3 ] == 0 )
+		{
+			pOut[ 0 ] = pOut[ 1 ] = pOut[ 2 ] = 0;
+			continue;
+		}
+
+		const float flScale = 255.0f / flAlpha;
+
+		for( int c = 0; c < 3; ++c )
+		{
+			pOut[ c ] = static_cast<byte>( std::min( std::max( static_cast<int>( pIn[ c ] * flScale + 0.5f ), 0 ), 255 ) );
+		}
+	}
+}
+
+void FilterRow( const float* pRow, const Kernel_t& kernel, const int iOutWidth, float* pOut )
+{
+	const int* pIndices = kernel.indices.data();
+	const float* pWeights = kernel.weights.data();
+
+	for( int x = 0; x < iOutWidth; ++x, pOut += 4 )
+	{
+		float flSums[ 4 ] = { 0, 0, 0, 0 };
+
+		for( int iTap = 0; iTap < kernel.iTaps; ++iTap, ++pIndices, ++pWeights )
+		{
+			const float* pPixel = pRow + *pIndices * 4;
+
+			for( int c = 0; c < 4; ++c )
+			{
+				flSums[ c ] += *pWeights * pPixel[ c ];
+			}
+		}
+
+		memcpy( pOut, flSums, sizeof( flSums ) );
+	}
+}
+
+/**
+*	Same as FilterRow, but each pixel is a single vector.
+*/
+SSE2_TARGET void FilterRowSSE2( const float* pRow, const Kernel_t& kernel, const int iOutWidth, float* pOut )
+{
+	const int* pIndices = kernel.indices.data();
+	const float* pWeights = kernel.weights.data();
+
+	for( int x = 0; x < iOutWidth; ++x, pOut += 4 )
+	{
+		__m128 sum = _mm_setzero_ps();
+
+		for( int iTap = 0; iTap < kernel.iTaps; ++iTap, ++pIndices, ++pWeights )
+		{
+			sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( *pWeights ), _mm_loadu_ps( pRow + *pIndices * 4 ) ) );
+		}
+
+		_mm_storeu_ps( pOut, sum );
+	}
+}
+
+void AccumulateRow( const float* pRow, const float flWeight, const size_t uiCount, float* pSums )
+{
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		pSums[ uiIndex ] += flWeight * pRow[ uiIndex ];
+	}
+}
+
+/**
+*	Same as AccumulateRow, 4 floats at a time. uiCount must be a multiple of 4.
+*/
+SSE2_TARGET void AccumulateRowSSE2( const float* pRow, const float flWeight, const size_t uiCount, float* pSums )
+{
+	const __m128 weight = _mm_set1_ps( flWeight );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; uiIndex += 4 )
+	{
+		_mm_storeu_ps( pSums + uiIndex, _mm_add_ps( _mm_loadu_ps( pSums + uiIndex ), _mm_mul_ps( weight, _mm_loadu_ps( pRow + uiIndex ) ) ) );
+	}
+}
+}
+
+void ResampleRGBA( const byte* pIn, const int iWidth, const int iHeight, byte* pOut, const int iOutWidth, const int iOutHeight,
+				   const ResampleFilter filter, const bool bBinaryAlpha )
+{
+	assert( pIn );
+	assert( pOut );
+	assert( iWidth > 0 && iHeight > 0 );
+	assert( iOutWidth > 0 && iOutHeight > 0 );
+
+	const bool bUseSSE2 = UseSSE2();
+
+	Kernel_t horizontal;
+	Kernel_t vertical;
+
+	BuildKernel( iWidth, iOutWidth, filter, horizontal );
+	BuildKernel( iHeight, iOutHeight, filter, vertical );
+
+	const size_t uiOutRowSize = static_cast<size_t>( iOutWidth ) * 4;
+
+	//Source rows filtered horizontally, so the vertical pass only has to combine whole rows.
+	std::vector<float> filtered( uiOutRowSize * iHeight );
+	std::vector<float> row( static_cast<size_t>( iWidth ) * 4 );
+
+	for( int y = 0; y < iHeight; ++y )
+	{
+		PremultiplyRow( pIn + static_cast<size_t>( y ) * iWidth * 4, iWidth, row.data() );
+
+		float* const pFiltered = filtered.data() + y * uiOutRowSize;
+
+		if( bUseSSE2 )
+			FilterRowSSE2( row.data(), horizontal, iOutWidth, pFiltered );
+		else
+			FilterRow( row.data(), horizontal, iOutWidth, pFiltered );
+	}
+
+	std::vector<float> sums( uiOutRowSize );
+
+	for( int y = 0; y < iOutHeight; ++y )
+	{
+		std::fill( sums.begin(), sums.end(), 0.0f );
+
+		for( int iTap = 0; iTap < vertical.iTaps; ++iTap )
+		{
+			const float flWeight = vertical.weights[ y * vertical.iTaps + iTap ];
+
+			if( flWeight == 0 )
+				continue;
+
+			const float* const pRow = filtered.data() + vertical.indices[ y * vertical.iTaps + iTap ] * uiOutRowSize;
+
+			if( bUseSSE2 )
+				AccumulateRowSSE2( pRow, flWeight, uiOutRowSize, sums.data() );
+			else
+				AccumulateRow( pRow, flWeight, uiOutRowSize, sums.data() );
+		}
+
+		FinishRow( sums.data(), iOutWidth, bBinaryAlpha, pOut + y * uiOutRowSize );
+	}
+}
+}
@@ -0,0 +1,41 @@
+#ifndef GRAPHICS_IMAGERESAMPLE_H
+#define GRAPHICS_IMAGERESAMPLE_H
+
+#include "shared/Const.h"
+
+/*
+*	Resizing of RGBA images. Images are filtered in two separable passes, using SSE2 if the CPU supports it.
+*	Colors are weighted by their alpha, so transparent pixels don't bleed into the pixels around them.
+*/
+
+namespace graphics
+{
+enum class ResampleFilter
+{
+	/**
+	*	Averages the pixels that each output pixel covers. Best for halving images, like when building mipmaps.
+	*/
+	BOX,
+
+	/**
+	*	Lanczos filter with 3 lobes. Keeps images sharp when they're scaled by factors other than 2.
+	*/
+	LANCZOS
+};
+
+/**
+*	Resizes an RGBA image.
+*	@param pIn Image to resize. Rows are tightly packed.
+*	@param iWidth Width of the image.
+*	@param iHeight Height of the image.
+*	@param pOut Resized image. Must be iOutWidth * iOutHeight * 4 bytes.
+*	@param iOutWidth Width of the resized image.
+*	@param iOutHeight Height of the resized image.
+*	@param filter Filter to use.
+*	@param bBinaryAlpha Whether to round alpha to 0 or 255, like it is in masked textures. Transparent pixels are made black.
+*/
+void ResampleRGBA( const byte* pIn, const int iWidth, const int iHeight, byte* pOut, const int iOutWidth, const int iOutHeight,
+				   const ResampleFilter filter, const bool bBinaryAlpha );
+}
+
+#endif //GRAPHICS_IMAGERESAMPLE_H
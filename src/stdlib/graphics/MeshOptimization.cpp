@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#include "MeshOptimization.h"
+
+namespace graphics
+{
+namespace
+{
+/**
+*	Size of the LRU cache that the optimizer models. Larger than real caches, which makes the result work well on most hardware.
+*/
+const size_t FORSYTH_CACHE_SIZE = 32;
+
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+const uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+/**
+*	Scores a vertex based on its position in the cache and the number of triangles that still use it.
+*	Vertices that were used by the last triangle get a fixed score so that triangle's neighbors don't all get picked first.
+*	Vertices with few triangles left are boosted so they can leave the cache sooner.
+*/
+float VertexScore( const int iCachePosition, const uint32_t uiRemainingTris )
+{
+	if( uiRemainingTris == 0 )
+		return -1.0f;
+
+	float flScore = 0;
+
+	if( iCachePosition >= 0 )
+	{
+		if( iCachePosition < 3 )
+		{
+			flScore = FORSYTH_LAST_TRI_SCORE;
+		}
+		else
+		{
+			const float flScale = 1.0f / ( FORSYTH_CACHE_SIZE - 3 );
+
+			flScore = std::pow( 1.0f - ( iCachePosition - 3 ) * flScale, FORSYTH_CACHE_DECAY_POWER );
+		}
+	}
+
+	flScore += FORSYTH_VALENCE_BOOST_SCALE * std::pow( static_cast<float>( uiRemainingTris ), -FORSYTH_VALENCE_BOOST_POWER );
+
+	return flScore;
+}
+}
+
+void OptimizeVertexCache( uint32_t* const pIndices, const size_t uiNumIndices, const size_t uiNumVertices )
+{
+	assert( pIndices || uiNumIndices == 0 );
+	assert( uiNumIndices % 3 == 0 );
+
+	const size_t uiNumTris = uiNumIndices / 3;
+
+	if( uiNumTris < 2 )
+		return;
+
+	//Triangles that use each vertex. The first uiRemainingTris[ vertex ] entries of each list haven't been added yet.
+	std::vector<uint32_t> remainingTris( uiNumVertices, 0 );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumIndices; ++uiIndex )
+	{
+		assert( pIndices[ uiIndex ] < uiNumVertices );
+		++remainingTris[ pIndices[ uiIndex ] ];
+	}
+
+	std::vector<uint32_t> triOffsets( uiNumVertices + 1, 0 );
+
+	for( size_t uiVertex = 0; uiVertex < uiNumVertices; ++uiVertex )
+	{
+		triOffsets[ uiVertex + 1 ] = triOffsets[ uiVertex ] + remainingTris[ uiVertex ];
+	}
+
+	std::vector<uint32_t> vertexTris( uiNumIndices );
+
+	{
+		std::vector<uint32_t> cursors( triOffsets.begin(), triOffsets.end() - 1 );
+
+		for( size_t uiIndex = 0; uiIndex < uiNumIndices; ++uiIndex )
+		{
+			vertexTris[ cursors[ pIndices[ uiIndex ] ]++ ] = static_cast<uint32_t>( uiIndex / 3 );
+		}
+	}
+
+	std::vector<int> cachePositions( uiNumVertices, -1 );
+	std::vector<float> vertexScores( uiNumVertices );
+
+	for( size_t uiVertex = 0; uiVertex < uiNumVertices; ++uiVertex )
+	{
+		vertexScores[ uiVertex ] = VertexScore( -1, remainingTris[ uiVertex ] );
+	}
+
+	std::vector<float> triScores( uiNumTris );
+	std::vector<bool> added( uiNumTris, false );
+
+	auto scoreTri = [ & ]( const size_t uiTri )
+	{
+		const uint32_t* const pTri = pIndices + uiTri * 3;
+
+		return vertexScores[ pTri[ 0 ] ] + vertexScores[ pTri[ 1 ] ] + vertexScores[ pTri[ 2 ] ];
+	};
+
+	for( size_t uiTri = 0; uiTri < uiNumTris; ++uiTri )
+	{
+		triScores[ uiTri ] = scoreTri( uiTri );
+	}
+
+	std::vector<uint32_t> output;
+
+	output.reserve( uiNumIndices );
+
+	uint32_t cache[ FORSYTH_CACHE_SIZE ];
+	size_t uiCacheCount = 0;
+
+	size_t uiBestTri = INVALID_INDEX;
+
+	//Triangles before this have all been added, so searches for the next isolated triangle start here.
+	size_t uiFirstRemaining = 0;
+
+	for( size_t uiAdded = 0; uiAdded < uiNumTris; ++uiAdded )
+	{
+		if( uiBestTri == INVALID_INDEX )
+		{
+			//Nothing in the cache has triangles left, so pick the best of all remaining triangles.
+			while( added[ uiFirstRemaining ] )
+				++uiFirstRemaining;
+
+			uiBestTri = uiFirstRemaining;
+
+			for( size_t uiTri = uiFirstRemaining + 1; uiTri < uiNumTris; ++uiTri )
+			{
+				if( !added[ uiTri ] && triScores[ uiTri ] > triScores[ uiBestTri ] )
+					uiBestTri = uiTri;
+			}
+		}
+
+		const uint32_t* const pTri = pIndices + uiBestTri * 3;
+
+		output.insert( output.end(), pTri, pTri + 3 );
+
+		added[ uiBestTri ] = true;
+
+		//Remove the triangle from its vertices' lists.
+		for( size_t uiCorner = 0; uiCorner < 3; ++uiCorner )
+		{
+			const uint32_t uiVertex = pTri[ uiCorner ];
+
+			uint32_t* const pList = vertexTris.data() + triOffsets[ uiVertex ];
+
+			uint32_t& uiRemaining = remainingTris[ uiVertex ];
+
+			for( uint32_t uiEntry = 0; uiEntry < uiRemaining; ++uiEntry )
+			{
+				if( pList[ uiEntry ] == uiBestTri )
+				{
+					std::swap( pList[ uiEntry ], pList[ uiRemaining - 1 ] );
+					--uiRemaining;
+					break;
+				}
+			}
+		}
+
+		//Move the triangle's vertices to the front of the cache. Degenerate triangles can use a vertex more than once.
+		uint32_t newCache[ FORSYTH_CACHE_SIZE + 3 ];
+		size_t uiNewCount = 0;
+
+		auto addToCache = [ & ]( const uint32_t uiVertex )
+		{
+			if( std::find( newCache, newCache + uiNewCount, uiVertex ) == newCache + uiNewCount )
+				newCache[ uiNewCount++ ] = uiVertex;
+		};
+
+		for( size_t uiCorner = 0; uiCorner < 3; ++uiCorner )
+		{
+			addToCache( pTri[ uiCorner ] );
+		}
+
+		for( size_t uiEntry = 0; uiEntry < uiCacheCount; ++uiEntry )
+		{
+			addToCache( cache[ uiEntry ] );
+		}
+
+		//Rescore everything that was in the cache, including vertices that just dropped out of it,
+		//and pick the best triangle that uses a cached vertex.
+		for( size_t uiEntry = 0; uiEntry < uiNewCount; ++uiEntry )
+		{
+			const uint32_t uiVertex = newCache[ uiEntry ];
+
+			cachePositions[ uiVertex ] = uiEntry < FORSYTH_CACHE_SIZE ? static_cast<int>( uiEntry ) : -1;
+			vertexScores[ uiVertex ] = VertexScore( cachePositions[ uiVertex ], remainingTris[ uiVertex ] );
+		}
+
+		uiBestTri = INVALID_INDEX;
+		float flBestScore = -1;
+
+		for( size_t uiEntry = 0; uiEntry < uiNewCount; ++uiEntry )
+		{
+			const uint32_t uiVertex = newCache[ uiEntry ];
+
+			const uint32_t* const pList = vertexTris.data() + triOffsets[ uiVertex ];
+
+			for( uint32_t uiTriEntry = 0; uiTriEntry < remainingTris[ uiVertex ]; ++uiTriEntry )
+			{
+				const uint32_t uiTri = pList[ uiTriEntry ];
+
+				const float flScore = triScores[ uiTri ] = scoreTri( uiTri );
+
+				if( uiEntry < FORSYTH_CACHE_SIZE && flScore > flBestScore )
+				{
+					flBestScore = flScore;
+					uiBestTri = uiTri;
+				}
+			}
+		}
+
+		uiCacheCount = std::min( uiNewCount, FORSYTH_CACHE_SIZE );
+
+		std::copy( newCache, newCache + uiCacheCount, cache );
+	}
+
+	std::copy( output.begin(), output.end(), pIndices );
+}
+
+void OptimizeVertexFetch( uint32_t* const pIndices, const size_t uiNumIndices, const size_t uiNumVertices, uint32_t* const pRemap )
+{
+	std::fill( pRemap, pRemap + uiNumVertices, INVALID_INDEX );
+
+	uint32_t uiNext = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiNumIndices; ++uiIndex )
+	{
+		uint32_t& uiRemapped = pRemap[ pIndices[ uiIndex ] ];
+
+		if( uiRemapped == INVALID_INDEX )
+			uiRemapped = uiNext++;
+
+		pIndices[ uiIndex ] = uiRemapped;
+	}
+
+	for( size_t uiVertex = 0; uiVertex < uiNumVertices; ++uiVertex )
+	{
+		if( pRemap[ uiVertex ] == INVALID_INDEX )
+			pRemap[ uiVertex ] = uiNext++;
+	}
+}
+
+size_t SimplifyByClustering( const uint32_t* const pIndices, const size_t uiNumIndices,
+							 const glm::vec3* const pPositions, const uint32_t* const pGroups, const size_t uiNumVertices,
+							 const float flCellSize, uint32_t* const pOutIndices )
+{
+	assert( uiNumIndices % 3 == 0 );
+	assert( flCellSize > 0 );
+
+	//Cells are keyed on the group and the cell coordinates, 16 bits each. Far apart cells that wrap onto the same key can only merge vertices that are in the same group.
+	auto cellKey = [ & ]( const size_t uiVertex )
+	{
+		const glm::vec3 vecCell = pPositions[ uiVertex ] / flCellSize;
+
+		return
+			( static_cast<uint64_t>( static_cast<uint16_t>( pGroups[ uiVertex ] ) ) << 48 ) |
+			( static_cast<uint64_t>( static_cast<uint16_t>( static_cast<int>( std::floor( vecCell.x ) ) ) ) << 32 ) |
+			( static_cast<uint64_t>( static_cast<uint16_t>( static_cast<int>( std::floor( vecCell.y ) ) ) ) << 16 ) |
+			static_cast<uint64_t>( static_cast<uint16_t>( static_cast<int>( std::floor( vecCell.z ) ) ) );
+	};
+
+	std::unordered_map<uint64_t, uint32_t> cells;
+
+	std::vector<uint32_t> clusters( uiNumVertices );
+	std::vector<glm::vec3> sums;
+	std::vector<uint32_t> counts;
+
+	for( size_t uiVertex = 0; uiVertex < uiNumVertices; ++uiVertex )
+	{
+		auto result = cells.emplace( cellKey( uiVertex ), static_cast<uint32_t>( sums.size() ) );
+
+		if( result.second )
+		{
+			sums.emplace_back( 0 );
+			counts.push_back( 0 );
+		}
+
+		const uint32_t uiCluster = result.first->second;
+
+		clusters[ uiVertex ] = uiCluster;
+		sums[ uiCluster ] += pPositions[ uiVertex ];
+		++counts[ uiCluster ];
+	}
+
+	std::vector<uint32_t> representatives( sums.size(), INVALID_INDEX );
+	std::vector<float> distances( sums.size(), std::numeric_limits<float>::max() );
+
+	for( size_t uiVertex = 0; uiVertex < uiNumVertices; ++uiVertex )
+	{
+		const uint32_t uiCluster = clusters[ uiVertex ];
+
+		const glm::vec3 vecDelta = pPositions[ uiVertex ] - sums[ uiCluster ] / static_cast<float>( counts[ uiCluster ] );
+
+		const float flDistance = glm::dot( vecDelta, vecDelta );
+
+		if( flDistance < distances[ uiCluster ] )
+		{
+			distances[ uiCluster ] = flDistance;
+			representatives[ uiCluster ] = static_cast<uint32_t>( uiVertex );
+		}
+	}
+
+	//Triangles are rotated so their smallest index comes first, which keeps the winding. Indices are packed into 21 bits each.
+	const bool bRemoveDuplicates = uiNumVertices <= ( 1 << 21 );
+
+	std::unordered_set<uint64_t> triangles;
+
+	size_t uiOutCount = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiNumIndices; uiIndex += 3 )
+	{
+		uint32_t tri[ 3 ];
+
+		for( size_t uiCorner = 0; uiCorner < 3; ++uiCorner )
+		{
+			tri[ uiCorner ] = representatives[ clusters[ pIndices[ uiIndex + uiCorner ] ] ];
+		}
+
+		if( tri[ 0 ] == tri[ 1 ] || tri[ 1 ] == tri[ 2 ] || tri[ 0 ] == tri[ 2 ] )
+			continue;
+
+		if( bRemoveDuplicates )
+		{
+			std::rotate( tri, std::min_element( tri, tri + 3 ), tri + 3 );
+
+			const uint64_t uiKey = ( static_cast<uint64_t>( tri[ 0 ] ) << 42 ) | ( static_cast<uint64_t>( tri[ 1 ] ) << 21 ) | tri[ 2 ];
+
+			if( !triangles.insert( uiKey ).second )
+				continue;
+		}
+
+		std::copy( tri, tri + 3, pOutIndices + uiOutCount );
+		uiOutCount += 3;
+	}
+
+	OptimizeVertexCache( pOutIndices, uiOutCount, uiNumVertices );
+
+	return uiOutCount;
+}
+
+float CalculateACMR( const uint32_t* const pIndices, const size_t uiNumIndices, const size_t uiNumVertices, const size_t uiCacheSize )
+{
+	if( uiNumIndices < 3 )
+		return 0;
+
+	//Time at which each vertex was last added to the cache. A vertex is still cached if fewer than uiCacheSize vertices were added since then.
+	std::vector<size_t> addedTimes( uiNumVertices, 0 );
+
+	size_t uiTime = uiCacheSize + 1;
+	size_t uiMisses = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiNumIndices; ++uiIndex )
+	{
+		size_t& uiAddedTime = addedTimes[ pIndices[ uiIndex ] ];
+
+		if( uiTime - uiAddedTime > uiCacheSize )
+		{
+			uiAddedTime = uiTime++;
+			++uiMisses;
+		}
+	}
+
+	return static_cast<float>( uiMisses ) / ( uiNumIndices / 3 );
+}
+}
@@ -0,0 +1,70 @@
+#ifndef GRAPHICS_MESHOPTIMIZATION_H
+#define GRAPHICS_MESHOPTIMIZATION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+/*
+*	Optimization of indexed triangle lists for the GPU's vertex caches.
+*	None of these use GL, so they can be called from any thread.
+*/
+
+namespace graphics
+{
+/**
+*	Size of the FIFO cache that ACMR is measured with. Most hardware has at least this many post-transform cache entries.
+*/
+const size_t ACMR_CACHE_SIZE = 16;
+
+/**
+*	Reorders triangles so that vertices are reused while they're still in the post-transform cache, using Tom Forsyth's
+*	linear-speed vertex cache optimization. Vertices are not moved.
+*	@param pIndices Triangle list to reorder, in place.
+*	@param uiNumIndices Number of indices. Must be a multiple of 3.
+*	@param uiNumVertices Number of vertices that are referenced. All indices must be smaller than this.
+*/
+void OptimizeVertexCache( uint32_t* const pIndices, const size_t uiNumIndices, const size_t uiNumVertices );
+
+/**
+*	Computes the order that vertices should be stored in so they're fetched from memory in the order they're first used,
+*	and changes the indices to refer to the reordered vertices. Should be done after OptimizeVertexCache.
+*	@param pIndices Triangle list to remap, in place.
+*	@param uiNumIndices Number of indices.
+*	@param uiNumVertices Number of vertices that are referenced. All indices must be smaller than this.
+*	@param pRemap For each vertex, its new index. Vertices that aren't used are moved to the end. Must be uiNumVertices entries.
+*/
+void OptimizeVertexFetch( uint32_t* const pIndices, const size_t uiNumIndices, const size_t uiNumVertices, uint32_t* const pRemap );
+
+/**
+*	Simplifies a triangle list by merging vertices that fall in the same cell of a uniform grid.
+*	Each cluster is represented by its existing vertex closest to the cluster's average position, so the simplified list uses a subset of the original vertices
+*	and can share their buffer. Vertices are only merged with vertices in the same group, which keeps attributes that can't be blended, like bone assignments.
+*	Triangles that collapse, and triangles that end up identical to another one, are removed. The result is optimized for the vertex cache.
+*	@param pIndices Triangle list to simplify.
+*	@param uiNumIndices Number of indices. Must be a multiple of 3.
+*	@param pPositions Position of each vertex.
+*	@param pGroups Group of each vertex.
+*	@param uiNumVertices Number of vertices. All indices must be smaller than this.
+*	@param flCellSize Size of the grid's cells. Larger cells remove more triangles.
+*	@param pOutIndices Simplified triangle list. Must have room for uiNumIndices indices.
+*	@return Number of indices in the simplified triangle list.
+*/
+size_t SimplifyByClustering( const uint32_t* const pIndices, const size_t uiNumIndices,
+							 const glm::vec3* const pPositions, const uint32_t* const pGroups, const size_t uiNumVertices,
+							 const float flCellSize, uint32_t* const pOutIndices );
+
+/**
+*	Calculates the average cache miss ratio of a triangle list: the number of vertices that are transformed per triangle,
+*	using a FIFO cache. 3 is the worst case, 0.5 is the best a regular grid can get.
+*	@param pIndices Triangle list.
+*	@param uiNumIndices Number of indices.
+*	@param uiNumVertices Number of vertices that are referenced. All indices must be smaller than this.
+*	@param uiCacheSize Number of entries in the simulated cache.
+*	@return The average cache miss ratio, or 0 if there are no triangles.
+*/
+float CalculateACMR( const uint32_t* const pIndices, const size_t uiNumIndices, const size_t uiNumVertices, const size_t uiCacheSize = ACMR_CACHE_SIZE );
+}
+
+#endif //GRAPHICS_MESHOPTIMIZATION_H
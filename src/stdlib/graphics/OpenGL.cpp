@@ -1,7 +1,80 @@
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
 #include "shared/Logging.h"
+#include "shared/Profiler.h"
+
+#include "cvar/CCVar.h"
 
 #include "OpenGL.h"
 
+namespace
+{
+static cvar::CCVar r_gldebug( "r_gldebug",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to log performance warnings reported by the OpenGL driver. Takes effect on restart" ) );
+
+/**
+*	Each message is logged at most once in this interval. Drivers tend to report the same problem every time it happens.
+*/
+const std::chrono::seconds DEBUG_MESSAGE_INTERVAL( 5 );
+
+struct DebugMessageState_t
+{
+	std::chrono::steady_clock::time_point lastLogged;
+	unsigned int uiSuppressed = 0;
+};
+
+std::mutex g_DebugMessageMutex;
+
+/**
+*	Keyed by message id.
+*/
+std::unordered_map<GLuint, DebugMessageState_t> g_DebugMessages;
+
+void APIENTRY DebugMessageCallback( GLenum, GLenum type, GLuint id, GLenum, GLsizei length, const GLchar* message, const void* )
+{
+	if( type != GL_DEBUG_TYPE_PERFORMANCE )
+		return;
+
+	//Called from a driver thread unless output is synchronous.
+	PROFILE_COUNT( "GL performance warnings", 1 );
+
+	const auto now = std::chrono::steady_clock::now();
+
+	unsigned int uiSuppressed;
+
+	{
+		std::lock_guard<std::mutex> lock( g_DebugMessageMutex );
+
+		auto result = g_DebugMessages.emplace( id, DebugMessageState_t() );
+
+		DebugMessageState_t& state = result.first->second;
+
+		if( !result.second && now - state.lastLogged < DEBUG_MESSAGE_INTERVAL )
+		{
+			++state.uiSuppressed;
+			return;
+		}
+
+		state.lastLogged = now;
+
+		uiSuppressed = state.uiSuppressed;
+		state.uiSuppressed = 0;
+	}
+
+	if( uiSuppressed > 0 )
+		Warning( "OpenGL performance warning %u: %.*s (repeated %u times)\n", id, static_cast<int>( length ), message, uiSuppressed );
+	else
+		Warning( "OpenGL performance warning %u: %.*s\n", id, static_cast<int>( length ), message );
+}
+}
+
 bool CBaseOpenGL::PostInitialize()
 {
 	if( IsPostInitialized() )
@@ -18,10 +91,30 @@ bool CBaseOpenGL::PostInitialize()
 	{
 		Error( "Error initializing GLEW:\n%s\n", reinterpret_cast<const char*>( glewGetErrorString( m_GLEWResult ) ) );
 	}
+	else
+	{
+		InstallDebugOutput();
+	}
 
 	return GLEW_OK == m_GLEWResult;
 }
 
+void CBaseOpenGL::InstallDebugOutput()
+{
+	if( !r_gldebug.GetBool() || !( GLEW_VERSION_4_3 || GLEW_KHR_debug ) )
+		return;
+
+	glDebugMessageCallback( &DebugMessageCallback, nullptr );
+
+	//Only performance messages are listened to, so the driver doesn't have to produce anything else.
+	glDebugMessageControl( GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE );
+	glDebugMessageControl( GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, nullptr, GL_TRUE );
+
+	glEnable( GL_DEBUG_OUTPUT );
+
+	Message( "Listening for OpenGL performance warnings\n" );
+}
+
 void CBaseOpenGL::GetErrors()
 {
 	GLenum error;
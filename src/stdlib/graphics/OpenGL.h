@@ -37,6 +37,13 @@ protected:
 	{
 	}
 
+private:
+	/**
+	*	Has the driver report performance problems, such as shader recompiles and stalls, to the log and to the profiler.
+	*	Requires KHR_debug. Drivers may only report messages for debug contexts.
+	*/
+	void InstallDebugOutput();
+
 private:
 	bool m_bPostInitialized = false;
 	/**
@@ -0,0 +1,421 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+#include "Palette.h"
+
+#include "PNGFile.h"
+
+namespace graphics
+{
+namespace pngfile
+{
+namespace
+{
+const uint8_t PNG_SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+/**
+*	Indexed color, one palette index per pixel.
+*/
+const uint8_t COLOR_TYPE_PALETTE = 3;
+
+/**
+*	Rows are stored unfiltered. Textures are noisy enough that filtering rarely helps indexed images.
+*/
+const uint8_t FILTER_NONE = 0;
+
+const int MIN_MATCH = 3;
+const int MAX_MATCH = 258;
+
+/**
+*	Largest distance a match can reference. Also the size of the zlib window that the header declares.
+*/
+const int WINDOW_SIZE = 32768;
+
+const int HASH_BITS = 15;
+const int HASH_SIZE = 1 << HASH_BITS;
+
+/**
+*	Most earlier positions with the same hash that are checked for a match.
+*/
+const int MAX_CHAIN = 32;
+
+const uint16_t LENGTH_BASE[] =
+{
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+const uint8_t LENGTH_EXTRA_BITS[] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+const uint16_t DISTANCE_BASE[] =
+{
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+const uint8_t DISTANCE_EXTRA_BITS[] =
+{
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+const std::array<uint32_t, 256>& GetCRCTable()
+{
+	static const std::array<uint32_t, 256> table = []()
+	{
+		std::array<uint32_t, 256> result;
+
+		for( uint32_t uiIndex = 0; uiIndex < result.size(); ++uiIndex )
+		{
+			uint32_t uiValue = uiIndex;
+
+			for( int iBit = 0; iBit < 8; ++iBit )
+			{
+				uiValue = ( uiValue & 1 ) ? 0xEDB88320 ^ ( uiValue >> 1 ) : uiValue >> 1;
+			}
+
+			result[ uiIndex ] = uiValue;
+		}
+
+		return result;
+	}();
+
+	return table;
+}
+
+uint32_t UpdateCRC( uint32_t uiCRC, const uint8_t* pData, const size_t uiSize )
+{
+	const auto& table = GetCRCTable();
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		uiCRC = table[ ( uiCRC ^ pData[ uiIndex ] ) & 0xFF ] ^ ( uiCRC >> 8 );
+	}
+
+	return uiCRC;
+}
+
+uint32_t Adler32( const uint8_t* pData, const size_t uiSize )
+{
+	const uint32_t MOD_ADLER = 65521;
+
+	uint32_t a = 1;
+	uint32_t b = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		a = ( a + pData[ uiIndex ] ) % MOD_ADLER;
+		b = ( b + a ) % MOD_ADLER;
+	}
+
+	return ( b << 16 ) | a;
+}
+
+void WriteBigEndian( std::vector<uint8_t>& data, const uint32_t uiValue )
+{
+	data.push_back( static_cast<uint8_t>( uiValue >> 24 ) );
+	data.push_back( static_cast<uint8_t>( uiValue >> 16 ) );
+	data.push_back( static_cast<uint8_t>( uiValue >> 8 ) );
+	data.push_back( static_cast<uint8_t>( uiValue ) );
+}
+
+void WriteChunk( std::vector<uint8_t>& data, const char* const pszType, const uint8_t* pChunkData, const size_t uiSize )
+{
+	WriteBigEndian( data, static_cast<uint32_t>( uiSize ) );
+
+	const size_t uiTypeOffset = data.size();
+
+	data.insert( data.end(), pszType, pszType + 4 );
+	data.insert( data.end(), pChunkData, pChunkData + uiSize );
+
+	//The CRC covers the type and the data, but not the length.
+	WriteBigEndian( data, UpdateCRC( 0xFFFFFFFF, data.data() + uiTypeOffset, data.size() - uiTypeOffset ) ^ 0xFFFFFFFF );
+}
+
+/**
+*	Writes deflate bit streams. Values are packed starting at the least significant bit, Huffman codes starting at their most significant bit.
+*/
+class CBitWriter final
+{
+public:
+	CBitWriter( std::vector<uint8_t>& data )
+		: m_Data( data )
+	{
+	}
+
+	void WriteBits( const uint32_t uiValue, const int iCount )
+	{
+		m_uiBuffer |= uiValue << m_iBitCount;
+		m_iBitCount += iCount;
+
+		while( m_iBitCount >= 8 )
+		{
+			m_Data.push_back( static_cast<uint8_t>( m_uiBuffer ) );
+			m_uiBuffer >>= 8;
+			m_iBitCount -= 8;
+		}
+	}
+
+	void WriteCode( const uint32_t uiCode, const int iLength )
+	{
+		uint32_t uiReversed = 0;
+
+		for( int iBit = 0; iBit < iLength; ++iBit )
+		{
+			uiReversed |= ( ( uiCode >> iBit ) & 1 ) << ( iLength - 1 - iBit );
+		}
+
+		WriteBits( uiReversed, iLength );
+	}
+
+	/**
+	*	Writes a symbol from the fixed literal/length alphabet.
+	*/
+	void WriteLiteralLength( const uint32_t uiSymbol )
+	{
+		if( uiSymbol <= 143 )
+			WriteCode( 0x30 + uiSymbol, 8 );
+		else if( uiSymbol <= 255 )
+			WriteCode( 0x190 + uiSymbol - 144, 9 );
+		else if( uiSymbol <= 279 )
+			WriteCode( uiSymbol - 256, 7 );
+		else
+			WriteCode( 0xC0 + uiSymbol - 280, 8 );
+	}
+
+	void WriteMatch( const int iLength, const int iDistance )
+	{
+		int iLengthCode = static_cast<int>( sizeof( LENGTH_BASE ) / sizeof( LENGTH_BASE[ 0 ] ) ) - 1;
+
+		while( LENGTH_BASE[ iLengthCode ] > iLength )
+			--iLengthCode;
+
+		WriteLiteralLength( 257 + iLengthCode );
+		WriteBits( iLength - LENGTH_BASE[ iLengthCode ], LENGTH_EXTRA_BITS[ iLengthCode ] );
+
+		int iDistanceCode = static_cast<int>( sizeof( DISTANCE_BASE ) / sizeof( DISTANCE_BASE[ 0 ] ) ) - 1;
+
+		while( DISTANCE_BASE[ iDistanceCode ] > iDistance )
+			--iDistanceCode;
+
+		WriteCode( iDistanceCode, 5 );
+		WriteBits( iDistance - DISTANCE_BASE[ iDistanceCode ], DISTANCE_EXTRA_BITS[ iDistanceCode ] );
+	}
+
+	void Flush()
+	{
+		if( m_iBitCount > 0 )
+			m_Data.push_back( static_cast<uint8_t>( m_uiBuffer ) );
+
+		m_uiBuffer = 0;
+		m_iBitCount = 0;
+	}
+
+private:
+	std::vector<uint8_t>& m_Data;
+
+	uint32_t m_uiBuffer = 0;
+	int m_iBitCount = 0;
+};
+
+int Hash( const uint8_t* pData )
+{
+	return ( ( pData[ 0 ] << 10 ) ^ ( pData[ 1 ] << 5 ) ^ pData[ 2 ] ) & ( HASH_SIZE - 1 );
+}
+
+/**
+*	Compresses data into a zlib stream with a single fixed Huffman block.
+*	Matches are found with hash chains, which is good enough for texture-sized images.
+*/
+void Compress( const uint8_t* pData, const int iSize, std::vector<uint8_t>& output )
+{
+	//Deflate, 32K window, no preset dictionary, fastest compression level.
+	output.push_back( 0x78 );
+	output.push_back( 0x01 );
+
+	CBitWriter writer( output );
+
+	//Final block, fixed Huffman codes.
+	writer.WriteBits( 1, 1 );
+	writer.WriteBits( 1, 2 );
+
+	std::vector<int> head( HASH_SIZE, -1 );
+	std::vector<int> prev( WINDOW_SIZE, -1 );
+
+	auto insert = [ & ]( const int iPos )
+	{
+		if( iPos + MIN_MATCH > iSize )
+			return;
+
+		const int iHash = Hash( pData + iPos );
+
+		prev[ iPos & ( WINDOW_SIZE - 1 ) ] = head[ iHash ];
+		head[ iHash ] = iPos;
+	};
+
+	int iPos = 0;
+
+	while( iPos < iSize )
+	{
+		int iBestLength = 0;
+		int iBestDistance = 0;
+
+		if( iPos + MIN_MATCH <= iSize )
+		{
+			const int iMaxLength = std::min( MAX_MATCH, iSize - iPos );
+
+			int iCandidate = head[ Hash( pData + iPos ) ];
+
+			for( int iChain = 0; iChain < MAX_CHAIN && iCandidate >= 0 && iPos - iCandidate <= WINDOW_SIZE; ++iChain )
+			{
+				int iLength = 0;
+
+				while( iLength < iMaxLength && pData[ iCandidate + iLength ] == pData[ iPos + iLength ] )
+					++iLength;
+
+				if( iLength > iBestLength )
+				{
+					iBestLength = iLength;
+					iBestDistance = iPos - iCandidate;
+
+					if( iLength == iMaxLength )
+						break;
+				}
+
+				const int iNext = prev[ iCandidate & ( WINDOW_SIZE - 1 ) ];
+
+				//Entries are reused once the window moves past them; a newer position means the chain has ended.
+				if( iNext >= iCandidate )
+					break;
+
+				iCandidate = iNext;
+			}
+		}
+
+		if( iBestLength >= MIN_MATCH )
+		{
+			writer.WriteMatch( iBestLength, iBestDistance );
+
+			for( int iIndex = 0; iIndex < iBestLength; ++iIndex )
+			{
+				insert( iPos + iIndex );
+			}
+
+			iPos += iBestLength;
+		}
+		else
+		{
+			writer.WriteLiteralLength( pData[ iPos ] );
+
+			insert( iPos );
+
+			++iPos;
+		}
+	}
+
+	//End of block.
+	writer.WriteLiteralLength( 256 );
+
+	writer.Flush();
+
+	WriteBigEndian( output, Adler32( pData, static_cast<size_t>( iSize ) ) );
+}
+}
+
+bool EncodePNG( const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette, const bool bTransparentLastIndex,
+				std::vector<uint8_t>& data )
+{
+	data.clear();
+
+	if( iWidth <= 0 || iHeight <= 0 )
+		return false;
+
+	if( !pPixels || !pPalette )
+		return false;
+
+	data.insert( data.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof( PNG_SIGNATURE ) );
+
+	{
+		const uint32_t uiWidth = static_cast<uint32_t>( iWidth );
+		const uint32_t uiHeight = static_cast<uint32_t>( iHeight );
+
+		uint8_t header[ 13 ] =
+		{
+			static_cast<uint8_t>( uiWidth >> 24 ), static_cast<uint8_t>( uiWidth >> 16 ), static_cast<uint8_t>( uiWidth >> 8 ), static_cast<uint8_t>( uiWidth ),
+			static_cast<uint8_t>( uiHeight >> 24 ), static_cast<uint8_t>( uiHeight >> 16 ), static_cast<uint8_t>( uiHeight >> 8 ), static_cast<uint8_t>( uiHeight )
+		};
+
+		header[ 8 ] = 8;					//8 bits per palette index.
+		header[ 9 ] = COLOR_TYPE_PALETTE;
+		header[ 10 ] = 0;					//Deflate.
+		header[ 11 ] = 0;					//Adaptive filtering.
+		header[ 12 ] = 0;					//Not interlaced.
+
+		WriteChunk( data, "IHDR", header, sizeof( header ) );
+	}
+
+	WriteChunk( data, "PLTE", pPalette, PALETTE_SIZE );
+
+	if( bTransparentLastIndex )
+	{
+		uint8_t alpha[ PALETTE_ENTRIES ];
+
+		memset( alpha, 0xFF, sizeof( alpha ) );
+
+		alpha[ PALETTE_ENTRIES - 1 ] = 0;
+
+		WriteChunk( data, "tRNS", alpha, sizeof( alpha ) );
+	}
+
+	{
+		//Every row starts with its filter type.
+		std::vector<uint8_t> rows( static_cast<size_t>( iWidth + 1 ) * iHeight );
+
+		for( int iRow = 0; iRow < iHeight; ++iRow )
+		{
+			uint8_t* pRow = rows.data() + static_cast<size_t>( iWidth + 1 ) * iRow;
+
+			pRow[ 0 ] = FILTER_NONE;
+
+			memcpy( pRow + 1, pPixels + static_cast<size_t>( iWidth ) * iRow, iWidth );
+		}
+
+		std::vector<uint8_t> compressed;
+
+		Compress( rows.data(), static_cast<int>( rows.size() ), compressed );
+
+		WriteChunk( data, "IDAT", compressed.data(), compressed.size() );
+	}
+
+	WriteChunk( data, "IEND", nullptr, 0 );
+
+	return true;
+}
+
+bool SavePNGFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette,
+				  const bool bTransparentLastIndex )
+{
+	if( !pszFilename || !( *pszFilename ) )
+		return false;
+
+	std::vector<uint8_t> data;
+
+	if( !EncodePNG( iWidth, iHeight, pPixels, pPalette, bTransparentLastIndex, data ) )
+		return false;
+
+	FILE* pFile = fopen( pszFilename, "wb" );
+
+	if( !pFile )
+		return false;
+
+	const bool bSuccess = fwrite( data.data(), data.size(), 1, pFile ) == 1;
+
+	if( fclose( pFile ) != 0 )
+		return false;
+
+	return bSuccess;
+}
+}
+}
@@ -0,0 +1,35 @@
+#ifndef GRAPHICS_PNGFILE_H
+#define GRAPHICS_PNGFILE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace graphics
+{
+namespace pngfile
+{
+/**
+*	Encodes an 8 bit paletted image as a PNG file. The image is compressed with fixed Huffman codes, so no zlib is needed.
+*	Only uses memory owned by the caller, so this can be called from any thread.
+*	@param iWidth Width of the image.
+*	@param iHeight Height of the image.
+*	@param pPixels Array of pixels. Must be iWidth * iHeight bytes in size.
+*	@param pPalette Array of colors. Must be 256 entries, each entry being 3 bytes (RGB 8 bit)
+*	@param bTransparentLastIndex Whether the last palette entry is transparent, like it is in masked textures.
+*	@param data Encoded file. Existing contents are replaced.
+*	@return true on success, false otherwise.
+*/
+bool EncodePNG( const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette, const bool bTransparentLastIndex,
+				std::vector<uint8_t>& data );
+
+/**
+*	Saves a PNG file.
+*	@param pszFilename Filename to save to.
+*	@see EncodePNG
+*/
+bool SavePNGFile( const char* const pszFilename, const int iWidth, const int iHeight, const uint8_t* pPixels, const uint8_t* pPalette,
+				  const bool bTransparentLastIndex = false );
+}
+}
+
+#endif //GRAPHICS_PNGFILE_H
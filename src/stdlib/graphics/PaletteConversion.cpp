@@ -0,0 +1,160 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include <tmmintrin.h>
+
+#include "utility/PlatUtils.h"
+
+#include "Palette.h"
+
+#include "PaletteConversion.h"
+
+namespace graphics
+{
+namespace
+{
+bool UseSSSE3()
+{
+	static const bool bSupported = plat::IsSSSE3Supported();
+
+	return bSupported;
+}
+
+/**
+*	Looks up pixels in a 32 bit copy of the palette, then packs every 4 of them into 12 bytes of RGB.
+*/
+SSSE3_TARGET void ExpandIndexedToRGBSSSE3( const byte* const pIndices, const size_t uiCount, const byte* const pPalette, byte* const pOut )
+{
+	//Lookups are done in a 32 bit palette so each pixel is a single load.
+	uint32_t palette[ PALETTE_ENTRIES ];
+
+	for( size_t uiIndex = 0; uiIndex < PALETTE_ENTRIES; ++uiIndex )
+	{
+		palette[ uiIndex ] = 0;
+		memcpy( &palette[ uiIndex ], pPalette + uiIndex * PALETTE_CHANNELS, PALETTE_CHANNELS );
+	}
+
+	const __m128i pack = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+
+	size_t uiIndex = 0;
+
+	//Each store writes 16 bytes, 4 more than the pixels produce. The next store overwrites those, so stop while there is room for them.
+	for( ; uiIndex + 6 <= uiCount; uiIndex += 4 )
+	{
+		const __m128i pixels = _mm_setr_epi32(
+			static_cast<int>( palette[ pIndices[ uiIndex ] ] ),
+			static_cast<int>( palette[ pIndices[ uiIndex + 1 ] ] ),
+			static_cast<int>( palette[ pIndices[ uiIndex + 2 ] ] ),
+			static_cast<int>( palette[ pIndices[ uiIndex + 3 ] ] ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pOut + uiIndex * 3 ), _mm_shuffle_epi8( pixels, pack ) );
+	}
+
+	for( ; uiIndex < uiCount; ++uiIndex )
+	{
+		memcpy( pOut + uiIndex * 3, pPalette + pIndices[ uiIndex ] * PALETTE_CHANNELS, PALETTE_CHANNELS );
+	}
+}
+
+SSSE3_TARGET void InterleaveRGBAndAlphaSSSE3( const byte* const pRGB, const byte* const pAlpha, const size_t uiCount, byte* const pOut )
+{
+	const __m128i rgbMask = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+	const __m128i alphaMask = _mm_setr_epi8( -1, -1, -1, 0, -1, -1, -1, 1, -1, -1, -1, 2, -1, -1, -1, 3 );
+
+	size_t uiIndex = 0;
+
+	//Each load reads 16 bytes, 4 more than the pixels use, so stop while those are still inside the input.
+	for( ; uiIndex + 6 <= uiCount; uiIndex += 4 )
+	{
+		const __m128i rgb = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pRGB + uiIndex * 3 ) );
+
+		int iAlpha;
+		memcpy( &iAlpha, pAlpha + uiIndex, sizeof( iAlpha ) );
+
+		const __m128i alpha = _mm_cvtsi32_si128( iAlpha );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pOut + uiIndex * 4 ),
+			_mm_or_si128( _mm_shuffle_epi8( rgb, rgbMask ), _mm_shuffle_epi8( alpha, alphaMask ) ) );
+	}
+
+	for( ; uiIndex < uiCount; ++uiIndex )
+	{
+		memcpy( pOut + uiIndex * 4, pRGB + uiIndex * 3, 3 );
+		pOut[ uiIndex * 4 + 3 ] = pAlpha[ uiIndex ];
+	}
+}
+}
+
+void ConvertPaletteToRGBA( const byte* const pPalette, byte* const pOutPalette )
+{
+	assert( pPalette );
+	assert( pOutPalette );
+
+	for( size_t uiIndex = 0; uiIndex < PALETTE_ENTRIES; ++uiIndex )
+	{
+		memcpy( pOutPalette + uiIndex * 4, pPalette + uiIndex * PALETTE_CHANNELS, PALETTE_CHANNELS );
+		pOutPalette[ uiIndex * 4 + 3 ] = 0xFF;
+	}
+}
+
+void ExpandIndexedToRGBA( const byte* const pIndices, const size_t uiCount, const byte* const pRGBAPalette, byte* const pOut )
+{
+	assert( pIndices );
+	assert( pRGBAPalette );
+	assert( pOut );
+
+	//Every pixel is a 32 bit copy, which compilers turn into a single load and store. There's nothing left for a shuffle to do here.
+	size_t uiIndex = 0;
+
+	for( ; uiIndex + 4 <= uiCount; uiIndex += 4 )
+	{
+		memcpy( pOut + uiIndex * 4, pRGBAPalette + pIndices[ uiIndex ] * 4, 4 );
+		memcpy( pOut + uiIndex * 4 + 4, pRGBAPalette + pIndices[ uiIndex + 1 ] * 4, 4 );
+		memcpy( pOut + uiIndex * 4 + 8, pRGBAPalette + pIndices[ uiIndex + 2 ] * 4, 4 );
+		memcpy( pOut + uiIndex * 4 + 12, pRGBAPalette + pIndices[ uiIndex + 3 ] * 4, 4 );
+	}
+
+	for( ; uiIndex < uiCount; ++uiIndex )
+	{
+		memcpy( pOut + uiIndex * 4, pRGBAPalette + pIndices[ uiIndex ] * 4, 4 );
+	}
+}
+
+void ExpandIndexedToRGB( const byte* const pIndices, const size_t uiCount, const byte* const pPalette, byte* const pOut )
+{
+	assert( pIndices );
+	assert( pPalette );
+	assert( pOut );
+
+	if( UseSSSE3() )
+	{
+		ExpandIndexedToRGBSSSE3( pIndices, uiCount, pPalette, pOut );
+		return;
+	}
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		memcpy( pOut + uiIndex * 3, pPalette + pIndices[ uiIndex ] * PALETTE_CHANNELS, PALETTE_CHANNELS );
+	}
+}
+
+void InterleaveRGBAndAlpha( const byte* const pRGB, const byte* const pAlpha, const size_t uiCount, byte* const pOut )
+{
+	assert( pRGB );
+	assert( pAlpha );
+	assert( pOut );
+
+	if( UseSSSE3() )
+	{
+		InterleaveRGBAndAlphaSSSE3( pRGB, pAlpha, uiCount, pOut );
+		return;
+	}
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		memcpy( pOut + uiIndex * 4, pRGB + uiIndex * 3, 3 );
+		pOut[ uiIndex * 4 + 3 ] = pAlpha[ uiIndex ];
+	}
+}
+}
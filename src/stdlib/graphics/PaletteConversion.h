@@ -0,0 +1,50 @@
+#ifndef GRAPHICS_PALETTECONVERSION_H
+#define GRAPHICS_PALETTECONVERSION_H
+
+#include <cstddef>
+
+#include "shared/Const.h"
+
+/*
+*	Conversion of 8 bit paletted images to RGB and RGBA.
+*	These use SSSE3 if the CPU supports it.
+*/
+
+namespace graphics
+{
+/**
+*	Converts a 24 bit palette to a 32 bit palette. Every entry is made opaque.
+*	@param pPalette Palette to convert. Must be PALETTE_SIZE bytes.
+*	@param pOutPalette Converted palette. Must be PALETTE_ENTRIES * 4 bytes.
+*/
+void ConvertPaletteToRGBA( const byte* const pPalette, byte* const pOutPalette );
+
+/**
+*	Converts 8 bit pixels to RGBA by looking up each pixel in a 32 bit palette.
+*	@param pIndices Pixels to convert.
+*	@param uiCount Number of pixels.
+*	@param pRGBAPalette Palette containing PALETTE_ENTRIES RGBA colors.
+*	@param pOut Converted pixels. Must be uiCount * 4 bytes.
+*/
+void ExpandIndexedToRGBA( const byte* const pIndices, const size_t uiCount, const byte* const pRGBAPalette, byte* const pOut );
+
+/**
+*	Converts 8 bit pixels to RGB by looking up each pixel in a 24 bit palette.
+*	@param pIndices Pixels to convert.
+*	@param uiCount Number of pixels.
+*	@param pPalette Palette containing PALETTE_ENTRIES RGB colors.
+*	@param pOut Converted pixels. Must be uiCount * 3 bytes.
+*/
+void ExpandIndexedToRGB( const byte* const pIndices, const size_t uiCount, const byte* const pPalette, byte* const pOut );
+
+/**
+*	Combines separate RGB and alpha planes into RGBA pixels.
+*	@param pRGB RGB pixels.
+*	@param pAlpha Alpha values, one for each pixel.
+*	@param uiCount Number of pixels.
+*	@param pOut Combined pixels. Must be uiCount * 4 bytes.
+*/
+void InterleaveRGBAndAlpha( const byte* const pRGB, const byte* const pAlpha, const size_t uiCount, byte* const pOut );
+}
+
+#endif //GRAPHICS_PALETTECONVERSION_H
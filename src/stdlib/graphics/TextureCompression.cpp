@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "ImageResample.h"
+#include "TextureCompression.h"
+
+namespace graphics
+{
+namespace
+{
+/**
+*	Size of a compressed block, in pixels.
+*/
+const int BLOCK_SIZE = 4;
+
+const int BLOCK_PIXELS = BLOCK_SIZE * BLOCK_SIZE;
+
+uint16_t PackRGB565( const int* pRGB )
+{
+	return static_cast<uint16_t>( ( ( pRGB[ 0 ] >> 3 ) << 11 ) | ( ( pRGB[ 1 ] >> 2 ) << 5 ) | ( pRGB[ 2 ] >> 3 ) );
+}
+
+void UnpackRGB565( const uint16_t color, int* pRGB )
+{
+	const int r = ( color >> 11 ) & 31;
+	const int g = ( color >> 5 ) & 63;
+	const int b = color & 31;
+
+	pRGB[ 0 ] = ( r << 3 ) | ( r >> 2 );
+	pRGB[ 1 ] = ( g << 2 ) | ( g >> 4 );
+	pRGB[ 2 ] = ( b << 3 ) | ( b >> 2 );
+}
+
+/**
+*	Reads a block of pixels. Pixels outside the image are clamped to its edges.
+*/
+void FetchBlock( const byte* pData, const int iWidth, const int iHeight, const int iBlockX, const int iBlockY, byte* pBlock )
+{
+	for( int y = 0; y < BLOCK_SIZE; ++y )
+	{
+		const int iY = std::min( iBlockY * BLOCK_SIZE + y, iHeight - 1 );
+
+		for( int x = 0; x < BLOCK_SIZE; ++x, pBlock += 4 )
+		{
+			const int iX = std::min( iBlockX * BLOCK_SIZE + x, iWidth - 1 );
+
+			const byte* pPixel = pData + ( iY * iWidth + iX ) * 4;
+
+			pBlock[ 0 ] = pPixel[ 0 ];
+			pBlock[ 1 ] = pPixel[ 1 ];
+			pBlock[ 2 ] = pPixel[ 2 ];
+			pBlock[ 3 ] = pPixel[ 3 ];
+		}
+	}
+}
+
+/**
+*	Encodes the colors of a block using the bounding box of its colors as endpoints.
+*	@param bPunchThrough Whether to use 3 color mode, with the 4th color marking pixels whose alpha is below 128.
+*/
+void EncodeColorBlock( const byte* pBlock, const bool bPunchThrough, byte* pOut )
+{
+	int mins[ 3 ] = { 255, 255, 255 };
+	int maxs[ 3 ] = { 0, 0, 0 };
+
+	bool bAnyOpaque = false;
+
+	for( int i = 0; i < BLOCK_PIXELS; ++i )
+	{
+		const byte* pPixel = pBlock + i * 4;
+
+		if( bPunchThrough && pPixel[ 3 ] < 128 )
+			continue;
+
+		bAnyOpaque = true;
+
+		for( int c = 0; c < 3; ++c )
+		{
+			mins[ c ] = std::min( mins[ c ], static_cast<int>( pPixel[ c ] ) );
+			maxs[ c ] = std::max( maxs[ c ], static_cast<int>( pPixel[ c ] ) );
+		}
+	}
+
+	if( !bAnyOpaque )
+	{
+		//Equal endpoints select 3 color mode, every pixel uses the transparent color.
+		pOut[ 0 ] = pOut[ 1 ] = pOut[ 2 ] = pOut[ 3 ] = 0;
+		pOut[ 4 ] = pOut[ 5 ] = pOut[ 6 ] = pOut[ 7 ] = 0xFF;
+		return;
+	}
+
+	//Move the endpoints inwards a bit. The extremes are rarely the best fit for the colors in between.
+	for( int c = 0; c < 3; ++c )
+	{
+		const int iInset = ( maxs[ c ] - mins[ c ] ) >> 4;
+
+		mins[ c ] += iInset;
+		maxs[ c ] -= iInset;
+	}
+
+	uint16_t color0 = PackRGB565( maxs );
+	uint16_t color1 = PackRGB565( mins );
+
+	//The order of the endpoints selects the mode.
+	if( bPunchThrough ? color0 > color1 : color0 < color1 )
+		std::swap( color0, color1 );
+
+	int palette[ 4 ][ 3 ];
+
+	UnpackRGB565( color0, palette[ 0 ] );
+	UnpackRGB565( color1, palette[ 1 ] );
+
+	const bool bFourColors = color0 > color1;
+
+	for( int c = 0; c < 3; ++c )
+	{
+		if( bFourColors )
+		{
+			palette[ 2 ][ c ] = ( 2 * palette[ 0 ][ c ] + palette[ 1 ][ c ] ) / 3;
+			palette[ 3 ][ c ] = ( palette[ 0 ][ c ] + 2 * palette[ 1 ][ c ] ) / 3;
+		}
+		else
+		{
+			palette[ 2 ][ c ] = ( palette[ 0 ][ c ] + palette[ 1 ][ c ] ) / 2;
+			palette[ 3 ][ c ] = 0;
+		}
+	}
+
+	//In 3 color mode the last color is transparent black, so it can't be used for opaque pixels.
+	const int iNumColors = bFourColors ? 4 : 3;
+
+	uint32_t indices = 0;
+
+	for( int i = 0; i < BLOCK_PIXELS; ++i )
+	{
+		const byte* pPixel = pBlock + i * 4;
+
+		uint32_t index;
+
+		if( bPunchThrough && pPixel[ 3 ] < 128 )
+		{
+			index = 3;
+		}
+		else
+		{
+			index = 0;
+			int iBestDist = INT32_MAX;
+
+			for( int iColor = 0; iColor < iNumColors; ++iColor )
+			{
+				int iDist = 0;
+
+				for( int c = 0; c < 3; ++c )
+				{
+					const int iDelta = pPixel[ c ] - palette[ iColor ][ c ];
+					iDist += iDelta * iDelta;
+				}
+
+				if( iDist < iBestDist )
+				{
+					iBestDist = iDist;
+					index = static_cast<uint32_t>( iColor );
+				}
+			}
+		}
+
+		indices |= index << ( i * 2 );
+	}
+
+	pOut[ 0 ] = static_cast<byte>( color0 & 0xFF );
+	pOut[ 1 ] = static_cast<byte>( color0 >> 8 );
+	pOut[ 2 ] = static_cast<byte>( color1 & 0xFF );
+	pOut[ 3 ] = static_cast<byte>( color1 >> 8 );
+	pOut[ 4 ] = static_cast<byte>( indices & 0xFF );
+	pOut[ 5 ] = static_cast<byte>( ( indices >> 8 ) & 0xFF );
+	pOut[ 6 ] = static_cast<byte>( ( indices >> 16 ) & 0xFF );
+	pOut[ 7 ] = static_cast<byte>( indices >> 24 );
+}
+
+/**
+*	Encodes the alpha of a block using 8 interpolated values.
+*/
+void EncodeAlphaBlock( const byte* pBlock, byte* pOut )
+{
+	int iMin = 255;
+	int iMax = 0;
+
+	for( int i = 0; i < BLOCK_PIXELS; ++i )
+	{
+		iMin = std::min( iMin, static_cast<int>( pBlock[ i * 4 + 3 ] ) );
+		iMax = std::max( iMax, static_cast<int>( pBlock[ i * 4 + 3 ] ) );
+	}
+
+	pOut[ 0 ] = static_cast<byte>( iMax );
+	pOut[ 1 ] = static_cast<byte>( iMin );
+
+	uint64_t indices = 0;
+
+	if( iMax != iMin )
+	{
+		int values[ 8 ];
+
+		values[ 0 ] = iMax;
+		values[ 1 ] = iMin;
+
+		for( int i = 2; i < 8; ++i )
+		{
+			values[ i ] = ( ( 8 - i ) * iMax + ( i - 1 ) * iMin ) / 7;
+		}
+
+		for( int i = 0; i < BLOCK_PIXELS; ++i )
+		{
+			const int iAlpha = pBlock[ i * 4 + 3 ];
+
+			uint64_t index = 0;
+			int iBestDist = INT32_MAX;
+
+			for( int iValue = 0; iValue < 8; ++iValue )
+			{
+				const int iDist = std::abs( iAlpha - values[ iValue ] );
+
+				if( iDist < iBestDist )
+				{
+					iBestDist = iDist;
+					index = static_cast<uint64_t>( iValue );
+				}
+			}
+
+			indices |= index << ( i * 3 );
+		}
+	}
+
+	for( int i = 0; i < 6; ++i )
+	{
+		pOut[ 2 + i ] = static_cast<byte>( ( indices >> ( i * 8 ) ) & 0xFF );
+	}
+}
+}
+
+size_t GetBlockBytes( const BlockFormat format )
+{
+	return format == BlockFormat::BC3 ? 16 : 8;
+}
+
+BlockFormat SelectBlockFormat( const byte* pData, const int iWidth, const int iHeight )
+{
+	BlockFormat format = BlockFormat::BC1;
+
+	const size_t uiPixels = static_cast<size_t>( iWidth * iHeight );
+
+	for( size_t uiIndex = 0; uiIndex < uiPixels; ++uiIndex )
+	{
+		const byte alpha = pData[ uiIndex * 4 + 3 ];
+
+		if( alpha == 0xFF )
+			continue;
+
+		if( alpha != 0 )
+			return BlockFormat::BC3;
+
+		format = BlockFormat::BC1_ALPHA;
+	}
+
+	return format;
+}
+
+void CompressImage( const byte* pData, const int iWidth, const int iHeight, const BlockFormat format, std::vector<byte>& compressed )
+{
+	const int iBlocksX = ( iWidth + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+	const int iBlocksY = ( iHeight + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+
+	compressed.resize( iBlocksX * iBlocksY * GetBlockBytes( format ) );
+
+	byte* pOut = compressed.data();
+
+	byte block[ BLOCK_PIXELS * 4 ];
+
+	for( int y = 0; y < iBlocksY; ++y )
+	{
+		for( int x = 0; x < iBlocksX; ++x )
+		{
+			FetchBlock( pData, iWidth, iHeight, x, y, block );
+
+			if( format == BlockFormat::BC3 )
+			{
+				EncodeAlphaBlock( block, pOut );
+				pOut += 8;
+			}
+
+			EncodeColorBlock( block, format == BlockFormat::BC1_ALPHA, pOut );
+			pOut += 8;
+		}
+	}
+}
+
+int GetMipLevelCount( const int iWidth, const int iHeight )
+{
+	int iLevels = 1;
+
+	for( int iSize = std::max( iWidth, iHeight ); iSize > 1; iSize >>= 1 )
+	{
+		++iLevels;
+	}
+
+	return iLevels;
+}
+
+BlockFormat CompressRGBAMipChain( const byte* pData, const int iWidth, const int iHeight, const bool bMipmaps, std::vector<std::vector<byte>>& levels )
+{
+	assert( iWidth > 0 && iHeight > 0 );
+	assert( pData );
+
+	const BlockFormat format = SelectBlockFormat( pData, iWidth, iHeight );
+
+	const int iLevels = bMipmaps ? GetMipLevelCount( iWidth, iHeight ) : 1;
+
+	levels.resize( iLevels );
+
+	std::vector<byte> level;
+	std::vector<byte> nextLevel;
+
+	const byte* pLevel = pData;
+	int iLevelWidth = iWidth;
+	int iLevelHeight = iHeight;
+
+	for( int iLevel = 0; iLevel < iLevels; ++iLevel )
+	{
+		CompressImage( pLevel, iLevelWidth, iLevelHeight, format, levels[ iLevel ] );
+
+		if( iLevel + 1 < iLevels )
+		{
+			const int iNextWidth = std::max( 1, iLevelWidth >> 1 );
+			const int iNextHeight = std::max( 1, iLevelHeight >> 1 );
+
+			nextLevel.resize( iNextWidth * iNextHeight * 4 );
+
+			//Same filtering as the upload path, so exported and uploaded textures look the same.
+			ResampleRGBA( pLevel, iLevelWidth, iLevelHeight, nextLevel.data(), iNextWidth, iNextHeight,
+				ResampleFilter::BOX, format == BlockFormat::BC1_ALPHA );
+
+			level.swap( nextLevel );
+
+			pLevel = level.data();
+			iLevelWidth = iNextWidth;
+			iLevelHeight = iNextHeight;
+		}
+	}
+
+	return format;
+}
+}
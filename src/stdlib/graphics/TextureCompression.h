@@ -0,0 +1,65 @@
+#ifndef GRAPHICS_TEXTURECOMPRESSION_H
+#define GRAPHICS_TEXTURECOMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+#include "shared/Const.h"
+
+/*
+*	Compression of RGBA images to BC1 and BC3 (S3TC). Doesn't use GL, so images can be compressed for files as well as for uploads,
+*	and from any thread.
+*/
+
+namespace graphics
+{
+enum class BlockFormat
+{
+	/**
+	*	Opaque BC1.
+	*/
+	BC1,
+
+	/**
+	*	BC1 with 1 bit alpha.
+	*/
+	BC1_ALPHA,
+
+	/**
+	*	BC3, with interpolated alpha.
+	*/
+	BC3
+};
+
+/**
+*	@return Size of a compressed 4x4 block, in bytes.
+*/
+size_t GetBlockBytes( const BlockFormat format );
+
+/**
+*	Picks the block format for an image: opaque images use BC1, images with only fully transparent or opaque pixels use BC1 with alpha and everything else uses BC3.
+*/
+BlockFormat SelectBlockFormat( const byte* pData, const int iWidth, const int iHeight );
+
+/**
+*	Compresses an RGBA image. Images whose size isn't a multiple of 4 are padded by repeating their edge pixels.
+*	@param compressed Compressed blocks, in rows. Existing contents are replaced.
+*/
+void CompressImage( const byte* pData, const int iWidth, const int iHeight, const BlockFormat format, std::vector<byte>& compressed );
+
+/**
+*	@return Number of levels in a full mip chain of an image, including the image itself.
+*/
+int GetMipLevelCount( const int iWidth, const int iHeight );
+
+/**
+*	Compresses an RGBA image and, optionally, a full mip chain built with the same filtering that uploads use.
+*	Every level uses the format picked for the full image.
+*	@param bMipmaps Whether to build a mip chain.
+*	@param levels Compressed levels, starting with the full image. Existing contents are replaced.
+*	@return Format of the levels.
+*/
+BlockFormat CompressRGBAMipChain( const byte* pData, const int iWidth, const int iHeight, const bool bMipmaps, std::vector<std::vector<byte>>& levels );
+}
+
+#endif //GRAPHICS_TEXTURECOMPRESSION_H
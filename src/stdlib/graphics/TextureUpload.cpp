@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "cvar/CCVar.h"
+
+#include "ImageResample.h"
+#include "TextureCompression.h"
+#include "TextureUpload.h"
+
+namespace graphics
+{
+namespace
+{
+//Note: multiple libraries can include this file and define these cvars. The first library to register theirs wins.
+static cvar::CCVar r_texturemipmaps( "r_texturemipmaps",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to generate mipmaps for model and sprite textures. Applies to textures uploaded after changing it" ) );
+
+static cvar::CCVar r_texturecompression( "r_texturecompression",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "Whether to compress model and sprite textures to BC1/BC3. Applies to textures uploaded after changing it" ) );
+
+GLenum BlockFormatToGL( const BlockFormat format )
+{
+	switch( format )
+	{
+	default:
+	case BlockFormat::BC1:			return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC1_ALPHA:	return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case BlockFormat::BC3:			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+}
+}
+
+TextureUploadSettings_t GetTextureUploadSettings( const bool bFilter )
+{
+	TextureUploadSettings_t settings;
+
+	settings.bFilter = bFilter;
+	settings.bMipmaps = r_texturemipmaps.GetBool();
+	settings.bCompress = r_texturecompression.GetBool();
+
+	return settings;
+}
+
+void UploadRGBATexture( const GLuint textureId, const int iWidth, const int iHeight, const byte* pData, const TextureUploadSettings_t& settings )
+{
+	assert( iWidth > 0 && iHeight > 0 );
+	assert( pData );
+
+	const bool bCompress = settings.bCompress && GLEW_EXT_texture_compression_s3tc;
+	const bool bImmutable = GLEW_ARB_texture_storage != 0;
+
+	const int iLevels = settings.bMipmaps ? GetMipLevelCount( iWidth, iHeight ) : 1;
+
+	//Every level uses the format picked for the full image so the texture has a single format.
+	//The format also says whether the image is opaque, or only has transparent and opaque pixels like masked textures.
+	const BlockFormat blockFormat = bCompress || iLevels > 1 ? SelectBlockFormat( pData, iWidth, iHeight ) : BlockFormat::BC1;
+	const GLenum compressedFormat = BlockFormatToGL( blockFormat );
+
+	//The driver can build mipmaps of opaque images. Images with alpha are done here, since drivers don't weight colors by alpha
+	//and don't keep masked alpha binary.
+	const bool bGPUMipmaps = iLevels > 1 && !bCompress && blockFormat == BlockFormat::BC1 && ( GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object );
+
+	glBindTexture( GL_TEXTURE_2D, textureId );
+
+	if( bImmutable )
+	{
+		glTexStorage2D( GL_TEXTURE_2D, iLevels, bCompress ? compressedFormat : GL_RGBA8, iWidth, iHeight );
+	}
+	else
+	{
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, iLevels - 1 );
+	}
+
+	std::vector<byte> level;
+	std::vector<byte> nextLevel;
+	std::vector<byte> compressed;
+
+	const byte* pLevel = pData;
+	int iLevelWidth = iWidth;
+	int iLevelHeight = iHeight;
+
+	for( int iLevel = 0; iLevel < iLevels; ++iLevel )
+	{
+		if( bCompress )
+		{
+			CompressImage( pLevel, iLevelWidth, iLevelHeight, blockFormat, compressed );
+
+			const GLsizei size = static_cast<GLsizei>( compressed.size() );
+
+			if( bImmutable )
+				glCompressedTexSubImage2D( GL_TEXTURE_2D, iLevel, 0, 0, iLevelWidth, iLevelHeight, compressedFormat, size, compressed.data() );
+			else
+				glCompressedTexImage2D( GL_TEXTURE_2D, iLevel, compressedFormat, iLevelWidth, iLevelHeight, 0, size, compressed.data() );
+		}
+		else
+		{
+			if( bImmutable )
+				glTexSubImage2D( GL_TEXTURE_2D, iLevel, 0, 0, iLevelWidth, iLevelHeight, GL_RGBA, GL_UNSIGNED_BYTE, pLevel );
+			else
+				glTexImage2D( GL_TEXTURE_2D, iLevel, GL_RGBA, iLevelWidth, iLevelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pLevel );
+		}
+
+		if( bGPUMipmaps )
+		{
+			glGenerateMipmap( GL_TEXTURE_2D );
+			break;
+		}
+
+		if( iLevel + 1 < iLevels )
+		{
+			const int iNextWidth = std::max( 1, iLevelWidth >> 1 );
+			const int iNextHeight = std::max( 1, iLevelHeight >> 1 );
+
+			nextLevel.resize( iNextWidth * iNextHeight * 4 );
+
+			ResampleRGBA( pLevel, iLevelWidth, iLevelHeight, nextLevel.data(), iNextWidth, iNextHeight,
+				ResampleFilter::BOX, blockFormat == BlockFormat::BC1_ALPHA );
+
+			level.swap( nextLevel );
+
+			pLevel = level.data();
+			iLevelWidth = iNextWidth;
+			iLevelHeight = iNextHeight;
+		}
+	}
+
+	glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+
+	GLint minFilter;
+
+	if( iLevels > 1 )
+		minFilter = settings.bFilter ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
+	else
+		minFilter = settings.bFilter ? GL_LINEAR : GL_NEAREST;
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, settings.bFilter ? GL_LINEAR : GL_NEAREST );
+}
+
+void SetTextureFilter( const GLuint textureId, const bool bFilter )
+{
+	glBindTexture( GL_TEXTURE_2D, textureId );
+
+	GLint minFilter = GL_NEAREST;
+
+	glGetTexParameteriv( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &minFilter );
+
+	//The minification filter says whether the texture was uploaded with mipmaps.
+	if( minFilter == GL_LINEAR || minFilter == GL_NEAREST )
+		minFilter = bFilter ? GL_LINEAR : GL_NEAREST;
+	else
+		minFilter = bFilter ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, bFilter ? GL_LINEAR : GL_NEAREST );
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+size_t EstimateRGBATextureSize( const int iWidth, const int iHeight, const TextureUploadSettings_t& settings )
+{
+	const bool bCompress = settings.bCompress && GLEW_EXT_texture_compression_s3tc;
+
+	//BC3 stores a 4x4 block in 16 bytes.
+	size_t uiSize = static_cast<size_t>( iWidth ) * static_cast<size_t>( iHeight ) * ( bCompress ? 1 : 4 );
+
+	//A full mip chain adds a third.
+	if( settings.bMipmaps )
+		uiSize += uiSize / 3;
+
+	return uiSize;
+}
+}
@@ -0,0 +1,63 @@
+#ifndef GRAPHICS_TEXTUREUPLOAD_H
+#define GRAPHICS_TEXTUREUPLOAD_H
+
+#include "shared/Const.h"
+
+#include "OpenGL.h"
+
+namespace graphics
+{
+/**
+*	Settings that control how textures are uploaded.
+*/
+struct TextureUploadSettings_t
+{
+	/**
+	*	Whether to use linear filtering.
+	*/
+	bool bFilter = true;
+
+	/**
+	*	Whether to generate a full mip chain.
+	*/
+	bool bMipmaps = false;
+
+	/**
+	*	Whether to compress the texture to BC1, or BC3 if it has translucent pixels. Ignored if the driver doesn't support S3TC.
+	*/
+	bool bCompress = false;
+};
+
+/**
+*	Gets the upload settings selected by the user.
+*	@param bFilter Whether to use linear filtering.
+*/
+TextureUploadSettings_t GetTextureUploadSettings( const bool bFilter );
+
+/**
+*	Uploads RGBA pixels to a 2D texture. Uses immutable storage when the driver supports it.
+*	The texture must not have storage yet.
+*	@param textureId Texture to upload to.
+*	@param iWidth Width of the image.
+*	@param iHeight Height of the image.
+*	@param pData RGBA pixels.
+*	@param settings Upload settings.
+*/
+void UploadRGBATexture( const GLuint textureId, const int iWidth, const int iHeight, const byte* pData, const TextureUploadSettings_t& settings );
+
+/**
+*	Changes the filtering of a texture uploaded by UploadRGBATexture, without uploading it again.
+*	Textures that have mipmaps keep using them.
+*	@param textureId Texture to change.
+*	@param bFilter Whether to use linear filtering.
+*/
+void SetTextureFilter( const GLuint textureId, const bool bFilter );
+
+/**
+*	Estimates how much video memory a texture uploaded by UploadRGBATexture uses. Compressed textures are assumed to be BC3.
+*	@return Size in bytes.
+*/
+size_t EstimateRGBATextureSize( const int iWidth, const int iHeight, const TextureUploadSettings_t& settings );
+}
+
+#endif //GRAPHICS_TEXTUREUPLOAD_H
@@ -0,0 +1,52 @@
+#include <cassert>
+
+#include "CInterfaceCache.h"
+
+void CInterfaceCache::SetFactories( const CreateInterfaceFn* pFactories, const size_t uiNumFactories )
+{
+	assert( pFactories || !uiNumFactories );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Factories.assign( pFactories, pFactories + uiNumFactories );
+	m_Resolved.clear();
+}
+
+void CInterfaceCache::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Factories.clear();
+	m_Factories.shrink_to_fit();
+
+	m_Resolved.clear();
+}
+
+IBaseInterface* CInterfaceCache::CreateInterface( const char* const pszName, IFaceResult* pResult )
+{
+	assert( pszName );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Resolved.find( pszName );
+
+	if( it == m_Resolved.end() )
+	{
+		Resolved_t resolved{ nullptr, IFaceResult::FAILURE };
+
+		for( auto factory : m_Factories )
+		{
+			resolved.pInterface = factory( pszName, &resolved.result );
+
+			if( resolved.result == IFaceResult::SUCCESS )
+				break;
+		}
+
+		it = m_Resolved.emplace( pszName, resolved ).first;
+	}
+
+	if( pResult )
+		*pResult = it->second.result;
+
+	return it->second.pInterface;
+}
@@ -0,0 +1,59 @@
+#ifndef LIB_CINTERFACECACHE_H
+#define LIB_CINTERFACECACHE_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/LibInterface.h"
+
+/**
+*	Resolves interfaces across the factories of all loaded libraries, and remembers what every name resolved to.
+*	Each name asks the factories once, so connecting many libraries doesn't ask every factory for every interface again.
+*	Interfaces are only created once, so only interfaces registered as a single instance should be requested through it.
+*/
+class CInterfaceCache final
+{
+public:
+	CInterfaceCache() = default;
+
+	/**
+	*	Sets the factories to resolve interfaces with, in the order they're asked. Clears the cache.
+	*/
+	void SetFactories( const CreateInterfaceFn* pFactories, const size_t uiNumFactories );
+
+	/**
+	*	Forgets all factories and resolved interfaces.
+	*/
+	void Clear();
+
+	/**
+	*	Resolves an interface. The first factory that has the interface provides it.
+	*	Names that no factory has are remembered too.
+	*	@param pszName Name of the interface.
+	*	@param pResult If non-null, set to whether any factory has the interface.
+	*	@return The interface, or null if it couldn't be found or created.
+	*/
+	IBaseInterface* CreateInterface( const char* const pszName, IFaceResult* pResult = nullptr );
+
+private:
+	struct Resolved_t
+	{
+		IBaseInterface* pInterface;
+		IFaceResult result;
+	};
+
+	std::mutex m_Mutex;
+
+	std::vector<CreateInterfaceFn> m_Factories;
+
+	std::unordered_map<std::string, Resolved_t> m_Resolved;
+
+private:
+	CInterfaceCache( const CInterfaceCache& ) = delete;
+	CInterfaceCache& operator=( const CInterfaceCache& ) = delete;
+};
+
+#endif //LIB_CINTERFACECACHE_H
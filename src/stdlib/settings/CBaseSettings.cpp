@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <cassert>
 
 #include "shared/Logging.h"
 
+#include "cvar/CCVar.h"
+
 #include "ConfigIO.h"
 #include "GameConfigIO.h"
 
@@ -16,12 +19,23 @@
 
 namespace settings
 {
+namespace
+{
+static cvar::CCVar fs_indexsearchpaths( "fs_indexsearchpaths", cvar::CCVarArgsBuilder().Flags( cvar::Flag::ARCHIVE ).FloatValue( 0 ).HelpInfo( "If non-zero, the files in each search path are indexed when the game configuration is activated. Files are then found without accessing the disk, and names are matched case insensitively" ) );
+
+static cvar::CCVar fs_prefetch( "fs_prefetch", cvar::CCVarArgsBuilder().Flags( cvar::Flag::ARCHIVE ).FloatValue( 1 ).HelpInfo( "If non-zero, recent files and the active game configuration's search paths are read in the background after startup, so the first file opened loads as fast as later ones" ) );
+
+static cvar::CCVar fs_prefetch_headers( "fs_prefetch_headers", cvar::CCVarArgsBuilder().Flags( cvar::Flag::ARCHIVE ).FloatValue( 4 ).MinValue( 0 ).HelpInfo( "Number of the most recent files whose headers are read while prefetching" ) );
+}
+
 const double CBaseSettings::DEFAULT_FPS = 30.0;
 
 const double CBaseSettings::MIN_FPS = 15.0;
 
 const double CBaseSettings::MAX_FPS = 500.0;
 
+const double CBaseSettings::SAVE_DELAY = 0.5;
+
 CBaseSettings::CBaseSettings( filesystem::IFileSystem* const pFileSystem )
 	: m_pFileSystem( pFileSystem )
 	, m_ConfigManager( std::make_shared<CGameConfigManager>() )
@@ -31,6 +45,7 @@ CBaseSettings::CBaseSettings( filesystem::IFileSystem* const pFileSystem )
 
 CBaseSettings::~CBaseSettings()
 {
+	WaitForSave();
 }
 
 CBaseSettings::CBaseSettings( const CBaseSettings& other )
@@ -51,7 +66,7 @@ CBaseSettings& CBaseSettings::operator=( const CBaseSettings& other )
 
 void CBaseSettings::Copy( const CBaseSettings& other )
 {
-	//Don't copy the filesystem.
+	//Don't copy the filesystem or the save state.
 
 	*m_ConfigManager = *other.m_ConfigManager;
 }
@@ -68,6 +83,8 @@ bool CBaseSettings::Initialize( const char* const pszFilename )
 
 	m_bInitialized = true;
 
+	m_szFilename = pszFilename;
+
 	//Load the settings, or if the file didn't exist, save settings.
 	bool bResult = LoadFromFile( pszFilename );
 
@@ -119,8 +136,116 @@ void CBaseSettings::Shutdown( const char* const pszFilename )
 
 	PreShutdown( pszFilename );
 
+	//Don't let a background save finish after the final one.
+	WaitForSave();
+
 	if( !SaveToFile( pszFilename ) )
 		Error( "Failed to save settings!\n" );
+
+	m_bChanged = false;
+}
+
+void CBaseSettings::MarkChanged()
+{
+	m_bChanged = true;
+	m_LastChangeTime = std::chrono::steady_clock::now();
+}
+
+void CBaseSettings::SaveIfChanged()
+{
+	if( m_PendingSave.valid() )
+	{
+		//Check later, saves don't stall the main thread.
+		if( m_PendingSave.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+			return;
+
+		WaitForSave();
+	}
+
+	if( !m_bChanged || !m_bInitialized )
+		return;
+
+	if( std::chrono::duration<double>( std::chrono::steady_clock::now() - m_LastChangeTime ).count() < SAVE_DELAY )
+		return;
+
+	m_bChanged = false;
+
+	kv::Writer writer;
+
+	writer.OpenMemory();
+
+	if( !SaveToFile( writer ) )
+	{
+		Error( "Failed to save settings!\n" );
+		return;
+	}
+
+	writer.Close();
+
+	m_PendingSave = std::async( std::launch::async, []( const std::string& szFilename, const std::string& szOutput )
+		{
+			return kv::Writer::WriteFileAtomic( szFilename.c_str(), szOutput.data(), szOutput.size() );
+		}, m_szFilename, writer.GetOutput()
+	);
+}
+
+void CBaseSettings::WaitForSave()
+{
+	if( !m_PendingSave.valid() )
+		return;
+
+	if( !m_PendingSave.get() )
+		Error( "Failed to save settings to \"%s\"!\n", m_szFilename.c_str() );
+}
+
+bool CBaseSettings::GetPrefetchRequest( CFilePrefetcher::Request_t& request ) const
+{
+	if( !fs_prefetch.GetBool() )
+		return false;
+
+	AddPrefetchFiles( request.files );
+
+	request.uiMappedFiles = static_cast<size_t>( std::max( 0, fs_prefetch_headers.GetInt() ) );
+
+	//The game configurations panel shows these.
+	for( const auto& config : m_ConfigManager->GetConfigs() )
+	{
+		request.paths.emplace_back( config->GetBasePath() );
+	}
+
+	GetSearchDirectories( request.directories );
+
+	return true;
+}
+
+void CBaseSettings::GetSearchDirectories( std::vector<std::string>& directories ) const
+{
+	auto activeConfig = m_ConfigManager->GetActiveConfig();
+
+	if( !activeConfig )
+		return;
+
+	const char* const* ppszDirectoryExts;
+
+	const size_t uiNumExts = m_pFileSystem->GetSteamPipeDirectoryExtensions( ppszDirectoryExts );
+
+	CString szPath;
+
+	//Same search paths as InitializeFileSystem.
+	auto addDirectories = [ & ]( const char* const pszDir )
+	{
+		for( size_t uiIndex = 0; uiIndex < uiNumExts; ++uiIndex )
+		{
+			szPath.Format( "%s/%s%s", activeConfig->GetBasePath(), pszDir, ppszDirectoryExts[ uiIndex ] );
+
+			directories.emplace_back( szPath.CStr() );
+		}
+	};
+
+	if( strcmp( activeConfig->GetGameDir(), activeConfig->GetModDir() ) )
+		addDirectories( activeConfig->GetModDir() );
+
+	addDirectories( activeConfig->GetGameDir() );
 }
 
 bool CBaseSettings::InitializeFileSystem()
@@ -139,6 +264,8 @@ bool CBaseSettings::InitializeFileSystem()
 
 bool CBaseSettings::InitializeFileSystem( const std::shared_ptr<const CGameConfig>& config )
 {
+	m_pFileSystem->SetSearchPathIndexing( fs_indexsearchpaths.GetBool() );
+
 	m_pFileSystem->SetBasePath( config->GetBasePath() );
 
 	CString szPath;
@@ -147,6 +274,26 @@ bool CBaseSettings::InitializeFileSystem( const std::shared_ptr<const CGameConfi
 
 	const size_t uiNumExts = m_pFileSystem->GetSteamPipeDirectoryExtensions( ppszDirectoryExts );
 
+	//Archives are added after their directory, so loose files override them. Archives are numbered from 0 without gaps.
+	auto addSearchPath = [ & ]( const char* const pszDir )
+	{
+		m_pFileSystem->AddSearchPath( pszDir );
+
+		CString szArchive;
+
+		for( unsigned int uiArchive = 0; ; ++uiArchive )
+		{
+			szArchive.Format( "%s/%s/pak%u.pak", config->GetBasePath(), pszDir, uiArchive );
+
+			if( !m_pFileSystem->FileExists( szArchive.CStr() ) )
+				break;
+
+			szArchive.Format( "%s/pak%u.pak", pszDir, uiArchive );
+
+			m_pFileSystem->AddSearchPath( szArchive.CStr() );
+		}
+	};
+
 	//Add mod dirs first, since they override game dirs.
 	if( strcmp( config->GetGameDir(), config->GetModDir() ) )
 	{
@@ -154,7 +301,7 @@ bool CBaseSettings::InitializeFileSystem( const std::shared_ptr<const CGameConfi
 		{
 			szPath.Format( "%s%s", config->GetModDir(), ppszDirectoryExts[ uiIndex ] );
 
-			m_pFileSystem->AddSearchPath( szPath.CStr() );
+			addSearchPath( szPath.CStr() );
 		}
 	}
 
@@ -162,7 +309,7 @@ bool CBaseSettings::InitializeFileSystem( const std::shared_ptr<const CGameConfi
 	{
 		szPath.Format( "%s%s", config->GetGameDir(), ppszDirectoryExts[ uiIndex ] );
 
-		m_pFileSystem->AddSearchPath( szPath.CStr() );
+		addSearchPath( szPath.CStr() );
 	}
 
 	return true;
@@ -202,7 +349,13 @@ bool CBaseSettings::SaveToFile( const char* const pszFilename )
 		return false;
 	}
 
-	return SaveToFile( writer );
+	if( !SaveToFile( writer ) )
+	{
+		writer.Discard();
+		return false;
+	}
+
+	return writer.Close();
 }
 
 bool CBaseSettings::LoadFromFile( const kv::Block& root )
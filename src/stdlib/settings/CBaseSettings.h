@@ -1,10 +1,16 @@
 #ifndef SETTINGS_CBASESETTINGS_H
 #define SETTINGS_CBASESETTINGS_H
 
+#include <chrono>
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "keyvalues/KVForward.h"
 
+#include "utility/CFilePrefetcher.h"
+
 #include "CGameConfig.h"
 
 namespace filesystem
@@ -27,6 +33,11 @@ public:
 
 	static const double MAX_FPS;
 
+	/**
+	*	Time that settings must be left unchanged before they're saved in the background, in seconds.
+	*/
+	static const double SAVE_DELAY;
+
 protected:
 	/**
 	*	Constructs a default settings instance.
@@ -101,6 +112,37 @@ public:
 	*/
 	bool SaveToFile( const char* const pszFilename );
 
+	/**
+	*	Marks the settings as changed. They're saved to the file they were initialized from in the background,
+	*	once they haven't changed for SAVE_DELAY seconds.
+	*	@see SaveIfChanged
+	*/
+	void MarkChanged();
+
+	/**
+	*	Saves the settings in the background if they've changed and the save delay has passed. Should be called regularly on the main thread.
+	*	Settings are written to memory on this thread, and the file is written on a worker thread.
+	*/
+	void SaveIfChanged();
+
+	/**
+	*	Waits for a background save to finish, if one is in progress.
+	*/
+	void WaitForSave();
+
+	/**
+	*	Gets the paths to prefetch after startup: files the tool is likely to open, the paths of all game configurations,
+	*	and the search paths of the active configuration.
+	*	@return Whether prefetching is enabled.
+	*/
+	bool GetPrefetchRequest( CFilePrefetcher::Request_t& request ) const;
+
+	/**
+	*	Gets the directories that the active configuration's search paths are made of, mod directory first.
+	*	@param directories Absolute paths of the directories are added to this list. Nothing is added if there is no active configuration.
+	*/
+	void GetSearchDirectories( std::vector<std::string>& directories ) const;
+
 protected:
 	/**
 	*	Called after this object has been initialized.
@@ -114,6 +156,12 @@ protected:
 	*/
 	virtual void PreShutdown( const char* const pszFilename ) {}
 
+	/**
+	*	Adds files that the tool is likely to open soon, most likely first.
+	*	@see GetPrefetchRequest
+	*/
+	virtual void AddPrefetchFiles( std::vector<std::string>& ) const {}
+
 	/**
 	*	Initializes the file system for the given configuration. Call the base class implementation first.
 	*	@param config Configuration to initialize with.
@@ -158,6 +206,20 @@ private:
 	double m_flFPS = DEFAULT_FPS;
 
 	bool m_bInitialized = false;
+
+	/**
+	*	File that the settings were initialized from, and that changes are saved to.
+	*/
+	std::string m_szFilename;
+
+	bool m_bChanged = false;
+
+	std::chrono::steady_clock::time_point m_LastChangeTime;
+
+	/**
+	*	Background save. Returns whether the file was written.
+	*/
+	std::future<bool> m_PendingSave;
 };
 }
 
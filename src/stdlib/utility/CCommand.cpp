@@ -43,54 +43,45 @@ bool CCommand::Initialize( const int iArgc, char** ppArgV )
 
 bool CCommand::Initialize( const int iArgc, void* pData, const GetArg getArg )
 {
-	m_iArgc = iArgc;
+	size_t uiArgsLength = 0;
 
-	char* pszCmdStrBuffer = m_szCommandString;
+	for( int iIndex = 0; iIndex < iArgc; ++iIndex )
+	{
+		uiArgsLength += strlen( getArg( pData, iIndex ) ) + 1;
+	}
 
-	char* pszArgVBuffer = m_szArgsBuffer;
+	m_ArgsBuffer.reserve( uiArgsLength );
+	m_ArgV.reserve( iArgc );
 
-	for( int iIndex = 0; iIndex < m_iArgc; ++iIndex )
+	for( int iIndex = 0; iIndex < iArgc; ++iIndex )
 	{
 		const char* pszToken = getArg( pData, iIndex );
 		const size_t uiLength = strlen( pszToken );
 
 		const bool bContainsSpace = strchr( pszToken, ' ' ) != nullptr;
 
-		if( bContainsSpace && ( MAX_LENGTH - ( pszCmdStrBuffer - m_szCommandString ) ) > 1 )
-			*pszCmdStrBuffer++ = '\"';
-
-		if( static_cast<size_t>( MAX_LENGTH - ( pszCmdStrBuffer - m_szCommandString ) ) > uiLength )
-		{
-			strncpy( pszCmdStrBuffer, pszToken, uiLength + 1 );
-			pszCmdStrBuffer += uiLength;
-		}
-		else //Token too large, handle error later
-			m_iArgc = 0;
+		if( iIndex > 0 )
+			m_szCommandString += ' ';
 
-		if( bContainsSpace && ( MAX_LENGTH - ( pszCmdStrBuffer - m_szCommandString ) ) > 1 )
-			*pszCmdStrBuffer++ = '\"';
+		if( bContainsSpace )
+			m_szCommandString += '\"';
 
-		if( iIndex < m_iArgc - 1 && ( MAX_LENGTH - ( pszCmdStrBuffer - m_szCommandString ) ) > 1 )
-			*pszCmdStrBuffer++ = ' ';
+		m_szCommandString.append( pszToken, uiLength );
 
-		//The command string buffer could not contain the entire string, abort
-		if( m_iArgc == 0 || ( pszCmdStrBuffer - m_szCommandString ) <= 0 )
-		{
-			m_iArgc = 0;
-			break;
-		}
+		if( bContainsSpace )
+			m_szCommandString += '\"';
 
-		//If the command string isn't overflowed yet, then the argV buffer can't be overflowed either
-		m_pArgV[ iIndex ] = pszArgVBuffer;
-		strncpy( pszArgVBuffer, pszToken, uiLength + 1 );
+		m_ArgV.push_back( m_ArgsBuffer.data() + m_ArgsBuffer.size() );
 
 		//Don't forget the null terminator for each argument
-		pszArgVBuffer += uiLength + 1;
+		m_ArgsBuffer.insert( m_ArgsBuffer.end(), pszToken, pszToken + uiLength + 1 );
 
 		if( iIndex == 0 )
 			m_uiCommandNameLength = uiLength;
 	}
 
+	m_iArgc = iArgc;
+
 	return m_iArgc > 0;
 }
 
@@ -106,64 +97,42 @@ bool CCommand::Initialize( const char* pszCommand )
 
 	Reset();
 
-	{
-		const size_t uiLength = strlen( pszCommand );
+	const size_t uiLength = strlen( pszCommand );
 
-		if( uiLength >= MAX_LENGTH )
-			return false;
+	m_szCommandString.assign( pszCommand, uiLength );
 
-		strncpy( m_szCommandString, pszCommand, sizeof( m_szCommandString ) );
-	}
+	//Every token takes up at least one character, so this holds all of them with their null terminators.
+	m_ArgsBuffer.reserve( uiLength * 2 );
 
-	char szBuffer[ tokenization::MINIMUM_BUFFER_SIZE ];
+	const char* const pszEnd = pszCommand + uiLength;
 
-	char* pszArgVBuffer = m_szArgsBuffer;
+	tokenization::TokenView_t token;
 
 	while( 1 )
 	{
 		// skip whitespace up to a /n
-		while( *pszCommand && ( *pszCommand ) <= ' ' && *pszCommand != '\n' )
+		while( pszCommand < pszEnd && ( *pszCommand ) <= ' ' && *pszCommand != '\n' )
 			++pszCommand;
 
-		if( *pszCommand == '\n' )
-		{
-			// a newline seperates commands in the buffer
-			++pszCommand;
+		// a newline seperates commands in the buffer
+		if( pszCommand == pszEnd || *pszCommand == '\n' )
 			break;
-		}
 
-		if( !( *pszCommand ) )
-			break;
-
-		pszCommand = tokenization::Parse( pszCommand, szBuffer, sizeof( szBuffer ) );
+		//Tokens are copied straight from the command into the arguments buffer.
+		pszCommand = tokenization::ParseView( pszCommand, pszEnd, token );
 		if( !pszCommand ) break;
 
-		const size_t uiLength = strlen( szBuffer );
+		m_ArgV.push_back( m_ArgsBuffer.data() + m_ArgsBuffer.size() );
 
-		if( m_iArgc < MAX_TOKENS )
-		{
-			if( uiLength < static_cast<size_t>( MAX_LENGTH - ( pszArgVBuffer - m_szArgsBuffer ) ) )
-			{
-				m_pArgV[ m_iArgc ] = pszArgVBuffer;
-
-				strncpy( pszArgVBuffer, szBuffer, uiLength + 1 );
-
-				//Don't forget the null terminator for each argument
-				pszArgVBuffer += uiLength + 1;
-
-				++m_iArgc;
-			}
-			else
-			{
-				m_iArgc = 0;
-				break;
-			}
-		}
+		m_ArgsBuffer.insert( m_ArgsBuffer.end(), token.pszBegin, token.pszBegin + token.uiLength );
+		m_ArgsBuffer.push_back( '\0' );
 
-		if( m_iArgc == 1 )
-			m_uiCommandNameLength = uiLength;
+		if( m_ArgV.size() == 1 )
+			m_uiCommandNameLength = token.uiLength;
 	}
 
+	m_iArgc = static_cast<int>( m_ArgV.size() );
+
 	return m_iArgc > 0;
 }
 
@@ -208,22 +177,24 @@ void CCommand::Reset()
 {
 	m_iArgc = 0;
 	m_uiCommandNameLength = 0;
-	m_szCommandString[ 0 ] = '\0';
+	m_szCommandString.clear();
+	m_ArgsBuffer.clear();
+	m_ArgV.clear();
 }
 
 const char* CCommand::GetCommandString() const
 {
-	return m_iArgc ? m_szCommandString : "";
+	return m_iArgc ? m_szCommandString.c_str() : "";
 }
 
 const char* CCommand::GetArgumentsString() const
 {
-	return m_uiCommandNameLength ? &m_szCommandString[ m_uiCommandNameLength ] : "";
+	return m_uiCommandNameLength ? m_szCommandString.c_str() + m_uiCommandNameLength : "";
 }
 
 const char* const* CCommand::ArgV() const
 {
-	return m_pArgV;
+	return m_ArgV.data();
 }
 
 const char* CCommand::operator[]( const int iIndex ) const
@@ -240,7 +211,7 @@ const char* CCommand::Arg( const int iIndex ) const
 		return "";
 	}
 
-	return m_pArgV[ iIndex ];
+	return m_ArgV[ iIndex ];
 }
 
 const char* CCommand::FindArg( const char* pszArgument ) const
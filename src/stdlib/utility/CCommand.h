@@ -1,6 +1,10 @@
 #ifndef UTILITY_CCOMMAND_H
 #define UTILITY_CCOMMAND_H
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
 namespace util
 {
 /**
@@ -10,12 +14,8 @@ class CCommand final
 {
 public:
 	/**
-	*	Maximum number of arguments that can be stored by this command.
-	*/
-	static const size_t MAX_TOKENS = 80;
-
-	/**
-	*	Maximum length that the entire command string can be, including null terminator.
+	*	Maximum length of commands read into fixed buffers, including null terminator.
+	*	Commands themselves have no length or argument count limit.
 	*/
 	static const size_t MAX_LENGTH = 512;
 
@@ -156,17 +156,18 @@ private:
 	/**
 	*	Contains the original command string, with quotes added if a string contains spaces.
 	*/
-	char m_szCommandString[ MAX_LENGTH ];
+	std::string m_szCommandString;
 
 	/**
-	*	Contains a series of null terminated strings.
+	*	Contains a series of null terminated strings. Reserved up front, so it never moves while arguments are added.
+	*	Kept between commands so reused commands don't allocate.
 	*/
-	char m_szArgsBuffer[ MAX_LENGTH ];
+	std::vector<char> m_ArgsBuffer;
 
 	/**
-	*	Points into m_szArgsBuffer.
+	*	Points into m_ArgsBuffer.
 	*/
-	char* m_pArgV[ MAX_TOKENS ];
+	std::vector<const char*> m_ArgV;
 };
 }
 
@@ -8,11 +8,13 @@
 CEscapeSequences::CEscapeSequences( const char cDelimiterChar, const size_t uiCount, const ConversionData_t* const pData )
 	: m_cDelimiterChar( cDelimiterChar )
 	, m_uiCount( uiCount )
+	, m_bHasCharToSeq( true )
 {
 	assert( pData );
 
 	memset( m_Infos, 0, sizeof( m_Infos ) );
 	memset( m_IndexToSeq, 0, sizeof( m_IndexToSeq ) );
+	memset( m_CharToSeq, INVALID_CHAR, sizeof( m_CharToSeq ) );
 
 	for( size_t uiIndex = 0; uiIndex < m_uiCount; ++uiIndex )
 	{
@@ -24,23 +26,36 @@ CEscapeSequences::CEscapeSequences( const char cDelimiterChar, const size_t uiCo
 
 		info.pszString = pData[ uiIndex ].pszString;
 		info.uiLength = strlen( info.pszString );
+
+		if( info.uiLength == 2 && info.pszString[ 0 ] == m_cDelimiterChar )
+			m_CharToSeq[ static_cast<unsigned char>( info.pszString[ 1 ] ) ] = m_IndexToSeq[ uiIndex ];
+		else
+			m_bHasCharToSeq = false;
 	}
 }
 
 const char* CEscapeSequences::GetString( const char cEscapeSequence ) const
 {
-	return m_Infos[ static_cast<size_t>( cEscapeSequence ) ].pszString;
+	return m_Infos[ static_cast<unsigned char>( cEscapeSequence ) ].pszString;
 }
 
 size_t CEscapeSequences::GetStringLength( const char cEscapeSequence ) const
 {
-	return m_Infos[ static_cast<size_t>( cEscapeSequence ) ].uiLength;
+	return m_Infos[ static_cast<unsigned char>( cEscapeSequence ) ].uiLength;
 }
 
 char CEscapeSequences::GetEscapeSequence( const char* const pszString ) const
 {
 	assert( pszString );
 
+	if( m_bHasCharToSeq )
+	{
+		if( *pszString != m_cDelimiterChar )
+			return INVALID_CHAR;
+
+		return m_CharToSeq[ static_cast<unsigned char>( pszString[ 1 ] ) ];
+	}
+
 	for( size_t uiIndex = 0; uiIndex < m_uiCount; ++uiIndex )
 	{
 		const ConversionInfo_t& info = m_Infos[ m_IndexToSeq[ uiIndex ] ];
@@ -52,6 +67,66 @@ char CEscapeSequences::GetEscapeSequence( const char* const pszString ) const
 	return INVALID_CHAR;
 }
 
+size_t CEscapeSequences::GetEscapedLength( const char* const pszSource, const size_t uiLength ) const
+{
+	assert( pszSource || !uiLength );
+
+	size_t uiEscapedLength = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	{
+		const ConversionInfo_t& info = m_Infos[ static_cast<unsigned char>( pszSource[ uiIndex ] ) ];
+
+		uiEscapedLength += info.pszString ? info.uiLength : 1;
+	}
+
+	return uiEscapedLength;
+}
+
+size_t CEscapeSequences::Escape( const char* const pszSource, const size_t uiLength, char* pszDest ) const
+{
+	assert( pszSource || !uiLength );
+	assert( pszDest || !uiLength );
+
+	char* const pszBegin = pszDest;
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	{
+		const ConversionInfo_t& info = m_Infos[ static_cast<unsigned char>( pszSource[ uiIndex ] ) ];
+
+		if( info.pszString )
+		{
+			memcpy( pszDest, info.pszString, info.uiLength );
+			pszDest += info.uiLength;
+		}
+		else
+			*pszDest++ = pszSource[ uiIndex ];
+	}
+
+	return pszDest - pszBegin;
+}
+
+size_t CEscapeSequences::Unescape( const char* const pszSource, const size_t uiLength, char* pszDest ) const
+{
+	assert( pszSource || !uiLength );
+	assert( pszDest || !uiLength );
+
+	char* const pszBegin = pszDest;
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; )
+	{
+		if( pszSource[ uiIndex ] == m_cDelimiterChar && uiIndex + 1 < uiLength )
+		{
+			*pszDest++ = m_bHasCharToSeq ? m_CharToSeq[ static_cast<unsigned char>( pszSource[ uiIndex + 1 ] ) ] : GetEscapeSequence( &pszSource[ uiIndex ] );
+			uiIndex += 2;
+		}
+		else
+			*pszDest++ = pszSource[ uiIndex++ ];
+	}
+
+	return pszDest - pszBegin;
+}
+
 BEGIN_ESCAPE_SEQ_LIST( EscapeSequences )
 	{ '\"', "\\\"" },
 	{ '\'', "\\\'" },
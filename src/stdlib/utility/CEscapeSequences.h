@@ -1,6 +1,8 @@
 #ifndef CESCAPESEQUENCES_H
 #define CESCAPESEQUENCES_H
 
+#include <cstddef>
+
 /**
 * This class represents a mapping of escape sequences to their string versions
 * E.g. \n becomes \\n
@@ -33,11 +35,37 @@ public:
 
 	char GetEscapeSequence( const char* const pszString ) const;
 
+	/**
+	*	Gets the length of text once its escape sequences are converted to strings.
+	*/
+	size_t GetEscapedLength( const char* const pszSource, const size_t uiLength ) const;
+
+	/**
+	*	Converts escape sequences in text to their strings in one pass.
+	*	@param pszSource Text to convert. Does not have to be null terminated.
+	*	@param uiLength Number of characters in pszSource.
+	*	@param pszDest Buffer that receives the converted text. Must hold GetEscapedLength characters. Not null terminated.
+	*	@return Number of characters written.
+	*/
+	size_t Escape( const char* const pszSource, const size_t uiLength, char* pszDest ) const;
+
+	/**
+	*	Converts strings in text back to their escape sequences in one pass. The strings must have been validated with GetEscapeSequence,
+	*	and must be the delimiter followed by one character.
+	*	@param pszSource Text to convert. Does not have to be null terminated.
+	*	@param uiLength Number of characters in pszSource.
+	*	@param pszDest Buffer that receives the converted text. Must hold uiLength characters. Not null terminated.
+	*	@return Number of characters written.
+	*/
+	size_t Unescape( const char* const pszSource, const size_t uiLength, char* pszDest ) const;
+
 private:
 	const char m_cDelimiterChar;		//Which character indicates a conversion is required when converting from string to sequence
 	const size_t m_uiCount;				//Number of mappings
 	ConversionInfo_t m_Infos[ 256 ];	//Escape sequence is an index into this array
 	char m_IndexToSeq[ 256 ];			//Maps an index to an escape sequence
+	char m_CharToSeq[ 256 ];			//Maps the character after the delimiter to an escape sequence, or INVALID_CHAR
+	bool m_bHasCharToSeq;				//Whether every string is the delimiter followed by one character, so m_CharToSeq can be used
 
 private:
 	CEscapeSequences( const CEscapeSequences& ) = delete;
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <experimental/filesystem>
+#include <system_error>
+
+#include "shared/Logging.h"
+
+#include "CMappedFile.h"
+#include "PlatUtils.h"
+
+#include "CFilePrefetcher.h"
+
+CFilePrefetcher::~CFilePrefetcher()
+{
+	Stop();
+}
+
+void CFilePrefetcher::Start( Request_t&& request )
+{
+	Stop();
+
+	m_bCancel = false;
+	m_bRunning = true;
+	m_uiPrefetchedCount = 0;
+
+	m_Thread = std::thread( &CFilePrefetcher::WorkerMain, this, std::move( request ) );
+}
+
+void CFilePrefetcher::Stop()
+{
+	if( !m_Thread.joinable() )
+		return;
+
+	m_bCancel = true;
+
+	m_Thread.join();
+
+	m_bRunning = false;
+}
+
+void CFilePrefetcher::WorkerMain( const Request_t request )
+{
+	namespace fs = std::experimental::filesystem;
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	std::error_code error;
+
+	auto stat = [ & ]( const std::string& szPath )
+	{
+		static_cast<void>( fs::status( szPath, error ) );
+		++m_uiPrefetchedCount;
+	};
+
+	for( size_t uiIndex = 0; uiIndex < request.files.size() && !m_bCancel; ++uiIndex )
+	{
+		stat( request.files[ uiIndex ] );
+
+		if( uiIndex < request.uiMappedFiles )
+			MapFile( request.files[ uiIndex ], request.uiMappedBytes );
+	}
+
+	for( size_t uiIndex = 0; uiIndex < request.paths.size() && !m_bCancel; ++uiIndex )
+	{
+		stat( request.paths[ uiIndex ] );
+	}
+
+	//Walking a directory reads its entries and the attributes of every file in it, which is what lookups and indexing need later on.
+	for( size_t uiIndex = 0; uiIndex < request.directories.size() && !m_bCancel; ++uiIndex )
+	{
+		for( fs::recursive_directory_iterator it( request.directories[ uiIndex ], error ), end; !error && it != end && !m_bCancel; it.increment( error ) )
+		{
+			static_cast<void>( it->status( error ) );
+			++m_uiPrefetchedCount;
+		}
+
+		error.clear();
+	}
+
+	if( !m_bCancel )
+	{
+		const double flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+		Message( "Prefetched %u paths in %.2f seconds\n", static_cast<unsigned int>( m_uiPrefetchedCount ), flSeconds );
+	}
+
+	m_bRunning = false;
+}
+
+void CFilePrefetcher::MapFile( const std::string& szFilename, const size_t uiBytes )
+{
+	CMappedFile file;
+
+	if( !file.Open( szFilename.c_str() ) )
+		return;
+
+	const unsigned char* const pData = static_cast<const unsigned char*>( file.GetData() );
+
+	const size_t uiSize = std::min( file.GetSize(), uiBytes );
+
+	const size_t uiPageSize = plat::GetPageSize();
+
+	volatile unsigned char uSink = 0;
+
+	//Touching a page makes the system read it in; the mapping is dropped right after, but the pages stay cached.
+	for( size_t uiOffset = 0; uiOffset < uiSize && !m_bCancel; uiOffset += uiPageSize )
+	{
+		uSink = uSink + pData[ uiOffset ];
+	}
+}
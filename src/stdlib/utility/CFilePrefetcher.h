@@ -0,0 +1,93 @@
+#ifndef STDLIB_UTILITY_CFILEPREFETCHER_H
+#define STDLIB_UTILITY_CFILEPREFETCHER_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+*	Warms the operating system's file caches on a background thread, so the first time files are opened is as fast as later times.
+*	Paths are stat'ed, directories are walked, and the start of the most likely files is read through a mapping.
+*	Nothing is kept in memory; only the operating system's caches are affected.
+*/
+class CFilePrefetcher final
+{
+public:
+	/**
+	*	Default number of bytes read from the start of each mapped file. Enough for the headers of most files.
+	*/
+	static const size_t DEFAULT_MAPPED_BYTES = 64 * 1024;
+
+	struct Request_t
+	{
+		/**
+		*	Files that are likely to be opened, most likely first.
+		*/
+		std::vector<std::string> files;
+
+		/**
+		*	Other paths to stat, such as directories that are shown to the user.
+		*/
+		std::vector<std::string> paths;
+
+		/**
+		*	Directories whose contents are walked recursively.
+		*/
+		std::vector<std::string> directories;
+
+		/**
+		*	Number of files at the start of files whose start is read.
+		*/
+		size_t uiMappedFiles = 0;
+
+		size_t uiMappedBytes = DEFAULT_MAPPED_BYTES;
+	};
+
+public:
+	CFilePrefetcher() = default;
+	~CFilePrefetcher();
+
+	/**
+	*	@return Whether a prefetch is in progress.
+	*/
+	bool IsRunning() const { return m_bRunning; }
+
+	/**
+	*	Starts prefetching in the background. Stops the previous prefetch first.
+	*/
+	void Start( Request_t&& request );
+
+	/**
+	*	Stops prefetching as soon as possible and waits for the thread to exit.
+	*/
+	void Stop();
+
+	/**
+	*	@return Number of paths that have been prefetched since the last call to Start.
+	*/
+	size_t GetPrefetchedCount() const { return m_uiPrefetchedCount; }
+
+private:
+	void WorkerMain( const Request_t request );
+
+	/**
+	*	Reads one byte of every page in the first uiBytes bytes of the given file.
+	*/
+	void MapFile( const std::string& szFilename, const size_t uiBytes );
+
+private:
+	std::thread m_Thread;
+
+	std::atomic<bool> m_bCancel{ false };
+	std::atomic<bool> m_bRunning{ false };
+
+	std::atomic<size_t> m_uiPrefetchedCount{ 0 };
+
+private:
+	CFilePrefetcher( const CFilePrefetcher& ) = delete;
+	CFilePrefetcher& operator=( const CFilePrefetcher& ) = delete;
+};
+
+#endif //STDLIB_UTILITY_CFILEPREFETCHER_H
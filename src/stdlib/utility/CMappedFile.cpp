@@ -0,0 +1,142 @@
+#include <cstring>
+#include <memory>
+
+#include "core/shared/Platform.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "CMappedFile.h"
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+bool CMappedFile::Open( const char* const pszFilename )
+{
+	Close();
+
+	if( !pszFilename )
+		return false;
+
+#ifdef WIN32
+	HANDLE hFile = CreateFileA( pszFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER size;
+
+	if( !GetFileSizeEx( hFile, &size ) || size.QuadPart == 0 || static_cast<unsigned long long>( size.QuadPart ) > static_cast<size_t>( -1 ) )
+	{
+		CloseHandle( hFile );
+		return false;
+	}
+
+	//PAGE_WRITECOPY makes written pages private copies.
+	HANDLE hMapping = CreateFileMappingA( hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+
+	//The view keeps the file open, so the handles aren't needed after this.
+	CloseHandle( hFile );
+
+	if( !hMapping )
+		return false;
+
+	void* pData = MapViewOfFile( hMapping, FILE_MAP_COPY, 0, 0, 0 );
+
+	CloseHandle( hMapping );
+
+	if( !pData )
+		return false;
+
+	m_pData = pData;
+	m_uiSize = static_cast<size_t>( size.QuadPart );
+#else
+	const int fd = open( pszFilename, O_RDONLY );
+
+	if( fd == -1 )
+		return false;
+
+	struct stat info;
+
+	if( fstat( fd, &info ) != 0 || info.st_size <= 0 )
+	{
+		close( fd );
+		return false;
+	}
+
+	//MAP_PRIVATE makes written pages private copies.
+	void* pData = mmap( nullptr, static_cast<size_t>( info.st_size ), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+
+	//The mapping keeps the file open, so the descriptor isn't needed after this.
+	close( fd );
+
+	if( pData == MAP_FAILED )
+		return false;
+
+	m_pData = pData;
+	m_uiSize = static_cast<size_t>( info.st_size );
+#endif
+
+	return true;
+}
+
+bool CMappedFile::Detach()
+{
+	if( !m_pData )
+		return false;
+
+	if( m_bDetached )
+		return true;
+
+	std::unique_ptr<unsigned char[]> copy( new unsigned char[ m_uiSize ] );
+
+	memcpy( copy.get(), m_pData, m_uiSize );
+
+#ifdef WIN32
+	//There is no way to replace a view in place, so unmap it and allocate memory at the same address.
+	//This can only fail if another thread allocates memory in that range in between.
+	UnmapViewOfFile( m_pData );
+
+	if( VirtualAlloc( m_pData, m_uiSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ) != m_pData )
+	{
+		m_pData = nullptr;
+		m_uiSize = 0;
+		return false;
+	}
+#else
+	//MAP_FIXED atomically replaces the file's pages with anonymous memory.
+	if( mmap( m_pData, m_uiSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 ) == MAP_FAILED )
+		return false;
+#endif
+
+	memcpy( m_pData, copy.get(), m_uiSize );
+
+	m_bDetached = true;
+
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if( !m_pData )
+		return;
+
+#ifdef WIN32
+	if( m_bDetached )
+		VirtualFree( m_pData, 0, MEM_RELEASE );
+	else
+		UnmapViewOfFile( m_pData );
+#else
+	munmap( m_pData, m_uiSize );
+#endif
+
+	m_pData = nullptr;
+	m_uiSize = 0;
+	m_bDetached = false;
+}
@@ -0,0 +1,66 @@
+#ifndef STDLIB_UTILITY_CMAPPEDFILE_H
+#define STDLIB_UTILITY_CMAPPEDFILE_H
+
+#include <cstddef>
+
+/**
+*	Maps a file into memory. The mapping is private: pages are read from the file on first access,
+*	and writes are made to copies of the pages that are never written back to the file.
+*/
+class CMappedFile final
+{
+public:
+	CMappedFile() = default;
+	~CMappedFile();
+
+	/**
+	*	@return Whether a file is mapped.
+	*/
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	/**
+	*	Maps the given file. Closes the current file first.
+	*	@param pszFilename Name of the file to map.
+	*	@return Whether the file was mapped. Empty files cannot be mapped.
+	*/
+	bool Open( const char* const pszFilename );
+
+	/**
+	*	Copies the file's data into memory that is not backed by the file, at the same address, so pointers to the data remain valid.
+	*	After this the file can be overwritten or replaced. Does nothing if the data is already detached.
+	*	@return Whether the data is no longer backed by the file.
+	*/
+	bool Detach();
+
+	/**
+	*	@return Whether the data has been detached from the file.
+	*/
+	bool IsDetached() const { return m_bDetached; }
+
+	/**
+	*	Unmaps the file. All pointers to its data become invalid.
+	*/
+	void Close();
+
+	/**
+	*	@return The file's data, or null if no file is mapped.
+	*/
+	void* GetData() const { return m_pData; }
+
+	/**
+	*	@return Size of the file, in bytes.
+	*/
+	size_t GetSize() const { return m_uiSize; }
+
+private:
+	void* m_pData = nullptr;
+	size_t m_uiSize = 0;
+
+	bool m_bDetached = false;
+
+private:
+	CMappedFile( const CMappedFile& ) = delete;
+	CMappedFile& operator=( const CMappedFile& ) = delete;
+};
+
+#endif //STDLIB_UTILITY_CMAPPEDFILE_H
@@ -0,0 +1,82 @@
+#ifndef STDLIB_UTILITY_CSCRATCHBUFFER_H
+#define STDLIB_UTILITY_CSCRATCHBUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+/**
+*	Growable storage for temporary results. Sized to what is actually needed instead of a worst case limit,
+*	and kept between uses so that repeated work of the same size doesn't allocate.
+*	Storage is aligned to a cache line so kernels can rely on it, and contents are not preserved when it grows.
+*/
+template<typename T, size_t ALIGNMENT = 64>
+class CScratchBuffer final
+{
+public:
+	static_assert( std::is_trivially_destructible<T>::value, "Scratch buffers only hold plain data" );
+	static_assert( ( ALIGNMENT & ( ALIGNMENT - 1 ) ) == 0 && ALIGNMENT >= alignof( T ), "Alignment must be a power of 2 that suits the type" );
+
+public:
+	CScratchBuffer() = default;
+	~CScratchBuffer() = default;
+
+	/**
+	*	@return The storage, or null if nothing has been reserved yet.
+	*/
+	T* Get() { return m_pData; }
+	const T* Get() const { return m_pData; }
+
+	/**
+	*	@return Number of elements that fit in the storage.
+	*/
+	size_t GetCapacity() const { return m_uiCapacity; }
+
+	/**
+	*	Makes sure that at least uiCount elements fit. Existing contents are lost if the storage has to grow.
+	*	@return The storage.
+	*/
+	T* Reserve( const size_t uiCount )
+	{
+		if( uiCount > m_uiCapacity )
+		{
+			//Grow by at least half so models that are slightly bigger each time don't reallocate every time.
+			const size_t uiCapacity = std::max( uiCount, m_uiCapacity + m_uiCapacity / 2 );
+
+			//Over-allocate so the start can be aligned.
+			std::unique_ptr<unsigned char[]> memory( new unsigned char[ uiCapacity * sizeof( T ) + ALIGNMENT - 1 ] );
+
+			const uintptr_t uiStart = ( reinterpret_cast<uintptr_t>( memory.get() ) + ALIGNMENT - 1 ) & ~static_cast<uintptr_t>( ALIGNMENT - 1 );
+
+			m_Memory = std::move( memory );
+			m_pData = reinterpret_cast<T*>( uiStart );
+			m_uiCapacity = uiCapacity;
+		}
+
+		return m_pData;
+	}
+
+	/**
+	*	Frees the storage.
+	*/
+	void Clear()
+	{
+		m_Memory.reset();
+		m_pData = nullptr;
+		m_uiCapacity = 0;
+	}
+
+private:
+	std::unique_ptr<unsigned char[]> m_Memory;
+
+	T* m_pData = nullptr;
+	size_t m_uiCapacity = 0;
+
+private:
+	CScratchBuffer( const CScratchBuffer& ) = delete;
+	CScratchBuffer& operator=( const CScratchBuffer& ) = delete;
+};
+
+#endif //STDLIB_UTILITY_CSCRATCHBUFFER_H
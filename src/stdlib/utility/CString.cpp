@@ -161,6 +161,31 @@ CString::CString( const CString& other )
 	*this = other;
 }
 
+CString::CString( CString&& other ) noexcept
+{
+	Construct();
+
+	MoveFrom( other );
+}
+
+void CString::MoveFrom( CString& other )
+{
+	if( other.m_pszString == other.m_szBuffer )
+	{
+		memcpy( m_szBuffer, other.m_szBuffer, other.m_uiLength + 1 );
+	}
+	else
+	{
+		//Heap allocated and static strings can just be handed over.
+		m_pszString = other.m_pszString;
+		m_uiCapacity = other.m_uiCapacity;
+	}
+
+	m_uiLength = other.m_uiLength;
+
+	other.Construct();
+}
+
 CString::CString( char* pszString, const bool bTakeOwnership )
 {
 	Construct();
@@ -173,7 +198,7 @@ CString::CString( char* pszString, const bool bTakeOwnership )
 
 CString& CString::TakeOwnership( char* pszString )
 {
-	if( m_pszString && m_pszString != m_szBuffer )
+	if( GetDynamicAllocation() )
 	{
 		delete[] m_pszString;
 		m_pszString = nullptr;
@@ -185,6 +210,7 @@ CString& CString::TakeOwnership( char* pszString )
 
 		m_pszString = pszString;
 
+		SetStatic( false );
 		SetCapacity( m_uiLength + 1 );
 	}
 	else
@@ -292,6 +318,34 @@ CString& CString::Assign( const CString& other, size_type uiBegin, size_type uiC
 	return Assign( other.CStr(), uiBegin, uiCount );
 }
 
+CString& CString::AssignN( const char* pszString, const size_type uiLength )
+{
+	assert( pszString || !uiLength );
+
+	Reserve( uiLength );
+
+	memcpy( m_pszString, pszString, uiLength );
+
+	m_pszString[ uiLength ] = '\0';
+
+	m_uiLength = uiLength;
+
+	return *this;
+}
+
+CString& CString::AssignStatic( const char* pszString, const size_type uiLength )
+{
+	assert( pszString );
+	assert( pszString[ uiLength ] == '\0' );
+
+	if( GetDynamicAllocation() )
+		delete[] m_pszString;
+
+	SetStaticString( pszString, uiLength );
+
+	return *this;
+}
+
 CString& CString::operator=( const CString& other )
 {
 	assert( this != &other );
@@ -301,6 +355,21 @@ CString& CString::operator=( const CString& other )
 	return *this;
 }
 
+CString& CString::operator=( CString&& other ) noexcept
+{
+	if( this != &other )
+	{
+		if( GetDynamicAllocation() )
+			delete[] m_pszString;
+
+		Construct();
+
+		MoveFrom( other );
+	}
+
+	return *this;
+}
+
 CString& CString::operator=( const bool fValue )
 {
 	return ( *this = String::BoolToCharacter( fValue ) );
@@ -393,37 +462,40 @@ CString::size_type CString::GetDynamicAllocation() const
 
 void CString::Resize( size_type iNewSize )
 {
-	assert( !IsStatic() );
-
 	//Account for null terminator
 	++iNewSize;
 
-	if( GetCapacity() == iNewSize || IsStatic() )
+	if( GetCapacity() == iNewSize )
 		return;
 
-	//Always dynamically allocate when resizing
-	char* pszBuffer = new char[ iNewSize ];
+	//Strings that fit in the local buffer don't need to allocate
+	const bool bLocal = iNewSize <= BUFFER_SIZE;
 
-	if( m_pszString )
-	{
-		//The buffer might not contain a valid string
-		m_pszString[ Length() ] = '\0';
+	const size_type uiCopyLength = std::min( Length(), iNewSize - 1 );
 
-		//Copy only the required number of characters
-		strncpy( pszBuffer, m_pszString, iNewSize );
-		pszBuffer[ iNewSize - 1 ] = '\0';
-	}
-	else
+	if( bLocal && m_pszString == m_szBuffer )
 	{
-		memset( pszBuffer, 0, sizeof( char ) * iNewSize );
+		m_pszString[ uiCopyLength ] = '\0';
+		m_uiLength = uiCopyLength;
+
+		return;
 	}
 
-	if( m_pszString != m_szBuffer )
+	char* pszBuffer = bLocal ? m_szBuffer : new char[ iNewSize ];
+
+	//Copy only the required number of characters
+	memcpy( pszBuffer, m_pszString, uiCopyLength );
+	pszBuffer[ uiCopyLength ] = '\0';
+
+	if( GetDynamicAllocation() )
 		delete[] m_pszString;
 
 	m_pszString = pszBuffer;
+	m_uiLength = uiCopyLength;
 
-	SetCapacity( iNewSize );
+	//Static strings become dynamic once they're copied.
+	SetStatic( false );
+	SetCapacity( bLocal ? BUFFER_SIZE : iNewSize );
 }
 
 void CString::Reserve( size_type iMinimum )
@@ -433,7 +505,7 @@ void CString::Reserve( size_type iMinimum )
 		return;
 	}
 
-	Resize( iMinimum );
+	Resize( std::max( iMinimum, GetCapacity() * 2 ) );
 }
 
 void CString::Clear()
@@ -946,23 +1018,38 @@ void CString::Format( const char* pszFormat, ... )
 
 void CString::VFormat( const char* pszFormat, va_list list )
 {
-	char szBuffer[ PRINTF_BUFFER_SIZE ];
+	//Discard the current contents so growing the buffer doesn't copy them
+	Clear();
 
-	const int iLength = vsnprintf( szBuffer, sizeof( szBuffer ), pszFormat, list );
+	va_list retryList;
 
-	szBuffer[ sizeof( szBuffer ) - 1 ] = '\0';
+	va_copy( retryList, list );
 
-	if( iLength < 0 || iLength >= sizeof( szBuffer ) )
+	const int iLength = vsnprintf( m_pszString, GetCapacity(), pszFormat, list );
+
+	if( iLength < 0 )
 	{
+		va_end( retryList );
+
 		//Error does not use this method, so there is no risk of recursive calls
 		assert( !"Error formatting string" );
 
-		*this = "";
+		Clear();
 
 		return;
 	}
 
-	*this = szBuffer;
+	//Only formats again if the result didn't fit in the spare capacity.
+	if( static_cast<size_type>( iLength ) >= GetCapacity() )
+	{
+		Reserve( iLength );
+
+		vsnprintf( m_pszString, GetCapacity(), pszFormat, retryList );
+	}
+
+	va_end( retryList );
+
+	m_uiLength = iLength;
 }
 
 CString& CString::ToLowercase()
@@ -1062,57 +1149,99 @@ void CString::SetStaticString( const char* pszString, size_type iLength )
 
 	m_uiLength = iLength;
 
+	//Force modifications to copy the string.
+	SetCapacity( 0 );
 	SetStatic( true );
 }
 
 CString operator+( const CString& string, const char* pszString )
 {
-	return CString( string ) += pszString;
+	CString szResult( string );
+
+	szResult += pszString;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const CString& other )
 {
-	return CString( string ) += other;
+	CString szResult( string );
+
+	szResult += other;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const bool fValue )
 {
-	return CString( string ) += fValue;
+	CString szResult( string );
+
+	szResult += fValue;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const char character )
 {
-	return CString( string ) += character;
+	CString szResult( string );
+
+	szResult += character;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const int iValue )
 {
-	return CString( string ) += iValue;
+	CString szResult( string );
+
+	szResult += iValue;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const unsigned int uiValue )
 {
-	return CString( string ) += uiValue;
+	CString szResult( string );
+
+	szResult += uiValue;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const long long int iValue )
 {
-	return CString( string ) += iValue;
+	CString szResult( string );
+
+	szResult += iValue;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const unsigned long long int uiValue )
 {
-	return CString( string ) += uiValue;
+	CString szResult( string );
+
+	szResult += uiValue;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const float flValue )
 {
-	return CString( string ) += flValue;
+	CString szResult( string );
+
+	szResult += flValue;
+
+	return szResult;
 }
 
 CString operator+( const CString& string, const double flValue )
 {
-	return CString( string ) += flValue;
+	CString szResult( string );
+
+	szResult += flValue;
+
+	return szResult;
 }
 
 bool operator==( const char* pszString, const CString& other )
@@ -70,12 +70,14 @@ public:
 	static const CString WHITESPACE_CHARACTERS;
 
 private:
-	static const size_type BUFFER_SIZE = 20;	//At least this much memory is needed before dynamic allocation is required
+	//At least this much memory is needed before dynamic allocation is required
+	//Large enough for most keyvalue values, cvar values and short paths, including the null terminator
+	static const size_type BUFFER_SIZE = 32;
 
 	//m_iCapacity stores a flag that tells us whether the string is static or not
 	//Static strings need to allocate memory if modified
 	static const size_type STATIC_BIT = 31;
-	static const size_type STATIC_MASK = 1 << 31;
+	static const size_type STATIC_MASK = static_cast<size_type>( 1 ) << STATIC_BIT;
 	static const size_type ALLOC_MASK = STATIC_MASK - 1;
 
 public:
@@ -88,6 +90,11 @@ public:
 
 	CString( const CString& other );
 
+	/*
+	* Takes the other string's memory. The other string is left empty.
+	*/
+	CString( CString&& other ) noexcept;
+
 	//Allows the string object to take ownership of the pointer.
 	CString( char* pszString, const bool bTakeOwnership );
 
@@ -107,8 +114,21 @@ public:
 	CString& Assign( const char* pszString, size_type uiBegin, size_type uiCount );
 	CString& Assign( const CString& other, size_type uiBegin, size_type uiCount );
 
+	/*
+	* Assigns the first uiLength characters of pszString. pszString does not have to be null terminated, and must not point into this string.
+	*/
+	CString& AssignN( const char* pszString, const size_type uiLength );
+
+	/*
+	* Points this string at a null terminated string that it doesn't own. The string must outlive this object.
+	* No memory is allocated until the string is modified, at which point it is copied.
+	*/
+	CString& AssignStatic( const char* pszString, const size_type uiLength );
+
 	CString& operator=( const CString& other );
 
+	CString& operator=( CString&& other ) noexcept;
+
 	CString& operator=( const bool fValue );
 	CString& operator=( const char character );
 	CString& operator=( const int iValue );
@@ -147,6 +167,9 @@ public:
 
 	void Resize( size_type iNewSize );
 
+	/*
+	* Makes sure there is room for at least iMinimum characters. Capacity grows geometrically so repeated appends are amortized.
+	*/
 	void Reserve( size_type iMinimum );
 
 	/*
@@ -231,6 +254,9 @@ public:
 	size_type FindLastNotOf( const char* pszString, size_t uiStartIndex = 0, const String::CompareType compare = String::DEFAULT_COMPARE ) const;
 	size_type FindLastNotOf( const CString& str, size_t uiStartIndex = 0, const String::CompareType compare = String::DEFAULT_COMPARE ) const;
 
+	/*
+	* Formats directly into this string's buffer. The arguments must not point into this string.
+	*/
 	void Format( const char* pszFormat, ... );
 
 	void VFormat( const char* pszFormat, va_list list );
@@ -266,6 +292,11 @@ private:
 	*/
 	void Construct();
 
+	/*
+	* Takes the other string's memory and leaves it empty. This string must be in its default state.
+	*/
+	void MoveFrom( CString& other );
+
 	void Assign( const char* pszString, const size_type iLength );
 
 	void Append( const char* pszString, const size_type iLength );
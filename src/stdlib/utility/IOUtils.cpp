@@ -1,4 +1,8 @@
+#include <cassert>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "keyvalues/Keyvalues.h"
 
@@ -116,6 +120,64 @@ bool LoadArchiveCVars( const kv::Block& cvars )
 
 namespace
 {
+/**
+*	Sets the cvars in the first block whose path matches.
+*/
+class CArchiveCVarsHandler final : public kv::IKeyvaluesHandler
+{
+public:
+	CArchiveCVarsHandler( const char* pszBlockPath )
+	{
+		for( const char* pszEnd; ( pszEnd = strchr( pszBlockPath, '/' ) ) != nullptr; pszBlockPath = pszEnd + 1 )
+		{
+			m_Path.emplace_back( pszBlockPath, pszEnd );
+		}
+
+		m_Path.emplace_back( pszBlockPath );
+	}
+
+	bool OnBlockBegin( const CString& szKey ) override
+	{
+		++m_uiDepth;
+
+		//Only descend if all parent blocks matched.
+		if( m_uiMatched + 1 == m_uiDepth && m_uiMatched < m_Path.size() && m_Path[ m_uiMatched ] == szKey.CStr() )
+			++m_uiMatched;
+
+		return true;
+	}
+
+	bool OnKeyvalue( const CString& szKey, const CString& szValue ) override
+	{
+		if( m_uiMatched == m_Path.size() && m_uiDepth == m_Path.size() )
+			g_pCVar->SetCVarString( szKey.CStr(), szValue.CStr() );
+
+		return true;
+	}
+
+	bool OnBlockEnd() override
+	{
+		if( m_uiMatched == m_uiDepth )
+		{
+			//Done once the block itself has been read.
+			if( m_uiMatched == m_Path.size() )
+				return false;
+
+			--m_uiMatched;
+		}
+
+		--m_uiDepth;
+
+		return true;
+	}
+
+private:
+	std::vector<std::string> m_Path;
+
+	size_t m_uiDepth = 0;
+	size_t m_uiMatched = 0;
+};
+
 static void SaveArchiveCVarsCallback( void* pObject, const cvar::CCVar& cvar )
 {
 	auto& writer = *reinterpret_cast<kv::Writer*>( pObject );
@@ -124,6 +186,29 @@ static void SaveArchiveCVarsCallback( void* pObject, const cvar::CCVar& cvar )
 }
 }
 
+bool LoadArchiveCVars( const char* const pszFilename, const char* const pszBlockPath )
+{
+	assert( pszFilename );
+	assert( pszBlockPath );
+
+	kv::SAXParser parser( pszFilename );
+
+	if( !parser.HasInputData() )
+		return false;
+
+	CArchiveCVarsHandler handler( pszBlockPath );
+
+	const auto result = parser.Parse( handler );
+
+	if( result != kv::SAXParser::ParseResult::SUCCESS )
+	{
+		Error( "LoadArchiveCVars: Error parsing \"%s\": %s\n", pszFilename, kv::SAXParser::ParseResultToString( result ) );
+		return false;
+	}
+
+	return true;
+}
+
 bool SaveArchiveCVars( kv::Writer& writer, const char* const pszBlockName )
 {
 	writer.BeginBlock( pszBlockName );
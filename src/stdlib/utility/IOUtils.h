@@ -15,6 +15,15 @@ bool SaveColorCVarSetting( kv::Writer& writer, const char* const pszName, const
 
 bool LoadArchiveCVars( const kv::Block& cvars );
 
+/**
+*	Loads archived cvars straight from a keyvalues file, without building a tree.
+*	Parsing stops once the block has been read.
+*	@param pszFilename Name of the file.
+*	@param pszBlockPath Path to the block containing the cvars, with block names separated by '/'. The first matching block is used.
+*	@return Whether the file was parsed successfully. Returns true even if the block wasn't found.
+*/
+bool LoadArchiveCVars( const char* const pszFilename, const char* const pszBlockPath );
+
 bool SaveArchiveCVars( kv::Writer& writer, const char* const pszBlockName );
 
 #endif //UTILITY_IOUTILS_H
\ No newline at end of file
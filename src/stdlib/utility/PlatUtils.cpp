@@ -1,9 +1,14 @@
 #include <cassert>
+#include <cstdint>
 #include <vector>
 
 #include "core/shared/Platform.h"
 
-#ifndef WIN32
+#ifdef WIN32
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -66,4 +71,113 @@ std::string GetExeFileName( bool* pSuccess )
 
 	return "";
 }
+
+bool IsSSE2Supported()
+{
+	//SSE2 support is indicated by bit 26 of EDX for function 1.
+	const unsigned int SSE2_BIT = 1 << 26;
+
+#ifdef WIN32
+	int info[ 4 ];
+
+	__cpuid( info, 1 );
+
+	return ( static_cast<unsigned int>( info[ 3 ] ) & SSE2_BIT ) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+
+	if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+		return false;
+
+	return ( edx & SSE2_BIT ) != 0;
+#endif
+}
+
+bool IsSSSE3Supported()
+{
+	//SSSE3 support is indicated by bit 9 of ECX for function 1.
+	const unsigned int SSSE3_BIT = 1 << 9;
+
+#ifdef WIN32
+	int info[ 4 ];
+
+	__cpuid( info, 1 );
+
+	return ( static_cast<unsigned int>( info[ 2 ] ) & SSSE3_BIT ) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+
+	if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+		return false;
+
+	return ( ecx & SSSE3_BIT ) != 0;
+#endif
+}
+size_t GetPageSize()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+
+	return static_cast<size_t>( info.dwPageSize );
+#else
+	const long iSize = sysconf( _SC_PAGESIZE );
+
+	return iSize > 0 ? static_cast<size_t>( iSize ) : 4096;
+#endif
+}
+
+unsigned int GetProcessId()
+{
+#ifdef WIN32
+	return static_cast<unsigned int>( ::GetCurrentProcessId() );
+#else
+	return static_cast<unsigned int>( getpid() );
+#endif
+}
+
+size_t ReleasePages( void* pData, const size_t uiSize, const bool bFileBacked )
+{
+	static const size_t uiPageSize = GetPageSize();
+
+	const uintptr_t start = ( reinterpret_cast<uintptr_t>( pData ) + uiPageSize - 1 ) & ~( uiPageSize - 1 );
+	const uintptr_t end = ( reinterpret_cast<uintptr_t>( pData ) + uiSize ) & ~( uiPageSize - 1 );
+
+	if( end <= start )
+		return 0;
+
+	void* const pStart = reinterpret_cast<void*>( start );
+	const size_t uiBytes = end - start;
+
+#ifdef WIN32
+	if( bFileBacked )
+	{
+		//Unlocking pages that aren't locked fails, but still removes them from the working set.
+		VirtualUnlock( pStart, uiBytes );
+	}
+	else if( !VirtualAlloc( pStart, uiBytes, MEM_RESET, PAGE_READWRITE ) )
+	{
+		return 0;
+	}
+#else
+	//Private file pages are read from the file again when they're next used.
+	int iAdvice = MADV_DONTNEED;
+
+#ifdef MADV_FREE
+	//Anonymous pages are only freed once memory runs low, which is cheaper than zero filling them right away.
+	if( !bFileBacked )
+		iAdvice = MADV_FREE;
+#endif
+
+	if( madvise( pStart, uiBytes, iAdvice ) != 0 )
+	{
+		//Kernels older than MADV_FREE reject it.
+		if( iAdvice == MADV_DONTNEED || madvise( pStart, uiBytes, MADV_DONTNEED ) != 0 )
+			return 0;
+	}
+#endif
+
+	return uiBytes;
+}
 }
\ No newline at end of file
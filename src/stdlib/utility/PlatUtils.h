@@ -1,11 +1,54 @@
 #ifndef STDLIB_UTILITY_PLATUTILS_H
 #define STDLIB_UTILITY_PLATUTILS_H
 
+#include <cstddef>
 #include <string>
 
+/**
+*	Compiles a function for SSE2 or SSSE3 even though the rest of the build doesn't target them.
+*	SSE2 isn't guaranteed in 32 bit builds and SSSE3 isn't enabled by default, so functions marked with these
+*	must only be called if plat::IsSSE2Supported or plat::IsSSSE3Supported returns true.
+*	MSVC allows intrinsics in any function, so there they expand to nothing.
+*/
+#ifdef __GNUC__
+#define SSE2_TARGET __attribute__( ( target( "sse2" ) ) )
+#define SSSE3_TARGET __attribute__( ( target( "ssse3" ) ) )
+#else
+#define SSE2_TARGET
+#define SSSE3_TARGET
+#endif
+
 namespace plat
 {
 std::string GetExeFileName( bool* pSuccess = nullptr );
+
+/**
+*	@return Whether the CPU supports SSE2 instructions.
+*/
+bool IsSSE2Supported();
+
+/**
+*	@return Whether the CPU supports SSSE3 instructions.
+*/
+bool IsSSSE3Supported();
+
+/**
+*	@return Size of a memory page, in bytes.
+*/
+size_t GetPageSize();
+
+/**
+*	@return Identifier of the current process. Unique among the processes running on this machine.
+*/
+unsigned int GetProcessId();
+
+/**
+*	Tells the OS that the whole pages in a range of memory aren't needed right now, so they can be taken out of physical memory.
+*	Pages of mapped files are read from the file again when they're next used. Other pages lose their contents, and must be written to before they are read again.
+*	@param bFileBacked Whether the range belongs to a mapped file whose pages haven't been written to.
+*	@return Number of bytes that were released. Parts of the range that don't cover a whole page are kept.
+*/
+size_t ReleasePages( void* pData, const size_t uiSize, const bool bFileBacked );
 }
 
 #endif //STDLIB_UTILITY_PLATUTILS_H
\ No newline at end of file
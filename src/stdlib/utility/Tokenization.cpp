@@ -1,10 +1,157 @@
 #include <cassert>
 #include <cctype>
+#include <cstddef>
+
+#include <emmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "utility/PlatUtils.h"
 
 #include "Tokenization.h"
 
 namespace tokenization
 {
+namespace
+{
+/**
+*	Number of characters scanned at a time by the SIMD scanners.
+*/
+const ptrdiff_t SIMD_WIDTH = 16;
+
+inline int CountTrailingZeros( const unsigned int uiValue )
+{
+#ifdef _MSC_VER
+	unsigned long ulIndex;
+	_BitScanForward( &ulIndex, uiValue );
+	return static_cast<int>( ulIndex );
+#else
+	return __builtin_ctz( uiValue );
+#endif
+}
+
+bool IsSIMDScanSupported()
+{
+	static const bool bSupported = plat::IsSSE2Supported();
+
+	return bSupported;
+}
+
+/*
+*	Characters are compared as signed, like Parse does, so characters above 127 count as whitespace.
+*/
+
+/**
+*	@return Bit mask of the characters in chars that are part of a token: anything above a space.
+*/
+SSE2_TARGET inline int TokenCharMask( const __m128i chars )
+{
+	return _mm_movemask_epi8( _mm_cmpgt_epi8( chars, _mm_set1_epi8( ' ' ) ) );
+}
+
+/**
+*	@return Bit mask of the characters in chars that end a word: whitespace and control characters.
+*/
+SSE2_TARGET inline int WordEndMask( const __m128i chars )
+{
+	const __m128i controls = _mm_or_si128( _mm_or_si128(
+		_mm_or_si128( _mm_cmpeq_epi8( chars, _mm_set1_epi8( '{' ) ), _mm_cmpeq_epi8( chars, _mm_set1_epi8( '}' ) ) ),
+		_mm_or_si128( _mm_cmpeq_epi8( chars, _mm_set1_epi8( '(' ) ), _mm_cmpeq_epi8( chars, _mm_set1_epi8( ')' ) ) ) ),
+		_mm_or_si128( _mm_cmpeq_epi8( chars, _mm_set1_epi8( '\'' ) ), _mm_cmpeq_epi8( chars, _mm_set1_epi8( ',' ) ) ) );
+
+	return ( ~TokenCharMask( chars ) & 0xFFFF ) | _mm_movemask_epi8( controls );
+}
+
+SSE2_TARGET const char* FindTokenCharSIMD( const char* pszBegin, const char* const pszEnd )
+{
+	for( ; pszEnd - pszBegin >= SIMD_WIDTH; pszBegin += SIMD_WIDTH )
+	{
+		const int iMask = TokenCharMask( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pszBegin ) ) );
+
+		if( iMask )
+			return pszBegin + CountTrailingZeros( iMask );
+	}
+
+	return pszBegin;
+}
+
+SSE2_TARGET const char* FindWordEndSIMD( const char* pszBegin, const char* const pszEnd )
+{
+	for( ; pszEnd - pszBegin >= SIMD_WIDTH; pszBegin += SIMD_WIDTH )
+	{
+		const int iMask = WordEndMask( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pszBegin ) ) );
+
+		if( iMask )
+			return pszBegin + CountTrailingZeros( iMask );
+	}
+
+	return pszBegin;
+}
+
+SSE2_TARGET const char* FindQuoteSIMD( const char* pszBegin, const char* const pszEnd )
+{
+	const __m128i quote = _mm_set1_epi8( '\"' );
+
+	for( ; pszEnd - pszBegin >= SIMD_WIDTH; pszBegin += SIMD_WIDTH )
+	{
+		const int iMask = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pszBegin ) ), quote ) );
+
+		if( iMask )
+			return pszBegin + CountTrailingZeros( iMask );
+	}
+
+	return pszBegin;
+}
+
+/**
+*	Finds the first character that can start a token.
+*	@return Pointer to the character, or pszEnd if there is none.
+*/
+const char* FindTokenChar( const char* pszBegin, const char* const pszEnd )
+{
+	if( IsSIMDScanSupported() )
+		pszBegin = FindTokenCharSIMD( pszBegin, pszEnd );
+
+	//Scan the remainder of the string.
+	while( pszBegin < pszEnd && *pszBegin <= ' ' )
+		++pszBegin;
+
+	return pszBegin;
+}
+
+/**
+*	Finds the end of a word.
+*	@return Pointer to the first character after the word, or pszEnd if the word runs to the end.
+*/
+const char* FindWordEnd( const char* pszBegin, const char* const pszEnd )
+{
+	if( IsSIMDScanSupported() )
+		pszBegin = FindWordEndSIMD( pszBegin, pszEnd );
+
+	while( pszBegin < pszEnd && *pszBegin > ' ' && !IsControlChar( *pszBegin ) )
+		++pszBegin;
+
+	return pszBegin;
+}
+
+/**
+*	Finds the closing quote of a quoted string.
+*	@return Pointer to the quote, or pszEnd if there is none.
+*/
+const char* FindQuote( const char* pszBegin, const char* const pszEnd )
+{
+	if( IsSIMDScanSupported() )
+		pszBegin = FindQuoteSIMD( pszBegin, pszEnd );
+
+	while( pszBegin < pszEnd && *pszBegin != '\"' )
+		++pszBegin;
+
+	return pszBegin;
+}
+}
+
 bool IsControlChar( const char c )
 {
 	return 
@@ -114,6 +261,65 @@ skipwhite:
 	return pszData;
 }
 
+const char* ParseView( const char* pszData, const char* const pszEnd, TokenView_t& token )
+{
+	token.pszBegin = pszData;
+	token.uiLength = 0;
+
+	if( !pszData )
+		return nullptr;
+
+	assert( pszEnd >= pszData );
+
+	while( true )
+	{
+		pszData = FindTokenChar( pszData, pszEnd );
+
+		if( pszData == pszEnd )
+			return nullptr;
+
+		//Skip // comments
+		if( *pszData == '/' && pszEnd - pszData > 1 && pszData[ 1 ] == '/' )
+		{
+			auto pszNewline = reinterpret_cast<const char*>( memchr( pszData, '\n', pszEnd - pszData ) );
+
+			pszData = pszNewline ? pszNewline : pszEnd;
+			continue;
+		}
+
+		break;
+	}
+
+	//Handle quoted strings specially. Strings without a closing quote run to the end.
+	if( *pszData == '\"' )
+	{
+		++pszData;
+
+		const char* const pszQuote = FindQuote( pszData, pszEnd );
+
+		token.pszBegin = pszData;
+		token.uiLength = pszQuote - pszData;
+
+		return pszQuote < pszEnd ? pszQuote + 1 : pszEnd;
+	}
+
+	token.pszBegin = pszData;
+
+	//Parse single characters
+	if( IsControlChar( *pszData ) )
+	{
+		token.uiLength = 1;
+		return pszData + 1;
+	}
+
+	//Parse a regular word
+	const char* const pszWordEnd = FindWordEnd( pszData + 1, pszEnd );
+
+	token.uiLength = pszWordEnd - pszData;
+
+	return pszWordEnd;
+}
+
 bool TokenWaiting( const char* pszLine )
 {
 	const char* p = pszLine;
@@ -32,6 +32,25 @@ bool IsControlChar( const char c );
 */
 const char* Parse( const char* pszData, char* pszBuffer, const size_t uiBufferSize, bool* bBufferTooSmall = nullptr );
 
+/**
+*	A token in a string, as a range of characters. Quotes around quoted tokens are not included.
+*/
+struct TokenView_t
+{
+	const char* pszBegin = nullptr;
+	size_t uiLength = 0;
+};
+
+/**
+*	Parses a token out of a string without copying it. Tokens are parsed the same way as Parse, but have no length limit.
+*	@param pszData String to parse.
+*	@param pszEnd End of the string. The string must not contain null characters before this.
+*	@param token Receives the token.
+*	@return If a token was parsed, returns the position of the next token in pszData.
+*			If the end was reached before a token was found, returns null.
+*/
+const char* ParseView( const char* pszData, const char* const pszEnd, TokenView_t& token );
+
 /**
 *	Returns true if additional data is waiting to be processed on this line.
 *	@param pszLine Line to check.
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+
+#include "shared/Logging.h"
+
+#include "Baseline.h"
+#include "CJSONValue.h"
+
+namespace bench
+{
+namespace
+{
+/**
+*	@return The number of nanoseconds in a time unit, or 0 if the unit is unknown.
+*/
+double GetNanosecondsPerUnit( const char* const pszUnit )
+{
+	if( !strcmp( pszUnit, "ns" ) )
+		return 1;
+
+	if( !strcmp( pszUnit, "us" ) )
+		return 1e3;
+
+	if( !strcmp( pszUnit, "ms" ) )
+		return 1e6;
+
+	if( !strcmp( pszUnit, "s" ) )
+		return 1e9;
+
+	return 0;
+}
+
+double Median( std::vector<double> values )
+{
+	if( values.empty() )
+		return 0;
+
+	std::sort( values.begin(), values.end() );
+
+	const size_t uiMiddle = values.size() / 2;
+
+	return values.size() % 2 ? values[ uiMiddle ] : ( values[ uiMiddle - 1 ] + values[ uiMiddle ] ) / 2;
+}
+
+std::vector<double> GetRealTimes( const Result_t& result )
+{
+	std::vector<double> times;
+
+	times.reserve( result.repetitions.size() );
+
+	for( const auto& repetition : result.repetitions )
+		times.push_back( repetition.flRealTime );
+
+	return times;
+}
+
+const Result_t* FindResult( const std::vector<Result_t>& results, const std::string& szName )
+{
+	for( const auto& result : results )
+	{
+		if( result.szName == szName )
+			return &result;
+	}
+
+	return nullptr;
+}
+
+/**
+*	Formats nanoseconds with a unit that keeps the number readable.
+*/
+std::string FormatTime( const double flNanoseconds )
+{
+	char szBuffer[ 32 ];
+
+	if( flNanoseconds >= 1e9 )
+		snprintf( szBuffer, sizeof( szBuffer ), "%.3f s", flNanoseconds / 1e9 );
+	else if( flNanoseconds >= 1e6 )
+		snprintf( szBuffer, sizeof( szBuffer ), "%.3f ms", flNanoseconds / 1e6 );
+	else if( flNanoseconds >= 1e3 )
+		snprintf( szBuffer, sizeof( szBuffer ), "%.3f us", flNanoseconds / 1e3 );
+	else
+		snprintf( szBuffer, sizeof( szBuffer ), "%.1f ns", flNanoseconds );
+
+	return szBuffer;
+}
+}
+
+std::string GetBaselineFilename( const std::string& szDirectory, const std::string& szProfile )
+{
+	return ( std::experimental::filesystem::path( szDirectory ) / ( szProfile + ".json" ) ).string();
+}
+
+bool LoadJSON( const char* const pszFilename, std::vector<Result_t>& results )
+{
+	results.clear();
+
+	CJSONValue document;
+
+	if( !document.ParseFile( pszFilename ) )
+		return false;
+
+	const auto pBenchmarks = document.Find( "benchmarks" );
+
+	if( !pBenchmarks || pBenchmarks->GetType() != CJSONValue::Type::ARRAY )
+	{
+		Error( "\"%s\" has no benchmarks array\n", pszFilename );
+		return false;
+	}
+
+	for( const auto& entry : pBenchmarks->GetArray() )
+	{
+		if( strcmp( entry.GetMemberString( "run_type", "iteration" ), "iteration" ) )
+			continue;
+
+		//Google Benchmark only writes run_name since 1.5, fall back to the name.
+		std::string szName = entry.GetMemberString( "run_name", entry.GetMemberString( "name" ) );
+
+		if( szName.empty() )
+			continue;
+
+		auto it = std::find_if( results.begin(), results.end(), [ & ]( const Result_t& result ) { return result.szName == szName; } );
+
+		if( it == results.end() )
+		{
+			results.emplace_back();
+			it = results.end() - 1;
+			it->szName = std::move( szName );
+		}
+
+		auto& result = *it;
+
+		if( entry.GetMemberBool( "error_occurred" ) )
+		{
+			result.bSkipped = true;
+			result.szSkipReason = entry.GetMemberString( "error_message" );
+			continue;
+		}
+
+		const double flScale = GetNanosecondsPerUnit( entry.GetMemberString( "time_unit", "ns" ) );
+
+		if( flScale == 0 )
+		{
+			Error( "\"%s\": benchmark \"%s\" has an unknown time unit\n", pszFilename, result.szName.c_str() );
+			return false;
+		}
+
+		result.uiIterations = static_cast<size_t>( entry.GetMemberNumber( "iterations" ) );
+
+		Repetition_t repetition;
+
+		repetition.flRealTime = entry.GetMemberNumber( "real_time" ) * flScale;
+		repetition.flCPUTime = entry.GetMemberNumber( "cpu_time" ) * flScale;
+		repetition.flItemsPerSecond = entry.GetMemberNumber( "items_per_second" );
+		repetition.flBytesPerSecond = entry.GetMemberNumber( "bytes_per_second" );
+
+		result.repetitions.push_back( repetition );
+	}
+
+	return true;
+}
+
+double MannWhitneyUTest( const std::vector<double>& a, const std::vector<double>& b )
+{
+	const size_t uiCountA = a.size();
+	const size_t uiCountB = b.size();
+
+	if( uiCountA == 0 || uiCountB == 0 )
+		return 1;
+
+	//Rank the combined samples, giving tied values the average of their ranks.
+	std::vector<std::pair<double, bool>> samples;
+
+	samples.reserve( uiCountA + uiCountB );
+
+	for( const auto value : a )
+		samples.emplace_back( value, true );
+
+	for( const auto value : b )
+		samples.emplace_back( value, false );
+
+	std::sort( samples.begin(), samples.end(), []( const std::pair<double, bool>& lhs, const std::pair<double, bool>& rhs ) { return lhs.first < rhs.first; } );
+
+	const double flTotal = static_cast<double>( samples.size() );
+
+	double flRankSumA = 0;
+	double flTieCorrection = 0;
+
+	for( size_t uiStart = 0; uiStart < samples.size(); )
+	{
+		size_t uiEnd = uiStart + 1;
+
+		while( uiEnd < samples.size() && samples[ uiEnd ].first == samples[ uiStart ].first )
+			++uiEnd;
+
+		//Ranks are 1 based.
+		const double flRank = ( uiStart + 1 + uiEnd ) / 2.0;
+		const double flTies = static_cast<double>( uiEnd - uiStart );
+
+		flTieCorrection += flTies * flTies * flTies - flTies;
+
+		for( size_t uiSample = uiStart; uiSample < uiEnd; ++uiSample )
+		{
+			if( samples[ uiSample ].second )
+				flRankSumA += flRank;
+		}
+
+		uiStart = uiEnd;
+	}
+
+	const double flCountA = static_cast<double>( uiCountA );
+	const double flCountB = static_cast<double>( uiCountB );
+
+	const double flU = flRankSumA - flCountA * ( flCountA + 1 ) / 2;
+	const double flMean = flCountA * flCountB / 2;
+
+	const double flVariance = flCountA * flCountB / 12 * ( ( flTotal + 1 ) - flTieCorrection / ( flTotal * ( flTotal - 1 ) ) );
+
+	//All values are equal.
+	if( flVariance <= 0 )
+		return 1;
+
+	const double flZ = std::max( 0.0, std::abs( flU - flMean ) - 0.5 ) / std::sqrt( flVariance );
+
+	return std::erfc( flZ / std::sqrt( 2.0 ) );
+}
+
+std::vector<Comparison_t> CompareResults( const std::vector<Result_t>& baseline, const std::vector<Result_t>& current, const CompareSettings_t& settings )
+{
+	std::vector<Comparison_t> comparisons;
+
+	for( const auto& result : current )
+	{
+		if( result.bSkipped || result.repetitions.empty() )
+			continue;
+
+		const auto pBaseline = FindResult( baseline, result.szName );
+
+		if( !pBaseline || pBaseline->bSkipped || pBaseline->repetitions.empty() )
+			continue;
+
+		const auto baselineTimes = GetRealTimes( *pBaseline );
+		const auto currentTimes = GetRealTimes( result );
+
+		Comparison_t comparison;
+
+		comparison.szName = result.szName;
+		comparison.flBaselineMedian = Median( baselineTimes );
+		comparison.flCurrentMedian = Median( currentTimes );
+		comparison.flChange = comparison.flBaselineMedian > 0 ? comparison.flCurrentMedian / comparison.flBaselineMedian - 1 : 0;
+		comparison.flPValue = MannWhitneyUTest( baselineTimes, currentTimes );
+		comparison.bTooFewRepetitions = baselineTimes.size() < MIN_SIGNIFICANT_REPETITIONS || currentTimes.size() < MIN_SIGNIFICANT_REPETITIONS;
+		comparison.bRegressed = comparison.flChange > settings.flThreshold && comparison.flPValue < settings.flAlpha;
+
+		comparisons.push_back( std::move( comparison ) );
+	}
+
+	return comparisons;
+}
+
+bool PrintComparison( const std::vector<Comparison_t>& comparisons, const CompareSettings_t& settings )
+{
+	if( comparisons.empty() )
+	{
+		Message( "No benchmarks were found in both the baseline and the current results\n" );
+		return true;
+	}
+
+	size_t uiNameWidth = strlen( "Benchmark" );
+
+	for( const auto& comparison : comparisons )
+		uiNameWidth = std::max( uiNameWidth, comparison.szName.size() );
+
+	const int iNameWidth = static_cast<int>( uiNameWidth );
+
+	Message( "%-*s %14s %14s %9s %9s\n", iNameWidth, "Benchmark", "Baseline", "Current", "Change", "p-value" );
+
+	size_t uiRegressions = 0;
+	bool bTooFewRepetitions = false;
+
+	for( const auto& comparison : comparisons )
+	{
+		const char* pszVerdict = "";
+
+		if( comparison.bRegressed )
+			pszVerdict = "  REGRESSED";
+		else if( comparison.flChange < -settings.flThreshold && comparison.flPValue < settings.flAlpha )
+			pszVerdict = "  improved";
+
+		Message( "%-*s %14s %14s %+8.1f%% %9.4f%s\n", iNameWidth, comparison.szName.c_str(),
+				 FormatTime( comparison.flBaselineMedian ).c_str(), FormatTime( comparison.flCurrentMedian ).c_str(),
+				 comparison.flChange * 100, comparison.flPValue, pszVerdict );
+
+		if( comparison.bRegressed )
+			++uiRegressions;
+
+		if( comparison.bTooFewRepetitions )
+			bTooFewRepetitions = true;
+	}
+
+	if( bTooFewRepetitions )
+	{
+		Message( "Warning: some benchmarks have fewer than %u repetitions, so slowdowns can't be significant. Use --repetitions %u or more\n",
+				 static_cast<unsigned int>( MIN_SIGNIFICANT_REPETITIONS ), static_cast<unsigned int>( MIN_SIGNIFICANT_REPETITIONS ) );
+	}
+
+	if( uiRegressions == 0 )
+	{
+		Message( "No regressions of more than %.1f%% (alpha %g)\n", settings.flThreshold * 100, settings.flAlpha );
+		return true;
+	}
+
+	Error( "%u benchmark(s) regressed by more than %.1f%% (alpha %g):\n",
+		   static_cast<unsigned int>( uiRegressions ), settings.flThreshold * 100, settings.flAlpha );
+
+	for( const auto& comparison : comparisons )
+	{
+		if( comparison.bRegressed )
+		{
+			Error( "  %s: %s -> %s (%+.1f%%)\n", comparison.szName.c_str(),
+				   FormatTime( comparison.flBaselineMedian ).c_str(), FormatTime( comparison.flCurrentMedian ).c_str(), comparison.flChange * 100 );
+		}
+	}
+
+	return false;
+}
+}
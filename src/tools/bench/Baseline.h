@@ -0,0 +1,92 @@
+#ifndef TOOLS_BENCH_BASELINE_H
+#define TOOLS_BENCH_BASELINE_H
+
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+/**
+*	Compares benchmark results with baseline results saved earlier on the same machine.
+*	A benchmark regresses when its repetitions are significantly slower according to a Mann-Whitney U test,
+*	and its median is slower than the baseline median by more than a threshold.
+*/
+namespace bench
+{
+struct CompareSettings_t
+{
+	/**
+	*	Relative slowdown of the median that counts as a regression. 0.1 is 10% slower.
+	*/
+	double flThreshold = 0.1;
+
+	/**
+	*	Significance level of the U test. Slowdowns with a larger p-value are considered noise.
+	*/
+	double flAlpha = 0.05;
+};
+
+struct Comparison_t
+{
+	std::string szName;
+
+	/**
+	*	Median nanoseconds per iteration.
+	*/
+	double flBaselineMedian = 0;
+	double flCurrentMedian = 0;
+
+	/**
+	*	Relative change of the median. Positive is slower.
+	*/
+	double flChange = 0;
+
+	/**
+	*	Two sided p-value of the U test.
+	*/
+	double flPValue = 1;
+
+	/**
+	*	Whether either side has fewer repetitions than the test needs to detect anything.
+	*/
+	bool bTooFewRepetitions = false;
+
+	bool bRegressed = false;
+};
+
+/**
+*	Fewest repetitions that each side needs for the U test to be able to reach a p-value below 0.05.
+*/
+static const size_t MIN_SIGNIFICANT_REPETITIONS = 4;
+
+/**
+*	@return The name of the baseline file for a machine profile in a directory.
+*/
+std::string GetBaselineFilename( const std::string& szDirectory, const std::string& szProfile );
+
+/**
+*	Loads results from a JSON file written by WriteJSON, or by Google Benchmark.
+*	Only "iteration" entries are used, so every repetition is available to the test. Benchmarks that reported an error are loaded as skipped.
+*	@return Whether the file was loaded.
+*/
+bool LoadJSON( const char* const pszFilename, std::vector<Result_t>& results );
+
+/**
+*	Two sided Mann-Whitney U test, using the normal approximation with tie and continuity correction.
+*	@return The p-value of the samples coming from the same distribution.
+*/
+double MannWhitneyUTest( const std::vector<double>& a, const std::vector<double>& b );
+
+/**
+*	Compares the results of all benchmarks that are in both sets and weren't skipped.
+*/
+std::vector<Comparison_t> CompareResults( const std::vector<Result_t>& baseline, const std::vector<Result_t>& current, const CompareSettings_t& settings );
+
+/**
+*	Prints a comparison table, then a summary of the regressions.
+*	@return Whether no benchmark regressed.
+*/
+bool PrintComparison( const std::vector<Comparison_t>& comparisons, const CompareSettings_t& settings );
+}
+
+#endif //TOOLS_BENCH_BASELINE_H
@@ -0,0 +1,27 @@
+#include <cstdlib>
+
+#include "shared/Logging.h"
+
+#include "CBenchApp.h"
+
+int main( int iArgc, char* pszArgV[] )
+{
+	//There's no UI to show messages in, print them instead.
+	SetDefaultLogListener( GetStdOutLogListener() );
+
+	bench::CBenchApp app;
+
+	const auto result = app.ParseCommandLine( iArgc, pszArgV );
+
+	if( result != bench::CBenchApp::CommandLineResult::RUN )
+		return result == bench::CBenchApp::CommandLineResult::EXIT ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	bool bSuccess = app.Start();
+
+	if( bSuccess )
+		bSuccess = app.RunBenchmarks();
+
+	app.OnShutdown();
+
+	return bSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "shared/Logging.h"
+
+#include "Benchmark.h"
+
+namespace bench
+{
+namespace
+{
+/**
+*	Most iterations a repetition may run.
+*/
+const size_t MAX_ITERATIONS = 1000000000;
+
+/**
+*	Most that the iteration count grows by between calibration runs, so a noisy short run doesn't overshoot by far.
+*/
+const double MAX_ITERATION_GROWTH = 10;
+
+std::vector<Benchmark_t>& GetBenchmarkList()
+{
+	//Constructed on first use, since benchmarks are registered during static initialization.
+	static std::vector<Benchmark_t> benchmarks;
+
+	return benchmarks;
+}
+
+Repetition_t MakeRepetition( const CState& state )
+{
+	Repetition_t repetition;
+
+	const double flIterations = static_cast<double>( state.GetIterations() );
+
+	repetition.flRealTime = state.GetRealTime() * 1e9 / flIterations;
+	repetition.flCPUTime = state.GetCPUTime() * 1e9 / flIterations;
+
+	const double flSeconds = state.GetRealTime() > 0 ? state.GetRealTime() : 1e-9;
+
+	repetition.flItemsPerSecond = state.GetItemsProcessed() / flSeconds;
+	repetition.flBytesPerSecond = state.GetBytesProcessed() / flSeconds;
+
+	return repetition;
+}
+
+struct Stats_t
+{
+	double flMean;
+	double flMedian;
+	double flStdDev;
+};
+
+Stats_t ComputeStats( std::vector<double> values )
+{
+	Stats_t stats{ 0, 0, 0 };
+
+	if( values.empty() )
+		return stats;
+
+	for( auto flValue : values )
+		stats.flMean += flValue;
+
+	stats.flMean /= values.size();
+
+	std::sort( values.begin(), values.end() );
+
+	const size_t uiMiddle = values.size() / 2;
+
+	stats.flMedian = ( values.size() % 2 ) ? values[ uiMiddle ] : ( values[ uiMiddle - 1 ] + values[ uiMiddle ] ) / 2;
+
+	//Sample standard deviation, like Google Benchmark reports.
+	if( values.size() > 1 )
+	{
+		double flSum = 0;
+
+		for( auto flValue : values )
+			flSum += ( flValue - stats.flMean ) * ( flValue - stats.flMean );
+
+		stats.flStdDev = std::sqrt( flSum / ( values.size() - 1 ) );
+	}
+
+	return stats;
+}
+
+template<typename FUNC>
+Stats_t ComputeStats( const std::vector<Repetition_t>& repetitions, FUNC getValue )
+{
+	std::vector<double> values;
+
+	values.reserve( repetitions.size() );
+
+	for( const auto& repetition : repetitions )
+		values.push_back( getValue( repetition ) );
+
+	return ComputeStats( std::move( values ) );
+}
+
+std::string EscapeJSON( const std::string& szString )
+{
+	std::string szResult;
+
+	szResult.reserve( szString.size() );
+
+	for( const char character : szString )
+	{
+		switch( character )
+		{
+		case '"':	szResult += "\\\""; break;
+		case '\\':	szResult += "\\\\"; break;
+		case '\n':	szResult += "\\n"; break;
+		case '\r':	szResult += "\\r"; break;
+		case '\t':	szResult += "\\t"; break;
+
+		default:
+			{
+				if( static_cast<unsigned char>( character ) < 0x20 )
+				{
+					char szBuffer[ 8 ];
+					snprintf( szBuffer, sizeof( szBuffer ), "\\u%04x", static_cast<unsigned char>( character ) );
+					szResult += szBuffer;
+				}
+				else
+				{
+					szResult += character;
+				}
+
+				break;
+			}
+		}
+	}
+
+	return szResult;
+}
+
+void WriteEntry( FILE* pFile, const Result_t& result, const char* const pszRunType, const char* const pszAggregate, const int iRepetition,
+				 const double flRealTime, const double flCPUTime, const double flItemsPerSecond, const double flBytesPerSecond, const bool bLast )
+{
+	const std::string szName = EscapeJSON( result.szName );
+
+	fprintf( pFile, "\t\t{\n" );
+
+	if( pszAggregate )
+		fprintf( pFile, "\t\t\t\"name\": \"%s_%s\",\n", szName.c_str(), pszAggregate );
+	else
+		fprintf( pFile, "\t\t\t\"name\": \"%s\",\n", szName.c_str() );
+
+	fprintf( pFile, "\t\t\t\"run_name\": \"%s\",\n", szName.c_str() );
+	fprintf( pFile, "\t\t\t\"run_type\": \"%s\",\n", pszRunType );
+	fprintf( pFile, "\t\t\t\"repetitions\": %u,\n", static_cast<unsigned int>( result.repetitions.size() ) );
+
+	if( pszAggregate )
+		fprintf( pFile, "\t\t\t\"aggregate_name\": \"%s\",\n", pszAggregate );
+	else
+		fprintf( pFile, "\t\t\t\"repetition_index\": %d,\n", iRepetition );
+
+	fprintf( pFile, "\t\t\t\"iterations\": %llu,\n", static_cast<unsigned long long>( result.uiIterations ) );
+	fprintf( pFile, "\t\t\t\"real_time\": %.17g,\n", flRealTime );
+	fprintf( pFile, "\t\t\t\"cpu_time\": %.17g,\n", flCPUTime );
+
+	if( flItemsPerSecond > 0 )
+		fprintf( pFile, "\t\t\t\"items_per_second\": %.17g,\n", flItemsPerSecond );
+
+	if( flBytesPerSecond > 0 )
+		fprintf( pFile, "\t\t\t\"bytes_per_second\": %.17g,\n", flBytesPerSecond );
+
+	fprintf( pFile, "\t\t\t\"time_unit\": \"ns\"\n" );
+	fprintf( pFile, bLast ? "\t\t}\n" : "\t\t},\n" );
+}
+}
+
+CState::CState( CBenchFixtures& fixtures, const size_t uiIterations )
+	: m_Fixtures( fixtures )
+	, m_uiIterations( uiIterations )
+{
+	assert( uiIterations > 0 );
+}
+
+void CState::PauseTiming()
+{
+	if( !m_bTiming )
+		return;
+
+	m_flRealTime += std::chrono::duration<double>( std::chrono::steady_clock::now() - m_RealStart ).count();
+	m_flCPUTime += static_cast<double>( std::clock() - m_CPUStart ) / CLOCKS_PER_SEC;
+
+	m_bTiming = false;
+}
+
+void CState::ResumeTiming()
+{
+	if( m_bTiming )
+		return;
+
+	m_bTiming = true;
+
+	m_CPUStart = std::clock();
+	m_RealStart = std::chrono::steady_clock::now();
+}
+
+void CState::Skip( const char* const pszReason )
+{
+	assert( pszReason );
+
+	m_bSkipped = true;
+	m_szSkipReason = pszReason;
+}
+
+CBenchmarkRegistrar::CBenchmarkRegistrar( const char* const pszName, const BenchmarkFn_t pFunction )
+{
+	assert( pszName );
+	assert( pFunction );
+
+	GetBenchmarkList().push_back( { pszName, pFunction } );
+}
+
+std::vector<Benchmark_t> GetBenchmarks()
+{
+	auto benchmarks = GetBenchmarkList();
+
+	std::sort( benchmarks.begin(), benchmarks.end(), []( const Benchmark_t& lhs, const Benchmark_t& rhs )
+		{
+			return strcmp( lhs.pszName, rhs.pszName ) < 0;
+		}
+	);
+
+	return benchmarks;
+}
+
+namespace
+{
+/**
+*	Volatile, so the store in UseAddress can't be optimized out.
+*/
+const void* volatile g_pUsedAddress = nullptr;
+}
+
+void UseAddress( const void* pAddress )
+{
+	g_pUsedAddress = pAddress;
+}
+
+std::vector<Result_t> RunBenchmarks( CBenchFixtures& fixtures, const RunSettings_t& settings )
+{
+	std::vector<Result_t> results;
+
+	for( const auto& benchmark : GetBenchmarks() )
+	{
+		if( !settings.szFilter.empty() && !strstr( benchmark.pszName, settings.szFilter.c_str() ) )
+			continue;
+
+		Message( "Running %s\n", benchmark.pszName );
+
+		Result_t result;
+
+		result.szName = benchmark.pszName;
+
+		//Find how many iterations it takes to reach the minimum time.
+		size_t uiIterations = 1;
+
+		while( true )
+		{
+			CState state( fixtures, uiIterations );
+
+			benchmark.pFunction( state );
+
+			if( state.IsSkipped() )
+			{
+				result.bSkipped = true;
+				result.szSkipReason = state.GetSkipReason();
+				break;
+			}
+
+			if( state.GetRealTime() >= settings.flMinTime || uiIterations >= MAX_ITERATIONS )
+			{
+				result.repetitions.push_back( MakeRepetition( state ) );
+				break;
+			}
+
+			const double flGrowth = state.GetRealTime() > 0 ? ( settings.flMinTime * 1.4 ) / state.GetRealTime() : MAX_ITERATION_GROWTH;
+
+			const double flNext = std::ceil( uiIterations * std::min( std::max( flGrowth, 2.0 ), MAX_ITERATION_GROWTH ) );
+
+			uiIterations = static_cast<size_t>( std::min( flNext, static_cast<double>( MAX_ITERATIONS ) ) );
+		}
+
+		result.uiIterations = uiIterations;
+
+		if( result.bSkipped )
+		{
+			Message( "Skipped %s: %s\n", benchmark.pszName, result.szSkipReason.c_str() );
+		}
+		else
+		{
+			for( size_t uiRepetition = 1; uiRepetition < settings.uiRepetitions; ++uiRepetition )
+			{
+				CState state( fixtures, uiIterations );
+
+				benchmark.pFunction( state );
+
+				result.repetitions.push_back( MakeRepetition( state ) );
+			}
+		}
+
+		results.push_back( std::move( result ) );
+	}
+
+	return results;
+}
+
+void PrintResults( const std::vector<Result_t>& results )
+{
+	Message( "%-48s %14s %14s %10s %14s %14s\n", "Benchmark", "Mean (ns)", "Median (ns)", "StdDev %", "CPU (ns)", "Iterations" );
+
+	for( const auto& result : results )
+	{
+		if( result.bSkipped )
+		{
+			Message( "%-48s skipped: %s\n", result.szName.c_str(), result.szSkipReason.c_str() );
+			continue;
+		}
+
+		const auto real = ComputeStats( result.repetitions, []( const Repetition_t& repetition ) { return repetition.flRealTime; } );
+		const auto cpu = ComputeStats( result.repetitions, []( const Repetition_t& repetition ) { return repetition.flCPUTime; } );
+
+		Message( "%-48s %14.1f %14.1f %9.2f%% %14.1f %14llu\n",
+				 result.szName.c_str(), real.flMean, real.flMedian, real.flMean > 0 ? real.flStdDev * 100 / real.flMean : 0.0,
+				 cpu.flMean, static_cast<unsigned long long>( result.uiIterations ) );
+	}
+}
+
+bool WriteJSON( const char* const pszFilename, const std::vector<Result_t>& results, const RunSettings_t& settings )
+{
+	assert( pszFilename );
+
+	FILE* pFile = fopen( pszFilename, "w" );
+
+	if( !pFile )
+	{
+		Error( "Couldn't open \"%s\" for writing\n", pszFilename );
+		return false;
+	}
+
+	char szDate[ 64 ] = {};
+
+	const std::time_t now = std::time( nullptr );
+
+	if( const auto pTime = std::localtime( &now ) )
+		std::strftime( szDate, sizeof( szDate ), "%Y-%m-%dT%H:%M:%S", pTime );
+
+	fprintf( pFile, "{\n" );
+	fprintf( pFile, "\t\"context\": {\n" );
+	fprintf( pFile, "\t\t\"date\": \"%s\",\n", szDate );
+	fprintf( pFile, "\t\t\"executable\": \"hltools_bench\",\n" );
+	fprintf( pFile, "\t\t\"num_cpus\": %u,\n", std::thread::hardware_concurrency() );
+	fprintf( pFile, "\t\t\"min_time\": %g,\n", settings.flMinTime );
+	fprintf( pFile, "\t\t\"repetitions\": %u,\n", static_cast<unsigned int>( settings.uiRepetitions ) );
+#ifdef NDEBUG
+	fprintf( pFile, "\t\t\"library_build_type\": \"release\"\n" );
+#else
+	fprintf( pFile, "\t\t\"library_build_type\": \"debug\"\n" );
+#endif
+	fprintf( pFile, "\t},\n" );
+	fprintf( pFile, "\t\"benchmarks\": [\n" );
+
+	for( size_t uiResult = 0; uiResult < results.size(); ++uiResult )
+	{
+		const auto& result = results[ uiResult ];
+
+		const bool bLastResult = uiResult + 1 == results.size();
+
+		if( result.bSkipped )
+		{
+			fprintf( pFile, "\t\t{\n" );
+			fprintf( pFile, "\t\t\t\"name\": \"%s\",\n", EscapeJSON( result.szName ).c_str() );
+			fprintf( pFile, "\t\t\t\"run_name\": \"%s\",\n", EscapeJSON( result.szName ).c_str() );
+			fprintf( pFile, "\t\t\t\"run_type\": \"iteration\",\n" );
+			fprintf( pFile, "\t\t\t\"error_occurred\": true,\n" );
+			fprintf( pFile, "\t\t\t\"error_message\": \"%s\"\n", EscapeJSON( result.szSkipReason ).c_str() );
+			fprintf( pFile, bLastResult ? "\t\t}\n" : "\t\t},\n" );
+			continue;
+		}
+
+		for( size_t uiRepetition = 0; uiRepetition < result.repetitions.size(); ++uiRepetition )
+		{
+			const auto& repetition = result.repetitions[ uiRepetition ];
+
+			WriteEntry( pFile, result, "iteration", nullptr, static_cast<int>( uiRepetition ),
+						repetition.flRealTime, repetition.flCPUTime, repetition.flItemsPerSecond, repetition.flBytesPerSecond, false );
+		}
+
+		const auto real = ComputeStats( result.repetitions, []( const Repetition_t& repetition ) { return repetition.flRealTime; } );
+		const auto cpu = ComputeStats( result.repetitions, []( const Repetition_t& repetition ) { return repetition.flCPUTime; } );
+		const auto items = ComputeStats( result.repetitions, []( const Repetition_t& repetition ) { return repetition.flItemsPerSecond; } );
+		const auto bytes = ComputeStats( result.repetitions, []( const Repetition_t& repetition ) { return repetition.flBytesPerSecond; } );
+
+		WriteEntry( pFile, result, "aggregate", "mean", 0, real.flMean, cpu.flMean, items.flMean, bytes.flMean, false );
+		WriteEntry( pFile, result, "aggregate", "median", 0, real.flMedian, cpu.flMedian, items.flMedian, bytes.flMedian, false );
+		WriteEntry( pFile, result, "aggregate", "stddev", 0, real.flStdDev, cpu.flStdDev, items.flStdDev, bytes.flStdDev, bLastResult );
+	}
+
+	fprintf( pFile, "\t]\n" );
+	fprintf( pFile, "}\n" );
+
+	const bool bSuccess = !ferror( pFile );
+
+	fclose( pFile );
+
+	if( !bSuccess )
+		Error( "Couldn't write \"%s\"\n", pszFilename );
+
+	return bSuccess;
+}
+}
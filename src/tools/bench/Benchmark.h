@@ -0,0 +1,235 @@
+#ifndef TOOLS_BENCH_BENCHMARK_H
+#define TOOLS_BENCH_BENCHMARK_H
+
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/**
+*	Small microbenchmark harness. Benchmarks are functions that are registered with HLTOOLS_BENCHMARK,
+*	and are run until they've taken a minimum amount of time so short operations can be measured accurately.
+*/
+namespace bench
+{
+class CBenchFixtures;
+
+/**
+*	State passed to a benchmark. Benchmarks do their setup first, then loop while KeepRunning returns true. Only the loop is timed.
+*/
+class CState final
+{
+public:
+	CState( CBenchFixtures& fixtures, const size_t uiIterations );
+
+	CBenchFixtures& GetFixtures() const { return m_Fixtures; }
+
+	/**
+	*	@return Number of iterations that this run does.
+	*/
+	size_t GetIterations() const { return m_uiIterations; }
+
+	/**
+	*	@return Whether another iteration should be run. Starts timing on the first call, and stops it once all iterations have run.
+	*/
+	bool KeepRunning()
+	{
+		if( m_uiIteration < m_uiIterations )
+		{
+			if( m_uiIteration++ == 0 )
+				ResumeTiming();
+
+			return true;
+		}
+
+		PauseTiming();
+
+		return false;
+	}
+
+	/**
+	*	Stops timing, so per iteration work that shouldn't be measured can be done.
+	*/
+	void PauseTiming();
+
+	/**
+	*	Resumes timing after PauseTiming.
+	*/
+	void ResumeTiming();
+
+	/**
+	*	Sets the number of items processed by all iterations, so a rate can be reported.
+	*/
+	void SetItemsProcessed( const size_t uiItems ) { m_uiItems = uiItems; }
+
+	/**
+	*	Sets the number of bytes processed by all iterations, so a rate can be reported.
+	*/
+	void SetBytesProcessed( const size_t uiBytes ) { m_uiBytes = uiBytes; }
+
+	/**
+	*	Skips the benchmark, for example because the fixtures it needs aren't available.
+	*	The measurements of a skipped run are discarded.
+	*/
+	void Skip( const char* const pszReason );
+
+	bool IsSkipped() const { return m_bSkipped; }
+
+	const std::string& GetSkipReason() const { return m_szSkipReason; }
+
+	/**
+	*	@return Wall clock time spent in the loop, in seconds.
+	*/
+	double GetRealTime() const { return m_flRealTime; }
+
+	/**
+	*	@return Processor time spent in the loop, in seconds.
+	*/
+	double GetCPUTime() const { return m_flCPUTime; }
+
+	size_t GetItemsProcessed() const { return m_uiItems; }
+
+	size_t GetBytesProcessed() const { return m_uiBytes; }
+
+private:
+	CBenchFixtures& m_Fixtures;
+
+	const size_t m_uiIterations;
+	size_t m_uiIteration = 0;
+
+	bool m_bTiming = false;
+
+	std::chrono::steady_clock::time_point m_RealStart;
+	std::clock_t m_CPUStart = 0;
+
+	double m_flRealTime = 0;
+	double m_flCPUTime = 0;
+
+	size_t m_uiItems = 0;
+	size_t m_uiBytes = 0;
+
+	bool m_bSkipped = false;
+	std::string m_szSkipReason;
+
+private:
+	CState( const CState& ) = delete;
+	CState& operator=( const CState& ) = delete;
+};
+
+typedef void ( *BenchmarkFn_t )( CState& state );
+
+struct Benchmark_t
+{
+	const char* pszName;
+	BenchmarkFn_t pFunction;
+};
+
+/**
+*	Adds a benchmark to the list of benchmarks. Used by HLTOOLS_BENCHMARK.
+*/
+class CBenchmarkRegistrar final
+{
+public:
+	CBenchmarkRegistrar( const char* const pszName, const BenchmarkFn_t pFunction );
+};
+
+/**
+*	@return All registered benchmarks, sorted by name.
+*/
+std::vector<Benchmark_t> GetBenchmarks();
+
+/**
+*	Makes the compiler assume that the value is used, so the code that computes it isn't optimized out.
+*/
+void UseAddress( const void* pAddress );
+
+template<typename T>
+inline void DoNotOptimize( const T& value )
+{
+#ifdef __GNUC__
+	asm volatile( "" : : "g"( &value ) : "memory" );
+#else
+	UseAddress( &value );
+#endif
+}
+
+struct RunSettings_t
+{
+	/**
+	*	If not empty, only benchmarks whose name contains this are run.
+	*/
+	std::string szFilter;
+
+	/**
+	*	Minimum number of seconds that each repetition runs for.
+	*/
+	double flMinTime = 0.5;
+
+	/**
+	*	Number of times each benchmark is measured.
+	*/
+	size_t uiRepetitions = 5;
+};
+
+/**
+*	Measurements of one repetition.
+*/
+struct Repetition_t
+{
+	/**
+	*	Nanoseconds per iteration.
+	*/
+	double flRealTime;
+	double flCPUTime;
+
+	/**
+	*	Rates, or 0 if the benchmark doesn't report them.
+	*/
+	double flItemsPerSecond;
+	double flBytesPerSecond;
+};
+
+struct Result_t
+{
+	std::string szName;
+
+	bool bSkipped = false;
+	std::string szSkipReason;
+
+	/**
+	*	Iterations that each repetition ran.
+	*/
+	size_t uiIterations = 0;
+
+	std::vector<Repetition_t> repetitions;
+};
+
+/**
+*	Runs all benchmarks that match the filter. Every repetition of a benchmark runs the same number of iterations,
+*	which is found by running it with more iterations until a run takes at least the minimum time. That run is the first repetition.
+*/
+std::vector<Result_t> RunBenchmarks( CBenchFixtures& fixtures, const RunSettings_t& settings );
+
+/**
+*	Prints the mean, median and standard deviation of each benchmark to the log.
+*/
+void PrintResults( const std::vector<Result_t>& results );
+
+/**
+*	Writes results to a JSON file. The layout matches Google Benchmark's JSON output, so its comparison tools can be used:
+*	every repetition is an "iteration" entry, followed by "aggregate" entries for the mean, median and standard deviation.
+*	@return Whether the file was written.
+*/
+bool WriteJSON( const char* const pszFilename, const std::vector<Result_t>& results, const RunSettings_t& settings );
+}
+
+/**
+*	Defines and registers a benchmark. The body receives a bench::CState& named state.
+*/
+#define HLTOOLS_BENCHMARK( name )														\
+static void Benchmark_##name( bench::CState& state );									\
+static const bench::CBenchmarkRegistrar g_##name##Registrar( #name, &Benchmark_##name );	\
+static void Benchmark_##name( bench::CState& state )
+
+#endif //TOOLS_BENCH_BENCHMARK_H
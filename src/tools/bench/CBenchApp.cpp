@@ -0,0 +1,357 @@
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+
+#include "core/LibHLCore.h"
+#include "shared/Logging.h"
+
+#include "cvar/CVar.h"
+#include "filesystem/IFileSystem.h"
+
+#include "CBenchApp.h"
+#include "CBenchFixtures.h"
+
+namespace bench
+{
+const char* const CBenchApp::DEFAULT_OUTPUT_FILE = "hltools_bench.json";
+const char* const CBenchApp::DEFAULT_BASELINE_DIRECTORY = "bench_baselines";
+const char* const CBenchApp::DEFAULT_PROFILE = "default";
+
+CBenchApp::CBenchApp()
+	: m_szOutputFile( DEFAULT_OUTPUT_FILE )
+	, m_szBaselineDirectory( DEFAULT_BASELINE_DIRECTORY )
+{
+	const char* const pszProfile = getenv( "HLTOOLS_BENCH_PROFILE" );
+
+	m_szProfile = pszProfile && *pszProfile ? pszProfile : DEFAULT_PROFILE;
+}
+
+CBenchApp::~CBenchApp()
+{
+}
+
+CBenchApp::CommandLineResult CBenchApp::ParseCommandLine( int iArgc, char* pszArgV[] )
+{
+	for( int iArg = 1; iArg < iArgc; ++iArg )
+	{
+		const char* const pszArg = pszArgV[ iArg ];
+
+		if( !strcmp( pszArg, "--help" ) )
+		{
+			PrintUsage();
+			return CommandLineResult::EXIT;
+		}
+
+		if( !strcmp( pszArg, "--list" ) )
+		{
+			ListBenchmarks();
+			return CommandLineResult::EXIT;
+		}
+
+		if( !strcmp( pszArg, "--save-baseline" ) )
+		{
+			m_bSaveBaseline = true;
+			continue;
+		}
+
+		if( !strcmp( pszArg, "--compare" ) )
+		{
+			m_bCompare = true;
+			continue;
+		}
+
+		//All other arguments take a value.
+		if( iArg + 1 >= iArgc )
+		{
+			Error( "Missing value for argument \"%s\"\n", pszArg );
+			PrintUsage();
+			return CommandLineResult::INVALID;
+		}
+
+		const char* const pszValue = pszArgV[ ++iArg ];
+
+		if( !strcmp( pszArg, "--corpus" ) )
+		{
+			m_szCorpusDirectory = pszValue;
+		}
+		else if( !strcmp( pszArg, "--filter" ) )
+		{
+			m_Settings.szFilter = pszValue;
+		}
+		else if( !strcmp( pszArg, "--min-time" ) )
+		{
+			m_Settings.flMinTime = atof( pszValue );
+
+			if( m_Settings.flMinTime <= 0 )
+			{
+				Error( "--min-time must be larger than 0\n" );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--repetitions" ) )
+		{
+			const int iRepetitions = atoi( pszValue );
+
+			if( iRepetitions <= 0 )
+			{
+				Error( "--repetitions must be at least 1\n" );
+				return CommandLineResult::INVALID;
+			}
+
+			m_Settings.uiRepetitions = static_cast<size_t>( iRepetitions );
+		}
+		else if( !strcmp( pszArg, "--output" ) )
+		{
+			m_szOutputFile = pszValue;
+		}
+		else if( !strcmp( pszArg, "--baseline-dir" ) )
+		{
+			m_szBaselineDirectory = pszValue;
+		}
+		else if( !strcmp( pszArg, "--profile" ) )
+		{
+			m_szProfile = pszValue;
+
+			if( m_szProfile.empty() || m_szProfile.find_first_of( "/\\:" ) != std::string::npos )
+			{
+				Error( "--profile must be a name, not a path\n" );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--threshold" ) )
+		{
+			const double flPercent = atof( pszValue );
+
+			if( flPercent <= 0 )
+			{
+				Error( "--threshold must be larger than 0\n" );
+				return CommandLineResult::INVALID;
+			}
+
+			m_CompareSettings.flThreshold = flPercent / 100;
+		}
+		else if( !strcmp( pszArg, "--alpha" ) )
+		{
+			m_CompareSettings.flAlpha = atof( pszValue );
+
+			if( m_CompareSettings.flAlpha <= 0 || m_CompareSettings.flAlpha >= 1 )
+			{
+				Error( "--alpha must be between 0 and 1\n" );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--input" ) )
+		{
+			m_szInputFile = pszValue;
+		}
+		else
+		{
+			Error( "Unknown argument \"%s\"\n", pszArg );
+			PrintUsage();
+			return CommandLineResult::INVALID;
+		}
+	}
+
+	//Starting changes the working directory to the executable's directory, so paths are made absolute first.
+	if( !m_szCorpusDirectory.empty() )
+		m_szCorpusDirectory = std::experimental::filesystem::absolute( m_szCorpusDirectory ).string();
+
+	m_szOutputFile = std::experimental::filesystem::absolute( m_szOutputFile ).string();
+	m_szBaselineDirectory = std::experimental::filesystem::absolute( m_szBaselineDirectory ).string();
+
+	if( !m_szInputFile.empty() )
+	{
+		if( !m_bCompare && !m_bSaveBaseline )
+		{
+			Error( "--input requires --compare or --save-baseline\n" );
+			return CommandLineResult::INVALID;
+		}
+
+		m_szInputFile = std::experimental::filesystem::absolute( m_szInputFile ).string();
+	}
+
+	if( m_bCompare && m_bSaveBaseline )
+	{
+		Error( "--compare and --save-baseline can't be used together\n" );
+		return CommandLineResult::INVALID;
+	}
+
+	return CommandLineResult::RUN;
+}
+
+bool CBenchApp::RunBenchmarks()
+{
+	std::vector<Result_t> results;
+
+	if( !m_szInputFile.empty() )
+	{
+		if( !LoadJSON( m_szInputFile.c_str(), results ) )
+			return false;
+
+		if( results.empty() )
+		{
+			Error( "\"%s\" has no results\n", m_szInputFile.c_str() );
+			return false;
+		}
+	}
+	else
+	{
+		results = bench::RunBenchmarks( *m_Fixtures, m_Settings );
+
+		if( results.empty() )
+		{
+			Error( "No benchmarks match the filter \"%s\"\n", m_Settings.szFilter.c_str() );
+			return false;
+		}
+
+		PrintResults( results );
+
+		if( !WriteJSON( m_szOutputFile.c_str(), results, m_Settings ) )
+			return false;
+
+		Message( "Wrote results to \"%s\"\n", m_szOutputFile.c_str() );
+	}
+
+	if( m_bSaveBaseline )
+	{
+		const auto szBaselineFile = GetBaselineFilename( m_szBaselineDirectory, m_szProfile );
+
+		std::error_code error;
+
+		std::experimental::filesystem::create_directories( m_szBaselineDirectory, error );
+
+		if( error )
+		{
+			Error( "Couldn't create baseline directory \"%s\": %s\n", m_szBaselineDirectory.c_str(), error.message().c_str() );
+			return false;
+		}
+
+		if( !WriteJSON( szBaselineFile.c_str(), results, m_Settings ) )
+			return false;
+
+		Message( "Saved baseline for profile \"%s\" to \"%s\"\n", m_szProfile.c_str(), szBaselineFile.c_str() );
+	}
+
+	if( m_bCompare )
+		return CompareWithBaseline( results );
+
+	return true;
+}
+
+bool CBenchApp::CompareWithBaseline( const std::vector<Result_t>& results ) const
+{
+	const auto szBaselineFile = GetBaselineFilename( m_szBaselineDirectory, m_szProfile );
+
+	if( !std::experimental::filesystem::exists( szBaselineFile ) )
+	{
+		Error( "Profile \"%s\" has no baseline \"%s\", save one with --save-baseline first\n", m_szProfile.c_str(), szBaselineFile.c_str() );
+		return false;
+	}
+
+	std::vector<Result_t> baseline;
+
+	if( !LoadJSON( szBaselineFile.c_str(), baseline ) )
+		return false;
+
+	Message( "Comparing with baseline \"%s\" of profile \"%s\"\n", szBaselineFile.c_str(), m_szProfile.c_str() );
+
+	return PrintComparison( CompareResults( baseline, results, m_CompareSettings ), m_CompareSettings );
+}
+
+bool CBenchApp::LoadAppLibraries()
+{
+	if( !LoadLibraries( "CVar", "FileSystem" ) )
+		return false;
+
+	return true;
+}
+
+bool CBenchApp::Connect( const CreateInterfaceFn* pFactories, const size_t uiNumFactories )
+{
+	if( !LoadAndCheckInterfaces( pFactories, uiNumFactories,
+							IFace( ICVARSYSTEM_NAME, g_pCVar, "CVar System" ),
+							IFace( IFILESYSTEM_NAME, m_pFileSystem, "File System" ) ) )
+	{
+		return false;
+	}
+
+	if( !g_pCVar->Initialize() )
+	{
+		FatalError( "Failed to initialize CVar system!\n" );
+		return false;
+	}
+
+	//Connect Core lib cvars first.
+	ConnectCoreCVars( g_pCVar );
+	cvar::ConnectCVars();
+
+	if( !m_pFileSystem->Initialize() )
+	{
+		FatalError( "Failed to initialize file system!\n" );
+		return false;
+	}
+
+	return true;
+}
+
+bool CBenchApp::Initialize()
+{
+	m_Fixtures = std::make_unique<CBenchFixtures>( m_pFileSystem, g_pCVar );
+
+	if( m_szCorpusDirectory.empty() )
+	{
+		Message( "No corpus directory given, benchmarks that need models and files will be skipped\n" );
+		return true;
+	}
+
+	return m_Fixtures->LoadCorpus( m_szCorpusDirectory.c_str() );
+}
+
+void CBenchApp::ShutdownApp()
+{
+	//Models must be freed before the libraries are unloaded.
+	m_Fixtures.reset();
+
+	if( m_pFileSystem )
+	{
+		m_pFileSystem->Shutdown();
+		m_pFileSystem = nullptr;
+	}
+
+	if( g_pCVar )
+	{
+		g_pCVar->Shutdown();
+		g_pCVar = nullptr;
+	}
+}
+
+void CBenchApp::PrintUsage() const
+{
+	Message(
+		"Usage: hltools_bench [options]\n"
+		"--corpus <directory>\tDirectory containing the models and files to benchmark with. Searched recursively\n"
+		"--filter <text>\t\tOnly run benchmarks whose name contains this text\n"
+		"--min-time <seconds>\tMinimum time that each repetition runs for (default %g)\n"
+		"--repetitions <count>\tNumber of times each benchmark is measured (default %u)\n"
+		"--output <file>\t\tJSON file to write the results to (default %s)\n"
+		"--baseline-dir <dir>\tDirectory that baselines are stored in, one file per machine profile (default %s)\n"
+		"--profile <name>\tMachine profile to save or compare the baseline of (default $HLTOOLS_BENCH_PROFILE or %s)\n"
+		"--save-baseline\t\tSave the results as the baseline of the profile\n"
+		"--compare\t\tCompare the results with the baseline of the profile, and fail if any benchmark regressed\n"
+		"--threshold <percent>\tSlowdown of the median that counts as a regression (default %g)\n"
+		"--alpha <p>\t\tSignificance level that slowdowns must reach to count as a regression (default %g)\n"
+		"--input <file>\t\tUse the results in this JSON file instead of running the benchmarks\n"
+		"--list\t\t\tList all benchmarks\n"
+		"--help\t\t\tShow this help\n",
+		RunSettings_t().flMinTime, static_cast<unsigned int>( RunSettings_t().uiRepetitions ), DEFAULT_OUTPUT_FILE,
+		DEFAULT_BASELINE_DIRECTORY, DEFAULT_PROFILE, CompareSettings_t().flThreshold * 100, CompareSettings_t().flAlpha );
+}
+
+void CBenchApp::ListBenchmarks() const
+{
+	for( const auto& benchmark : GetBenchmarks() )
+	{
+		Message( "%s\n", benchmark.pszName );
+	}
+}
+}
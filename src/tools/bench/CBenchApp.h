@@ -0,0 +1,124 @@
+#ifndef TOOLS_BENCH_CBENCHAPP_H
+#define TOOLS_BENCH_CBENCHAPP_H
+
+#include <memory>
+#include <string>
+
+#include "app/CAppSystem.h"
+
+#include "Baseline.h"
+#include "Benchmark.h"
+
+namespace filesystem
+{
+class IFileSystem;
+}
+
+namespace bench
+{
+class CBenchFixtures;
+
+/**
+*	Runs the microbenchmarks. Loads the cvar system and file system like the tools do, but doesn't create any windows or GL contexts.
+*/
+class CBenchApp final : public app::CAppSystem
+{
+public:
+	/**
+	*	Default file that results are written to.
+	*/
+	static const char* const DEFAULT_OUTPUT_FILE;
+
+	/**
+	*	Default directory that baselines are stored in.
+	*/
+	static const char* const DEFAULT_BASELINE_DIRECTORY;
+
+	/**
+	*	Machine profile used if none is given and HLTOOLS_BENCH_PROFILE isn't set.
+	*/
+	static const char* const DEFAULT_PROFILE;
+
+	enum class CommandLineResult
+	{
+		/**
+		*	The arguments are valid, and the benchmarks should be run.
+		*/
+		RUN = 0,
+
+		/**
+		*	An informational argument like --help was handled, nothing should be run.
+		*/
+		EXIT,
+
+		INVALID
+	};
+
+public:
+	CBenchApp();
+	~CBenchApp();
+
+	/**
+	*	Parses the command line. Must be called before the app is started, since starting changes the working directory.
+	*/
+	CommandLineResult ParseCommandLine( int iArgc, char* pszArgV[] );
+
+	/**
+	*	Runs the benchmarks, prints the results and writes them to the output file.
+	*	If requested, the results are then saved as the baseline of the machine profile, or compared with it.
+	*	@return Whether the results were written, and no benchmark regressed.
+	*/
+	bool RunBenchmarks();
+
+protected:
+	bool LoadAppLibraries() override;
+
+	bool Connect( const CreateInterfaceFn* pFactories, const size_t uiNumFactories ) override;
+
+	bool Initialize() override;
+
+	void ShutdownApp() override;
+
+private:
+	void PrintUsage() const;
+
+	/**
+	*	Lists the names of all benchmarks.
+	*/
+	void ListBenchmarks() const;
+
+	/**
+	*	Compares results with the baseline of the machine profile.
+	*	@return Whether the baseline was loaded, and no benchmark regressed.
+	*/
+	bool CompareWithBaseline( const std::vector<Result_t>& results ) const;
+
+private:
+	RunSettings_t m_Settings;
+	CompareSettings_t m_CompareSettings;
+
+	std::string m_szCorpusDirectory;
+	std::string m_szOutputFile;
+
+	std::string m_szBaselineDirectory;
+	std::string m_szProfile;
+
+	/**
+	*	If not empty, results are loaded from this file instead of running the benchmarks.
+	*/
+	std::string m_szInputFile;
+
+	bool m_bSaveBaseline = false;
+	bool m_bCompare = false;
+
+	filesystem::IFileSystem* m_pFileSystem = nullptr;
+
+	std::unique_ptr<CBenchFixtures> m_Fixtures;
+
+private:
+	CBenchApp( const CBenchApp& ) = delete;
+	CBenchApp& operator=( const CBenchApp& ) = delete;
+};
+}
+
+#endif //TOOLS_BENCH_CBENCHAPP_H
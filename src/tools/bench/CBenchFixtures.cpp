@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <experimental/filesystem>
+#include <system_error>
+
+#include "shared/Logging.h"
+
+#include "cvar/ICVarSystem.h"
+#include "filesystem/IFileSystem.h"
+
+#include "CBenchFixtures.h"
+
+namespace bench
+{
+namespace
+{
+/**
+*	@return Whether the file is the texture or a sequence group file of another model in the same directory, like barneyt.mdl or barney01.mdl.
+*/
+bool IsCompanionFile( const std::experimental::filesystem::path& path )
+{
+	std::string szStem = path.stem().string();
+
+	size_t uiSuffix = 0;
+
+	if( !szStem.empty() && tolower( szStem.back() ) == 't' )
+	{
+		uiSuffix = 1;
+	}
+	else if( szStem.size() >= 2 && isdigit( szStem[ szStem.size() - 1 ] ) && isdigit( szStem[ szStem.size() - 2 ] ) )
+	{
+		uiSuffix = 2;
+	}
+
+	if( uiSuffix == 0 || uiSuffix >= szStem.size() )
+		return false;
+
+	szStem.resize( szStem.size() - uiSuffix );
+
+	std::error_code error;
+
+	return std::experimental::filesystem::exists( path.parent_path() / ( szStem + path.extension().string() ), error );
+}
+}
+
+CBenchFixtures::CBenchFixtures( filesystem::IFileSystem* pFileSystem, cvar::ICVarSystem* pCVarSystem )
+	: m_pFileSystem( pFileSystem )
+	, m_pCVarSystem( pCVarSystem )
+{
+	assert( pFileSystem );
+	assert( pCVarSystem );
+}
+
+bool CBenchFixtures::LoadCorpus( const char* const pszDirectory )
+{
+	assert( pszDirectory );
+
+	namespace fs = std::experimental::filesystem;
+
+	std::error_code error;
+
+	const fs::path directory = fs::canonical( pszDirectory, error );
+
+	if( error || !fs::is_directory( directory, error ) )
+	{
+		Error( "Couldn't open corpus directory \"%s\"\n", pszDirectory );
+		return false;
+	}
+
+	m_szCorpusDirectory = directory.generic_string();
+
+	std::vector<fs::path> models;
+
+	for( fs::recursive_directory_iterator it( directory, error ), end; !error && it != end; it.increment( error ) )
+	{
+		if( !fs::is_regular_file( it->status() ) )
+			continue;
+
+		const fs::path& path = it->path();
+
+		m_Files.push_back( path.generic_string().substr( m_szCorpusDirectory.size() + 1 ) );
+
+		std::string szExtension = path.extension().string();
+
+		std::transform( szExtension.begin(), szExtension.end(), szExtension.begin(), ::tolower );
+
+		if( szExtension == ".mdl" && !IsCompanionFile( path ) )
+			models.push_back( path );
+	}
+
+	if( error )
+	{
+		Error( "Couldn't read corpus directory \"%s\": %s\n", pszDirectory, error.message().c_str() );
+		return false;
+	}
+
+	//Sorted so runs with the same corpus use the same order.
+	std::sort( m_Files.begin(), m_Files.end() );
+	std::sort( models.begin(), models.end() );
+
+	for( const auto& path : models )
+	{
+		studiomdl::CStudioModel* pModel = nullptr;
+
+		const auto result = studiomdl::LoadStudioModelFiles( path.string().c_str(), pModel );
+
+		if( result != studiomdl::StudioModelLoadResult::SUCCESS )
+		{
+			Warning( "Couldn't load corpus model \"%s\"\n", path.string().c_str() );
+			continue;
+		}
+
+		m_Models.push_back( { path.generic_string().substr( m_szCorpusDirectory.size() + 1 ), std::unique_ptr<studiomdl::CStudioModel>( pModel ) } );
+	}
+
+	//File names are looked up relative to the corpus.
+	m_pFileSystem->SetBasePath( m_szCorpusDirectory.c_str() );
+	m_pFileSystem->AddSearchPath( "." );
+
+	Message( "Loaded %u models from the corpus, %u files in total\n",
+			 static_cast<unsigned int>( m_Models.size() ), static_cast<unsigned int>( m_Files.size() ) );
+
+	return true;
+}
+
+CScopedCVarValue::CScopedCVarValue( cvar::ICVarSystem* pCVarSystem, const char* const pszName, const char* const pszValue )
+	: m_pCVarSystem( pCVarSystem )
+	, m_pszName( pszName )
+	, m_szOldValue( pCVarSystem->GetCVarString( pszName ) )
+{
+	assert( pszValue );
+
+	m_pCVarSystem->SetCVarString( m_pszName, pszValue );
+}
+
+CScopedCVarValue::~CScopedCVarValue()
+{
+	m_pCVarSystem->SetCVarString( m_pszName, m_szOldValue.c_str() );
+}
+}
@@ -0,0 +1,98 @@
+#ifndef TOOLS_BENCH_CBENCHFIXTURES_H
+#define TOOLS_BENCH_CBENCHFIXTURES_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shared/studiomodel/CStudioModel.h"
+
+namespace cvar
+{
+class ICVarSystem;
+}
+
+namespace filesystem
+{
+class IFileSystem;
+}
+
+namespace bench
+{
+/**
+*	Data that benchmarks run on. Models and file names come from a corpus directory given on the command line.
+*	Benchmarks that need them are skipped if no corpus was given; the others generate their own data.
+*/
+class CBenchFixtures final
+{
+public:
+	struct Model_t
+	{
+		/**
+		*	Name of the file, relative to the corpus directory.
+		*/
+		std::string szFilename;
+
+		std::unique_ptr<studiomdl::CStudioModel> pModel;
+	};
+
+public:
+	CBenchFixtures( filesystem::IFileSystem* pFileSystem, cvar::ICVarSystem* pCVarSystem );
+	~CBenchFixtures() = default;
+
+	filesystem::IFileSystem* GetFileSystem() const { return m_pFileSystem; }
+
+	cvar::ICVarSystem* GetCVarSystem() const { return m_pCVarSystem; }
+
+	/**
+	*	Loads every model in the directory and its subdirectories, and makes the directory the file system's base path.
+	*	Textures are converted and sequence groups are loaded, but nothing is uploaded.
+	*	@return Whether the directory could be read. Models that fail to load are skipped with a warning.
+	*/
+	bool LoadCorpus( const char* const pszDirectory );
+
+	const std::string& GetCorpusDirectory() const { return m_szCorpusDirectory; }
+
+	const std::vector<Model_t>& GetModels() const { return m_Models; }
+
+	/**
+	*	@return Names of all files in the corpus, relative to the corpus directory.
+	*/
+	const std::vector<std::string>& GetFiles() const { return m_Files; }
+
+private:
+	filesystem::IFileSystem* const m_pFileSystem;
+	cvar::ICVarSystem* const m_pCVarSystem;
+
+	std::string m_szCorpusDirectory;
+
+	std::vector<Model_t> m_Models;
+
+	std::vector<std::string> m_Files;
+
+private:
+	CBenchFixtures( const CBenchFixtures& ) = delete;
+	CBenchFixtures& operator=( const CBenchFixtures& ) = delete;
+};
+
+/**
+*	Sets a cvar for as long as this object exists, and restores the old value afterwards.
+*/
+class CScopedCVarValue final
+{
+public:
+	CScopedCVarValue( cvar::ICVarSystem* pCVarSystem, const char* const pszName, const char* const pszValue );
+	~CScopedCVarValue();
+
+private:
+	cvar::ICVarSystem* const m_pCVarSystem;
+	const char* const m_pszName;
+	std::string m_szOldValue;
+
+private:
+	CScopedCVarValue( const CScopedCVarValue& ) = delete;
+	CScopedCVarValue& operator=( const CScopedCVarValue& ) = delete;
+};
+}
+
+#endif //TOOLS_BENCH_CBENCHFIXTURES_H
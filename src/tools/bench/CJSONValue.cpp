@@ -0,0 +1,459 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "shared/Logging.h"
+
+#include "CJSONValue.h"
+
+namespace bench
+{
+/**
+*	Recursive descent parser. Strings are kept as UTF-8; \u escapes outside of ASCII are encoded as UTF-8.
+*/
+class CJSONValue::CParser final
+{
+public:
+	/**
+	*	Deepest that arrays and objects may be nested, so malformed input can't exhaust the stack.
+	*/
+	static const size_t MAX_DEPTH = 64;
+
+public:
+	CParser( const char* const pszText, const size_t uiLength, std::string& szError )
+		: m_pszCurrent( pszText )
+		, m_pszEnd( pszText + uiLength )
+		, m_szError( szError )
+	{
+	}
+
+	bool ParseDocument( CJSONValue& value )
+	{
+		if( !ParseValue( value, 0 ) )
+			return false;
+
+		SkipWhitespace();
+
+		if( m_pszCurrent != m_pszEnd )
+			return SetError( "unexpected data after the document" );
+
+		return true;
+	}
+
+private:
+	bool SetError( const char* const pszError )
+	{
+		m_szError = pszError;
+		return false;
+	}
+
+	void SkipWhitespace()
+	{
+		while( m_pszCurrent != m_pszEnd && ( *m_pszCurrent == ' ' || *m_pszCurrent == '\t' || *m_pszCurrent == '\n' || *m_pszCurrent == '\r' ) )
+			++m_pszCurrent;
+	}
+
+	bool Expect( const char* const pszLiteral )
+	{
+		const size_t uiLength = strlen( pszLiteral );
+
+		if( static_cast<size_t>( m_pszEnd - m_pszCurrent ) < uiLength || strncmp( m_pszCurrent, pszLiteral, uiLength ) )
+			return SetError( "invalid literal" );
+
+		m_pszCurrent += uiLength;
+
+		return true;
+	}
+
+	bool ParseValue( CJSONValue& value, const size_t uiDepth )
+	{
+		if( uiDepth > MAX_DEPTH )
+			return SetError( "arrays and objects are nested too deeply" );
+
+		SkipWhitespace();
+
+		if( m_pszCurrent == m_pszEnd )
+			return SetError( "unexpected end of data" );
+
+		switch( *m_pszCurrent )
+		{
+		case '{':	return ParseObject( value, uiDepth );
+		case '[':	return ParseArray( value, uiDepth );
+		case '\"':
+			{
+				value.m_Type = Type::STRING;
+				return ParseString( value.m_szValue );
+			}
+
+		case 't':
+			{
+				value.m_Type = Type::BOOLEAN;
+				value.m_bValue = true;
+				return Expect( "true" );
+			}
+
+		case 'f':
+			{
+				value.m_Type = Type::BOOLEAN;
+				value.m_bValue = false;
+				return Expect( "false" );
+			}
+
+		case 'n':
+			{
+				value.m_Type = Type::NUL;
+				return Expect( "null" );
+			}
+
+		default:	return ParseNumber( value );
+		}
+	}
+
+	bool ParseObject( CJSONValue& value, const size_t uiDepth )
+	{
+		value.m_Type = Type::OBJECT;
+
+		//Skip the '{'.
+		++m_pszCurrent;
+
+		SkipWhitespace();
+
+		if( m_pszCurrent != m_pszEnd && *m_pszCurrent == '}' )
+		{
+			++m_pszCurrent;
+			return true;
+		}
+
+		while( true )
+		{
+			SkipWhitespace();
+
+			if( m_pszCurrent == m_pszEnd || *m_pszCurrent != '\"' )
+				return SetError( "expected a member name" );
+
+			value.m_Members.emplace_back();
+
+			auto& member = value.m_Members.back();
+
+			if( !ParseString( member.first ) )
+				return false;
+
+			SkipWhitespace();
+
+			if( m_pszCurrent == m_pszEnd || *m_pszCurrent != ':' )
+				return SetError( "expected ':' after a member name" );
+
+			++m_pszCurrent;
+
+			if( !ParseValue( member.second, uiDepth + 1 ) )
+				return false;
+
+			SkipWhitespace();
+
+			if( m_pszCurrent == m_pszEnd )
+				return SetError( "unexpected end of data in an object" );
+
+			if( *m_pszCurrent == '}' )
+			{
+				++m_pszCurrent;
+				return true;
+			}
+
+			if( *m_pszCurrent != ',' )
+				return SetError( "expected ',' or '}' in an object" );
+
+			++m_pszCurrent;
+		}
+	}
+
+	bool ParseArray( CJSONValue& value, const size_t uiDepth )
+	{
+		value.m_Type = Type::ARRAY;
+
+		//Skip the '['.
+		++m_pszCurrent;
+
+		SkipWhitespace();
+
+		if( m_pszCurrent != m_pszEnd && *m_pszCurrent == ']' )
+		{
+			++m_pszCurrent;
+			return true;
+		}
+
+		while( true )
+		{
+			value.m_Array.emplace_back();
+
+			if( !ParseValue( value.m_Array.back(), uiDepth + 1 ) )
+				return false;
+
+			SkipWhitespace();
+
+			if( m_pszCurrent == m_pszEnd )
+				return SetError( "unexpected end of data in an array" );
+
+			if( *m_pszCurrent == ']' )
+			{
+				++m_pszCurrent;
+				return true;
+			}
+
+			if( *m_pszCurrent != ',' )
+				return SetError( "expected ',' or ']' in an array" );
+
+			++m_pszCurrent;
+		}
+	}
+
+	bool ParseHexDigits( unsigned int& uiCodePoint )
+	{
+		if( m_pszEnd - m_pszCurrent < 4 )
+			return SetError( "unexpected end of data in a \\u escape" );
+
+		uiCodePoint = 0;
+
+		for( int iDigit = 0; iDigit < 4; ++iDigit, ++m_pszCurrent )
+		{
+			const char cDigit = *m_pszCurrent;
+
+			uiCodePoint <<= 4;
+
+			if( cDigit >= '0' && cDigit <= '9' )
+				uiCodePoint |= cDigit - '0';
+			else if( cDigit >= 'a' && cDigit <= 'f' )
+				uiCodePoint |= cDigit - 'a' + 10;
+			else if( cDigit >= 'A' && cDigit <= 'F' )
+				uiCodePoint |= cDigit - 'A' + 10;
+			else
+				return SetError( "invalid \\u escape" );
+		}
+
+		return true;
+	}
+
+	static void AppendUTF8( std::string& szString, const unsigned int uiCodePoint )
+	{
+		if( uiCodePoint < 0x80 )
+		{
+			szString += static_cast<char>( uiCodePoint );
+		}
+		else if( uiCodePoint < 0x800 )
+		{
+			szString += static_cast<char>( 0xC0 | ( uiCodePoint >> 6 ) );
+			szString += static_cast<char>( 0x80 | ( uiCodePoint & 0x3F ) );
+		}
+		else if( uiCodePoint < 0x10000 )
+		{
+			szString += static_cast<char>( 0xE0 | ( uiCodePoint >> 12 ) );
+			szString += static_cast<char>( 0x80 | ( ( uiCodePoint >> 6 ) & 0x3F ) );
+			szString += static_cast<char>( 0x80 | ( uiCodePoint & 0x3F ) );
+		}
+		else
+		{
+			szString += static_cast<char>( 0xF0 | ( uiCodePoint >> 18 ) );
+			szString += static_cast<char>( 0x80 | ( ( uiCodePoint >> 12 ) & 0x3F ) );
+			szString += static_cast<char>( 0x80 | ( ( uiCodePoint >> 6 ) & 0x3F ) );
+			szString += static_cast<char>( 0x80 | ( uiCodePoint & 0x3F ) );
+		}
+	}
+
+	bool ParseString( std::string& szString )
+	{
+		//Skip the opening quote.
+		++m_pszCurrent;
+
+		while( m_pszCurrent != m_pszEnd )
+		{
+			const char cChar = *m_pszCurrent++;
+
+			if( cChar == '\"' )
+				return true;
+
+			if( cChar != '\\' )
+			{
+				szString += cChar;
+				continue;
+			}
+
+			if( m_pszCurrent == m_pszEnd )
+				break;
+
+			switch( *m_pszCurrent++ )
+			{
+			case '\"':	szString += '\"'; break;
+			case '\\':	szString += '\\'; break;
+			case '/':	szString += '/'; break;
+			case 'b':	szString += '\b'; break;
+			case 'f':	szString += '\f'; break;
+			case 'n':	szString += '\n'; break;
+			case 'r':	szString += '\r'; break;
+			case 't':	szString += '\t'; break;
+			case 'u':
+				{
+					unsigned int uiCodePoint;
+
+					if( !ParseHexDigits( uiCodePoint ) )
+						return false;
+
+					//Combine surrogate pairs. Lone surrogates are kept as is.
+					if( uiCodePoint >= 0xD800 && uiCodePoint < 0xDC00 &&
+						m_pszEnd - m_pszCurrent >= 6 && m_pszCurrent[ 0 ] == '\\' && m_pszCurrent[ 1 ] == 'u' )
+					{
+						m_pszCurrent += 2;
+
+						unsigned int uiLow;
+
+						if( !ParseHexDigits( uiLow ) )
+							return false;
+
+						if( uiLow >= 0xDC00 && uiLow < 0xE000 )
+						{
+							uiCodePoint = 0x10000 + ( ( uiCodePoint - 0xD800 ) << 10 ) + ( uiLow - 0xDC00 );
+						}
+						else
+						{
+							AppendUTF8( szString, uiCodePoint );
+							uiCodePoint = uiLow;
+						}
+					}
+
+					AppendUTF8( szString, uiCodePoint );
+					break;
+				}
+
+			default:	return SetError( "invalid escape sequence in a string" );
+			}
+		}
+
+		return SetError( "unexpected end of data in a string" );
+	}
+
+	bool ParseNumber( CJSONValue& value )
+	{
+		//strtod needs a terminated string, and numbers are short, so copy it.
+		char szNumber[ 64 ];
+
+		size_t uiLength = 0;
+
+		while( m_pszCurrent != m_pszEnd && uiLength + 1 < sizeof( szNumber ) &&
+			   ( ( *m_pszCurrent >= '0' && *m_pszCurrent <= '9' ) ||
+				 *m_pszCurrent == '-' || *m_pszCurrent == '+' || *m_pszCurrent == '.' || *m_pszCurrent == 'e' || *m_pszCurrent == 'E' ) )
+		{
+			szNumber[ uiLength++ ] = *m_pszCurrent++;
+		}
+
+		szNumber[ uiLength ] = '\0';
+
+		if( uiLength == 0 )
+			return SetError( "unexpected character" );
+
+		char* pszNumberEnd;
+
+		value.m_Type = Type::NUMBER;
+		value.m_flValue = strtod( szNumber, &pszNumberEnd );
+
+		if( pszNumberEnd != szNumber + uiLength )
+			return SetError( "invalid number" );
+
+		return true;
+	}
+
+private:
+	const char* m_pszCurrent;
+	const char* const m_pszEnd;
+
+	std::string& m_szError;
+
+private:
+	CParser( const CParser& ) = delete;
+	CParser& operator=( const CParser& ) = delete;
+};
+
+bool CJSONValue::Parse( const char* const pszText, const size_t uiLength, std::string& szError )
+{
+	*this = CJSONValue();
+
+	CParser parser( pszText, uiLength, szError );
+
+	if( !parser.ParseDocument( *this ) )
+	{
+		*this = CJSONValue();
+		return false;
+	}
+
+	return true;
+}
+
+bool CJSONValue::ParseFile( const char* const pszFilename )
+{
+	FILE* pFile = fopen( pszFilename, "rb" );
+
+	if( !pFile )
+	{
+		Error( "Couldn't open \"%s\" for reading\n", pszFilename );
+		return false;
+	}
+
+	std::string szText;
+
+	char szBuffer[ 4096 ];
+
+	size_t uiRead;
+
+	while( ( uiRead = fread( szBuffer, 1, sizeof( szBuffer ), pFile ) ) > 0 )
+		szText.append( szBuffer, uiRead );
+
+	const bool bReadError = ferror( pFile ) != 0;
+
+	fclose( pFile );
+
+	if( bReadError )
+	{
+		Error( "Couldn't read \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	std::string szError;
+
+	if( !Parse( szText.c_str(), szText.size(), szError ) )
+	{
+		Error( "Couldn't parse \"%s\": %s\n", pszFilename, szError.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+const CJSONValue* CJSONValue::Find( const char* const pszKey ) const
+{
+	for( const auto& member : m_Members )
+	{
+		if( member.first == pszKey )
+			return &member.second;
+	}
+
+	return nullptr;
+}
+
+const char* CJSONValue::GetMemberString( const char* const pszKey, const char* const pszDefault ) const
+{
+	const auto pValue = Find( pszKey );
+
+	return pValue && pValue->GetType() == Type::STRING ? pValue->GetString().c_str() : pszDefault;
+}
+
+double CJSONValue::GetMemberNumber( const char* const pszKey, const double flDefault ) const
+{
+	const auto pValue = Find( pszKey );
+
+	return pValue ? pValue->GetNumber( flDefault ) : flDefault;
+}
+
+bool CJSONValue::GetMemberBool( const char* const pszKey, const bool bDefault ) const
+{
+	const auto pValue = Find( pszKey );
+
+	return pValue ? pValue->GetBool( bDefault ) : bDefault;
+}
+}
@@ -0,0 +1,91 @@
+#ifndef TOOLS_BENCH_CJSONVALUE_H
+#define TOOLS_BENCH_CJSONVALUE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+/**
+*	A parsed JSON value. Only meant for reading result files back in, so it's small rather than fast.
+*/
+class CJSONValue final
+{
+public:
+	enum class Type
+	{
+		NUL = 0,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	typedef std::vector<CJSONValue> Array_t;
+	typedef std::vector<std::pair<std::string, CJSONValue>> Members_t;
+
+public:
+	CJSONValue() = default;
+
+	/**
+	*	Parses a JSON document.
+	*	@param pszText Text to parse.
+	*	@param uiLength Length of the text.
+	*	@param szError If parsing fails, a description of the error.
+	*	@return Whether the text was valid JSON.
+	*/
+	bool Parse( const char* const pszText, const size_t uiLength, std::string& szError );
+
+	/**
+	*	Reads and parses a JSON file. Errors are logged.
+	*/
+	bool ParseFile( const char* const pszFilename );
+
+	Type GetType() const { return m_Type; }
+
+	bool GetBool( const bool bDefault = false ) const { return m_Type == Type::BOOLEAN ? m_bValue : bDefault; }
+
+	double GetNumber( const double flDefault = 0 ) const { return m_Type == Type::NUMBER ? m_flValue : flDefault; }
+
+	/**
+	*	@return The string, or an empty string if this isn't a string.
+	*/
+	const std::string& GetString() const { return m_szValue; }
+
+	/**
+	*	@return The elements, or an empty array if this isn't an array.
+	*/
+	const Array_t& GetArray() const { return m_Array; }
+
+	/**
+	*	@return The member with the given key, or null if this isn't an object or doesn't have the member.
+	*/
+	const CJSONValue* Find( const char* const pszKey ) const;
+
+	/**
+	*	@return The string value of a member, or pszDefault if it doesn't exist or isn't a string.
+	*/
+	const char* GetMemberString( const char* const pszKey, const char* const pszDefault = "" ) const;
+
+	double GetMemberNumber( const char* const pszKey, const double flDefault = 0 ) const;
+
+	bool GetMemberBool( const char* const pszKey, const bool bDefault = false ) const;
+
+private:
+	class CParser;
+
+private:
+	Type m_Type = Type::NUL;
+
+	bool m_bValue = false;
+	double m_flValue = 0;
+	std::string m_szValue;
+
+	Array_t m_Array;
+	Members_t m_Members;
+};
+}
+
+#endif //TOOLS_BENCH_CJSONVALUE_H
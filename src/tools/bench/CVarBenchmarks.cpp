@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+
+#include "cvar/ICVarSystem.h"
+#include "cvar/CBaseConCommand.h"
+
+#include "Benchmark.h"
+#include "CBenchFixtures.h"
+
+namespace
+{
+/**
+*	@return The names of all commands and cvars, in alphabetical order.
+*/
+std::vector<std::string> GetCommandNames( const cvar::ICVarSystem* pCVarSystem )
+{
+	std::vector<std::string> names;
+
+	pCVarSystem->FindCommandsByPrefix( "", []( void* pObject, const cvar::CBaseConCommand& command )
+		{
+			static_cast<std::vector<std::string>*>( pObject )->push_back( command.GetName() );
+			return true;
+		},
+		&names );
+
+	return names;
+}
+
+/**
+*	Looks up every command by name.
+*	@param bMissing Whether to look up names that don't exist instead. They share a prefix with an existing command, so they aren't rejected early.
+*/
+void FindCommand( bench::CState& state, const bool bMissing )
+{
+	auto pCVarSystem = state.GetFixtures().GetCVarSystem();
+
+	auto names = GetCommandNames( pCVarSystem );
+
+	if( names.empty() )
+	{
+		state.Skip( "No commands are registered" );
+		return;
+	}
+
+	if( bMissing )
+	{
+		for( auto& szName : names )
+			szName += "_missing";
+	}
+
+	size_t uiName = 0;
+
+	while( state.KeepRunning() )
+	{
+		bench::DoNotOptimize( pCVarSystem->FindCommand( names[ uiName ].c_str() ) );
+
+		if( ++uiName == names.size() )
+			uiName = 0;
+	}
+
+	state.SetItemsProcessed( state.GetIterations() );
+}
+}
+
+HLTOOLS_BENCHMARK( CVar_FindCommand )
+{
+	FindCommand( state, false );
+}
+
+HLTOOLS_BENCHMARK( CVar_FindCommand_Missing )
+{
+	FindCommand( state, true );
+}
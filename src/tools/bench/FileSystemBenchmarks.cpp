@@ -0,0 +1,89 @@
+#include <string>
+#include <vector>
+
+#include "shared/Platform.h"
+
+#include "filesystem/IFileSystem.h"
+
+#include "Benchmark.h"
+#include "CBenchFixtures.h"
+
+namespace
+{
+/**
+*	Looks up every file in the corpus, and a name that doesn't exist for each of them.
+*	@param bCached Whether lookups may come from the path cache. If not, it's cleared before each iteration.
+*	@param bIndexed Whether search paths are indexed.
+*/
+void GetRelativePath( bench::CState& state, const bool bCached, const bool bIndexed )
+{
+	const auto& files = state.GetFixtures().GetFiles();
+
+	if( files.empty() )
+	{
+		state.Skip( "No files in the corpus" );
+		return;
+	}
+
+	auto pFileSystem = state.GetFixtures().GetFileSystem();
+
+	std::vector<std::string> names;
+
+	names.reserve( files.size() * 2 );
+
+	for( const auto& szFile : files )
+	{
+		names.push_back( szFile );
+		names.push_back( szFile + ".missing" );
+	}
+
+	const bool bWasIndexing = pFileSystem->IsSearchPathIndexing();
+
+	pFileSystem->SetSearchPathIndexing( bIndexed );
+
+	char szPath[ MAX_PATH_LENGTH ];
+
+	//Fill the cache so the first iteration isn't slower than the rest.
+	if( bCached )
+	{
+		for( const auto& szName : names )
+			pFileSystem->GetRelativePath( szName.c_str(), szPath, sizeof( szPath ) );
+	}
+
+	while( state.KeepRunning() )
+	{
+		if( !bCached )
+		{
+			state.PauseTiming();
+			pFileSystem->InvalidatePathCache();
+			state.ResumeTiming();
+		}
+
+		for( const auto& szName : names )
+		{
+			pFileSystem->GetRelativePath( szName.c_str(), szPath, sizeof( szPath ) );
+		}
+
+		bench::DoNotOptimize( szPath );
+	}
+
+	pFileSystem->SetSearchPathIndexing( bWasIndexing );
+
+	state.SetItemsProcessed( names.size() * state.GetIterations() );
+}
+}
+
+HLTOOLS_BENCHMARK( FileSystem_GetRelativePath )
+{
+	GetRelativePath( state, true, false );
+}
+
+HLTOOLS_BENCHMARK( FileSystem_GetRelativePath_Uncached )
+{
+	GetRelativePath( state, false, false );
+}
+
+HLTOOLS_BENCHMARK( FileSystem_GetRelativePath_Indexed )
+{
+	GetRelativePath( state, false, true );
+}
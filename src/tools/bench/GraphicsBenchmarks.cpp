@@ -0,0 +1,78 @@
+#include <memory>
+#include <random>
+
+#include "graphics/Palette.h"
+#include "graphics/PaletteConversion.h"
+
+#include "Benchmark.h"
+
+namespace
+{
+/**
+*	Size of the generated sprite frame. Large sprites like HUD elements and explosions are about this size.
+*/
+const size_t FRAME_WIDTH = 256;
+const size_t FRAME_HEIGHT = 256;
+
+/**
+*	Fills a buffer with random bytes. The same seed is used every time, so runs convert the same data.
+*/
+std::unique_ptr<byte[]> MakeRandomBytes( const size_t uiSize )
+{
+	auto data = std::make_unique<byte[]>( uiSize );
+
+	std::mt19937 random( 1 );
+	std::uniform_int_distribution<int> distribution( 0, 255 );
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+		data[ uiIndex ] = static_cast<byte>( distribution( random ) );
+
+	return data;
+}
+}
+
+/**
+*	The palette conversion that sprites do in Convert8To32Bit.
+*/
+HLTOOLS_BENCHMARK( Sprite_ConvertPalette )
+{
+	const auto palette = MakeRandomBytes( PALETTE_SIZE );
+
+	byte rgbaPalette[ PALETTE_ENTRIES * 4 ];
+
+	while( state.KeepRunning() )
+	{
+		graphics::ConvertPaletteToRGBA( palette.get(), rgbaPalette );
+
+		bench::DoNotOptimize( rgbaPalette );
+	}
+
+	state.SetItemsProcessed( PALETTE_ENTRIES * state.GetIterations() );
+}
+
+/**
+*	The pixel conversion that LoadSpriteFrame does for every frame.
+*/
+HLTOOLS_BENCHMARK( Sprite_ExpandFrame )
+{
+	const size_t uiPixels = FRAME_WIDTH * FRAME_HEIGHT;
+
+	const auto indices = MakeRandomBytes( uiPixels );
+	const auto palette = MakeRandomBytes( PALETTE_SIZE );
+
+	byte rgbaPalette[ PALETTE_ENTRIES * 4 ];
+
+	graphics::ConvertPaletteToRGBA( palette.get(), rgbaPalette );
+
+	auto pixels = std::make_unique<byte[]>( uiPixels * 4 );
+
+	while( state.KeepRunning() )
+	{
+		graphics::ExpandIndexedToRGBA( indices.get(), uiPixels, rgbaPalette, pixels.get() );
+
+		bench::DoNotOptimize( pixels[ 0 ] );
+	}
+
+	state.SetItemsProcessed( uiPixels * state.GetIterations() );
+	state.SetBytesProcessed( uiPixels * 4 * state.GetIterations() );
+}
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <string>
+
+#include "keyvalues/Keyvalues.h"
+
+#include "Benchmark.h"
+#include "CBenchFixtures.h"
+
+namespace
+{
+/**
+*	Number of blocks in the generated text.
+*/
+const int NUM_BLOCKS = 2000;
+
+/**
+*	Generates text that looks like entity data and settings files: blocks of short keys with numeric and string values, with a nested block in each.
+*/
+const std::string& GetKeyvaluesText()
+{
+	static const std::string szText = []()
+		{
+			static const char* const CLASSNAMES[] = { "monster_scientist", "monster_barney", "func_door", "light", "info_player_start", "env_sprite" };
+
+			std::string szResult;
+
+			char szBuffer[ 512 ];
+
+			for( int iBlock = 0; iBlock < NUM_BLOCKS; ++iBlock )
+			{
+				snprintf( szBuffer, sizeof( szBuffer ),
+						  "\"entity\"\n{\n"
+						  "\t\"classname\" \"%s\"\n"
+						  "\t\"origin\" \"%d %d %d\"\n"
+						  "\t\"angles\" \"0 %d 0\"\n"
+						  "\t\"targetname\" \"target_%d\"\n"
+						  "\t\"rendermode\" \"%d\"\n"
+						  "\t\"renderamt\" \"%d\"\n"
+						  "\t\"model\" \"models/entity_%d.mdl\"\n"
+						  "\t\"spawnflags\" \"%d\"\n"
+						  "\t\"settings\"\n\t{\n"
+						  "\t\t\"scale\" \"%d.5\"\n"
+						  "\t\t\"framerate\" \"%d\"\n"
+						  "\t}\n"
+						  "}\n",
+						  CLASSNAMES[ iBlock % ( sizeof( CLASSNAMES ) / sizeof( CLASSNAMES[ 0 ] ) ) ],
+						  iBlock * 16, -iBlock * 8, iBlock % 256,
+						  ( iBlock * 45 ) % 360,
+						  iBlock,
+						  iBlock % 6,
+						  iBlock % 256,
+						  iBlock % 32,
+						  iBlock % 4096,
+						  iBlock % 4,
+						  10 + iBlock % 20 );
+
+				szResult += szBuffer;
+			}
+
+			return szResult;
+		}();
+
+	return szText;
+}
+
+void Parse( bench::CState& state, const bool bUseArena )
+{
+	const std::string& szText = GetKeyvaluesText();
+
+	keyvalues::CKeyvaluesParserSettings settings;
+
+	settings.fUseArena = bUseArena;
+
+	keyvalues::CKeyvaluesParser parser( settings );
+
+	bool bSuccess = true;
+
+	while( state.KeepRunning() )
+	{
+		//The lexer doesn't modify its input, so every iteration reads the same text without copying it.
+		keyvalues::CKeyvaluesLexer::Memory_t memory( szText.data(), szText.size(), false );
+
+		parser.Initialize( memory );
+
+		bSuccess = parser.Parse() == keyvalues::CKeyvaluesParser::ParseResult::SUCCESS && bSuccess;
+
+		bench::DoNotOptimize( parser.GetKeyvalues() );
+	}
+
+	if( !bSuccess )
+		state.Skip( "The generated keyvalues couldn't be parsed" );
+
+	state.SetBytesProcessed( szText.size() * state.GetIterations() );
+}
+}
+
+HLTOOLS_BENCHMARK( Keyvalues_Parse )
+{
+	Parse( state, false );
+}
+
+HLTOOLS_BENCHMARK( Keyvalues_Parse_Arena )
+{
+	Parse( state, true );
+}
@@ -0,0 +1,251 @@
+#include <memory>
+#include <vector>
+
+#include "shared/renderer/studiomodel/CModelRenderInfo.h"
+#include "shared/studiomodel/CStudioModel.h"
+#include "shared/studiomodel/CStudioPoseContext.h"
+
+#include "Benchmark.h"
+#include "CBenchFixtures.h"
+
+namespace
+{
+/**
+*	Most sequences of each model that are posed, so models with many sequences don't dominate the results.
+*/
+const int MAX_SEQUENCES = 16;
+
+/**
+*	Number of frames of each sequence that are posed.
+*/
+const int FRAMES_PER_SEQUENCE = 4;
+
+studiomdl::CModelRenderInfo MakeRenderInfo( studiomdl::CStudioModel* pModel, const int iSequence, const float flFrame )
+{
+	studiomdl::CModelRenderInfo renderInfo{};
+
+	renderInfo.vecScale = glm::vec3( 1 );
+	renderInfo.pModel = pModel;
+	renderInfo.flTransparency = 1;
+	renderInfo.iSequence = iSequence;
+	renderInfo.flFrame = flFrame;
+
+	//Halfway, so blended sequences blend.
+	renderInfo.iBlender[ 0 ] = 127;
+	renderInfo.iBlender[ 1 ] = 127;
+
+	return renderInfo;
+}
+
+/**
+*	Builds the poses that bone benchmarks cycle through: a few frames between keyframes of each sequence of each model in the corpus.
+*/
+std::vector<studiomdl::CModelRenderInfo> MakePoses( const bench::CBenchFixtures& fixtures )
+{
+	std::vector<studiomdl::CModelRenderInfo> poses;
+
+	for( const auto& model : fixtures.GetModels() )
+	{
+		const studiohdr_t* const pStudioHdr = model.pModel->GetStudioHeader();
+
+		for( int iSequence = 0; iSequence < pStudioHdr->numseq && iSequence < MAX_SEQUENCES; ++iSequence )
+		{
+			const int iNumFrames = pStudioHdr->GetSequence( iSequence )->numframes;
+
+			for( int iFrame = 0; iFrame < FRAMES_PER_SEQUENCE; ++iFrame )
+			{
+				const float flFrame = iNumFrames > 1 ? ( ( iNumFrames - 1 ) * iFrame ) / static_cast<float>( FRAMES_PER_SEQUENCE ) + 0.5f : 0;
+
+				poses.push_back( MakeRenderInfo( model.pModel.get(), iSequence, flFrame ) );
+			}
+		}
+	}
+
+	return poses;
+}
+
+void SetUpBones( bench::CState& state )
+{
+	const auto poses = MakePoses( state.GetFixtures() );
+
+	if( poses.empty() )
+	{
+		state.Skip( "No models in the corpus" );
+		return;
+	}
+
+	auto context = std::make_unique<studiomdl::CStudioPoseContext>();
+
+	size_t uiPose = 0;
+	size_t uiBones = 0;
+
+	while( state.KeepRunning() )
+	{
+		const auto& renderInfo = poses[ uiPose ];
+
+		context->SetUpBones( renderInfo );
+
+		bench::DoNotOptimize( context->GetBoneTransforms()[ 0 ] );
+
+		uiBones += renderInfo.pModel->GetStudioHeader()->numbones;
+
+		if( ++uiPose == poses.size() )
+			uiPose = 0;
+	}
+
+	state.SetItemsProcessed( uiBones );
+}
+
+void TransformVertices( bench::CState& state, const bool bUseSIMD )
+{
+	const auto& models = state.GetFixtures().GetModels();
+
+	if( models.empty() )
+	{
+		state.Skip( "No models in the corpus" );
+		return;
+	}
+
+	struct Posed_t
+	{
+		std::unique_ptr<studiomdl::CStudioPoseContext> context;
+		std::vector<const mstudiomodel_t*> submodels;
+		size_t uiVertices = 0;
+	};
+
+	std::vector<Posed_t> posed;
+
+	for( const auto& model : models )
+	{
+		Posed_t entry;
+
+		entry.context = std::make_unique<studiomdl::CStudioPoseContext>();
+		entry.context->SetUpBones( MakeRenderInfo( model.pModel.get(), 0, 0 ) );
+
+		const studiohdr_t* const pStudioHdr = model.pModel->GetStudioHeader();
+
+		for( int iBodyPart = 0; iBodyPart < pStudioHdr->numbodyparts; ++iBodyPart )
+		{
+			const mstudiomodel_t* const pSubModel = model.pModel->GetModelByBodyPart( 0, iBodyPart );
+
+			if( !pSubModel )
+				continue;
+
+			entry.submodels.push_back( pSubModel );
+			entry.uiVertices += pSubModel->numverts;
+		}
+
+		posed.push_back( std::move( entry ) );
+	}
+
+	size_t uiModel = 0;
+	size_t uiVertices = 0;
+
+	while( state.KeepRunning() )
+	{
+		auto& entry = posed[ uiModel ];
+
+		for( auto pSubModel : entry.submodels )
+			entry.context->TransformVertices( pSubModel, bUseSIMD );
+
+		bench::DoNotOptimize( entry.context->GetTransformedVertices()[ 0 ] );
+
+		uiVertices += entry.uiVertices;
+
+		if( ++uiModel == posed.size() )
+			uiModel = 0;
+	}
+
+	state.SetItemsProcessed( uiVertices );
+}
+}
+
+/**
+*	Poses every corpus model with the decoded animation cache disabled and without SIMD,
+*	so the time is spent walking the run length encoded animations in CalcBoneQuaternion and CalcBonePosition.
+*/
+HLTOOLS_BENCHMARK( StudioModel_CalcBones )
+{
+	bench::CScopedCVarValue animCache( state.GetFixtures().GetCVarSystem(), "r_animcachebudget", "0" );
+	bench::CScopedCVarValue simdBones( state.GetFixtures().GetCVarSystem(), "mdl_simdbones", "0" );
+
+	SetUpBones( state );
+}
+
+/**
+*	Like StudioModel_CalcBones, but with the decoded animation cache.
+*/
+HLTOOLS_BENCHMARK( StudioModel_CalcBones_Decoded )
+{
+	bench::CScopedCVarValue simdBones( state.GetFixtures().GetCVarSystem(), "mdl_simdbones", "0" );
+
+	SetUpBones( state );
+}
+
+/**
+*	Poses every corpus model with the current settings.
+*/
+HLTOOLS_BENCHMARK( StudioModel_SetUpBones )
+{
+	SetUpBones( state );
+}
+
+/**
+*	The vertex transform that DrawPoints uses.
+*/
+HLTOOLS_BENCHMARK( StudioModel_TransformVertices )
+{
+	TransformVertices( state, false );
+}
+
+HLTOOLS_BENCHMARK( StudioModel_TransformVertices_SIMD )
+{
+	TransformVertices( state, true );
+}
+
+/**
+*	Converts textures to RGBA and resamples them to power of 2 dimensions, like UploadTexture's input is produced.
+*/
+HLTOOLS_BENCHMARK( StudioModel_ConvertTexture )
+{
+	struct Texture_t
+	{
+		const studiomdl::CStudioModel* pModel;
+		int iIndex;
+	};
+
+	std::vector<Texture_t> textures;
+
+	for( const auto& model : state.GetFixtures().GetModels() )
+	{
+		for( int iTexture = 0; iTexture < model.pModel->GetUploadableTextureCount(); ++iTexture )
+			textures.push_back( { model.pModel.get(), iTexture } );
+	}
+
+	if( textures.empty() )
+	{
+		state.Skip( "No textures in the corpus" );
+		return;
+	}
+
+	studiomdl::StudioRGBATexture_t converted;
+
+	size_t uiTexture = 0;
+	size_t uiBytes = 0;
+
+	while( state.KeepRunning() )
+	{
+		const auto& texture = textures[ uiTexture ];
+
+		texture.pModel->ConvertTexture( texture.iIndex, true, converted );
+
+		bench::DoNotOptimize( converted.pixels );
+
+		uiBytes += static_cast<size_t>( converted.iWidth ) * converted.iHeight * 4;
+
+		if( ++uiTexture == textures.size() )
+			uiTexture = 0;
+	}
+
+	state.SetBytesProcessed( uiBytes );
+}
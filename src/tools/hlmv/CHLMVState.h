@@ -11,6 +11,8 @@
 #include "graphics/Constants.h"
 #include "graphics/CCamera.h"
 
+#include "shared/studiomodel/StudioModelDump.h"
+
 #include "tools/hlmv/entity/CHLMVStudioModelEntity.h"
 
 /*
@@ -57,7 +59,16 @@ public:
 
 	void SetUseWeaponOrigin( const bool bUse );
 
-	bool DumpModelInfo( const char* const pszFilename );
+	/**
+	*	Dumps the current model's headers to the given file.
+	*/
+	bool DumpModelInfo( const char* const pszFilename, const studiomdl::DumpFormat format = studiomdl::DumpFormat::TEXT );
+
+	/**
+	*	Writes the current model's statistics to the given file.
+	*	@see studiomdl::ComputeStudioModelStats
+	*/
+	bool DumpModelStats( const char* const pszFilename, const studiomdl::DumpFormat format = studiomdl::DumpFormat::TEXT );
 
 public:
 	graphics::CCamera camera;
@@ -1,3 +1,6 @@
+#include <cstring>
+#include <vector>
+
 #include "soundsystem/shared/SoundConstants.h"
 #include "soundsystem/shared/ISoundSystem.h"
 
@@ -41,9 +44,48 @@ bool CHLMVStudioModelEntity::Spawn()
 
 	SetSkin( 0 );
 
+	if( s_ent_playsounds.GetBool() )
+		PreloadEventSounds();
+
 	return true;
 }
 
+void CHLMVStudioModelEntity::PreloadEventSounds()
+{
+	const studiohdr_t* pStudioHdr = GetModel()->GetStudioHeader();
+
+	std::vector<const char*> sounds;
+
+	for( int iSequence = 0; iSequence < pStudioHdr->numseq; ++iSequence )
+	{
+		const mstudioseqdesc_t* const pseqdesc = pStudioHdr->GetSequence( iSequence );
+
+		const mstudioevent_t* const pEvents = reinterpret_cast<const mstudioevent_t*>( pStudioHdr->GetData() + pseqdesc->eventindex );
+
+		for( int iEvent = 0; iEvent < pseqdesc->numevents; ++iEvent )
+		{
+			switch( pEvents[ iEvent ].event )
+			{
+			case SCRIPT_EVENT_SOUND:
+			case SCRIPT_EVENT_SOUND_VOICE:
+			case SCRIPT_CLIENT_EVENT_SOUND:
+				{
+					//Options aren't guaranteed to be null terminated.
+					if( memchr( pEvents[ iEvent ].options, '\0', sizeof( pEvents[ iEvent ].options ) ) )
+						sounds.push_back( pEvents[ iEvent ].options );
+
+					break;
+				}
+
+			default: break;
+			}
+		}
+	}
+
+	if( !sounds.empty() )
+		g_pSoundSystem->PreloadSounds( sounds.data(), sounds.size() );
+}
+
 void CHLMVStudioModelEntity::HandleAnimEvent( const CAnimEvent& event )
 {
 	//TODO: move to subclass.
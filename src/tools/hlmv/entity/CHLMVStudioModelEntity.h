@@ -20,6 +20,11 @@ public:
 
 	virtual void HandleAnimEvent( const CAnimEvent& event ) override;
 
+	/**
+	*	Preloads the sounds that the model's animation events play, so they don't stall the first time they're played.
+	*/
+	void PreloadEventSounds();
+
 	void AnimThink();
 
 	hlmv::CHLMVState* m_pState = nullptr;
@@ -106,6 +106,15 @@ void CHLMVSettings::PreShutdown( const char* const pszFilename )
 	GetConfigManager()->SetListener( nullptr );
 }
 
+void CHLMVSettings::AddPrefetchFiles( std::vector<std::string>& files ) const
+{
+	//Most recent first.
+	for( const auto& szFilename : m_RecentFiles->GetFiles() )
+	{
+		files.emplace_back( szFilename );
+	}
+}
+
 bool CHLMVSettings::LoadFromFile( const kv::Block& root )
 {
 	if( !CBaseSettings::LoadFromFile( root ) )
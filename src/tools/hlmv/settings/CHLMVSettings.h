@@ -160,6 +160,8 @@ protected:
 
 	void PreShutdown( const char* const pszFilename ) override final;
 
+	void AddPrefetchFiles( std::vector<std::string>& files ) const override final;
+
 	bool LoadFromFile( const kv::Block& root ) override final;
 
 	bool SaveToFile( kv::Writer& writer ) override final;
@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <memory>
+#include <tuple>
+#include <vector>
 
 #include <glm/mat4x4.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <wx/filename.h>
 #include <wx/image.h>
 #include <wx/notebook.h>
 
@@ -14,27 +20,98 @@
 #include "MouseOpFlag.h"
 #include "controlpanels/CBaseControlPanel.h"
 
+#include "graphics/BMPFile.h"
 #include "graphics/GraphicsUtils.h"
 #include "graphics/GraphicsHelpers.h"
 #include "graphics/GLRenderTarget.h"
 
+#include "shared/Logging.h"
+#include "shared/Profiler.h"
+
+#include "cvar/CCVar.h"
+#include "cvar/CVar.h"
+
+#include "shared/renderer/IRenderContext.h"
+#include "shared/renderer/sprite/ISpriteRenderer.h"
 #include "shared/renderer/studiomodel/IStudioModelRenderer.h"
 
 #include "game/entity/CStudioModelEntity.h"
 
+#include "shared/studiomodel/CStudioModel.h"
+
 #include "ui/wx/CwxOpenGL.h"
 
 #include "CMainPanel.h"
+#include "CMainWindow.h"
 
+#include "controlpanels/CAttachmentsPanel.h"
+#include "controlpanels/CBodyPartsPanel.h"
+#include "controlpanels/CBonesPanel.h"
 #include "controlpanels/CTexturesPanel.h"
 
+#include "ModelScene.h"
+
 #include "C3DView.h"
 
 //TODO: remove
 extern studiomdl::IStudioModelRenderer* g_pStudioMdlRenderer;
+extern renderer::IRenderContext* g_pRenderContext;
+extern sprite::ISpriteRenderer* g_pSpriteRenderer;
 
 namespace hlmv
 {
+static cvar::CCVar r_uvmapscale( "r_uvmapscale",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 1 )
+	.MaxValue( 8 )
+	.HelpInfo( "Size of saved UV maps, as a multiple of the texture size" ) );
+
+static cvar::CCVar r_uvmapsupersample( "r_uvmapsupersample",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 1 )
+	.MaxValue( 8 )
+	.HelpInfo( "Number of samples per pixel along each axis when saving UV maps. Values above 1 anti alias the lines" ) );
+
+static cvar::CCVar r_profiler( "r_profiler",
+	cvar::CCVarArgsBuilder()
+	.FloatValue( 0 )
+	.HelpInfo( "If non-zero, shows per frame timings of each rendering stage, and draw call and state change counts" ) );
+
+static cvar::CCVar hlmv_quadview( "hlmv_quadview",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "If non-zero, splits the 3D view into front, side, top and perspective views of the model" ) );
+
+static cvar::CCVar r_scenecache( "r_scenecache",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.HelpInfo( "If non-zero, the 3D view keeps the last model scene it drew and shows it again while nothing in it has changed. Overlays are still drawn every frame" ) );
+
+/**
+*	View directions of the fixed quad view cameras: front, side and top.
+*/
+static const glm::vec3 QUAD_VIEW_DIRECTIONS[] =
+{
+	{ -90, 0, -90 },
+	{ -90, 90, -90 },
+	{ 0, 180, -90 }
+};
+
+/**
+*	Largest render target used to draw UV maps. Larger maps are drawn in tiles.
+*/
+static const GLint UV_MAP_MAX_TILE_SIZE = 2048;
+
 wxBEGIN_EVENT_TABLE( C3DView, CwxBase3DView )
 	EVT_MOUSE_EVENTS( C3DView::MouseEvents )
 wxEND_EVENT_TABLE()
@@ -52,8 +129,25 @@ C3DView::~C3DView()
 {
 	SetCurrent( *GetContext() );
 
-	glDeleteTexture( m_GroundTexture );
-	glDeleteTexture( m_BackgroundTexture );
+	//Save any screenshots that are still being read back.
+	PollCaptures( true );
+
+	m_Readback.Destroy();
+
+	m_Encoder.Finish();
+
+	m_ProfilerOverlay.Destroy();
+
+	m_UVMapLines.Destroy();
+
+	m_SceneCache.reset();
+
+	//Loads that haven't finished would call back into this view.
+	wxOpenGL().CancelImageLoad( m_BackgroundLoad );
+	wxOpenGL().CancelImageLoad( m_GroundLoad );
+
+	wxOpenGL().glFreeImage( m_GroundTexture );
+	wxOpenGL().glFreeImage( m_BackgroundTexture );
 }
 
 void C3DView::PrepareForLoad()
@@ -63,6 +157,17 @@ void C3DView::PrepareForLoad()
 
 void C3DView::UpdateView()
 {
+	if( m_Readback.IsPending() )
+	{
+		SetCurrent( *GetContext() );
+
+		PollCaptures();
+
+		//Keep frames coming until all screenshots have been read back.
+		if( m_Readback.IsPending() )
+			m_pHLMV->RequestRedraw();
+	}
+
 	if( !m_pHLMV->GetState()->pause )
 	{
 		Refresh();
@@ -72,6 +177,8 @@ void C3DView::UpdateView()
 
 void C3DView::OnDraw()
 {
+	profiler::SetEnabled( r_profiler.GetBool() );
+
 	const Color& backgroundColor = m_pHLMV->GetSettings()->GetBackgroundColor();
 
 	glClearColor( backgroundColor.GetRed() / 255.0f, backgroundColor.GetGreen() / 255.0f, backgroundColor.GetBlue() / 255.0f, 1.0 );
@@ -91,41 +198,218 @@ void C3DView::OnDraw()
 
 	m_pHLMV->GetState()->drawnPolys = 0;
 
+	g_pRenderContext->ResetDrawStats();
+	g_pStudioMdlRenderer->ResetDrawStats();
+	g_pSpriteRenderer->ResetDrawStats();
+
 	if( m_pHLMV->GetState()->showTexture )
 	{
 		DrawTexture( m_pHLMV->GetState()->texture, m_pHLMV->GetState()->textureScale,
 					 m_pHLMV->GetState()->showUVMap, m_pHLMV->GetState()->overlayUVMap,
 					 m_pHLMV->GetState()->antiAliasUVLines, m_pHLMV->GetState()->pUVMesh );
 	}
-	else
+	else if( !DrawCachedModel() )
 	{
 		DrawModel();
 	}
 
 	if( m_pListener )
 		m_pListener->Draw3D( size );
+
+	//Results from a few frames ago end up in this frame. Also frees queries that were pending when the profiler was disabled.
+	g_pRenderContext->ResolveGPUTimers();
+
+	if( profiler::IsEnabled() )
+	{
+		profiler::EndFrame();
+
+		renderer::DrawStats_t stats = g_pRenderContext->GetDrawStats();
+
+		stats += g_pStudioMdlRenderer->GetDrawStats();
+		stats += g_pSpriteRenderer->GetDrawStats();
+
+		m_ProfilerOverlay.Draw( size, m_pHLMV->GetState()->drawnPolys, stats );
+	}
 }
 
-void C3DView::ApplyCameraToScene()
+
+bool C3DView::SceneKey_t::operator==( const SceneKey_t& other ) const
 {
-	auto pCamera = m_pHLMV->GetState()->GetCurrentCamera();
+	const auto tie = []( const SceneKey_t& key )
+	{
+		return std::tie( key.uiContentRevision, key.iWidth, key.iHeight, key.bQuadView,
+						 key.vecCameraOrigin, key.vecCameraDirection, key.flFOV, key.vecLightVector,
+						 key.backgroundTexture, key.groundTexture,
+						 key.pEntity, key.pModel, key.uiPoseRevision,
+						 key.vecOrigin, key.vecAngles, key.vecScale, key.flTransparency,
+						 key.iSequence, key.flFrame, key.iBodygroup, key.iSkin,
+						 key.iBlender[ 0 ], key.iBlender[ 1 ],
+						 key.iController[ 0 ], key.iController[ 1 ], key.iController[ 2 ], key.iController[ 3 ], key.iMouth );
+	};
+
+	return tie( *this ) == tie( other );
+}
+
+C3DView::SceneKey_t C3DView::MakeSceneKey() const
+{
+	const auto pState = m_pHLMV->GetState();
+
+	SceneKey_t key;
+
+	//Panels, menus, options and cvars all change the content revision, so the state's flags and the settings don't need to be in the key.
+	key.uiContentRevision = m_pHLMV->GetContentRevision();
+
+	const wxSize size = GetClientSize();
+
+	key.iWidth = size.GetWidth();
+	key.iHeight = size.GetHeight();
+	key.bQuadView = hlmv_quadview.GetBool();
+
+	//Dragging the mouse moves the camera and the light without issuing any commands.
+	const graphics::CCamera& camera = *pState->GetCurrentCamera();
+
+	key.vecCameraOrigin = camera.GetOrigin();
+	key.vecCameraDirection = camera.GetViewDirection();
+	key.flFOV = pState->GetCurrentFOV();
+
+	key.vecLightVector = g_pStudioMdlRenderer->GetLightVector();
+
+	key.backgroundTexture = m_BackgroundTexture;
+	key.groundTexture = m_GroundTexture;
+
+	//Animations change the entity's state on their own.
+	if( auto pEntity = pState->GetEntity() )
+	{
+		key.pEntity = pEntity;
+
+		studiomdl::CModelRenderInfo renderInfo;
+
+		pEntity->GetRenderInfo( renderInfo );
 
-	const auto& vecOrigin = pCamera->GetOrigin();
-	const auto vecAngles = pCamera->GetViewDirection();
+		key.pModel = renderInfo.pModel;
+		key.uiPoseRevision = renderInfo.pModel ? renderInfo.pModel->GetPoseRevision() : 0;
+
+		key.vecOrigin = renderInfo.vecOrigin;
+		key.vecAngles = renderInfo.vecAngles;
+		key.vecScale = renderInfo.vecScale;
+		key.flTransparency = renderInfo.flTransparency;
+
+		key.iSequence = renderInfo.iSequence;
+		key.flFrame = renderInfo.flFrame;
+		key.iBodygroup = renderInfo.iBodygroup;
+		key.iSkin = renderInfo.iSkin;
+
+		for( int iIndex = 0; iIndex < 2; ++iIndex )
+		{
+			key.iBlender[ iIndex ] = renderInfo.iBlender[ iIndex ];
+		}
+
+		for( int iIndex = 0; iIndex < 4; ++iIndex )
+		{
+			key.iController[ iIndex ] = renderInfo.iController[ iIndex ];
+		}
+
+		key.iMouth = renderInfo.iMouth;
+	}
+
+	return key;
+}
+
+bool C3DView::DrawCachedModel()
+{
+	//Stress entities animate on their own and aren't part of the key.
+	if( !r_scenecache.GetBool() || m_bSceneCacheFailed || m_pHLMV->GetEntityStress().GetCount() > 0 )
+	{
+		m_bSceneCached = false;
+		return false;
+	}
+
+	//Copying depth and stencil between framebuffers needs blits.
+	if( !GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object )
+	{
+		m_bSceneCacheFailed = true;
+		return false;
+	}
+
+	const SceneKey_t key = MakeSceneKey();
+
+	if( key.iWidth <= 0 || key.iHeight <= 0 )
+		return false;
+
+	auto pState = m_pHLMV->GetState();
+
+	if( !m_bSceneCached || key != m_SceneKey )
+	{
+		if( !m_SceneCache )
+			m_SceneCache = std::make_unique<GLRenderTarget>( true );
+
+		const bool bResized = !m_bSceneCached || key.iWidth != m_SceneKey.iWidth || key.iHeight != m_SceneKey.iHeight;
+
+		m_bSceneCached = false;
+
+		if( !m_SceneCache->Bind() )
+		{
+			m_bSceneCacheFailed = true;
+			return false;
+		}
+
+		if( bResized )
+			m_SceneCache->Setup( key.iWidth, key.iHeight, true );
+
+		const GLenum completeness = m_SceneCache->GetStatus();
+
+		if( completeness != GL_FRAMEBUFFER_COMPLETE )
+		{
+			Warning( "C3DView: Scene cache framebuffer is incomplete: %s (status code %d), drawing the scene every frame\n",
+					 glFrameBufferStatusToString( completeness ), completeness );
+
+			m_SceneCache->Unbind();
+			m_bSceneCacheFailed = true;
+			return false;
+		}
+
+		glViewport( 0, 0, key.iWidth, key.iHeight );
+
+		glClearStencil( 0 );
+
+		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+
+		DrawModel();
+
+		m_SceneCache->Unbind();
+
+		m_uiCachedDrawnPolys = pState->drawnPolys;
+
+		m_SceneKey = key;
+		m_bSceneCached = true;
+	}
+	else
+	{
+		pState->drawnPolys = m_uiCachedDrawnPolys;
+	}
 
-	const glm::mat4x4 identity = Mat4x4ModelView();
+	//Depth and stencil are copied too, so overlays are drawn the same as they would be on top of the scene.
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, m_SceneCache->GetFrameBuffer() );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
 
-	auto mat = Mat4x4ModelView();
+	glBlitFramebuffer( 0, 0, key.iWidth, key.iHeight, 0, 0, key.iWidth, key.iHeight,
+					   GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST );
 
-	mat *= glm::translate( -vecOrigin );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 
-	mat *= glm::rotate( glm::radians( vecAngles[ 2 ] ), glm::vec3{ 1, 0, 0 } );
+	glViewport( 0, 0, key.iWidth, key.iHeight );
 
-	mat *= glm::rotate( glm::radians( vecAngles[ 0 ] ), glm::vec3{ 0, 1, 0 } );
+	//Blits fail if the window's depth and stencil format doesn't match the cache's.
+	if( glGetError() != GL_NO_ERROR )
+	{
+		Warning( "C3DView: Couldn't copy the scene cache to the window, drawing the scene every frame\n" );
 
-	mat *= glm::rotate( glm::radians( vecAngles[ 1 ] ), glm::vec3{ 0, 0, 1 } );
+		m_bSceneCached = false;
+		m_bSceneCacheFailed = true;
+		return false;
+	}
 
-	glLoadMatrixf( glm::value_ptr( mat ) );
+	return true;
 }
 
 void C3DView::MouseEvents( wxMouseEvent& event )
@@ -176,12 +460,31 @@ void C3DView::MouseEvents( wxMouseEvent& event )
 		m_vecOldCoords.x = event.GetX();
 		m_vecOldCoords.y = event.GetY();
 
+		m_vecClickCoords = m_vecOldCoords;
+
 		m_iButtonsDown |= event.GetButton();
 	}
 	else if( event.ButtonUp() )
 	{
+		//Releasing the left button where it was pressed selects whatever is under it.
+		if( !m_bTexPanelMouseData && event.GetButton() == wxMOUSE_BTN_LEFT && ( m_iButtonsDown & wxMOUSE_BTN_LEFT ) &&
+			m_vecClickCoords.x == event.GetX() && m_vecClickCoords.y == event.GetY() )
+		{
+			studiomdl::PickResult_t result;
+
+			if( PickModel( event.GetX(), event.GetY(), result ) )
+				SelectPick( result );
+		}
+
 		m_iButtonsDown &= ~event.GetButton();
 	}
+	else if( event.Moving() )
+	{
+		if( !m_bTexPanelMouseData )
+			UpdateHoverPick( event.GetX(), event.GetY() );
+
+		event.Skip();
+	}
 	else if( event.Dragging() )
 	{
 		//Reset data if the panel changed.
@@ -303,6 +606,161 @@ void C3DView::MouseEvents( wxMouseEvent& event )
 	}
 }
 
+bool C3DView::PickModel( const int iX, const int iY, studiomdl::PickResult_t& result )
+{
+	result = studiomdl::PickResult_t();
+
+	auto pEntity = m_pHLMV->GetState()->GetEntity();
+
+	if( !pEntity || !pEntity->GetModel() )
+		return false;
+
+	//Picking only supports a single view.
+	if( hlmv_quadview.GetBool() )
+		return false;
+
+	const wxSize size = GetClientSize();
+
+	if( size.GetWidth() <= 0 || size.GetHeight() <= 0 )
+		return false;
+
+	auto pModel = pEntity->GetModel();
+
+	if( !m_Picker || !m_Picker->IsBuiltFor( *pModel ) )
+		m_Picker = std::make_unique<studiomdl::CStudioModelPicker>( *pModel );
+
+	const studiomdl::CStudioPoseContext* const pPose = pEntity->GetPose();
+
+	if( !pPose )
+		return false;
+
+	//Same projection as graphics::SetProjection, so the ray goes through the center of the pixel.
+	const float flTan = std::tan( glm::radians( m_pHLMV->GetState()->GetCurrentFOV() ) / 2 );
+	const float flAspect = static_cast<float>( size.GetWidth() ) / size.GetHeight();
+
+	const glm::vec3 vecViewDir(
+		( 2.0f * ( iX + 0.5f ) / size.GetWidth() - 1.0f ) * flTan * flAspect,
+		( 1.0f - 2.0f * ( iY + 0.5f ) / size.GetHeight() ) * flTan,
+		-1.0f );
+
+	const glm::mat4x4 inverseView = glm::inverse( GetSceneViewMatrix( *m_pHLMV->GetState() ) );
+
+	studiomdl::CModelRenderInfo renderInfo;
+
+	pEntity->GetRenderInfo( renderInfo );
+
+	const studiomdl::PickRay_t ray = studiomdl::TransformRayToModel(
+		glm::vec3( inverseView[ 3 ] ), glm::vec3( inverseView * glm::vec4( vecViewDir, 0 ) ),
+		renderInfo.vecOrigin, renderInfo.vecAngles, renderInfo.vecScale );
+
+	//Bones and attachments are drawn as points, so they're picked within a few pixels of them.
+	const float PICK_RADIUS = 5.0f;
+
+	const float flTolerance = PICK_RADIUS * 2.0f * flTan / size.GetHeight();
+
+	const glm::mat3x4* const pBoneTransforms = pPose->GetBoneTransforms();
+
+	auto pCurrentPage = m_pMainPanel->GetControlPanels()->GetCurrentPage();
+
+	if( pCurrentPage == m_pMainPanel->GetBonesPanel() )
+		return m_Picker->PickBone( pBoneTransforms, ray, flTolerance, result );
+
+	if( pCurrentPage == m_pMainPanel->GetAttachmentsPanel() )
+		return m_Picker->PickAttachment( pBoneTransforms, ray, flTolerance, result );
+
+	if( g_pCVar->GetCVarFloat( "r_showhitboxes" ) != 0 )
+		return m_Picker->PickHitbox( pBoneTransforms, ray, result );
+
+	return m_Picker->PickMesh( pBoneTransforms, renderInfo.iBodygroup, ray, result );
+}
+
+void C3DView::UpdateHoverPick( const int iX, const int iY )
+{
+	studiomdl::PickResult_t result;
+
+	PickModel( iX, iY, result );
+
+	if( result.type == m_HoverPick.type && result.iIndex == m_HoverPick.iIndex && result.pMesh == m_HoverPick.pMesh )
+		return;
+
+	m_HoverPick = result;
+
+	CMainWindow* const pMainWindow = m_pHLMV->GetMainWindow();
+
+	if( !pMainWindow )
+		return;
+
+	wxString szText;
+
+	auto pModel = m_pHLMV->GetState()->GetEntity() ? m_pHLMV->GetState()->GetEntity()->GetModel() : nullptr;
+
+	if( pModel )
+	{
+		const studiohdr_t* const pStudioHdr = pModel->GetStudioHeader();
+
+		switch( result.type )
+		{
+		case studiomdl::PickType::BONE:
+			szText = wxString::Format( "Bone %d: %s", result.iIndex, pStudioHdr->GetBone( result.iIndex )->name );
+			break;
+
+		case studiomdl::PickType::ATTACHMENT:
+			szText = wxString::Format( "Attachment %d: %s", result.iIndex, pStudioHdr->GetAttachment( result.iIndex )->name );
+			break;
+
+		case studiomdl::PickType::HITBOX:
+			{
+				const mstudiobbox_t& hitbox = pStudioHdr->GetHitBoxes()[ result.iIndex ];
+
+				szText = wxString::Format( "Hitbox %d: bone %s, group %d", result.iIndex, pStudioHdr->GetBone( hitbox.bone )->name, hitbox.group );
+				break;
+			}
+
+		case studiomdl::PickType::MESH:
+			{
+				const studiohdr_t* const pTextureHdr = pModel->GetTextureHeader();
+
+				const mstudiomodel_t* const pSubmodel = m_pHLMV->GetState()->GetEntity()->GetModelByBodyPart( result.iIndex );
+
+				const mstudiomesh_t* const pMeshes = ( const mstudiomesh_t* ) ( pStudioHdr->GetData() + pSubmodel->meshindex );
+
+				const int iTexture = pTextureHdr->GetSkins()[ result.pMesh->skinref ];
+
+				szText = wxString::Format( "Body part %s, mesh %d, texture %s",
+										   pStudioHdr->GetBodypart( result.iIndex )->name, static_cast<int>( result.pMesh - pMeshes ), pTextureHdr->GetTexture( iTexture )->name );
+				break;
+			}
+
+		default: break;
+		}
+	}
+
+	pMainWindow->SetStatusText( szText );
+}
+
+void C3DView::SelectPick( const studiomdl::PickResult_t& result )
+{
+	auto pCurrentPage = m_pMainPanel->GetControlPanels()->GetCurrentPage();
+
+	switch( result.type )
+	{
+	case studiomdl::PickType::BONE:
+		m_pMainPanel->GetBonesPanel()->SetBone( result.iIndex );
+		break;
+
+	case studiomdl::PickType::ATTACHMENT:
+		m_pMainPanel->GetAttachmentsPanel()->SetAttachment( result.iIndex );
+		break;
+
+	case studiomdl::PickType::MESH:
+		if( pCurrentPage == m_pMainPanel->GetBodyPartsPanel() )
+			m_pMainPanel->GetBodyPartsPanel()->SetBodypart( result.iIndex );
+		break;
+
+	default: break;
+	}
+}
+
 void C3DView::SetupRenderMode( RenderMode renderMode )
 {
 	if( renderMode == RenderMode::INVALID )
@@ -324,7 +782,7 @@ void C3DView::DrawTexture( const int iTexture, const float flTextureScale, const
 				 pEntity, iTexture, flTextureScale, bShowUVMap, bOverlayUVMap, bAntiAliasLines, pUVMesh );
 }
 
-void C3DView::DrawTexture( const int iXOffset, const int iYOffset, const int iWidth, const int iHeight,
+void C3DView::DrawTexture( const float flXOffset, const float flYOffset, const int iWidth, const int iHeight,
 				  CStudioModelEntity* pEntity,
 				  const int iTexture, const float flTextureScale, const bool bShowUVMap, const bool bOverlayUVMap, const bool bAntiAliasLines,
 				  const mstudiomesh_t* const pUVMesh )
@@ -365,8 +823,8 @@ void C3DView::DrawTexture( const int iXOffset, const int iYOffset, const int iWi
 		}
 
 		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
-		float x = ( ( ( float ) iWidth - w ) / 2 ) + iXOffset;
-		float y = ( ( ( float ) iHeight - h ) / 2 ) + iYOffset;
+		float x = ( ( ( float ) iWidth - w ) / 2 ) + flXOffset;
+		float y = ( ( ( float ) iHeight - h ) / 2 ) + flYOffset;
 
 		glDisable( GL_DEPTH_TEST );
 
@@ -406,17 +864,6 @@ void C3DView::DrawTexture( const int iXOffset, const int iYOffset, const int iWi
 		{
 			glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
 
-			CStudioModelEntity::MeshList_t meshes;
-
-			if( pUVMesh )
-			{
-				meshes.push_back( pUVMesh );
-			}
-			else
-			{
-				meshes = pEntity->ComputeMeshList( iTexture );
-			}
-
 			graphics::helpers::SetupRenderMode( RenderMode::WIREFRAME, true );
 
 			if( bAntiAliasLines )
@@ -426,34 +873,7 @@ void C3DView::DrawTexture( const int iXOffset, const int iYOffset, const int iWi
 				glEnable( GL_LINE_SMOOTH );
 			}
 
-			int i;
-
-			const mstudiomesh_t* const* ppMeshes = meshes.data();
-
-			for( size_t uiIndex = 0; uiIndex < meshes.size(); ++uiIndex, ++ppMeshes )
-			{
-				const short* ptricmds = ( short* ) ( ( byte* ) pModel->GetStudioHeader() + ( *ppMeshes )->triindex );
-
-				while( i = *( ptricmds++ ) )
-				{
-					if( i < 0 )
-					{
-						glBegin( GL_TRIANGLE_FAN );
-						i = -i;
-					}
-					else
-					{
-						glBegin( GL_TRIANGLE_STRIP );
-					}
-
-					for( ; i > 0; i--, ptricmds += 4 )
-					{
-						// FIX: put these in as integer coords, not floats
-						glVertex2f( x + ptricmds[ 2 ] * flTextureScale, y + ptricmds[ 3 ] * flTextureScale );
-					}
-					glEnd();
-				}
-			}
+			m_UVMapLines.Draw( *pModel, iTexture, pUVMesh, x, y, flTextureScale );
 
 			if( bAntiAliasLines )
 			{
@@ -474,171 +894,104 @@ void C3DView::DrawModel()
 {
 	const wxSize size = GetClientSize();
 
-	//
-	// draw background
-	//
-
-	if( m_pHLMV->GetState()->showBackground && m_BackgroundTexture != GL_INVALID_TEXTURE_ID && !m_pHLMV->GetState()->showTexture )
+	if( !hlmv_quadview.GetBool() )
 	{
-		graphics::DrawBackground( m_BackgroundTexture );
-	}
-
-	graphics::SetProjection( m_pHLMV->GetState()->GetCurrentFOV(), size.GetWidth(), size.GetHeight() );
-
-	glMatrixMode( GL_MODELVIEW );
-	glPushMatrix();
-	glLoadIdentity();
-
-	ApplyCameraToScene();
-
-	if( m_pHLMV->GetState()->drawAxes )
-	{
-		glDisable( GL_TEXTURE_2D );
-		glEnable( GL_DEPTH_TEST );
-
-		const float flLength = 50.0f;
-
-		glLineWidth( 1.0f );
-
-		glBegin( GL_LINES );
-
-		glColor3f( 1.0f, 0, 0 );
-
-		glVertex3f( 0, 0, 0 );
-		glVertex3f( flLength, 0, 0 );
-
-		glColor3f( 0, 1, 0 );
-
-		glVertex3f( 0, 0, 0 );
-		glVertex3f( 0, flLength, 0 );
-
-		glColor3f( 0, 0, 1.0f );
-
-		glVertex3f( 0, 0, 0 );
-		glVertex3f( 0, 0, flLength );
-
-		glEnd();
+		DrawModelScene( m_pHLMV, size.GetWidth(), size.GetHeight(), m_BackgroundTexture, m_GroundTexture );
+		return;
 	}
 
-	const auto vecAngles = m_pHLMV->GetState()->GetCurrentCamera()->GetViewDirection();
-
-	auto mat = Mat4x4ModelView();
-
-	mat *= glm::translate( -m_pHLMV->GetState()->GetCurrentCamera()->GetOrigin() );
-
-	mat *= glm::rotate( glm::radians( vecAngles[ 2 ] ), glm::vec3{ 1, 0, 0 } );
+	//The entity is posed once per frame and the renderer reuses skinning and lighting between views,
+	//so each view after the first only costs the draw calls.
+	const int iWidth = size.GetWidth() / 2;
+	const int iHeight = size.GetHeight() / 2;
 
-	mat *= glm::rotate( glm::radians( vecAngles[ 0 ] ), glm::vec3{ 0, 1, 0 } );
-
-	mat *= glm::rotate( glm::radians( vecAngles[ 1 ] ), glm::vec3{ 0, 0, 1 } );
-
-	const auto vecAbsOrigin = glm::inverse( mat )[ 3 ];
-	
-	g_pStudioMdlRenderer->SetViewerOrigin( glm::vec3( vecAbsOrigin ) );
-
-	//Originally this was calculated as:
-	//vecViewerRight[ 0 ] = vecViewerRight[ 1 ] = vecOrigin[ 2 ];
-	//But that vector was incorrect. It mostly affects chrome because of its reflective nature.
-
-	//Grab the angles that the player would have in-game. Since model viewer rotates the world, rather than moving the camera, this has to be adjusted.
-	glm::vec3 angViewerDir = -m_pHLMV->GetState()->GetCurrentCamera()->GetViewDirection();
-
-	angViewerDir = angViewerDir + 180.0f;
-
-	glm::vec3 vecViewerRight;
-
-	//We're using the up vector here since the in-game look can only be matched if chrome is rotated.
-	AngleVectors( angViewerDir, nullptr, nullptr, &vecViewerRight );
+	if( iWidth <= 0 || iHeight <= 0 )
+		return;
 
-	//Invert it so it points down instead of up. This allows chrome to match the in-game look.
-	g_pStudioMdlRenderer->SetViewerRight( -vecViewerRight );
+	const graphics::CCamera& currentCamera = *m_pHLMV->GetState()->GetCurrentCamera();
 
-	const unsigned int uiOldPolys = g_pStudioMdlRenderer->GetDrawnPolygonsCount();
+	unsigned int uiDrawnPolys = 0;
 
-	auto pEntity = m_pHLMV->GetState()->GetEntity();
+	glEnable( GL_SCISSOR_TEST );
 
-	if( pEntity )
+	//Top left, top right, bottom left and bottom right. The fixed views keep the current camera's offset so they zoom and pan along with it.
+	for( int iView = 0; iView < 4; ++iView )
 	{
-		// setup stencil buffer and draw mirror
-		if( m_pHLMV->GetState()->mirror )
-		{
-			graphics::helpers::DrawMirroredModel( pEntity, m_pHLMV->GetState()->renderMode,
-												  m_pHLMV->GetState()->wireframeOverlay, 
-												  m_pHLMV->GetSettings()->GetFloorLength(),
-												  m_pHLMV->GetState()->backfaceCulling );
-		}
-	}
+		const int x = ( iView % 2 ) * iWidth;
+		const int y = ( iView < 2 ) ? iHeight : 0;
 
-	SetupRenderMode();
+		glViewport( x, y, iWidth, iHeight );
+		glScissor( x, y, iWidth, iHeight );
 
-	if( pEntity )
-	{
-		const glm::vec3& vecScale = pEntity->GetScale();
+		//The first view uses the buffers cleared by OnDraw, the others clear depth and the mirror's stencil.
+		if( iView > 0 )
+			glClear( GL_DEPTH_BUFFER_BIT | ( m_pHLMV->GetState()->mirror ? GL_STENCIL_BUFFER_BIT : 0 ) );
 
-		//Determine if an odd number of scale values are negative. The cull face has to be changed if so.
-		const float flScale = vecScale.x * vecScale.y * vecScale.z;
-
-		glCullFace( flScale > 0 ? GL_FRONT : GL_BACK );
-
-		renderer::DrawFlags_t flags = renderer::DrawFlag::NONE;
-
-		//Draw wireframe overlay
-		if( m_pHLMV->GetState()->wireframeOverlay )
+		if( iView < 3 )
 		{
-			flags |= renderer::DrawFlag::WIREFRAME_OVERLAY;
-		}
+			const graphics::CCamera camera( currentCamera.GetOrigin(), QUAD_VIEW_DIRECTIONS[ iView ] );
 
-		if( m_pHLMV->GetState()->UsingWeaponOrigin() )
+			DrawModelScene( m_pHLMV, iWidth, iHeight, m_BackgroundTexture, m_GroundTexture, &camera );
+		}
+		else
 		{
-			flags |= renderer::DrawFlag::IS_VIEW_MODEL;
+			DrawModelScene( m_pHLMV, iWidth, iHeight, m_BackgroundTexture, m_GroundTexture );
 		}
 
-		pEntity->Draw( flags );
+		uiDrawnPolys += m_pHLMV->GetState()->drawnPolys;
 	}
 
-	//
-	// draw ground
-	//
+	glDisable( GL_SCISSOR_TEST );
 
-	if( m_pHLMV->GetState()->showGround )
-	{
-		graphics::helpers::DrawFloor( m_pHLMV->GetSettings()->GetFloorLength(), m_GroundTexture, m_pHLMV->GetSettings()->GetGroundColor(), m_pHLMV->GetState()->mirror );
-	}
-
-	m_pHLMV->GetState()->drawnPolys = g_pStudioMdlRenderer->GetDrawnPolygonsCount() - uiOldPolys;
+	glViewport( 0, 0, size.GetWidth(), size.GetHeight() );
 
-	glPopMatrix();
+	m_pHLMV->GetState()->drawnPolys = uiDrawnPolys;
 }
 
 bool C3DView::LoadBackgroundTexture( const wxString& szFilename )
 {
 	UnloadBackgroundTexture();
 
-	m_BackgroundTexture = wxOpenGL().glLoadImage( szFilename.c_str() );
+	//Large images take a while to decode, so the old background stays hidden until the new one is ready.
+	m_BackgroundLoad = wxOpenGL().glLoadImageAsync( szFilename.c_str(), [ this ]( const GLuint textureId )
+	{
+		m_BackgroundLoad = CwxOpenGL::INVALID_IMAGE_LOAD;
+		m_BackgroundTexture = textureId;
 
-	//TODO: notify UI
-	m_pHLMV->GetState()->showBackground = m_BackgroundTexture != GL_INVALID_TEXTURE_ID;
+		//TODO: notify UI
+		m_pHLMV->GetState()->showBackground = m_BackgroundTexture != GL_INVALID_TEXTURE_ID;
+	} );
 
-	return m_BackgroundTexture != GL_INVALID_TEXTURE_ID;
+	return m_BackgroundLoad != CwxOpenGL::INVALID_IMAGE_LOAD;
 }
 
 void C3DView::UnloadBackgroundTexture()
 {
-	glDeleteTexture( m_BackgroundTexture );
+	wxOpenGL().CancelImageLoad( m_BackgroundLoad );
+	m_BackgroundLoad = CwxOpenGL::INVALID_IMAGE_LOAD;
+
+	wxOpenGL().glFreeImage( m_BackgroundTexture );
 }
 
 bool C3DView::LoadGroundTexture( const wxString& szFilename )
 {
-	glDeleteTexture( m_GroundTexture );
+	UnloadGroundTexture();
 
-	m_GroundTexture = wxOpenGL().glLoadImage( szFilename.c_str() );
+	m_GroundLoad = wxOpenGL().glLoadImageAsync( szFilename.c_str(), [ this ]( const GLuint textureId )
+	{
+		m_GroundLoad = CwxOpenGL::INVALID_IMAGE_LOAD;
+		m_GroundTexture = textureId;
+	} );
 
-	return m_GroundTexture != GL_INVALID_TEXTURE_ID;
+	return m_GroundLoad != CwxOpenGL::INVALID_IMAGE_LOAD;
 }
 
 void C3DView::UnloadGroundTexture()
 {
-	glDeleteTexture( m_GroundTexture );
+	wxOpenGL().CancelImageLoad( m_GroundLoad );
+	m_GroundLoad = CwxOpenGL::INVALID_IMAGE_LOAD;
+
+	wxOpenGL().glFreeImage( m_GroundTexture );
 }
 
 /*
@@ -662,48 +1015,185 @@ void C3DView::SaveUVMap( const wxString& szFilename, const int iTexture )
 
 	SetCurrent( *GetContext() );
 
-	//This is the old way UV render to texture was done, but it doesn't work with some 2.1 compliant GPUs so a workaround is used
-	/*
-	GLRenderTarget* const pScratchTarget = wxOpenGL().GetScratchTarget();
+	wxFileName fileName( szFilename );
 
-	if( !pScratchTarget )
-	{
-		wxMessageBox( "Unable to create target to draw UV map to!" );
-		return;
-	}
+	if( !fileName.HasExt() )
+		fileName.SetExt( "bmp" );
+
+	//Render targets can be drawn to at any size; the back buffer is only used if they are not available.
+	if( !SaveUVMapTiled( fileName.GetFullPath(), pEntity, texture, iTexture ) )
+		SaveUVMapFromBackBuffer( fileName.GetFullPath(), pEntity, texture, iTexture );
+}
+
+bool C3DView::SaveUVMapTiled( const wxString& szFilename, CStudioModelEntity* pEntity, const mstudiotexture_t& texture, const int iTexture )
+{
+	GLRenderTarget* const pTarget = wxOpenGL().GetScratchTarget();
+
+	if( !pTarget )
+		return false;
+
+	const int iSupersample = r_uvmapsupersample.GetInt();
+
+	const int iOutputWidth = texture.width * r_uvmapscale.GetInt();
+	const int iOutputHeight = texture.height * r_uvmapscale.GetInt();
+
+	const int iFullWidth = iOutputWidth * iSupersample;
+	const int iFullHeight = iOutputHeight * iSupersample;
+
+	GLint iMaxRenderbufferSize;
+	GLint iMaxTextureSize;
+	GLint maxViewportDims[ 2 ];
 
-	pScratchTarget->Bind();
+	glGetIntegerv( GL_MAX_RENDERBUFFER_SIZE, &iMaxRenderbufferSize );
+	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &iMaxTextureSize );
+	glGetIntegerv( GL_MAX_VIEWPORT_DIMS, maxViewportDims );
 
-	pScratchTarget->Setup( texture.width, texture.height, false );
+	const GLint iMaxTileSize = std::min( { UV_MAP_MAX_TILE_SIZE, iMaxRenderbufferSize, iMaxTextureSize, maxViewportDims[ 0 ], maxViewportDims[ 1 ] } );
 
-	const GLenum completeness = pScratchTarget->GetStatus();
+	//Tiles are a multiple of the supersample factor so every tile covers whole output pixels.
+	const int iTileWidth = std::min( ( iMaxTileSize / iSupersample ) * iSupersample, iFullWidth );
+	const int iTileHeight = std::min( ( iMaxTileSize / iSupersample ) * iSupersample, iFullHeight );
+
+	if( iTileWidth <= 0 || iTileHeight <= 0 )
+		return false;
+
+	pTarget->Bind();
+
+	pTarget->Setup( iTileWidth, iTileHeight, false );
+
+	const GLenum completeness = pTarget->GetStatus();
 
 	if( completeness != GL_FRAMEBUFFER_COMPLETE )
 	{
-		wxMessageBox( wxString::Format( "UV map framebuffer is incomplete!\n%s (status code %d)", glFrameBufferStatusToString( completeness ), completeness ) );
+		Warning( "UV map framebuffer is incomplete: %s (status code %d), drawing to the back buffer instead\n", glFrameBufferStatusToString( completeness ), completeness );
 
-		pScratchTarget->Unbind();
+		pTarget->Unbind();
 
-		return;
+		return false;
 	}
 
-	glViewport( 0, 0, texture.width, texture.height );
+	struct Tile_t
+	{
+		int x, y;
+	};
+
+	std::unordered_map<graphics::CPixelReadback::Handle_t, Tile_t> tiles;
+
+	std::vector<unsigned char> pixels( static_cast<size_t>( iOutputWidth ) * iOutputHeight * 3 );
+
+	bool bSuccess = true;
+
+	//Averages each block of supersampled pixels into one output pixel. Tiles are read bottom to top, so rows are flipped here as well.
+	auto composeTile = [ & ]( const graphics::CPixelReadback::Handle_t handle, const unsigned char* pPixels, const GLsizei iWidth, const GLsizei iHeight )
+	{
+		const auto it = tiles.find( handle );
+
+		assert( it != tiles.end() );
+
+		const Tile_t tile = it->second;
+
+		tiles.erase( it );
+
+		if( !pPixels )
+		{
+			bSuccess = false;
+			return;
+		}
+
+		const int iSamples = iSupersample * iSupersample;
+
+		for( int iY = 0; iY < iHeight / iSupersample; ++iY )
+		{
+			unsigned char* pDest = pixels.data() + ( ( static_cast<size_t>( tile.y / iSupersample ) + iY ) * iOutputWidth + tile.x / iSupersample ) * 3;
+
+			for( int iX = 0; iX < iWidth / iSupersample; ++iX, pDest += 3 )
+			{
+				unsigned int sum[ 3 ] = { 0, 0, 0 };
+
+				for( int iSampleY = 0; iSampleY < iSupersample; ++iSampleY )
+				{
+					const unsigned char* pSource = pPixels + ( static_cast<size_t>( iHeight - 1 - ( iY * iSupersample + iSampleY ) ) * iWidth + iX * iSupersample ) * 3;
+
+					for( int iSampleX = 0; iSampleX < iSupersample; ++iSampleX, pSource += 3 )
+					{
+						sum[ 0 ] += pSource[ 0 ];
+						sum[ 1 ] += pSource[ 1 ];
+						sum[ 2 ] += pSource[ 2 ];
+					}
+				}
+
+				pDest[ 0 ] = static_cast<unsigned char>( sum[ 0 ] / iSamples );
+				pDest[ 1 ] = static_cast<unsigned char>( sum[ 1 ] / iSamples );
+				pDest[ 2 ] = static_cast<unsigned char>( sum[ 2 ] / iSamples );
+			}
+		}
+	};
+
+	GLfloat flOldLineWidth;
+
+	glGetFloatv( GL_LINE_WIDTH, &flOldLineWidth );
+
+	//Keep lines one output pixel wide after downsampling.
+	glLineWidth( static_cast<GLfloat>( iSupersample ) );
+
+	glViewport( 0, 0, iTileWidth, iTileHeight );
 
 	glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
 
-	glClear( GL_COLOR_BUFFER_BIT );
+	{
+		graphics::CPixelReadback readback;
 
-	DrawTexture( 0, 0, texture.width, texture.height, pEntity, iTexture, 1.0f, true, false, false, m_pHLMV->GetState()->pUVMesh );
+		for( int iTileY = 0; iTileY < iFullHeight; iTileY += iTileHeight )
+		{
+			for( int iTileX = 0; iTileX < iFullWidth; iTileX += iTileWidth )
+			{
+				glClear( GL_COLOR_BUFFER_BIT );
 
-	pScratchTarget->FinishDraw();
+				//DrawTexture centers the texture in the area; offset it so this tile's part of the texture covers the target.
+				DrawTexture( -iTileX - ( iTileWidth - iFullWidth ) / 2.0f, -iTileY - ( iTileHeight - iFullHeight ) / 2.0f, iTileWidth, iTileHeight,
+							 pEntity, iTexture, static_cast<float>( iSupersample * r_uvmapscale.GetInt() ), true, false, false, m_pHLMV->GetState()->pUVMesh );
 
-	std::unique_ptr<byte[]> rgbData = std::make_unique<byte[]>( texture.width * texture.height * 3 );
+				const GLsizei iWidth = std::min( iTileWidth, iFullWidth - iTileX );
+				const GLsizei iHeight = std::min( iTileHeight, iFullHeight - iTileY );
 
-	pScratchTarget->GetPixels( texture.width, texture.height, GL_RGB, GL_UNSIGNED_BYTE, rgbData.get() );
+				//The texture is drawn top down, so partial tiles are at the top of the target.
+				tiles[ readback.Read( 0, iTileHeight - iHeight, iWidth, iHeight, GL_COLOR_ATTACHMENT0 ) ] = { iTileX, iTileY };
 
-	pScratchTarget->Unbind();
-	*/
+				//Earlier tiles are composed while later ones are drawn.
+				readback.Poll( composeTile );
+			}
+		}
+
+		readback.Poll( composeTile, true );
+	}
 
+	glLineWidth( flOldLineWidth );
+
+	pTarget->Unbind();
+
+	if( !bSuccess )
+	{
+		wxMessageBox( wxString::Format( "Failed to read back UV map for \"%s\"!", szFilename.c_str() ) );
+		return true;
+	}
+
+	ui::CImageEncoder::Job_t job;
+
+	job.szFilename = szFilename.ToStdString();
+	job.iWidth = iOutputWidth;
+	job.iHeight = iOutputHeight;
+	job.bFlipVertically = false;
+	job.pixels = std::move( pixels );
+
+	m_Encoder.Start();
+
+	m_Encoder.Queue( std::move( job ) );
+
+	return true;
+}
+
+void C3DView::SaveUVMapFromBackBuffer( const wxString& szFilename, CStudioModelEntity* pEntity, const mstudiotexture_t& texture, const int iTexture )
+{
 	//Save off all settings we're about to modify
 	//Don't need to restore the viewport since it's reset every frame anyway
 	GLint oldReadBuffer;
@@ -740,12 +1230,25 @@ void C3DView::SaveUVMap( const wxString& szFilename, const int iTexture )
 	glDrawBuffer( oldDrawBuffer );
 	glPixelStorei( GL_PACK_ALIGNMENT, oldPackAlignment );
 
-	//We have to flip the image vertically, since OpenGL reads it upside down.
-	graphics::FlipImageVertically( texture.width, texture.height, rgbData.get() );
+	bool bSaved;
 
-	wxImage image( texture.width, texture.height, rgbData.get(), true );
+	//OpenGL reads the image upside down. BMP files store rows that way too, so they're written as is.
+	if( wxFileName( szFilename ).GetExt().IsSameAs( "bmp", false ) )
+	{
+		bSaved = graphics::bmpfile::SaveRGBBMPFile( szFilename.c_str(), texture.width, texture.height, rgbData.get(), true );
+	}
+	else
+	{
+		//Flipped while copying into the image, instead of in a separate pass.
+		wxImage image( texture.width, texture.height, false );
+
+		graphics::FlipImageVertically( texture.width, texture.height, rgbData.get(), image.GetData() );
+
+		//Let extension determine format
+		bSaved = image.SaveFile( szFilename );
+	}
 
-	if( !image.SaveFile( szFilename, wxBITMAP_TYPE_BMP ) )
+	if( !bSaved )
 	{
 		wxMessageBox( wxString::Format( "Failed to save image \"%s\"!", szFilename.c_str() ) );
 	}
@@ -755,52 +1258,139 @@ void C3DView::TakeScreenshot()
 {
 	SetCurrent( *GetContext() );
 
-	//Use the actual viewport size
-	GLint viewportSize[ 4 ];
+	//Start reading the currently displayed buffer before the dialog covers it.
+	const auto handle = m_Readback.Read( 0, 0, GetClientSize().GetWidth(), GetClientSize().GetHeight(), GL_FRONT );
 
-	glGetIntegerv( GL_VIEWPORT, viewportSize );
+	//Now ask for a filename.
+	wxFileDialog dlg( this, _( "Save screenshot" ), wxEmptyString, "screenshot.png",
+		"PNG files (*.png)|*.png|BMP files (*.bmp)|*.bmp|JPG files(*.jpg;*.jpeg)|*.jpg;*.jpeg|All files (*.*)|*.*", wxFD_SAVE | wxFD_OVERWRITE_PROMPT );
 
-	const auto width = viewportSize[ 2 ];
-	const auto height = viewportSize[ 3 ];
+	if( dlg.ShowModal() != wxID_CANCEL )
+		m_PendingCaptures[ handle ] = dlg.GetPath().ToStdString();
 
-	std::unique_ptr<byte[]> rgbData = std::make_unique<byte[]>( width * height * 3 );
+	//Readbacks without a filename are discarded when they finish.
+	m_pHLMV->RequestRedraw();
+}
 
-	GLint oldReadBuffer;
-	GLint oldPackAlignment;
+void C3DView::CaptureSequence()
+{
+	auto pEntity = m_pHLMV->GetState()->GetEntity();
 
-	glGetIntegerv( GL_READ_BUFFER, &oldReadBuffer );
-	glGetIntegerv( GL_PACK_ALIGNMENT, &oldPackAlignment );
+	if( !pEntity )
+	{
+		wxMessageBox( "No model loaded!" );
+		return;
+	}
 
-	//Read currently displayed buffer.
-	glReadBuffer( GL_FRONT );
+	wxFileDialog dlg( this, _( "Save sequence images" ), wxEmptyString, "sequence.png",
+		"PNG files (*.png)|*.png|BMP files (*.bmp)|*.bmp|JPG files(*.jpg;*.jpeg)|*.jpg;*.jpeg|All files (*.*)|*.*", wxFD_SAVE );
 
-	//Set pack alignment to 1 so no padding is added
-	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	if( dlg.ShowModal() == wxID_CANCEL )
+		return;
 
-	//Grab the image from the 3D view itself.
-	glReadPixels( viewportSize[ 0 ], viewportSize[ 1 ], width, height, GL_RGB, GL_UNSIGNED_BYTE, rgbData.get() );
+	const wxFileName baseName( dlg.GetPath() );
 
-	glReadBuffer( oldReadBuffer );
-	glPixelStorei( GL_PACK_ALIGNMENT, oldPackAlignment );
+	const wxString szExtension = baseName.HasExt() ? baseName.GetExt() : wxString( "png" );
 
-	//Now ask for a filename.
-	wxFileDialog dlg( this, _( "Save screenshot" ), wxEmptyString, "screenshot.png",
-		"PNG files (*.png)|*.png|BMP files (*.bmp)|*.bmp|JPG files(*.jpg;*.jpeg)|*.jpg;*.jpeg|All files (*.*)|*.*", wxFD_SAVE | wxFD_OVERWRITE_PROMPT );
+	const float flOldFrame = pEntity->GetFrame();
+	const bool bOldPlaySequence = m_pHLMV->GetState()->playSequence;
 
-	if( dlg.ShowModal() == wxID_CANCEL )
-		return;
+	m_pHLMV->GetState()->playSequence = false;
 
-	const wxString szFilename = dlg.GetPath();
+	SetCurrent( *GetContext() );
 
-	//We have to flip the image vertically, since OpenGL reads it upside down.
-	graphics::FlipImageVertically( width, height, rgbData.get() );
+	const int iNumFrames = pEntity->GetNumFrames();
 
-	wxImage image( width, height, rgbData.get(), true );
+	for( int iFrame = 0; iFrame < iNumFrames; ++iFrame )
+	{
+		pEntity->SetFrame( iFrame );
+
+		DrawScene();
+
+		//Read the frame that was just drawn; earlier frames are encoded while later ones are drawn.
+		wxFileName fileName( baseName );
+
+		fileName.SetName( wxString::Format( "%s_%04d", baseName.GetName(), iFrame ) );
+		fileName.SetExt( szExtension );
+
+		QueueCapture( GL_BACK, fileName.GetFullPath() );
+
+		SwapBuffers();
+
+		PollCaptures();
+	}
+
+	PollCaptures( true );
+
+	pEntity->SetFrame( static_cast<int>( flOldFrame ) );
+
+	m_pHLMV->GetState()->playSequence = bOldPlaySequence;
+
+	m_pHLMV->RequestRedraw();
+
+	Message( "Captured %d frames to \"%s\"\n", iNumFrames, baseName.GetPath().c_str().AsChar() );
+}
+
+bool C3DView::RenderToFile( const wxString& szFilename, int iWidth, int iHeight )
+{
+	if( iWidth <= 0 || iHeight <= 0 )
+	{
+		iWidth = GetClientSize().GetWidth();
+		iHeight = GetClientSize().GetHeight();
+	}
+
+	SetCurrent( *GetContext() );
+
+	wxImage image;
+
+	if( !RenderModelSceneToImage( m_pHLMV, iWidth, iHeight, m_BackgroundTexture, m_GroundTexture, image ) )
+		return false;
 
-	//Let extension determine format
 	if( !image.SaveFile( szFilename ) )
 	{
-		wxMessageBox( wxString::Format( "Failed to save image \"%s\"!", szFilename.c_str() ) );
+		Error( "C3DView::RenderToFile: Failed to save image \"%s\"\n", szFilename.c_str().AsChar() );
+		return false;
 	}
+
+	return true;
+}
+
+void C3DView::PollCaptures( const bool bWait )
+{
+	m_Readback.Poll( [ this ]( const graphics::CPixelReadback::Handle_t handle, const unsigned char* pPixels, const GLsizei iWidth, const GLsizei iHeight )
+	{
+		auto it = m_PendingCaptures.find( handle );
+
+		if( it == m_PendingCaptures.end() )
+			return;
+
+		ui::CImageEncoder::Job_t job;
+
+		job.szFilename = std::move( it->second );
+
+		m_PendingCaptures.erase( it );
+
+		if( !pPixels )
+			return;
+
+		job.iWidth = iWidth;
+		job.iHeight = iHeight;
+		//OpenGL reads the image upside down; flipped while encoding.
+		job.bFlipVertically = true;
+		job.pixels.assign( pPixels, pPixels + static_cast<size_t>( iWidth ) * iHeight * 3 );
+
+		m_Encoder.Start();
+
+		m_Encoder.Queue( std::move( job ) );
+	}, bWait );
+}
+
+void C3DView::QueueCapture( const GLenum readBuffer, const wxString& szFilename )
+{
+	const wxSize size = GetClientSize();
+
+	const auto handle = m_Readback.Read( 0, 0, size.GetWidth(), size.GetHeight(), readBuffer );
+
+	m_PendingCaptures[ handle ] = szFilename.ToStdString();
+}
 }
-}
\ No newline at end of file
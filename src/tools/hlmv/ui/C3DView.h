@@ -5,14 +5,32 @@
 
 #include "ui/wx/shared/CwxBase3DView.h"
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+
 #include <glm/vec3.hpp>
 
 #include "graphics/Constants.h"
 #include "graphics/CCamera.h"
+#include "graphics/CPixelReadback.h"
 
 #include "shared/studiomodel/studio.h"
+#include "shared/studiomodel/StudioPicking.h"
+
+#include "ui/wx/CwxOpenGL.h"
+#include "ui/wx/utility/CImageEncoder.h"
+
+#include "CProfilerOverlay.h"
+#include "CUVMapLines.h"
 
 class CStudioModelEntity;
+class GLRenderTarget;
+
+namespace studiomdl
+{
+class CStudioModel;
+}
 
 namespace hlmv
 {
@@ -51,31 +69,112 @@ public:
 	bool LoadGroundTexture( const wxString& szFilename );
 	void UnloadGroundTexture();
 
+	/**
+	*	Saves the given texture's UV map. The size and supersampling are set by the r_uvmapscale and r_uvmapsupersample cvars.
+	*/
 	void SaveUVMap( const wxString& szFilename, const int iTexture );
 
+	/**
+	*	Saves the image that is currently displayed. The pixels are read back asynchronously and saved on a worker thread.
+	*/
 	void TakeScreenshot();
 
+	/**
+	*	Saves one image for every frame of the current sequence.
+	*/
+	void CaptureSequence();
+
+	/**
+	*	Renders the scene into an offscreen target and saves it right away, without asking for a filename.
+	*	@param iWidth Width of the image, or 0 to use the size of the view.
+	*	@param iHeight Height of the image, or 0 to use the size of the view.
+	*	@return Whether the image was saved.
+	*/
+	bool RenderToFile( const wxString& szFilename, int iWidth = 0, int iHeight = 0 );
+
 protected:
 	wxDECLARE_EVENT_TABLE();
 
 private:
+	/**
+	*	Everything that the model scene depends on. If it's the same as the last frame, the cached scene is shown instead of drawing it again.
+	*/
+	struct SceneKey_t
+	{
+		unsigned int uiContentRevision = 0;
+
+		int iWidth = 0;
+		int iHeight = 0;
+		bool bQuadView = false;
+
+		glm::vec3 vecCameraOrigin;
+		glm::vec3 vecCameraDirection;
+		float flFOV = 0;
+
+		glm::vec3 vecLightVector;
+
+		GLuint backgroundTexture = GL_INVALID_TEXTURE_ID;
+		GLuint groundTexture = GL_INVALID_TEXTURE_ID;
+
+		const CStudioModelEntity* pEntity = nullptr;
+		const studiomdl::CStudioModel* pModel = nullptr;
+		unsigned int uiPoseRevision = 0;
+
+		glm::vec3 vecOrigin;
+		glm::vec3 vecAngles;
+		glm::vec3 vecScale;
+		float flTransparency = 0;
+
+		int iSequence = 0;
+		float flFrame = 0;
+		int iBodygroup = 0;
+		int iSkin = 0;
+
+		byte iBlender[ 2 ] = { 0, 0 };
+		byte iController[ 4 ] = { 0, 0, 0, 0 };
+		byte iMouth = 0;
+
+		bool operator==( const SceneKey_t& other ) const;
+		bool operator!=( const SceneKey_t& other ) const { return !( *this == other ); }
+	};
+
 	void OnDraw() override final;
 
+	SceneKey_t MakeSceneKey() const;
+
 	/**
-	*	Applies the current camera settings to the scene.
+	*	Draws the model scene into the scene cache if the scene has changed, and copies the cache to the back buffer, depth and stencil included.
+	*	@return Whether the cache was used. If not, the scene has to be drawn directly.
 	*/
-	void ApplyCameraToScene();
+	bool DrawCachedModel();
 
 	void MouseEvents( wxMouseEvent& event );
 
+	/**
+	*	Picks the part of the model under the given point of the view. Which parts are picked depends on the current control panel:
+	*	bones and attachments on their panels, hitboxes if they're shown, and meshes otherwise.
+	*	@return Whether anything was hit.
+	*/
+	bool PickModel( const int iX, const int iY, studiomdl::PickResult_t& result );
+
+	/**
+	*	Shows what's under the mouse in the status bar.
+	*/
+	void UpdateHoverPick( const int iX, const int iY );
+
+	/**
+	*	Selects what was clicked in the current control panel.
+	*/
+	void SelectPick( const studiomdl::PickResult_t& result );
+
 	void SetupRenderMode( RenderMode renderMode = RenderMode::INVALID );
 
 	void DrawTexture( const int iTexture, const float flTextureScale, const bool bShowUVMap, const bool bOverlayUVMap, const bool bAntiAliasLines, const mstudiomesh_t* const pUVMesh );
 
 	/**
 	*	Draws a texture onto the screen. Optionally draws a UV map, either on a black background, or on top of the texture.
-	*	@param iXOffset			X Offset.
-	*	@param iYOffset			Y Offset.
+	*	@param flXOffset		X Offset.
+	*	@param flYOffset		Y Offset.
 	*	@param iWidth			Width of the viewport
 	*	@param iHeight			Height of the viewport
 	*	@param pEntity			Entity whose model's texture is being drawn
@@ -86,7 +185,7 @@ private:
 	*	@param bAntiAliasLines	If true, anti aliases UV map lines
 	*	@param pUVMesh			If specified, is the mesh to use to draw the UV map. If null, all meshes that use the texture are drawn.
 	*/
-	void DrawTexture( const int iXOffset, const int iYOffset, const int iWidth, const int iHeight,
+	void DrawTexture( const float flXOffset, const float flYOffset, const int iWidth, const int iHeight,
 					  CStudioModelEntity* pEntity,
 					  const int iTexture, const float flTextureScale, const bool bShowUVMap, const bool bOverlayUVMap, const bool bAntiAliasLines,
 					  const mstudiomesh_t* const pUVMesh );
@@ -94,6 +193,28 @@ private:
 
 	void DrawModel();
 
+	/**
+	*	Draws the UV map into a render target, in tiles if it is larger than the target can be, and reads the tiles back through pixel buffers.
+	*	@return false if render targets are not available.
+	*/
+	bool SaveUVMapTiled( const wxString& szFilename, CStudioModelEntity* pEntity, const mstudiotexture_t& texture, const int iTexture );
+
+	/**
+	*	Draws the UV map into the back buffer at the texture's size. Used if render targets are not available.
+	*/
+	void SaveUVMapFromBackBuffer( const wxString& szFilename, CStudioModelEntity* pEntity, const mstudiotexture_t& texture, const int iTexture );
+
+	/**
+	*	Hands finished readbacks to the encoder.
+	*	@param bWait Whether to wait for all pending readbacks.
+	*/
+	void PollCaptures( const bool bWait = false );
+
+	/**
+	*	Queues a readback of the given buffer to be saved to the given file.
+	*/
+	void QueueCapture( const GLenum readBuffer, const wxString& szFilename );
+
 private:
 	CModelViewerApp* const m_pHLMV;
 
@@ -115,9 +236,61 @@ private:
 
 	float m_flOldTextureScale;
 
+	//Where the last button was pressed. Releasing it at the same place is a click.
+	glm::vec2 m_vecClickCoords;
+
+	/**
+	*	Built when the current model is first picked.
+	*/
+	std::unique_ptr<studiomdl::CStudioModelPicker> m_Picker;
+
+	//What the mouse was over the last time it moved.
+	studiomdl::PickResult_t m_HoverPick;
+
 	GLuint m_BackgroundTexture	= GL_INVALID_TEXTURE_ID;
 	GLuint m_GroundTexture		= GL_INVALID_TEXTURE_ID;
 
+	CwxOpenGL::ImageLoadHandle_t m_BackgroundLoad	= CwxOpenGL::INVALID_IMAGE_LOAD;
+	CwxOpenGL::ImageLoadHandle_t m_GroundLoad		= CwxOpenGL::INVALID_IMAGE_LOAD;
+
+	graphics::CPixelReadback m_Readback;
+
+	/**
+	*	Started when the first image is captured.
+	*/
+	ui::CImageEncoder m_Encoder;
+
+	/**
+	*	Maps readbacks to the file they will be saved to.
+	*/
+	std::unordered_map<graphics::CPixelReadback::Handle_t, std::string> m_PendingCaptures;
+
+	CProfilerOverlay m_ProfilerOverlay;
+
+	/**
+	*	The last model scene that was drawn. Created the first time it's used.
+	*/
+	std::unique_ptr<GLRenderTarget> m_SceneCache;
+
+	SceneKey_t m_SceneKey;
+
+	bool m_bSceneCached = false;
+
+	/**
+	*	Set if the cache couldn't be created or copied, the scene is always drawn directly from then on.
+	*/
+	bool m_bSceneCacheFailed = false;
+
+	/**
+	*	Polygons drawn by the cached scene, so the count stays the same while it's reused.
+	*/
+	unsigned int m_uiCachedDrawnPolys = 0;
+
+	/**
+	*	UV map wireframes drawn by the textures panel.
+	*/
+	CUVMapLines m_UVMapLines;
+
 private:
 	C3DView( const C3DView& ) = delete;
 	C3DView& operator=( const C3DView& ) = delete;
@@ -0,0 +1,413 @@
+#include <cstdio>
+
+#include <wx/file.h>
+
+#include "shared/CWorldTime.h"
+#include "shared/Logging.h"
+#include "shared/Trace.h"
+#include "shared/Utility.h"
+
+#include "cvar/CVar.h"
+
+#include "shared/renderer/IRenderContext.h"
+#include "shared/renderer/studiomodel/IStudioModelRenderer.h"
+
+#include "shared/studiomodel/CStudioModelManager.h"
+
+#include "game/entity/CEntityManager.h"
+
+#include "graphics/GLRenderTarget.h"
+
+#include "ui/wx/CwxOpenGL.h"
+
+#include "CModelViewerApp.h"
+#include "../CHLMVState.h"
+
+#include "ModelScene.h"
+
+#include "CBenchmark.h"
+
+//TODO: remove
+extern studiomdl::IStudioModelRenderer* g_pStudioMdlRenderer;
+extern renderer::IRenderContext* g_pRenderContext;
+
+namespace hlmv
+{
+namespace
+{
+/**
+*	Cvars that enable the overlays drawn in the overlays pass.
+*/
+static cvar::CCVarHandle g_ShowHitboxes( "r_showhitboxes" );
+static cvar::CCVarHandle g_ShowBones( "r_showbones" );
+static cvar::CCVarHandle g_ShowAttachments( "r_showattachments" );
+static cvar::CCVarHandle g_ShowEyePosition( "r_showeyeposition" );
+
+static const cvar::CCVarHandle* const g_pOverlayCVars[] =
+{
+	&g_ShowHitboxes,
+	&g_ShowBones,
+	&g_ShowAttachments,
+	&g_ShowEyePosition
+};
+
+/**
+*	Animation time that each pass starts at.
+*/
+const float START_TIME = 1.0f;
+
+profiler::SeriesStats_t ComputeStats( const std::vector<float>& values )
+{
+	//Sorted in place, so use a copy.
+	std::vector<float> sorted( values );
+
+	profiler::SeriesStats_t stats;
+
+	profiler::ComputeStats( sorted.data(), sorted.size(), stats );
+
+	return stats;
+}
+
+wxString EscapeJSON( const wxString& szString )
+{
+	wxString szResult;
+
+	for( const wxUniChar character : szString )
+	{
+		switch( character.GetValue() )
+		{
+		case '"':	szResult += "\\\""; break;
+		case '\\':	szResult += "\\\\"; break;
+		case '\n':	szResult += "\\n"; break;
+		case '\r':	szResult += "\\r"; break;
+		case '\t':	szResult += "\\t"; break;
+
+		default:
+			{
+				if( character.GetValue() < 0x20 )
+					szResult += wxString::Format( "\\u%04x", static_cast<unsigned int>( character.GetValue() ) );
+				else
+					szResult += character;
+				break;
+			}
+		}
+	}
+
+	return szResult;
+}
+
+wxString FormatStatsJSON( const profiler::SeriesStats_t& stats )
+{
+	return wxString::Format( "\"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f",
+							 stats.flAverage, stats.flP50, stats.flP95, stats.flP99, stats.flMax );
+}
+}
+
+CBenchmark::CBenchmark( CModelViewerApp* const pHLMV )
+	: m_pHLMV( pHLMV )
+{
+	wxASSERT( pHLMV );
+}
+
+CBenchmark::~CBenchmark()
+{
+}
+
+bool CBenchmark::Run( const Settings_t& settings )
+{
+	wxASSERT( settings.uiFrames > 0 );
+	wxASSERT( settings.uiFPS > 0 );
+
+	if( settings.szModel.IsEmpty() )
+	{
+		Error( "No model given to benchmark\n" );
+		return false;
+	}
+
+	studiomdl::CStudioModelManager::ModelPtr_t model;
+
+	const auto result = studiomdl::StudioModelManager().LoadModel( settings.szModel.c_str(), model );
+
+	if( result != studiomdl::StudioModelLoadResult::SUCCESS )
+	{
+		Error( "Error loading model \"%s\"\n", settings.szModel.c_str().AsChar() );
+		return false;
+	}
+
+	if( settings.iSequence < 0 || settings.iSequence >= model->GetStudioHeader()->numseq )
+	{
+		Error( "Model \"%s\" has no sequence %d\n", settings.szModel.c_str().AsChar(), settings.iSequence );
+		return false;
+	}
+
+	auto pState = m_pHLMV->GetState();
+
+	CHLMVStudioModelEntity* pEntity = static_cast<CHLMVStudioModelEntity*>( CBaseEntity::Create( "studiomodel", glm::vec3(), glm::vec3(), false ) );
+
+	if( !pEntity )
+	{
+		Error( "Couldn't create the model entity\n" );
+		return false;
+	}
+
+	pEntity->m_pState = pState;
+
+	pEntity->SetModel( model );
+
+	pEntity->Spawn();
+
+	pState->SetEntity( pEntity );
+
+	pState->CenterView();
+
+	pState->playSequence = true;
+	pState->pause = false;
+
+	bool bOldOverlays[ ARRAYSIZE( g_pOverlayCVars ) ];
+
+	for( size_t uiIndex = 0; uiIndex < ARRAYSIZE( g_pOverlayCVars ); ++uiIndex )
+	{
+		bOldOverlays[ uiIndex ] = g_pOverlayCVars[ uiIndex ]->GetBool();
+	}
+
+	const bool bOldWireframeOverlay = pState->wireframeOverlay;
+
+	m_Passes.clear();
+
+	m_Passes.push_back( { "plain", false } );
+	m_Passes.push_back( { "overlays", true } );
+
+	bool bSuccess = true;
+
+	for( auto& pass : m_Passes )
+	{
+		if( !RunPass( pEntity, settings, pass ) )
+		{
+			bSuccess = false;
+			break;
+		}
+	}
+
+	for( size_t uiIndex = 0; uiIndex < ARRAYSIZE( g_pOverlayCVars ); ++uiIndex )
+	{
+		g_pOverlayCVars[ uiIndex ]->SetBool( bOldOverlays[ uiIndex ] );
+	}
+
+	pState->wireframeOverlay = bOldWireframeOverlay;
+
+	pState->ClearEntity();
+
+	EntityManager().RunFrame();
+
+	wxOpenGL().GetErrors();
+
+	if( !bSuccess )
+		return false;
+
+	const wxString szReport = FormatReport( settings );
+
+	//Written to stdout directly so scripts get the results even though messages only go to the log in headless mode.
+	fputs( szReport.c_str(), stdout );
+	fflush( stdout );
+
+	Message( "%s", szReport.c_str().AsChar() );
+
+	if( !settings.szOutputFile.IsEmpty() )
+	{
+		const wxScopedCharBuffer json = FormatJSON( settings ).utf8_str();
+
+		wxFile file;
+
+		if( !file.Create( settings.szOutputFile, true ) || file.Write( json.data(), json.length() ) != json.length() )
+		{
+			Error( "Failed to write benchmark results to \"%s\"\n", settings.szOutputFile.c_str().AsChar() );
+			return false;
+		}
+
+		Message( "Wrote benchmark results to \"%s\"\n", settings.szOutputFile.c_str().AsChar() );
+	}
+
+	return true;
+}
+
+bool CBenchmark::RunPass( CHLMVStudioModelEntity* pEntity, const Settings_t& settings, Pass_t& pass )
+{
+	auto pState = m_pHLMV->GetState();
+
+	for( const auto pCVar : g_pOverlayCVars )
+	{
+		pCVar->SetBool( pass.bOverlays );
+	}
+
+	pState->wireframeOverlay = pass.bOverlays;
+
+	//Every pass plays the same frames of the sequence.
+	WorldTime.SetPreviousTime( START_TIME );
+	WorldTime.SetCurrentTime( START_TIME );
+	WorldTime.SetFrameTime( 0 );
+
+	pEntity->SetSequence( settings.iSequence );
+	pEntity->SetFrame( 0 );
+
+	GLRenderTarget* const pTarget = BindSceneTarget( "CBenchmark", settings.size.GetWidth(), settings.size.GetHeight() );
+
+	if( !pTarget )
+		return false;
+
+	const Color& backgroundColor = m_pHLMV->GetSettings()->GetBackgroundColor();
+
+	const float flFrameTime = 1.0f / settings.uiFPS;
+
+	//Restart recording so every pass starts with an empty history.
+	profiler::SetEnabled( false );
+	profiler::SetEnabled( true );
+
+	pass.frameTimes.reserve( settings.uiFrames );
+
+	for( unsigned int uiFrame = 0; uiFrame < WARMUP_FRAMES + settings.uiFrames; ++uiFrame )
+	{
+		const int64_t iStart = trace::GetTimestamp();
+
+		WorldTime.SetPreviousTime( WorldTime.GetCurrentTime() );
+		WorldTime.SetCurrentTime( WorldTime.GetCurrentTime() + flFrameTime );
+		WorldTime.SetFrameTime( flFrameTime );
+
+		g_pStudioMdlRenderer->RunFrame();
+
+		EntityManager().RunFrame();
+
+		glClearColor( backgroundColor.GetRed() / 255.0f, backgroundColor.GetGreen() / 255.0f, backgroundColor.GetBlue() / 255.0f, 1.0 );
+
+		glClearStencil( 0 );
+
+		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+
+		DrawModelScene( m_pHLMV, settings.size.GetWidth(), settings.size.GetHeight(), GL_INVALID_TEXTURE_ID, GL_INVALID_TEXTURE_ID );
+
+		//Nothing is presented, so wait for the GPU to make frame times include the work each frame queued.
+		glFinish();
+
+		g_pRenderContext->ResolveGPUTimers();
+
+		const float flFrameMs = ( trace::GetTimestamp() - iStart ) / 1000.0f;
+
+		profiler::EndFrame();
+
+		if( uiFrame < WARMUP_FRAMES )
+			continue;
+
+		pass.frameTimes.push_back( flFrameMs );
+
+		RecordStages( pass );
+	}
+
+	profiler::SetEnabled( false );
+
+	pTarget->FinishDraw();
+	pTarget->Unbind();
+
+	return true;
+}
+
+void CBenchmark::RecordStages( Pass_t& pass )
+{
+	const size_t uiSeriesCount = profiler::GetSeriesCount();
+
+	//Series are registered the first time they are recorded. Frames before that had nothing in them.
+	while( pass.stages.size() < uiSeriesCount )
+	{
+		const size_t uiSeries = pass.stages.size();
+
+		pass.stages.push_back( { profiler::GetSeriesName( uiSeries ), profiler::GetSeriesType( uiSeries ), std::vector<float>( pass.frameTimes.size() - 1, 0.0f ) } );
+	}
+
+	for( size_t uiSeries = 0; uiSeries < uiSeriesCount; ++uiSeries )
+	{
+		pass.stages[ uiSeries ].values.push_back( profiler::GetLastValue( uiSeries ) );
+	}
+}
+
+wxString CBenchmark::FormatReport( const Settings_t& settings ) const
+{
+	wxString szReport = wxString::Format( "Benchmark of \"%s\", sequence %d, %u frames at %u FPS, %dx%d\n",
+										  settings.szModel, settings.iSequence, settings.uiFrames, settings.uiFPS,
+										  settings.size.GetWidth(), settings.size.GetHeight() );
+
+	for( const auto& pass : m_Passes )
+	{
+		const auto frameStats = ComputeStats( pass.frameTimes );
+
+		szReport += wxString::Format( "\nPass \"%s\":\n", pass.pszName );
+
+		szReport += wxString::Format( "  %-28s avg %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f  max %8.3f ms\n",
+									  "Frame", frameStats.flAverage, frameStats.flP50, frameStats.flP95, frameStats.flP99, frameStats.flMax );
+
+		for( size_t uiSeries = 0; uiSeries < pass.stages.size(); ++uiSeries )
+		{
+			//The frame time is measured by the benchmark itself so it isn't affected by recording the stages.
+			if( uiSeries == profiler::FRAME_TIME_SERIES )
+				continue;
+
+			const auto& stage = pass.stages[ uiSeries ];
+
+			const auto stats = ComputeStats( stage.values );
+
+			szReport += wxString::Format( "  %-28s avg %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f  max %8.3f%s\n",
+										  stage.pszName, stats.flAverage, stats.flP50, stats.flP95, stats.flP99, stats.flMax,
+										  stage.type == profiler::SeriesType::TIME ? " ms" : "" );
+		}
+	}
+
+	return szReport;
+}
+
+wxString CBenchmark::FormatJSON( const Settings_t& settings ) const
+{
+	wxString szJSON = "{\n";
+
+	szJSON += wxString::Format( "\t\"model\": \"%s\",\n", EscapeJSON( settings.szModel ) );
+	szJSON += wxString::Format( "\t\"sequence\": %d,\n", settings.iSequence );
+	szJSON += wxString::Format( "\t\"frames\": %u,\n", settings.uiFrames );
+	szJSON += wxString::Format( "\t\"warmupFrames\": %u,\n", WARMUP_FRAMES );
+	szJSON += wxString::Format( "\t\"fps\": %u,\n", settings.uiFPS );
+	szJSON += wxString::Format( "\t\"width\": %d,\n", settings.size.GetWidth() );
+	szJSON += wxString::Format( "\t\"height\": %d,\n", settings.size.GetHeight() );
+	szJSON += "\t\"passes\": [\n";
+
+	for( size_t uiPass = 0; uiPass < m_Passes.size(); ++uiPass )
+	{
+		const auto& pass = m_Passes[ uiPass ];
+
+		szJSON += "\t\t{\n";
+		szJSON += wxString::Format( "\t\t\t\"name\": \"%s\",\n", pass.pszName );
+		szJSON += wxString::Format( "\t\t\t\"overlays\": %s,\n", pass.bOverlays ? "true" : "false" );
+		szJSON += wxString::Format( "\t\t\t\"frameTime\": { %s },\n", FormatStatsJSON( ComputeStats( pass.frameTimes ) ) );
+		szJSON += "\t\t\t\"stages\": [";
+
+		bool bFirst = true;
+
+		for( size_t uiSeries = 0; uiSeries < pass.stages.size(); ++uiSeries )
+		{
+			if( uiSeries == profiler::FRAME_TIME_SERIES )
+				continue;
+
+			const auto& stage = pass.stages[ uiSeries ];
+
+			szJSON += bFirst ? "\n" : ",\n";
+
+			szJSON += wxString::Format( "\t\t\t\t{ \"name\": \"%s\", \"type\": \"%s\", %s }",
+										EscapeJSON( stage.pszName ), stage.type == profiler::SeriesType::TIME ? "time" : "count",
+										FormatStatsJSON( ComputeStats( stage.values ) ) );
+
+			bFirst = false;
+		}
+
+		szJSON += bFirst ? "]\n" : "\n\t\t\t]\n";
+		szJSON += uiPass + 1 < m_Passes.size() ? "\t\t},\n" : "\t\t}\n";
+	}
+
+	szJSON += "\t]\n}\n";
+
+	return szJSON;
+}
+}
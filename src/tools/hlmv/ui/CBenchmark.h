@@ -0,0 +1,116 @@
+#ifndef HLMV_UI_CBENCHMARK_H
+#define HLMV_UI_CBENCHMARK_H
+
+#include <vector>
+
+#include "wxHLMV.h"
+
+#include "shared/Profiler.h"
+
+namespace hlmv
+{
+class CModelViewerApp;
+class CHLMVStudioModelEntity;
+
+/**
+*	Plays a sequence of a model at a fixed timestep with a fixed camera and measures how long each frame takes, without opening any windows.
+*	The model is played once without and once with overlays. Frame times and the stages that the profiler records are reported
+*	to stdout and to a JSON file, so runs on different hardware and drivers can be compared.
+*/
+class CBenchmark final
+{
+public:
+	/**
+	*	Default number of frames that are measured in each pass.
+	*/
+	static const unsigned int DEFAULT_FRAMES = 1000;
+
+	/**
+	*	Default number of frames per second of animation time that each frame advances.
+	*/
+	static const unsigned int DEFAULT_FPS = 60;
+
+	/**
+	*	Number of frames drawn before measuring starts, so texture uploads and driver warm up don't show up in the results.
+	*/
+	static const unsigned int WARMUP_FRAMES = 30;
+
+	struct Settings_t
+	{
+		wxString szModel;
+
+		/**
+		*	JSON file to write the results to.
+		*/
+		wxString szOutputFile;
+
+		wxSize size;
+
+		unsigned int uiFrames = DEFAULT_FRAMES;
+
+		int iSequence = 0;
+
+		unsigned int uiFPS = DEFAULT_FPS;
+	};
+
+private:
+	/**
+	*	Values that a profiler series had in every measured frame.
+	*/
+	struct Stage_t
+	{
+		const char* pszName;
+		profiler::SeriesType type;
+		std::vector<float> values;
+	};
+
+	struct Pass_t
+	{
+		const char* pszName;
+		bool bOverlays;
+
+		/**
+		*	Milliseconds, including the time the GPU took to finish the frame.
+		*/
+		std::vector<float> frameTimes;
+
+		/**
+		*	Indexed by profiler series.
+		*/
+		std::vector<Stage_t> stages;
+	};
+
+public:
+	CBenchmark( CModelViewerApp* const pHLMV );
+	~CBenchmark();
+
+	/**
+	*	Runs the benchmark and writes the results. The context must be current.
+	*	@return Whether the model was loaded, every pass was drawn and the results were written.
+	*/
+	bool Run( const Settings_t& settings );
+
+private:
+	bool RunPass( CHLMVStudioModelEntity* pEntity, const Settings_t& settings, Pass_t& pass );
+
+	/**
+	*	Adds the values the profiler recorded for the last frame to the pass.
+	*/
+	void RecordStages( Pass_t& pass );
+
+	wxString FormatReport( const Settings_t& settings ) const;
+
+	wxString FormatJSON( const Settings_t& settings ) const;
+
+private:
+	CModelViewerApp* const m_pHLMV;
+
+	std::vector<Pass_t> m_Passes;
+
+private:
+	CBenchmark( const CBenchmark& ) = delete;
+	CBenchmark& operator=( const CBenchmark& ) = delete;
+};
+}
+
+#endif //HLMV_UI_CBENCHMARK_H
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "shared/Logging.h"
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
+
+#include "game/entity/CBaseEntityList.h"
+
+#include "CModelViewerApp.h"
+#include "../CHLMVState.h"
+
+#include "CEntityStress.h"
+
+namespace hlmv
+{
+namespace
+{
+/**
+*	Seed used for sequences and frames, so runs can be compared.
+*/
+const std::mt19937::result_type RANDOM_SEED = 12345;
+
+static cvar::CConCommand ent_stress( "ent_stress",
+	[]( const util::CCommand& args )
+	{
+		auto pApp = dynamic_cast<CModelViewerApp*>( wxApp::GetInstance() );
+
+		if( !pApp )
+			return;
+
+		if( args.ArgC() >= 2 && !strcmp( args.Arg( 1 ), "clear" ) )
+		{
+			pApp->GetEntityStress().Clear();
+			pApp->RequestRedraw();
+			return;
+		}
+
+		if( args.ArgC() < 3 )
+		{
+			Message( "Usage: ent_stress <model> <count> [spacing] | ent_stress clear\n" );
+			return;
+		}
+
+		const long iCount = strtol( args.Arg( 2 ), nullptr, 10 );
+
+		if( iCount < 0 )
+		{
+			Warning( "ent_stress: count must not be negative\n" );
+			return;
+		}
+
+		const float flSpacing = args.ArgC() >= 4 ? static_cast<float>( atof( args.Arg( 3 ) ) ) : CEntityStress::DEFAULT_SPACING;
+
+		pApp->GetEntityStress().SetCount( args.Arg( 1 ), static_cast<size_t>( iCount ), flSpacing );
+		pApp->RequestRedraw();
+	},
+	cvar::Flag::NONE, "Spawns a grid of model entities playing random sequences and reports frame times for them. Usage: ent_stress <model> <count> [spacing] | ent_stress clear" );
+}
+
+const float CEntityStress::DEFAULT_SPACING = 64.0f;
+
+CEntityStress::CEntityStress( CModelViewerApp* const pHLMV )
+	: m_pHLMV( pHLMV )
+	, m_Random( RANDOM_SEED )
+{
+	wxASSERT( pHLMV );
+}
+
+CEntityStress::~CEntityStress()
+{
+	Clear();
+}
+
+bool CEntityStress::SetCount( const char* const pszModel, const size_t uiCount, const float flSpacing )
+{
+	wxASSERT( pszModel );
+
+	studiomdl::CStudioModelManager::ModelPtr_t model;
+
+	const auto result = studiomdl::StudioModelManager().LoadModel( pszModel, model );
+
+	if( result != studiomdl::StudioModelLoadResult::SUCCESS )
+	{
+		Error( "ent_stress: Error loading model \"%s\"\n", pszModel );
+		return false;
+	}
+
+	//The manager returns the same model for the same file, so this only clears if the model changed.
+	if( model != m_Model )
+		Clear();
+
+	m_Model = model;
+
+	const studiohdr_t* const pStudioHdr = m_Model->GetStudioHeader();
+
+	while( m_Entities.size() > uiCount )
+	{
+		if( auto pEntity = m_Entities.back().Get() )
+			GetEntityList().Remove( pEntity );
+
+		m_Entities.pop_back();
+	}
+
+	m_Entities.reserve( uiCount );
+
+	while( m_Entities.size() < uiCount )
+	{
+		CHLMVStudioModelEntity* pEntity = static_cast<CHLMVStudioModelEntity*>( CBaseEntity::Create( "studiomodel", glm::vec3(), glm::vec3(), false ) );
+
+		if( !pEntity )
+		{
+			Error( "ent_stress: Couldn't create entity %u\n", static_cast<unsigned int>( m_Entities.size() ) );
+			break;
+		}
+
+		pEntity->m_pState = m_pHLMV->GetState();
+
+		pEntity->SetModel( m_Model );
+
+		pEntity->Spawn();
+
+		if( pStudioHdr->numseq > 0 )
+		{
+			const int iSequence = std::uniform_int_distribution<int>( 0, pStudioHdr->numseq - 1 )( m_Random );
+
+			pEntity->SetSequence( iSequence );
+
+			const int iNumFrames = pStudioHdr->GetSequence( iSequence )->numframes;
+
+			pEntity->SetFrame( iNumFrames > 1 ? std::uniform_int_distribution<int>( 0, iNumFrames - 1 )( m_Random ) : 0 );
+		}
+
+		m_Entities.emplace_back( pEntity );
+	}
+
+	//Lay everything out again so the grid stays square as it grows.
+	const size_t uiColumns = static_cast<size_t>( std::ceil( std::sqrt( static_cast<double>( m_Entities.size() ) ) ) );
+
+	const float flCenter = ( uiColumns > 0 ? uiColumns - 1 : 0 ) * 0.5f;
+
+	for( size_t uiIndex = 0; uiIndex < m_Entities.size(); ++uiIndex )
+	{
+		if( auto pEntity = m_Entities[ uiIndex ].Get() )
+		{
+			pEntity->SetOrigin( glm::vec3( 
+				( uiIndex % uiColumns - flCenter ) * flSpacing, 
+				( uiIndex / uiColumns - flCenter ) * flSpacing, 
+				0 ) );
+		}
+	}
+
+	Message( "ent_stress: %u entities using \"%s\"\n", static_cast<unsigned int>( m_Entities.size() ), pszModel );
+
+	if( m_Entities.empty() )
+	{
+		m_bMeasuring = false;
+		m_Model.reset();
+	}
+	else
+	{
+		StartMeasuring();
+	}
+
+	return true;
+}
+
+void CEntityStress::Clear()
+{
+	for( auto& entity : m_Entities )
+	{
+		if( auto pEntity = entity.Get() )
+			GetEntityList().Remove( pEntity );
+	}
+
+	m_Entities.clear();
+
+	m_Model.reset();
+
+	m_bMeasuring = false;
+}
+
+void CEntityStress::Draw( const renderer::DrawFlags_t flags )
+{
+	for( auto& entity : m_Entities )
+	{
+		if( auto pEntity = entity.Get() )
+			pEntity->Draw( flags );
+	}
+}
+
+void CEntityStress::AddFrame( const double flEntityTime, const double flFrameTime )
+{
+	if( !m_bMeasuring )
+		return;
+
+	if( m_uiFrames++ < WARMUP_FRAMES )
+		return;
+
+	if( m_uiFrames == WARMUP_FRAMES + 1 )
+	{
+		m_flMinFrameTime = m_flMaxFrameTime = flFrameTime;
+	}
+	else
+	{
+		m_flMinFrameTime = std::min( m_flMinFrameTime, flFrameTime );
+		m_flMaxFrameTime = std::max( m_flMaxFrameTime, flFrameTime );
+	}
+
+	m_flTotalEntityTime += flEntityTime;
+	m_flTotalFrameTime += flFrameTime;
+
+	if( m_uiFrames == WARMUP_FRAMES + MEASURE_FRAMES )
+	{
+		Report();
+		m_bMeasuring = false;
+	}
+}
+
+void CEntityStress::StartMeasuring()
+{
+	m_bMeasuring = true;
+	m_uiFrames = 0;
+	m_flTotalEntityTime = 0;
+	m_flTotalFrameTime = 0;
+	m_flMinFrameTime = 0;
+	m_flMaxFrameTime = 0;
+}
+
+void CEntityStress::Report() const
+{
+	Message( "ent_stress: %u entities, %u frames: %.3f ms per frame (min %.3f, max %.3f), %.3f ms running entities\n",
+			 static_cast<unsigned int>( m_Entities.size() ), MEASURE_FRAMES,
+			 m_flTotalFrameTime * 1000.0 / MEASURE_FRAMES, m_flMinFrameTime * 1000.0, m_flMaxFrameTime * 1000.0,
+			 m_flTotalEntityTime * 1000.0 / MEASURE_FRAMES );
+}
+}
@@ -0,0 +1,103 @@
+#ifndef HLMV_UI_CENTITYSTRESS_H
+#define HLMV_UI_CENTITYSTRESS_H
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "shared/renderer/DrawConstants.h"
+
+#include "shared/studiomodel/CStudioModelManager.h"
+
+#include "game/entity/EHandle.h"
+
+namespace hlmv
+{
+class CModelViewerApp;
+
+/**
+*	Spawns a grid of model entities alongside the model being viewed, each playing a random sequence from a random frame,
+*	and measures how long frames take with that many entities. Used to find out how far entity thinking, pose setup and drawing scale.
+*	Sequences and frames are picked with a fixed seed, so runs with the same model and count are the same.
+*/
+class CEntityStress final
+{
+public:
+	/**
+	*	Default distance between entities in the grid.
+	*/
+	static const float DEFAULT_SPACING;
+
+	/**
+	*	Number of frames measured after the number of entities changes.
+	*/
+	static const unsigned int MEASURE_FRAMES = 120;
+
+	/**
+	*	Number of frames skipped before measuring, so spawning and uploads don't show up in the results.
+	*/
+	static const unsigned int WARMUP_FRAMES = 10;
+
+public:
+	CEntityStress( CModelViewerApp* const pHLMV );
+	~CEntityStress();
+
+	/**
+	*	@return Number of spawned entities.
+	*/
+	size_t GetCount() const { return m_Entities.size(); }
+
+	/**
+	*	Spawns or removes entities until there are uiCount entities using the given model, and lays them out in a grid.
+	*	Entities using another model are removed first. Frame times are measured and reported once enough frames have run.
+	*	@return Whether the model was loaded.
+	*/
+	bool SetCount( const char* const pszModel, const size_t uiCount, const float flSpacing );
+
+	/**
+	*	Removes all spawned entities.
+	*/
+	void Clear();
+
+	/**
+	*	Draws all spawned entities. Entities outside the view are culled by the renderer.
+	*/
+	void Draw( const renderer::DrawFlags_t flags );
+
+	/**
+	*	Adds the times that a frame took to the measurement, if one is running.
+	*	@param flEntityTime Time spent running entities, in seconds.
+	*	@param flFrameTime Time spent on the whole frame, in seconds.
+	*/
+	void AddFrame( const double flEntityTime, const double flFrameTime );
+
+private:
+	void StartMeasuring();
+
+	void Report() const;
+
+private:
+	CModelViewerApp* const m_pHLMV;
+
+	studiomdl::CStudioModelManager::ModelPtr_t m_Model;
+
+	std::vector<EHandle> m_Entities;
+
+	std::mt19937 m_Random;
+
+	bool m_bMeasuring = false;
+
+	unsigned int m_uiFrames = 0;
+
+	double m_flTotalEntityTime = 0;
+	double m_flTotalFrameTime = 0;
+	double m_flMinFrameTime = 0;
+	double m_flMaxFrameTime = 0;
+
+private:
+	CEntityStress( const CEntityStress& ) = delete;
+	CEntityStress& operator=( const CEntityStress& ) = delete;
+};
+}
+
+#endif //HLMV_UI_CENTITYSTRESS_H
@@ -14,12 +14,19 @@
 #include "controlpanels/CFullscreenPanel.h"
 #include "controlpanels/CGlobalFlagsPanel.h"
 
+#include "shared/Logging.h"
+
+#include "cvar/CCVar.h"
+
 #include "shared/studiomodel/CStudioModel.h"
+#include "shared/studiomodel/CStudioModelManager.h"
 #include "shared/renderer/studiomodel/IStudioModelRenderer.h"
 #include "game/entity/CStudioModelEntity.h"
 #include "game/entity/CBaseEntityList.h"
 
 #include "CModelViewerApp.h"
+#include "CMainWindow.h"
+#include "CPreviewServer.h"
 #include "../CHLMVState.h"
 
 #include "CMainPanel.h"
@@ -27,6 +34,8 @@
 //TODO: remove
 extern studiomdl::IStudioModelRenderer* g_pStudioMdlRenderer;
 
+static cvar::CCVar hlmv_loadbudget( "hlmv_loadbudget", cvar::CCVarArgsBuilder().FloatValue( 8 ).MinValue( 1 ).HelpInfo( "Time, in milliseconds, that may be spent uploading a model that is being loaded each frame" ) );
+
 namespace hlmv
 {
 static const wxString VIEWORIGINS[] = 
@@ -153,6 +162,9 @@ void CMainPanel::RunFrame()
 {
 	++m_uiCurrentFPS;
 
+	if( m_ModelLoader.IsLoading() )
+		UpdateModelLoad();
+
 	const long long iCurrentTick = GetCurrentTick();
 
 	ForEachPanel( &CBaseControlPanel::ViewPreUpdate );
@@ -200,70 +212,195 @@ void CMainPanel::Draw3D( const wxSize& size )
 	}
 }
 
-bool CMainPanel::LoadModel( const wxString& szFilename )
+bool CMainPanel::LoadModel( const wxString& szFilename, const bool bQuiet )
 {
+	//The preview server answers its own loads that replace each other.
+	if( !bQuiet )
+		AbandonQuietLoad();
+
 	m_p3DView->PrepareForLoad();
 
 	m_pHLMV->GetState()->ResetModelData();
 
 	m_pHLMV->GetState()->ClearEntity();
 
-	auto szCFilename = szFilename.char_str( wxMBConvUTF8() );
+	m_ModelLoader.Start( szFilename.c_str() );
+
+	m_iLastLoadProgress = -1;
+	m_bReloading = false;
+	m_bQuietLoad = bQuiet;
+
+	return true;
+}
+
+bool CMainPanel::ReloadModel( const wxString& szFilename, const bool bQuiet )
+{
+	auto pEntity = m_pHLMV->GetState()->GetEntity();
+
+	//Nothing to keep, so load it like any other model.
+	if( !pEntity || !pEntity->GetModel() || m_ModelLoader.IsLoading() )
+		return LoadModel( szFilename, bQuiet );
+
+	//The current model stays in use until the new one is ready.
+	m_ModelLoader.StartReload( szFilename.c_str(), pEntity->GetModelPtr() );
+
+	m_iLastLoadProgress = -1;
+	m_bReloading = true;
+	m_bQuietLoad = bQuiet;
 
-	studiomdl::CStudioModel* pModel;
+	return true;
+}
+
+void CMainPanel::UpdateModelLoad()
+{
+	const bool bFinished = m_ModelLoader.Update( hlmv_loadbudget.GetFloat() / 1000.0 );
 
-	const auto res = studiomdl::LoadStudioModel( szFilename.c_str(), pModel );
+	CMainWindow* const pMainWindow = m_pHLMV->GetMainWindow();
 
-	switch( res )
+	if( bFinished )
+	{
+		const bool bSuccess = FinishLoadModel();
+
+		if( pMainWindow )
+			pMainWindow->ModelLoaded( m_ModelLoader.GetFilename().c_str(), bSuccess );
+
+		return;
+	}
+
+	//Only update the status bar when the percentage changes.
+	const int iProgress = static_cast<int>( m_ModelLoader.GetProgress() * 100 );
+
+	if( pMainWindow && iProgress != m_iLastLoadProgress )
+	{
+		m_iLastLoadProgress = iProgress;
+
+		pMainWindow->SetStatusText( wxString::Format( "Loading \"%s\": %d%%", m_ModelLoader.GetFilename().c_str(), iProgress ) );
+	}
+}
+
+bool CMainPanel::FinishLoadModel()
+{
+	const auto& szFilename = m_ModelLoader.GetFilename();
+
+	//If a reload fails, the current model is kept.
+	const bool bReload = m_bReloading && m_pHLMV->GetState()->GetEntity();
+
+	m_bReloading = false;
+
+	m_szLoadError.clear();
+
+	switch( m_ModelLoader.GetResult() )
 	{
 	default:
 	case studiomdl::StudioModelLoadResult::FAILURE:
 		{
-			wxMessageBox( wxString::Format( "Error loading model \"%s\"\n", szCFilename.data() ), "Error" );
-			return false;
+			m_szLoadError = "Error loading model \"" + szFilename + "\"";
+			break;
 		}
 
 	case studiomdl::StudioModelLoadResult::POSTLOADFAILURE:
 		{
-			wxMessageBox( wxString::Format( "Error post-loading model \"%s\"\n", szCFilename.data() ), "Error" );
-			return false;
+			m_szLoadError = "Error post-loading model \"" + szFilename + "\"";
+			break;
 		}
 
 	case studiomdl::StudioModelLoadResult::VERSIONDIFFERS:
 		{
-			wxMessageBox( wxString::Format( "Error loading model \"%s\": version differs\n", szCFilename.data() ), "Error" );
-			return false;
+			m_szLoadError = "Error loading model \"" + szFilename + "\": version differs";
+			break;
 		}
 
 	case studiomdl::StudioModelLoadResult::SUCCESS: break;
 	}
 
+	if( !m_szLoadError.empty() )
+	{
+		//Nobody might be around to close a dialog for loads started by the preview server, and its client would wait until they did.
+		if( m_bQuietLoad )
+			Error( "%s\n", m_szLoadError.c_str() );
+		else
+			wxMessageBox( m_szLoadError + "\n", "Error" );
+
+		return false;
+	}
+
+	int iOldSequence = 0;
+	int iOldFrame = 0;
+
+	if( bReload )
+	{
+		auto pOldEntity = m_pHLMV->GetState()->GetEntity();
+
+		iOldSequence = pOldEntity->GetSequence();
+		iOldFrame = static_cast<int>( pOldEntity->GetFrame() );
+
+		//Points into the old model's data.
+		m_pHLMV->GetState()->pUVMesh = nullptr;
+
+		m_p3DView->PrepareForLoad();
+
+		m_pHLMV->GetState()->ClearEntity();
+
+		Message( "Reloaded model \"%s\", %u textures were unchanged\n", szFilename.c_str(), static_cast<unsigned int>( m_ModelLoader.GetNumReusedTextures() ) );
+	}
+
+	auto model = studiomdl::StudioModelManager().AddModel( m_ModelLoader.GetFilename().c_str(), m_ModelLoader.ReleaseModel() );
+
 	CHLMVStudioModelEntity* pEntity = static_cast<CHLMVStudioModelEntity*>( CBaseEntity::Create( "studiomodel", glm::vec3(), glm::vec3(), false ) );
 
 	if( pEntity )
 	{
 		pEntity->m_pState = m_pHLMV->GetState();
 
-		pEntity->SetModel( pModel );
+		pEntity->SetModel( model );
 
 		pEntity->Spawn();
 
 		m_pHLMV->GetState()->SetEntity( pEntity );
 	}
+
+	InitializeUI();
+
+	if( bReload )
+	{
+		m_pSequencesPanel->SetSequence( iOldSequence );
+
+		//The panel only sets frames while the sequence is paused.
+		if( m_pHLMV->GetState()->playSequence )
+		{
+			if( pEntity )
+				pEntity->SetFrame( iOldFrame );
+		}
+		else
+		{
+			m_pSequencesPanel->SetFrame( iOldFrame );
+		}
+	}
 	else
 	{
-		delete pModel;
+		m_pHLMV->GetState()->CenterView();
 	}
 
-	InitializeUI();
+	return true;
+}
 
-	m_pHLMV->GetState()->CenterView();
+void CMainPanel::AbandonQuietLoad()
+{
+	if( !m_bQuietLoad || !m_ModelLoader.IsLoading() )
+		return;
 
-	return true;
+	m_bQuietLoad = false;
+
+	if( auto pServer = m_pHLMV->GetPreviewServer() )
+		pServer->ModelLoaded( false, "The load was replaced or cancelled by the model viewer" );
 }
 
 void CMainPanel::FreeModel()
 {
+	AbandonQuietLoad();
+
+	m_ModelLoader.Cancel();
+
 	m_p3DView->PrepareForLoad();
 
 	m_pHLMV->GetState()->ClearEntity();
@@ -326,6 +463,11 @@ void CMainPanel::TakeScreenshot()
 	m_p3DView->TakeScreenshot();
 }
 
+void CMainPanel::CaptureSequence()
+{
+	m_p3DView->CaptureSequence();
+}
+
 void CMainPanel::OnPostDraw( studiomdl::IStudioModelRenderer& renderer, const studiomdl::CModelRenderInfo& info )
 {
 	auto pPage = static_cast<CBaseControlPanel*>( m_pControlPanels->GetCurrentPage() );
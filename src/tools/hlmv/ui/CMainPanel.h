@@ -1,12 +1,16 @@
 #ifndef CMAINPANEL_H
 #define CMAINPANEL_H
 
+#include <string>
+
 #include "wxHLMV.h"
 
 #include <wx/notebook.h>
 
 #include "shared/Utility.h"
 
+#include "shared/studiomodel/CStudioModelLoader.h"
+
 #include "shared/renderer/studiomodel/IStudioModelRendererListener.h"
 
 #include "controlpanels/CBaseControlPanel.h"
@@ -78,6 +82,8 @@ public:
 
 	void Draw3D( const wxSize& size ) override final;
 
+	C3DView* Get3DView() { return m_p3DView; }
+
 	wxNotebook* GetControlPanels() { return m_pControlPanels; }
 
 	CModelDisplayPanel*		GetModelDisplayPanel() { return m_pModelDisplay; }
@@ -89,7 +95,44 @@ public:
 	CSequencesPanel*		GetSequencesPanel() { return m_pSequencesPanel; }
 	CFullscreenPanel*		GetFullscreenPanel() { return m_pFullscreen; }
 
-	bool LoadModel( const wxString& szFilename );
+	/**
+	*	Starts loading a model. The model is loaded in the background, and the main window is notified when it has finished loading.
+	*	@param szFilename Absolute name of the model to load.
+	*	@param bQuiet Whether the load was started by the preview server. Errors are logged instead of shown in a dialog,
+	*	and the server is told when the load finishes or is abandoned.
+	*	@return Whether loading was started.
+	*/
+	bool LoadModel( const wxString& szFilename, const bool bQuiet = false );
+
+	/**
+	*	Starts loading a new version of the current model. The current model stays visible until the new one has loaded,
+	*	textures that haven't changed are taken over from it, and the sequence, frame and camera are kept.
+	*	If no model is loaded, or another model is being loaded, the model is loaded like any other.
+	*	@param szFilename Absolute name of the model to load.
+	*	@param bQuiet Whether the load was started by the preview server. See LoadModel.
+	*	@return Whether loading was started.
+	*/
+	bool ReloadModel( const wxString& szFilename, const bool bQuiet = false );
+
+	/**
+	*	@return Name of the model that was loaded last, or an empty string if none was.
+	*/
+	const std::string& GetModelFilename() const { return m_ModelLoader.GetFilename(); }
+
+	/**
+	*	@return Whether a model is being loaded.
+	*/
+	bool IsLoadingModel() const { return m_ModelLoader.IsLoading(); }
+
+	/**
+	*	@return Whether the model that is being loaded, or was loaded last, was loaded by the preview server.
+	*/
+	bool IsQuietLoad() const { return m_bQuietLoad; }
+
+	/**
+	*	@return Why the last load failed, or an empty string if it succeeded.
+	*/
+	const std::string& GetLoadError() const { return m_szLoadError; }
 
 	void FreeModel();
 
@@ -107,6 +150,8 @@ public:
 
 	void TakeScreenshot();
 
+	void CaptureSequence();
+
 protected:
 	wxDECLARE_EVENT_TABLE();
 
@@ -134,6 +179,22 @@ private:
 
 	void ResetLightVector( wxCommandEvent& event );
 
+	/**
+	*	Uploads part of the model being loaded, and finishes loading it once it's ready.
+	*/
+	void UpdateModelLoad();
+
+	/**
+	*	Creates the entity for a model that has finished loading.
+	*	@return Whether the model was loaded successfully.
+	*/
+	bool FinishLoadModel();
+
+	/**
+	*	Tells the preview server that the load it started won't finish, because it was cancelled or replaced by another load.
+	*/
+	void AbandonQuietLoad();
+
 private:
 	CModelViewerApp* const m_pHLMV;
 
@@ -171,6 +232,19 @@ private:
 	CSequencesPanel*		m_pSequencesPanel;
 	CFullscreenPanel*		m_pFullscreen;
 
+	studiomdl::CStudioModelLoader m_ModelLoader;
+
+	int m_iLastLoadProgress = -1;
+
+	/**
+	*	Whether the model being loaded replaces the current one.
+	*/
+	bool m_bReloading = false;
+
+	bool m_bQuietLoad = false;
+
+	std::string m_szLoadError;
+
 private:
 	CMainPanel( const CMainPanel& ) = delete;
 	CMainPanel& operator=( const CMainPanel& ) = delete;
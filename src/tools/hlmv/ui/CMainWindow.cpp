@@ -1,28 +1,138 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <wx/dirdlg.h>
 #include <wx/filename.h>
+#include <wx/utils.h>
 
 #include "ui/wx/CwxOpenGL.h"
 
 #include "ui/wx/shared/CMessagesWindow.h"
 #include "ui/wx/shared/CCmdLineConfigDialog.h"
 #include "ui/wx/shared/CProcessDialog.h"
+#include "ui/wx/shared/CProcessQueueDialog.h"
 #include "ui/wx/utility/wxUtil.h"
 
 #include "CModelViewerApp.h"
 
 #include "options/COptionsDialog.h"
 
+#include "filesystem/IFileSystem.h"
 #include "tools/shared/Credits.h"
 
 #include "settings/CCmdLineConfig.h"
 
+#include "shared/studiomodel/CStudioModel.h"
+#include "shared/studiomodel/StudioModelDecompiler.h"
+#include "shared/studiomodel/StudioModelValidation.h"
+
 #include "CMainPanel.h"
+#include "CPreviewServer.h"
 
 #include "CMainWindow.h"
 
 namespace hlmv
 {
+namespace
+{
+/**
+*	Runs a tool on each of the given files. A single file is run in a process dialog, multiple files are run in a queue, several at a time.
+*	@param pszOutputFilter Output file filter, formatted with the name of each file.
+*	@param pszSuccessMessage Message logged for each file the tool succeeded on, formatted with the file's path.
+*/
+void RunToolOnFiles( wxWindow* pParent, const wxString& szTitle, const wxString& szProgram, const settings::CCmdLineConfig& config,
+					 const wxArrayString& paths, const char* const pszOutputFilter, const char* const pszSuccessMessage )
+{
+	std::vector<ui::CProcessQueueDialog::Job_t> jobs;
+
+	for( const auto& szPath : paths )
+	{
+		auto parameters = config.GetParameters();
+		parameters.emplace_back( szPath.ToStdString(), "" );
+
+		const wxFileName cwd( szPath );
+
+		ui::CProcessQueueDialog::Job_t job;
+
+		job.szName = cwd.GetFullName();
+		job.szCommand = wx::FormatCommandLine( szProgram, parameters );
+		job.szWorkingDirectory = cwd.GetPath();
+		job.bCopyFiles = config.ShouldCopyOutputFiles();
+		job.szOutputDirectory = config.GetOutputFileDirectory();
+
+		if( job.bCopyFiles )
+		{
+			for( const auto& filter : config.GetFilters() )
+			{
+				job.outputFileFilters.Add( filter );
+			}
+
+			job.outputFileFilters.Add( wxString::Format( pszOutputFilter, cwd.GetName() ) );
+		}
+
+		jobs.emplace_back( std::move( job ) );
+	}
+
+	if( jobs.size() == 1 )
+	{
+		const auto& job = jobs.front();
+
+		ui::CProcessDialog processDlg( pParent, wxID_ANY, szTitle );
+
+		processDlg.SetCommand( job.szCommand );
+
+		wxExecuteEnv* pEnv = new wxExecuteEnv;
+
+		pEnv->cwd = job.szWorkingDirectory;
+
+		processDlg.SetExecuteEnv( pEnv );
+
+		processDlg.SetShouldCopyFiles( job.bCopyFiles );
+
+		processDlg.SetOutputDirectory( job.szOutputDirectory );
+
+		processDlg.SetOutputFileFilters( job.outputFileFilters );
+
+		const int iResult = processDlg.ShowModal();
+
+		if( iResult != ui::CProcessDialog::SUCCESS )
+		{
+			wxMessageBox( processDlg.GetErrorString( iResult ), wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
+		}
+		else
+		{
+			Message( pszSuccessMessage, paths[ 0 ].c_str().AsChar() );
+		}
+
+		return;
+	}
+
+	ui::CProcessQueueDialog queueDlg( pParent, wxID_ANY, szTitle );
+
+	for( const auto& job : jobs )
+	{
+		queueDlg.AddJob( job );
+	}
+
+	const int iResult = queueDlg.ShowModal();
+
+	for( size_t uiIndex = 0; uiIndex < paths.size(); ++uiIndex )
+	{
+		if( queueDlg.DidJobSucceed( uiIndex ) )
+			Message( pszSuccessMessage, paths[ uiIndex ].c_str().AsChar() );
+	}
+
+	if( iResult != ui::CProcessQueueDialog::SUCCESS )
+	{
+		wxMessageBox( queueDlg.GetErrorString( iResult ), wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
+	}
+}
+}
+
 wxBEGIN_EVENT_TABLE( CMainWindow, ui::CwxBaseFrame )
 	EVT_MENU( wxID_MAINWND_LOADMODEL, CMainWindow::LoadModel )
+	EVT_MENU( wxID_MAINWND_RELOADMODEL, CMainWindow::ReloadModel )
 	EVT_MENU( wxID_MAINWND_LOADBACKGROUND, CMainWindow::LoadBackgroundTexture )
 	EVT_MENU( wxID_MAINWND_LOADGROUND, CMainWindow::LoadGroundTexture )
 	EVT_MENU( wxID_MAINWND_UNLOADGROUND, CMainWindow::UnloadGroundTexture )
@@ -33,7 +143,9 @@ wxBEGIN_EVENT_TABLE( CMainWindow, ui::CwxBaseFrame )
 	EVT_MENU( wxID_MAINWND_SAVEVIEW, CMainWindow::SaveView )
 	EVT_MENU( wxID_MAINWND_RESTOREVIEW, CMainWindow::RestoreView )
 	EVT_MENU( wxID_MAINWND_TAKESCREENSHOT, CMainWindow::TakeScreenshot )
+	EVT_MENU( wxID_MAINWND_CAPTURESEQUENCE, CMainWindow::CaptureSequence )
 	EVT_MENU( wxID_MAINWND_DUMPMODELINFO, CMainWindow::DumpModelInfo )
+	EVT_MENU( wxID_MAINWND_MODELSTATS, CMainWindow::ShowModelStats )
 	EVT_MENU( wxID_MAINWND_TOGGLEMESSAGES, CMainWindow::ShowMessagesWindow )
 	EVT_MENU( wxID_MAINWND_COMPILEMODEL, CMainWindow::OnCompileModel )
 	EVT_MENU( wxID_MAINWND_DECOMPILEMODEL, CMainWindow::OnDecompileModel )
@@ -58,6 +170,9 @@ CMainWindow::CMainWindow( CModelViewerApp* const pHLMV )
 	menuFile->Append( wxID_MAINWND_LOADMODEL, "&Load Model...",
 					  "Load a model" );
 
+	menuFile->Append( wxID_MAINWND_RELOADMODEL, "&Reload Model",
+					  "Load the current model again, keeping the view and textures that haven't changed" );
+
 	menuFile->AppendSeparator();
 
 	menuFile->Append( wxID_MAINWND_LOADBACKGROUND, "Load Background Texture..." );
@@ -96,8 +211,10 @@ CMainWindow::CMainWindow( CModelViewerApp* const pHLMV )
 	pMenuView->AppendSeparator();
 
 	pMenuView->Append( wxID_MAINWND_TAKESCREENSHOT, "Take Screenshot" );
+	pMenuView->Append( wxID_MAINWND_CAPTURESEQUENCE, "Capture Sequence", "Saves an image for every frame of the current sequence" );
 
 	pMenuView->Append( wxID_MAINWND_DUMPMODELINFO, "Dump Model Info" );
+	pMenuView->Append( wxID_MAINWND_MODELSTATS, "Model Statistics" );
 
 	wxMenu* pMenuTools = new wxMenu;
 
@@ -105,8 +222,8 @@ CMainWindow::CMainWindow( CModelViewerApp* const pHLMV )
 
 	pMenuTools->AppendSeparator();
 
-	pMenuTools->Append( wxID_MAINWND_COMPILEMODEL, "Compile Model..." );
-	pMenuTools->Append( wxID_MAINWND_DECOMPILEMODEL, "Decompile Model..." );
+	pMenuTools->Append( wxID_MAINWND_COMPILEMODEL, "Compile Model(s)..." );
+	pMenuTools->Append( wxID_MAINWND_DECOMPILEMODEL, "Decompile Model(s)..." );
 	pMenuTools->Append( wxID_MAINWND_EDITQC, "Edit QC File..." );
 
 	pMenuTools->AppendSeparator();
@@ -151,7 +268,12 @@ void CMainWindow::RunFrame()
 	m_pMainPanel->RunFrame();
 }
 
-bool CMainWindow::LoadModel( const wxString& szFilename )
+bool CMainWindow::IsLoadingModel() const
+{
+	return m_pMainPanel->IsLoadingModel();
+}
+
+bool CMainWindow::LoadModel( const wxString& szFilename, const bool bQuiet )
 {
 	wxFileName file( szFilename );
 
@@ -161,16 +283,30 @@ bool CMainWindow::LoadModel( const wxString& szFilename )
 
 	if( !file.Exists() )
 	{
-		wxMessageBox( wxString::Format( "The file \"%s\" does not exist.", szAbsFilename ) );
+		if( !bQuiet )
+			wxMessageBox( wxString::Format( "The file \"%s\" does not exist.", szAbsFilename ) );
 
 		m_pHLMV->GetSettings()->GetRecentFiles()->Remove( std::string( szFilename.c_str() ) );
+		m_pHLMV->GetSettings()->MarkChanged();
 
 		m_RecentFiles.Refresh();
 
 		return false;
 	}
 
-	const bool bSuccess = m_pMainPanel->LoadModel( szAbsFilename );
+	const bool bStarted = m_pMainPanel->LoadModel( szAbsFilename, bQuiet );
+
+	if( bStarted )
+		SetStatusText( wxString::Format( "Loading \"%s\"", szAbsFilename ) );
+	else
+		this->ClearTitleContent();
+
+	return bStarted;
+}
+
+void CMainWindow::ModelLoaded( const wxString& szAbsFilename, const bool bSuccess )
+{
+	SetStatusText( "" );
 
 	if( bSuccess )
 	{
@@ -180,15 +316,49 @@ bool CMainWindow::LoadModel( const wxString& szFilename )
 		this->SetTitleContent( pszAbsFilename );
 
 		m_pHLMV->GetSettings()->GetRecentFiles()->Add( pszAbsFilename );
+		m_pHLMV->GetSettings()->MarkChanged();
 
 		m_RecentFiles.Refresh();
 
+		//Reload the model when it's changed by other programs.
+		m_pHLMV->GetFileSystem()->UnwatchAllFiles();
+		m_pHLMV->GetFileSystem()->WatchFile( pszAbsFilename );
+
 		Message( "Loaded model \"%s\"\n", pszAbsFilename );
 	}
 	else
 		this->ClearTitleContent();
 
-	return bSuccess;
+	//Only loads that the preview server started are answered.
+	if( m_pMainPanel->IsQuietLoad() )
+	{
+		if( auto pServer = m_pHLMV->GetPreviewServer() )
+			pServer->ModelLoaded( bSuccess, m_pMainPanel->GetLoadError() );
+	}
+}
+
+bool CMainWindow::ReloadModel( const wxString& szFilename, const bool bQuiet )
+{
+	wxFileName file( szFilename );
+
+	file.MakeAbsolute();
+
+	const wxString szAbsFilename = file.GetFullPath();
+
+	if( !file.Exists() )
+	{
+		if( !bQuiet )
+			wxMessageBox( wxString::Format( "The file \"%s\" does not exist.", szAbsFilename ) );
+
+		return false;
+	}
+
+	const bool bStarted = m_pMainPanel->ReloadModel( szAbsFilename, bQuiet );
+
+	if( bStarted )
+		SetStatusText( wxString::Format( "Reloading \"%s\"", szAbsFilename ) );
+
+	return bStarted;
 }
 
 bool CMainWindow::PromptLoadModel()
@@ -308,6 +478,11 @@ void CMainWindow::TakeScreenshot()
 	m_pMainPanel->TakeScreenshot();
 }
 
+void CMainWindow::CaptureSequence()
+{
+	m_pMainPanel->CaptureSequence();
+}
+
 void CMainWindow::DumpModelInfo()
 {
 	if( !m_pHLMV->GetState()->GetEntity() )
@@ -327,6 +502,24 @@ void CMainWindow::DumpModelInfo()
 	}
 }
 
+void CMainWindow::ShowModelStats()
+{
+	if( !m_pHLMV->GetState()->GetEntity() )
+	{
+		wxMessageBox( "No model loaded!" );
+		return;
+	}
+
+	if( m_pHLMV->GetState()->DumpModelStats( HLMV_MODEL_STATS_FILE ) )
+	{
+		wx::LaunchDefaultTextEditor( HLMV_MODEL_STATS_FILE );
+	}
+	else
+	{
+		wxMessageBox( "An error occurred while writing model statistics" );
+	}
+}
+
 bool CMainWindow::ShowUnsavedWarning()
 {
 	//The question icon isn't supported due to Microsoft style guideline changes.
@@ -340,6 +533,20 @@ void CMainWindow::LoadModel( wxCommandEvent& event )
 	PromptLoadModel();
 }
 
+void CMainWindow::ReloadModel( wxCommandEvent& event )
+{
+	if( !m_pHLMV->GetState()->GetEntity() || m_pMainPanel->GetModelFilename().empty() )
+		return;
+
+	if( m_pHLMV->GetState()->modelChanged )
+	{
+		if( !ShowUnsavedWarning() )
+			return;
+	}
+
+	ReloadModel( m_pMainPanel->GetModelFilename() );
+}
+
 void CMainWindow::LoadBackgroundTexture( wxCommandEvent& event )
 {
 	PromptLoadBackgroundTexture();
@@ -415,11 +622,21 @@ void CMainWindow::TakeScreenshot( wxCommandEvent& event )
 	TakeScreenshot();
 }
 
+void CMainWindow::CaptureSequence( wxCommandEvent& event )
+{
+	CaptureSequence();
+}
+
 void CMainWindow::DumpModelInfo( wxCommandEvent& event )
 {
 	DumpModelInfo();
 }
 
+void CMainWindow::ShowModelStats( wxCommandEvent& event )
+{
+	ShowModelStats();
+}
+
 void CMainWindow::ShowMessagesWindow( wxCommandEvent& event )
 {
 	m_pHLMV->ShowMessagesWindow( event.IsChecked() );
@@ -435,12 +652,14 @@ void CMainWindow::OnCompileModel( wxCommandEvent& event )
 		return;
 	}
 
-	wxFileDialog dlg( this, "Select QC file", wxEmptyString, wxEmptyString, "QC files (*.qc)|*.qc" );
+	wxFileDialog dlg( this, "Select QC file(s)", wxEmptyString, wxEmptyString, "QC files (*.qc)|*.qc", wxFD_OPEN | wxFD_FILE_MUST_EXIST | wxFD_MULTIPLE );
 
 	if( dlg.ShowModal() == wxID_CANCEL )
 		return;
 
-	const wxString szPath = dlg.GetPath();
+	wxArrayString paths;
+
+	dlg.GetPaths( paths );
 
 	ui::CCmdLineConfigDialog commandLineDlg( this, wxID_ANY, "Configure StudioMdl", 
 											 m_pHLMV->GetSettings()->GetDefaultOutputFileDirectory().CStr(), m_pHLMV->GetSettings()->GetStudioMdlConfigManager() );
@@ -457,127 +676,69 @@ void CMainWindow::OnCompileModel( wxCommandEvent& event )
 	if( !config )
 		config = std::make_shared<settings::CCmdLineConfig>( "Empty config" );
 
-	auto parameters = config->GetParameters();
-	parameters.emplace_back( szPath.ToStdString(), "" );
-
-	ui::CProcessDialog processDlg( this, wxID_ANY, "StudioMdl Compiler" );
-
-	processDlg.SetCommand( wx::FormatCommandLine( szStudioMdl, parameters ) );
-
-	const wxFileName cwd( szPath );
-
-	wxExecuteEnv* pEnv = new wxExecuteEnv;
-
-	pEnv->cwd = cwd.GetPath();
-
-	processDlg.SetExecuteEnv( pEnv );
-
-	processDlg.SetShouldCopyFiles( config->ShouldCopyOutputFiles() );
-
-	processDlg.SetOutputDirectory( config->GetOutputFileDirectory() );
-
-	if( config->ShouldCopyOutputFiles() )
-	{
-		wxArrayString filters;
-		
-		for( const auto& filter : config->GetFilters() )
-		{
-			filters.Add( filter );
-		}
-
-		//Copy output model(s)
-		filters.Add( wxString::Format( "%s*.mdl", cwd.GetName() ) );
-
-		processDlg.SetOutputFileFilters( filters );
-	}
-
-	const int iResult = processDlg.ShowModal();
-
-	if( iResult != ui::CProcessDialog::SUCCESS )
-	{
-		wxMessageBox( processDlg.GetErrorString( iResult ), wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
-	}
-	else
-	{
-		Message( "Compiled QC file \"%s\"\n", szPath.c_str().AsChar() );
-	}
+	//Copy output model(s)
+	RunToolOnFiles( this, "StudioMdl Compiler", szStudioMdl, *config, paths, "%s*.mdl", "Compiled QC file \"%s\"\n" );
 }
 
 void CMainWindow::OnDecompileModel( wxCommandEvent& event )
 {
-	const wxString szMdlDec = m_pHLMV->GetSettings()->GetMdlDec().CStr();
-
-	if( !wxFileName( szMdlDec ).Exists() )
-	{
-		wxMessageBox( "Couldn't find mdldec decompiler!", wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
-		return;
-	}
-
-	wxFileDialog dlg( this, "Select MDL file", wxEmptyString, wxEmptyString, "Half-Life MDL files (*.mdl)|*.mdl" );
+	wxFileDialog dlg( this, "Select MDL file(s)", wxEmptyString, wxEmptyString, "Half-Life MDL files (*.mdl)|*.mdl", wxFD_OPEN | wxFD_FILE_MUST_EXIST | wxFD_MULTIPLE );
 
 	if( dlg.ShowModal() == wxID_CANCEL )
 		return;
 
-	const wxString szPath = dlg.GetPath();
+	wxArrayString paths;
 
-	ui::CCmdLineConfigDialog commandLineDlg( this, wxID_ANY, "Configure MdlDec",
-											 m_pHLMV->GetSettings()->GetDefaultOutputFileDirectory().CStr(), m_pHLMV->GetSettings()->GetMdlDecConfigManager() );
+	dlg.GetPaths( paths );
 
-	commandLineDlg.SetCopySupportEnabled( true );
+	wxDirDialog dirDlg( this, "Select output directory", m_pHLMV->GetSettings()->GetDefaultOutputFileDirectory().CStr() );
 
-	if( commandLineDlg.ShowModal() == wxID_CANCEL )
+	if( dirDlg.ShowModal() == wxID_CANCEL )
 		return;
 
-	commandLineDlg.Save();
+	//Models are decompiled from the loaded headers, so no external decompiler is needed.
+	wxBusyCursor cursor;
 
-	auto config = m_pHLMV->GetSettings()->GetMdlDecConfigManager()->GetActiveConfig();
-
-	if( !config )
-		config = std::make_shared<settings::CCmdLineConfig>( "Empty config" );
-
-	auto parameters = config->GetParameters();
-	parameters.emplace_back( szPath.ToStdString(), "" );
-
-	ui::CProcessDialog processDlg( this, wxID_ANY, "MdlDec Decompiler" );
-
-	processDlg.SetCommand( wx::FormatCommandLine( szMdlDec, parameters ) );
-
-	wxFileName cwd( szPath );
-
-	wxExecuteEnv* pEnv = new wxExecuteEnv;
-
-	pEnv->cwd = cwd.GetPath();
+	for( const auto& szPath : paths )
+	{
+		const std::string szFilename = szPath.ToStdString();
 
-	processDlg.SetExecuteEnv( pEnv );
+		std::vector<std::string> issues;
 
-	processDlg.SetShouldCopyFiles( config->ShouldCopyOutputFiles() );
+		//The loader trusts the headers, so files are validated before they're loaded.
+		if( !studiomdl::ValidateStudioModelFile( szFilename.c_str(), issues ) )
+		{
+			for( const auto& szIssue : issues )
+			{
+				Error( "%s\n", szIssue.c_str() );
+			}
 
-	processDlg.SetOutputDirectory( config->GetOutputFileDirectory() );
+			continue;
+		}
 
-	if( config->ShouldCopyOutputFiles() )
-	{
-		wxArrayString filters;
+		studiomdl::CStudioModel* pLoadedModel = nullptr;
 
-		for( const auto& filter : config->GetFilters() )
+		if( studiomdl::LoadStudioModelFiles( szFilename.c_str(), pLoadedModel ) != studiomdl::StudioModelLoadResult::SUCCESS )
 		{
-			filters.Add( filter );
+			Error( "Couldn't load model \"%s\"\n", szFilename.c_str() );
+			continue;
 		}
 
-		//Copy output qc
-		filters.Add( wxString::Format( "%s.qc", cwd.GetName() ) );
+		std::unique_ptr<studiomdl::CStudioModel> model( pLoadedModel );
 
-		processDlg.SetOutputFileFilters( filters );
-	}
+		const wxFileName fileName( szPath );
 
-	const int iResult = processDlg.ShowModal();
+		//Each model gets a directory named after it.
+		wxFileName outputDir = wxFileName::DirName( dirDlg.GetPath() );
 
-	if( iResult != ui::CProcessDialog::SUCCESS )
-	{
-		wxMessageBox( processDlg.GetErrorString( iResult ), wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
-	}
-	else
-	{
-		Message( "Decompiled MDL file \"%s\"\n", szPath.c_str().AsChar() );
+		outputDir.AppendDir( fileName.GetName() );
+
+		studiomdl::DecompileResult_t result;
+
+		if( studiomdl::DecompileStudioModel( *model, fileName.GetName().ToStdString().c_str(), outputDir.GetPath().ToStdString().c_str(), result ) )
+			Message( "Decompiled MDL file \"%s\" (%u files)\n", szFilename.c_str(), static_cast<unsigned int>( result.uiFilesWritten ) );
+		else
+			Error( "Couldn't decompile MDL file \"%s\": %u files couldn't be written\n", szFilename.c_str(), static_cast<unsigned int>( result.uiFilesFailed ) );
 	}
 }
 
@@ -40,11 +40,38 @@ public:
 	const CModelViewerApp* GetHLMV() const { return m_pHLMV; }
 	CModelViewerApp* GetHLMV() { return m_pHLMV; }
 
+	CMainPanel* GetMainPanel() { return m_pMainPanel; }
+
 	void RunFrame();
 
-	bool LoadModel( const wxString& szFilename );
+	/**
+	*	@return Whether a model is being loaded.
+	*/
+	bool IsLoadingModel() const;
+
+	/**
+	*	Starts loading a model. ModelLoaded is called once it has finished loading.
+	*	@param bQuiet Whether the load was started by the preview server, and errors shouldn't be shown in dialogs.
+	*	@return Whether loading was started.
+	*/
+	bool LoadModel( const wxString& szFilename, const bool bQuiet = false );
 	bool PromptLoadModel();
 
+	/**
+	*	Starts loading a new version of the current model, keeping textures that haven't changed and the sequence, frame and camera.
+	*	ModelLoaded is called once it has finished loading.
+	*	@param bQuiet Whether the load was started by the preview server, and errors shouldn't be shown in dialogs.
+	*	@return Whether loading was started.
+	*/
+	bool ReloadModel( const wxString& szFilename, const bool bQuiet = false );
+
+	/**
+	*	Called by the main panel when a model has finished loading.
+	*	@param szFilename Absolute name of the model.
+	*	@param bSuccess Whether the model was loaded successfully.
+	*/
+	void ModelLoaded( const wxString& szFilename, const bool bSuccess );
+
 	bool SaveModel( const wxString& szFilename );
 	bool PromptSaveModel();
 
@@ -68,8 +95,12 @@ public:
 
 	void TakeScreenshot();
 
+	void CaptureSequence();
+
 	void DumpModelInfo();
 
+	void ShowModelStats();
+
 	bool OnDropFiles( wxCoord x, wxCoord y, const wxArrayString& filenames );
 
 private:
@@ -78,6 +109,7 @@ private:
 	bool ShowUnsavedWarning();
 
 	void LoadModel( wxCommandEvent& event );
+	void ReloadModel( wxCommandEvent& event );
 	void LoadBackgroundTexture( wxCommandEvent& event );
 	void LoadGroundTexture( wxCommandEvent& event );
 	void UnloadGroundTexture( wxCommandEvent& event );
@@ -90,7 +122,9 @@ private:
 	void SaveView( wxCommandEvent& event );
 	void RestoreView( wxCommandEvent& event );
 	void TakeScreenshot( wxCommandEvent& event );
+	void CaptureSequence( wxCommandEvent& event );
 	void DumpModelInfo( wxCommandEvent& event );
+	void ShowModelStats( wxCommandEvent& event );
 
 	void ShowMessagesWindow( wxCommandEvent& event );
 	void OnCompileModel( wxCommandEvent& event );
@@ -1,12 +1,28 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+
 #include "shared/Logging.h"
 
 #include <wx/cmdline.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+
+#include "shared/studiomodel/CStudioModelManager.h"
+#include "shared/studiomodel/StudioModelDump.h"
 
 #include "game/entity/CEntityManager.h"
 #include "game/entity/CBaseEntityList.h"
 
+#include "ui/wx/CwxOpenGL.h"
+
+#include "CBenchmark.h"
 #include "CFullscreenWindow.h"
 #include "CMainWindow.h"
+#include "ModelScene.h"
+#include "CPreviewServer.h"
+#include "CSequenceExport.h"
+#include "CThumbnailBatch.h"
 
 #include "CModelViewerApp.h"
 
@@ -38,11 +54,31 @@ bool CModelViewerApp::OnInit()
 
 void CModelViewerApp::OnInitCmdLine( wxCmdLineParser& parser )
 {
-	wxApp::OnInitCmdLine( parser );
+	CBaseWXToolApp::OnInitCmdLine( parser );
 
 	//Note: this works by setting all available parameters in the order that they appear on the command line.
 	//The model filename must be last for this to work with drag&drop.
 	parser.AddParam( "Filename of the model to load on startup", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL );
+
+	parser.AddOption( "", "render", "Render the model to the given image without opening any windows, then exit", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "render-size", "Size of the image to render, as <width>x<height>. Defaults to 640x480", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "thumbnails", "Render thumbnails for every model in the given directory or manifest without opening any windows, then exit", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "thumbnail-dir", "Directory to write thumbnails to. Defaults to \"thumbnails\"", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "turntable", "Number of angles to render each thumbnail from. Defaults to 1", wxCMD_LINE_VAL_NUMBER );
+	parser.AddOption( "", "dump", "Dump the headers of the given model, or of every model in the given directory, without opening any windows, then exit", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "dump-dir", "Directory to write dumps to. Defaults to \"dumps\"", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "dump-format", "Format to dump in: text, json or csv. Defaults to text", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "benchmark", "Play a sequence of the given model at a fixed timestep without opening any windows, report frame times, then exit", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "benchmark-frames", "Number of frames to measure in each benchmark pass. Defaults to 1000", wxCMD_LINE_VAL_NUMBER );
+	parser.AddOption( "", "benchmark-sequence", "Sequence to play in the benchmark. Defaults to 0", wxCMD_LINE_VAL_NUMBER );
+	parser.AddOption( "", "benchmark-fps", "Frames per second of animation time that each benchmark frame advances. Defaults to 60", wxCMD_LINE_VAL_NUMBER );
+	parser.AddOption( "", "benchmark-output", "JSON file to write benchmark results to. Defaults to \"benchmark.json\"", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "export", "Render a sequence of the model frame by frame to numbered images, or to a video through ffmpeg, without opening any windows, then exit", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "export-sequence", "Sequence to export. Defaults to 0", wxCMD_LINE_VAL_NUMBER );
+	parser.AddOption( "", "export-fps", "Frames per second of the exported sequence. Defaults to 30", wxCMD_LINE_VAL_NUMBER );
+	parser.AddOption( "", "export-frames", "Number of frames to export. Defaults to one playthrough of the sequence", wxCMD_LINE_VAL_NUMBER );
+	parser.AddOption( "", "ffmpeg", "Path to ffmpeg, used to encode exported videos. Defaults to \"ffmpeg\"", wxCMD_LINE_VAL_STRING );
+	parser.AddOption( "", "preview-port", "Let other programs load models, set the sequence, frame and camera and take screenshots through the given local TCP port", wxCMD_LINE_VAL_NUMBER );
 }
 
 bool CModelViewerApp::OnCmdLineParsed( wxCmdLineParser& parser )
@@ -51,7 +87,123 @@ bool CModelViewerApp::OnCmdLineParsed( wxCmdLineParser& parser )
 	if( parser.GetParamCount() > 0 )
 		m_szModel = parser.GetParam( parser.GetParamCount() - 1 );
 
-	return wxApp::OnCmdLineParsed( parser );
+	parser.Found( "render", &m_szRenderFilename );
+	parser.Found( "thumbnails", &m_szThumbnailSource );
+	parser.Found( "thumbnail-dir", &m_szThumbnailDir );
+
+	if( parser.Found( "turntable", &m_iTurntableAngles ) && m_iTurntableAngles <= 0 )
+	{
+		wxLogError( "The number of turntable angles must be positive" );
+		return false;
+	}
+
+	parser.Found( "dump", &m_szDumpSource );
+	parser.Found( "dump-dir", &m_szDumpDir );
+
+	wxString szFormat;
+
+	if( parser.Found( "dump-format", &szFormat ) && !studiomdl::StringToDumpFormat( szFormat.c_str(), m_DumpFormat ) )
+	{
+		wxLogError( "Invalid dump format \"%s\", expected text, json or csv", szFormat );
+		return false;
+	}
+
+	parser.Found( "benchmark", &m_szBenchmarkModel );
+	parser.Found( "benchmark-output", &m_szBenchmarkOutput );
+
+	long iValue;
+
+	if( parser.Found( "benchmark-frames", &iValue ) )
+	{
+		if( iValue <= 0 )
+		{
+			wxLogError( "The number of benchmark frames must be positive" );
+			return false;
+		}
+
+		m_uiBenchmarkFrames = static_cast<unsigned int>( iValue );
+	}
+
+	if( parser.Found( "benchmark-sequence", &iValue ) )
+	{
+		if( iValue < 0 )
+		{
+			wxLogError( "The benchmark sequence must not be negative" );
+			return false;
+		}
+
+		m_iBenchmarkSequence = static_cast<int>( iValue );
+	}
+
+	if( parser.Found( "benchmark-fps", &iValue ) )
+	{
+		if( iValue <= 0 )
+		{
+			wxLogError( "The benchmark FPS must be positive" );
+			return false;
+		}
+
+		m_uiBenchmarkFPS = static_cast<unsigned int>( iValue );
+	}
+
+	parser.Found( "export", &m_szExportFile );
+	parser.Found( "ffmpeg", &m_szFFmpeg );
+
+	if( parser.Found( "export-sequence", &iValue ) )
+	{
+		if( iValue < 0 )
+		{
+			wxLogError( "The export sequence must not be negative" );
+			return false;
+		}
+
+		m_iExportSequence = static_cast<int>( iValue );
+	}
+
+	if( parser.Found( "export-fps", &iValue ) )
+	{
+		if( iValue <= 0 )
+		{
+			wxLogError( "The export FPS must be positive" );
+			return false;
+		}
+
+		m_uiExportFPS = static_cast<unsigned int>( iValue );
+	}
+
+	if( parser.Found( "export-frames", &iValue ) )
+	{
+		if( iValue <= 0 )
+		{
+			wxLogError( "The number of export frames must be positive" );
+			return false;
+		}
+
+		m_uiExportFrames = static_cast<unsigned int>( iValue );
+	}
+
+	if( parser.Found( "preview-port", &m_iPreviewPort ) && ( m_iPreviewPort <= 0 || m_iPreviewPort > 65535 ) )
+	{
+		wxLogError( "The preview port must be between 1 and 65535" );
+		return false;
+	}
+
+	wxString szSize;
+
+	if( parser.Found( "render-size", &szSize ) )
+	{
+		int iWidth, iHeight;
+
+		if( sscanf( szSize.c_str(), "%dx%d", &iWidth, &iHeight ) != 2 || iWidth <= 0 || iHeight <= 0 )
+		{
+			wxLogError( "Invalid render size \"%s\", expected <width>x<height>", szSize );
+			return false;
+		}
+
+		m_RenderSize.Set( iWidth, iHeight );
+	}
+
+	return CBaseWXToolApp::OnCmdLineParsed( parser );
 }
 
 void CModelViewerApp::SetMainWindow( CMainWindow* const pMainWindow )
@@ -64,6 +216,11 @@ void CModelViewerApp::SetFullscreenWindow( CFullscreenWindow* const pWindow )
 	m_pFullscreenWindow = pWindow;
 }
 
+bool CModelViewerApp::UseUploadThread() const
+{
+	return !IsHeadless() && CBaseWXToolApp::UseUploadThread();
+}
+
 bool CModelViewerApp::PreRunApp()
 {
 	m_pState = new CHLMVState();
@@ -74,6 +231,12 @@ bool CModelViewerApp::PreRunApp()
 
 	SetEntityList( &g_EntityList );
 
+	if( !EntityManager().Initialize() )
+	{
+		FatalError( "Failed to initialize entity manager\n" );
+		return false;
+	}
+
 	if( !EntityManager().OnMapBegin() )
 	{
 		FatalError( "Failed to start map\n" );
@@ -81,25 +244,228 @@ bool CModelViewerApp::PreRunApp()
 	}
 
 	//Must be called before we create the main window, since it accesses the window.
-	UseMessagesWindow( true );
+	//Headless renders have no windows, so messages only go to the log.
+	if( !IsHeadless() )
+		UseMessagesWindow( true );
 
 	if( !GetSettings()->Initialize( HLMV_SETTINGS_FILE ) )
 	{
 		return false;
 	}
 
+	if( IsHeadless() )
+	{
+		bool bSuccess;
+
+		if( !m_szDumpSource.IsEmpty() )
+			bSuccess = DumpModels();
+		else if( !m_szBenchmarkModel.IsEmpty() )
+			bSuccess = RunBenchmark();
+		else if( !m_szThumbnailSource.IsEmpty() )
+			bSuccess = RenderThumbnails();
+		else if( !m_szExportFile.IsEmpty() )
+			bSuccess = ExportSequence();
+		else
+			bSuccess = RenderHeadless();
+
+		m_iHeadlessResult = bSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
+		return true;
+	}
+
 	m_pMainWindow = new hlmv::CMainWindow( this );
 
 	m_pMainWindow->Show( true );
 
+	//Failing to listen isn't fatal, the viewer can still be used normally.
+	if( m_iPreviewPort > 0 )
+	{
+		m_PreviewServer = std::make_unique<CPreviewServer>( this );
+
+		if( !m_PreviewServer->Start( static_cast<unsigned short>( m_iPreviewPort ) ) )
+			m_PreviewServer.reset();
+	}
+
 	if( !m_szModel.IsEmpty() )
 		LoadModel( m_szModel );
 
 	return true;
 }
 
+int CModelViewerApp::OnRun()
+{
+	if( IsHeadless() )
+		return m_iHeadlessResult;
+
+	return CBaseWXToolApp::OnRun();
+}
+
+bool CModelViewerApp::RenderHeadless()
+{
+	if( m_szModel.IsEmpty() )
+	{
+		Error( "No model given to render\n" );
+		return false;
+	}
+
+	if( !wxOpenGL().MakeOffscreenCurrent() )
+		return false;
+
+	studiomdl::CStudioModelManager::ModelPtr_t model;
+
+	const auto result = studiomdl::StudioModelManager().LoadModel( m_szModel.c_str(), model );
+
+	if( result != studiomdl::StudioModelLoadResult::SUCCESS )
+	{
+		Error( "Error loading model \"%s\"\n", m_szModel.c_str().AsChar() );
+		return false;
+	}
+
+	CHLMVStudioModelEntity* pEntity = static_cast<CHLMVStudioModelEntity*>( CBaseEntity::Create( "studiomodel", glm::vec3(), glm::vec3(), false ) );
+
+	if( !pEntity )
+	{
+		Error( "Couldn't create the model entity\n" );
+		return false;
+	}
+
+	pEntity->m_pState = GetState();
+
+	pEntity->SetModel( model );
+
+	pEntity->Spawn();
+
+	GetState()->SetEntity( pEntity );
+
+	GetState()->CenterView();
+
+	EntityManager().RunFrame();
+
+	wxImage image;
+
+	if( !RenderModelSceneToImage( this, m_RenderSize.GetWidth(), m_RenderSize.GetHeight(), GL_INVALID_TEXTURE_ID, GL_INVALID_TEXTURE_ID, image ) )
+		return false;
+
+	if( !image.SaveFile( m_szRenderFilename ) )
+	{
+		Error( "Failed to save image \"%s\"\n", m_szRenderFilename.c_str().AsChar() );
+		return false;
+	}
+
+	Message( "Rendered \"%s\" to \"%s\"\n", m_szModel.c_str().AsChar(), m_szRenderFilename.c_str().AsChar() );
+
+	wxOpenGL().GetErrors();
+
+	return true;
+}
+
+bool CModelViewerApp::RenderThumbnails()
+{
+	if( !wxOpenGL().MakeOffscreenCurrent() )
+		return false;
+
+	CThumbnailBatch batch( this );
+
+	if( !batch.AddSource( m_szThumbnailSource ) )
+		return false;
+
+	const bool bSuccess = batch.Run( m_szThumbnailDir, m_RenderSize, static_cast<unsigned int>( m_iTurntableAngles ) );
+
+	wxOpenGL().GetErrors();
+
+	return bSuccess;
+}
+
+bool CModelViewerApp::ExportSequence()
+{
+	if( !wxOpenGL().MakeOffscreenCurrent() )
+		return false;
+
+	CSequenceExport::Settings_t settings;
+
+	settings.szModel = m_szModel;
+	settings.szOutputFile = m_szExportFile;
+	settings.szFFmpeg = m_szFFmpeg;
+	settings.size = m_RenderSize;
+	settings.iSequence = m_iExportSequence;
+	settings.uiFPS = m_uiExportFPS;
+	settings.uiFrames = m_uiExportFrames;
+
+	CSequenceExport sequenceExport( this );
+
+	return sequenceExport.Run( settings );
+}
+
+bool CModelViewerApp::RunBenchmark()
+{
+	if( !wxOpenGL().MakeOffscreenCurrent() )
+		return false;
+
+	CBenchmark::Settings_t settings;
+
+	settings.szModel = m_szBenchmarkModel;
+	settings.szOutputFile = m_szBenchmarkOutput;
+	settings.size = m_RenderSize;
+	settings.uiFrames = m_uiBenchmarkFrames;
+	settings.iSequence = m_iBenchmarkSequence;
+	settings.uiFPS = m_uiBenchmarkFPS;
+
+	CBenchmark benchmark( this );
+
+	return benchmark.Run( settings );
+}
+
+bool CModelViewerApp::DumpModels()
+{
+	const auto startTime = std::chrono::steady_clock::now();
+
+	size_t uiDumped = 0;
+	size_t uiFailed = 0;
+
+	if( wxDirExists( m_szDumpSource ) )
+	{
+		if( !studiomdl::DumpStudioModelDirectory( m_szDumpSource.c_str(), m_szDumpDir.c_str(), m_DumpFormat, uiDumped, uiFailed ) )
+			return false;
+	}
+	else
+	{
+		if( !wxDirExists( m_szDumpDir ) && !wxFileName::Mkdir( m_szDumpDir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL ) )
+		{
+			Error( "Couldn't create output directory \"%s\"\n", m_szDumpDir.c_str().AsChar() );
+			return false;
+		}
+
+		wxFileName outputName( m_szDumpDir, wxFileName( m_szDumpSource ).GetName() );
+
+		outputName.SetExt( studiomdl::DumpFormatToExtension( m_DumpFormat ) );
+
+		std::string szOutput;
+
+		if( studiomdl::DumpStudioModelFile( m_szDumpSource.c_str(), m_DumpFormat, szOutput ) )
+		{
+			wxFile file;
+
+			if( file.Create( outputName.GetFullPath(), true ) && file.Write( szOutput.data(), szOutput.size() ) == szOutput.size() )
+				++uiDumped;
+			else
+				++uiFailed;
+		}
+		else
+		{
+			++uiFailed;
+		}
+	}
+
+	const double flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+	Message( "Dumped %u models in %.2f seconds, %u failed\n", static_cast<unsigned int>( uiDumped ), flSeconds, static_cast<unsigned int>( uiFailed ) );
+
+	return uiFailed == 0;
+}
+
 void CModelViewerApp::ShutdownApp()
 {
+	m_PreviewServer.reset();
+
 	if( auto pSettings = GetSettings() )
 	{
 		pSettings->Shutdown( HLMV_SETTINGS_FILE );
@@ -115,6 +481,8 @@ void CModelViewerApp::ShutdownApp()
 		m_pMainWindow = nullptr;
 	}
 
+	m_EntityStress.Clear();
+
 	if( EntityManager().IsMapRunning() )
 	{
 		EntityManager().OnMapEnd();
@@ -137,14 +505,43 @@ void CModelViewerApp::ShutdownApp()
 	CBaseWXToolApp::ShutdownApp();
 }
 
+void CModelViewerApp::FastShutdownApp()
+{
+	if( auto pSettings = GetSettings() )
+	{
+		pSettings->Shutdown( HLMV_SETTINGS_FILE );
+	}
+}
+
 void CModelViewerApp::RunFrame()
 {
+	const auto startTime = std::chrono::steady_clock::now();
+
 	EntityManager().RunFrame();
 
+	const auto entityTime = std::chrono::steady_clock::now();
+
 	if( m_pFullscreenWindow )
 		m_pFullscreenWindow->RunFrame();
 	else if( m_pMainWindow )
 		m_pMainWindow->RunFrame();
+
+	const auto endTime = std::chrono::steady_clock::now();
+
+	m_EntityStress.AddFrame( std::chrono::duration<double>( entityTime - startTime ).count(), std::chrono::duration<double>( endTime - startTime ).count() );
+}
+
+bool CModelViewerApp::IsAnimating()
+{
+	//Loading finishes in a frame.
+	if( m_pMainWindow && m_pMainWindow->IsLoadingModel() )
+		return true;
+
+	//Stress entities are measured while they animate, so frames have to keep running.
+	if( m_EntityStress.GetCount() > 0 )
+		return true;
+
+	return m_pState->GetEntity() && m_pState->playSequence && !m_pState->pause;
 }
 
 void CModelViewerApp::OnExit( const bool bMainWndClosed )
@@ -167,6 +564,23 @@ void CModelViewerApp::OnExit( const bool bMainWndClosed )
 	wxOpenGL().Shutdown();
 }
 
+void CModelViewerApp::OnFileChanged( const std::string& szFilename )
+{
+	//Only the loaded model is watched.
+	if( !m_pMainWindow || m_pFullscreenWindow )
+		return;
+
+	if( GetState()->modelChanged )
+	{
+		Warning( "Model \"%s\" was changed on disk, not reloading because it has unsaved changes\n", szFilename.c_str() );
+		return;
+	}
+
+	Message( "Model \"%s\" was changed on disk, reloading\n", szFilename.c_str() );
+
+	m_pMainWindow->ReloadModel( szFilename.c_str() );
+}
+
 bool CModelViewerApp::LoadModel( const char* const pszFilename )
 {
 	return m_pMainWindow->LoadModel( pszFilename );
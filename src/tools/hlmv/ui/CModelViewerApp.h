@@ -1,6 +1,9 @@
 #ifndef CMODELVIEWERAPP_H
 #define CMODELVIEWERAPP_H
 
+#include <cstdlib>
+#include <memory>
+
 #include "wxHLMV.h"
 
 #include "tools/shared/CBaseWXToolApp.h"
@@ -8,10 +11,15 @@
 #include "../CHLMVState.h"
 #include "../settings/CHLMVSettings.h"
 
+#include "CBenchmark.h"
+#include "CEntityStress.h"
+#include "CSequenceExport.h"
+
 namespace hlmv
 {
 class CMainWindow;
 class CFullscreenWindow;
+class CPreviewServer;
 
 class CModelViewerApp : public tools::CBaseWXToolApp
 {
@@ -22,6 +30,20 @@ public:
 
 	virtual bool OnCmdLineParsed( wxCmdLineParser& parser ) override;
 
+	/**
+	*	In headless mode, returns right away with the result of the render instead of running the main loop.
+	*/
+	int OnRun() override;
+
+	/**
+	*	@return Whether the model viewer is rendering a model to an image without opening any windows.
+	*/
+	bool IsHeadless() const
+	{
+		return !m_szRenderFilename.IsEmpty() || !m_szThumbnailSource.IsEmpty() || !m_szDumpSource.IsEmpty() || !m_szBenchmarkModel.IsEmpty() ||
+			!m_szExportFile.IsEmpty();
+	}
+
 	/**
 	*	Gets the state object.
 	*/
@@ -62,15 +84,38 @@ public:
 	*/
 	void SetFullscreenWindow( CFullscreenWindow* const pWindow );
 
+	/**
+	*	@return The preview server, or null if it wasn't enabled with --preview-port.
+	*/
+	CPreviewServer* GetPreviewServer() { return m_PreviewServer.get(); }
+
+	/**
+	*	Gets the entities spawned by ent_stress.
+	*/
+	CEntityStress& GetEntityStress() { return m_EntityStress; }
+
 protected:
+	/**
+	*	Headless modes render once and exit, so they upload synchronously.
+	*/
+	bool UseUploadThread() const override;
+
 	bool PreRunApp() override;
 
 	void ShutdownApp() override;
 
+	void FastShutdownApp() override;
+
 	void RunFrame() override;
 
+	bool IsAnimating() override;
+
 	void OnExit( const bool bMainWndClosed ) override final;
 
+	void OnFileChanged( const std::string& szFilename ) override;
+
+	settings::CBaseSettings* GetBaseSettings() override { return m_pSettings; }
+
 public:
 
 	//Load/Save model
@@ -142,6 +187,38 @@ public:
 	*/
 	void SaveUVMap( const wxString& szFilename, const int iTexture );
 
+private:
+	/**
+	*	Loads the startup model and renders it to the render file, without opening any windows.
+	*	@return Whether the image was saved.
+	*/
+	bool RenderHeadless();
+
+	/**
+	*	Renders thumbnails for every model in the thumbnail source, without opening any windows.
+	*	@return Whether every thumbnail was saved.
+	*/
+	bool RenderThumbnails();
+
+	/**
+	*	Dumps the headers of the model or every model in the directory given as the dump source, without opening any windows.
+	*	Doesn't need GL, so no textures are created.
+	*	@return Whether every model was dumped.
+	*/
+	bool DumpModels();
+
+	/**
+	*	Benchmarks playback of the benchmark model, without opening any windows.
+	*	@return Whether the benchmark ran and its results were written.
+	*/
+	bool RunBenchmark();
+
+	/**
+	*	Exports a sequence of the startup model to the export file, without opening any windows.
+	*	@return Whether every frame was exported.
+	*/
+	bool ExportSequence();
+
 private:
 	CHLMVState* m_pState = nullptr;
 	CHLMVSettings* m_pSettings = nullptr;
@@ -150,6 +227,37 @@ private:
 	CFullscreenWindow* m_pFullscreenWindow = nullptr;
 
 	wxString m_szModel;		//Model to load on startup, if any.
+
+	wxString m_szRenderFilename;		//If set, the startup model is rendered to this image and the program exits.
+	wxSize m_RenderSize{ 640, 480 };	//Size of the image to render in headless mode.
+
+	wxString m_szThumbnailSource;				//If set, thumbnails are rendered for the models in this directory or manifest and the program exits.
+	wxString m_szThumbnailDir = "thumbnails";	//Directory to write thumbnails to.
+	long m_iTurntableAngles = 1;				//Number of angles to render each thumbnail model from.
+
+	wxString m_szDumpSource;									//If set, the headers of this model or the models in this directory are dumped and the program exits.
+	wxString m_szDumpDir = "dumps";								//Directory to write dumps to.
+	studiomdl::DumpFormat m_DumpFormat = studiomdl::DumpFormat::TEXT;	//Format to write dumps in.
+
+	wxString m_szBenchmarkModel;										//If set, playback of this model is benchmarked and the program exits.
+	wxString m_szBenchmarkOutput = "benchmark.json";					//JSON file to write benchmark results to.
+	unsigned int m_uiBenchmarkFrames = CBenchmark::DEFAULT_FRAMES;		//Number of frames to measure in each pass.
+	int m_iBenchmarkSequence = 0;										//Sequence to play.
+	unsigned int m_uiBenchmarkFPS = CBenchmark::DEFAULT_FPS;			//Animation rate of the fixed timestep.
+
+	wxString m_szExportFile;											//If set, a sequence of the startup model is exported to this file and the program exits.
+	wxString m_szFFmpeg = "ffmpeg";										//Path to ffmpeg, used to encode exported videos.
+	int m_iExportSequence = 0;											//Sequence to export.
+	unsigned int m_uiExportFPS = CSequenceExport::DEFAULT_FPS;			//Frames per second of the export.
+	unsigned int m_uiExportFrames = 0;									//Number of frames to export, or 0 for one playthrough.
+
+	long m_iPreviewPort = 0;								//If set, other programs can control the viewer through this port.
+
+	std::unique_ptr<CPreviewServer> m_PreviewServer;
+
+	CEntityStress m_EntityStress{ this };
+
+	int m_iHeadlessResult = EXIT_SUCCESS;
 };
 }
 
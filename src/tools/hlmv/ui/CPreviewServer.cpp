@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <wx/filename.h>
+
+#include "shared/Logging.h"
+
+#include "CMainPanel.h"
+#include "CMainWindow.h"
+#include "CModelViewerApp.h"
+#include "C3DView.h"
+#include "../CHLMVState.h"
+
+#include "controlpanels/CSequencesPanel.h"
+
+#include "CPreviewServer.h"
+
+namespace hlmv
+{
+namespace
+{
+enum
+{
+	SERVER_ID = wxID_HIGHEST + 1,
+	CLIENT_ID
+};
+
+/**
+*	Splits a line into the command name and the rest of the line, without leading or trailing whitespace.
+*/
+void SplitCommand( const std::string& szLine, std::string& szCommand, std::string& szArgs )
+{
+	const char* const pszWhitespace = " \t\r";
+
+	const size_t uiStart = szLine.find_first_not_of( pszWhitespace );
+
+	if( uiStart == std::string::npos )
+	{
+		szCommand.clear();
+		szArgs.clear();
+		return;
+	}
+
+	const size_t uiEnd = szLine.find_first_of( pszWhitespace, uiStart );
+
+	szCommand = szLine.substr( uiStart, uiEnd - uiStart );
+
+	const size_t uiArgsStart = uiEnd != std::string::npos ? szLine.find_first_not_of( pszWhitespace, uiEnd ) : std::string::npos;
+
+	if( uiArgsStart == std::string::npos )
+	{
+		szArgs.clear();
+		return;
+	}
+
+	szArgs = szLine.substr( uiArgsStart, szLine.find_last_not_of( pszWhitespace ) + 1 - uiArgsStart );
+}
+}
+
+CPreviewServer::CPreviewServer( CModelViewerApp* const pHLMV )
+	: m_pHLMV( pHLMV )
+{
+	Bind( wxEVT_SOCKET, &CPreviewServer::OnServerEvent, this, SERVER_ID );
+	Bind( wxEVT_SOCKET, &CPreviewServer::OnClientEvent, this, CLIENT_ID );
+}
+
+CPreviewServer::~CPreviewServer()
+{
+	Stop();
+}
+
+bool CPreviewServer::Start( const unsigned short uiPort )
+{
+	Stop();
+
+	//Only programs on this computer may connect.
+	wxIPV4address address;
+
+	address.LocalHost();
+	address.Service( uiPort );
+
+	m_pServer = new wxSocketServer( address, wxSOCKET_REUSEADDR );
+
+	if( !m_pServer->IsOk() )
+	{
+		Error( "CPreviewServer::Start: Couldn't listen on port %u\n", static_cast<unsigned int>( uiPort ) );
+		m_pServer->Destroy();
+		m_pServer = nullptr;
+		return false;
+	}
+
+	m_pServer->SetEventHandler( *this, SERVER_ID );
+	m_pServer->SetNotify( wxSOCKET_CONNECTION_FLAG );
+	m_pServer->Notify( true );
+
+	Message( "Preview server listening on port %u\n", static_cast<unsigned int>( uiPort ) );
+
+	return true;
+}
+
+void CPreviewServer::Stop()
+{
+	for( auto& client : m_Clients )
+	{
+		client->pSocket->Destroy();
+	}
+
+	m_Clients.clear();
+
+	if( m_pServer )
+	{
+		m_pServer->Destroy();
+		m_pServer = nullptr;
+	}
+}
+
+void CPreviewServer::ModelLoaded( const bool bSuccess, const std::string& szError )
+{
+	auto it = std::find_if( m_Clients.begin(), m_Clients.end(), []( const std::unique_ptr<Client_t>& client ) { return client->bWaitingForLoad; } );
+
+	if( it == m_Clients.end() )
+		return;
+
+	Client_t& client = **it;
+
+	client.bWaitingForLoad = false;
+
+	Reply( client, bSuccess, !szError.empty() ? szError : "Couldn't load the model" );
+
+	//Commands that were sent while the model was loading. Run later, since this can be called while the main panel starts another load.
+	wxSocketBase* const pSocket = client.pSocket;
+
+	CallAfter( [ this, pSocket ]()
+		{
+			if( Client_t* pClient = FindClient( pSocket ) )
+				RunCommands( *pClient );
+		}
+	);
+}
+
+void CPreviewServer::OnServerEvent( wxSocketEvent& event )
+{
+	if( event.GetSocketEvent() != wxSOCKET_CONNECTION || !m_pServer )
+		return;
+
+	wxSocketBase* const pSocket = m_pServer->Accept( false );
+
+	if( !pSocket )
+		return;
+
+	//Reads return whatever has arrived, replies are small enough to be written right away.
+	pSocket->SetFlags( wxSOCKET_NOWAIT_READ );
+	pSocket->SetEventHandler( *this, CLIENT_ID );
+	pSocket->SetNotify( wxSOCKET_INPUT_FLAG | wxSOCKET_LOST_FLAG );
+	pSocket->Notify( true );
+
+	auto client = std::make_unique<Client_t>();
+
+	client->pSocket = pSocket;
+
+	m_Clients.emplace_back( std::move( client ) );
+}
+
+void CPreviewServer::OnClientEvent( wxSocketEvent& event )
+{
+	wxSocketBase* const pSocket = event.GetSocket();
+
+	Client_t* const pClient = FindClient( pSocket );
+
+	if( !pClient )
+		return;
+
+	if( event.GetSocketEvent() == wxSOCKET_LOST )
+	{
+		RemoveClient( pSocket );
+		return;
+	}
+
+	if( event.GetSocketEvent() != wxSOCKET_INPUT )
+		return;
+
+	char szBuffer[ 1024 ];
+
+	do
+	{
+		pSocket->Read( szBuffer, sizeof( szBuffer ) );
+
+		pClient->szPending.append( szBuffer, pSocket->LastReadCount() );
+	}
+	while( pSocket->LastReadCount() == sizeof( szBuffer ) );
+
+	if( !pClient->bWaitingForLoad )
+		RunCommands( *pClient );
+}
+
+CPreviewServer::Client_t* CPreviewServer::FindClient( const wxSocketBase* pSocket )
+{
+	auto it = std::find_if( m_Clients.begin(), m_Clients.end(), [ = ]( const std::unique_ptr<Client_t>& client ) { return client->pSocket == pSocket; } );
+
+	return it != m_Clients.end() ? it->get() : nullptr;
+}
+
+void CPreviewServer::RemoveClient( const wxSocketBase* pSocket )
+{
+	auto it = std::find_if( m_Clients.begin(), m_Clients.end(), [ = ]( const std::unique_ptr<Client_t>& client ) { return client->pSocket == pSocket; } );
+
+	if( it == m_Clients.end() )
+		return;
+
+	( *it )->pSocket->Destroy();
+
+	m_Clients.erase( it );
+}
+
+bool CPreviewServer::RunCommands( Client_t& client )
+{
+	size_t uiLineEnd;
+
+	while( !client.bWaitingForLoad && ( uiLineEnd = client.szPending.find( '\n' ) ) != std::string::npos )
+	{
+		const std::string szLine = client.szPending.substr( 0, uiLineEnd );
+
+		client.szPending.erase( 0, uiLineEnd + 1 );
+
+		bool bWait = false;
+		std::string szError;
+
+		const bool bSuccess = RunCommand( szLine, bWait, szError );
+
+		if( bSuccess && bWait )
+		{
+			//Only one model can load at a time, so a load started by another client replaces that client's load.
+			for( auto& other : m_Clients )
+			{
+				if( other.get() != &client && other->bWaitingForLoad )
+				{
+					other->bWaitingForLoad = false;
+					Reply( *other, false, "Another model was loaded" );
+				}
+			}
+
+			client.bWaitingForLoad = true;
+		}
+		else
+		{
+			Reply( client, bSuccess, szError );
+		}
+	}
+
+	if( client.szPending.size() > MAX_LINE_LENGTH )
+	{
+		Warning( "CPreviewServer: Disconnecting client that sent a line longer than %u characters\n", static_cast<unsigned int>( MAX_LINE_LENGTH ) );
+		RemoveClient( client.pSocket );
+		return false;
+	}
+
+	return true;
+}
+
+bool CPreviewServer::RunCommand( const std::string& szLine, bool& bWait, std::string& szError )
+{
+	bWait = false;
+
+	std::string szCommand, szArgs;
+
+	SplitCommand( szLine, szCommand, szArgs );
+
+	if( szCommand.empty() )
+	{
+		szError = "No command given";
+		return false;
+	}
+
+	CMainWindow* const pMainWindow = m_pHLMV->GetMainWindow();
+
+	if( !pMainWindow )
+	{
+		szError = "The main window is closed";
+		return false;
+	}
+
+	CMainPanel* const pMainPanel = pMainWindow->GetMainPanel();
+
+	CHLMVState* const pState = m_pHLMV->GetState();
+
+	if( szCommand == "load" )
+	{
+		if( szArgs.empty() )
+		{
+			szError = "No filename given";
+			return false;
+		}
+
+		//Checked here so the reply can say what's wrong.
+		if( !wxFileName::FileExists( szArgs ) )
+		{
+			szError = "The file \"" + szArgs + "\" does not exist";
+			return false;
+		}
+
+		//Loads started here never show dialogs; errors are sent to the client once the load has finished.
+		if( !pMainWindow->LoadModel( szArgs, true ) )
+		{
+			szError = "Couldn't start loading \"" + szArgs + "\"";
+			return false;
+		}
+
+		bWait = true;
+		return true;
+	}
+
+	if( szCommand == "reload" )
+	{
+		const std::string& szFilename = pMainPanel->GetModelFilename();
+
+		if( szFilename.empty() )
+		{
+			szError = "No model is loaded";
+			return false;
+		}
+
+		if( !wxFileName::FileExists( szFilename ) )
+		{
+			szError = "The file \"" + szFilename + "\" does not exist anymore";
+			return false;
+		}
+
+		if( !pMainWindow->ReloadModel( szFilename, true ) )
+		{
+			szError = "Couldn't start reloading \"" + szFilename + "\"";
+			return false;
+		}
+
+		bWait = true;
+		return true;
+	}
+
+	if( szCommand == "screenshot" )
+	{
+		int iWidth = 0, iHeight = 0;
+
+		std::string szFilename = szArgs;
+
+		std::string szSize, szRest;
+
+		SplitCommand( szArgs, szSize, szRest );
+
+		//The size is optional, so anything that doesn't look like one is part of the filename.
+		if( !szRest.empty() && sscanf( szSize.c_str(), "%dx%d", &iWidth, &iHeight ) == 2 )
+		{
+			if( iWidth <= 0 || iHeight <= 0 )
+			{
+				szError = "Invalid size \"" + szSize + "\"";
+				return false;
+			}
+
+			szFilename = szRest;
+		}
+		else
+		{
+			iWidth = iHeight = 0;
+		}
+
+		if( szFilename.empty() )
+		{
+			szError = "No filename given";
+			return false;
+		}
+
+		if( !pMainPanel->Get3DView()->RenderToFile( szFilename, iWidth, iHeight ) )
+		{
+			szError = "Couldn't save \"" + szFilename + "\"";
+			return false;
+		}
+
+		return true;
+	}
+
+	if( szCommand == "camera" )
+	{
+		float flValues[ 6 ];
+
+		const int iCount = sscanf( szArgs.c_str(), "%f %f %f %f %f %f", &flValues[ 0 ], &flValues[ 1 ], &flValues[ 2 ], &flValues[ 3 ], &flValues[ 4 ], &flValues[ 5 ] );
+
+		if( iCount != 3 && iCount != 6 )
+		{
+			szError = "Expected an origin, and optionally a view direction";
+			return false;
+		}
+
+		graphics::CCamera* const pCamera = pState->GetCurrentCamera();
+
+		pCamera->SetOrigin( glm::vec3( flValues[ 0 ], flValues[ 1 ], flValues[ 2 ] ) );
+
+		if( iCount == 6 )
+			pCamera->SetViewDirection( glm::vec3( flValues[ 3 ], flValues[ 4 ], flValues[ 5 ] ) );
+
+		m_pHLMV->RequestRedraw();
+
+		return true;
+	}
+
+	//Everything else needs a model.
+	CHLMVStudioModelEntity* const pEntity = pState->GetEntity();
+
+	if( !pEntity )
+	{
+		szError = "No model is loaded";
+		return false;
+	}
+
+	if( szCommand == "sequence" )
+	{
+		const studiohdr_t* const pHdr = pEntity->GetModel()->GetStudioHeader();
+
+		char* pszEnd;
+
+		int iSequence = static_cast<int>( strtol( szArgs.c_str(), &pszEnd, 10 ) );
+
+		//Not a number, so it's a name.
+		if( szArgs.empty() || *pszEnd )
+		{
+			iSequence = -1;
+
+			for( int i = 0; i < pHdr->numseq; ++i )
+			{
+				if( !strncmp( pHdr->GetSequence( i )->label, szArgs.c_str(), sizeof( pHdr->GetSequence( i )->label ) ) )
+				{
+					iSequence = i;
+					break;
+				}
+			}
+		}
+
+		if( iSequence < 0 || iSequence >= pHdr->numseq )
+		{
+			szError = "No sequence \"" + szArgs + "\"";
+			return false;
+		}
+
+		pMainPanel->GetSequencesPanel()->SetSequence( iSequence );
+
+		m_pHLMV->RequestRedraw();
+
+		return true;
+	}
+
+	if( szCommand == "frame" )
+	{
+		char* pszEnd;
+
+		const int iFrame = static_cast<int>( strtol( szArgs.c_str(), &pszEnd, 10 ) );
+
+		if( szArgs.empty() || *pszEnd || iFrame < 0 || iFrame >= pEntity->GetNumFrames() )
+		{
+			szError = "Invalid frame \"" + szArgs + "\"";
+			return false;
+		}
+
+		pMainPanel->GetSequencesPanel()->SetFrame( iFrame );
+
+		m_pHLMV->RequestRedraw();
+
+		return true;
+	}
+
+	szError = "Unknown command \"" + szCommand + "\"";
+
+	return false;
+}
+
+void CPreviewServer::Reply( Client_t& client, const bool bSuccess, const std::string& szError )
+{
+	std::string szReply = bSuccess ? "ok\n" : "error " + szError + "\n";
+
+	client.pSocket->Write( szReply.data(), szReply.size() );
+}
+}
@@ -0,0 +1,118 @@
+#ifndef HLMV_UI_CPREVIEWSERVER_H
+#define HLMV_UI_CPREVIEWSERVER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "wxHLMV.h"
+
+#include <wx/socket.h>
+
+namespace hlmv
+{
+class CModelViewerApp;
+
+/**
+*	Lets other programs control a running model viewer, so tools like exporters can show previews without starting a new instance every time.
+*	Listens on a TCP port on the loopback interface only. Clients send commands as lines of text, and get one line back for each command:
+*	"ok", or "error " followed by a description. Commands from a client are run in order, on the main thread.
+*
+*	Commands:
+*	load <filename>							Loads a model. Replies once the model has finished loading.
+*	reload									Reloads the current model, keeping the sequence, frame and camera. Replies once it has finished loading.
+*	sequence <index or name>				Sets the sequence.
+*	frame <frame>							Sets the frame of the current sequence.
+*	camera <x> <y> <z> [<dx> <dy> <dz>]		Sets the camera's origin, and optionally its view direction.
+*	screenshot [<width>x<height>] <filename>	Renders the scene and saves it. Uses the size of the 3D view if no size is given.
+*/
+class CPreviewServer final : public wxEvtHandler
+{
+public:
+	/**
+	*	Longest line that is accepted. Clients that send longer lines are disconnected.
+	*/
+	static const size_t MAX_LINE_LENGTH = 4096;
+
+private:
+	struct Client_t
+	{
+		/**
+		*	Destroyed with Destroy, since events for it can still be queued.
+		*/
+		wxSocketBase* pSocket = nullptr;
+
+		/**
+		*	Received data that hasn't been run yet.
+		*/
+		std::string szPending;
+
+		/**
+		*	Whether the client is waiting for a model to load. Its other commands are run after that.
+		*/
+		bool bWaitingForLoad = false;
+	};
+
+public:
+	CPreviewServer( CModelViewerApp* const pHLMV );
+	~CPreviewServer();
+
+	/**
+	*	Starts listening on the given port.
+	*	@return Whether the server is listening.
+	*/
+	bool Start( const unsigned short uiPort );
+
+	/**
+	*	Disconnects all clients and stops listening.
+	*/
+	void Stop();
+
+	bool IsRunning() const { return m_pServer != nullptr; }
+
+	/**
+	*	Called by the main window when a model that the server started loading has finished loading, or won't finish.
+	*	Replies to the client that is waiting for it, if any.
+	*	@param szError If the load failed, why it failed.
+	*/
+	void ModelLoaded( const bool bSuccess, const std::string& szError );
+
+private:
+	void OnServerEvent( wxSocketEvent& event );
+
+	void OnClientEvent( wxSocketEvent& event );
+
+	Client_t* FindClient( const wxSocketBase* pSocket );
+
+	void RemoveClient( const wxSocketBase* pSocket );
+
+	/**
+	*	Runs the complete lines a client has sent, until a command has to wait for a model load.
+	*	@return Whether the client is still connected.
+	*/
+	bool RunCommands( Client_t& client );
+
+	/**
+	*	Runs one command.
+	*	@param[ out ] bWait Set to true if the reply is sent once a model has finished loading.
+	*	@param[ out ] szError If the command failed, set to a description of the problem.
+	*	@return Whether the command succeeded.
+	*/
+	bool RunCommand( const std::string& szLine, bool& bWait, std::string& szError );
+
+	void Reply( Client_t& client, const bool bSuccess, const std::string& szError );
+
+private:
+	CModelViewerApp* const m_pHLMV;
+
+	wxSocketServer* m_pServer = nullptr;
+
+	std::vector<std::unique_ptr<Client_t>> m_Clients;
+
+private:
+	CPreviewServer( const CPreviewServer& ) = delete;
+	CPreviewServer& operator=( const CPreviewServer& ) = delete;
+};
+}
+
+#endif //HLMV_UI_CPREVIEWSERVER_H
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <vector>
+
+#include <wx/dcmemory.h>
+#include <wx/image.h>
+
+#include "shared/Profiler.h"
+
+#include "CProfilerOverlay.h"
+
+namespace hlmv
+{
+namespace
+{
+/**
+*	How often the text is redrawn.
+*/
+const std::chrono::milliseconds TEXT_UPDATE_INTERVAL( 250 );
+
+const int MARGIN = 8;
+const int PADDING = 4;
+
+const int ROW_HEIGHT = 28;
+const int LINE_HEIGHT = 12;
+
+/**
+*	Polygon and frame counts, and 3 lines of draw stats.
+*/
+const int HEADER_HEIGHT = LINE_HEIGHT * 4 + 4;
+
+const int TEXT_WIDTH = 260;
+
+/**
+*	One pixel per frame of history.
+*/
+const int GRAPH_WIDTH = static_cast<int>( profiler::HISTORY_SIZE );
+
+void DrawQuad( const float flX, const float flY, const float flWidth, const float flHeight )
+{
+	glBegin( GL_QUADS );
+
+	glTexCoord2f( 0, 0 );
+	glVertex2f( flX, flY );
+
+	glTexCoord2f( 1, 0 );
+	glVertex2f( flX + flWidth, flY );
+
+	glTexCoord2f( 1, 1 );
+	glVertex2f( flX + flWidth, flY + flHeight );
+
+	glTexCoord2f( 0, 1 );
+	glVertex2f( flX, flY + flHeight );
+
+	glEnd();
+}
+
+wxString FormatValue( const profiler::SeriesType type, const float flValue )
+{
+	if( type == profiler::SeriesType::TIME )
+		return wxString::Format( "%.2f", flValue );
+
+	return wxString::Format( "%.0f", flValue );
+}
+}
+
+void CProfilerOverlay::Draw( const wxSize& size, const unsigned int uiDrawnPolys, const renderer::DrawStats_t& drawStats )
+{
+	const size_t uiSeriesCount = profiler::GetSeriesCount();
+
+	if( !m_TextTexture || uiSeriesCount != m_uiTextSeriesCount || std::chrono::steady_clock::now() - m_LastTextUpdate >= TEXT_UPDATE_INTERVAL )
+	{
+		UpdateText( uiDrawnPolys, drawStats );
+	}
+
+	glPushAttrib( GL_ENABLE_BIT | GL_CURRENT_BIT | GL_LINE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT | GL_POLYGON_BIT );
+
+	glDisable( GL_DEPTH_TEST );
+	glDisable( GL_CULL_FACE );
+	glDisable( GL_ALPHA_TEST );
+	glDisable( GL_TEXTURE_2D );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+	glLineWidth( 1.0f );
+
+	glMatrixMode( GL_PROJECTION );
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho( 0.0f, ( float ) size.GetWidth(), ( float ) size.GetHeight(), 0.0f, 1.0f, -1.0f );
+
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+	glLoadIdentity();
+
+	const float flPanelX = MARGIN;
+	const float flPanelY = MARGIN;
+
+	glColor4f( 0, 0, 0, 0.6f );
+
+	DrawQuad( flPanelX, flPanelY, TEXT_WIDTH + GRAPH_WIDTH + PADDING * 3, HEADER_HEIGHT + ROW_HEIGHT * uiSeriesCount + PADDING * 2 );
+
+	float flValues[ profiler::HISTORY_SIZE ];
+
+	const float flGraphX = flPanelX + PADDING * 2 + TEXT_WIDTH;
+
+	for( size_t uiSeries = 0; uiSeries < uiSeriesCount; ++uiSeries )
+	{
+		const float flRowY = flPanelY + PADDING + HEADER_HEIGHT + ROW_HEIGHT * uiSeries;
+		const float flGraphHeight = ROW_HEIGHT - PADDING;
+
+		glColor4f( 0.3f, 0.3f, 0.3f, 0.5f );
+
+		DrawQuad( flGraphX, flRowY, GRAPH_WIDTH, flGraphHeight );
+
+		profiler::SeriesStats_t stats;
+
+		if( !profiler::GetSeriesStats( uiSeries, stats ) )
+			continue;
+
+		const size_t uiCount = profiler::GetSeriesHistory( uiSeries, flValues, profiler::HISTORY_SIZE );
+
+		//Scaled to the largest value so spikes stay visible.
+		const float flScale = flGraphHeight / std::max( stats.flMax, 0.001f );
+
+		const float flBottom = flRowY + flGraphHeight;
+
+		//The newest frame is always at the right edge.
+		const float flStartX = flGraphX + GRAPH_WIDTH - uiCount;
+
+		if( profiler::GetSeriesType( uiSeries ) == profiler::SeriesType::TIME )
+			glColor4f( 0.4f, 1.0f, 0.4f, 1.0f );
+		else
+			glColor4f( 0.4f, 0.8f, 1.0f, 1.0f );
+
+		glBegin( GL_LINE_STRIP );
+
+		for( size_t uiValue = 0; uiValue < uiCount; ++uiValue )
+		{
+			glVertex2f( flStartX + uiValue, flBottom - flValues[ uiValue ] * flScale );
+		}
+
+		glEnd();
+
+		//Mark the 95th percentile so outliers stand out.
+		glColor4f( 1.0f, 0.3f, 0.3f, 0.8f );
+
+		glBegin( GL_LINES );
+		glVertex2f( flGraphX, flBottom - stats.flP95 * flScale );
+		glVertex2f( flGraphX + GRAPH_WIDTH, flBottom - stats.flP95 * flScale );
+		glEnd();
+	}
+
+	if( m_TextTexture )
+	{
+		glEnable( GL_TEXTURE_2D );
+		glBindTexture( GL_TEXTURE_2D, m_TextTexture );
+		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+
+		glColor4f( 1, 1, 1, 1 );
+
+		DrawQuad( flPanelX + PADDING, flPanelY + PADDING, m_iTextWidth, m_iTextHeight );
+	}
+
+	glPopMatrix();
+
+	glMatrixMode( GL_PROJECTION );
+	glPopMatrix();
+
+	glMatrixMode( GL_MODELVIEW );
+
+	glPopAttrib();
+}
+
+void CProfilerOverlay::Destroy()
+{
+	if( m_TextTexture )
+	{
+		glDeleteTextures( 1, &m_TextTexture );
+		m_TextTexture = 0;
+	}
+
+	m_uiTextSeriesCount = 0;
+}
+
+void CProfilerOverlay::UpdateText( const unsigned int uiDrawnPolys, const renderer::DrawStats_t& drawStats )
+{
+	m_LastTextUpdate = std::chrono::steady_clock::now();
+
+	m_uiTextSeriesCount = profiler::GetSeriesCount();
+
+	m_iTextWidth = TEXT_WIDTH;
+	m_iTextHeight = HEADER_HEIGHT + ROW_HEIGHT * static_cast<int>( m_uiTextSeriesCount );
+
+	wxBitmap bitmap( m_iTextWidth, m_iTextHeight, 24 );
+
+	{
+		wxMemoryDC dc( bitmap );
+
+		dc.SetBackground( *wxBLACK_BRUSH );
+		dc.Clear();
+
+		dc.SetFont( wxFontInfo( 8 ).Family( wxFONTFAMILY_TELETYPE ) );
+		dc.SetTextForeground( *wxWHITE );
+
+		dc.DrawText( wxString::Format( "Polygons: %u  Frames: %u", uiDrawnPolys, static_cast<unsigned int>( profiler::GetFrameCount() ) ), 0, 0 );
+
+		dc.DrawText( wxString::Format( "Draws: %u  Verts: %u  Binds: %u", drawStats.uiDrawCalls, drawStats.uiVertices, drawStats.uiTextureBinds ), 0, LINE_HEIGHT );
+
+		dc.DrawText( wxString::Format( "Blend: %u  Depth: %u  Alpha: %u", drawStats.uiBlendChanges, drawStats.uiDepthChanges, drawStats.uiAlphaChanges ), 0, LINE_HEIGHT * 2 );
+
+		dc.DrawText( wxString::Format( "Upload: %.1f KB  Culled: %u", drawStats.uiUploadedBytes / 1024.0, drawStats.uiCulledMeshes ), 0, LINE_HEIGHT * 3 );
+
+		for( size_t uiSeries = 0; uiSeries < m_uiTextSeriesCount; ++uiSeries )
+		{
+			const int iY = HEADER_HEIGHT + ROW_HEIGHT * static_cast<int>( uiSeries );
+
+			const profiler::SeriesType type = profiler::GetSeriesType( uiSeries );
+
+			profiler::SeriesStats_t stats;
+
+			profiler::GetSeriesStats( uiSeries, stats );
+
+			dc.DrawText( wxString::Format( "%s: %s%s", profiler::GetSeriesName( uiSeries ), FormatValue( type, stats.flLast ),
+										   type == profiler::SeriesType::TIME ? " ms" : "" ), 0, iY );
+
+			dc.DrawText( wxString::Format( "p50 %s  p95 %s  p99 %s",
+										   FormatValue( type, stats.flP50 ), FormatValue( type, stats.flP95 ), FormatValue( type, stats.flP99 ) ),
+						 0, iY + LINE_HEIGHT );
+		}
+
+		dc.SelectObject( wxNullBitmap );
+	}
+
+	const wxImage image = bitmap.ConvertToImage();
+
+	const unsigned char* pSource = image.GetData();
+
+	const size_t uiPixels = static_cast<size_t>( m_iTextWidth ) * m_iTextHeight;
+
+	//White text, with the drawn brightness as alpha so it blends over the graphs.
+	std::vector<unsigned char> pixels( uiPixels * 4, 255 );
+
+	for( size_t uiPixel = 0; uiPixel < uiPixels; ++uiPixel )
+	{
+		pixels[ uiPixel * 4 + 3 ] = pSource[ uiPixel * 3 ];
+	}
+
+	if( !m_TextTexture )
+		glGenTextures( 1, &m_TextTexture );
+
+	GLint oldTexture;
+
+	glGetIntegerv( GL_TEXTURE_BINDING_2D, &oldTexture );
+
+	glBindTexture( GL_TEXTURE_2D, m_TextTexture );
+
+	//Drawn at its own size, so no filtering is needed.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, m_iTextWidth, m_iTextHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data() );
+
+	glBindTexture( GL_TEXTURE_2D, static_cast<GLuint>( oldTexture ) );
+}
+}
@@ -0,0 +1,60 @@
+#ifndef HLMV_UI_CPROFILEROVERLAY_H
+#define HLMV_UI_CPROFILEROVERLAY_H
+
+#include <chrono>
+
+#include "wxHLMV.h"
+
+#include "graphics/OpenGL.h"
+
+#include "engine/shared/renderer/DrawStats.h"
+
+namespace hlmv
+{
+/**
+*	Draws the frame profiler's series on top of the 3D view: a graph of each series' history, and its latest value and percentiles.
+*	Text is drawn with wxWidgets into a texture that is only redrawn a few times per second, so the overlay barely shows up in its own timings.
+*	The context must be current whenever this is used.
+*/
+class CProfilerOverlay final
+{
+public:
+	CProfilerOverlay() = default;
+	~CProfilerOverlay() = default;
+
+	/**
+	*	Draws the overlay in the top left corner of the viewport.
+	*	@param size Size of the viewport.
+	*	@param uiDrawnPolys Number of polygons drawn in the last frame.
+	*	@param drawStats Draw stats of the renderers and the render context for the last frame.
+	*/
+	void Draw( const wxSize& size, const unsigned int uiDrawnPolys, const renderer::DrawStats_t& drawStats );
+
+	/**
+	*	Frees the text texture.
+	*/
+	void Destroy();
+
+private:
+	void UpdateText( const unsigned int uiDrawnPolys, const renderer::DrawStats_t& drawStats );
+
+private:
+	GLuint m_TextTexture = 0;
+
+	int m_iTextWidth = 0;
+	int m_iTextHeight = 0;
+
+	/**
+	*	Number of series the text was drawn for. Series are registered when they are first recorded, so the text is redrawn when this changes.
+	*/
+	size_t m_uiTextSeriesCount = 0;
+
+	std::chrono::steady_clock::time_point m_LastTextUpdate;
+
+private:
+	CProfilerOverlay( const CProfilerOverlay& ) = delete;
+	CProfilerOverlay& operator=( const CProfilerOverlay& ) = delete;
+};
+}
+
+#endif //HLMV_UI_CPROFILEROVERLAY_H
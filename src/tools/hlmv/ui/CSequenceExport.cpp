@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <wx/filename.h>
+#include <wx/image.h>
+
+#include "shared/CWorldTime.h"
+#include "shared/Logging.h"
+
+#include "shared/renderer/studiomodel/IStudioModelRenderer.h"
+
+#include "shared/studiomodel/CStudioModelManager.h"
+
+#include "game/entity/CEntityManager.h"
+
+#include "graphics/GLRenderTarget.h"
+
+#include "ui/wx/CwxOpenGL.h"
+#include "ui/wx/utility/wxUtil.h"
+
+#include "CModelViewerApp.h"
+#include "../CHLMVState.h"
+
+#include "ModelScene.h"
+
+#include "CSequenceExport.h"
+
+//TODO: remove
+extern studiomdl::IStudioModelRenderer* g_pStudioMdlRenderer;
+
+namespace hlmv
+{
+namespace
+{
+/**
+*	Animation time that the export starts at.
+*/
+const double START_TIME = 1.0;
+}
+
+CSequenceExport::CSequenceExport( CModelViewerApp* const pHLMV )
+	: m_pHLMV( pHLMV )
+{
+	wxASSERT( pHLMV );
+}
+
+CSequenceExport::~CSequenceExport()
+{
+}
+
+bool CSequenceExport::Run( const Settings_t& settings )
+{
+	wxASSERT( settings.uiFPS > 0 );
+
+	if( settings.szModel.IsEmpty() )
+	{
+		Error( "No model given to export\n" );
+		return false;
+	}
+
+	studiomdl::CStudioModelManager::ModelPtr_t model;
+
+	const auto result = studiomdl::StudioModelManager().LoadModel( settings.szModel.c_str(), model );
+
+	if( result != studiomdl::StudioModelLoadResult::SUCCESS )
+	{
+		Error( "Error loading model \"%s\"\n", settings.szModel.c_str().AsChar() );
+		return false;
+	}
+
+	const studiohdr_t* const pStudioHdr = model->GetStudioHeader();
+
+	if( settings.iSequence < 0 || settings.iSequence >= pStudioHdr->numseq )
+	{
+		Error( "Model \"%s\" has no sequence %d\n", settings.szModel.c_str().AsChar(), settings.iSequence );
+		return false;
+	}
+
+	unsigned int uiFrames = settings.uiFrames;
+
+	//Render the sequence once by default.
+	if( uiFrames == 0 )
+	{
+		const mstudioseqdesc_t* const pseqdesc = pStudioHdr->GetSequence( settings.iSequence );
+
+		const double flDuration = pseqdesc->fps > 0 ? pseqdesc->numframes / pseqdesc->fps : 0;
+
+		uiFrames = std::max( 1u, static_cast<unsigned int>( std::ceil( flDuration * settings.uiFPS ) ) );
+	}
+
+	auto pState = m_pHLMV->GetState();
+
+	CHLMVStudioModelEntity* pEntity = static_cast<CHLMVStudioModelEntity*>( CBaseEntity::Create( "studiomodel", glm::vec3(), glm::vec3(), false ) );
+
+	if( !pEntity )
+	{
+		Error( "Couldn't create the model entity\n" );
+		return false;
+	}
+
+	pEntity->m_pState = pState;
+
+	pEntity->SetModel( model );
+
+	pEntity->Spawn();
+
+	pState->SetEntity( pEntity );
+
+	pState->CenterView();
+
+	pState->playSequence = true;
+	pState->pause = false;
+
+	pEntity->SetSequence( settings.iSequence );
+	pEntity->SetFrame( 0 );
+
+	WorldTime.SetPreviousTime( START_TIME );
+	WorldTime.SetCurrentTime( START_TIME );
+	WorldTime.SetFrameTime( 0 );
+
+	bool bSuccess = OpenOutput( settings );
+
+	GLRenderTarget* const pTarget = bSuccess ? BindSceneTarget( "CSequenceExport", settings.size.GetWidth(), settings.size.GetHeight() ) : nullptr;
+
+	if( !pTarget )
+		bSuccess = false;
+
+	if( bSuccess )
+	{
+		Message( "Exporting %u frames of sequence %d to \"%s\"\n", uiFrames, settings.iSequence, settings.szOutputFile.c_str().AsChar() );
+
+		const auto startTime = std::chrono::steady_clock::now();
+
+		const Color& backgroundColor = m_pHLMV->GetSettings()->GetBackgroundColor();
+
+		const double flFrameTime = 1.0 / settings.uiFPS;
+
+		auto completion = [ this ]( const graphics::CPixelReadback::Handle_t, const unsigned char* pPixels, const GLsizei iWidth, const GLsizei iHeight )
+		{
+			QueueFrame( pPixels, iWidth, iHeight );
+		};
+
+		for( unsigned int uiFrame = 0; uiFrame < uiFrames; ++uiFrame )
+		{
+			//The first frame shows the start of the sequence.
+			if( uiFrame > 0 )
+			{
+				WorldTime.SetPreviousTime( WorldTime.GetCurrentTime() );
+				WorldTime.SetCurrentTime( WorldTime.GetCurrentTime() + flFrameTime );
+				WorldTime.SetFrameTime( flFrameTime );
+			}
+
+			g_pStudioMdlRenderer->RunFrame();
+
+			EntityManager().RunFrame();
+
+			glClearColor( backgroundColor.GetRed() / 255.0f, backgroundColor.GetGreen() / 255.0f, backgroundColor.GetBlue() / 255.0f, 1.0 );
+
+			glClearStencil( 0 );
+
+			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+
+			DrawModelScene( m_pHLMV, settings.size.GetWidth(), settings.size.GetHeight(), GL_INVALID_TEXTURE_ID, GL_INVALID_TEXTURE_ID );
+
+			//The copy runs while the next frames are drawn; only the oldest readbacks are waited on once too many are in flight.
+			m_Readback.Read( 0, 0, settings.size.GetWidth(), settings.size.GetHeight(), GL_COLOR_ATTACHMENT0 );
+
+			m_Readback.PollUntil( completion, MAX_PENDING_READBACKS );
+		}
+
+		m_Readback.Poll( completion, true );
+
+		const double flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+		bSuccess = m_uiFailedReads == 0;
+
+		Message( "Rendered %u frames in %.2f seconds: %.2f frames/s\n", uiFrames, flSeconds, flSeconds > 0 ? uiFrames / flSeconds : 0.0 );
+	}
+
+	if( pTarget )
+		pTarget->Unbind();
+
+	m_Readback.Destroy();
+
+	if( !CloseOutput() )
+		bSuccess = false;
+
+	pState->ClearEntity();
+
+	EntityManager().RunFrame();
+
+	wxOpenGL().GetErrors();
+
+	return bSuccess;
+}
+
+bool CSequenceExport::OpenOutput( const Settings_t& settings )
+{
+	const wxFileName fileName( settings.szOutputFile );
+
+	if( !fileName.GetPath().IsEmpty() && !wxDirExists( fileName.GetPath() ) && !wxFileName::Mkdir( fileName.GetPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL ) )
+	{
+		Error( "Couldn't create output directory \"%s\"\n", fileName.GetPath().c_str().AsChar() );
+		return false;
+	}
+
+	m_szBaseName = wxFileName( fileName.GetPath(), fileName.GetName() ).GetFullPath();
+	m_szExtension = fileName.GetExt();
+	m_uiNextFrame = 0;
+	m_uiFailedReads = 0;
+
+	//Anything that isn't an image is left to ffmpeg.
+	m_bVideo = m_szExtension.IsEmpty() || !wxImage::FindHandler( m_szExtension, wxBITMAP_TYPE_ANY );
+
+	if( !m_bVideo )
+	{
+		m_Encoder.Start();
+		return true;
+	}
+
+	//Frames are read bottom to top; ffmpeg flips them while encoding so the GL thread doesn't have to.
+	const std::vector<std::pair<std::string, std::string>> parameters
+	{
+		{ "-y", "" },
+		{ "-loglevel", "error" },
+		{ "-f", "rawvideo" },
+		{ "-pix_fmt", "rgb24" },
+		{ "-s", wxString::Format( "%dx%d", settings.size.GetWidth(), settings.size.GetHeight() ).ToStdString() },
+		{ "-r", std::to_string( settings.uiFPS ) },
+		{ "-i", "-" },
+		{ "-vf", "vflip" },
+		{ "-pix_fmt", "yuv420p" },
+		{ settings.szOutputFile.ToStdString(), "" }
+	};
+
+	return m_VideoPipe.Open( wx::FormatCommandLine( settings.szFFmpeg, parameters ).ToStdString() );
+}
+
+void CSequenceExport::QueueFrame( const unsigned char* pPixels, const GLsizei iWidth, const GLsizei iHeight )
+{
+	const unsigned int uiFrame = m_uiNextFrame++;
+
+	if( !pPixels )
+	{
+		++m_uiFailedReads;
+		return;
+	}
+
+	std::vector<unsigned char> pixels( pPixels, pPixels + static_cast<size_t>( iWidth ) * iHeight * 3 );
+
+	if( m_bVideo )
+	{
+		m_VideoPipe.Queue( std::move( pixels ) );
+		return;
+	}
+
+	ui::CImageEncoder::Job_t job;
+
+	job.szFilename = wxString::Format( "%s_%05u.%s", m_szBaseName, uiFrame, m_szExtension ).ToStdString();
+	job.iWidth = iWidth;
+	job.iHeight = iHeight;
+	//OpenGL reads the image upside down; flipped while encoding.
+	job.bFlipVertically = true;
+	job.pixels = std::move( pixels );
+
+	m_Encoder.Queue( std::move( job ) );
+}
+
+bool CSequenceExport::CloseOutput()
+{
+	if( m_bVideo )
+	{
+		if( !m_VideoPipe.IsOpen() )
+			return false;
+
+		const bool bSuccess = m_VideoPipe.Close();
+
+		Message( "Wrote %u frames to ffmpeg\n", static_cast<unsigned int>( m_VideoPipe.GetWrittenCount() ) );
+
+		return bSuccess;
+	}
+
+	if( !m_Encoder.IsRunning() )
+		return false;
+
+	m_Encoder.Finish();
+
+	if( m_Encoder.GetFailedCount() > 0 )
+	{
+		Warning( "%u frames failed to save\n", static_cast<unsigned int>( m_Encoder.GetFailedCount() ) );
+		return false;
+	}
+
+	return true;
+}
+}
@@ -0,0 +1,124 @@
+#ifndef HLMV_UI_CSEQUENCEEXPORT_H
+#define HLMV_UI_CSEQUENCEEXPORT_H
+
+#include <cstddef>
+
+#include "wxHLMV.h"
+
+#include "graphics/CPixelReadback.h"
+
+#include "ui/wx/utility/CImageEncoder.h"
+#include "ui/wx/utility/CVideoPipe.h"
+
+namespace hlmv
+{
+class CModelViewerApp;
+
+/**
+*	Renders a sequence of a model frame by frame at a fixed timestep to an image sequence or a video, without opening any windows.
+*	Frames go through a pipeline: they're drawn into the offscreen render target, copied into pixel buffer objects that are mapped
+*	a few frames later, and then encoded by worker threads, or written to an ffmpeg process that encodes the video.
+*	Drawing never waits for a readback unless too many are in flight, so exports are limited by how fast frames can be encoded.
+*/
+class CSequenceExport final
+{
+public:
+	/**
+	*	Default number of frames per second of the output.
+	*/
+	static const unsigned int DEFAULT_FPS = 30;
+
+	/**
+	*	Number of readbacks that may be in flight before drawing waits for the oldest one.
+	*/
+	static const size_t MAX_PENDING_READBACKS = 3;
+
+	struct Settings_t
+	{
+		wxString szModel;
+
+		/**
+		*	File to write to. If the extension is an image format, a numbered image is written for each frame.
+		*	Otherwise, frames are piped to ffmpeg, which picks the video format from the extension.
+		*/
+		wxString szOutputFile;
+
+		/**
+		*	Path to ffmpeg.
+		*/
+		wxString szFFmpeg = "ffmpeg";
+
+		wxSize size;
+
+		int iSequence = 0;
+
+		unsigned int uiFPS = DEFAULT_FPS;
+
+		/**
+		*	Number of frames to render, or 0 to render the sequence once.
+		*/
+		unsigned int uiFrames = 0;
+	};
+
+public:
+	CSequenceExport( CModelViewerApp* const pHLMV );
+	~CSequenceExport();
+
+	/**
+	*	Loads the model and exports the sequence. The context must be current.
+	*	@return Whether every frame was rendered and saved.
+	*/
+	bool Run( const Settings_t& settings );
+
+private:
+	/**
+	*	Starts writing frames to the output.
+	*	@return Whether the output is ready.
+	*/
+	bool OpenOutput( const Settings_t& settings );
+
+	/**
+	*	Hands a frame that has been read back to the encoder.
+	*/
+	void QueueFrame( const unsigned char* pPixels, const GLsizei iWidth, const GLsizei iHeight );
+
+	/**
+	*	Waits for all frames to be written and closes the output.
+	*	@return Whether every frame was written.
+	*/
+	bool CloseOutput();
+
+private:
+	CModelViewerApp* const m_pHLMV;
+
+	graphics::CPixelReadback m_Readback;
+
+	/**
+	*	Used for image sequences.
+	*/
+	ui::CImageEncoder m_Encoder;
+
+	/**
+	*	Used for videos.
+	*/
+	ui::CVideoPipe m_VideoPipe;
+
+	bool m_bVideo = false;
+
+	/**
+	*	Output file name without extension, and the extension. Image sequences append the frame number in between.
+	*/
+	wxString m_szBaseName;
+	wxString m_szExtension;
+
+	unsigned int m_uiNextFrame = 0;
+
+	size_t m_uiFailedReads = 0;
+
+private:
+	CSequenceExport( const CSequenceExport& ) = delete;
+	CSequenceExport& operator=( const CSequenceExport& ) = delete;
+};
+}
+
+#endif //HLMV_UI_CSEQUENCEEXPORT_H
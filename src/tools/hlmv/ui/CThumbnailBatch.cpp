@@ -0,0 +1,308 @@
+#include <chrono>
+#include <memory>
+
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include <wx/image.h>
+#include <wx/textfile.h>
+
+#include "shared/Logging.h"
+
+#include "shared/studiomodel/CStudioModelLoader.h"
+
+#include "game/entity/CEntityManager.h"
+
+#include "CModelViewerApp.h"
+#include "../CHLMVState.h"
+
+#include "ModelScene.h"
+
+#include "CThumbnailBatch.h"
+
+namespace hlmv
+{
+namespace
+{
+/**
+*	Time that may be spent uploading textures per loader per update, in seconds.
+*/
+const double LOAD_BUDGET = 0.05;
+
+/**
+*	Returns whether the given model file belongs to another model, like a texture model or a sequence group.
+*/
+bool IsCompanionFile( const wxFileName& fileName )
+{
+	const wxString szName = fileName.GetName();
+
+	wxString szOwner;
+
+	if( szName.length() > 1 && ( szName.EndsWith( "t" ) || szName.EndsWith( "T" ) ) )
+		szOwner = szName.Left( szName.length() - 1 );
+	else if( szName.length() > 2 && wxIsdigit( szName[ szName.length() - 1 ] ) && wxIsdigit( szName[ szName.length() - 2 ] ) )
+		szOwner = szName.Left( szName.length() - 2 );
+	else
+		return false;
+
+	wxFileName owner( fileName );
+
+	owner.SetName( szOwner );
+
+	return owner.FileExists();
+}
+}
+
+CThumbnailBatch::CThumbnailBatch( CModelViewerApp* const pHLMV )
+	: m_pHLMV( pHLMV )
+{
+	wxASSERT( pHLMV );
+}
+
+CThumbnailBatch::~CThumbnailBatch()
+{
+}
+
+bool CThumbnailBatch::AddSource( const wxString& szSource )
+{
+	if( wxDirExists( szSource ) )
+	{
+		wxArrayString files;
+
+		wxDir::GetAllFiles( szSource, &files, "*.mdl", wxDIR_FILES | wxDIR_DIRS );
+
+		//Directory order is not defined; sort so output is the same on every run.
+		files.Sort();
+
+		wxFileName root = wxFileName::DirName( szSource );
+
+		root.MakeAbsolute();
+
+		for( const auto& szFile : files )
+		{
+			wxFileName fileName( szFile );
+
+			if( IsCompanionFile( fileName ) )
+				continue;
+
+			fileName.MakeAbsolute();
+
+			wxFileName outputName( fileName.GetPath(), fileName.GetName() );
+
+			//Keep the directory structure so models with the same name don't overwrite each other's images.
+			outputName.MakeRelativeTo( root.GetPath() );
+
+			m_Models.push_back( { fileName.GetFullPath(), outputName.GetFullPath() } );
+		}
+
+		return true;
+	}
+
+	wxTextFile manifest;
+
+	if( !wxFileExists( szSource ) || !manifest.Open( szSource ) )
+	{
+		Error( "Couldn't open model directory or manifest \"%s\"\n", szSource.c_str().AsChar() );
+		return false;
+	}
+
+	wxFileName manifestName( szSource );
+
+	manifestName.MakeAbsolute();
+
+	for( size_t uiLine = 0; uiLine < manifest.GetLineCount(); ++uiLine )
+	{
+		wxString szLine = manifest.GetLine( uiLine );
+
+		szLine.Trim( true ).Trim( false );
+
+		if( szLine.IsEmpty() || szLine.StartsWith( "#" ) )
+			continue;
+
+		wxFileName fileName( szLine );
+
+		fileName.MakeAbsolute( manifestName.GetPath() );
+
+		m_Models.push_back( { fileName.GetFullPath(), fileName.GetName() } );
+	}
+
+	return true;
+}
+
+bool CThumbnailBatch::Run( const wxString& szOutputDir, const wxSize& size, const unsigned int uiAngles, const size_t uiMaxLoads )
+{
+	wxASSERT( uiAngles > 0 );
+	wxASSERT( uiMaxLoads > 0 );
+
+	if( m_Models.empty() )
+	{
+		Error( "No models to render\n" );
+		return false;
+	}
+
+	if( !wxDirExists( szOutputDir ) && !wxFileName::Mkdir( szOutputDir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL ) )
+	{
+		Error( "Couldn't create output directory \"%s\"\n", szOutputDir.c_str().AsChar() );
+		return false;
+	}
+
+	Message( "Rendering %u models from %u angles\n", static_cast<unsigned int>( m_Models.size() ), uiAngles );
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	m_Encoder.Start();
+
+	std::vector<std::unique_ptr<studiomdl::CStudioModelLoader>> loaders;
+	std::vector<size_t> loaderModels( uiMaxLoads );
+
+	for( size_t uiLoader = 0; uiLoader < uiMaxLoads; ++uiLoader )
+	{
+		loaders.emplace_back( std::make_unique<studiomdl::CStudioModelLoader>() );
+	}
+
+	size_t uiNextModel = 0;
+	size_t uiRendered = 0;
+	size_t uiFailed = 0;
+
+	while( true )
+	{
+		bool bLoading = false;
+		bool bFinishedAny = false;
+
+		for( size_t uiLoader = 0; uiLoader < loaders.size(); ++uiLoader )
+		{
+			auto& loader = *loaders[ uiLoader ];
+
+			if( !loader.IsLoading() )
+			{
+				if( uiNextModel >= m_Models.size() )
+					continue;
+
+				loaderModels[ uiLoader ] = uiNextModel;
+
+				loader.Start( m_Models[ uiNextModel++ ].szFilename.c_str() );
+			}
+
+			bLoading = true;
+
+			if( !loader.Update( LOAD_BUDGET ) )
+				continue;
+
+			bFinishedAny = true;
+
+			const Model_t& model = m_Models[ loaderModels[ uiLoader ] ];
+
+			if( loader.GetResult() != studiomdl::StudioModelLoadResult::SUCCESS )
+			{
+				Error( "Error loading model \"%s\"\n", model.szFilename.c_str().AsChar() );
+				++uiFailed;
+				continue;
+			}
+
+			auto studioModel = studiomdl::StudioModelManager().AddModel( loader.GetFilename().c_str(), loader.ReleaseModel() );
+
+			if( RenderModel( model, studioModel, szOutputDir, size, uiAngles ) )
+				++uiRendered;
+			else
+				++uiFailed;
+		}
+
+		if( !bLoading )
+			break;
+
+		//Nothing to upload yet; don't spin while the worker threads are reading files.
+		if( !bFinishedAny )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+
+	m_Encoder.Finish();
+
+	const double flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+	const size_t uiSaved = m_Encoder.GetSavedCount();
+	const size_t uiFailedImages = m_Encoder.GetFailedCount();
+
+	Message( "Rendered %u models (%u images) in %.2f seconds: %.2f models/s, %.2f images/s\n",
+		static_cast<unsigned int>( uiRendered ), static_cast<unsigned int>( uiSaved ), flSeconds,
+		flSeconds > 0 ? uiRendered / flSeconds : 0.0, flSeconds > 0 ? uiSaved / flSeconds : 0.0 );
+
+	if( uiFailed > 0 || uiFailedImages > 0 )
+	{
+		Warning( "%u models failed to render, %u images failed to save\n",
+			static_cast<unsigned int>( uiFailed ), static_cast<unsigned int>( uiFailedImages ) );
+	}
+
+	return uiFailed == 0 && uiFailedImages == 0;
+}
+
+bool CThumbnailBatch::RenderModel( const Model_t& model, const studiomdl::CStudioModelManager::ModelPtr_t& studioModel,
+								   const wxString& szOutputDir, const wxSize& size, const unsigned int uiAngles )
+{
+	auto pState = m_pHLMV->GetState();
+
+	CHLMVStudioModelEntity* pEntity = static_cast<CHLMVStudioModelEntity*>( CBaseEntity::Create( "studiomodel", glm::vec3(), glm::vec3(), false ) );
+
+	if( !pEntity )
+	{
+		Error( "Couldn't create the model entity\n" );
+		return false;
+	}
+
+	pEntity->m_pState = pState;
+
+	pEntity->SetModel( studioModel );
+
+	pEntity->Spawn();
+
+	pState->SetEntity( pEntity );
+
+	pState->CenterView();
+
+	const wxFileName baseName( szOutputDir, model.szOutputName );
+
+	if( !wxDirExists( baseName.GetPath() ) && !wxFileName::Mkdir( baseName.GetPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL ) )
+	{
+		Error( "Couldn't create output directory \"%s\"\n", baseName.GetPath().c_str().AsChar() );
+		pState->ClearEntity();
+		return false;
+	}
+
+	bool bSuccess = true;
+
+	wxImage image;
+
+	for( unsigned int uiAngle = 0; uiAngle < uiAngles; ++uiAngle )
+	{
+		pEntity->SetAngles( glm::vec3( 0, ( 360.0f * uiAngle ) / uiAngles, 0 ) );
+
+		if( !RenderModelSceneToImage( m_pHLMV, size.GetWidth(), size.GetHeight(), GL_INVALID_TEXTURE_ID, GL_INVALID_TEXTURE_ID, image ) )
+		{
+			bSuccess = false;
+			break;
+		}
+
+		wxString szFilename = baseName.GetFullPath();
+
+		if( uiAngles > 1 )
+			szFilename += wxString::Format( "_%03u", uiAngle );
+
+		szFilename += ".png";
+
+		ui::CImageEncoder::Job_t job;
+
+		job.szFilename = szFilename.ToStdString();
+		job.iWidth = image.GetWidth();
+		job.iHeight = image.GetHeight();
+		job.bFlipVertically = false;
+		job.pixels.assign( image.GetData(), image.GetData() + job.iWidth * job.iHeight * 3 );
+
+		m_Encoder.Queue( std::move( job ) );
+	}
+
+	pState->ClearEntity();
+
+	//Frees the entity and with it the model, so memory use doesn't grow with the number of models.
+	EntityManager().RunFrame();
+
+	return bSuccess;
+}
+}
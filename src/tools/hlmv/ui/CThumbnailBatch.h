@@ -0,0 +1,87 @@
+#ifndef HLMV_UI_CTHUMBNAILBATCH_H
+#define HLMV_UI_CTHUMBNAILBATCH_H
+
+#include <vector>
+
+#include "wxHLMV.h"
+
+#include "ui/wx/utility/CImageEncoder.h"
+
+#include "shared/studiomodel/CStudioModelManager.h"
+
+namespace hlmv
+{
+class CModelViewerApp;
+
+/**
+*	Renders preview images for many models without opening any windows.
+*	Several models are loaded at once by their loaders' worker threads, each model is rendered from a number of turntable angles
+*	on the GL thread, and images are encoded by a separate pool of threads while the next models are being rendered.
+*/
+class CThumbnailBatch final
+{
+public:
+	/**
+	*	Default number of models that are loaded at the same time.
+	*/
+	static const size_t DEFAULT_MAX_LOADS = 4;
+
+private:
+	struct Model_t
+	{
+		wxString szFilename;
+
+		/**
+		*	Name of the output images, relative to the output directory and without extension.
+		*/
+		wxString szOutputName;
+	};
+
+public:
+	CThumbnailBatch( CModelViewerApp* const pHLMV );
+	~CThumbnailBatch();
+
+	/**
+	*	Adds models to render. If szSource is a directory, all models in it and its subdirectories are added.
+	*	Otherwise it is a manifest that lists one model per line. Relative paths are relative to the manifest.
+	*	Empty lines and lines starting with '#' are ignored.
+	*	@return Whether the source could be read.
+	*/
+	bool AddSource( const wxString& szSource );
+
+	/**
+	*	@return Number of models that have been added.
+	*/
+	size_t GetModelCount() const { return m_Models.size(); }
+
+	/**
+	*	Renders all added models. The context must be current.
+	*	@param szOutputDir Directory to write images to. Created if it doesn't exist.
+	*	@param size Size of each image.
+	*	@param uiAngles Number of turntable angles to render each model from.
+	*	@param uiMaxLoads Number of models to load at the same time.
+	*	@return Whether every model was rendered and saved.
+	*/
+	bool Run( const wxString& szOutputDir, const wxSize& size, const unsigned int uiAngles, const size_t uiMaxLoads = DEFAULT_MAX_LOADS );
+
+private:
+	/**
+	*	Renders a model that has finished loading from every angle and queues the images for encoding.
+	*/
+	bool RenderModel( const Model_t& model, const studiomdl::CStudioModelManager::ModelPtr_t& studioModel,
+					  const wxString& szOutputDir, const wxSize& size, const unsigned int uiAngles );
+
+private:
+	CModelViewerApp* const m_pHLMV;
+
+	std::vector<Model_t> m_Models;
+
+	ui::CImageEncoder m_Encoder;
+
+private:
+	CThumbnailBatch( const CThumbnailBatch& ) = delete;
+	CThumbnailBatch& operator=( const CThumbnailBatch& ) = delete;
+};
+}
+
+#endif //HLMV_UI_CTHUMBNAILBATCH_H
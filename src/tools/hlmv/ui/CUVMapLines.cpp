@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include <glm/vec2.hpp>
+
+#include "shared/studiomodel/CStudioModel.h"
+
+#include "CUVMapLines.h"
+
+namespace hlmv
+{
+namespace
+{
+/**
+*	Packs texture coordinates into a single value, so edges can be sorted and compared as integers.
+*/
+uint32_t PackUV( const short* ptricmd )
+{
+	return ( static_cast<uint32_t>( static_cast<uint16_t>( ptricmd[ 2 ] ) ) << 16 ) | static_cast<uint16_t>( ptricmd[ 3 ] );
+}
+
+/**
+*	Adds an edge, ordering its ends so edges that are shared by triangles wound in different directions are identical.
+*/
+void AddEdge( std::vector<uint64_t>& edges, const uint32_t uiStart, const uint32_t uiEnd )
+{
+	if( uiStart == uiEnd )
+		return;
+
+	const uint32_t uiMin = std::min( uiStart, uiEnd );
+	const uint32_t uiMax = std::max( uiStart, uiEnd );
+
+	edges.push_back( ( static_cast<uint64_t>( uiMin ) << 32 ) | uiMax );
+}
+
+void AddTriangle( std::vector<uint64_t>& edges, const short* pA, const short* pB, const short* pC )
+{
+	const uint32_t uiA = PackUV( pA );
+	const uint32_t uiB = PackUV( pB );
+	const uint32_t uiC = PackUV( pC );
+
+	AddEdge( edges, uiA, uiB );
+	AddEdge( edges, uiB, uiC );
+	AddEdge( edges, uiC, uiA );
+}
+
+void AddMeshEdges( const studiohdr_t* pStudioHdr, const mstudiomesh_t* pMesh, std::vector<uint64_t>& edges )
+{
+	const short* ptricmds = reinterpret_cast<const short*>( pStudioHdr->GetData() + pMesh->triindex );
+
+	int i;
+
+	while( ( i = *( ptricmds++ ) ) != 0 )
+	{
+		const bool bFan = i < 0;
+
+		if( bFan )
+			i = -i;
+
+		//Each vertex is 4 shorts: vertex, normal, s and t.
+		for( int iVertex = 2; iVertex < i; ++iVertex )
+		{
+			const short* pVertex = ptricmds + iVertex * 4;
+
+			if( bFan )
+				AddTriangle( edges, ptricmds, pVertex - 4, pVertex );
+			else
+				AddTriangle( edges, pVertex - 8, pVertex - 4, pVertex );
+		}
+
+		ptricmds += i * 4;
+	}
+}
+}
+
+void CUVMapLines::Draw( const studiomdl::CStudioModel& model, const int iTexture, const mstudiomesh_t* pMesh, const float x, const float y, const float flScale )
+{
+	const Lines_t& lines = GetLines( model, iTexture, pMesh );
+
+	if( lines.iVertexCount == 0 )
+		return;
+
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+
+	//Lines are stored in texels.
+	glTranslatef( x, y, 0 );
+	glScalef( flScale, flScale, 1 );
+
+	glBindBuffer( GL_ARRAY_BUFFER, lines.buffer );
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+
+	glVertexPointer( 2, GL_FLOAT, sizeof( glm::vec2 ), nullptr );
+
+	glDrawArrays( GL_LINES, 0, lines.iVertexCount );
+
+	glDisableClientState( GL_VERTEX_ARRAY );
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	glPopMatrix();
+}
+
+void CUVMapLines::Destroy()
+{
+	for( auto& lines : m_Lines )
+	{
+		if( lines.buffer != 0 )
+			glDeleteBuffers( 1, &lines.buffer );
+	}
+
+	m_Lines.clear();
+
+	m_pModel = nullptr;
+	m_pStudioHdr = nullptr;
+}
+
+const CUVMapLines::Lines_t& CUVMapLines::GetLines( const studiomdl::CStudioModel& model, const int iTexture, const mstudiomesh_t* pMesh )
+{
+	if( m_pModel != &model || m_pStudioHdr != model.GetStudioHeader() )
+	{
+		Destroy();
+
+		m_pModel = &model;
+		m_pStudioHdr = model.GetStudioHeader();
+	}
+
+	for( const auto& lines : m_Lines )
+	{
+		if( lines.iTexture == iTexture && lines.pMesh == pMesh )
+			return lines;
+	}
+
+	const mstudiomesh_t* const* ppMeshes;
+	size_t uiMeshCount;
+
+	if( pMesh )
+	{
+		ppMeshes = &pMesh;
+		uiMeshCount = 1;
+	}
+	else
+	{
+		ppMeshes = model.GetTextureMeshes( iTexture, uiMeshCount );
+	}
+
+	std::vector<uint64_t> edges;
+
+	for( size_t uiIndex = 0; uiIndex < uiMeshCount; ++uiIndex )
+	{
+		AddMeshEdges( m_pStudioHdr, ppMeshes[ uiIndex ], edges );
+	}
+
+	std::sort( edges.begin(), edges.end() );
+	edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+
+	std::vector<glm::vec2> vertices;
+
+	vertices.reserve( edges.size() * 2 );
+
+	auto unpack = []( const uint32_t uiUV )
+	{
+		return glm::vec2( static_cast<int16_t>( uiUV >> 16 ), static_cast<int16_t>( uiUV & 0xFFFF ) );
+	};
+
+	for( const auto edge : edges )
+	{
+		vertices.push_back( unpack( static_cast<uint32_t>( edge >> 32 ) ) );
+		vertices.push_back( unpack( static_cast<uint32_t>( edge ) ) );
+	}
+
+	Lines_t lines{ iTexture, pMesh, 0, static_cast<GLsizei>( vertices.size() ) };
+
+	if( !vertices.empty() )
+	{
+		glGenBuffers( 1, &lines.buffer );
+
+		glBindBuffer( GL_ARRAY_BUFFER, lines.buffer );
+		glBufferData( GL_ARRAY_BUFFER, vertices.size() * sizeof( glm::vec2 ), vertices.data(), GL_STATIC_DRAW );
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+
+	m_Lines.push_back( lines );
+
+	return m_Lines.back();
+}
+}
@@ -0,0 +1,81 @@
+#ifndef HLMV_UI_CUVMAPLINES_H
+#define HLMV_UI_CUVMAPLINES_H
+
+#include <vector>
+
+#include "graphics/OpenGL.h"
+
+#include "shared/studiomodel/studio.h"
+
+namespace studiomdl
+{
+class CStudioModel;
+}
+
+namespace hlmv
+{
+/**
+*	UV map wireframes of a model's textures, kept in vertex buffers so the textures panel doesn't walk the triangle commands every frame.
+*	Each texture and mesh pair is built the first time it's drawn. Edges shared by triangles are only stored once.
+*	Everything is discarded when a different model is drawn.
+*	The context must be current whenever this is used.
+*/
+class CUVMapLines final
+{
+private:
+	struct Lines_t
+	{
+		int iTexture;
+
+		/**
+		*	Null for the lines of all meshes that use the texture.
+		*/
+		const mstudiomesh_t* pMesh;
+
+		GLuint buffer;
+
+		/**
+		*	Number of vertices in the buffer, 2 for each edge.
+		*/
+		GLsizei iVertexCount;
+	};
+
+public:
+	CUVMapLines() = default;
+	~CUVMapLines() = default;
+
+	/**
+	*	Draws the UV map of a texture with a single call. The caller sets up the color, blending and line smoothing beforehand.
+	*	@param model Model that the texture belongs to.
+	*	@param iTexture Index of the texture.
+	*	@param pMesh Mesh to draw the UV map of, or null to draw all meshes that use the texture.
+	*	@param x Position of the texture's top left corner.
+	*	@param y Position of the texture's top left corner.
+	*	@param flScale Scale of the texture.
+	*/
+	void Draw( const studiomdl::CStudioModel& model, const int iTexture, const mstudiomesh_t* pMesh, const float x, const float y, const float flScale );
+
+	/**
+	*	Frees all buffers.
+	*/
+	void Destroy();
+
+private:
+	const Lines_t& GetLines( const studiomdl::CStudioModel& model, const int iTexture, const mstudiomesh_t* pMesh );
+
+private:
+	/**
+	*	Model that the lines were built for. Both the model and its header are compared, so reloading a model at the same address is detected.
+	*/
+	const studiomdl::CStudioModel* m_pModel = nullptr;
+	const studiohdr_t* m_pStudioHdr = nullptr;
+
+	std::vector<Lines_t> m_Lines;
+
+private:
+	CUVMapLines( const CUVMapLines& ) = delete;
+	CUVMapLines& operator=( const CUVMapLines& ) = delete;
+};
+}
+
+#endif //HLMV_UI_CUVMAPLINES_H
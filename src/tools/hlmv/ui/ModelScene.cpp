@@ -0,0 +1,295 @@
+#include <memory>
+
+#include <glm/mat4x4.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <wx/image.h>
+
+#include "shared/Logging.h"
+#include "shared/Profiler.h"
+
+#include "CModelViewerApp.h"
+#include "../settings/CHLMVSettings.h"
+#include "../CHLMVState.h"
+
+#include "graphics/GraphicsUtils.h"
+#include "graphics/GraphicsHelpers.h"
+#include "graphics/GLRenderTarget.h"
+
+#include "shared/renderer/IRenderContext.h"
+#include "shared/renderer/studiomodel/IStudioModelRenderer.h"
+
+#include "game/entity/CStudioModelEntity.h"
+
+#include "ui/wx/CwxOpenGL.h"
+
+#include "ModelScene.h"
+
+//TODO: remove
+extern studiomdl::IStudioModelRenderer* g_pStudioMdlRenderer;
+extern renderer::IRenderContext* g_pRenderContext;
+
+namespace hlmv
+{
+glm::mat4x4 GetSceneViewMatrix( const graphics::CCamera& camera )
+{
+	const auto& vecOrigin = camera.GetOrigin();
+	const auto vecAngles = camera.GetViewDirection();
+
+	auto mat = Mat4x4ModelView();
+
+	mat *= glm::translate( -vecOrigin );
+
+	mat *= glm::rotate( glm::radians( vecAngles[ 2 ] ), glm::vec3{ 1, 0, 0 } );
+
+	mat *= glm::rotate( glm::radians( vecAngles[ 0 ] ), glm::vec3{ 0, 1, 0 } );
+
+	mat *= glm::rotate( glm::radians( vecAngles[ 1 ] ), glm::vec3{ 0, 0, 1 } );
+
+	return mat;
+}
+
+glm::mat4x4 GetSceneViewMatrix( const CHLMVState& state )
+{
+	return GetSceneViewMatrix( *state.GetCurrentCamera() );
+}
+
+void ApplyCameraToScene( const graphics::CCamera& camera )
+{
+	const auto mat = GetSceneViewMatrix( camera );
+
+	glLoadMatrixf( glm::value_ptr( mat ) );
+}
+
+void ApplyCameraToScene( const CHLMVState& state )
+{
+	ApplyCameraToScene( *state.GetCurrentCamera() );
+}
+
+void DrawModelScene( CModelViewerApp* pHLMV, const int iWidth, const int iHeight, const GLuint backgroundTexture, const GLuint groundTexture,
+					 const graphics::CCamera* pCamera )
+{
+	const graphics::CCamera& camera = pCamera ? *pCamera : *pHLMV->GetState()->GetCurrentCamera();
+
+	//
+	// draw background
+	//
+
+	if( pHLMV->GetState()->showBackground && backgroundTexture != GL_INVALID_TEXTURE_ID && !pHLMV->GetState()->showTexture )
+	{
+		PROFILE_SCOPE( "Background" );
+		const renderer::CScopedGPUTimer gpuTimer( *g_pRenderContext, "GPU background" );
+		graphics::DrawBackground( backgroundTexture );
+	}
+
+	graphics::SetProjection( pHLMV->GetState()->GetCurrentFOV(), iWidth, iHeight );
+
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+	glLoadIdentity();
+
+	ApplyCameraToScene( camera );
+
+	if( pHLMV->GetState()->drawAxes )
+	{
+		graphics::DrawSceneGeometry( graphics::SceneGeometry::AXES );
+	}
+
+	const auto mat = GetSceneViewMatrix( camera );
+
+	const auto vecAbsOrigin = glm::inverse( mat )[ 3 ];
+	
+	g_pStudioMdlRenderer->SetViewerOrigin( glm::vec3( vecAbsOrigin ) );
+
+	//Originally this was calculated as:
+	//vecViewerRight[ 0 ] = vecViewerRight[ 1 ] = vecOrigin[ 2 ];
+	//But that vector was incorrect. It mostly affects chrome because of its reflective nature.
+
+	//Grab the angles that the player would have in-game. Since model viewer rotates the world, rather than moving the camera, this has to be adjusted.
+	glm::vec3 angViewerDir = -camera.GetViewDirection();
+
+	angViewerDir = angViewerDir + 180.0f;
+
+	glm::vec3 vecViewerRight;
+
+	//We're using the up vector here since the in-game look can only be matched if chrome is rotated.
+	AngleVectors( angViewerDir, nullptr, nullptr, &vecViewerRight );
+
+	//Invert it so it points down instead of up. This allows chrome to match the in-game look.
+	g_pStudioMdlRenderer->SetViewerRight( -vecViewerRight );
+
+	const unsigned int uiOldPolys = g_pStudioMdlRenderer->GetDrawnPolygonsCount();
+
+	auto pEntity = pHLMV->GetState()->GetEntity();
+
+	if( pEntity )
+	{
+		// setup stencil buffer and draw mirror
+		if( pHLMV->GetState()->mirror )
+		{
+			PROFILE_SCOPE( "Mirror" );
+			const renderer::CScopedGPUTimer gpuTimer( *g_pRenderContext, "GPU mirror" );
+			graphics::helpers::DrawMirroredModel( pEntity, pHLMV->GetState()->renderMode,
+												  pHLMV->GetState()->wireframeOverlay, 
+												  pHLMV->GetSettings()->GetFloorLength(),
+												  pHLMV->GetState()->backfaceCulling );
+		}
+	}
+
+	graphics::helpers::SetupRenderMode( pHLMV->GetState()->renderMode, pHLMV->GetState()->backfaceCulling );
+
+	if( pEntity )
+	{
+		const glm::vec3& vecScale = pEntity->GetScale();
+
+		//Determine if an odd number of scale values are negative. The cull face has to be changed if so.
+		const float flScale = vecScale.x * vecScale.y * vecScale.z;
+
+		glCullFace( flScale > 0 ? GL_FRONT : GL_BACK );
+
+		renderer::DrawFlags_t flags = renderer::DrawFlag::NONE;
+
+		//Draw wireframe overlay
+		if( pHLMV->GetState()->wireframeOverlay )
+		{
+			flags |= renderer::DrawFlag::WIREFRAME_OVERLAY;
+		}
+
+		if( pHLMV->GetState()->UsingWeaponOrigin() )
+		{
+			flags |= renderer::DrawFlag::IS_VIEW_MODEL;
+		}
+
+		const renderer::CScopedGPUTimer gpuTimer( *g_pRenderContext, "GPU model" );
+
+		g_pStudioMdlRenderer->BeginRenderQueue();
+
+		pEntity->Draw( flags );
+
+		g_pStudioMdlRenderer->FlushRenderQueue();
+	}
+
+	if( pHLMV->GetEntityStress().GetCount() > 0 )
+	{
+		PROFILE_SCOPE( "Stress entities" );
+		const renderer::CScopedGPUTimer gpuTimer( *g_pRenderContext, "GPU stress entities" );
+
+		glCullFace( GL_FRONT );
+
+		g_pStudioMdlRenderer->BeginRenderQueue();
+
+		pHLMV->GetEntityStress().Draw( renderer::DrawFlag::NONE );
+
+		g_pStudioMdlRenderer->FlushRenderQueue();
+	}
+
+	//
+	// draw ground
+	//
+
+	if( pHLMV->GetState()->showGround )
+	{
+		PROFILE_SCOPE( "Ground" );
+		const renderer::CScopedGPUTimer gpuTimer( *g_pRenderContext, "GPU ground" );
+		graphics::helpers::DrawFloor( pHLMV->GetSettings()->GetFloorLength(), groundTexture, pHLMV->GetSettings()->GetGroundColor(), pHLMV->GetState()->mirror );
+	}
+
+	pHLMV->GetState()->drawnPolys = g_pStudioMdlRenderer->GetDrawnPolygonsCount() - uiOldPolys;
+
+	glPopMatrix();
+}
+
+GLRenderTarget* BindSceneTarget( const char* const pszCaller, const int iWidth, const int iHeight )
+{
+	if( iWidth <= 0 || iHeight <= 0 )
+	{
+		Error( "%s: Invalid image size %dx%d\n", pszCaller, iWidth, iHeight );
+		return nullptr;
+	}
+
+	GLint iMaxSize;
+
+	glGetIntegerv( GL_MAX_RENDERBUFFER_SIZE, &iMaxSize );
+
+	if( iWidth > iMaxSize || iHeight > iMaxSize )
+	{
+		Error( "%s: Image size %dx%d is larger than the maximum of %dx%d\n", pszCaller, iWidth, iHeight, iMaxSize, iMaxSize );
+		return nullptr;
+	}
+
+	GLRenderTarget* const pTarget = wxOpenGL().GetScratchTarget();
+
+	if( !pTarget )
+	{
+		Error( "%s: Unable to create a render target\n", pszCaller );
+		return nullptr;
+	}
+
+	pTarget->Bind();
+
+	pTarget->Setup( iWidth, iHeight, true );
+
+	const GLenum completeness = pTarget->GetStatus();
+
+	if( completeness != GL_FRAMEBUFFER_COMPLETE )
+	{
+		Error( "%s: Framebuffer is incomplete: %s (status code %d)\n", pszCaller, glFrameBufferStatusToString( completeness ), completeness );
+
+		pTarget->Unbind();
+
+		return nullptr;
+	}
+
+	glViewport( 0, 0, iWidth, iHeight );
+
+	return pTarget;
+}
+
+bool RenderModelSceneToImage( CModelViewerApp* pHLMV, const int iWidth, const int iHeight,
+							  const GLuint backgroundTexture, const GLuint groundTexture, wxImage& image )
+{
+	GLRenderTarget* const pTarget = BindSceneTarget( "RenderModelSceneToImage", iWidth, iHeight );
+
+	if( !pTarget )
+		return false;
+
+	const Color& backgroundColor = pHLMV->GetSettings()->GetBackgroundColor();
+
+	glClearColor( backgroundColor.GetRed() / 255.0f, backgroundColor.GetGreen() / 255.0f, backgroundColor.GetBlue() / 255.0f, 1.0 );
+
+	glClearStencil( 0 );
+
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+
+	DrawModelScene( pHLMV, iWidth, iHeight, backgroundTexture, groundTexture );
+
+	pTarget->FinishDraw();
+
+	image.Create( iWidth, iHeight, false );
+
+	GLint oldReadBuffer;
+	GLint oldPackAlignment;
+
+	glGetIntegerv( GL_READ_BUFFER, &oldReadBuffer );
+	glGetIntegerv( GL_PACK_ALIGNMENT, &oldPackAlignment );
+
+	glReadBuffer( GL_COLOR_ATTACHMENT0 );
+
+	//Set pack alignment to 1 so no padding is added
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+
+	pTarget->GetPixels( iWidth, iHeight, GL_RGB, GL_UNSIGNED_BYTE, image.GetData() );
+
+	glPixelStorei( GL_PACK_ALIGNMENT, oldPackAlignment );
+
+	pTarget->Unbind();
+
+	glReadBuffer( oldReadBuffer );
+
+	//We have to flip the image vertically, since OpenGL reads it upside down.
+	graphics::FlipImageVertically( iWidth, iHeight, image.GetData() );
+
+	return true;
+}
+}
@@ -0,0 +1,78 @@
+#ifndef HLMV_UI_MODELSCENE_H
+#define HLMV_UI_MODELSCENE_H
+
+#include "wxHLMV.h"
+
+#include <glm/mat4x4.hpp>
+
+#include "graphics/OpenGL.h"
+
+class GLRenderTarget;
+
+namespace graphics
+{
+class CCamera;
+}
+
+namespace hlmv
+{
+class CHLMVState;
+class CModelViewerApp;
+
+/**
+*	@return The view matrix of the given camera.
+*/
+glm::mat4x4 GetSceneViewMatrix( const graphics::CCamera& camera );
+
+/**
+*	@return The view matrix of the state's current camera.
+*/
+glm::mat4x4 GetSceneViewMatrix( const CHLMVState& state );
+
+/**
+*	Applies the given camera to the modelview matrix.
+*/
+void ApplyCameraToScene( const graphics::CCamera& camera );
+
+/**
+*	Applies the state's current camera to the modelview matrix.
+*/
+void ApplyCameraToScene( const CHLMVState& state );
+
+/**
+*	Draws the model scene the way the 3D view shows it: background, axes, mirrored model, model and ground.
+*	Draws into whatever framebuffer is bound; the viewport must already be set and the buffers cleared.
+*	@param pHLMV Model viewer whose state and settings are drawn.
+*	@param iWidth Width of the viewport, in pixels.
+*	@param iHeight Height of the viewport, in pixels.
+*	@param backgroundTexture Background texture, or GL_INVALID_TEXTURE_ID.
+*	@param groundTexture Ground texture, or GL_INVALID_TEXTURE_ID.
+*	@param pCamera Camera to draw from, or null to use the state's current camera.
+*/
+void DrawModelScene( CModelViewerApp* pHLMV, const int iWidth, const int iHeight, const GLuint backgroundTexture, const GLuint groundTexture,
+					 const graphics::CCamera* pCamera = nullptr );
+
+/**
+*	Binds the scratch render target, sets it up with the given size and sets the viewport to it.
+*	The context must be current.
+*	@param pszCaller Name of the caller, used in error messages.
+*	@return The bound target, or null if it couldn't be set up. Nothing is left bound on failure.
+*/
+GLRenderTarget* BindSceneTarget( const char* const pszCaller, const int iWidth, const int iHeight );
+
+/**
+*	Draws the model scene into an offscreen render target and reads it back. Does not need a visible 3D view.
+*	The context must be current.
+*	@param pHLMV Model viewer whose state and settings are drawn.
+*	@param iWidth Width of the image, in pixels.
+*	@param iHeight Height of the image, in pixels.
+*	@param backgroundTexture Background texture, or GL_INVALID_TEXTURE_ID.
+*	@param groundTexture Ground texture, or GL_INVALID_TEXTURE_ID.
+*	@param image Image that receives the result.
+*	@return Whether the scene was drawn.
+*/
+bool RenderModelSceneToImage( CModelViewerApp* pHLMV, const int iWidth, const int iHeight,
+							  const GLuint backgroundTexture, const GLuint groundTexture, wxImage& image );
+}
+
+#endif //HLMV_UI_MODELSCENE_H
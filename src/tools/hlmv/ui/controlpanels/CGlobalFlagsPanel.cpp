@@ -136,7 +136,7 @@ void CGlobalFlagsPanel::CheckBoxChanged( wxCommandEvent& event )
 {
 	wxCheckBox* const pCheckBox = static_cast<wxCheckBox*>( event.GetEventObject() );
 
-	const CheckBox::Type checkbox = static_cast<CheckBox::Type>( reinterpret_cast<int>( pCheckBox->GetClientData() ) );
+	const CheckBox::Type checkbox = static_cast<CheckBox::Type>( reinterpret_cast<size_t>( pCheckBox->GetClientData() ) );
 
 	if( checkbox < CheckBox::FIRST || checkbox > CheckBox::LAST )
 		return;
@@ -14,6 +14,11 @@
 
 namespace hlmv
 {
+namespace
+{
+static cvar::CCVarHandle g_ShowStudioNormals( "r_showstudionormals" );
+}
+
 wxBEGIN_EVENT_TABLE( CModelDisplayPanel, CBaseControlPanel )
 	EVT_CHOICE( wxID_MDLDISP_RENDERMODE, CModelDisplayPanel::RenderModeChanged )
 	EVT_SLIDER( wxID_MDLDISP_OPACITY, CModelDisplayPanel::OpacityChanged )
@@ -301,7 +306,7 @@ void CModelDisplayPanel::InternalSetCheckBox( const CheckBox::Type checkBox, con
 
 	case CheckBox::NORMALS:
 		{
-			g_pCVar->SetCVarFloat( "r_showstudionormals", bValue ? 1 : 0 );
+			g_ShowStudioNormals.SetBool( bValue );
 			break;
 		}
 
@@ -328,7 +333,7 @@ void CModelDisplayPanel::CheckBoxChanged( wxCommandEvent& event )
 {
 	wxCheckBox* const pCheckBox = static_cast<wxCheckBox*>( event.GetEventObject() );
 
-	const CheckBox::Type checkbox = static_cast<CheckBox::Type>( reinterpret_cast<int>( pCheckBox->GetClientData() ) );
+	const CheckBox::Type checkbox = static_cast<CheckBox::Type>( reinterpret_cast<size_t>( pCheckBox->GetClientData() ) );
 
 	if( checkbox < CheckBox::FIRST || checkbox > CheckBox::LAST )
 		return;
@@ -19,6 +19,11 @@
 
 namespace hlmv
 {
+namespace
+{
+static cvar::CCVarHandle g_PitchFramerate( "s_ent_pitchframerate" );
+}
+
 wxBEGIN_EVENT_TABLE( CSequencesPanel, CBaseControlPanel )
 	EVT_CHOICE( wxID_SEQUENCE_SEQCHANGED, CSequencesPanel::SequenceChanged )
 	EVT_TOGGLEBUTTON( wxID_SEQUENCE_TOGGLEPLAY, CSequencesPanel::TogglePlay )
@@ -197,6 +202,39 @@ CSequencesPanel::~CSequencesPanel()
 	g_pCVar->RemoveGlobalCVarHandler( this );
 }
 
+void CSequencesPanel::ViewPreUpdate()
+{
+	auto pEntity = m_pHLMV->GetState()->GetEntity();
+
+	//Only paused sequences are baked, playback rarely lands on whole frames.
+	if( !pEntity || !pEntity->GetModel() || m_pHLMV->GetState()->playSequence )
+	{
+		m_PoseTrackBaker.Clear();
+
+		if( pEntity )
+			pEntity->SetPoseTrack( nullptr );
+
+		return;
+	}
+
+	studiomdl::CModelRenderInfo renderInfo;
+
+	pEntity->GetRenderInfo( renderInfo );
+
+	//Blenders, controllers or the model's pose data changed, so the track is out of date.
+	auto track = m_PoseTrackBaker.GetTrack();
+
+	if( track && track->Matches( renderInfo ) )
+	{
+		if( pEntity->GetPoseTrack() != track )
+			pEntity->SetPoseTrack( track );
+	}
+	else
+	{
+		m_PoseTrackBaker.Request( pEntity->GetModelPtr(), renderInfo );
+	}
+}
+
 void CSequencesPanel::Draw3D( const wxSize& size )
 {
 	const int x = size.GetX() / 2;
@@ -646,6 +684,9 @@ void CSequencesPanel::OnEditEvents( wxCommandEvent& event )
 	//Note: if the user clicks on apply and then cancel, we should still update our state.
 	dlg.ShowModal();
 
+	//Event frames may have changed.
+	pModel->BuildEventIndex();
+
 	//Current event may have been updated.
 	UpdateEventInfo( m_pEvent->GetSelection() );
 
@@ -660,7 +701,7 @@ void CSequencesPanel::PlaySoundChanged( wxCommandEvent& event )
 
 void CSequencesPanel::PitchFramerateChanged( wxCommandEvent& event )
 {
-	g_pCVar->SetCVarFloat( "s_ent_pitchframerate", m_pPitchFramerate->GetValue() ? 1 : 0 );
+	g_PitchFramerate.SetBool( m_pPitchFramerate->GetValue() );
 }
 
 void CSequencesPanel::OnOriginChanged( wxSpinDoubleEvent& event )
@@ -3,6 +3,8 @@
 
 #include "cvar/CCVar.h"
 
+#include "shared/studiomodel/CBakedPoseTrack.h"
+
 #include "CBaseControlPanel.h"
 
 class wxToggleButton;
@@ -35,6 +37,8 @@ public:
 	CSequencesPanel( wxWindow* pParent, CModelViewerApp* const pHLMV );
 	~CSequencesPanel();
 
+	void ViewPreUpdate() override;
+
 	void Draw3D( const wxSize& size ) override;
 
 	void InitializeUI() override;
@@ -120,6 +124,11 @@ private:
 	wxCheckBox* m_pShowCrosshair;
 	wxCheckBox* m_pShowGuidelines;
 
+	/**
+	*	Bakes the current sequence while it's paused, so stepping through and scrubbing frames doesn't set up bones.
+	*/
+	studiomdl::CPoseTrackBaker m_PoseTrackBaker;
+
 private:
 	CSequencesPanel( const CSequencesPanel& ) = delete;
 	CSequencesPanel& operator=( const CSequencesPanel& ) = delete;
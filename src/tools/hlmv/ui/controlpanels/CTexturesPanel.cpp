@@ -1,16 +1,24 @@
+#include <algorithm>
 #include <new>
 #include <memory>
 
+#include <wx/filename.h>
 #include <wx/gbsizer.h>
 #include <wx/image.h>
 
 #include "ui/wx/utility/wxUtil.h"
 
+#include "shared/Logging.h"
+
+#include "cvar/CCVar.h"
+
+#include "graphics/ColorQuantization.h"
+#include "graphics/CPaletteMapper.h"
 #include "graphics/GraphicsHelpers.h"
 #include "graphics/Palette.h"
-#include "graphics/BMPFile.h"
 
 #include "shared/studiomodel/CStudioModel.h"
+#include "shared/studiomodel/StudioModelTextureExport.h"
 
 #include "../CModelViewerApp.h"
 #include "../../CHLMVState.h"
@@ -19,6 +27,110 @@
 
 namespace hlmv
 {
+static cvar::CCVar tex_importdither( "tex_importdither",
+	cvar::CCVarArgsBuilder()
+	.Flags( cvar::Flag::ARCHIVE )
+	.FloatValue( 1 )
+	.HelpInfo( "If non-zero, images that are imported as textures are dithered when they're reduced to 256 colors" ) );
+
+namespace
+{
+/**
+*	Converts an image to 8 bit. Paletted images keep their palette, all other images are reduced to 256 colors with median cut.
+*	@param image Image to convert. Must have the size of the texture.
+*	@param bMasked Whether the texture is masked. Transparent pixels are then mapped to the last palette entry,
+*		and the remaining colors are reduced to 255.
+*	@param pOutPixels Palette indices. Must be width * height bytes.
+*	@param pOutPalette Palette. Must be PALETTE_SIZE bytes.
+*/
+void ConvertImageToIndexed( const wxImage& image, const bool bMasked, byte* const pOutPixels, byte* const pOutPalette )
+{
+	const int iWidth = image.GetWidth();
+	const int iHeight = image.GetHeight();
+	const size_t uiCount = static_cast<size_t>( iWidth ) * iHeight;
+
+	memset( pOutPalette, 0, PALETTE_SIZE );
+
+	const wxPalette& palette = image.GetPalette();
+
+	if( palette.IsOk() )
+	{
+		unsigned char r, g, b;
+
+		for( size_t uiIndex = 0; uiIndex < PALETTE_ENTRIES; ++uiIndex )
+		{
+			if( palette.GetRGB( uiIndex, &r, &g, &b ) )
+			{
+				pOutPalette[ uiIndex * PALETTE_CHANNELS ] = r;
+				pOutPalette[ uiIndex * PALETTE_CHANNELS + 1 ] = g;
+				pOutPalette[ uiIndex * PALETTE_CHANNELS + 2 ] = b;
+			}
+		}
+
+		//wxPalette::GetPixel searches the whole palette for every pixel, the mapper looks colors up in tables instead.
+		const size_t uiNumColors = std::min<size_t>( std::max( palette.GetColoursCount(), 1 ), PALETTE_ENTRIES );
+
+		auto mapper = std::make_unique<graphics::CPaletteMapper>( pOutPalette, uiNumColors );
+
+		mapper->MapImage( image.GetData(), iWidth, iHeight, pOutPixels );
+
+		return;
+	}
+
+	//Transparent pixels are either in the alpha channel or have the mask color.
+	std::unique_ptr<byte[]> alpha;
+
+	if( bMasked && ( image.HasAlpha() || image.HasMask() ) )
+	{
+		alpha = std::make_unique<byte[]>( uiCount );
+
+		if( image.HasAlpha() )
+		{
+			memcpy( alpha.get(), image.GetAlpha(), uiCount );
+		}
+		else
+		{
+			const unsigned char* pRGB = image.GetData();
+
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex, pRGB += 3 )
+			{
+				const bool bIsMask = pRGB[ 0 ] == image.GetMaskRed() && pRGB[ 1 ] == image.GetMaskGreen() && pRGB[ 2 ] == image.GetMaskBlue();
+
+				alpha[ uiIndex ] = bIsMask ? 0 : 255;
+			}
+		}
+	}
+
+	const size_t uiMaxColors = bMasked ? PALETTE_ENTRIES - 1 : PALETTE_ENTRIES;
+
+	const size_t uiNumColors = std::max<size_t>( graphics::BuildMedianCutPalette( image.GetData(), uiCount, uiMaxColors, pOutPalette, alpha.get() ), 1 );
+
+	auto mapper = std::make_unique<graphics::CPaletteMapper>( pOutPalette, uiNumColors );
+
+	if( tex_importdither.GetBool() )
+		graphics::DitherImage( *mapper, pOutPalette, image.GetData(), iWidth, iHeight, pOutPixels );
+	else
+		mapper->MapImage( image.GetData(), iWidth, iHeight, pOutPixels );
+
+	if( bMasked )
+	{
+		//The engine draws the last entry as transparent, blue is the convention for it.
+		pOutPalette[ PALETTE_ALPHA_INDEX ] = 0;
+		pOutPalette[ PALETTE_ALPHA_INDEX + 1 ] = 0;
+		pOutPalette[ PALETTE_ALPHA_INDEX + 2 ] = 255;
+
+		if( alpha )
+		{
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+			{
+				if( alpha[ uiIndex ] < 128 )
+					pOutPixels[ uiIndex ] = static_cast<byte>( PALETTE_ENTRIES - 1 );
+			}
+		}
+	}
+}
+}
+
 wxBEGIN_EVENT_TABLE( CTexturesPanel, CBaseControlPanel )
 	EVT_CHOICE( wxID_TEX_CHANGED, CTexturesPanel::TextureChanged )
 	EVT_SLIDER( wxID_TEX_SCALE, CTexturesPanel::ScaleChanged )
@@ -205,20 +317,22 @@ void CTexturesPanel::SetTexture( int iIndex )
 	m_pCheckBoxes[ CheckBox::TRANSPARENT ]->SetValue( ( texture.flags & STUDIO_NF_MASKED ) != 0 );
 	m_pCheckBoxes[ CheckBox::FULLBRIGHT ]->SetValue( ( texture.flags & STUDIO_NF_FULLBRIGHT ) != 0 );
 
-	const CStudioModelEntity::MeshList_t meshes = pEntity->ComputeMeshList( iIndex );
+	size_t uiMeshCount;
+
+	const mstudiomesh_t* const* ppMeshes = pEntity->GetModel()->GetTextureMeshes( iIndex, uiMeshCount );
 
 	m_pMesh->Enable( true );
 
 	size_t uiIndex;
 
-	for( uiIndex = 0; uiIndex < meshes.size(); ++uiIndex )
+	for( uiIndex = 0; uiIndex < uiMeshCount; ++uiIndex )
 	{
-		m_pMesh->Append( wxString::Format( "Mesh %u", uiIndex + 1 ), new ui::CMeshClientData( meshes[ uiIndex ] ) );
+		m_pMesh->Append( wxString::Format( "Mesh %u", uiIndex + 1 ), new ui::CMeshClientData( ppMeshes[ uiIndex ] ) );
 	}
 
 	if( uiIndex > 0 )
 	{
-		m_pHLMV->GetState()->pUVMesh = meshes[ 0 ];
+		m_pHLMV->GetState()->pUVMesh = ppMeshes[ 0 ];
 
 		if( uiIndex > 1 )
 		{
@@ -276,7 +390,7 @@ void CTexturesPanel::CheckBoxChanged( wxCommandEvent& event )
 
 	wxCheckBox* const pCheckBox = static_cast<wxCheckBox*>( event.GetEventObject() );
 
-	const CheckBox::Type checkbox = static_cast<CheckBox::Type>( reinterpret_cast<int>( pCheckBox->GetClientData() ) );
+	const CheckBox::Type checkbox = static_cast<CheckBox::Type>( reinterpret_cast<size_t>( pCheckBox->GetClientData() ) );
 
 	if( checkbox < CheckBox::FIRST || checkbox > CheckBox::LAST )
 		return;
@@ -394,6 +508,9 @@ void CTexturesPanel::CheckBoxChanged( wxCommandEvent& event )
 	case CheckBox::TRANSPARENT:
 	case CheckBox::FULLBRIGHT:
 		{
+			//Draw lists store texture flags.
+			pModel->BuildDrawLists();
+
 			m_pHLMV->GetState()->modelChanged = true;
 
 			break;
@@ -436,15 +553,16 @@ void CTexturesPanel::ImportTexture( wxCommandEvent& event )
 		return;
 	}
 
-	wxFileDialog dlg( this, wxFileSelectorPromptStr, wxEmptyString, wxEmptyString, "Windows Bitmap (*.bmp)|*.bmp" );
+	wxFileDialog dlg( this, wxFileSelectorPromptStr, wxEmptyString, wxEmptyString,
+					  "Images (*.bmp;*.png;*.tga;*.jpg;*.jpeg;*.pcx;*.gif;*.tif;*.tiff)|*.bmp;*.png;*.tga;*.jpg;*.jpeg;*.pcx;*.gif;*.tif;*.tiff|"
+					  "Windows Bitmap (*.bmp)|*.bmp|All files (*.*)|*.*" );
 
 	if( dlg.ShowModal() == wxID_CANCEL )
 		return;
 
 	const wxString szFilename = dlg.GetPath();
 
-	//Must be BMP
-	wxImage image( szFilename, wxBITMAP_TYPE_BMP );
+	wxImage image( szFilename, wxBITMAP_TYPE_ANY );
 
 	if( !image.IsOk() )
 	{
@@ -452,54 +570,28 @@ void CTexturesPanel::ImportTexture( wxCommandEvent& event )
 		return;
 	}
 
-	const wxPalette& palette = image.GetPalette();
-
-	if( !palette.IsOk() )
-	{
-		wxMessageBox( wxString::Format( "Palette for image \"%s\" does not exist!", szFilename.c_str() ) );
-		return;
-	}
-
 	studiohdr_t* const pHdr = pStudioModel->GetTextureHeader();
 
 	mstudiotexture_t& texture = ( ( mstudiotexture_t* ) ( ( byte* ) pHdr + pHdr->textureindex ) )[ iTextureIndex ];
 
 	if( texture.width != image.GetWidth() || texture.height != image.GetHeight() )
 	{
-		wxMessageBox( wxString::Format( "Image \"%s\" does not have matching dimensions to the current texture (src: %d x %d, dest: %d x %d)",
-										szFilename.c_str(),
-										image.GetWidth(), image.GetHeight(),
-										texture.width, texture.height ) );
-		return;
+		Message( "Resizing image \"%s\" from %d x %d to %d x %d\n",
+				 szFilename.c_str().AsChar(), image.GetWidth(), image.GetHeight(), texture.width, texture.height );
+
+		//Resampling blends colors, so the image's palette no longer applies after this.
+		image.Rescale( texture.width, texture.height, wxIMAGE_QUALITY_HIGH );
 	}
 
 	//Convert to 8 bit palette based image.
 	std::unique_ptr<byte[]> texData = std::make_unique<byte[]>( image.GetWidth() * image.GetHeight() );
 
-	byte* pDest = texData.get();
-
-	const unsigned char* pSourceData = image.GetData();
-
-	for( int i = 0; i < image.GetWidth() * image.GetHeight(); ++i, ++pDest, pSourceData += 3 )
-	{
-		*pDest = palette.GetPixel( pSourceData[ 0 ], pSourceData[ 1 ], pSourceData[ 2 ] );
-	}
-
 	byte convPal[ PALETTE_SIZE ];
 
-	memset( convPal, 0, sizeof( convPal ) );
+	ConvertImageToIndexed( image, ( texture.flags & STUDIO_NF_MASKED ) != 0, texData.get(), convPal );
 
-	unsigned char r, g, b;
-
-	for( size_t uiIndex = 0; uiIndex < PALETTE_ENTRIES; ++uiIndex )
-	{
-		if( palette.GetRGB( uiIndex, &r, &g, &b ) )
-		{
-			convPal[ uiIndex * PALETTE_CHANNELS ] = r;
-			convPal[ uiIndex * PALETTE_CHANNELS + 1 ] = g;
-			convPal[ uiIndex * PALETTE_CHANNELS + 2 ] = b;
-		}
-	}
+	//Compacted pixels have to be restored first, or they'd be read back in over the new image.
+	pStudioModel->EnsureTexturePixels();
 
 	//Copy over the new image data to the texture.
 	memcpy( ( byte* ) pHdr + texture.index, texData.get(), image.GetWidth() * image.GetHeight() );
@@ -530,18 +622,17 @@ void CTexturesPanel::ExportTexture( wxCommandEvent& event )
 		return;
 	}
 
-	wxFileDialog dlg( this, wxFileSelectorPromptStr, wxEmptyString, wxEmptyString, "Windows Bitmap (*.bmp)|*.bmp", wxFD_SAVE | wxFD_OVERWRITE_PROMPT );
+	wxFileDialog dlg( this, wxFileSelectorPromptStr, wxEmptyString, wxEmptyString, "Windows Bitmap (*.bmp)|*.bmp|PNG files (*.png)|*.png", wxFD_SAVE | wxFD_OVERWRITE_PROMPT );
 
 	if( dlg.ShowModal() == wxID_CANCEL )
 		return;
 
 	const wxString szFilename = dlg.GetPath();
 
-	studiohdr_t* const pHdr = pStudioModel->GetTextureHeader();
-
-	mstudiotexture_t& texture = ( ( mstudiotexture_t* ) ( ( byte* ) pHdr + pHdr->textureindex ) )[ iTextureIndex ];
+	const auto format = wxFileName( szFilename ).GetExt().Lower() == "png" ? studiomdl::ImageFormat::PNG : studiomdl::ImageFormat::BMP;
 
-	if( !graphics::bmpfile::SaveBMPFile( szFilename.c_str(), texture.width, texture.height, ( uint8_t* ) pHdr + texture.index, ( uint8_t* ) pHdr + texture.index + texture.width * texture.height ) )
+	if( !pStudioModel->EnsureTexturePixels() || 
+		!studiomdl::ExportStudioTexture( *pStudioModel->GetTextureHeader(), iTextureIndex, format, szFilename.c_str() ) )
 	{
 		wxMessageBox( wxString::Format( "Failed to save image \"%s\"!", szFilename.c_str() ) );
 	}
@@ -567,7 +658,7 @@ void CTexturesPanel::ExportUVMap( wxCommandEvent& event )
 		return;
 	}
 
-	wxFileDialog dlg( this, wxFileSelectorPromptStr, wxEmptyString, wxEmptyString, "Windows Bitmap (*.bmp)|*.bmp", wxFD_SAVE | wxFD_OVERWRITE_PROMPT );
+	wxFileDialog dlg( this, wxFileSelectorPromptStr, wxEmptyString, wxEmptyString, "Windows Bitmap (*.bmp)|*.bmp|PNG files (*.png)|*.png", wxFD_SAVE | wxFD_OVERWRITE_PROMPT );
 
 	if( dlg.ShowModal() == wxID_CANCEL )
 		return;
@@ -16,6 +16,13 @@
 
 namespace hlmv
 {
+namespace
+{
+static cvar::CCVarHandle g_PowerOf2Textures( "r_powerof2textures" );
+
+static cvar::CCVarHandle g_MaxFPS( "max_fps" );
+}
+
 wxBEGIN_EVENT_TABLE( CGeneralOptions, wxPanel )
 	EVT_BUTTON( wxID_OPTIONS_GENERAL_DEFAULT_GROUND_COLOR, CGeneralOptions::SetDefaultColor )
 	EVT_BUTTON( wxID_OPTIONS_GENERAL_DEFAULT_BACKGROUND_COLOR, CGeneralOptions::SetDefaultColor )
@@ -118,9 +125,7 @@ CGeneralOptions::~CGeneralOptions()
 
 void CGeneralOptions::Save()
 {
-	auto pPowerOf2 = static_cast<cvar::CCVar*>( g_pCVar->FindCommand( "r_powerof2textures") );
-
-	pPowerOf2->SetBool( m_pPowerOf2Textures ->GetValue() );
+	g_PowerOf2Textures.SetBool( m_pPowerOf2Textures->GetValue() );
 
 	m_pSettings->SetGroundColor( wx::wxToColor( m_pGroundColor->GetColour() ) );
 	m_pSettings->SetBackgroundColor( wx::wxToColor( m_pBackgroundColor->GetColour() ) );
@@ -148,15 +153,13 @@ void CGeneralOptions::Save()
 		pLightingB->SetInt( color.GetBlue() );
 	}
 
-	g_pCVar->SetCVarFloat( "max_fps", m_pFPS->GetValue() );
+	g_MaxFPS.SetFloat( m_pFPS->GetValue() );
 	m_pSettings->SetFloorLength( m_pFloorLength->GetValue() );
 }
 
 void CGeneralOptions::Initialize()
 {
-	auto pPowerOf2 = static_cast< cvar::CCVar* >( g_pCVar->FindCommand( "r_powerof2textures" ) );
-
-	m_pPowerOf2Textures->SetValue( pPowerOf2->GetBool() );
+	m_pPowerOf2Textures->SetValue( g_PowerOf2Textures.GetBool() );
 
 	m_pGroundColor->SetColour( wx::ColorTowx( m_pSettings->GetGroundColor() ) );
 	m_pBackgroundColor->SetColour( wx::ColorTowx( m_pSettings->GetBackgroundColor() ) );
@@ -176,7 +179,7 @@ void CGeneralOptions::Initialize()
 		m_pWireframeColor->SetColour( wx::ColorTowx( Color( pLightingR->GetInt(), pLightingG->GetInt(), pLightingB->GetInt() ) ) );
 	}
 
-	m_pFPS->SetValue( g_pCVar->GetCVarFloat( "max_fps" ) );
+	m_pFPS->SetValue( g_MaxFPS.GetFloat() );
 	m_pFloorLength->SetValue( m_pSettings->GetFloorLength() );
 }
 
@@ -62,6 +62,8 @@ void COptionsDialog::OnButton( wxCommandEvent& event )
 
 			//Copy over the settings to the actual settings object.
 			*m_pSettings = *m_EditableSettings;
+
+			m_pSettings->MarkChanged();
 			break;
 		}
 
@@ -10,6 +10,7 @@ enum wxIdentifier
 	//Main window
 	//File menu
 	wxID_MAINWND_LOADMODEL,
+	wxID_MAINWND_RELOADMODEL,
 	wxID_MAINWND_LOADBACKGROUND,
 	wxID_MAINWND_LOADGROUND,
 	wxID_MAINWND_UNLOADGROUND,
@@ -20,7 +21,9 @@ enum wxIdentifier
 	wxID_MAINWND_SAVEVIEW,
 	wxID_MAINWND_RESTOREVIEW,
 	wxID_MAINWND_TAKESCREENSHOT,
+	wxID_MAINWND_CAPTURESEQUENCE,
 	wxID_MAINWND_DUMPMODELINFO,
+	wxID_MAINWND_MODELSTATS,
 
 	//Tools menu
 	wxID_MAINWND_TOGGLEMESSAGES,
@@ -105,5 +108,6 @@ enum wxIdentifier
 #define HLMV_TITLE "Half-Life Model Viewer"
 #define HLMV_SETTINGS_FILE "HLMVSettings.txt"
 #define HLMV_DUMP_MODEL_INFO_FILE "midump.txt"
+#define HLMV_MODEL_STATS_FILE "mistats.txt"
 
 #endif //HLMV_UI_WXHLMV_H
\ No newline at end of file
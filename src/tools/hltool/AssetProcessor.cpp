@@ -0,0 +1,667 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "shared/Logging.h"
+
+#include "graphics/BMPFile.h"
+#include "graphics/DDSFile.h"
+#include "graphics/Palette.h"
+#include "graphics/PaletteConversion.h"
+#include "graphics/PNGFile.h"
+
+#include "shared/TaskScheduler.h"
+
+#include "shared/sprite/CSprite.h"
+#include "shared/studiomodel/CStudioModel.h"
+#include "shared/studiomodel/StudioModelDecompiler.h"
+#include "shared/studiomodel/StudioModelStats.h"
+#include "shared/studiomodel/StudioModelValidation.h"
+
+#include "AssetProcessor.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace hltool
+{
+namespace
+{
+enum class ProcessResult
+{
+	SUCCEEDED = 0,
+	FAILED,
+	SKIPPED
+};
+
+/**
+*	Deletes models loaded with studiomdl::LoadStudioModelFiles.
+*/
+struct StudioModelDeleter final
+{
+	void operator()( studiomdl::CStudioModel* pModel ) const
+	{
+		delete pModel;
+	}
+};
+
+/**
+*	Frees sprites loaded with sprite::LoadSpriteFiles.
+*/
+struct SpriteDeleter final
+{
+	void operator()( sprite::msprite_t* pSprite ) const
+	{
+		sprite::FreeSprite( pSprite );
+	}
+};
+
+bool GetAssetType( const fs::path& path, AssetType& type )
+{
+	std::string szExtension = path.extension().string();
+
+	std::transform( szExtension.begin(), szExtension.end(), szExtension.begin(), ::tolower );
+
+	if( szExtension == ".mdl" || szExtension == ".dol" )
+	{
+		type = AssetType::MODEL;
+		return true;
+	}
+
+	if( szExtension == ".spr" )
+	{
+		type = AssetType::SPRITE;
+		return true;
+	}
+
+	return false;
+}
+
+bool IsDirectlyProcessed( const fs::path& path, const AssetType type )
+{
+	return type != AssetType::MODEL || !studiomdl::IsStudioModelCompanionFile( path.string().c_str() );
+}
+
+bool WriteFile( const char* const pszFilename, const std::string& szContents )
+{
+	FILE* pFile = fopen( pszFilename, "wb" );
+
+	if( !pFile )
+	{
+		Error( "Couldn't open \"%s\" for writing\n", pszFilename );
+		return false;
+	}
+
+	const bool bSuccess = fwrite( szContents.data(), 1, szContents.size(), pFile ) == szContents.size();
+
+	if( fclose( pFile ) != 0 || !bSuccess )
+	{
+		Error( "Couldn't write \"%s\"\n", pszFilename );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*	Gets the path that output for an asset is written to, and creates its directory.
+*	@param pszExtension If not null, the extension is replaced with this one. Includes the dot.
+*/
+bool GetOutputPath( const Asset_t& asset, const ProcessSettings_t& settings, const char* const pszExtension, fs::path& outputPath )
+{
+	outputPath = fs::path( settings.szOutputDirectory ) / asset.szRelativePath;
+
+	if( pszExtension )
+		outputPath.replace_extension( pszExtension );
+
+	std::error_code error;
+
+	fs::create_directories( outputPath.parent_path(), error );
+
+	if( error )
+	{
+		Error( "Couldn't create directory \"%s\": %s\n", outputPath.parent_path().string().c_str(), error.message().c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*	Dumps the sprite's header in the same layout that models are dumped in.
+*/
+void DumpSprite( const sprite::msprite_t& sprite, const studiomdl::DumpFormat format, std::string& szOutput )
+{
+	char szBuffer[ 512 ];
+
+	switch( format )
+	{
+	default:
+	case studiomdl::DumpFormat::TEXT:
+		{
+			snprintf( szBuffer, sizeof( szBuffer ),
+					  "Type: %s\nTexture format: %s\nFrames: %d\nMax width: %d\nMax height: %d\nBeam length: %g\n",
+					  sprite::TypeToString( sprite.type ), sprite::TexFormatToString( sprite.texFormat ),
+					  sprite.numframes, sprite.maxwidth, sprite.maxheight, sprite.beamlength );
+			break;
+		}
+
+	case studiomdl::DumpFormat::JSON:
+		{
+			snprintf( szBuffer, sizeof( szBuffer ),
+					  "{\n\t\"type\": \"%s\",\n\t\"texFormat\": \"%s\",\n\t\"numframes\": %d,\n\t\"maxwidth\": %d,\n\t\"maxheight\": %d,\n\t\"beamlength\": %g\n}\n",
+					  sprite::TypeToString( sprite.type ), sprite::TexFormatToString( sprite.texFormat ),
+					  sprite.numframes, sprite.maxwidth, sprite.maxheight, sprite.beamlength );
+			break;
+		}
+
+	case studiomdl::DumpFormat::CSV:
+		{
+			snprintf( szBuffer, sizeof( szBuffer ),
+					  "key,value\ntype,%s\ntexFormat,%s\nnumframes,%d\nmaxwidth,%d\nmaxheight,%d\nbeamlength,%g\n",
+					  sprite::TypeToString( sprite.type ), sprite::TexFormatToString( sprite.texFormat ),
+					  sprite.numframes, sprite.maxwidth, sprite.maxheight, sprite.beamlength );
+			break;
+		}
+	}
+
+	szOutput += szBuffer;
+}
+
+/**
+*	Writes or stores the dump of an asset.
+*/
+bool OutputDump( const Asset_t& asset, const ProcessSettings_t& settings, const std::string& szDump, std::string& szOutput )
+{
+	if( settings.szOutputDirectory.empty() )
+	{
+		szOutput = szDump;
+		return true;
+	}
+
+	fs::path outputPath;
+
+	if( !GetOutputPath( asset, settings, ( std::string( "." ) + studiomdl::DumpFormatToExtension( settings.dumpFormat ) ).c_str(), outputPath ) )
+		return false;
+
+	return WriteFile( outputPath.string().c_str(), szDump );
+}
+
+ProcessResult ProcessModel( const Asset_t& asset, const ProcessSettings_t& settings, std::string& szOutput )
+{
+	std::vector<std::string> issues;
+
+	//The loader trusts the headers, so files are always validated before they're loaded.
+	if( !studiomdl::ValidateStudioModelFile( asset.szFilename.c_str(), issues ) )
+	{
+		for( const auto& szIssue : issues )
+		{
+			Error( "%s\n", szIssue.c_str() );
+		}
+
+		return ProcessResult::FAILED;
+	}
+
+	if( settings.operation == Operation::VALIDATE )
+		return ProcessResult::SUCCEEDED;
+
+	studiomdl::CStudioModel* pLoadedModel = nullptr;
+
+	if( studiomdl::LoadStudioModelFiles( asset.szFilename.c_str(), pLoadedModel ) != studiomdl::StudioModelLoadResult::SUCCESS )
+	{
+		Error( "Couldn't load model \"%s\"\n", asset.szFilename.c_str() );
+		return ProcessResult::FAILED;
+	}
+
+	std::unique_ptr<studiomdl::CStudioModel, StudioModelDeleter> model( pLoadedModel );
+
+	if( settings.operation == Operation::INFO )
+	{
+		std::string szDump;
+
+		studiomdl::DumpStudioModel( *model->GetStudioHeader(), *model->GetTextureHeader(), settings.dumpFormat, szDump );
+
+		return OutputDump( asset, settings, szDump, szOutput ) ? ProcessResult::SUCCEEDED : ProcessResult::FAILED;
+	}
+
+	if( settings.operation == Operation::STATS )
+	{
+		studiomdl::StudioModelStats_t stats;
+
+		studiomdl::ComputeStudioModelStats( *model, stats );
+
+		std::string szDump;
+
+		studiomdl::FormatStudioModelStats( stats, settings.dumpFormat, szDump );
+
+		return OutputDump( asset, settings, szDump, szOutput ) ? ProcessResult::SUCCEEDED : ProcessResult::FAILED;
+	}
+
+	if( settings.operation == Operation::TEXTURES )
+	{
+		//Each model gets a directory named after it, textures in different models often have the same name.
+		fs::path outputPath = fs::path( settings.szOutputDirectory ) / asset.szRelativePath;
+
+		outputPath.replace_extension();
+
+		size_t uiExported;
+
+		//Loading converts Dreamcast textures, so the texture header is always in the mdl layout.
+		return studiomdl::ExportStudioModelTextures( *model->GetTextureHeader(), settings.imageFormat, outputPath.string().c_str(), uiExported ) ?
+			ProcessResult::SUCCEEDED : ProcessResult::FAILED;
+	}
+
+	if( settings.operation == Operation::DECOMPILE )
+	{
+		//Like textures, each model gets a directory named after it.
+		fs::path outputPath = fs::path( settings.szOutputDirectory ) / asset.szRelativePath;
+
+		const std::string szModelName = outputPath.stem().string();
+
+		outputPath.replace_extension();
+
+		studiomdl::DecompileResult_t result;
+
+		return studiomdl::DecompileStudioModel( *model, szModelName.c_str(), outputPath.string().c_str(), result ) ?
+			ProcessResult::SUCCEEDED : ProcessResult::FAILED;
+	}
+
+	if( settings.operation == Operation::RESCALE )
+	{
+		if( settings.flMeshScale != 1 )
+			studiomdl::ScaleMeshes( model.get(), settings.flMeshScale );
+
+		if( settings.flBoneScale != 1 )
+			studiomdl::ScaleBones( model.get(), settings.flBoneScale );
+	}
+
+	fs::path outputPath;
+
+	if( !GetOutputPath( asset, settings, nullptr, outputPath ) )
+		return ProcessResult::FAILED;
+
+	//Saving detaches the model from its files, so the output directory can be the input directory.
+	if( !studiomdl::SaveStudioModel( outputPath.string().c_str(), model.get() ) )
+	{
+		Error( "Couldn't save model \"%s\"\n", outputPath.string().c_str() );
+		return ProcessResult::FAILED;
+	}
+
+	return ProcessResult::SUCCEEDED;
+}
+
+/**
+*	@return Whether all frames of the sprite have pixels.
+*/
+bool CheckSpriteFrames( const Asset_t& asset, const sprite::msprite_t& sprite )
+{
+	if( sprite.numframes <= 0 )
+	{
+		Error( "\"%s\": Sprite has no frames\n", asset.szFilename.c_str() );
+		return false;
+	}
+
+	auto checkFrame = [ & ]( const sprite::mspriteframe_t* pFrame, const int iFrame )
+	{
+		if( !pFrame || pFrame->width <= 0 || pFrame->height <= 0 )
+		{
+			Error( "\"%s\": Frame %d is empty\n", asset.szFilename.c_str(), iFrame );
+			return false;
+		}
+
+		return true;
+	};
+
+	bool bValid = true;
+
+	for( int iFrame = 0; iFrame < sprite.numframes; ++iFrame )
+	{
+		const auto pDesc = sprite.GetFrameDescriptor( iFrame );
+
+		if( pDesc->type == sprite::spriteframetype_t::SINGLE )
+		{
+			bValid = checkFrame( pDesc->GetFrame(), iFrame ) && bValid;
+			continue;
+		}
+
+		const auto pGroup = pDesc->GetGroup();
+
+		if( pGroup->numframes <= 0 )
+		{
+			Error( "\"%s\": Frame group %d has no frames\n", asset.szFilename.c_str(), iFrame );
+			bValid = false;
+			continue;
+		}
+
+		for( int iGroupFrame = 0; iGroupFrame < pGroup->numframes; ++iGroupFrame )
+		{
+			bValid = checkFrame( pGroup->GetFrame( iGroupFrame ), iFrame ) && bValid;
+		}
+	}
+
+	return bValid;
+}
+
+/**
+*	Saves a sprite with the sprite settings applied.
+*/
+bool ResaveSprite( const Asset_t& asset, const ProcessSettings_t& settings, const sprite::msprite_t& sprite )
+{
+	fs::path outputPath;
+
+	if( !GetOutputPath( asset, settings, nullptr, outputPath ) )
+		return false;
+
+	const sprite::TexFormat::TexFormat texFormat = settings.spriteTexFormat != sprite::TexFormat::COUNT ? settings.spriteTexFormat : sprite.texFormat;
+
+	//The sprite is loaded into memory, so the output directory can be the input directory.
+	if( !sprite::SaveSprite( outputPath.string().c_str(), &sprite, texFormat, settings.iFirstSpriteFrame, settings.iSpriteFrameCount ) )
+	{
+		Error( "Couldn't save sprite \"%s\"\n", outputPath.string().c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*	Saves a sprite frame as an image. DDS files use the colors and alpha that the frame is drawn with.
+*/
+bool ExportSpriteFrame( const sprite::msprite_t& sprite, const sprite::mspriteframe_t& frame, const byte* pRGBAPalette,
+						const studiomdl::ImageFormat format, const char* const pszFilename )
+{
+	switch( format )
+	{
+	default:
+	case studiomdl::ImageFormat::BMP:
+		return graphics::bmpfile::SaveBMPFile( pszFilename, frame.width, frame.height, frame.pixels, sprite.palette );
+
+	case studiomdl::ImageFormat::PNG:
+		return graphics::pngfile::SavePNGFile( pszFilename, frame.width, frame.height, frame.pixels, sprite.palette,
+											   sprite.texFormat == sprite::TexFormat::SPR_ALPHTEST );
+
+	case studiomdl::ImageFormat::DDS:
+		{
+			const size_t uiPixels = static_cast<size_t>( frame.width ) * frame.height;
+
+			std::vector<byte> pixels( uiPixels * 4 );
+
+			graphics::ExpandIndexedToRGBA( frame.pixels, uiPixels, pRGBAPalette, pixels.data() );
+
+			return graphics::ddsfile::SaveDDSFile( pszFilename, frame.width, frame.height, pixels.data() );
+		}
+	}
+}
+
+/**
+*	Exports every frame of a sprite to a directory named after it. Frames in groups are suffixed with their index in the group.
+*/
+bool ExportSpriteFrames( const Asset_t& asset, const ProcessSettings_t& settings, const sprite::msprite_t& sprite )
+{
+	fs::path outputPath = fs::path( settings.szOutputDirectory ) / asset.szRelativePath;
+
+	outputPath.replace_extension();
+
+	std::error_code error;
+
+	fs::create_directories( outputPath, error );
+
+	if( error )
+	{
+		Error( "Couldn't create directory \"%s\": %s\n", outputPath.string().c_str(), error.message().c_str() );
+		return false;
+	}
+
+	byte rgbaPalette[ PALETTE_ENTRIES * 4 ];
+
+	if( settings.imageFormat == studiomdl::ImageFormat::DDS )
+		sprite::ConvertPaletteToRGBA( sprite.palette, sprite.texFormat, rgbaPalette );
+
+	const std::string szExtension = std::string( "." ) + studiomdl::ImageFormatToExtension( settings.imageFormat );
+
+	bool bSuccess = true;
+
+	auto exportFrame = [ & ]( const sprite::mspriteframe_t* pFrame, std::string&& szName )
+	{
+		const fs::path filename = outputPath / ( szName + szExtension );
+
+		if( !ExportSpriteFrame( sprite, *pFrame, rgbaPalette, settings.imageFormat, filename.string().c_str() ) )
+		{
+			Error( "Couldn't save frame \"%s\"\n", filename.string().c_str() );
+			bSuccess = false;
+		}
+	};
+
+	char szName[ 64 ];
+
+	for( int iFrame = 0; iFrame < sprite.numframes; ++iFrame )
+	{
+		const auto pDesc = sprite.GetFrameDescriptor( iFrame );
+
+		if( pDesc->type == sprite::spriteframetype_t::SINGLE )
+		{
+			snprintf( szName, sizeof( szName ), "frame_%03d", iFrame );
+			exportFrame( pDesc->GetFrame(), szName );
+			continue;
+		}
+
+		const auto pGroup = pDesc->GetGroup();
+
+		for( int iGroupFrame = 0; iGroupFrame < pGroup->numframes; ++iGroupFrame )
+		{
+			snprintf( szName, sizeof( szName ), "frame_%03d_%02d", iFrame, iGroupFrame );
+			exportFrame( pGroup->GetFrame( iGroupFrame ), szName );
+		}
+	}
+
+	return bSuccess;
+}
+
+ProcessResult ProcessSprite( const Asset_t& asset, const ProcessSettings_t& settings, std::string& szOutput )
+{
+	//Sprites can't be scaled, and they have no model statistics or sources to decompile to.
+	if( settings.operation == Operation::RESCALE || settings.operation == Operation::STATS || settings.operation == Operation::DECOMPILE )
+		return ProcessResult::SKIPPED;
+
+	sprite::msprite_t* pLoadedSprite = nullptr;
+
+	//The sprite loader checks that the file is intact, so sprites are validated by loading them.
+	if( !sprite::LoadSpriteFiles( asset.szFilename.c_str(), pLoadedSprite ) )
+	{
+		Error( "Couldn't load sprite \"%s\"\n", asset.szFilename.c_str() );
+		return ProcessResult::FAILED;
+	}
+
+	std::unique_ptr<sprite::msprite_t, SpriteDeleter> sprite( pLoadedSprite );
+
+	if( !CheckSpriteFrames( asset, *sprite ) )
+		return ProcessResult::FAILED;
+
+	if( settings.operation == Operation::INFO )
+	{
+		std::string szDump;
+
+		DumpSprite( *sprite, settings.dumpFormat, szDump );
+
+		return OutputDump( asset, settings, szDump, szOutput ) ? ProcessResult::SUCCEEDED : ProcessResult::FAILED;
+	}
+
+	if( settings.operation == Operation::RESAVE )
+		return ResaveSprite( asset, settings, *sprite ) ? ProcessResult::SUCCEEDED : ProcessResult::FAILED;
+
+	if( settings.operation == Operation::TEXTURES )
+		return ExportSpriteFrames( asset, settings, *sprite ) ? ProcessResult::SUCCEEDED : ProcessResult::FAILED;
+
+	return ProcessResult::SUCCEEDED;
+}
+}
+
+bool StringToOperation( const char* const pszString, Operation& operation )
+{
+	if( !strcmp( pszString, "validate" ) )
+		operation = Operation::VALIDATE;
+	else if( !strcmp( pszString, "info" ) )
+		operation = Operation::INFO;
+	else if( !strcmp( pszString, "rescale" ) )
+		operation = Operation::RESCALE;
+	else if( !strcmp( pszString, "resave" ) )
+		operation = Operation::RESAVE;
+	else if( !strcmp( pszString, "textures" ) )
+		operation = Operation::TEXTURES;
+	else if( !strcmp( pszString, "stats" ) )
+		operation = Operation::STATS;
+	else if( !strcmp( pszString, "decompile" ) )
+		operation = Operation::DECOMPILE;
+	else
+		return false;
+
+	return true;
+}
+
+bool OperationSavesFiles( const Operation operation )
+{
+	return operation == Operation::RESCALE || operation == Operation::RESAVE || operation == Operation::TEXTURES ||
+		operation == Operation::DECOMPILE;
+}
+
+bool GatherAssets( const std::vector<std::string>& inputs, std::vector<Asset_t>& assets )
+{
+	assets.clear();
+
+	bool bSuccess = true;
+
+	for( const auto& szInput : inputs )
+	{
+		const fs::path input( szInput );
+
+		std::error_code error;
+
+		AssetType type;
+
+		if( fs::is_regular_file( input, error ) )
+		{
+			//Files given directly are processed even if they look like companion files.
+			if( GetAssetType( input, type ) )
+				assets.push_back( { type, input.string(), input.filename().string() } );
+			else
+				Warning( "\"%s\" is not a model or sprite, skipping\n", szInput.c_str() );
+
+			continue;
+		}
+
+		if( !fs::is_directory( input, error ) )
+		{
+			Error( "\"%s\" does not exist\n", szInput.c_str() );
+			bSuccess = false;
+			continue;
+		}
+
+		const std::string szRoot = input.generic_string();
+
+		for( fs::recursive_directory_iterator it( input, error ), end; !error && it != end; it.increment( error ) )
+		{
+			if( !fs::is_regular_file( it->status() ) || !GetAssetType( it->path(), type ) || !IsDirectlyProcessed( it->path(), type ) )
+				continue;
+
+			const std::string szFilename = it->path().generic_string();
+
+			//Keep the directory structure so files with the same name don't overwrite each other's output.
+			std::string szRelativePath = szFilename.substr( szRoot.size() );
+
+			szRelativePath.erase( 0, szRelativePath.find_first_not_of( '/' ) );
+
+			assets.push_back( { type, it->path().string(), szRelativePath } );
+		}
+
+		if( error )
+		{
+			Error( "Couldn't search directory \"%s\": %s\n", szInput.c_str(), error.message().c_str() );
+			bSuccess = false;
+		}
+	}
+
+	//Directory order is not defined; sort so the output is the same on every run.
+	std::sort( assets.begin(), assets.end(), []( const Asset_t& lhs, const Asset_t& rhs )
+	{
+		return lhs.szFilename < rhs.szFilename;
+	} );
+
+	return bSuccess;
+}
+
+ProcessResult_t ProcessAssets( const std::vector<Asset_t>& assets, const ProcessSettings_t& settings )
+{
+	ProcessResult_t result;
+
+	std::atomic<size_t> uiSucceeded{ 0 };
+	std::atomic<size_t> uiFailed{ 0 };
+	std::atomic<size_t> uiSkipped{ 0 };
+	std::atomic<size_t> uiBytes{ 0 };
+
+	//Dumps that are printed are stored until all files are done, so they're printed in order.
+	std::vector<std::string> outputs( assets.size() );
+
+	const auto start = std::chrono::steady_clock::now();
+
+	//The app starts the scheduler with its default thread count, restart it if a count was requested.
+	//The calling thread takes part in the work, so it counts as one of the threads.
+	//With a single thread the scheduler stays stopped and everything runs on this thread.
+	if( settings.uiNumThreads != 0 && ( !tasks::IsRunning() || tasks::GetNumThreads() != settings.uiNumThreads - 1 ) )
+	{
+		tasks::Stop();
+
+		if( settings.uiNumThreads > 1 )
+			tasks::Start( settings.uiNumThreads - 1 );
+	}
+
+	tasks::ParallelFor( assets.size(), [ & ]( const size_t uiIndex )
+	{
+		const Asset_t& asset = assets[ uiIndex ];
+
+		const ProcessResult processResult = asset.type == AssetType::MODEL ?
+			ProcessModel( asset, settings, outputs[ uiIndex ] ) :
+			ProcessSprite( asset, settings, outputs[ uiIndex ] );
+
+		switch( processResult )
+		{
+		case ProcessResult::SUCCEEDED:	++uiSucceeded; break;
+		case ProcessResult::FAILED:		++uiFailed; break;
+		case ProcessResult::SKIPPED:	++uiSkipped; return;
+		}
+
+		std::error_code error;
+
+		const auto uiSize = fs::file_size( asset.szFilename, error );
+
+		if( !error )
+			uiBytes += static_cast<size_t>( uiSize );
+	}, 1, "ProcessAsset" );
+
+	result.flElapsedTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+	result.uiSucceeded = uiSucceeded;
+	result.uiFailed = uiFailed;
+	result.uiSkipped = uiSkipped;
+	result.uiBytes = uiBytes;
+
+	for( size_t uiIndex = 0; uiIndex < assets.size(); ++uiIndex )
+	{
+		if( outputs[ uiIndex ].empty() )
+			continue;
+
+		//Dumps can be larger than the log buffer, so they're written directly.
+		printf( "%s:\n", assets[ uiIndex ].szFilename.c_str() );
+		fwrite( outputs[ uiIndex ].data(), 1, outputs[ uiIndex ].size(), stdout );
+		printf( "\n" );
+	}
+
+	return result;
+}
+}
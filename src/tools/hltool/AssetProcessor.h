@@ -0,0 +1,169 @@
+#ifndef TOOLS_HLTOOL_ASSETPROCESSOR_H
+#define TOOLS_HLTOOL_ASSETPROCESSOR_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "shared/sprite/sprite.h"
+#include "shared/studiomodel/StudioModelDump.h"
+#include "shared/studiomodel/StudioModelTextureExport.h"
+
+namespace hltool
+{
+enum class Operation
+{
+	/**
+	*	Checks that files are intact, without loading them.
+	*/
+	VALIDATE = 0,
+
+	/**
+	*	Dumps the contents of each file.
+	*/
+	INFO,
+
+	/**
+	*	Scales meshes and bones, and saves the result.
+	*/
+	RESCALE,
+
+	/**
+	*	Loads and saves each file. Models are saved unchanged, sprites can be re-encoded and trimmed.
+	*/
+	RESAVE,
+
+	/**
+	*	Exports every texture of each model and every frame of each sprite as an image.
+	*/
+	TEXTURES,
+
+	/**
+	*	Reports the cost of each model: geometry, texture memory, animation data and posing.
+	*/
+	STATS,
+
+	/**
+	*	Decompiles each model into a QC file, SMD files and BMP textures.
+	*/
+	DECOMPILE
+};
+
+/**
+*	Parses an operation name: "validate", "info", "rescale", "resave", "textures", "stats" or "decompile".
+*	@return Whether the name is a valid operation.
+*/
+bool StringToOperation( const char* const pszString, Operation& operation );
+
+/**
+*	@return Whether the operation writes files, and needs an output directory.
+*/
+bool OperationSavesFiles( const Operation operation );
+
+enum class AssetType
+{
+	MODEL = 0,
+	SPRITE
+};
+
+struct Asset_t
+{
+	AssetType type;
+
+	/**
+	*	Absolute path to the file.
+	*/
+	std::string szFilename;
+
+	/**
+	*	Path that output is written to, relative to the output directory.
+	*	For files found in a directory, this is their path relative to that directory.
+	*/
+	std::string szRelativePath;
+};
+
+struct ProcessSettings_t
+{
+	Operation operation = Operation::VALIDATE;
+
+	/**
+	*	Number of threads to process files on. 0 to use one per hardware thread.
+	*/
+	size_t uiNumThreads = 0;
+
+	/**
+	*	Scale applied to model meshes by Operation::RESCALE.
+	*/
+	float flMeshScale = 1;
+
+	/**
+	*	Scale applied to model bones by Operation::RESCALE.
+	*/
+	float flBoneScale = 1;
+
+	studiomdl::DumpFormat dumpFormat = studiomdl::DumpFormat::TEXT;
+
+	/**
+	*	Format that Operation::TEXTURES saves textures and sprite frames in.
+	*/
+	studiomdl::ImageFormat imageFormat = studiomdl::ImageFormat::PNG;
+
+	/**
+	*	Texture format that Operation::RESAVE saves sprites with. TexFormat::COUNT keeps the format of each sprite.
+	*/
+	sprite::TexFormat::TexFormat spriteTexFormat = sprite::TexFormat::COUNT;
+
+	/**
+	*	First frame of each sprite that Operation::RESAVE saves.
+	*/
+	int iFirstSpriteFrame = 0;
+
+	/**
+	*	Number of frames of each sprite that Operation::RESAVE saves, or -1 for all frames from iFirstSpriteFrame onward.
+	*/
+	int iSpriteFrameCount = -1;
+
+	/**
+	*	Directory that files are written to. For Operation::INFO and Operation::STATS, dumps are printed if this is empty.
+	*/
+	std::string szOutputDirectory;
+};
+
+struct ProcessResult_t
+{
+	size_t uiSucceeded = 0;
+	size_t uiFailed = 0;
+
+	/**
+	*	Files that the operation does not apply to, like sprites when saving.
+	*/
+	size_t uiSkipped = 0;
+
+	/**
+	*	Total size of the processed files, in bytes.
+	*/
+	size_t uiBytes = 0;
+
+	/**
+	*	Time spent processing, in seconds. Does not include finding the files.
+	*/
+	double flElapsedTime = 0;
+};
+
+/**
+*	Finds all models and sprites in the given files and directories. Directories are searched recursively.
+*	Texture and sequence group files are skipped, they're processed along with their model.
+*	@param inputs Absolute paths to files and directories.
+*	@param assets Assets that were found, sorted by filename.
+*	@return Whether all inputs exist.
+*/
+bool GatherAssets( const std::vector<std::string>& inputs, std::vector<Asset_t>& assets );
+
+/**
+*	Processes assets in parallel. Models are validated before they're loaded, so corrupt files are reported instead of read out of bounds.
+*	Does not use GL, only the files are loaded.
+*/
+ProcessResult_t ProcessAssets( const std::vector<Asset_t>& assets, const ProcessSettings_t& settings );
+}
+
+#endif //TOOLS_HLTOOL_ASSETPROCESSOR_H
@@ -0,0 +1,292 @@
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+
+#include "core/LibHLCore.h"
+#include "shared/Logging.h"
+
+#include "cvar/CVar.h"
+#include "filesystem/IFileSystem.h"
+
+#include "CHLToolApp.h"
+
+namespace hltool
+{
+CHLToolApp::CommandLineResult CHLToolApp::ParseCommandLine( int iArgc, char* pszArgV[] )
+{
+	if( iArgc >= 2 && !strcmp( pszArgV[ 1 ], "--help" ) )
+	{
+		PrintUsage();
+		return CommandLineResult::EXIT;
+	}
+
+	if( iArgc < 2 || !StringToOperation( pszArgV[ 1 ], m_Settings.operation ) )
+	{
+		if( iArgc >= 2 )
+			Error( "Unknown operation \"%s\"\n", pszArgV[ 1 ] );
+
+		PrintUsage();
+		return CommandLineResult::INVALID;
+	}
+
+	for( int iArg = 2; iArg < iArgc; ++iArg )
+	{
+		const char* const pszArg = pszArgV[ iArg ];
+
+		if( !strcmp( pszArg, "--help" ) )
+		{
+			PrintUsage();
+			return CommandLineResult::EXIT;
+		}
+
+		//Everything that isn't an option is a file or directory to process.
+		if( strncmp( pszArg, "--", 2 ) )
+		{
+			m_Inputs.push_back( pszArg );
+			continue;
+		}
+
+		//All other options take a value.
+		if( iArg + 1 >= iArgc )
+		{
+			Error( "Missing value for argument \"%s\"\n", pszArg );
+			PrintUsage();
+			return CommandLineResult::INVALID;
+		}
+
+		const char* const pszValue = pszArgV[ ++iArg ];
+
+		if( !strcmp( pszArg, "--threads" ) )
+		{
+			const int iThreads = atoi( pszValue );
+
+			if( iThreads < 0 )
+			{
+				Error( "--threads must be 0 or larger\n" );
+				return CommandLineResult::INVALID;
+			}
+
+			m_Settings.uiNumThreads = static_cast<size_t>( iThreads );
+		}
+		else if( !strcmp( pszArg, "--scale" ) )
+		{
+			m_Settings.flMeshScale = static_cast<float>( atof( pszValue ) );
+
+			if( m_Settings.flMeshScale <= 0 )
+			{
+				Error( "--scale must be larger than 0\n" );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--bone-scale" ) )
+		{
+			m_Settings.flBoneScale = static_cast<float>( atof( pszValue ) );
+
+			if( m_Settings.flBoneScale <= 0 )
+			{
+				Error( "--bone-scale must be larger than 0\n" );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--format" ) )
+		{
+			if( !studiomdl::StringToDumpFormat( pszValue, m_Settings.dumpFormat ) )
+			{
+				Error( "Unknown format \"%s\", must be text, json or csv\n", pszValue );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--image-format" ) )
+		{
+			if( !studiomdl::StringToImageFormat( pszValue, m_Settings.imageFormat ) )
+			{
+				Error( "Unknown image format \"%s\", must be bmp, png or dds\n", pszValue );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--tex-format" ) )
+		{
+			bool bSuccess;
+
+			m_Settings.spriteTexFormat = sprite::StringToTexFormat( pszValue, &bSuccess );
+
+			if( !bSuccess )
+			{
+				Error( "Unknown texture format \"%s\", must be normal, additive, indexalpha or alphatest\n", pszValue );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--first-frame" ) )
+		{
+			m_Settings.iFirstSpriteFrame = atoi( pszValue );
+
+			if( m_Settings.iFirstSpriteFrame < 0 )
+			{
+				Error( "--first-frame must be 0 or larger\n" );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--frame-count" ) )
+		{
+			m_Settings.iSpriteFrameCount = atoi( pszValue );
+
+			if( m_Settings.iSpriteFrameCount <= 0 )
+			{
+				Error( "--frame-count must be larger than 0\n" );
+				return CommandLineResult::INVALID;
+			}
+		}
+		else if( !strcmp( pszArg, "--output" ) )
+		{
+			m_Settings.szOutputDirectory = pszValue;
+		}
+		else
+		{
+			Error( "Unknown argument \"%s\"\n", pszArg );
+			PrintUsage();
+			return CommandLineResult::INVALID;
+		}
+	}
+
+	if( m_Inputs.empty() )
+	{
+		Error( "No files or directories to process\n" );
+		PrintUsage();
+		return CommandLineResult::INVALID;
+	}
+
+	if( OperationSavesFiles( m_Settings.operation ) && m_Settings.szOutputDirectory.empty() )
+	{
+		Error( "%s requires --output\n", pszArgV[ 1 ] );
+		return CommandLineResult::INVALID;
+	}
+
+	if( m_Settings.operation == Operation::RESCALE && m_Settings.flMeshScale == 1 && m_Settings.flBoneScale == 1 )
+	{
+		Error( "rescale requires --scale or --bone-scale\n" );
+		return CommandLineResult::INVALID;
+	}
+
+	//Starting changes the working directory to the executable's directory, so paths are made absolute first.
+	for( auto& szInput : m_Inputs )
+	{
+		szInput = std::experimental::filesystem::absolute( szInput ).string();
+	}
+
+	if( !m_Settings.szOutputDirectory.empty() )
+		m_Settings.szOutputDirectory = std::experimental::filesystem::absolute( m_Settings.szOutputDirectory ).string();
+
+	return CommandLineResult::RUN;
+}
+
+bool CHLToolApp::Run()
+{
+	std::vector<Asset_t> assets;
+
+	const bool bFoundAll = GatherAssets( m_Inputs, assets );
+
+	if( assets.empty() )
+	{
+		Error( "No models or sprites found\n" );
+		return false;
+	}
+
+	const ProcessResult_t result = ProcessAssets( assets, m_Settings );
+
+	const size_t uiProcessed = result.uiSucceeded + result.uiFailed;
+
+	Message( "Processed %u files (%.2f MB) in %.3f seconds: %u succeeded, %u failed, %u skipped\n",
+			 static_cast<unsigned int>( uiProcessed ), result.uiBytes / ( 1024.0 * 1024.0 ), result.flElapsedTime,
+			 static_cast<unsigned int>( result.uiSucceeded ), static_cast<unsigned int>( result.uiFailed ), static_cast<unsigned int>( result.uiSkipped ) );
+
+	if( result.flElapsedTime > 0 )
+	{
+		Message( "Throughput: %.1f files/s, %.2f MB/s\n",
+				 uiProcessed / result.flElapsedTime, result.uiBytes / ( 1024.0 * 1024.0 ) / result.flElapsedTime );
+	}
+
+	return bFoundAll && result.uiFailed == 0;
+}
+
+bool CHLToolApp::LoadAppLibraries()
+{
+	if( !LoadLibraries( "CVar", "FileSystem" ) )
+		return false;
+
+	return true;
+}
+
+bool CHLToolApp::Connect( const CreateInterfaceFn* pFactories, const size_t uiNumFactories )
+{
+	if( !LoadAndCheckInterfaces( pFactories, uiNumFactories,
+							IFace( ICVARSYSTEM_NAME, g_pCVar, "CVar System" ),
+							IFace( IFILESYSTEM_NAME, m_pFileSystem, "File System" ) ) )
+	{
+		return false;
+	}
+
+	if( !g_pCVar->Initialize() )
+	{
+		FatalError( "Failed to initialize CVar system!\n" );
+		return false;
+	}
+
+	//Connect Core lib cvars first.
+	ConnectCoreCVars( g_pCVar );
+	cvar::ConnectCVars();
+
+	if( !m_pFileSystem->Initialize() )
+	{
+		FatalError( "Failed to initialize file system!\n" );
+		return false;
+	}
+
+	return true;
+}
+
+void CHLToolApp::ShutdownApp()
+{
+	if( m_pFileSystem )
+	{
+		m_pFileSystem->Shutdown();
+		m_pFileSystem = nullptr;
+	}
+
+	if( g_pCVar )
+	{
+		g_pCVar->Shutdown();
+		g_pCVar = nullptr;
+	}
+}
+
+void CHLToolApp::PrintUsage() const
+{
+	Message(
+		"Usage: hltool <operation> [options] <files and directories>\n"
+		"Directories are searched recursively for models and sprites\n"
+		"Operations:\n"
+		"validate\t\tCheck that files are intact\n"
+		"info\t\t\tDump the contents of each file\n"
+		"rescale\t\t\tScale models and save them, sprites are skipped\n"
+		"resave\t\t\tLoad models and sprites and save them. Models are saved unchanged\n"
+		"textures\t\tExport every texture of each model and every frame of each sprite to a directory named after it\n"
+		"stats\t\t\tReport the cost of each model: geometry, strip efficiency, texture memory,\n"
+		"\t\t\tanimation data per sequence group and posing, sprites are skipped\n"
+		"decompile\t\tDecompile each model into a QC file, SMD files and BMP textures in a directory named after it,\n"
+		"\t\t\tsprites are skipped\n"
+		"Options:\n"
+		"--threads <count>\tNumber of threads to process files on (default 0, one per hardware thread)\n"
+		"--scale <scale>\t\tScale to apply to meshes when rescaling\n"
+		"--bone-scale <scale>\tScale to apply to bones when rescaling\n"
+		"--format <format>\tFormat of dumps and statistics: text, json or csv (default text)\n"
+		"--image-format <format>\tFormat of exported textures: bmp, png or dds (default png).\n"
+		"\t\t\tDDS files are compressed to BC1 or BC3 and have a full mip chain\n"
+		"--tex-format <format>\tTexture format to resave sprites with: normal, additive, indexalpha or alphatest\n"
+		"\t\t\t(default is to keep the format of each sprite)\n"
+		"--first-frame <frame>\tFirst frame of each sprite to keep when resaving (default 0)\n"
+		"--frame-count <count>\tNumber of frames of each sprite to keep when resaving (default is all frames)\n"
+		"--output <directory>\tDirectory to write files to. Paths relative to the input directories are kept\n"
+		"\t\t\tRequired by rescale, resave, textures and decompile. Dumps are printed if no directory is given\n"
+		"--help\t\t\tShow this help\n" );
+}
+}
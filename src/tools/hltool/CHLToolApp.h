@@ -0,0 +1,80 @@
+#ifndef TOOLS_HLTOOL_CHLTOOLAPP_H
+#define TOOLS_HLTOOL_CHLTOOLAPP_H
+
+#include <string>
+#include <vector>
+
+#include "app/CAppSystem.h"
+
+#include "AssetProcessor.h"
+
+namespace filesystem
+{
+class IFileSystem;
+}
+
+namespace hltool
+{
+/**
+*	Processes models and sprites from the command line. Loads the cvar system and file system like the tools do, but doesn't create any windows or GL contexts.
+*/
+class CHLToolApp final : public app::CAppSystem
+{
+public:
+	enum class CommandLineResult
+	{
+		/**
+		*	The arguments are valid, and the files should be processed.
+		*/
+		RUN = 0,
+
+		/**
+		*	An informational argument like --help was handled, nothing should be processed.
+		*/
+		EXIT,
+
+		INVALID
+	};
+
+public:
+	CHLToolApp() = default;
+	~CHLToolApp() = default;
+
+	/**
+	*	Parses the command line. Must be called before the app is started, since starting changes the working directory.
+	*/
+	CommandLineResult ParseCommandLine( int iArgc, char* pszArgV[] );
+
+	/**
+	*	Processes all files and prints how many succeeded, and how fast.
+	*	@return Whether all files were found and processed.
+	*/
+	bool Run();
+
+protected:
+	bool LoadAppLibraries() override;
+
+	bool Connect( const CreateInterfaceFn* pFactories, const size_t uiNumFactories ) override;
+
+	void ShutdownApp() override;
+
+private:
+	void PrintUsage() const;
+
+private:
+	ProcessSettings_t m_Settings;
+
+	/**
+	*	Files and directories to process.
+	*/
+	std::vector<std::string> m_Inputs;
+
+	filesystem::IFileSystem* m_pFileSystem = nullptr;
+
+private:
+	CHLToolApp( const CHLToolApp& ) = delete;
+	CHLToolApp& operator=( const CHLToolApp& ) = delete;
+};
+}
+
+#endif //TOOLS_HLTOOL_CHLTOOLAPP_H
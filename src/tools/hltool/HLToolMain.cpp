@@ -0,0 +1,27 @@
+#include <cstdlib>
+
+#include "shared/Logging.h"
+
+#include "CHLToolApp.h"
+
+int main( int iArgc, char* pszArgV[] )
+{
+	//There's no UI to show messages in, print them instead.
+	SetDefaultLogListener( GetStdOutLogListener() );
+
+	hltool::CHLToolApp app;
+
+	const auto result = app.ParseCommandLine( iArgc, pszArgV );
+
+	if( result != hltool::CHLToolApp::CommandLineResult::RUN )
+		return result == hltool::CHLToolApp::CommandLineResult::EXIT ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	bool bSuccess = app.Start();
+
+	if( bSuccess )
+		bSuccess = app.Run();
+
+	app.OnShutdown();
+
+	return bSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
+}
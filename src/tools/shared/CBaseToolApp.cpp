@@ -11,6 +11,8 @@
 #include "filesystem/IFileSystem.h"
 #include "soundsystem/shared/ISoundSystem.h"
 
+#include "engine/shared/EngineFileSystem.h"
+#include "engine/shared/EngineRenderContext.h"
 #include "engine/shared/renderer/IRendererLibrary.h"
 #include "engine/shared/renderer/IRenderContext.h"
 #include "engine/shared/renderer/studiomodel/IStudioModelRenderer.h"
@@ -72,7 +74,6 @@ bool CBaseToolApp::Connect( const CreateInterfaceFn* pFactories, const size_t ui
 							IFace( IFILESYSTEM_NAME, m_pFileSystem, "File System" ),
 							IFace( ISOUNDSYSTEM_NAME, m_pSoundSystem, "Sound System" ),
 							IFace( IRENDERERLIBRARY_NAME, m_pRendererLib, "Render Library" ),
-							IFace( IRENDERCONTEXT_NAME, g_pRenderContext, "Render Context" ),
 							IFace( ISTUDIOMODELRENDERER_NAME, g_pStudioMdlRenderer, "StudioModel Renderer" ) ) )
 	{
 		return false;
@@ -80,50 +81,81 @@ bool CBaseToolApp::Connect( const CreateInterfaceFn* pFactories, const size_t ui
 
 	g_pSoundSystem = m_pSoundSystem;
 
-	if( !g_pCVar->Initialize() )
+	if( !m_pSoundSystem->Connect( pFactories, uiNumFactories ) )
 	{
-		FatalError( "Failed to initialize CVar system!\n" );
+		FatalError( "Failed to connect sound system!\n" );
 		return false;
 	}
 
-	//Connect Core lib cvars first.
-	ConnectCoreCVars( g_pCVar );
+	//FMOD doesn't depend on anything else, so it's started while the rest is set up. CAppSystem waits for it after Connect.
+	StartParallelStep( "Sound system", [ this ]()
+		{
+			if( !m_pSoundSystem->Initialize() )
+			{
+				FatalError( "Failed to initialize sound system!\n" );
+				return false;
+			}
 
-	cvar::ConnectCVars();
+			return true;
+		}
+	);
 
-	if( !m_pFileSystem->Initialize() )
-	{
-		FatalError( "Failed to initialize file system!\n" );
-		return false;
-	}
+	g_pRenderContext = m_pRendererLib->SelectBackend( m_RenderBackend );
 
-	if( !InitOpenGL() )
-	{
-		return false;
-	}
+	//Models and sprites register their textures with it.
+	engine::SetRenderContext( g_pRenderContext );
 
-	if( !m_pRendererLib->Connect( pFactories, uiNumFactories ) )
 	{
-		FatalError( "Failed to connect renderer!\n" );
-		return false;
+		CStartupTimer timer( *this, "CVar system" );
+
+		if( !g_pCVar->Initialize() )
+		{
+			FatalError( "Failed to initialize CVar system!\n" );
+			return false;
+		}
+
+		//Connect Core lib cvars first.
+		ConnectCoreCVars( g_pCVar );
+
+		cvar::ConnectCVars();
 	}
 
-	if( !g_pStudioMdlRenderer->Initialize() )
 	{
-		FatalError( "Failed to initialize StudioModel renderer!\n" );
-		return false;
+		CStartupTimer timer( *this, "File system" );
+
+		if( !m_pFileSystem->Initialize() )
+		{
+			FatalError( "Failed to initialize file system!\n" );
+			return false;
+		}
 	}
 
-	if( !m_pSoundSystem->Connect( pFactories, uiNumFactories ) )
+	//Models and sprites are loaded through the filesystem so they can be read from archives.
+	engine::SetFileSystem( m_pFileSystem );
+
 	{
-		FatalError( "Failed to connect sound system!\n" );
-		return false;
+		CStartupTimer timer( *this, "OpenGL" );
+
+		if( !InitOpenGL() )
+		{
+			return false;
+		}
 	}
 
-	if( !m_pSoundSystem->Initialize() )
 	{
-		FatalError( "Failed to initialize sound system!\n" );
-		return false;
+		CStartupTimer timer( *this, "Renderer" );
+
+		if( !m_pRendererLib->Connect( pFactories, uiNumFactories ) )
+		{
+			FatalError( "Failed to connect renderer!\n" );
+			return false;
+		}
+
+		if( !g_pStudioMdlRenderer->Initialize() )
+		{
+			FatalError( "Failed to initialize StudioModel renderer!\n" );
+			return false;
+		}
 	}
 
 	return true;
@@ -146,6 +178,7 @@ void CBaseToolApp::ShutdownApp()
 
 	if( g_pRenderContext )
 	{
+		engine::SetRenderContext( nullptr );
 		g_pRenderContext = nullptr;
 	}
 
@@ -157,6 +190,8 @@ void CBaseToolApp::ShutdownApp()
 
 	ShutdownOpenGL();
 
+	engine::SetFileSystem( nullptr );
+
 	if( m_pFileSystem )
 	{
 		m_pFileSystem->Shutdown();
@@ -5,6 +5,8 @@
 
 #include "app/CAppSystem.h"
 
+#include "engine/shared/renderer/IRendererLibrary.h"
+
 namespace filesystem
 {
 class IFileSystem;
@@ -15,8 +17,6 @@ namespace soundsystem
 class ISoundSystem;
 }
 
-class ILibSystem;
-
 namespace tools
 {
 /**
@@ -50,6 +50,19 @@ public:
 	*/
 	soundsystem::ISoundSystem* GetSoundSystem() { return m_pSoundSystem; }
 
+	/**
+	*	@return The render context backend.
+	*/
+	renderer::RenderBackend GetRenderBackend() const { return m_RenderBackend; }
+
+	/**
+	*	Sets the render context backend. Must be called before the app is started.
+	*/
+	void SetRenderBackend( const renderer::RenderBackend backend )
+	{
+		m_RenderBackend = backend;
+	}
+
 protected:
 	bool StartupApp() override;
 
@@ -76,7 +89,9 @@ private:
 	filesystem::IFileSystem* m_pFileSystem = nullptr;
 	soundsystem::ISoundSystem* m_pSoundSystem = nullptr;
 
-	ILibSystem* m_pRendererLib = nullptr;
+	renderer::IRendererLibrary* m_pRendererLib = nullptr;
+
+	renderer::RenderBackend m_RenderBackend = renderer::RenderBackend::IMMEDIATE;
 };
 }
 
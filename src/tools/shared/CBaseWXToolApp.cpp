@@ -1,3 +1,8 @@
+#include <cstring>
+#include <vector>
+
+#include <wx/cmdline.h>
+
 #include "core/shared/Platform.h"
 
 #include "core/shared/Logging.h"
@@ -5,7 +10,17 @@
 #include "core/shared/Utility.h"
 #include "core/shared/CWorldTime.h"
 
+#include "utility/CCommand.h"
+
 #include "cvar/CVar.h"
+#include "cvar/CConCommand.h"
+
+#include "filesystem/IFileSystem.h"
+
+#include "settings/CBaseSettings.h"
+
+#include "graphics/CGLUploadQueue.h"
+#include "graphics/FrameCapture.h"
 
 #include "shared/renderer/studiomodel/IStudioModelRenderer.h"
 #include "soundsystem/shared/ISoundSystem.h"
@@ -28,6 +43,157 @@ static cvar::CCVar max_fps(
 	.Flags( cvar::Flag::ARCHIVE )
 );
 
+static cvar::CCVar r_ondemand(
+	"r_ondemand",
+	cvar::CCVarArgsBuilder()
+	.HelpInfo( "If non-zero, frames are only run when something has changed, like an animation playing or user input. Otherwise, frames are run up to max_fps" )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.Flags( cvar::Flag::ARCHIVE )
+);
+
+static cvar::CCVar app_fastshutdown(
+	"app_fastshutdown",
+	cvar::CCVarArgsBuilder()
+	.HelpInfo( "If non-zero, only settings and logs are written on exit, and the system frees everything else at once. Ignored in debug builds" )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.Flags( cvar::Flag::ARCHIVE )
+);
+
+static cvar::CCVar fs_hotreload(
+	"fs_hotreload",
+	cvar::CCVarArgsBuilder()
+	.HelpInfo( "Whether to reload files that are changed by other programs" )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.Flags( cvar::Flag::ARCHIVE )
+);
+
+static cvar::CCVar sim_fixedrate(
+	"sim_fixedrate",
+	cvar::CCVarArgsBuilder()
+	.HelpInfo( "If non-zero, the world advances in fixed steps at this rate instead of by the frame time, so animation and events are the same at any frame rate" )
+	.FloatValue( 0 )
+	.MinValue( 0 )
+	.MaxValue( 1000 )
+	.Flags( cvar::Flag::ARCHIVE )
+);
+
+static cvar::CCVar r_uploadthread(
+	"r_uploadthread",
+	cvar::CCVarArgsBuilder()
+	.HelpInfo( "Whether to upload textures on a separate thread so loading models doesn't stall drawing. Takes effect on restart" )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.Flags( cvar::Flag::ARCHIVE )
+);
+
+static cvar::CConCommand fps_stats( "fps_stats",
+	[]( const util::CCommand& args )
+	{
+		auto pApp = dynamic_cast<CBaseWXToolApp*>( wxApp::GetInstance() );
+
+		if( !pApp )
+			return;
+
+		pApp->GetFramePacer().PrintStats();
+
+		if( args.ArgC() >= 2 && !strcmp( args.Arg( 1 ), "reset" ) )
+			pApp->GetFramePacer().ResetStats();
+	},
+	cvar::Flag::NONE, "Prints frame time statistics for recent frames. Usage: fps_stats [reset]" );
+
+static cvar::CCVar asset_index(
+	"asset_index",
+	cvar::CCVarArgsBuilder()
+	.HelpInfo( "Whether to index the models, sprites and sounds in the active game configuration's directories after startup, so they can be searched with asset_find" )
+	.FloatValue( 1 )
+	.MinValue( 0 )
+	.MaxValue( 1 )
+	.Flags( cvar::Flag::ARCHIVE )
+);
+
+static cvar::CConCommand asset_index_rebuild( "asset_index_rebuild",
+	[]( const util::CCommand& args )
+	{
+		if( auto pApp = dynamic_cast<CBaseWXToolApp*>( wxApp::GetInstance() ) )
+			pApp->StartAssetIndex();
+	},
+	cvar::Flag::NONE, "Scans the active game configuration's directories again to update the asset index" );
+
+static cvar::CConCommand asset_find( "asset_find",
+	[]( const util::CCommand& args )
+	{
+		auto pApp = dynamic_cast<CBaseWXToolApp*>( wxApp::GetInstance() );
+
+		if( !pApp )
+			return;
+
+		if( args.ArgC() < 2 )
+		{
+			Message( "Usage: asset_find <query>\n" );
+			return;
+		}
+
+		const size_t MAX_RESULTS = 100;
+
+		std::vector<engine::CAssetIndex::Entry_t> results;
+
+		const size_t uiMatches = pApp->GetAssetIndex().Search( args.GetArgumentsString(), results, MAX_RESULTS );
+
+		for( const auto& entry : results )
+		{
+			switch( entry.type )
+			{
+			case engine::AssetType::MODEL:
+				if( entry.bValidHeader )
+				{
+					Message( "%s (%u KB, %d bones, %d sequences, %d textures, %d bodyparts)\n", entry.szPath.c_str(), static_cast<unsigned int>( entry.uiSize / 1024 ),
+						entry.iNumBones, entry.iNumSequences, entry.iNumTextures, entry.iNumBodyparts );
+					continue;
+				}
+
+				break;
+
+			case engine::AssetType::SPRITE:
+				if( entry.bValidHeader )
+				{
+					Message( "%s (%u KB, %d frames, %dx%d)\n", entry.szPath.c_str(), static_cast<unsigned int>( entry.uiSize / 1024 ),
+						entry.iNumFrames, entry.iWidth, entry.iHeight );
+					continue;
+				}
+
+				break;
+
+			default: break;
+			}
+
+			Message( "%s (%s, %u KB)\n", entry.szPath.c_str(), engine::AssetTypeToString( entry.type ), static_cast<unsigned int>( entry.uiSize / 1024 ) );
+		}
+
+		Message( "%u of %u assets match\n", static_cast<unsigned int>( uiMatches ), static_cast<unsigned int>( pApp->GetAssetIndex().GetCount() ) );
+
+		if( uiMatches > results.size() )
+			Message( "Only the first %u are listed\n", static_cast<unsigned int>( results.size() ) );
+	},
+	cvar::Flag::NONE, "Searches the asset index. Terms match part of the path, type:<model|sprite|sound> matches a type, "
+	"and <field><op><number> compares size, bones, seq, textures, bodyparts, frames, width or height. Usage: asset_find <query>" );
+
+/**
+*	Time that a changed file must be left alone before it's reloaded, in seconds.
+*/
+static const double FILE_CHANGE_DELAY = 0.5;
+
+/**
+*	Interval at which the event loop is woken up while no frames are being run, in milliseconds.
+*/
+static const int WAKE_UP_INTERVAL = 100;
+
 bool CBaseWXToolApp::Connect( const CreateInterfaceFn* pFactories, const size_t uiNumFactories )
 {
 	if( !CBaseToolApp::Connect( pFactories, uiNumFactories ) )
@@ -40,6 +206,9 @@ bool CBaseWXToolApp::Connect( const CreateInterfaceFn* pFactories, const size_t
 
 bool CBaseWXToolApp::InitOpenGL()
 {
+	//RenderDoc only captures contexts that are created after it's loaded.
+	graphics::InitFrameCapture();
+
 	//Set up OpenGL parameters.
 	CwxOpenGL::CreateInstance();
 
@@ -57,9 +226,16 @@ bool CBaseWXToolApp::InitOpenGL()
 		return false;
 	}
 
+	wxOpenGL().SetUploadThreadEnabled( UseUploadThread() );
+
 	return true;
 }
 
+bool CBaseWXToolApp::UseUploadThread() const
+{
+	return r_uploadthread.GetBool();
+}
+
 void CBaseWXToolApp::ShutdownOpenGL()
 {
 	if( CwxOpenGL::InstanceExists() )
@@ -70,6 +246,15 @@ void CBaseWXToolApp::ShutdownOpenGL()
 	}
 }
 
+bool CBaseWXToolApp::UseFastShutdown() const
+{
+#ifdef NDEBUG
+	return app_fastshutdown.GetBool();
+#else
+	return false;
+#endif
+}
+
 void CBaseWXToolApp::GetGLCanvasAttributes( wxGLAttributes& attrs )
 {
 	attrs
@@ -83,6 +268,18 @@ void CBaseWXToolApp::GetGLCanvasAttributes( wxGLAttributes& attrs )
 
 void CBaseWXToolApp::GetGLContextAttributes( wxGLContextAttrs& attrs )
 {
+	if( GetRenderBackend() == renderer::RenderBackend::CORE )
+	{
+		//Renderers that aren't drawing through the core context yet still need the fixed function pipeline, so ask for the compatibility profile.
+		attrs
+			.PlatformDefaults()
+			.CompatibilityProfile()
+			.OGLVersion( 3, 3 )
+			.EndList();
+
+		return;
+	}
+
 	//The default settings for OpenGL allow for Windows XP support. OpenGL 2.1 is typically supported by XP era hardware, making it the best choice.
 	//2.1 supports GLSL 120, which has some features that are nice to have in shaders.
 	attrs
@@ -123,13 +320,66 @@ bool CBaseWXToolApp::OnInit()
 	//Reduce the idle event strain on the system a bit.
 	wxIdleEvent::SetMode( wxIDLE_PROCESS_SPECIFIED );
 
+	g_pCVar->InstallGlobalCVarHandler( this );
+
+	m_WakeUpTimer = std::make_unique<CTimer>( this );
+	m_WakeUpTimer->Start( WAKE_UP_INTERVAL );
+
+	//From here on messages are written by a background thread and passed to listeners in OnIdle.
+	logging().StartAsync();
+
 	return true;
 }
 
+void CBaseWXToolApp::OnInitCmdLine( wxCmdLineParser& parser )
+{
+	wxApp::OnInitCmdLine( parser );
+
+	parser.AddOption( "", "renderer", "Render context to use: imode or core. Defaults to imode", wxCMD_LINE_VAL_STRING );
+}
+
+bool CBaseWXToolApp::OnCmdLineParsed( wxCmdLineParser& parser )
+{
+	wxString szBackend;
+
+	if( parser.Found( "renderer", &szBackend ) )
+	{
+		renderer::RenderBackend backend;
+
+		if( !renderer::StringToRenderBackend( szBackend.c_str(), backend ) )
+		{
+			wxLogError( "Invalid renderer \"%s\", expected imode or core", szBackend );
+			return false;
+		}
+
+		SetRenderBackend( backend );
+	}
+
+	return wxApp::OnCmdLineParsed( parser );
+}
+
 int CBaseWXToolApp::OnExit()
 {
 	wxApp::Disconnect( wxEVT_IDLE, wxIdleEventHandler( CBaseWXToolApp::OnIdle ) );
 
+	m_Prefetcher.Stop();
+
+	StopAssetIndex();
+
+	if( m_AssetIndex.IsDirty() )
+		m_AssetIndex.Save();
+
+	if( m_WakeUpTimer )
+	{
+		m_WakeUpTimer->Stop();
+		m_WakeUpTimer.reset();
+	}
+
+	if( g_pCVar->HasGlobalCVarHandler( this ) )
+		g_pCVar->RemoveGlobalCVarHandler( this );
+
+	logging().StopAsync();
+
 	OnShutdown();
 
 	UseMessagesWindow( false );
@@ -145,6 +395,9 @@ void CBaseWXToolApp::Exit( const bool bMainWndClosed )
 
 	m_bExiting = true;
 
+	//Write out anything that's still queued; shutdown messages are logged synchronously.
+	logging().StopAsync();
+
 	//Close messages window if needed.
 	UseMessagesWindow( false );
 
@@ -154,6 +407,51 @@ void CBaseWXToolApp::Exit( const bool bMainWndClosed )
 	OnExit( bMainWndClosed );
 }
 
+int CBaseWXToolApp::FilterEvent( wxEvent& event )
+{
+	const wxEventType type = event.GetEventType();
+
+	//Idle, paint and update UI events are caused by running frames, so they can't request frames.
+	if( ( event.GetEventCategory() & wxEVT_CATEGORY_USER_INPUT ) ||
+		type == wxEVT_SIZE ||
+		( event.IsCommandEvent() && type != wxEVT_UPDATE_UI ) )
+	{
+		m_bRedrawRequested = true;
+
+		//Commands and keys can change anything, other input is seen by views through the state it changes, like the camera.
+		if( ( event.IsCommandEvent() && type != wxEVT_UPDATE_UI ) || type == wxEVT_KEY_DOWN || type == wxEVT_CHAR )
+			++m_uiContentRevision;
+	}
+
+	return wxApp::FilterEvent( event );
+}
+
+void CBaseWXToolApp::RequestRedraw()
+{
+	m_bRedrawRequested = true;
+
+	++m_uiContentRevision;
+
+	wxWakeUpIdle();
+}
+
+void CBaseWXToolApp::OnTimer( CTimer& timer )
+{
+	//Processing the timer event is enough to get an idle event.
+}
+
+void CBaseWXToolApp::HandleCVar( cvar::CCVar& cvar, const char* pszOldValue, float flOldValue )
+{
+	RequestRedraw();
+
+	//Archived cvars are saved with the settings.
+	if( cvar.GetFlags() & cvar::Flag::ARCHIVE )
+	{
+		if( auto pSettings = GetBaseSettings() )
+			pSettings->MarkChanged();
+	}
+}
+
 void CBaseWXToolApp::OnWindowClose( wxFrame* pWindow, wxCloseEvent& event )
 {
 	if( pWindow == m_pMessagesWindow )
@@ -224,31 +522,168 @@ void CBaseWXToolApp::MessagesWindowClosed()
 	logging().SetLogListener( nullptr );
 }
 
+void CBaseWXToolApp::StartPrefetch()
+{
+	m_bPrefetchStarted = true;
+
+	auto pSettings = GetBaseSettings();
+
+	if( !pSettings )
+		return;
+
+	CFilePrefetcher::Request_t request;
+
+	if( pSettings->GetPrefetchRequest( request ) )
+		m_Prefetcher.Start( std::move( request ) );
+
+	if( asset_index.GetBool() )
+		StartAssetIndex();
+}
+
+void CBaseWXToolApp::StartAssetIndex()
+{
+	StopAssetIndex();
+
+	auto pSettings = GetBaseSettings();
+
+	if( !pSettings )
+		return;
+
+	std::vector<std::string> directories;
+
+	pSettings->GetSearchDirectories( directories );
+
+	const bool bLoad = !m_bAssetIndexLoaded;
+
+	m_bAssetIndexLoaded = true;
+
+	m_bCancelAssetIndex = false;
+
+	m_AssetIndexThread = std::thread( [ this, directories = std::move( directories ), bLoad ]()
+	{
+		if( bLoad )
+			m_AssetIndex.Load();
+
+		if( m_AssetIndex.Scan( directories, true, &m_bCancelAssetIndex ) && m_AssetIndex.IsDirty() )
+			m_AssetIndex.Save();
+	} );
+}
+
+void CBaseWXToolApp::StopAssetIndex()
+{
+	if( !m_AssetIndexThread.joinable() )
+		return;
+
+	m_bCancelAssetIndex = true;
+
+	m_AssetIndexThread.join();
+}
+
 void CBaseWXToolApp::OnIdle( wxIdleEvent& event )
 {
-	event.RequestMore();
+	//Show messages as soon as possible, even if this isn't a new frame.
+	logging().DispatchMessages();
+
+	if( !m_bPrefetchStarted )
+		StartPrefetch();
+
+	//The wake up timer keeps idle events coming, so changes are saved even if no frames are run.
+	if( auto pSettings = GetBaseSettings() )
+		pSettings->SaveIfChanged();
+
+	//Finished uploads make textures usable, so redraw to show them.
+	if( CwxOpenGL::InstanceExists() && wxOpenGL().GetContext() )
+	{
+		//Decoded images are queued for upload first, so they can finish in the same frame if there's no upload thread.
+		const size_t uiImageLoads = wxOpenGL().RunImageLoads();
+
+		if( graphics::GLUploadQueue().RunCompletions() > 0 || uiImageLoads > 0 )
+			RequestRedraw();
+	}
+
+	//When rendering on demand, the event loop blocks until something happens instead of asking for more idle events.
+	const bool bRunFrame = !r_ondemand.GetBool() || m_bRedrawRequested || IsAnimating();
+
+	const double flFrameInterval = max_fps.GetFloat() > 0 ? 1.0 / max_fps.GetFloat() : 0;
+
+	if( bRunFrame )
+	{
+		event.RequestMore();
+
+		//Sleep until the frame is due instead of returning and polling again, so frames are evenly spaced.
+		m_FramePacer.WaitForNextFrame( flFrameInterval );
+	}
 
 	const double flCurTime = GetCurrentTime();
 
 	double flFrameTime = flCurTime - WorldTime.GetPreviousRealTime();
 
-	WorldTime.SetRealTime( flCurTime );
-
 	if( flFrameTime > 1.0 )
 		flFrameTime = 0.1;
 
 	//Don't use this when using wxTimer, since it lowers the FPS by a fair amount.
-	if( flFrameTime < ( 1.0 / max_fps.GetFloat() ) )
+	if( !bRunFrame && flFrameTime < flFrameInterval )
 		return;
 
-	WorldTime.TimeChanged( flCurTime );
+	WorldTime.SetRealTime( flCurTime );
 
-	g_pCVar->RunFrame();
+	CheckFileChanges( flCurTime );
 
-	g_pStudioMdlRenderer->RunFrame();
+	g_pCVar->RunFrame();
 
 	GetSoundSystem()->RunFrame();
 
+	//Commands and file changes can request a frame.
+	if( !bRunFrame && !m_bRedrawRequested )
+		return;
+
+	m_bRedrawRequested = false;
+
+	WorldTime.SetFixedStep( sim_fixedrate.GetFloat() > 0 ? 1.0 / sim_fixedrate.GetFloat() : 0 );
+
+	WorldTime.TimeChanged( flCurTime );
+
+	g_pStudioMdlRenderer->RunFrame();
+
 	RunFrame();
 }
+
+void CBaseWXToolApp::CheckFileChanges( const double flCurTime )
+{
+	std::vector<std::string> changes;
+
+	//Always get the changes so cached paths are invalidated.
+	GetFileSystem()->GetFileChanges( changes );
+
+	//The index is kept up to date even if files aren't reloaded.
+	if( !changes.empty() )
+		m_AssetIndex.Update( changes );
+
+	if( !fs_hotreload.GetBool() )
+	{
+		m_ChangedFiles.clear();
+		return;
+	}
+
+	if( !changes.empty() )
+	{
+		m_ChangedFiles.insert( changes.begin(), changes.end() );
+		m_flLastFileChangeTime = flCurTime;
+	}
+
+	if( m_ChangedFiles.empty() || ( flCurTime - m_flLastFileChangeTime ) < FILE_CHANGE_DELAY )
+		return;
+
+	//Reloading can change which files are watched.
+	const std::unordered_set<std::string> changedFiles = std::move( m_ChangedFiles );
+
+	m_ChangedFiles.clear();
+
+	for( const auto& szFilename : changedFiles )
+	{
+		OnFileChanged( szFilename );
+	}
+
+	RequestRedraw();
+}
 }
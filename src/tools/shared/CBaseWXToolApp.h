@@ -1,22 +1,42 @@
 #ifndef TOOLS_SHARED_CBASEWXTOOLAPP_H
 #define TOOLS_SHARED_CBASEWXTOOLAPP_H
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
 #include "ui/wx/wxInclude.h"
 
 #include "ui/wx/CwxOpenGL.h"
 
+#include "ui/wx/utility/CTimer.h"
+
 #include "ui/wx/utility/IWindowCloseListener.h"
 
+#include "cvar/CCVar.h"
+
+#include "utility/CFilePrefetcher.h"
+
+#include "shared/CAssetIndex.h"
+
 #include "CBaseToolApp.h"
+#include "CFramePacer.h"
 
 namespace ui
 {
 class CMessagesWindow;
 }
 
+namespace settings
+{
+class CBaseSettings;
+}
+
 namespace tools
 {
-class CBaseWXToolApp : public CBaseToolApp, public wxApp, public IWindowCloseListener
+class CBaseWXToolApp : public CBaseToolApp, public wxApp, public IWindowCloseListener, public ITimerListener, public cvar::ICVarHandler
 {
 public:
 	static const size_t DEFAULT_MAX_MESSAGES_COUNT = 100;
@@ -40,19 +60,41 @@ protected:
 	*/
 	virtual void GetGLContextAttributes( wxGLContextAttrs& attrs );
 
+	/**
+	*	@return Whether textures should be uploaded on a separate thread. Tools that only render once can opt out.
+	*/
+	virtual bool UseUploadThread() const;
+
 	/**
 	*	Allows wxWidgets apps to run code after base tool app run code has been executed, but before the wxWidgets app is started.
 	*	@return true on success, false otherwise.
 	*/
 	virtual bool PreRunApp() { return true; }
 
+	/**
+	*	Release builds shut down fast if app_fastshutdown is set. Debug builds always free everything, so leaks can be found.
+	*/
+	bool UseFastShutdown() const override;
+
 public:
 	//wxApp overrides
 
 	bool OnInit() override;
 
+	/**
+	*	Adds the options shared by all tools. Tools that add their own must call this.
+	*/
+	void OnInitCmdLine( wxCmdLineParser& parser ) override;
+
+	bool OnCmdLineParsed( wxCmdLineParser& parser ) override;
+
 	int OnExit() override;
 
+	/**
+	*	Requests a redraw for user input, so frames only have to be run when something could have changed.
+	*/
+	int FilterEvent( wxEvent& event ) override;
+
 	/**
 	*	Returns whether the tool is exiting.
 	*/
@@ -63,17 +105,60 @@ public:
 	*/
 	void Exit( const bool bMainWndClosed = false );
 
+	/**
+	*	Makes the tool run a frame as soon as possible. Only needed when rendering on demand; input and cvar changes request frames automatically.
+	*/
+	void RequestRedraw();
+
+	/**
+	*	@return Changes every time a redraw is requested or the user issues a command or presses a key, since those can change what views show.
+	*	Views that cache what they draw compare this to tell whether the cache is still valid. Moving the mouse doesn't change it.
+	*/
+	unsigned int GetContentRevision() const { return m_uiContentRevision; }
+
+	const CFramePacer& GetFramePacer() const { return m_FramePacer; }
+
+	CFramePacer& GetFramePacer() { return m_FramePacer; }
+
+	const engine::CAssetIndex& GetAssetIndex() const { return m_AssetIndex; }
+
+	engine::CAssetIndex& GetAssetIndex() { return m_AssetIndex; }
+
+	/**
+	*	Scans the search paths of the active game configuration on a background thread, updating the asset index.
+	*	Stops the previous scan first. The index is loaded from disk the first time, so unchanged files don't have to be read again.
+	*/
+	void StartAssetIndex();
+
 protected:
 	/**
 	*	Called every frame.
 	*/
 	virtual void RunFrame() = 0;
 
+	/**
+	*	When rendering on demand, frames are only run while this returns true, or when a redraw has been requested.
+	*	@return Whether something is changing on its own, like an animation that is playing.
+	*/
+	virtual bool IsAnimating() { return false; }
+
 	/**
 	*	Called when the tool wants to exit.
 	*/
 	virtual void OnExit( const bool bMainWndClosed ) = 0;
 
+	/**
+	*	Called when a file watched through the filesystem has changed on disk. Reported once the file hasn't changed for a moment,
+	*	so files that are still being written aren't reloaded. Only called if hot reloading is enabled.
+	*	@param szFilename Absolute path to the file.
+	*/
+	virtual void OnFileChanged( const std::string& szFilename ) {}
+
+	/**
+	*	@return The tool's settings, if it has any. Changes to archived cvars mark them as changed, and changed settings are saved while idle.
+	*/
+	virtual settings::CBaseSettings* GetBaseSettings() { return nullptr; }
+
 public:
 	const wxIcon& GetToolIcon() const { return m_ToolIcon; }
 
@@ -110,6 +195,10 @@ public:
 protected:
 	void OnWindowClose( wxFrame* pWindow, wxCloseEvent& event ) override;
 
+	void OnTimer( CTimer& timer ) override;
+
+	void HandleCVar( cvar::CCVar& cvar, const char* pszOldValue, float flOldValue ) override;
+
 	/**
 	*	Allows an app to enable the messages window. This is a separate window containing log messages.
 	*	bUse Whether to use the messages window or not.
@@ -119,6 +208,21 @@ protected:
 private:
 	void MessagesWindowClosed();
 
+	/**
+	*	Passes changes to watched files to OnFileChanged.
+	*/
+	void CheckFileChanges( const double flCurTime );
+
+	/**
+	*	Starts prefetching the files the tool is likely to open. Runs once the event loop is idle for the first time, so startup isn't delayed.
+	*/
+	void StartPrefetch();
+
+	/**
+	*	Stops the asset index scan, if one is running, and waits for it to exit.
+	*/
+	void StopAssetIndex();
+
 protected:
 	void OnIdle( wxIdleEvent& event );
 
@@ -130,6 +234,39 @@ private:
 	ui::CMessagesWindow* m_pMessagesWindow = nullptr;
 
 	size_t m_uiMaxMessagesCount = DEFAULT_MAX_MESSAGES_COUNT;
+
+	/**
+	*	Watched files that changed, but haven't been reported yet.
+	*/
+	std::unordered_set<std::string> m_ChangedFiles;
+
+	double m_flLastFileChangeTime = 0;
+
+	/**
+	*	Whether something changed that needs a frame to be run.
+	*/
+	bool m_bRedrawRequested = true;
+
+	unsigned int m_uiContentRevision = 0;
+
+	/**
+	*	Wakes the event loop up now and then, so messages and file changes are handled while no frames are being run.
+	*/
+	std::unique_ptr<CTimer> m_WakeUpTimer;
+
+	CFramePacer m_FramePacer;
+
+	CFilePrefetcher m_Prefetcher;
+
+	bool m_bPrefetchStarted = false;
+
+	engine::CAssetIndex m_AssetIndex;
+
+	std::thread m_AssetIndexThread;
+
+	std::atomic<bool> m_bCancelAssetIndex{ false };
+
+	bool m_bAssetIndexLoaded = false;
 };
 }
 
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+#include "core/shared/Logging.h"
+
+#include "CFramePacer.h"
+
+#ifdef WIN32
+//Not defined by older SDKs. Supported as of Windows 10 1803; older versions fail to create the timer.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace tools
+{
+namespace
+{
+/**
+*	How long before a deadline to stop sleeping and start spinning.
+*/
+const std::chrono::microseconds SPIN_TIME( 1000 );
+}
+
+CFramePacer::CFramePacer()
+{
+#ifdef WIN32
+	m_hTimer = CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+
+	//Fall back to a regular timer, which is only as precise as the system timer.
+	if( !m_hTimer )
+		m_hTimer = CreateWaitableTimerW( NULL, TRUE, NULL );
+#endif
+}
+
+CFramePacer::~CFramePacer()
+{
+#ifdef WIN32
+	if( m_hTimer )
+		CloseHandle( m_hTimer );
+#endif
+}
+
+void CFramePacer::WaitForNextFrame( const double flFrameInterval )
+{
+	assert( flFrameInterval >= 0 );
+
+	const auto interval = std::chrono::duration_cast<Clock_t::duration>( std::chrono::duration<double>( flFrameInterval ) );
+
+	auto now = Clock_t::now();
+
+	//Start over if this is the first frame or if the schedule has fallen behind by more than a frame.
+	if( !m_bStarted || now > m_NextFrameTime + interval || flFrameInterval != m_flFrameInterval )
+	{
+		m_bStarted = true;
+		m_flFrameInterval = flFrameInterval;
+		m_NextFrameTime = now + interval;
+		m_LastFrameTime = now;
+		return;
+	}
+
+	if( now < m_NextFrameTime )
+	{
+		SleepUntil( m_NextFrameTime - SPIN_TIME );
+
+		while( ( now = Clock_t::now() ) < m_NextFrameTime )
+		{
+		}
+	}
+
+	AddFrameTime( std::chrono::duration<double>( now - m_LastFrameTime ).count() );
+
+	m_LastFrameTime = now;
+
+	//Schedule from the deadline rather than the current time so small errors don't add up.
+	m_NextFrameTime += interval;
+
+	if( m_NextFrameTime < now )
+		m_NextFrameTime = now + interval;
+}
+
+void CFramePacer::SleepUntil( const Clock_t::time_point& time )
+{
+	const auto now = Clock_t::now();
+
+	if( time <= now )
+		return;
+
+#ifdef WIN32
+	if( m_hTimer )
+	{
+		//Relative due time in 100 nanosecond intervals.
+		LARGE_INTEGER dueTime;
+
+		dueTime.QuadPart = -static_cast<LONGLONG>( std::chrono::duration_cast<std::chrono::nanoseconds>( time - now ).count() / 100 );
+
+		if( SetWaitableTimer( m_hTimer, &dueTime, 0, NULL, NULL, FALSE ) )
+		{
+			WaitForSingleObject( m_hTimer, INFINITE );
+			return;
+		}
+	}
+#endif
+
+	std::this_thread::sleep_until( time );
+}
+
+void CFramePacer::AddFrameTime( const double flFrameTime )
+{
+	m_flFrameTimes[ m_uiNextFrameTime ] = flFrameTime;
+
+	m_uiNextFrameTime = ( m_uiNextFrameTime + 1 ) % HISTORY_COUNT;
+
+	if( m_uiFrameTimeCount < HISTORY_COUNT )
+		++m_uiFrameTimeCount;
+}
+
+void CFramePacer::ResetStats()
+{
+	m_uiNextFrameTime = 0;
+	m_uiFrameTimeCount = 0;
+}
+
+void CFramePacer::GetStats( Stats_t& stats ) const
+{
+	stats = {};
+
+	stats.uiFrameCount = m_uiFrameTimeCount;
+
+	if( !m_uiFrameTimeCount )
+		return;
+
+	double flSum = 0;
+
+	stats.flMin = m_flFrameTimes[ 0 ];
+	stats.flMax = m_flFrameTimes[ 0 ];
+
+	for( size_t uiIndex = 0; uiIndex < m_uiFrameTimeCount; ++uiIndex )
+	{
+		const double flTime = m_flFrameTimes[ uiIndex ];
+
+		flSum += flTime;
+
+		stats.flMin = std::min( stats.flMin, flTime );
+		stats.flMax = std::max( stats.flMax, flTime );
+
+		if( flTime > m_flFrameInterval * 1.5 )
+			++stats.uiLateCount;
+	}
+
+	stats.flMean = flSum / m_uiFrameTimeCount;
+
+	double flVariance = 0;
+
+	for( size_t uiIndex = 0; uiIndex < m_uiFrameTimeCount; ++uiIndex )
+	{
+		const double flDelta = m_flFrameTimes[ uiIndex ] - stats.flMean;
+
+		flVariance += flDelta * flDelta;
+	}
+
+	flVariance /= m_uiFrameTimeCount;
+
+	stats.flMean *= 1000.0;
+	stats.flMin *= 1000.0;
+	stats.flMax *= 1000.0;
+	stats.flJitter = std::sqrt( flVariance ) * 1000.0;
+}
+
+void CFramePacer::PrintStats() const
+{
+	Stats_t stats;
+
+	GetStats( stats );
+
+	if( !stats.uiFrameCount )
+	{
+		Message( "No frames have been paced yet\n" );
+		return;
+	}
+
+	Message( "Last %u frames (target %.2f ms):\n", static_cast<unsigned int>( stats.uiFrameCount ), m_flFrameInterval * 1000.0 );
+	Message( "Mean: %.3f ms, min: %.3f ms, max: %.3f ms\n", stats.flMean, stats.flMin, stats.flMax );
+	Message( "Jitter: %.3f ms, late frames: %u\n", stats.flJitter, static_cast<unsigned int>( stats.uiLateCount ) );
+}
+}
@@ -0,0 +1,108 @@
+#ifndef TOOLS_SHARED_CFRAMEPACER_H
+#define TOOLS_SHARED_CFRAMEPACER_H
+
+#include <chrono>
+#include <cstddef>
+
+#include "core/shared/Platform.h"
+
+namespace tools
+{
+/**
+*	Keeps frames at a steady rate by sleeping until the next frame is due, instead of polling.
+*	Sleeps on a high resolution waitable timer where available, and spins for the last part of the wait to hit the deadline precisely.
+*	Keeps track of recent frame times so the smoothness of playback can be checked.
+*/
+class CFramePacer final
+{
+public:
+	typedef std::chrono::steady_clock Clock_t;
+
+	/**
+	*	Number of frames that statistics are kept for.
+	*/
+	static const size_t HISTORY_COUNT = 240;
+
+	struct Stats_t
+	{
+		size_t uiFrameCount;
+
+		/**
+		*	Frame times, in milliseconds.
+		*/
+		double flMean;
+		double flMin;
+		double flMax;
+
+		/**
+		*	Standard deviation of frame times, in milliseconds.
+		*/
+		double flJitter;
+
+		/**
+		*	Number of frames that took more than one and a half times the target frame time.
+		*/
+		size_t uiLateCount;
+	};
+
+public:
+	CFramePacer();
+	~CFramePacer();
+
+	/**
+	*	Waits until the next frame is due.
+	*	If the previous frame was too long ago, like after being idle, the frame starts right away and the schedule starts over.
+	*	@param flFrameInterval Target time between frames, in seconds.
+	*/
+	void WaitForNextFrame( const double flFrameInterval );
+
+	/**
+	*	Forgets all recorded frame times.
+	*/
+	void ResetStats();
+
+	/**
+	*	Gets statistics over the last HISTORY_COUNT frames.
+	*/
+	void GetStats( Stats_t& stats ) const;
+
+	/**
+	*	Prints statistics to the log.
+	*/
+	void PrintStats() const;
+
+private:
+	/**
+	*	Sleeps until shortly before the given time.
+	*/
+	void SleepUntil( const Clock_t::time_point& time );
+
+	void AddFrameTime( const double flFrameTime );
+
+private:
+#ifdef WIN32
+	HANDLE m_hTimer = NULL;
+#endif
+
+	Clock_t::time_point m_NextFrameTime;
+	Clock_t::time_point m_LastFrameTime;
+
+	bool m_bStarted = false;
+
+	double m_flFrameInterval = 0;
+
+	/**
+	*	Ring buffer of frame times, in seconds.
+	*/
+	double m_flFrameTimes[ HISTORY_COUNT ];
+
+	size_t m_uiNextFrameTime = 0;
+	size_t m_uiFrameTimeCount = 0;
+
+private:
+	CFramePacer( const CFramePacer& ) = delete;
+	CFramePacer& operator=( const CFramePacer& ) = delete;
+};
+}
+
+#endif //TOOLS_SHARED_CFRAMEPACER_H
@@ -55,6 +55,15 @@ void CSpriteViewerSettings::PreShutdown( const char* const pszFilename )
 {
 }
 
+void CSpriteViewerSettings::AddPrefetchFiles( std::vector<std::string>& files ) const
+{
+	//Most recent first.
+	for( const auto& szFilename : m_RecentFiles->GetFiles() )
+	{
+		files.emplace_back( szFilename );
+	}
+}
+
 bool CSpriteViewerSettings::LoadFromFile( const kv::Block& root )
 {
 	if( !CBaseSettings::LoadFromFile( root ) )
@@ -6,6 +6,7 @@
 #include "../settings/CSpriteViewerSettings.h"
 #include "../CSpriteViewerState.h"
 
+#include "graphics/BMPFile.h"
 #include "graphics/GraphicsUtils.h"
 
 #include "engine/shared/renderer/IRenderContext.h"
@@ -38,7 +39,7 @@ C3DView::~C3DView()
 {
 	SetCurrent( *GetContext() );
 
-	glDeleteTexture( m_BackgroundTexture );
+	UnloadBackgroundTexture();
 }
 
 void C3DView::PrepareForLoad()
@@ -54,6 +55,9 @@ void C3DView::UpdateView()
 
 void C3DView::DrawScene()
 {
+	g_pRenderContext->ResetDrawStats();
+	g_pSpriteRenderer->ResetDrawStats();
+
 	const Color& backgroundColor = m_pSpriteViewer->GetSettings()->GetBackgroundColor();
 
 	g_pRenderContext->ClearColor( backgroundColor.GetRed() / 255.0f, backgroundColor.GetGreen() / 255.0f, backgroundColor.GetBlue() / 255.0f, 1.0 );
@@ -101,7 +105,7 @@ void C3DView::DrawSpriteInfo()
 		renderInfo.vecScale			= Vector2D( vecScale.x, vecScale.y );
 		renderInfo.pSprite			= pEntity->GetSprite();
 		renderInfo.flTransparency	= pEntity->GetTransparency();
-		renderInfo.flFrame			= pEntity->GetFrame();
+		renderInfo.flFrame			= pEntity->GetCurrentFrame();
 
 		if( m_pSpriteViewer->GetState()->IsTexFormatOverridden() )
 		{
@@ -168,17 +172,24 @@ bool C3DView::LoadBackgroundTexture( const wxString& szFilename )
 {
 	UnloadBackgroundTexture();
 
-	m_BackgroundTexture = wxOpenGL().glLoadImage( szFilename.c_str() );
+	m_BackgroundLoad = wxOpenGL().glLoadImageAsync( szFilename.c_str(), [ this ]( const GLuint textureId )
+	{
+		m_BackgroundLoad = CwxOpenGL::INVALID_IMAGE_LOAD;
+		m_BackgroundTexture = textureId;
 
-	//TODO: notify UI
-	m_pSpriteViewer->GetState()->showBackground = m_BackgroundTexture != GL_INVALID_TEXTURE_ID;
+		//TODO: notify UI
+		m_pSpriteViewer->GetState()->showBackground = m_BackgroundTexture != GL_INVALID_TEXTURE_ID;
+	} );
 
-	return m_BackgroundTexture != GL_INVALID_TEXTURE_ID;
+	return m_BackgroundLoad != CwxOpenGL::INVALID_IMAGE_LOAD;
 }
 
 void C3DView::UnloadBackgroundTexture()
 {
-	glDeleteTexture( m_BackgroundTexture );
+	wxOpenGL().CancelImageLoad( m_BackgroundLoad );
+	m_BackgroundLoad = CwxOpenGL::INVALID_IMAGE_LOAD;
+
+	wxOpenGL().glFreeImage( m_BackgroundTexture );
 }
 
 void C3DView::TakeScreenshot()
@@ -207,13 +218,9 @@ void C3DView::TakeScreenshot()
 
 	const wxString szFilename = dlg.GetPath();
 
-	//We have to flip the image vertically, since OpenGL reads it upside down.
-	graphics::FlipImageVertically( size.GetWidth(), size.GetHeight(), rgbData.get() );
-
-	wxImage image( size.GetWidth(), size.GetHeight(), rgbData.get(), true );
-
+	//OpenGL reads the image upside down, which is how BMP files store it, so it doesn't need flipping.
 	//TODO: set default extension to bmp if none is given. Also do this for HLMV.
-	if( !image.SaveFile( szFilename, wxBITMAP_TYPE_BMP ) )
+	if( !graphics::bmpfile::SaveRGBBMPFile( szFilename.c_str(), size.GetWidth(), size.GetHeight(), rgbData.get(), true ) )
 	{
 		wxMessageBox( wxString::Format( "Failed to save image \"%s\"!", szFilename.c_str() ) );
 	}
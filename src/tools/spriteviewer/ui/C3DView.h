@@ -9,6 +9,8 @@
 
 #include "graphics/Constants.h"
 
+#include "ui/wx/CwxOpenGL.h"
+
 namespace sprview
 {
 class CSpriteViewerApp;
@@ -61,6 +63,8 @@ private:
 
 	GLuint m_BackgroundTexture	= GL_INVALID_TEXTURE_ID;
 
+	CwxOpenGL::ImageLoadHandle_t m_BackgroundLoad = CwxOpenGL::INVALID_IMAGE_LOAD;
+
 private:
 	C3DView( const C3DView& ) = delete;
 	C3DView& operator=( const C3DView& ) = delete;
@@ -135,6 +135,9 @@ bool CMainPanel::LoadSprite( const wxString& szFilename )
 
 	m_pSpriteViewer->GetState()->ResetModelData();
 
+	//The frames list builds thumbnails from the sprite on a worker thread, so release it before the sprite is freed.
+	m_pFramesList->SetSprite( nullptr );
+
 	m_pSpriteViewer->GetState()->ClearEntity();
 
 	auto szCFilename = szFilename.char_str( wxMBConvUTF8() );
@@ -166,7 +169,7 @@ bool CMainPanel::LoadSprite( const wxString& szFilename )
 	}
 	else
 	{
-		delete pSprite;
+		sprite::FreeSprite( pSprite );
 	}
 
 	InitializeUI();
@@ -178,6 +181,8 @@ void CMainPanel::FreeSprite()
 {
 	m_p3DView->PrepareForLoad();
 
+	m_pFramesList->SetSprite( nullptr );
+
 	m_pSpriteViewer->GetState()->ClearEntity();
 }
 
@@ -9,6 +9,10 @@
 
 #include "game/entity/CSpriteEntity.h"
 
+#include "shared/sprite/CSprite.h"
+
+#include "filesystem/IFileSystem.h"
+
 #include "tools/shared/Credits.h"
 
 #include "CMainPanel.h"
@@ -128,6 +132,7 @@ bool CMainWindow::LoadSprite( const wxString& szFilename )
 		wxMessageBox( wxString::Format( "The file \"%s\" does not exist.", szAbsFilename ) );
 
 		m_pSpriteViewer->GetSettings()->GetRecentFiles()->Remove( std::string( szFilename.c_str() ) );
+		m_pSpriteViewer->GetSettings()->MarkChanged();
 
 		m_RecentFiles.Refresh();
 
@@ -144,9 +149,14 @@ bool CMainWindow::LoadSprite( const wxString& szFilename )
 		this->SetTitleContent( pszAbsFilename );
 
 		m_pSpriteViewer->GetSettings()->GetRecentFiles()->Add( pszAbsFilename );
+		m_pSpriteViewer->GetSettings()->MarkChanged();
 
 		m_RecentFiles.Refresh();
 
+		//Reload the sprite when it's changed by other programs.
+		m_pSpriteViewer->GetFileSystem()->UnwatchAllFiles();
+		m_pSpriteViewer->GetFileSystem()->WatchFile( pszAbsFilename );
+
 		Message( "Loaded sprite \"%s\"\n", pszAbsFilename );
 	}
 	else
@@ -172,8 +182,7 @@ bool CMainWindow::SaveSprite( const wxString& szFilename )
 
 	auto pSprite = m_pSpriteViewer->GetState()->GetEntity()->GetSprite();
 
-	//TODO
-	const bool bSuccess = false;//sprite::SaveSprite( szFilename.c_str(), pSprite );
+	const bool bSuccess = sprite::SaveSprite( szFilename.c_str(), pSprite );
 
 	if( !bSuccess )
 	{
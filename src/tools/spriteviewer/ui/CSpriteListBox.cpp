@@ -1,6 +1,6 @@
 #include "core/shared/Const.h"
 
-#include "graphics/OpenGL.h"
+#include "graphics/PaletteConversion.h"
 
 #include "engine/shared/sprite/sprite.h"
 
@@ -18,69 +18,53 @@ CSpriteListBox::CSpriteListBox( wxWindow* pParent, sprite::msprite_t* pSprite )
 	, m_pSprite( nullptr )
 	, m_Font( 16, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL, false, wxT( "Arial" ) )
 {
-	SetSprite( pSprite );
-}
-
-static std::unique_ptr<wxBitmap> LoadSpriteAsBitmap( std::vector<byte> rgbBuffer, std::vector<byte> alphaBuffer, sprite::mspriteframe_t* pFrame )
-{
-	const int iNumPixels = pFrame->width * pFrame->height;
-
-	const GLsizei iSize = iNumPixels * 4;
-	const GLsizei iAlphaSize = iNumPixels;
-
-	if( iSize > 0 )
 	{
-		//Get the image contents from the GPU.
-		rgbBuffer.resize( iSize );
-		alphaBuffer.resize( iAlphaSize );
+		wxClientDC dc( this );
 
-		glBindTexture( GL_TEXTURE_2D, pFrame->gl_texturenum );
-		glGetnTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbBuffer.size(), rgbBuffer.data() );
+		dc.SetFont( m_Font );
 
-		byte* pInData = rgbBuffer.data() + 3;
-		byte* pOutData = alphaBuffer.data();
-
-		//No way to get the alpha channel on its own, so pull it out.
-		for( int x = 0; x < pFrame->width; ++x )
-		{
-			for( int y = 0; y < pFrame->height; ++y, pInData += 4 )
-			{
-				*pOutData++ = *pInData;
-			}
-		}
+		//Every line uses the same font, so they all have the same height.
+		m_iLineHeight = dc.GetTextExtent( GROUP_TITLE_TEXT ).GetHeight();
+	}
 
-		//Now remove the alpha channel.
-		for( int iCount = 0; iCount < iNumPixels; ++iCount )
-		{
-			rgbBuffer.erase( rgbBuffer.end() - ( ( iCount * 3 ) + 1 ) );
-		}
+	m_Thread = std::thread( &CSpriteListBox::WorkerMain, this );
 
-		//TODO: figure out how to toggle the alpha channel - Solokiller
-		wxImage image( pFrame->width, pFrame->height, rgbBuffer.data()/*, alphaBuffer.data()*/, true );
+	SetSprite( pSprite );
+}
 
-		if( image.IsOk() )
-		{
-			return std::make_unique<wxBitmap>( image );
-		}
-		else
-		{
-			//TODO: error handling.
-		}
-	}
-	else
+CSpriteListBox::~CSpriteListBox()
+{
 	{
-		//TODO: error handling.
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bQuit = true;
 	}
 
-	return nullptr;
+	m_Condition.notify_all();
+
+	m_Thread.join();
 }
 
 void CSpriteListBox::SetSprite( sprite::msprite_t* pSprite )
 {
+	{
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		m_Requests.clear();
+		m_Completed.clear();
+
+		++m_uiGeneration;
+
+		//The worker may still be reading the previous sprite.
+		m_Condition.wait( lock, [ this ]() { return !m_bWorking; } );
+	}
+
 	if( m_pSprite )
 	{
 		m_Frames.clear();
 		m_Frames.shrink_to_fit();
+
+		m_BitmapLRU.clear();
 	}
 
 	m_pSprite = pSprite;
@@ -89,11 +73,6 @@ void CSpriteListBox::SetSprite( sprite::msprite_t* pSprite )
 	{
 		m_Frames.reserve( m_pSprite->numframes );
 
-		std::vector<byte> rgbBuffer;
-		std::vector<byte> alphaBuffer;
-
-		size_t uiNumFrames = 0;
-
 		for( int iIndex = 0; iIndex < m_pSprite->numframes; ++iIndex )
 		{
 			auto pFrameDesc = &m_pSprite->frames[ iIndex ];
@@ -102,13 +81,9 @@ void CSpriteListBox::SetSprite( sprite::msprite_t* pSprite )
 			{
 				auto pFrame = pFrameDesc->frameptr;
 
-				auto bitmap = LoadSpriteAsBitmap( rgbBuffer, alphaBuffer, pFrame );
-
-				if( bitmap )
+				if( pFrame->pixels )
 				{
-					m_Frames.push_back( std::make_unique<FrameData_t>( pFrameDesc, std::move( bitmap ), iIndex ) );
-
-					++uiNumFrames;
+					m_Frames.emplace_back( pFrameDesc, pFrame, iIndex );
 				}
 				else
 				{
@@ -121,13 +96,11 @@ void CSpriteListBox::SetSprite( sprite::msprite_t* pSprite )
 
 				for( int iGroupIndex = 0; iGroupIndex < pFrameGroup->numframes; ++iGroupIndex )
 				{
-					auto bitmap = LoadSpriteAsBitmap( rgbBuffer, alphaBuffer, pFrameGroup->frames[ iGroupIndex ] );
+					auto pFrame = pFrameGroup->frames[ iGroupIndex ];
 
-					if( bitmap )
+					if( pFrame->pixels )
 					{
-						m_Frames.emplace_back( std::make_unique<FrameData_t>( pFrameDesc, std::move( bitmap ), iGroupIndex, true ) );
-
-						++uiNumFrames;
+						m_Frames.emplace_back( pFrameDesc, pFrame, iGroupIndex, true );
 					}
 					else
 					{
@@ -137,8 +110,10 @@ void CSpriteListBox::SetSprite( sprite::msprite_t* pSprite )
 			}
 		}
 
-		//Must be set after getting all of the bitmaps loaded, since it calls OnMeasureItem.
-		SetItemCount( uiNumFrames );
+		UpdateRowHeights();
+
+		//Must be set after getting all of the frames, since it calls OnMeasureItem.
+		SetItemCount( m_Frames.size() );
 
 		Refresh();
 
@@ -151,11 +126,181 @@ void CSpriteListBox::SetSprite( sprite::msprite_t* pSprite )
 	}
 }
 
-static void DrawText( wxDC& dc, const wxString& szText, wxPoint& textCoord )
+void CSpriteListBox::SetScale( double flScale )
+{
+	m_flScale = flScale != 0 ? flScale : 1.0;
+
+	UpdateRowHeights();
+
+	if( !m_Frames.empty() )
+		RefreshAll();
+}
+
+void CSpriteListBox::UpdateRowHeights()
+{
+	for( auto& frame : m_Frames )
+	{
+		wxCoord height = 0;
+
+		if( frame.bIsGroup && frame.uiFrame == 0 )
+			height += m_iLineHeight * GetGroupTextScale();
+
+		height += frame.pFrame->height * GetBitmapScale();
+
+		//Give it some space between each frame.
+		frame.iRowHeight = height + 20;
+	}
+}
+
+void CSpriteListBox::TouchBitmap( const size_t uiItem )
+{
+	m_BitmapLRU.splice( m_BitmapLRU.begin(), m_BitmapLRU, m_Frames[ uiItem ].lruEntry );
+}
+
+void CSpriteListBox::EvictBitmaps()
 {
-	dc.DrawText( szText, textCoord );
+	const size_t uiFirst = GetVisibleBegin();
+	const size_t uiLast = GetVisibleEnd();
+
+	while( m_BitmapLRU.size() > MAX_CACHED_BITMAPS )
+	{
+		const size_t uiItem = m_BitmapLRU.back();
+
+		//Everything before it was shown more recently, so it's all on screen too.
+		if( uiItem >= uiFirst && uiItem < uiLast )
+			break;
 
-	textCoord.y += dc.GetTextExtent( szText ).GetHeight();
+		m_BitmapLRU.pop_back();
+
+		auto& frame = m_Frames[ uiItem ];
+
+		frame.bitmap.reset();
+
+		//Built again if the row is scrolled back into view.
+		frame.bRequested = false;
+	}
+}
+
+void CSpriteListBox::RequestThumbnail( const size_t uiItem )
+{
+	const size_t uiFirst = GetVisibleBegin();
+	const size_t uiLast = GetVisibleEnd();
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		//Rows that were scrolled past before their thumbnail was built don't need it anymore.
+		for( auto it = m_Requests.begin(); it != m_Requests.end(); )
+		{
+			if( *it < uiFirst || *it >= uiLast )
+			{
+				m_Frames[ *it ].bRequested = false;
+				it = m_Requests.erase( it );
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		m_Requests.push_back( uiItem );
+	}
+
+	m_Frames[ uiItem ].bRequested = true;
+
+	m_Condition.notify_all();
+}
+
+void CSpriteListBox::OnThumbnailsReady()
+{
+	std::vector<Thumbnail_t> completed;
+
+	unsigned int uiGeneration;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		completed.swap( m_Completed );
+
+		uiGeneration = m_uiGeneration;
+	}
+
+	for( auto& thumbnail : completed )
+	{
+		if( thumbnail.uiGeneration != uiGeneration )
+			continue;
+
+		auto& frame = m_Frames[ thumbnail.uiItem ];
+
+		//TODO: figure out how to toggle the alpha channel - Solokiller
+		wxImage image( frame.pFrame->width, frame.pFrame->height, thumbnail.pixels.data(), true );
+
+		if( image.IsOk() )
+		{
+			if( !frame.bitmap )
+			{
+				m_BitmapLRU.push_front( thumbnail.uiItem );
+				frame.lruEntry = m_BitmapLRU.begin();
+			}
+
+			frame.bitmap = std::make_unique<wxBitmap>( image );
+
+			RefreshRow( thumbnail.uiItem );
+		}
+		else
+		{
+			//TODO: error handling.
+		}
+	}
+
+	EvictBitmaps();
+}
+
+void CSpriteListBox::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_Condition.wait( lock, [ this ]() { return m_bQuit || !m_Requests.empty(); } );
+
+		if( m_bQuit )
+			break;
+
+		Thumbnail_t thumbnail;
+
+		thumbnail.uiItem = m_Requests.front();
+		thumbnail.uiGeneration = m_uiGeneration;
+
+		m_Requests.pop_front();
+
+		const sprite::mspriteframe_t* pFrame = m_Frames[ thumbnail.uiItem ].pFrame;
+		const byte* pPalette = m_pSprite->palette;
+
+		m_bWorking = true;
+
+		lock.unlock();
+
+		const size_t uiNumPixels = static_cast<size_t>( pFrame->width * pFrame->height );
+
+		thumbnail.pixels.resize( uiNumPixels * 3 );
+
+		graphics::ExpandIndexedToRGB( pFrame->pixels, uiNumPixels, pPalette, thumbnail.pixels.data() );
+
+		lock.lock();
+
+		m_bWorking = false;
+
+		const bool bNotify = m_Completed.empty();
+
+		m_Completed.emplace_back( std::move( thumbnail ) );
+
+		//One call handles everything that finishes before the main thread gets to it.
+		if( bNotify )
+			CallAfter( &CSpriteListBox::OnThumbnailsReady );
+
+		m_Condition.notify_all();
+	}
 }
 
 void CSpriteListBox::OnDrawItem( wxDC& dc, const wxRect& rect, size_t n ) const
@@ -164,7 +309,14 @@ void CSpriteListBox::OnDrawItem( wxDC& dc, const wxRect& rect, size_t n ) const
 
 	auto& frame = m_Frames[ n ];
 
-	auto& bitmap = frame->bitmap;
+	auto& bitmap = frame.bitmap;
+
+	auto drawText = [ & ]( const wxString& szText, wxPoint& textCoord )
+	{
+		dc.DrawText( szText, textCoord );
+
+		textCoord.y += m_iLineHeight;
+	};
 
 	double x, y;
 
@@ -178,24 +330,19 @@ void CSpriteListBox::OnDrawItem( wxDC& dc, const wxRect& rect, size_t n ) const
 	wxCoord xOffset = 0;
 	wxCoord yOffset = 0;
 
-	sprite::mspriteframe_t* pFrame;
+	sprite::mspriteframe_t* pFrame = frame.pFrame;
 
-	if( frame->bIsGroup )
+	if( frame.bIsGroup )
 	{
-		pFrame = frame->pFrameDesc->GetGroup()->frames[ frame->uiFrame ];
-
-		if( frame->uiFrame == 0 )
+		if( frame.uiFrame == 0 )
 		{
 			dc.SetLogicalScale( GetGroupTextScale(), GetGroupTextScale() );
 
 			wxPoint topLeftText( dc.DeviceToLogicalXRel( rect.GetLeft() ), dc.DeviceToLogicalYRel( rect.GetTop() ) );
 
-			const wxString szText = wxString::Format( GROUP_TITLE_TEXT, n );
-			dc.DrawText( szText, topLeftText );
-
-			int height = dc.GetTextExtent( szText ).GetHeight();
+			dc.DrawText( wxString::Format( GROUP_TITLE_TEXT, n ), topLeftText );
 
-			yOffset = dc.LogicalToDeviceYRel( height );
+			yOffset = dc.LogicalToDeviceYRel( m_iLineHeight );
 
 			dc.SetLogicalScale( GetBitmapScale(), GetBitmapScale() );
 
@@ -206,15 +353,25 @@ void CSpriteListBox::OnDrawItem( wxDC& dc, const wxRect& rect, size_t n ) const
 		xOffset = 20;
 		topLeft.x += xOffset;
 	}
-	else
+
+	if( bitmap )
 	{
-		pFrame = frame->pFrameDesc->GetFrame();
+		dc.DrawBitmap( *bitmap, topLeft, false );
+
+		const_cast<CSpriteListBox*>( this )->TouchBitmap( n );
 	}
+	else
+	{
+		//Show the frame's outline until the thumbnail is ready.
+		dc.SetPen( *wxLIGHT_GREY_PEN );
+		dc.SetBrush( *wxTRANSPARENT_BRUSH );
+		dc.DrawRectangle( topLeft, wxSize( pFrame->width, pFrame->height ) );
 
-	dc.DrawBitmap( *bitmap, topLeft, false );
+		if( !frame.bRequested )
+			const_cast<CSpriteListBox*>( this )->RequestThumbnail( n );
+	}
 
-	const wxCoord scaledWidth = dc.LogicalToDeviceXRel( bitmap->GetWidth() );
-	const wxCoord scaledHeight = dc.LogicalToDeviceYRel( bitmap->GetHeight() );
+	const wxCoord scaledWidth = dc.LogicalToDeviceXRel( pFrame->width );
 
 	wxPoint textCoord = rect.GetTopLeft();
 
@@ -230,25 +387,17 @@ void CSpriteListBox::OnDrawItem( wxDC& dc, const wxRect& rect, size_t n ) const
 	//Offset the text a bit.
 	textCoord.x += 20;
 
-	wxString szText = wxString::Format( "Frame index: %u", frame->uiFrame );
-
-	dc.DrawText( szText, textCoord );
-
-	textCoord.y += dc.GetTextExtent( szText ).GetHeight();
+	drawText( wxString::Format( "Frame index: %u", static_cast<unsigned int>( frame.uiFrame ) ), textCoord );
 
-	DrawText( dc, wxString::Format( "Dimensions: %d x %d", pFrame->width, pFrame->height ), textCoord );
+	drawText( wxString::Format( "Dimensions: %d x %d", pFrame->width, pFrame->height ), textCoord );
 
-	DrawText( dc, wxString::Format( "Origin: %.1f, %.1f", pFrame->left, pFrame->up ), textCoord );
+	drawText( wxString::Format( "Origin: %.1f, %.1f", pFrame->left, pFrame->up ), textCoord );
 
-	if( frame->bIsGroup )
+	if( frame.bIsGroup )
 	{
-		sprite::mspritegroup_t* pGroup = reinterpret_cast<sprite::mspritegroup_t*>( frame->pFrameDesc->frameptr );
+		sprite::mspritegroup_t* pGroup = reinterpret_cast<sprite::mspritegroup_t*>( frame.pFrameDesc->frameptr );
 
-		szText = wxString::Format( "Interval: %.2f", pGroup->intervals[ frame->uiFrame ] );
-
-		dc.DrawText( szText, textCoord );
-
-		textCoord.y += dc.GetTextExtent( szText ).GetHeight();
+		drawText( wxString::Format( "Interval: %.2f", pGroup->intervals[ frame.uiFrame ] ), textCoord );
 	}
 
 	dc.SetLogicalScale( x, y );
@@ -256,27 +405,6 @@ void CSpriteListBox::OnDrawItem( wxDC& dc, const wxRect& rect, size_t n ) const
 
 wxCoord CSpriteListBox::OnMeasureItem( size_t n ) const
 {
-	wxCoord height = 0;
-
-	auto& frame = m_Frames[ n ];
-
-	if( frame->bIsGroup )
-	{
-		if( frame->uiFrame == 0 )
-		{
-			wxClientDC dc( const_cast<CSpriteListBox*>( this ) );
-
-			sprite::mspritegroup_t* pGroup = reinterpret_cast<sprite::mspritegroup_t*>( frame->pFrameDesc->frameptr );
-
-			dc.SetFont( m_Font );
-
-			height += dc.GetTextExtent( GROUP_TITLE_TEXT ).GetHeight() * GetGroupTextScale();
-		}
-	}
-
-	height += frame->bitmap->GetHeight() * GetBitmapScale();
-
-	//Give it some space between each frame.
-	return height + 20;
+	return m_Frames[ n ].iRowHeight;
 }
 }
\ No newline at end of file
@@ -1,54 +1,102 @@
 #ifndef TOOLS_SPRITEVIEWER_UI_CSPRITELISTBOX_H
 #define TOOLS_SPRITEVIEWER_UI_CSPRITELISTBOX_H
 
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "wxSpriteViewer.h"
 
 #include <wx/vlbox.h>
 
+#include "core/shared/Const.h"
+
 namespace sprite
 {
 struct msprite_t;
 struct mspriteframedesc_t;
+struct mspriteframe_t;
 }
 
 namespace sprview
 {
+/**
+*	Lists the frames of a sprite. Thumbnails are built from the sprite's indexed pixels on a worker thread, only for rows that are shown.
+*	Only the most recently shown thumbnails are kept, so memory use doesn't grow with the number of frames.
+*/
 class CSpriteListBox : public wxVListBox
 {
+public:
+	/**
+	*	Maximum number of thumbnail bitmaps that are kept. Rows that are visible are never evicted.
+	*/
+	static const size_t MAX_CACHED_BITMAPS = 256;
+
 private:
 	struct FrameData_t
 	{
 		sprite::mspriteframedesc_t* pFrameDesc;
 
+		sprite::mspriteframe_t* pFrame;
+
 		std::unique_ptr<wxBitmap> bitmap;
 
+		/**
+		*	Position in m_BitmapLRU. Only valid while bitmap is set.
+		*/
+		std::list<size_t>::iterator lruEntry;
+
 		size_t uiFrame;
 
+		/**
+		*	Height of the row, measured once when the sprite or scale changes.
+		*/
+		wxCoord iRowHeight = 0;
+
 		bool bIsGroup;
 
-		FrameData_t( sprite::mspriteframedesc_t* pFrameDesc, std::unique_ptr<wxBitmap>&& bitmap, const size_t uiFrame, const bool bIsGroup = false )
+		/**
+		*	Whether the thumbnail has been requested from the worker thread.
+		*/
+		bool bRequested = false;
+
+		FrameData_t( sprite::mspriteframedesc_t* pFrameDesc, sprite::mspriteframe_t* pFrame, const size_t uiFrame, const bool bIsGroup = false )
 			: pFrameDesc( pFrameDesc )
-			, bitmap( std::move( bitmap ) )
+			, pFrame( pFrame )
 			, uiFrame( uiFrame )
 			, bIsGroup( bIsGroup )
 		{
 		}
 	};
 
+	/**
+	*	Pixels of a thumbnail built by the worker thread.
+	*/
+	struct Thumbnail_t
+	{
+		size_t uiItem;
+
+		unsigned int uiGeneration;
+
+		std::vector<byte> pixels;
+	};
+
 public:
 	CSpriteListBox( wxWindow* pParent, sprite::msprite_t* pSprite = nullptr );
+	~CSpriteListBox();
 
+	/**
+	*	Sets the sprite to list. Waits for the worker thread to stop using the previous sprite, so it can be freed afterwards.
+	*/
 	void SetSprite( sprite::msprite_t* pSprite );
 
 	double GetScale() const { return m_flScale; }
 
-	void SetScale( double flScale )
-	{
-		m_flScale = flScale != 0 ? flScale : 1.0;
-	}
+	void SetScale( double flScale );
 
 protected:
 	void OnDrawItem( wxDC& dc, const wxRect& rect, size_t n ) const override;
@@ -61,15 +109,78 @@ protected:
 
 	float GetBitmapScale() const { return m_flScale; }
 
+private:
+	/**
+	*	Measures the height of every row. Text metrics don't depend on the frame, so only the line height is measured.
+	*/
+	void UpdateRowHeights();
+
+	/**
+	*	Marks the bitmap of the given item as most recently used.
+	*/
+	void TouchBitmap( const size_t uiItem );
+
+	/**
+	*	Frees the least recently used bitmaps until no more than MAX_CACHED_BITMAPS are left, skipping visible rows.
+	*/
+	void EvictBitmaps();
+
+	/**
+	*	Queues the thumbnail of the given item. Requests for rows that have scrolled out of view are dropped.
+	*/
+	void RequestThumbnail( const size_t uiItem );
+
+	/**
+	*	Creates bitmaps for thumbnails finished by the worker thread. Runs on the main thread.
+	*/
+	void OnThumbnailsReady();
+
+	void WorkerMain();
+
 private:
 	sprite::msprite_t* m_pSprite;
 
-	std::vector<std::unique_ptr<FrameData_t>> m_Frames;
+	std::vector<FrameData_t> m_Frames;
+
+	/**
+	*	Items that have a bitmap, most recently shown first.
+	*/
+	std::list<size_t> m_BitmapLRU;
 
 	double m_flScale = 1.0;
 
 	wxFont m_Font;
+
+	/**
+	*	Height of a line of text in m_Font, in logical units.
+	*/
+	wxCoord m_iLineHeight = 0;
+
+	std::thread m_Thread;
+
+	/**
+	*	Guards all members below.
+	*/
+	std::mutex m_Mutex;
+
+	std::condition_variable m_Condition;
+
+	/**
+	*	Items whose thumbnails should be built.
+	*/
+	std::deque<size_t> m_Requests;
+
+	std::vector<Thumbnail_t> m_Completed;
+
+	/**
+	*	Incremented when the sprite changes, so thumbnails of the previous sprite are discarded.
+	*/
+	unsigned int m_uiGeneration = 0;
+
+	bool m_bWorking = false;
+
+	bool m_bQuit = false;
 };
 }
 
-#endif //TOOLS_SPRITEVIEWER_UI_CSPRITELISTBOX_H
\ No newline at end of file
+#endif //TOOLS_SPRITEVIEWER_UI_CSPRITELISTBOX_H
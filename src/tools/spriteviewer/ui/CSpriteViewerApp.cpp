@@ -3,9 +3,11 @@
 #include <wx/cmdline.h>
 
 #include "engine/shared/renderer/sprite/ISpriteRenderer.h"
+#include "engine/shared/sprite/sprite.h"
 
 #include "game/entity/CEntityManager.h"
 #include "game/entity/CBaseEntityList.h"
+#include "game/entity/CSpriteEntity.h"
 
 #include "CMainWindow.h"
 
@@ -35,7 +37,7 @@ bool CSpriteViewerApp::OnInit()
 
 void CSpriteViewerApp::OnInitCmdLine( wxCmdLineParser& parser )
 {
-	wxApp::OnInitCmdLine( parser );
+	CBaseWXToolApp::OnInitCmdLine( parser );
 
 	//Note: this works by setting all available parameters in the order that they appear on the command line.
 	//The model filename must be last for this to work with drag&drop.
@@ -48,7 +50,7 @@ bool CSpriteViewerApp::OnCmdLineParsed( wxCmdLineParser& parser )
 	if( parser.GetParamCount() > 0 )
 		m_szSprite = parser.GetParam( parser.GetParamCount() - 1 );
 
-	return wxApp::OnCmdLineParsed( parser );
+	return CBaseWXToolApp::OnCmdLineParsed( parser );
 }
 
 void CSpriteViewerApp::SetMainWindow( CMainWindow* const pMainWindow )
@@ -85,6 +87,12 @@ bool CSpriteViewerApp::PreRunApp()
 
 	SetEntityList( &g_EntityList );
 
+	if( !EntityManager().Initialize() )
+	{
+		FatalError( "Failed to initialize entity manager", wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
+		return false;
+	}
+
 	if( !EntityManager().OnMapBegin() )
 	{
 		FatalError( "Failed to initialize start map", wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
@@ -140,9 +148,23 @@ void CSpriteViewerApp::ShutdownApp()
 		m_pState = nullptr;
 	}
 
+	if( g_pSpriteRenderer )
+	{
+		g_pSpriteRenderer->Shutdown();
+		g_pSpriteRenderer = nullptr;
+	}
+
 	CBaseWXToolApp::ShutdownApp();
 }
 
+void CSpriteViewerApp::FastShutdownApp()
+{
+	if( auto pSettings = GetSettings() )
+	{
+		pSettings->Shutdown( SPRITEVIEWER_SETTINGS_FILE );
+	}
+}
+
 void CSpriteViewerApp::RunFrame()
 {
 	EntityManager().RunFrame();
@@ -151,6 +173,24 @@ void CSpriteViewerApp::RunFrame()
 		m_pMainWindow->RunFrame();
 }
 
+bool CSpriteViewerApp::IsAnimating()
+{
+	auto pEntity = m_pState->GetEntity();
+
+	return pEntity && pEntity->GetSprite() && pEntity->GetSprite()->numframes > 1;
+}
+
+void CSpriteViewerApp::OnFileChanged( const std::string& szFilename )
+{
+	//Only the loaded sprite is watched.
+	if( !m_pMainWindow )
+		return;
+
+	Message( "Sprite \"%s\" was changed on disk, reloading\n", szFilename.c_str() );
+
+	m_pMainWindow->LoadSprite( szFilename );
+}
+
 void CSpriteViewerApp::OnExit( const bool bMainWndClosed )
 {
 	if( bMainWndClosed )
@@ -46,10 +46,18 @@ protected:
 
 	void ShutdownApp() override;
 
+	void FastShutdownApp() override;
+
 	void RunFrame() override;
 
+	bool IsAnimating() override;
+
 	void OnExit( const bool bMainWndClosed ) override final;
 
+	void OnFileChanged( const std::string& szFilename ) override;
+
+	settings::CBaseSettings* GetBaseSettings() override { return m_pSettings; }
+
 private:
 	CSpriteViewerState* m_pState = nullptr;
 	CSpriteViewerSettings* m_pSettings = nullptr;
@@ -1,8 +1,17 @@
+#include <algorithm>
+#include <chrono>
 #include <memory>
 
+#ifndef WIN32
+#include <GL/glx.h>
+#endif
+
 #include "shared/Logging.h"
 
+#include "graphics/CGLUploadQueue.h"
 #include "graphics/GLRenderTarget.h"
+#include "graphics/GraphicsUtils.h"
+#include "graphics/PaletteConversion.h"
 
 #include "engine/shared/renderer/IRenderContext.h"
 
@@ -11,6 +20,51 @@
 //TODO: remove.
 extern renderer::IRenderContext* g_pRenderContext;
 
+namespace
+{
+/**
+*	Upload context that is made current on the offscreen canvas.
+*	Both it and the main context can be current on the canvas at once, since each is current on a different thread.
+*/
+class CwxGLUploadContext final : public graphics::IGLUploadContext
+{
+public:
+	CwxGLUploadContext( wxGLCanvas* pCanvas, wxGLContext* pContext )
+		: m_pCanvas( pCanvas )
+		, m_pContext( pContext )
+	{
+	}
+
+	~CwxGLUploadContext()
+	{
+		delete m_pContext;
+	}
+
+	bool MakeCurrent() override
+	{
+		return m_pContext->SetCurrent( *m_pCanvas );
+	}
+
+	void ReleaseCurrent() override
+	{
+		//wxWidgets has no way to make no context current.
+#ifdef WIN32
+		wglMakeCurrent( nullptr, nullptr );
+#else
+		glXMakeCurrent( glXGetCurrentDisplay(), None, nullptr );
+#endif
+	}
+
+private:
+	wxGLCanvas* const m_pCanvas;
+	wxGLContext* const m_pContext;
+
+private:
+	CwxGLUploadContext( const CwxGLUploadContext& ) = delete;
+	CwxGLUploadContext& operator=( const CwxGLUploadContext& ) = delete;
+};
+}
+
 CwxOpenGL* CwxOpenGL::m_pInstance = nullptr;
 
 CwxOpenGL& CwxOpenGL::CreateInstance()
@@ -77,6 +131,13 @@ bool CwxOpenGL::Initialize( const wxGLAttributes& canvasAttributes, const wxGLCo
 */
 void CwxOpenGL::Shutdown()
 {
+	//Waits for images that are still being decoded.
+	m_ImageLoads.clear();
+	m_ImageUploads.clear();
+
+	//Must stop before the main context is destroyed, since they share objects.
+	graphics::GLUploadQueue().Stop();
+
 	//TODO: this requires the gl context to be current. It requires a canvas to do so, meaning this has to happen before the last canvas is destroyed.
 	if( m_pScratchTarget )
 	{
@@ -84,12 +145,21 @@ void CwxOpenGL::Shutdown()
 		m_pScratchTarget = nullptr;
 	}
 
+	graphics::FreeSceneGeometry();
+
 	if( m_pContext )
 	{
 		delete m_pContext;
 		m_pContext = nullptr;
 	}
 
+	if( m_pOffscreenFrame )
+	{
+		m_pOffscreenFrame->Destroy();
+		m_pOffscreenFrame = nullptr;
+		m_pOffscreenCanvas = nullptr;
+	}
+
 	if( m_bContextAttributesSet )
 	{
 		m_bContextAttributesSet = false;
@@ -139,6 +209,9 @@ wxGLContext* CwxOpenGL::GetContext( wxGLCanvas* pCanvas )
 				return nullptr;
 			}
 		}
+
+		if( m_bUploadThreadEnabled )
+			StartUploadThread();
 	}
 
 	return m_pContext;
@@ -167,6 +240,63 @@ GLRenderTarget* CwxOpenGL::GetScratchTarget()
 	return m_pScratchTarget;
 }
 
+bool CwxOpenGL::CreateOffscreenCanvas()
+{
+	if( m_pOffscreenCanvas )
+		return true;
+
+	if( !wxGLCanvas::IsDisplaySupported( m_CanvasAttributes ) )
+	{
+		Error( "CwxOpenGL::CreateOffscreenCanvas: Canvas attributes are not supported by this display\n" );
+		return false;
+	}
+
+	//Never shown; it only exists so contexts have something to be made current on.
+	m_pOffscreenFrame = new wxFrame( nullptr, wxID_ANY, "Offscreen" );
+
+	m_pOffscreenCanvas = new wxGLCanvas( m_pOffscreenFrame, m_CanvasAttributes, wxID_ANY, wxDefaultPosition, wxSize( 1, 1 ) );
+
+	return true;
+}
+
+void CwxOpenGL::StartUploadThread()
+{
+	if( !CreateOffscreenCanvas() )
+		return;
+
+	//Note: on X11 this requires XInitThreads to have been called before any other Xlib call.
+	std::unique_ptr<wxGLContext> context( new wxGLContext( m_pOffscreenCanvas, m_pContext, GetContextAttributes() ) );
+
+	if( !context->IsOK() )
+	{
+		Warning( "CwxOpenGL::StartUploadThread: Couldn't create a shared context; uploading on the main thread\n" );
+		return;
+	}
+
+	std::unique_ptr<graphics::IGLUploadContext> uploadContext( new CwxGLUploadContext( m_pOffscreenCanvas, context.release() ) );
+
+	graphics::GLUploadQueue().Start( std::move( uploadContext ) );
+}
+
+bool CwxOpenGL::MakeOffscreenCurrent()
+{
+	if( !CreateOffscreenCanvas() )
+		return false;
+
+	wxGLContext* const pContext = GetContext( m_pOffscreenCanvas );
+
+	if( !pContext )
+		return false;
+
+	if( !m_pOffscreenCanvas->SetCurrent( *pContext ) )
+	{
+		Error( "CwxOpenGL::MakeOffscreenCurrent: Couldn't make the context current\n" );
+		return false;
+	}
+
+	return true;
+}
+
 GLuint CwxOpenGL::glLoadImage( const char* const pszFilename )
 {
 	if( !pszFilename || !( *pszFilename ) )
@@ -189,34 +319,221 @@ GLuint CwxOpenGL::glLoadImage( const char* const pszFilename )
 	const unsigned char* const pData = image.GetData();
 	const unsigned char* const pAlpha = image.GetAlpha();
 
-	const int BPP = image.HasAlpha() ? 4 : 3;
+	const size_t uiPixels = static_cast<size_t>( image.GetWidth() * image.GetHeight() );
 
-	std::unique_ptr<GLubyte[]> pImageData( new GLubyte[ image.GetWidth() * image.GetHeight() * BPP ] );
+	//wxImage stores alpha separately, so it has to be combined with the colors. RGB images can be uploaded as is.
+	std::unique_ptr<GLubyte[]> pImageData;
 
-	for( int y = 0; y < image.GetHeight(); ++y )
+	if( image.HasAlpha() )
 	{
-		for( int x = 0; x < image.GetWidth(); ++x )
-		{
-			for( int i = 0; i < 3; ++i )
-			{
-				pImageData[ ( x + y * image.GetWidth() ) * BPP + i ] = pData[ ( x + ( y ) * image.GetWidth() ) * 3 + i ];
-			}
+		pImageData.reset( new GLubyte[ uiPixels * 4 ] );
 
-			if( image.HasAlpha() )
-			{
-				pImageData[ ( x + y * image.GetWidth() ) * BPP + 3 ] = pAlpha[ x + ( y ) * image.GetWidth() ];
-			}
-		}
+		graphics::InterleaveRGBAndAlpha( pData, pAlpha, uiPixels, pImageData.get() );
 	}
 
 	const renderer::ImageFormat format = image.HasAlpha() ? renderer::ImageFormat::RGBA : renderer::ImageFormat::RGB;
 
-	renderer::HTexture_t tex = g_pRenderContext->CreateTexture( 0, format, image.GetWidth(), image.GetHeight(), pImageData.get() );
+	renderer::HTexture_t tex = g_pRenderContext->CreateTexture( 0, format, image.GetWidth(), image.GetHeight(), pImageData ? pImageData.get() : pData );
 
 	g_pRenderContext->BindTexture( tex );
 
 	g_pRenderContext->SetMinMagFilters( renderer::MinFilter::LINEAR, renderer::MagFilter::LINEAR );
 
 	//TODO: update all uses to use HTexture_t
-	return ( GLuint ) tex;
-}
\ No newline at end of file
+	return renderer::TexHandleToName( tex );
+}
+
+struct CwxOpenGL::DecodedImage_t
+{
+	int iWidth;
+	int iHeight;
+
+	bool bHasAlpha;
+
+	/**
+	*	Tightly packed RGBA pixels if the image has alpha, RGB otherwise.
+	*/
+	std::vector<GLubyte> pixels;
+};
+
+CwxOpenGL::ImageLoadHandle_t CwxOpenGL::glLoadImageAsync( const char* const pszFilename, ImageLoadedFn_t&& callback )
+{
+	if( !pszFilename || !( *pszFilename ) )
+		return INVALID_IMAGE_LOAD;
+
+	if( !wxFileExists( pszFilename ) )
+	{
+		wxMessageBox( wxString::Format( "File \"%s\" does not exist\n", pszFilename ) );
+		return INVALID_IMAGE_LOAD;
+	}
+
+	ImageLoad_t load;
+
+	load.handle = m_NextImageLoad++;
+
+	if( m_NextImageLoad == INVALID_IMAGE_LOAD )
+		m_NextImageLoad = INVALID_IMAGE_LOAD + 1;
+
+	load.szFilename = pszFilename;
+	load.callback = std::move( callback );
+	load.decoded = std::async( std::launch::async, &CwxOpenGL::DecodeImage, load.szFilename );
+
+	const ImageLoadHandle_t handle = load.handle;
+
+	m_ImageLoads.emplace_back( std::move( load ) );
+
+	return handle;
+}
+
+void CwxOpenGL::CancelImageLoad( const ImageLoadHandle_t handle )
+{
+	if( handle == INVALID_IMAGE_LOAD )
+		return;
+
+	auto it = std::find_if( m_ImageLoads.begin(), m_ImageLoads.end(), [ = ]( const ImageLoad_t& load ) { return load.handle == handle; } );
+
+	//Still decoding. Destroying the future would wait for the decode to finish, so the result is discarded once it's done instead.
+	if( it != m_ImageLoads.end() )
+	{
+		it->callback = nullptr;
+		return;
+	}
+
+	//Uploads that are no longer tracked free their texture when they finish.
+	auto upload = std::find( m_ImageUploads.begin(), m_ImageUploads.end(), handle );
+
+	if( upload != m_ImageUploads.end() )
+		m_ImageUploads.erase( upload );
+}
+
+size_t CwxOpenGL::RunImageLoads()
+{
+	if( m_ImageLoads.empty() )
+		return 0;
+
+	//Taken out first, since callbacks can start and cancel loads.
+	std::vector<ImageLoad_t> decoded;
+
+	for( auto it = m_ImageLoads.begin(); it != m_ImageLoads.end(); )
+	{
+		if( it->decoded.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+		{
+			decoded.emplace_back( std::move( *it ) );
+			it = m_ImageLoads.erase( it );
+		}
+		else
+			++it;
+	}
+
+	for( auto& load : decoded )
+	{
+		std::shared_ptr<const DecodedImage_t> image = load.decoded.get();
+
+		//Cancelled.
+		if( !load.callback )
+			continue;
+
+		if( !image )
+		{
+			wxMessageBox( wxString::Format( "An error occurred while loading \"%s\"\n", load.szFilename.c_str() ) );
+			load.callback( GL_INVALID_TEXTURE_ID );
+			continue;
+		}
+
+		//Names are created on this thread so they can be freed if the load is cancelled while uploading.
+		GLuint textureId;
+
+		glGenTextures( 1, &textureId );
+
+		const ImageLoadHandle_t handle = load.handle;
+
+		m_ImageUploads.push_back( handle );
+
+		graphics::GLUploadQueue().Queue(
+			[ = ]()
+			{
+				const GLenum format = image->bHasAlpha ? GL_RGBA : GL_RGB;
+
+				GLint oldUnpackAlignment;
+
+				glGetIntegerv( GL_UNPACK_ALIGNMENT, &oldUnpackAlignment );
+
+				//RGB rows aren't padded.
+				glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+				glBindTexture( GL_TEXTURE_2D, textureId );
+
+				glTexImage2D( GL_TEXTURE_2D, 0, format, image->iWidth, image->iHeight, 0, format, GL_UNSIGNED_BYTE, image->pixels.data() );
+
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+
+				glBindTexture( GL_TEXTURE_2D, 0 );
+
+				glPixelStorei( GL_UNPACK_ALIGNMENT, oldUnpackAlignment );
+			},
+			[ this, handle, textureId, callback = std::move( load.callback ) ]()
+			{
+				auto it = std::find( m_ImageUploads.begin(), m_ImageUploads.end(), handle );
+
+				if( it == m_ImageUploads.end() )
+				{
+					GLuint cancelledId = textureId;
+					glFreeImage( cancelledId );
+					return;
+				}
+
+				m_ImageUploads.erase( it );
+
+				callback( textureId );
+			}
+		);
+	}
+
+	return decoded.size();
+}
+
+std::shared_ptr<const CwxOpenGL::DecodedImage_t> CwxOpenGL::DecodeImage( const std::string& szFilename )
+{
+	//wxImage's reference counting isn't thread safe, so the image never leaves this thread.
+	wxImage image( szFilename );
+
+	if( !image.IsOk() )
+		return nullptr;
+
+	auto decoded = std::make_shared<DecodedImage_t>();
+
+	decoded->iWidth = image.GetWidth();
+	decoded->iHeight = image.GetHeight();
+	decoded->bHasAlpha = image.HasAlpha();
+
+	const size_t uiPixels = static_cast<size_t>( image.GetWidth() ) * image.GetHeight();
+
+	if( decoded->bHasAlpha )
+	{
+		decoded->pixels.resize( uiPixels * 4 );
+
+		graphics::InterleaveRGBAndAlpha( image.GetData(), image.GetAlpha(), uiPixels, decoded->pixels.data() );
+	}
+	else
+	{
+		decoded->pixels.assign( image.GetData(), image.GetData() + uiPixels * 3 );
+	}
+
+	return decoded;
+}
+
+void CwxOpenGL::glFreeImage( GLuint& textureId )
+{
+	if( textureId == GL_INVALID_TEXTURE_ID )
+		return;
+
+	//Created by the render context, so it's destroyed by it too if it still exists.
+	if( g_pRenderContext )
+	{
+		g_pRenderContext->DestroyTexture( renderer::NameToTexHandle( textureId ) );
+		textureId = GL_INVALID_TEXTURE_ID;
+	}
+	else
+		glDeleteTexture( textureId );
+}
@@ -1,6 +1,12 @@
 #ifndef UI_CWXOPENGL_H
 #define UI_CWXOPENGL_H
 
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "wxInclude.h"
 
 #include "graphics/OpenGL.h"
@@ -40,14 +46,96 @@ public:
 
 	GLRenderTarget* GetScratchTarget();
 
+	/**
+	*	Makes the context current without needing a visible canvas, so drawing can be done into render targets while no windows are open.
+	*	The context is shared with all canvases. A hidden window is created the first time this is called.
+	*	@return Whether the context is current.
+	*/
+	bool MakeOffscreenCurrent();
+
+	/**
+	*	Sets whether textures are uploaded on a separate thread with its own context. Must be set before the context is created.
+	*	@see graphics::CGLUploadQueue
+	*/
+	void SetUploadThreadEnabled( const bool bEnabled ) { m_bUploadThreadEnabled = bEnabled; }
+
+	bool IsUploadThreadEnabled() const { return m_bUploadThreadEnabled; }
+
+	/**
+	*	Called on the main thread once an image loaded by glLoadImageAsync can be used.
+	*	@param textureId The texture, or GL_INVALID_TEXTURE_ID if the image couldn't be loaded. Freed with glFreeImage.
+	*/
+	typedef std::function<void( GLuint textureId )> ImageLoadedFn_t;
+
+	typedef unsigned int ImageLoadHandle_t;
+
+	static const ImageLoadHandle_t INVALID_IMAGE_LOAD = 0;
+
 	using CBaseOpenGL::GetErrors;
 
 	GLuint glLoadImage( const char* const pszFilename ) override final;
 
+	/**
+	*	Loads an image like glLoadImage, but decodes it on a worker thread and uploads it through the upload queue,
+	*	so large images don't block the UI. Progress is made by RunImageLoads.
+	*	@param pszFilename Image to load.
+	*	@param callback Called once the texture is usable, or the image failed to load. Not called if the file doesn't exist.
+	*	@return Handle to cancel the load with, or INVALID_IMAGE_LOAD if the file doesn't exist.
+	*/
+	ImageLoadHandle_t glLoadImageAsync( const char* const pszFilename, ImageLoadedFn_t&& callback );
+
+	/**
+	*	Cancels a load started by glLoadImageAsync. Its callback won't be called, and its texture is freed if it was already created.
+	*	Does nothing if the load has already finished.
+	*/
+	void CancelImageLoad( const ImageLoadHandle_t handle );
+
+	/**
+	*	Queues uploads of images that have been decoded, and calls the callbacks of images that failed to load.
+	*	Must be called on the main thread with the main context current.
+	*	@return Number of loads that made progress.
+	*/
+	size_t RunImageLoads();
+
+	/**
+	*	Destroys a texture created by glLoadImage, and sets it to GL_INVALID_TEXTURE_ID.
+	*/
+	void glFreeImage( GLuint& textureId );
+
+private:
+	struct DecodedImage_t;
+
+	struct ImageLoad_t
+	{
+		ImageLoadHandle_t handle;
+
+		std::string szFilename;
+
+		ImageLoadedFn_t callback;
+
+		/**
+		*	Null if the image couldn't be decoded.
+		*/
+		std::future<std::shared_ptr<const DecodedImage_t>> decoded;
+	};
+
 private:
 	CwxOpenGL();
 	~CwxOpenGL();
 
+	/**
+	*	Creates the hidden offscreen canvas if it doesn't exist yet.
+	*	@return Whether the canvas exists.
+	*/
+	bool CreateOffscreenCanvas();
+
+	/**
+	*	Creates a context shared with the main context and starts the upload thread with it.
+	*/
+	void StartUploadThread();
+
+	static std::shared_ptr<const DecodedImage_t> DecodeImage( const std::string& szFilename );
+
 private:
 	static CwxOpenGL* m_pInstance;
 
@@ -59,6 +147,16 @@ private:
 
 	GLRenderTarget*		m_pScratchTarget = nullptr;			//Render target used for one off drawing and conversion operations.
 
+	wxFrame*			m_pOffscreenFrame = nullptr;		//Hidden window that owns the offscreen canvas.
+	wxGLCanvas*			m_pOffscreenCanvas = nullptr;		//Canvas used to make the context current when drawing offscreen.
+
+	bool				m_bUploadThreadEnabled = false;
+
+	std::vector<ImageLoad_t>		m_ImageLoads;		//Images that are being decoded.
+	std::vector<ImageLoadHandle_t>	m_ImageUploads;		//Images that are being uploaded.
+
+	ImageLoadHandle_t	m_NextImageLoad = INVALID_IMAGE_LOAD + 1;
+
 private:
 	CwxOpenGL( const CwxOpenGL& ) = delete;
 	CwxOpenGL& operator=( const CwxOpenGL& ) = delete;
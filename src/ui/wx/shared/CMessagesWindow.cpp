@@ -1,4 +1,5 @@
 #include <wx/sizer.h>
+#include <wx/checkbox.h>
 
 #include "ui/wx/utility/IWindowCloseListener.h"
 
@@ -8,9 +9,65 @@
 
 namespace ui
 {
+/**
+*	Virtual list that gets its rows from the messages window's store.
+*/
+class CMessagesListCtrl final : public wxListCtrl
+{
+public:
+	CMessagesListCtrl( CMessagesWindow* pOwner )
+		: wxListCtrl( pOwner, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxLC_HRULES | wxLC_VIRTUAL )
+		, m_pOwner( pOwner )
+	{
+		m_MessageAttr.SetTextColour( wxColor( 0, 0, 0 ) );
+		m_WarningAttr.SetTextColour( wxColor( 128, 0, 0 ) );
+		m_ErrorAttr.SetTextColour( wxColor( 255, 0, 0 ) );
+	}
+
+	wxString OnGetItemText( long item, long column ) const override
+	{
+		const auto& message = m_pOwner->GetViewMessage( static_cast<size_t>( item ) );
+
+		switch( message.type )
+		{
+		default:
+		case LogType::MESSAGE:		return message.szText;
+		case LogType::WARNING:		return "WARNING: " + message.szText;
+		case LogType::ERROR:		return "ERROR: " + message.szText;
+		case LogType::FATAL_ERROR:	return "FATAL ERROR: " + message.szText;
+		}
+	}
+
+	wxListItemAttr* OnGetItemAttr( long item ) const override
+	{
+		switch( m_pOwner->GetViewMessage( static_cast<size_t>( item ) ).type )
+		{
+		default:
+		case LogType::MESSAGE:		return &m_MessageAttr;
+		case LogType::WARNING:		return &m_WarningAttr;
+		case LogType::ERROR:
+		case LogType::FATAL_ERROR:	return &m_ErrorAttr;
+		}
+	}
+
+private:
+	CMessagesWindow* m_pOwner;
+
+	mutable wxListItemAttr m_MessageAttr;
+	mutable wxListItemAttr m_WarningAttr;
+	mutable wxListItemAttr m_ErrorAttr;
+
+private:
+	CMessagesListCtrl( const CMessagesListCtrl& ) = delete;
+	CMessagesListCtrl& operator=( const CMessagesListCtrl& ) = delete;
+};
+
 wxBEGIN_EVENT_TABLE( CMessagesWindow, wxFrame )
 	EVT_SIZE( CMessagesWindow::OnSize )
 	EVT_BUTTON( wxID_SHARED_MESSAGES_CLEAR, CMessagesWindow::OnClear )
+	EVT_CHECKBOX( wxID_SHARED_MESSAGES_SHOWMESSAGES, CMessagesWindow::OnFilterChanged )
+	EVT_CHECKBOX( wxID_SHARED_MESSAGES_SHOWWARNINGS, CMessagesWindow::OnFilterChanged )
+	EVT_CHECKBOX( wxID_SHARED_MESSAGES_SHOWERRORS, CMessagesWindow::OnFilterChanged )
 	EVT_LIST_COL_BEGIN_DRAG( wxID_ANY, CMessagesWindow::OnListColumnBeginDrag )
 	EVT_TEXT_ENTER( wxID_SHARED_MESSAGES_COMMAND, CMessagesWindow::CommandEntered )
 	EVT_SHOW( CMessagesWindow::OnShown )
@@ -21,11 +78,20 @@ CMessagesWindow::CMessagesWindow( const size_t uiMaxMessagesCount, IWindowCloseL
 	: wxFrame( nullptr, wxID_ANY, "Messages Window", wxDefaultPosition, wxDefaultSize, ( wxDEFAULT_FRAME_STYLE ) )
 	, m_uiMaxMessagesCount( 0 )
 	, m_pWindowCloseListener( pWindowCloseListener )
+	, m_FlushTimer( std::make_unique<CTimer>( this ) )
 {
 
 	wxButton* pClear = new wxButton( this, wxID_SHARED_MESSAGES_CLEAR, "Clear" );
 
-	m_pList = new wxListView( this, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxLC_HRULES );
+	m_pShowMessages = new wxCheckBox( this, wxID_SHARED_MESSAGES_SHOWMESSAGES, "Messages" );
+	m_pShowWarnings = new wxCheckBox( this, wxID_SHARED_MESSAGES_SHOWWARNINGS, "Warnings" );
+	m_pShowErrors = new wxCheckBox( this, wxID_SHARED_MESSAGES_SHOWERRORS, "Errors" );
+
+	m_pShowMessages->SetValue( true );
+	m_pShowWarnings->SetValue( true );
+	m_pShowErrors->SetValue( true );
+
+	m_pList = new CMessagesListCtrl( this );
 
 	m_pList->InsertColumn( 0, "", wxLIST_FORMAT_LEFT, wxLIST_AUTOSIZE_USEHEADER );
 
@@ -39,6 +105,9 @@ CMessagesWindow::CMessagesWindow( const size_t uiMaxMessagesCount, IWindowCloseL
 	wxBoxSizer* pBtnsSizer = new wxBoxSizer( wxHORIZONTAL );
 
 	pBtnsSizer->Add( pClear );
+	pBtnsSizer->Add( m_pShowMessages, wxSizerFlags().Centre().Border( wxLEFT ) );
+	pBtnsSizer->Add( m_pShowWarnings, wxSizerFlags().Centre().Border( wxLEFT ) );
+	pBtnsSizer->Add( m_pShowErrors, wxSizerFlags().Centre().Border( wxLEFT ) );
 
 	pSizer->Add( pBtnsSizer );
 
@@ -58,6 +127,7 @@ CMessagesWindow::CMessagesWindow( const size_t uiMaxMessagesCount, IWindowCloseL
 
 CMessagesWindow::~CMessagesWindow()
 {
+	m_FlushTimer->Stop();
 }
 
 void CMessagesWindow::SetMaxMessagesCount( const size_t uiMaxMessagesCount )
@@ -72,72 +142,66 @@ void CMessagesWindow::SetMaxMessagesCount( const size_t uiMaxMessagesCount )
 
 void CMessagesWindow::AddMessage( const LogType type, const wxString& szMessage )
 {
-	wxListItem item;
-
-	wxString szPrefix;
+	m_PendingMessages.push_back( { type, szMessage } );
 
-	item.SetId( m_pList->GetItemCount() );
-
-	switch( type )
+	if( type == LogType::FATAL_ERROR )
 	{
-	default:
-	case LogType::MESSAGE:
-		{
-			item.SetTextColour( wxColor( 0, 0, 0 ) );
-			break;
-		}
+		FlushMessages();
 
-	case LogType::WARNING:
-		{
-			item.SetTextColour( wxColor( 128, 0, 0 ) );
-			szPrefix = "WARNING: ";
-			break;
-		}
+		wxMessageBox( szMessage, "Fatal Error", wxCENTRE | wxOK | wxICON_ERROR );
+	}
+	else if( !m_FlushTimer->IsRunning() )
+	{
+		m_FlushTimer->StartOnce( FLUSH_INTERVAL );
+	}
+}
 
-	case LogType::ERROR:
-		{
-			item.SetTextColour( wxColor( 255, 0, 0 ) );
-			szPrefix = "ERROR: ";
-			break;
-		}
+void CMessagesWindow::FlushMessages()
+{
+	m_FlushTimer->Stop();
 
-	case LogType::FATAL_ERROR:
-		{
-			item.SetTextColour( wxColor( 255, 0, 0 ) );
-			szPrefix = "FATAL ERROR: ";
-			break;
-		}
-	}
+	if( m_PendingMessages.empty() )
+		return;
 
-	item.SetText( szPrefix + szMessage );
+	//Only follow new messages if the user hasn't scrolled up.
+	const bool bScrollToEnd = m_pList->GetTopItem() + m_pList->GetCountPerPage() >= m_pList->GetItemCount();
 
-	m_pList->InsertItem( item );
+	for( auto& message : m_PendingMessages )
+	{
+		if( IsTypeShown( message.type ) )
+			m_View.push_back( m_uiFirstMessageId + m_Messages.size() );
 
-	Truncate();
+		m_Messages.emplace_back( std::move( message ) );
+	}
 
-	UpdateHeader();
+	m_PendingMessages.clear();
 
-	if( type == LogType::FATAL_ERROR )
+	//Trim here so it's done once per batch.
+	if( m_Messages.size() > m_uiMaxMessagesCount )
 	{
-		wxMessageBox( szMessage, "Fatal Error", wxCENTRE | wxOK | wxICON_ERROR );
+		TruncateToCount( m_uiMaxMessagesCount );
 	}
+
+	UpdateList( bScrollToEnd );
 }
 
 void CMessagesWindow::TruncateToCount( size_t uiCount )
 {
-	const size_t uiTotal = static_cast<size_t>( m_pList->GetItemCount() );
-
-	if( uiCount >= uiTotal )
+	if( uiCount >= m_Messages.size() )
 		return;
 
-	const size_t uiRemove = uiTotal - uiCount;
+	const size_t uiRemove = m_Messages.size() - uiCount;
+
+	m_Messages.erase( m_Messages.begin(), m_Messages.begin() + uiRemove );
 
-	for( size_t uiIndex = 0; uiIndex < uiRemove; ++uiIndex )
+	m_uiFirstMessageId += uiRemove;
+
+	while( !m_View.empty() && m_View.front() < m_uiFirstMessageId )
 	{
-		m_pList->DeleteItem( 0 );
+		m_View.pop_front();
 	}
 
-	UpdateHeader();
+	UpdateList( false );
 }
 
 void CMessagesWindow::Truncate()
@@ -147,9 +211,43 @@ void CMessagesWindow::Truncate()
 
 void CMessagesWindow::Clear()
 {
-	m_pList->DeleteAllItems();
+	m_uiFirstMessageId += m_Messages.size();
 
-	UpdateHeader();
+	m_Messages.clear();
+	m_View.clear();
+
+	UpdateList( false );
+}
+
+bool CMessagesWindow::IsTypeShown( const LogType type ) const
+{
+	switch( type )
+	{
+	default:
+	case LogType::MESSAGE:		return m_pShowMessages->GetValue();
+	case LogType::WARNING:		return m_pShowWarnings->GetValue();
+	case LogType::ERROR:
+	case LogType::FATAL_ERROR:	return m_pShowErrors->GetValue();
+	}
+}
+
+void CMessagesWindow::SetTypeShown( const LogType type, const bool bShow )
+{
+	switch( type )
+	{
+	default:
+	case LogType::MESSAGE:		m_pShowMessages->SetValue( bShow ); break;
+	case LogType::WARNING:		m_pShowWarnings->SetValue( bShow ); break;
+	case LogType::ERROR:
+	case LogType::FATAL_ERROR:	m_pShowErrors->SetValue( bShow ); break;
+	}
+
+	RebuildView();
+}
+
+void CMessagesWindow::OnTimer( CTimer& timer )
+{
+	FlushMessages();
 }
 
 void CMessagesWindow::OnSize( wxSizeEvent& event )
@@ -165,6 +263,11 @@ void CMessagesWindow::OnClear( wxCommandEvent& event )
 	Clear();
 }
 
+void CMessagesWindow::OnFilterChanged( wxCommandEvent& event )
+{
+	RebuildView();
+}
+
 void CMessagesWindow::OnListColumnBeginDrag( wxListEvent& event )
 {
 	//Disallow user dragging of the header
@@ -223,8 +326,41 @@ void CMessagesWindow::UpdateHeader()
 {
 	wxListItem column;
 
-	column.SetText( wxString::Format( "Messages (%d)", m_pList->GetItemCount() ) );
+	if( m_View.size() != m_Messages.size() )
+		column.SetText( wxString::Format( "Messages (%u of %u)", static_cast<unsigned int>( m_View.size() ), static_cast<unsigned int>( m_Messages.size() ) ) );
+	else
+		column.SetText( wxString::Format( "Messages (%u)", static_cast<unsigned int>( m_Messages.size() ) ) );
 
 	m_pList->SetColumn( 0, column );
 }
+
+void CMessagesWindow::RebuildView()
+{
+	m_View.clear();
+
+	for( size_t uiIndex = 0; uiIndex < m_Messages.size(); ++uiIndex )
+	{
+		if( IsTypeShown( m_Messages[ uiIndex ].type ) )
+			m_View.push_back( m_uiFirstMessageId + uiIndex );
+	}
+
+	UpdateList( true );
+}
+
+void CMessagesWindow::UpdateList( const bool bScrollToEnd )
+{
+	m_pList->SetItemCount( static_cast<long>( m_View.size() ) );
+
+	if( bScrollToEnd && !m_View.empty() )
+		m_pList->EnsureVisible( static_cast<long>( m_View.size() - 1 ) );
+
+	m_pList->Refresh();
+
+	UpdateHeader();
+}
+
+const CMessagesWindow::Message_t& CMessagesWindow::GetViewMessage( const size_t uiIndex ) const
+{
+	return m_Messages[ m_View[ uiIndex ] - m_uiFirstMessageId ];
+}
 }
\ No newline at end of file
@@ -1,22 +1,46 @@
 #ifndef UI_CMESSAGESWINDOW_H
 #define UI_CMESSAGESWINDOW_H
 
+#include <deque>
+#include <memory>
+#include <vector>
+
 #include "ui/wx/wxInclude.h"
 
 #include <wx/listctrl.h>
 
 #include "shared/Logging.h"
 
-class wxListView;
+#include "ui/wx/utility/CTimer.h"
+
+class wxCheckBox;
 class IWindowCloseListener;
 
 namespace ui
 {
+class CMessagesListCtrl;
+
 /**
 *	A window that lists a number of log messages.
+*	Messages are kept in a store and shown by a virtual list, so only visible rows are drawn.
+*	New messages are added to the store in batches.
 */
-class CMessagesWindow final : public wxFrame, public ILogListener
+class CMessagesWindow final : public wxFrame, public ILogListener, public ITimerListener
 {
+private:
+	friend class CMessagesListCtrl;
+
+	/**
+	*	How long to wait after a message arrives before adding pending messages to the list, in milliseconds.
+	*/
+	static const int FLUSH_INTERVAL = 50;
+
+	struct Message_t
+	{
+		LogType type;
+		wxString szText;
+	};
+
 public:
 	CMessagesWindow( const size_t uiMaxMessagesCount, IWindowCloseListener* pWindowCloseListener = nullptr );
 	~CMessagesWindow();
@@ -37,22 +61,44 @@ public:
 		m_pWindowCloseListener = pListener;
 	}
 
+	/**
+	*	Adds a message. The message is shown the next time pending messages are flushed. Fatal errors are shown immediately.
+	*/
 	void AddMessage( const LogType type, const wxString& szMessage );
 
+	/**
+	*	Adds all pending messages to the store and updates the list.
+	*/
+	void FlushMessages();
+
 	void TruncateToCount( size_t uiCount );
 
 	void Truncate();
 
 	void Clear();
 
+	/**
+	*	@return Whether messages of the given type are shown.
+	*/
+	bool IsTypeShown( const LogType type ) const;
+
+	/**
+	*	Sets whether messages of the given type are shown. Fatal errors are shown along with errors.
+	*/
+	void SetTypeShown( const LogType type, const bool bShow );
+
 protected:
 	wxDECLARE_EVENT_TABLE();
 
 private:
+	void OnTimer( CTimer& timer ) override final;
+
 	void OnSize( wxSizeEvent& event );
 
 	void OnClear( wxCommandEvent& event );
 
+	void OnFilterChanged( wxCommandEvent& event );
+
 	void OnListColumnBeginDrag( wxListEvent& event );
 
 	void CommandEntered( wxCommandEvent& event );
@@ -63,19 +109,49 @@ private:
 
 	void UpdateHeader();
 
+	/**
+	*	Rebuilds the list of shown messages from the store.
+	*/
+	void RebuildView();
+
+	/**
+	*	Updates the list after messages have been added or removed.
+	*	@param bScrollToEnd Whether to scroll to the last message.
+	*/
+	void UpdateList( const bool bScrollToEnd );
+
+	const Message_t& GetViewMessage( const size_t uiIndex ) const;
+
 private:
 	size_t m_uiMaxMessagesCount;
 
 	IWindowCloseListener* m_pWindowCloseListener;
 
-	wxListView* m_pList;
+	CMessagesListCtrl* m_pList;
 
 	wxTextCtrl* m_pCommand;
 
+	wxCheckBox* m_pShowMessages;
+	wxCheckBox* m_pShowWarnings;
+	wxCheckBox* m_pShowErrors;
+
+	std::unique_ptr<CTimer> m_FlushTimer;
+
+	//All stored messages, oldest first.
+	std::deque<Message_t> m_Messages;
+
+	//Identifier of the oldest stored message. Identifiers increase by one for each message.
+	size_t m_uiFirstMessageId = 0;
+
+	//Identifiers of the stored messages that pass the filter.
+	std::deque<size_t> m_View;
+
+	std::vector<Message_t> m_PendingMessages;
+
 private:
 	CMessagesWindow( const CMessagesWindow& ) = delete;
 	CMessagesWindow& operator=( const CMessagesWindow& ) = delete;
 };
 }
 
-#endif //UI_CMESSAGESWINDOW_H
\ No newline at end of file
+#endif //UI_CMESSAGESWINDOW_H
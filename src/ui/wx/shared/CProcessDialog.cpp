@@ -1,7 +1,7 @@
-#include <wx/dir.h>
-#include <wx/filename.h>
 #include <wx/txtstrm.h>
 
+#include "ui/wx/utility/wxUtil.h"
+
 #include "CProcessDialog.h"
 
 namespace ui
@@ -9,7 +9,7 @@ namespace ui
 wxBEGIN_EVENT_TABLE( CProcessDialog, wxDialog )
 	EVT_TEXT_ENTER( wxID_PROCESSDLG_INPUT, CProcessDialog::OnSendInput )
 	EVT_BUTTON( wxID_PROCESSDLG_SENDINPUT, CProcessDialog::OnSendInput )
-	EVT_IDLE( CProcessDialog::OnIdle )
+	EVT_TIMER( wxID_PROCESSDLG_FLUSHOUTPUT, CProcessDialog::OnFlushOutput )
 	EVT_END_PROCESS( wxID_ANY, CProcessDialog::OnTerminated )
 	EVT_BUTTON( wxID_PROCESSDLG_TERMINATE, CProcessDialog::OnTerminatePressed )
 	EVT_BUTTON( wxID_PROCESSDLG_CLOSE, CProcessDialog::OnClosePressed )
@@ -21,6 +21,7 @@ CProcessDialog::CProcessDialog( wxWindow* pParent, wxWindowID ID, const wxString
 								long style,
 								const wxString& name )
 	: wxDialog( pParent, ID, szTitle, pos, size, style, name )
+	, m_FlushTimer( this, wxID_PROCESSDLG_FLUSHOUTPUT )
 {
 	m_pOutput = new wxTextCtrl( this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize( 600, 600 ), wxTE_MULTILINE | wxTE_RICH );
 	m_pOutput->SetEditable( false );
@@ -68,6 +69,8 @@ CProcessDialog::CProcessDialog( wxWindow* pParent, wxWindowID ID, const wxString
 
 CProcessDialog::~CProcessDialog()
 {
+	Terminate();
+
 	SetExecuteEnv( nullptr );
 }
 
@@ -96,8 +99,9 @@ int CProcessDialog::ShowModal()
 
 	m_bTerminated = false;
 
-	//Start sending idle events.
-	wxWakeUpIdle();
+	m_OutputReader.Start( *m_pProcess );
+
+	m_FlushTimer.Start( OUTPUT_FLUSH_INTERVAL );
 
 	if( m_bInputEnabled )
 	{
@@ -191,11 +195,14 @@ void CProcessDialog::Terminate()
 	if( !m_pProcess )
 		return;
 
-	//Pull remaining output. This won't ever get all output due to race conditions, but it will get most of it.
-	PullOutput();
-
 	wxProcess::Kill( m_pProcess->GetPid(), wxSIGTERM, wxKILL_CHILDREN );
 
+	//Killing the process closes its streams, which ends the readers. Output it wrote before it was killed is still shown.
+	m_OutputReader.Stop();
+	m_FlushTimer.Stop();
+
+	FlushOutput();
+
 	delete m_pProcess;
 	m_pProcess = nullptr;
 
@@ -204,47 +211,34 @@ void CProcessDialog::Terminate()
 	Ended();
 }
 
-void CProcessDialog::OnIdle( wxIdleEvent& event )
+void CProcessDialog::FlushOutput()
 {
-	if( !m_pProcess )
-	{
-		event.Skip();
-		return;
-	}
+	std::vector<CProcessOutputReader::Chunk_t> output;
 
-	PullOutput();
+	m_OutputReader.TakeOutput( output );
 
-	event.RequestMore();
-}
+	if( output.empty() )
+		return;
 
-void CProcessDialog::PullOutput()
-{
-	//Pull input from the input and error streams.
-	if( m_pProcess->GetInputStream() && m_pProcess->IsInputAvailable() )
-	{
-		//Use black text color.
-		m_pOutput->SetDefaultStyle( wxTextAttr( wxColor( 0, 0, 0 ) ) );
+	m_pOutput->Freeze();
 
-		wxTextInputStream in( *m_pProcess->GetInputStream() );
+	for( const auto& chunk : output )
+	{
+		//Errors are red, regular output is black.
+		m_pOutput->SetDefaultStyle( wxTextAttr( chunk.bError ? wxColor( 255, 0, 0 ) : wxColor( 0, 0, 0 ) ) );
 
-		while( !in.GetInputStream().Eof() )
-		{
-			m_pOutput->AppendText( in.ReadLine() + '\n' );
-		}
+		m_pOutput->AppendText( CProcessOutputReader::ToDisplayText( chunk ) );
 	}
 
-	if( m_pProcess->GetErrorStream() && m_pProcess->IsErrorAvailable() )
-	{
-		//Use red text color.
-		m_pOutput->SetDefaultStyle( wxTextAttr( wxColor( 255, 0, 0 ) ) );
+	m_pOutput->Thaw();
 
-		wxTextInputStream in( *m_pProcess->GetErrorStream() );
+	//Freezing prevents the control from following the output.
+	m_pOutput->ShowPosition( m_pOutput->GetLastPosition() );
+}
 
-		while( !in.GetInputStream().Eof() )
-		{
-			m_pOutput->AppendText( in.ReadLine() + '\n' );
-		}
-	}
+void CProcessDialog::OnFlushOutput( wxTimerEvent& event )
+{
+	FlushOutput();
 }
 
 void CProcessDialog::SendCurrentInput()
@@ -261,53 +255,15 @@ void CProcessDialog::Ended()
 
 void CProcessDialog::CopyOutputFiles()
 {
-	if( m_szOutputDir.IsEmpty() )
-	{
-		wxMessageBox( "Cannot copy output files, output directory unspecified!", wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
-		return;
-	}
+	wxString szLog;
 
-	if( m_OutputFileFilters.IsEmpty() )
-	{
-		m_pOutput->AppendText( "No output file filters specified\n" );
-		return;
-	}
-
-	const wxFileName inputDir( m_pEnv ? m_pEnv->cwd : "." );
+	const bool bSuccess = wx::CopyOutputFiles( m_pEnv ? m_pEnv->cwd : ".", m_szOutputDir, m_OutputFileFilters, szLog );
 
-	wxDir dir( inputDir.GetFullPath() );
+	m_pOutput->AppendText( szLog );
 
-	if( dir.IsOpened() )
+	if( !bSuccess )
 	{
-		wxString szFilename;
-
-		size_t uiNumCopied = 0;
-
-		for( const auto& szFilter : m_OutputFileFilters )
-		{
-			for( bool bContinue = dir.GetFirst( &szFilename, szFilter, wxDIR_FILES ); bContinue; bContinue = dir.GetNext( &szFilename ) )
-			{
-				const wxString szIn = dir.GetNameWithSep() + szFilename;
-				const wxString szOut = m_szOutputDir + '/' + szFilename;
-
-				if( wxCopyFile( szIn, szOut, true ) )
-				{
-					++uiNumCopied;
-
-					m_pOutput->AppendText( wxString::Format( "Copied \"%s\"\n", szFilename ) );
-				}
-				else
-				{
-					m_pOutput->AppendText( wxString::Format( "Failed to copy \"%s\"\n", szFilename ) );
-				}
-			}
-		}
-
-		m_pOutput->AppendText( wxString::Format( "%u file%s copied to %s\n", uiNumCopied, uiNumCopied != 1 ? "s" : "", m_szOutputDir ) );
-	}
-	else
-	{
-		wxMessageBox( wxString::Format( "Couldn't access directory \"%s\" contents", inputDir.GetPath() ), wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
+		wxMessageBox( szLog.Trim(), wxMessageBoxCaptionStr, wxOK | wxCENTRE | wxICON_ERROR );
 	}
 }
 
@@ -318,8 +274,11 @@ void CProcessDialog::OnSendInput( wxCommandEvent& event )
 
 void CProcessDialog::OnTerminated( wxProcessEvent& event )
 {
-	//If the process finishes before we've pulled all output, finish doing so now.
-	PullOutput();
+	//The process has exited, so the readers finish once they have read what is left in the streams.
+	m_OutputReader.Stop();
+	m_FlushTimer.Stop();
+
+	FlushOutput();
 
 	m_pOutput->SetDefaultStyle( wxTextAttr( wxColor( 0, 0, 0 ) ) );
 	m_pOutput->AppendText( wxString::Format( "\nThe program exited with exit code %d\n", event.GetExitCode() ) );
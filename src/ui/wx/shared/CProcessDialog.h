@@ -4,6 +4,9 @@
 #include "../wxInclude.h"
 
 #include <wx/process.h>
+#include <wx/timer.h>
+
+#include "CProcessOutputReader.h"
 
 namespace ui
 {
@@ -13,10 +16,17 @@ namespace ui
 *	Useful for spawning compilers and other utility programs.
 *	Supports input. This is disabled by default.
 *	Output piped through stderror is displayed as red, whereas regular output is displayed as black.
+*	Output is read by a thread per stream and added to the dialog in batches, so processes that produce a lot of output don't stall the UI.
 *	Note: you must use ShowModal.
 */
 class CProcessDialog : public wxDialog
 {
+public:
+	/**
+	*	How often output that was read is added to the dialog, in milliseconds.
+	*/
+	static const int OUTPUT_FLUSH_INTERVAL = 50;
+
 public:
 	/**
 	*	Return codes for ShowModal()
@@ -154,10 +164,13 @@ public:
 protected:
 	wxDECLARE_EVENT_TABLE();
 
-	virtual void OnIdle( wxIdleEvent& event );
-
 private:
-	void PullOutput();
+	/**
+	*	Adds all pending output to the output control.
+	*/
+	void FlushOutput();
+
+	void OnFlushOutput( wxTimerEvent& event );
 
 	void SendCurrentInput();
 
@@ -200,6 +213,10 @@ private:
 
 	bool m_bTerminated = false;
 
+	CProcessOutputReader m_OutputReader;
+
+	wxTimer m_FlushTimer;
+
 private:
 	CProcessDialog( const CProcessDialog& ) = delete;
 	CProcessDialog& operator=( const CProcessDialog& ) = delete;
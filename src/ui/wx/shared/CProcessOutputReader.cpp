@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+
+#include "CProcessOutputReader.h"
+
+namespace ui
+{
+CProcessOutputReader::~CProcessOutputReader()
+{
+	Stop();
+}
+
+void CProcessOutputReader::Start( wxProcess& process )
+{
+	wxASSERT( !m_OutputReader.joinable() && !m_ErrorReader.joinable() );
+
+	m_bStopReading = false;
+
+	if( auto pStream = process.GetInputStream() )
+		m_OutputReader = std::thread( &CProcessOutputReader::ReadStream, this, pStream, false );
+
+	if( auto pStream = process.GetErrorStream() )
+		m_ErrorReader = std::thread( &CProcessOutputReader::ReadStream, this, pStream, true );
+}
+
+void CProcessOutputReader::Stop()
+{
+	m_bStopReading = true;
+
+	if( m_OutputReader.joinable() )
+		m_OutputReader.join();
+
+	if( m_ErrorReader.joinable() )
+		m_ErrorReader.join();
+}
+
+void CProcessOutputReader::TakeOutput( std::vector<Chunk_t>& output )
+{
+	output.clear();
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	output.swap( m_PendingOutput );
+}
+
+wxString CProcessOutputReader::ToDisplayText( const Chunk_t& chunk )
+{
+	std::string szText( chunk.szText );
+
+	//Lines end in CRLF on Windows.
+	szText.erase( std::remove( szText.begin(), szText.end(), '\r' ), szText.end() );
+
+	return wxString( szText.c_str(), wxConvAuto() );
+}
+
+void CProcessOutputReader::ReadStream( wxInputStream* pStream, const bool bError )
+{
+	char buffer[ 4096 ];
+
+	//Text after the last newline that was read.
+	std::string szPartialLine;
+
+	while( true )
+	{
+		//Blocks until some output is available, then returns what is available.
+		pStream->Read( buffer, sizeof( buffer ) );
+
+		const size_t uiRead = pStream->LastRead();
+
+		if( uiRead == 0 )
+		{
+			if( pStream->Eof() || pStream->GetLastError() != wxSTREAM_NO_ERROR || m_bStopReading )
+				break;
+
+			//Pipes can be non-blocking on some platforms; don't spin while waiting for output.
+			std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+			continue;
+		}
+
+		const char* const pszEnd = buffer + uiRead;
+
+		const char* pszLastNewline = nullptr;
+
+		for( const char* pszChar = pszEnd; pszChar != buffer; --pszChar )
+		{
+			if( pszChar[ -1 ] == '\n' )
+			{
+				pszLastNewline = pszChar - 1;
+				break;
+			}
+		}
+
+		if( !pszLastNewline )
+		{
+			szPartialLine.append( buffer, uiRead );
+			continue;
+		}
+
+		szPartialLine.append( buffer, pszLastNewline + 1 );
+
+		Queue( bError, szPartialLine.data(), szPartialLine.size() );
+
+		szPartialLine.assign( pszLastNewline + 1, pszEnd );
+	}
+
+	if( !szPartialLine.empty() )
+	{
+		szPartialLine += '\n';
+
+		Queue( bError, szPartialLine.data(), szPartialLine.size() );
+	}
+}
+
+void CProcessOutputReader::Queue( const bool bError, const char* pszText, const size_t uiLength )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	//Consecutive output from the same stream is merged so the UI can add it in one go.
+	if( !m_PendingOutput.empty() && m_PendingOutput.back().bError == bError )
+	{
+		m_PendingOutput.back().szText.append( pszText, uiLength );
+	}
+	else
+	{
+		m_PendingOutput.push_back( { bError, std::string( pszText, uiLength ) } );
+	}
+}
+}
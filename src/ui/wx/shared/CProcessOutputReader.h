@@ -0,0 +1,88 @@
+#ifndef UI_WX_SHARED_CPROCESSOUTPUTREADER_H
+#define UI_WX_SHARED_CPROCESSOUTPUTREADER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../wxInclude.h"
+
+#include <wx/process.h>
+
+namespace ui
+{
+/**
+*	Reads the output and error streams of a redirected process, with a thread per stream.
+*	Output is collected until the UI takes it, so processes that produce a lot of output don't stall the UI.
+*/
+class CProcessOutputReader final
+{
+public:
+	/**
+	*	Output read from one of the process' streams.
+	*/
+	struct Chunk_t
+	{
+		bool bError;
+		std::string szText;
+	};
+
+public:
+	CProcessOutputReader() = default;
+	~CProcessOutputReader();
+
+	/**
+	*	Starts reading the process' streams. The process must have been redirected and must outlive the reader threads.
+	*/
+	void Start( wxProcess& process );
+
+	/**
+	*	Waits for the reader threads to finish. The process must have exited or been killed, so the streams reach their end.
+	*/
+	void Stop();
+
+	/**
+	*	Moves all output that was read so far into output, in the order it was read.
+	*	Consecutive output from the same stream is merged into one chunk.
+	*/
+	void TakeOutput( std::vector<Chunk_t>& output );
+
+	/**
+	*	Converts the text of a chunk for display.
+	*/
+	static wxString ToDisplayText( const Chunk_t& chunk );
+
+private:
+	/**
+	*	Reads a stream until it ends. Runs on a reader thread.
+	*	Only whole lines are passed on, so interleaved output and error lines stay intact.
+	*/
+	void ReadStream( wxInputStream* pStream, const bool bError );
+
+	void Queue( const bool bError, const char* pszText, const size_t uiLength );
+
+private:
+	std::thread m_OutputReader;
+	std::thread m_ErrorReader;
+
+	/**
+	*	Tells the reader threads to stop if their stream hasn't ended by the next time they check.
+	*/
+	std::atomic<bool> m_bStopReading{ false };
+
+	/**
+	*	Guards m_PendingOutput.
+	*/
+	std::mutex m_Mutex;
+
+	std::vector<Chunk_t> m_PendingOutput;
+
+private:
+	CProcessOutputReader( const CProcessOutputReader& ) = delete;
+	CProcessOutputReader& operator=( const CProcessOutputReader& ) = delete;
+};
+}
+
+#endif //UI_WX_SHARED_CPROCESSOUTPUTREADER_H
@@ -0,0 +1,552 @@
+#include <algorithm>
+#include <thread>
+
+#include "ui/wx/utility/wxUtil.h"
+
+#include "CProcessQueueDialog.h"
+
+namespace ui
+{
+namespace
+{
+/**
+*	How often output is collected and progress is updated, in milliseconds.
+*/
+const int UPDATE_INTERVAL = 50;
+
+enum JobColumn
+{
+	JOB_COLUMN_NAME = 0,
+	JOB_COLUMN_STATUS,
+	JOB_COLUMN_TIME
+};
+}
+
+/**
+*	Tells the dialog when the job's process exits. If the dialog is destroyed first, the process deletes itself when it exits.
+*/
+class CProcessQueueDialog::CJobProcess final : public wxProcess
+{
+public:
+	CJobProcess( CProcessQueueDialog* pDialog, const size_t uiIndex )
+		: wxProcess( wxPROCESS_REDIRECT )
+		, m_pDialog( pDialog )
+		, m_uiIndex( uiIndex )
+	{
+	}
+
+	/**
+	*	Detaches the process from the dialog.
+	*/
+	void Orphan()
+	{
+		m_pDialog = nullptr;
+	}
+
+	void OnTerminate( int iPid, int iStatus ) override
+	{
+		if( m_pDialog )
+			m_pDialog->OnJobExited( m_uiIndex, iStatus );
+		else
+			delete this;
+	}
+
+private:
+	CProcessQueueDialog* m_pDialog;
+	const size_t m_uiIndex;
+};
+
+wxBEGIN_EVENT_TABLE( CProcessQueueDialog, wxDialog )
+	EVT_TIMER( wxID_PROCESSQUEUEDLG_UPDATE, CProcessQueueDialog::OnUpdate )
+	EVT_LIST_ITEM_SELECTED( wxID_PROCESSQUEUEDLG_JOBS, CProcessQueueDialog::OnJobSelected )
+	EVT_BUTTON( wxID_PROCESSQUEUEDLG_CANCEL, CProcessQueueDialog::OnCancelPressed )
+	EVT_BUTTON( wxID_PROCESSQUEUEDLG_CLOSE, CProcessQueueDialog::OnClosePressed )
+wxEND_EVENT_TABLE()
+
+CProcessQueueDialog::CProcessQueueDialog( wxWindow* pParent, wxWindowID id, const wxString& szTitle, const size_t uiMaxRunning )
+	: wxDialog( pParent, id, szTitle, wxDefaultPosition, wxDefaultSize, wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER )
+	, m_UpdateTimer( this, wxID_PROCESSQUEUEDLG_UPDATE )
+	, m_uiMaxRunning( uiMaxRunning > 0 ? uiMaxRunning : std::max( 1u, std::thread::hardware_concurrency() ) )
+{
+	m_pJobList = new wxListCtrl( this, wxID_PROCESSQUEUEDLG_JOBS, wxDefaultPosition, wxSize( 600, 200 ), wxLC_REPORT | wxLC_SINGLE_SEL );
+
+	m_pJobList->AppendColumn( "Job", wxLIST_FORMAT_LEFT, 400 );
+	m_pJobList->AppendColumn( "Status", wxLIST_FORMAT_LEFT, 110 );
+	m_pJobList->AppendColumn( "Time", wxLIST_FORMAT_RIGHT, 70 );
+
+	m_pOutput = new wxTextCtrl( this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize( 600, 300 ), wxTE_MULTILINE | wxTE_RICH );
+	m_pOutput->SetEditable( false );
+
+	m_pProgress = new wxGauge( this, wxID_ANY, 1 );
+
+	m_pStatus = new wxStaticText( this, wxID_ANY, wxEmptyString );
+
+	m_pCancel = new wxButton( this, wxID_PROCESSQUEUEDLG_CANCEL, "Cancel" );
+
+	m_pClose = new wxButton( this, wxID_PROCESSQUEUEDLG_CLOSE, "Close" );
+	m_pClose->Enable( false );
+
+	//Layout
+	auto pSizer = new wxBoxSizer( wxVERTICAL );
+
+	pSizer->Add( m_pJobList, wxSizerFlags().Expand().DoubleBorder() );
+	pSizer->Add( m_pOutput, wxSizerFlags().Expand().Proportion( 1 ).DoubleBorder( wxLEFT | wxRIGHT ) );
+	pSizer->Add( m_pProgress, wxSizerFlags().Expand().DoubleBorder() );
+	pSizer->Add( m_pStatus, wxSizerFlags().Expand().DoubleBorder( wxLEFT | wxRIGHT ) );
+
+	auto pButtonsSizer = new wxBoxSizer( wxHORIZONTAL );
+
+	pButtonsSizer->Add( m_pCancel, wxSizerFlags() );
+	pButtonsSizer->Add( m_pClose, wxSizerFlags().DoubleBorder( wxLEFT ) );
+
+	pSizer->Add( pButtonsSizer, wxSizerFlags().Align( wxALIGN_RIGHT ).DoubleBorder() );
+
+	this->SetSizer( pSizer );
+
+	this->Fit();
+	this->CenterOnScreen();
+}
+
+CProcessQueueDialog::~CProcessQueueDialog()
+{
+	m_UpdateTimer.Stop();
+
+	for( auto& job : m_Jobs )
+	{
+		if( !job->pProcess )
+			continue;
+
+		if( !job->bExited )
+			wxProcess::Kill( job->pProcess->GetPid(), wxSIGTERM, wxKILL_CHILDREN );
+
+		job->reader.Stop();
+
+		if( job->bExited )
+		{
+			delete job->pProcess;
+		}
+		else
+		{
+			//Deletes itself once it has exited.
+			job->pProcess->Orphan();
+		}
+
+		job->pProcess = nullptr;
+	}
+}
+
+void CProcessQueueDialog::AddJob( const Job_t& job )
+{
+	wxASSERT( !IsModal() );
+
+	auto state = std::make_unique<JobState_t>();
+
+	state->job = job;
+
+	const long iIndex = static_cast<long>( m_Jobs.size() );
+
+	m_Jobs.emplace_back( std::move( state ) );
+
+	m_pJobList->InsertItem( iIndex, job.szName );
+
+	UpdateJobItem( iIndex );
+}
+
+bool CProcessQueueDialog::DidJobSucceed( const size_t uiIndex ) const
+{
+	return uiIndex < m_Jobs.size() && m_Jobs[ uiIndex ]->status == JobStatus::SUCCEEDED;
+}
+
+int CProcessQueueDialog::ShowModal()
+{
+	if( m_Jobs.empty() )
+		return NO_JOBS;
+
+	m_StartTime = std::chrono::steady_clock::now();
+
+	m_pProgress->SetRange( static_cast<int>( m_Jobs.size() ) );
+
+	StartPendingJobs();
+
+	m_pJobList->SetItemState( 0, wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED, wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED );
+
+	ShowJobLog( 0 );
+
+	UpdateProgress();
+
+	m_UpdateTimer.Start( UPDATE_INTERVAL );
+
+	return wxDialog::ShowModal();
+}
+
+void CProcessQueueDialog::EndModal( int iReturnCode )
+{
+	//Jobs have to be cancelled before the dialog can be closed.
+	if( IsRunning() )
+		return;
+
+	m_UpdateTimer.Stop();
+
+	if( m_bCancelled )
+		iReturnCode = CANCELLED;
+	else if( m_uiFailed > 0 )
+		iReturnCode = FAILED;
+	else
+		iReturnCode = SUCCESS;
+
+	wxDialog::EndModal( iReturnCode );
+}
+
+wxString CProcessQueueDialog::GetErrorString( const int iReturnCode ) const
+{
+	switch( iReturnCode )
+	{
+	case SUCCESS:	return wxString::Format( "All %u jobs completed successfully", static_cast<unsigned int>( m_Jobs.size() ) );
+
+	case NO_JOBS:	return "No jobs were added";
+
+	case FAILED:	return wxString::Format( "%u of %u jobs failed", static_cast<unsigned int>( m_uiFailed ), static_cast<unsigned int>( m_Jobs.size() ) );
+
+	case CANCELLED:	return wxString::Format( "The queue was cancelled after %u of %u jobs finished",
+											 static_cast<unsigned int>( m_uiSucceeded + m_uiFailed ), static_cast<unsigned int>( m_Jobs.size() ) );
+
+	default:		return wxString::Format( "Unknown error code \"%d\"", iReturnCode );
+	}
+}
+
+void CProcessQueueDialog::StartPendingJobs()
+{
+	while( m_uiRunning < m_uiMaxRunning && m_uiNextJob < m_Jobs.size() )
+	{
+		StartJob( m_uiNextJob++ );
+	}
+}
+
+void CProcessQueueDialog::StartJob( const size_t uiIndex )
+{
+	auto& state = *m_Jobs[ uiIndex ];
+
+	AddToLog( uiIndex, false, wxString::Format( "Command line parameters: %s\n", state.job.szCommand ) );
+
+	state.pProcess = new CJobProcess( this, uiIndex );
+
+	wxExecuteEnv env;
+
+	env.cwd = state.job.szWorkingDirectory;
+
+	state.startTime = std::chrono::steady_clock::now();
+
+	const long iPid = wxExecute( state.job.szCommand, wxEXEC_ASYNC | wxEXEC_HIDE_CONSOLE | wxEXEC_MAKE_GROUP_LEADER, state.pProcess, &env );
+
+	if( iPid == 0 )
+	{
+		delete state.pProcess;
+		state.pProcess = nullptr;
+
+		AddToLog( uiIndex, true, wxString::Format( "Could not execute command \"%s\"\n", state.job.szCommand ) );
+
+		state.status = JobStatus::FAILED;
+		++m_uiFailed;
+
+		UpdateJobItem( uiIndex );
+		return;
+	}
+
+	state.status = JobStatus::RUNNING;
+	++m_uiRunning;
+
+	state.reader.Start( *state.pProcess );
+
+	UpdateJobItem( uiIndex );
+}
+
+void CProcessQueueDialog::UpdateJobs()
+{
+	std::vector<CProcessOutputReader::Chunk_t> output;
+
+	for( size_t uiIndex = 0; uiIndex < m_Jobs.size(); ++uiIndex )
+	{
+		auto& state = *m_Jobs[ uiIndex ];
+
+		if( state.status != JobStatus::RUNNING )
+			continue;
+
+		state.reader.TakeOutput( output );
+
+		AddToLog( uiIndex, output );
+
+		if( state.bExited )
+			FinishJob( uiIndex );
+		else
+			UpdateJobItem( uiIndex );
+	}
+
+	if( !m_bCancelled )
+		StartPendingJobs();
+
+	if( !IsRunning() )
+	{
+		m_flTotalSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - m_StartTime ).count();
+
+		m_UpdateTimer.Stop();
+
+		m_pCancel->Enable( false );
+		m_pClose->Enable( true );
+	}
+
+	UpdateProgress();
+}
+
+void CProcessQueueDialog::FinishJob( const size_t uiIndex )
+{
+	auto& state = *m_Jobs[ uiIndex ];
+
+	//The process has exited, so the readers finish once they have read what is left in the streams.
+	state.reader.Stop();
+
+	std::vector<CProcessOutputReader::Chunk_t> output;
+
+	state.reader.TakeOutput( output );
+
+	AddToLog( uiIndex, output );
+
+	delete state.pProcess;
+	state.pProcess = nullptr;
+
+	state.flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - state.startTime ).count();
+
+	--m_uiRunning;
+
+	if( state.bCancelled )
+	{
+		AddToLog( uiIndex, true, "\nThe job was cancelled before it could finish\n" );
+
+		state.status = JobStatus::CANCELLED;
+	}
+	else
+	{
+		AddToLog( uiIndex, false, wxString::Format( "\nThe program exited with exit code %d\n", state.iExitCode ) );
+
+		bool bSuccess = state.iExitCode == 0;
+
+		//Don't copy incomplete or stale output of failed jobs.
+		if( bSuccess && state.job.bCopyFiles )
+		{
+			wxString szLog;
+
+			const bool bCopied = wx::CopyOutputFiles( state.job.szWorkingDirectory, state.job.szOutputDirectory, state.job.outputFileFilters, szLog );
+
+			AddToLog( uiIndex, !bCopied, "\n" + szLog );
+
+			bSuccess = bCopied;
+		}
+
+		if( bSuccess )
+		{
+			state.status = JobStatus::SUCCEEDED;
+			++m_uiSucceeded;
+		}
+		else
+		{
+			state.status = JobStatus::FAILED;
+			++m_uiFailed;
+		}
+	}
+
+	UpdateJobItem( uiIndex );
+}
+
+void CProcessQueueDialog::OnJobExited( const size_t uiIndex, const int iExitCode )
+{
+	auto& state = *m_Jobs[ uiIndex ];
+
+	//Finished on the next update, after the last output has been read.
+	state.bExited = true;
+	state.iExitCode = iExitCode;
+}
+
+void CProcessQueueDialog::AddToLog( const size_t uiIndex, const bool bError, const wxString& szText )
+{
+	auto& log = m_Jobs[ uiIndex ]->log;
+
+	const wxScopedCharBuffer text = szText.utf8_str();
+
+	log.push_back( { bError, std::string( text.data(), text.length() ) } );
+
+	if( static_cast<long>( uiIndex ) == m_iShownJob )
+		AppendToOutput( log.back() );
+}
+
+void CProcessQueueDialog::AddToLog( const size_t uiIndex, std::vector<CProcessOutputReader::Chunk_t>& output )
+{
+	if( output.empty() )
+		return;
+
+	auto& log = m_Jobs[ uiIndex ]->log;
+
+	const bool bShown = static_cast<long>( uiIndex ) == m_iShownJob;
+
+	if( bShown )
+		m_pOutput->Freeze();
+
+	for( auto& chunk : output )
+	{
+		log.emplace_back( std::move( chunk ) );
+
+		if( bShown )
+			AppendToOutput( log.back() );
+	}
+
+	if( bShown )
+	{
+		m_pOutput->Thaw();
+		m_pOutput->ShowPosition( m_pOutput->GetLastPosition() );
+	}
+
+	output.clear();
+}
+
+void CProcessQueueDialog::AppendToOutput( const CProcessOutputReader::Chunk_t& chunk )
+{
+	//Errors are red, regular output is black.
+	m_pOutput->SetDefaultStyle( wxTextAttr( chunk.bError ? wxColor( 255, 0, 0 ) : wxColor( 0, 0, 0 ) ) );
+
+	m_pOutput->AppendText( CProcessOutputReader::ToDisplayText( chunk ) );
+}
+
+void CProcessQueueDialog::ShowJobLog( const long iIndex )
+{
+	m_iShownJob = iIndex;
+
+	m_pOutput->Freeze();
+
+	m_pOutput->Clear();
+
+	if( iIndex >= 0 && static_cast<size_t>( iIndex ) < m_Jobs.size() )
+	{
+		for( const auto& chunk : m_Jobs[ iIndex ]->log )
+		{
+			AppendToOutput( chunk );
+		}
+	}
+
+	m_pOutput->Thaw();
+
+	m_pOutput->ShowPosition( m_pOutput->GetLastPosition() );
+}
+
+void CProcessQueueDialog::UpdateJobItem( const size_t uiIndex )
+{
+	const auto& state = *m_Jobs[ uiIndex ];
+
+	const long iItem = static_cast<long>( uiIndex );
+
+	const char* pszStatus;
+
+	switch( state.status )
+	{
+	default:
+	case JobStatus::PENDING:	pszStatus = "Pending"; break;
+	case JobStatus::RUNNING:	pszStatus = "Running"; break;
+	case JobStatus::SUCCEEDED:	pszStatus = "Succeeded"; break;
+	case JobStatus::FAILED:		pszStatus = "Failed"; break;
+	case JobStatus::CANCELLED:	pszStatus = "Cancelled"; break;
+	}
+
+	m_pJobList->SetItem( iItem, JOB_COLUMN_STATUS, pszStatus );
+
+	if( state.status == JobStatus::RUNNING )
+	{
+		const double flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - state.startTime ).count();
+
+		m_pJobList->SetItem( iItem, JOB_COLUMN_TIME, wxString::Format( "%.1f s", flSeconds ) );
+	}
+	else if( state.status != JobStatus::PENDING && state.flSeconds > 0 )
+	{
+		m_pJobList->SetItem( iItem, JOB_COLUMN_TIME, wxString::Format( "%.1f s", state.flSeconds ) );
+	}
+	else
+	{
+		m_pJobList->SetItem( iItem, JOB_COLUMN_TIME, wxEmptyString );
+	}
+
+	switch( state.status )
+	{
+	case JobStatus::FAILED:		m_pJobList->SetItemTextColour( iItem, wxColor( 255, 0, 0 ) ); break;
+	case JobStatus::CANCELLED:	m_pJobList->SetItemTextColour( iItem, wxColor( 128, 128, 128 ) ); break;
+	default:					m_pJobList->SetItemTextColour( iItem, m_pJobList->GetTextColour() ); break;
+	}
+}
+
+void CProcessQueueDialog::UpdateProgress()
+{
+	size_t uiFinished = 0;
+
+	for( const auto& job : m_Jobs )
+	{
+		if( job->status != JobStatus::PENDING && job->status != JobStatus::RUNNING )
+			++uiFinished;
+	}
+
+	m_pProgress->SetValue( static_cast<int>( uiFinished ) );
+
+	const unsigned int uiCount = static_cast<unsigned int>( m_Jobs.size() );
+
+	if( IsRunning() )
+	{
+		const double flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - m_StartTime ).count();
+
+		m_pStatus->SetLabel( wxString::Format( "%u of %u jobs finished, %u running (at most %u), %u failed. Elapsed: %.1f s",
+											   static_cast<unsigned int>( uiFinished ), uiCount,
+											   static_cast<unsigned int>( m_uiRunning ), static_cast<unsigned int>( m_uiMaxRunning ),
+											   static_cast<unsigned int>( m_uiFailed ), flSeconds ) );
+	}
+	else
+	{
+		m_pStatus->SetLabel( wxString::Format( "Finished %u jobs in %.1f s: %u succeeded, %u failed, %u cancelled",
+											   uiCount, m_flTotalSeconds,
+											   static_cast<unsigned int>( m_uiSucceeded ), static_cast<unsigned int>( m_uiFailed ),
+											   static_cast<unsigned int>( uiFinished - m_uiSucceeded - m_uiFailed ) ) );
+	}
+}
+
+void CProcessQueueDialog::OnUpdate( wxTimerEvent& event )
+{
+	UpdateJobs();
+}
+
+void CProcessQueueDialog::OnJobSelected( wxListEvent& event )
+{
+	ShowJobLog( event.GetIndex() );
+}
+
+void CProcessQueueDialog::OnCancelPressed( wxCommandEvent& event )
+{
+	m_bCancelled = true;
+
+	m_pCancel->Enable( false );
+
+	for( ; m_uiNextJob < m_Jobs.size(); ++m_uiNextJob )
+	{
+		m_Jobs[ m_uiNextJob ]->status = JobStatus::CANCELLED;
+
+		UpdateJobItem( m_uiNextJob );
+	}
+
+	//Running jobs are finished by the next update once their processes have exited.
+	for( const auto& job : m_Jobs )
+	{
+		if( job->status == JobStatus::RUNNING && !job->bExited )
+		{
+			job->bCancelled = true;
+
+			wxProcess::Kill( job->pProcess->GetPid(), wxSIGTERM, wxKILL_CHILDREN );
+		}
+	}
+}
+
+void CProcessQueueDialog::OnClosePressed( wxCommandEvent& event )
+{
+	EndModal( SUCCESS );
+}
+}
@@ -0,0 +1,233 @@
+#ifndef UI_WX_SHARED_CPROCESSQUEUEDIALOG_H
+#define UI_WX_SHARED_CPROCESSQUEUEDIALOG_H
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "../wxInclude.h"
+
+#include <wx/listctrl.h>
+#include <wx/process.h>
+#include <wx/timer.h>
+
+#include "CProcessOutputReader.h"
+
+namespace ui
+{
+/**
+*	@brief A dialog that runs a queue of child processes, several at a time, and shows their progress and output.
+*
+*	Useful for compiling or decompiling many files at once.
+*	Each job's output is kept separately and shown when the job is selected. Output files are copied after each job that succeeds.
+*	Note: you must use ShowModal.
+*/
+class CProcessQueueDialog final : public wxDialog
+{
+public:
+	/**
+	*	Return codes for ShowModal()
+	*/
+	enum ReturnCode
+	{
+		/**
+		*	All jobs completed successfully.
+		*/
+		SUCCESS,
+
+		/**
+		*	No jobs were added.
+		*/
+		NO_JOBS,
+
+		/**
+		*	One or more jobs failed or couldn't be started.
+		*/
+		FAILED,
+
+		/**
+		*	The queue was cancelled before all jobs completed.
+		*/
+		CANCELLED
+	};
+
+	struct Job_t
+	{
+		/**
+		*	Name to show in the job list.
+		*/
+		wxString szName;
+
+		wxString szCommand;
+
+		wxString szWorkingDirectory;
+
+		bool bCopyFiles = false;
+
+		wxString szOutputDirectory;
+
+		wxArrayString outputFileFilters;
+	};
+
+private:
+	enum class JobStatus
+	{
+		PENDING = 0,
+		RUNNING,
+		SUCCEEDED,
+		FAILED,
+		CANCELLED
+	};
+
+	class CJobProcess;
+
+	struct JobState_t
+	{
+		Job_t job;
+
+		JobStatus status = JobStatus::PENDING;
+
+		/**
+		*	Everything the job printed, and messages about it.
+		*/
+		std::vector<CProcessOutputReader::Chunk_t> log;
+
+		CJobProcess* pProcess = nullptr;
+
+		CProcessOutputReader reader;
+
+		bool bExited = false;
+		int iExitCode = 0;
+
+		/**
+		*	Whether the process was killed because the queue was cancelled.
+		*/
+		bool bCancelled = false;
+
+		std::chrono::steady_clock::time_point startTime;
+
+		double flSeconds = 0;
+	};
+
+public:
+	/**
+	*	@param uiMaxRunning Maximum number of jobs that run at the same time. 0 uses the number of cores.
+	*/
+	CProcessQueueDialog( wxWindow* pParent, wxWindowID id, const wxString& szTitle, const size_t uiMaxRunning = 0 );
+	~CProcessQueueDialog();
+
+	/**
+	*	Adds a job to the end of the queue. Must be called before ShowModal.
+	*/
+	void AddJob( const Job_t& job );
+
+	size_t GetJobCount() const { return m_Jobs.size(); }
+
+	size_t GetSucceededCount() const { return m_uiSucceeded; }
+
+	size_t GetFailedCount() const { return m_uiFailed; }
+
+	/**
+	*	@return Whether the job at the given index completed successfully.
+	*/
+	bool DidJobSucceed( const size_t uiIndex ) const;
+
+	//Overridden to start the jobs.
+	virtual int ShowModal() override final;
+
+	//Overridden to ignore close requests while jobs are running.
+	virtual void EndModal( int iReturnCode ) override final;
+
+	/**
+	*	Gets a string describing the given return code.
+	*	@param iReturnCode Return Code. Must be one of the ReturnCode enum.
+	*/
+	wxString GetErrorString( const int iReturnCode ) const;
+
+protected:
+	wxDECLARE_EVENT_TABLE();
+
+private:
+	/**
+	*	Starts pending jobs until the maximum number of jobs are running.
+	*/
+	void StartPendingJobs();
+
+	void StartJob( const size_t uiIndex );
+
+	/**
+	*	Collects output from running jobs and finishes the jobs that have exited.
+	*/
+	void UpdateJobs();
+
+	void FinishJob( const size_t uiIndex );
+
+	/**
+	*	Called by a job's process when it exits.
+	*/
+	void OnJobExited( const size_t uiIndex, const int iExitCode );
+
+	void AddToLog( const size_t uiIndex, const bool bError, const wxString& szText );
+
+	void AddToLog( const size_t uiIndex, std::vector<CProcessOutputReader::Chunk_t>& output );
+
+	void AppendToOutput( const CProcessOutputReader::Chunk_t& chunk );
+
+	void ShowJobLog( const long iIndex );
+
+	void UpdateJobItem( const size_t uiIndex );
+
+	void UpdateProgress();
+
+	bool IsRunning() const { return m_uiRunning > 0 || m_uiNextJob < m_Jobs.size(); }
+
+	void OnUpdate( wxTimerEvent& event );
+
+	void OnJobSelected( wxListEvent& event );
+
+	void OnCancelPressed( wxCommandEvent& event );
+
+	void OnClosePressed( wxCommandEvent& event );
+
+private:
+	wxListCtrl* m_pJobList;
+	wxTextCtrl* m_pOutput;
+	wxGauge* m_pProgress;
+	wxStaticText* m_pStatus;
+
+	wxButton* m_pCancel;
+	wxButton* m_pClose;
+
+	wxTimer m_UpdateTimer;
+
+	const size_t m_uiMaxRunning;
+
+	std::vector<std::unique_ptr<JobState_t>> m_Jobs;
+
+	/**
+	*	Index of the next job to start.
+	*/
+	size_t m_uiNextJob = 0;
+
+	size_t m_uiRunning = 0;
+	size_t m_uiSucceeded = 0;
+	size_t m_uiFailed = 0;
+
+	bool m_bCancelled = false;
+
+	/**
+	*	Job whose log is shown, or -1.
+	*/
+	long m_iShownJob = -1;
+
+	std::chrono::steady_clock::time_point m_StartTime;
+
+	double m_flTotalSeconds = 0;
+
+private:
+	CProcessQueueDialog( const CProcessQueueDialog& ) = delete;
+	CProcessQueueDialog& operator=( const CProcessQueueDialog& ) = delete;
+};
+}
+
+#endif //UI_WX_SHARED_CPROCESSQUEUEDIALOG_H
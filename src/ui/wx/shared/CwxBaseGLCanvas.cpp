@@ -1,9 +1,59 @@
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "shared/Logging.h"
+#include "shared/Profiler.h"
+
+#include "utility/CCommand.h"
+
+#include "cvar/CConCommand.h"
+
+#include "graphics/FrameCapture.h"
+
 #include "ui/wx/CwxOpenGL.h"
 
 #include "CwxBaseGLCanvas.h"
 
 namespace ui
 {
+namespace
+{
+/**
+*	Frames drawn by r_replayframe by default.
+*/
+const unsigned int DEFAULT_REPLAY_FRAMES = 100;
+
+static CwxBaseGLCanvas* g_pLastPaintedCanvas = nullptr;
+
+void PrintReplayStats( const char* const pszName, std::vector<float>& times )
+{
+	profiler::SeriesStats_t stats{};
+
+	profiler::ComputeStats( times.data(), times.size(), stats );
+
+	Message( "%-8s average %8.3f ms, p50 %8.3f ms, p95 %8.3f ms, p99 %8.3f ms, max %8.3f ms\n",
+			 pszName, stats.flAverage, stats.flP50, stats.flP95, stats.flP99, stats.flMax );
+}
+
+static cvar::CConCommand r_replayframe( "r_replayframe",
+	[]( const util::CCommand& args )
+	{
+		auto pCanvas = CwxBaseGLCanvas::GetLastPaintedCanvas();
+
+		if( !pCanvas )
+		{
+			Message( "No view has been drawn yet\n" );
+			return;
+		}
+
+		const int iCount = args.ArgC() >= 2 ? atoi( args.Arg( 1 ) ) : static_cast<int>( DEFAULT_REPLAY_FRAMES );
+
+		pCanvas->ReplayFrame( iCount > 0 ? static_cast<unsigned int>( iCount ) : DEFAULT_REPLAY_FRAMES );
+	},
+	cvar::Flag::NONE, "Draws the last drawn view's current frame repeatedly and prints how long it takes. Usage: r_replayframe [count]" );
+}
+
 wxBEGIN_EVENT_TABLE( CwxBaseGLCanvas, wxGLCanvas )
 	EVT_PAINT( CwxBaseGLCanvas::Paint )
 wxEND_EVENT_TABLE()
@@ -20,6 +70,53 @@ CwxBaseGLCanvas::CwxBaseGLCanvas( wxWindow* pParent, wxWindowID id,
 
 CwxBaseGLCanvas::~CwxBaseGLCanvas()
 {
+	if( g_pLastPaintedCanvas == this )
+		g_pLastPaintedCanvas = nullptr;
+}
+
+void CwxBaseGLCanvas::ReplayFrame( const unsigned int uiCount )
+{
+	SetCurrent( *m_pContext );
+
+	std::vector<float> submitTimes;
+	std::vector<float> frameTimes;
+
+	submitTimes.reserve( uiCount );
+	frameTimes.reserve( uiCount );
+
+	//Don't measure work left over from earlier frames.
+	glFinish();
+
+	for( unsigned int uiFrame = 0; uiFrame < uiCount; ++uiFrame )
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		DrawScene();
+
+		const auto submitted = std::chrono::steady_clock::now();
+
+		glFinish();
+
+		const auto finished = std::chrono::steady_clock::now();
+
+		submitTimes.push_back( std::chrono::duration<float, std::milli>( submitted - start ).count() );
+		frameTimes.push_back( std::chrono::duration<float, std::milli>( finished - start ).count() );
+	}
+
+	SwapBuffers();
+
+	wxOpenGL().GetErrors();
+
+	Message( "Replayed %u frames at %dx%d\n", uiCount, GetClientSize().GetWidth(), GetClientSize().GetHeight() );
+
+	//Submit is the time spent making calls, frame also includes waiting for the GPU.
+	PrintReplayStats( "Submit", submitTimes );
+	PrintReplayStats( "Frame", frameTimes );
+}
+
+CwxBaseGLCanvas* CwxBaseGLCanvas::GetLastPaintedCanvas()
+{
+	return g_pLastPaintedCanvas;
 }
 
 void CwxBaseGLCanvas::Paint( wxPaintEvent& event )
@@ -29,11 +126,17 @@ void CwxBaseGLCanvas::Paint( wxPaintEvent& event )
 	//Can't use the DC to draw anything since OpenGL draws over it.
 	wxPaintDC( this );
 
+	g_pLastPaintedCanvas = this;
+
+	graphics::BeginFrameCapture();
+
 	DrawScene();
 
 	SwapBuffers();
 
+	graphics::EndFrameCapture();
+
 	//Get any errors that were logged during this frame.
 	wxOpenGL().GetErrors();
 }
-}
\ No newline at end of file
+}
@@ -26,6 +26,17 @@ protected:
 public:
 	virtual ~CwxBaseGLCanvas();
 
+	/**
+	*	Draws the current frame uiCount times in a row, waiting for each one to finish, and prints how long the frames took.
+	*	Nothing is updated in between, so every frame makes the same calls and the timings are stable.
+	*/
+	void ReplayFrame( const unsigned int uiCount );
+
+	/**
+	*	@return The canvas that was painted most recently, or null if it has been destroyed.
+	*/
+	static CwxBaseGLCanvas* GetLastPaintedCanvas();
+
 protected:
 	wxGLContext* GetContext() { return m_pContext; }
 
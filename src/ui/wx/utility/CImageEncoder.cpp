@@ -0,0 +1,143 @@
+#include <cassert>
+#include <cstring>
+
+#include <wx/image.h>
+
+#include "shared/Logging.h"
+#include "shared/TaskScheduler.h"
+
+#include "CImageEncoder.h"
+
+namespace ui
+{
+CImageEncoder::CImageEncoder( const size_t uiMaxQueued )
+	: m_uiMaxQueued( uiMaxQueued )
+{
+	assert( uiMaxQueued > 0 );
+}
+
+CImageEncoder::~CImageEncoder()
+{
+	Finish();
+}
+
+void CImageEncoder::Start()
+{
+	if( IsRunning() )
+		return;
+
+	m_bFinished = false;
+	m_uiSavedCount = 0;
+	m_uiFailedCount = 0;
+
+	m_Thread = std::thread( &CImageEncoder::EncoderMain, this );
+}
+
+void CImageEncoder::Finish()
+{
+	if( !IsRunning() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		m_bFinished = true;
+	}
+
+	m_QueueChanged.notify_all();
+
+	m_Thread.join();
+}
+
+void CImageEncoder::Queue( Job_t&& job )
+{
+	assert( IsRunning() );
+	assert( job.pixels.size() >= static_cast<size_t>( job.iWidth * job.iHeight * 3 ) );
+
+	{
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		m_QueueChanged.wait( lock, [ this ]() { return m_Queue.size() + m_uiEncoding < m_uiMaxQueued; } );
+
+		m_Queue.emplace_back( std::move( job ) );
+	}
+
+	m_QueueChanged.notify_all();
+}
+
+void CImageEncoder::EncoderMain()
+{
+	std::vector<Job_t> jobs;
+
+	while( true )
+	{
+		{
+			std::unique_lock<std::mutex> lock( m_Mutex );
+
+			m_QueueChanged.wait( lock, [ this ]() { return m_bFinished || !m_Queue.empty(); } );
+
+			//Only stop once everything has been encoded.
+			if( m_Queue.empty() )
+				return;
+
+			jobs.clear();
+
+			for( auto& job : m_Queue )
+			{
+				jobs.emplace_back( std::move( job ) );
+			}
+
+			m_Queue.clear();
+
+			m_uiEncoding = jobs.size();
+		}
+
+		tasks::ParallelFor( jobs.size(), [ & ]( const size_t uiIndex )
+		{
+			if( Encode( jobs[ uiIndex ] ) )
+				++m_uiSavedCount;
+			else
+				++m_uiFailedCount;
+		}, 1, "EncodeImage" );
+
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			m_uiEncoding = 0;
+		}
+
+		m_QueueChanged.notify_all();
+	}
+}
+
+bool CImageEncoder::Encode( Job_t& job )
+{
+	wxImage image;
+
+	if( job.bFlipVertically )
+	{
+		//Flip while copying into the image, instead of in a separate pass.
+		image.Create( job.iWidth, job.iHeight, false );
+
+		const size_t uiRowSize = static_cast<size_t>( job.iWidth ) * 3;
+
+		unsigned char* const pDest = image.GetData();
+
+		for( int iRow = 0; iRow < job.iHeight; ++iRow )
+		{
+			memcpy( pDest + iRow * uiRowSize, job.pixels.data() + ( job.iHeight - 1 - iRow ) * uiRowSize, uiRowSize );
+		}
+	}
+	else
+	{
+		image = wxImage( job.iWidth, job.iHeight, job.pixels.data(), true );
+	}
+
+	//Let extension determine format
+	if( !image.SaveFile( job.szFilename ) )
+	{
+		Error( "Failed to save image \"%s\"\n", job.szFilename.c_str() );
+		return false;
+	}
+
+	return true;
+}
+}
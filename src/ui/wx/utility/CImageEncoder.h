@@ -0,0 +1,114 @@
+#ifndef UI_WX_UTILITY_CIMAGEENCODER_H
+#define UI_WX_UTILITY_CIMAGEENCODER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ui/wx/wxInclude.h"
+
+namespace ui
+{
+/**
+*	Encodes and saves images on background threads. An encoder thread collects queued images and encodes them on the task scheduler.
+*	Images are passed as raw RGB pixels rather than as wxImage, since wxImage's reference counting is not thread safe.
+*/
+class CImageEncoder final
+{
+public:
+	/**
+	*	Default maximum number of images waiting to be encoded.
+	*/
+	static const size_t DEFAULT_MAX_QUEUED = 64;
+
+	struct Job_t
+	{
+		/**
+		*	File to save to. The extension determines the format.
+		*/
+		std::string szFilename;
+
+		int iWidth;
+		int iHeight;
+
+		/**
+		*	Whether the rows are stored bottom to top, like OpenGL returns them. They are flipped while the image is encoded.
+		*/
+		bool bFlipVertically;
+
+		/**
+		*	Tightly packed RGB pixels.
+		*/
+		std::vector<unsigned char> pixels;
+	};
+
+public:
+	/**
+	*	@param uiMaxQueued Number of images that can wait to be encoded before Queue blocks.
+	*/
+	CImageEncoder( const size_t uiMaxQueued = DEFAULT_MAX_QUEUED );
+	~CImageEncoder();
+
+	/**
+	*	@return Whether the encoder is running.
+	*/
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	/**
+	*	Starts the encoder. Does nothing if it is already running.
+	*/
+	void Start();
+
+	/**
+	*	Saves all queued images and stops the encoder.
+	*/
+	void Finish();
+
+	/**
+	*	Queues an image to be saved. Blocks while the queue is full.
+	*/
+	void Queue( Job_t&& job );
+
+	/**
+	*	@return Number of images that have been saved since the encoder was started.
+	*/
+	size_t GetSavedCount() const { return m_uiSavedCount; }
+
+	/**
+	*	@return Number of images that could not be saved since the encoder was started.
+	*/
+	size_t GetFailedCount() const { return m_uiFailedCount; }
+
+private:
+	void EncoderMain();
+
+	bool Encode( Job_t& job );
+
+private:
+	const size_t m_uiMaxQueued;
+
+	std::thread m_Thread;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_QueueChanged;
+
+	//Guarded by m_Mutex.
+	std::deque<Job_t> m_Queue;
+	size_t m_uiEncoding = 0;
+	bool m_bFinished = false;
+
+	std::atomic<size_t> m_uiSavedCount{ 0 };
+	std::atomic<size_t> m_uiFailedCount{ 0 };
+
+private:
+	CImageEncoder( const CImageEncoder& ) = delete;
+	CImageEncoder& operator=( const CImageEncoder& ) = delete;
+};
+}
+
+#endif //UI_WX_UTILITY_CIMAGEENCODER_H
@@ -0,0 +1,131 @@
+#include <cassert>
+
+#include "shared/Logging.h"
+
+#include "CVideoPipe.h"
+
+#ifdef WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace ui
+{
+CVideoPipe::CVideoPipe( const size_t uiMaxQueued )
+	: m_uiMaxQueued( uiMaxQueued )
+{
+	assert( uiMaxQueued > 0 );
+}
+
+CVideoPipe::~CVideoPipe()
+{
+	Close();
+}
+
+bool CVideoPipe::Open( const std::string& szCommand )
+{
+	if( IsOpen() )
+		return false;
+
+#ifdef WIN32
+	//cmd.exe removes the outer quotes of the command, so quoted programs need another pair.
+	m_pPipe = popen( ( "\"" + szCommand + "\"" ).c_str(), "wb" );
+#else
+	m_pPipe = popen( szCommand.c_str(), "w" );
+#endif
+
+	if( !m_pPipe )
+	{
+		Error( "Couldn't start encoder \"%s\"\n", szCommand.c_str() );
+		return false;
+	}
+
+	m_bFinished = false;
+	m_uiWrittenCount = 0;
+	m_bFailed = false;
+
+	m_Thread = std::thread( &CVideoPipe::WriterMain, this );
+
+	return true;
+}
+
+bool CVideoPipe::Close()
+{
+	if( !IsOpen() )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		m_bFinished = true;
+	}
+
+	m_QueueChanged.notify_all();
+
+	m_Thread.join();
+
+	const int iResult = pclose( m_pPipe );
+
+	m_pPipe = nullptr;
+
+	if( iResult != 0 )
+	{
+		Error( "Encoder exited with code %d\n", iResult );
+		return false;
+	}
+
+	return !m_bFailed;
+}
+
+void CVideoPipe::Queue( std::vector<unsigned char>&& frame )
+{
+	assert( IsOpen() );
+
+	{
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		m_QueueChanged.wait( lock, [ this ]() { return m_Queue.size() < m_uiMaxQueued; } );
+
+		m_Queue.emplace_back( std::move( frame ) );
+	}
+
+	m_QueueChanged.notify_all();
+}
+
+void CVideoPipe::WriterMain()
+{
+	std::vector<unsigned char> frame;
+
+	while( true )
+	{
+		{
+			std::unique_lock<std::mutex> lock( m_Mutex );
+
+			m_QueueChanged.wait( lock, [ this ]() { return m_bFinished || !m_Queue.empty(); } );
+
+			//Only stop once everything has been written.
+			if( m_Queue.empty() )
+				return;
+
+			frame = std::move( m_Queue.front() );
+
+			m_Queue.pop_front();
+		}
+
+		//Queue can add the next frame while this one is written.
+		m_QueueChanged.notify_all();
+
+		//Frames are still taken out of the queue after a failure so Queue never blocks forever.
+		if( m_bFailed )
+			continue;
+
+		if( fwrite( frame.data(), 1, frame.size(), m_pPipe ) != frame.size() )
+		{
+			Error( "Couldn't write frame %u to the encoder\n", static_cast<unsigned int>( m_uiWrittenCount ) );
+			m_bFailed = true;
+			continue;
+		}
+
+		++m_uiWrittenCount;
+	}
+}
+}
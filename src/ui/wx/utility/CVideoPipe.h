@@ -0,0 +1,89 @@
+#ifndef UI_WX_UTILITY_CVIDEOPIPE_H
+#define UI_WX_UTILITY_CVIDEOPIPE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ui
+{
+/**
+*	Writes raw video frames to the standard input of an encoder process, such as ffmpeg, on a background thread.
+*	Frames are written in the order they are queued. The encoder process does the actual encoding, on its own threads.
+*/
+class CVideoPipe final
+{
+public:
+	/**
+	*	Default maximum number of frames waiting to be written.
+	*/
+	static const size_t DEFAULT_MAX_QUEUED = 8;
+
+public:
+	/**
+	*	@param uiMaxQueued Number of frames that can wait to be written before Queue blocks.
+	*/
+	CVideoPipe( const size_t uiMaxQueued = DEFAULT_MAX_QUEUED );
+	~CVideoPipe();
+
+	/**
+	*	@return Whether the pipe is open.
+	*/
+	bool IsOpen() const { return m_pPipe != nullptr; }
+
+	/**
+	*	Starts the encoder process and the thread that writes frames to it.
+	*	@param szCommand Command line of the encoder.
+	*	@return Whether the process was started.
+	*/
+	bool Open( const std::string& szCommand );
+
+	/**
+	*	Writes all queued frames, closes the pipe and waits for the encoder to exit.
+	*	@return Whether every frame was written and the encoder exited successfully.
+	*/
+	bool Close();
+
+	/**
+	*	Queues a frame to be written. Blocks while the queue is full.
+	*/
+	void Queue( std::vector<unsigned char>&& frame );
+
+	/**
+	*	@return Number of frames that have been written since the pipe was opened.
+	*/
+	size_t GetWrittenCount() const { return m_uiWrittenCount; }
+
+private:
+	void WriterMain();
+
+private:
+	const size_t m_uiMaxQueued;
+
+	FILE* m_pPipe = nullptr;
+
+	std::thread m_Thread;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_QueueChanged;
+
+	//Guarded by m_Mutex.
+	std::deque<std::vector<unsigned char>> m_Queue;
+	bool m_bFinished = false;
+
+	std::atomic<size_t> m_uiWrittenCount{ 0 };
+	std::atomic<bool> m_bFailed{ false };
+
+private:
+	CVideoPipe( const CVideoPipe& ) = delete;
+	CVideoPipe& operator=( const CVideoPipe& ) = delete;
+};
+}
+
+#endif //UI_WX_UTILITY_CVIDEOPIPE_H
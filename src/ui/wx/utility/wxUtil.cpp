@@ -1,5 +1,7 @@
 #include <algorithm>
 
+#include <wx/dir.h>
+#include <wx/filename.h>
 #include <wx/gbsizer.h>
 
 #include "wxUtil.h"
@@ -54,6 +56,59 @@ bool LaunchDefaultTextEditor( const wxString& szFilename )
 	return bResult;
 }
 
+bool CopyOutputFiles( const wxString& szInputDir, const wxString& szOutputDir, const wxArrayString& filters, wxString& szLog )
+{
+	if( szOutputDir.IsEmpty() )
+	{
+		szLog += "Cannot copy output files, output directory unspecified!\n";
+		return false;
+	}
+
+	if( filters.IsEmpty() )
+	{
+		szLog += "No output file filters specified\n";
+		return true;
+	}
+
+	const wxFileName inputDir( szInputDir );
+
+	wxDir dir( inputDir.GetFullPath() );
+
+	if( !dir.IsOpened() )
+	{
+		szLog += wxString::Format( "Couldn't access directory \"%s\" contents\n", inputDir.GetPath() );
+		return false;
+	}
+
+	wxString szFilename;
+
+	size_t uiNumCopied = 0;
+
+	for( const auto& szFilter : filters )
+	{
+		for( bool bContinue = dir.GetFirst( &szFilename, szFilter, wxDIR_FILES ); bContinue; bContinue = dir.GetNext( &szFilename ) )
+		{
+			const wxString szIn = dir.GetNameWithSep() + szFilename;
+			const wxString szOut = szOutputDir + '/' + szFilename;
+
+			if( wxCopyFile( szIn, szOut, true ) )
+			{
+				++uiNumCopied;
+
+				szLog += wxString::Format( "Copied \"%s\"\n", szFilename );
+			}
+			else
+			{
+				szLog += wxString::Format( "Failed to copy \"%s\"\n", szFilename );
+			}
+		}
+	}
+
+	szLog += wxString::Format( "%u file%s copied to %s\n", uiNumCopied, uiNumCopied != 1 ? "s" : "", szOutputDir );
+
+	return true;
+}
+
 wxSizer* CreateCheckBoxSizer( wxCheckBox** ppCheckBoxes, const size_t uiNumCheckBoxes, const size_t uiNumColumns, int flag, int border )
 {
 	wxASSERT( ppCheckBoxes );
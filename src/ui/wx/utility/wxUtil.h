@@ -56,6 +56,16 @@ Color wxToColor( const wxColor& color );
 */
 bool LaunchDefaultTextEditor( const wxString& szFilename );
 
+/**
+*	Copies the files in a directory that match any of the given filters to another directory. Used to copy the output of compilers.
+*	@param szInputDir Directory to copy from.
+*	@param szOutputDir Directory to copy to.
+*	@param filters Wildcard filters to match files against.
+*	@param szLog Receives a line for every file that was copied or failed to copy, and a summary. Errors are added as well.
+*	@return false if the output directory was not given or the input directory couldn't be read, true otherwise.
+*/
+bool CopyOutputFiles( const wxString& szInputDir, const wxString& szOutputDir, const wxArrayString& filters, wxString& szLog );
+
 /**
 *	@brief Given an array of checkboxes and a maximum number of columns, returns a sizer containing the checkboxes, arranged in columns.
 *
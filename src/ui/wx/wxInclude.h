@@ -14,6 +14,9 @@ enum wxSharedIdentifier
 	//Messages window
 	wxID_SHARED_MESSAGES_CLEAR,
 	wxID_SHARED_MESSAGES_COMMAND,
+	wxID_SHARED_MESSAGES_SHOWMESSAGES,
+	wxID_SHARED_MESSAGES_SHOWWARNINGS,
+	wxID_SHARED_MESSAGES_SHOWERRORS,
 
 	//Game configs panel
 	wxID_SHARED_GAMECONFIGS_CONFIG_CHANGED,
@@ -29,6 +32,13 @@ enum wxSharedIdentifier
 	wxID_PROCESSDLG_SENDINPUT,
 	wxID_PROCESSDLG_TERMINATE,
 	wxID_PROCESSDLG_CLOSE,
+	wxID_PROCESSDLG_FLUSHOUTPUT,
+
+	//Process queue dialog
+	wxID_PROCESSQUEUEDLG_JOBS,
+	wxID_PROCESSQUEUEDLG_UPDATE,
+	wxID_PROCESSQUEUEDLG_CANCEL,
+	wxID_PROCESSQUEUEDLG_CLOSE,
 
 	wxID_SHARED_HIGHEST
 };